@@ -19,6 +19,7 @@ from typing import (
     Sequence,
     TypeVar,
     Callable,
+    Union,
 )
 from typing_extensions import Protocol
 
@@ -26,6 +27,41 @@ class Readable(Protocol):
     def read(self, n: int = -1) -> bytes:
         ...
 
+class BufferReader:
+    """
+    A byte stream over a buffer, that can be used instead of a ``BytesIO``.
+
+    The buffer is never copied: :meth:`read` only materializes the bytes that it returns, and :meth:`read_view` and
+    :meth:`sub_reader` return views into the original buffer, so that the large values of a PSBT (like the non-witness
+    UTXOs) are parsed in place.
+    """
+
+    def __init__(self, data: Union[bytes, bytearray, memoryview]) -> None:
+        self._view = memoryview(data)
+        self._pos = 0
+
+    def read(self, n: int = -1) -> bytes:
+        return bytes(self.read_view(n))
+
+    def read_view(self, n: int = -1) -> memoryview:
+        """Like :meth:`read`, but returns a view into the buffer instead of a copy."""
+        end = len(self._view) if n < 0 else min(self._pos + n, len(self._view))
+        result = self._view[self._pos:end]
+        self._pos = end
+        return result
+
+    def sub_reader(self, n: int) -> 'BufferReader':
+        """Returns a reader over the next ``n`` bytes (or the remaining ones, if fewer), and skips them."""
+        return BufferReader(self.read_view(n))
+
+    def tell(self) -> int:
+        return self._pos
+
+    def getbuffer(self) -> memoryview:
+        """Returns a view of the whole buffer of the reader."""
+        return self._view
+
+
 class Deserializable(Protocol):
     def deserialize(self, f: Readable) -> None:
         ...
@@ -80,6 +116,19 @@ def deser_string(f: Readable) -> bytes:
     nit = deser_compact_size(f)
     return f.read(nit)
 
+def deser_string_reader(f: Readable) -> BufferReader:
+    """
+    Deserialize a variable length byte string like :func:`deser_string`, and return a byte stream over it.
+    If ``f`` is a :class:`BufferReader`, the stream is a view into its buffer, and the string is not copied.
+
+    :param f: The byte stream
+    :returns: A byte stream over the byte string that was serialized
+    """
+    nit = deser_compact_size(f)
+    if isinstance(f, BufferReader):
+        return f.sub_reader(nit)
+    return BufferReader(f.read(nit))
+
 def ser_string(s: bytes) -> bytes:
     """
     Serialize a byte string with Bitcoin's variable length string serialization.
@@ -0,0 +1,332 @@
+import asyncio
+
+from abc import ABC, abstractmethod
+from concurrent.futures import Executor
+from typing import Tuple, List, Mapping, Optional, Union
+
+from bitcoin_client.command import BitcoinCommand, ApduException, Flow, PreparedPsbt, ProgressCallback, T
+from bitcoin_client.client_command import ClientCommandInterpreter
+from bitcoin_client.command_builder import MAX_BATCH_DATA_LEN
+from bitcoin_client.psbt import PSBT
+from bitcoin_client.psbt_stream import PsbtSource
+from bitcoin_client.tracing import ExchangeMetrics, INIT_PHASE, Timer
+from bitcoin_client.wallet import Wallet
+
+
+class AsyncTransport(ABC):
+    """Asynchronous transport to a single device.
+
+    Like the synchronous clients, apdu_exchange returns the response data if the status word is 0x9000, and raises an
+    ApduException otherwise.
+    """
+
+    @abstractmethod
+    async def apdu_exchange(
+        self, cla: int, ins: int, data: bytes = b"", p1: int = 0, p2: int = 0
+    ) -> bytes:
+        raise NotImplementedError()
+
+    async def stop(self) -> None:
+        pass
+
+
+class ThreadedAsyncTransport(AsyncTransport):
+    """AsyncTransport that wraps a synchronous client (for example, HIDClient or SpeculosClient).
+
+    Each exchange runs in the default executor of the event loop, so that waiting for a device does not block the
+    loop.
+    """
+
+    def __init__(self, client) -> None:
+        self.client = client
+
+    async def apdu_exchange(
+        self, cla: int, ins: int, data: bytes = b"", p1: int = 0, p2: int = 0
+    ) -> bytes:
+        loop = asyncio.get_running_loop()
+        return await loop.run_in_executor(
+            None, lambda: self.client.apdu_exchange(cla=cla, ins=ins, data=data, p1=p1, p2=p2))
+
+    async def stop(self) -> None:
+        loop = asyncio.get_running_loop()
+        await loop.run_in_executor(None, self.client.stop)
+
+
+class AsyncBitcoinCommand:
+    """Asynchronous version of BitcoinCommand, with the same commands as coroutines.
+
+    The commands run the same flows as BitcoinCommand; the interruptions are answered by the client command
+    interpreter as the responses arrive, so a single event loop can drive many devices at once, each with its own
+    AsyncBitcoinCommand. The parameters are the same as for BitcoinCommand, except that `transport` is an
+    AsyncTransport.
+
+    Concurrent commands on the same AsyncBitcoinCommand are executed one at a time.
+    """
+
+    def __init__(self, transport: AsyncTransport, debug: bool = False, prefetch: bool = False,
+                 psbt_cache_size: int = 0, latency_ms: int = 0, preimage_spill_size: Optional[int] = None,
+                 coalesce_yields: bool = False, response_cache: bool = False,
+                 progress_callback: Optional[ProgressCallback] = None,
+                 metrics: Optional[ExchangeMetrics] = None,
+                 precompute_executor: Optional[Executor] = None) -> None:
+        self.transport = transport
+        # only used to build the flows and the CONTINUE apdus; it never exchanges apdus itself
+        self._cmd = BitcoinCommand(client=None, debug=debug, prefetch=prefetch, psbt_cache_size=psbt_cache_size,
+                                   latency_ms=latency_ms, preimage_spill_size=preimage_spill_size,
+                                   coalesce_yields=coalesce_yields, response_cache=response_cache,
+                                   progress_callback=progress_callback, metrics=metrics,
+                                   precompute_executor=precompute_executor)
+        # serializes the commands; created in the running event loop on first use
+        self._lock: Optional[asyncio.Lock] = None
+
+    async def _apdu_exchange(self, apdu: dict) -> Tuple[int, bytes]:
+        timer = Timer() if self._cmd.metrics is not None else None
+        try:
+            sw, response = 0x9000, await self.transport.apdu_exchange(**apdu)
+        except ApduException as e:
+            self._cmd._check_status_word(e.sw)
+            sw, response = e.sw, e.data
+        except Exception:
+            self._cmd.clear_response_cache()
+            raise
+
+        if timer is not None:
+            self._cmd._record_apdu_exchange(timer, apdu, sw, response)
+        return sw, response
+
+    def clear_response_cache(self) -> None:
+        """See BitcoinCommand.clear_response_cache."""
+
+        self._cmd.clear_response_cache()
+
+    async def warm_response_cache(self, bip32_paths: Optional[List[str]] = None) -> None:
+        """See BitcoinCommand.warm_response_cache."""
+
+        await self._run_flow(self._cmd._warm_response_cache_flow(bip32_paths))
+
+    async def make_request(
+        self, apdu: dict, client_intepreter: ClientCommandInterpreter = None
+    ) -> Tuple[int, bytes]:
+        if self._cmd.metrics is not None:
+            self._cmd.metrics.set_phase(INIT_PHASE)
+
+        sw, response = await self._apdu_exchange(apdu)
+
+        while sw == 0xE000:
+            sw, response = await self._apdu_exchange(self._cmd.continue_apdu(response, client_intepreter))
+
+        return sw, response
+
+    async def _run_flow(self, flow: "Flow[T]") -> T:
+        if self._lock is None:
+            self._lock = asyncio.Lock()
+
+        async with self._lock:
+            try:
+                request = next(flow)
+                while True:
+                    request = flow.send(await self.make_request(*request))
+            except StopIteration as e:
+                return e.value
+
+    async def get_extended_pubkey(self, bip32_path: str, display: bool = False) -> str:
+        """See BitcoinCommand.get_extended_pubkey."""
+
+        return await self._run_flow(self._cmd._get_extended_pubkey_flow(bip32_path, display))
+
+    async def get_extended_pubkeys(self, bip32_paths: List[str]) -> List[str]:
+        """See BitcoinCommand.get_extended_pubkeys."""
+
+        return await self._run_flow(self._cmd._get_extended_pubkeys_flow(bip32_paths))
+
+    async def get_child_extended_pubkeys(self, base_path: str, first_child: int, count: int) -> List[str]:
+        """See BitcoinCommand.get_child_extended_pubkeys."""
+
+        return await self._run_flow(self._cmd._get_child_extended_pubkeys_flow(base_path, first_child, count))
+
+    async def get_account_xpubs(self) -> List[str]:
+        """See BitcoinCommand.get_account_xpubs."""
+
+        return await self._run_flow(self._cmd._get_account_xpubs_flow())
+
+    async def sign_message(self, message: Union[str, bytes], bip32_path: str) -> str:
+        """See BitcoinCommand.sign_message."""
+
+        return await self._run_flow(self._cmd._sign_message_flow(message, bip32_path))
+
+    async def register_wallet(self, wallet: Wallet, store: bool = False) -> Tuple[bytes, bytes]:
+        """See BitcoinCommand.register_wallet."""
+
+        return await self._run_flow(self._cmd._register_wallet_flow(wallet, store))
+
+    async def register_wallet_compiled(self, wallet: Wallet) -> Tuple[bytes, bytes, bytes, bytes]:
+        """See BitcoinCommand.register_wallet_compiled."""
+
+        return await self._run_flow(self._cmd._register_wallet_compiled_flow(wallet))
+
+    async def register_spending_policy(
+        self, wallet: Wallet, wallet_hmac: Optional[bytes], max_tx_amount: int, max_session_amount: int,
+        destinations: List[bytes]
+    ) -> Tuple[bytes, bytes]:
+        """See BitcoinCommand.register_spending_policy."""
+
+        return await self._run_flow(self._cmd._register_spending_policy_flow(
+            wallet, wallet_hmac, max_tx_amount, max_session_amount, destinations))
+
+    async def get_wallet_address(
+        self,
+        wallet: Wallet,
+        wallet_hmac: Optional[bytes],
+        change: int,
+        address_index: int,
+        display: bool,
+        compiled_policy: Optional[Tuple[bytes, bytes]] = None,
+    ) -> str:
+        """See BitcoinCommand.get_wallet_address."""
+
+        return await self._run_flow(
+            self._cmd._get_wallet_address_flow(wallet, wallet_hmac, change, address_index, display, compiled_policy))
+
+    async def get_wallet_addresses(
+        self,
+        wallet: Wallet,
+        wallet_hmac: Optional[bytes],
+        change: int,
+        start_index: int,
+        count: int,
+        compiled_policy: Optional[Tuple[bytes, bytes]] = None,
+    ) -> List[str]:
+        """See BitcoinCommand.get_wallet_addresses."""
+
+        return await self._run_flow(
+            self._cmd._get_wallet_addresses_flow(wallet, wallet_hmac, change, start_index, count, compiled_policy))
+
+    async def get_wallet_script_pubkeys(
+        self,
+        wallet: Wallet,
+        wallet_hmac: Optional[bytes],
+        change: int,
+        start_index: int,
+        count: int,
+    ) -> List[bytes]:
+        """See BitcoinCommand.get_wallet_script_pubkeys."""
+
+        return await self._run_flow(
+            self._cmd._get_wallet_script_pubkeys_flow(wallet, wallet_hmac, change, start_index, count))
+
+    async def get_wallet_addresses_batch(
+        self,
+        requests: List[Tuple[Wallet, Optional[bytes], int, int]],
+        max_batch_len: int = MAX_BATCH_DATA_LEN,
+    ) -> List[str]:
+        """See BitcoinCommand.get_wallet_addresses_batch."""
+
+        return await self._run_flow(self._cmd._get_wallet_addresses_batch_flow(requests, max_batch_len))
+
+    async def sign_psbt(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes], resume: bool = False,
+        input_range: Optional[Tuple[int, int]] = None
+    ) -> Mapping[int, bytes]:
+        """See BitcoinCommand.sign_psbt."""
+
+        return await self._run_flow(self._cmd._sign_psbt_flow(psbt, wallet, wallet_hmac, resume, input_range))
+
+    async def sign_psbt_stream(
+        self, psbt: PsbtSource, wallet: Wallet, wallet_hmac: Optional[bytes], resume: bool = False,
+        input_range: Optional[Tuple[int, int]] = None
+    ) -> Mapping[int, bytes]:
+        """See BitcoinCommand.sign_psbt_stream."""
+
+        return await self._run_flow(self._cmd._sign_psbt_stream_flow(psbt, wallet, wallet_hmac, resume, input_range))
+
+    async def sign_psbt_all_signatures(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes], resume: bool = False,
+        input_range: Optional[Tuple[int, int]] = None
+    ) -> Mapping[int, List[bytes]]:
+        """See BitcoinCommand.sign_psbt_all_signatures."""
+
+        return await self._run_flow(
+            self._cmd._sign_psbt_all_signatures_flow(psbt, wallet, wallet_hmac, resume, input_range))
+
+    async def sign_psbt_multi_wallet(
+        self, psbt: PSBT, wallets: List[Tuple[Wallet, Optional[bytes]]],
+        input_range: Optional[Tuple[int, int]] = None
+    ) -> Mapping[int, List[bytes]]:
+        """See BitcoinCommand.sign_psbt_multi_wallet."""
+
+        return await self._run_flow(self._cmd._sign_psbt_multi_wallet_flow(psbt, wallets, input_range))
+
+    async def sign_psbt_in_order(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes], input_order: Optional[List[int]] = None,
+        input_range: Optional[Tuple[int, int]] = None
+    ) -> Mapping[int, List[bytes]]:
+        """See BitcoinCommand.sign_psbt_in_order."""
+
+        return await self._run_flow(self._cmd._sign_psbt_in_order_flow(
+            psbt, wallet, wallet_hmac, input_order, input_range))
+
+    async def check_psbt(self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes]) -> dict:
+        """See BitcoinCommand.check_psbt."""
+
+        return await self._run_flow(self._cmd._check_psbt_flow(psbt, wallet, wallet_hmac))
+
+    async def sign_prepared_psbt(
+        self, prepared: PreparedPsbt, wallet_hmac: Optional[bytes], resume: bool = False,
+        input_range: Optional[Tuple[int, int]] = None
+    ) -> Mapping[int, List[bytes]]:
+        """See BitcoinCommand.sign_prepared_psbt."""
+
+        return await self._run_flow(self._cmd._sign_prepared_psbt_flow(prepared, wallet_hmac, resume, input_range))
+
+    async def sign_proof_of_reserves(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes], message: Union[str, bytes]
+    ) -> Mapping[int, List[bytes]]:
+        """See BitcoinCommand.sign_proof_of_reserves."""
+
+        return await self._run_flow(self._cmd._sign_proof_of_reserves_flow(psbt, wallet, wallet_hmac, message))
+
+    async def sign_psbt_amendable(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes],
+        amend_record: Optional[Tuple[bytes, bytes]] = None
+    ) -> Tuple[Mapping[int, List[bytes]], Tuple[bytes, bytes]]:
+        """See BitcoinCommand.sign_psbt_amendable."""
+
+        return await self._run_flow(self._cmd._sign_psbt_amend_flow(psbt, wallet, wallet_hmac, amend_record, True))
+
+    async def sign_psbt_amend(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes], amend_record: Tuple[bytes, bytes]
+    ) -> Mapping[int, List[bytes]]:
+        """See BitcoinCommand.sign_psbt_amend."""
+
+        signatures, _ = await self._run_flow(
+            self._cmd._sign_psbt_amend_flow(psbt, wallet, wallet_hmac, amend_record, False))
+        return signatures
+
+    async def sign_psbt_unattended(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes], spending_policy: Tuple[bytes, bytes],
+        destinations: List[bytes]
+    ) -> Mapping[int, List[bytes]]:
+        """See BitcoinCommand.sign_psbt_unattended."""
+
+        return await self._run_flow(
+            self._cmd._sign_psbt_unattended_flow(psbt, wallet, wallet_hmac, spending_policy, destinations))
+
+    async def get_master_fingerprint(self) -> bytes:
+        """See BitcoinCommand.get_master_fingerprint."""
+
+        return await self._run_flow(self._cmd._get_master_fingerprint_flow())
+
+    async def get_app_stats(self) -> dict:
+        """See BitcoinCommand.get_app_stats."""
+
+        return await self._run_flow(self._cmd._get_app_stats_flow())
+
+    async def get_processor_trace(self) -> dict:
+        """See BitcoinCommand.get_processor_trace."""
+
+        return await self._run_flow(self._cmd._get_processor_trace_flow())
+
+    async def get_debug_trace(self) -> dict:
+        """See BitcoinCommand.get_debug_trace."""
+
+        return await self._run_flow(self._cmd._get_debug_trace_flow())
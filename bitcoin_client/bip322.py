@@ -0,0 +1,83 @@
+"""
+Construction of the transactions of a BIP-322 proof of funds, to be signed with `BitcoinCommand.sign_proof_of_reserves`.
+
+A proof for a message is a 'to_sign' transaction that spends the only output of a virtual 'to_spend' transaction,
+committing to the message and to the scriptPubKey of the challenge address, followed by the UTXOs whose ownership is
+proven. Since 'to_spend' is never mined, 'to_sign' can not be mined either, therefore signing it moves no funds.
+"""
+
+import copy
+from typing import Optional, Sequence, Tuple, Union
+
+from bitcoin_client._script import is_witness
+from bitcoin_client.key import tagged_hash
+from bitcoin_client.psbt import PSBT, PartiallySignedInput, PartiallySignedOutput
+from bitcoin_client.tx import COutPoint, CTransaction, CTxIn, CTxOut
+
+
+def message_hash(message: Union[str, bytes]) -> bytes:
+    """Returns the BIP-322 hash of the message (a string is encoded in UTF-8)."""
+
+    if isinstance(message, str):
+        message = message.encode("utf-8")
+    return tagged_hash("BIP0322-signed-message", message)
+
+
+def make_to_spend(msg_hash: bytes, challenge_script: bytes) -> CTransaction:
+    """Returns the 'to_spend' transaction for the hash of the message, and the scriptPubKey of the challenge."""
+
+    tx = CTransaction()
+    tx.nVersion = 0
+    tx.vin = [CTxIn(COutPoint(0, 0xffffffff), b"\x00\x20" + msg_hash, 0)]
+    tx.vout = [CTxOut(0, challenge_script)]
+    tx.nLockTime = 0
+    tx.rehash()
+    return tx
+
+
+def make_proof_psbt(
+    msg_hash: bytes, challenge_script: bytes, utxos: Sequence[Tuple[COutPoint, PartiallySignedInput]],
+    challenge_input: Optional[PartiallySignedInput] = None
+) -> PSBT:
+    """Returns the 'to_sign' transaction of a proof of funds, as a PSBT of version 0.
+
+    Parameters
+    ----------
+    msg_hash : bytes
+        The BIP-322 hash of the message, as returned by `message_hash`.
+
+    challenge_script : bytes
+        The scriptPubKey of the challenge address, that the first input spends.
+
+    utxos : Sequence[Tuple[COutPoint, PartiallySignedInput]]
+        The outpoints of the UTXOs that are proven, each with its PSBT input map (with the UTXO and the key
+        derivations needed to sign it).
+
+    challenge_input : Optional[PartiallySignedInput]
+        If the challenge address belongs to the wallet, the PSBT input map with the key derivations for its
+        scriptPubKey, so that the first input is also signed; its UTXO fields are filled in from 'to_spend'.
+
+    Returns
+    -------
+    PSBT
+        The 'to_sign' PSBT: version 0, locktime 0, a single empty OP_RETURN output of value 0.
+    """
+
+    to_spend = make_to_spend(msg_hash, challenge_script)
+
+    first_input = copy.deepcopy(challenge_input) if challenge_input is not None else PartiallySignedInput()
+    first_input.non_witness_utxo = to_spend
+    if is_witness(challenge_script)[0]:
+        first_input.witness_utxo = to_spend.vout[0]
+
+    tx = CTransaction()
+    tx.nVersion = 0
+    tx.vin = [CTxIn(COutPoint(to_spend.sha256, 0), b"", 0)]
+    tx.vin += [CTxIn(outpoint, b"", 0) for outpoint, _ in utxos]
+    tx.vout = [CTxOut(0, b"\x6a")]
+    tx.nLockTime = 0
+
+    psbt = PSBT(tx)
+    psbt.inputs = [first_input] + [copy.deepcopy(psbt_in) for _, psbt_in in utxos]
+    psbt.outputs = [PartiallySignedOutput()]
+    return psbt
@@ -1,10 +1,20 @@
 from enum import IntEnum
-from typing import List, Mapping
+from typing import Callable, Dict, List, Mapping, MutableMapping, Optional
 from collections import deque
+from concurrent.futures import Executor, Future
 from hashlib import sha256
 
 from bitcoin_client.common import ByteStreamParser, sha256, write_varint
 from bitcoin_client.merkle import MerkleTree, element_hash
+from bitcoin_client.tracing import ExchangeMetrics, Timer
+
+# Maximum length of the response to a client command, which is sent as the payload of a single (short) CONTINUE apdu.
+# The responses are packed up to this length; anything that does not fit is queued for GET_MORE_ELEMENTS.
+MAX_RESPONSE_SIZE = 255
+
+# Minimum number of leaves of the known Merkle trees that are precomputed; the lookup tables of a smaller tree (like
+# the trees of the keys and values of most PSBT maps) would be larger than the tree, for no measurable gain.
+PRECOMPUTE_MIN_LEAVES = 16
 
 
 class ClientCommandCode(IntEnum):
@@ -12,13 +22,22 @@ class ClientCommandCode(IntEnum):
     GET_PREIMAGE = 0x40
     GET_MERKLE_LEAF_PROOF = 0x41
     GET_MERKLE_LEAF_INDEX = 0x42
+    GET_MERKLE_LEAVES_PROOF = 0x43
+    GET_MERKLEIZED_MAP_VALUE = 0x44
+    GET_PREIMAGES = 0x45
     GET_MORE_ELEMENTS = 0xA0
+    BATCH = 0xA1
 
 
 class ClientCommand:
     def execute(self, request: bytes) -> bytes:
         raise NotImplementedError("Subclasses should implement this method.")
 
+    def predict_next_requests(self, request: bytes) -> List[bytes]:
+        """Returns the requests that the hardware wallet is likely to send right after `request`, in order.
+        Their responses can be pushed in advance, as the hardware wallet does not trust them anyway."""
+        return []
+
     @property
     def code(self) -> int:
         raise NotImplementedError("Subclasses should implement this method.")
@@ -37,6 +56,16 @@ class YieldCommand(ClientCommand):
         return b""
 
 
+def get_preimage_request(req_hash: bytes) -> bytes:
+    """Returns the GET_PREIMAGE request that the hardware wallet sends for the preimage of `req_hash`."""
+    return bytes([ClientCommandCode.GET_PREIMAGE, 0]) + req_hash
+
+
+def get_preimages_request(req_hashes: List[bytes]) -> bytes:
+    """Returns the GET_PREIMAGES request that the hardware wallet sends for the preimages of `req_hashes`."""
+    return bytes([ClientCommandCode.GET_PREIMAGES, len(req_hashes)]) + b"".join(req_hashes)
+
+
 class GetPreimageCommand(ClientCommand):
     def __init__(self, known_preimages: Mapping[bytes, bytes], queue: "deque[bytes]"):
         self.queue = queue
@@ -60,10 +89,10 @@ class GetPreimageCommand(ClientCommand):
 
             preimage_len_out = write_varint(len(known_preimage))
 
-            # We can send at most 255 - len(preimage_len_out) - 1 bytes in a single message;
+            # We can send at most MAX_RESPONSE_SIZE - len(preimage_len_out) - 1 bytes in a single message;
             # the rest will be stored for GET_MORE_ELEMENTS
 
-            max_payload_size = 255 - len(preimage_len_out) - 1
+            max_payload_size = MAX_RESPONSE_SIZE - len(preimage_len_out) - 1
 
             payload_size = min(max_payload_size, len(known_preimage))
 
@@ -101,6 +130,7 @@ class GetMerkleLeafProofCommand(ClientCommand):
         root = req.read_bytes(32)
         tree_size = req.read_varint()
         leaf_index = req.read_varint()
+        proof_size = req.read_uint(1)
         req.assert_empty()
 
         if not root in self.known_trees:
@@ -118,8 +148,15 @@ class GetMerkleLeafProofCommand(ClientCommand):
 
         proof = mt.prove_leaf(leaf_index)
 
-        # Compute how many elements we can fit in 255 - 32 - 1 - 1 = 221 bytes
-        n_response_elements = min((255 - 32 - 1 - 1) // 32, len(proof))
+        if proof_size > len(proof):
+            raise ValueError(f"Invalid proof size.")
+
+        # The hardware wallet might only need the first part of the proof, if it already knows
+        # the hash of an ancestor of the leaf
+        proof = proof[:proof_size]
+
+        # Compute how many elements fit after the leaf hash and the two lengths
+        n_response_elements = min((MAX_RESPONSE_SIZE - 32 - 1 - 1) // 32, len(proof))
         n_leftover_elements = len(proof) - n_response_elements
 
         # Add to the queue any proof elements that do not fit the response
@@ -136,6 +173,85 @@ class GetMerkleLeafProofCommand(ClientCommand):
         )
 
 
+    def predict_next_requests(self, request: bytes) -> List[bytes]:
+        req = ByteStreamParser(request[1:])
+        root = req.read_bytes(32)
+        req.read_varint()  # tree_size
+        leaf_index = req.read_varint()
+
+        # the preimage of a leaf is usually requested right after its proof
+        return [get_preimage_request(self.known_trees[root].get(leaf_index))]
+
+
+class GetMerkleLeavesProofCommand(ClientCommand):
+    def __init__(self, known_trees: Mapping[bytes, MerkleTree], queue: "deque[bytes]"):
+        self.queue = queue
+        self.known_trees = known_trees
+
+    @property
+    def code(self) -> int:
+        return ClientCommandCode.GET_MERKLE_LEAVES_PROOF
+
+    def execute(self, request: bytes) -> bytes:
+        req = ByteStreamParser(request[1:])
+
+        root = req.read_bytes(32)
+        tree_size = req.read_varint()
+        first_leaf_index = req.read_varint()
+        n_leaves = req.read_varint()
+        req.assert_empty()
+
+        if not root in self.known_trees:
+            raise ValueError(f"Unknown Merkle root: {root.hex()}.")
+
+        mt: MerkleTree = self.known_trees[root]
+
+        if first_leaf_index >= tree_size or len(mt) != tree_size:
+            raise ValueError(f"Invalid index or tree size.")
+
+        if len(self.queue) != 0:
+            raise RuntimeError(
+                "This command should not execute when the queue is not empty."
+            )
+
+        last_leaf_index = min(first_leaf_index + n_leaves, tree_size)
+        leaves = [mt.get(i) for i in range(first_leaf_index, last_leaf_index)]
+        proof = mt.prove_leaves(first_leaf_index, n_leaves)
+
+        elements = leaves + proof
+
+        # Compute how many elements fit after the two lengths
+        n_response_elements = min((MAX_RESPONSE_SIZE - 1 - 1) // 32, len(elements))
+        n_leftover_elements = len(elements) - n_response_elements
+
+        # Add to the queue any elements that do not fit the response
+        if (n_leftover_elements > 0):
+            self.queue.extend(elements[-n_leftover_elements:])
+
+        return b"".join(
+            [
+                len(proof).to_bytes(1, byteorder="big"),
+                n_response_elements.to_bytes(1, byteorder="big"),
+                *elements[:n_response_elements],
+            ]
+        )
+
+
+    def predict_next_requests(self, request: bytes) -> List[bytes]:
+        req = ByteStreamParser(request[1:])
+        root = req.read_bytes(32)
+        tree_size = req.read_varint()
+        first_leaf_index = req.read_varint()
+        n_leaves = req.read_varint()
+
+        # the preimages of the leaves are usually requested in order, after the proof
+        mt: MerkleTree = self.known_trees[root]
+        return [
+            get_preimage_request(mt.get(i))
+            for i in range(first_leaf_index, min(first_leaf_index + n_leaves, tree_size))
+        ]
+
+
 class GetMerkleLeafIndexCommand(ClientCommand):
     def __init__(self, known_trees: Mapping[bytes, MerkleTree]):
         self.known_trees = known_trees
@@ -164,6 +280,118 @@ class GetMerkleLeafIndexCommand(ClientCommand):
         return found.to_bytes(1, byteorder="big") + write_varint(leaf_index)
 
 
+class GetMerkleizedMapValueCommand(ClientCommand):
+    def __init__(
+        self,
+        known_preimages: Mapping[bytes, bytes],
+        known_trees: Mapping[bytes, MerkleTree],
+        queue: "deque[bytes]",
+    ):
+        self.queue = queue
+        self.known_preimages = known_preimages
+        self.known_trees = known_trees
+
+    @property
+    def code(self) -> int:
+        return ClientCommandCode.GET_MERKLEIZED_MAP_VALUE
+
+    def execute(self, request: bytes) -> bytes:
+        req = ByteStreamParser(request[1:])
+
+        keys_root = req.read_bytes(32)
+        values_root = req.read_bytes(32)
+        size = req.read_varint()
+        key_hash = req.read_bytes(32)
+        req.assert_empty()
+
+        for root in [keys_root, values_root]:
+            if root not in self.known_trees:
+                raise ValueError(f"Unknown Merkle root: {root.hex()}.")
+
+        keys_tree: MerkleTree = self.known_trees[keys_root]
+        values_tree: MerkleTree = self.known_trees[values_root]
+
+        if len(keys_tree) != size or len(values_tree) != size:
+            raise ValueError(f"Invalid tree size.")
+
+        if len(self.queue) != 0:
+            raise RuntimeError(
+                "This command should not execute when the queue is not empty."
+            )
+
+        try:
+            leaf_index = keys_tree.leaf_index(key_hash)
+        except ValueError:
+            return b'\0'
+
+        value_hash = values_tree.get(leaf_index)
+        if value_hash not in self.known_preimages:
+            raise RuntimeError(f"Requested unknown preimage for: {value_hash.hex()}")
+
+        value = self.known_preimages[value_hash][1:]  # skip the 0x00 prefix of the leaf preimage
+
+        key_proof = keys_tree.prove_leaf(leaf_index)
+        value_proof = values_tree.prove_leaf(leaf_index)
+
+        response = b"".join(
+            [
+                b'\1',
+                write_varint(leaf_index),
+                write_varint(len(value)),
+                value,
+                len(key_proof).to_bytes(1, byteorder="big"),
+                *key_proof,
+                *value_proof,
+            ]
+        )
+
+        # We can send at most MAX_RESPONSE_SIZE bytes in a single message; the rest is split into
+        # length-1 bytes elements and stored for GET_MORE_ELEMENTS
+        self.queue.extend(response[i: i + 1] for i in range(MAX_RESPONSE_SIZE, len(response)))
+
+        return response[:MAX_RESPONSE_SIZE]
+
+
+class GetPreimagesCommand(ClientCommand):
+    def __init__(self, known_preimages: Mapping[bytes, bytes], queue: "deque[bytes]"):
+        self.queue = queue
+        self.known_preimages = known_preimages
+
+    @property
+    def code(self) -> int:
+        return ClientCommandCode.GET_PREIMAGES
+
+    def execute(self, request: bytes) -> bytes:
+        req = ByteStreamParser(request[1:])
+
+        n_hashes = req.read_uint(1)
+        if n_hashes == 0:
+            raise ValueError("At least one preimage must be requested.")
+        hashes = [req.read_bytes(32) for _ in range(n_hashes)]
+        req.assert_empty()
+
+        if len(self.queue) != 0:
+            raise RuntimeError(
+                "This command should not execute when the queue is not empty."
+            )
+
+        for req_hash in hashes:
+            if req_hash not in self.known_preimages:
+                raise RuntimeError(f"Requested unknown preimage for: {req_hash.hex()}")
+
+        # the length and the bytes of each preimage, in the order of the hashes
+        response = b"".join(
+            write_varint(len(preimage)) + preimage
+            for preimage in (self.known_preimages[req_hash] for req_hash in hashes)
+        )
+
+        # We can send at most MAX_RESPONSE_SIZE bytes in a single message; the rest is split into
+        # length-1 bytes elements and stored for GET_MORE_ELEMENTS
+        self.queue.extend(response[i: i + 1] for i in range(MAX_RESPONSE_SIZE, len(response)))
+
+        return response[:MAX_RESPONSE_SIZE]
+
+
 class GetMoreElementsCommand(ClientCommand):
     def __init__(self, queue: "deque[bytes]"):
         self.queue = queue
@@ -185,12 +413,12 @@ class GetMoreElementsCommand(ClientCommand):
                 "The queue contains elements of different byte length, which is not expected."
             )
 
-        # pop from the queue, keeping the total response length at most 255
+        # pop from the queue, keeping the total response length at most MAX_RESPONSE_SIZE
 
         response_elements = bytearray()
 
         n_added_elements = 0
-        while len(self.queue) > 0 and len(response_elements) + element_len <= 253:
+        while len(self.queue) > 0 and len(response_elements) + element_len <= MAX_RESPONSE_SIZE - 2:
             response_elements.extend(self.queue.popleft())
             n_added_elements += 1
 
@@ -203,6 +431,25 @@ class GetMoreElementsCommand(ClientCommand):
         )
 
 
+class BatchCommand(ClientCommand):
+    def __init__(self, get_responses: Callable[[List[bytes], int], bytes]):
+        self.get_responses = get_responses
+
+    @property
+    def code(self) -> int:
+        return ClientCommandCode.BATCH
+
+    def execute(self, request: bytes) -> bytes:
+        req = ByteStreamParser(request[1:])
+
+        n_requests = req.read_uint(1)
+        requests = [req.read_bytes(req.read_uint(1)) for _ in range(n_requests)]
+        req.assert_empty()
+
+        # keep one byte for the length prefix, in case other responses are pushed with this one
+        return self.get_responses(requests, MAX_RESPONSE_SIZE - 1)
+
+
 class ClientCommandInterpreter:
     """Interpreter for the client-side commands.
 
@@ -212,9 +459,9 @@ class ClientCommandInterpreter:
 
     Moreover, it containes the state that is relevant for the interpreted client side commands:
     - a queue of bytes that contains any bytes that could not fit in a response from the
-      GET_PREIMAGE client command (when a preimage is too long to fit in a single message) or the
-      GET_MERKLE_LEAF_PROOF command (which returns a Merkle proof, which might be too long to fit
-      in a single message). The data in the queue is returned in one (or more) successive
+      GET_PREIMAGE and GET_PREIMAGES client commands (when the preimages are too long to fit in a single message)
+      or the GET_MERKLE_LEAF_PROOF, GET_MERKLE_LEAVES_PROOF and GET_MERKLEIZED_MAP_VALUE commands (which
+      return Merkle proofs, which might be too long to fit in a single message). The data in the queue is returned in one (or more) successive
       GET_MORE_ELEMENTS commands from the hardware wallet.
 
     Finally, it keeps track of the yielded values (that is, the values sent from the hardware
@@ -225,26 +472,68 @@ class ClientCommandInterpreter:
     yielded: list[bytes]
         A list of all the value sent by the Hardware Wallet with a YIELD client command during thw
         processing of an APDU.
+    metrics: Optional[ExchangeMetrics]
+        If not None, the time and the sizes of each executed client command, and of the prefetched responses, are
+        recorded there (see `bitcoin_client.tracing`).
     """
 
-    def __init__(self):
-        self.known_preimages: Mapping[bytes, bytes] = {}
-        self.known_trees: Mapping[bytes, MerkleTree] = {}
+    def __init__(self, known_preimages: Optional[MutableMapping[bytes, bytes]] = None,
+                 known_trees: Optional[MutableMapping[bytes, MerkleTree]] = None,
+                 metrics: Optional[ExchangeMetrics] = None,
+                 precompute_executor: Optional[Executor] = None):
+        """If `known_preimages` is given, the known preimages are stored there instead of in a new dict (for
+        example, in a `PreimageStore` that reads the long preimages back from a file); likewise for the Merkle trees
+        and `known_trees`.
+
+        If `precompute_executor` is given, the lookup tables of the known Merkle trees (see `MerkleTree.precompute`)
+        are computed there in the background, instead of when the trees are added. Until the table of a tree is
+        ready, its proofs are computed when they are asked, so the responses never wait for the background tasks."""
+
+        self.metrics = metrics
+        self.precompute_executor = precompute_executor
+        self._precomputations: List[Future] = []
+
+        # content-addressed store of the nodes of the known Merkle trees: each distinct hash is kept once
+        self.known_nodes: Dict[bytes, bytes] = {}
+
+        self.known_preimages: MutableMapping[bytes, bytes] = known_preimages if known_preimages is not None else {}
+        self.known_trees: MutableMapping[bytes, MerkleTree] = known_trees if known_trees is not None else {}
 
         self.yielded: List[bytes] = []
 
-        queue = deque()
+        self.queue = deque()
 
         commands = [
             YieldCommand(self.yielded),
-            GetPreimageCommand(self.known_preimages, queue),
+            GetPreimageCommand(self.known_preimages, self.queue),
             GetMerkleLeafIndexCommand(self.known_trees),
-            GetMerkleLeafProofCommand(self.known_trees, queue),
-            GetMoreElementsCommand(queue),
+            GetMerkleLeafProofCommand(self.known_trees, self.queue),
+            GetMerkleLeavesProofCommand(self.known_trees, self.queue),
+            GetMerkleizedMapValueCommand(self.known_preimages, self.known_trees, self.queue),
+            GetPreimagesCommand(self.known_preimages, self.queue),
+            GetMoreElementsCommand(self.queue),
+            BatchCommand(self.get_responses),
         ]
 
         self.commands = {cmd.code: cmd for cmd in commands}
 
+    def reset(self) -> None:
+        """Clears the state of an execution (the yielded values and the queue), keeping the known preimages and
+        Merkle trees, so that the interpreter can be used again for a new request with the same data."""
+
+        self.yielded.clear()
+        self.queue.clear()
+
+    def fork(self) -> "ClientCommandInterpreter":
+        """Returns a new interpreter that shares the known preimages and Merkle trees of this one, with its own state
+        of an execution.
+
+        The known data must not be modified anymore: it is then only read, so the interpreters can be used at the same
+        time (for example, by the commands of several devices signing the same PSBT) without preparing it again.
+        """
+
+        return ClientCommandInterpreter(self.known_preimages, self.known_trees)
+
     def execute(self, hw_response: bytes) -> bytes:
         """Interprets the client command requested by the hardware wallet, returning the appropriet
         response and updating the client interpreter's internal state if appropriate.
@@ -272,7 +561,85 @@ class ClientCommandInterpreter:
                 "Unexpected command code: 0x{:02X}".format(cmd_code)
             )
 
-        return self.commands[cmd_code].execute(hw_response)
+        if self.metrics is None:
+            return self.commands[cmd_code].execute(hw_response)
+
+        timer = Timer()
+        response = self.commands[cmd_code].execute(hw_response)
+        self.metrics.record_client_command(ClientCommandCode(cmd_code).name, timer.start_ns, timer.elapsed_ns(),
+                                           len(hw_response), len(response), len(self.queue))
+        return response
+
+    def get_prefetched_responses(self, hw_response: bytes, max_size: int) -> bytes:
+        """Returns the responses to the requests that the hardware wallet is likely to send after the one in
+        `hw_response` (which must have already been executed), to be pushed in advance with the response.
+
+        Each entry is serialized as the length of the request (1 byte), the request, the length of the response
+        (1 byte) and the response. Only responses that fit in a single message are pushed, and at most `max_size`
+        bytes are returned.
+
+        Parameters
+        ----------
+        hw_response : bytes
+            The data content of the SW_INTERRUPTED_EXECUTION sent by the hardware wallet.
+        max_size : int
+            The maximum length of the result.
+
+        Returns
+        -------
+        bytes
+            The concatenation of the serialized entries.
+        """
+
+        if self.metrics is None:
+            return self.get_responses(self.commands[hw_response[0]].predict_next_requests(hw_response), max_size)
+
+        timer = Timer()
+        result = self.get_responses(self.commands[hw_response[0]].predict_next_requests(hw_response), max_size)
+        self.metrics.record_client_command("PREFETCH", timer.start_ns, timer.elapsed_ns(), 0, len(result),
+                                           len(self.queue))
+        return result
+
+    def get_responses(self, requests: List[bytes], max_size: int) -> bytes:
+        """Executes the given requests in order, and returns their responses serialized as the entries of
+        `get_prefetched_responses`. It stops at the first request that fails, or whose response does not fit in a
+        single message or in the `max_size` bytes of the result.
+
+        Used for the prefetched responses, and for the BATCH command of the hardware wallet.
+        """
+
+        if len(self.queue) > 0:
+            # the next request will be GET_MORE_ELEMENTS
+            return b""
+
+        result = b""
+        for request in requests:
+            if len(request) == 0 or request[0] in (ClientCommandCode.YIELD, ClientCommandCode.GET_MORE_ELEMENTS,
+                                                   ClientCommandCode.BATCH):
+                # these requests change the state of the client, or can't be nested
+                break
+
+            try:
+                response = self.commands[request[0]].execute(request)
+            except (RuntimeError, KeyError, ValueError):
+                break
+
+            if len(self.queue) > 0:
+                # the response does not fit in a single message
+                self.queue.clear()
+                break
+
+            entry = b"".join([
+                len(request).to_bytes(1, byteorder="big"),
+                request,
+                len(response).to_bytes(1, byteorder="big"),
+                response
+            ])
+            if len(result) + len(entry) > max_size:
+                break
+            result += entry
+
+        return result
 
     def add_known_preimage(self, element: bytes) -> None:
         """Adds a preimage to the list of known preimages.
@@ -286,9 +653,14 @@ class ClientCommandInterpreter:
             An array of bytes whose preimage must be known to the client during an APDU execution.
         """
 
-        self.known_preimages[sha256(element)] = element
+        self._add_preimage(sha256(element), element)
+
+    def _add_preimage(self, element_hash: bytes, element: bytes) -> None:
+        # a preimage that is already known is not stored again (for example, in the spill file of a PreimageStore)
+        if element_hash not in self.known_preimages:
+            self.known_preimages[element_hash] = element
 
-    def add_known_list(self, elements: List[bytes]) -> None:
+    def add_known_list(self, elements: List[bytes]) -> MerkleTree:
         """Adds a known Merkleized list.
 
         Builds the Merkle tree of `elements`, and adds it to the Merkle trees known to the client
@@ -297,38 +669,116 @@ class ClientCommandInterpreter:
 
         If `el` is one of `elements`, the client must respond with b'\0' + `el` when a GET_PREIMAGE
         client command is sent with `sha256(b'\0' + el)`.
-        Moreover, the commands GET_MERKLE_LEAF_INDEX and GET_MERKLE_LEAF_PROOF must correctly answer
-        queries relative to the Merkle whose root is `mt_root`.
+        Moreover, the commands GET_MERKLE_LEAF_INDEX, GET_MERKLE_LEAF_PROOF and
+        GET_MERKLE_LEAVES_PROOF must correctly answer queries relative to the Merkle whose root is
+        `mt_root`.
 
         Parameters
         ----------
         elements : List[bytes]
             A list of `bytes` corresponding to the leafs of the Merkle tree.
+
+        Returns
+        -------
+        MerkleTree
+            The Merkle tree of the list; if a tree with the same root was already known, it is returned instead of a
+            new one.
         """
 
+        hashes = []
         for el in elements:
-            self.add_known_preimage(b"\x00" + el)
+            hashes.append(element_hash(el))
+            self._add_preimage(hashes[-1], b"\x00" + el)
+
+        return self.add_known_tree(MerkleTree(hashes))
 
-        mt = MerkleTree(element_hash(el) for el in elements)
+    def add_known_tree(self, mt: MerkleTree) -> MerkleTree:
+        """Adds a known Merkle tree, without any preimage of its leaves.
+
+        Used when the preimages are added separately, like in `add_known_list`. The tree is precomputed, if it
+        was not already and it has at least PRECOMPUTE_MIN_LEAVES leaves.
+
+        The known trees are content-addressed: if a tree with the same root is already known (like the trees of the
+        keys of the input maps, that are often the same), it is kept, and `mt` is discarded. The nodes of the trees
+        are interned in `known_nodes`, so that the hashes that are in several trees (like the leaves of repeated
+        values) are stored once.
+
+        Parameters
+        ----------
+        mt : MerkleTree
+            The Merkle tree, whose leaves are the hashes of the elements.
+
+        Returns
+        -------
+        MerkleTree
+            The known tree with the root of `mt`.
+        """
+
+        known = self.known_trees.get(mt.root)
+        if known is not None:
+            return known
+
+        mt.intern_nodes(self.known_nodes)
+
+        # the hardware wallet might ask for many proofs from the same tree
+        if not mt.is_precomputed and len(mt) >= PRECOMPUTE_MIN_LEAVES:
+            if self.precompute_executor is not None:
+                self._precomputations.append(self.precompute_executor.submit(mt.precompute))
+            else:
+                mt.precompute()
 
         self.known_trees[mt.root] = mt
+        return mt
+
+    def wait_precomputed(self) -> None:
+        """Waits for the lookup tables computed in the background with `precompute_executor`; it must be called before
+        modifying a known Merkle tree in place, as the tables of a tree must not be computed while it changes."""
+
+        for future in self._precomputations:
+            future.result()
+        self._precomputations.clear()
+
+    def replace_known_tree(self, old_root: bytes, mt: MerkleTree) -> None:
+        """Replaces the known Merkle tree with root `old_root` by `mt`, like a tree that was modified in place with
+        `MerkleTree.set`.
 
-    def add_known_mapping(self, mapping: Mapping[bytes, bytes]) -> None:
+        Unlike `add_known_tree`, the tree is not precomputed again, as that costs O(n log n): its proofs are computed
+        when they are asked, in O(log n).
+
+        Parameters
+        ----------
+        old_root : bytes
+            The Merkle root of the tree before it was modified.
+        mt : MerkleTree
+            The Merkle tree, whose leaves are the hashes of the elements.
+        """
+
+        self.known_trees.pop(old_root, None)
+        self.known_trees[mt.root] = mt
+
+    def add_known_mapping(self, mapping: Mapping[bytes, bytes]) -> bytes:
         """Adds the Merkle trees of keys, and the Merkle tree of values (ordered by key)
         of a mapping of bytes to bytes.
 
         Adds the Merkle tree of the list of keys, and the Merkle tree of the list of corresponding
-        values, with the same semantics as the `add_known_list` applied separately to the two lists. 
+        values, with the same semantics as the `add_known_list` applied separately to the two lists.
+        Therefore, the client can also respond to GET_MERKLEIZED_MAP_VALUE queries for the mapping.
 
         Parameters
         ----------
         mapping : Mapping[bytes, bytes]
             A mapping whose keys and values are `bytes`.
+
+        Returns
+        -------
+        bytes
+            The Merkleized map commitment of the mapping, as `get_merkleized_map_commitment`.
         """
 
         items_sorted = list(sorted(mapping.items()))
 
         keys = [i[0] for i in items_sorted]
         values = [i[1] for i in items_sorted]
-        self.add_known_list(keys)
-        self.add_known_list(values)
+        keys_tree = self.add_known_list(keys)
+        values_tree = self.add_known_list(values)
+        return write_varint(len(mapping)) + keys_tree.root + values_tree.root
@@ -1,18 +1,28 @@
-from typing import Tuple, List, Mapping, Generator, Optional
+from typing import Callable, Tuple, List, Mapping, Dict, Generator, Optional, TypeVar, Union
 import base64
-from io import BytesIO, BufferedReader
+from collections import OrderedDict
+from concurrent.futures import Executor
+from enum import IntEnum
+from hashlib import sha256
+from io import BytesIO
 
 from ledgercomm import Transport
 
-from bitcoin_client.command_builder import BitcoinCommandBuilder, BitcoinInsType
-from bitcoin_client.common import AddressType
-from bitcoin_client.exception import DeviceException
+from bitcoin_client import bip322
+from bitcoin_client.command_builder import BitcoinCommandBuilder, BitcoinInsType, FrameworkInsType, MAX_BATCH_DATA_LEN
+from bitcoin_client.common import AddressType, bip32_path_from_string, read_varint, write_varint
+from bitcoin_client.exception import DeviceException, InsNotSupportedError
+from bitcoin_client.key import ExtendedKey
 
-from bitcoin_client.client_command import ClientCommandInterpreter
+from bitcoin_client.client_command import ClientCommandCode, ClientCommandInterpreter, MAX_RESPONSE_SIZE
 
-from bitcoin_client.merkle import get_merkleized_map_commitment
-from bitcoin_client.wallet import Wallet, WalletType, PolicyMapWallet
+from bitcoin_client.merkle import MerkleTree, element_hash
+from bitcoin_client.wallet import Wallet, WalletType, PolicyMapWallet, PreparedWallet
 from bitcoin_client.psbt import PSBT, deser_string
+from bitcoin_client.preimage_store import PreimageStore
+from bitcoin_client.psbt_stream import PsbtSource, prepare_sign_psbt_stream
+from bitcoin_client.tracing import ExchangeMetrics, INIT_PHASE, Timer
+from bitcoin_client._serialize import BufferReader, Readable
 
 
 try:
@@ -25,7 +35,20 @@ except ImportError:
             self.sw = sw
             self.data = data
 
-def parse_stream_to_map(f: BufferedReader) -> Mapping[bytes, bytes]:
+class SignPsbtPhase(IntEnum):
+    """The phases of SIGN_PSBT in its progress events (flag 0x08 of the mode, see doc/bitcoin.md)."""
+    INPUTS = 1
+    OUTPUTS = 2
+    SIGN = 3
+
+
+# Length of a progress event (phase, items done, items total); signatures and amend records are longer
+SIGN_PSBT_PROGRESS_LEN = 1 + 4 + 4
+
+ProgressCallback = Callable[[SignPsbtPhase, int, int], None]
+
+
+def parse_stream_to_map(f: Readable) -> Mapping[bytes, bytes]:
     result = {}
     while True:
         try:
@@ -43,6 +66,56 @@ def parse_stream_to_map(f: BufferedReader) -> Mapping[bytes, bytes]:
     return result
 
 
+def add_known_wallet(client_intepreter: ClientCommandInterpreter, wallet: PolicyMapWallet) -> None:
+    """Adds the serialized wallet policy and the Merkle tree of its keys information to the client interpreter."""
+
+    if isinstance(wallet, PreparedWallet):
+        # the preimages and the tree were computed once
+        client_intepreter.known_preimages.update(wallet.preimages)
+        client_intepreter.add_known_tree(wallet.keys_tree)
+    else:
+        client_intepreter.add_known_list(wallet.keys_info_leaves())
+        client_intepreter.add_known_preimage(wallet.serialize())
+
+
+def derivation_locality_order(psbt: PSBT, input_range: Optional[Tuple[int, int]] = None) -> List[int]:
+    """Returns the indexes of the inputs in `input_range` (by default, all of them), sorted so that the inputs with
+    the same BIP-32 derivation up to the change step, and then with the same address index, are consecutive; the
+    inputs without a derivation come last. Used as the signing order of `BitcoinCommand.sign_psbt_in_order`."""
+
+    start, end = input_range if input_range is not None else (0, len(psbt.inputs))
+
+    def locality_key(index: int):
+        psbt_in = psbt.inputs[index]
+        origins = list(psbt_in.hd_keypaths.values()) + [origin for _, origin in psbt_in.tap_hd_keypaths.values()]
+        if len(origins) == 0:
+            return (1, b"", [], 0)
+        origin = min(origins, key=lambda o: (o.fingerprint, list(o.path)))
+        path = list(origin.path)
+        return (0, origin.fingerprint, path[:-1], path[-1] if len(path) > 0 else 0)
+
+    # sorted is stable: the inputs that spend the same address keep their order
+    return sorted(range(start, end), key=locality_key)
+
+
+def external_outputs_hash(psbt: PSBT, change_outputs: List[int]) -> bytes:
+    """Returns the hash of the external outputs of psbt that the user validates with
+    `BitcoinCommand.sign_psbt_summary`: the sha256 of the serializations (amount and scriptPubKey) of the outputs whose
+    index is not in `change_outputs` (as returned by `BitcoinCommand.check_psbt`), in order."""
+
+    change = set(change_outputs)
+    h = sha256()
+    for i in range(len(psbt.outputs)):
+        if i in change:
+            continue
+        if psbt.version == 2:
+            amount, script = psbt.outputs[i].amount, psbt.outputs[i].script
+        else:
+            amount, script = psbt.tx.vout[i].nValue, psbt.tx.vout[i].scriptPubKey
+        h.update(amount.to_bytes(8, byteorder="little") + write_varint(len(script)) + script)
+    return h.digest()
+
+
 class HIDClient:
     def __init__(self):
         self.transport = Transport("hid")  # TODO: other params
@@ -66,37 +139,275 @@ class HIDClient:
         self.transport.close()
 
 
+T = TypeVar("T")
+
+# length of the chunks of the message of SIGN_MESSAGE; the last one can be shorter
+MESSAGE_CHUNK_SIZE = 64
+
+# Status words meaning that the Bitcoin app is not the one answering (anymore): it was closed, another app was opened,
+# or the device is locked. The responses cached by BitcoinCommand are cleared when one of them is received.
+APP_SWITCH_STATUS_WORDS = {
+    0x6D00,  # SW_INS_NOT_SUPPORTED
+    0x6E00,  # SW_CLA_NOT_SUPPORTED
+    0x6E01,  # returned by the dashboard
+    0x6D02,  # returned by the dashboard
+    0x6511,  # app not open
+    0x5515,  # device locked
+}
+
+# The commands are implemented as flows: generators that yield the requests to send to the device, as pairs of an apdu
+# and of the client command interpreter that answers the interruptions (None if none are expected), receive the final
+# status word and response of each request, and return the result of the command. As flows do no I/O, the same flows
+# are run synchronously by BitcoinCommand, and asynchronously by AsyncBitcoinCommand.
+Flow = Generator[Tuple[dict, Optional[ClientCommandInterpreter]], Tuple[int, bytes], T]
+
+
+class PreparedPsbt:
+    """A PSBT prepared for SIGN_PSBT with a wallet policy: the Merkleized map commitments of its maps, and a client
+    command interpreter that knows all its Merkle trees and preimages.
+
+    Returned by `BitcoinCommand.prepare_psbt`, and signed with `BitcoinCommand.sign_prepared_psbt`. The prepared data
+    is only read while signing, and each signing has its own execution state: the same `PreparedPsbt` can be signed
+    by several devices, even at the same time, like the cosigners of a multisig wallet (see `bitcoin_client.quorum`).
+    Therefore, the PSBT is only prepared once, however many devices sign it.
+
+    It also keeps the maps of the PSBT and the Merkle trees of the lists of the commitments of its input and output
+    maps, so that it can be updated for a new version of the PSBT with `BitcoinCommand.update_prepared_psbt`.
+    """
+
+    def __init__(self, wallet: Wallet, global_commitment: bytes, input_commitments: List[bytes],
+                 output_commitments: List[bytes], client_intepreter: ClientCommandInterpreter,
+                 global_map: Mapping[bytes, bytes], input_maps: List[Mapping[bytes, bytes]],
+                 output_maps: List[Mapping[bytes, bytes]], input_tree: MerkleTree, output_tree: MerkleTree) -> None:
+        self.wallet = wallet
+        self.global_commitment = global_commitment
+        self.input_commitments = input_commitments
+        self.output_commitments = output_commitments
+        self.client_intepreter = client_intepreter
+        self.global_map = global_map
+        self.input_maps = input_maps
+        self.output_maps = output_maps
+        self.input_tree = input_tree
+        self.output_tree = output_tree
+
+
+def _update_prepared_maps(client_intepreter: ClientCommandInterpreter, tree: MerkleTree,
+                          old_maps: List[Mapping[bytes, bytes]], new_maps: List[Mapping[bytes, bytes]],
+                          commitments: List[bytes]) -> MerkleTree:
+    """Updates in place the maps and the commitments of a list of maps of a prepared PSBT (and the interpreter) for
+    new_maps, only merkleizing the maps that differ from old_maps. Returns the Merkle tree of the commitments: tree,
+    whose changed leaves are updated in O(log n) each, or a new tree if there are fewer maps."""
+
+    changed = [i for i, m in enumerate(new_maps) if i >= len(old_maps) or m != old_maps[i]]
+    for i in changed:
+        commitment = client_intepreter.add_known_mapping(new_maps[i])
+        client_intepreter.add_known_preimage(b"\x00" + commitment)
+        if i < len(commitments):
+            commitments[i] = commitment
+        else:
+            commitments.append(commitment)
+    del commitments[len(new_maps):]
+
+    old_root = tree.root
+    if len(new_maps) < len(old_maps):
+        # MerkleTree can not remove leaves
+        new_tree = MerkleTree(element_hash(c) for c in commitments)
+    else:
+        for i in changed:  # in increasing order, so that the new leaves are appended
+            tree.set(i, element_hash(commitments[i]))
+        new_tree = tree
+    client_intepreter.replace_known_tree(old_root, new_tree)
+
+    old_maps[:] = new_maps
+    return new_tree
+
+
 class BitcoinCommand:
     # internal use for testing: if set to True, sign_psbt will not clone the psbt before converting to psbt version 2
     _no_clone_psbt: bool = False
 
-    def __init__(self, client: HIDClient, debug: bool = False) -> None:
+    def __init__(self, client: HIDClient, debug: bool = False, prefetch: bool = False,
+                 psbt_cache_size: int = 0, latency_ms: int = 0, preimage_spill_size: Optional[int] = None,
+                 coalesce_yields: bool = False, response_cache: bool = False,
+                 progress_callback: Optional[ProgressCallback] = None,
+                 metrics: Optional[ExchangeMetrics] = None,
+                 precompute_executor: Optional[Executor] = None) -> None:
+        """
+        If `prefetch` is True, the responses to the client commands that the hardware wallet is likely to send next
+        are pushed in advance when possible, saving some round trips. Only supported by app versions that implement
+        CONTINUE with P1 = 1.
+
+        If `psbt_cache_size` is positive, `sign_psbt` keeps the Merkleized map commitments and the client command
+        interpreter prepared for the last `psbt_cache_size` distinct PSBTs (together with the wallet and its hmac),
+        so that signing the same PSBT again (for example, after the user rejected it, or after a timeout) does not
+        recompute them. Entries are replaced in least recently used order. A PSBT that is not cached, but for the same
+        wallet and hmac as a cached one (for example, a fee bump of it), replaces the most recent such entry, that is
+        updated with `update_prepared_psbt`: only the maps that changed are prepared again.
+
+        `latency_ms` is the expected time to respond to a client command (for example, if the responses come from
+        a remote service); it is declared in each command (rounded up to units of 100 ms, at most 25.5 s), so that
+        the hardware wallet waits longer before resetting for a client that does not respond. Older app versions
+        ignore it.
+
+        If `preimage_spill_size` is not None, the preimages of the PSBTs longer than `preimage_spill_size` bytes (like
+        the non-witness UTXOs) are kept in a memory-mapped temporary file instead of in memory, and only paged in when
+        the hardware wallet asks for them; see `PreimageStore`.
+
+        If `coalesce_yields` is True, `sign_psbt` asks the hardware wallet to return several signatures with each
+        YIELD client command, and the last ones with the final response, saving a round trip for most inputs. Only
+        supported by app versions that accept the flag 0x80 in the mode of SIGN_PSBT; older ones fail with
+        IncorrectDataError.
+
+        If `response_cache` is True, the results of the commands that always give the same result and show nothing on
+        screen (`get_master_fingerprint`, and `get_extended_pubkey` without display, `get_extended_pubkeys`,
+        `get_child_extended_pubkeys` and `get_account_xpubs`) are kept, and returned again without exchanging with
+        the device. The cache is cleared if the transport fails, or if a status word in APP_SWITCH_STATUS_WORDS is
+        received; it must be cleared with `clear_response_cache` when reconnecting the client to a device. It can be
+        filled in advance with `warm_response_cache`. With a client that checks the identity of the device when it
+        reconnects (`PersistentHIDClient`), the cache is only cleared when the identity changes, instead of when the
+        transport fails.
+
+        If `progress_callback` is not None, the SIGN_PSBT commands ask the hardware wallet to report their progress,
+        and the callback is called with the phase, the number of items done and the total number of items of the
+        phase, as soon as each event is received: at the start and at the end of each phase, and about every 8 items.
+        Each event costs a round trip. Only supported by app versions that accept the flag 0x08 in the mode of
+        SIGN_PSBT; older ones fail with IncorrectDataError.
+
+        If `metrics` is not None, the latency and the size of each APDU and of each client command are recorded there,
+        by phase of SIGN_PSBT if `progress_callback` is given; see `bitcoin_client.tracing`.
+
+        If `precompute_executor` is not None (for example, a `ThreadPoolExecutor` with a single thread), the lookup
+        tables of the Merkle trees of the PSBTs (see `MerkleTree.precompute`) are computed there, while the first
+        client commands of SIGN_PSBT are exchanged; the commitments are still computed before the command is sent.
+        The proofs that are asked before their table is ready are computed on demand, in O(log n). Since the tables
+        are computed in Python, this only helps when the transport waits without holding the GIL (like a USB or TCP
+        transport), and more than one thread rarely helps.
+        """
         self.client = client
-        self.builder = BitcoinCommandBuilder(debug=debug)
+        self.builder = BitcoinCommandBuilder(debug=debug, latency=min(255, -(-latency_ms // 100)))
+        self.prefetch = prefetch
         self.debug = debug
+        self.psbt_cache_size = psbt_cache_size
+        self.preimage_spill_size = preimage_spill_size
+        self.coalesce_yields = coalesce_yields
+        self.progress_callback = progress_callback
+        self.metrics = metrics
+        self.precompute_executor = precompute_executor
+        self._psbt_cache: "OrderedDict[bytes, Tuple[dict, PreparedPsbt, Optional[bytes]]]" = OrderedDict()
+        self.response_cache = response_cache
+        self._cached_fingerprint: Optional[bytes] = None
+        self._cached_coin_type: Optional[int] = None  # as seen in the response to GET_ACCOUNT_XPUBS
+        self._cached_xpubs: Dict[bytes, str] = {}  # by serialized path
+        # for a client that checks the identity of the device when it reconnects, like PersistentHIDClient
+        self._client_generation: Optional[int] = getattr(client, "identity_generation", None)
+
+    def clear_response_cache(self) -> None:
+        """Forgets the responses cached with `response_cache`; it must be called when the device is reconnected."""
+        self._cached_fingerprint = None
+        self._cached_coin_type = None
+        self._cached_xpubs.clear()
+
+    def _check_status_word(self, sw: int) -> None:
+        if sw in APP_SWITCH_STATUS_WORDS:
+            self.clear_response_cache()
+
+    def _cache_xpubs(self, steps: List[List[bytes]], xpubs: List[str]) -> None:
+        if self.response_cache:
+            for path_steps, xpub in zip(steps, xpubs):
+                self._cached_xpubs[b"".join(path_steps)] = xpub
+
+    def _get_cached_xpubs(self, steps: List[List[bytes]]) -> Optional[List[str]]:
+        """Returns the cached xpubs at the given paths, or None if any of them is not cached."""
+        if not self.response_cache:
+            return None
+        xpubs = [self._cached_xpubs.get(b"".join(path_steps)) for path_steps in steps]
+        return None if None in xpubs else xpubs
+
+    def _check_client_identity(self) -> None:
+        generation = getattr(self.client, "identity_generation", None)
+        if generation != self._client_generation:
+            self.clear_response_cache()
+            self._client_generation = generation
 
     def _apdu_exchange(self, apdu: dict) -> Tuple[int, bytes]:
+        timer = Timer() if self.metrics is not None else None
         try:
-            return 0x9000, self.client.apdu_exchange(**apdu)
+            sw, response = 0x9000, self.client.apdu_exchange(**apdu)
         except ApduException as e:
-            return e.sw, e.data
+            self._check_status_word(e.sw)
+            sw, response = e.sw, e.data
+        except Exception:
+            # the device might have been disconnected; if the client checks the identity of the device, the caches
+            # are only cleared if another device answers after reconnecting
+            if self._client_generation is None:
+                self.clear_response_cache()
+            raise
+        finally:
+            self._check_client_identity()
+
+        if timer is not None:
+            self._record_apdu_exchange(timer, apdu, sw, response)
+        return sw, response
+
+    def _record_apdu_exchange(self, timer: Timer, apdu: dict, sw: int, response: bytes) -> None:
+        # the sent bytes include the 5-byte header, and the received bytes include the 2-byte status word
+        self.metrics.record_apdu_exchange(apdu["ins"], sw, timer.start_ns, timer.elapsed_ns(),
+                                          5 + len(apdu.get("data", b"")), len(response) + 2)
+
+    def continue_apdu(self, response: bytes, client_intepreter: Optional[ClientCommandInterpreter]) -> dict:
+        """Executes the client command in the response of a SW_INTERRUPTED_EXECUTION, and returns the CONTINUE apdu
+        with its result."""
+
+        if not client_intepreter:
+            raise RuntimeError("Unexpected SW_INTERRUPTED_EXECUTION received.")
+
+        if self.metrics is not None:
+            client_intepreter.metrics = self.metrics
+
+        command_response = client_intepreter.execute(response)
+
+        if (self.progress_callback is not None and len(response) == 1 + SIGN_PSBT_PROGRESS_LEN
+                and response[0] == ClientCommandCode.YIELD):
+            # a progress event is not a result of the command
+            client_intepreter.yielded.pop()
+            if self.metrics is not None:
+                self.metrics.set_phase(SignPsbtPhase(response[1]).name)
+            self.progress_callback(SignPsbtPhase(response[1]), int.from_bytes(response[2:6], "little"),
+                                   int.from_bytes(response[6:10], "little"))
+
+        prefetched = None
+        if self.prefetch:
+            # the length of the response takes 1 byte of the payload
+            prefetched = client_intepreter.get_prefetched_responses(
+                response, MAX_RESPONSE_SIZE - 1 - len(command_response))
+
+        return self.builder.continue_interrupted(command_response, prefetched)
 
     def make_request(
         self, apdu: dict, client_intepreter: ClientCommandInterpreter = None
     ) -> Tuple[int, bytes]:
+        if self.metrics is not None:
+            self.metrics.set_phase(INIT_PHASE)
+
         sw, response = self._apdu_exchange(apdu)
 
         while sw == 0xE000:
-            if not client_intepreter:
-                raise RuntimeError("Unexpected SW_INTERRUPTED_EXECUTION received.")
-
-            command_response = client_intepreter.execute(response)
-            sw, response = self._apdu_exchange(
-                self.builder.continue_interrupted(command_response)
-            )
+            sw, response = self._apdu_exchange(self.continue_apdu(response, client_intepreter))
 
         return sw, response
 
+    def _run_flow(self, flow: "Flow[T]") -> T:
+        """Runs a flow to completion, sending each of its requests with make_request."""
+
+        # the client might have reconnected to another device in a command of another BitcoinCommand using it
+        self._check_client_identity()
+        try:
+            request = next(flow)
+            while True:
+                request = flow.send(self.make_request(*request))
+        except StopIteration as e:
+            return e.value
+
     def get_extended_pubkey(self, bip32_path: str, display: bool = False) -> str:
         """Gets the serialized extended public key for certain BIP32 path. Optionally, validate with the user.
 
@@ -113,20 +424,200 @@ class BitcoinCommand:
             The requested serialized extended public key.
         """
 
-        sw, response = self.make_request(self.builder.get_extended_pubkey(bip32_path, display))
+        return self._run_flow(self._get_extended_pubkey_flow(bip32_path, display))
+
+    def _get_extended_pubkey_flow(self, bip32_path: str, display: bool = False) -> Flow[str]:
+        steps = [bip32_path_from_string(bip32_path)]
+        if not display:
+            cached = self._get_cached_xpubs(steps)
+            if cached is not None:
+                return cached[0]
+
+        sw, response = yield self.builder.get_extended_pubkey(bip32_path, display), None
 
         if sw != 0x9000:
             raise DeviceException(error_code=sw, ins=BitcoinInsType.GET_EXTENDED_PUBKEY)
 
+        self._cache_xpubs(steps, [response.decode()])
         return response.decode()
 
-    def register_wallet(self, wallet: Wallet) -> Tuple[bytes, bytes]:
+    def get_extended_pubkeys(self, bip32_paths: List[str]) -> List[str]:
+        """Gets the serialized extended public keys at several standard paths in one command, without showing them
+        on screen.
+
+        Parameters
+        ----------
+        bip32_paths : List[str]
+            The BIP32 paths, in the same format as for `get_extended_pubkey`. They must all be standard.
+
+        Returns
+        -------
+        List[str]
+            The extended public keys, in the same order as the paths.
+        """
+
+        return self._run_flow(self._get_extended_pubkeys_flow(bip32_paths))
+
+    def _get_extended_pubkeys_flow(self, bip32_paths: List[str]) -> Flow[List[str]]:
+        if not 0 < len(bip32_paths) < 256:
+            raise ValueError("Invalid number of paths")
+
+        steps = [bip32_path_from_string(path) for path in bip32_paths]
+        cached = self._get_cached_xpubs(steps)
+        if cached is not None:
+            return cached
+
+        xpubs = yield from self._get_extended_pubkeys_raw_flow(
+            self.builder.get_extended_pubkeys(bip32_paths), len(bip32_paths))
+        self._cache_xpubs(steps, xpubs)
+        return xpubs
+
+    def get_child_extended_pubkeys(self, base_path: str, first_child: int, count: int) -> List[str]:
+        """Gets the serialized extended public keys of `count` consecutive children of a path in one command, without
+        showing them on screen.
+
+        Parameters
+        ----------
+        base_path : str
+            The BIP32 path of the parent, in the same format as for `get_extended_pubkey`.
+        first_child : int
+            The index of the first child; for hardened children, it includes 0x80000000.
+        count : int
+            The number of children, from 1 to 255.
+
+        Returns
+        -------
+        List[str]
+            The extended public keys at base_path/first_child, base_path/(first_child + 1), and so on.
+        """
+
+        return self._run_flow(self._get_child_extended_pubkeys_flow(base_path, first_child, count))
+
+    def _get_child_extended_pubkeys_flow(self, base_path: str, first_child: int, count: int) -> Flow[List[str]]:
+        if not 0 < count < 256 or first_child < 0 or first_child + count > 0x100000000:
+            raise ValueError("Invalid range of children")
+
+        base_steps = bip32_path_from_string(base_path)
+        steps = [base_steps + [i.to_bytes(4, byteorder="big")] for i in range(first_child, first_child + count)]
+        cached = self._get_cached_xpubs(steps)
+        if cached is not None:
+            return cached
+
+        xpubs = yield from self._get_extended_pubkeys_raw_flow(
+            self.builder.get_child_extended_pubkeys(base_path, first_child, count), count)
+        self._cache_xpubs(steps, xpubs)
+        return xpubs
+
+    def _get_extended_pubkeys_raw_flow(self, apdu: dict, count: int) -> Flow[List[str]]:
+        client_intepreter = ClientCommandInterpreter()
+
+        sw, _ = yield apdu, client_intepreter
+
+        if sw != 0x9000:
+            raise DeviceException(error_code=sw, ins=BitcoinInsType.GET_EXTENDED_PUBKEYS)
+
+        results = client_intepreter.yielded
+
+        if len(results) != count:
+            raise RuntimeError("Invalid response")
+
+        return [x.decode() for x in results]
+
+    def get_account_xpubs(self) -> List[str]:
+        """Gets the serialized extended public keys of the standard accounts, without showing them on screen.
+
+        Returns
+        -------
+        List[str]
+            The extended public keys at m/84'/c'/0', m/49'/c'/0', m/86'/c'/0' and m/48'/c'/0'/2', in this order, where c
+            is the coin type of the app.
+        """
+
+        return self._run_flow(self._get_account_xpubs_flow())
+
+    @staticmethod
+    def _account_xpubs_steps(coin_type: int) -> List[List[bytes]]:
+        c = f"{coin_type}'"
+        return [bip32_path_from_string(path) for path in [f"m/84'/{c}/0'", f"m/49'/{c}/0'", f"m/86'/{c}/0'",
+                                                             f"m/48'/{c}/0'/2'"]]
+
+    def _get_account_xpubs_flow(self) -> Flow[List[str]]:
+        # the paths depend on the coin type of the app, that is only known once it answered
+        if self._cached_coin_type is not None:
+            cached = self._get_cached_xpubs(self._account_xpubs_steps(self._cached_coin_type))
+            if cached is not None:
+                return cached
+
+        client_intepreter = ClientCommandInterpreter()
+
+        sw, _ = yield self.builder.get_account_xpubs(), client_intepreter
+
+        if sw != 0x9000:
+            raise DeviceException(error_code=sw, ins=BitcoinInsType.GET_ACCOUNT_XPUBS)
+
+        results = client_intepreter.yielded
+
+        if len(results) != 4:
+            raise RuntimeError("Invalid response")
+
+        xpubs = [x.decode() for x in results]
+        if self.response_cache:
+            coin_type = 1 if ExtendedKey.deserialize(xpubs[0]).is_testnet else 0
+            self._cached_coin_type = coin_type
+            self._cache_xpubs(self._account_xpubs_steps(coin_type), xpubs)
+        return xpubs
+
+    def sign_message(self, message: Union[str, bytes], bip32_path: str) -> str:
+        """Signs a message with the key at `bip32_path`, after showing its hash (and its beginning, if printable)
+        to the user.
+
+        Parameters
+        ----------
+        message : Union[str, bytes]
+            The message to sign; a str is encoded in UTF-8.
+        bip32_path : str
+            The BIP32 path of the key, in the same format as for `get_extended_pubkey`.
+
+        Returns
+        -------
+        str
+            The signature in the format of BIP-137 for a compressed pubkey, encoded in base64 (like the
+            `signmessage` command of Bitcoin Core for legacy addresses).
+        """
+
+        return self._run_flow(self._sign_message_flow(message, bip32_path))
+
+    def _sign_message_flow(self, message: Union[str, bytes], bip32_path: str) -> Flow[str]:
+        message_bytes = message.encode("utf-8") if isinstance(message, str) else message
+        if len(message_bytes) == 0:
+            raise ValueError("The message must not be empty")
+
+        chunks = [message_bytes[i:i + MESSAGE_CHUNK_SIZE] for i in range(0, len(message_bytes), MESSAGE_CHUNK_SIZE)]
+
+        client_intepreter = ClientCommandInterpreter()
+        client_intepreter.add_known_list(chunks)
+
+        chunks_root = MerkleTree(element_hash(c) for c in chunks).root
+        sw, response = yield self.builder.sign_message(len(message_bytes), chunks_root, bip32_path), client_intepreter
+
+        if sw != 0x9000:
+            raise DeviceException(error_code=sw, ins=BitcoinInsType.SIGN_MESSAGE)
+
+        if len(response) != 65:
+            raise RuntimeError(f"Invalid response length: {len(response)}")
+
+        return base64.b64encode(response).decode()
+
+    def register_wallet(self, wallet: Wallet, store: bool = False) -> Tuple[bytes, bytes]:
         """Registers a wallet policy with the user. After approval returns the wallet id and hmac to be stored on the client.
 
         Parameters
         ----------
         wallet : Wallet
             The Wallet policy to register on the device.
+        store : bool
+            If True, asks the device to also keep the wallet policy in its store (in builds with `WALLET_STORE=1`),
+            so that the later commands with the same wallet id and hmac do not request the policy again.
 
         Returns
         -------
@@ -135,16 +626,16 @@ class BitcoinCommand:
             The second element is the hmac.
         """
 
-        if wallet.type != WalletType.POLICYMAP:
-            raise ValueError("wallet type must be POLICYMAP")
+        return self._run_flow(self._register_wallet_flow(wallet, store))
+
+    def _register_wallet_flow(self, wallet: Wallet, store: bool = False) -> Flow[Tuple[bytes, bytes]]:
+        if wallet.type not in (WalletType.POLICYMAP, WalletType.POLICYMAP_BINARY_KEYS):
+            raise ValueError("wallet type must be POLICYMAP or POLICYMAP_BINARY_KEYS")
 
         client_intepreter = ClientCommandInterpreter()
-        client_intepreter.add_known_preimage(wallet.serialize())
-        client_intepreter.add_known_list([k.encode() for k in wallet.keys_info])
+        add_known_wallet(client_intepreter, wallet)
 
-        sw, response = self.make_request(
-            self.builder.register_wallet(wallet), client_intepreter
-        )
+        sw, response = yield self.builder.register_wallet(wallet, store=store), client_intepreter
 
         if sw != 0x9000:
             raise DeviceException(error_code=sw, ins=BitcoinInsType.REGISTER_WALLET)
@@ -157,6 +648,147 @@ class BitcoinCommand:
 
         return wallet_id, wallet_hmac
 
+    def register_wallets(self, wallets: List[Wallet], store: bool = False) -> List[Tuple[bytes, bytes]]:
+        """Registers several wallet policies in a single command, for example to provision all the wallets of a
+        device at once. Each wallet is shown to the user as in `register_wallet`, one after the other.
+
+        Parameters
+        ----------
+        wallets : List[Wallet]
+            The Wallet policies to register on the device.
+        store : bool
+            As in `register_wallet`, for all the wallets.
+
+        Returns
+        -------
+        List[Tuple[bytes, bytes]]
+            The wallet id and the hmac of each wallet, in the same order as `wallets`.
+        """
+
+        return self._run_flow(self._register_wallets_flow(wallets, store))
+
+    def _register_wallets_flow(self, wallets: List[Wallet], store: bool = False) -> Flow[List[Tuple[bytes, bytes]]]:
+        if len(wallets) == 0:
+            raise ValueError("At least one wallet is required")
+        for wallet in wallets:
+            if wallet.type not in (WalletType.POLICYMAP, WalletType.POLICYMAP_BINARY_KEYS):
+                raise ValueError("wallet type must be POLICYMAP or POLICYMAP_BINARY_KEYS")
+
+        client_intepreter = ClientCommandInterpreter()
+        for wallet in wallets:
+            add_known_wallet(client_intepreter, wallet)
+        client_intepreter.add_known_list([wallet.serialize() for wallet in wallets])
+
+        sw, _ = yield self.builder.register_wallets(wallets, store=store), client_intepreter
+
+        if sw != 0x9000:
+            raise DeviceException(error_code=sw, ins=BitcoinInsType.REGISTER_WALLETS)
+
+        results = client_intepreter.yielded
+
+        if len(results) != len(wallets) or any(len(result) != 64 for result in results):
+            raise RuntimeError("Invalid response")
+
+        return [(result[0:32], result[32:64]) for result in results]
+
+    def register_wallet_compiled(self, wallet: Wallet) -> Tuple[bytes, bytes, bytes, bytes]:
+        """Like `register_wallet`, but also returns the compiled form of the wallet policy, and its hmac.
+
+        The compiled form can be given to `get_wallet_address` and `get_wallet_addresses` instead of the wallet
+        policy, so that the device does not parse and compile the policy at each command.
+
+        Returns
+        -------
+        Tuple[bytes, bytes, bytes, bytes]
+            The wallet id, the hmac, the compiled form of the wallet policy and the hmac of the compiled form.
+        """
+
+        return self._run_flow(self._register_wallet_compiled_flow(wallet))
+
+    def _register_wallet_compiled_flow(self, wallet: Wallet) -> Flow[Tuple[bytes, bytes, bytes, bytes]]:
+        if wallet.type not in (WalletType.POLICYMAP, WalletType.POLICYMAP_BINARY_KEYS):
+            raise ValueError("wallet type must be POLICYMAP or POLICYMAP_BINARY_KEYS")
+
+        client_intepreter = ClientCommandInterpreter()
+        add_known_wallet(client_intepreter, wallet)
+
+        sw, response = yield self.builder.register_wallet(wallet, compiled=True), client_intepreter
+
+        if sw != 0x9000:
+            raise DeviceException(error_code=sw, ins=BitcoinInsType.REGISTER_WALLET)
+
+        if len(response) != 96 or len(client_intepreter.yielded) != 1:
+            raise RuntimeError(f"Invalid response length: {len(response)}")
+
+        wallet_id = response[0:32]
+        wallet_hmac = response[32:64]
+        compiled_policy = client_intepreter.yielded[0]
+        compiled_policy_hmac = response[64:96]
+
+        return wallet_id, wallet_hmac, compiled_policy, compiled_policy_hmac
+
+    def register_spending_policy(
+        self, wallet: Wallet, wallet_hmac: Optional[bytes], max_tx_amount: int, max_session_amount: int,
+        destinations: List[bytes]
+    ) -> Tuple[bytes, bytes]:
+        """Registers a spending policy for a wallet policy with the user, to sign the PSBTs that match it with
+        `sign_psbt_unattended`, without user interaction. Only supported by the builds of the app with
+        `UNATTENDED_SIGNING=1`.
+
+        The user approves the limits of the spending policy, then each of its destinations.
+
+        Parameters
+        ----------
+        wallet, wallet_hmac :
+            The wallet policy, as for `sign_psbt`; wallet_hmac is None for a default wallet policy.
+        max_tx_amount : int
+            The maximum amount, in satoshis, that a transaction can spend (its external outputs and its fee).
+        max_session_amount : int
+            The maximum total amount, in satoshis, that the transactions signed with the spending policy can spend until
+            the device is locked or the app exits; at least max_tx_amount.
+        destinations : List[bytes]
+            The scriptPubKeys that the external outputs can pay to.
+
+        Returns
+        -------
+        Tuple[bytes, bytes]
+            The serialized spending policy and its hmac, to be given to `sign_psbt_unattended`.
+        """
+
+        return self._run_flow(self._register_spending_policy_flow(
+            wallet, wallet_hmac, max_tx_amount, max_session_amount, destinations))
+
+    def _register_spending_policy_flow(
+        self, wallet: Wallet, wallet_hmac: Optional[bytes], max_tx_amount: int, max_session_amount: int,
+        destinations: List[bytes]
+    ) -> Flow[Tuple[bytes, bytes]]:
+        client_intepreter = ClientCommandInterpreter()
+        add_known_wallet(client_intepreter, wallet)
+        destinations_root = client_intepreter.add_known_list(destinations).root
+
+        sw, response = yield self.builder.register_spending_policy(
+            wallet, wallet_hmac, max_tx_amount, max_session_amount, destinations), client_intepreter
+
+        if sw != 0x9000:
+            raise DeviceException(error_code=sw, ins=BitcoinInsType.REGISTER_SPENDING_POLICY)
+
+        if len(response) != 64:
+            raise RuntimeError(f"Invalid response length: {len(response)}")
+
+        # version 1 | wallet_id | max_tx_amount | max_session_amount | n_destinations | destinations_root
+        policy = b"".join([
+            b"\x01",
+            wallet.id,
+            max_tx_amount.to_bytes(8, byteorder="little"),
+            max_session_amount.to_bytes(8, byteorder="little"),
+            len(destinations).to_bytes(4, byteorder="little"),
+            destinations_root,
+        ])
+        if response[0:32] != sha256(policy).digest():
+            raise RuntimeError("Invalid spending policy id")
+
+        return policy, response[32:64]
+
     def get_wallet_address(
         self,
         wallet: Wallet,
@@ -164,6 +796,7 @@ class BitcoinCommand:
         change: int,
         address_index: int,
         display: bool,
+        compiled_policy: Optional[Tuple[bytes, bytes]] = None,
     ) -> str:
         """For a given wallet that was already registered on the device (or a standard wallet that does not need registration),
         returns the address for a certain `change`/`address_index` combination.
@@ -185,27 +818,44 @@ class BitcoinCommand:
         display: bool
             Whether you want to display address and ask confirmation on the device.
 
+        compiled_policy: Optional[Tuple[bytes, bytes]]
+            For a registered wallet, the compiled form of the wallet policy and its hmac, as returned by
+            `register_wallet_compiled`; the device then uses it instead of parsing the wallet policy.
+
         Returns
         -------
         str
             The requested address.
         """
 
-        if wallet.type != WalletType.POLICYMAP or not isinstance(
+        return self._run_flow(
+            self._get_wallet_address_flow(wallet, wallet_hmac, change, address_index, display, compiled_policy))
+
+    def _get_wallet_address_flow(
+        self,
+        wallet: Wallet,
+        wallet_hmac: Optional[bytes],
+        change: int,
+        address_index: int,
+        display: bool,
+        compiled_policy: Optional[Tuple[bytes, bytes]] = None,
+    ) -> Flow[str]:
+        if wallet.type not in (WalletType.POLICYMAP, WalletType.POLICYMAP_BINARY_KEYS) or not isinstance(
             wallet, PolicyMapWallet
         ):
-            raise ValueError("wallet type must be POLICYMAP")
+            raise ValueError("wallet type must be POLICYMAP or POLICYMAP_BINARY_KEYS")
 
         if change != 0 and change != 1:
             raise ValueError("Invalid change")
 
         client_intepreter = ClientCommandInterpreter()
-        client_intepreter.add_known_list([k.encode() for k in wallet.keys_info])
-        client_intepreter.add_known_preimage(wallet.serialize())
+        add_known_wallet(client_intepreter, wallet)
+        if compiled_policy is not None:
+            client_intepreter.add_known_preimage(compiled_policy[0])
 
-        sw, response = self.make_request(
+        sw, response = yield (
             self.builder.get_wallet_address(
-                wallet, wallet_hmac, address_index, change, display
+                wallet, wallet_hmac, address_index, change, display, compiled_policy
             ),
             client_intepreter,
         )
@@ -215,106 +865,1153 @@ class BitcoinCommand:
 
         return response.decode()
 
-    def sign_psbt(self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes]) -> Mapping[int, bytes]:
-        """Signs a PSBT using a registered wallet (or a standard wallet that does not need registration).
-
-        Signature requires explicit approval from the user.
-
-        Parameters
-        ----------
-        psbt : PSBT
-            A PSBT of version 0 or 2, with all the necessary information to sign the inputs already filled in; what the
-            required fields changes depending on the type of input.
-            The non-witness UTXO must be present for both legacy and SegWit inputs, or the hardware wallet will reject
-            signing (this will change for Taproot inputs).
-
-        wallet : Wallet
-            The registered wallet policy, or a standard wallet policy.
-
-        wallet_hmac: Optional[bytes]
-            For a registered wallet, the hmac obtained at wallet registration. `None` for a standard wallet policy.
-
-        Returns
-        -------
-        Mapping[int, bytes]
-            A mapping that has as keys the indexes of inputs that the Hardware Wallet signed, and the corresponding signatures as values.
-        """
-        if psbt.version != 2:
-            if self._no_clone_psbt:
-                psbt.to_psbt_v2()
-                psbt_v2 = psbt
-            else:
-                psbt_v2 = PSBT()
-                psbt_v2.deserialize(psbt.serialize())  # clone psbt
-                psbt_v2.to_psbt_v2()
-        else:
-            psbt_v2 = psbt
-
-        psbt_bytes = base64.b64decode(psbt_v2.serialize())
-        f = BytesIO(psbt_bytes)
+    def _get_wallet_addresses_raw_flow(
+        self,
+        wallet: Wallet,
+        wallet_hmac: Optional[bytes],
+        change: int,
+        start_index: int,
+        count: int,
+        script_pubkeys: bool,
+        compiled_policy: Optional[Tuple[bytes, bytes]] = None,
+    ) -> Flow[List[bytes]]:
+        if wallet.type not in (WalletType.POLICYMAP, WalletType.POLICYMAP_BINARY_KEYS) or not isinstance(
+            wallet, PolicyMapWallet
+        ):
+            raise ValueError("wallet type must be POLICYMAP or POLICYMAP_BINARY_KEYS")
 
-        # We parse the individual maps (global map, each input map, and each output map) from the psbt serialized as a
-        # sequence of bytes, in order to produce the serialized Merkleized map commitments. Moreover, we prepare the
-        # client interpreter to respond on queries on all the relevant Merkle trees and pre-images in the psbt.
+        if change != 0 and change != 1:
+            raise ValueError("Invalid change")
 
-        assert f.read(5) == b"psbt\xff"
+        if count <= 0 or start_index < 0 or start_index + count > 0x80000000:
+            raise ValueError("Invalid range of address indexes")
 
         client_intepreter = ClientCommandInterpreter()
-        client_intepreter.add_known_list([k.encode() for k in wallet.keys_info])
-        client_intepreter.add_known_preimage(wallet.serialize())
-
-        global_map: Mapping[bytes, bytes] = parse_stream_to_map(f)
-        client_intepreter.add_known_mapping(global_map)
-
-        input_maps: List[Mapping[bytes, bytes]] = []
-        for _ in range(psbt_v2.input_count):
-            input_maps.append(parse_stream_to_map(f))
-        for m in input_maps:
-            client_intepreter.add_known_mapping(m)
-
-        output_maps: List[Mapping[bytes, bytes]] = []
-        for _ in range(psbt_v2.output_count):
-            output_maps.append(parse_stream_to_map(f))
-        for m in output_maps:
-            client_intepreter.add_known_mapping(m)
+        add_known_wallet(client_intepreter, wallet)
+        if compiled_policy is not None:
+            client_intepreter.add_known_preimage(compiled_policy[0])
 
-        # We also add the Merkle tree of the input (resp. output) map commitments as a known tree
-        input_commitments = [get_merkleized_map_commitment(m_in) for m_in in input_maps]
-        output_commitments = [get_merkleized_map_commitment(m_out) for m_out in output_maps]
-
-        client_intepreter.add_known_list(input_commitments)
-        client_intepreter.add_known_list(output_commitments)
-
-        sw, _ = self.make_request(
-            self.builder.sign_psbt(
-                global_map, input_maps, output_maps, wallet, wallet_hmac
+        sw, _ = yield (
+            self.builder.get_wallet_addresses(
+                wallet, wallet_hmac, change, start_index, count, script_pubkeys, compiled_policy
             ),
             client_intepreter,
         )
 
         if sw != 0x9000:
-            raise DeviceException(error_code=sw, ins=BitcoinInsType.SIGN_PSBT)
+            raise DeviceException(error_code=sw, ins=BitcoinInsType.GET_WALLET_ADDRESSES)
 
-        # parse results and return a structured version instead
         results = client_intepreter.yielded
 
-        if any(len(x) <= 1 for x in results):
+        if len(results) != count:
             raise RuntimeError("Invalid response")
 
-        return {int(res[0]): res[1:] for res in results}
+        return results
 
-    def get_master_fingerprint(self) -> bytes:
-        """Gets the fingerprint of the master public key, as per BIP-32.
+    def get_wallet_addresses(
+        self,
+        wallet: Wallet,
+        wallet_hmac: Optional[bytes],
+        change: int,
+        start_index: int,
+        count: int,
+        compiled_policy: Optional[Tuple[bytes, bytes]] = None,
+    ) -> List[str]:
+        """For a given wallet that was already registered on the device (or a standard wallet that does not need registration),
+        returns the addresses for `change` and the `count` consecutive address indexes starting from `start_index`.
 
-        Returns
-        -------
-        bytes
-            The fingerprint of the master public key, as an array of 4 bytes.
+        The addresses are not shown on the device; use `get_wallet_address` to verify an address on screen.
+
+        Parameters
+        ----------
+        wallet : Wallet
+            The registered wallet policy, or a standard wallet policy.
+
+        wallet_hmac: Optional[bytes]
+            For a registered wallet, the hmac obtained at wallet registration. `None` for a standard wallet policy.
+
+        change: int
+            0 for standard receive addresses, 1 for change addresses. Other values are invalid.
+
+        start_index: int
+            The address index of the first address.
+
+        count: int
+            The number of addresses.
+
+        compiled_policy: Optional[Tuple[bytes, bytes]]
+            For a registered wallet, the compiled form of the wallet policy and its hmac, as in `get_wallet_address`.
+
+        Returns
+        -------
+        List[str]
+            The requested addresses, in order of address index.
         """
 
-        sw, response = self.make_request(self.builder.get_master_fingerprint())
+        return self._run_flow(
+            self._get_wallet_addresses_flow(wallet, wallet_hmac, change, start_index, count, compiled_policy))
+
+    def _get_wallet_addresses_flow(
+        self,
+        wallet: Wallet,
+        wallet_hmac: Optional[bytes],
+        change: int,
+        start_index: int,
+        count: int,
+        compiled_policy: Optional[Tuple[bytes, bytes]] = None,
+    ) -> Flow[List[str]]:
+        results = yield from self._get_wallet_addresses_raw_flow(
+            wallet, wallet_hmac, change, start_index, count, False, compiled_policy)
+        return [res.decode() for res in results]
+
+    def get_wallet_script_pubkeys(
+        self,
+        wallet: Wallet,
+        wallet_hmac: Optional[bytes],
+        change: int,
+        start_index: int,
+        count: int,
+    ) -> List[bytes]:
+        """Like `get_wallet_addresses`, but returns the scriptPubKeys instead of the addresses.
+
+        Returns
+        -------
+        List[bytes]
+            The requested scriptPubKeys, in order of address index.
+        """
+
+        return self._run_flow(self._get_wallet_script_pubkeys_flow(wallet, wallet_hmac, change, start_index, count))
+
+    def _get_wallet_script_pubkeys_flow(
+        self,
+        wallet: Wallet,
+        wallet_hmac: Optional[bytes],
+        change: int,
+        start_index: int,
+        count: int,
+    ) -> Flow[List[bytes]]:
+        return (yield from self._get_wallet_addresses_raw_flow(wallet, wallet_hmac, change, start_index, count, True))
+
+    def get_wallet_addresses_batch(
+        self,
+        requests: List[Tuple[Wallet, Optional[bytes], int, int]],
+        max_batch_len: int = MAX_BATCH_DATA_LEN,
+    ) -> List[str]:
+        """Returns the addresses of several wallets, or of arbitrary address indexes, without showing them on the
+        device; the GET_WALLET_ADDRESS commands are sent in BATCH commands, saving the round trip of each one.
+
+        Parameters
+        ----------
+        requests : List[Tuple[Wallet, Optional[bytes], int, int]]
+            For each address, the wallet, its hmac, the change and the address index, as in `get_wallet_address`.
+
+        max_batch_len : int
+            The maximum length of the data of each BATCH command; it must be at most 128 for the Nano S.
+
+        Returns
+        -------
+        List[str]
+            The requested addresses, in the same order as the requests.
+        """
+
+        return self._run_flow(self._get_wallet_addresses_batch_flow(requests, max_batch_len))
+
+    def _get_wallet_addresses_batch_flow(
+        self,
+        requests: List[Tuple[Wallet, Optional[bytes], int, int]],
+        max_batch_len: int = MAX_BATCH_DATA_LEN,
+    ) -> Flow[List[str]]:
+        client_intepreter = ClientCommandInterpreter()
+        apdus = []
+        for wallet, wallet_hmac, change, address_index in requests:
+            if wallet.type not in (WalletType.POLICYMAP, WalletType.POLICYMAP_BINARY_KEYS) or not isinstance(
+                wallet, PolicyMapWallet
+            ):
+                raise ValueError("wallet type must be POLICYMAP or POLICYMAP_BINARY_KEYS")
+
+            if change != 0 and change != 1:
+                raise ValueError("Invalid change")
+
+            add_known_wallet(client_intepreter, wallet)
+            apdus.append(self.builder.get_wallet_address(wallet, wallet_hmac, address_index, change, False))
+
+        results = yield from self._batch_flow(apdus, client_intepreter, max_batch_len)
+
+        addresses = []
+        for sw, response in results:
+            if sw != 0x9000:
+                raise DeviceException(error_code=sw, ins=BitcoinInsType.GET_WALLET_ADDRESS)
+            addresses.append(response.decode())
+        return addresses
+
+    def _batch_flow(
+        self,
+        apdus: List[dict],
+        client_intepreter: ClientCommandInterpreter,
+        max_batch_len: int = MAX_BATCH_DATA_LEN,
+    ) -> Flow[List[Tuple[int, bytes]]]:
+        """Runs the commands in as few BATCH commands as possible, and returns the status word and the response of
+        each one; client_intepreter must handle the client commands of all of them."""
+
+        batches: List[List[dict]] = []
+        batch_len = 0
+        for apdu in apdus:
+            apdu_len = 3 + len(apdu["data"])
+            if apdu_len > max_batch_len:
+                raise ValueError("Command too long for a batch")
+            if len(batches) == 0 or batch_len + apdu_len > max_batch_len:
+                batches.append([])
+                batch_len = 0
+            batches[-1].append(apdu)
+            batch_len += apdu_len
+
+        results: List[Tuple[int, bytes]] = []
+        for batch in batches:
+            n_yielded = len(client_intepreter.yielded)
+
+            sw, _ = yield self.builder.batch(batch), client_intepreter
+
+            if sw != 0x9000:
+                raise DeviceException(error_code=sw, ins=FrameworkInsType.BATCH)
+
+            # each yielded value is the response of a command, followed by its status word
+            responses = client_intepreter.yielded[n_yielded:]
+            if len(responses) != len(batch) or any(len(response) < 2 for response in responses):
+                raise RuntimeError("Invalid response")
+
+            results.extend((int.from_bytes(response[-2:], byteorder="big"), response[:-2]) for response in responses)
+        return results
+
+    def sign_psbt(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes], resume: bool = False,
+        input_range: Optional[Tuple[int, int]] = None
+    ) -> Mapping[int, bytes]:
+        """Signs a PSBT using a registered wallet (or a standard wallet that does not need registration).
+
+        Signature requires explicit approval from the user.
+
+        If the wallet has more than one internal key, only the last signature of each input is returned; use
+        `sign_psbt_all_signatures` to get all of them.
+
+        Parameters
+        ----------
+        psbt : PSBT
+            A PSBT of version 0 or 2, with all the necessary information to sign the inputs already filled in; what the
+            required fields changes depending on the type of input.
+            The non-witness UTXO must be present for both legacy and SegWit inputs, or the hardware wallet will reject
+            signing (this will change for Taproot inputs).
+
+        wallet : Wallet
+            The registered wallet policy, or a standard wallet policy.
+
+        wallet_hmac: Optional[bytes]
+            For a registered wallet, the hmac obtained at wallet registration. `None` for a standard wallet policy.
+
+        resume : bool
+            If True, and the app was built with SIGN_PSBT_CHECKPOINT=1, resumes an interrupted signing of the same
+            psbt with the same wallet; only the signatures of the inputs that were not yielded yet are returned.
+            Otherwise, the psbt is signed from the start.
+
+        input_range : Optional[Tuple[int, int]]
+            If not None, a pair `(start, end)`: only the internal inputs with index `start <= i < end` are signed.
+            The user still approves the whole transaction.
+
+        Returns
+        -------
+        Mapping[int, bytes]
+            A mapping that has as keys the indexes of inputs that the Hardware Wallet signed, and the corresponding signatures as values.
+        """
+
+        return self._run_flow(self._sign_psbt_flow(psbt, wallet, wallet_hmac, resume, input_range))
+
+    def _sign_psbt_flow(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes], resume: bool = False,
+        input_range: Optional[Tuple[int, int]] = None
+    ) -> Flow[Mapping[int, bytes]]:
+        all_signatures = yield from self._sign_psbt_all_signatures_flow(
+            psbt, wallet, wallet_hmac, resume, input_range)
+        return {input_index: sigs[-1] for input_index, sigs in all_signatures.items()}
+
+    def sign_psbt_all_signatures(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes], resume: bool = False,
+        input_range: Optional[Tuple[int, int]] = None
+    ) -> Mapping[int, List[bytes]]:
+        """Signs a PSBT like `sign_psbt`, returning all the signatures produced for each input.
+
+        Each internal input is signed with every key of the wallet that belongs to the Hardware Wallet.
+
+        Parameters
+        ----------
+        psbt : PSBT
+            A PSBT of version 0 or 2, as for `sign_psbt`.
+
+        wallet : Wallet
+            The registered wallet policy, or a standard wallet policy.
+
+        wallet_hmac: Optional[bytes]
+            For a registered wallet, the hmac obtained at wallet registration. `None` for a standard wallet policy.
+
+        resume : bool
+            As for `sign_psbt`.
+
+        input_range : Optional[Tuple[int, int]]
+            As for `sign_psbt`.
+
+        Returns
+        -------
+        Mapping[int, List[bytes]]
+            A mapping that has as keys the indexes of inputs that the Hardware Wallet signed, and as values the list of the
+            corresponding signatures, in the order of the internal keys in the wallet's keys information.
+        """
+
+        return self._run_flow(self._sign_psbt_all_signatures_flow(psbt, wallet, wallet_hmac, resume, input_range))
+
+    def _sign_psbt_all_signatures_flow(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes], resume: bool = False,
+        input_range: Optional[Tuple[int, int]] = None
+    ) -> Flow[Mapping[int, List[bytes]]]:
+        apdu, client_intepreter = self._get_prepared_sign_psbt(psbt, wallet, wallet_hmac)
+        return (yield from self._sign_psbt_prepared_flow(apdu, client_intepreter, resume, input_range))
+
+    def sign_psbt_multi_wallet(
+        self, psbt: PSBT, wallets: List[Tuple[Wallet, Optional[bytes]]],
+        input_range: Optional[Tuple[int, int]] = None
+    ) -> Mapping[int, List[bytes]]:
+        """Signs a PSBT like `sign_psbt_all_signatures`, with the internal inputs of several wallet policies.
+
+        The hardware wallet verifies the transaction once, and the user approves it once: the inputs and the outputs
+        of any of the wallet policies are internal, and each internal input is signed with the keys of its wallet
+        policy. At most 4 wallet policies are supported (2 on Nano S).
+
+        Parameters
+        ----------
+        psbt : PSBT
+            As for `sign_psbt`.
+
+        wallets : List[Tuple[Wallet, Optional[bytes]]]
+            The wallet policies, each with its hmac (`None` for a standard wallet policy). The PSBT is prepared with the
+            first one.
+
+        input_range : Optional[Tuple[int, int]]
+            As for `sign_psbt`.
+
+        Returns
+        -------
+        Mapping[int, List[bytes]]
+            As for `sign_psbt_all_signatures`.
+        """
+
+        return self._run_flow(self._sign_psbt_multi_wallet_flow(psbt, wallets, input_range))
+
+    def _sign_psbt_multi_wallet_flow(
+        self, psbt: PSBT, wallets: List[Tuple[Wallet, Optional[bytes]]],
+        input_range: Optional[Tuple[int, int]] = None
+    ) -> Flow[Mapping[int, List[bytes]]]:
+        if len(wallets) == 0:
+            raise ValueError("At least one wallet policy is needed")
+
+        wallet, wallet_hmac = wallets[0]
+        apdu, client_intepreter = self._get_prepared_sign_psbt(psbt, wallet, wallet_hmac)
+        for extra_wallet, _ in wallets[1:]:
+            add_known_wallet(client_intepreter, extra_wallet)
+
+        # flag 0x20 of the mode: the number of additional wallet policies, followed by the id and the hmac of each of
+        # them; the cached apdu is not modified
+        data = apdu["data"] + bytes([self._sign_psbt_mode(0) | 0x20, len(wallets) - 1])
+        for extra_wallet, extra_hmac in wallets[1:]:
+            data += extra_wallet.id + (extra_hmac if extra_hmac is not None else b'\0' * 32)
+        if input_range is not None:
+            start, end = input_range
+            data += write_varint(start) + write_varint(end)
+
+        sw, response = yield dict(apdu, data=data), client_intepreter
+
+        if sw != 0x9000:
+            raise DeviceException(error_code=sw, ins=BitcoinInsType.SIGN_PSBT)
+
+        return self._parse_yielded_signatures(client_intepreter, response)
+
+    def sign_psbt_in_order(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes], input_order: Optional[List[int]] = None,
+        input_range: Optional[Tuple[int, int]] = None
+    ) -> Mapping[int, List[bytes]]:
+        """Signs a PSBT like `sign_psbt_all_signatures`, visiting the inputs in the given order rather than by index.
+
+        The keys of the addresses signed last are cached by the hardware wallet, so signing consecutively the inputs
+        that spend from the same address, as in a sweep of reused addresses, is faster.
+
+        Parameters
+        ----------
+        psbt, wallet, wallet_hmac :
+            As for `sign_psbt`.
+
+        input_order : Optional[List[int]]
+            A permutation of the indexes of the inputs in `input_range`, in the order they are signed; by default, the
+            one of `derivation_locality_order`.
+
+        input_range : Optional[Tuple[int, int]]
+            As for `sign_psbt`.
+
+        Returns
+        -------
+        Mapping[int, List[bytes]]
+            As for `sign_psbt_all_signatures`; the signatures are still mapped to the index of their input.
+        """
+
+        return self._run_flow(self._sign_psbt_in_order_flow(psbt, wallet, wallet_hmac, input_order, input_range))
+
+    def _sign_psbt_in_order_flow(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes], input_order: Optional[List[int]] = None,
+        input_range: Optional[Tuple[int, int]] = None
+    ) -> Flow[Mapping[int, List[bytes]]]:
+        if input_order is None:
+            input_order = derivation_locality_order(psbt, input_range)
+
+        apdu, client_intepreter = self._get_prepared_sign_psbt(psbt, wallet, wallet_hmac)
+        order_tree = client_intepreter.add_known_list([i.to_bytes(4, byteorder="little") for i in input_order])
+
+        # flag 0x10 of the mode: the Merkle root of the signing order; the cached apdu is not modified
+        data = apdu["data"] + bytes([self._sign_psbt_mode(0) | 0x10]) + order_tree.root
+        if input_range is not None:
+            start, end = input_range
+            data += write_varint(start) + write_varint(end)
+
+        sw, response = yield dict(apdu, data=data), client_intepreter
+
+        if sw != 0x9000:
+            raise DeviceException(error_code=sw, ins=BitcoinInsType.SIGN_PSBT)
+
+        return self._parse_yielded_signatures(client_intepreter, response)
+
+    def check_psbt(self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes]) -> dict:
+        """Verifies a PSBT like `sign_psbt` would, without asking the user to validate it and without signing it.
+
+        The hardware wallet returns what the user would be shown: the totals of the transaction, and which inputs and
+        outputs are internal. Since the prepared command is cached like for `sign_psbt`, signing the same PSBT
+        afterwards does not prepare it again.
+
+        Parameters
+        ----------
+        psbt, wallet, wallet_hmac :
+            As for `sign_psbt`.
+
+        Returns
+        -------
+        dict
+            A dictionary with the keys "inputs_total", "outputs_total", "fee" and "change_total" (in satoshis),
+            "internal_inputs" (the list of the indexes of the internal inputs) and "change_outputs" (the list of the
+            indexes of the change outputs).
+        """
+
+        return self._run_flow(self._check_psbt_flow(psbt, wallet, wallet_hmac))
+
+    def _check_psbt_flow(self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes]) -> Flow[dict]:
+        apdu, client_intepreter = self._get_prepared_sign_psbt(psbt, wallet, wallet_hmac)
+
+        # mode 2: only verify the psbt; the cached apdu is not modified
+        sw, response = yield dict(apdu, data=apdu["data"] + b"\x02"), client_intepreter
+
+        if sw != 0x9000:
+            raise DeviceException(error_code=sw, ins=BitcoinInsType.SIGN_PSBT)
+
+        def bits(bitvector: bytes, n: int) -> List[int]:
+            return [i for i in range(n) if bitvector[i // 8] & (1 << (i % 8))]
+
+        n_inputs, n_outputs = len(psbt.inputs), len(psbt.outputs)
+        change_data = response[24 + (n_inputs + 7) // 8:]
+        if n_outputs <= 256:
+            if len(change_data) != (n_outputs + 7) // 8:
+                raise RuntimeError("Invalid response")
+            change_outputs = bits(change_data, n_outputs)
+        else:
+            # for larger psbts, the number of change outputs followed by their indexes
+            if len(change_data) == 0 or len(change_data) != 1 + 4 * change_data[0]:
+                raise RuntimeError("Invalid response")
+            change_outputs = [int.from_bytes(change_data[1 + 4 * i:5 + 4 * i], byteorder="little")
+                              for i in range(change_data[0])]
+
+        inputs_total = int.from_bytes(response[0:8], byteorder="little")
+        outputs_total = int.from_bytes(response[8:16], byteorder="little")
+        return {
+            "inputs_total": inputs_total,
+            "outputs_total": outputs_total,
+            "fee": inputs_total - outputs_total,
+            "change_total": int.from_bytes(response[16:24], byteorder="little"),
+            "internal_inputs": bits(response[24:], n_inputs),
+            "change_outputs": change_outputs,
+        }
+
+    def sign_psbt_summary(self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes]) -> Mapping[int, List[bytes]]:
+        """Signs a PSBT like `sign_psbt_all_signatures`, with the external outputs validated at once rather than one by
+        one, which is practical for transactions with many outputs, like payout batches.
+
+        The user validates the number of external outputs, their total amount and their hash, that the client should
+        show next to the one on the screen of the device: it is returned by `external_outputs_hash`, with the change
+        outputs found by `check_psbt`.
+
+        Parameters
+        ----------
+        psbt, wallet, wallet_hmac :
+            As for `sign_psbt`.
+
+        Returns
+        -------
+        Mapping[int, List[bytes]]
+            As for `sign_psbt_all_signatures`.
+        """
+
+        return self._run_flow(self._sign_psbt_summary_flow(psbt, wallet, wallet_hmac))
+
+    def _sign_psbt_summary_flow(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes]
+    ) -> Flow[Mapping[int, List[bytes]]]:
+        apdu, client_intepreter = self._get_prepared_sign_psbt(psbt, wallet, wallet_hmac)
+
+        # mode 5: the external outputs are validated at once; the cached apdu is not modified
+        sw, response = yield dict(apdu, data=apdu["data"] + bytes([self._sign_psbt_mode(5)])), client_intepreter
+
+        if sw != 0x9000:
+            raise DeviceException(error_code=sw, ins=BitcoinInsType.SIGN_PSBT)
+
+        return self._parse_yielded_signatures(client_intepreter, response)
+
+    def sign_proof_of_reserves(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes], message: Union[str, bytes]
+    ) -> Mapping[int, List[bytes]]:
+        """Signs the 'to_sign' transaction of a BIP-322 proof of funds for a message, with all its internal inputs.
+
+        The hardware wallet verifies that the first input spends the 'to_spend' transaction of the message, and that
+        the only output is an empty OP_RETURN; the user confirms the hash of the message and the total amount of the
+        internal inputs once, instead of a transaction. See `bitcoin_client.bip322` to build the PSBT.
+
+        Parameters
+        ----------
+        psbt : PSBT
+            The 'to_sign' PSBT, as returned by `bitcoin_client.bip322.make_proof_psbt` for the same message.
+
+        wallet, wallet_hmac :
+            As for `sign_psbt`.
+
+        message : Union[str, bytes]
+            The message (a string is encoded in UTF-8).
+
+        Returns
+        -------
+        Mapping[int, List[bytes]]
+            As for `sign_psbt_all_signatures`.
+        """
+
+        return self._run_flow(self._sign_proof_of_reserves_flow(psbt, wallet, wallet_hmac, message))
+
+    def _sign_proof_of_reserves_flow(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes], message: Union[str, bytes]
+    ) -> Flow[Mapping[int, List[bytes]]]:
+        apdu, client_intepreter = self._get_prepared_sign_psbt(psbt, wallet, wallet_hmac)
+
+        # mode 3: proof of funds, followed by the hash of the message; the cached apdu is not modified
+        mode = self._sign_psbt_mode(3)
+        sw, response = yield (dict(apdu, data=apdu["data"] + bytes([mode]) + bip322.message_hash(message)),
+                              client_intepreter)
+
+        if sw != 0x9000:
+            raise DeviceException(error_code=sw, ins=BitcoinInsType.SIGN_PSBT)
+
+        return self._parse_yielded_signatures(client_intepreter, response)
+
+    def sign_psbt_amendable(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes],
+        amend_record: Optional[Tuple[bytes, bytes]] = None
+    ) -> Tuple[Mapping[int, List[bytes]], Tuple[bytes, bytes]]:
+        """Signs a PSBT like `sign_psbt_all_signatures`, and also returns its amend record, that can be given to
+        `sign_psbt_amend` to sign a fee bump of the same transaction.
+
+        The amend record contains the result of the verification of the inputs by the hardware wallet, authenticated
+        with an hmac; it is only available for PSBTs with at most 256 inputs.
+
+        Parameters
+        ----------
+        psbt, wallet, wallet_hmac :
+            As for `sign_psbt`.
+
+        amend_record : Optional[Tuple[bytes, bytes]]
+            If not None, the PSBT is signed as a fee bump of the PSBT of this amend record, like with `sign_psbt_amend`.
+
+        Returns
+        -------
+        Tuple[Mapping[int, List[bytes]], Tuple[bytes, bytes]]
+            The signatures, as for `sign_psbt_all_signatures`, and the amend record with its hmac.
+        """
+
+        return self._run_flow(self._sign_psbt_amend_flow(psbt, wallet, wallet_hmac, amend_record, True))
+
+    def sign_psbt_amend(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes], amend_record: Tuple[bytes, bytes]
+    ) -> Mapping[int, List[bytes]]:
+        """Signs a fee bump of a PSBT signed with `sign_psbt_amendable`, given its amend record.
+
+        The inputs of psbt must be exactly the same as in the original PSBT (in particular, without the signatures
+        produced for it), as well as its external outputs; only the change outputs can differ. The hardware wallet does
+        not verify the inputs again, and the user only approves the new fee.
+
+        Parameters
+        ----------
+        psbt, wallet, wallet_hmac :
+            As for `sign_psbt`; the wallet must be the same as for the original PSBT.
+
+        amend_record : Tuple[bytes, bytes]
+            The amend record of the original PSBT and its hmac, as returned by `sign_psbt_amendable`.
+
+        Returns
+        -------
+        Mapping[int, List[bytes]]
+            As for `sign_psbt_all_signatures`.
+        """
+
+        signatures, _ = self._run_flow(self._sign_psbt_amend_flow(psbt, wallet, wallet_hmac, amend_record, False))
+        return signatures
+
+    def _sign_psbt_amend_flow(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes], amend_record: Optional[Tuple[bytes, bytes]],
+        yield_record: bool
+    ) -> Flow[Tuple[Mapping[int, List[bytes]], Optional[Tuple[bytes, bytes]]]]:
+        apdu, client_intepreter = self._get_prepared_sign_psbt(psbt, wallet, wallet_hmac)
+
+        # mode 4: amend, followed by the sha256 of the amend record and its hmac; flag 0x40: yield the amend record.
+        # The cached apdu is not modified.
+        mode = self._sign_psbt_mode(4 if amend_record is not None else 0) | (0x40 if yield_record else 0)
+        data = apdu["data"] + bytes([mode])
+        if amend_record is not None:
+            record, record_hmac = amend_record
+            client_intepreter.add_known_preimage(record)
+            data += sha256(record).digest() + record_hmac
+
+        sw, response = yield dict(apdu, data=data), client_intepreter
+
+        if sw != 0x9000:
+            raise DeviceException(error_code=sw, ins=BitcoinInsType.SIGN_PSBT)
+
+        new_record = None
+        if yield_record:
+            # the amend record and its hmac are yielded before the signatures
+            if len(client_intepreter.yielded) == 0 or len(client_intepreter.yielded[0]) <= 32:
+                raise RuntimeError("Invalid response")
+            record_data = client_intepreter.yielded.pop(0)
+            new_record = (record_data[:-32], record_data[-32:])
+
+        return self._parse_yielded_signatures(client_intepreter, response), new_record
+
+    def sign_psbt_unattended(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes], spending_policy: Tuple[bytes, bytes],
+        destinations: List[bytes]
+    ) -> Mapping[int, List[bytes]]:
+        """Signs a PSBT that matches a spending policy registered with `register_spending_policy`, without user
+        interaction.
+
+        The app refuses (with `DeviceException` for `SW_DENY`) the PSBTs with external inputs, with non-default sighash
+        types, with external outputs that are not destinations of the spending policy, or that spend more than its
+        limits.
+
+        Parameters
+        ----------
+        psbt, wallet, wallet_hmac :
+            As for `sign_psbt`; the wallet must be the one of the spending policy.
+        spending_policy : Tuple[bytes, bytes]
+            The spending policy and its hmac, as returned by `register_spending_policy`.
+        destinations : List[bytes]
+            The destinations of the spending policy, as given to `register_spending_policy`.
+
+        Returns
+        -------
+        Mapping[int, List[bytes]]
+            As for `sign_psbt_all_signatures`.
+        """
+
+        return self._run_flow(self._sign_psbt_unattended_flow(psbt, wallet, wallet_hmac, spending_policy, destinations))
+
+    def _sign_psbt_unattended_flow(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes], spending_policy: Tuple[bytes, bytes],
+        destinations: List[bytes]
+    ) -> Flow[Mapping[int, List[bytes]]]:
+        apdu, client_intepreter = self._get_prepared_sign_psbt(psbt, wallet, wallet_hmac)
+
+        # mode 6: unattended, followed by the sha256 of the spending policy and its hmac, that the app gets as a
+        # preimage; the destinations are looked up with GET_MERKLE_LEAF_INDEX. The cached apdu is not modified.
+        policy, policy_hmac = spending_policy
+        client_intepreter.add_known_preimage(policy + policy_hmac)
+        client_intepreter.add_known_list(destinations)
+        mode = self._sign_psbt_mode(6)
+        data = apdu["data"] + bytes([mode]) + sha256(policy + policy_hmac).digest()
+
+        sw, response = yield dict(apdu, data=data), client_intepreter
+
+        if sw != 0x9000:
+            raise DeviceException(error_code=sw, ins=BitcoinInsType.SIGN_PSBT)
+
+        return self._parse_yielded_signatures(client_intepreter, response)
+
+    def _get_prepared_sign_psbt(
+        self, psbt: PSBT, wallet: Wallet, wallet_hmac: Optional[bytes]
+    ) -> Tuple[dict, ClientCommandInterpreter]:
+        """Returns the apdu and the client interpreter for SIGN_PSBT, from the cache if possible."""
+
+        cache_key = None
+        cached = None
+        if self.psbt_cache_size > 0:
+            cache_key = sha256(b"".join([
+                sha256(psbt.serialize().encode()).digest(),
+                wallet.id,
+                wallet_hmac if wallet_hmac is not None else b"",
+            ])).digest()
+            cached = self._psbt_cache.get(cache_key)
+
+        if cached is not None:
+            self._psbt_cache.move_to_end(cache_key)
+            apdu, prepared, _ = cached
+            prepared.client_intepreter.reset()
+            return apdu, prepared.client_intepreter
+
+        # A new version of a cached psbt for the same wallet (for example, a fee bump of it) is prepared by updating
+        # the most recent one, so that only the maps that changed are merkleized again.
+        base_key = None
+        if cache_key is not None:
+            base_key = next((key for key, (_, base, base_hmac) in reversed(self._psbt_cache.items())
+                             if base.wallet.id == wallet.id and base_hmac == wallet_hmac), None)
+
+        if base_key is not None:
+            _, prepared, _ = self._psbt_cache.pop(base_key)
+            prepared.client_intepreter.reset()
+            self.update_prepared_psbt(prepared, psbt)
+        else:
+            prepared = self.prepare_psbt(psbt, wallet)
+
+        apdu = self._sign_psbt_apdu(prepared, wallet_hmac)
+        if cache_key is not None:
+            self._psbt_cache[cache_key] = (apdu, prepared, wallet_hmac)
+            while len(self._psbt_cache) > self.psbt_cache_size:
+                self._psbt_cache.popitem(last=False)
+
+        return apdu, prepared.client_intepreter
+
+    def sign_psbt_stream(
+        self, psbt: PsbtSource, wallet: Wallet, wallet_hmac: Optional[bytes], resume: bool = False,
+        input_range: Optional[Tuple[int, int]] = None
+    ) -> Mapping[int, bytes]:
+        """Signs a PSBT like `sign_psbt`, reading it from a file instead of a PSBT object.
+
+        The PSBT is merkleized map by map while it is read, and only the hashes and the short values are kept in
+        memory; the long values (like non-witness UTXOs) are read back from the file when the hardware wallet asks for
+        them. Therefore, the memory used does not grow with the size of the PSBT.
+
+        Parameters
+        ----------
+        psbt : PsbtSource
+            A PSBT of version 0 or 2, binary or base64-encoded: a path to a file, a binary stream, or an iterable of
+            chunks of bytes. A path to a binary PSBT is memory-mapped; anything else is first copied to a temporary
+            file.
+
+        wallet, wallet_hmac, resume, input_range :
+            As for `sign_psbt`.
+
+        Returns
+        -------
+        Mapping[int, bytes]
+            As for `sign_psbt`.
+        """
+
+        return self._run_flow(self._sign_psbt_stream_flow(psbt, wallet, wallet_hmac, resume, input_range))
+
+    def _sign_psbt_stream_flow(
+        self, psbt: PsbtSource, wallet: Wallet, wallet_hmac: Optional[bytes], resume: bool = False,
+        input_range: Optional[Tuple[int, int]] = None
+    ) -> Flow[Mapping[int, bytes]]:
+        client_intepreter = ClientCommandInterpreter(PreimageStore(self.preimage_spill_size),
+                                                     precompute_executor=self.precompute_executor)
+        add_known_wallet(client_intepreter, wallet)
+
+        global_commitment, input_commitments, output_commitments = prepare_sign_psbt_stream(psbt, client_intepreter)
+
+        apdu = self.builder.sign_psbt_commitments(
+            global_commitment, input_commitments, output_commitments, wallet, wallet_hmac)
+
+        all_signatures = yield from self._sign_psbt_prepared_flow(apdu, client_intepreter, resume, input_range)
+        return {input_index: sigs[-1] for input_index, sigs in all_signatures.items()}
+
+    def _sign_psbt_prepared_flow(
+        self, apdu: dict, client_intepreter: ClientCommandInterpreter, resume: bool,
+        input_range: Optional[Tuple[int, int]]
+    ) -> Flow[Mapping[int, List[bytes]]]:
+        # the mode (resume flag and coalesced yields) and the range of inputs are optional fields at the end of the
+        # data; the cached apdu is not modified
+        mode = self._sign_psbt_mode(1 if resume else 0)
+        if input_range is not None:
+            start, end = input_range
+            apdu = dict(apdu, data=apdu["data"] + bytes([mode]) + write_varint(start) + write_varint(end))
+        elif mode != 0:
+            apdu = dict(apdu, data=apdu["data"] + bytes([mode]))
+
+        sw, response = yield apdu, client_intepreter
+
+        if sw != 0x9000:
+            raise DeviceException(error_code=sw, ins=BitcoinInsType.SIGN_PSBT)
+
+        return self._parse_yielded_signatures(client_intepreter, response)
+
+    def _sign_psbt_mode(self, mode: int) -> int:
+        """Returns the mode byte of SIGN_PSBT, with the flags for coalesced yields and for the progress events if
+        enabled."""
+        if self.coalesce_yields:
+            mode |= 0x80
+        if self.progress_callback is not None:
+            mode |= 0x08
+        return mode
+
+    def _parse_yielded_signatures(
+        self, client_intepreter: ClientCommandInterpreter, response: bytes = b""
+    ) -> Mapping[int, List[bytes]]:
+        # parse results and return a structured version instead
+        results = client_intepreter.yielded
+
+        if self.coalesce_yields:
+            # each YIELD, and the final response, is a sequence of length-prefixed signatures
+            entries = []
+            for data in results + [response]:
+                pos = 0
+                while pos < len(data):
+                    entry_len = data[pos]
+                    if pos + 1 + entry_len > len(data):
+                        raise RuntimeError("Invalid response")
+                    entries.append(data[pos + 1:pos + 1 + entry_len])
+                    pos += 1 + entry_len
+            results = entries
+
+        # each signature is prefixed by the index of its input, as a varint
+        signatures: Dict[int, List[bytes]] = {}
+        for res in results:
+            buf = BytesIO(res)
+            try:
+                input_index = read_varint(buf)
+            except ValueError:
+                raise RuntimeError("Invalid response")
+            signature = buf.read()
+            if len(signature) == 0:
+                raise RuntimeError("Invalid response")
+            signatures.setdefault(input_index, []).append(signature)
+        return signatures
+
+    def _sign_psbt_apdu(self, prepared: PreparedPsbt, wallet_hmac: Optional[bytes]) -> dict:
+        """Returns the SIGN_PSBT apdu for a prepared psbt, from the roots of its Merkle trees."""
+
+        return self.builder.sign_psbt_roots(
+            prepared.global_commitment, len(prepared.input_tree), prepared.input_tree.root, len(prepared.output_tree),
+            prepared.output_tree.root, prepared.wallet, wallet_hmac)
+
+    def prepare_psbt(self, psbt: PSBT, wallet: Wallet) -> PreparedPsbt:
+        """Prepares psbt for SIGN_PSBT with the wallet policy, to be signed with `sign_prepared_psbt`, possibly by
+        several devices.
+
+        Parameters
+        ----------
+        psbt : PSBT
+            As for `sign_psbt`.
+
+        wallet : Wallet
+            The registered wallet policy, or a standard wallet policy. The hmac of a registered wallet is only needed
+            to sign, as it can differ for each device.
+
+        Returns
+        -------
+        PreparedPsbt
+            The commitments of the PSBT, and the client command interpreter that knows all its Merkle trees and
+            preimages.
+        """
+
+        # We parse the individual maps (global map, each input map, and each output map) from the psbt serialized as a
+        # sequence of bytes, in order to produce the serialized Merkleized map commitments. Moreover, we prepare the
+        # client interpreter to respond on queries on all the relevant Merkle trees and pre-images in the psbt.
+
+        global_map, input_maps, output_maps = self._parse_psbt_maps(psbt)
+
+        client_intepreter = ClientCommandInterpreter(
+            PreimageStore(self.preimage_spill_size) if self.preimage_spill_size is not None else None,
+            precompute_executor=self.precompute_executor)
+        add_known_wallet(client_intepreter, wallet)
+
+        global_commitment = client_intepreter.add_known_mapping(global_map)
+        input_commitments = [client_intepreter.add_known_mapping(m_in) for m_in in input_maps]
+        output_commitments = [client_intepreter.add_known_mapping(m_out) for m_out in output_maps]
+
+        # We also add the Merkle tree of the input (resp. output) map commitments as a known tree
+        input_tree = client_intepreter.add_known_list(input_commitments)
+        output_tree = client_intepreter.add_known_list(output_commitments)
+
+        return PreparedPsbt(wallet, global_commitment, input_commitments, output_commitments,
+                            client_intepreter, global_map, input_maps, output_maps, input_tree, output_tree)
+
+    def update_prepared_psbt(self, prepared: PreparedPsbt, psbt: PSBT) -> None:
+        """Updates a PSBT prepared with `prepare_psbt` for a new version of it, like a fee bump that only changes its
+        change outputs.
+
+        Only the maps that differ from the ones of the prepared PSBT are merkleized again, and the Merkle trees of the
+        lists of the input and output maps are updated in place, in O(log n) for each changed map; the PSBT is still
+        parsed again. The known data of the prepared PSBT is modified: it must not be used by other commands while it
+        is updated, and the previous version of the PSBT can not be signed with it anymore.
+
+        Parameters
+        ----------
+        prepared : PreparedPsbt
+            A PSBT prepared with `prepare_psbt`, for the same wallet policy.
+
+        psbt : PSBT
+            The new version of the PSBT.
+        """
+
+        global_map, input_maps, output_maps = self._parse_psbt_maps(psbt)
+        client_intepreter = prepared.client_intepreter
+
+        # the lookup tables of the trees that are updated in place must not be computed in the background anymore
+        client_intepreter.wait_precomputed()
+
+        if global_map != prepared.global_map:
+            prepared.global_commitment = client_intepreter.add_known_mapping(global_map)
+            prepared.global_map = global_map
+
+        prepared.input_tree = _update_prepared_maps(
+            client_intepreter, prepared.input_tree, prepared.input_maps, input_maps, prepared.input_commitments)
+        prepared.output_tree = _update_prepared_maps(
+            client_intepreter, prepared.output_tree, prepared.output_maps, output_maps, prepared.output_commitments)
+
+    def _parse_psbt_maps(
+        self, psbt: PSBT
+    ) -> Tuple[Mapping[bytes, bytes], List[Mapping[bytes, bytes]], List[Mapping[bytes, bytes]]]:
+        """Returns the global map, the input maps and the output maps of psbt, converted to version 2."""
+
+        if psbt.version != 2:
+            if self._no_clone_psbt:
+                psbt.to_psbt_v2()
+                psbt_v2 = psbt
+            else:
+                psbt_v2 = PSBT()
+                psbt_v2.deserialize(psbt.serialize())  # clone psbt
+                psbt_v2.to_psbt_v2()
+        else:
+            psbt_v2 = psbt
+
+        psbt_bytes = base64.b64decode(psbt_v2.serialize())
+        f = BufferReader(psbt_bytes)
+
+        assert f.read(5) == b"psbt\xff"
+
+        global_map: Mapping[bytes, bytes] = parse_stream_to_map(f)
+        input_maps = [parse_stream_to_map(f) for _ in range(psbt_v2.input_count)]
+        output_maps = [parse_stream_to_map(f) for _ in range(psbt_v2.output_count)]
+        return global_map, input_maps, output_maps
+
+    def sign_prepared_psbt(
+        self, prepared: PreparedPsbt, wallet_hmac: Optional[bytes], resume: bool = False,
+        input_range: Optional[Tuple[int, int]] = None
+    ) -> Mapping[int, List[bytes]]:
+        """Signs a PSBT prepared with `prepare_psbt`, like `sign_psbt_all_signatures`.
+
+        The prepared PSBT is not modified, so other commands (for other devices) can sign it at the same time.
+
+        Parameters
+        ----------
+        prepared : PreparedPsbt
+            The PSBT, as returned by `prepare_psbt` (by this command, or by another one).
+
+        wallet_hmac, resume, input_range :
+            As for `sign_psbt`; the hmac is the one obtained when this device registered the wallet.
+
+        Returns
+        -------
+        Mapping[int, List[bytes]]
+            As for `sign_psbt_all_signatures`.
+        """
+
+        return self._run_flow(self._sign_prepared_psbt_flow(prepared, wallet_hmac, resume, input_range))
+
+    def _sign_prepared_psbt_flow(
+        self, prepared: PreparedPsbt, wallet_hmac: Optional[bytes], resume: bool = False,
+        input_range: Optional[Tuple[int, int]] = None
+    ) -> Flow[Mapping[int, List[bytes]]]:
+        apdu = self._sign_psbt_apdu(prepared, wallet_hmac)
+        return (yield from self._sign_psbt_prepared_flow(apdu, prepared.client_intepreter.fork(), resume, input_range))
+
+    def get_master_fingerprint(self) -> bytes:
+        """Gets the fingerprint of the master public key, as per BIP-32.
+
+        Returns
+        -------
+        bytes
+            The fingerprint of the master public key, as an array of 4 bytes.
+        """
+
+        return self._run_flow(self._get_master_fingerprint_flow())
+
+    def _get_master_fingerprint_flow(self) -> Flow[bytes]:
+        if self.response_cache and self._cached_fingerprint is not None:
+            return self._cached_fingerprint
+
+        sw, response = yield self.builder.get_master_fingerprint(), None
 
         if sw != 0x9000:
             raise DeviceException(error_code=sw, ins=BitcoinInsType.GET_EXTENDED_PUBKEY)
 
+        if self.response_cache:
+            self._cached_fingerprint = response
         return response
+
+    def warm_response_cache(self, bip32_paths: Optional[List[str]] = None) -> None:
+        """Fills the cache of `response_cache` with the master fingerprint and, in one command, the xpubs at
+        `bip32_paths` (that must be standard), or the ones of the standard accounts (see `get_account_xpubs`) if
+        None. Meant to be called after connecting to the device; the xpubs are skipped if the app does not support
+        the command."""
+
+        self._run_flow(self._warm_response_cache_flow(bip32_paths))
+
+    def _warm_response_cache_flow(self, bip32_paths: Optional[List[str]] = None) -> Flow[None]:
+        if not self.response_cache:
+            raise RuntimeError("The response cache is not enabled")
+
+        try:
+            if bip32_paths is None:
+                yield from self._get_account_xpubs_flow()
+            else:
+                yield from self._get_extended_pubkeys_flow(bip32_paths)
+        except InsNotSupportedError:
+            pass  # older app versions
+
+        yield from self._get_master_fingerprint_flow()
+
+    def get_app_stats(self) -> dict:
+        """Gets the instrumentation counters collected since the previous call, and resets them.
+        Only available if the app is compiled with APP_STATS=1.
+
+        Returns
+        -------
+        dict
+            A dictionary with the counters; the "client_commands" entry maps each client command
+            code to the number of interruptions with that code. Builds with STACK_PROFILE=1 also
+            return the "stack_high_water" and "stack_free" entries (in bytes), and the
+            "deepest_processor" entry, with the "function" and the "line" of the deepest processor.
+        """
+
+        return self._run_flow(self._get_app_stats_flow())
+
+    def _get_app_stats_flow(self) -> Flow[dict]:
+        sw, response = yield self.builder.get_app_stats(), None
+
+        if sw != 0x9000:
+            raise DeviceException(error_code=sw, ins=BitcoinInsType.GET_APP_STATS)
+
+        names = ["n_interruptions", "bytes_received", "bytes_sent", "sha256_bytes",
+                 "sha256_digests", "ec_scalar_mults", "max_stack_depth"]
+        result = {
+            name: int.from_bytes(response[4*i:4*i+4], byteorder="big")
+            for i, name in enumerate(names)
+        }
+
+        offset = 4 * len(names)
+        n_client_commands = response[offset]
+        offset += 1
+        result["client_commands"] = {}
+        for _ in range(n_client_commands):
+            code = response[offset]
+            count = int.from_bytes(response[offset+1:offset+5], byteorder="big")
+            result["client_commands"][code] = count
+            offset += 5
+
+        # only present in builds with STACK_PROFILE=1
+        if len(response) > offset:
+            result["stack_high_water"] = int.from_bytes(response[offset:offset+4], byteorder="big")
+            result["stack_free"] = int.from_bytes(response[offset+4:offset+8], byteorder="big")
+            line = int.from_bytes(response[offset+8:offset+10], byteorder="big")
+            name_len = response[offset+10]
+            name = response[offset+11:offset+11+name_len].decode()
+            result["deepest_processor"] = {"function": name, "line": line}
+
+        return result
+
+    def get_processor_trace(self) -> dict:
+        """Gets the trace of the processors recorded since the previous call, and resets it.
+        Only available if the app is compiled with PROCESSOR_TRACE=1.
+
+        Returns
+        -------
+        dict
+            A dictionary with the "entries" of the trace, from the oldest; each entry is a dictionary with the
+            "tick" when it was recorded, and either the "function" and the "line" of a processor, or the "event"
+            of the dispatcher ("interruption", "resume" or "end"). The "dropped" entry is the number of entries
+            that were lost because the trace was full, and "tick" is the tick when the trace was read.
+        """
+
+        return self._run_flow(self._get_processor_trace_flow())
+
+    def _get_processor_trace_flow(self) -> Flow[dict]:
+        events = ["interruption", "resume", "end"]
+
+        result = {"entries": []}
+        while True:
+            sw, response = yield self.builder.get_processor_trace(len(result["entries"])), None
+
+            if sw != 0x9000:
+                raise DeviceException(error_code=sw, ins=BitcoinInsType.GET_PROCESSOR_TRACE)
+
+            count = response[0]
+            result["dropped"] = int.from_bytes(response[1:5], byteorder="big")
+            result["tick"] = int.from_bytes(response[5:7], byteorder="big")
+
+            offset = 7
+            while offset < len(response):
+                tick = int.from_bytes(response[offset:offset+2], byteorder="big")
+                line = int.from_bytes(response[offset+2:offset+4], byteorder="big")
+                name_len = response[offset+4]
+                name = response[offset+5:offset+5+name_len].decode()
+                offset += 5 + name_len
+
+                if name_len > 0:
+                    result["entries"].append({"tick": tick, "function": name, "line": line})
+                else:
+                    event = events[line] if line < len(events) else str(line)
+                    result["entries"].append({"tick": tick, "event": event})
+
+            if len(result["entries"]) >= count:
+                return result
+
+    def get_debug_trace(self) -> dict:
+        """Gets the events of the debug trace recorded since the previous call, and resets it.
+        Only available if the app is compiled with DEBUG_TRACE=1.
+
+        Returns
+        -------
+        dict
+            A dictionary with the "entries" of the trace, from the oldest; each entry is a dictionary with the
+            "tick" when it was recorded, the id of the "event", and its two "args", not decoded (see
+            dev-tools/debug_trace.py). The "dropped" entry is the number of events that were lost because the trace
+            was full, and "tick" is the tick when the trace was read.
+        """
+
+        return self._run_flow(self._get_debug_trace_flow())
+
+    def _get_debug_trace_flow(self) -> Flow[dict]:
+        result = {"entries": []}
+        while True:
+            sw, response = yield self.builder.get_debug_trace(len(result["entries"])), None
+
+            if sw != 0x9000:
+                raise DeviceException(error_code=sw, ins=BitcoinInsType.GET_DEBUG_TRACE)
+
+            count = response[0]
+            result["dropped"] = int.from_bytes(response[1:5], byteorder="big")
+            result["tick"] = int.from_bytes(response[5:7], byteorder="big")
+
+            for offset in range(7, len(response) - 10, 11):
+                result["entries"].append({
+                    "tick": int.from_bytes(response[offset:offset+2], byteorder="big"),
+                    "event": response[offset+2],
+                    "args": [int.from_bytes(response[offset+3:offset+7], byteorder="big"),
+                             int.from_bytes(response[offset+7:offset+11], byteorder="big")],
+                })
+
+            if len(result["entries"]) >= count:
+                return result
@@ -1,4 +1,5 @@
 import enum
+from hashlib import sha256
 from typing import List, Tuple, Mapping, Union, Iterator, Optional
 
 from bitcoin_client.common import bip32_path_from_string, AddressType, write_varint
@@ -32,10 +33,24 @@ class BitcoinInsType(enum.IntEnum):
     GET_WALLET_ADDRESS = 0x03
     SIGN_PSBT = 0x04
     GET_MASTER_FINGERPRINT = 0x05
+    GET_WALLET_ADDRESSES = 0x06
+    GET_ACCOUNT_XPUBS = 0x07
+    GET_EXTENDED_PUBKEYS = 0x08
+    REGISTER_WALLETS = 0x09
+    REGISTER_SPENDING_POLICY = 0x0A
+    SIGN_MESSAGE = 0x10
+    GET_DEBUG_TRACE = 0x7D
+    GET_PROCESSOR_TRACE = 0x7E
+    GET_APP_STATS = 0x7F
 
 
 class FrameworkInsType(enum.IntEnum):
     CONTINUE_INTERRUPTED = 0x01
+    BATCH = 0x02
+
+
+# Maximum length of the data of a BATCH command; it is 128 on the Nano S
+MAX_BATCH_DATA_LEN = 255
 
 
 class BitcoinCommandBuilder:
@@ -45,20 +60,32 @@ class BitcoinCommandBuilder:
     ----------
     debug: bool
         Whether you want to see logging or not.
+    latency: int
+        The latency of the client when responding to client commands, in units of 100 ms; sent in P2 of the
+        commands, so that the hardware wallet extends its interruption timeout accordingly.
 
     Attributes
     ----------
     debug: bool
         Whether you want to see logging or not.
+    latency: int
+        The latency declared in P2 of the commands.
 
     """
 
     CLA_BITCOIN: int = 0xE1
     CLA_FRAMEWORK: int = 0xF8
 
-    def __init__(self, debug: bool = False):
+    # P1 of CONTINUE when the response is followed by responses pushed in advance
+    CONTINUE_P1_PREFETCH: int = 0x01
+
+    def __init__(self, debug: bool = False, latency: int = 0):
         """Init constructor."""
+        if not 0 <= latency <= 255:
+            raise ValueError("The latency must be between 0 and 255")
+
         self.debug = debug
+        self.latency = latency
 
     def serialize(
         self,
@@ -79,7 +106,8 @@ class BitcoinCommandBuilder:
         p1 : int
             Instruction parameter 1: P1 (1 byte).
         p2 : int
-            Instruction parameter 2: P2 (1 byte).
+            Instruction parameter 2: P2 (1 byte). For the commands of the Bitcoin application, the declared
+            latency is used if it is 0.
         cdata : bytes
             Bytes of command data.
 
@@ -90,6 +118,9 @@ class BitcoinCommandBuilder:
 
         """
 
+        if cla == self.CLA_BITCOIN and p2 == 0:
+            p2 = self.latency
+
         return {"cla": cla, "ins": ins, "p1": p1, "p2": p2, "data": cdata}
 
     def get_extended_pubkey(self, bip32_path: List[int], display: bool = False):
@@ -107,13 +138,47 @@ class BitcoinCommandBuilder:
             cdata=cdata,
         )
 
-    def register_wallet(self, wallet: Wallet):
+    def register_wallet(self, wallet: Wallet, compiled: bool = False, store: bool = False):
         wallet_bytes = wallet.serialize()
+        flags = (1 if compiled else 0) | (2 if store else 0)
 
         return self.serialize(
             cla=self.CLA_BITCOIN,
             ins=BitcoinInsType.REGISTER_WALLET,
-            cdata=write_varint(len(wallet_bytes)) + wallet_bytes,
+            cdata=write_varint(len(wallet_bytes)) + wallet_bytes + (bytes([flags]) if flags != 0 else b''),
+        )
+
+    def register_wallets(self, wallets: List[Wallet], store: bool = False):
+        wallets_root = MerkleTree([element_hash(wallet.serialize()) for wallet in wallets]).root
+        flags = 2 if store else 0
+
+        return self.serialize(
+            cla=self.CLA_BITCOIN,
+            ins=BitcoinInsType.REGISTER_WALLETS,
+            cdata=write_varint(len(wallets)) + wallets_root + (bytes([flags]) if flags != 0 else b''),
+        )
+
+    def register_spending_policy(
+        self,
+        wallet: Wallet,
+        wallet_hmac: Optional[bytes],
+        max_tx_amount: int,
+        max_session_amount: int,
+        destinations: List[bytes],
+    ):
+        cdata: bytes = b"".join([
+            wallet.id,                                               # 32 bytes
+            wallet_hmac if wallet_hmac is not None else b'\0' * 32,  # 32 bytes
+            max_tx_amount.to_bytes(8, byteorder="little"),           # 8 bytes
+            max_session_amount.to_bytes(8, byteorder="little"),      # 8 bytes
+            write_varint(len(destinations)),
+            MerkleTree([element_hash(d) for d in destinations]).root,  # 32 bytes
+        ])
+
+        return self.serialize(
+            cla=self.CLA_BITCOIN,
+            ins=BitcoinInsType.REGISTER_SPENDING_POLICY,
+            cdata=cdata,
         )
 
     def get_wallet_address(
@@ -123,6 +188,7 @@ class BitcoinCommandBuilder:
         address_index: int,
         change: bool,
         display: bool,
+        compiled_policy: Optional[Tuple[bytes, bytes]] = None,
     ):
         cdata: bytes = b"".join(
             [
@@ -133,6 +199,9 @@ class BitcoinCommandBuilder:
                 address_index.to_bytes(4, byteorder="big"),             # 4 bytes
             ]
         )
+        if compiled_policy is not None:
+            compiled_policy_bytes, compiled_policy_hmac = compiled_policy
+            cdata += sha256(compiled_policy_bytes).digest() + compiled_policy_hmac  # 64 bytes
 
         return self.serialize(
             cla=self.CLA_BITCOIN,
@@ -140,6 +209,88 @@ class BitcoinCommandBuilder:
             cdata=cdata,
         )
 
+    def get_wallet_addresses(
+        self,
+        wallet: Wallet,
+        wallet_hmac: Optional[bytes],
+        change: bool,
+        start_index: int,
+        count: int,
+        script_pubkeys: bool,
+        compiled_policy: Optional[Tuple[bytes, bytes]] = None,
+    ):
+        cdata: bytes = b"".join(
+            [
+                b'\1' if script_pubkeys else b'\0',                     # 1 byte
+                wallet.id,                                              # 32 bytes
+                wallet_hmac if wallet_hmac is not None else b'\0' * 32, # 32 bytes
+                b"\1" if change else b"\0",                             # 1 byte
+                start_index.to_bytes(4, byteorder="big"),               # 4 bytes
+                count.to_bytes(4, byteorder="big"),                     # 4 bytes
+            ]
+        )
+        if compiled_policy is not None:
+            compiled_policy_bytes, compiled_policy_hmac = compiled_policy
+            cdata += sha256(compiled_policy_bytes).digest() + compiled_policy_hmac  # 64 bytes
+
+        return self.serialize(
+            cla=self.CLA_BITCOIN,
+            ins=BitcoinInsType.GET_WALLET_ADDRESSES,
+            cdata=cdata,
+        )
+
+    def get_extended_pubkeys(self, bip32_paths: List[str]):
+        cdata: bytes = b"".join(
+            [b'\0', len(bip32_paths).to_bytes(1, byteorder="big")]
+            + [len(steps).to_bytes(1, byteorder="big") + b"".join(steps)
+               for steps in map(bip32_path_from_string, bip32_paths)]
+        )
+
+        return self.serialize(
+            cla=self.CLA_BITCOIN,
+            ins=BitcoinInsType.GET_EXTENDED_PUBKEYS,
+            cdata=cdata,
+        )
+
+    def get_child_extended_pubkeys(self, base_path: str, first_child: int, count: int):
+        steps: List[bytes] = bip32_path_from_string(base_path)
+
+        cdata: bytes = b"".join([
+            b'\1',
+            len(steps).to_bytes(1, byteorder="big"),
+            *steps,
+            first_child.to_bytes(4, byteorder="big"),
+            count.to_bytes(1, byteorder="big"),
+        ])
+
+        return self.serialize(
+            cla=self.CLA_BITCOIN,
+            ins=BitcoinInsType.GET_EXTENDED_PUBKEYS,
+            cdata=cdata,
+        )
+
+    def get_account_xpubs(self):
+        return self.serialize(
+            cla=self.CLA_BITCOIN,
+            ins=BitcoinInsType.GET_ACCOUNT_XPUBS
+        )
+
+    def sign_message(self, message_length: int, message_merkle_root: bytes, bip32_path: str):
+        steps: List[bytes] = bip32_path_from_string(bip32_path)
+
+        cdata: bytes = b"".join([
+            len(steps).to_bytes(1, byteorder="big"),
+            *steps,
+            write_varint(message_length),
+            message_merkle_root,
+        ])
+
+        return self.serialize(
+            cla=self.CLA_BITCOIN,
+            ins=BitcoinInsType.SIGN_MESSAGE,
+            cdata=cdata,
+        )
+
     def sign_psbt(
         self,
         global_mapping: Mapping[bytes, bytes],
@@ -149,24 +300,55 @@ class BitcoinCommandBuilder:
         wallet_hmac: Optional[bytes],
     ):
 
+        return self.sign_psbt_commitments(
+            get_merkleized_map_commitment(global_mapping),
+            [get_merkleized_map_commitment(m_in) for m_in in input_mappings],
+            [get_merkleized_map_commitment(m_out) for m_out in output_mappings],
+            wallet,
+            wallet_hmac
+        )
+
+    def sign_psbt_commitments(
+        self,
+        global_commitment: bytes,
+        input_commitments: List[bytes],
+        output_commitments: List[bytes],
+        wallet: Wallet,
+        wallet_hmac: Optional[bytes],
+    ):
+        """Like sign_psbt, from the serialized Merkleized map commitments of the maps."""
+
+        return self.sign_psbt_roots(
+            global_commitment,
+            len(input_commitments),
+            MerkleTree([element_hash(c) for c in input_commitments]).root,
+            len(output_commitments),
+            MerkleTree([element_hash(c) for c in output_commitments]).root,
+            wallet,
+            wallet_hmac
+        )
+
+    def sign_psbt_roots(
+        self,
+        global_commitment: bytes,
+        n_inputs: int,
+        inputs_root: bytes,
+        n_outputs: int,
+        outputs_root: bytes,
+        wallet: Wallet,
+        wallet_hmac: Optional[bytes],
+    ):
+        """Like sign_psbt_commitments, from the Merkle roots of the lists of the commitments of the input and output
+        maps."""
+
         cdata = bytearray()
-        cdata += get_merkleized_map_commitment(global_mapping)
+        cdata += global_commitment
 
-        cdata += write_varint(len(input_mappings))
-        cdata += MerkleTree(
-            [
-                element_hash(get_merkleized_map_commitment(m_in))
-                for m_in in input_mappings
-            ]
-        ).root
+        cdata += write_varint(n_inputs)
+        cdata += inputs_root
 
-        cdata += write_varint(len(output_mappings))
-        cdata += MerkleTree(
-            [
-                element_hash(get_merkleized_map_commitment(m_out))
-                for m_out in output_mappings
-            ]
-        ).root
+        cdata += write_varint(n_outputs)
+        cdata += outputs_root
 
         cdata += wallet.id
         cdata += wallet_hmac if wallet_hmac is not None else b'\0' * 32
@@ -181,17 +363,81 @@ class BitcoinCommandBuilder:
             ins=BitcoinInsType.GET_MASTER_FINGERPRINT
         )
 
-    def continue_interrupted(self, cdata: bytes):
+    def get_app_stats(self):
+        return self.serialize(
+            cla=self.CLA_BITCOIN,
+            ins=BitcoinInsType.GET_APP_STATS
+        )
+
+    def get_processor_trace(self, start: int):
+        return self.serialize(
+            cla=self.CLA_BITCOIN,
+            ins=BitcoinInsType.GET_PROCESSOR_TRACE,
+            cdata=start.to_bytes(1, byteorder="big")
+        )
+
+    def get_debug_trace(self, start: int):
+        return self.serialize(
+            cla=self.CLA_BITCOIN,
+            ins=BitcoinInsType.GET_DEBUG_TRACE,
+            cdata=start.to_bytes(1, byteorder="big")
+        )
+
+    def batch(self, apdus: List[dict]):
+        """Command builder for BATCH.
+
+        Parameters
+        ----------
+        apdus : List[dict]
+            The commands of the batch, as returned by the other methods of the builder; their P1 must be 0, and their
+            P2 is not sent.
+
+        Returns
+        -------
+        bytes
+            APDU command for BATCH.
+
+        """
+        cdata = b""
+        for apdu in apdus:
+            if apdu["p1"] != 0:
+                raise ValueError("The commands of a batch can not use P1")
+            cdata += bytes([apdu["cla"], apdu["ins"], len(apdu["data"])]) + apdu["data"]
+
+        return self.serialize(
+            cla=self.CLA_FRAMEWORK,
+            ins=FrameworkInsType.BATCH,
+            p2=self.latency,
+            cdata=cdata,
+        )
+
+    def continue_interrupted(self, cdata: bytes, prefetched: Optional[bytes] = None):
         """Command builder for CONTINUE.
 
+        Parameters
+        ----------
+        cdata : bytes
+            The response to the client command.
+        prefetched : Optional[bytes]
+            If not None, the serialized responses pushed in advance after the response, as returned by
+            `ClientCommandInterpreter.get_prefetched_responses`.
+
         Returns
         -------
         bytes
             APDU command for CONTINUE.
 
         """
+        if prefetched is None:
+            return self.serialize(
+                cla=self.CLA_FRAMEWORK,
+                ins=FrameworkInsType.CONTINUE_INTERRUPTED,
+                cdata=cdata,
+            )
+
         return self.serialize(
             cla=self.CLA_FRAMEWORK,
             ins=FrameworkInsType.CONTINUE_INTERRUPTED,
-            cdata=cdata,
+            p1=self.CONTINUE_P1_PREFETCH,
+            cdata=len(cdata).to_bytes(1, byteorder="big") + cdata + prefetched,
         )
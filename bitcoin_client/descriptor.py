@@ -47,6 +47,7 @@ from enum import Enum
 from typing import (
     List,
     Optional,
+    Sequence,
     Tuple,
 )
 
@@ -149,6 +150,9 @@ class PubkeyProvider(object):
             # Not hex, maybe xpub
             self.extkey = ExtendedKey.deserialize(self.pubkey)
 
+        self._parent_key: Optional['ExtendedKey'] = None
+        self._is_ranged = False
+
     @classmethod
     def parse(cls, s: str) -> 'PubkeyProvider':
         """
@@ -187,18 +191,32 @@ class PubkeyProvider(object):
             s += self.deriv_path
         return s
 
+    def _get_parent_key(self) -> Tuple['ExtendedKey', bool]:
+        """
+        Returns the key derived from the extended key with the fixed steps of the derivation path, and whether the
+        path ends with a wildcard; the key is computed only once.
+        """
+        if self._parent_key is None:
+            path_str = self.deriv_path[1:] if self.deriv_path is not None else ""
+            self._is_ranged = path_str.endswith("*")
+            if self._is_ranged:
+                path_str = path_str[:-2] if path_str.endswith("/*") else path_str[:-1]
+            self._parent_key = self.extkey.derive_pub_path(parse_path(path_str))
+        return self._parent_key, self._is_ranged
+
     def get_pubkey_bytes(self, pos: int) -> bytes:
+        return self.get_pubkey_bytes_batch([pos])[0]
+
+    def get_pubkey_bytes_batch(self, positions: Sequence[int]) -> List[bytes]:
+        """
+        Returns the public keys at the given positions, deriving the non-ranged part of the path only once.
+        """
         if self.extkey is not None:
-            if self.deriv_path is not None:
-                path_str = self.deriv_path[1:]
-                if path_str[-1] == "*":
-                    path_str = path_str[:-1] + str(pos)
-                path = parse_path(path_str)
-                child_key = self.extkey.derive_pub_path(path)
-                return child_key.pubkey
-            else:
-                return self.extkey.pubkey
-        return unhexlify(self.pubkey)
+            parent_key, is_ranged = self._get_parent_key()
+            if is_ranged:
+                return [child_key.pubkey for child_key in parent_key.derive_pub_batch(positions)]
+            return [parent_key.pubkey] * len(positions)
+        return [unhexlify(self.pubkey)] * len(positions)
 
     def get_full_derivation_path(self, pos: int) -> str:
         """
@@ -280,6 +298,13 @@ class Descriptor(object):
         """
         Returns the scripts for a descriptor at the given `pos` for ranged descriptors.
         """
+        return self.expand_batch([pos])[0]
+
+    def expand_batch(self, positions: Sequence[int]) -> List["ExpandedScripts"]:
+        """
+        Returns the scripts for a descriptor at each of the given `positions`; the non-ranged part of the derivation
+        path of each key is only derived once.
+        """
         raise NotImplementedError("The Descriptor base class does not implement this method")
 
 
@@ -297,9 +322,9 @@ class PKHDescriptor(Descriptor):
         """
         super().__init__([pubkey], None, "pkh")
 
-    def expand(self, pos: int) -> "ExpandedScripts":
-        script = b"\x76\xa9\x14" + hash160(self.pubkeys[0].get_pubkey_bytes(pos)) + b"\x88\xac"
-        return ExpandedScripts(script, None, None)
+    def expand_batch(self, positions: Sequence[int]) -> List["ExpandedScripts"]:
+        return [ExpandedScripts(b"\x76\xa9\x14" + hash160(pubkey) + b"\x88\xac", None, None)
+                for pubkey in self.pubkeys[0].get_pubkey_bytes_batch(positions)]
 
 
 class WPKHDescriptor(Descriptor):
@@ -316,9 +341,9 @@ class WPKHDescriptor(Descriptor):
         """
         super().__init__([pubkey], None, "wpkh")
 
-    def expand(self, pos: int) -> "ExpandedScripts":
-        script = b"\x00\x14" + hash160(self.pubkeys[0].get_pubkey_bytes(pos))
-        return ExpandedScripts(script, None, None)
+    def expand_batch(self, positions: Sequence[int]) -> List["ExpandedScripts"]:
+        return [ExpandedScripts(b"\x00\x14" + hash160(pubkey), None, None)
+                for pubkey in self.pubkeys[0].get_pubkey_bytes_batch(positions)]
 
 
 class MultisigDescriptor(Descriptor):
@@ -346,21 +371,25 @@ class MultisigDescriptor(Descriptor):
     def to_string_no_checksum(self) -> str:
         return "{}({},{})".format(self.name, self.thresh, ",".join([p.to_string() for p in self.pubkeys]))
 
-    def expand(self, pos: int) -> "ExpandedScripts":
+    def expand_batch(self, positions: Sequence[int]) -> List["ExpandedScripts"]:
         if self.thresh > 16:
             m = b"\x01" + self.thresh.to_bytes(1, "big")
         else:
             m = (self.thresh + 0x50).to_bytes(1, "big") if self.thresh > 0 else b"\x00"
         n = (len(self.pubkeys) + 0x50).to_bytes(1, "big") if len(self.pubkeys) > 0 else b"\x00"
-        script: bytes = m
-        der_pks = [p.get_pubkey_bytes(pos) for p in self.pubkeys]
-        if self.is_sorted:
-            der_pks.sort()
-        for pk in der_pks:
-            script += len(pk).to_bytes(1, "big") + pk
-        script += n + b"\xae"
 
-        return ExpandedScripts(script, None, None)
+        result = []
+        # the pubkeys of each key at all the positions, then the pubkeys at each position
+        for der_pks in zip(*[p.get_pubkey_bytes_batch(positions) for p in self.pubkeys]):
+            der_pks = list(der_pks)
+            if self.is_sorted:
+                der_pks.sort()
+            script: bytes = m
+            for pk in der_pks:
+                script += len(pk).to_bytes(1, "big") + pk
+            script += n + b"\xae"
+            result.append(ExpandedScripts(script, None, None))
+        return result
 
 
 class SHDescriptor(Descriptor):
@@ -377,11 +406,10 @@ class SHDescriptor(Descriptor):
         """
         super().__init__([], subdescriptor, "sh")
 
-    def expand(self, pos: int) -> "ExpandedScripts":
+    def expand_batch(self, positions: Sequence[int]) -> List["ExpandedScripts"]:
         assert self.subdescriptor
-        redeem_script, _, witness_script = self.subdescriptor.expand(pos)
-        script = b"\xa9\x14" + hash160(redeem_script) + b"\x87"
-        return ExpandedScripts(script, redeem_script, witness_script)
+        return [ExpandedScripts(b"\xa9\x14" + hash160(redeem_script) + b"\x87", redeem_script, witness_script)
+                for redeem_script, _, witness_script in self.subdescriptor.expand_batch(positions)]
 
 
 class WSHDescriptor(Descriptor):
@@ -398,11 +426,10 @@ class WSHDescriptor(Descriptor):
         """
         super().__init__([], subdescriptor, "wsh")
 
-    def expand(self, pos: int) -> "ExpandedScripts":
+    def expand_batch(self, positions: Sequence[int]) -> List["ExpandedScripts"]:
         assert self.subdescriptor
-        witness_script, _, _ = self.subdescriptor.expand(pos)
-        script = b"\x00\x20" + sha256(witness_script)
-        return ExpandedScripts(script, None, witness_script)
+        return [ExpandedScripts(b"\x00\x20" + sha256(witness_script), None, witness_script)
+                for witness_script, _, _ in self.subdescriptor.expand_batch(positions)]
 
 
 class TRDescriptor(Descriptor):
@@ -419,11 +446,9 @@ class TRDescriptor(Descriptor):
         """
         super().__init__([pubkey], None, "tr")
 
-    def expand(self, pos: int) -> "ExpandedScripts":
-        internal_key = self.pubkeys[0].get_pubkey_bytes(pos)
-
-        script = b"\x51\x20" + get_taproot_output_key(internal_key)
-        return ExpandedScripts(script, None, None)
+    def expand_batch(self, positions: Sequence[int]) -> List["ExpandedScripts"]:
+        return [ExpandedScripts(b"\x51\x20" + get_taproot_output_key(internal_key), None, None)
+                for internal_key in self.pubkeys[0].get_pubkey_bytes_batch(positions)]
 
 
 def _get_func_expr(s: str) -> Tuple[str, str]:
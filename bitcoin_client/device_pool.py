@@ -0,0 +1,253 @@
+"""
+A pool of devices that run the commands of many clients, like a signing farm.
+
+Each device of the pool is a `BitcoinCommand` (with its own transport), with its master key fingerprint, read once
+when it is added; with `response_cache=True`, its xpubs are cached too. The hmacs of the registered wallet policies
+are kept for each fingerprint, as the hmac key is derived from the seed: devices with the same seed accept the same
+hmacs.
+
+The jobs are queued, and each one is run by the first idle device that can run it: a device can sign a PSBT, or
+get an address, with a wallet policy if one of the keys of the policy is derived from its seed, and if the policy is
+either a standard one, or registered for its fingerprint. `sign_psbt` splits the inputs of a PSBT in ranges across the
+devices with the same seed (with the `input_range` of `sign_prepared_psbt`), so that they sign it at the same
+time; the PSBT is prepared only once for all of them.
+
+The devices are not enumerated by the pool: each one is added with the `BitcoinCommand` of its transport.
+"""
+
+import threading
+
+from collections import deque
+from concurrent.futures import Future
+from typing import Callable, Deque, Dict, List, Mapping, Optional, Sequence, Tuple, TypeVar
+
+from bitcoin_client.command import BitcoinCommand
+from bitcoin_client.psbt import PSBT
+from bitcoin_client.quorum import _internal_key_origins, add_signatures
+from bitcoin_client.wallet import PolicyMapWallet
+
+T = TypeVar("T")
+
+
+def split_range(start: int, end: int, n_parts: int) -> List[Tuple[int, int]]:
+    """Splits [start, end) into at most n_parts consecutive non-empty ranges of (almost) the same length."""
+
+    n_parts = max(1, min(n_parts, end - start))
+    size, rest = divmod(end - start, n_parts)
+    ranges = []
+    for i in range(n_parts):
+        part_end = start + size + (1 if i < rest else 0)
+        ranges.append((start, part_end))
+        start = part_end
+    return ranges
+
+
+class PoolDevice:
+    """A device of a `DevicePool`: its command and its master key fingerprint."""
+
+    def __init__(self, cmd: BitcoinCommand) -> None:
+        self.cmd = cmd
+        self.fingerprint = cmd.get_master_fingerprint()
+        if cmd.response_cache:
+            cmd.warm_response_cache()
+
+    def holds_keys_of(self, wallet: PolicyMapWallet) -> bool:
+        """Returns True if some key of the wallet policy is derived from the seed of the device."""
+
+        return len(_internal_key_origins(wallet, self.fingerprint)) > 0
+
+
+class _Job:
+    def __init__(self, fn: Callable[[PoolDevice], object], can_run: Callable[[PoolDevice], bool]) -> None:
+        self.fn = fn
+        self.can_run = can_run
+        self.future: Future = Future()
+
+
+class DevicePool:
+    """A pool of devices, each one running the queued jobs in its own thread.
+
+    The pool must be closed with `close` (or used as a context manager): the jobs that no device can run are then
+    cancelled.
+    """
+
+    def __init__(self, commands: Sequence[BitcoinCommand] = ()) -> None:
+        self._cond = threading.Condition()
+        self._devices: List[PoolDevice] = []
+        self._threads: List[threading.Thread] = []
+        self._jobs: Deque[_Job] = deque()
+        self._wallet_hmacs: Dict[Tuple[bytes, bytes], bytes] = {}
+        self._closed = False
+
+        for cmd in commands:
+            self.add_device(cmd)
+
+    def __enter__(self) -> "DevicePool":
+        return self
+
+    def __exit__(self, *args) -> None:
+        self.close()
+
+    @property
+    def devices(self) -> List[PoolDevice]:
+        with self._cond:
+            return list(self._devices)
+
+    def add_device(self, cmd: BitcoinCommand) -> PoolDevice:
+        """Adds a device to the pool, reading its master key fingerprint; it starts running the queued jobs."""
+
+        device = PoolDevice(cmd)
+        thread = threading.Thread(target=self._run_device, args=(device,), daemon=True)
+        with self._cond:
+            if self._closed:
+                raise RuntimeError("The pool is closed")
+            self._devices.append(device)
+            self._threads.append(thread)
+            self._cond.notify_all()
+        thread.start()
+        return device
+
+    def add_wallet(self, wallet: PolicyMapWallet, fingerprint: bytes, wallet_hmac: bytes) -> None:
+        """Adds the hmac returned by `register_wallet` on a device with the given master key fingerprint; all the
+        devices with the same seed can then use the wallet policy."""
+
+        with self._cond:
+            self._wallet_hmacs[(fingerprint, wallet.id)] = wallet_hmac
+            self._cond.notify_all()
+
+    def get_wallet_hmac(self, wallet: PolicyMapWallet, fingerprint: bytes) -> Optional[bytes]:
+        """Returns the hmac of the wallet policy for the given fingerprint, or None if it was not added."""
+
+        with self._cond:
+            return self._wallet_hmacs.get((fingerprint, wallet.id))
+
+    def can_use_wallet(self, device: PoolDevice, wallet: PolicyMapWallet) -> bool:
+        """Returns True if the device holds a key of the wallet policy, and the policy is standard (it has no name)
+        or registered for the fingerprint of the device."""
+
+        return device.holds_keys_of(wallet) and (
+            wallet.name == "" or self.get_wallet_hmac(wallet, device.fingerprint) is not None)
+
+    def submit(self, fn: Callable[[PoolDevice], T],
+               can_run: Callable[[PoolDevice], bool] = lambda device: True) -> "Future[T]":
+        """Queues a job, that is run as fn(device) by the first idle device for which can_run(device) is True.
+        Returns the future of its result."""
+
+        job = _Job(fn, can_run)
+        with self._cond:
+            if self._closed:
+                raise RuntimeError("The pool is closed")
+            self._jobs.append(job)
+            self._cond.notify_all()
+        return job.future
+
+    def get_wallet_address(self, wallet: PolicyMapWallet, change: int, address_index: int,
+                           display: bool = False) -> "Future[str]":
+        """Queues `BitcoinCommand.get_wallet_address` on a device that can use the wallet policy."""
+
+        def run(device: PoolDevice) -> str:
+            wallet_hmac = self.get_wallet_hmac(wallet, device.fingerprint)
+            return device.cmd.get_wallet_address(wallet, wallet_hmac, change, address_index, display)
+
+        return self.submit(run, lambda device: self.can_use_wallet(device, wallet))
+
+    def sign_psbt(self, psbt: PSBT, wallet: PolicyMapWallet,
+                  max_devices_per_seed: Optional[int] = None) -> "Future[Mapping[bytes, Mapping[int, List[bytes]]]]":
+        """Queues the signing of psbt by each seed of the pool that holds keys of the wallet policy, and merges the
+        signatures into psbt once all of them are signed.
+
+        The inputs are split in ranges across the devices with the same seed that are in the pool when the job is
+        submitted (at most `max_devices_per_seed` of them), and each range is signed by one of them; each device
+        still shows the whole transaction to its user.
+
+        Returns
+        -------
+        Future[Mapping[bytes, Mapping[int, List[bytes]]]]
+            The future of the signatures of each fingerprint, as for `sign_psbt_with_devices`.
+        """
+
+        if len(psbt.inputs) == 0:
+            raise ValueError("The psbt has no inputs")
+
+        devices = [d for d in self.devices if self.can_use_wallet(d, wallet)]
+        if len(devices) == 0:
+            raise ValueError("No device of the pool can sign with this wallet policy")
+
+        n_devices: Dict[bytes, int] = {}
+        for device in devices:
+            n_devices[device.fingerprint] = n_devices.get(device.fingerprint, 0) + 1
+
+        prepared = devices[0].cmd.prepare_psbt(psbt, wallet)
+
+        parts: List[Tuple[bytes, "Future[Mapping[int, List[bytes]]]"]] = []
+        for fingerprint, count in n_devices.items():
+            if max_devices_per_seed is not None:
+                count = min(count, max_devices_per_seed)
+            for input_range in split_range(0, len(psbt.inputs), count):
+                def run(device: PoolDevice, input_range=input_range) -> Mapping[int, List[bytes]]:
+                    wallet_hmac = self.get_wallet_hmac(wallet, device.fingerprint)
+                    return device.cmd.sign_prepared_psbt(prepared, wallet_hmac, input_range=input_range)
+
+                def can_run(device: PoolDevice, fingerprint=fingerprint) -> bool:
+                    return device.fingerprint == fingerprint
+
+                parts.append((fingerprint, self.submit(run, can_run)))
+
+        result: Future = Future()
+        remaining = [len(parts)]
+        lock = threading.Lock()
+
+        def on_part_done(_: Future) -> None:
+            with lock:
+                remaining[0] -= 1
+                if remaining[0] > 0:
+                    return
+            try:
+                signatures: Dict[bytes, Dict[int, List[bytes]]] = {}
+                for fingerprint, part in parts:
+                    signatures.setdefault(fingerprint, {}).update(part.result())
+                for fingerprint, sigs in signatures.items():
+                    add_signatures(psbt, wallet, fingerprint, sigs)
+                result.set_result(signatures)
+            except BaseException as e:
+                result.set_exception(e)
+
+        for _, part in parts:
+            part.add_done_callback(on_part_done)
+        return result
+
+    def close(self) -> None:
+        """Waits for the jobs that some device can run, cancels the others, and stops the threads of the devices."""
+
+        with self._cond:
+            self._closed = True
+            self._cond.notify_all()
+        for thread in self._threads:
+            thread.join()
+        with self._cond:
+            while self._jobs:
+                self._jobs.popleft().future.cancel()
+
+    def _take_job(self, device: PoolDevice) -> Optional[_Job]:
+        for job in self._jobs:
+            if job.can_run(device):
+                self._jobs.remove(job)
+                return job
+        return None
+
+    def _run_device(self, device: PoolDevice) -> None:
+        while True:
+            with self._cond:
+                job = self._take_job(device)
+                while job is None:
+                    if self._closed:
+                        return
+                    self._cond.wait()
+                    job = self._take_job(device)
+
+            if not job.future.set_running_or_notify_cancel():
+                continue
+            try:
+                job.future.set_result(job.fn(device))
+            except BaseException as e:
+                job.future.set_exception(e)
@@ -18,6 +18,8 @@ from .common import (
     hash160,
 )
 from .errors import BadArgumentError
+from . import secp256k1
+from .secp256k1 import G, n, p, point_add, point_mul  # noqa: F401 (part of the interface of this module)
 
 import binascii
 import hmac
@@ -34,10 +36,6 @@ from typing import (
 
 HARDENED_FLAG = 1 << 31
 
-p = 0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC2F
-n = 0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141
-G = (0x79BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798, 0x483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8)
-
 Point = Optional[Tuple[int, int]]
 
 def H_(x: int) -> int:
@@ -53,30 +51,6 @@ def is_hardened(i: int) -> bool:
     return i & HARDENED_FLAG != 0
 
 
-def point_add(p1: Point, p2: Point) -> Point:
-    if (p1 is None):
-        return p2
-    if (p2 is None):
-        return p1
-    if (p1[0] == p2[0] and p1[1] != p2[1]):
-        return None
-    if (p1 == p2):
-        lam = (3 * p1[0] * p1[0] * pow(2 * p1[1], p - 2, p)) % p
-    else:
-        lam = ((p2[1] - p1[1]) * pow(p2[0] - p1[0], p - 2, p)) % p
-    x3 = (lam * lam - p1[0] - p2[0]) % p
-    return (x3, (lam * (p1[0] - x3) - p1[1]) % p)
-
-
-def point_mul(p: Point, n: int) -> Point:
-    r = None
-    for i in range(256):
-        if ((n >> i) & 1):
-            r = point_add(r, p)
-        p = point_add(p, p)
-    return r
-
-
 def deserialize_point(b: bytes) -> Point:
     x = int.from_bytes(b[1:], byteorder="big")
     y = pow((x * x * x + 7) % p, (p + 1) // 4, p)
@@ -118,8 +92,7 @@ def taproot_tweak_pubkey(pubkey: bytes, h: bytes) -> Tuple[int, bytes]:
     t = int_from_bytes(tagged_hash("TapTweak", pubkey + h))
     if t >= p:
         raise ValueError
-    Q = point_add(lift_x(int_from_bytes(pubkey)), point_mul(G, t))
-    return 0 if Q[1] & 1 == 0 else 1, Q[0].to_bytes(32, byteorder="big")
+    return secp256k1.xonly_tweak_add(pubkey, t.to_bytes(32, byteorder="big"))
 
 
 def get_taproot_output_key(derived_key: bytes) -> bytes:
@@ -181,7 +154,7 @@ class ExtendedKey(object):
 
         if is_private:
             privkey = data[46:]
-            pubkey = point_to_bytes(point_mul(G, int.from_bytes(privkey, byteorder="big")))
+            pubkey = secp256k1.pubkey_create(privkey)
             return cls(version, depth, parent_fingerprint, child_num, chaincode, privkey, pubkey)
         else:
             pubkey = data[45:78]
@@ -262,7 +235,7 @@ class ExtendedKey(object):
             return None
 
         privkey = k_int.to_bytes(32, byteorder="big")
-        pubkey = point_to_bytes(point_mul(G, k_int))
+        pubkey = secp256k1.pubkey_create(privkey)
 
         chaincode = Ir
         fingerprint = hash160(self.pubkey)[0:4]
@@ -286,15 +259,36 @@ class ExtendedKey(object):
         Ir = Ihmac[32:]
 
         # Construct curve point Il*G+K
-        Il_int = int(binascii.hexlify(Il), 16)
-        child_pubkey = point_add(point_mul(G, Il_int), bytes_to_point(self.pubkey))
+        pubkey = secp256k1.pubkey_tweak_add(self.pubkey, Il)
 
         # Construct and return a new BIP32Key
-        pubkey = point_to_bytes(child_pubkey)
         chaincode = Ir
         fingerprint = hash160(self.pubkey)[0:4]
         return ExtendedKey(ExtendedKey.TESTNET_PUBLIC if self.is_testnet else ExtendedKey.MAINNET_PUBLIC, self.depth + 1, fingerprint, i, chaincode, None, pubkey)
 
+    def derive_pub_batch(self, indexes: Sequence[int]) -> List['ExtendedKey']:
+        """
+        Derive the public keys at the given child indexes; the same as calling :meth:`derive_pub` for each index,
+        without transforming the parent key again for each child.
+
+        :param indexes: The child indexes of the pubkeys to derive
+        """
+        if any(is_hardened(i) for i in indexes):
+            raise ValueError("Index cannot be larger than 2^31")
+
+        version = ExtendedKey.TESTNET_PUBLIC if self.is_testnet else ExtendedKey.MAINNET_PUBLIC
+        fingerprint = hash160(self.pubkey)[0:4]
+        mac = hmac.new(self.chaincode, self.pubkey, hashlib.sha512)
+
+        result = []
+        for i in indexes:
+            h = mac.copy()
+            h.update(struct.pack(">L", i))
+            Ihmac = h.digest()
+            pubkey = secp256k1.pubkey_tweak_add(self.pubkey, Ihmac[:32])
+            result.append(ExtendedKey(version, self.depth + 1, fingerprint, i, Ihmac[32:], None, pubkey))
+        return result
+
     def derive_priv_path(self, path: Sequence[int]) -> 'ExtendedKey':
         """
         Derive the private key at the given path
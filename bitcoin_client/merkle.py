@@ -1,9 +1,15 @@
-from typing import List, Iterable, Mapping
+from concurrent.futures import Executor
+from hashlib import sha256 as _sha256
+from typing import Dict, List, Iterable, Mapping, Optional, Tuple
 
 from .common import write_varint, sha256
 
 NIL = bytes([0] * 32)
 
+# Minimum number of elements for hashing in parallel, when an executor is given, and number of hashes per task
+PARALLEL_MIN_ELEMENTS = 1024
+PARALLEL_CHUNK_SIZE = 256
+
 
 def floor_lg(n: int) -> int:
     """Return floor(log_2(n)) for a positive integer `n`"""
@@ -63,51 +69,42 @@ def combine_hashes(left: bytes, right: bytes) -> bytes:
     return sha256(b'\x01' + left + right)
 
 
-# root is the only node with parent == None
-# leaves have left == right == None
-class Node:
-    def __init__(self, left, right, parent, value: bytes):
-        self.left = left
-        self.right = right
-        self.parent = parent
-        self.value = value
-
-    def recompute_value(self):
-        assert self.left is not None
-        assert self.right is not None
-        self.value = combine_hashes(self.left.value, self.right.value)
-
-    def sibling(self):
-        if self.parent is None:
-            raise IndexError("The root does not have a sibling.")
-
-        if self.parent.left == self:
-            return self.parent.right
-        elif self.parent.right == self:
-            return self.parent.left
-        else:
-            raise IndexError("Invalid state: not a child of his parent.")
+def element_hashes(elements: Iterable[bytes], executor: Optional[Executor] = None) -> List[bytes]:
+    """Computes the hashes of a list of elements to be stored in a Merkle tree.
 
+    If an `executor` is given and there are at least `PARALLEL_MIN_ELEMENTS` elements, the hashes are computed
+    in parallel. Since hashlib only releases the GIL for long inputs, a thread pool is only useful for large
+    elements (like the serialization of non-witness UTXOs)."""
 
-def make_tree(leaves: List[Node], begin: int, size: int) -> Node:
-    """Given a list of nodes, builds the left-complete Merkle tree on top of it.
-    The nodes in `leaves` are modified by setting their `parent` field appropriately.
-    It returns the root of the newly built tree.
-    """
+    elements = list(elements)
+    if executor is None or len(elements) < PARALLEL_MIN_ELEMENTS:
+        return [element_hash(el) for el in elements]
+    return list(executor.map(element_hash, elements, chunksize=PARALLEL_CHUNK_SIZE))
+
+
+def _hash_pairs(level: List[bytes], begin: int, end: int) -> List[bytes]:
+    """Returns the list of the hashes of the pairs (level[i], level[i + 1]), for i = begin, begin + 2, ..., end - 2."""
 
-    if size == 0:
-        return []
-    if size == 1:
-        return leaves[begin]
+    return [_sha256(b'\x01' + level[i] + level[i + 1]).digest() for i in range(begin, end, 2)]
 
-    lchild_size = largest_power_of_2_less_than(size)
 
-    lchild = make_tree(leaves, begin, lchild_size)
-    rchild = make_tree(leaves, begin + lchild_size, size - lchild_size)
-    root = Node(lchild, rchild, None, None)
-    root.recompute_value()
-    lchild.parent = rchild.parent = root
-    return root
+def _next_level(level: List[bytes], executor: Optional[Executor] = None) -> List[bytes]:
+    """Given the values of the nodes at one level of the tree, computes the values of the nodes at the next level.
+    Each pair of consecutive nodes is combined; if the number of nodes is odd, the last one is moved up unchanged."""
+
+    n_pairs_end = len(level) - len(level) % 2
+
+    if executor is None or len(level) < PARALLEL_MIN_ELEMENTS:
+        result = _hash_pairs(level, 0, n_pairs_end)
+    else:
+        step = 2 * PARALLEL_CHUNK_SIZE
+        chunks = executor.map(lambda begin: _hash_pairs(level, begin, min(begin + step, n_pairs_end)),
+                              range(0, n_pairs_end, step))
+        result = [h for chunk in chunks for h in chunk]
+
+    if len(level) % 2 == 1:
+        result.append(level[-1])
+    return result
 
 
 class MerkleTree:
@@ -125,30 +122,44 @@ class MerkleTree:
     - There are always n - 1 internal nodes; all the internal nodes have exactly two children.
     - If a subtree has n > 1 leaves, then the left subchild is a complete subtree with p leaves, where p is the largest
       power of 2 smaller than n.
+
+    The tree is stored level by level: `levels[0]` is the list of leaves, and `levels[k][i]` is the value of the
+    node at height k that is the ancestor of the leaves with index from i * 2^k to (i + 1) * 2^k - 1. If a level has
+    an odd number of nodes, the last one has no sibling, and it is moved up unchanged to the next level; this gives
+    exactly the shape described above, with no node stored for the internal nodes that would have a single child.
     """
 
-    def __init__(self, elements: Iterable[bytes] = []):
-        self.leaves = [Node(None, None, None, el) for el in elements]
-        n_elements = len(self.leaves)
-        if n_elements > 0:
-            self.root_node = make_tree(self.leaves, 0, n_elements)
-            self.depth = ceil_lg(n_elements)
-        else:
-            self.root_node = None
-            self.depth = None
+    def __init__(self, elements: Iterable[bytes] = [], executor: Optional[Executor] = None):
+        """Builds the tree on top of the leaf hashes in `elements`. If an `executor` is given, it is used to hash
+        the levels of the tree in parallel when they are large enough."""
+
+        self.levels: List[List[bytes]] = [list(elements)]
+        while len(self.levels[-1]) > 1:
+            self.levels.append(_next_level(self.levels[-1], executor))
+
+        # lookup tables computed by `precompute`, and discarded whenever the tree changes
+        self._leaf_indexes: Optional[Dict[bytes, int]] = None
+        self._proofs: Optional[List[Tuple[bytes, ...]]] = None
 
     def __len__(self) -> int:
         """Return the total number of leaves in the tree."""
-        return len(self.leaves)
+        return len(self.levels[0])
+
+    @property
+    def depth(self) -> Optional[int]:
+        """Return the depth of the tree, or None if the tree is empty."""
+        return None if len(self) == 0 else len(self.levels) - 1
 
     @property
     def root(self) -> bytes:
         """Return the Merkle root, or None if the tree is empty."""
-        return NIL if self.root_node is None else self.root_node.value
+        return NIL if len(self) == 0 else self.levels[-1][0]
 
     def copy(self):
         """Return an identical copy of this Merkle tree."""
-        return MerkleTree([leaf.value for leaf in self.leaves])
+        mt = MerkleTree()
+        mt.levels = [list(level) for level in self.levels]
+        return mt
 
     def add(self, x: bytes) -> None:
         """Add an element as new leaf, and recompute the tree accordingly. Cost O(log n)."""
@@ -156,41 +167,8 @@ class MerkleTree:
         if len(x) != 32:
             raise ValueError("Inserted elements must be exactly 32 bytes long")
 
-        new_leaf = Node(None, None, None, x)
-        self.leaves.append(new_leaf)
-        if len(self.leaves) == 1:
-            self.root_node = new_leaf
-            self.depth = 0
-            return
-
-        # add a new leaf
-        if self.depth == 0:
-            ltree_size = 0
-        else:
-            # number of leaves of the left subtree of cur_root
-            ltree_size = 1 << (self.depth - 1)
-
-        cur_root = self.root_node
-        cur_root_size = len(self.leaves) - 1
-
-        while not is_power_of_2(cur_root_size):
-            cur_root = cur_root.right
-            cur_root_size -= ltree_size
-            ltree_size /= 2
-
-        # node value will be computed later
-        new_node = Node(cur_root, new_leaf, cur_root.parent, None)
-        if cur_root.parent is None:
-            # replacing the root
-            self.depth += 1
-            self.root_node = new_node
-        else:
-            assert cur_root.parent.right == cur_root
-            cur_root.parent.right = new_node
-        cur_root.parent = new_node
-        new_leaf.parent = new_node
-
-        self.fix_up(new_node)
+        self.levels[0].append(x)
+        self._fix_up(len(self) - 1)
 
     def set(self, index: int, x: bytes) -> None:
         """
@@ -199,55 +177,138 @@ class MerkleTree:
 
         Cost: Worst case O(log n).
         """
-        assert 0 <= index <= len(self.leaves)
+        assert 0 <= index <= len(self)
 
-        if not (0 <= index <= len(self.leaves)):
+        if not (0 <= index <= len(self)):
             raise ValueError(
                 "The index must be at least 0, and at most the current number of leaves.")
 
         if len(x) != 32:
             raise ValueError("Inserted elements must be exactly 32 bytes long.")
 
-        if index == len(self.leaves):
+        if index == len(self):
             self.add(x)
         else:
-            self.leaves[index].value = x
-            self.fix_up(self.leaves[index].parent)
-
-    def fix_up(self, node: Node):
-        while node is not None:
-            node.recompute_value()
-            node = node.parent
+            self.levels[0][index] = x
+            self._fix_up(index)
+
+    def _fix_up(self, index: int) -> None:
+        """Recomputes the values of all the ancestors of the leaf with the given index, adding new nodes (and new
+        levels) if the leaf was just appended."""
+
+        self._leaf_indexes = None
+        self._proofs = None
+
+        height = 0
+        while len(self.levels[height]) > 1:
+            level = self.levels[height]
+            if height + 1 == len(self.levels):
+                self.levels.append([])
+            parent_level = self.levels[height + 1]
+
+            parent_index = index // 2
+            left = level[2 * parent_index]
+            if 2 * parent_index + 1 < len(level):
+                value = combine_hashes(left, level[2 * parent_index + 1])
+            else:
+                value = left  # no sibling, the node is moved up unchanged
+
+            if parent_index == len(parent_level):
+                parent_level.append(value)
+            else:
+                parent_level[parent_index] = value
+
+            index = parent_index
+            height += 1
 
     def get(self, i: int) -> bytes:
         """Return the value of the leaf with index `i`, where 0 <= i < len(self)."""
-        return self.leaves[i].value
+        return self.levels[0][i]
+
+    def intern_nodes(self, nodes: Dict[bytes, bytes]) -> None:
+        """Replaces each node of the tree by the equal node in `nodes` if any, and adds the others to it, so that the
+        trees interned with the same `nodes` share the memory of their identical nodes. Cost O(n)."""
+
+        for level in self.levels:
+            for i, x in enumerate(level):
+                level[i] = nodes.setdefault(x, x)
+
+    def precompute(self) -> None:
+        """Precompute the index of each leaf hash and the Merkle proof of each leaf, so that `leaf_index` and
+        `prove_leaf` take constant time until the tree is modified. Cost O(n log n).
+
+        The tables are only used once both are complete, so the tree can be read by another thread while they are
+        computed (but it must not be modified)."""
+
+        leaf_indexes: Dict[bytes, int] = {}
+        for i, x in enumerate(self.levels[0]):
+            leaf_indexes.setdefault(x, i)  # keep the first index, if a leaf is repeated
+
+        # the proof of a node is its sibling (if any), followed by the proof of its parent
+        proofs: List[Tuple[bytes, ...]] = [()]
+        for level in reversed(self.levels[:-1]):
+            proofs = [
+                ((level[i ^ 1],) if i ^ 1 < len(level) else ()) + proofs[i // 2]
+                for i in range(len(level))
+            ]
+        self._leaf_indexes = leaf_indexes
+        self._proofs = proofs
+
+    @property
+    def is_precomputed(self) -> bool:
+        """True if `precompute` was called, and the tree was not modified since."""
+        return self._proofs is not None
 
     def leaf_index(self, x: bytes) -> int:
         """Return the index of the leaf with hash `x`. Raises `ValueError` if not found."""
-        idx = 0
-        while idx < len(self):
-            if self.leaves[idx].value == x:
-                return idx
-            idx += 1
-        raise ValueError("Leaf not found")
+        if self._leaf_indexes is not None:
+            if x not in self._leaf_indexes:
+                raise ValueError("Leaf not found")
+            return self._leaf_indexes[x]
+
+        try:
+            return self.levels[0].index(x)
+        except ValueError:
+            raise ValueError("Leaf not found")
+
+    def _prove_node(self, height: int, index: int) -> List[bytes]:
+        """Produce the Merkle proof of membership for the node at the given height and index."""
+        proof = []
+        while height < len(self.levels) - 1:
+            sibling_index = index ^ 1
+            if sibling_index < len(self.levels[height]):
+                proof.append(self.levels[height][sibling_index])
+            index //= 2
+            height += 1
+        return proof
 
     def prove_leaf(self, index: int) -> List[bytes]:
         """Produce the Merkle proof of membership for the leaf with the given index where 0 <= index < len(self)."""
-        node = self.leaves[index]
-        proof = []
-        while node.parent is not None:
-            sibling = node.sibling()
-            assert sibling is not None
+        if not (0 <= index < len(self)):
+            raise IndexError("Leaf index out of range.")
 
-            proof.append(sibling.value)
+        if self._proofs is not None:
+            return list(self._proofs[index])
 
-            node = node.parent
+        return self._prove_node(0, index)
 
-        return proof
+    def prove_leaves(self, first_index: int, n_leaves: int) -> List[bytes]:
+        """Produce the Merkle proof of membership for the subtree containing the leaves with indexes from `first_index`
+        to `first_index + n_leaves - 1` (or `len(self) - 1`, if smaller). `n_leaves` must be a power of 2, and
+        `first_index` a multiple of `n_leaves`, so that the range of leaves is exactly the set of leaves of a subtree."""
+
+        if not is_power_of_2(n_leaves) or first_index % n_leaves != 0 or not (0 <= first_index < len(self)):
+            raise ValueError("Invalid range of leaves.")
+
+        # the node at height log2(n_leaves) is the root of the subtree; if the range is truncated by the end of the
+        # vector, it is the lowest ancestor containing all the remaining leaves, moved up unchanged
+        height = min(floor_lg(n_leaves), len(self.levels) - 1)
+        index = first_index >> height
+
+        return self._prove_node(height, index)
 
 
-def get_merkleized_map_commitment(mapping: Mapping[bytes, bytes]) -> bytes:
+def get_merkleized_map_commitment(mapping: Mapping[bytes, bytes], executor: Optional[Executor] = None) -> bytes:
     """Returns a serialized Merkleized map commitment, encoded as the concatenation of:
        - the number of key/value pairs, as a Bitcoin-style varint;
        - the root of the Merkle tree of the keys
@@ -255,6 +316,6 @@ def get_merkleized_map_commitment(mapping: Mapping[bytes, bytes]) -> bytes:
     """
 
     items_sorted = list(sorted(mapping.items()))
-    keys_hashes = [element_hash(i[0]) for i in items_sorted]
-    values_hashes = [element_hash(i[1]) for i in items_sorted]
-    return write_varint(len(mapping)) + MerkleTree(keys_hashes).root + MerkleTree(values_hashes).root
+    keys_hashes = element_hashes((i[0] for i in items_sorted), executor)
+    values_hashes = element_hashes((i[1] for i in items_sorted), executor)
+    return write_varint(len(mapping)) + MerkleTree(keys_hashes, executor).root + MerkleTree(values_hashes, executor).root
@@ -0,0 +1,186 @@
+"""
+Binding of the native client command interpreter of host-lib/ (see host-lib/README.md), that answers the client
+commands of the hardware wallet with the Merkle tree and serialization code of the app, compiled for the host.
+
+The library is loaded from the path in the BITCOIN_HOST_LIB environment variable if set, otherwise from the build
+directory host-lib/build of the repository.
+"""
+
+import ctypes
+import os
+import threading
+
+from pathlib import Path
+from typing import List, Mapping, Optional, Sequence, Tuple
+
+from .client_command import MAX_RESPONSE_SIZE
+from .wallet import PolicyMapWallet
+
+LIBRARY_PATH_ENV = "BITCOIN_HOST_LIB"
+DEFAULT_LIBRARY_PATH = Path(__file__).resolve().parent.parent / "host-lib" / "build" / "libbitcoin_host.so"
+
+# Maximum length of the commitment of a Merkleized map, as HOST_MAX_MAP_COMMITMENT_SIZE
+MAX_MAP_COMMITMENT_SIZE = 9 + 2 * 32
+
+# host_error_e
+HOST_ERR_INVALID_REQUEST = -1
+HOST_ERR_UNKNOWN_DATA = -2
+HOST_ERR_INVALID_STATE = -3
+HOST_ERR_NO_MEMORY = -4
+
+# The library hashes the Merkle trees in a single global context: only one call can run at a time in the process.
+_lock = threading.Lock()
+_library: Optional[ctypes.CDLL] = None
+
+
+def library_path() -> Path:
+    return Path(os.environ.get(LIBRARY_PATH_ENV, DEFAULT_LIBRARY_PATH))
+
+
+def is_available() -> bool:
+    """Returns True if the native library can be loaded."""
+    try:
+        _load_library()
+        return True
+    except OSError:
+        return False
+
+
+def _load_library() -> ctypes.CDLL:
+    global _library
+
+    if _library is None:
+        lib = ctypes.CDLL(str(library_path()))
+
+        ptr, size_t, u8p = ctypes.c_void_p, ctypes.c_size_t, ctypes.c_char_p
+        size_tp = ctypes.POINTER(ctypes.c_size_t)
+        signatures = {
+            "host_interpreter_new": (ptr, []),
+            "host_interpreter_free": (None, [ptr]),
+            "host_interpreter_reset": (None, [ptr]),
+            "host_interpreter_add_known_preimage": (ctypes.c_int, [ptr, u8p, size_t]),
+            "host_interpreter_add_known_list": (ctypes.c_int, [ptr, u8p, size_tp, size_t, u8p]),
+            "host_interpreter_add_known_mapping": (ctypes.c_int, [ptr, u8p, size_tp, u8p, size_tp, size_t, u8p]),
+            "host_interpreter_add_known_wallet": (ctypes.c_int, [ptr, u8p, size_t, u8p, size_tp, size_t]),
+            "host_interpreter_execute": (ctypes.c_int, [ptr, u8p, size_t, u8p]),
+            "host_interpreter_get_prefetched_responses": (size_t, [ptr, u8p, size_t, u8p, size_t]),
+            "host_interpreter_n_yielded": (size_t, [ptr]),
+            "host_interpreter_get_yielded": (ctypes.POINTER(ctypes.c_uint8), [ptr, size_t, size_tp]),
+        }
+        for name, (restype, argtypes) in signatures.items():
+            fn = getattr(lib, name)
+            fn.restype = restype
+            fn.argtypes = argtypes
+
+        _library = lib
+    return _library
+
+
+def _check(ret: int) -> int:
+    """Raises the exception of ClientCommandInterpreter for a negative host_error_e, or returns ret."""
+    if ret == HOST_ERR_NO_MEMORY:
+        raise MemoryError("Out of memory in the native client command interpreter.")
+    elif ret == HOST_ERR_INVALID_STATE:
+        raise RuntimeError("Unexpected client command in this state of the execution.")
+    elif ret < 0:
+        raise ValueError(f"Invalid client command, or unknown data (error {ret}).")
+    return ret
+
+
+def _concat(elements: Sequence[bytes]) -> Tuple[bytes, ctypes.Array]:
+    """Returns the concatenation of the elements, and the array of their lengths."""
+    return b"".join(elements), (ctypes.c_size_t * max(1, len(elements)))(*[len(el) for el in elements])
+
+
+class NativeClientCommandInterpreter:
+    """Client command interpreter implemented by the native library, with the same responses as
+    `ClientCommandInterpreter`; the known data is kept by the library, so the preimages and the Merkle trees can not
+    be shared with the Python objects (`MerkleTree`, `PreimageStore`, `PreparedWallet`).
+
+    Unlike `ClientCommandInterpreter.add_known_list`, `add_known_list` returns the Merkle root of the list instead of
+    its tree; like `ClientCommandInterpreter.add_known_mapping`, `add_known_mapping` returns the commitment of the
+    map.
+    """
+
+    def __init__(self) -> None:
+        self._lib = _load_library()
+        with _lock:
+            self._handle = self._lib.host_interpreter_new()
+        if not self._handle:
+            raise MemoryError("Out of memory in the native client command interpreter.")
+
+    def __del__(self) -> None:
+        handle = getattr(self, "_handle", None)
+        if handle:
+            with _lock:
+                self._lib.host_interpreter_free(handle)
+            self._handle = None
+
+    @property
+    def yielded(self) -> List[bytes]:
+        """The values sent by the hardware wallet with YIELD since the last reset."""
+        with _lock:
+            result = []
+            for i in range(self._lib.host_interpreter_n_yielded(self._handle)):
+                length = ctypes.c_size_t()
+                data = self._lib.host_interpreter_get_yielded(self._handle, i, ctypes.byref(length))
+                result.append(ctypes.string_at(data, length.value))
+            return result
+
+    def reset(self) -> None:
+        """Clears the state of an execution (the yielded values and the queue), keeping the known data."""
+        with _lock:
+            self._lib.host_interpreter_reset(self._handle)
+
+    def add_known_preimage(self, element: bytes) -> None:
+        with _lock:
+            _check(self._lib.host_interpreter_add_known_preimage(self._handle, element, len(element)))
+
+    def add_known_list(self, elements: List[bytes]) -> bytes:
+        """Adds a known Merkleized list, and returns its Merkle root."""
+        data, lens = _concat(elements)
+        root = ctypes.create_string_buffer(32)
+        with _lock:
+            _check(self._lib.host_interpreter_add_known_list(self._handle, data, lens, len(elements), root))
+        return root.raw
+
+    def add_known_mapping(self, mapping: Mapping[bytes, bytes]) -> bytes:
+        """Adds the Merkleized lists of the keys and of the values of a mapping, and returns its commitment (as
+        `get_merkleized_map_commitment`)."""
+        keys, key_lens = _concat(list(mapping.keys()))
+        values, value_lens = _concat(list(mapping.values()))
+        commitment = ctypes.create_string_buffer(MAX_MAP_COMMITMENT_SIZE)
+        with _lock:
+            length = _check(self._lib.host_interpreter_add_known_mapping(
+                self._handle, keys, key_lens, values, value_lens, len(mapping), commitment))
+        return commitment.raw[:length]
+
+    def add_known_wallet(self, wallet: PolicyMapWallet) -> None:
+        """Adds the serialized wallet policy and the Merkleized list of its keys information, like
+        `bitcoin_client.command.add_known_wallet`."""
+        serialized = wallet.serialize()
+        keys, key_lens = _concat(wallet.keys_info_leaves())
+        with _lock:
+            _check(self._lib.host_interpreter_add_known_wallet(
+                self._handle, serialized, len(serialized), keys, key_lens, len(wallet.keys_info)))
+
+    def execute(self, hw_response: bytes) -> bytes:
+        """Interprets the client command requested by the hardware wallet, and returns the response to send via
+        INS_CONTINUE."""
+        if len(hw_response) == 0:
+            raise RuntimeError("Unexpected empty SW_INTERRUPTED_EXECUTION response from hardware wallet.")
+
+        response = ctypes.create_string_buffer(MAX_RESPONSE_SIZE)
+        with _lock:
+            length = _check(self._lib.host_interpreter_execute(self._handle, hw_response, len(hw_response),
+                                                               response))
+        return response.raw[:length]
+
+    def get_prefetched_responses(self, hw_response: bytes, max_size: int) -> bytes:
+        """Returns the responses to push in advance after the one to `hw_response`, like
+        `ClientCommandInterpreter.get_prefetched_responses`."""
+        out = ctypes.create_string_buffer(max(1, max_size))
+        with _lock:
+            length = self._lib.host_interpreter_get_prefetched_responses(self._handle, hw_response,
+                                                                         len(hw_response), out, max_size)
+        return out.raw[:length]
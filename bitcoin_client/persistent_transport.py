@@ -0,0 +1,170 @@
+"""
+A HID transport that stays open for the whole life of a process, shared by all the `BitcoinCommand` of the process,
+and that is re-opened on the next exchange when the device goes away (for example, when the Bitcoin app is closed
+and opened again, which re-enumerates the USB device).
+
+Each time the transport is opened, the master key fingerprint of the device is read. As long as it is the same, the
+`identity_generation` of the client does not change, and the caches of the commands using it are kept across the
+reconnections (see `response_cache` in `BitcoinCommand`); if it changed, or if it could not be read, the generation is
+incremented, and the commands clear their caches at their next exchange.
+
+A failed exchange is never retried: the device might have received the APDU, and the state of an interactive command
+is lost anyway. The exception is raised, and the transport is re-opened by the next exchange.
+"""
+
+import threading
+import time
+
+from typing import Callable, Dict, Optional
+
+from ledgercomm import Transport
+
+from bitcoin_client.command import ApduException
+from bitcoin_client.command_builder import BitcoinCommandBuilder, BitcoinInsType
+
+TransportFactory = Callable[[], Transport]
+
+
+def default_transport_factory() -> Transport:
+    return Transport("hid")
+
+
+class PersistentHIDClient:
+    """A client with the interface of `HIDClient`, on top of a transport that is kept open, and re-opened when needed.
+
+    If `health_check_interval` is not None, the device is also checked with `check_health` before an exchange when
+    the transport was idle for at least `health_check_interval` seconds, so that a transport gone stale while idle is
+    re-opened before the first APDU of a command, instead of failing it.
+
+    Opening the transport is attempted `open_attempts` times, `open_delay` seconds apart, as the device takes a
+    moment to be enumerated again after the app is opened.
+
+    Only one command can run at a time on the same client.
+    """
+
+    _shared: Dict[str, "PersistentHIDClient"] = {}
+    _shared_lock = threading.Lock()
+
+    def __init__(self, transport_factory: TransportFactory = default_transport_factory,
+                 health_check_interval: Optional[float] = None, open_attempts: int = 3, open_delay: float = 0.2) -> None:
+        self.transport_factory = transport_factory
+        self.health_check_interval = health_check_interval
+        self.open_attempts = open_attempts
+        self.open_delay = open_delay
+
+        self.fingerprint: Optional[bytes] = None  # of the device, when the transport was last opened
+        self.identity_generation = 0
+        self.n_opens = 0
+
+        self._transport: Optional[Transport] = None
+        self._last_exchange = 0.0
+        self._lock = threading.RLock()
+
+    @classmethod
+    def shared(cls, key: str = "hid", **kwargs) -> "PersistentHIDClient":
+        """Returns the client of the process for `key`, created with `kwargs` by the first call; the other calls
+        ignore `kwargs`. Short-lived `BitcoinCommand` objects (one per request, for example) can use it to avoid
+        enumerating and opening the device each time."""
+
+        with cls._shared_lock:
+            client = cls._shared.get(key)
+            if client is None:
+                client = cls(**kwargs)
+                cls._shared[key] = client
+            return client
+
+    @property
+    def is_open(self) -> bool:
+        return self._transport is not None
+
+    def open(self) -> None:
+        """Opens the transport if it is not open, and reads the master key fingerprint of the device."""
+
+        with self._lock:
+            if self._transport is not None:
+                return
+
+            for attempt in range(self.open_attempts):
+                try:
+                    self._transport = self.transport_factory()
+                    break
+                except Exception:
+                    if attempt == self.open_attempts - 1:
+                        raise
+                    time.sleep(self.open_delay)
+            self.n_opens += 1
+            self._last_exchange = time.monotonic()
+
+            fingerprint = self._read_fingerprint()
+            if fingerprint is None or fingerprint != self.fingerprint:
+                # another device, or the identity is unknown: the caches of the commands are not valid anymore
+                self.identity_generation += 1
+            self.fingerprint = fingerprint
+
+    def close(self) -> None:
+        with self._lock:
+            if self._transport is not None:
+                transport, self._transport = self._transport, None
+                try:
+                    transport.close()
+                except Exception:
+                    pass  # the device is already gone
+
+    def check_health(self) -> bool:
+        """Checks that the Bitcoin app of the same device answers, re-opening the transport once if it does not.
+        Returns False if the app does not answer (for example, if it is not open, or if the device is locked)."""
+
+        with self._lock:
+            if self._transport is None:
+                self.open()
+                return self.fingerprint is not None
+            try:
+                fingerprint = self._read_fingerprint()
+            except Exception:
+                # the transport was closed by the failed exchange
+                self.open()
+                return self.fingerprint is not None
+            if fingerprint is not None and fingerprint != self.fingerprint:
+                self.identity_generation += 1
+                self.fingerprint = fingerprint
+            return fingerprint is not None
+
+    def apdu_exchange(self, cla: int, ins: int, data: bytes = b"", p1: int = 0, p2: int = 0) -> bytes:
+        with self._lock:
+            if self._transport is None:
+                self.open()
+            elif (self.health_check_interval is not None
+                  and time.monotonic() - self._last_exchange >= self.health_check_interval):
+                self.check_health()
+
+            sw, response = self._exchange(cla, ins, p1, p2, data)
+
+            if sw != 0x9000:
+                raise ApduException(sw, response)
+
+            return response
+
+    def apdu_exchange_nowait(self, cla: int, ins: int, data: bytes = b"", p1: int = 0, p2: int = 0):
+        raise NotImplementedError()
+
+    def stop(self) -> None:
+        """Closes the transport; it is opened again by the next exchange."""
+
+        self.close()
+
+    def _exchange(self, cla: int, ins: int, p1: int, p2: int, data: bytes):
+        try:
+            sw, response = self._transport.exchange(cla, ins, p1, p2, None, data)
+        except Exception:
+            # the device was probably disconnected; the next exchange re-opens the transport
+            self.close()
+            raise
+        self._last_exchange = time.monotonic()
+        return sw, response
+
+    def _read_fingerprint(self) -> Optional[bytes]:
+        """Returns the master key fingerprint of the device, or None if the Bitcoin app does not answer."""
+
+        sw, response = self._exchange(BitcoinCommandBuilder.CLA_BITCOIN, BitcoinInsType.GET_MASTER_FINGERPRINT, 0, 0,
+                                      b"")
+        return response if sw == 0x9000 and len(response) == 4 else None
@@ -0,0 +1,108 @@
+"""
+Stores for the preimages known to the client command interpreter.
+
+The interpreter answers GET_PREIMAGE (and GET_PREIMAGES and GET_MERKLEIZED_MAP_VALUE) from a mapping from the hash
+of each preimage to the preimage. A plain dict keeps all of them in memory, which for a PSBT is dominated by a few long
+values (like the non-witness UTXOs). `PreimageStore` keeps only an index in memory for the long ones, and pages them in
+from a memory-mapped file when the hardware wallet actually asks for them.
+"""
+
+import mmap
+import tempfile
+import threading
+from typing import BinaryIO, Dict, Iterator, List, MutableMapping, Optional, Tuple
+
+
+class PreimageStore(MutableMapping[bytes, bytes]):
+    """Mapping from the hash of each known preimage to the preimage, backed by memory-mapped files.
+
+    Preimages are kept in memory, except:
+    - the ranges added with `add_range`, which are leaf preimages (the byte 0x00 followed by a range of bytes of a
+      memory-mapped file, like a PSBT) and are not copied;
+    - if `spill_size` is not None, the preimages longer than `spill_size` bytes, which are appended to an anonymous
+      temporary file owned by the store.
+    """
+
+    def __init__(self, spill_size: Optional[int] = None) -> None:
+        self.spill_size = spill_size
+
+        self._preimages: Dict[bytes, bytes] = {}
+
+        # hash -> (index in _buffers, offset, length)
+        self._ranges: Dict[bytes, Tuple[int, int, int]] = {}
+        self._buffers: List[mmap.mmap] = []
+
+        # hash -> (offset, length) in the spill file
+        self._spilled: Dict[bytes, Tuple[int, int]] = {}
+        self._spill_file: Optional[BinaryIO] = None
+        self._spill_map: Optional[mmap.mmap] = None
+        self._spill_file_size = 0
+        # the spill file is mapped again when it grew, maybe by another thread reading from the store
+        self._spill_lock = threading.Lock()
+
+    def add_buffer(self, buf: mmap.mmap) -> int:
+        """Adds a buffer for `add_range`, and returns its index. The store keeps a reference to it."""
+
+        self._buffers.append(buf)
+        return len(self._buffers) - 1
+
+    def add_range(self, preimage_hash: bytes, buffer_index: int, offset: int, length: int) -> None:
+        """Adds the preimage b"\\x00" + buf[offset:offset + length], where buf is the buffer with the given index.
+        The hash must have already been verified by the caller."""
+
+        self._discard(preimage_hash)
+        self._ranges[preimage_hash] = (buffer_index, offset, length)
+
+    def _discard(self, preimage_hash: bytes) -> None:
+        self._preimages.pop(preimage_hash, None)
+        self._ranges.pop(preimage_hash, None)
+        self._spilled.pop(preimage_hash, None)  # the bytes stay in the spill file
+
+    def _read_spilled(self, offset: int, length: int) -> bytes:
+        with self._spill_lock:
+            if self._spill_map is None or len(self._spill_map) < offset + length:
+                # the file grew since it was mapped
+                self._spill_file.flush()
+                if self._spill_map is not None:
+                    self._spill_map.close()
+                self._spill_map = mmap.mmap(self._spill_file.fileno(), 0, access=mmap.ACCESS_READ)
+            return self._spill_map[offset:offset + length]
+
+    def __getitem__(self, preimage_hash: bytes) -> bytes:
+        if preimage_hash in self._preimages:
+            return self._preimages[preimage_hash]
+
+        if preimage_hash in self._spilled:
+            return self._read_spilled(*self._spilled[preimage_hash])
+
+        buffer_index, offset, length = self._ranges[preimage_hash]
+        return b"\x00" + self._buffers[buffer_index][offset:offset + length]
+
+    def __setitem__(self, preimage_hash: bytes, preimage: bytes) -> None:
+        self._discard(preimage_hash)
+
+        if self.spill_size is None or len(preimage) <= self.spill_size:
+            self._preimages[preimage_hash] = preimage
+            return
+
+        if self._spill_file is None:
+            self._spill_file = tempfile.TemporaryFile()
+        self._spill_file.write(preimage)
+        self._spilled[preimage_hash] = (self._spill_file_size, len(preimage))
+        self._spill_file_size += len(preimage)
+
+    def __delitem__(self, preimage_hash: bytes) -> None:
+        if preimage_hash not in self:
+            raise KeyError(preimage_hash)
+        self._discard(preimage_hash)
+
+    def __iter__(self) -> Iterator[bytes]:
+        yield from self._preimages
+        yield from self._ranges
+        yield from self._spilled
+
+    def __len__(self) -> int:
+        return len(self._preimages) + len(self._ranges) + len(self._spilled)
+
+    def __contains__(self, preimage_hash: object) -> bool:
+        return preimage_hash in self._preimages or preimage_hash in self._ranges or preimage_hash in self._spilled
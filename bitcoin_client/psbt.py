@@ -32,7 +32,6 @@ PSBT Classes and Utilities
 import base64
 import struct
 
-from io import BytesIO, BufferedReader
 from typing import (
     Dict,
     List,
@@ -50,13 +49,17 @@ from .tx import (
     CTxInWitness,
     CTxOut,
 )
+from .common import hash256
 from ._serialize import (
+    BufferReader,
     deser_compact_size,
     deser_string,
+    deser_string_reader,
     Readable,
     ser_compact_size,
     ser_string,
-    ser_uint256
+    ser_uint256,
+    uint256_from_str,
 )
 
 def DeserializeHDKeypath(
@@ -124,8 +127,7 @@ def DeserializeHDHashesKeypath(
     if pubkey in hashes_hd_keypaths:
         raise PSBTSerializationError("Duplicate key, input partial signature for pubkey already provided")
 
-    value = deser_string(f)
-    f_value = BufferedReader(BytesIO(value)) # type: ignore
+    f_value = deser_string_reader(f)
 
     hashes_len = deser_compact_size(f_value)
     hashes = [f_value.read(32) for _ in range(hashes_len)]
@@ -185,7 +187,7 @@ class PartiallySignedInput:
 
         # taproot fields
         self.tap_key_sig: bytes = b""
-        # self.tap_script_sig = # Not implemented
+        self.tap_script_sigs: Dict[Tuple[bytes, bytes], bytes] = {}  # by (x-only pubkey, leaf hash)
         # self.tap_leaf_script = # Not implemented
         self.tap_hd_keypaths: Dict[bytes, Tuple[List[bytes], KeyOriginInfo]] = {}
         self.tap_internal_key: bytes = b""
@@ -214,6 +216,7 @@ class PartiallySignedInput:
         self.required_height_locktime = None
 
         self.tap_key_sig = b""
+        self.tap_script_sigs = {}
         self.tap_hd_keypaths = {}
         self.tap_internal_key = b""
 
@@ -248,9 +251,15 @@ class PartiallySignedInput:
                 elif len(key) != 1:
                     raise PSBTSerializationError("non witness utxo key is more than one byte type")
                 self.non_witness_utxo = CTransaction()
-                utxo_bytes = BufferedReader(BytesIO(deser_string(f))) # type: ignore
+                utxo_bytes = deser_string_reader(f)
                 self.non_witness_utxo.deserialize(utxo_bytes)
-                self.non_witness_utxo.rehash()
+                if len(self.non_witness_utxo.wit.vtxinwit) == 0 and utxo_bytes.tell() == len(utxo_bytes.getbuffer()):
+                    # the value is the serialization without witness: the txid is its hash, without serializing again
+                    txid = hash256(utxo_bytes.getbuffer())
+                    self.non_witness_utxo.sha256 = uint256_from_str(txid)
+                    self.non_witness_utxo.hash = txid[::-1].hex()
+                else:
+                    self.non_witness_utxo.rehash()
 
             elif key_type == 1:
                 if self.witness_utxo:
@@ -258,7 +267,7 @@ class PartiallySignedInput:
                 elif len(key) != 1:
                     raise PSBTSerializationError("witness utxo key is more than one byte type")
                 self.witness_utxo = CTxOut()
-                tx_out_bytes = BufferedReader(BytesIO(deser_string(f))) # type: ignore
+                tx_out_bytes = deser_string_reader(f)
                 self.witness_utxo.deserialize(tx_out_bytes)
 
             elif key_type == 2:
@@ -308,7 +317,7 @@ class PartiallySignedInput:
                     raise PSBTSerializationError("Duplicate key, input final scriptWitness already provided")
                 elif len(key) != 1:
                     raise PSBTSerializationError("final scriptWitness key is more than one byte type")
-                witness_bytes = BufferedReader(BytesIO(deser_string(f))) # type: ignore
+                witness_bytes = deser_string_reader(f)
                 self.final_script_witness.deserialize(witness_bytes)
 
             # key types 0x8 to 0x0d are defined in the standard, but left to the unknowns here
@@ -401,7 +410,20 @@ class PartiallySignedInput:
                 if len(self.tap_key_sig) not in [64, 65]:
                     raise PSBTSerializationError("Input key path Schnorr signature must be 64 or 65 bytes long")
 
-            # 0x14 and 0x15 are not implemented
+            elif key_type == 0x14:
+                if len(key) != 1 + 32 + 32:
+                    raise PSBTSerializationError("Input script path Schnorr signature key is not 65 bytes long")
+                pubkey_leaf_hash = (key[1:33], key[33:])
+                if pubkey_leaf_hash in self.tap_script_sigs:
+                    raise PSBTSerializationError("Duplicate key, input script path Schnorr signature already provided")
+
+                sig = deser_string(f)
+
+                if len(sig) not in [64, 65]:
+                    raise PSBTSerializationError("Input script path Schnorr signature must be 64 or 65 bytes long")
+                self.tap_script_sigs[pubkey_leaf_hash] = sig
+
+            # 0x15 is not implemented
 
             elif key_type == 0x16:
                 DeserializeHDHashesKeypath(f, key, self.tap_hd_keypaths, [1 + 32])
@@ -506,9 +528,13 @@ class PartiallySignedInput:
             r += ser_string(b"\x13")
             r += ser_string(self.tap_key_sig)
 
-        # serialize the unknown key types 0x14 and 0x15
+        for (pubkey, leaf_hash), sig in sorted(self.tap_script_sigs.items()):
+            r += ser_string(b"\x14" + pubkey + leaf_hash)
+            r += ser_string(sig)
+
+        # serialize the unknown key type 0x15
         for key, value in sorted(self.unknown.items()):
-            if 0x14 <= key[0] <= 0x15:
+            if key[0] == 0x15:
                 r += ser_string(key)
                 r += ser_string(value)
 
@@ -740,7 +766,7 @@ class PSBT(object):
         :param psbt: A base 64 PSBT.
         """
         psbt_bytes = base64.b64decode(psbt.strip())
-        f = BufferedReader(BytesIO(psbt_bytes)) # type: ignore
+        f = BufferReader(psbt_bytes)
         end = len(psbt_bytes)
 
         # Read the magic bytes
@@ -772,7 +798,7 @@ class PSBT(object):
                     raise PSBTSerializationError("Global unsigned tx key is more than one byte type")
 
                 # read in value
-                tx_bytes = BufferedReader(BytesIO(deser_string(f))) # type: ignore
+                tx_bytes = deser_string_reader(f)
                 self.tx.deserialize(tx_bytes)
 
                 # Make sure that all scriptSigs and scriptWitnesses are empty
@@ -805,7 +831,7 @@ class PSBT(object):
                 elif len(key) > 1:
                     raise PSBTSerializationError("Input count key is more than one byte type")
 
-                input_count_bytes = BufferedReader(BytesIO(deser_string(f)))
+                input_count_bytes = deser_string_reader(f)
                 self.input_count = deser_compact_size(input_count_bytes)
             elif key_type == 0x05:
                 if self.output_count is not None:
@@ -813,7 +839,7 @@ class PSBT(object):
                 elif len(key) > 1:
                     raise PSBTSerializationError("Output count key is more than one byte type")
 
-                output_count_bytes = BufferedReader(BytesIO(deser_string(f)))
+                output_count_bytes = deser_string_reader(f)
                 self.output_count = deser_compact_size(output_count_bytes)
             elif key_type == 0x06:
                 if self.tx_modifiable is not None:
@@ -888,7 +914,6 @@ class PSBT(object):
             prevout_hash = self.tx.vin[input_idx].prevout.hash if psbt_version == 0 else input.previous_txid
 
             if input.non_witness_utxo:
-                input.non_witness_utxo.rehash()
                 if input.non_witness_utxo.sha256 != prevout_hash:
                     raise PSBTSerializationError("Non-witness UTXO does not match outpoint hash")
 
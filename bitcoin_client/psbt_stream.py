@@ -0,0 +1,272 @@
+"""
+Streaming preparation of a PSBT for the SIGN_PSBT command.
+
+`BitcoinCommand.sign_psbt` deserializes the whole PSBT, converts it to version 2 and keeps every key and value in
+memory. For PSBTs with many legacy inputs (each with the full previous transaction), that is many times the size of
+the PSBT itself. The functions in this module instead read the PSBT from a file, map by map, and only keep in memory
+the hashes of the Merkle trees and the short values; long values are read back from the (memory-mapped) file when
+the hardware wallet asks for their preimage.
+
+The maps are the same that `sign_psbt` would send, so the signatures are the same.
+"""
+
+import base64
+import mmap
+import struct
+import tempfile
+from hashlib import sha256 as _sha256
+from io import BytesIO
+from itertools import chain
+from os import PathLike
+from typing import BinaryIO, Dict, Iterable, Iterator, List, Optional, Tuple, Union
+
+from bitcoin_client.client_command import ClientCommandInterpreter
+from bitcoin_client.common import write_varint
+from bitcoin_client.merkle import MerkleTree, element_hash
+from bitcoin_client.preimage_store import PreimageStore
+from bitcoin_client.tx import CTransaction
+from bitcoin_client._serialize import ser_compact_size, ser_uint256
+
+PSBT_MAGIC = b"psbt\xff"
+
+# values up to this length are kept in memory; longer ones are read back from the file
+MAX_IN_MEMORY_VALUE_SIZE = 256
+
+# size of the chunks read from the source when it is not a binary file that can be memory-mapped
+CHUNK_SIZE = 1 << 16
+
+PsbtSource = Union[str, PathLike, BinaryIO, Iterable[bytes]]
+
+# a value of a map, either in memory, or as the offset and the length of its bytes in the file
+Value = Union[bytes, Tuple[int, int]]
+
+
+def _iter_chunks(source: PsbtSource) -> Iterator[bytes]:
+    if isinstance(source, (str, PathLike)):
+        with open(source, "rb") as f:
+            yield from iter(lambda: f.read(CHUNK_SIZE), b"")
+    elif hasattr(source, "read"):
+        yield from iter(lambda: source.read(CHUNK_SIZE), b"")
+    else:
+        yield from source
+
+
+def _iter_decoded_chunks(chunks: Iterator[bytes]) -> Iterator[bytes]:
+    """Yields the binary PSBT from the chunks of a binary or a base64-encoded PSBT."""
+
+    first = b""
+    for chunk in chunks:
+        first += chunk
+        if len(first) >= len(PSBT_MAGIC):
+            break
+
+    if first.startswith(PSBT_MAGIC):
+        yield first
+        yield from chunks
+        return
+
+    rest = b""
+    for chunk in chain([first], chunks):
+        rest += b"".join(chunk.split())  # ignore whitespace and newlines
+        n_complete = len(rest) - len(rest) % 4  # base64 decodes in groups of 4 characters
+        yield base64.b64decode(rest[:n_complete], validate=True)
+        rest = rest[n_complete:]
+
+    if len(rest) > 0:
+        raise ValueError("Invalid base64 encoding of the PSBT")
+
+
+def _open_psbt_file(source: PsbtSource) -> Tuple[BinaryIO, mmap.mmap]:
+    """Returns a binary file with the PSBT in `source`, and a read-only memory map of it.
+
+    A path to a binary PSBT is mapped directly; anything else (a base64 PSBT, a stream or an iterable of chunks) is
+    first decoded to an anonymous temporary file."""
+
+    if isinstance(source, (str, PathLike)):
+        f = open(source, "rb")
+        if f.read(len(PSBT_MAGIC)) == PSBT_MAGIC:
+            return f, mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        f.close()
+
+    f = tempfile.TemporaryFile()
+    for chunk in _iter_decoded_chunks(_iter_chunks(source)):
+        f.write(chunk)
+    f.flush()
+
+    f.seek(0)
+    if f.read(len(PSBT_MAGIC)) != PSBT_MAGIC:
+        f.close()
+        raise ValueError("Invalid PSBT magic")
+
+    return f, mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+
+class _Reader:
+    def __init__(self, buf: mmap.mmap, pos: int) -> None:
+        self.buf = buf
+        self.pos = pos
+
+    def read(self, n: int) -> bytes:
+        if self.pos + n > len(self.buf):
+            raise ValueError("Unexpected end of the PSBT")
+        result = self.buf[self.pos:self.pos + n]
+        self.pos += n
+        return result
+
+    def read_compact_size(self) -> int:
+        n = self.read(1)[0]
+        if n == 253:
+            return struct.unpack("<H", self.read(2))[0]
+        elif n == 254:
+            return struct.unpack("<I", self.read(4))[0]
+        elif n == 255:
+            return struct.unpack("<Q", self.read(8))[0]
+        return n
+
+    def read_map(self) -> Dict[bytes, Value]:
+        """Reads a map up to its separator; the values are returned as their offset and length in the file."""
+
+        result: Dict[bytes, Value] = {}
+        while True:
+            key = self.read(self.read_compact_size())
+            if len(key) == 0:
+                return result
+
+            if key in result:
+                raise ValueError(f"Duplicate key in the PSBT: {key.hex()}")
+
+            length = self.read_compact_size()
+            if self.pos + length > len(self.buf):
+                raise ValueError("Unexpected end of the PSBT")
+            result[key] = (self.pos, length)
+            self.pos += length
+
+
+def _get_value(buf: mmap.mmap, value: Value) -> bytes:
+    if isinstance(value, bytes):
+        return value
+    offset, length = value
+    return buf[offset:offset + length]
+
+
+def _add_known_map(client_interpreter: ClientCommandInterpreter, store: PreimageStore,
+                   buf: mmap.mmap, buffer_index: int, mapping: Dict[bytes, Value]) -> bytes:
+    """Adds the Merkle trees of keys and values of `mapping` to the client interpreter, like `add_known_mapping`,
+    and returns the serialized Merkleized map commitment."""
+
+    keys = sorted(mapping.keys())
+
+    keys_hashes = []
+    for key in keys:
+        keys_hashes.append(element_hash(key))
+        store[keys_hashes[-1]] = b"\x00" + key
+
+    values_hashes = []
+    for key in keys:
+        value = mapping[key]
+        if isinstance(value, tuple) and value[1] > MAX_IN_MEMORY_VALUE_SIZE:
+            offset, length = value
+            h = _sha256(b"\x00")
+            h.update(memoryview(buf)[offset:offset + length])
+            values_hashes.append(h.digest())
+            store.add_range(values_hashes[-1], buffer_index, offset, length)
+        else:
+            value = _get_value(buf, value)
+            values_hashes.append(element_hash(value))
+            store[values_hashes[-1]] = b"\x00" + value
+
+    keys_tree = MerkleTree(keys_hashes)
+    values_tree = MerkleTree(values_hashes)
+    client_interpreter.add_known_tree(keys_tree)
+    client_interpreter.add_known_tree(values_tree)
+
+    return write_varint(len(mapping)) + keys_tree.root + values_tree.root
+
+
+def _normalize_input_map(mapping: Dict[bytes, Value]) -> None:
+    # like PSBT.serialize, the fields that are only used to finalize the input are dropped once it is finalized
+    if b"\x07" in mapping or b"\x08" in mapping:
+        for key in [k for k in mapping if 0x02 <= k[0] <= 0x06]:
+            del mapping[key]
+
+
+def prepare_sign_psbt_stream(
+    source: PsbtSource, client_interpreter: ClientCommandInterpreter
+) -> Tuple[bytes, List[bytes], List[bytes]]:
+    """Reads the PSBT (of version 0 or 2, binary or base64) from `source`, and adds all its Merkle trees and
+    preimages to `client_interpreter`, which must have been created with a `PreimageStore` as its known preimages.
+
+    `source` can be a path, a binary stream or an iterable of chunks of bytes. A path to a binary PSBT is
+    memory-mapped; anything else is first copied to a temporary file. The file stays open as long as the client
+    interpreter references its preimages.
+
+    Returns the Merkleized map commitments of the global map, of each input map and of each output map, with the
+    maps converted to version 2 like `PSBT.to_psbt_v2`.
+    """
+
+    store = client_interpreter.known_preimages
+    if not isinstance(store, PreimageStore):
+        raise ValueError("The client interpreter must use a PreimageStore")
+
+    f, buf = _open_psbt_file(source)
+    f.close()  # the memory map stays valid
+    buffer_index = store.add_buffer(buf)
+
+    reader = _Reader(buf, len(PSBT_MAGIC))
+    global_map = reader.read_map()
+
+    version_value = global_map.get(b"\xfb")
+    version = struct.unpack("<I", _get_value(buf, version_value))[0] if version_value is not None else 0
+
+    tx: Optional[CTransaction] = None
+    if version == 0:
+        if b"\x00" not in global_map:
+            raise ValueError("Missing unsigned transaction in a PSBT of version 0")
+        tx = CTransaction()
+        tx.deserialize(BytesIO(_get_value(buf, global_map[b"\x00"])))
+
+        global_map[b"\x02"] = struct.pack("<I", tx.nVersion)
+        global_map[b"\x03"] = struct.pack("<I", tx.nLockTime)
+        global_map[b"\x04"] = ser_compact_size(len(tx.vin))
+        global_map[b"\x05"] = ser_compact_size(len(tx.vout))
+        global_map[b"\xfb"] = struct.pack("<I", 2)
+        input_count, output_count = len(tx.vin), len(tx.vout)
+    elif version == 2:
+        if b"\x04" not in global_map or b"\x05" not in global_map:
+            raise ValueError("Missing input or output count in a PSBT of version 2")
+        input_count = _Reader(_get_value(buf, global_map[b"\x04"]), 0).read_compact_size()
+        output_count = _Reader(_get_value(buf, global_map[b"\x05"]), 0).read_compact_size()
+    else:
+        raise ValueError(f"Unsupported PSBT version: {version}")
+
+    # like PSBT.serialize, the empty unsigned transaction is always present in version 2
+    global_map[b"\x00"] = CTransaction().serialize_with_witness()
+
+    global_commitment = _add_known_map(client_interpreter, store, buf, buffer_index, global_map)
+
+    input_commitments: List[bytes] = []
+    for i in range(input_count):
+        input_map = reader.read_map()
+        if tx is not None:
+            txin = tx.vin[i]
+            input_map[b"\x0e"] = ser_uint256(txin.prevout.hash)
+            input_map[b"\x0f"] = struct.pack("<I", txin.prevout.n)
+            input_map[b"\x10"] = struct.pack("<I", txin.nSequence)
+            locktime_key = b"\x11" if tx.nLockTime >= 500_000_000 else b"\x12"
+            input_map[locktime_key] = struct.pack("<I", tx.nLockTime)
+        _normalize_input_map(input_map)
+        input_commitments.append(_add_known_map(client_interpreter, store, buf, buffer_index, input_map))
+
+    output_commitments: List[bytes] = []
+    for i in range(output_count):
+        output_map = reader.read_map()
+        if tx is not None:
+            txout = tx.vout[i]
+            output_map[b"\x03"] = struct.pack("<Q", txout.nValue)
+            output_map[b"\x04"] = txout.scriptPubKey
+        output_commitments.append(_add_known_map(client_interpreter, store, buf, buffer_index, output_map))
+
+    client_interpreter.add_known_list(input_commitments)
+    client_interpreter.add_known_list(output_commitments)
+
+    return global_commitment, input_commitments, output_commitments
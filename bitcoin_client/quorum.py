@@ -0,0 +1,120 @@
+"""
+Signing of a PSBT by several devices, like the cosigners of a multisig wallet.
+
+The PSBT is prepared once with `BitcoinCommand.prepare_psbt`, then signed by all the devices at the same time; the
+signatures of each device are merged back into the PSBT.
+"""
+
+from concurrent.futures import ThreadPoolExecutor
+from typing import List, Mapping, Optional, Sequence, Tuple
+
+from bitcoin_client.command import BitcoinCommand
+from bitcoin_client.key import KeyOriginInfo
+from bitcoin_client.psbt import PSBT, PartiallySignedInput
+from bitcoin_client.wallet import PolicyMapWallet
+
+
+def _internal_key_origins(wallet: PolicyMapWallet, fingerprint: bytes) -> List[KeyOriginInfo]:
+    """Returns the key origins of the keys of the wallet that belong to the device with the given fingerprint, in the
+    order of the keys information (which is the order of the signatures of each input)."""
+
+    origins = []
+    for key_info in wallet.keys_info:
+        if not key_info.startswith("["):
+            continue
+        origin = KeyOriginInfo.from_string(key_info[1:key_info.index("]")])
+        if origin.fingerprint == fingerprint:
+            origins.append(origin)
+    return origins
+
+
+def _find_pubkey(psbt_in: PartiallySignedInput, origin: KeyOriginInfo) -> Tuple[bytes, Optional[List[bytes]]]:
+    """Returns the pubkey of the input derived from the key with the given origin and, for a taproot key, the hashes of
+    its leaves (otherwise, None)."""
+
+    def is_derived(key_origin: KeyOriginInfo) -> bool:
+        return key_origin.fingerprint == origin.fingerprint and key_origin.path[:-2] == origin.path
+
+    for pubkey, key_origin in psbt_in.hd_keypaths.items():
+        if is_derived(key_origin):
+            return pubkey, None
+    for pubkey, (leaf_hashes, key_origin) in psbt_in.tap_hd_keypaths.items():
+        if is_derived(key_origin):
+            return pubkey, leaf_hashes
+    raise ValueError(f"No derivation for the key {origin.to_string()} in the input")
+
+
+def add_signatures(psbt: PSBT, wallet: PolicyMapWallet, fingerprint: bytes,
+                   signatures: Mapping[int, List[bytes]]) -> None:
+    """Adds to psbt the signatures returned by `BitcoinCommand.sign_prepared_psbt` for the device with the given
+    master key fingerprint.
+
+    ECDSA signatures are added as partial signatures of the derived pubkeys; Schnorr signatures as the taproot key
+    path signature for the internal key of the input, otherwise as the script path signature of the first leaf hash
+    of the key (in PSBT_IN_TAP_BIP32_DERIVATION).
+
+    Raises
+    ------
+    ValueError
+        If the signatures can not be matched to the keys of the device in the wallet and in the inputs.
+    """
+
+    origins = _internal_key_origins(wallet, fingerprint)
+
+    for input_index, sigs in signatures.items():
+        if input_index >= len(psbt.inputs) or len(sigs) > len(origins):
+            raise ValueError(f"Unexpected signatures for input {input_index}")
+
+        psbt_in = psbt.inputs[input_index]
+        for origin, sig in zip(origins, sigs):
+            pubkey, leaf_hashes = _find_pubkey(psbt_in, origin)
+            if leaf_hashes is None:
+                psbt_in.partial_sigs[pubkey] = sig
+            elif pubkey == psbt_in.tap_internal_key or len(leaf_hashes) == 0:
+                psbt_in.tap_key_sig = sig
+            else:
+                psbt_in.tap_script_sigs[(pubkey, leaf_hashes[0])] = sig
+
+
+def sign_psbt_with_devices(
+    psbt: PSBT, wallet: PolicyMapWallet, signers: Sequence[Tuple[BitcoinCommand, Optional[bytes]]]
+) -> Mapping[bytes, Mapping[int, List[bytes]]]:
+    """Signs psbt with several devices at the same time, and merges their signatures into it.
+
+    The PSBT is only prepared once, and its prepared data is shared by all the devices.
+
+    Parameters
+    ----------
+    psbt : PSBT
+        A PSBT of version 0 or 2, as for `BitcoinCommand.sign_psbt`. The signatures are added to it.
+
+    wallet : PolicyMapWallet
+        The wallet policy, registered on all the devices.
+
+    signers : Sequence[Tuple[BitcoinCommand, Optional[bytes]]]
+        For each device, its command and the hmac obtained when it registered the wallet (`None` for a standard
+        wallet policy).
+
+    Returns
+    -------
+    Mapping[bytes, Mapping[int, List[bytes]]]
+        For the master key fingerprint of each device, its signatures, as returned by
+        `BitcoinCommand.sign_prepared_psbt`.
+    """
+
+    if len(signers) == 0:
+        return {}
+
+    prepared = signers[0][0].prepare_psbt(psbt, wallet)
+
+    def sign(signer: Tuple[BitcoinCommand, Optional[bytes]]) -> Tuple[bytes, Mapping[int, List[bytes]]]:
+        cmd, wallet_hmac = signer
+        return cmd.get_master_fingerprint(), cmd.sign_prepared_psbt(prepared, wallet_hmac)
+
+    with ThreadPoolExecutor(max_workers=len(signers)) as executor:
+        results = list(executor.map(sign, signers))
+
+    for fingerprint, signatures in results:
+        add_signatures(psbt, wallet, fingerprint, signatures)
+
+    return dict(results)
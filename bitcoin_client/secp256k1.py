@@ -0,0 +1,222 @@
+"""
+Backends for the elliptic curve operations of `bitcoin_client.key` on secp256k1.
+
+The pure Python implementation is always available; libsecp256k1 is used instead if it can be loaded, either
+through the `coincurve` package, or directly with `ctypes` from the shared library of the system. The backend is
+chosen when the module is first used, as given by the BITCOIN_CLIENT_EC_BACKEND environment variable:
+
+- "auto" (default): coincurve, then libsecp256k1 with ctypes, then pure Python;
+- "coincurve", "ctypes" or "python": only the given backend (an error is raised if it is not available).
+
+All the backends work on 33-byte compressed public keys and 32-byte big-endian scalars, and give the same results;
+they raise ValueError for an invalid input, or if the result is the point at infinity.
+"""
+
+import ctypes
+import ctypes.util
+import os
+
+from typing import Optional, Tuple
+
+BACKEND_ENV = "BITCOIN_CLIENT_EC_BACKEND"
+
+p = 0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC2F
+n = 0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141
+G = (0x79BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798, 0x483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8)
+
+Point = Optional[Tuple[int, int]]
+
+
+def point_add(p1: Point, p2: Point) -> Point:
+    if (p1 is None):
+        return p2
+    if (p2 is None):
+        return p1
+    if (p1[0] == p2[0] and p1[1] != p2[1]):
+        return None
+    if (p1 == p2):
+        lam = (3 * p1[0] * p1[0] * pow(2 * p1[1], p - 2, p)) % p
+    else:
+        lam = ((p2[1] - p1[1]) * pow(p2[0] - p1[0], p - 2, p)) % p
+    x3 = (lam * lam - p1[0] - p2[0]) % p
+    return (x3, (lam * (p1[0] - x3) - p1[1]) % p)
+
+
+def point_mul(p: Point, n: int) -> Point:
+    r = None
+    for i in range(256):
+        if ((n >> i) & 1):
+            r = point_add(r, p)
+        p = point_add(p, p)
+    return r
+
+
+def _check_scalar(b: bytes, allow_zero: bool) -> int:
+    if len(b) != 32:
+        raise ValueError("Invalid scalar length")
+    k = int.from_bytes(b, byteorder="big")
+    if k >= n or (k == 0 and not allow_zero):
+        raise ValueError("Invalid scalar")
+    return k
+
+
+class PythonBackend:
+    """The pure Python implementation, with affine coordinates."""
+
+    name = "python"
+
+    @staticmethod
+    def _parse(pubkey: bytes) -> Point:
+        if len(pubkey) != 33 or pubkey[0] not in (2, 3):
+            raise ValueError("Invalid compressed public key")
+        x = int.from_bytes(pubkey[1:], byteorder="big")
+        if x >= p:
+            raise ValueError("Invalid compressed public key")
+        c = (pow(x, 3, p) + 7) % p
+        y = pow(c, (p + 1) // 4, p)
+        if y * y % p != c:
+            raise ValueError("Invalid compressed public key")
+        return (x, y if y & 1 == pubkey[0] & 1 else p - y)
+
+    @staticmethod
+    def _serialize(P: Point) -> bytes:
+        if P is None:
+            raise ValueError("The result is the point at infinity")
+        return (b'\x03' if P[1] & 1 else b'\x02') + P[0].to_bytes(32, byteorder="big")
+
+    def pubkey_create(self, privkey: bytes) -> bytes:
+        return self._serialize(point_mul(G, _check_scalar(privkey, False)))
+
+    def pubkey_tweak_add(self, pubkey: bytes, tweak: bytes) -> bytes:
+        return self._serialize(point_add(point_mul(G, _check_scalar(tweak, True)), self._parse(pubkey)))
+
+
+class CoincurveBackend:
+    """libsecp256k1, through the coincurve package."""
+
+    name = "coincurve"
+
+    def __init__(self) -> None:
+        import coincurve  # raises ImportError if not installed
+        self._coincurve = coincurve
+
+    def pubkey_create(self, privkey: bytes) -> bytes:
+        _check_scalar(privkey, False)
+        return self._coincurve.PublicKey.from_secret(privkey).format(compressed=True)
+
+    def pubkey_tweak_add(self, pubkey: bytes, tweak: bytes) -> bytes:
+        # coincurve rejects a zero tweak, that is valid in BIP-32 and in libsecp256k1
+        is_zero = _check_scalar(tweak, True) == 0
+        try:
+            key = self._coincurve.PublicKey(pubkey)
+            return (key if is_zero else key.add(tweak)).format(compressed=True)
+        except Exception as e:
+            raise ValueError("Invalid public key, or the result is the point at infinity") from e
+
+
+class CtypesBackend:
+    """libsecp256k1, loaded with ctypes from the path in the BITCOIN_CLIENT_LIBSECP256K1 environment variable, or
+    from the library path of the system."""
+
+    name = "ctypes"
+
+    SECP256K1_CONTEXT_SIGN = 0x201
+    SECP256K1_CONTEXT_VERIFY = 0x101
+    SECP256K1_EC_COMPRESSED = 0x102
+
+    def __init__(self) -> None:
+        path = os.environ.get("BITCOIN_CLIENT_LIBSECP256K1") or ctypes.util.find_library("secp256k1")
+        if path is None:
+            raise OSError("libsecp256k1 not found")
+        lib = ctypes.CDLL(path)
+
+        ptr, buf, size_tp = ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_size_t)
+        signatures = {
+            "secp256k1_context_create": (ptr, [ctypes.c_uint]),
+            "secp256k1_ec_pubkey_create": (ctypes.c_int, [ptr, buf, buf]),
+            "secp256k1_ec_pubkey_parse": (ctypes.c_int, [ptr, buf, buf, ctypes.c_size_t]),
+            "secp256k1_ec_pubkey_serialize": (ctypes.c_int, [ptr, buf, size_tp, buf, ctypes.c_uint]),
+            "secp256k1_ec_pubkey_tweak_add": (ctypes.c_int, [ptr, buf, buf]),
+        }
+        for fn_name, (restype, argtypes) in signatures.items():
+            fn = getattr(lib, fn_name)
+            fn.restype = restype
+            fn.argtypes = argtypes
+
+        self._lib = lib
+        self._ctx = lib.secp256k1_context_create(self.SECP256K1_CONTEXT_SIGN | self.SECP256K1_CONTEXT_VERIFY)
+        if not self._ctx:
+            raise OSError("Could not create the libsecp256k1 context")
+
+    def _serialize(self, pubkey64: ctypes.Array) -> bytes:
+        out = ctypes.create_string_buffer(33)
+        out_len = ctypes.c_size_t(33)
+        self._lib.secp256k1_ec_pubkey_serialize(self._ctx, out, ctypes.byref(out_len), pubkey64,
+                                                self.SECP256K1_EC_COMPRESSED)
+        return out.raw[:out_len.value]
+
+    def pubkey_create(self, privkey: bytes) -> bytes:
+        _check_scalar(privkey, False)
+        pubkey64 = ctypes.create_string_buffer(64)
+        if not self._lib.secp256k1_ec_pubkey_create(self._ctx, pubkey64, privkey):
+            raise ValueError("Invalid private key")
+        return self._serialize(pubkey64)
+
+    def pubkey_tweak_add(self, pubkey: bytes, tweak: bytes) -> bytes:
+        _check_scalar(tweak, True)
+        pubkey64 = ctypes.create_string_buffer(64)
+        if len(pubkey) != 33 or not self._lib.secp256k1_ec_pubkey_parse(self._ctx, pubkey64, pubkey, len(pubkey)):
+            raise ValueError("Invalid compressed public key")
+        if not self._lib.secp256k1_ec_pubkey_tweak_add(self._ctx, pubkey64, tweak):
+            raise ValueError("The result is the point at infinity")
+        return self._serialize(pubkey64)
+
+
+_BACKENDS = {
+    CoincurveBackend.name: CoincurveBackend,
+    CtypesBackend.name: CtypesBackend,
+    PythonBackend.name: PythonBackend,
+}
+
+_backend = None
+
+
+def set_backend(name: str) -> None:
+    """Selects the backend with the given name ("auto", "coincurve", "ctypes" or "python"); raises ImportError or
+    OSError if it is not available."""
+    global _backend
+
+    if name == "auto":
+        for cls in _BACKENDS.values():
+            try:
+                _backend = cls()
+                return
+            except (ImportError, OSError, AttributeError):
+                continue
+    elif name not in _BACKENDS:
+        raise ValueError(f"Unknown elliptic curve backend: {name}")
+    else:
+        _backend = _BACKENDS[name]()
+
+
+def get_backend():
+    """Returns the current backend, selecting it from the environment on the first call."""
+    if _backend is None:
+        set_backend(os.environ.get(BACKEND_ENV, "auto"))
+    return _backend
+
+
+def pubkey_create(privkey: bytes) -> bytes:
+    """Returns the compressed public key privkey*G of a 32-byte private key."""
+    return get_backend().pubkey_create(privkey)
+
+
+def pubkey_tweak_add(pubkey: bytes, tweak: bytes) -> bytes:
+    """Returns the compressed public key pubkey + tweak*G."""
+    return get_backend().pubkey_tweak_add(pubkey, tweak)
+
+
+def xonly_tweak_add(xonly_pubkey: bytes, tweak: bytes) -> Tuple[int, bytes]:
+    """Returns the parity and the x coordinate of lift_x(xonly_pubkey) + tweak*G, as in BIP-341."""
+    Q = pubkey_tweak_add(b'\x02' + xonly_pubkey, tweak)
+    return Q[0] & 1, Q[1:]
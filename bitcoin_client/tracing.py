@@ -0,0 +1,181 @@
+"""
+Optional instrumentation of the exchanges with the hardware wallet, to tell apart the time spent by the device from the
+time spent by the host to answer its client commands.
+
+An `ExchangeMetrics` is given to `BitcoinCommand` (or `AsyncBitcoinCommand`) with `metrics=`; it then records:
+
+- for each APDU exchanged, the time from sending it to receiving the response, so the computation of the device and
+  the transfer in both directions (they can not be told apart from the host: the transfer time can be estimated from
+  the bytes, that include the 5-byte header and the 2-byte status word);
+- for each client command answered by the `ClientCommandInterpreter`, by command code, the time to compute the
+  response, the bytes of the request and of the response, and the number of elements left in the queue for
+  GET_MORE_ELEMENTS; the prefetched responses are counted as PREFETCH;
+- the same times added up by phase of SIGN_PSBT, if its progress events are enabled with `progress_callback`
+  (see `SignPsbtPhase`); the exchanges before the first event of a command, or without progress events, are counted
+  in the phase INIT.
+
+The times are histograms with the bounds in LATENCY_BUCKETS_MS; `as_dict` returns all of them as plain Python values.
+
+If `span_hook` is given, it is also called for each exchange and each client command with the name of the span
+("apdu_exchange" or "client_command"), its start and end times in nanoseconds since the epoch and its attributes,
+as they are recorded; for example, with OpenTelemetry:
+
+    def span_hook(name, start_ns, end_ns, attributes):
+        tracer.start_span(name, start_time=start_ns, attributes=attributes).end(end_time=end_ns)
+
+Nothing is recorded if no `ExchangeMetrics` is given. An `ExchangeMetrics` can be shared by the commands of several
+devices, for example in a `DevicePool`.
+"""
+
+import threading
+import time
+
+from typing import Callable, Dict, List, Mapping, Optional
+
+# name, start time, end time (in ns since the epoch), attributes
+SpanHook = Callable[[str, int, int, Mapping[str, object]], None]
+
+# Upper bounds of the buckets of the latency histograms; the last bucket has no upper bound
+LATENCY_BUCKETS_MS = (1, 2, 5, 10, 20, 50, 100, 200, 500, 1000)
+
+INIT_PHASE = "INIT"
+
+
+class LatencyHistogram:
+    def __init__(self) -> None:
+        self.counts: List[int] = [0] * (len(LATENCY_BUCKETS_MS) + 1)
+        self.total_ns = 0
+        self.max_ns = 0
+
+    def record(self, duration_ns: int) -> None:
+        bucket = 0
+        while bucket < len(LATENCY_BUCKETS_MS) and duration_ns > LATENCY_BUCKETS_MS[bucket] * 1_000_000:
+            bucket += 1
+        self.counts[bucket] += 1
+        self.total_ns += duration_ns
+        self.max_ns = max(self.max_ns, duration_ns)
+
+    def as_dict(self) -> dict:
+        bounds = [f"<={bound}" for bound in LATENCY_BUCKETS_MS] + [f">{LATENCY_BUCKETS_MS[-1]}"]
+        return {
+            "count": sum(self.counts),
+            "total_ms": self.total_ns / 1e6,
+            "max_ms": self.max_ns / 1e6,
+            "histogram_ms": dict(zip(bounds, self.counts)),
+        }
+
+
+class _Stats:
+    """The latency and the bytes of the exchanges of one kind."""
+
+    def __init__(self) -> None:
+        self.latency = LatencyHistogram()
+        self.bytes_in = 0
+        self.bytes_out = 0
+
+    def record(self, duration_ns: int, bytes_in: int, bytes_out: int) -> None:
+        self.latency.record(duration_ns)
+        self.bytes_in += bytes_in
+        self.bytes_out += bytes_out
+
+    def as_dict(self) -> dict:
+        return dict(self.latency.as_dict(), bytes_in=self.bytes_in, bytes_out=self.bytes_out)
+
+
+class _PhaseStats:
+    def __init__(self) -> None:
+        self.device_ns = 0
+        self.host_ns = 0
+        self.n_apdus = 0
+        self.n_client_commands = 0
+
+    def as_dict(self) -> dict:
+        return {
+            "device_ms": self.device_ns / 1e6,
+            "host_ms": self.host_ns / 1e6,
+            "apdus": self.n_apdus,
+            "client_commands": self.n_client_commands,
+        }
+
+
+class ExchangeMetrics:
+    """The latencies and sizes of the APDUs and of the client commands, by kind and by phase; see the module."""
+
+    def __init__(self, span_hook: Optional[SpanHook] = None) -> None:
+        self.span_hook = span_hook
+        self._lock = threading.Lock()
+        self.reset()
+
+    def reset(self) -> None:
+        """Forgets everything recorded so far, for example before each `sign_psbt` call."""
+
+        with self._lock:
+            self.phase = INIT_PHASE
+            self._apdus: Dict[int, _Stats] = {}
+            self._client_commands: Dict[str, _Stats] = {}
+            self._phases: Dict[str, _PhaseStats] = {}
+            self.max_queue_depth = 0
+
+    def set_phase(self, phase: str) -> None:
+        """Sets the phase of the next exchanges; called when a command starts (INIT), and at each progress event."""
+
+        with self._lock:
+            self.phase = phase
+
+    def _get_phase(self) -> _PhaseStats:
+        return self._phases.setdefault(self.phase, _PhaseStats())
+
+    def _emit(self, name: str, start_ns: int, duration_ns: int, attributes: Mapping[str, object]) -> None:
+        if self.span_hook is not None:
+            self.span_hook(name, start_ns, start_ns + duration_ns, attributes)
+
+    def record_apdu_exchange(self, ins: int, sw: int, start_ns: int, duration_ns: int,
+                             bytes_out: int, bytes_in: int) -> None:
+        """Records an APDU sent at start_ns (in ns since the epoch), with bytes_out bytes sent and bytes_in
+        received, that took duration_ns."""
+
+        with self._lock:
+            self._apdus.setdefault(ins, _Stats()).record(duration_ns, bytes_in, bytes_out)
+            phase = self._get_phase()
+            phase.device_ns += duration_ns
+            phase.n_apdus += 1
+            attributes = {"ins": ins, "sw": sw, "bytes_out": bytes_out, "bytes_in": bytes_in, "phase": self.phase}
+        self._emit("apdu_exchange", start_ns, duration_ns, attributes)
+
+    def record_client_command(self, command: str, start_ns: int, duration_ns: int, bytes_in: int, bytes_out: int,
+                              queue_depth: int) -> None:
+        """Records a client command answered by the host, with the request of bytes_in bytes and the response of
+        bytes_out bytes; queue_depth is the number of elements left in the queue of GET_MORE_ELEMENTS."""
+
+        with self._lock:
+            self._client_commands.setdefault(command, _Stats()).record(duration_ns, bytes_in, bytes_out)
+            phase = self._get_phase()
+            phase.host_ns += duration_ns
+            phase.n_client_commands += 1
+            self.max_queue_depth = max(self.max_queue_depth, queue_depth)
+            attributes = {"command": command, "bytes_in": bytes_in, "bytes_out": bytes_out,
+                          "queue_depth": queue_depth, "phase": self.phase}
+        self._emit("client_command", start_ns, duration_ns, attributes)
+
+    def as_dict(self) -> dict:
+        """Returns what was recorded since the last reset: the APDUs by instruction code ("0x.."), the client commands
+        by name, the maximum depth of the queue of GET_MORE_ELEMENTS, and the device and host times by phase."""
+
+        with self._lock:
+            return {
+                "apdus": {f"0x{ins:02x}": stats.as_dict() for ins, stats in self._apdus.items()},
+                "client_commands": {name: stats.as_dict() for name, stats in self._client_commands.items()},
+                "max_queue_depth": self.max_queue_depth,
+                "phases": {name: stats.as_dict() for name, stats in self._phases.items()},
+            }
+
+
+class Timer:
+    """Measures a duration with the monotonic clock, and keeps the start time in ns since the epoch for the spans."""
+
+    def __init__(self) -> None:
+        self.start_ns = time.time_ns()
+        self._start = time.perf_counter_ns()
+
+    def elapsed_ns(self) -> int:
+        return time.perf_counter_ns() - self._start
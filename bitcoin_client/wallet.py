@@ -1,13 +1,59 @@
+import re
+import struct
+
 from enum import IntEnum
-from typing import List
+from typing import Dict, List, Optional, Tuple
 
 from hashlib import sha256
 
+from . import base58
 from .common import serialize_str, AddressType, write_varint
+from .descriptor import Descriptor, parse_descriptor
+from .key import KeyOriginInfo
 from .merkle import MerkleTree, element_hash
 
 class WalletType(IntEnum):
     POLICYMAP = 1
+    # same as POLICYMAP, with the keys information in the binary format of serialize_key_info_binary
+    POLICYMAP_BINARY_KEYS = 2
+
+
+# flags of the binary keys information
+KEY_INFO_FLAG_HAS_KEY_ORIGIN = 0x01
+KEY_INFO_FLAG_HAS_WILDCARD = 0x02
+
+
+def serialize_key_info_binary(key_info: str) -> bytes:
+    """Returns the binary format of a key information given as a string, like "[f5acc2fd/48'/1'/0'/2']tpub.../**":
+       - 1 byte   : flags (KEY_INFO_FLAG_HAS_KEY_ORIGIN, KEY_INFO_FLAG_HAS_WILDCARD)
+       - 4 bytes  : master key fingerprint (only with key origin)
+       - 1 byte   : number of derivation steps (only with key origin)
+       - (var)    : derivation steps, 4 bytes each, little endian (only with key origin)
+       - 78 bytes : the serialized extended pubkey, without the base58check encoding.
+    """
+
+    flags = 0
+    origin = b""
+    if key_info.startswith("["):
+        end = key_info.index("]")
+        key_origin = KeyOriginInfo.from_string(key_info[1:end])
+        flags |= KEY_INFO_FLAG_HAS_KEY_ORIGIN
+        origin = b"".join([
+            key_origin.fingerprint,
+            len(key_origin.path).to_bytes(1, byteorder="little"),
+            struct.pack("<" + "I" * len(key_origin.path), *key_origin.path)
+        ])
+        key_info = key_info[end + 1:]
+
+    if key_info.endswith("/**"):
+        flags |= KEY_INFO_FLAG_HAS_WILDCARD
+        key_info = key_info[:-3]
+
+    ext_pubkey = base58.decode_check(key_info)
+    if len(ext_pubkey) != 78:
+        raise ValueError(f"Invalid extended pubkey: {key_info}")
+
+    return bytes([flags]) + origin + ext_pubkey
 
 
 # should not be instantiated directly
@@ -34,16 +80,20 @@ class PolicyMapWallet(Wallet):
        - 1 byte   : wallet type
        - 1 byte   : length of the wallet name (max 16)
        - (var)    : wallet name (ASCII string)
-       - (varint) : length of the policy map, at most 74 bytes at this time
+       - (varint) : length of the policy map, at most 160 bytes at this time
        - (var)    : policy map
        - (varint) : number of keys (not larger than 252)
        - 32-bytes : root of the Merkle tree of all the keys information.
 
     The specific format of the keys is deferred to subclasses.
+
+    The keys information are always given as strings; if `binary_keys` is True, the wallet has type
+    POLICYMAP_BINARY_KEYS, and the leaves of the Merkle tree are their binary format, which the hardware wallet uses
+    without parsing nor base58-decoding them.
     """
 
-    def __init__(self, name: str, policy_map: str, keys_info: List[str]):
-        super().__init__(name, WalletType.POLICYMAP)
+    def __init__(self, name: str, policy_map: str, keys_info: List[str], binary_keys: bool = False):
+        super().__init__(name, WalletType.POLICYMAP_BINARY_KEYS if binary_keys else WalletType.POLICYMAP)
         self.policy_map = policy_map
         self.keys_info = keys_info
 
@@ -51,20 +101,78 @@ class PolicyMapWallet(Wallet):
     def n_keys(self) -> int:
         return len(self.keys_info)
 
-    def serialize(self) -> bytes:
-        keys_info_hashes = map(lambda k: element_hash(k.encode("latin-1")), self.keys_info)
+    def keys_info_leaves(self) -> List[bytes]:
+        """Returns the keys information as in the leaves of the Merkle tree of the keys."""
+
+        if self.type == WalletType.POLICYMAP_BINARY_KEYS:
+            return [serialize_key_info_binary(k) for k in self.keys_info]
+        return [k.encode("latin-1") for k in self.keys_info]
+
+    def keys_info_root(self) -> bytes:
+        """Returns the root of the Merkle tree of the keys information."""
 
+        return MerkleTree(element_hash(k) for k in self.keys_info_leaves()).root
+
+    def serialize(self) -> bytes:
         return b"".join([
             super().serialize(),
             write_varint(len(self.policy_map)),
             self.policy_map.encode("latin-1"),
             write_varint(len(self.keys_info)),
-            MerkleTree(keys_info_hashes).root
+            self.keys_info_root()
         ])
 
 
+class PreparedWallet(PolicyMapWallet):
+    """
+    A PolicyMapWallet whose serialization, id and Merkle tree of the keys information are computed once, at
+    construction, instead of at each command. Its fields must not be modified afterwards.
+
+    `keys_tree` can be given if the leaves of the tree (the hashes of the keys information) are already known, for
+    example when loading the wallet from a `WalletRegistry`.
+    """
+
+    def __init__(self, name: str, policy_map: str, keys_info: List[str],
+                 keys_tree: Optional[MerkleTree] = None, binary_keys: bool = False) -> None:
+        super().__init__(name, policy_map, keys_info, binary_keys)
+
+        leaves = self.keys_info_leaves()
+        if keys_tree is None:
+            keys_tree = MerkleTree(element_hash(k) for k in leaves)
+        elif len(keys_tree) != len(keys_info):
+            raise ValueError("The Merkle tree does not match the keys information")
+        # the hardware wallet asks for the proof of each key that it uses
+        keys_tree.precompute()
+        self.keys_tree = keys_tree
+
+        self._serialized = super().serialize()
+        self._id = sha256(self._serialized).digest()
+
+        # preimages known to the client for any command using the wallet, as in ClientCommandInterpreter
+        self.preimages: Dict[bytes, bytes] = {
+            keys_tree.get(i): b"\x00" + k for i, k in enumerate(leaves)
+        }
+        self.preimages[self._id] = self._serialized
+
+    @classmethod
+    def from_wallet(cls, wallet: PolicyMapWallet) -> "PreparedWallet":
+        return cls(wallet.name, wallet.policy_map, wallet.keys_info,
+                   binary_keys=wallet.type == WalletType.POLICYMAP_BINARY_KEYS)
+
+    def keys_info_root(self) -> bytes:
+        return self.keys_tree.root
+
+    def serialize(self) -> bytes:
+        return self._serialized
+
+    @property
+    def id(self) -> bytes:
+        return self._id
+
+
 class MultisigWallet(PolicyMapWallet):
-    def __init__(self, name: str, address_type: AddressType, threshold: int, keys_info: List[str], sorted: bool = True) -> None:
+    def __init__(self, name: str, address_type: AddressType, threshold: int, keys_info: List[str], sorted: bool = True,
+                 binary_keys: bool = False) -> None:
         n_keys = len(keys_info)
 
         if not (1 <= threshold <= n_keys <= 15):
@@ -91,6 +199,59 @@ class MultisigWallet(PolicyMapWallet):
             policy_suffix
         ])
 
-        super().__init__(name, policy_map, keys_info)
+        super().__init__(name, policy_map, keys_info, binary_keys)
 
         self.threshold = threshold
+
+
+class WalletAddressIndex:
+    """
+    The scriptPubKeys of a wallet policy derived on the host, to check the ones returned by the hardware wallet (for
+    example, by `get_wallet_script_pubkeys`) without trusting it.
+
+    The descriptor of each of the receive and change branches is only parsed once, and it keeps the `/change` child
+    of each key, so that each address only derives the last step; all the scriptPubKeys that were computed are kept,
+    with the index of each one. Only the wallet policies supported by `descriptor.py` can be indexed, like `pkh`,
+    `wpkh`, `tr` without scripts and the `multi`/`sortedmulti` wallets, and all the keys must end with `/**`.
+    """
+
+    def __init__(self, wallet: PolicyMapWallet) -> None:
+        self.wallet = wallet
+        self._descriptors: Dict[bool, Descriptor] = {}
+        self._script_pubkeys: Dict[Tuple[bool, int], bytes] = {}
+        self._positions: Dict[bytes, Tuple[bool, int]] = {}
+
+    def descriptor(self, change: bool) -> Descriptor:
+        """Returns the (ranged) descriptor of the receive or change addresses of the wallet."""
+
+        if change not in self._descriptors:
+            def key_expression(match: re.Match) -> str:
+                key_info = self.wallet.keys_info[int(match.group(1))]
+                if not key_info.endswith("/**"):
+                    raise ValueError("All the keys must have wildcard (/**)")
+                return key_info[:-3] + f"/{1 if change else 0}/*"
+
+            self._descriptors[change] = parse_descriptor(re.sub(r"@(\d+)", key_expression, self.wallet.policy_map))
+        return self._descriptors[change]
+
+    def script_pubkey(self, change: bool, address_index: int) -> bytes:
+        """Returns the scriptPubKey at the given `change` and `address_index`."""
+
+        return self.script_pubkeys(change, address_index, 1)[0]
+
+    def script_pubkeys(self, change: bool, start_index: int, count: int) -> List[bytes]:
+        """Returns the `count` scriptPubKeys from `start_index`, like `get_wallet_script_pubkeys`; only the ones that
+        are not known yet are derived, all together."""
+
+        indexes = range(start_index, start_index + count)
+        missing = [i for i in indexes if (change, i) not in self._script_pubkeys]
+        if len(missing) > 0:
+            for i, scripts in zip(missing, self.descriptor(change).expand_batch(missing)):
+                self._script_pubkeys[(change, i)] = scripts.output_script
+                self._positions[scripts.output_script] = (change, i)
+        return [self._script_pubkeys[(change, i)] for i in indexes]
+
+    def find(self, script_pubkey: bytes) -> Optional[Tuple[bool, int]]:
+        """Returns the `change` and `address_index` of a scriptPubKey among the ones already derived, or None."""
+
+        return self._positions.get(script_pubkey)
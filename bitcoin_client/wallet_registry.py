@@ -0,0 +1,120 @@
+"""
+A persistent registry of the wallet policies registered on a device, for clients that use many registered wallets.
+
+For each wallet, the registry stores the policy, the hmac returned by the hardware wallet at registration, and the
+precomputed data that every command with the wallet needs: the serialized wallet policy, its id and the leaves of
+the Merkle tree of the keys information. The wallets are returned as `PreparedWallet`s, so that the commands that
+use them do not recompute any of it.
+
+The registry is a SQLite database; wallets loaded once are also kept in memory.
+"""
+
+import json
+import sqlite3
+from hashlib import sha256
+from os import PathLike
+from typing import Dict, Iterator, Optional, Tuple, Union
+
+from bitcoin_client.merkle import MerkleTree
+from bitcoin_client.wallet import PolicyMapWallet, PreparedWallet, WalletType
+
+_SCHEMA = """
+CREATE TABLE IF NOT EXISTS wallets (
+    id BLOB PRIMARY KEY,
+    name TEXT NOT NULL,
+    policy_map TEXT NOT NULL,
+    keys_info TEXT NOT NULL,
+    keys_leaves BLOB NOT NULL,
+    serialized BLOB NOT NULL,
+    hmac BLOB NOT NULL
+)
+"""
+
+
+class WalletRegistry:
+    """Registry of the registered wallets, with their hmac, stored in the SQLite database at `path` (created if
+    missing). Use ":memory:" for a registry that is not persisted."""
+
+    def __init__(self, path: Union[str, PathLike]) -> None:
+        self._db = sqlite3.connect(path)
+        self._db.execute(_SCHEMA)
+        self._db.commit()
+
+        self._loaded: Dict[bytes, Tuple[PreparedWallet, bytes]] = {}
+
+    def close(self) -> None:
+        self._db.close()
+
+    def __enter__(self) -> "WalletRegistry":
+        return self
+
+    def __exit__(self, *args) -> None:
+        self.close()
+
+    def add(self, wallet: PolicyMapWallet, wallet_hmac: bytes) -> PreparedWallet:
+        """Adds (or replaces) a wallet with the hmac returned by `register_wallet`, and returns it prepared."""
+
+        if len(wallet_hmac) != 32:
+            raise ValueError("Invalid hmac length")
+
+        prepared = wallet if isinstance(wallet, PreparedWallet) else PreparedWallet.from_wallet(wallet)
+        keys_tree = prepared.keys_tree
+
+        self._db.execute(
+            "INSERT OR REPLACE INTO wallets VALUES (?, ?, ?, ?, ?, ?, ?)",
+            (
+                prepared.id,
+                prepared.name,
+                prepared.policy_map,
+                json.dumps(prepared.keys_info),
+                b"".join(keys_tree.get(i) for i in range(len(keys_tree))),
+                prepared.serialize(),
+                wallet_hmac,
+            )
+        )
+        self._db.commit()
+
+        self._loaded[prepared.id] = (prepared, wallet_hmac)
+        return prepared
+
+    def get(self, wallet_id: bytes) -> Optional[Tuple[PreparedWallet, bytes]]:
+        """Returns the wallet with the given id and its hmac, or None if it is not in the registry."""
+
+        if wallet_id in self._loaded:
+            return self._loaded[wallet_id]
+
+        row = self._db.execute(
+            "SELECT name, policy_map, keys_info, keys_leaves, serialized, hmac FROM wallets WHERE id = ?",
+            (wallet_id,)
+        ).fetchone()
+        if row is None:
+            return None
+
+        name, policy_map, keys_info, keys_leaves, serialized, wallet_hmac = row
+        keys_tree = MerkleTree(keys_leaves[i:i + 32] for i in range(0, len(keys_leaves), 32))
+        wallet = PreparedWallet(name, policy_map, json.loads(keys_info), keys_tree,
+                                binary_keys=serialized[0] == WalletType.POLICYMAP_BINARY_KEYS)
+
+        # the serialization commits to the root of the keys tree, so this also checks the stored leaves
+        if wallet.serialize() != serialized or sha256(serialized).digest() != wallet_id:
+            raise ValueError(f"Corrupted entry in the wallet registry: {wallet_id.hex()}")
+
+        self._loaded[wallet_id] = (wallet, wallet_hmac)
+        return self._loaded[wallet_id]
+
+    def remove(self, wallet_id: bytes) -> None:
+        self._db.execute("DELETE FROM wallets WHERE id = ?", (wallet_id,))
+        self._db.commit()
+        self._loaded.pop(wallet_id, None)
+
+    def __contains__(self, wallet_id: object) -> bool:
+        return self.get(wallet_id) is not None
+
+    def __iter__(self) -> Iterator[bytes]:
+        """Iterates over the ids of the wallets in the registry."""
+
+        for (wallet_id,) in self._db.execute("SELECT id FROM wallets"):
+            yield wallet_id
+
+    def __len__(self) -> int:
+        return self._db.execute("SELECT COUNT(*) FROM wallets").fetchone()[0]
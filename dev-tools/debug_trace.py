@@ -0,0 +1,108 @@
+"""
+Collects the debug trace of an app compiled with `make DEBUG_TRACE=1`, and prints its events decoded: the APDUs
+received, the client commands sent to the host or answered with prefetched responses, and the final responses.
+
+Run some commands (for example, a SIGN_PSBT from the test suite) on a device or on speculos, then run:
+
+    python dev-tools/debug_trace.py            # speculos, on localhost:9999
+    python dev-tools/debug_trace.py --hid      # device connected via USB
+
+Reading the trace resets it, so that the next run only shows the following commands. Times are in ticks of the device
+(100 ms), relative to the first event; with --json, the entries are printed as JSON instead, with the raw arguments.
+"""
+
+import argparse
+import json
+
+from ledgercomm import Transport
+
+from bitcoin_client.client_command import ClientCommandCode
+from bitcoin_client.command import BitcoinCommand, ApduException
+from bitcoin_client.command_builder import BitcoinInsType, FrameworkInsType
+
+# ids of the events, as in src/boilerplate/debug_trace.h
+DEBUG_TRACE_APDU = 1
+DEBUG_TRACE_INTERRUPTION = 2
+DEBUG_TRACE_PREFETCHED = 3
+DEBUG_TRACE_RESPONSE = 4
+
+
+class TransportClient:
+    def __init__(self, interface: str, server: str = "127.0.0.1", port: int = 9999):
+        self.transport = Transport(interface, server=server, port=port)
+
+    def apdu_exchange(self, cla: int, ins: int, data: bytes = b"", p1: int = 0, p2: int = 0) -> bytes:
+        sw, data = self.transport.exchange(cla, ins, p1, p2, None, data)
+
+        if sw != 0x9000:
+            raise ApduException(sw, data)
+
+        return data
+
+    def stop(self) -> None:
+        self.transport.close()
+
+
+def _enum_name(enum_type, value: int) -> str:
+    try:
+        return enum_type(value).name
+    except ValueError:
+        return f"0x{value:02X}"
+
+
+def decode_event(event: int, args: list) -> str:
+    """Returns the description of an event of the trace."""
+
+    if event == DEBUG_TRACE_APDU:
+        cla, ins, p1, p2 = args[0].to_bytes(4, byteorder="big")
+        lc, data_prefix = args[1] >> 24, args[1] & 0xFFFFFF
+        ins_name = _enum_name(FrameworkInsType if cla == 0xF8 else BitcoinInsType, ins)
+        data = data_prefix.to_bytes(3, byteorder="big")[:lc].hex()
+        return f"APDU {ins_name} CLA={cla:02X} P1={p1:02X} P2={p2:02X} Lc={lc} data={data}{'...' if lc > 3 else ''}"
+    elif event == DEBUG_TRACE_INTERRUPTION:
+        return f"-> {_enum_name(ClientCommandCode, args[0])} ({args[1]} bytes)"
+    elif event == DEBUG_TRACE_PREFETCHED:
+        return f"-> {_enum_name(ClientCommandCode, args[0])} answered by a prefetched response ({args[1]} bytes)"
+    elif event == DEBUG_TRACE_RESPONSE:
+        return f"<= SW={args[0]:04X} ({args[1]} bytes)"
+    return f"event {event}: {args[0]:08X} {args[1]:08X}"
+
+
+def print_trace(trace: dict) -> None:
+    if trace["dropped"] > 0:
+        print(f"Warning: the oldest {trace['dropped']} events were dropped, as the trace was full.\n")
+
+    entries = trace["entries"]
+    first_tick = entries[0]["tick"] if len(entries) > 0 else 0
+    for entry in entries:
+        # ticks are 16-bit counters
+        ticks = (entry["tick"] - first_tick) % 0x10000
+        print(f"{ticks:6}  {decode_event(entry['event'], entry['args'])}")
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Collect and decode the debug trace of the Bitcoin app.")
+    parser.add_argument("--hid", action="store_true", help="use a device connected via USB instead of speculos")
+    parser.add_argument("--server", default="127.0.0.1", help="address of the speculos APDU server")
+    parser.add_argument("--port", type=int, default=9999, help="port of the speculos APDU server")
+    parser.add_argument("--json", action="store_true", help="print the raw entries as JSON")
+    args = parser.parse_args()
+
+    if args.hid:
+        client = TransportClient("hid")
+    else:
+        client = TransportClient("tcp", server=args.server, port=args.port)
+
+    try:
+        trace = BitcoinCommand(client=client).get_debug_trace()
+    finally:
+        client.stop()
+
+    if args.json:
+        print(json.dumps(trace, indent=2))
+    else:
+        print_trace(trace)
+
+
+if __name__ == "__main__":
+    main()
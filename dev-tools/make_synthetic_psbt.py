@@ -0,0 +1,73 @@
+"""
+Prints a large synthetic PSBT (base64) for load testing, made with tests/utils/psbt_generator.py; the same arguments
+always give the same PSBT. Run it from the root of the repository, for example:
+
+    PYTHONPATH=. python3 dev-tools/make_synthetic_psbt.py --script-type wsh --quorum 2 3 --inputs 32 --outputs 8
+
+The wallet policy is printed too; for multisig wallets, the keys of the cosigners are random (but deterministic).
+"""
+
+import argparse
+import random
+
+from bitcoin_client.wallet import MultisigWallet
+from tests.test_benchmark_sign_psbt import MULTISIG_ADDRESS_TYPES, MULTISIG_OUR_KEY_INFO, MULTISIG_PATH, SINGLESIG_WALLETS
+from tests.utils import txmaker
+from tests.utils.psbt_generator import PsbtSpec, generate_psbt, input_sizes
+
+
+def run() -> None:
+    parser = argparse.ArgumentParser(description="Generate a synthetic PSBT for load testing")
+    parser.add_argument("--script-type", default="wpkh",
+                        choices=sorted(set(SINGLESIG_WALLETS.keys()) | set(MULTISIG_ADDRESS_TYPES.keys())))
+    parser.add_argument("--quorum", nargs=2, type=int, metavar=("K", "N"), default=None,
+                        help="K-of-N multisig (sh, sh_wsh or wsh only); single-signature if omitted")
+    parser.add_argument("--inputs", type=int, default=1)
+    parser.add_argument("--outputs", type=int, default=2)
+    parser.add_argument("--change", type=int, default=1, help="number of change outputs")
+    parser.add_argument("--parent-inputs", type=int, default=1, help="inputs of each non-witness parent")
+    parser.add_argument("--parent-outputs", type=int, default=2, help="outputs of each non-witness parent")
+    parser.add_argument("--foreign-keypaths", type=int, default=0,
+                        help="foreign derivations in each input and output")
+    parser.add_argument("--no-mixed-outputs", action="store_true",
+                        help="external outputs pay to the wallet's script type, instead of all the script types")
+    parser.add_argument("--seed", default="synthetic")
+    args = parser.parse_args()
+
+    if args.quorum is None:
+        if args.script_type not in SINGLESIG_WALLETS:
+            parser.error(f"{args.script_type} requires --quorum")
+        wallet = SINGLESIG_WALLETS[args.script_type]
+    else:
+        if args.script_type not in MULTISIG_ADDRESS_TYPES:
+            parser.error(f"--quorum is not supported for {args.script_type}")
+        threshold, n_keys = args.quorum
+        random.seed(args.seed)  # for the cosigners
+        wallet = MultisigWallet(
+            name="Synthetic",
+            address_type=MULTISIG_ADDRESS_TYPES[args.script_type],
+            threshold=threshold,
+            keys_info=[MULTISIG_OUR_KEY_INFO] + [txmaker.createCosignerKeyInfo(MULTISIG_PATH)
+                                                 for _ in range(n_keys - 1)],
+        )
+
+    spec = PsbtSpec(
+        n_inputs=args.inputs,
+        n_outputs=args.outputs,
+        n_change=args.change,
+        parent_inputs=args.parent_inputs,
+        parent_outputs=args.parent_outputs,
+        mixed_outputs=not args.no_mixed_outputs,
+        foreign_keypaths=args.foreign_keypaths,
+    )
+    psbt = generate_psbt(wallet, spec, args.seed)
+
+    print(f"Policy map: {wallet.policy_map}")
+    for i, key_info in enumerate(wallet.keys_info):
+        print(f"Key @{i}: {key_info}")
+    print(f"Size of the non-witness parents: {sum(input_sizes(psbt))} bytes")
+    print(psbt.serialize())
+
+
+if __name__ == "__main__":
+    run()
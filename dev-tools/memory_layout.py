@@ -0,0 +1,241 @@
+"""
+Reports the memory layout of the command states, from the debug information of a build of the app.
+
+Since only one command runs at a time, the states of all the commands share the `command_state_t` union, which is
+sized by its largest member. This script shows, for each member of the union, its size, how many of its bytes are
+padding (holes between fields, and at the end of structs), and how much of the union it leaves unused. The RAM that
+is only there because of padding in the largest state can be reclaimed by reordering its fields.
+
+Build the app (with debug information, as by default), then run:
+
+    python dev-tools/memory_layout.py bin/app.elf                           # the members of command_state_t
+    python dev-tools/memory_layout.py bin/app.elf --type sign_psbt_state_t  # the fields of a type, with the holes
+
+The debug information is read with `readelf` (use --readelf to choose another one, like arm-none-eabi-readelf), so
+no other tool is needed.
+"""
+
+import argparse
+import re
+import subprocess
+from typing import Dict, List, Optional, Tuple
+
+DIE_RE = re.compile(r"^\s*<(\d+)><([0-9a-f]+)>: Abbrev Number: (\d+)(?: \((\w+)\))?")
+ATTR_RE = re.compile(r"^\s*<[0-9a-f]+>\s+(DW_AT_\w+)\s*:\s*(?:\(\w+\) )?(.*)$")  # without the form, if shown
+REF_RE = re.compile(r"<0x([0-9a-f]+)>")
+PLUS_UCONST_RE = re.compile(r"DW_OP_plus_uconst: (\d+)")
+
+# tags that do not change the layout of the type they refer to
+TRANSPARENT_TAGS = {"DW_TAG_typedef", "DW_TAG_const_type", "DW_TAG_volatile_type", "DW_TAG_restrict_type"}
+
+
+class Die:
+    def __init__(self, offset: int, tag: str) -> None:
+        self.offset = offset
+        self.tag = tag
+        self.attrs: Dict[str, str] = {}
+        self.children: List["Die"] = []
+
+    @property
+    def name(self) -> Optional[str]:
+        value = self.attrs.get("DW_AT_name")
+        if value is None:
+            return None
+        # indirect strings are printed as "(indirect string, offset: 0x...): name"
+        return value.rsplit("): ", 1)[-1].strip()
+
+    def int_attr(self, attr: str) -> Optional[int]:
+        value = self.attrs.get(attr)
+        if value is None:
+            return None
+        match = PLUS_UCONST_RE.search(value)  # DWARF 2 member locations are expressions
+        if match is not None:
+            return int(match.group(1))
+        return int(value.split()[0], 0)
+
+    def ref_attr(self, attr: str) -> Optional[int]:
+        value = self.attrs.get(attr)
+        if value is None:
+            return None
+        return int(REF_RE.search(value).group(1), 16)
+
+
+class DebugInfo:
+    def __init__(self, dies: Dict[int, Die], pointer_size: int) -> None:
+        self.dies = dies
+        self.pointer_size = pointer_size
+
+        # the first definition of each named type (the same types are in the debug information of many units)
+        self.types: Dict[str, Die] = {}
+        for die in dies.values():
+            if die.name is not None and die.name not in self.types and die.tag in (
+                    "DW_TAG_typedef", "DW_TAG_structure_type", "DW_TAG_union_type") \
+                    and "DW_AT_declaration" not in die.attrs:
+                self.types[die.name] = die
+
+    def resolve(self, die: Die) -> Die:
+        while die.tag in TRANSPARENT_TAGS and "DW_AT_type" in die.attrs:
+            die = self.dies[die.ref_attr("DW_AT_type")]
+        return die
+
+    def type_of(self, die: Die) -> Die:
+        return self.resolve(self.dies[die.ref_attr("DW_AT_type")])
+
+    def size(self, die: Die) -> int:
+        die = self.resolve(die)
+        if die.tag == "DW_TAG_array_type":
+            count = 1
+            for subrange in die.children:
+                if subrange.tag != "DW_TAG_subrange_type":
+                    continue
+                if "DW_AT_count" in subrange.attrs:
+                    count *= subrange.int_attr("DW_AT_count")
+                elif "DW_AT_upper_bound" in subrange.attrs:
+                    count *= subrange.int_attr("DW_AT_upper_bound") + 1
+                else:
+                    count = 0  # flexible array member
+            return count * self.size(self.type_of(die))
+        if die.tag == "DW_TAG_pointer_type" and "DW_AT_byte_size" not in die.attrs:
+            return self.pointer_size
+        return die.int_attr("DW_AT_byte_size") or 0
+
+    def padding(self, die: Die) -> int:
+        """Returns the number of bytes of padding in the type, including the padding of the types of its fields."""
+
+        die = self.resolve(die)
+        if die.tag == "DW_TAG_array_type":
+            return self.size(die) // max(self.size(self.type_of(die)), 1) * self.padding(self.type_of(die))
+
+        if die.tag == "DW_TAG_structure_type":
+            result = 0
+            end = 0
+            for offset, member in self.members(die):
+                result += max(offset - end, 0) + self.padding(self.type_of(member))
+                end = max(end, offset + self.size(self.type_of(member)))
+            return result + self.size(die) - end
+
+        if die.tag == "DW_TAG_union_type":
+            # the padding of a union is the one of its largest member
+            largest = max(self.members(die), key=lambda m: self.size(self.type_of(m[1])), default=None)
+            if largest is None:
+                return self.size(die)
+            largest_type = self.type_of(largest[1])
+            return self.size(die) - self.size(largest_type) + self.padding(largest_type)
+
+        return 0
+
+    def members(self, die: Die) -> List[Tuple[int, Die]]:
+        return [(member.int_attr("DW_AT_data_member_location") or 0, member)
+                for member in die.children if member.tag == "DW_TAG_member"]
+
+    def type_name(self, die: Die) -> str:
+        die = self.dies[die.ref_attr("DW_AT_type")]
+        while die.name is None and die.tag in TRANSPARENT_TAGS:
+            die = self.dies[die.ref_attr("DW_AT_type")]
+        if die.tag == "DW_TAG_array_type":
+            return f"{self.type_name(die)}[{self.size(die) // max(self.size(self.type_of(die)), 1)}]"
+        if die.tag == "DW_TAG_pointer_type":
+            return "pointer"
+        if die.name is None:
+            return "struct" if die.tag == "DW_TAG_structure_type" else "union"
+        return die.name
+
+
+def read_debug_info(elf: str, readelf: str) -> DebugInfo:
+    output = subprocess.run([readelf, "--debug-dump=info", elf],
+                            check=True, stdout=subprocess.PIPE, universal_newlines=True).stdout
+
+    dies: Dict[int, Die] = {}
+    stack: List[Die] = []
+    pointer_size = 4
+    current: Optional[Die] = None
+    for line in output.splitlines():
+        match = DIE_RE.match(line)
+        if match is not None:
+            depth, offset, abbrev, tag = int(match.group(1)), int(match.group(2), 16), match.group(3), match.group(4)
+            if abbrev == "0":  # end of the children of the current die
+                current = None
+                continue
+            del stack[depth:]
+            current = Die(offset, tag)
+            dies[offset] = current
+            if depth > 0 and len(stack) == depth:
+                stack[-1].children.append(current)
+            stack.append(current)
+            continue
+
+        if line.strip().startswith("Pointer Size:"):
+            pointer_size = int(line.split(":")[1])
+            continue
+
+        match = ATTR_RE.match(line)
+        if match is not None and current is not None:
+            current.attrs[match.group(1)] = match.group(2)
+
+    return DebugInfo(dies, pointer_size)
+
+
+def print_union_report(info: DebugInfo, name: str) -> None:
+    union = info.resolve(info.types[name])
+    union_size = info.size(union)
+    print(f"{name}: {union_size} bytes ({info.padding(union)} of padding)\n")
+
+    rows = []
+    for _, member in info.members(union):
+        member_type = info.type_of(member)
+        size = info.size(member_type)
+        rows.append((member.name or "(anonymous)", info.type_name(member), size, info.padding(member_type),
+                     union_size - size))
+
+    width_name = max(len(row[0]) for row in rows)
+    width_type = max(len(row[1]) for row in rows)
+    print(f"{'member':<{width_name}}  {'type':<{width_type}}  {'size':>6}  {'padding':>7}  {'unused':>6}")
+    for row in sorted(rows, key=lambda row: -row[2]):
+        print(f"{row[0]:<{width_name}}  {row[1]:<{width_type}}  {row[2]:6}  {row[3]:7}  {row[4]:6}")
+
+
+def print_type_layout(info: DebugInfo, die: Die, indent: int = 0, base: int = 0) -> None:
+    """Prints the fields of a struct or union with their offsets and sizes, and the holes between them."""
+
+    die = info.resolve(die)
+    prefix = "    " * indent
+    end = 0
+    for offset, member in info.members(die):
+        member_type = info.type_of(member)
+        size = info.size(member_type)
+        if die.tag == "DW_TAG_structure_type" and offset > end:
+            print(f"{prefix}/* {base + end:5} */  /* XXX {offset - end}-byte hole */")
+
+        print(f"{prefix}/* {base + offset:5} {size:5} */  {info.type_name(member)} {member.name or ''}")
+        if member_type.tag in ("DW_TAG_structure_type", "DW_TAG_union_type") and member_type.name is None:
+            print_type_layout(info, member_type, indent + 1, base + offset)
+
+        end = max(end, offset + size)
+
+    if die.tag == "DW_TAG_structure_type" and info.size(die) > end:
+        print(f"{prefix}/* {base + end:5} */  /* XXX {info.size(die) - end} bytes of padding at the end */")
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Report the memory layout of the command states of the app.")
+    parser.add_argument("elf", help="the ELF file of a build of the app, with debug information")
+    parser.add_argument("--type", help="print the fields of this type, instead of the summary of the command states")
+    parser.add_argument("--readelf", default="readelf", help="the readelf executable (default: readelf)")
+    args = parser.parse_args()
+
+    info = read_debug_info(args.elf, args.readelf)
+
+    name = args.type or "command_state_t"
+    if name not in info.types:
+        raise SystemExit(f"Type not found in the debug information: {name}")
+
+    if args.type is None:
+        print_union_report(info, name)
+    else:
+        die = info.types[name]
+        print(f"{name}: {info.size(die)} bytes ({info.padding(die)} of padding)\n")
+        print_type_layout(info, die)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,114 @@
+"""
+Collects the processor trace of an app compiled with `make PROCESSOR_TRACE=1`, and shows where the time of the last
+commands was spent: in each processor on the device, or waiting for the responses of the host to the client commands.
+
+Run a command (for example, a SIGN_PSBT from the test suite) on a device or on speculos, then run:
+
+    python dev-tools/processor_trace.py            # speculos, on localhost:9999
+    python dev-tools/processor_trace.py --hid      # device connected via USB
+
+Reading the trace resets it, so that the next run only shows the following commands. With --folded, the output is
+in the folded format of flamegraph.pl instead.
+
+Times are in ticks of the device (100 ms); each entry of the trace is charged the time until the next entry, so the
+breakdown is only meaningful for commands that run for many ticks.
+"""
+
+import argparse
+from collections import OrderedDict
+from typing import Dict, List
+
+from ledgercomm import Transport
+
+from bitcoin_client.command import BitcoinCommand, ApduException
+
+HOST = "(waiting for the host)"
+
+
+class TransportClient:
+    def __init__(self, interface: str, server: str = "127.0.0.1", port: int = 9999):
+        self.transport = Transport(interface, server=server, port=port)
+
+    def apdu_exchange(self, cla: int, ins: int, data: bytes = b"", p1: int = 0, p2: int = 0) -> bytes:
+        sw, data = self.transport.exchange(cla, ins, p1, p2, None, data)
+
+        if sw != 0x9000:
+            raise ApduException(sw, data)
+
+        return data
+
+    def stop(self) -> None:
+        self.transport.close()
+
+
+def breakdown(trace: dict) -> Dict[str, int]:
+    """Returns the number of ticks spent in each processor, and waiting for the host, ordered by decreasing time."""
+
+    result: Dict[str, int] = {}
+    entries: List[dict] = trace["entries"]
+    current = None
+    for entry, next_entry in zip(entries, entries[1:]):
+        if "function" in entry:
+            current = f"{entry['function']}:{entry['line']}"
+        elif entry["event"] == "interruption":
+            current = HOST
+        elif entry["event"] == "end":
+            current = None
+        # after a "resume" event, the execution continues in the processor that was interrupted
+
+        if current is not None:
+            # ticks are 16-bit counters
+            ticks = (next_entry["tick"] - entry["tick"]) % 0x10000
+            result[current] = result.get(current, 0) + ticks
+
+    return OrderedDict(sorted(result.items(), key=lambda item: -item[1]))
+
+
+def print_table(trace: dict, times: Dict[str, int]) -> None:
+    if trace["dropped"] > 0:
+        print(f"Warning: the oldest {trace['dropped']} entries were dropped, as the trace was full.\n")
+
+    total = sum(times.values())
+    host = times.get(HOST, 0)
+    print(f"Total: {total} ticks; device: {total - host} ticks; host: {host} ticks\n")
+
+    width = max([len(name) for name in times] + [0])
+    for name, ticks in times.items():
+        share = ticks / total if total > 0 else 0
+        bar = "#" * round(40 * share)
+        print(f"{name:<{width}}  {ticks:6}  {100 * share:5.1f}%  {bar}")
+
+
+def print_folded(times: Dict[str, int]) -> None:
+    for name, ticks in times.items():
+        stack = "host" if name == HOST else f"device;{name}"
+        print(f"{stack} {ticks}")
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Collect and render the processor trace of the Bitcoin app.")
+    parser.add_argument("--hid", action="store_true", help="use a device connected via USB instead of speculos")
+    parser.add_argument("--server", default="127.0.0.1", help="address of the speculos APDU server")
+    parser.add_argument("--port", type=int, default=9999, help="port of the speculos APDU server")
+    parser.add_argument("--folded", action="store_true", help="print the folded format of flamegraph.pl")
+    args = parser.parse_args()
+
+    if args.hid:
+        client = TransportClient("hid")
+    else:
+        client = TransportClient("tcp", server=args.server, port=args.port)
+
+    try:
+        trace = BitcoinCommand(client=client).get_processor_trace()
+    finally:
+        client.stop()
+
+    times = breakdown(trace)
+    if args.folded:
+        print_folded(times)
+    else:
+        print_table(trace, times)
+
+
+if __name__ == "__main__":
+    main()
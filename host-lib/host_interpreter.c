@@ -0,0 +1,877 @@
+#include <stdbool.h>  // bool
+#include <stdlib.h>   // malloc, calloc, realloc, free, qsort
+#include <string.h>   // memcpy, memcmp, memset
+
+#include "os.h"
+#include "cx.h"
+
+#include "common/buffer.h"
+#include "common/varint.h"
+#include "common/wallet.h"
+#include "handler/client_commands.h"
+
+#include "host_merkle.h"
+#include "host_interpreter.h"
+
+// Maximum number of elements of a Merkle proof.
+#define MAX_PROOF_ELEMENTS (HOST_MERKLE_MAX_LEVELS - 1)
+
+/*
+  Hash table from 32-byte hashes to heap-allocated values, with open addressing and linear probing.
+  The hashes are uniformly distributed, so their first bytes are used as the hash of the table.
+*/
+typedef struct {
+    uint8_t key[32];
+    void *value;  // NULL for a free slot
+} table_entry_t;
+
+typedef struct {
+    table_entry_t *entries;
+    size_t capacity;  // 0 or a power of 2
+    size_t count;
+} table_t;
+
+typedef struct {
+    size_t len;
+    uint8_t data[];
+} preimage_t;
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+} yielded_t;
+
+struct host_interpreter_s {
+    table_t preimages;  // of preimage_t
+    table_t trees;      // of host_merkle_tree_t, by Merkle root
+
+    // queue of the elements for GET_MORE_ELEMENTS, all of the same length
+    uint8_t *queue;
+    size_t queue_capacity;
+    size_t queue_begin, queue_end;  // offsets of the queued bytes
+    size_t queue_element_len;
+
+    yielded_t *yielded;
+    size_t n_yielded, yielded_capacity;
+};
+
+static size_t table_slot(const table_t *table, const uint8_t key[static 32]) {
+    size_t h = 0;
+    for (size_t i = 0; i < sizeof(size_t); i++) {
+        h = (h << 8) | key[i];
+    }
+    return h & (table->capacity - 1);
+}
+
+static void *table_get(const table_t *table, const uint8_t key[static 32]) {
+    if (table->capacity == 0) {
+        return NULL;
+    }
+    for (size_t i = table_slot(table, key);; i = (i + 1) & (table->capacity - 1)) {
+        if (table->entries[i].value == NULL) {
+            return NULL;
+        }
+        if (memcmp(table->entries[i].key, key, 32) == 0) {
+            return table->entries[i].value;
+        }
+    }
+}
+
+static void table_insert_new(table_t *table, const uint8_t key[static 32], void *value) {
+    size_t i = table_slot(table, key);
+    while (table->entries[i].value != NULL) {
+        i = (i + 1) & (table->capacity - 1);
+    }
+    memcpy(table->entries[i].key, key, 32);
+    table->entries[i].value = value;
+    ++table->count;
+}
+
+// Inserts a value for a key that is not in the table, growing it to keep a load factor of at most
+// 1/2. The table takes ownership of the value only on success.
+static int table_insert(table_t *table, const uint8_t key[static 32], void *value) {
+    if (2 * (table->count + 1) > table->capacity) {
+        table_t grown = {.capacity = table->capacity == 0 ? 64 : 2 * table->capacity};
+        grown.entries = calloc(grown.capacity, sizeof(table_entry_t));
+        if (grown.entries == NULL) {
+            return HOST_ERR_NO_MEMORY;
+        }
+        for (size_t i = 0; i < table->capacity; i++) {
+            if (table->entries[i].value != NULL) {
+                table_insert_new(&grown, table->entries[i].key, table->entries[i].value);
+            }
+        }
+        free(table->entries);
+        *table = grown;
+    }
+    table_insert_new(table, key, value);
+    return 0;
+}
+
+static void table_free(table_t *table, void (*free_value)(void *)) {
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (table->entries[i].value != NULL) {
+            free_value(table->entries[i].value);
+        }
+    }
+    free(table->entries);
+    memset(table, 0, sizeof(table_t));
+}
+
+static void free_tree(void *tree) {
+    host_merkle_tree_free(tree);
+    free(tree);
+}
+
+static void sha256(const uint8_t *in, size_t in_len, uint8_t out[static 32]) {
+    cx_sha256_t hash;
+    cx_sha256_init_no_throw(&hash);
+    cx_hash_no_throw(&hash.header, CX_LAST, in, in_len, out, 32);
+}
+
+static int add_preimage(host_interpreter_t *interpreter,
+                        const uint8_t hash[static 32],
+                        const uint8_t *data,
+                        size_t len) {
+    if (table_get(&interpreter->preimages, hash) != NULL) {
+        return 0;  // same hash, same preimage
+    }
+
+    preimage_t *preimage = malloc(sizeof(preimage_t) + len);
+    if (preimage == NULL) {
+        return HOST_ERR_NO_MEMORY;
+    }
+    preimage->len = len;
+    memcpy(preimage->data, data, len);
+
+    int ret = table_insert(&interpreter->preimages, hash, preimage);
+    if (ret < 0) {
+        free(preimage);
+    }
+    return ret;
+}
+
+// Adds the Merkle tree of the given leaves; the tree is not added again for a known root.
+static int add_tree(host_interpreter_t *interpreter,
+                    const uint8_t (*leaf_hashes)[32],
+                    size_t n_leaves,
+                    uint8_t root[static 32]) {
+    host_merkle_tree_t *tree = malloc(sizeof(host_merkle_tree_t));
+    if (tree == NULL) {
+        return HOST_ERR_NO_MEMORY;
+    }
+    if (host_merkle_tree_init(tree, leaf_hashes, n_leaves) < 0) {
+        free_tree(tree);
+        return HOST_ERR_NO_MEMORY;
+    }
+
+    host_merkle_tree_root(tree, root);
+    if (table_get(&interpreter->trees, root) != NULL) {
+        free_tree(tree);
+        return 0;
+    }
+
+    int ret = table_insert(&interpreter->trees, root, tree);
+    if (ret < 0) {
+        free_tree(tree);
+    }
+    return ret;
+}
+
+host_interpreter_t *host_interpreter_new(void) {
+    return calloc(1, sizeof(host_interpreter_t));
+}
+
+void host_interpreter_free(host_interpreter_t *interpreter) {
+    if (interpreter == NULL) {
+        return;
+    }
+    host_interpreter_reset(interpreter);
+    table_free(&interpreter->preimages, free);
+    table_free(&interpreter->trees, free_tree);
+    free(interpreter->queue);
+    free(interpreter->yielded);
+    free(interpreter);
+}
+
+void host_interpreter_reset(host_interpreter_t *interpreter) {
+    for (size_t i = 0; i < interpreter->n_yielded; i++) {
+        free(interpreter->yielded[i].data);
+    }
+    interpreter->n_yielded = 0;
+    interpreter->queue_begin = interpreter->queue_end = 0;
+}
+
+int host_interpreter_add_known_preimage(host_interpreter_t *interpreter,
+                                        const uint8_t *preimage,
+                                        size_t preimage_len) {
+    uint8_t hash[32];
+    sha256(preimage, preimage_len, hash);
+    return add_preimage(interpreter, hash, preimage, preimage_len);
+}
+
+int host_interpreter_add_known_list(host_interpreter_t *interpreter,
+                                    const uint8_t *elements,
+                                    const size_t *element_lens,
+                                    size_t n_elements,
+                                    uint8_t root[static 32]) {
+    uint8_t(*leaf_hashes)[32] = malloc(n_elements * 32 + 1);
+    if (leaf_hashes == NULL) {
+        return HOST_ERR_NO_MEMORY;
+    }
+
+    // the preimage of each leaf is the element with the 0x00 prefix, and the leaf is its hash
+    int ret = 0;
+    uint8_t *leaf_preimage = NULL;
+    size_t leaf_preimage_capacity = 0;
+    for (size_t i = 0; i < n_elements && ret == 0; i++) {
+        if (1 + element_lens[i] > leaf_preimage_capacity) {
+            leaf_preimage_capacity = 2 * (1 + element_lens[i]);
+            free(leaf_preimage);
+            leaf_preimage = malloc(leaf_preimage_capacity);
+            if (leaf_preimage == NULL) {
+                ret = HOST_ERR_NO_MEMORY;
+                break;
+            }
+        }
+        leaf_preimage[0] = 0x00;
+        memcpy(leaf_preimage + 1, elements, element_lens[i]);
+        elements += element_lens[i];
+
+        sha256(leaf_preimage, 1 + element_lens[i], leaf_hashes[i]);
+        ret = add_preimage(interpreter, leaf_hashes[i], leaf_preimage, 1 + element_lens[i]);
+    }
+    free(leaf_preimage);
+
+    if (ret == 0) {
+        ret = add_tree(interpreter, (const uint8_t(*)[32]) leaf_hashes, n_elements, root);
+    }
+    free(leaf_hashes);
+    return ret;
+}
+
+typedef struct {
+    const uint8_t *key;
+    size_t key_len;
+    const uint8_t *value;
+    size_t value_len;
+} map_entry_t;
+
+// Orders the keys like the bytes objects of Python.
+static int compare_map_entries(const void *a, const void *b) {
+    const map_entry_t *left = a, *right = b;
+    size_t min_len = left->key_len < right->key_len ? left->key_len : right->key_len;
+    int cmp = memcmp(left->key, right->key, min_len);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return left->key_len < right->key_len ? -1 : (left->key_len > right->key_len);
+}
+
+// Adds the Merkleized list of the keys or of the values of the sorted entries.
+static int add_map_list(host_interpreter_t *interpreter,
+                        const map_entry_t *entries,
+                        size_t n_entries,
+                        bool keys,
+                        uint8_t root[static 32]) {
+    size_t total_len = 0;
+    for (size_t i = 0; i < n_entries; i++) {
+        total_len += keys ? entries[i].key_len : entries[i].value_len;
+    }
+
+    uint8_t *elements = malloc(total_len + 1);
+    size_t *lens = malloc(n_entries * sizeof(size_t) + 1);
+    int ret = HOST_ERR_NO_MEMORY;
+    if (elements != NULL && lens != NULL) {
+        size_t offset = 0;
+        for (size_t i = 0; i < n_entries; i++) {
+            lens[i] = keys ? entries[i].key_len : entries[i].value_len;
+            memcpy(elements + offset, keys ? entries[i].key : entries[i].value, lens[i]);
+            offset += lens[i];
+        }
+        ret = host_interpreter_add_known_list(interpreter, elements, lens, n_entries, root);
+    }
+    free(elements);
+    free(lens);
+    return ret;
+}
+
+int host_interpreter_add_known_mapping(host_interpreter_t *interpreter,
+                                       const uint8_t *keys,
+                                       const size_t *key_lens,
+                                       const uint8_t *values,
+                                       const size_t *value_lens,
+                                       size_t n_entries,
+                                       uint8_t commitment[static HOST_MAX_MAP_COMMITMENT_SIZE]) {
+    map_entry_t *entries = malloc(n_entries * sizeof(map_entry_t) + 1);
+    if (entries == NULL) {
+        return HOST_ERR_NO_MEMORY;
+    }
+    for (size_t i = 0; i < n_entries; i++) {
+        entries[i] = (map_entry_t){keys, key_lens[i], values, value_lens[i]};
+        keys += key_lens[i];
+        values += value_lens[i];
+    }
+    qsort(entries, n_entries, sizeof(map_entry_t), compare_map_entries);
+
+    int ret = 0;
+    for (size_t i = 1; i < n_entries; i++) {
+        if (compare_map_entries(&entries[i - 1], &entries[i]) == 0) {
+            ret = HOST_ERR_INVALID_REQUEST;
+        }
+    }
+
+    int varint_len = varint_write(commitment, 0, n_entries);
+    if (ret == 0) {
+        ret = add_map_list(interpreter, entries, n_entries, true, commitment + varint_len);
+    }
+    if (ret == 0) {
+        ret = add_map_list(interpreter, entries, n_entries, false, commitment + varint_len + 32);
+    }
+    free(entries);
+
+    return ret < 0 ? ret : varint_len + 2 * 32;
+}
+
+int host_interpreter_add_known_wallet(host_interpreter_t *interpreter,
+                                      const uint8_t *serialized_wallet,
+                                      size_t serialized_wallet_len,
+                                      const uint8_t *keys_info,
+                                      const size_t *key_info_lens,
+                                      size_t n_keys) {
+    // same validation as the app, when it receives the wallet policy
+    buffer_t buf = buffer_create((void *) serialized_wallet, serialized_wallet_len);
+    policy_map_wallet_header_t header;
+    if (read_policy_map_wallet(&buf, &header) < 0 || buffer_can_read(&buf, 1) ||
+        header.n_keys != n_keys) {
+        return HOST_ERR_INVALID_REQUEST;
+    }
+
+    uint8_t keys_root[32];
+    int ret =
+        host_interpreter_add_known_list(interpreter, keys_info, key_info_lens, n_keys, keys_root);
+    if (ret < 0) {
+        return ret;
+    }
+    if (memcmp(keys_root, header.keys_info_merkle_root, 32) != 0) {
+        return HOST_ERR_INVALID_REQUEST;
+    }
+
+    return host_interpreter_add_known_preimage(interpreter,
+                                               serialized_wallet,
+                                               serialized_wallet_len);
+}
+
+// Appends elements of the given length to the queue for GET_MORE_ELEMENTS.
+static int queue_push(host_interpreter_t *interpreter,
+                      const uint8_t *elements,
+                      size_t n_elements,
+                      size_t element_len) {
+    if (n_elements == 0) {
+        return 0;
+    }
+
+    if (interpreter->queue_begin == interpreter->queue_end) {
+        interpreter->queue_begin = interpreter->queue_end = 0;
+        interpreter->queue_element_len = element_len;
+    } else if (interpreter->queue_element_len != element_len) {
+        return HOST_ERR_INVALID_STATE;
+    }
+
+    size_t len = n_elements * element_len;
+    if (interpreter->queue_end + len > interpreter->queue_capacity) {
+        size_t capacity = 2 * (interpreter->queue_end + len);
+        uint8_t *queue = realloc(interpreter->queue, capacity);
+        if (queue == NULL) {
+            return HOST_ERR_NO_MEMORY;
+        }
+        interpreter->queue = queue;
+        interpreter->queue_capacity = capacity;
+    }
+
+    memcpy(interpreter->queue + interpreter->queue_end, elements, len);
+    interpreter->queue_end += len;
+    return 0;
+}
+
+static bool queue_is_empty(const host_interpreter_t *interpreter) {
+    return interpreter->queue_begin == interpreter->queue_end;
+}
+
+static const host_merkle_tree_t *get_tree(const host_interpreter_t *interpreter,
+                                          const uint8_t root[static 32]) {
+    return table_get(&interpreter->trees, root);
+}
+
+static int execute_yield(host_interpreter_t *interpreter, const uint8_t *request, size_t len) {
+    if (interpreter->n_yielded == interpreter->yielded_capacity) {
+        size_t capacity =
+            interpreter->yielded_capacity == 0 ? 8 : 2 * interpreter->yielded_capacity;
+        yielded_t *yielded = realloc(interpreter->yielded, capacity * sizeof(yielded_t));
+        if (yielded == NULL) {
+            return HOST_ERR_NO_MEMORY;
+        }
+        interpreter->yielded = yielded;
+        interpreter->yielded_capacity = capacity;
+    }
+
+    // only skip the first byte (command code)
+    yielded_t *value = &interpreter->yielded[interpreter->n_yielded];
+    value->len = len - 1;
+    value->data = malloc(value->len + 1);
+    if (value->data == NULL) {
+        return HOST_ERR_NO_MEMORY;
+    }
+    memcpy(value->data, request + 1, value->len);
+    ++interpreter->n_yielded;
+    return 0;
+}
+
+static int execute_get_preimage(host_interpreter_t *interpreter,
+                                buffer_t *req,
+                                uint8_t response[static HOST_MAX_RESPONSE_SIZE]) {
+    uint8_t reserved;
+    uint8_t hash[32];
+    if (!buffer_read_u8(req, &reserved) || reserved != 0 || !buffer_read_bytes(req, hash, 32) ||
+        buffer_can_read(req, 1)) {
+        return HOST_ERR_INVALID_REQUEST;
+    }
+
+    const preimage_t *preimage = table_get(&interpreter->preimages, hash);
+    if (preimage == NULL) {
+        return HOST_ERR_UNKNOWN_DATA;
+    }
+
+    // as many bytes as fit after the two lengths; the rest is queued as 1-byte elements
+    int varint_len = varint_write(response, 0, preimage->len);
+    size_t max_payload_len = HOST_MAX_RESPONSE_SIZE - varint_len - 1;
+    size_t payload_len = preimage->len < max_payload_len ? preimage->len : max_payload_len;
+
+    int ret = queue_push(interpreter, preimage->data + payload_len, preimage->len - payload_len, 1);
+    if (ret < 0) {
+        return ret;
+    }
+
+    response[varint_len] = (uint8_t) payload_len;
+    memcpy(response + varint_len + 1, preimage->data, payload_len);
+    return varint_len + 1 + (int) payload_len;
+}
+
+static int execute_get_merkle_leaf_index(host_interpreter_t *interpreter,
+                                         buffer_t *req,
+                                         uint8_t response[static HOST_MAX_RESPONSE_SIZE]) {
+    uint8_t root[32], leaf_hash[32];
+    if (!buffer_read_bytes(req, root, 32) || !buffer_read_bytes(req, leaf_hash, 32) ||
+        buffer_can_read(req, 1)) {
+        return HOST_ERR_INVALID_REQUEST;
+    }
+
+    const host_merkle_tree_t *tree = get_tree(interpreter, root);
+    if (tree == NULL) {
+        return HOST_ERR_UNKNOWN_DATA;
+    }
+
+    int64_t leaf_index = host_merkle_tree_leaf_index(tree, leaf_hash);
+    response[0] = leaf_index >= 0;
+    return 1 + varint_write(response, 1, leaf_index >= 0 ? (uint64_t) leaf_index : 0);
+}
+
+// Writes the response with the given elements after the prefix, queueing those that do not fit.
+static int respond_with_elements(host_interpreter_t *interpreter,
+                                 uint8_t response[static HOST_MAX_RESPONSE_SIZE],
+                                 size_t prefix_len,
+                                 const uint8_t (*elements)[32],
+                                 size_t n_elements) {
+    size_t max_response_elements = (HOST_MAX_RESPONSE_SIZE - prefix_len - 1) / 32;
+    size_t n_response_elements =
+        n_elements < max_response_elements ? n_elements : max_response_elements;
+
+    int ret = queue_push(interpreter,
+                         elements[n_response_elements],
+                         n_elements - n_response_elements,
+                         32);
+    if (ret < 0) {
+        return ret;
+    }
+
+    response[prefix_len] = (uint8_t) n_response_elements;
+    memcpy(response + prefix_len + 1, elements, n_response_elements * 32);
+    return (int) (prefix_len + 1 + n_response_elements * 32);
+}
+
+static int execute_get_merkle_leaf_proof(host_interpreter_t *interpreter,
+                                         buffer_t *req,
+                                         uint8_t response[static HOST_MAX_RESPONSE_SIZE]) {
+    uint8_t root[32];
+    uint64_t tree_size, leaf_index;
+    uint8_t proof_size;
+    if (!buffer_read_bytes(req, root, 32) || !buffer_read_varint(req, &tree_size) ||
+        !buffer_read_varint(req, &leaf_index) || !buffer_read_u8(req, &proof_size) ||
+        buffer_can_read(req, 1)) {
+        return HOST_ERR_INVALID_REQUEST;
+    }
+
+    const host_merkle_tree_t *tree = get_tree(interpreter, root);
+    if (tree == NULL || leaf_index >= tree_size || tree->n_leaves != tree_size) {
+        return HOST_ERR_UNKNOWN_DATA;
+    }
+    if (!queue_is_empty(interpreter)) {
+        return HOST_ERR_INVALID_STATE;
+    }
+
+    uint8_t proof[MAX_PROOF_ELEMENTS][32];
+    int proof_len = host_merkle_tree_prove_leaf(tree, leaf_index, proof);
+    if (proof_size > proof_len) {
+        return HOST_ERR_INVALID_REQUEST;
+    }
+
+    // the app might only need the first part of the proof, if it already knows the hash of an
+    // ancestor of the leaf
+    memcpy(response, host_merkle_tree_leaf(tree, leaf_index), 32);
+    response[32] = proof_size;
+    return respond_with_elements(interpreter,
+                                 response,
+                                 33,
+                                 (const uint8_t(*)[32]) proof,
+                                 proof_size);
+}
+
+static int execute_get_merkle_leaves_proof(host_interpreter_t *interpreter,
+                                           buffer_t *req,
+                                           uint8_t response[static HOST_MAX_RESPONSE_SIZE]) {
+    uint8_t root[32];
+    uint64_t tree_size, first_leaf_index, n_leaves;
+    if (!buffer_read_bytes(req, root, 32) || !buffer_read_varint(req, &tree_size) ||
+        !buffer_read_varint(req, &first_leaf_index) || !buffer_read_varint(req, &n_leaves) ||
+        buffer_can_read(req, 1)) {
+        return HOST_ERR_INVALID_REQUEST;
+    }
+
+    const host_merkle_tree_t *tree = get_tree(interpreter, root);
+    if (tree == NULL || first_leaf_index >= tree_size || tree->n_leaves != tree_size) {
+        return HOST_ERR_UNKNOWN_DATA;
+    }
+    if (!queue_is_empty(interpreter)) {
+        return HOST_ERR_INVALID_STATE;
+    }
+
+    size_t n_range = n_leaves < tree_size - first_leaf_index ? n_leaves
+                                                             : tree_size - first_leaf_index;
+
+    // the leaves, followed by the proof of their subtree
+    uint8_t(*elements)[32] = malloc((n_range + MAX_PROOF_ELEMENTS) * 32);
+    if (elements == NULL) {
+        return HOST_ERR_NO_MEMORY;
+    }
+    memcpy(elements, host_merkle_tree_leaf(tree, first_leaf_index), n_range * 32);
+
+    int ret = host_merkle_tree_prove_leaves(tree, first_leaf_index, n_leaves, elements + n_range);
+    if (ret < 0) {
+        ret = HOST_ERR_INVALID_REQUEST;
+    } else {
+        response[0] = (uint8_t) ret;
+        ret = respond_with_elements(interpreter,
+                                    response,
+                                    1,
+                                    (const uint8_t(*)[32]) elements,
+                                    n_range + ret);
+    }
+    free(elements);
+    return ret;
+}
+
+static int execute_get_merkleized_map_value(host_interpreter_t *interpreter,
+                                            buffer_t *req,
+                                            uint8_t response[static HOST_MAX_RESPONSE_SIZE]) {
+    uint8_t keys_root[32], values_root[32], key_hash[32];
+    uint64_t size;
+    if (!buffer_read_bytes(req, keys_root, 32) || !buffer_read_bytes(req, values_root, 32) ||
+        !buffer_read_varint(req, &size) || !buffer_read_bytes(req, key_hash, 32) ||
+        buffer_can_read(req, 1)) {
+        return HOST_ERR_INVALID_REQUEST;
+    }
+
+    const host_merkle_tree_t *keys_tree = get_tree(interpreter, keys_root);
+    const host_merkle_tree_t *values_tree = get_tree(interpreter, values_root);
+    if (keys_tree == NULL || values_tree == NULL || keys_tree->n_leaves != size ||
+        values_tree->n_leaves != size) {
+        return HOST_ERR_UNKNOWN_DATA;
+    }
+    if (!queue_is_empty(interpreter)) {
+        return HOST_ERR_INVALID_STATE;
+    }
+
+    int64_t leaf_index = host_merkle_tree_leaf_index(keys_tree, key_hash);
+    if (leaf_index < 0) {
+        response[0] = 0;
+        return 1;
+    }
+
+    const preimage_t *value =
+        table_get(&interpreter->preimages, host_merkle_tree_leaf(values_tree, leaf_index));
+    if (value == NULL) {
+        return HOST_ERR_UNKNOWN_DATA;
+    }
+    size_t value_len = value->len - 1;  // skip the 0x00 prefix of the leaf preimage
+
+    uint8_t key_proof[MAX_PROOF_ELEMENTS][32], value_proof[MAX_PROOF_ELEMENTS][32];
+    int key_proof_len = host_merkle_tree_prove_leaf(keys_tree, leaf_index, key_proof);
+    int value_proof_len = host_merkle_tree_prove_leaf(values_tree, leaf_index, value_proof);
+
+    // 1, the index, the length of the value, the value, the length of the key proof, the proofs
+    uint8_t *full_response = malloc(1 + 9 + 9 + value_len + 1 + 2 * MAX_PROOF_ELEMENTS * 32);
+    if (full_response == NULL) {
+        return HOST_ERR_NO_MEMORY;
+    }
+    size_t len = 0;
+    full_response[len++] = 1;
+    len += varint_write(full_response, len, leaf_index);
+    len += varint_write(full_response, len, value_len);
+    memcpy(full_response + len, value->data + 1, value_len);
+    len += value_len;
+    full_response[len++] = (uint8_t) key_proof_len;
+    memcpy(full_response + len, key_proof, key_proof_len * 32);
+    len += key_proof_len * 32;
+    memcpy(full_response + len, value_proof, value_proof_len * 32);
+    len += value_proof_len * 32;
+
+    // the bytes after the first HOST_MAX_RESPONSE_SIZE are queued as 1-byte elements
+    size_t response_len = len < HOST_MAX_RESPONSE_SIZE ? len : HOST_MAX_RESPONSE_SIZE;
+    int ret = queue_push(interpreter, full_response + response_len, len - response_len, 1);
+    memcpy(response, full_response, response_len);
+    free(full_response);
+
+    return ret < 0 ? ret : (int) response_len;
+}
+
+static int execute_get_preimages(host_interpreter_t *interpreter,
+                                 buffer_t *req,
+                                 uint8_t response[static HOST_MAX_RESPONSE_SIZE]) {
+    uint8_t n_hashes;
+    if (!buffer_read_u8(req, &n_hashes) || n_hashes == 0 || !buffer_can_read(req, n_hashes * 32) ||
+        buffer_can_read(req, n_hashes * 32 + 1)) {
+        return HOST_ERR_INVALID_REQUEST;
+    }
+    if (!queue_is_empty(interpreter)) {
+        return HOST_ERR_INVALID_STATE;
+    }
+
+    const preimage_t *preimages[UINT8_MAX];
+    size_t len = 0;
+    for (size_t i = 0; i < n_hashes; i++) {
+        preimages[i] = table_get(&interpreter->preimages, req->ptr + req->offset + 32 * i);
+        if (preimages[i] == NULL) {
+            return HOST_ERR_UNKNOWN_DATA;
+        }
+        len += 9 + preimages[i]->len;
+    }
+
+    // the length and the preimage of each hash, in order
+    uint8_t *full_response = malloc(len);
+    if (full_response == NULL) {
+        return HOST_ERR_NO_MEMORY;
+    }
+    len = 0;
+    for (size_t i = 0; i < n_hashes; i++) {
+        len += varint_write(full_response, len, preimages[i]->len);
+        memcpy(full_response + len, preimages[i]->data, preimages[i]->len);
+        len += preimages[i]->len;
+    }
+
+    // the bytes after the first HOST_MAX_RESPONSE_SIZE are queued as 1-byte elements
+    size_t response_len = len < HOST_MAX_RESPONSE_SIZE ? len : HOST_MAX_RESPONSE_SIZE;
+    int ret = queue_push(interpreter, full_response + response_len, len - response_len, 1);
+    memcpy(response, full_response, response_len);
+    free(full_response);
+
+    return ret < 0 ? ret : (int) response_len;
+}
+
+static int execute_get_more_elements(host_interpreter_t *interpreter,
+                                     size_t request_len,
+                                     uint8_t response[static HOST_MAX_RESPONSE_SIZE]) {
+    if (request_len != 1) {
+        return HOST_ERR_INVALID_REQUEST;
+    }
+    if (queue_is_empty(interpreter)) {
+        return HOST_ERR_INVALID_STATE;
+    }
+
+    // pop from the queue, keeping the total response length at most HOST_MAX_RESPONSE_SIZE
+    size_t element_len = interpreter->queue_element_len;
+    size_t n_queued = (interpreter->queue_end - interpreter->queue_begin) / element_len;
+    size_t max_elements = (HOST_MAX_RESPONSE_SIZE - 2) / element_len;
+    size_t n_elements = n_queued < max_elements ? n_queued : max_elements;
+
+    response[0] = (uint8_t) n_elements;
+    response[1] = (uint8_t) element_len;
+    memcpy(response + 2, interpreter->queue + interpreter->queue_begin, n_elements * element_len);
+    interpreter->queue_begin += n_elements * element_len;
+
+    return 2 + (int) (n_elements * element_len);
+}
+
+// Executes a request that can be answered in advance, for BATCH or for the prefetched responses,
+// and appends its entry to out. Returns false if it can not be answered in advance, or if the
+// entry does not fit; the state of the execution is unchanged in any case.
+static bool append_response_entry(host_interpreter_t *interpreter,
+                                  const uint8_t *request,
+                                  size_t request_len,
+                                  uint8_t *out,
+                                  size_t *out_len,
+                                  size_t max_size) {
+    if (request_len == 0 || request[0] == CCMD_YIELD || request[0] == CCMD_GET_MORE_ELEMENTS ||
+        request[0] == CCMD_BATCH) {
+        // these requests change the state of the client, or can't be nested
+        return false;
+    }
+
+    uint8_t response[HOST_MAX_RESPONSE_SIZE];
+    int response_len = host_interpreter_execute(interpreter, request, request_len, response);
+    if (response_len < 0) {
+        return false;
+    }
+    if (!queue_is_empty(interpreter)) {
+        // the response does not fit in a single message
+        interpreter->queue_begin = interpreter->queue_end = 0;
+        return false;
+    }
+
+    size_t entry_len = 1 + request_len + 1 + response_len;
+    if (*out_len + entry_len > max_size) {
+        return false;
+    }
+    out[(*out_len)++] = (uint8_t) request_len;
+    memcpy(out + *out_len, request, request_len);
+    *out_len += request_len;
+    out[(*out_len)++] = (uint8_t) response_len;
+    memcpy(out + *out_len, response, response_len);
+    *out_len += response_len;
+    return true;
+}
+
+static int execute_batch(host_interpreter_t *interpreter,
+                         buffer_t *req,
+                         uint8_t response[static HOST_MAX_RESPONSE_SIZE]) {
+    uint8_t n_requests;
+    if (!buffer_read_u8(req, &n_requests)) {
+        return HOST_ERR_INVALID_REQUEST;
+    }
+
+    // validate the whole request first
+    size_t requests_offset = req->offset;
+    for (size_t i = 0; i < n_requests; i++) {
+        uint8_t len;
+        if (!buffer_read_u8(req, &len) || !buffer_seek_cur(req, len)) {
+            return HOST_ERR_INVALID_REQUEST;
+        }
+    }
+    if (buffer_can_read(req, 1)) {
+        return HOST_ERR_INVALID_REQUEST;
+    }
+
+    if (!queue_is_empty(interpreter)) {
+        // the next request will be GET_MORE_ELEMENTS
+        return 0;
+    }
+
+    // keep one byte for the length prefix, in case other responses are pushed with this one
+    size_t response_len = 0;
+    const uint8_t *request = req->ptr + requests_offset;
+    for (size_t i = 0; i < n_requests; i++, request += 1 + request[0]) {
+        if (!append_response_entry(interpreter,
+                                   request + 1,
+                                   request[0],
+                                   response,
+                                   &response_len,
+                                   HOST_MAX_RESPONSE_SIZE - 1)) {
+            break;
+        }
+    }
+    return (int) response_len;
+}
+
+int host_interpreter_execute(host_interpreter_t *interpreter,
+                             const uint8_t *request,
+                             size_t request_len,
+                             uint8_t response[static HOST_MAX_RESPONSE_SIZE]) {
+    if (request_len == 0) {
+        return HOST_ERR_INVALID_REQUEST;
+    }
+
+    buffer_t req = buffer_create((void *) (request + 1), request_len - 1);
+    switch (request[0]) {
+        case CCMD_YIELD:
+            return execute_yield(interpreter, request, request_len);
+        case CCMD_GET_PREIMAGE:
+            return execute_get_preimage(interpreter, &req, response);
+        case CCMD_GET_MERKLE_LEAF_PROOF:
+            return execute_get_merkle_leaf_proof(interpreter, &req, response);
+        case CCMD_GET_MERKLE_LEAF_INDEX:
+            return execute_get_merkle_leaf_index(interpreter, &req, response);
+        case CCMD_GET_MERKLE_LEAVES_PROOF:
+            return execute_get_merkle_leaves_proof(interpreter, &req, response);
+        case CCMD_GET_MERKLEIZED_MAP_VALUE:
+            return execute_get_merkleized_map_value(interpreter, &req, response);
+        case CCMD_GET_PREIMAGES:
+            return execute_get_preimages(interpreter, &req, response);
+        case CCMD_GET_MORE_ELEMENTS:
+            return execute_get_more_elements(interpreter, request_len, response);
+        case CCMD_BATCH:
+            return execute_batch(interpreter, &req, response);
+        default:
+            return HOST_ERR_INVALID_REQUEST;
+    }
+}
+
+size_t host_interpreter_get_prefetched_responses(host_interpreter_t *interpreter,
+                                                 const uint8_t *request,
+                                                 size_t request_len,
+                                                 uint8_t *out,
+                                                 size_t max_size) {
+    size_t out_len = 0;
+    if (request_len == 0 || !queue_is_empty(interpreter) ||
+        (request[0] != CCMD_GET_MERKLE_LEAF_PROOF && request[0] != CCMD_GET_MERKLE_LEAVES_PROOF)) {
+        return 0;
+    }
+
+    buffer_t req = buffer_create((void *) (request + 1), request_len - 1);
+    uint8_t root[32];
+    uint64_t tree_size, first_leaf_index, n_leaves = 1;
+    if (!buffer_read_bytes(&req, root, 32) || !buffer_read_varint(&req, &tree_size) ||
+        !buffer_read_varint(&req, &first_leaf_index) ||
+        (request[0] == CCMD_GET_MERKLE_LEAVES_PROOF && !buffer_read_varint(&req, &n_leaves))) {
+        return 0;
+    }
+
+    const host_merkle_tree_t *tree = get_tree(interpreter, root);
+    if (tree == NULL || tree->n_leaves != tree_size) {
+        return 0;
+    }
+
+    // the preimages of the leaves are usually requested in order, right after their proof
+    uint8_t preimage_request[2 + 32] = {CCMD_GET_PREIMAGE, 0};
+    for (uint64_t i = first_leaf_index; i < tree_size && i - first_leaf_index < n_leaves; i++) {
+        memcpy(preimage_request + 2, host_merkle_tree_leaf(tree, i), 32);
+        if (!append_response_entry(interpreter,
+                                   preimage_request,
+                                   sizeof(preimage_request),
+                                   out,
+                                   &out_len,
+                                   max_size)) {
+            break;
+        }
+    }
+    return out_len;
+}
+
+size_t host_interpreter_n_yielded(const host_interpreter_t *interpreter) {
+    return interpreter->n_yielded;
+}
+
+const uint8_t *host_interpreter_get_yielded(const host_interpreter_t *interpreter,
+                                            size_t i,
+                                            size_t *len) {
+    *len = interpreter->yielded[i].len;
+    return interpreter->yielded[i].data;
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint*_t
+
+/*
+  Interpreter of the client commands (CCMD_*, see doc/bitcoin.md) for the host, with the same
+  semantics as ClientCommandInterpreter in bitcoin_client/client_command.py: it knows a set of
+  preimages and of Merkle trees, and answers the interruptions of the app (SW_INTERRUPTED_EXECUTION)
+  with the payload of the following CONTINUE apdu. It keeps the state of an execution: the queue
+  of the elements that did not fit a response, for GET_MORE_ELEMENTS, and the values sent with
+  YIELD.
+
+  The Merkle trees are computed with the code of the app (common/merkle.c), that hashes in the
+  shared G_cx context: the interpreters are not thread-safe, and only one of them can be used at a
+  time in a process.
+*/
+
+// Maximum length of a response, sent as the payload of a single (short) CONTINUE apdu.
+#define HOST_MAX_RESPONSE_SIZE 255
+
+// Maximum length of a commitment of a Merkleized map: a varint, and two Merkle roots.
+#define HOST_MAX_MAP_COMMITMENT_SIZE (9 + 2 * 32)
+
+typedef enum {
+    HOST_ERR_INVALID_REQUEST = -1,  // malformed request or data, or unknown command code
+    HOST_ERR_UNKNOWN_DATA = -2,     // unknown preimage or Merkle root, or index out of range
+    HOST_ERR_INVALID_STATE = -3,    // the request is not expected in the state of the execution
+    HOST_ERR_NO_MEMORY = -4,
+} host_error_e;
+
+typedef struct host_interpreter_s host_interpreter_t;
+
+/**
+ * Returns a new interpreter without any known data, or NULL if out of memory.
+ */
+host_interpreter_t *host_interpreter_new(void);
+
+/**
+ * Frees an interpreter and all its known data.
+ */
+void host_interpreter_free(host_interpreter_t *interpreter);
+
+/**
+ * Clears the state of an execution (the yielded values and the queue), keeping the known
+ * preimages and Merkle trees, so that the interpreter can be used again for a new request with
+ * the same data.
+ */
+void host_interpreter_reset(host_interpreter_t *interpreter);
+
+/**
+ * Adds a preimage: the interpreter answers GET_PREIMAGE (and GET_PREIMAGES) for sha256(preimage).
+ *
+ * @return 0 on success, or a negative host_error_e.
+ */
+int host_interpreter_add_known_preimage(host_interpreter_t *interpreter,
+                                        const uint8_t *preimage,
+                                        size_t preimage_len);
+
+/**
+ * Adds a Merkleized list: the Merkle tree of the element hashes, and the preimage of each leaf
+ * (the element with the 0x00 prefix).
+ *
+ * @param[in] interpreter
+ *   The interpreter.
+ * @param[in] elements
+ *   The concatenation of the elements.
+ * @param[in] element_lens
+ *   The length of each element.
+ * @param[in] n_elements
+ *   The number of elements.
+ * @param[out] root
+ *   The Merkle root of the list.
+ *
+ * @return 0 on success, or a negative host_error_e.
+ */
+int host_interpreter_add_known_list(host_interpreter_t *interpreter,
+                                    const uint8_t *elements,
+                                    const size_t *element_lens,
+                                    size_t n_elements,
+                                    uint8_t root[static 32]);
+
+/**
+ * Adds a Merkleized map: the Merkleized lists of its keys and of its values, ordered by key, so
+ * that the interpreter can also answer GET_MERKLEIZED_MAP_VALUE for the map. The keys must be
+ * distinct.
+ *
+ * @param[in] interpreter
+ *   The interpreter.
+ * @param[in] keys
+ *   The concatenation of the keys, in any order.
+ * @param[in] key_lens
+ *   The length of each key.
+ * @param[in] values
+ *   The concatenation of the values, in the order of the keys.
+ * @param[in] value_lens
+ *   The length of each value.
+ * @param[in] n_entries
+ *   The number of key/value pairs.
+ * @param[out] commitment
+ *   The commitment of the map: the number of pairs as a varint, the root of the Merkle tree of the
+ *   keys, and the root of the Merkle tree of the values.
+ *
+ * @return the length of the commitment on success, or a negative host_error_e.
+ */
+int host_interpreter_add_known_mapping(host_interpreter_t *interpreter,
+                                       const uint8_t *keys,
+                                       const size_t *key_lens,
+                                       const uint8_t *values,
+                                       const size_t *value_lens,
+                                       size_t n_entries,
+                                       uint8_t commitment[static HOST_MAX_MAP_COMMITMENT_SIZE]);
+
+/**
+ * Adds a wallet policy: its serialization, and the Merkleized list of its keys information. The
+ * serialization is validated with the parser of the app, and must commit to the given keys.
+ *
+ * @param[in] interpreter
+ *   The interpreter.
+ * @param[in] serialized_wallet
+ *   The serialized wallet policy.
+ * @param[in] serialized_wallet_len
+ *   The length of the serialized wallet policy.
+ * @param[in] keys_info
+ *   The concatenation of the keys information.
+ * @param[in] key_info_lens
+ *   The length of each key information.
+ * @param[in] n_keys
+ *   The number of keys.
+ *
+ * @return 0 on success, or a negative host_error_e.
+ */
+int host_interpreter_add_known_wallet(host_interpreter_t *interpreter,
+                                      const uint8_t *serialized_wallet,
+                                      size_t serialized_wallet_len,
+                                      const uint8_t *keys_info,
+                                      const size_t *key_info_lens,
+                                      size_t n_keys);
+
+/**
+ * Interprets the client command requested by the app, updating the state of the execution.
+ *
+ * @param[in] interpreter
+ *   The interpreter.
+ * @param[in] request
+ *   The data of the SW_INTERRUPTED_EXECUTION response of the app.
+ * @param[in] request_len
+ *   The length of the request.
+ * @param[out] response
+ *   The payload of the CONTINUE apdu.
+ *
+ * @return the length of the response on success, or a negative host_error_e.
+ */
+int host_interpreter_execute(host_interpreter_t *interpreter,
+                             const uint8_t *request,
+                             size_t request_len,
+                             uint8_t response[static HOST_MAX_RESPONSE_SIZE]);
+
+/**
+ * Returns the responses to the requests that the app is likely to send after the given one (which
+ * must have already been executed), to be pushed in advance with its response; they are serialized
+ * like the response to BATCH, and only the responses that fit a single message are pushed.
+ *
+ * @param[in] interpreter
+ *   The interpreter.
+ * @param[in] request
+ *   The request that was executed.
+ * @param[in] request_len
+ *   The length of the request.
+ * @param[out] out
+ *   The concatenation of the serialized responses.
+ * @param[in] max_size
+ *   The size of out.
+ *
+ * @return the length of the serialized responses.
+ */
+size_t host_interpreter_get_prefetched_responses(host_interpreter_t *interpreter,
+                                                 const uint8_t *request,
+                                                 size_t request_len,
+                                                 uint8_t *out,
+                                                 size_t max_size);
+
+/**
+ * Returns the number of values sent by the app with YIELD since the last reset.
+ */
+size_t host_interpreter_n_yielded(const host_interpreter_t *interpreter);
+
+/**
+ * Returns the i-th value sent by the app with YIELD, and its length in *len.
+ */
+const uint8_t *host_interpreter_get_yielded(const host_interpreter_t *interpreter,
+                                            size_t i,
+                                            size_t *len);
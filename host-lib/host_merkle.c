@@ -0,0 +1,166 @@
+#include <stdlib.h>  // malloc, free, qsort
+#include <string.h>  // memcpy, memcmp, memset
+
+#include "common/merkle.h"
+
+#include "host_merkle.h"
+
+typedef struct {
+    uint8_t hash[32];
+    uint32_t index;
+} sorted_leaf_t;
+
+static int compare_sorted_leaves(const void *a, const void *b) {
+    const sorted_leaf_t *left = a, *right = b;
+    int cmp = memcmp(left->hash, right->hash, 32);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return left->index < right->index ? -1 : (left->index > right->index);
+}
+
+static int index_leaves(host_merkle_tree_t *tree) {
+    sorted_leaf_t *leaves = malloc(tree->n_leaves * sizeof(sorted_leaf_t));
+    tree->sorted_leaves = malloc(tree->n_leaves * sizeof(uint32_t));
+    if (leaves == NULL || tree->sorted_leaves == NULL) {
+        free(leaves);
+        return -1;
+    }
+
+    for (size_t i = 0; i < tree->n_leaves; i++) {
+        memcpy(leaves[i].hash, tree->level[0][i], 32);
+        leaves[i].index = (uint32_t) i;
+    }
+    qsort(leaves, tree->n_leaves, sizeof(sorted_leaf_t), compare_sorted_leaves);
+    for (size_t i = 0; i < tree->n_leaves; i++) {
+        tree->sorted_leaves[i] = leaves[i].index;
+    }
+
+    free(leaves);
+    return 0;
+}
+
+int host_merkle_tree_init(host_merkle_tree_t *tree,
+                          const uint8_t (*leaf_hashes)[32],
+                          size_t n_leaves) {
+    memset(tree, 0, sizeof(host_merkle_tree_t));
+
+    if (n_leaves == 0) {
+        return 0;
+    }
+    if (n_leaves > UINT32_MAX) {
+        return -1;
+    }
+
+    // sizes of the levels, up to the root
+    size_t n_nodes = 0;
+    for (size_t size = n_leaves;; size = (size + 1) / 2) {
+        tree->level_size[tree->n_levels++] = size;
+        n_nodes += size;
+        if (size == 1) {
+            break;
+        }
+    }
+
+    tree->nodes = malloc(n_nodes * 32);
+    if (tree->nodes == NULL) {
+        return -1;
+    }
+    tree->n_leaves = n_leaves;
+
+    size_t offset = 0;
+    for (size_t k = 0; k < tree->n_levels; k++) {
+        tree->level[k] = tree->nodes + offset;
+        offset += tree->level_size[k];
+    }
+
+    memcpy(tree->level[0], leaf_hashes, n_leaves * 32);
+    for (size_t k = 1; k < tree->n_levels; k++) {
+        uint8_t(*below)[32] = tree->level[k - 1];
+        size_t below_size = tree->level_size[k - 1];
+
+        for (size_t i = 0; 2 * i + 1 < below_size; i++) {
+            merkle_combine_hashes(below[2 * i], below[2 * i + 1], tree->level[k][i]);
+        }
+        if (below_size % 2 == 1) {
+            // no sibling, the node is moved up unchanged
+            memcpy(tree->level[k][below_size / 2], below[below_size - 1], 32);
+        }
+    }
+
+    return index_leaves(tree);
+}
+
+void host_merkle_tree_free(host_merkle_tree_t *tree) {
+    free(tree->nodes);
+    free(tree->sorted_leaves);
+    memset(tree, 0, sizeof(host_merkle_tree_t));
+}
+
+void host_merkle_tree_root(const host_merkle_tree_t *tree, uint8_t out[static 32]) {
+    if (tree->n_levels == 0) {
+        memset(out, 0, 32);
+    } else {
+        memcpy(out, tree->level[tree->n_levels - 1][0], 32);
+    }
+}
+
+size_t host_merkle_tree_prove_node(const host_merkle_tree_t *tree,
+                                   size_t height,
+                                   size_t index,
+                                   uint8_t (*proof)[32]) {
+    size_t n_elements = 0;
+    for (; height + 1 < tree->n_levels; height++, index /= 2) {
+        size_t sibling_index = index ^ 1;
+        if (sibling_index < tree->level_size[height]) {
+            memcpy(proof[n_elements++], tree->level[height][sibling_index], 32);
+        }
+    }
+    return n_elements;
+}
+
+int host_merkle_tree_prove_leaf(const host_merkle_tree_t *tree,
+                                size_t index,
+                                uint8_t (*proof)[32]) {
+    if (index >= tree->n_leaves) {
+        return -1;
+    }
+    return (int) host_merkle_tree_prove_node(tree, 0, index, proof);
+}
+
+int host_merkle_tree_prove_leaves(const host_merkle_tree_t *tree,
+                                  size_t first_index,
+                                  size_t n_leaves,
+                                  uint8_t (*proof)[32]) {
+    if (n_leaves == 0 || (n_leaves & (n_leaves - 1)) != 0 || first_index % n_leaves != 0 ||
+        first_index >= tree->n_leaves) {
+        return -1;
+    }
+
+    // the node at height log2(n_leaves) is the root of the subtree; if the range is truncated by
+    // the end of the vector, it is the lowest ancestor containing all the remaining leaves
+    size_t height = 0;
+    while (((size_t) 1 << height) < n_leaves && height + 1 < tree->n_levels) {
+        ++height;
+    }
+
+    return (int) host_merkle_tree_prove_node(tree, height, first_index >> height, proof);
+}
+
+int64_t host_merkle_tree_leaf_index(const host_merkle_tree_t *tree, const uint8_t hash[static 32]) {
+    // lower bound in the sorted leaves, so that the first of the equal leaves is found
+    size_t lo = 0, hi = tree->n_leaves;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (memcmp(tree->level[0][tree->sorted_leaves[mid]], hash, 32) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo < tree->n_leaves && memcmp(tree->level[0][tree->sorted_leaves[lo]], hash, 32) == 0) {
+        return tree->sorted_leaves[lo];
+    }
+    return -1;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stddef.h>   // size_t
+#include <stdint.h>   // uint*_t
+#include <stdbool.h>  // bool
+
+// Maximum number of levels of a tree; the leaves are indexed by 32-bit integers in the protocol.
+#define HOST_MERKLE_MAX_LEVELS 33
+
+/*
+  A Merkle tree of the host, built on top of a vector of leaf hashes, with the same shape as the
+  trees of the app (see common/merkle.h): the tree is stored level by level, levels[0] being the
+  leaves, and levels[k][i] the ancestor at height k of the leaves with index from i * 2^k to
+  (i + 1) * 2^k - 1. If a level has an odd number of nodes, the last one has no sibling, and it is
+  moved up unchanged to the next level. This is the representation of MerkleTree in
+  bitcoin_client/merkle.py.
+
+  The leaf hashes are also indexed by value, so that the index of a leaf is found in O(log n).
+*/
+typedef struct {
+    size_t n_leaves;
+    size_t n_levels;                          // 0 for an empty tree
+    size_t level_size[HOST_MERKLE_MAX_LEVELS];
+    uint8_t (*level[HOST_MERKLE_MAX_LEVELS])[32];  // pointers inside nodes
+    uint8_t (*nodes)[32];                     // all the levels, one after the other
+    uint32_t *sorted_leaves;                  // leaf indexes, sorted by hash and then by index
+} host_merkle_tree_t;
+
+/**
+ * Builds the Merkle tree of the given leaf hashes.
+ *
+ * @param[out] tree
+ *   The tree; it must be freed with host_merkle_tree_free, even on failure.
+ * @param[in] leaf_hashes
+ *   The hashes of the leaves (see merkle_compute_element_hash).
+ * @param[in] n_leaves
+ *   The number of leaves.
+ *
+ * @return 0 on success, -1 on failure (too many leaves, or out of memory).
+ */
+int host_merkle_tree_init(host_merkle_tree_t *tree,
+                          const uint8_t (*leaf_hashes)[32],
+                          size_t n_leaves);
+
+/**
+ * Frees the memory of a tree initialized with host_merkle_tree_init.
+ */
+void host_merkle_tree_free(host_merkle_tree_t *tree);
+
+/**
+ * Computes the root of the tree: 32 zero bytes for an empty tree, like merkle_compute_root.
+ */
+void host_merkle_tree_root(const host_merkle_tree_t *tree, uint8_t out[static 32]);
+
+/**
+ * Returns the hash of the leaf with the given index, which must be less than the number of leaves.
+ */
+static inline const uint8_t *host_merkle_tree_leaf(const host_merkle_tree_t *tree, size_t index) {
+    return tree->level[0][index];
+}
+
+/**
+ * Produces the Merkle proof of the node at the given height and index: the siblings of the node
+ * and of its ancestors, from the bottom up, skipping the nodes without a sibling.
+ *
+ * @param[in] tree
+ *   The tree.
+ * @param[in] height
+ *   The height of the node, less than the number of levels of the tree.
+ * @param[in] index
+ *   The index of the node in its level.
+ * @param[out] proof
+ *   The elements of the proof; it must have room for HOST_MERKLE_MAX_LEVELS - 1 elements.
+ *
+ * @return the number of elements of the proof.
+ */
+size_t host_merkle_tree_prove_node(const host_merkle_tree_t *tree,
+                                   size_t height,
+                                   size_t index,
+                                   uint8_t (*proof)[32]);
+
+/**
+ * Produces the Merkle proof of the leaf with the given index.
+ *
+ * @return the number of elements of the proof, or -1 if the index is out of range.
+ */
+int host_merkle_tree_prove_leaf(const host_merkle_tree_t *tree,
+                                size_t index,
+                                uint8_t (*proof)[32]);
+
+/**
+ * Produces the Merkle proof of the subtree containing the leaves with indexes from first_index to
+ * first_index + n_leaves - 1 (or the last leaf, if smaller). n_leaves must be a power of 2, and
+ * first_index a multiple of n_leaves, so that the range of leaves is exactly the set of leaves of
+ * a subtree.
+ *
+ * @return the number of elements of the proof, or -1 if the range is invalid.
+ */
+int host_merkle_tree_prove_leaves(const host_merkle_tree_t *tree,
+                                  size_t first_index,
+                                  size_t n_leaves,
+                                  uint8_t (*proof)[32]);
+
+/**
+ * Returns the index of the first leaf with the given hash, or -1 if there is none.
+ */
+int64_t host_merkle_tree_leaf_index(const host_merkle_tree_t *tree, const uint8_t hash[static 32]);
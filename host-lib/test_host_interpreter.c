@@ -0,0 +1,527 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "os.h"
+#include "cx.h"
+
+#include "common/merkle.h"
+#include "common/wallet.h"
+#include "handler/client_commands.h"
+
+#include "host_interpreter.h"
+
+static void sha256(const uint8_t *in, size_t in_len, uint8_t out[static 32]) {
+    cx_sha256_t hash;
+    cx_sha256_init_no_throw(&hash);
+    cx_hash_no_throw(&hash.header, CX_LAST, in, in_len, out, 32);
+}
+
+static void element_hash(const uint8_t *element, size_t len, uint8_t out[static 32]) {
+    uint8_t preimage[256];
+    preimage[0] = 0x00;
+    memcpy(preimage + 1, element, len);
+    sha256(preimage, 1 + len, out);
+}
+
+static int execute(host_interpreter_t *interpreter,
+                   const uint8_t *request,
+                   size_t request_len,
+                   uint8_t response[static HOST_MAX_RESPONSE_SIZE]) {
+    return host_interpreter_execute(interpreter, request, request_len, response);
+}
+
+// Drains the queue with GET_MORE_ELEMENTS, appending the elements to out; returns their length.
+static size_t get_more_elements(host_interpreter_t *interpreter, uint8_t *out, size_t element_len) {
+    const uint8_t request[] = {CCMD_GET_MORE_ELEMENTS};
+    uint8_t response[HOST_MAX_RESPONSE_SIZE];
+    size_t len = 0;
+
+    int response_len;
+    while ((response_len = execute(interpreter, request, 1, response)) >= 0) {
+        assert_true(response[0] > 0);
+        assert_int_equal(response[1], element_len);
+        assert_int_equal(response_len, 2 + response[0] * element_len);
+        memcpy(out + len, response + 2, response_len - 2);
+        len += response_len - 2;
+    }
+    assert_int_equal(response_len, HOST_ERR_INVALID_STATE);
+    return len;
+}
+
+// Adds a list of 20 elements of 20 bytes, the i-th being made of bytes equal to i.
+static void add_test_list(host_interpreter_t *interpreter,
+                          uint8_t root[static 32],
+                          uint8_t leaves[static 20][32]) {
+    uint8_t elements[20 * 20];
+    size_t lens[20];
+    for (size_t i = 0; i < 20; i++) {
+        memset(elements + 20 * i, (int) i, 20);
+        lens[i] = 20;
+        element_hash(elements + 20 * i, 20, leaves[i]);
+    }
+    assert_int_equal(host_interpreter_add_known_list(interpreter, elements, lens, 20, root), 0);
+
+    uint8_t expected_root[32];
+    merkle_compute_root((const uint8_t(*)[32]) leaves, 20, expected_root);
+    assert_memory_equal(root, expected_root, 32);
+}
+
+static void test_get_preimage(void **state) {
+    (void) state;
+
+    host_interpreter_t *interpreter = host_interpreter_new();
+
+    uint8_t preimage[600];
+    for (size_t i = 0; i < sizeof(preimage); i++) {
+        preimage[i] = (uint8_t) (i * 7);
+    }
+    assert_int_equal(host_interpreter_add_known_preimage(interpreter, preimage, sizeof(preimage)),
+                     0);
+
+    uint8_t request[2 + 32] = {CCMD_GET_PREIMAGE, 0};
+    sha256(preimage, sizeof(preimage), request + 2);
+
+    // the length of the preimage (3-byte varint), the length of the partial preimage, its bytes
+    uint8_t response[HOST_MAX_RESPONSE_SIZE];
+    assert_int_equal(execute(interpreter, request, sizeof(request), response),
+                     HOST_MAX_RESPONSE_SIZE);
+    const uint8_t expected_prefix[] = {0xFD, 600 & 0xFF, 600 >> 8, HOST_MAX_RESPONSE_SIZE - 4};
+    assert_memory_equal(response, expected_prefix, sizeof(expected_prefix));
+
+    uint8_t received[600];
+    memcpy(received, response + 4, HOST_MAX_RESPONSE_SIZE - 4);
+    assert_int_equal(get_more_elements(interpreter, received + HOST_MAX_RESPONSE_SIZE - 4, 1),
+                     600 - (HOST_MAX_RESPONSE_SIZE - 4));
+    assert_memory_equal(received, preimage, sizeof(preimage));
+
+    // unknown preimage, and malformed requests
+    request[2] ^= 1;
+    assert_int_equal(execute(interpreter, request, sizeof(request), response),
+                     HOST_ERR_UNKNOWN_DATA);
+    request[1] = 1;
+    assert_int_equal(execute(interpreter, request, sizeof(request), response),
+                     HOST_ERR_INVALID_REQUEST);
+    assert_int_equal(execute(interpreter, request, sizeof(request) - 1, response),
+                     HOST_ERR_INVALID_REQUEST);
+
+    host_interpreter_free(interpreter);
+}
+
+static void test_get_preimages(void **state) {
+    (void) state;
+
+    host_interpreter_t *interpreter = host_interpreter_new();
+
+    // a short preimage, and one that overflows the first response
+    uint8_t short_preimage[] = {0x00, 0x01, 0x02};
+    uint8_t long_preimage[300];
+    memset(long_preimage, 0x5A, sizeof(long_preimage));
+    assert_int_equal(host_interpreter_add_known_preimage(interpreter,
+                                                         short_preimage,
+                                                         sizeof(short_preimage)),
+                     0);
+    assert_int_equal(host_interpreter_add_known_preimage(interpreter,
+                                                         long_preimage,
+                                                         sizeof(long_preimage)),
+                     0);
+
+    uint8_t request[2 + 2 * 32] = {CCMD_GET_PREIMAGES, 2};
+    sha256(short_preimage, sizeof(short_preimage), request + 2);
+    sha256(long_preimage, sizeof(long_preimage), request + 2 + 32);
+
+    // the length (varint) and the bytes of each preimage, in order
+    uint8_t response[HOST_MAX_RESPONSE_SIZE];
+    assert_int_equal(execute(interpreter, request, sizeof(request), response),
+                     HOST_MAX_RESPONSE_SIZE);
+
+    size_t full_len = 1 + 3 + 3 + 300;
+    uint8_t full_response[1 + 3 + 3 + 300];
+    memcpy(full_response, response, HOST_MAX_RESPONSE_SIZE);
+    assert_int_equal(get_more_elements(interpreter, full_response + HOST_MAX_RESPONSE_SIZE, 1),
+                     full_len - HOST_MAX_RESPONSE_SIZE);
+    const uint8_t expected_prefix[] = {3, 0x00, 0x01, 0x02, 0xFD, 300 & 0xFF, 300 >> 8};
+    assert_memory_equal(full_response, expected_prefix, sizeof(expected_prefix));
+    assert_memory_equal(full_response + 7, long_preimage, 300);
+
+    // one unknown preimage, and malformed requests
+    request[2 + 32] ^= 1;
+    assert_int_equal(execute(interpreter, request, sizeof(request), response),
+                     HOST_ERR_UNKNOWN_DATA);
+    assert_int_equal(execute(interpreter, request, sizeof(request) - 1, response),
+                     HOST_ERR_INVALID_REQUEST);
+    request[1] = 0;
+    assert_int_equal(execute(interpreter, request, 2, response), HOST_ERR_INVALID_REQUEST);
+
+    host_interpreter_free(interpreter);
+}
+
+static void test_get_merkle_leaf_proof_and_index(void **state) {
+    (void) state;
+
+    host_interpreter_t *interpreter = host_interpreter_new();
+    uint8_t root[32], leaves[20][32];
+    add_test_list(interpreter, root, leaves);
+
+    for (size_t index = 0; index < 20; index++) {
+        uint32_t directions;
+        int proof_len = merkle_get_directions(20, index, &directions);
+
+        // root, tree size, leaf index, proof size
+        uint8_t request[1 + 32 + 3] = {CCMD_GET_MERKLE_LEAF_PROOF};
+        memcpy(request + 1, root, 32);
+        request[33] = 20;
+        request[34] = (uint8_t) index;
+        request[35] = (uint8_t) proof_len;
+
+        // the leaf, the length of the proof, the number of elements in the response, the elements
+        uint8_t response[HOST_MAX_RESPONSE_SIZE];
+        int response_len = execute(interpreter, request, sizeof(request), response);
+        assert_int_equal(response_len, 34 + 32 * proof_len);
+        assert_memory_equal(response, leaves[index], 32);
+        assert_int_equal(response[32], proof_len);
+        assert_int_equal(response[33], proof_len);
+
+        uint8_t cur_hash[32];
+        memcpy(cur_hash, leaves[index], 32);
+        assert_int_equal(
+            merkle_climb_proof(cur_hash, response + 34, proof_len, directions, proof_len),
+            0);
+        assert_memory_equal(cur_hash, root, 32);
+
+        // only the first part of the proof
+        request[35] = 1;
+        assert_int_equal(execute(interpreter, request, sizeof(request), response), 34 + 32);
+
+        // the index, from the leaf hash
+        uint8_t index_request[1 + 32 + 32] = {CCMD_GET_MERKLE_LEAF_INDEX};
+        memcpy(index_request + 1, root, 32);
+        memcpy(index_request + 33, leaves[index], 32);
+        assert_int_equal(execute(interpreter, index_request, sizeof(index_request), response), 2);
+        assert_int_equal(response[0], 1);
+        assert_int_equal(response[1], index);
+
+        // the preimage of the leaf is pushed in advance
+        uint8_t prefetched[HOST_MAX_RESPONSE_SIZE];
+        size_t prefetched_len = host_interpreter_get_prefetched_responses(interpreter,
+                                                                          request,
+                                                                          sizeof(request),
+                                                                          prefetched,
+                                                                          sizeof(prefetched));
+        assert_int_equal(prefetched_len, 1 + 34 + 1 + 1 + 1 + 21);
+        assert_int_equal(prefetched[0], 34);
+        assert_memory_equal(prefetched + 3, leaves[index], 32);
+        assert_int_equal(prefetched[35], 1 + 1 + 21);
+    }
+
+    uint8_t response[HOST_MAX_RESPONSE_SIZE];
+
+    // a leaf that is not in the tree
+    uint8_t index_request[1 + 32 + 32] = {CCMD_GET_MERKLE_LEAF_INDEX};
+    memcpy(index_request + 1, root, 32);
+    assert_int_equal(execute(interpreter, index_request, sizeof(index_request), response), 2);
+    assert_int_equal(response[0], 0);
+
+    // wrong tree size, proof longer than the path, and unknown root
+    uint8_t request[1 + 32 + 3] = {CCMD_GET_MERKLE_LEAF_PROOF};
+    memcpy(request + 1, root, 32);
+    request[33] = 21;
+    assert_int_equal(execute(interpreter, request, sizeof(request), response),
+                     HOST_ERR_UNKNOWN_DATA);
+    request[33] = 20;
+    request[35] = 6;
+    assert_int_equal(execute(interpreter, request, sizeof(request), response),
+                     HOST_ERR_INVALID_REQUEST);
+    request[1] ^= 1;
+    assert_int_equal(execute(interpreter, request, sizeof(request), response),
+                     HOST_ERR_UNKNOWN_DATA);
+
+    host_interpreter_free(interpreter);
+}
+
+static void test_get_merkle_leaves_proof(void **state) {
+    (void) state;
+
+    host_interpreter_t *interpreter = host_interpreter_new();
+    uint8_t root[32], leaves[20][32];
+    add_test_list(interpreter, root, leaves);
+
+    // root, tree size, first leaf index, number of leaves: all of them
+    uint8_t request[1 + 32 + 3] = {CCMD_GET_MERKLE_LEAVES_PROOF};
+    memcpy(request + 1, root, 32);
+    request[33] = 20;
+    request[34] = 0;
+    request[35] = 32;
+
+    // the length of the proof, the number of elements in the response, the elements
+    uint8_t response[HOST_MAX_RESPONSE_SIZE];
+    assert_int_equal(execute(interpreter, request, sizeof(request), response), 2 + 7 * 32);
+    assert_int_equal(response[0], 0);
+    assert_int_equal(response[1], 7);
+
+    uint8_t received[20][32];
+    memcpy(received, response + 2, 7 * 32);
+    assert_int_equal(get_more_elements(interpreter, received[7], 32), 13 * 32);
+    assert_memory_equal(received, leaves, sizeof(leaves));
+
+    // the last 4 leaves, and the proof of their subtree: the root of the first 16 leaves
+    request[34] = 16;
+    request[35] = 4;
+    assert_int_equal(execute(interpreter, request, sizeof(request), response), 2 + 5 * 32);
+    assert_int_equal(response[0], 1);
+    assert_int_equal(response[1], 5);
+    assert_memory_equal(response + 2, leaves[16], 4 * 32);
+    uint8_t left_root[32];
+    merkle_compute_root((const uint8_t(*)[32]) leaves, 16, left_root);
+    assert_memory_equal(response + 2 + 4 * 32, left_root, 32);
+
+    // not a subtree
+    request[35] = 3;
+    assert_int_equal(execute(interpreter, request, sizeof(request), response),
+                     HOST_ERR_INVALID_REQUEST);
+
+    host_interpreter_free(interpreter);
+}
+
+static void test_get_merkleized_map_value(void **state) {
+    (void) state;
+
+    host_interpreter_t *interpreter = host_interpreter_new();
+
+    // not sorted: the keys are sorted like bytes, so "\x01" < "\x01\x00" < "\x02"
+    const uint8_t keys[] = {0x02, 0x01, 0x00, 0x01};
+    const size_t key_lens[] = {1, 2, 1};
+    uint8_t values[300 + 1 + 2];
+    memset(values, 0xAB, 300);
+    values[300] = 0xCD;
+    values[301] = 0xEF;
+    values[302] = 0x42;
+    const size_t value_lens[] = {300, 2, 1};
+
+    uint8_t commitment[HOST_MAX_MAP_COMMITMENT_SIZE];
+    assert_int_equal(host_interpreter_add_known_mapping(interpreter,
+                                                        keys,
+                                                        key_lens,
+                                                        values,
+                                                        value_lens,
+                                                        3,
+                                                        commitment),
+                     1 + 64);
+    assert_int_equal(commitment[0], 3);
+
+    uint8_t sorted_key_hashes[3][32];
+    element_hash((const uint8_t[]){0x01}, 1, sorted_key_hashes[0]);
+    element_hash((const uint8_t[]){0x01, 0x00}, 2, sorted_key_hashes[1]);
+    element_hash((const uint8_t[]){0x02}, 1, sorted_key_hashes[2]);
+    uint8_t keys_root[32];
+    merkle_compute_root((const uint8_t(*)[32]) sorted_key_hashes, 3, keys_root);
+    assert_memory_equal(commitment + 1, keys_root, 32);
+
+    // keys root, values root, size, key hash
+    uint8_t request[1 + 32 + 32 + 1 + 32] = {CCMD_GET_MERKLEIZED_MAP_VALUE};
+    memcpy(request + 1, commitment + 1, 64);
+    request[65] = 3;
+
+    // the key 0x02 is the last one, with the value of 300 bytes
+    memcpy(request + 66, sorted_key_hashes[2], 32);
+    uint8_t response[HOST_MAX_RESPONSE_SIZE];
+    assert_int_equal(execute(interpreter, request, sizeof(request), response),
+                     HOST_MAX_RESPONSE_SIZE);
+
+    // 1, index, length of the value (varint), value, length of the key proof, key and value proofs
+    size_t full_len = 1 + 1 + 3 + 300 + 1 + 32 + 32;
+    uint8_t full_response[1 + 1 + 3 + 300 + 1 + 32 + 32];
+    memcpy(full_response, response, HOST_MAX_RESPONSE_SIZE);
+    assert_int_equal(get_more_elements(interpreter, full_response + HOST_MAX_RESPONSE_SIZE, 1),
+                     full_len - HOST_MAX_RESPONSE_SIZE);
+    const uint8_t expected_prefix[] = {1, 2, 0xFD, 300 & 0xFF, 300 >> 8};
+    assert_memory_equal(full_response, expected_prefix, sizeof(expected_prefix));
+    assert_memory_equal(full_response + 5, values, 300);
+    assert_int_equal(full_response[305], 1);
+
+    // the key 0x01 has the 1-byte value
+    memcpy(request + 66, sorted_key_hashes[0], 32);
+    assert_int_equal(execute(interpreter, request, sizeof(request), response),
+                     1 + 1 + 1 + 1 + 1 + 2 * 2 * 32);
+    const uint8_t expected_short[] = {1, 0, 1, 0x42, 2};
+    assert_memory_equal(response, expected_short, sizeof(expected_short));
+
+    // a missing key
+    request[66] ^= 1;
+    assert_int_equal(execute(interpreter, request, sizeof(request), response), 1);
+    assert_int_equal(response[0], 0);
+
+    // repeated keys are rejected
+    assert_int_equal(host_interpreter_add_known_mapping(interpreter,
+                                                        (const uint8_t[]){0x01, 0x01},
+                                                        (const size_t[]){1, 1},
+                                                        values,
+                                                        (const size_t[]){1, 1},
+                                                        2,
+                                                        commitment),
+                     HOST_ERR_INVALID_REQUEST);
+
+    host_interpreter_free(interpreter);
+}
+
+static void test_batch(void **state) {
+    (void) state;
+
+    host_interpreter_t *interpreter = host_interpreter_new();
+    uint8_t root[32], leaves[20][32];
+    add_test_list(interpreter, root, leaves);
+
+    // the preimages of 8 leaves: each entry has 1 + 34 + 1 + 23 bytes, and only 4 fit
+    uint8_t request[2 + 8 * (1 + 34)] = {CCMD_BATCH, 8};
+    for (size_t i = 0; i < 8; i++) {
+        uint8_t *entry = request + 2 + i * (1 + 34);
+        entry[0] = 34;
+        entry[1] = CCMD_GET_PREIMAGE;
+        entry[2] = 0;
+        memcpy(entry + 3, leaves[i], 32);
+    }
+
+    uint8_t response[HOST_MAX_RESPONSE_SIZE];
+    assert_int_equal(execute(interpreter, request, sizeof(request), response),
+                     4 * (1 + 34 + 1 + 23));
+    for (size_t i = 0; i < 4; i++) {
+        const uint8_t *entry = response + i * (1 + 34 + 1 + 23);
+        assert_memory_equal(entry, request + 2 + i * (1 + 34), 1 + 34);
+        const uint8_t expected_preimage_prefix[] = {23, 21, 21, 0x00};
+        assert_memory_equal(entry + 35,
+                            expected_preimage_prefix,
+                            sizeof(expected_preimage_prefix));
+    }
+
+    // responses to requests that change the state are never returned
+    const uint8_t yield_batch[] = {CCMD_BATCH, 1, 2, CCMD_YIELD, 0x42};
+    assert_int_equal(execute(interpreter, yield_batch, sizeof(yield_batch), response), 0);
+    assert_int_equal(host_interpreter_n_yielded(interpreter), 0);
+
+    // malformed
+    assert_int_equal(execute(interpreter, request, sizeof(request) - 1, response),
+                     HOST_ERR_INVALID_REQUEST);
+
+    host_interpreter_free(interpreter);
+}
+
+static void test_yield_and_reset(void **state) {
+    (void) state;
+
+    host_interpreter_t *interpreter = host_interpreter_new();
+
+    const uint8_t request_1[] = {CCMD_YIELD, 0x01, 0x02, 0x03};
+    const uint8_t request_2[] = {CCMD_YIELD};
+    uint8_t response[HOST_MAX_RESPONSE_SIZE];
+    assert_int_equal(execute(interpreter, request_1, sizeof(request_1), response), 0);
+    assert_int_equal(execute(interpreter, request_2, sizeof(request_2), response), 0);
+
+    size_t len;
+    assert_int_equal(host_interpreter_n_yielded(interpreter), 2);
+    assert_memory_equal(host_interpreter_get_yielded(interpreter, 0, &len), request_1 + 1, 3);
+    assert_int_equal(len, 3);
+    host_interpreter_get_yielded(interpreter, 1, &len);
+    assert_int_equal(len, 0);
+
+    // the queue and the yielded values are cleared, the known data is kept
+    uint8_t preimage[300] = {0};
+    assert_int_equal(host_interpreter_add_known_preimage(interpreter, preimage, sizeof(preimage)),
+                     0);
+    uint8_t preimage_request[2 + 32] = {CCMD_GET_PREIMAGE, 0};
+    sha256(preimage, sizeof(preimage), preimage_request + 2);
+    assert_int_equal(execute(interpreter, preimage_request, sizeof(preimage_request), response),
+                     HOST_MAX_RESPONSE_SIZE);
+
+    host_interpreter_reset(interpreter);
+    assert_int_equal(host_interpreter_n_yielded(interpreter), 0);
+    const uint8_t more_elements[] = {CCMD_GET_MORE_ELEMENTS};
+    assert_int_equal(execute(interpreter, more_elements, 1, response), HOST_ERR_INVALID_STATE);
+    assert_int_equal(execute(interpreter, preimage_request, sizeof(preimage_request), response),
+                     HOST_MAX_RESPONSE_SIZE);
+
+    // unknown command
+    const uint8_t unknown[] = {0x55};
+    assert_int_equal(execute(interpreter, unknown, 1, response), HOST_ERR_INVALID_REQUEST);
+
+    host_interpreter_free(interpreter);
+}
+
+static void test_add_known_wallet(void **state) {
+    (void) state;
+
+    host_interpreter_t *interpreter = host_interpreter_new();
+
+    const char key_info[] =
+        "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9"
+        "bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**";
+    const size_t key_info_len = sizeof(key_info) - 1;
+    uint8_t keys_root[32];
+    element_hash((const uint8_t *) key_info, key_info_len, keys_root);
+
+    // type, name, policy map, number of keys, root of the keys information
+    uint8_t wallet[1 + 1 + 4 + 1 + 8 + 1 + 32] =
+        {WALLET_TYPE_POLICY_MAP, 4, 'T', 'e', 's', 't', 8};
+    memcpy(wallet + 7, "wpkh(@0)", 8);
+    wallet[15] = 1;
+    memcpy(wallet + 16, keys_root, 32);
+
+    assert_int_equal(host_interpreter_add_known_wallet(interpreter,
+                                                       wallet,
+                                                       sizeof(wallet),
+                                                       (const uint8_t *) key_info,
+                                                       &key_info_len,
+                                                       1),
+                     0);
+
+    // the serialized wallet is known, by the wallet id
+    uint8_t request[2 + 32] = {CCMD_GET_PREIMAGE, 0};
+    sha256(wallet, sizeof(wallet), request + 2);
+    uint8_t response[HOST_MAX_RESPONSE_SIZE];
+    assert_int_equal(execute(interpreter, request, sizeof(request), response),
+                     2 + sizeof(wallet));
+    assert_memory_equal(response + 2, wallet, sizeof(wallet));
+
+    // wrong number of keys, trailing bytes, and a root that is not the one of the keys
+    assert_int_equal(host_interpreter_add_known_wallet(interpreter,
+                                                       wallet,
+                                                       sizeof(wallet),
+                                                       (const uint8_t *) key_info,
+                                                       &key_info_len,
+                                                       0),
+                     HOST_ERR_INVALID_REQUEST);
+    assert_int_equal(host_interpreter_add_known_wallet(interpreter,
+                                                       wallet,
+                                                       sizeof(wallet) - 1,
+                                                       (const uint8_t *) key_info,
+                                                       &key_info_len,
+                                                       1),
+                     HOST_ERR_INVALID_REQUEST);
+    wallet[16] ^= 1;
+    assert_int_equal(host_interpreter_add_known_wallet(interpreter,
+                                                       wallet,
+                                                       sizeof(wallet),
+                                                       (const uint8_t *) key_info,
+                                                       &key_info_len,
+                                                       1),
+                     HOST_ERR_INVALID_REQUEST);
+
+    host_interpreter_free(interpreter);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {cmocka_unit_test(test_get_preimage),
+                                       cmocka_unit_test(test_get_preimages),
+                                       cmocka_unit_test(test_get_merkle_leaf_proof_and_index),
+                                       cmocka_unit_test(test_get_merkle_leaves_proof),
+                                       cmocka_unit_test(test_get_merkleized_map_value),
+                                       cmocka_unit_test(test_batch),
+                                       cmocka_unit_test(test_yield_and_reset),
+                                       cmocka_unit_test(test_add_known_wallet)};
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
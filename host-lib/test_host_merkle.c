@@ -0,0 +1,132 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "common/merkle.h"
+
+#include "host_merkle.h"
+
+#define MAX_TEST_LEAVES 70
+
+static void make_leaves(uint8_t (*leaves)[32], size_t n_leaves) {
+    for (size_t i = 0; i < n_leaves; i++) {
+        memset(leaves[i], (int) i, 32);
+    }
+}
+
+// The root and the proofs are the ones of the app, for all the sizes up to MAX_TEST_LEAVES.
+static void test_host_merkle_tree_matches_app(void **state) {
+    (void) state;
+
+    uint8_t leaves[MAX_TEST_LEAVES][32];
+    make_leaves(leaves, MAX_TEST_LEAVES);
+
+    for (size_t n_leaves = 0; n_leaves <= MAX_TEST_LEAVES; n_leaves++) {
+        host_merkle_tree_t tree;
+        assert_int_equal(host_merkle_tree_init(&tree, (const uint8_t(*)[32]) leaves, n_leaves), 0);
+
+        uint8_t root[32], expected_root[32];
+        host_merkle_tree_root(&tree, root);
+        merkle_compute_root((const uint8_t(*)[32]) leaves, n_leaves, expected_root);
+        assert_memory_equal(root, expected_root, 32);
+
+        for (size_t index = 0; index < n_leaves; index++) {
+            uint8_t proof[HOST_MERKLE_MAX_LEVELS - 1][32];
+            int proof_len = host_merkle_tree_prove_leaf(&tree, index, proof);
+
+            uint32_t directions;
+            assert_int_equal(merkle_get_directions(n_leaves, index, &directions), proof_len);
+
+            uint8_t cur_hash[32];
+            memcpy(cur_hash, leaves[index], 32);
+            assert_int_equal(
+                merkle_climb_proof(cur_hash, proof[0], proof_len, directions, proof_len),
+                0);
+            assert_memory_equal(cur_hash, root, 32);
+        }
+        assert_int_equal(host_merkle_tree_prove_leaf(&tree, n_leaves, NULL), -1);
+
+        host_merkle_tree_free(&tree);
+    }
+}
+
+static void test_host_merkle_tree_prove_leaves(void **state) {
+    (void) state;
+
+    uint8_t leaves[20][32];
+    make_leaves(leaves, 20);
+
+    host_merkle_tree_t tree;
+    assert_int_equal(host_merkle_tree_init(&tree, (const uint8_t(*)[32]) leaves, 20), 0);
+
+    uint8_t root[32];
+    host_merkle_tree_root(&tree, root);
+
+    // (first index, number of leaves, number of leaves in the tree from there)
+    const size_t ranges[][3] = {{8, 8, 8}, {16, 8, 4}, {16, 4, 4}, {18, 2, 2}, {19, 1, 1}};
+    for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+        size_t first_index = ranges[i][0], n_leaves = ranges[i][1], n_present = ranges[i][2];
+
+        uint8_t proof[HOST_MERKLE_MAX_LEVELS - 1][32];
+        int proof_len = host_merkle_tree_prove_leaves(&tree, first_index, n_leaves, proof);
+        assert_true(proof_len >= 0);
+
+        // the nodes above the height of the subtree make the tree of the subtrees
+        uint8_t cur_hash[32];
+        merkle_compute_root((const uint8_t(*)[32]) leaves[first_index], n_present, cur_hash);
+        uint32_t directions;
+        size_t n_subtrees = (20 + n_leaves - 1) / n_leaves;
+        assert_int_equal(merkle_get_directions(n_subtrees, first_index / n_leaves, &directions),
+                         proof_len);
+        assert_int_equal(
+            merkle_climb_proof(cur_hash, proof[0], proof_len, directions, proof_len),
+            0);
+        assert_memory_equal(cur_hash, root, 32);
+    }
+
+    // the range must be the set of leaves of a subtree
+    uint8_t proof[HOST_MERKLE_MAX_LEVELS - 1][32];
+    assert_int_equal(host_merkle_tree_prove_leaves(&tree, 4, 8, proof), -1);
+    assert_int_equal(host_merkle_tree_prove_leaves(&tree, 0, 3, proof), -1);
+    assert_int_equal(host_merkle_tree_prove_leaves(&tree, 0, 0, proof), -1);
+    assert_int_equal(host_merkle_tree_prove_leaves(&tree, 20, 1, proof), -1);
+
+    host_merkle_tree_free(&tree);
+}
+
+static void test_host_merkle_tree_leaf_index(void **state) {
+    (void) state;
+
+    uint8_t leaves[MAX_TEST_LEAVES][32];
+    make_leaves(leaves, MAX_TEST_LEAVES);
+    // a repeated leaf has the index of its first occurrence
+    memcpy(leaves[50], leaves[7], 32);
+
+    host_merkle_tree_t tree;
+    assert_int_equal(
+        host_merkle_tree_init(&tree, (const uint8_t(*)[32]) leaves, MAX_TEST_LEAVES),
+        0);
+
+    for (size_t i = 0; i < MAX_TEST_LEAVES; i++) {
+        assert_int_equal(host_merkle_tree_leaf_index(&tree, leaves[i]), i == 50 ? 7 : i);
+    }
+
+    uint8_t missing[32];
+    memset(missing, 0xFF, 32);
+    assert_int_equal(host_merkle_tree_leaf_index(&tree, missing), -1);
+
+    host_merkle_tree_free(&tree);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {cmocka_unit_test(test_host_merkle_tree_matches_app),
+                                       cmocka_unit_test(test_host_merkle_tree_prove_leaves),
+                                       cmocka_unit_test(test_host_merkle_tree_leaf_index)};
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
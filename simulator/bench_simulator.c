@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "boilerplate/sw.h"
+#include "constants.h"
+#include "commands.h"
+#include "handler/sign_psbt.h"
+
+#include "host_interpreter.h"
+#include "sim_device.h"
+#include "sim_host.h"
+#include "sim_ui.h"
+#include "sim_vectors.h"
+
+/*
+  Round trips and hashes of SIGN_PSBT per phase, for each vector of sim_vectors.h, with and without
+  the prefetched responses. Unlike the times, the counters are deterministic: they only change with
+  the code of the app or of the interpreter, so they can be compared across machines.
+*/
+
+static const char *const PHASE_NAMES[SIM_N_PHASES] = {"setup", "inputs", "outputs", "sign"};
+
+static void print_counters(const char *name, const sim_counters_t *counters) {
+    printf("  %-8s %8u %8u %10u %10u %10u %10u %8u\n",
+           name,
+           counters->n_apdus,
+           counters->n_interruptions,
+           counters->bytes_sent,
+           counters->bytes_received,
+           counters->sha256_digests,
+           counters->sha256_bytes,
+           counters->ec_scalar_mults);
+}
+
+static int bench_sign_psbt(const sim_vector_t *vector, bool prefetch) {
+    sim_device_init(SIM_DEFAULT_MNEMONIC);
+    sim_device_set_prefetch(prefetch);
+
+    host_interpreter_t *interpreter = host_interpreter_new();
+    if (interpreter == NULL) {
+        return -1;
+    }
+
+    uint8_t keys_info[SIM_VECTOR_MAX_KEYS * 256];
+    size_t key_info_lens[SIM_VECTOR_MAX_KEYS];
+    size_t pos = 0;
+    for (size_t i = 0; i < vector->n_keys; i++) {
+        key_info_lens[i] = strlen(vector->keys_info[i]);
+        memcpy(keys_info + pos, vector->keys_info[i], key_info_lens[i]);
+        pos += key_info_lens[i];
+    }
+
+    uint8_t wallet_id[32];
+    uint8_t data[SIM_MAX_SIGN_PSBT_DATA_SIZE];
+    int data_len = -1;
+    if (sim_host_add_wallet(interpreter,
+                            vector->wallet,
+                            vector->wallet_len,
+                            keys_info,
+                            key_info_lens,
+                            vector->n_keys,
+                            wallet_id) == 0) {
+        data_len = sim_host_prepare_psbt(interpreter,
+                                         vector->psbt,
+                                         vector->psbt_len,
+                                         wallet_id,
+                                         NULL,
+                                         data);
+    }
+
+    sim_result_t result;
+    if (data_len < 0) {
+        host_interpreter_free(interpreter);
+        return -1;
+    }
+    data[data_len++] = SIGN_PSBT_MODE_FLAG_PROGRESS;
+
+    int ret =
+        sim_device_exchange(interpreter, CLA_APP, SIGN_PSBT, 0, 0, data, data_len, &result);
+    host_interpreter_free(interpreter);
+    if (ret < 0 || result.sw != SW_OK) {
+        fprintf(stderr, "%s: failed (%d, sw %04x)\n", vector->name, ret, ret < 0 ? 0 : result.sw);
+        return -1;
+    }
+
+    printf("%s%s: %llu us, %u flows\n",
+           vector->name,
+           prefetch ? ", prefetch" : "",
+           (unsigned long long) result.elapsed_us,
+           result.n_ui_flows);
+    printf("  %-8s %8s %8s %10s %10s %10s %10s %8s\n",
+           "phase",
+           "apdus",
+           "interr.",
+           "bytes out",
+           "bytes in",
+           "digests",
+           "hashed",
+           "ec mults");
+    for (int phase = 0; phase < SIM_N_PHASES; phase++) {
+        print_counters(PHASE_NAMES[phase], &result.phases[phase]);
+    }
+    print_counters("total", &result.total);
+    return 0;
+}
+
+int main() {
+    sim_ui_set_approve(true);
+
+    for (size_t v = 0; v < sizeof(sim_vectors) / sizeof(sim_vectors[0]); v++) {
+        for (int prefetch = 0; prefetch < 2; prefetch++) {
+            if (bench_sign_psbt(&sim_vectors[v], prefetch) < 0) {
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""
+Generates sim_vectors.h, with PSBTs of the tests of the app converted to version 2 by the Python client, their wallet
+policy and the signatures that the tests expect, that are used by test_simulator.c. Run from the root of the
+repository:
+
+    python3 simulator/gen_sim_vectors.py > simulator/sim_vectors.h
+"""
+
+import base64
+import sys
+from pathlib import Path
+
+ROOT = Path(__file__).resolve().parent.parent
+sys.path.append(str(ROOT))
+
+from bitcoin_client.psbt import PSBT  # noqa: E402
+from bitcoin_client.wallet import PolicyMapWallet  # noqa: E402
+
+ACCOUNT_84 = ("[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxN"
+              "xXn1d7QkdbL52Ty5jiSLcxPt1P/**")
+
+# name, psbt file, policy and keys of the wallet, signatures of tests/test_sign_psbt.py by input index
+VECTORS = [
+    ("wpkh_1to2", "singlesig/wpkh-1to2.psbt", "wpkh(@0)", [ACCOUNT_84], {
+        0: "3045022100ab44f34dd7e87c9054591297a101e8500a0641d1d591878d0d23cf8096fa79e802205d12d1062d925e27b57bdcf994"
+           "ecf332ad0a8e67b8fe407bab2101255da632aa01",
+    }),
+    ("wpkh_2to2", "singlesig/wpkh-2to2.psbt", "wpkh(@0)", [ACCOUNT_84], {
+        0: "304402206b3e877655f08c6e7b1b74d6d893a82cdf799f68a5ae7cecae63a71b0339e5ce022019b94aa3fb6635956e109f3d89c996"
+           "b1bfbbaf3c619134b5a302badfaf52180e01",
+        1: "3045022100e2e98e4f8c70274f10145c89a5d86e216d0376bdf9f42f829e4315ea67d79d210220743589fd4f55e540540a976a5a"
+           "f58acd610fa5e188a5096dfe7d36baf3afb94001",
+    }),
+]
+
+
+def c_bytes(data: bytes) -> str:
+    return "{" + ", ".join(f"0x{b:02x}" for b in data) + "}"
+
+
+def main():
+    print("// Generated by gen_sim_vectors.py; do not edit.")
+    print()
+    print("#pragma once")
+    print()
+    print("#include <stdint.h>")
+    print("#include <stddef.h>")
+    print()
+    print("#define SIM_VECTOR_MAX_KEYS       2")
+    print("#define SIM_VECTOR_MAX_SIGNATURES 2")
+    print()
+    print("typedef struct {")
+    print("    const char *name;")
+    print("    const uint8_t *psbt;  // binary, version 2")
+    print("    size_t psbt_len;")
+    print("    const uint8_t *wallet;  // serialized wallet policy")
+    print("    size_t wallet_len;")
+    print("    const char *keys_info[SIM_VECTOR_MAX_KEYS];")
+    print("    size_t n_keys;")
+    print("    size_t n_signatures;")
+    print("    struct {")
+    print("        uint8_t input_index;")
+    print("        size_t len;")
+    print("        uint8_t sig[73];  // DER-encoded, with the sighash byte")
+    print("    } signatures[SIM_VECTOR_MAX_SIGNATURES];")
+    print("} sim_vector_t;")
+
+    for name, path, policy, keys, _ in VECTORS:
+        psbt = PSBT()
+        psbt.deserialize((ROOT / "tests" / "psbt" / path).read_text().strip())
+        psbt.to_psbt_v2()
+        wallet = PolicyMapWallet("", policy, keys)
+
+        print()
+        print(f"static const uint8_t {name}_psbt[] = {c_bytes(base64.b64decode(psbt.serialize()))};")
+        print(f"static const uint8_t {name}_wallet[] = {c_bytes(wallet.serialize())};")
+
+    print()
+    print("static const sim_vector_t sim_vectors[] = {")
+    for name, _, _, keys, signatures in VECTORS:
+        print("    {")
+        print(f"        .name = \"{name}\",")
+        print(f"        .psbt = {name}_psbt,")
+        print(f"        .psbt_len = sizeof({name}_psbt),")
+        print(f"        .wallet = {name}_wallet,")
+        print(f"        .wallet_len = sizeof({name}_wallet),")
+        print("        .keys_info = {" + ", ".join(f"\"{k}\"" for k in keys) + "},")
+        print(f"        .n_keys = {len(keys)},")
+        print(f"        .n_signatures = {len(signatures)},")
+        print("        .signatures = {")
+        for index, sig in signatures.items():
+            sig_bytes = bytes.fromhex(sig)
+            print(f"            {{{index}, {len(sig_bytes)}, {c_bytes(sig_bytes)}}},")
+        print("        },")
+        print("    },")
+    print("};")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,208 @@
+#pragma once
+
+/*
+  Mock of the cryptographic API of the SDK, for the host simulation of the app. The hash contexts
+  have the layout of the SDK ones (the intermediate state is in acc, so that the app can copy them
+  to snapshot a hash); everything is implemented in sim_sdk.c, on top of OpenSSL.
+*/
+
+#include "os.h"
+
+typedef uint32_t cx_err_t;
+
+#define CX_OK 0x00000000
+
+/* ----------------------------------------------------------------------- */
+/* flags                                                                   */
+/* ----------------------------------------------------------------------- */
+
+#define CX_LAST (1 << 0)
+
+#define CX_RND_TRNG    (2 << 9)
+#define CX_RND_RFC6979 (3 << 9)
+
+#define CX_ECSCHNORR_BIP0340 (0 << 12)
+
+#define CX_ECCINFO_PARITY_ODD 1
+#define CX_ECCINFO_xGTn       2
+
+/* ----------------------------------------------------------------------- */
+/* hashes                                                                  */
+/* ----------------------------------------------------------------------- */
+
+typedef enum cx_md_e {
+    CX_NONE,
+    CX_RIPEMD160,
+    CX_SHA224,
+    CX_SHA256,
+    CX_SHA384,
+    CX_SHA512,
+} cx_md_t;
+
+#define CX_RIPEMD160_SIZE 20
+#define CX_SHA256_SIZE    32
+#define CX_SHA512_SIZE    64
+
+struct cx_hash_header_s {
+    cx_md_t algo;
+    unsigned int counter;  // number of blocks already processed
+};
+typedef struct cx_hash_header_s cx_hash_t;
+
+struct cx_ripemd160_s {
+    struct cx_hash_header_s header;
+    unsigned int blen;
+    unsigned char block[64];
+    unsigned char acc[5 * 4];
+};
+typedef struct cx_ripemd160_s cx_ripemd160_t;
+
+struct cx_sha256_s {
+    struct cx_hash_header_s header;
+    unsigned int blen;
+    unsigned char block[64];
+    unsigned char acc[8 * 4];
+};
+typedef struct cx_sha256_s cx_sha256_t;
+
+struct cx_sha512_s {
+    struct cx_hash_header_s header;
+    unsigned int blen;
+    unsigned char block[128];
+    unsigned char acc[8 * 8];
+};
+typedef struct cx_sha512_s cx_sha512_t;
+
+// only in the contexts of the legacy app, never used by the new protocol
+typedef struct {
+    struct cx_hash_header_s header;
+    unsigned char state[224];
+} cx_blake2b_t;
+
+int cx_hash(cx_hash_t *hash,
+            int mode,
+            const unsigned char WIDE *in,
+            unsigned int len,
+            unsigned char *out,
+            unsigned int out_len);
+
+cx_err_t cx_hash_no_throw(cx_hash_t *hash,
+                          uint32_t mode,
+                          const uint8_t *in,
+                          size_t len,
+                          uint8_t *out,
+                          size_t out_len);
+
+int cx_sha256_init(cx_sha256_t *hash);
+cx_err_t cx_sha256_init_no_throw(cx_sha256_t *hash);
+int cx_hash_sha256(const unsigned char WIDE *in,
+                   unsigned int len,
+                   unsigned char *out,
+                   unsigned int out_len);
+
+int cx_sha512_init(cx_sha512_t *hash);
+
+cx_err_t cx_ripemd160_init_no_throw(cx_ripemd160_t *hash);
+cx_err_t cx_ripemd160_update(cx_ripemd160_t *hash, const uint8_t *in, size_t len);
+cx_err_t cx_ripemd160_final(cx_ripemd160_t *hash, uint8_t *out);
+
+int cx_hmac_sha256(const unsigned char WIDE *key,
+                   unsigned int key_len,
+                   const unsigned char WIDE *in,
+                   unsigned int len,
+                   unsigned char *mac,
+                   unsigned int mac_len);
+
+int cx_hmac_sha512(const unsigned char WIDE *key,
+                   unsigned int key_len,
+                   const unsigned char WIDE *in,
+                   unsigned int len,
+                   unsigned char *mac,
+                   unsigned int mac_len);
+
+/* ----------------------------------------------------------------------- */
+/* big numbers, big-endian                                                 */
+/* ----------------------------------------------------------------------- */
+
+int cx_math_cmp(const unsigned char WIDE *a, const unsigned char WIDE *b, unsigned int length);
+int cx_math_is_zero(const unsigned char WIDE *a, unsigned int len);
+void cx_math_sub(unsigned char *r,
+                 const unsigned char WIDE *a,
+                 const unsigned char WIDE *b,
+                 unsigned int len);
+void cx_math_addm(unsigned char *r,
+                  const unsigned char WIDE *a,
+                  const unsigned char WIDE *b,
+                  const unsigned char WIDE *m,
+                  unsigned int len);
+void cx_math_powm(unsigned char *r,
+                  const unsigned char *a,
+                  const unsigned char WIDE *e,
+                  unsigned int len_e,
+                  const unsigned char WIDE *m,
+                  unsigned int len);
+
+/* ----------------------------------------------------------------------- */
+/* elliptic curves                                                         */
+/* ----------------------------------------------------------------------- */
+
+typedef enum cx_curve_e {
+    CX_CURVE_NONE,
+    CX_CURVE_SECP256K1 = 0x21,
+} cx_curve_t;
+
+#define CX_CURVE_256K1 CX_CURVE_SECP256K1
+
+typedef struct {
+    cx_curve_t curve;
+    unsigned int d_len;
+    unsigned char d[32];
+} cx_ecfp_private_key_t;
+
+typedef struct {
+    cx_curve_t curve;
+    unsigned int W_len;
+    unsigned char W[65];
+} cx_ecfp_public_key_t;
+
+int cx_ecfp_init_private_key(cx_curve_t curve,
+                             const unsigned char WIDE *rawkey,
+                             unsigned int key_len,
+                             cx_ecfp_private_key_t *pvkey);
+
+int cx_ecfp_generate_pair(cx_curve_t curve,
+                          cx_ecfp_public_key_t *pubkey,
+                          cx_ecfp_private_key_t *privkey,
+                          int keepprivate);
+
+// P = k.P, with P uncompressed; returns the length of P, or 0 for the point at infinity
+int cx_ecfp_scalar_mult(cx_curve_t curve,
+                        unsigned char *P,
+                        unsigned int P_len,
+                        const unsigned char WIDE *k,
+                        unsigned int k_len);
+
+// R = P + Q, all uncompressed; returns the length of R, or 0 for the point at infinity
+int cx_ecfp_add_point(cx_curve_t curve,
+                      unsigned char *R,
+                      const unsigned char WIDE *P,
+                      const unsigned char WIDE *Q,
+                      unsigned int X_len);
+
+// DER-encoded signature with a low s; returns its length
+int cx_ecdsa_sign(const cx_ecfp_private_key_t WIDE *pvkey,
+                  int mode,
+                  cx_md_t hashID,
+                  const unsigned char WIDE *hash,
+                  unsigned int hash_len,
+                  unsigned char *sig,
+                  unsigned int sig_len,
+                  unsigned int *info);
+
+cx_err_t cx_ecschnorr_sign_no_throw(const cx_ecfp_private_key_t *pvkey,
+                                    uint32_t mode,
+                                    cx_md_t hashID,
+                                    const uint8_t *msg,
+                                    size_t msg_len,
+                                    uint8_t *sig,
+                                    size_t *sig_len);
@@ -0,0 +1,4 @@
+#pragma once
+
+// the declarations are all in cx.h
+#include "cx.h"
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "cx.h"
+
+/**
+ * Shared RAM region for the cryptographic contexts (the CXRAM section on the device).
+ */
+union cx_u {
+    cx_sha256_t sha256;
+    cx_ripemd160_t ripemd160;
+    unsigned char raw[1024];
+};
+
+extern union cx_u G_cx;
@@ -0,0 +1,196 @@
+#pragma once
+
+/*
+  Mock of the operating system API of the SDK, for the host simulation of the app: only what the
+  sources of the new protocol use, with the same names and signatures. The functions are
+  implemented in sim_sdk.c; the exceptions are the ones of the SDK, with setjmp/longjmp.
+*/
+
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define WIDE
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+#define MAX(x, y) ((x) > (y) ? (x) : (y))
+
+#ifndef PRINTF
+#define PRINTF(...)
+#endif
+
+void *pic(void *linked_address);
+
+#ifndef PIC
+#define PIC(x) pic((void *) (x))
+#endif
+
+#define PRINT_STACK_POINTER()
+
+#define U2BE(buf, off) ((((buf)[off] & 0xFF) << 8) | ((buf)[off + 1] & 0xFF))
+#define U4BE(buf, off) ((U2BE(buf, off) << 16) | (U2BE(buf, off + 2) & 0xFFFF))
+
+/* ----------------------------------------------------------------------- */
+/* exceptions                                                              */
+/* ----------------------------------------------------------------------- */
+
+typedef unsigned short exception_t;
+
+typedef struct try_context_s {
+    jmp_buf jmp_buf;
+    struct try_context_s *previous;
+    exception_t ex;
+} try_context_t;
+
+try_context_t *try_context_get(void);
+try_context_t *try_context_set(try_context_t *context);
+
+void os_longjmp(unsigned int exception) __attribute__((noreturn));
+
+#define BEGIN_TRY_L(L) \
+    {                  \
+        try_context_t __try##L;
+
+#define TRY_L(L)                                   \
+    __try##L.ex = setjmp(__try##L.jmp_buf);        \
+    if (__try##L.ex == 0) {                        \
+        __try##L.previous = try_context_set(&__try##L);
+
+#define CATCH_L(L, x)             \
+    goto __FINALLY##L;            \
+    }                             \
+    else if (__try##L.ex == (x)) { \
+        __try##L.ex = 0;          \
+        CLOSE_TRY_L(L);
+
+#define CATCH_OTHER_L(L, e)    \
+    goto __FINALLY##L;         \
+    }                          \
+    else {                     \
+        exception_t e;         \
+        e = __try##L.ex;       \
+        __try##L.ex = 0;       \
+        CLOSE_TRY_L(L);
+
+#define CATCH_ALL_L(L)   \
+    goto __FINALLY##L;   \
+    }                    \
+    else {               \
+        __try##L.ex = 0; \
+        CLOSE_TRY_L(L);
+
+#define FINALLY_L(L)   \
+    goto __FINALLY##L; \
+    }                  \
+    __FINALLY##L:      \
+    CLOSE_TRY_L(L);
+
+#define CLOSE_TRY_L(L)                      \
+    if (try_context_get() == &__try##L) {   \
+        try_context_set(__try##L.previous); \
+    }
+
+#define END_TRY_L(L)              \
+    if (__try##L.ex != 0) {       \
+        os_longjmp(__try##L.ex);  \
+    }                             \
+    }
+
+#define THROW_L(L, x) os_longjmp(x)
+
+#define THROW(x)       THROW_L(EX, x)
+#define BEGIN_TRY      BEGIN_TRY_L(EX)
+#define TRY            TRY_L(EX)
+#define CATCH(x)       CATCH_L(EX, x)
+#define CATCH_OTHER(e) CATCH_OTHER_L(EX, e)
+#define CATCH_ALL      CATCH_ALL_L(EX)
+#define FINALLY        FINALLY_L(EX)
+#define CLOSE_TRY      CLOSE_TRY_L(EX)
+#define END_TRY        END_TRY_L(EX)
+
+#define EXCEPTION          1
+#define INVALID_PARAMETER  2
+#define EXCEPTION_OVERFLOW 3
+#define EXCEPTION_SECURITY 4
+#define EXCEPTION_IO_RESET 16
+
+/* ----------------------------------------------------------------------- */
+/* system calls                                                            */
+/* ----------------------------------------------------------------------- */
+
+typedef unsigned char bolos_bool_t;
+
+#define BOLOS_TRUE  0xAA
+#define BOLOS_FALSE 0x55
+#define BOLOS_UX_OK 0xAA
+
+bolos_bool_t os_global_pin_is_validated(void);
+
+char os_secure_memcmp(void WIDE *src1, void WIDE *src2, unsigned int length);
+
+void os_sched_exit(bolos_bool_t exit_code) __attribute__((noreturn));
+
+#define HDW_NORMAL 0
+#define HDW_SLIP21 2
+
+void os_perso_derive_node_bip32(unsigned int curve,
+                                const unsigned int *path,
+                                unsigned int pathLength,
+                                unsigned char *privateKey,
+                                unsigned char *chain);
+
+void os_perso_derive_node_with_seed_key(unsigned int mode,
+                                        unsigned int curve,
+                                        const unsigned int *path,
+                                        unsigned int pathLength,
+                                        unsigned char *privateKey,
+                                        unsigned char *chain,
+                                        unsigned char *seed_key,
+                                        unsigned int seed_key_length);
+
+void nvm_write(void WIDE *dst_adr, void *src_adr, unsigned int src_len);
+
+/* ----------------------------------------------------------------------- */
+/* io                                                                      */
+/* ----------------------------------------------------------------------- */
+
+#define CHANNEL_APDU           0
+#define CHANNEL_KEYBOARD       1
+#define CHANNEL_SPI            2
+#define IO_RESET_AFTER_REPLIED 0x80
+#define IO_RECEIVE_DATA        0x40
+#define IO_RETURN_AFTER_TX     0x20
+#define IO_ASYNCH_REPLY        0x10
+#define IO_FLAGS               0xF8
+
+#define IO_APDU_BUFFER_SIZE (5 + 255)
+
+extern unsigned char G_io_apdu_buffer[IO_APDU_BUFFER_SIZE];
+
+#define IO_SEPROXYHAL_BUFFER_SIZE_B 128
+
+typedef enum {
+    IO_APDU_MEDIA_NONE = 0,
+    IO_APDU_MEDIA_USB_HID = 1,
+} io_apdu_media_t;
+
+typedef struct {
+    unsigned short apdu_length;
+    io_apdu_media_t apdu_media;
+} io_seph_app_t;
+
+extern io_seph_app_t G_io_app;
+
+#define G_io_apdu_media G_io_app.apdu_media
+
+/**
+ * Sends the tx_len bytes of G_io_apdu_buffer to the host, and, unless IO_RETURN_AFTER_TX is set,
+ * receives the next apdu in G_io_apdu_buffer; returns its length.
+ */
+unsigned short io_exchange(unsigned char channel_and_flags, unsigned short tx_len);
+
+void halt(void) __attribute__((noreturn));
+
+// the cryptographic API is part of the SDK headers included with os.h
+#include "cx.h"
@@ -0,0 +1,23 @@
+#pragma once
+
+/*
+  Mock of the SE proxy HAL of the SDK, for the host simulation of the app: the events are never
+  received, as the apdus are exchanged with io_exchange (see sim_device.c).
+*/
+
+#include "os.h"
+#include "ux.h"
+
+#define SEPROXYHAL_TAG_BUTTON_PUSH_EVENT             0x05
+#define SEPROXYHAL_TAG_STATUS_EVENT                  0x0E
+#define SEPROXYHAL_TAG_STATUS_EVENT_FLAG_USB_POWERED 0x00000008
+#define SEPROXYHAL_TAG_TICKER_EVENT                  0x0D
+#define SEPROXYHAL_TAG_DISPLAY_PROCESSED_EVENT       0x0F
+
+void io_seproxyhal_display_default(bagl_element_t *element);
+unsigned int io_seproxyhal_spi_is_status_sent(void);
+void io_seproxyhal_general_status(void);
+void io_seproxyhal_spi_send(const unsigned char *buffer, unsigned short length);
+unsigned short io_seproxyhal_spi_recv(unsigned char *buffer,
+                                      unsigned short maxlength,
+                                      unsigned int flags);
@@ -0,0 +1,38 @@
+#pragma once
+
+/*
+  Mock of the UX library of the SDK, for the host simulation of the app: the flows are never shown,
+  as the screens of the app are replaced by sim_ui.c; only what boilerplate/io.c uses is declared.
+*/
+
+#include "os.h"
+
+typedef struct {
+    int unused;
+} bagl_element_t;
+
+typedef struct {
+    int unused;
+} ux_state_t;
+
+typedef struct {
+    int unused;
+} bolos_ux_params_t;
+
+typedef int ux_flow_step_t;
+
+#define UX_STEP_NOCB(stepname, layoutkind, ...) static const ux_flow_step_t stepname = 0
+#define UX_FLOW(flowname, ...) \
+    static const ux_flow_step_t *const flowname[] = {__VA_ARGS__, NULL}
+
+#define UX_BUTTON_PUSH_EVENT(seph_packet) ((void) (seph_packet))
+#define UX_DISPLAYED_EVENT(...)
+#define UX_TICKER_EVENT(seph_packet, ...) ((void) (seph_packet))
+#define UX_DEFAULT_EVENT()
+
+/**
+ * Counts the flows that would be shown, in sim_ui.c.
+ */
+void ux_flow_init(unsigned int stack_slot,
+                  const ux_flow_step_t *const *steps,
+                  const ux_flow_step_t *start_step);
@@ -0,0 +1,425 @@
+#include <stdbool.h>  // bool
+#include <string.h>   // memcpy, memset, explicit_bzero
+#include <time.h>     // clock_gettime
+
+#include "os.h"
+#include "ux.h"
+
+#include "globals.h"
+#include "main.h"
+#include "commands.h"
+#include "cxram_stash.h"
+#include "boilerplate/apdu_parser.h"
+#include "boilerplate/app_stats.h"
+#include "boilerplate/constants.h"
+#include "boilerplate/dispatcher.h"
+#include "boilerplate/sw.h"
+#include "common/account_xpub_cache.h"
+#include "common/address_cache.h"
+#include "common/key_info_cache.h"
+#include "common/map_commitment_cache.h"
+#include "common/merkle_cache.h"
+#include "common/private_node_cache.h"
+#include "common/pubkey_cache.h"
+#include "common/read.h"
+#include "common/sorted_tree_cache.h"
+#include "common/spending_policy.h"
+#include "common/symmetric_key_cache.h"
+#include "common/taproot_key_cache.h"
+#include "common/tweaked_key_cache.h"
+#include "common/wallet_cache.h"
+#include "common/xpub_cache.h"
+#include "handler/client_commands.h"
+#include "handler/sign_psbt.h"
+#include "ui/menu.h"
+
+#include "sim_sdk.h"
+#include "sim_ui.h"
+#include "sim_device.h"
+
+/*
+  The globals of main.c, and its loop for the apdus of the new protocol; the apdus are exchanged
+  with the host interpreter by io_exchange, instead of the MCU.
+*/
+
+uint8_t G_io_apdu_buffer[IO_APDU_BUFFER_SIZE];
+io_seph_app_t G_io_app;
+
+uint8_t G_io_seproxyhal_spi_buffer[IO_SEPROXYHAL_BUFFER_SIZE_B];
+ux_state_t G_ux;
+bolos_ux_params_t G_ux_params;
+
+command_state_t G_command_state;
+dispatcher_context_t G_dispatcher_context;
+
+global_context_t *G_coin_config;
+
+uint8_t G_app_mode;
+
+static global_context_t G_sim_coin_config;
+
+// clang-format off
+static const command_descriptor_t COMMAND_DESCRIPTORS[] = {
+    {
+        .cla = CLA_APP,
+        .ins = GET_EXTENDED_PUBKEY,
+        .handler = (command_handler_t)handler_get_extended_pubkey,
+        .batchable = true
+    },
+    {
+        .cla = CLA_APP,
+        .ins = GET_WALLET_ADDRESS,
+        .handler = (command_handler_t)handler_get_wallet_address,
+        .batchable = true
+    },
+    {
+        .cla = CLA_APP,
+        .ins = REGISTER_WALLET,
+        .handler = (command_handler_t)handler_register_wallet
+    },
+    {
+        .cla = CLA_APP,
+        .ins = SIGN_PSBT,
+        .handler = (command_handler_t)handler_sign_psbt
+    },
+    {
+        .cla = CLA_APP,
+        .ins = GET_MASTER_FINGERPRINT,
+        .handler = (command_handler_t)handler_get_master_fingerprint,
+        .batchable = true
+    },
+    {
+        .cla = CLA_APP,
+        .ins = GET_WALLET_ADDRESSES,
+        .handler = (command_handler_t)handler_get_wallet_addresses
+    },
+    {
+        .cla = CLA_APP,
+        .ins = GET_ACCOUNT_XPUBS,
+        .handler = (command_handler_t)handler_get_account_xpubs
+    },
+    {
+        .cla = CLA_APP,
+        .ins = GET_EXTENDED_PUBKEYS,
+        .handler = (command_handler_t)handler_get_extended_pubkeys
+    },
+    {
+        .cla = CLA_APP,
+        .ins = REGISTER_WALLETS,
+        .handler = (command_handler_t)handler_register_wallets
+    },
+    {
+        .cla = CLA_APP,
+        .ins = SIGN_MESSAGE,
+        .handler = (command_handler_t)handler_sign_message
+    },
+#ifdef HAVE_UNATTENDED_SIGNING
+    {
+        .cla = CLA_APP,
+        .ins = REGISTER_SPENDING_POLICY,
+        .handler = (command_handler_t)handler_register_spending_policy
+    },
+#endif
+    {
+        .cla = CLA_APP,
+        .ins = GET_APP_STATS,
+        .handler = (command_handler_t)handler_get_app_stats
+    },
+};
+// clang-format on
+
+static struct {
+    host_interpreter_t *interpreter;
+    bool prefetch;
+
+    // the last response sent by the app with IO_RETURN_AFTER_TX, not yet handled by the host
+    uint8_t response[IO_APDU_BUFFER_SIZE];
+    size_t response_len;
+    bool has_response;
+
+    int host_error;
+    uint32_t n_apdus;
+
+    // the counters at the start of the current phase, to attribute their increments to it
+    int phase;
+    sim_counters_t phase_start;
+    sim_result_t *result;
+} G_sim;
+
+// the legacy protocol is not simulated
+void btchip_signing_key_cache_reset(void) {
+}
+
+static void init_coin_config(global_context_t *coin_config) {
+    memset(coin_config, 0, sizeof(global_context_t));
+
+    coin_config->bip32_pubkey_version = BIP32_PUBKEY_VERSION;
+
+    coin_config->bip44_coin_type = BIP44_COIN_TYPE;
+    coin_config->bip44_coin_type2 = BIP44_COIN_TYPE_2;
+    coin_config->p2pkh_version = COIN_P2PKH_VERSION;
+    coin_config->p2sh_version = COIN_P2SH_VERSION;
+    coin_config->family = COIN_FAMILY;
+    strcpy(coin_config->coinid, COIN_COINID);
+    strcpy(coin_config->name, COIN_COINID_NAME);
+    strcpy(coin_config->name_short, COIN_COINID_SHORT);
+    strcpy(coin_config->native_segwit_prefix_val, COIN_NATIVE_SEGWIT_PREFIX);
+    coin_config->native_segwit_prefix = coin_config->native_segwit_prefix_val;
+    coin_config->flags = COIN_FLAGS;
+    coin_config->kind = COIN_KIND;
+}
+
+void sim_device_init(const char *mnemonic) {
+    sim_sdk_set_mnemonic(mnemonic);
+
+    init_coin_config(&G_sim_coin_config);
+    G_coin_config = &G_sim_coin_config;
+
+    xpub_cache_reset();
+    account_xpub_cache_reset();
+    private_node_cache_reset();
+    tweaked_key_cache_reset();
+    symmetric_key_cache_reset();
+    wallet_cache_reset();
+    sign_psbt_checkpoint_reset();
+    spending_session_reset();
+    // like the rest of the RAM of the app at its start
+    address_cache_reset();
+    key_info_cache_reset();
+    map_commitment_cache_reset();
+    merkle_cache_reset();
+    pubkey_cache_reset();
+    sorted_tree_cache_reset();
+    taproot_key_cache_reset();
+
+    explicit_bzero(&G_command_state, sizeof(G_command_state));
+    explicit_bzero(&G_dispatcher_context, sizeof(G_dispatcher_context));
+    G_app_mode = APP_MODE_NEW;
+
+    sim_ui_reset();
+}
+
+void sim_device_set_prefetch(bool prefetch) {
+    G_sim.prefetch = prefetch;
+}
+
+static void read_counters(sim_counters_t *out) {
+    out->n_apdus = G_sim.n_apdus;
+    out->n_interruptions = G_app_stats.n_interruptions;
+    out->bytes_received = G_app_stats.bytes_received;
+    out->bytes_sent = G_app_stats.bytes_sent;
+    out->sha256_bytes = G_app_stats.sha256_bytes;
+    out->sha256_digests = G_app_stats.sha256_digests;
+    out->ec_scalar_mults = G_app_stats.ec_scalar_mults;
+}
+
+// Adds the increments of the counters since the start of the current phase to it, and starts the
+// given phase.
+static void switch_phase(int phase) {
+    sim_counters_t now;
+    read_counters(&now);
+
+    sim_counters_t *counters = &G_sim.result->phases[G_sim.phase];
+    counters->n_apdus += now.n_apdus - G_sim.phase_start.n_apdus;
+    counters->n_interruptions += now.n_interruptions - G_sim.phase_start.n_interruptions;
+    counters->bytes_received += now.bytes_received - G_sim.phase_start.bytes_received;
+    counters->bytes_sent += now.bytes_sent - G_sim.phase_start.bytes_sent;
+    counters->sha256_bytes += now.sha256_bytes - G_sim.phase_start.sha256_bytes;
+    counters->sha256_digests += now.sha256_digests - G_sim.phase_start.sha256_digests;
+    counters->ec_scalar_mults += now.ec_scalar_mults - G_sim.phase_start.ec_scalar_mults;
+
+    G_sim.phase = phase;
+    G_sim.phase_start = now;
+}
+
+// Answers the client command in the first len bytes of G_io_apdu_buffer (without the status word)
+// with the CONTINUE apdu, written in G_io_apdu_buffer; returns its length, or -1 on error.
+static int host_answer(size_t len) {
+    uint8_t request[IO_APDU_BUFFER_SIZE];
+    memcpy(request, G_io_apdu_buffer, len);
+
+    if (len == 1 + SIGN_PSBT_PROGRESS_LEN && request[0] == CCMD_YIELD &&
+        request[1] >= SIGN_PSBT_PHASE_INPUTS && request[1] <= SIGN_PSBT_PHASE_SIGN &&
+        request[1] != G_sim.phase) {
+        switch_phase(request[1]);
+    }
+
+    uint8_t response[HOST_MAX_RESPONSE_SIZE];
+    int response_len = host_interpreter_execute(G_sim.interpreter, request, len, response);
+    if (response_len < 0) {
+        G_sim.host_error = response_len;
+        return -1;
+    }
+
+    uint8_t *apdu = G_io_apdu_buffer;
+    apdu[0] = CLA_FRAMEWORK;
+    apdu[1] = INS_CONTINUE;
+    apdu[2] = 0;
+    apdu[3] = 0;
+
+    size_t prefetched_len = 0;
+    if (G_sim.prefetch && response_len < 255) {
+        prefetched_len = host_interpreter_get_prefetched_responses(G_sim.interpreter,
+                                                                   request,
+                                                                   len,
+                                                                   apdu + 5 + 1 + response_len,
+                                                                   255 - 1 - response_len);
+    }
+
+    if (prefetched_len > 0) {
+        apdu[2] = CONTINUE_P1_PREFETCH;
+        apdu[4] = (uint8_t) (1 + response_len + prefetched_len);
+        apdu[5] = (uint8_t) response_len;
+        memcpy(apdu + 6, response, response_len);
+    } else {
+        apdu[4] = (uint8_t) response_len;
+        memcpy(apdu + 5, response, response_len);
+    }
+
+    ++G_sim.n_apdus;
+    return 5 + apdu[4];
+}
+
+unsigned short io_exchange(unsigned char channel_and_flags, unsigned short tx_len) {
+    if (channel_and_flags & IO_RETURN_AFTER_TX) {
+        // a response, handled by sim_device_exchange once the dispatcher returns
+        memcpy(G_sim.response, G_io_apdu_buffer, tx_len);
+        G_sim.response_len = tx_len;
+        G_sim.has_response = true;
+        return 0;
+    }
+
+    // an interruption of process_interruption, that waits for the next apdu
+    if (tx_len < 2 || read_u16_be(G_io_apdu_buffer, tx_len - 2) != SW_INTERRUPTED_EXECUTION) {
+        THROW(EXCEPTION_IO_RESET);
+    }
+    int len = host_answer(tx_len - 2);
+    if (len < 0) {
+        // like a client that does not respond: the app sees a reset of the io
+        THROW(EXCEPTION_IO_RESET);
+    }
+    return len;
+}
+
+// Processes the apdu in G_io_apdu_buffer like app_main, and answers the flows waiting for the user;
+// returns 0 once the app sent a response, or a negative sim_error_e.
+static int run_apdu(size_t apdu_len, sim_result_t *result) {
+    int ret = 0;
+
+    BEGIN_TRY {
+        TRY {
+            command_t cmd;
+            memset(&cmd, 0, sizeof(cmd));
+            // No allocation of the cxram stash outlives a command
+            cxram_reset();
+            if (!apdu_parser(&cmd, G_io_apdu_buffer, apdu_len)) {
+                io_send_sw(SW_WRONG_DATA_LENGTH);
+            } else {
+                // Private keys are only cached during a command
+                if (cmd.cla != CLA_FRAMEWORK || cmd.ins != INS_CONTINUE) {
+                    private_node_cache_reset();
+                    tweaked_key_cache_reset();
+#ifndef HAVE_KEY_INFO_CACHE
+                    // without the session cache, key information only lives for a command
+                    key_info_cache_reset();
+#endif
+                }
+
+                apdu_dispatcher(COMMAND_DESCRIPTORS,
+                                sizeof(COMMAND_DESCRIPTORS) / sizeof(COMMAND_DESCRIPTORS[0]),
+                                (machine_context_t *) &G_command_state,
+                                sizeof(G_command_state),
+                                ui_menu_main,
+                                &cmd);
+            }
+
+            // the answer of the user resumes the dispatcher, that can show the next flow
+            while (!G_sim.has_response && sim_ui_resolve_pending()) {
+            }
+        }
+        CATCH_OTHER(e) {
+            result->exception = e;
+            ret = G_sim.host_error != 0 ? SIM_ERR_HOST : SIM_ERR_EXCEPTION;
+        }
+        FINALLY {
+        }
+    }
+    END_TRY;
+
+    if (ret == 0 && !G_sim.has_response) {
+        ret = SIM_ERR_NO_RESPONSE;
+    }
+    return ret;
+}
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int sim_device_exchange(host_interpreter_t *interpreter,
+                        uint8_t cla,
+                        uint8_t ins,
+                        uint8_t p1,
+                        uint8_t p2,
+                        const uint8_t *data,
+                        size_t data_len,
+                        sim_result_t *result) {
+    if (data_len > 255) {
+        return SIM_ERR_INVALID_APDU;
+    }
+
+    memset(result, 0, sizeof(sim_result_t));
+    host_interpreter_reset(interpreter);
+    app_stats_reset();
+    sim_ui_reset();
+
+    G_sim.interpreter = interpreter;
+    G_sim.has_response = false;
+    G_sim.host_error = 0;
+    G_sim.n_apdus = 0;
+    G_sim.result = result;
+    G_sim.phase = SIM_PHASE_SETUP;
+    memset(&G_sim.phase_start, 0, sizeof(G_sim.phase_start));
+
+    uint64_t start = now_us();
+
+    G_io_apdu_buffer[0] = cla;
+    G_io_apdu_buffer[1] = ins;
+    G_io_apdu_buffer[2] = p1;
+    G_io_apdu_buffer[3] = p2;
+    G_io_apdu_buffer[4] = (uint8_t) data_len;
+    memcpy(G_io_apdu_buffer + 5, data, data_len);
+    size_t apdu_len = 5 + data_len;
+    ++G_sim.n_apdus;
+
+    int ret;
+    while ((ret = run_apdu(apdu_len, result)) == 0) {
+        G_sim.has_response = false;
+
+        uint16_t sw = read_u16_be(G_sim.response, G_sim.response_len - 2);
+        if (sw != SW_INTERRUPTED_EXECUTION) {
+            result->sw = sw;
+            result->data_len = G_sim.response_len - 2;
+            memcpy(result->data, G_sim.response, result->data_len);
+            break;
+        }
+
+        // an interruption of interrupt(): the response comes in the next apdu
+        memcpy(G_io_apdu_buffer, G_sim.response, G_sim.response_len);
+        int len = host_answer(G_sim.response_len - 2);
+        if (len < 0) {
+            ret = SIM_ERR_HOST;
+            break;
+        }
+        apdu_len = len;
+    }
+
+    switch_phase(G_sim.phase);
+    read_counters(&result->total);
+    result->n_ui_flows = sim_ui_n_flows();
+    result->host_error = G_sim.host_error;
+    result->elapsed_us = now_us() - start;
+    return ret;
+}
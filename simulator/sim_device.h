@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdbool.h>  // bool
+#include <stddef.h>   // size_t
+#include <stdint.h>   // uint*_t
+
+#include "host_interpreter.h"
+
+/*
+  Host simulation of the new protocol of the app: the command handlers, the dispatcher and the io
+  of the app, compiled for the host with the mocked SDK of simulator/sdk, exchange the apdus with
+  the C interpreter of the client commands of host-lib. Each command runs to completion in a single
+  call, including its interruptions and its user approvals, and returns the counters of GET_APP_STATS
+  accumulated while it ran.
+
+  With SIGN_PSBT_MODE_FLAG_PROGRESS in the mode of a SIGN_PSBT, the counters are also split per
+  phase, at the first progress event of each phase.
+*/
+
+// Default seed of the simulator: the one of speculos, and of the tests of the app.
+#define SIM_DEFAULT_MNEMONIC                                                                \
+    "glory promote mansion idle axis finger extra february uncover one trip resource lawn " \
+    "turtle enact monster seven myth punch hobby comfort wild raise skin"
+
+// The phases of the counters: before the first progress event, then the phases of SIGN_PSBT.
+#define SIM_PHASE_SETUP 0
+#define SIM_N_PHASES    4
+
+typedef enum {
+    SIM_ERR_INVALID_APDU = -1,  // the apdu is too long
+    SIM_ERR_HOST = -2,          // the host could not answer a client command; see host_error
+    SIM_ERR_EXCEPTION = -3,     // the app threw an exception; see exception
+    SIM_ERR_NO_RESPONSE = -4,   // the app returned without responding, nor waiting for the user
+} sim_error_e;
+
+typedef struct {
+    uint32_t n_apdus;          // apdus sent to the app, including the CONTINUE ones
+    uint32_t n_interruptions;  // client commands, except the ones answered by prefetched responses
+    uint32_t bytes_received;   // as counted by the app, in apdu_dispatcher
+    uint32_t bytes_sent;
+    uint32_t sha256_bytes;
+    uint32_t sha256_digests;
+    uint32_t ec_scalar_mults;
+} sim_counters_t;
+
+typedef struct {
+    uint16_t sw;
+    uint8_t data[256];  // the data of the response, without the status word
+    size_t data_len;
+
+    uint32_t n_ui_flows;  // flows that waited for the user
+    sim_counters_t total;
+    sim_counters_t phases[SIM_N_PHASES];
+    uint64_t elapsed_us;  // wall-clock time of the whole command, including the host
+
+    int host_error;      // for SIM_ERR_HOST, the host_error_e of the interpreter
+    unsigned exception;  // for SIM_ERR_EXCEPTION, the exception thrown by the app
+} sim_result_t;
+
+/**
+ * Initializes the simulated app, with the seed of the given mnemonic, as if it was just started;
+ * the caches of the app are empty.
+ */
+void sim_device_init(const char *mnemonic);
+
+/**
+ * Sets whether the responses to the client commands are sent with the responses that the host
+ * interpreter predicts that the app will ask next (CONTINUE_P1_PREFETCH); disabled by default.
+ */
+void sim_device_set_prefetch(bool prefetch);
+
+/**
+ * Sends a command to the app, and runs it to completion, answering its client commands with the
+ * given interpreter (whose execution state is reset first) and its flows with the answer set with
+ * sim_ui_set_approve.
+ *
+ * @return 0 if the app responded, with the response in result; a negative sim_error_e otherwise.
+ */
+int sim_device_exchange(host_interpreter_t *interpreter,
+                        uint8_t cla,
+                        uint8_t ins,
+                        uint8_t p1,
+                        uint8_t p2,
+                        const uint8_t *data,
+                        size_t data_len,
+                        sim_result_t *result);
@@ -0,0 +1,188 @@
+#include <stdbool.h>  // bool
+#include <stdlib.h>   // malloc, free
+#include <string.h>   // memcpy
+
+#include "os.h"
+#include "cx.h"
+
+#include "common/buffer.h"
+#include "common/psbt.h"
+#include "common/varint.h"
+
+#include "sim_host.h"
+
+// the magic bytes of a binary PSBT
+static const uint8_t PSBT_MAGIC[] = {'p', 's', 'b', 't', 0xff};
+
+int sim_host_add_wallet(host_interpreter_t *interpreter,
+                        const uint8_t *serialized_wallet,
+                        size_t serialized_wallet_len,
+                        const uint8_t *keys_info,
+                        const size_t *key_info_lens,
+                        size_t n_keys,
+                        uint8_t wallet_id[static 32]) {
+    int ret = host_interpreter_add_known_wallet(interpreter,
+                                                serialized_wallet,
+                                                serialized_wallet_len,
+                                                keys_info,
+                                                key_info_lens,
+                                                n_keys);
+    if (ret < 0) {
+        return ret;
+    }
+
+    cx_hash_sha256(serialized_wallet, serialized_wallet_len, wallet_id, 32);
+    return 0;
+}
+
+// Reads a key or a value of a map: a varint length, and the data; returns false on error.
+static bool read_map_field(buffer_t *buffer, const uint8_t **data, size_t *len) {
+    uint64_t field_len;
+    if (!buffer_read_varint(buffer, &field_len) || !buffer_can_read(buffer, field_len)) {
+        return false;
+    }
+    *data = buffer->ptr + buffer->offset;
+    *len = (size_t) field_len;
+    return buffer_seek_cur(buffer, field_len);
+}
+
+/**
+ * Adds the next map of a PSBT to the interpreter, and writes its commitment. For each non-zero
+ * count_keys[i], also reads the varint value of the key made of this single byte in counts[i].
+ * Returns the length of the commitment, or a negative host_error_e.
+ */
+static int add_map(host_interpreter_t *interpreter,
+                   buffer_t *buffer,
+                   uint8_t count_keys[static 2],
+                   uint64_t counts[static 2],
+                   uint8_t commitment[static HOST_MAX_MAP_COMMITMENT_SIZE]) {
+    // first pass: the number of entries, and the total length of the keys and of the values
+    buffer_snapshot_t start = buffer_snapshot(buffer);
+    size_t n_entries = 0, keys_len = 0, values_len = 0;
+    while (true) {
+        const uint8_t *key, *value;
+        size_t key_len, value_len;
+        if (!read_map_field(buffer, &key, &key_len)) {
+            return HOST_ERR_INVALID_REQUEST;
+        }
+        if (key_len == 0) {
+            break;  // separator
+        }
+        if (!read_map_field(buffer, &value, &value_len)) {
+            return HOST_ERR_INVALID_REQUEST;
+        }
+        ++n_entries;
+        keys_len += key_len;
+        values_len += value_len;
+    }
+    buffer_restore(buffer, start);
+
+    uint8_t *keys = malloc(keys_len + 1), *values = malloc(values_len + 1);
+    size_t *lens = malloc(2 * (n_entries + 1) * sizeof(size_t));
+    size_t *key_lens = lens, *value_lens = lens + n_entries + 1;
+    if (keys == NULL || values == NULL || lens == NULL) {
+        free(keys), free(values), free(lens);
+        return HOST_ERR_NO_MEMORY;
+    }
+
+    // second pass: the entries
+    size_t keys_pos = 0, values_pos = 0;
+    for (size_t i = 0; i < n_entries; i++) {
+        const uint8_t *key, *value;
+        read_map_field(buffer, &key, &key_lens[i]);
+        read_map_field(buffer, &value, &value_lens[i]);
+        memcpy(keys + keys_pos, key, key_lens[i]);
+        memcpy(values + values_pos, value, value_lens[i]);
+        keys_pos += key_lens[i];
+        values_pos += value_lens[i];
+
+        for (int j = 0; j < 2; j++) {
+            if (count_keys[j] != 0 && key_lens[i] == 1 && key[0] == count_keys[j] &&
+                varint_read(value, value_lens[i], &counts[j]) < 0) {
+                free(keys), free(values), free(lens);
+                return HOST_ERR_INVALID_REQUEST;
+            }
+        }
+    }
+    buffer_seek_cur(buffer, 1);  // separator
+
+    int ret = host_interpreter_add_known_mapping(interpreter,
+                                                 keys,
+                                                 key_lens,
+                                                 values,
+                                                 value_lens,
+                                                 n_entries,
+                                                 commitment);
+    free(keys), free(values), free(lens);
+    return ret;
+}
+
+/**
+ * Adds the n maps of the inputs or of the outputs, and the list of their commitments; writes the
+ * number of maps and the Merkle root of the list to out, and returns the length written, or a
+ * negative host_error_e.
+ */
+static int add_map_list(host_interpreter_t *interpreter, buffer_t *buffer, size_t n, uint8_t *out) {
+    uint8_t *commitments = malloc((n + 1) * HOST_MAX_MAP_COMMITMENT_SIZE);
+    size_t *lens = malloc((n + 1) * sizeof(size_t));
+    if (commitments == NULL || lens == NULL) {
+        free(commitments), free(lens);
+        return HOST_ERR_NO_MEMORY;
+    }
+
+    size_t pos = 0;
+    int ret = 0;
+    for (size_t i = 0; i < n && ret >= 0; i++) {
+        uint8_t no_keys[2] = {0, 0};
+        uint64_t unused[2];
+        ret = add_map(interpreter, buffer, no_keys, unused, commitments + pos);
+        if (ret >= 0) {
+            lens[i] = ret;
+            pos += ret;
+        }
+    }
+
+    int len = varint_write(out, 0, n);
+    if (ret >= 0) {
+        ret = host_interpreter_add_known_list(interpreter, commitments, lens, n, out + len);
+    }
+    free(commitments), free(lens);
+    return ret < 0 ? ret : len + 32;
+}
+
+int sim_host_prepare_psbt(host_interpreter_t *interpreter,
+                          const uint8_t *psbt,
+                          size_t psbt_len,
+                          const uint8_t wallet_id[static 32],
+                          const uint8_t *wallet_hmac,
+                          uint8_t out[static SIM_MAX_SIGN_PSBT_DATA_SIZE]) {
+    buffer_t buffer = buffer_create((void *) psbt, psbt_len);
+    if (psbt_len < sizeof(PSBT_MAGIC) || memcmp(psbt, PSBT_MAGIC, sizeof(PSBT_MAGIC)) != 0) {
+        return HOST_ERR_INVALID_REQUEST;
+    }
+    buffer_seek_cur(&buffer, sizeof(PSBT_MAGIC));
+
+    uint8_t count_keys[2] = {PSBT_GLOBAL_INPUT_COUNT, PSBT_GLOBAL_OUTPUT_COUNT};
+    uint64_t counts[2] = {0, 0};
+    int len = add_map(interpreter, &buffer, count_keys, counts, out);
+    if (len < 0) {
+        return len;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        int ret = add_map_list(interpreter, &buffer, counts[i], out + len);
+        if (ret < 0) {
+            return ret;
+        }
+        len += ret;
+    }
+
+    memcpy(out + len, wallet_id, 32);
+    len += 32;
+    if (wallet_hmac != NULL) {
+        memcpy(out + len, wallet_hmac, 32);
+    } else {
+        memset(out + len, 0, 32);
+    }
+    return len + 32;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint*_t
+
+#include "host_interpreter.h"
+
+/*
+  What the client does before sending a command to the app, like BitcoinCommand of the Python
+  client: the known data of the interpreter, and the data of the apdus.
+*/
+
+// Maximum length of the data of a SIGN_PSBT apdu: the commitments, the wallet and the mode.
+#define SIM_MAX_SIGN_PSBT_DATA_SIZE (HOST_MAX_MAP_COMMITMENT_SIZE + 2 * (9 + 32) + 32 + 32 + 1)
+
+/**
+ * Adds a wallet policy, like host_interpreter_add_known_wallet, and computes its id.
+ *
+ * @return 0 on success, or a negative host_error_e.
+ */
+int sim_host_add_wallet(host_interpreter_t *interpreter,
+                        const uint8_t *serialized_wallet,
+                        size_t serialized_wallet_len,
+                        const uint8_t *keys_info,
+                        const size_t *key_info_lens,
+                        size_t n_keys,
+                        uint8_t wallet_id[static 32]);
+
+/**
+ * Adds the maps of a binary PSBT of version 2 to the interpreter, with the lists of the commitments
+ * of the input and of the output maps, and writes the data of the SIGN_PSBT apdu (without the mode).
+ *
+ * @param[in] interpreter
+ *   The interpreter.
+ * @param[in] psbt
+ *   The serialized PSBT.
+ * @param[in] psbt_len
+ *   The length of the serialized PSBT.
+ * @param[in] wallet_id
+ *   The id of the wallet policy.
+ * @param[in] wallet_hmac
+ *   The hmac of the registered wallet policy, or NULL for a default wallet policy.
+ * @param[out] out
+ *   The data of the apdu.
+ *
+ * @return the length of the data on success, or a negative host_error_e.
+ */
+int sim_host_prepare_psbt(host_interpreter_t *interpreter,
+                          const uint8_t *psbt,
+                          size_t psbt_len,
+                          const uint8_t wallet_id[static 32],
+                          const uint8_t *wallet_hmac,
+                          uint8_t out[static SIM_MAX_SIGN_PSBT_DATA_SIZE]);
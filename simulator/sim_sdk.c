@@ -0,0 +1,817 @@
+#include <stdio.h>   // fprintf
+#include <stdlib.h>  // abort, exit
+#include <string.h>  // memcpy, memcmp, memset
+
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/obj_mac.h>
+#include <openssl/rand.h>
+#include <openssl/ripemd.h>
+#include <openssl/sha.h>
+
+#include "os.h"
+#include "cx.h"
+#include "cx_ram.h"
+#include "os_io_seproxyhal.h"
+#include "ux.h"
+
+#include "sim_sdk.h"
+
+/*
+  The SDK functions used by the app, on top of OpenSSL. The hashes keep their state in the contexts
+  of the app (so that they can be copied like on the device), and only use the compression
+  functions of OpenSSL; the keys are derived from the BIP-39 seed of the mnemonic, like speculos.
+*/
+
+/* ----------------------------------------------------------------------- */
+/* system                                                                  */
+/* ----------------------------------------------------------------------- */
+
+static try_context_t *G_try_context;
+
+try_context_t *try_context_get(void) {
+    return G_try_context;
+}
+
+try_context_t *try_context_set(try_context_t *context) {
+    try_context_t *previous = G_try_context;
+    G_try_context = context;
+    return previous;
+}
+
+void os_longjmp(unsigned int exception) {
+    if (G_try_context == NULL) {
+        fprintf(stderr, "simulator: uncaught exception 0x%04X\n", exception);
+        abort();
+    }
+    longjmp(G_try_context->jmp_buf, exception);
+}
+
+void *pic(void *linked_address) {
+    return linked_address;
+}
+
+bolos_bool_t os_global_pin_is_validated(void) {
+    return BOLOS_UX_OK;
+}
+
+char os_secure_memcmp(void *src1, void *src2, unsigned int length) {
+    return memcmp(src1, src2, length) != 0;
+}
+
+void os_sched_exit(bolos_bool_t exit_code) {
+    exit(exit_code);
+}
+
+void nvm_write(void *dst_adr, void *src_adr, unsigned int src_len) {
+    if (src_adr == NULL) {
+        memset(dst_adr, 0, src_len);
+    } else {
+        memmove(dst_adr, src_adr, src_len);
+    }
+}
+
+void halt(void) {
+    abort();
+}
+
+// there is no screen nor MCU: events are never received
+void io_seproxyhal_display_default(bagl_element_t *element) {
+    (void) element;
+}
+
+unsigned int io_seproxyhal_spi_is_status_sent(void) {
+    return 1;
+}
+
+void io_seproxyhal_general_status(void) {
+}
+
+void io_seproxyhal_spi_send(const unsigned char *buffer, unsigned short length) {
+    (void) buffer, (void) length;
+}
+
+unsigned short io_seproxyhal_spi_recv(unsigned char *buffer,
+                                      unsigned short max_length,
+                                      unsigned int flags) {
+    (void) buffer, (void) max_length, (void) flags;
+    return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+/* hashes                                                                  */
+/* ----------------------------------------------------------------------- */
+
+typedef struct {
+    size_t block_size;
+    size_t acc_size;
+    size_t length_size;  // size of the length of the message in the padding, in bytes
+    bool big_endian;     // endianness of the words of the state and of the length
+    size_t word_size;
+    void (*compress)(unsigned char *acc, const unsigned char *block);
+} hash_info_t;
+
+static void sha256_compress(unsigned char *acc, const unsigned char *block) {
+    SHA256_CTX ctx;
+    memcpy(ctx.h, acc, sizeof(ctx.h));
+    SHA256_Transform(&ctx, block);
+    memcpy(acc, ctx.h, sizeof(ctx.h));
+}
+
+static void sha512_compress(unsigned char *acc, const unsigned char *block) {
+    SHA512_CTX ctx;
+    memcpy(ctx.h, acc, sizeof(ctx.h));
+    SHA512_Transform(&ctx, block);
+    memcpy(acc, ctx.h, sizeof(ctx.h));
+}
+
+static void ripemd160_compress(unsigned char *acc, const unsigned char *block) {
+    RIPEMD160_CTX ctx;
+    memcpy(&ctx.A, acc, 5 * 4);  // A, B, C, D, E are consecutive
+    RIPEMD160_Transform(&ctx, block);
+    memcpy(acc, &ctx.A, 5 * 4);
+}
+
+static const hash_info_t SHA256_INFO = {64, 32, 8, true, 4, sha256_compress};
+static const hash_info_t SHA512_INFO = {128, 64, 16, true, 8, sha512_compress};
+static const hash_info_t RIPEMD160_INFO = {64, 20, 8, false, 4, ripemd160_compress};
+
+// Returns the description of the hash of a context, and the pointers to its fields.
+static const hash_info_t *get_hash_fields(cx_hash_t *hash,
+                                          unsigned int **blen,
+                                          unsigned char **block,
+                                          unsigned char **acc) {
+    switch (hash->algo) {
+        case CX_SHA256: {
+            cx_sha256_t *ctx = (cx_sha256_t *) hash;
+            *blen = &ctx->blen, *block = ctx->block, *acc = ctx->acc;
+            return &SHA256_INFO;
+        }
+        case CX_SHA512: {
+            cx_sha512_t *ctx = (cx_sha512_t *) hash;
+            *blen = &ctx->blen, *block = ctx->block, *acc = ctx->acc;
+            return &SHA512_INFO;
+        }
+        case CX_RIPEMD160: {
+            cx_ripemd160_t *ctx = (cx_ripemd160_t *) hash;
+            *blen = &ctx->blen, *block = ctx->block, *acc = ctx->acc;
+            return &RIPEMD160_INFO;
+        }
+        default:
+            return NULL;
+    }
+}
+
+static void hash_update(cx_hash_t *hash, const unsigned char *in, size_t len) {
+    unsigned int *blen;
+    unsigned char *block, *acc;
+    const hash_info_t *info = get_hash_fields(hash, &blen, &block, &acc);
+
+    while (len > 0) {
+        size_t n = MIN(len, info->block_size - *blen);
+        memcpy(block + *blen, in, n);
+        *blen += n;
+        in += n;
+        len -= n;
+
+        if (*blen == info->block_size) {
+            info->compress(acc, block);
+            ++hash->counter;
+            *blen = 0;
+        }
+    }
+}
+
+// Pads the message and writes the digest; returns its length.
+static size_t hash_final(cx_hash_t *hash, unsigned char *out) {
+    unsigned int *blen;
+    unsigned char *block, *acc;
+    const hash_info_t *info = get_hash_fields(hash, &blen, &block, &acc);
+
+    // the length in bits fits 64 bits; the upper bytes of a longer length field are zeros
+    uint64_t bit_len = ((uint64_t) hash->counter * info->block_size + *blen) * 8;
+
+    block[(*blen)++] = 0x80;
+    if (*blen > info->block_size - info->length_size) {
+        memset(block + *blen, 0, info->block_size - *blen);
+        info->compress(acc, block);
+        *blen = 0;
+    }
+    memset(block + *blen, 0, info->block_size - *blen);
+    for (int i = 0; i < 8; i++) {
+        uint8_t byte = (uint8_t) (bit_len >> (8 * i));
+        if (info->big_endian) {
+            block[info->block_size - 1 - i] = byte;
+        } else {
+            block[info->block_size - info->length_size + i] = byte;
+        }
+    }
+    info->compress(acc, block);
+
+    // the words of the state are in the endianness of the host
+    for (size_t w = 0; w < info->acc_size / info->word_size; w++) {
+        for (size_t i = 0; i < info->word_size; i++) {
+            size_t src = w * info->word_size + i;
+            size_t dst = info->big_endian ? w * info->word_size + info->word_size - 1 - i : src;
+            out[dst] = acc[src];
+        }
+    }
+    return info->acc_size;
+}
+
+int cx_hash(cx_hash_t *hash,
+            int mode,
+            const unsigned char *in,
+            unsigned int len,
+            unsigned char *out,
+            unsigned int out_len) {
+    (void) out_len;
+
+    unsigned int *blen;
+    unsigned char *block, *acc;
+    if (get_hash_fields(hash, &blen, &block, &acc) == NULL) {
+        THROW(INVALID_PARAMETER);
+    }
+
+    hash_update(hash, in, len);
+    if (mode & CX_LAST) {
+        uint8_t digest[CX_SHA512_SIZE];
+        size_t digest_len = hash_final(hash, digest);
+        if (out != NULL) {
+            memcpy(out, digest, digest_len);
+        }
+        return digest_len;
+    }
+    return 0;
+}
+
+cx_err_t cx_hash_no_throw(cx_hash_t *hash,
+                          uint32_t mode,
+                          const uint8_t *in,
+                          size_t len,
+                          uint8_t *out,
+                          size_t out_len) {
+    cx_hash(hash, mode, in, len, out, out_len);
+    return CX_OK;
+}
+
+int cx_sha256_init(cx_sha256_t *hash) {
+    SHA256_CTX ctx;
+    SHA256_Init(&ctx);
+
+    memset(hash, 0, sizeof(cx_sha256_t));
+    hash->header.algo = CX_SHA256;
+    memcpy(hash->acc, ctx.h, sizeof(hash->acc));
+    return CX_SHA256;
+}
+
+cx_err_t cx_sha256_init_no_throw(cx_sha256_t *hash) {
+    cx_sha256_init(hash);
+    return CX_OK;
+}
+
+int cx_hash_sha256(const unsigned char *in, unsigned int len, unsigned char *out, unsigned int out_len) {
+    cx_sha256_t hash;
+    cx_sha256_init(&hash);
+    return cx_hash(&hash.header, CX_LAST, in, len, out, out_len);
+}
+
+int cx_sha512_init(cx_sha512_t *hash) {
+    SHA512_CTX ctx;
+    SHA512_Init(&ctx);
+
+    memset(hash, 0, sizeof(cx_sha512_t));
+    hash->header.algo = CX_SHA512;
+    memcpy(hash->acc, ctx.h, sizeof(hash->acc));
+    return CX_SHA512;
+}
+
+cx_err_t cx_ripemd160_init_no_throw(cx_ripemd160_t *hash) {
+    RIPEMD160_CTX ctx;
+    RIPEMD160_Init(&ctx);
+
+    memset(hash, 0, sizeof(cx_ripemd160_t));
+    hash->header.algo = CX_RIPEMD160;
+    memcpy(hash->acc, &ctx.A, sizeof(hash->acc));
+    return CX_OK;
+}
+
+cx_err_t cx_ripemd160_update(cx_ripemd160_t *hash, const uint8_t *in, size_t len) {
+    hash_update(&hash->header, in, len);
+    return CX_OK;
+}
+
+cx_err_t cx_ripemd160_final(cx_ripemd160_t *hash, uint8_t *out) {
+    hash_final(&hash->header, out);
+    return CX_OK;
+}
+
+int cx_hmac_sha256(const unsigned char *key,
+                   unsigned int key_len,
+                   const unsigned char *in,
+                   unsigned int len,
+                   unsigned char *mac,
+                   unsigned int mac_len) {
+    uint8_t out[32];
+    HMAC(EVP_sha256(), key, key_len, in, len, out, NULL);
+    memcpy(mac, out, MIN(mac_len, sizeof(out)));
+    return MIN(mac_len, sizeof(out));
+}
+
+int cx_hmac_sha512(const unsigned char *key,
+                   unsigned int key_len,
+                   const unsigned char *in,
+                   unsigned int len,
+                   unsigned char *mac,
+                   unsigned int mac_len) {
+    uint8_t out[64];
+    HMAC(EVP_sha512(), key, key_len, in, len, out, NULL);
+    memcpy(mac, out, MIN(mac_len, sizeof(out)));
+    return MIN(mac_len, sizeof(out));
+}
+
+/* ----------------------------------------------------------------------- */
+/* big numbers                                                             */
+/* ----------------------------------------------------------------------- */
+
+// Writes a (non-negative) big number in len bytes, big-endian, reducing it modulo 2^(8 * len).
+static void bn_write(const BIGNUM *a, unsigned char *r, unsigned int len) {
+    BIGNUM *t = BN_dup(a);
+    BN_mask_bits(t, 8 * len);
+    BN_bn2binpad(t, r, len);
+    BN_free(t);
+}
+
+int cx_math_cmp(const unsigned char *a, const unsigned char *b, unsigned int length) {
+    int cmp = memcmp(a, b, length);
+    return cmp < 0 ? -1 : cmp > 0 ? 1 : 0;
+}
+
+int cx_math_is_zero(const unsigned char *a, unsigned int len) {
+    for (unsigned int i = 0; i < len; i++) {
+        if (a[i] != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void cx_math_sub(unsigned char *r, const unsigned char *a, const unsigned char *b, unsigned int len) {
+    BIGNUM *A = BN_bin2bn(a, len, NULL), *B = BN_bin2bn(b, len, NULL), *R = BN_new();
+
+    // r = a - b + 2^(8 * len), truncated
+    BN_set_bit(A, 8 * len);
+    BN_sub(R, A, B);
+    bn_write(R, r, len);
+
+    BN_free(A), BN_free(B), BN_free(R);
+}
+
+void cx_math_addm(unsigned char *r,
+                  const unsigned char *a,
+                  const unsigned char *b,
+                  const unsigned char *m,
+                  unsigned int len) {
+    BN_CTX *ctx = BN_CTX_new();
+    BIGNUM *A = BN_bin2bn(a, len, NULL), *B = BN_bin2bn(b, len, NULL);
+    BIGNUM *M = BN_bin2bn(m, len, NULL), *R = BN_new();
+
+    BN_mod_add(R, A, B, M, ctx);
+    bn_write(R, r, len);
+
+    BN_free(A), BN_free(B), BN_free(M), BN_free(R);
+    BN_CTX_free(ctx);
+}
+
+void cx_math_powm(unsigned char *r,
+                  const unsigned char *a,
+                  const unsigned char *e,
+                  unsigned int len_e,
+                  const unsigned char *m,
+                  unsigned int len) {
+    BN_CTX *ctx = BN_CTX_new();
+    BIGNUM *A = BN_bin2bn(a, len, NULL), *E = BN_bin2bn(e, len_e, NULL);
+    BIGNUM *M = BN_bin2bn(m, len, NULL), *R = BN_new();
+
+    BN_mod_exp(R, A, E, M, ctx);
+    bn_write(R, r, len);
+
+    BN_free(A), BN_free(E), BN_free(M), BN_free(R);
+    BN_CTX_free(ctx);
+}
+
+/* ----------------------------------------------------------------------- */
+/* secp256k1                                                               */
+/* ----------------------------------------------------------------------- */
+
+static EC_GROUP *G_secp256k1;
+
+static const EC_GROUP *secp256k1(void) {
+    if (G_secp256k1 == NULL) {
+        G_secp256k1 = EC_GROUP_new_by_curve_name(NID_secp256k1);
+    }
+    return G_secp256k1;
+}
+
+static const BIGNUM *secp256k1_order(void) {
+    return EC_GROUP_get0_order(secp256k1());
+}
+
+// Returns the point of an uncompressed (or compressed) public key, or NULL if invalid.
+static EC_POINT *point_read(const unsigned char *P, size_t P_len, BN_CTX *ctx) {
+    EC_POINT *point = EC_POINT_new(secp256k1());
+    if (!EC_POINT_oct2point(secp256k1(), point, P, P_len, ctx)) {
+        EC_POINT_free(point);
+        return NULL;
+    }
+    return point;
+}
+
+// Writes a point uncompressed; returns 65, or 0 for the point at infinity.
+static int point_write(const EC_POINT *point, unsigned char *out, BN_CTX *ctx) {
+    if (EC_POINT_is_at_infinity(secp256k1(), point)) {
+        return 0;
+    }
+    return EC_POINT_point2oct(secp256k1(), point, POINT_CONVERSION_UNCOMPRESSED, out, 65, ctx);
+}
+
+// Computes k.G, with k big-endian; writes the coordinates of the point if not NULL.
+static void generator_mult(const BIGNUM *k, BIGNUM *x, BIGNUM *y, BN_CTX *ctx) {
+    EC_POINT *R = EC_POINT_new(secp256k1());
+    EC_POINT_mul(secp256k1(), R, k, NULL, NULL, ctx);
+    EC_POINT_get_affine_coordinates(secp256k1(), R, x, y, ctx);
+    EC_POINT_free(R);
+}
+
+int cx_ecfp_init_private_key(cx_curve_t curve,
+                             const unsigned char *rawkey,
+                             unsigned int key_len,
+                             cx_ecfp_private_key_t *pvkey) {
+    memset(pvkey, 0, sizeof(cx_ecfp_private_key_t));
+    pvkey->curve = curve;
+    if (rawkey != NULL) {
+        memcpy(pvkey->d, rawkey, MIN(key_len, sizeof(pvkey->d)));
+        pvkey->d_len = key_len;
+    }
+    return key_len;
+}
+
+int cx_ecfp_generate_pair(cx_curve_t curve,
+                          cx_ecfp_public_key_t *pubkey,
+                          cx_ecfp_private_key_t *privkey,
+                          int keepprivate) {
+    BN_CTX *ctx = BN_CTX_new();
+
+    if (!keepprivate) {
+        BIGNUM *d = BN_new();
+        BN_rand_range(d, secp256k1_order());
+        privkey->curve = curve;
+        privkey->d_len = 32;
+        BN_bn2binpad(d, privkey->d, 32);
+        BN_free(d);
+    }
+
+    BIGNUM *d = BN_bin2bn(privkey->d, 32, NULL), *x = BN_new(), *y = BN_new();
+    generator_mult(d, x, y, ctx);
+
+    pubkey->curve = curve;
+    pubkey->W_len = 65;
+    pubkey->W[0] = 0x04;
+    BN_bn2binpad(x, pubkey->W + 1, 32);
+    BN_bn2binpad(y, pubkey->W + 33, 32);
+
+    BN_clear_free(d), BN_free(x), BN_free(y);
+    BN_CTX_free(ctx);
+    return 0;
+}
+
+int cx_ecfp_scalar_mult(cx_curve_t curve,
+                        unsigned char *P,
+                        unsigned int P_len,
+                        const unsigned char *k,
+                        unsigned int k_len) {
+    (void) curve;
+
+    BN_CTX *ctx = BN_CTX_new();
+    EC_POINT *point = point_read(P, P_len, ctx);
+    if (point == NULL) {
+        BN_CTX_free(ctx);
+        THROW(INVALID_PARAMETER);
+    }
+
+    BIGNUM *K = BN_bin2bn(k, k_len, NULL);
+    EC_POINT_mul(secp256k1(), point, NULL, point, K, ctx);
+    int ret = point_write(point, P, ctx);
+
+    BN_clear_free(K);
+    EC_POINT_free(point);
+    BN_CTX_free(ctx);
+    return ret;
+}
+
+int cx_ecfp_add_point(cx_curve_t curve,
+                      unsigned char *R,
+                      const unsigned char *P,
+                      const unsigned char *Q,
+                      unsigned int X_len) {
+    (void) curve, (void) X_len;
+
+    BN_CTX *ctx = BN_CTX_new();
+    EC_POINT *p = point_read(P, 65, ctx), *q = point_read(Q, 65, ctx);
+    if (p == NULL || q == NULL) {
+        EC_POINT_free(p), EC_POINT_free(q);
+        BN_CTX_free(ctx);
+        THROW(INVALID_PARAMETER);
+    }
+
+    EC_POINT_add(secp256k1(), p, p, q, ctx);
+    int ret = point_write(p, R, ctx);
+
+    EC_POINT_free(p), EC_POINT_free(q);
+    BN_CTX_free(ctx);
+    return ret;
+}
+
+// Writes a DER integer of 32 bytes big-endian; returns its length.
+static size_t der_write_integer(const uint8_t value[static 32], uint8_t *out) {
+    size_t start = 0;
+    while (start < 31 && value[start] == 0) {
+        ++start;
+    }
+    bool pad = (value[start] & 0x80) != 0;
+
+    out[0] = 0x02;
+    out[1] = (uint8_t) (32 - start + pad);
+    out[2] = 0x00;
+    memcpy(out + 2 + pad, value + start, 32 - start);
+    return 2 + pad + 32 - start;
+}
+
+int cx_ecdsa_sign(const cx_ecfp_private_key_t *pvkey,
+                  int mode,
+                  cx_md_t hashID,
+                  const unsigned char *hash,
+                  unsigned int hash_len,
+                  unsigned char *sig,
+                  unsigned int sig_len,
+                  unsigned int *info) {
+    (void) mode, (void) hashID, (void) sig_len;
+
+    if (hash_len != 32) {
+        THROW(INVALID_PARAMETER);
+    }
+
+    BN_CTX *ctx = BN_CTX_new();
+    const BIGNUM *n = secp256k1_order();
+
+    // RFC 6979 with HMAC-SHA256; the hash is reduced modulo n
+    BIGNUM *h = BN_bin2bn(hash, 32, NULL);
+    BN_nnmod(h, h, n, ctx);
+    uint8_t h1[32];
+    BN_bn2binpad(h, h1, 32);
+
+    uint8_t V[32], K[32], data[32 + 1 + 32 + 32];
+    memset(V, 0x01, 32);
+    memset(K, 0x00, 32);
+    for (uint8_t step = 0x00; step <= 0x01; step++) {
+        memcpy(data, V, 32);
+        data[32] = step;
+        memcpy(data + 33, pvkey->d, 32);
+        memcpy(data + 65, h1, 32);
+        HMAC(EVP_sha256(), K, 32, data, sizeof(data), K, NULL);
+        HMAC(EVP_sha256(), K, 32, V, 32, V, NULL);
+    }
+
+    BIGNUM *d = BN_bin2bn(pvkey->d, 32, NULL), *k = BN_new(), *r = BN_new(), *s = BN_new();
+    BIGNUM *x = BN_new(), *y = BN_new(), *t = BN_new();
+    unsigned int parity = 0;
+    while (true) {
+        HMAC(EVP_sha256(), K, 32, V, 32, V, NULL);
+        BN_bin2bn(V, 32, k);
+        if (!BN_is_zero(k) && BN_cmp(k, n) < 0) {
+            generator_mult(k, x, y, ctx);
+            BN_nnmod(r, x, n, ctx);
+            parity = (BN_is_odd(y) ? CX_ECCINFO_PARITY_ODD : 0) |
+                     (BN_cmp(x, n) >= 0 ? CX_ECCINFO_xGTn : 0);
+
+            // s = k^-1 (h + r.d) mod n
+            BN_mod_mul(t, r, d, n, ctx);
+            BN_mod_add(t, t, h, n, ctx);
+            BN_mod_inverse(s, k, n, ctx);
+            BN_mod_mul(s, s, t, n, ctx);
+            if (!BN_is_zero(r) && !BN_is_zero(s)) {
+                break;
+            }
+        }
+
+        memcpy(data, V, 32);
+        data[32] = 0x00;
+        HMAC(EVP_sha256(), K, 32, data, 33, K, NULL);
+        HMAC(EVP_sha256(), K, 32, V, 32, V, NULL);
+    }
+
+    // low s, as required by the standardness rules of bitcoin
+    BN_rshift1(t, n);
+    if (BN_cmp(s, t) > 0) {
+        BN_sub(s, n, s);
+        parity ^= CX_ECCINFO_PARITY_ODD;
+    }
+
+    uint8_t r_bytes[32], s_bytes[32];
+    BN_bn2binpad(r, r_bytes, 32);
+    BN_bn2binpad(s, s_bytes, 32);
+
+    size_t len = 2;
+    len += der_write_integer(r_bytes, sig + len);
+    len += der_write_integer(s_bytes, sig + len);
+    sig[0] = 0x30;
+    sig[1] = (uint8_t) (len - 2);
+
+    if (info != NULL) {
+        *info = parity;
+    }
+
+    BN_free(h), BN_clear_free(d), BN_clear_free(k), BN_free(r), BN_free(s);
+    BN_free(x), BN_free(y), BN_clear_free(t);
+    BN_CTX_free(ctx);
+    return len;
+}
+
+// sha256(sha256(tag) || sha256(tag) || data), as in BIP-340.
+static void tagged_hash(const char *tag, const uint8_t *data, size_t data_len, uint8_t out[32]) {
+    uint8_t tag_hash[32];
+    SHA256((const uint8_t *) tag, strlen(tag), tag_hash);
+
+    SHA256_CTX ctx;
+    SHA256_Init(&ctx);
+    SHA256_Update(&ctx, tag_hash, 32);
+    SHA256_Update(&ctx, tag_hash, 32);
+    SHA256_Update(&ctx, data, data_len);
+    SHA256_Final(out, &ctx);
+}
+
+cx_err_t cx_ecschnorr_sign_no_throw(const cx_ecfp_private_key_t *pvkey,
+                                    uint32_t mode,
+                                    cx_md_t hashID,
+                                    const uint8_t *msg,
+                                    size_t msg_len,
+                                    uint8_t *sig,
+                                    size_t *sig_len) {
+    (void) mode, (void) hashID;
+
+    if (msg_len != 32) {
+        return INVALID_PARAMETER;
+    }
+
+    BN_CTX *ctx = BN_CTX_new();
+    const BIGNUM *n = secp256k1_order();
+    BIGNUM *d = BN_bin2bn(pvkey->d, 32, NULL), *k = BN_new(), *e = BN_new();
+    BIGNUM *x = BN_new(), *y = BN_new();
+
+    // P = d.G, with d negated if P has an odd y
+    uint8_t P_x[32];
+    generator_mult(d, x, y, ctx);
+    BN_bn2binpad(x, P_x, 32);
+    if (BN_is_odd(y)) {
+        BN_sub(d, n, d);
+    }
+
+    // the auxiliary randomness is all zeros, so that the signatures are deterministic
+    uint8_t d_bytes[32], t[32], aux[32] = {0};
+    BN_bn2binpad(d, d_bytes, 32);
+    tagged_hash("BIP0340/aux", aux, 32, aux);
+    for (int i = 0; i < 32; i++) {
+        t[i] = d_bytes[i] ^ aux[i];
+    }
+
+    uint8_t buf[32 + 32 + 32], rand[32];
+    memcpy(buf, t, 32);
+    memcpy(buf + 32, P_x, 32);
+    memcpy(buf + 64, msg, 32);
+    tagged_hash("BIP0340/nonce", buf, sizeof(buf), rand);
+    BN_bin2bn(rand, 32, k);
+    BN_nnmod(k, k, n, ctx);
+
+    // R = k.G, with k negated if R has an odd y
+    uint8_t R_x[32];
+    generator_mult(k, x, y, ctx);
+    BN_bn2binpad(x, R_x, 32);
+    if (BN_is_odd(y)) {
+        BN_sub(k, n, k);
+    }
+
+    uint8_t e_bytes[32];
+    memcpy(buf, R_x, 32);
+    memcpy(buf + 32, P_x, 32);
+    memcpy(buf + 64, msg, 32);
+    tagged_hash("BIP0340/challenge", buf, sizeof(buf), e_bytes);
+    BN_bin2bn(e_bytes, 32, e);
+    BN_nnmod(e, e, n, ctx);
+
+    // s = k + e.d mod n
+    BN_mod_mul(e, e, d, n, ctx);
+    BN_mod_add(e, e, k, n, ctx);
+
+    memcpy(sig, R_x, 32);
+    BN_bn2binpad(e, sig + 32, 32);
+    *sig_len = 64;
+
+    explicit_bzero(d_bytes, sizeof(d_bytes));
+    explicit_bzero(t, sizeof(t));
+    BN_clear_free(d), BN_clear_free(k), BN_clear_free(e), BN_free(x), BN_free(y);
+    BN_CTX_free(ctx);
+    return CX_OK;
+}
+
+/* ----------------------------------------------------------------------- */
+/* derivation of the keys                                                  */
+/* ----------------------------------------------------------------------- */
+
+static uint8_t G_seed[64];
+
+void sim_sdk_set_mnemonic(const char *mnemonic) {
+    PKCS5_PBKDF2_HMAC(mnemonic,
+                      strlen(mnemonic),
+                      (const unsigned char *) "mnemonic",
+                      8,
+                      2048,
+                      EVP_sha512(),
+                      sizeof(G_seed),
+                      G_seed);
+}
+
+void os_perso_derive_node_bip32(unsigned int curve,
+                                const unsigned int *path,
+                                unsigned int pathLength,
+                                unsigned char *privateKey,
+                                unsigned char *chain) {
+    (void) curve;
+
+    uint8_t I[64];
+    const char *key = "Bitcoin seed";
+    HMAC(EVP_sha512(), key, strlen(key), G_seed, sizeof(G_seed), I, NULL);
+
+    BN_CTX *ctx = BN_CTX_new();
+    BIGNUM *k = BN_bin2bn(I, 32, NULL), *t = BN_new(), *x = BN_new(), *y = BN_new();
+    for (unsigned int i = 0; i < pathLength; i++) {
+        // data = 0x00 || k || index for hardened children, the compressed k.G || index otherwise
+        uint8_t data[33 + 4];
+        if (path[i] & 0x80000000u) {
+            data[0] = 0x00;
+            BN_bn2binpad(k, data + 1, 32);
+        } else {
+            generator_mult(k, x, y, ctx);
+            data[0] = BN_is_odd(y) ? 0x03 : 0x02;
+            BN_bn2binpad(x, data + 1, 32);
+        }
+        for (int j = 0; j < 4; j++) {
+            data[33 + j] = (uint8_t) (path[i] >> (24 - 8 * j));
+        }
+
+        uint8_t chain_code[32];
+        memcpy(chain_code, I + 32, 32);
+        HMAC(EVP_sha512(), chain_code, 32, data, sizeof(data), I, NULL);
+
+        BN_bin2bn(I, 32, t);
+        BN_mod_add(k, k, t, secp256k1_order(), ctx);
+    }
+
+    if (privateKey != NULL) {
+        BN_bn2binpad(k, privateKey, 32);
+    }
+    if (chain != NULL) {
+        memcpy(chain, I + 32, 32);
+    }
+
+    explicit_bzero(I, sizeof(I));
+    BN_clear_free(k), BN_clear_free(t), BN_free(x), BN_free(y);
+    BN_CTX_free(ctx);
+}
+
+void os_perso_derive_node_with_seed_key(unsigned int mode,
+                                        unsigned int curve,
+                                        const unsigned int *path,
+                                        unsigned int pathLength,
+                                        unsigned char *privateKey,
+                                        unsigned char *chain,
+                                        unsigned char *seed_key,
+                                        unsigned int seed_key_length) {
+    (void) seed_key, (void) seed_key_length;
+
+    if (mode != HDW_SLIP21) {
+        os_perso_derive_node_bip32(curve, path, pathLength, privateKey, chain);
+        return;
+    }
+
+    // SLIP-0021: path is the label (with its 0x00 prefix), and the key is the right half of the node
+    uint8_t master[64], node[64];
+    const char *key = "Symmetric key seed";
+    HMAC(EVP_sha512(), key, strlen(key), G_seed, sizeof(G_seed), master, NULL);
+    HMAC(EVP_sha512(), master, 32, (const uint8_t *) path, pathLength, node, NULL);
+    memcpy(privateKey, node + 32, 32);
+
+    explicit_bzero(master, sizeof(master));
+    explicit_bzero(node, sizeof(node));
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+/**
+ * Sets the seed of the keys derived by the mocked SDK: the BIP-39 seed of the mnemonic, with an
+ * empty passphrase.
+ */
+void sim_sdk_set_mnemonic(const char *mnemonic);
@@ -0,0 +1,203 @@
+#include <stdbool.h>  // bool
+#include <stddef.h>   // NULL
+
+#include "os.h"
+#include "ux.h"
+
+#include "ui/display.h"
+#include "ui/menu.h"
+
+#include "sim_ui.h"
+
+/*
+  The screens of the app (ui/display.c), without the screens: each flow waiting for the user only
+  stores its callback, that the simulator calls with the configured answer once the dispatcher
+  returns, like the button of the last screen of the flow would on the device.
+*/
+
+extern dispatcher_context_t G_dispatcher_context;
+
+static struct {
+    action_validate_cb pending;
+    bool approve;
+    uint32_t n_flows;
+} G_sim_ui = {.approve = true};
+
+static void show_flow(action_validate_cb callback) {
+    G_sim_ui.pending = callback;
+    ++G_sim_ui.n_flows;
+}
+
+void sim_ui_set_approve(bool approve) {
+    G_sim_ui.approve = approve;
+}
+
+void sim_ui_reset(void) {
+    G_sim_ui.pending = NULL;
+    G_sim_ui.n_flows = 0;
+}
+
+uint32_t sim_ui_n_flows(void) {
+    return G_sim_ui.n_flows;
+}
+
+bool sim_ui_resolve_pending(void) {
+    action_validate_cb callback = G_sim_ui.pending;
+    if (callback == NULL) {
+        return false;
+    }
+
+    // the callback can show the next flow
+    G_sim_ui.pending = NULL;
+    callback(&G_dispatcher_context, G_sim_ui.approve);
+    return true;
+}
+
+void ux_flow_init(unsigned int stack_slot,
+                  const ux_flow_step_t *const *steps,
+                  const ux_flow_step_t *start_step) {
+    // only the "Processing..." screen of io.c, that does not wait for the user
+    (void) stack_slot, (void) steps, (void) start_step;
+}
+
+void ui_menu_main(void) {
+}
+
+void ui_display_pubkey(dispatcher_context_t *context,
+                       char *bip32_path_str,
+                       bool is_path_suspicious,
+                       char *pubkey,
+                       action_validate_cb callback) {
+    (void) context, (void) bip32_path_str, (void) is_path_suspicious, (void) pubkey;
+    show_flow(callback);
+}
+
+void ui_display_address(dispatcher_context_t *context,
+                        char *address,
+                        bool is_path_suspicious,
+                        char *bip32_path_str,
+                        action_validate_cb callback) {
+    (void) context, (void) address, (void) is_path_suspicious, (void) bip32_path_str;
+    show_flow(callback);
+}
+
+void ui_display_message(dispatcher_context_t *context,
+                        char *bip32_path_str,
+                        char *message,
+                        bool is_truncated,
+                        char *message_hash,
+                        action_validate_cb callback) {
+    (void) context, (void) bip32_path_str, (void) message, (void) is_truncated;
+    (void) message_hash;
+    show_flow(callback);
+}
+
+void ui_display_wallet_header(dispatcher_context_t *context,
+                              policy_map_wallet_header_t *wallet_header,
+                              action_validate_cb callback) {
+    (void) context, (void) wallet_header;
+    show_flow(callback);
+}
+
+void ui_display_policy_map_cosigner_pubkey(dispatcher_context_t *context,
+                                           char *pubkey,
+                                           uint8_t cosigner_index,
+                                           uint8_t n_keys,
+                                           bool is_internal,
+                                           action_validate_cb callback) {
+    (void) context, (void) pubkey, (void) cosigner_index, (void) n_keys, (void) is_internal;
+    show_flow(callback);
+}
+
+void ui_display_wallet_address(dispatcher_context_t *context,
+                               char *wallet_name,
+                               char *address,
+                               action_validate_cb callback) {
+    (void) context, (void) wallet_name, (void) address;
+    show_flow(callback);
+}
+
+void ui_display_unusual_path(dispatcher_context_t *context,
+                             char *bip32_path_str,
+                             action_validate_cb callback) {
+    (void) context, (void) bip32_path_str;
+    show_flow(callback);
+}
+
+void ui_authorize_wallet_spend(dispatcher_context_t *context,
+                               char *wallet_name,
+                               action_validate_cb callback) {
+    (void) context, (void) wallet_name;
+    show_flow(callback);
+}
+
+void ui_warn_external_inputs(dispatcher_context_t *context, action_validate_cb callback) {
+    (void) context;
+    show_flow(callback);
+}
+
+void ui_warn_nondefault_sighash(dispatcher_context_t *context, action_validate_cb callback) {
+    (void) context;
+    show_flow(callback);
+}
+
+char *ui_prepare_output(int index, const char *coin_name, uint64_t amount) {
+    // only the address is encoded by the caller
+    static char address[MAX_ADDRESS_LENGTH_STR + 1];
+
+    (void) index, (void) coin_name, (void) amount;
+    address[0] = '\0';
+    return address;
+}
+
+void ui_validate_output(dispatcher_context_t *context, action_validate_cb callback) {
+    (void) context;
+    show_flow(callback);
+}
+
+void ui_validate_output_summary(dispatcher_context_t *context,
+                                int n_outputs,
+                                char *outputs_hash,
+                                char *coin_name,
+                                uint64_t amount,
+                                action_validate_cb callback) {
+    (void) context, (void) n_outputs, (void) outputs_hash, (void) coin_name, (void) amount;
+    show_flow(callback);
+}
+
+void ui_validate_transaction(dispatcher_context_t *context,
+                             char *coin_name,
+                             uint64_t fee,
+                             action_validate_cb callback) {
+    (void) context, (void) coin_name, (void) fee;
+    show_flow(callback);
+}
+
+void ui_validate_proof_of_reserves(dispatcher_context_t *context,
+                                   char *message_hash,
+                                   char *coin_name,
+                                   uint64_t amount,
+                                   action_validate_cb callback) {
+    (void) context, (void) message_hash, (void) coin_name, (void) amount;
+    show_flow(callback);
+}
+
+void ui_display_spending_policy(dispatcher_context_t *context,
+                                char *wallet,
+                                char *coin_name,
+                                uint64_t max_tx_amount,
+                                uint64_t max_session_amount,
+                                uint32_t n_destinations,
+                                action_validate_cb callback) {
+    (void) context, (void) wallet, (void) coin_name, (void) max_tx_amount;
+    (void) max_session_amount, (void) n_destinations;
+    show_flow(callback);
+}
+
+void ui_display_spending_destination(dispatcher_context_t *context,
+                                     int index,
+                                     char *address,
+                                     action_validate_cb callback) {
+    (void) context, (void) index, (void) address;
+    show_flow(callback);
+}
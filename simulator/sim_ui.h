@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdbool.h>  // bool
+#include <stdint.h>   // uint*_t
+
+/**
+ * Sets the answer of the user to all the following flows: approve (the default), or reject.
+ */
+void sim_ui_set_approve(bool approve);
+
+/**
+ * Forgets the flow waiting for the user, if any, and resets the count of the flows.
+ */
+void sim_ui_reset(void);
+
+/**
+ * Returns the number of flows waiting for the user that were shown since the last reset.
+ */
+uint32_t sim_ui_n_flows(void);
+
+/**
+ * If a flow is waiting for the user, answers it by calling its callback, that resumes the
+ * dispatcher; returns false if there is none.
+ */
+bool sim_ui_resolve_pending(void);
@@ -0,0 +1,61 @@
+// Generated by gen_sim_vectors.py; do not edit.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SIM_VECTOR_MAX_KEYS       2
+#define SIM_VECTOR_MAX_SIGNATURES 2
+
+typedef struct {
+    const char *name;
+    const uint8_t *psbt;  // binary, version 2
+    size_t psbt_len;
+    const uint8_t *wallet;  // serialized wallet policy
+    size_t wallet_len;
+    const char *keys_info[SIM_VECTOR_MAX_KEYS];
+    size_t n_keys;
+    size_t n_signatures;
+    struct {
+        uint8_t input_index;
+        size_t len;
+        uint8_t sig[73];  // DER-encoded, with the sighash byte
+    } signatures[SIM_VECTOR_MAX_SIGNATURES];
+} sim_vector_t;
+
+static const uint8_t wpkh_1to2_psbt[] = {0x70, 0x73, 0x62, 0x74, 0xff, 0x01, 0x00, 0x0a, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x04, 0x02, 0x00, 0x00, 0x00, 0x01, 0x03, 0x04, 0x00, 0x00, 0x00, 0x00, 0x01, 0x04, 0x01, 0x01, 0x01, 0x05, 0x01, 0x02, 0x01, 0xfb, 0x04, 0x02, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x7d, 0x02, 0x00, 0x00, 0x00, 0x01, 0xaf, 0xbf, 0xae, 0x06, 0x59, 0x0f, 0x74, 0x1f, 0xf1, 0xaf, 0x59, 0xb6, 0xac, 0x46, 0x11, 0x26, 0x33, 0x6a, 0x4c, 0x4a, 0x82, 0xdb, 0x55, 0x3d, 0xf6, 0xfe, 0xfa, 0xb7, 0x37, 0xac, 0x33, 0xf3, 0x01, 0x00, 0x00, 0x00, 0x00, 0xfd, 0xff, 0xff, 0xff, 0x02, 0x70, 0x11, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x22, 0x00, 0x20, 0xfd, 0xee, 0x44, 0x1c, 0x56, 0xe5, 0xb0, 0x6d, 0x0d, 0xf8, 0x2c, 0x12, 0x4c, 0x70, 0x70, 0x14, 0xa5, 0xca, 0x19, 0x65, 0x8b, 0xe0, 0xb9, 0x85, 0x6b, 0xca, 0x16, 0xf1, 0xed, 0x32, 0x59, 0xf7, 0xa5, 0xf4, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x16, 0x00, 0x14, 0x3a, 0xf8, 0x42, 0x9a, 0xd5, 0x95, 0x4a, 0xa5, 0xee, 0x8a, 0x33, 0xc9, 0x83, 0xfd, 0x8a, 0x1e, 0x86, 0x79, 0x92, 0x4b, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x1f, 0xa5, 0xf4, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x16, 0x00, 0x14, 0x3a, 0xf8, 0x42, 0x9a, 0xd5, 0x95, 0x4a, 0xa5, 0xee, 0x8a, 0x33, 0xc9, 0x83, 0xfd, 0x8a, 0x1e, 0x86, 0x79, 0x92, 0x4b, 0x22, 0x06, 0x03, 0xee, 0x2c, 0x3d, 0x98, 0xeb, 0x1f, 0x93, 0xc0, 0xa1, 0xaa, 0x8e, 0x5a, 0x40, 0x09, 0xb7, 0x0e, 0xb7, 0xb4, 0x4e, 0xad, 0x15, 0xf1, 0x66, 0x6f, 0x13, 0x6b, 0x01, 0x2a, 0xd5, 0x8d, 0x30, 0x68, 0x18, 0xf5, 0xac, 0xc2, 0xfd, 0x54, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x01, 0x0e, 0x20, 0x7a, 0x2a, 0x99, 0x79, 0x56, 0xc0, 0x9f, 0x8e, 0xa7, 0xfd, 0x28, 0x19, 0xc1, 0xa9, 0x87, 0xbb, 0x14, 0xe2, 0x2b, 0xf9, 0xad, 0xcd, 0xaf, 0x20, 0xa8, 0x97, 0x63, 0x72, 0x2c, 0xee, 0xe2, 0x64, 0x01, 0x0f, 0x04, 0x01, 0x00, 0x00, 0x00, 0x01, 0x10, 0x04, 0xfd, 0xff, 0xff, 0xff, 0x01, 0x12, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x03, 0x08, 0xa0, 0xbb, 0x0d, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x04, 0x19, 0x76, 0xa9, 0x14, 0x34, 0x4a, 0x0f, 0x48, 0xca, 0x15, 0x0e, 0xc2, 0xb9, 0x03, 0x81, 0x76, 0x60, 0xb9, 0xb6, 0x8b, 0x13, 0xa6, 0x70, 0x26, 0x88, 0xac, 0x00, 0x22, 0x02, 0x02, 0x29, 0xec, 0x47, 0x72, 0x71, 0x31, 0xed, 0x25, 0x88, 0xa2, 0x0c, 0x46, 0xed, 0xa9, 0xab, 0xb7, 0xda, 0xa6, 0xf4, 0x9f, 0xd5, 0x0b, 0xaf, 0xe7, 0x0b, 0x9c, 0x5a, 0xa6, 0x96, 0x1c, 0x4e, 0xcc, 0x18, 0xf5, 0xac, 0xc2, 0xfd, 0x54, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x01, 0x03, 0x08, 0x74, 0x38, 0x23, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x04, 0x16, 0x00, 0x14, 0xeb, 0x38, 0xfa, 0x9b, 0x81, 0x28, 0xf8, 0x1f, 0x26, 0xe9, 0x5e, 0xdb, 0x0c, 0x5f, 0xfa, 0xea, 0x83, 0x69, 0x0f, 0xe4, 0x00};
+static const uint8_t wpkh_1to2_wallet[] = {0x01, 0x00, 0x08, 0x77, 0x70, 0x6b, 0x68, 0x28, 0x40, 0x30, 0x29, 0x01, 0xac, 0x0e, 0xfe, 0x99, 0xff, 0x9d, 0x29, 0x2d, 0x0e, 0x7b, 0xd2, 0xea, 0xb1, 0xb2, 0x44, 0x80, 0xf9, 0x63, 0xc5, 0x2a, 0xfe, 0x2e, 0x65, 0x5d, 0x96, 0x68, 0x27, 0xd3, 0xef, 0xbb, 0xe3, 0x40};
+
+static const uint8_t wpkh_2to2_psbt[] = {0x70, 0x73, 0x62, 0x74, 0xff, 0x01, 0x00, 0x0a, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x04, 0x02, 0x00, 0x00, 0x00, 0x01, 0x03, 0x04, 0x00, 0x00, 0x00, 0x00, 0x01, 0x04, 0x01, 0x02, 0x01, 0x05, 0x01, 0x02, 0x01, 0xfb, 0x04, 0x02, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x71, 0x02, 0x00, 0x00, 0x00, 0x01, 0x93, 0x6a, 0xb2, 0xe0, 0x10, 0x72, 0xf7, 0x93, 0xcf, 0xe4, 0xc9, 0x77, 0x54, 0xde, 0x1b, 0x61, 0xfe, 0x03, 0xe7, 0xdb, 0x65, 0x36, 0xc8, 0xb2, 0xf2, 0x1d, 0xd0, 0xb5, 0x74, 0x2c, 0x48, 0x45, 0x01, 0x00, 0x00, 0x00, 0x00, 0xfe, 0xff, 0xff, 0xff, 0x02, 0xde, 0xe1, 0xc7, 0x00, 0x00, 0x00, 0x00, 0x00, 0x16, 0x00, 0x14, 0xeb, 0x78, 0xd7, 0xc4, 0x0b, 0xf1, 0x06, 0x3b, 0x0e, 0x3f, 0xce, 0x29, 0xc3, 0x56, 0x5b, 0x68, 0x9c, 0x85, 0x59, 0xab, 0x10, 0x27, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x16, 0x00, 0x14, 0x23, 0x18, 0xd6, 0x6f, 0x84, 0xfe, 0xf5, 0xc4, 0x87, 0x5f, 0x93, 0x3b, 0x03, 0x8d, 0xc6, 0x38, 0x31, 0xf8, 0xda, 0x13, 0xf9, 0x97, 0x1e, 0x00, 0x01, 0x01, 0x1f, 0x10, 0x27, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x16, 0x00, 0x14, 0x23, 0x18, 0xd6, 0x6f, 0x84, 0xfe, 0xf5, 0xc4, 0x87, 0x5f, 0x93, 0x3b, 0x03, 0x8d, 0xc6, 0x38, 0x31, 0xf8, 0xda, 0x13, 0x22, 0x06, 0x03, 0x45, 0x5e, 0xe7, 0xce, 0xdc, 0x97, 0xb0, 0xba, 0x43, 0x5b, 0x80, 0x06, 0x6f, 0xc9, 0x2c, 0x96, 0x3a, 0x34, 0xc6, 0x00, 0x31, 0x79, 0x81, 0xd1, 0x35, 0x33, 0x0c, 0x4e, 0xe4, 0x3a, 0xc7, 0xa3, 0x18, 0xf5, 0xac, 0xc2, 0xfd, 0x54, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x0e, 0x20, 0x9e, 0x2c, 0xfe, 0x27, 0xf0, 0xad, 0x87, 0xb7, 0x8a, 0x23, 0x7d, 0x5d, 0x74, 0x05, 0xd4, 0xa3, 0x06, 0x66, 0xca, 0x36, 0x1d, 0x58, 0x5a, 0x46, 0x7b, 0x0d, 0xfe, 0x42, 0x26, 0x2b, 0x4d, 0xb4, 0x01, 0x0f, 0x04, 0x01, 0x00, 0x00, 0x00, 0x01, 0x10, 0x04, 0xfd, 0xff, 0xff, 0xff, 0x01, 0x12, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x71, 0x01, 0x00, 0x00, 0x00, 0x01, 0x0e, 0x47, 0x1e, 0xf4, 0xe9, 0x2c, 0x1a, 0xcb, 0x51, 0xef, 0xc8, 0x66, 0x0f, 0x8d, 0x3f, 0x69, 0x93, 0x6e, 0xa9, 0xc9, 0xb2, 0xbf, 0xf7, 0x2f, 0xf9, 0xbc, 0x81, 0xc5, 0x1e, 0xfc, 0xf4, 0x64, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x60, 0xae, 0x0a, 0x00, 0x00, 0x00, 0x00, 0x00, 0x16, 0x00, 0x14, 0x35, 0xc6, 0xe0, 0xdd, 0x6d, 0x3c, 0x84, 0xb1, 0x6b, 0xa8, 0x85, 0xdc, 0xa7, 0x3a, 0xc8, 0x63, 0xd0, 0xb5, 0x93, 0xec, 0xaf, 0x06, 0x32, 0x00, 0x00, 0x00, 0x00, 0x00, 0x16, 0x00, 0x14, 0xdc, 0x28, 0x6e, 0x0c, 0xd2, 0xe6, 0xbd, 0x37, 0xce, 0xbe, 0x9e, 0xc3, 0x49, 0xfb, 0x5f, 0x08, 0x90, 0x56, 0x72, 0xfc, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x1f, 0x60, 0xae, 0x0a, 0x00, 0x00, 0x00, 0x00, 0x00, 0x16, 0x00, 0x14, 0x35, 0xc6, 0xe0, 0xdd, 0x6d, 0x3c, 0x84, 0xb1, 0x6b, 0xa8, 0x85, 0xdc, 0xa7, 0x3a, 0xc8, 0x63, 0xd0, 0xb5, 0x93, 0xec, 0x22, 0x06, 0x02, 0x71, 0xb5, 0xb7, 0x79, 0xad, 0x87, 0x08, 0x38, 0x58, 0x77, 0x97, 0xbc, 0xf6, 0xf0, 0xc7, 0xae, 0xc5, 0xab, 0xe7, 0x6a, 0x70, 0x9d, 0x72, 0x4f, 0x48, 0xd2, 0xe2, 0x6c, 0xf8, 0x74, 0xf0, 0xa0, 0x18, 0xf5, 0xac, 0xc2, 0xfd, 0x54, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x0e, 0x20, 0xaf, 0xbf, 0xae, 0x06, 0x59, 0x0f, 0x74, 0x1f, 0xf1, 0xaf, 0x59, 0xb6, 0xac, 0x46, 0x11, 0x26, 0x33, 0x6a, 0x4c, 0x4a, 0x82, 0xdb, 0x55, 0x3d, 0xf6, 0xfe, 0xfa, 0xb7, 0x37, 0xac, 0x33, 0xf3, 0x01, 0x0f, 0x04, 0x00, 0x00, 0x00, 0x00, 0x01, 0x10, 0x04, 0xfd, 0xff, 0xff, 0xff, 0x01, 0x12, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x22, 0x02, 0x02, 0x29, 0xec, 0x47, 0x72, 0x71, 0x31, 0xed, 0x25, 0x88, 0xa2, 0x0c, 0x46, 0xed, 0xa9, 0xab, 0xb7, 0xda, 0xa6, 0xf4, 0x9f, 0xd5, 0x0b, 0xaf, 0xe7, 0x0b, 0x9c, 0x5a, 0xa6, 0x96, 0x1c, 0x4e, 0xcc, 0x18, 0xf5, 0xac, 0xc2, 0xfd, 0x54, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x01, 0x03, 0x08, 0xa8, 0x3a, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x04, 0x16, 0x00, 0x14, 0xeb, 0x38, 0xfa, 0x9b, 0x81, 0x28, 0xf8, 0x1f, 0x26, 0xe9, 0x5e, 0xdb, 0x0c, 0x5f, 0xfa, 0xea, 0x83, 0x69, 0x0f, 0xe4, 0x00, 0x01, 0x03, 0x08, 0xe0, 0x93, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x04, 0x22, 0x00, 0x20, 0x3f, 0xa9, 0x66, 0xc9, 0xdd, 0xcd, 0xc2, 0xfd, 0x96, 0xe4, 0xa5, 0xe1, 0xbc, 0x76, 0x5b, 0x9f, 0xaf, 0x6c, 0xe8, 0xb3, 0xeb, 0x4f, 0x11, 0x04, 0xaa, 0xd6, 0xbd, 0xf7, 0x73, 0x24, 0xe5, 0xbe, 0x00};
+static const uint8_t wpkh_2to2_wallet[] = {0x01, 0x00, 0x08, 0x77, 0x70, 0x6b, 0x68, 0x28, 0x40, 0x30, 0x29, 0x01, 0xac, 0x0e, 0xfe, 0x99, 0xff, 0x9d, 0x29, 0x2d, 0x0e, 0x7b, 0xd2, 0xea, 0xb1, 0xb2, 0x44, 0x80, 0xf9, 0x63, 0xc5, 0x2a, 0xfe, 0x2e, 0x65, 0x5d, 0x96, 0x68, 0x27, 0xd3, 0xef, 0xbb, 0xe3, 0x40};
+
+static const sim_vector_t sim_vectors[] = {
+    {
+        .name = "wpkh_1to2",
+        .psbt = wpkh_1to2_psbt,
+        .psbt_len = sizeof(wpkh_1to2_psbt),
+        .wallet = wpkh_1to2_wallet,
+        .wallet_len = sizeof(wpkh_1to2_wallet),
+        .keys_info = {"[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"},
+        .n_keys = 1,
+        .n_signatures = 1,
+        .signatures = {
+            {0, 72, {0x30, 0x45, 0x02, 0x21, 0x00, 0xab, 0x44, 0xf3, 0x4d, 0xd7, 0xe8, 0x7c, 0x90, 0x54, 0x59, 0x12, 0x97, 0xa1, 0x01, 0xe8, 0x50, 0x0a, 0x06, 0x41, 0xd1, 0xd5, 0x91, 0x87, 0x8d, 0x0d, 0x23, 0xcf, 0x80, 0x96, 0xfa, 0x79, 0xe8, 0x02, 0x20, 0x5d, 0x12, 0xd1, 0x06, 0x2d, 0x92, 0x5e, 0x27, 0xb5, 0x7b, 0xdc, 0xf9, 0x94, 0xec, 0xf3, 0x32, 0xad, 0x0a, 0x8e, 0x67, 0xb8, 0xfe, 0x40, 0x7b, 0xab, 0x21, 0x01, 0x25, 0x5d, 0xa6, 0x32, 0xaa, 0x01}},
+        },
+    },
+    {
+        .name = "wpkh_2to2",
+        .psbt = wpkh_2to2_psbt,
+        .psbt_len = sizeof(wpkh_2to2_psbt),
+        .wallet = wpkh_2to2_wallet,
+        .wallet_len = sizeof(wpkh_2to2_wallet),
+        .keys_info = {"[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"},
+        .n_keys = 1,
+        .n_signatures = 2,
+        .signatures = {
+            {0, 71, {0x30, 0x44, 0x02, 0x20, 0x6b, 0x3e, 0x87, 0x76, 0x55, 0xf0, 0x8c, 0x6e, 0x7b, 0x1b, 0x74, 0xd6, 0xd8, 0x93, 0xa8, 0x2c, 0xdf, 0x79, 0x9f, 0x68, 0xa5, 0xae, 0x7c, 0xec, 0xae, 0x63, 0xa7, 0x1b, 0x03, 0x39, 0xe5, 0xce, 0x02, 0x20, 0x19, 0xb9, 0x4a, 0xa3, 0xfb, 0x66, 0x35, 0x95, 0x6e, 0x10, 0x9f, 0x3d, 0x89, 0xc9, 0x96, 0xb1, 0xbf, 0xbb, 0xaf, 0x3c, 0x61, 0x91, 0x34, 0xb5, 0xa3, 0x02, 0xba, 0xdf, 0xaf, 0x52, 0x18, 0x0e, 0x01}},
+            {1, 72, {0x30, 0x45, 0x02, 0x21, 0x00, 0xe2, 0xe9, 0x8e, 0x4f, 0x8c, 0x70, 0x27, 0x4f, 0x10, 0x14, 0x5c, 0x89, 0xa5, 0xd8, 0x6e, 0x21, 0x6d, 0x03, 0x76, 0xbd, 0xf9, 0xf4, 0x2f, 0x82, 0x9e, 0x43, 0x15, 0xea, 0x67, 0xd7, 0x9d, 0x21, 0x02, 0x20, 0x74, 0x35, 0x89, 0xfd, 0x4f, 0x55, 0xe5, 0x40, 0x54, 0x0a, 0x97, 0x6a, 0x5a, 0xf5, 0x8a, 0xcd, 0x61, 0x0f, 0xa5, 0xe1, 0x88, 0xa5, 0x09, 0x6d, 0xfe, 0x7d, 0x36, 0xba, 0xf3, 0xaf, 0xb9, 0x40, 0x01}},
+        },
+    },
+};
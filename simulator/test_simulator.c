@@ -0,0 +1,578 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "cx.h"
+
+#include "boilerplate/sw.h"
+#include "constants.h"
+#include "commands.h"
+#include "common/buffer.h"
+#include "common/psbt.h"
+#include "common/spending_policy.h"
+#include "common/varint.h"
+#include "handler/sign_psbt.h"
+
+#include "host_interpreter.h"
+#include "sim_device.h"
+#include "sim_host.h"
+#include "sim_ui.h"
+#include "sim_vectors.h"
+
+// keys of SIM_DEFAULT_MNEMONIC, as returned by speculos
+#define MASTER_FINGERPRINT 0xF5ACC2FD
+#define ACCOUNT_84_TPUB                                                                         \
+    "tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1" \
+    "d7QkdbL52Ty5jiSLcxPt1P"
+
+static int setup(void **state) {
+    (void) state;
+
+    sim_device_init(SIM_DEFAULT_MNEMONIC);
+    sim_device_set_prefetch(false);
+    sim_ui_set_approve(true);
+    return 0;
+}
+
+// Adds the wallet policy of a vector to the interpreter, and computes its id.
+static void add_vector_wallet(host_interpreter_t *interpreter,
+                              const sim_vector_t *vector,
+                              uint8_t wallet_id[static 32]) {
+    uint8_t keys_info[SIM_VECTOR_MAX_KEYS * 256];
+    size_t key_info_lens[SIM_VECTOR_MAX_KEYS];
+    size_t pos = 0;
+    for (size_t i = 0; i < vector->n_keys; i++) {
+        key_info_lens[i] = strlen(vector->keys_info[i]);
+        memcpy(keys_info + pos, vector->keys_info[i], key_info_lens[i]);
+        pos += key_info_lens[i];
+    }
+
+    assert_int_equal(sim_host_add_wallet(interpreter,
+                                         vector->wallet,
+                                         vector->wallet_len,
+                                         keys_info,
+                                         key_info_lens,
+                                         vector->n_keys,
+                                         wallet_id),
+                     0);
+}
+
+// Prepares the SIGN_PSBT of a vector, with the given mode; returns the length of the data.
+static size_t prepare_sign_psbt(host_interpreter_t *interpreter,
+                                const sim_vector_t *vector,
+                                uint8_t mode,
+                                uint8_t data[static SIM_MAX_SIGN_PSBT_DATA_SIZE]) {
+    uint8_t wallet_id[32];
+    add_vector_wallet(interpreter, vector, wallet_id);
+
+    int len =
+        sim_host_prepare_psbt(interpreter, vector->psbt, vector->psbt_len, wallet_id, NULL, data);
+    assert_true(len > 0);
+
+    if (mode != 0) {
+        data[len++] = mode;
+    }
+    return len;
+}
+
+// Checks that the signatures yielded by the app are the expected ones, ignoring the progress events.
+static void assert_signatures(const host_interpreter_t *interpreter, const sim_vector_t *vector) {
+    size_t n_signatures = 0;
+    for (size_t i = 0; i < host_interpreter_n_yielded(interpreter); i++) {
+        size_t len;
+        const uint8_t *yielded = host_interpreter_get_yielded(interpreter, i, &len);
+        if (len == SIGN_PSBT_PROGRESS_LEN) {
+            continue;
+        }
+
+        assert_true(n_signatures < vector->n_signatures);
+        assert_int_equal(yielded[0], vector->signatures[n_signatures].input_index);
+        assert_int_equal(len - 1, vector->signatures[n_signatures].len);
+        assert_memory_equal(yielded + 1,
+                            vector->signatures[n_signatures].sig,
+                            vector->signatures[n_signatures].len);
+        ++n_signatures;
+    }
+    assert_int_equal(n_signatures, vector->n_signatures);
+}
+
+// Returns the length of the map at the start of a serialized PSBT, with its terminator; if
+// input_count_offset is not NULL, sets it to the offset of the record of PSBT_GLOBAL_INPUT_COUNT.
+static size_t psbt_map_len(const uint8_t *map, size_t *input_count_offset) {
+    size_t pos = 0;
+    while (map[pos] != 0x00) {
+        uint64_t key_len, value_len;
+        size_t record_offset = pos;
+        pos += varint_read(map + pos, 9, &key_len);
+        if (input_count_offset != NULL && key_len == 1 && map[pos] == PSBT_GLOBAL_INPUT_COUNT) {
+            *input_count_offset = record_offset;
+        }
+        pos += key_len;
+        pos += varint_read(map + pos, 9, &value_len);
+        pos += value_len;
+    }
+    return pos + 1;
+}
+
+// Writes the PSBT of a vector of a single input, with that input repeated n_inputs times; returns
+// its length. The inputs spend the same outpoint, which the app does not check.
+static size_t repeat_vector_input(const sim_vector_t *vector,
+                                  size_t n_inputs,
+                                  uint8_t *out,
+                                  size_t out_size) {
+    const uint8_t *psbt = vector->psbt;
+    size_t input_count_offset = 0;
+    size_t global_len = psbt_map_len(psbt + 5, &input_count_offset);
+    size_t input_len = psbt_map_len(psbt + 5 + global_len, NULL);
+    size_t outputs_len = vector->psbt_len - 5 - global_len - input_len;
+    // the record of the count of a single input: {0x01, PSBT_GLOBAL_INPUT_COUNT, 0x01, 0x01}
+    const uint8_t *input_count_record = psbt + 5 + input_count_offset;
+    assert_int_equal(input_count_record[2], 1);
+    assert_int_equal(input_count_record[3], 1);
+
+    uint8_t input_count[3];
+    size_t input_count_len = varint_write(input_count, 0, n_inputs);
+    size_t len = 5 + global_len - 1 + input_count_len + n_inputs * input_len + outputs_len;
+    assert_true(len <= out_size);
+
+    uint8_t *pos = out;
+    memcpy(pos, psbt, 5 + input_count_offset + 2);
+    pos += 5 + input_count_offset + 2;
+    *pos++ = (uint8_t) input_count_len;
+    memcpy(pos, input_count, input_count_len);
+    pos += input_count_len;
+    memcpy(pos, input_count_record + 4, global_len - input_count_offset - 4);
+    pos += global_len - input_count_offset - 4;
+    for (size_t i = 0; i < n_inputs; i++) {
+        memcpy(pos, psbt + 5 + global_len, input_len);
+        pos += input_len;
+    }
+    memcpy(pos, psbt + 5 + global_len + input_len, outputs_len);
+    pos += outputs_len;
+    assert_int_equal(pos - out, len);
+    return len;
+}
+
+static void test_get_master_fingerprint(void **state) {
+    (void) state;
+
+    host_interpreter_t *interpreter = host_interpreter_new();
+    sim_result_t result;
+    assert_int_equal(
+        sim_device_exchange(interpreter, CLA_APP, GET_MASTER_FINGERPRINT, 0, 0, NULL, 0, &result),
+        0);
+
+    assert_int_equal(result.sw, SW_OK);
+    assert_int_equal(result.data_len, 4);
+    const uint8_t expected[] = {(MASTER_FINGERPRINT >> 24) & 0xFF,
+                                (MASTER_FINGERPRINT >> 16) & 0xFF,
+                                (MASTER_FINGERPRINT >> 8) & 0xFF,
+                                MASTER_FINGERPRINT & 0xFF};
+    assert_memory_equal(result.data, expected, 4);
+
+    assert_int_equal(result.total.n_apdus, 1);
+    assert_int_equal(result.total.n_interruptions, 0);
+    assert_int_equal(result.n_ui_flows, 0);
+
+    host_interpreter_free(interpreter);
+}
+
+static void test_get_extended_pubkey(void **state) {
+    (void) state;
+
+    host_interpreter_t *interpreter = host_interpreter_new();
+    sim_result_t result;
+
+    // m/84'/1'/0', without display
+    const uint8_t data[] = {0x00, 0x03, 0x80, 0x00, 0x00, 84, 0x80, 0x00, 0x00, 1, 0x80, 0x00, 0x00, 0};
+    assert_int_equal(sim_device_exchange(interpreter,
+                                         CLA_APP,
+                                         GET_EXTENDED_PUBKEY,
+                                         0,
+                                         0,
+                                         data,
+                                         sizeof(data),
+                                         &result),
+                     0);
+
+    assert_int_equal(result.sw, SW_OK);
+    assert_int_equal(result.data_len, strlen(ACCOUNT_84_TPUB));
+    assert_memory_equal(result.data, ACCOUNT_84_TPUB, strlen(ACCOUNT_84_TPUB));
+
+    host_interpreter_free(interpreter);
+}
+
+static void test_get_extended_pubkey_unhardened_tail(void **state) {
+    (void) state;
+
+    host_interpreter_t *interpreter = host_interpreter_new();
+    sim_result_t result;
+
+    // m/84'/1'/2'/0/10, without display; the expected value is the one of tests/test_get_pubkey.py
+    const uint8_t data[] = {0x00, 0x05, 0x80, 0x00, 0x00, 84, 0x80, 0x00, 0x00, 1, 0x80, 0x00,
+                            0x00, 2,    0x00, 0x00, 0x00, 0,  0x00, 0x00, 0x00, 10};
+    const char expected[] =
+        "tpubDG9YpSUwScWJBBSrhnAT47NcT4NZGLcY18cpkaiWHnkUCi19EtCh8Heeox268NaFF6o56nVeSXuTyK6jpzTvV"
+        "1h68Kr3edA8AZp27MiLUNt";
+
+    // the second time, the account key is in the xpub cache, and only the tail is derived
+    unsigned int ec_scalar_mults[2];
+    for (int i = 0; i < 2; i++) {
+        assert_int_equal(sim_device_exchange(interpreter,
+                                             CLA_APP,
+                                             GET_EXTENDED_PUBKEY,
+                                             0,
+                                             0,
+                                             data,
+                                             sizeof(data),
+                                             &result),
+                         0);
+        assert_int_equal(result.sw, SW_OK);
+        assert_int_equal(result.data_len, strlen(expected));
+        assert_memory_equal(result.data, expected, strlen(expected));
+        ec_scalar_mults[i] = result.total.ec_scalar_mults;
+    }
+    assert_true(ec_scalar_mults[1] < ec_scalar_mults[0]);
+
+    host_interpreter_free(interpreter);
+}
+
+static void test_sign_psbt(void **state) {
+    (void) state;
+
+    for (size_t v = 0; v < sizeof(sim_vectors) / sizeof(sim_vectors[0]); v++) {
+        const sim_vector_t *vector = &sim_vectors[v];
+
+        host_interpreter_t *interpreter = host_interpreter_new();
+        uint8_t data[SIM_MAX_SIGN_PSBT_DATA_SIZE];
+        size_t data_len = prepare_sign_psbt(interpreter, vector, 0, data);
+
+        sim_result_t result;
+        assert_int_equal(
+            sim_device_exchange(interpreter, CLA_APP, SIGN_PSBT, 0, 0, data, data_len, &result),
+            0);
+        assert_int_equal(result.sw, SW_OK);
+        assert_signatures(interpreter, vector);
+
+        // all the client commands interrupt, with their own apdu
+        assert_true(result.total.n_interruptions > 0);
+        assert_int_equal(result.total.n_apdus, 1 + result.total.n_interruptions);
+        assert_true(result.total.sha256_digests > 0);
+        assert_true(result.n_ui_flows > 0);
+
+        // without progress events, everything is in the first phase
+        assert_memory_equal(&result.phases[SIM_PHASE_SETUP], &result.total, sizeof(result.total));
+
+        host_interpreter_free(interpreter);
+    }
+}
+
+static void test_sign_psbt_rejected(void **state) {
+    (void) state;
+
+    host_interpreter_t *interpreter = host_interpreter_new();
+    uint8_t data[SIM_MAX_SIGN_PSBT_DATA_SIZE];
+    size_t data_len = prepare_sign_psbt(interpreter, &sim_vectors[0], 0, data);
+
+    sim_ui_set_approve(false);
+    sim_result_t result;
+    assert_int_equal(
+        sim_device_exchange(interpreter, CLA_APP, SIGN_PSBT, 0, 0, data, data_len, &result),
+        0);
+    assert_int_equal(result.sw, SW_DENY);
+    assert_int_equal(host_interpreter_n_yielded(interpreter), 0);
+
+    host_interpreter_free(interpreter);
+}
+
+static void test_sign_psbt_summary(void **state) {
+    (void) state;
+
+    sim_result_t results[2];
+    const uint8_t modes[2] = {SIGN_PSBT_MODE_SIGN, SIGN_PSBT_MODE_SUMMARY};
+    for (int i = 0; i < 2; i++) {
+        host_interpreter_t *interpreter = host_interpreter_new();
+        uint8_t data[SIM_MAX_SIGN_PSBT_DATA_SIZE];
+        size_t data_len = prepare_sign_psbt(interpreter, &sim_vectors[1], modes[i], data);
+        assert_int_equal(
+            sim_device_exchange(interpreter, CLA_APP, SIGN_PSBT, 0, 0, data, data_len, &results[i]),
+            0);
+        assert_int_equal(results[i].sw, SW_OK);
+        assert_signatures(interpreter, &sim_vectors[1]);
+        host_interpreter_free(interpreter);
+    }
+
+    // the single external output is validated with the summary instead of its own flow
+    assert_int_equal(results[1].n_ui_flows, results[0].n_ui_flows);
+}
+
+static void test_sign_psbt_phases(void **state) {
+    (void) state;
+
+    host_interpreter_t *interpreter = host_interpreter_new();
+    uint8_t data[SIM_MAX_SIGN_PSBT_DATA_SIZE];
+    size_t data_len =
+        prepare_sign_psbt(interpreter, &sim_vectors[0], SIGN_PSBT_MODE_FLAG_PROGRESS, data);
+
+    sim_result_t result;
+    assert_int_equal(
+        sim_device_exchange(interpreter, CLA_APP, SIGN_PSBT, 0, 0, data, data_len, &result),
+        0);
+    assert_int_equal(result.sw, SW_OK);
+    assert_signatures(interpreter, &sim_vectors[0]);
+
+    // the phases add up to the total
+    sim_counters_t sum = {0};
+    for (int phase = 0; phase < SIM_N_PHASES; phase++) {
+        // each phase interrupts at least for its progress events
+        assert_true(result.phases[phase].n_interruptions > 0);
+
+        sum.n_apdus += result.phases[phase].n_apdus;
+        sum.n_interruptions += result.phases[phase].n_interruptions;
+        sum.bytes_received += result.phases[phase].bytes_received;
+        sum.bytes_sent += result.phases[phase].bytes_sent;
+        sum.sha256_bytes += result.phases[phase].sha256_bytes;
+        sum.sha256_digests += result.phases[phase].sha256_digests;
+        sum.ec_scalar_mults += result.phases[phase].ec_scalar_mults;
+    }
+    assert_memory_equal(&sum, &result.total, sizeof(sum));
+
+    // only the signing phase computes signatures
+    assert_int_equal(result.phases[SIGN_PSBT_PHASE_SIGN].n_interruptions > 0, true);
+
+    host_interpreter_free(interpreter);
+}
+
+static void test_sign_psbt_deterministic(void **state) {
+    (void) state;
+
+    sim_result_t results[2];
+    for (int i = 0; i < 2; i++) {
+        // like a new session: the caches of the app are empty
+        sim_device_init(SIM_DEFAULT_MNEMONIC);
+
+        host_interpreter_t *interpreter = host_interpreter_new();
+        uint8_t data[SIM_MAX_SIGN_PSBT_DATA_SIZE];
+        size_t data_len =
+            prepare_sign_psbt(interpreter, &sim_vectors[1], SIGN_PSBT_MODE_FLAG_PROGRESS, data);
+        assert_int_equal(
+            sim_device_exchange(interpreter, CLA_APP, SIGN_PSBT, 0, 0, data, data_len, &results[i]),
+            0);
+        host_interpreter_free(interpreter);
+    }
+
+    assert_memory_equal(&results[0].total, &results[1].total, sizeof(results[0].total));
+    assert_memory_equal(results[0].phases, results[1].phases, sizeof(results[0].phases));
+}
+
+static void test_sign_psbt_prefetch(void **state) {
+    (void) state;
+
+    sim_result_t results[2];
+    for (int prefetch = 0; prefetch < 2; prefetch++) {
+        sim_device_init(SIM_DEFAULT_MNEMONIC);
+        sim_device_set_prefetch(prefetch);
+
+        host_interpreter_t *interpreter = host_interpreter_new();
+        uint8_t data[SIM_MAX_SIGN_PSBT_DATA_SIZE];
+        size_t data_len = prepare_sign_psbt(interpreter, &sim_vectors[1], 0, data);
+        assert_int_equal(sim_device_exchange(interpreter,
+                                             CLA_APP,
+                                             SIGN_PSBT,
+                                             0,
+                                             0,
+                                             data,
+                                             data_len,
+                                             &results[prefetch]),
+                         0);
+        assert_int_equal(results[prefetch].sw, SW_OK);
+        assert_signatures(interpreter, &sim_vectors[1]);
+        host_interpreter_free(interpreter);
+    }
+
+    // the preimages pushed with the Merkle proofs save their interruptions, not the work
+    assert_true(results[1].total.n_interruptions < results[0].total.n_interruptions);
+    assert_int_equal(results[1].total.n_apdus, 1 + results[1].total.n_interruptions);
+    assert_int_equal(results[1].total.sha256_digests, results[0].total.sha256_digests);
+}
+
+// Checks that the signatures of a yield (or, if coalesced, a list of entries, each prefixed by its
+// length) are for the inputs following the n_signatures ones already checked, and counts them.
+static void assert_coalesced_signatures(const uint8_t *data,
+                                        size_t len,
+                                        bool coalesced,
+                                        uint64_t *n_signatures) {
+    size_t pos = 0;
+    while (pos < len) {
+        size_t entry_len = len;
+        if (coalesced) {
+            entry_len = data[pos++];
+            assert_true(pos + entry_len <= len);
+        }
+
+        // the index is a varint
+        uint64_t input_index;
+        int index_len = varint_read(data + pos, entry_len, &input_index);
+        assert_int_equal(index_len, input_index < 0xFD ? 1 : 3);
+        assert_int_equal(input_index, *n_signatures);
+        assert_true(entry_len > (size_t) index_len);
+        ++*n_signatures;
+        pos += entry_len;
+    }
+}
+
+static void test_sign_psbt_many_inputs(void **state) {
+    (void) state;
+
+    // the index of the inputs after the 253rd is a varint of 3 bytes
+    const size_t n_inputs = 300;
+    static uint8_t psbt[256 * 1024];
+    const uint8_t flags[2] = {0, SIGN_PSBT_MODE_FLAG_COALESCE_YIELDS};
+    for (int i = 0; i < 2; i++) {
+        host_interpreter_t *interpreter = host_interpreter_new();
+        uint8_t wallet_id[32];
+        add_vector_wallet(interpreter, &sim_vectors[0], wallet_id);
+
+        size_t psbt_len = repeat_vector_input(&sim_vectors[0], n_inputs, psbt, sizeof(psbt));
+        uint8_t data[SIM_MAX_SIGN_PSBT_DATA_SIZE];
+        int data_len = sim_host_prepare_psbt(interpreter, psbt, psbt_len, wallet_id, NULL, data);
+        assert_true(data_len > 0);
+        if (flags[i] != 0) {
+            data[data_len++] = SIGN_PSBT_MODE_SIGN | flags[i];
+        }
+
+        sim_result_t result;
+        assert_int_equal(
+            sim_device_exchange(interpreter, CLA_APP, SIGN_PSBT, 0, 0, data, data_len, &result),
+            0);
+        assert_int_equal(result.sw, SW_OK);
+
+        // a signature for each input, in order; the coalesced ones that were not yielded yet are
+        // in the response
+        uint64_t n_signatures = 0;
+        for (size_t y = 0; y < host_interpreter_n_yielded(interpreter); y++) {
+            size_t len;
+            const uint8_t *yielded = host_interpreter_get_yielded(interpreter, y, &len);
+            assert_coalesced_signatures(yielded, len, flags[i] != 0, &n_signatures);
+        }
+        assert_coalesced_signatures(result.data, result.data_len, true, &n_signatures);
+        assert_int_equal(n_signatures, n_inputs);
+
+        host_interpreter_free(interpreter);
+    }
+}
+
+static void test_sign_psbt_unattended(void **state) {
+    (void) state;
+
+    const sim_vector_t *vector = &sim_vectors[1];
+    host_interpreter_t *interpreter = host_interpreter_new();
+
+    // a spending policy for the default wallet policy of the vector, whose transaction spends
+    // 301768 sats (300000 to its only external output, and the fee): the session has room for a
+    // single one of them
+    spending_policy_t policy = {.max_tx_amount = 301768,
+                                .max_session_amount = 2 * 301768 - 1,
+                                .n_destinations = 1};
+    add_vector_wallet(interpreter, vector, policy.wallet_id);
+    const uint8_t destination[] = {0x00, 0x20, 0x3f, 0xa9, 0x66, 0xc9, 0xdd, 0xcd, 0xc2, 0xfd, 0x96,
+                                   0xe4, 0xa5, 0xe1, 0xbc, 0x76, 0x5b, 0x9f, 0xaf, 0x6c, 0xe8, 0xb3,
+                                   0xeb, 0x4f, 0x11, 0x04, 0xaa, 0xd6, 0xbd, 0xf7, 0x73, 0x24, 0xe5,
+                                   0xbe};
+    const size_t destination_len = sizeof(destination);
+    assert_int_equal(host_interpreter_add_known_list(interpreter,
+                                                     destination,
+                                                     &destination_len,
+                                                     1,
+                                                     policy.destinations_root),
+                     0);
+
+    uint8_t register_data[32 + 32 + 8 + 8 + 1 + 32];
+    buffer_t out = buffer_create(register_data, sizeof(register_data));
+    buffer_write_bytes(&out, policy.wallet_id, 32);
+    buffer_write_bytes(&out, (const uint8_t[32]){0}, 32);  // the hmac of a default wallet policy
+    buffer_write_u64(&out, policy.max_tx_amount, LE);
+    buffer_write_u64(&out, policy.max_session_amount, LE);
+    buffer_write_u8(&out, (uint8_t) policy.n_destinations);
+    buffer_write_bytes(&out, policy.destinations_root, 32);
+
+    sim_result_t result;
+    assert_int_equal(sim_device_exchange(interpreter,
+                                         CLA_APP,
+                                         REGISTER_SPENDING_POLICY,
+                                         0,
+                                         0,
+                                         register_data,
+                                         sizeof(register_data),
+                                         &result),
+                     0);
+    assert_int_equal(result.sw, SW_OK);
+    assert_int_equal(result.data_len, 32 + 32);
+    assert_int_equal(result.n_ui_flows, 1 + policy.n_destinations);
+
+    // the spending policy followed by its hmac, given by its sha256
+    uint8_t policy_with_hmac[SPENDING_POLICY_LEN + 32];
+    spending_policy_serialize(&policy, policy_with_hmac);
+    uint8_t policy_id[32];
+    cx_hash_sha256(policy_with_hmac, SPENDING_POLICY_LEN, policy_id, 32);
+    assert_memory_equal(result.data, policy_id, 32);
+    memcpy(policy_with_hmac + SPENDING_POLICY_LEN, result.data + 32, 32);
+    assert_int_equal(host_interpreter_add_known_preimage(interpreter,
+                                                         policy_with_hmac,
+                                                         sizeof(policy_with_hmac)),
+                     0);
+
+    uint8_t data[SIM_MAX_SIGN_PSBT_DATA_SIZE + 32];
+    size_t data_len = prepare_sign_psbt(interpreter, vector, SIGN_PSBT_MODE_UNATTENDED, data);
+    cx_hash_sha256(policy_with_hmac, sizeof(policy_with_hmac), data + data_len, 32);
+    data_len += 32;
+
+    // the user would reject anything that is shown
+    sim_ui_set_approve(false);
+    assert_int_equal(
+        sim_device_exchange(interpreter, CLA_APP, SIGN_PSBT, 0, 0, data, data_len, &result),
+        0);
+    assert_int_equal(result.sw, SW_OK);
+    assert_int_equal(result.n_ui_flows, 0);
+    assert_signatures(interpreter, vector);
+
+    // over the limit of the session
+    assert_int_equal(
+        sim_device_exchange(interpreter, CLA_APP, SIGN_PSBT, 0, 0, data, data_len, &result),
+        0);
+    assert_int_equal(result.sw, SW_DENY);
+    assert_int_equal(host_interpreter_n_yielded(interpreter), 0);
+
+    // a new session
+    sim_device_init(SIM_DEFAULT_MNEMONIC);
+    assert_int_equal(
+        sim_device_exchange(interpreter, CLA_APP, SIGN_PSBT, 0, 0, data, data_len, &result),
+        0);
+    assert_int_equal(result.sw, SW_OK);
+    assert_signatures(interpreter, vector);
+
+    host_interpreter_free(interpreter);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup(test_get_master_fingerprint, setup),
+        cmocka_unit_test_setup(test_get_extended_pubkey, setup),
+        cmocka_unit_test_setup(test_get_extended_pubkey_unhardened_tail, setup),
+        cmocka_unit_test_setup(test_sign_psbt, setup),
+        cmocka_unit_test_setup(test_sign_psbt_rejected, setup),
+        cmocka_unit_test_setup(test_sign_psbt_summary, setup),
+        cmocka_unit_test_setup(test_sign_psbt_phases, setup),
+        cmocka_unit_test_setup(test_sign_psbt_deterministic, setup),
+        cmocka_unit_test_setup(test_sign_psbt_prefetch, setup),
+        cmocka_unit_test_setup(test_sign_psbt_many_inputs, setup),
+        cmocka_unit_test_setup(test_sign_psbt_unattended, setup),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
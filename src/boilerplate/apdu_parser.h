@@ -19,6 +19,9 @@ typedef struct {
 /**
  * Parse APDU command from byte buffer.
  *
+ * Only short APDUs are supported (Lc is a single byte): the APDU must fit in G_io_apdu_buffer,
+ * whose size is fixed by the SDK. The transport already splits each APDU in multiple HID packets.
+ *
  * @param[out] cmd
  *   Structured APDU command (CLA, INS, P1, P2, Lc, Command data).
  * @param[in]  buf
@@ -0,0 +1,144 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#ifdef HAVE_APP_STATS
+
+#include <stdint.h>
+#include <string.h>
+
+#include "app_stats.h"
+
+app_stats_t G_app_stats;
+
+#ifdef HAVE_STACK_PROFILE
+
+// the stack grows down towards the canary, that is the lowest word of the stack
+extern unsigned int app_stack_canary;
+
+#define STACK_PAINT_PATTERN 0xA5A5A5A5u
+
+// Bytes left unpainted below the stack pointer, to account for the frame of the painting loop
+#define STACK_PAINT_MARGIN 64
+
+#endif
+
+// Returns the current stack pointer (approximately)
+static uintptr_t __attribute__((noinline)) get_stack_pointer(void) {
+    volatile int stack_top = 0;
+    // Returning an address on the stack is unusual, so we disable the warning; it only exists in
+    // clang, and gcc would warn about the unknown option instead
+#if defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-stack-address"
+#endif
+    return (uintptr_t) &stack_top;
+#if defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+}
+
+void app_stats_reset(void) {
+    memset(&G_app_stats, 0, sizeof(G_app_stats));
+
+#ifdef HAVE_STACK_PROFILE
+    app_stats_paint_stack();
+#endif
+}
+
+void app_stats_count_interruption(uint8_t client_command_code) {
+    ++G_app_stats.n_interruptions;
+
+    for (size_t i = 0; i < G_app_stats.n_client_commands; i++) {
+        if (G_app_stats.client_commands[i].code == client_command_code) {
+            ++G_app_stats.client_commands[i].count;
+            return;
+        }
+    }
+
+    if (G_app_stats.n_client_commands < APP_STATS_MAX_CLIENT_COMMANDS) {
+        G_app_stats.client_commands[G_app_stats.n_client_commands].code = client_command_code;
+        G_app_stats.client_commands[G_app_stats.n_client_commands].count = 1;
+        ++G_app_stats.n_client_commands;
+    }
+}
+
+void app_stats_record_stack_base(void) {
+    uintptr_t sp = get_stack_pointer();
+    if (sp > G_app_stats.stack_base) {
+        G_app_stats.stack_base = sp;
+    }
+}
+
+void app_stats_record_stack_pointer(void) {
+    uintptr_t sp = get_stack_pointer();
+    if (G_app_stats.min_stack_pointer == 0 || sp < G_app_stats.min_stack_pointer) {
+        G_app_stats.min_stack_pointer = sp;
+    }
+}
+
+uint32_t app_stats_get_max_stack_depth(void) {
+    if (G_app_stats.min_stack_pointer == 0 ||
+        G_app_stats.min_stack_pointer > G_app_stats.stack_base) {
+        return 0;
+    }
+    return (uint32_t) (G_app_stats.stack_base - G_app_stats.min_stack_pointer);
+}
+
+#ifdef HAVE_STACK_PROFILE
+
+void __attribute__((noinline)) app_stats_paint_stack(void) {
+    volatile uint32_t *p = (volatile uint32_t *) (&app_stack_canary + 1);
+    uintptr_t end = (get_stack_pointer() - STACK_PAINT_MARGIN) & ~(uintptr_t) 3;
+    while ((uintptr_t) p < end) {
+        *p++ = STACK_PAINT_PATTERN;
+    }
+}
+
+// Returns the lowest address of the stack that was written since it was painted
+static uintptr_t get_stack_low_water(void) {
+    const volatile uint32_t *p = (const volatile uint32_t *) (&app_stack_canary + 1);
+    uintptr_t sp = get_stack_pointer();
+    while ((uintptr_t) p < sp && *p == STACK_PAINT_PATTERN) {
+        ++p;
+    }
+    return (uintptr_t) p;
+}
+
+uint32_t app_stats_get_stack_high_water(void) {
+    uintptr_t low_water = get_stack_low_water();
+    if (low_water > G_app_stats.stack_base) {
+        return 0;
+    }
+    return (uint32_t) (G_app_stats.stack_base - low_water);
+}
+
+uint32_t app_stats_get_stack_free(void) {
+    return (uint32_t) (get_stack_low_water() - (uintptr_t) (&app_stack_canary + 1));
+}
+
+void app_stats_record_processor(const char *func, int line) {
+    uintptr_t sp = get_stack_pointer();
+    if (G_app_stats.deepest_processor_sp == 0 || sp < G_app_stats.deepest_processor_sp) {
+        G_app_stats.deepest_processor_sp = sp;
+        G_app_stats.deepest_processor = func;
+        G_app_stats.deepest_processor_line = (uint16_t) line;
+    }
+}
+
+#endif
+
+#endif
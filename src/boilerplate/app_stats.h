@@ -0,0 +1,125 @@
+#pragma once
+
+#include <stdint.h>  // uint*_t
+#include <stddef.h>  // size_t
+
+/*
+  Optional instrumentation counters, used to analyze the performance of the app. They are only
+  compiled if HAVE_APP_STATS is defined (build with `make APP_STATS=1`); otherwise, the APP_STATS_*
+  macros expand to nothing.
+
+  The counters accumulate across commands, and are returned and reset by the GET_APP_STATS command.
+
+  Builds with `make STACK_PROFILE=1` (that implies APP_STATS=1) also paint the free part of the stack
+  with a known pattern at boot and at each reset of the counters, so that GET_APP_STATS can return
+  the high-water mark of the stack, together with the LOG_PROCESSOR site that was reached with the
+  lowest stack pointer.
+*/
+
+/**
+ * Maximum number of distinct client command codes whose interruptions are counted separately.
+ */
+#define APP_STATS_MAX_CLIENT_COMMANDS 8
+
+/**
+ * Maximum length of the name of the deepest processor returned by GET_APP_STATS.
+ */
+#define STACK_PROFILE_MAX_NAME_LEN 32
+
+/**
+ * Length of the stack profile appended to the response of GET_APP_STATS, if any.
+ */
+#ifdef HAVE_STACK_PROFILE
+#define STACK_PROFILE_LEN (4 + 4 + 2 + 1 + STACK_PROFILE_MAX_NAME_LEN)
+#else
+#define STACK_PROFILE_LEN 0
+#endif
+
+typedef struct {
+    uint32_t n_interruptions;     // total number of interruptions (client commands)
+    uint32_t bytes_received;      // data bytes received, both in commands and in CONTINUE
+    uint32_t bytes_sent;          // bytes sent, including the status words
+    uint32_t sha256_bytes;        // bytes added to SHA256 contexts via crypto_hash_update
+    uint32_t sha256_digests;      // SHA256 digests computed via crypto_hash_digest
+    uint32_t ec_scalar_mults;     // secp256k1 scalar multiplications (including key generation)
+    uintptr_t stack_base;         // highest stack pointer seen when a command starts
+    uintptr_t min_stack_pointer;  // lowest stack pointer recorded by PRINT_STACK_POINTER
+
+    uint8_t n_client_commands;
+    struct {
+        uint8_t code;
+        uint32_t count;
+    } client_commands[APP_STATS_MAX_CLIENT_COMMANDS];
+
+#ifdef HAVE_STACK_PROFILE
+    uintptr_t deepest_processor_sp;  // lowest stack pointer recorded by LOG_PROCESSOR
+    const char *deepest_processor;   // name of the function of that LOG_PROCESSOR site
+    uint16_t deepest_processor_line;
+#endif
+} app_stats_t;
+
+#ifdef HAVE_APP_STATS
+
+extern app_stats_t G_app_stats;
+
+/**
+ * Resets all the counters.
+ */
+void app_stats_reset(void);
+
+/**
+ * Counts an interruption with the given client command code.
+ */
+void app_stats_count_interruption(uint8_t client_command_code);
+
+/**
+ * Records the current stack pointer as the base of the stack, if higher than the previous one.
+ * Called at the beginning of each command.
+ */
+void app_stats_record_stack_base(void);
+
+/**
+ * Records the current stack pointer, if lower than those previously recorded.
+ */
+void app_stats_record_stack_pointer(void);
+
+/**
+ * Returns the maximum stack depth observed since the last reset, in bytes.
+ */
+uint32_t app_stats_get_max_stack_depth(void);
+
+#ifdef HAVE_STACK_PROFILE
+
+/**
+ * Fills the free part of the stack (below the current stack pointer) with a known pattern.
+ */
+void app_stats_paint_stack(void);
+
+/**
+ * Returns the maximum stack depth reached since the stack was last painted, relative to the stack
+ * base recorded at the beginning of the commands, in bytes.
+ */
+uint32_t app_stats_get_stack_high_water(void);
+
+/**
+ * Returns the number of bytes of the stack above the canary that were never used since the stack
+ * was last painted.
+ */
+uint32_t app_stats_get_stack_free(void);
+
+/**
+ * Records a LOG_PROCESSOR site, if the current stack pointer is lower than for the previous ones.
+ */
+void app_stats_record_processor(const char *func, int line);
+
+#endif
+
+#define APP_STATS_ADD(field, n) (G_app_stats.field += (n))
+#define APP_STATS_INC(field)    (++G_app_stats.field)
+
+#else
+
+#define APP_STATS_ADD(field, n)
+#define APP_STATS_INC(field)
+
+#endif
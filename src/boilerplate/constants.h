@@ -1,5 +1,7 @@
 #pragma once
 
+#include "../target_config.h"
+
 /**
  * APDU instruction class for command defined by the framework.
  */
@@ -9,3 +11,23 @@
  * Framework instruction to continue execution after an interruption.
  */
 #define INS_CONTINUE 0x01
+
+/**
+ * Framework instruction to run several commands back to back, see apdu_dispatcher.
+ */
+#define INS_BATCH 0x02
+
+/**
+ * Value of P1 for INS_CONTINUE, if the response is followed by responses pushed in advance.
+ */
+#define CONTINUE_P1_PREFETCH 0x01
+
+/**
+ * Size of the buffer for the responses to client commands pushed in advance by the client.
+ */
+#define PREFETCH_BUFFER_SIZE TARGET_PREFETCH_BUFFER_SIZE
+
+/**
+ * Maximum length of the data of an INS_BATCH apdu, that is kept during the whole batch.
+ */
+#define BATCH_BUFFER_SIZE TARGET_BATCH_BUFFER_SIZE
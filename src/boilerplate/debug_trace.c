@@ -0,0 +1,79 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#ifdef HAVE_DEBUG_TRACE
+
+#include <stdint.h>
+#include <string.h>
+
+#include "debug_trace.h"
+
+// incremented at each ticker event, in io.c
+extern uint16_t G_ticks;
+
+static struct {
+    debug_trace_entry_t entries[DEBUG_TRACE_SIZE];
+    size_t start;  // index of the oldest entry
+    size_t count;
+    uint32_t dropped;
+} G_debug_trace;
+
+void debug_trace_reset(void) {
+    memset(&G_debug_trace, 0, sizeof(G_debug_trace));
+}
+
+void debug_trace_record(uint8_t event, uint32_t arg0, uint32_t arg1) {
+    size_t pos = (G_debug_trace.start + G_debug_trace.count) % DEBUG_TRACE_SIZE;
+    if (G_debug_trace.count == DEBUG_TRACE_SIZE) {
+        // overwrite the oldest entry
+        G_debug_trace.start = (G_debug_trace.start + 1) % DEBUG_TRACE_SIZE;
+        ++G_debug_trace.dropped;
+    } else {
+        ++G_debug_trace.count;
+    }
+
+    G_debug_trace.entries[pos].args[0] = arg0;
+    G_debug_trace.entries[pos].args[1] = arg1;
+    G_debug_trace.entries[pos].tick = G_ticks;
+    G_debug_trace.entries[pos].event = event;
+}
+
+void debug_trace_apdu(const command_t *cmd) {
+    uint32_t data_prefix = 0;
+    for (int i = 0; i < 3; i++) {
+        data_prefix = (data_prefix << 8) | (i < cmd->lc ? cmd->data[i] : 0);
+    }
+
+    debug_trace_record(DEBUG_TRACE_APDU,
+                       (uint32_t) cmd->cla << 24 | (uint32_t) cmd->ins << 16 |
+                           (uint32_t) cmd->p1 << 8 | cmd->p2,
+                       (uint32_t) cmd->lc << 24 | data_prefix);
+}
+
+size_t debug_trace_count(void) {
+    return G_debug_trace.count;
+}
+
+uint32_t debug_trace_dropped(void) {
+    return G_debug_trace.dropped;
+}
+
+const debug_trace_entry_t *debug_trace_get(size_t index) {
+    return &G_debug_trace.entries[(G_debug_trace.start + index) % DEBUG_TRACE_SIZE];
+}
+
+#endif
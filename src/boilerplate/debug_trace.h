@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>  // uint*_t
+#include <stddef.h>  // size_t
+
+#include "apdu_parser.h"
+#include "../target_config.h"
+
+/*
+  Optional binary trace of the exchanges with the host, that replaces the PRINTF of the APDUs in
+  the debug builds. It is only compiled if HAVE_DEBUG_TRACE is defined (build with
+  `make DEBUG_TRACE=1`, with or without DEBUG); otherwise, the APDUs are printed with PRINTF as
+  before.
+
+  Each event is a fixed id and two raw 32-bit arguments, stored with the current tick in a ring
+  buffer that drops the oldest events when full; nothing is formatted on the device, so recording
+  an event only costs a few stores, and the trace can be left on in performance runs. The events
+  are returned by the GET_DEBUG_TRACE command, and decoded by dev-tools/debug_trace.py.
+*/
+
+/**
+ * Number of events of the trace.
+ */
+#define DEBUG_TRACE_SIZE TARGET_DEBUG_TRACE_SIZE
+
+/**
+ * Ids of the events, and their arguments.
+ */
+// an APDU was received; arg0: CLA, INS, P1 and P2 (from the most significant byte), arg1: Lc in
+// the most significant byte, then the first 3 bytes of the data (0 if shorter)
+#define DEBUG_TRACE_APDU 1
+// a client command was sent to the host; arg0: command code, arg1: length of the request
+#define DEBUG_TRACE_INTERRUPTION 2
+// a client command was answered with a response pushed in advance; arg0: command code, arg1:
+// length of the response
+#define DEBUG_TRACE_PREFETCHED 3
+// the command returned its final response; arg0: status word, arg1: length of the response data
+#define DEBUG_TRACE_RESPONSE 4
+
+typedef struct {
+    uint32_t args[2];
+    uint16_t tick;
+    uint8_t event;
+} debug_trace_entry_t;
+
+#ifdef HAVE_DEBUG_TRACE
+
+/**
+ * Removes all the events from the trace.
+ */
+void debug_trace_reset(void);
+
+/**
+ * Records an event at the current tick.
+ */
+void debug_trace_record(uint8_t event, uint32_t arg0, uint32_t arg1);
+
+/**
+ * Records the DEBUG_TRACE_APDU event of a received APDU.
+ */
+void debug_trace_apdu(const command_t *cmd);
+
+/**
+ * Returns the number of events in the trace.
+ */
+size_t debug_trace_count(void);
+
+/**
+ * Returns the number of events that were dropped since the trace was reset, because it was full.
+ */
+uint32_t debug_trace_dropped(void);
+
+/**
+ * Returns the event at the given index, where 0 is the oldest event; index must be smaller than
+ * debug_trace_count().
+ */
+const debug_trace_entry_t *debug_trace_get(size_t index);
+
+#else
+
+static inline void debug_trace_record(uint8_t event, uint32_t arg0, uint32_t arg1) {
+    (void) event;
+    (void) arg0;
+    (void) arg1;
+}
+
+static inline void debug_trace_apdu(const command_t *cmd) {
+    (void) cmd;
+
+    PRINTF("=> CLA=%02X | INS=%02X | P1=%02X | P2=%02X | Lc=%02X | CData=",
+           cmd->cla,
+           cmd->ins,
+           cmd->p1,
+           cmd->p2,
+           cmd->lc);
+    for (int i = 0; i < cmd->lc; i++) {
+        PRINTF("%02X", cmd->data[i]);
+    }
+    PRINTF("\n");
+}
+
+#endif
@@ -17,14 +17,21 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "dispatcher.h"
+#include "app_stats.h"
+#include "debug_trace.h"
+#include "processor_trace.h"
 #include "constants.h"
 #include "globals.h"
 #include "io.h"
 #include "sw.h"
 
 #include "common/buffer.h"
+#include "common/private_node_cache.h"
+#include "common/tweaked_key_cache.h"
+#include "handler/client_commands.h"
 
 extern dispatcher_context_t G_dispatcher_context;
 
@@ -32,28 +39,119 @@ extern bool G_was_processing_screen_shown;
 
 // Private state that is not made accessible from the dispatcher context
 struct {
+    const command_descriptor_t *cmd_descriptors;
+    int n_descriptors;
+    machine_context_t *top_context;
+    size_t top_context_size;
     void (*termination_cb)(void);
     bool paused;
     uint16_t sw;
     bool had_ux_flow;  // set to true if there was any UX flow during the APDU processing
 } G_dispatcher_state;
 
+// Responses to client commands that the client pushed in advance, after the response in an
+// INS_CONTINUE with P1 = CONTINUE_P1_PREFETCH. Each entry contains the length of the request
+// (1 byte), the request, the length of the response (1 byte) and the response. When the buffer is
+// full, the oldest entries are dropped.
+static struct {
+    uint8_t data[PREFETCH_BUFFER_SIZE];
+    size_t len;
+} G_prefetch;
+
+// Commands of the INS_BATCH apdu being executed, each one encoded as
+// <cla : 1> <ins : 1> <lc : 1> <data : lc>; pos is the position of the next command to run.
+static struct {
+    uint8_t data[BATCH_BUFFER_SIZE];
+    size_t len;
+    size_t pos;
+    bool running;  // set while a command of the batch is being executed
+} G_batch;
+
 static void dispatcher_loop();
 
-static void next(command_processor_t next_processor) {
+// Returns the length of the prefetch entry starting at position pos of buf.
+static size_t prefetch_entry_len(const uint8_t *buf, size_t pos) {
+    size_t req_len = buf[pos];
+    return 1 + req_len + 1 + buf[pos + 1 + req_len];
+}
+
+// Returns a pointer to the length-prefixed prefetched response for the given request, or NULL if
+// not found.
+static const uint8_t *prefetch_find(const uint8_t *req, size_t req_len) {
+    for (size_t pos = 0; pos < G_prefetch.len; pos += prefetch_entry_len(G_prefetch.data, pos)) {
+        if (G_prefetch.data[pos] == req_len && memcmp(&G_prefetch.data[pos + 1], req, req_len) == 0) {
+            return &G_prefetch.data[pos + 1 + req_len];
+        }
+    }
+    return NULL;
+}
+
+// Appends the prefetch entries in data to the buffer, dropping the oldest entries if needed.
+// Returns false if the entries are malformed.
+static bool prefetch_add(const uint8_t *data, size_t data_len) {
+    size_t pos = 0;
+    while (pos < data_len) {
+        if (pos + 1 + data[pos] + 1 > data_len || pos + prefetch_entry_len(data, pos) > data_len) {
+            return false;
+        }
+        pos += prefetch_entry_len(data, pos);
+    }
+
+    // skip the first new entries if they can't all fit
+    size_t skip = 0;
+    while (data_len - skip > PREFETCH_BUFFER_SIZE) {
+        skip += prefetch_entry_len(data, skip);
+    }
+
+    // drop the oldest entries to make room for the new ones
+    size_t drop = 0;
+    while (G_prefetch.len - drop + (data_len - skip) > PREFETCH_BUFFER_SIZE) {
+        drop += prefetch_entry_len(G_prefetch.data, drop);
+    }
+    memmove(G_prefetch.data, G_prefetch.data + drop, G_prefetch.len - drop);
+    G_prefetch.len -= drop;
+
+    memcpy(G_prefetch.data + G_prefetch.len, data + skip, data_len - skip);
+    G_prefetch.len += data_len - skip;
+    return true;
+}
+
+static bool has_prefetched_response(const uint8_t *request, size_t request_len) {
+    return prefetch_find(request, request_len) != NULL;
+}
+
+void dispatcher_next(command_processor_t next_processor) {
     G_dispatcher_context.machine_context_ptr->next_processor = next_processor;
 }
 
-static void add_to_response(const void *rdata, size_t rdata_len) {
+void dispatcher_add_to_response(const void *rdata, size_t rdata_len) {
     io_add_to_response(rdata, rdata_len);
 }
 
-static void finalize_response(uint16_t sw) {
+void dispatcher_add_u8_to_response(uint8_t value) {
+    io_add_u8_to_response(value);
+}
+
+void dispatcher_add_varint_to_response(uint64_t value) {
+    io_add_varint_to_response(value);
+}
+
+void dispatcher_finalize_response(uint16_t sw) {
     G_dispatcher_state.sw = sw;
     io_finalize_response(sw);
+
+    if (sw != SW_INTERRUPTED_EXECUTION) {
+        debug_trace_record(DEBUG_TRACE_RESPONSE, sw, G_output_len - 2);
+    }
 }
 
-static void send_response() {
+void dispatcher_send_response(void) {
+    if (G_batch.running && G_dispatcher_state.sw != SW_INTERRUPTED_EXECUTION) {
+        // the final response of a command of a batch is returned by batch_yield_response
+        return;
+    }
+
+    APP_STATS_ADD(bytes_sent, G_output_len);
     io_confirm_response();
 }
 
@@ -86,22 +184,190 @@ static void start_flow(command_processor_t first_processor,
     G_dispatcher_context.machine_context_ptr = subcontext;
 }
 
-// TODO: refactor code in common with the main apdu loop
-static int process_interruption(dispatcher_context_t *dc) {
+void dispatcher_interrupt(command_processor_t resume_processor) {
+    dispatcher_finalize_response(SW_INTERRUPTED_EXECUTION);
+    dispatcher_next(resume_processor);
+}
+
+// If the client already pushed the response to the pending request, loads it in the read_buffer
+// of the dispatcher context and returns true; otherwise, returns false.
+static bool load_prefetched_response(dispatcher_context_t *dc) {
+    if (G_dispatcher_state.sw != SW_INTERRUPTED_EXECUTION || G_output_len < 2) {
+        return false;
+    }
+
+    const uint8_t *prefetched = prefetch_find(G_io_apdu_buffer, G_output_len - 2);
+    if (prefetched == NULL) {
+        return false;
+    }
+
+    size_t response_len = prefetched[0];
+    debug_trace_record(DEBUG_TRACE_PREFETCHED, G_io_apdu_buffer[0], response_len);
+    memcpy(G_io_apdu_buffer, prefetched + 1, response_len);
+
+    G_output_len = 0;
+    G_dispatcher_state.sw = 0;
+
+    dc->read_buffer = buffer_create(G_io_apdu_buffer, response_len);
+    return true;
+}
+
+// Sets the read_buffer of the dispatcher context to the response to a client command contained in
+// an INS_CONTINUE apdu, storing the responses pushed in advance if any.
+// Returns 0 on success, or the status word of the error otherwise.
+static uint16_t load_continue_response(dispatcher_context_t *dc, const command_t *cmd) {
+    if (cmd->p1 == CONTINUE_P1_PREFETCH && cmd->p2 == 0) {
+        // the response is length-prefixed, and followed by the responses pushed in advance
+        if (cmd->lc < 1 || cmd->data[0] > cmd->lc - 1 ||
+            !prefetch_add(cmd->data + 1 + cmd->data[0], cmd->lc - 1 - cmd->data[0])) {
+            return SW_INCORRECT_DATA;
+        }
+        dc->read_buffer = buffer_create(cmd->data + 1, cmd->data[0]);
+    } else if (cmd->p1 == 0 && cmd->p2 == 0) {
+        dc->read_buffer = buffer_create(cmd->data, cmd->lc);
+    } else {
+        return SW_WRONG_P1P2;
+    }
+    return 0;
+}
+
+static bool is_in_batch(void) {
+    return G_batch.running;
+}
+
+// Returns the descriptor of the command with the given CLA and INS; if there is none, returns NULL
+// and sets *sw to the status word of the error.
+static const command_descriptor_t *find_command(uint8_t cla, uint8_t ins, uint16_t *sw) {
+    bool cla_found = false;
+    for (int i = 0; i < G_dispatcher_state.n_descriptors; i++) {
+        if (G_dispatcher_state.cmd_descriptors[i].cla != cla) continue;
+        cla_found = true;
+        if (G_dispatcher_state.cmd_descriptors[i].ins != ins) continue;
+
+        return &G_dispatcher_state.cmd_descriptors[i];
+    }
+
+    *sw = cla_found ? SW_INS_NOT_SUPPORTED : SW_CLA_NOT_SUPPORTED;
+    return NULL;
+}
+
+// Calls the handler of a command, with the given input data; the top context must be reset.
+static void start_command(const command_descriptor_t *descriptor, uint8_t *data, size_t data_len) {
+    G_dispatcher_context.read_buffer = buffer_create(data, data_len);
+
+    command_handler_t handler = (command_handler_t) PIC(descriptor->handler);
+    handler(&G_dispatcher_context);
+}
+
+// Checks all the commands of an INS_BATCH apdu, and stores them for batch_run_next.
+// Returns 0 on success, or the status word of the error otherwise.
+static uint16_t batch_init(const command_t *cmd) {
+    if (cmd->p1 != 0) {
+        return SW_WRONG_P1P2;
+    }
+    if (cmd->lc == 0 || cmd->lc > BATCH_BUFFER_SIZE) {
+        return SW_WRONG_DATA_LENGTH;
+    }
+
+    size_t pos = 0;
+    while (pos < cmd->lc) {
+        if (pos + 3 > cmd->lc || pos + 3 + cmd->data[pos + 2] > cmd->lc) {
+            return SW_WRONG_DATA_LENGTH;
+        }
+
+        uint16_t sw;
+        const command_descriptor_t *descriptor =
+            find_command(cmd->data[pos], cmd->data[pos + 1], &sw);
+        if (descriptor == NULL) {
+            return sw;
+        }
+        if (!descriptor->batchable) {
+            return SW_NOT_SUPPORTED;
+        }
+        pos += 3 + cmd->data[pos + 2];
+    }
+
+    memcpy(G_batch.data, cmd->data, cmd->lc);
+    G_batch.len = cmd->lc;
+    G_batch.pos = 0;
+    return 0;
+}
+
+// Runs the next command of the batch, or completes the batch if there is none left.
+static void batch_run_next(dispatcher_context_t *dc) {
+    if (G_batch.pos == G_batch.len) {
+        SEND_SW(dc, SW_OK);
+        return;
+    }
+
+    uint8_t *cmd_data = &G_batch.data[G_batch.pos];
+    G_batch.pos += 3 + cmd_data[2];
+
+    command_t cmd = {.cla = cmd_data[0],
+                     .ins = cmd_data[1],
+                     .p1 = 0,
+                     .p2 = 0,
+                     .lc = cmd_data[2],
+                     .data = cmd_data + 3};
+    debug_trace_apdu(&cmd);
+
+    // the commands were checked in batch_init
+    uint16_t sw;
+    const command_descriptor_t *descriptor = find_command(cmd.cla, cmd.ins, &sw);
+
+    // each command starts from a clean context, like a command received in its own apdu
+    G_dispatcher_context.machine_context_ptr = G_dispatcher_state.top_context;
+    explicit_bzero(G_dispatcher_state.top_context, G_dispatcher_state.top_context_size);
+
+    G_batch.running = true;
+    start_command(descriptor, cmd.data, cmd.lc);
+}
+
+// Returns the response of the command of the batch that just completed, followed by its status
+// word, with a YIELD client command; the batch continues once the host responds.
+static void batch_yield_response(dispatcher_context_t *dc) {
+    if (G_output_len > IO_APDU_BUFFER_SIZE - 3) {
+        // no room for the client command code and the status word of the interruption
+        io_reset_response();
+        io_finalize_response(SW_WRONG_RESPONSE_LENGTH);
+    }
+
+    memmove(G_io_apdu_buffer + 1, G_io_apdu_buffer, G_output_len);
+    G_io_apdu_buffer[0] = CCMD_YIELD;
+    G_output_len += 1;
+
+    dc_interrupt(dc, batch_run_next);
+}
+
+int dispatcher_process_interruption(dispatcher_context_t *dc) {
     command_t cmd;
     int input_len;
 
     // Reset structured APDU command
     memset(&cmd, 0, sizeof(cmd));
 
+    // If the client already pushed the response to this request, there is no need to interrupt
+    if (load_prefetched_response(dc)) {
+        return 0;
+    }
+
     io_start_interruption_timeout();
 
+#ifdef HAVE_APP_STATS
+    // the first byte of the response is the client command code
+    app_stats_count_interruption(G_output_len > 2 ? G_io_apdu_buffer[0] : 0);
+    APP_STATS_ADD(bytes_sent, G_output_len);
+#endif
+    processor_trace_record_event(PROCESSOR_TRACE_INTERRUPTION);
+    debug_trace_record(DEBUG_TRACE_INTERRUPTION, G_io_apdu_buffer[0], G_output_len - 2);
+
     // Receive command bytes in G_io_apdu_buffer
     if ((input_len = io_exchange(CHANNEL_APDU, G_output_len)) < 0) {
         return -1;
     }
 
     io_clear_interruption_timeout();
+    processor_trace_record_event(PROCESSOR_TRACE_RESUME);
 
     G_output_len = 0;
 
@@ -119,16 +385,7 @@ static int process_interruption(dispatcher_context_t *dc) {
         return -1;
     }
 
-    PRINTF("=> CLA=%02X | INS=%02X | P1=%02X | P2=%02X | Lc=%02X | CData=",
-           cmd.cla,
-           cmd.ins,
-           cmd.p1,
-           cmd.p2,
-           cmd.lc);
-    for (int i = 0; i < cmd.lc; i++) {
-        PRINTF("%02X", cmd.data[i]);
-    }
-    PRINTF("\n");
+    debug_trace_apdu(&cmd);
 
     // INS_CONTINUE is the only valid apdu here
     if (cmd.cla != CLA_FRAMEWORK || cmd.ins != INS_CONTINUE) {
@@ -136,7 +393,13 @@ static int process_interruption(dispatcher_context_t *dc) {
         return -1;
     }
 
-    dc->read_buffer = buffer_create(cmd.data, cmd.lc);
+    APP_STATS_ADD(bytes_received, cmd.lc);
+
+    uint16_t sw = load_continue_response(dc, &cmd);
+    if (sw != 0) {
+        SEND_SW(dc, sw);
+        return -1;
+    }
 
     return 0;
 }
@@ -152,64 +415,91 @@ void apdu_dispatcher(command_descriptor_t const cmd_descriptors[],
 
     G_dispatcher_state.had_ux_flow = false;
 
+    G_dispatcher_state.cmd_descriptors = cmd_descriptors;
+    G_dispatcher_state.n_descriptors = n_descriptors;
+    G_dispatcher_state.top_context = top_context;
+    G_dispatcher_state.top_context_size = top_context_size;
     G_dispatcher_state.termination_cb = termination_cb;
     G_dispatcher_state.paused = false;
     G_dispatcher_state.sw = 0;
 
-    G_dispatcher_context.next = next;
-    G_dispatcher_context.add_to_response = add_to_response;
-    G_dispatcher_context.finalize_response = finalize_response;
-    G_dispatcher_context.send_response = send_response;
+    G_dispatcher_context.next = dispatcher_next;
+    G_dispatcher_context.add_to_response = dispatcher_add_to_response;
+    G_dispatcher_context.add_u8_to_response = dispatcher_add_u8_to_response;
+    G_dispatcher_context.add_varint_to_response = dispatcher_add_varint_to_response;
+    G_dispatcher_context.finalize_response = dispatcher_finalize_response;
+    G_dispatcher_context.send_response = dispatcher_send_response;
     G_dispatcher_context.pause = pause;
     G_dispatcher_context.run = run;
     G_dispatcher_context.start_flow = start_flow;
-    G_dispatcher_context.process_interruption = process_interruption;
-
-    G_dispatcher_context.read_buffer = buffer_create(cmd->data, cmd->lc);
+    G_dispatcher_context.process_interruption = dispatcher_process_interruption;
+    G_dispatcher_context.interrupt = dispatcher_interrupt;
+    G_dispatcher_context.add_prefetched_responses = prefetch_add;
+    G_dispatcher_context.has_prefetched_response = has_prefetched_response;
+    G_dispatcher_context.is_in_batch = is_in_batch;
+
+    APP_STATS_ADD(bytes_received, cmd->lc);
+#ifdef HAVE_APP_STATS
+    app_stats_record_stack_base();
+#endif
+
+    // any apdu ends the wait for the response to a client command sent with interrupt()
+    io_clear_interruption_timeout();
 
     if (cmd->cla == CLA_FRAMEWORK && cmd->ins == INS_CONTINUE) {
-        if (cmd->p1 != 0 || cmd->p2 != 0) {
-            io_send_sw(SW_WRONG_P1P2);
-            return;
-        }
-
         if (G_dispatcher_context.machine_context_ptr == NULL ||
             G_dispatcher_context.machine_context_ptr->next_processor == NULL) {
             PRINTF("Unexpected INS_CONTINUE.\n");
             io_send_sw(SW_BAD_STATE);  // received INS_CONTINUE, but no command was interrupted.
             return;
         }
+
+        processor_trace_record_event(PROCESSOR_TRACE_RESUME);
+
+        uint16_t sw = load_continue_response(&G_dispatcher_context, cmd);
+        if (sw != 0) {
+            io_send_sw(sw);
+            return;
+        }
+
+        io_start_processing_timeout();
     } else {
         // If a previous command was interrupted but any command other than INS_CONTINUE is
-        // received, the interrupted command is discarded.
+        // received, the interrupted command is discarded, and so is a previous batch.
+        G_batch.running = false;
+        G_batch.len = 0;
 
         G_dispatcher_context.machine_context_ptr = top_context;
 
         // Safety measure: reset to 0 the entire context before starting.
         explicit_bzero(top_context, top_context_size);
 
-        bool cla_found = false, ins_found = false;
-        command_handler_t handler;
-        for (int i = 0; i < n_descriptors; i++) {
-            if (cmd_descriptors[i].cla != cmd->cla) continue;
-            cla_found = true;
-            if (cmd_descriptors[i].ins != cmd->ins) continue;
-            ins_found = true;
+        // responses pushed in advance are only valid during the same command
+        G_prefetch.len = 0;
 
-            handler = (command_handler_t) PIC(cmd_descriptors[i].handler);
-            break;
-        }
+        // P2 is the latency of the client declared for this command, in ticks
+        io_set_client_latency(cmd->p2);
 
-        if (!cla_found) {
-            io_send_sw(SW_CLA_NOT_SUPPORTED);
-            return;
-        } else if (!ins_found) {
-            io_send_sw(SW_INS_NOT_SUPPORTED);
-            return;
-        }
+        if (cmd->cla == CLA_FRAMEWORK && cmd->ins == INS_BATCH) {
+            uint16_t sw = batch_init(cmd);
+            if (sw != 0) {
+                io_send_sw(sw);
+                return;
+            }
 
-        io_start_processing_timeout();
-        handler(&G_dispatcher_context);
+            io_start_processing_timeout();
+            top_context->next_processor = batch_run_next;
+        } else {
+            uint16_t sw;
+            const command_descriptor_t *descriptor = find_command(cmd->cla, cmd->ins, &sw);
+            if (descriptor == NULL) {
+                io_send_sw(sw);
+                return;
+            }
+
+            io_start_processing_timeout();
+            start_command(descriptor, cmd->data, cmd->lc);
+        }
     }
 
     dispatcher_loop();
@@ -228,6 +518,14 @@ static void dispatcher_loop() {
         }
 
         if (G_dispatcher_state.sw != 0) {
+            if (G_batch.running) {
+                // the command of the batch completed; its response is still in the output buffer
+                G_batch.running = false;
+                G_dispatcher_state.sw = 0;
+                G_dispatcher_context.machine_context_ptr = G_dispatcher_state.top_context;
+                G_dispatcher_context.machine_context_ptr->next_processor = batch_yield_response;
+                continue;
+            }
             break;
         }
 
@@ -246,6 +544,20 @@ static void dispatcher_loop() {
                     PRINTF("Interruption requested, but the next processor was not set.\n");
                 }
 
+                // no need to wait for the client if it already pushed the response
+                if (load_prefetched_response(&G_dispatcher_context)) {
+                    continue;
+                }
+
+#ifdef HAVE_APP_STATS
+                // the first byte of the response is the client command code
+                app_stats_count_interruption(G_output_len > 2 ? G_io_apdu_buffer[0] : 0);
+#endif
+                // the response to the client command arrives as a new INS_CONTINUE apdu
+                debug_trace_record(DEBUG_TRACE_INTERRUPTION, G_io_apdu_buffer[0], G_output_len - 2);
+                dispatcher_send_response();
+                processor_trace_record_event(PROCESSOR_TRACE_INTERRUPTION);
+                io_start_interruption_timeout();
                 io_clear_processing_timeout();
                 return;
             }
@@ -265,6 +577,11 @@ static void dispatcher_loop() {
         PRINTF("No response before terminating\n");
         io_send_sw(SW_BAD_STATE);
     }
+    processor_trace_record_event(PROCESSOR_TRACE_END);
+
+    // The private keys cached during the command are wiped whatever its outcome, errors included
+    private_node_cache_reset();
+    tweaked_key_cache_reset();
 
     // We call the termination callback if given, but only if the UX is "dirty", that is either
     // - there was some kind of UX flow with user interaction;
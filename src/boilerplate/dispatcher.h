@@ -3,6 +3,8 @@
 #include "os.h"
 
 #include "apdu_parser.h"
+#include "app_stats.h"
+#include "processor_trace.h"
 
 #include "common/buffer.h"
 
@@ -53,34 +55,126 @@ struct dispatcher_context_s {
     void (*run)();
     void (*next)(command_processor_t next_processor);
     void (*add_to_response)(const void *rdata, size_t rdata_len);
+    void (*add_u8_to_response)(uint8_t value);
+    void (*add_varint_to_response)(uint64_t value);
     void (*finalize_response)(uint16_t sw);
     void (*send_response)(void);
     void (*start_flow)(command_processor_t first_processor,
                        machine_context_t *subcontext,
                        command_processor_t return_processor);
     int (*process_interruption)(dispatcher_context_t *dispatcher_context);
+    /**
+     * Sends the response built with add_to_response as a client command, and sets resume_processor
+     * as the next processor of the current flow; the processor must return right after calling it.
+     * When resume_processor runs, the response of the client is in read_buffer.
+     *
+     * Unlike process_interruption, that only returns once the client responded, no stack frame
+     * stays live while waiting for the client: the dispatcher loop returns, and resumes the flow
+     * when the INS_CONTINUE apdu with the response is received. Responses that the client pushed in
+     * advance are used the same way, without returning from the dispatcher loop.
+     */
+    void (*interrupt)(command_processor_t resume_processor);
+    /**
+     * Stores responses to client requests received in advance; entries have the same format as the
+     * ones pushed with CONTINUE_P1_PREFETCH, and are used instead of interrupting for the same
+     * requests. Returns false if the entries are malformed.
+     */
+    bool (*add_prefetched_responses)(const uint8_t *entries, size_t entries_len);
+    /**
+     * Returns true if the response to the given request (including the client command code) is
+     * stored, so that sending the request would not interrupt the execution.
+     */
+    bool (*has_prefetched_response)(const uint8_t *request, size_t request_len);
+    /**
+     * Returns true if the command is one of the commands of a BATCH; it must then complete without
+     * any user interaction, as its response is returned to the host with a YIELD.
+     */
+    bool (*is_in_batch)(void);
 };
 
-static inline void SEND_SW(struct dispatcher_context_s *dc, uint16_t sw) {
-    dc->finalize_response(sw);
+/*
+  The functions of the dispatcher used by the processors, that the dispatcher context points to.
+  The processors call them with the dc_* functions below: with HAVE_DIRECT_DISPATCHER_CALLS (build
+  with `make DIRECT_DISPATCHER_CALLS=1`), these are direct calls, that the compiler can inline,
+  rather than indirect calls through the dispatcher context, that happen at each step of the
+  thousands of interruptions of a large SIGN_PSBT. The pointers of the dispatcher context are still
+  set, for the code that replaces them (for example, a mock of the dispatcher in tests).
+*/
+void dispatcher_next(command_processor_t next_processor);
+void dispatcher_add_to_response(const void *rdata, size_t rdata_len);
+void dispatcher_add_u8_to_response(uint8_t value);
+void dispatcher_add_varint_to_response(uint64_t value);
+void dispatcher_finalize_response(uint16_t sw);
+void dispatcher_send_response(void);
+int dispatcher_process_interruption(dispatcher_context_t *dc);
+void dispatcher_interrupt(command_processor_t resume_processor);
+
+// calls the function fn of the dispatcher, with the given arguments
+#ifdef HAVE_DIRECT_DISPATCHER_CALLS
+#define DC_CALL(dc, fn, ...) ((void) (dc), dispatcher_##fn(__VA_ARGS__))
+#else
+#define DC_CALL(dc, fn, ...) ((dc)->fn(__VA_ARGS__))
+#endif
+
+static inline void dc_next(dispatcher_context_t *dc, command_processor_t next_processor) {
+    DC_CALL(dc, next, next_processor);
+}
+
+static inline void dc_add_to_response(dispatcher_context_t *dc,
+                                      const void *rdata,
+                                      size_t rdata_len) {
+    DC_CALL(dc, add_to_response, rdata, rdata_len);
+}
+
+static inline void dc_add_u8_to_response(dispatcher_context_t *dc, uint8_t value) {
+    DC_CALL(dc, add_u8_to_response, value);
+}
+
+static inline void dc_add_varint_to_response(dispatcher_context_t *dc, uint64_t value) {
+    DC_CALL(dc, add_varint_to_response, value);
+}
+
+static inline void dc_finalize_response(dispatcher_context_t *dc, uint16_t sw) {
+    DC_CALL(dc, finalize_response, sw);
+}
+
+static inline void dc_send_response(dispatcher_context_t *dc) {
+#ifdef HAVE_DIRECT_DISPATCHER_CALLS
+    (void) dc;
+    dispatcher_send_response();
+#else
     dc->send_response();
+#endif
+}
+
+static inline int dc_process_interruption(dispatcher_context_t *dc) {
+    return DC_CALL(dc, process_interruption, dc);
+}
+
+static inline void dc_interrupt(dispatcher_context_t *dc, command_processor_t resume_processor) {
+    DC_CALL(dc, interrupt, resume_processor);
+}
+
+static inline void SEND_SW(struct dispatcher_context_s *dc, uint16_t sw) {
+    dc_finalize_response(dc, sw);
+    dc_send_response(dc);
 }
 
 static inline void SET_RESPONSE(struct dispatcher_context_s *dc,
                                 void *rdata,
                                 size_t rdata_len,
                                 uint16_t sw) {
-    dc->add_to_response(rdata, rdata_len);
-    dc->finalize_response(sw);
+    dc_add_to_response(dc, rdata, rdata_len);
+    dc_finalize_response(dc, sw);
 }
 
 static inline void SEND_RESPONSE(struct dispatcher_context_s *dc,
                                  void *rdata,
                                  size_t rdata_len,
                                  uint16_t sw) {
-    dc->add_to_response(rdata, rdata_len);
-    dc->finalize_response(sw);
-    dc->send_response();
+    dc_add_to_response(dc, rdata, rdata_len);
+    dc_finalize_response(dc, sw);
+    dc_send_response(dc);
 }
 
 // TODO: instead of exposing a method like send_response, it might be more efficient to expose the
@@ -100,6 +194,7 @@ typedef struct {
     command_handler_t handler;
     uint8_t cla;
     uint8_t ins;
+    bool batchable;  // the command can be part of a BATCH (see apdu_dispatcher)
 } command_descriptor_t;
 
 /**
@@ -111,6 +206,14 @@ typedef struct {
  * @param[in] cmd
  *   Structured APDU command (CLA, INS, P1, P2, Lc, Command data).
  *
+ * Besides INS_CONTINUE, the dispatcher handles the INS_BATCH framework instruction: its data
+ * contains several commands, each encoded as <cla : 1> <ins : 1> <lc : 1> <data : lc>, that are
+ * run one after the other as if each one was received in its own APDU (with P1 = P2 = 0), except
+ * that the responses pushed in advance are kept for the whole batch. Only the commands whose
+ * descriptor is batchable are accepted; the whole batch is rejected before running any command
+ * otherwise. The response of each command, followed by its status word, is returned with a YIELD
+ * client command; the batch then continues with the next command, whatever the status word.
+ *
  * TODO: update docs with new params
  *
  */
@@ -140,4 +243,19 @@ static inline void print_dispatcher_info(dispatcher_context_t *dc,
     PRINTF("->%s %d: %s\n", file, line, func);
 }
 
-#define LOG_PROCESSOR(dc, file, line, func) print_dispatcher_info(dc, file, line, func)
+// Records the processor in the profiling builds: for the stack profile returned by GET_APP_STATS,
+// and in the trace returned by GET_PROCESSOR_TRACE.
+static inline void record_processor(const char *func, int line) {
+    (void) func, (void) line;
+
+#ifdef HAVE_STACK_PROFILE
+    app_stats_record_processor(func, line);
+#endif
+    processor_trace_record(func, line);
+}
+
+#define LOG_PROCESSOR(dc, file, line, func)          \
+    do {                                             \
+        record_processor(func, line);                \
+        print_dispatcher_info(dc, file, line, func); \
+    } while (0)
@@ -25,7 +25,19 @@
 #include "globals.h"
 #include "sw.h"
 #include "common/buffer.h"
+#include "common/varint.h"
+#include "common/key_info_cache.h"
+#include "common/wallet_cache.h"
 #include "common/write.h"
+#include "common/account_xpub_cache.h"
+#include "common/private_node_cache.h"
+#include "common/spending_policy.h"
+#include "common/tweaked_key_cache.h"
+#include "common/symmetric_key_cache.h"
+#include "common/xpub_cache.h"
+#include "handler/sign_psbt.h"
+#include "legacy/include/btchip_context.h"
+#include "main.h"
 
 #include "dispatcher.h"
 
@@ -47,7 +59,12 @@ struct {
 // UX is not in idle state at the end of a command handler.
 bool G_was_processing_screen_shown;
 
+// set while the device is unlocked, in order to wipe the caches only once when it gets locked; the
+// initial value makes sure that they are wiped if the app starts with the device locked
+bool G_was_unlocked = true;
+
 uint16_t G_interruption_timeout_start_tick;
+uint16_t G_interruption_timeout_ticks = INTERRUPTION_TIMEOUT_TICKS;
 uint16_t G_processing_timeout_start_tick;
 
 UX_STEP_NOCB(ux_processing_flow_1_step, pn, {&C_icon_processing, "Processing..."});
@@ -57,6 +74,11 @@ void io_seproxyhal_display(const bagl_element_t *element) {
     io_seproxyhal_display_default((bagl_element_t *) element);
 }
 
+void io_set_client_latency(uint8_t latency_ticks) {
+    G_interruption_timeout_ticks =
+        INTERRUPTION_TIMEOUT_TICKS + INTERRUPTION_TIMEOUT_LATENCY_FACTOR * latency_ticks;
+}
+
 void io_start_interruption_timeout() {
     G_interruption_timeout_start_tick = G_ticks;
     G_is_timeout_active.interruption = true;
@@ -101,6 +123,26 @@ uint8_t io_event(uint8_t channel) {
         case SEPROXYHAL_TAG_TICKER_EVENT:
             ++G_ticks;
 
+            // keys derived from the seed, verified wallets and approved transactions are only
+            // cached while the device is unlocked
+            bool is_unlocked = os_global_pin_is_validated() == BOLOS_UX_OK;
+            if (!is_unlocked && G_was_unlocked) {
+                // on Nano S, the legacy context overlaps the globals of the new protocol
+                if (G_app_mode == APP_MODE_LEGACY) {
+                    btchip_signing_key_cache_reset();
+                }
+                xpub_cache_reset();
+                account_xpub_cache_reset();
+                private_node_cache_reset();
+                tweaked_key_cache_reset();
+                symmetric_key_cache_reset();
+                wallet_cache_reset();
+                key_info_cache_reset();
+                sign_psbt_checkpoint_reset();
+                spending_session_reset();
+            }
+            G_was_unlocked = is_unlocked;
+
             if (G_is_timeout_active.processing &&
                 G_ticks - G_processing_timeout_start_tick >= PROCESSING_TIMEOUT_TICKS) {
                 io_clear_processing_timeout();
@@ -110,7 +152,7 @@ uint8_t io_event(uint8_t channel) {
             }
 
             if (G_is_timeout_active.interruption &&
-                G_ticks - G_interruption_timeout_start_tick >= INTERRUPTION_TIMEOUT_TICKS) {
+                G_ticks - G_interruption_timeout_start_tick >= G_interruption_timeout_ticks) {
                 io_clear_interruption_timeout();
 
                 // TODO: It would be better to have the dispatcher be notified somehow.
@@ -169,6 +211,24 @@ void io_add_to_response(const void *rdata, size_t rdata_len) {
     }
 }
 
+void io_add_u8_to_response(uint8_t value) {
+    if (G_output_len >= IO_APDU_BUFFER_SIZE - 2) {
+        G_output_len = IO_APDU_BUFFER_SIZE;
+        write_u16_be(G_io_apdu_buffer, IO_APDU_BUFFER_SIZE - 2, SW_WRONG_RESPONSE_LENGTH);
+    } else {
+        G_io_apdu_buffer[G_output_len++] = value;
+    }
+}
+
+void io_add_varint_to_response(uint64_t value) {
+    if (G_output_len + varint_size(value) > IO_APDU_BUFFER_SIZE - 2) {
+        G_output_len = IO_APDU_BUFFER_SIZE;
+        write_u16_be(G_io_apdu_buffer, IO_APDU_BUFFER_SIZE - 2, SW_WRONG_RESPONSE_LENGTH);
+    } else {
+        G_output_len += varint_write(G_io_apdu_buffer, G_output_len, value);
+    }
+}
+
 void io_finalize_response(uint16_t sw) {
     if (G_output_len >= IO_APDU_BUFFER_SIZE - 2) {
         G_output_len = IO_APDU_BUFFER_SIZE;
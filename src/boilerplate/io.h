@@ -23,10 +23,20 @@ uint16_t io_exchange_al(uint8_t channel, uint16_t tx_len);
 #define INTERRUPTION_TIMEOUT_TICKS 50
 #define PROCESSING_TIMEOUT_TICKS   10
 
+// Number of ticks added to the interruption timeout for each tick of latency declared by the client
+#define INTERRUPTION_TIMEOUT_LATENCY_FACTOR 4
+
 /**
- * Instructs io_event to reset the app if INTERRUPTION_TIMEOUT_TICKS tick events are received before
- * io_clear_interruption_timeout is called. Used to cause an app reset if the client stop responding
- * while an APDU is being processed.
+ * Sets the latency of the client declared at the start of a command, in ticks (0 if the client
+ * responds immediately). The interruption timeout becomes INTERRUPTION_TIMEOUT_TICKS plus
+ * INTERRUPTION_TIMEOUT_LATENCY_FACTOR times the latency.
+ */
+void io_set_client_latency(uint8_t latency_ticks);
+
+/**
+ * Instructs io_event to reset the app if the interruption timeout (see io_set_client_latency)
+ * expires before io_clear_interruption_timeout is called. Used to cause an app reset if the client
+ * stop responding while an APDU is being processed.
  */
 void io_start_interruption_timeout();
 
@@ -62,6 +72,16 @@ void io_reset_response();
  */
 void io_add_to_response(const void *rdata, size_t rdata_len);
 
+/**
+ * Appends a single byte to the response.
+ */
+void io_add_u8_to_response(uint8_t value);
+
+/**
+ * Appends a Bitcoin-like varint to the response, writing it directly in the APDU buffer.
+ */
+void io_add_varint_to_response(uint64_t value);
+
 /**
  * TODO: docs
  */
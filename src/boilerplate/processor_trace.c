@@ -0,0 +1,74 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#ifdef HAVE_PROCESSOR_TRACE
+
+#include <stdint.h>
+#include <string.h>
+
+#include "processor_trace.h"
+
+// incremented at each ticker event, in io.c
+extern uint16_t G_ticks;
+
+static struct {
+    processor_trace_entry_t entries[PROCESSOR_TRACE_SIZE];
+    size_t start;  // index of the oldest entry
+    size_t count;
+    uint32_t dropped;
+} G_processor_trace;
+
+static void processor_trace_add(const char *func, uint16_t line) {
+    size_t pos = (G_processor_trace.start + G_processor_trace.count) % PROCESSOR_TRACE_SIZE;
+    if (G_processor_trace.count == PROCESSOR_TRACE_SIZE) {
+        // overwrite the oldest entry
+        G_processor_trace.start = (G_processor_trace.start + 1) % PROCESSOR_TRACE_SIZE;
+        ++G_processor_trace.dropped;
+    } else {
+        ++G_processor_trace.count;
+    }
+
+    G_processor_trace.entries[pos].func = func;
+    G_processor_trace.entries[pos].tick = G_ticks;
+    G_processor_trace.entries[pos].line = line;
+}
+
+void processor_trace_reset(void) {
+    memset(&G_processor_trace, 0, sizeof(G_processor_trace));
+}
+
+void processor_trace_record(const char *func, int line) {
+    processor_trace_add(func, (uint16_t) line);
+}
+
+void processor_trace_record_event(uint16_t event) {
+    processor_trace_add(NULL, event);
+}
+
+size_t processor_trace_count(void) {
+    return G_processor_trace.count;
+}
+
+uint32_t processor_trace_dropped(void) {
+    return G_processor_trace.dropped;
+}
+
+const processor_trace_entry_t *processor_trace_get(size_t index) {
+    return &G_processor_trace.entries[(G_processor_trace.start + index) % PROCESSOR_TRACE_SIZE];
+}
+
+#endif
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>  // uint*_t
+#include <stddef.h>  // size_t
+
+#include "../target_config.h"
+
+/*
+  Optional trace of the execution of the commands, used to analyze where the time is spent. It is
+  only compiled if HAVE_PROCESSOR_TRACE is defined (build with `make PROCESSOR_TRACE=1`); otherwise,
+  nothing is recorded.
+
+  Each LOG_PROCESSOR site records an entry with the current tick and the name of the processor;
+  the dispatcher also records an entry when a client command is sent to the host, when its
+  response is received, and when the command ends, so that the time spent waiting for the host can be told apart from the
+  time spent computing on the device. The entries are kept in a ring buffer, that drops the oldest
+  entries when full, and are returned by the GET_PROCESSOR_TRACE command.
+*/
+
+/**
+ * Number of entries of the trace.
+ */
+#define PROCESSOR_TRACE_SIZE TARGET_PROCESSOR_TRACE_SIZE
+
+/**
+ * Values of the line of the events of the dispatcher (entries whose func is NULL).
+ */
+#define PROCESSOR_TRACE_INTERRUPTION 0  // a client command was sent to the host
+#define PROCESSOR_TRACE_RESUME       1  // the response to a client command was received
+#define PROCESSOR_TRACE_END          2  // the command returned its final response
+
+typedef struct {
+    const char *func;  // name of the processor, or NULL for the events of the dispatcher
+    uint16_t tick;
+    uint16_t line;  // line of the LOG_PROCESSOR site, or the type of the event
+} processor_trace_entry_t;
+
+#ifdef HAVE_PROCESSOR_TRACE
+
+/**
+ * Removes all the entries from the trace.
+ */
+void processor_trace_reset(void);
+
+/**
+ * Records the execution of a processor at the current tick.
+ */
+void processor_trace_record(const char *func, int line);
+
+/**
+ * Records an event of the dispatcher (one of the PROCESSOR_TRACE_INTERRUPTION,
+ * PROCESSOR_TRACE_RESUME or PROCESSOR_TRACE_END) at the current tick.
+ */
+void processor_trace_record_event(uint16_t event);
+
+/**
+ * Returns the number of entries in the trace.
+ */
+size_t processor_trace_count(void);
+
+/**
+ * Returns the number of entries that were dropped since the trace was reset, because it was full.
+ */
+uint32_t processor_trace_dropped(void);
+
+/**
+ * Returns the entry at the given index, where 0 is the oldest entry; index must be smaller than
+ * processor_trace_count().
+ */
+const processor_trace_entry_t *processor_trace_get(size_t index);
+
+#else
+
+static inline void processor_trace_reset(void) {
+}
+
+static inline void processor_trace_record(const char *func, int line) {
+    (void) func;
+    (void) line;
+}
+
+static inline void processor_trace_record_event(uint16_t event) {
+    (void) event;
+}
+
+#endif
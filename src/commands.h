@@ -2,10 +2,15 @@
 
 #include "boilerplate/dispatcher.h"
 #include "constants.h"
+#include "handler/get_app_stats.h"
+#include "handler/get_debug_trace.h"
 #include "handler/get_master_fingerprint.h"
+#include "handler/get_processor_trace.h"
 #include "handler/get_extended_pubkey.h"
 #include "handler/get_wallet_address.h"
+#include "handler/register_spending_policy.h"
 #include "handler/register_wallet.h"
+#include "handler/sign_message.h"
 #include "handler/sign_psbt.h"
 
 /**
@@ -17,6 +22,15 @@ typedef enum {
     GET_WALLET_ADDRESS = 0x03,
     SIGN_PSBT = 0x04,
     GET_MASTER_FINGERPRINT = 0x05,
+    GET_WALLET_ADDRESSES = 0x06,
+    GET_ACCOUNT_XPUBS = 0x07,
+    GET_EXTENDED_PUBKEYS = 0x08,
+    REGISTER_WALLETS = 0x09,
+    REGISTER_SPENDING_POLICY = 0x0A,  // only available if compiled with HAVE_UNATTENDED_SIGNING
+    SIGN_MESSAGE = 0x10,
+    GET_DEBUG_TRACE = 0x7D,      // only available if compiled with HAVE_DEBUG_TRACE
+    GET_PROCESSOR_TRACE = 0x7E,  // only available if compiled with HAVE_PROCESSOR_TRACE
+    GET_APP_STATS = 0x7F,        // only available if compiled with HAVE_APP_STATS
 } command_e;
 
 /**
@@ -28,6 +42,10 @@ typedef union {
     register_wallet_state_t register_wallet_state;
     get_wallet_address_state_t get_wallet_address_state;
     sign_psbt_state_t sign_psbt_state;
+    sign_message_state_t sign_message_state;
+#ifdef HAVE_UNATTENDED_SIGNING
+    register_spending_policy_state_t register_spending_policy_state;
+#endif
 } command_state_t;
 
 /**
@@ -0,0 +1,128 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <string.h>   // memcpy
+#include <stdbool.h>  // bool
+
+#include "bip32.h"
+#include "cache.h"
+#include "account_xpub_cache.h"
+
+#define H BIP32_FIRST_HARDENED_CHILD
+
+// purpose, and script type for BIP48 (0 otherwise), of each standard account
+static const uint32_t standard_accounts[N_STANDARD_ACCOUNTS][2] = {
+    {H + 84, 0},
+    {H + 49, 0},
+    {H + 86, 0},
+    {H + 48, H + 2},
+};
+
+size_t get_standard_account_path(size_t index,
+                                 uint32_t coin_type,
+                                 uint32_t out[static MAX_STANDARD_ACCOUNT_PATH_LEN]) {
+    out[0] = standard_accounts[index][0];
+    out[1] = H + coin_type;
+    out[2] = H + 0;
+    if (standard_accounts[index][1] == 0) {
+        return 3;
+    }
+    out[3] = standard_accounts[index][1];
+    return 4;
+}
+
+#ifdef HAVE_ACCOUNT_XPUB_CACHE
+
+typedef struct {
+    uint32_t coin_type;  // with the hardened bit
+} account_xpub_cache_key_t;
+
+typedef struct {
+    account_xpub_cache_key_t key;
+    uint8_t parent_fingerprint[4];
+    uint8_t chain_code[32];
+    uint8_t compressed_pubkey[33];
+} account_xpub_cache_entry_t;
+
+// the slot of an entry is the index of its standard account
+CACHE_DEFINE(G_account_xpub_cache, account_xpub_cache_entry_t, N_STANDARD_ACCOUNTS);
+
+// Returns the index of the standard account with the given path (for any coin type), or -1.
+static int find_standard_account(const uint32_t bip32_path[], size_t bip32_path_len) {
+    if (bip32_path_len < 3 || bip32_path_len > MAX_STANDARD_ACCOUNT_PATH_LEN ||
+        bip32_path[1] < H || bip32_path[2] != H + 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < N_STANDARD_ACCOUNTS; i++) {
+        size_t len = standard_accounts[i][1] == 0 ? 3 : 4;
+        if (bip32_path[0] == standard_accounts[i][0] && bip32_path_len == len &&
+            (len == 3 || bip32_path[3] == standard_accounts[i][1])) {
+            return (int) i;
+        }
+    }
+    return -1;
+}
+
+void account_xpub_cache_reset(void) {
+    cache_reset(&G_account_xpub_cache);
+}
+
+bool account_xpub_cache_get(const uint32_t bip32_path[],
+                            size_t bip32_path_len,
+                            uint8_t parent_fingerprint[static 4],
+                            uint8_t chain_code[static 32],
+                            uint8_t compressed_pubkey[static 33]) {
+    int index = find_standard_account(bip32_path, bip32_path_len);
+    if (index < 0) {
+        return false;
+    }
+
+    account_xpub_cache_key_t key = {.coin_type = bip32_path[1]};
+    const account_xpub_cache_entry_t *entry =
+        cache_get_at(&G_account_xpub_cache, (size_t) index, &key);
+    if (entry == NULL) {
+        return false;
+    }
+
+    memcpy(parent_fingerprint, entry->parent_fingerprint, 4);
+    memcpy(chain_code, entry->chain_code, 32);
+    memcpy(compressed_pubkey, entry->compressed_pubkey, 33);
+    return true;
+}
+
+bool account_xpub_cache_add(const uint32_t bip32_path[],
+                            size_t bip32_path_len,
+                            const uint8_t parent_fingerprint[static 4],
+                            const uint8_t chain_code[static 32],
+                            const uint8_t compressed_pubkey[static 33]) {
+    int index = find_standard_account(bip32_path, bip32_path_len);
+    if (index < 0) {
+        return false;
+    }
+
+    account_xpub_cache_key_t key = {.coin_type = bip32_path[1]};
+    account_xpub_cache_entry_t *entry = cache_set_at(&G_account_xpub_cache, (size_t) index, &key);
+    memcpy(entry->parent_fingerprint, parent_fingerprint, 4);
+    memcpy(entry->chain_code, chain_code, 32);
+    memcpy(entry->compressed_pubkey, compressed_pubkey, 33);
+    return true;
+}
+
+#endif
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+/*
+  The standard accounts are the account-level keys of the default wallets that software wallets
+  query whenever they connect to the device: m/84'/c'/0', m/49'/c'/0', m/86'/c'/0' and
+  m/48'/c'/0'/2', where c is the coin type. GET_ACCOUNT_XPUBS returns all of them in one command.
+
+  The optional account xpub cache keeps their extended pubkeys, one slot per standard account, so
+  that they are never evicted by the other keys in the xpub cache. It is only compiled if
+  HAVE_ACCOUNT_XPUB_CACHE is defined (build with `make ACCOUNT_XPUB_CACHE=1`); otherwise, lookups
+  always miss and additions do nothing. The slots are filled the first time each key is derived
+  after the device is unlocked; like the xpub cache, the cache is wiped when the device is locked,
+  and when the app exits.
+*/
+
+/**
+ * Number of standard accounts.
+ */
+#define N_STANDARD_ACCOUNTS 4
+
+/**
+ * Maximum number of steps of the path of a standard account.
+ */
+#define MAX_STANDARD_ACCOUNT_PATH_LEN 4
+
+/**
+ * Computes the BIP32 path of a standard account.
+ *
+ * @param[in] index
+ *   Index of the standard account, from 0 to N_STANDARD_ACCOUNTS - 1.
+ * @param[in] coin_type
+ *   The BIP44 coin type, without the hardened bit.
+ * @param[out] out
+ *   Pointer to the output buffer for the steps of the path.
+ *
+ * @return the number of steps of the path.
+ */
+size_t get_standard_account_path(size_t index,
+                                 uint32_t coin_type,
+                                 uint32_t out[static MAX_STANDARD_ACCOUNT_PATH_LEN]);
+
+#ifdef HAVE_ACCOUNT_XPUB_CACHE
+
+/**
+ * Removes all the entries from the cache, wiping their content.
+ */
+void account_xpub_cache_reset(void);
+
+/**
+ * Looks up the extended pubkey at the given path in the cache.
+ *
+ * @param[in] bip32_path
+ *   Pointer to the steps of the BIP32 path.
+ * @param[in] bip32_path_len
+ *   Number of steps of the BIP32 path.
+ * @param[out] parent_fingerprint
+ *   Pointer to the 4-bytes output buffer for the fingerprint of the parent key, in big-endian.
+ * @param[out] chain_code
+ *   Pointer to the 32-bytes output buffer for the chain code.
+ * @param[out] compressed_pubkey
+ *   Pointer to the 33-bytes output buffer for the compressed pubkey.
+ *
+ * @return true if the key was found in the cache, false otherwise.
+ */
+bool account_xpub_cache_get(const uint32_t bip32_path[],
+                            size_t bip32_path_len,
+                            uint8_t parent_fingerprint[static 4],
+                            uint8_t chain_code[static 32],
+                            uint8_t compressed_pubkey[static 33]);
+
+/**
+ * Stores the extended pubkey at the given path in the slot of its standard account, if the path is
+ * the one of a standard account (for any coin type).
+ *
+ * @param[in] bip32_path
+ *   Pointer to the steps of the BIP32 path.
+ * @param[in] bip32_path_len
+ *   Number of steps of the BIP32 path.
+ * @param[in] parent_fingerprint
+ *   Pointer to the 4-bytes fingerprint of the parent key, in big-endian.
+ * @param[in] chain_code
+ *   Pointer to the 32-bytes chain code.
+ * @param[in] compressed_pubkey
+ *   Pointer to the 33-bytes compressed pubkey.
+ *
+ * @return true if the path is the one of a standard account and the key was stored, false
+ * otherwise.
+ */
+bool account_xpub_cache_add(const uint32_t bip32_path[],
+                            size_t bip32_path_len,
+                            const uint8_t parent_fingerprint[static 4],
+                            const uint8_t chain_code[static 32],
+                            const uint8_t compressed_pubkey[static 33]);
+
+#else
+
+static inline void account_xpub_cache_reset(void) {
+}
+
+static inline bool account_xpub_cache_get(const uint32_t bip32_path[],
+                                          size_t bip32_path_len,
+                                          uint8_t parent_fingerprint[static 4],
+                                          uint8_t chain_code[static 32],
+                                          uint8_t compressed_pubkey[static 33]) {
+    (void) bip32_path;
+    (void) bip32_path_len;
+    (void) parent_fingerprint;
+    (void) chain_code;
+    (void) compressed_pubkey;
+    return false;
+}
+
+static inline bool account_xpub_cache_add(const uint32_t bip32_path[],
+                                          size_t bip32_path_len,
+                                          const uint8_t parent_fingerprint[static 4],
+                                          const uint8_t chain_code[static 32],
+                                          const uint8_t compressed_pubkey[static 33]) {
+    (void) bip32_path;
+    (void) bip32_path_len;
+    (void) parent_fingerprint;
+    (void) chain_code;
+    (void) compressed_pubkey;
+    return false;
+}
+
+#endif
@@ -0,0 +1,87 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <string.h>   // memcpy, memset
+#include <stdbool.h>  // bool
+
+#include "cache.h"
+#include "address_cache.h"
+
+typedef struct {
+    uint8_t script_len;
+    uint8_t script[ADDRESS_CACHE_MAX_SCRIPT_LEN];
+} address_cache_key_t;
+
+typedef struct {
+    address_cache_key_t key;
+    uint8_t address_len;
+    char address[ADDRESS_CACHE_MAX_ADDRESS_LEN];
+} address_cache_entry_t;
+
+CACHE_DEFINE(G_address_cache, address_cache_entry_t, ADDRESS_CACHE_SIZE);
+
+void address_cache_reset(void) {
+    cache_reset(&G_address_cache);
+}
+
+// Returns false if the scriptPubKey is empty or too long to be cached.
+static bool make_key(address_cache_key_t *key, const uint8_t script[], size_t script_len) {
+    if (script_len == 0 || script_len > ADDRESS_CACHE_MAX_SCRIPT_LEN) {
+        return false;
+    }
+
+    memset(key, 0, sizeof(*key));
+    key->script_len = (uint8_t) script_len;
+    memcpy(key->script, script, script_len);
+    return true;
+}
+
+int address_cache_get(const uint8_t script[], size_t script_len, char *out, size_t out_len) {
+    address_cache_key_t key;
+    if (!make_key(&key, script, script_len)) {
+        return -1;
+    }
+
+    const address_cache_entry_t *entry = cache_get(&G_address_cache, &key);
+    if (entry == NULL || out_len < (size_t) entry->address_len + 1) {
+        return -1;
+    }
+
+    memcpy(out, entry->address, entry->address_len);
+    out[entry->address_len] = '\0';
+    return entry->address_len;
+}
+
+void address_cache_add(const uint8_t script[],
+                       size_t script_len,
+                       const char *address,
+                       size_t address_len) {
+    address_cache_key_t key;
+    if (address_len > ADDRESS_CACHE_MAX_ADDRESS_LEN || !make_key(&key, script, script_len)) {
+        return;
+    }
+
+    address_cache_entry_t *entry = cache_add(&G_address_cache, &key);
+    if (entry == NULL) {
+        return;
+    }
+
+    entry->address_len = (uint8_t) address_len;
+    memcpy(entry->address, address, address_len);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#include "../target_config.h"
+
+/*
+  A small cache of the addresses of scriptPubKeys, as rendered by get_script_address. The same
+  address is often rendered more than once: requested again with GET_WALLET_ADDRESS (for example,
+  to show it after returning it), or both shown and returned by different commands; each time, it
+  takes a base58check encoding (with a double sha256) or a bech32/bech32m encoding.
+
+  An address is identified by its scriptPubKey; the coin (hence, the address versions and the
+  segwit prefix) is fixed for the lifetime of the app, so entries are kept across commands, and
+  replaced in round-robin order.
+*/
+
+/**
+ * Number of entries of the cache.
+ */
+#define ADDRESS_CACHE_SIZE TARGET_ADDRESS_CACHE_SIZE
+
+/**
+ * Maximum length of the scriptPubKeys in the cache; the ones of all the supported address types
+ * are at most 34 bytes long (P2WSH and P2TR).
+ */
+#define ADDRESS_CACHE_MAX_SCRIPT_LEN 34
+
+/**
+ * Maximum length of the addresses in the cache, excluding the terminating null character.
+ */
+#define ADDRESS_CACHE_MAX_ADDRESS_LEN 74
+
+/**
+ * Removes all the entries from the cache.
+ */
+void address_cache_reset(void);
+
+/**
+ * Looks up the address of a scriptPubKey in the cache.
+ *
+ * @param[in] script
+ *   Pointer to the scriptPubKey.
+ * @param[in] script_len
+ *   Length of the scriptPubKey.
+ * @param[out] out
+ *   Pointer to the output buffer for the null-terminated address.
+ * @param[in] out_len
+ *   Length of the output buffer.
+ *
+ * @return the length of the address (excluding the terminating null character) if it was found in
+ * the cache and it fits in the output buffer, -1 otherwise.
+ */
+int address_cache_get(const uint8_t script[], size_t script_len, char *out, size_t out_len);
+
+/**
+ * Adds the address of a scriptPubKey to the cache, replacing the oldest entry if the cache is full.
+ * Does nothing if the scriptPubKey is already present, or if it or the address is too long.
+ *
+ * @param[in] script
+ *   Pointer to the scriptPubKey.
+ * @param[in] script_len
+ *   Length of the scriptPubKey.
+ * @param[in] address
+ *   Pointer to the address.
+ * @param[in] address_len
+ *   Length of the address, excluding the terminating null character (if any).
+ */
+void address_cache_add(const uint8_t script[],
+                       size_t script_len,
+                       const char *address,
+                       size_t address_len);
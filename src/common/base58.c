@@ -16,7 +16,7 @@
 
 #include <stddef.h>   // size_t
 #include <stdint.h>   // uint*_t
-#include <string.h>   // memmove, memset
+#include <string.h>   // memset
 #include <stdbool.h>  // bool
 
 #include "base58.h"
@@ -44,81 +44,117 @@ char const BASE58_ALPHABET[] = {
     'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z'             //
 };
 
-int base58_decode(const char *in, size_t in_len, uint8_t *out, size_t out_len) {
-    // uint8_t tmp[MAX_DEC_INPUT_SIZE] = {0};
-    // uint8_t buffer[MAX_DEC_INPUT_SIZE] = {0};
-
-    // allocate buffers inside the cxram section; safe as there are no syscalls here
-    uint8_t *tmp = get_cxram_buffer();                          // MAX_DEC_INPUT_SIZE bytes buffer
-    uint8_t *buffer = get_cxram_buffer() + MAX_DEC_INPUT_SIZE;  // MAX_DEC_INPUT_SIZE bytes buffer
-    memset(tmp, 0, MAX_DEC_INPUT_SIZE);
-    memset(buffer, 0, MAX_DEC_INPUT_SIZE);
-
-    uint8_t j;
-    uint8_t start_at;
-    uint8_t zero_count = 0;
+// The conversions work on multi-digit limbs rather than on single digits, which divides the number
+// of inner iterations (and, when encoding, of divisions) by 4; the limbs are small enough that all
+// the arithmetic fits in 32 bits, as the Cortex-M0 has no 64-bit multiply or divide instructions.
+
+// Decoding accumulates the value in 16-bit limbs, absorbing two base58 digits (a factor 58^2) at a
+// time; no division is needed.
+#define DEC_LIMB_BITS 16
+#define DEC_LIMB_MASK 0xFFFF
+#define DEC_DIGITS_MUL(n_digits) ((n_digits) == 1 ? 58 : 58 * 58)
+// log(58)/log(256) < 0.733, plus one limb for the rounding
+#define DEC_MAX_LIMBS ((MAX_DEC_INPUT_SIZE * 733 / 1000 + 1) / 2 + 1)
+
+// Encoding accumulates the value in limbs of 4 base58 digits each, absorbing one byte at a time:
+// limb * 256 + carry < 58^4 * 256 < 2^32.
+#define ENC_LIMB_BASE (58 * 58 * 58 * 58)
+#define ENC_LIMB_DIGITS 4
+#define ENC_MAX_DIGITS (MAX_ENC_INPUT_SIZE * 138 / 100 + 1)
+#define ENC_MAX_LIMBS ((ENC_MAX_DIGITS + ENC_LIMB_DIGITS - 1) / ENC_LIMB_DIGITS)
+
+// limbs has room for DEC_MAX_LIMBS limbs; the input must have been validated by the caller
+static int base58_decode_limbs(uint16_t *limbs,
+                               const char *in,
+                               size_t in_len,
+                               uint8_t *out,
+                               size_t out_len) {
+    size_t n_limbs = 0;  // least significant first
+    size_t zero_count = 0;
 
-    if (in_len > MAX_DEC_INPUT_SIZE || in_len < 2) {
-        return -1;
+    while ((zero_count < in_len) && (in[zero_count] == BASE58_ALPHABET[0])) {
+        ++zero_count;
     }
 
-    memmove(tmp, in, in_len);
+    // if the number of digits is odd, the first group only has one digit
+    size_t i = zero_count;
+    size_t group_len = (in_len - zero_count) % 2 == 1 ? 1 : 2;
+    while (i < in_len) {
+        uint32_t carry = BASE58_TABLE[(uint8_t) in[i]];
+        if (group_len == 2) {
+            carry = carry * 58 + BASE58_TABLE[(uint8_t) in[i + 1]];
+        }
+        uint32_t mul = DEC_DIGITS_MUL(group_len);
 
-    for (uint8_t i = 0; i < in_len; i++) {
-        if (in[i] >= sizeof(BASE58_TABLE)) {
-            return -1;
+        for (size_t k = 0; k < n_limbs; k++) {
+            uint32_t t = (uint32_t) limbs[k] * mul + carry;
+            limbs[k] = (uint16_t) (t & DEC_LIMB_MASK);
+            carry = t >> DEC_LIMB_BITS;
+        }
+        while (carry != 0) {
+            if (n_limbs >= DEC_MAX_LIMBS) {
+                return -1;  // should never happen
+            }
+            limbs[n_limbs++] = (uint16_t) (carry & DEC_LIMB_MASK);
+            carry >>= DEC_LIMB_BITS;
         }
 
-        tmp[i] = BASE58_TABLE[(int) in[i]];
+        i += group_len;
+        group_len = 2;
+    }
 
-        if (tmp[i] == 0xFF) {
-            return -1;
-        }
+    // the most significant limb might only use its low byte
+    size_t n_bytes = 2 * n_limbs;
+    if (n_limbs > 0 && limbs[n_limbs - 1] <= 0xFF) {
+        --n_bytes;
     }
 
-    while ((zero_count < in_len) && (tmp[zero_count] == 0)) {
-        ++zero_count;
+    size_t length = zero_count + n_bytes;
+    if (out_len < length) {
+        return -1;
     }
 
-    j = in_len;
-    start_at = zero_count;
-    while (start_at < in_len) {
-        uint16_t remainder = 0;
-        for (uint8_t div_loop = start_at; div_loop < in_len; div_loop++) {
-            uint16_t digit256 = (uint16_t) (tmp[div_loop] & 0xFF);
-            uint16_t tmp_div = remainder * 58 + digit256;
-            tmp[div_loop] = (uint8_t) (tmp_div / 256);
-            remainder = tmp_div % 256;
-        }
+    memset(out, 0, zero_count);
+    for (size_t b = 0; b < n_bytes; b++) {
+        // b-th byte from the end of the output
+        uint16_t limb = limbs[b / 2];
+        out[length - 1 - b] = (uint8_t) (b % 2 == 0 ? limb & 0xFF : limb >> 8);
+    }
 
-        if (tmp[start_at] == 0) {
-            ++start_at;
-        }
+    return (int) length;
+}
 
-        buffer[--j] = (uint8_t) remainder;
+int base58_decode(const char *in, size_t in_len, uint8_t *out, size_t out_len) {
+    if (in_len > MAX_DEC_INPUT_SIZE || in_len < 2) {
+        return -1;
     }
 
-    while ((j < in_len) && (buffer[j] == 0)) {
-        ++j;
+    for (size_t i = 0; i < in_len; i++) {
+        uint8_t c = (uint8_t) in[i];
+        if (c >= sizeof(BASE58_TABLE) || BASE58_TABLE[c] == 0xFF) {
+            return -1;
+        }
     }
 
-    int length = in_len - (j - zero_count);
+    // uint16_t limbs[DEC_MAX_LIMBS];
 
-    if ((int) out_len < length) {
+    // allocate the limbs inside the cxram section; safe as there are no syscalls here
+    cxram_mark_t mark = cxram_mark();
+    uint16_t *limbs = cxram_alloc(DEC_MAX_LIMBS * sizeof(uint16_t));
+    if (limbs == NULL) {
         return -1;
     }
 
-    memmove(out, buffer + j - zero_count, length);
+    int result = base58_decode_limbs(limbs, in, in_len, out, out_len);
 
-    return length;
+    cxram_release(mark);
+    return result;
 }
 
 int base58_encode(const uint8_t *in, size_t in_len, char *out, size_t out_len) {
-    uint8_t buffer[MAX_ENC_INPUT_SIZE * 138 / 100 + 1] = {0};
-    size_t i, j;
-    size_t stop_at;
+    uint32_t limbs[ENC_MAX_LIMBS];  // least significant first
+    size_t n_limbs = 0;
     size_t zero_count = 0;
-    size_t output_size;
 
     if (in_len > MAX_ENC_INPUT_SIZE) {
         return -1;
@@ -128,37 +164,45 @@ int base58_encode(const uint8_t *in, size_t in_len, char *out, size_t out_len) {
         ++zero_count;
     }
 
-    output_size = (in_len - zero_count) * 138 / 100 + 1;
-    stop_at = output_size - 1;
-    for (size_t start_at = zero_count; start_at < in_len; start_at++) {
-        unsigned int carry = in[start_at];
-        for (j = output_size - 1; (int) j >= 0; j--) {
-            carry += 256 * buffer[j];
-            buffer[j] = carry % 58;
-            carry /= 58;
-
-            if (j <= stop_at - 1 && carry == 0) {
-                break;
-            }
+    for (size_t i = zero_count; i < in_len; i++) {
+        uint32_t carry = in[i];
+        for (size_t k = 0; k < n_limbs; k++) {
+            uint32_t t = limbs[k] * 256 + carry;
+            limbs[k] = t % ENC_LIMB_BASE;
+            carry = t / ENC_LIMB_BASE;
+        }
+        // carry < 256 < ENC_LIMB_BASE, so at most one new limb is needed
+        if (carry != 0) {
+            limbs[n_limbs++] = carry;
         }
-        stop_at = j;
     }
 
-    j = 0;
-    while (j < output_size && buffer[j] == 0) {
-        j += 1;
+    // number of digits of the most significant limb; the other limbs have exactly ENC_LIMB_DIGITS
+    size_t top_digits = 0;
+    if (n_limbs > 0) {
+        for (uint32_t top = limbs[n_limbs - 1]; top != 0; top /= 58) {
+            ++top_digits;
+        }
     }
 
-    if (out_len < zero_count + output_size - j) {
+    size_t n_digits = n_limbs == 0 ? 0 : (n_limbs - 1) * ENC_LIMB_DIGITS + top_digits;
+    size_t length = zero_count + n_digits;
+    if (out_len < length) {
         return -1;
     }
 
     memset(out, BASE58_ALPHABET[0], zero_count);
 
-    i = zero_count;
-    while (j < output_size) {
-        out[i++] = BASE58_ALPHABET[buffer[j++]];
+    // write the digits from the least significant
+    size_t pos = length;
+    for (size_t k = 0; k < n_limbs; k++) {
+        uint32_t limb = limbs[k];
+        size_t limb_digits = k == n_limbs - 1 ? top_digits : ENC_LIMB_DIGITS;
+        for (size_t d = 0; d < limb_digits; d++) {
+            out[--pos] = BASE58_ALPHABET[limb % 58];
+            limb /= 58;
+        }
     }
 
-    return i;
+    return (int) length;
 }
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+/**
+ * Number of bytes needed to store a bitvector of the given number of bits.
+ */
+#define BITVECTOR_REAL_SIZE(n_bits) (((n_bits) + 7) / 8)
+
+/**
+ * Sets the bit at position i of the bitvector to the given value.
+ *
+ * @param[in,out] vec
+ *   Pointer to the bitvector.
+ * @param[in] i
+ *   Index of the bit; must be smaller than the number of bits of the bitvector.
+ * @param[in] value
+ *   The new value of the bit.
+ */
+static inline void bitvector_set(uint8_t *vec, size_t i, bool value) {
+    size_t byte_idx = i / 8;
+    uint8_t mask = (uint8_t) (1 << (i % 8));
+
+    if (value) {
+        vec[byte_idx] |= mask;
+    } else {
+        vec[byte_idx] &= (uint8_t) ~mask;
+    }
+}
+
+/**
+ * Returns the value of the bit at position i of the bitvector.
+ *
+ * @param[in] vec
+ *   Pointer to the bitvector.
+ * @param[in] i
+ *   Index of the bit; must be smaller than the number of bits of the bitvector.
+ *
+ * @return true if the bit is set, false otherwise.
+ */
+static inline bool bitvector_get(const uint8_t *vec, size_t i) {
+    return (vec[i / 8] >> (i % 8)) & 1;
+}
@@ -0,0 +1,73 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <string.h>   // memcpy, memcmp, memset, explicit_bzero
+#include <stdbool.h>  // bool
+
+#include "cache.h"
+
+static uint8_t *get_entry(const cache_t *cache, size_t slot) {
+    return (uint8_t *) cache->entries + slot * cache->entry_size;
+}
+
+static bool is_used(const cache_t *cache, size_t slot) {
+    return (cache->state->used & (UINT32_C(1) << slot)) != 0;
+}
+
+void cache_reset(const cache_t *cache) {
+    explicit_bzero(cache->entries, (size_t) cache->n_entries * cache->entry_size);
+    explicit_bzero(cache->state, sizeof(*cache->state));
+}
+
+void *cache_get_at(const cache_t *cache, size_t slot, const void *key) {
+    uint8_t *entry = get_entry(cache, slot);
+    if (!is_used(cache, slot) || memcmp(entry, key, cache->key_size) != 0) {
+        return NULL;
+    }
+    return entry;
+}
+
+void *cache_get(const cache_t *cache, const void *key) {
+    for (size_t i = 0; i < cache->n_entries; i++) {
+        void *entry = cache_get_at(cache, i, key);
+        if (entry != NULL) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+void *cache_set_at(const cache_t *cache, size_t slot, const void *key) {
+    uint8_t *entry = get_entry(cache, slot);
+
+    explicit_bzero(entry, cache->entry_size);
+    memcpy(entry, key, cache->key_size);
+    cache->state->used |= UINT32_C(1) << slot;
+    return entry;
+}
+
+void *cache_add(const cache_t *cache, const void *key) {
+    if (cache_get(cache, key) != NULL) {
+        return NULL;
+    }
+
+    size_t slot = cache->state->next_slot;
+    cache->state->next_slot = (uint8_t) ((slot + 1) % cache->n_entries);
+    return cache_set_at(cache, slot, key);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+/*
+  The storage of the caches of the app: a fixed array of entries, each identified by a key. The
+  caches only define the types of their entries, that is of their keys and of their values, and
+  how they map the arguments of their API to a key.
+
+  The key must be the first member of the entry, and is compared with memcmp: it must be zeroed
+  (including its padding, and the unused elements of its arrays) before being filled.
+
+  Entries are placed either in round-robin order (cache_add), or in a slot chosen by the caller
+  (cache_set_at), for the caches that know the access pattern better than round robin; a cache
+  that mixes kinds of entries with different lifetimes uses one storage for each kind. The content
+  is always wiped by cache_reset, as several caches hold secrets.
+*/
+
+/**
+ * Maximum number of entries of a cache.
+ */
+#define CACHE_MAX_ENTRIES 32
+
+/**
+ * The mutable state of a cache, besides its entries.
+ */
+typedef struct {
+    uint32_t used;      // bit i is set if the entry i holds a key
+    uint8_t next_slot;  // the entry replaced by the next cache_add
+} cache_state_t;
+
+/**
+ * Describes the storage of a cache; defined with CACHE_DEFINE.
+ */
+typedef struct {
+    void *entries;
+    cache_state_t *state;
+    uint16_t entry_size;
+    uint16_t key_size;
+    uint8_t n_entries;
+} cache_t;
+
+/**
+ * Defines the storage `name` of a cache of n_entries entries of type entry_type, a struct whose
+ * first member is its `key`.
+ */
+#define CACHE_DEFINE(name, entry_type, n_entries_)                                         \
+    _Static_assert(offsetof(entry_type, key) == 0, "The key must come first in the entry"); \
+    _Static_assert((n_entries_) > 0 && (n_entries_) <= CACHE_MAX_ENTRIES,                  \
+                   "Unsupported number of entries");                                       \
+    static entry_type name##_entries[n_entries_];                                          \
+    static cache_state_t name##_state;                                                     \
+    static const cache_t name = {.entries = name##_entries,                                \
+                                 .state = &name##_state,                                   \
+                                 .entry_size = sizeof(entry_type),                         \
+                                 .key_size = sizeof(((entry_type *) 0)->key),              \
+                                 .n_entries = (n_entries_)}
+
+/**
+ * Removes all the entries from the cache, wiping their content.
+ *
+ * @param[in] cache
+ *   Pointer to the cache.
+ */
+void cache_reset(const cache_t *cache);
+
+/**
+ * Looks up the entry with the given key in the cache.
+ *
+ * @param[in] cache
+ *   Pointer to the cache.
+ * @param[in] key
+ *   Pointer to the key, of the size of the keys of the cache.
+ *
+ * @return a pointer to the entry if found, or NULL otherwise.
+ */
+void *cache_get(const cache_t *cache, const void *key);
+
+/**
+ * Adds an entry with the given key, replacing the oldest entry if the cache is full. The caller
+ * then fills the value of the entry, whose other bytes are zeroed.
+ *
+ * @param[in] cache
+ *   Pointer to the cache.
+ * @param[in] key
+ *   Pointer to the key, of the size of the keys of the cache.
+ *
+ * @return a pointer to the new entry, or NULL if the key is already present.
+ */
+void *cache_add(const cache_t *cache, const void *key);
+
+/**
+ * Looks up the entry with the given key in the given slot of the cache.
+ *
+ * @param[in] cache
+ *   Pointer to the cache.
+ * @param[in] slot
+ *   Index of the slot, that must be less than the number of entries.
+ * @param[in] key
+ *   Pointer to the key, of the size of the keys of the cache.
+ *
+ * @return a pointer to the entry if the slot holds the key, or NULL otherwise.
+ */
+void *cache_get_at(const cache_t *cache, size_t slot, const void *key);
+
+/**
+ * Replaces the entry in the given slot of the cache with an entry with the given key. The caller
+ * then fills the value of the entry, whose other bytes are zeroed.
+ *
+ * @param[in] cache
+ *   Pointer to the cache.
+ * @param[in] slot
+ *   Index of the slot, that must be less than the number of entries.
+ * @param[in] key
+ *   Pointer to the key, of the size of the keys of the cache.
+ *
+ * @return a pointer to the new entry.
+ */
+void *cache_set_at(const cache_t *cache, size_t slot, const void *key);
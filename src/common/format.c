@@ -16,82 +16,93 @@
 
 #include <stddef.h>   // size_t
 #include <stdint.h>   // int*_t, uint*_t
-#include <string.h>   // strncpy, memmove
+#include <string.h>   // strncpy, memmove, memcpy
 #include <stdbool.h>  // bool
 
 #include "format.h"
 
-bool format_i64(char *dst, size_t dst_len, const int64_t value) {
-    char temp[] = "-9223372036854775808";
+// The Cortex-M0 has no divide instruction: each 64-bit division is a costly call to libgcc. The
+// digits are therefore computed in limbs of 9 decimal digits, with at most two 64-bit divisions to
+// split the value, and x / 10 within a limb is a multiplication by the reciprocal.
 
-    char *ptr = temp;
-    int64_t num = value;
-    int sign = 1;
+#define LIMB_DIGITS 9
+#define LIMB_BASE   1000000000u
 
-    if (value < 0) {
-        sign = -1;
-    }
+// x / 10, exact for any 32-bit x
+static inline uint32_t div10(uint32_t x) {
+    return (uint32_t) (((uint64_t) x * 0xCCCCCCCDu) >> 35);
+}
 
-    while (num != 0) {
-        *ptr++ = '0' + (num % 10) * sign;
-        num /= 10;
+// Writes the digits of value (most significant first, left-padded with zeros to min_digits, at
+// most LIMB_DIGITS) to out, without terminating it. Returns the number of digits written.
+static size_t write_u32_digits(char *out, uint32_t value, size_t min_digits) {
+    char digits[10];  // digits of UINT32_MAX
+    size_t count = 0;
+    do {
+        uint32_t quotient = div10(value);
+        digits[count++] = (char) ('0' + (value - quotient * 10));
+        value = quotient;
+    } while (value != 0);
+    while (count < min_digits) {
+        digits[count++] = '0';
     }
 
-    if (value < 0) {
-        *ptr++ = '-';
-    } else if (value == 0) {
-        *ptr++ = '0';
+    for (size_t i = 0; i < count; i++) {
+        out[i] = digits[count - 1 - i];
     }
+    return count;
+}
 
-    int distance = (ptr - temp) + 1;
+// Writes the digits of value to out, without terminating it; out must have room for 20 chars.
+// Returns the number of digits written.
+static size_t write_u64_digits(char *out, uint64_t value) {
+    uint32_t limbs[3];  // UINT64_MAX has 20 digits
+    size_t n_limbs = 0;
+    while (value > UINT32_MAX) {
+        uint64_t quotient = value / LIMB_BASE;
+        limbs[n_limbs++] = (uint32_t) (value - quotient * LIMB_BASE);
+        value = quotient;
+    }
+    limbs[n_limbs++] = (uint32_t) value;
 
-    if ((int) dst_len < distance) {
-        return false;
+    size_t count = write_u32_digits(out, limbs[n_limbs - 1], 1);
+    for (size_t i = n_limbs - 1; i > 0; i--) {
+        count += write_u32_digits(out + count, limbs[i - 1], LIMB_DIGITS);
     }
+    return count;
+}
+
+bool format_i64(char *dst, size_t dst_len, const int64_t value) {
+    char temp[20];
 
-    size_t index = 0;
+    // the magnitude of INT64_MIN is representable as an uint64_t
+    uint64_t magnitude = value < 0 ? -(uint64_t) value : (uint64_t) value;
+    size_t digits = write_u64_digits(temp, magnitude);
+    size_t length = digits + (value < 0 ? 1 : 0);
 
-    while (--ptr >= temp) {
-        dst[index++] = *ptr;
+    if (dst_len < length + 1) {
+        return false;
     }
 
-    dst[index] = '\0';
+    if (value < 0) {
+        *dst++ = '-';
+    }
+    memcpy(dst, temp, digits);
+    dst[digits] = '\0';
 
     return true;
 }
 
 bool format_u64(char *out, size_t outLen, uint64_t in) {
-    uint8_t i = 0;
+    char temp[20];
+    size_t digits = write_u64_digits(temp, in);
 
-    if (outLen == 0) {
+    if (outLen < digits + 1) {
         return false;
     }
-    outLen--;
 
-    while (in > 9) {
-        out[i] = in % 10 + '0';
-        in /= 10;
-        i++;
-        if (i + 1 > outLen) {
-            return false;
-        }
-    }
-    out[i] = in + '0';
-    out[i + 1] = '\0';
-
-    uint8_t j = 0;
-    char tmp;
-
-    // revert the string
-    while (j < i) {
-        // swap out[j] and out[i]
-        tmp = out[j];
-        out[j] = out[i];
-        out[i] = tmp;
-
-        i--;
-        j++;
-    }
+    memcpy(out, temp, digits);
+    out[digits] = '\0';
     return true;
 }
 
@@ -124,6 +135,7 @@ bool format_fpu64(char *dst, size_t dst_len, const uint64_t value, uint8_t decim
         memmove(dst, buffer, shift);
         dst[shift] = '.';
         strncpy(dst + shift + 1, buffer + shift, decimals);
+        dst[shift + 1 + decimals] = '\0';
     }
 
     return true;
@@ -0,0 +1,116 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <string.h>   // memcpy, memset
+#include <stdbool.h>  // bool
+
+#include "cache.h"
+#include "key_info_cache.h"
+
+#ifdef KEY_INFO_CACHE_ENABLED
+
+typedef struct {
+    uint32_t n_keys;
+    uint32_t key_index;
+    uint8_t keys_root[32];
+} key_info_cache_key_t;
+
+// The key information in binary form, without the room for the base58check-encoded extended pubkey
+// of policy_map_key_info_t.
+typedef struct {
+    key_info_cache_key_t key;
+    uint8_t master_key_derivation_len;
+    uint8_t has_key_origin;
+    uint8_t has_wildcard;
+    uint32_t master_key_derivation[MAX_BIP32_PATH_STEPS];
+    uint8_t master_key_fingerprint[4];
+    uint8_t serialized_ext_pubkey[SERIALIZED_EXTENDED_PUBKEY_LEN];
+} key_info_cache_entry_t;
+
+CACHE_DEFINE(G_key_info_cache, key_info_cache_entry_t, KEY_INFO_CACHE_SIZE);
+
+void key_info_cache_reset(void) {
+    cache_reset(&G_key_info_cache);
+}
+
+static void make_key(key_info_cache_key_t *key,
+                     const uint8_t keys_root[static 32],
+                     uint32_t n_keys,
+                     uint32_t key_index) {
+    key->n_keys = n_keys;
+    key->key_index = key_index;
+    memcpy(key->keys_root, keys_root, 32);
+}
+
+bool key_info_cache_get(const uint8_t keys_root[static 32],
+                        uint32_t n_keys,
+                        uint32_t key_index,
+                        policy_map_key_info_t *out) {
+    key_info_cache_key_t key;
+    make_key(&key, keys_root, n_keys, key_index);
+
+    const key_info_cache_entry_t *entry = cache_get(&G_key_info_cache, &key);
+    if (entry == NULL) {
+        return false;
+    }
+
+    memset(out, 0, sizeof(policy_map_key_info_t));
+    memcpy(out->master_key_derivation,
+           entry->master_key_derivation,
+           entry->master_key_derivation_len * sizeof(uint32_t));
+    memcpy(out->master_key_fingerprint, entry->master_key_fingerprint, 4);
+    out->master_key_derivation_len = entry->master_key_derivation_len;
+    out->has_key_origin = entry->has_key_origin;
+    out->has_wildcard = entry->has_wildcard;
+    out->is_binary = 1;
+    memcpy(out->serialized_ext_pubkey,
+           entry->serialized_ext_pubkey,
+           sizeof(entry->serialized_ext_pubkey));
+    return true;
+}
+
+void key_info_cache_add(const uint8_t keys_root[static 32],
+                        uint32_t n_keys,
+                        uint32_t key_index,
+                        const policy_map_key_info_t *key_info) {
+    if (!key_info->is_binary || key_info->master_key_derivation_len > MAX_BIP32_PATH_STEPS) {
+        return;
+    }
+
+    key_info_cache_key_t key;
+    make_key(&key, keys_root, n_keys, key_index);
+
+    key_info_cache_entry_t *entry = cache_add(&G_key_info_cache, &key);
+    if (entry == NULL) {
+        return;
+    }
+
+    memcpy(entry->master_key_derivation,
+           key_info->master_key_derivation,
+           key_info->master_key_derivation_len * sizeof(uint32_t));
+    memcpy(entry->master_key_fingerprint, key_info->master_key_fingerprint, 4);
+    entry->master_key_derivation_len = key_info->master_key_derivation_len;
+    entry->has_key_origin = key_info->has_key_origin;
+    entry->has_wildcard = key_info->has_wildcard;
+    memcpy(entry->serialized_ext_pubkey,
+           key_info->serialized_ext_pubkey,
+           sizeof(entry->serialized_ext_pubkey));
+}
+
+#endif
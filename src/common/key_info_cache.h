@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#include "wallet.h"
+#include "../target_config.h"
+
+/*
+  Cache of the key information of the wallet policies that were verified against the root of their
+  Merkle tree, so that the keys of a wallet policy are requested to the client, parsed, and their
+  base58check extended pubkeys decoded only once; for example, by SIGN_PSBT, that needs the keys
+  both to check the ownership of the inputs and outputs and to find its own keys when signing.
+
+  An entry is identified by the root of the Merkle tree of the keys information and its size, and
+  by the index of the key in the tree; the root commits to the leaf, and the wallet policies whose
+  keys are looked up are verified (with their hmac, or as default wallets) before their root is
+  used. Key information are stored in their binary form (with the extended pubkey already decoded
+  and checksummed), whatever the form of the leaf.
+
+  If HAVE_KEY_INFO_CACHE is defined (build with `make KEY_INFO_CACHE=1`), the cache is kept for the
+  session, so that consecutive commands for the same wallet (for example, GET_WALLET_ADDRESS and
+  SIGN_PSBT for the same multisig wallet) also share it: like the wallet cache, entries are only
+  kept while the device is unlocked, and the cache is wiped when the device is locked, and when
+  the app exits. Otherwise, on the devices where KEY_INFO_CACHE_PER_COMMAND is 1, entries only live
+  for the duration of a command, and the cache is wiped when a new command starts; on the others,
+  lookups always miss and additions do nothing.
+*/
+
+/**
+ * Number of entries of the cache; enough for all the keys of a wallet policy, except on NanoS.
+ */
+#define KEY_INFO_CACHE_SIZE TARGET_KEY_INFO_CACHE_SIZE
+
+/**
+ * 1 if the cache is compiled even without HAVE_KEY_INFO_CACHE, for the duration of a command.
+ */
+#define KEY_INFO_CACHE_PER_COMMAND TARGET_KEY_INFO_CACHE_PER_COMMAND
+
+#if defined(HAVE_KEY_INFO_CACHE) || KEY_INFO_CACHE_PER_COMMAND
+#define KEY_INFO_CACHE_ENABLED
+#endif
+
+#ifdef KEY_INFO_CACHE_ENABLED
+
+/**
+ * Removes all the entries from the cache, wiping their content.
+ */
+void key_info_cache_reset(void);
+
+/**
+ * Looks up a verified key information in the cache.
+ *
+ * @param[in] keys_root
+ *   Pointer to the 32-bytes root of the Merkle tree of the keys information.
+ * @param[in] n_keys
+ *   Number of keys in the Merkle tree.
+ * @param[in] key_index
+ *   Index of the key.
+ * @param[out] out
+ *   Pointer to the key information, written in binary form if found.
+ *
+ * @return true if the key was found in the cache, false otherwise.
+ */
+bool key_info_cache_get(const uint8_t keys_root[static 32],
+                        uint32_t n_keys,
+                        uint32_t key_index,
+                        policy_map_key_info_t *out);
+
+/**
+ * Adds a key information, whose leaf was verified against the root, to the cache, replacing the
+ * least recently added entry if the cache is full. Does nothing if the key is already present.
+ *
+ * @param[in] keys_root
+ *   Pointer to the 32-bytes root of the Merkle tree of the keys information.
+ * @param[in] n_keys
+ *   Number of keys in the Merkle tree.
+ * @param[in] key_index
+ *   Index of the key.
+ * @param[in] key_info
+ *   Pointer to the key information, that must be in binary form.
+ */
+void key_info_cache_add(const uint8_t keys_root[static 32],
+                        uint32_t n_keys,
+                        uint32_t key_index,
+                        const policy_map_key_info_t *key_info);
+
+#else
+
+static inline void key_info_cache_reset(void) {
+}
+
+static inline bool key_info_cache_get(const uint8_t keys_root[static 32],
+                                      uint32_t n_keys,
+                                      uint32_t key_index,
+                                      policy_map_key_info_t *out) {
+    (void) keys_root;
+    (void) n_keys;
+    (void) key_index;
+    (void) out;
+    return false;
+}
+
+static inline void key_info_cache_add(const uint8_t keys_root[static 32],
+                                      uint32_t n_keys,
+                                      uint32_t key_index,
+                                      const policy_map_key_info_t *key_info) {
+    (void) keys_root;
+    (void) n_keys;
+    (void) key_index;
+    (void) key_info;
+}
+
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+/*
+  A 16-bit filter of the key origins (fingerprint and derivation path) of the keys of a wallet
+  policy, to classify a BIP32 derivation as foreign without deriving any script: each key origin
+  sets one bit of the filter, chosen by a hash of the origin. A derivation whose origin (its path
+  without the final /change/address_index steps) does not hit a set bit can not be the derivation
+  of a key of the wallet; a hit is only a candidate.
+*/
+typedef uint16_t key_origin_filter_t;
+
+// Filter that accepts any origin; used for wallet policies with keys without a key origin.
+#define KEY_ORIGIN_FILTER_ANY ((key_origin_filter_t) 0xFFFF)
+
+/**
+ * Returns the bit of the filter for the given key origin.
+ *
+ * @param[in] fingerprint
+ *   The fingerprint of the key origin, as the little-endian integer of its 4 bytes.
+ * @param[in] path
+ *   The derivation steps of the key origin.
+ * @param[in] path_len
+ *   The number of derivation steps.
+ *
+ * @return a filter with exactly one bit set.
+ */
+static inline key_origin_filter_t key_origin_filter_bit(uint32_t fingerprint,
+                                                        const uint32_t *path,
+                                                        size_t path_len) {
+    // multiplicative hashing; the top 4 bits of the hash select the bit
+    uint32_t h = (fingerprint ^ (uint32_t) path_len) * 0x9E3779B1u;
+    for (size_t i = 0; i < path_len; i++) {
+        h = (h ^ path[i]) * 0x9E3779B1u;
+    }
+    return (key_origin_filter_t) (1u << (h >> 28));
+}
+
+/**
+ * Returns true if the given key origin may be one of the key origins added to the filter, false if
+ * it is definitely not.
+ *
+ * @param[in] filter
+ *   The filter.
+ * @param[in] fingerprint
+ *   The fingerprint of the key origin, as the little-endian integer of its 4 bytes.
+ * @param[in] path
+ *   The derivation steps of the key origin.
+ * @param[in] path_len
+ *   The number of derivation steps.
+ */
+static inline bool key_origin_filter_may_contain(key_origin_filter_t filter,
+                                                 uint32_t fingerprint,
+                                                 const uint32_t *path,
+                                                 size_t path_len) {
+    return (filter & key_origin_filter_bit(fingerprint, path, path_len)) != 0;
+}
@@ -0,0 +1,124 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <string.h>   // memcpy, memset
+#include <stdbool.h>  // bool
+
+#include "cache.h"
+#include "map_commitment_cache.h"
+
+#if MAP_COMMITMENT_CACHE_SIZE > 0
+
+typedef struct {
+    uint32_t size;
+    uint8_t root[32];
+} map_commitment_cache_key_t;
+
+typedef struct {
+    map_commitment_cache_key_t key;
+    uint32_t index;
+    merkleized_map_commitment_t map;
+} map_commitment_cache_entry_t;
+
+// the slot of a leaf is given by its index
+CACHE_DEFINE(G_map_commitment_cache, map_commitment_cache_entry_t, MAP_COMMITMENT_CACHE_SIZE);
+
+void map_commitment_cache_reset(void) {
+    cache_reset(&G_map_commitment_cache);
+}
+
+static void make_key(map_commitment_cache_key_t *key,
+                     const uint8_t root[static 32],
+                     uint32_t size) {
+    memset(key, 0, sizeof(*key));
+    key->size = size;
+    memcpy(key->root, root, 32);
+}
+
+bool map_commitment_cache_get(const uint8_t root[static 32],
+                              uint32_t size,
+                              uint32_t index,
+                              merkleized_map_commitment_t *out) {
+    if (size == 0) {
+        return false;
+    }
+
+    map_commitment_cache_key_t key;
+    make_key(&key, root, size);
+
+    const map_commitment_cache_entry_t *entry =
+        cache_get_at(&G_map_commitment_cache, index % MAP_COMMITMENT_CACHE_SIZE, &key);
+    if (entry == NULL || entry->index != index) {
+        return false;
+    }
+    memcpy(out, &entry->map, sizeof(entry->map));
+    return true;
+}
+
+void map_commitment_cache_add(const uint8_t root[static 32],
+                              uint32_t size,
+                              uint32_t index,
+                              const merkleized_map_commitment_t *map) {
+    if (size == 0 || index >= size) {
+        return;
+    }
+
+    map_commitment_cache_key_t key;
+    make_key(&key, root, size);
+
+    // the leaf in the slot, if of the same tree, is kept if it comes later in a visit by index
+    size_t slot = index % MAP_COMMITMENT_CACHE_SIZE;
+    const map_commitment_cache_entry_t *resident =
+        cache_get_at(&G_map_commitment_cache, slot, &key);
+    if (resident != NULL && resident->index >= index) {
+        return;
+    }
+
+    map_commitment_cache_entry_t *entry = cache_set_at(&G_map_commitment_cache, slot, &key);
+    entry->index = index;
+    memcpy(&entry->map, map, sizeof(*map));
+}
+
+#else
+
+void map_commitment_cache_reset(void) {
+}
+
+bool map_commitment_cache_get(const uint8_t root[static 32],
+                              uint32_t size,
+                              uint32_t index,
+                              merkleized_map_commitment_t *out) {
+    (void) root;
+    (void) size;
+    (void) index;
+    (void) out;
+    return false;
+}
+
+void map_commitment_cache_add(const uint8_t root[static 32],
+                              uint32_t size,
+                              uint32_t index,
+                              const merkleized_map_commitment_t *map) {
+    (void) root;
+    (void) size;
+    (void) index;
+    (void) map;
+}
+
+#endif
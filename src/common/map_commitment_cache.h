@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#include "../target_config.h"
+#include "merkle.h"
+
+/*
+  A small cache of the commitments of merkleized maps that were already verified to be a leaf of a
+  Merkle tree, like the maps of the inputs and the outputs of a PSBT. An entry is identified by the
+  root and the size of the tree, and by the index of the leaf.
+
+  Each phase of SIGN_PSBT fetches the same maps again; with the cache, the roots of a map are found
+  without the Merkle proof of its leaf, nor the preimage of the commitment.
+
+  Like for the Merkle cache, entries are facts that hold independently of the command being
+  executed. The slot of an entry is given by the index of its leaf, modulo the size of the cache:
+  the maps are visited by increasing index, so when a later leaf of the same tree takes the slot,
+  the entry already there is kept, as it is needed again sooner in the next visit. A tree with at
+  most MAP_COMMITMENT_CACHE_SIZE leaves is cached whole; for a larger one, a pass over its leaves
+  keeps the last MAP_COMMITMENT_CACHE_SIZE of them, and the following passes find those.
+*/
+
+/**
+ * Number of entries of the cache.
+ */
+#define MAP_COMMITMENT_CACHE_SIZE TARGET_MAP_COMMITMENT_CACHE_SIZE
+
+/**
+ * Removes all the entries from the cache.
+ */
+void map_commitment_cache_reset(void);
+
+/**
+ * Looks up the commitment of a merkleized map in the cache.
+ *
+ * @param[in] root
+ *   Pointer to the 32-bytes root of the Merkle tree.
+ * @param[in] size
+ *   Number of leaves of the Merkle tree.
+ * @param[in] index
+ *   Index of the leaf of the map.
+ * @param[out] out
+ *   Pointer to the commitment, only written if present in the cache.
+ *
+ * @return true if the commitment is in the cache, false otherwise.
+ */
+bool map_commitment_cache_get(const uint8_t root[static 32],
+                              uint32_t size,
+                              uint32_t index,
+                              merkleized_map_commitment_t *out);
+
+/**
+ * Adds the commitment of a merkleized map to the cache, in the slot of its index, unless the slot
+ * holds a later leaf of the same tree. The commitment must have already been verified to be the
+ * leaf of the tree at the given index. Does nothing if the leaf is already present.
+ *
+ * @param[in] root
+ *   Pointer to the 32-bytes root of the Merkle tree.
+ * @param[in] size
+ *   Number of leaves of the Merkle tree.
+ * @param[in] index
+ *   Index of the leaf of the map.
+ * @param[in] map
+ *   Pointer to the commitment.
+ */
+void map_commitment_cache_add(const uint8_t root[static 32],
+                              uint32_t size,
+                              uint32_t index,
+                              const merkleized_map_commitment_t *map);
@@ -20,11 +20,22 @@
 #include <stdbool.h>  // bool
 
 #include "buffer.h"
+
+#ifndef SKIP_FOR_CMOCKA
 #include "../crypto.h"
+#else
+// the crypto helpers are not available when compiling unit tests with CMOCKA
+#include "os.h"
+#include "cx.h"
+#define PRINT_STACK_POINTER()
+#endif
 
 #include "merkle.h"
 
 #include "cx_ram.h"
+#include "../cxram_stash.h"
+
+#ifndef SKIP_FOR_CMOCKA
 
 void merkle_compute_element_hash(const uint8_t *in, size_t in_len, uint8_t out[static 32]) {
     cx_sha256_t hash;
@@ -37,6 +48,8 @@ void merkle_compute_element_hash(const uint8_t *in, size_t in_len, uint8_t out[s
     crypto_hash_digest(&hash.header, out, 32);
 }
 
+#endif
+
 // void merkle_combine_hashes(const uint8_t left[static 32],
 //                            const uint8_t right[static 32],
 //                            uint8_t out[static 32]) {
@@ -53,20 +66,74 @@ void merkle_compute_element_hash(const uint8_t *in, size_t in_len, uint8_t out[s
 //     crypto_hash_digest(&hash.header, out, 32);
 // }
 
-// implementation using the cxram section, in order to save ram
+// Computes H(0x01 | left | right) from node, that contains the concatenation, with a single update
+// of the hash context in the cxram section (in order to save ram). The output can overlap node.
+static void merkle_hash_node(const uint8_t node[static 1 + 2 * 32], uint8_t out[static 32]) {
+    cxram_check_overlap(&G_cx.sha256, sizeof(cx_sha256_t));
+
+    cx_sha256_init_no_throw(&G_cx.sha256);
+    cx_hash_no_throw(&G_cx.sha256.header, CX_LAST, node, 1 + 2 * 32, out, 32);
+}
+
 void merkle_combine_hashes(const uint8_t left[static 32],
                            const uint8_t right[static 32],
                            uint8_t out[static 32]) {
     PRINT_STACK_POINTER();
 
-    cx_sha256_init_no_throw(&G_cx.sha256);
+    uint8_t node[1 + 2 * 32];
+    node[0] = 0x01;
+    memcpy(node + 1, left, 32);
+    memcpy(node + 1 + 32, right, 32);
+
+    merkle_hash_node(node, out);
+    explicit_bzero(&G_cx.sha256, sizeof(cx_sha256_t));
+}
 
-    uint8_t prefix = 0x01;
-    cx_sha256_update(&G_cx.sha256, &prefix, 1);
+int merkle_climb_proof(uint8_t cur_hash[static 32],
+                       const uint8_t *siblings,
+                       size_t n_steps,
+                       uint32_t directions,
+                       size_t level) {
+    PRINT_STACK_POINTER();
 
-    cx_sha256_update(&G_cx.sha256, left, 32);
-    cx_sha256_update(&G_cx.sha256, right, 32);
+    if (n_steps > level) {
+        return -1;
+    }
+
+    uint8_t node[1 + 2 * 32];
+    node[0] = 0x01;
+    for (size_t i = 0; i < n_steps; i++) {
+        // the direction of the ancestor at the current level, from its parent
+        if (((directions >> (level - i - 1)) & 1) == 0) {
+            memcpy(node + 1, cur_hash, 32);
+            memcpy(node + 1 + 32, siblings + 32 * i, 32);
+        } else {
+            memcpy(node + 1, siblings + 32 * i, 32);
+            memcpy(node + 1 + 32, cur_hash, 32);
+        }
+
+        merkle_hash_node(node, cur_hash);
+    }
 
-    cx_sha256_final(&G_cx.sha256, out);
     explicit_bzero(&G_cx.sha256, sizeof(cx_sha256_t));
-}
\ No newline at end of file
+    return 0;
+}
+
+void merkle_compute_root(const uint8_t (*leaf_hashes)[32], size_t n_leaves, uint8_t out[static 32]) {
+    if (n_leaves == 0) {
+        memset(out, 0, 32);
+        return;
+    } else if (n_leaves == 1) {
+        memcpy(out, leaf_hashes[0], 32);
+        return;
+    }
+
+    // the left subtree has the largest power of 2 strictly smaller than n_leaves
+    size_t n_left = 1 << (ceil_lg(n_leaves) - 1);
+
+    uint8_t right_hash[32];
+    merkle_compute_root(leaf_hashes, n_left, out);
+    merkle_compute_root(leaf_hashes + n_left, n_leaves - n_left, right_hash);
+
+    merkle_combine_hashes(out, right_hash, out);
+}
@@ -2,6 +2,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 
 // TODO: RFC6962 defines the empty list hash as sha256(b''); while we're using 0 here. Should we
 // change?
@@ -57,54 +58,144 @@ void merkle_combine_hashes(const uint8_t left[static 32],
                            const uint8_t right[static 32],
                            uint8_t out[static 32]);
 
+/**
+ * Verifies a part of the Merkle proof of a leaf, combining the hash of one of its ancestors with
+ * consecutive sibling hashes of the proof, from the lowest level.
+ *
+ * The intermediate hashes are computed with a single hash context, with one update per level; it
+ * is equivalent to, but faster than, calling merkle_combine_hashes for each sibling.
+ *
+ * @param[in,out] cur_hash
+ *   Pointer to the 32-bytes hash of the ancestor at the given level; on success, it contains the
+ *   hash of the ancestor at level (level - n_steps).
+ * @param[in] siblings
+ *   Pointer to n_steps consecutive 32-byte sibling hashes.
+ * @param[in] n_steps
+ *   Number of sibling hashes.
+ * @param[in] directions
+ *   The directions of the path from the root to the leaf, as computed by merkle_get_directions.
+ * @param[in] level
+ *   Level of the ancestor whose hash is cur_hash, where the root has level 0. It must not be larger
+ *   than the level of the leaf.
+ *
+ * @return 0 on success, or -1 if the path from the ancestor to the root has less than n_steps
+ * levels; in that case, cur_hash is left unchanged.
+ */
+int merkle_climb_proof(uint8_t cur_hash[static 32],
+                       const uint8_t *siblings,
+                       size_t n_steps,
+                       uint32_t directions,
+                       size_t level);
+
+/**
+ * Computes the root of the Merkle tree built on top of the given list of leaf hashes. The root of
+ * an empty list is 32 zero bytes.
+ *
+ * The implementation is recursive, with depth ceil(log2(n_leaves)); therefore, it should only be
+ * used for small lists.
+ *
+ * @param[in] leaf_hashes
+ *   Pointer to an array of n_leaves hashes, each 32 bytes long.
+ * @param[in] n_leaves
+ *   Number of leaves.
+ * @param[out] out
+ *   Pointer to a 32-bytes buffer to store the result. It must not overlap with leaf_hashes.
+ */
+void merkle_compute_root(const uint8_t (*leaf_hashes)[32], size_t n_leaves, uint8_t out[static 32]);
+
 // inlined to save on stack depth
 static inline uint8_t ceil_lg(uint32_t n) {
-    uint8_t r = 0;
-    uint32_t t = 1;
-    while (t < n) {
-        t = 2 * t;
-        ++r;
-    }
-    return r;
+    return n <= 1 ? 0 : (uint8_t) (32 - __builtin_clz(n - 1));
 }
 
-// Returns the ith member of the directions array for the leaf with the given index in a Merkle tree
-// of the given size. Returns -1 on error.
-// TODO: make this O(log n), or possibly O(1). Currently O(log^2 n).
+// The shape of a Merkle tree, shared by the paths to all its leaves. The left subtree of each node
+// is perfect, so the tree only differs from a perfect tree of 2^depth leaves on its right edge: at
+// each level where the bit of size - 1 is 0, the last node has no sibling, and is moved up
+// unchanged.
+typedef struct {
+    uint32_t size;             // the number of leaves
+    uint32_t right_edge_mask;  // size - 1; the levels of the right edge with a left sibling
+    uint8_t depth;             // ceil_lg(size)
+} merkle_tree_shape_t;
+
+static inline void merkle_tree_shape_init(merkle_tree_shape_t *shape, uint32_t size) {
+    shape->size = size;
+    shape->right_edge_mask = size - 1;
+    shape->depth = ceil_lg(size);
+}
+
+// Number of set bits of x, without a library call on the targets without a popcount instruction.
+static inline uint32_t merkle_popcount(uint32_t x) {
+    x = x - ((x >> 1) & 0x55555555);
+    x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+    x = (x + (x >> 4)) & 0x0F0F0F0F;
+    return (x * 0x01010101) >> 24;
+}
+
+// Reverses the order of the bits of x.
+static inline uint32_t merkle_bit_reverse(uint32_t x) {
+    x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+    x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F) | ((x & 0x0F0F0F0F) << 4);
+    x = ((x >> 8) & 0x00FF00FF) | ((x & 0x00FF00FF) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// Computes the directions of the path from the root to the leaf with the given index in a Merkle
+// tree with the given shape: bit i of *directions is the ith direction, where 0 = left, 1 = right.
+// Returns the number of directions (that is, the level of the leaf), or -1 on error. O(1).
 //
-// inlined to save on stack depth (only used once anyway, so no impact on code size)
-static inline int merkle_get_ith_direction(size_t size, size_t index, size_t i) {
-    if (size <= 1 || index >= size) {
+// The path follows the right edge of the tree while the index agrees with the index of the last
+// leaf, turning right at each set bit of the right edge mask; it then turns left at the highest
+// bit where they differ, into a perfect subtree where the directions are the lower bits of the
+// index, from the highest one.
+static inline int merkle_shape_get_directions(const merkle_tree_shape_t *shape,
+                                              uint32_t index,
+                                              uint32_t *directions) {
+    if (index >= shape->size) {
         return -1;
     }
 
-    uint8_t n_directions = 0;
-    while (size > 1) {
-        uint8_t depth = ceil_lg(size);
-
-        // bitmask of the direction from the current node, where 0 = left, 1 = right;
-        // also the number of leaves of the left subtree
-        uint32_t mask = 1 << (depth - 1);
-
-        uint8_t is_right_child = (index & mask) != 0 ? 1 : 0;
+    uint32_t diff = index ^ shape->right_edge_mask;
+    if (diff == 0) {
+        // the last leaf: only right turns
+        uint32_t n_right = merkle_popcount(shape->right_edge_mask);
+        *directions = (uint32_t) (((uint64_t) 1 << n_right) - 1);
+        return (int) n_right;
+    }
 
-        if (n_directions == i) {
-            return is_right_child;
-        }
+    uint32_t k = 31 - (uint32_t) __builtin_clz(diff);
+    uint32_t n_right = merkle_popcount(shape->right_edge_mask >> k >> 1);
+    // the k lower bits of the index, the highest one first
+    uint32_t perfect_directions =
+        (uint32_t) (((uint64_t) merkle_bit_reverse(index) << k) >> 32);
+    *directions = (((uint32_t) 1 << n_right) - 1) | (perfect_directions << (n_right + 1));
+    return (int) (n_right + 1 + k);
+}
 
-        ++n_directions;
+// Same as merkle_shape_get_directions, for a tree of the given size.
+//
+// inlined to save on stack depth
+static inline int merkle_get_directions(size_t size, size_t index, uint32_t *directions) {
+    if (index >= size) {
+        return -1;
+    }
 
-        if (is_right_child) {
-            size -= mask;
-            index -= mask;
-        } else {
-            size = mask;
-        }
+    merkle_tree_shape_t shape;
+    merkle_tree_shape_init(&shape, (uint32_t) size);
+    return merkle_shape_get_directions(&shape, (uint32_t) index, directions);
+}
 
-        mask /= 2;
+// Returns the ith member of the directions array for the leaf with the given index in a Merkle tree
+// of the given size. Returns -1 on error. O(log n); in order to visit all the directions, use
+// merkle_get_directions instead.
+static inline int merkle_get_ith_direction(size_t size, size_t index, size_t i) {
+    uint32_t directions;
+    int n_directions = merkle_get_directions(size, index, &directions);
+    if (n_directions < 0 || i >= (size_t) n_directions) {
+        return -1;
     }
-
-    return -1;
+    return (directions >> i) & 1;
 }
 
 /**
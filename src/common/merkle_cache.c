@@ -0,0 +1,126 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <string.h>   // memcpy, memset
+#include <stdbool.h>  // bool
+
+#include "cache.h"
+#include "merkle_cache.h"
+
+typedef struct {
+    uint32_t size;
+    uint32_t first_leaf_index;
+    uint8_t level;
+    uint8_t root[32];
+} merkle_cache_key_t;
+
+typedef struct {
+    merkle_cache_key_t key;
+    uint8_t hash[32];
+} merkle_cache_entry_t;
+
+// the internal nodes and the leaves are replaced in their own storage
+CACHE_DEFINE(G_merkle_node_cache, merkle_cache_entry_t, MERKLE_CACHE_NODE_SLOTS);
+CACHE_DEFINE(G_merkle_leaf_cache,
+             merkle_cache_entry_t,
+             MERKLE_CACHE_SIZE - MERKLE_CACHE_NODE_SLOTS);
+
+void merkle_cache_reset(void) {
+    cache_reset(&G_merkle_node_cache);
+    cache_reset(&G_merkle_leaf_cache);
+}
+
+static void make_key(merkle_cache_key_t *key,
+                     const uint8_t root[static 32],
+                     uint32_t size,
+                     uint8_t level,
+                     uint32_t first_leaf_index) {
+    memset(key, 0, sizeof(*key));
+    key->size = size;
+    key->first_leaf_index = first_leaf_index;
+    key->level = level;
+    memcpy(key->root, root, 32);
+}
+
+const uint8_t *merkle_cache_get(const uint8_t root[static 32],
+                                uint32_t size,
+                                uint8_t level,
+                                uint32_t first_leaf_index) {
+    if (size == 0) {
+        return NULL;
+    }
+
+    merkle_cache_key_t key;
+    make_key(&key, root, size, level, first_leaf_index);
+
+    const merkle_cache_entry_t *entry = cache_get(&G_merkle_node_cache, &key);
+    if (entry == NULL) {
+        entry = cache_get(&G_merkle_leaf_cache, &key);
+    }
+    return entry != NULL ? entry->hash : NULL;
+}
+
+void merkle_cache_add(const uint8_t root[static 32],
+                      uint32_t size,
+                      uint8_t level,
+                      uint32_t first_leaf_index,
+                      const uint8_t hash[static 32]) {
+    if (size == 0) {
+        return;
+    }
+
+    merkle_cache_key_t key;
+    make_key(&key, root, size, level, first_leaf_index);
+
+    // a leaf has no descendant at the next level
+    bool is_leaf = merkle_get_ancestor_first_leaf(size, first_leaf_index, level + 1) < 0;
+    merkle_cache_entry_t *entry =
+        cache_add(is_leaf ? &G_merkle_leaf_cache : &G_merkle_node_cache, &key);
+    if (entry != NULL) {
+        memcpy(entry->hash, hash, 32);
+    }
+}
+
+int64_t merkle_get_ancestor_first_leaf(uint32_t size, uint32_t leaf_index, uint8_t level) {
+    if (leaf_index >= size) {
+        return -1;
+    }
+
+    uint32_t first_leaf_index = 0;
+    for (uint8_t cur_level = 0; cur_level < level; cur_level++) {
+        if (size <= 1) {
+            return -1;  // reached the leaf before the requested level
+        }
+
+        // number of leaves of the left subtree: the largest power of 2 strictly smaller than size
+        uint32_t n_left = 1;
+        while (2 * n_left < size) {
+            n_left *= 2;
+        }
+
+        if (leaf_index - first_leaf_index >= n_left) {
+            first_leaf_index += n_left;
+            size -= n_left;
+        } else {
+            size = n_left;
+        }
+    }
+
+    return first_leaf_index;
+}
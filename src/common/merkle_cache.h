@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#include "../target_config.h"
+
+/*
+  A small cache of Merkle tree nodes whose hash was already authenticated against the root of the
+  tree. A node is identified by the root and the size of the tree, by its level (where the root has
+  level 0), and by the index of the leftmost leaf in its subtree. Leaves are also nodes, whose level
+  is the length of their Merkle proof.
+
+  Once a node is verified, its hash can be trusted in place of the root when verifying the Merkle
+  proof of any leaf in its subtree, which allows to stop the verification early, and to request
+  shorter proofs to the client.
+
+  Since entries are facts that hold independently of the command being executed, the cache does not
+  need to be reset between commands. Internal nodes and leaves are replaced in round-robin order,
+  each in their own slots: the leaves of the large trees of a psbt are visited once per pass, and
+  would otherwise evict the few internal nodes that shorten the proofs of all the following leaves.
+*/
+
+/**
+ * Number of entries of the cache.
+ */
+#define MERKLE_CACHE_SIZE TARGET_MERKLE_CACHE_SIZE
+
+/**
+ * Number of the entries of the cache for internal nodes; the others are for leaves.
+ */
+#define MERKLE_CACHE_NODE_SLOTS (MERKLE_CACHE_SIZE / 2)
+
+/**
+ * Internal nodes are only cached up to this level, as nodes closer to the root are shared by more
+ * leaves.
+ */
+#define MERKLE_CACHE_MAX_LEVEL 3
+
+/**
+ * Removes all the entries from the cache.
+ */
+void merkle_cache_reset(void);
+
+/**
+ * Looks up the hash of a node in the cache.
+ *
+ * @param[in] root
+ *   Pointer to the 32-bytes root of the Merkle tree.
+ * @param[in] size
+ *   Number of leaves of the Merkle tree.
+ * @param[in] level
+ *   Level of the node, where the root has level 0.
+ * @param[in] first_leaf_index
+ *   Index of the leftmost leaf in the subtree of the node.
+ *
+ * @return pointer to the 32-bytes hash of the node if present in the cache, NULL otherwise. The
+ *   pointer is only valid until the next call to merkle_cache_add or merkle_cache_reset.
+ */
+const uint8_t *merkle_cache_get(const uint8_t root[static 32],
+                                uint32_t size,
+                                uint8_t level,
+                                uint32_t first_leaf_index);
+
+/**
+ * Adds the hash of a node to the cache, replacing the oldest internal node or leaf (like the added
+ * node) if they fill their slots. The hash must have already been verified against the root. Does
+ * nothing if the node is already present.
+ *
+ * @param[in] root
+ *   Pointer to the 32-bytes root of the Merkle tree.
+ * @param[in] size
+ *   Number of leaves of the Merkle tree.
+ * @param[in] level
+ *   Level of the node, where the root has level 0.
+ * @param[in] first_leaf_index
+ *   Index of the leftmost leaf in the subtree of the node.
+ * @param[in] hash
+ *   Pointer to the 32-bytes hash of the node.
+ */
+void merkle_cache_add(const uint8_t root[static 32],
+                      uint32_t size,
+                      uint8_t level,
+                      uint32_t first_leaf_index,
+                      const uint8_t hash[static 32]);
+
+/**
+ * Computes the index of the leftmost leaf in the subtree of the ancestor of a leaf at the given
+ * level.
+ *
+ * @param[in] size
+ *   Number of leaves of the Merkle tree.
+ * @param[in] leaf_index
+ *   Index of the leaf.
+ * @param[in] level
+ *   Level of the ancestor, where the root has level 0.
+ *
+ * @return the index of the leftmost leaf of the ancestor, or -1 if the leaf index is invalid or the
+ *   leaf is at a lower level than requested.
+ */
+int64_t merkle_get_ancestor_first_leaf(uint32_t size, uint32_t leaf_index, uint8_t level);
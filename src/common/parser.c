@@ -3,6 +3,7 @@
 #include "parser.h"
 
 #include "read.h"
+#include "varint.h"
 
 size_t dbuffer_get_length(buffer_t *buffers[2]) {
     return (buffers[0]->size - buffers[0]->offset) + (buffers[1]->size - buffers[1]->offset);
@@ -31,6 +32,34 @@ bool dbuffer_read_bytes(buffer_t *buffers[2], uint8_t *out, size_t n) {
     return true;
 }
 
+size_t dbuffer_read_chunk(buffer_t *buffers[2], size_t n, const uint8_t **out) {
+    for (int i = 0; i < 2; i++) {
+        size_t length = buffers[i]->size - buffers[i]->offset;
+        if (length > 0) {
+            size_t chunk_len = (length >= n) ? n : length;
+            *out = buffers[i]->ptr + buffers[i]->offset;
+            buffer_seek_cur(buffers[i], chunk_len);
+            return chunk_len;
+        }
+    }
+    return 0;
+}
+
+bool dbuffer_read_spans(buffer_t *buffers[2], size_t n, const uint8_t *out[2], size_t out_len[2]) {
+    if (!dbuffer_can_read(buffers, n)) {
+        return false;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        size_t length = buffers[i]->size - buffers[i]->offset;
+        out_len[i] = (length >= n) ? n : length;
+        out[i] = buffers[i]->ptr + buffers[i]->offset;
+        buffer_seek_cur(buffers[i], out_len[i]);
+        n -= out_len[i];
+    }
+    return true;
+}
+
 bool dbuffer_read_u8(buffer_t *buffers[2], uint8_t *out) {
     return dbuffer_read_bytes(buffers, out, 1);
 }
@@ -64,28 +93,19 @@ bool dbuffer_read_u32(buffer_t *buffers[2], uint32_t *out, endianness_t endianne
 }
 
 bool dbuffer_read_varint(buffer_t *buffers[2], uint64_t *out) {
+    // fast path: the varint is entirely in the first non-empty buffer, which is the common case
+    buffer_t *first = buffer_can_read(buffers[0], 1) ? buffers[0] : buffers[1];
+    if (buffer_read_varint(first, out)) {
+        return true;
+    }
+
     if (!dbuffer_can_read(buffers, 1)) {
         return false;
     }
 
-    // peek the first byte without changing the offsets
-    uint8_t first_byte = buffer_can_read(buffers[0], 1) ? buffers[0]->ptr[buffers[0]->offset]
-                                                        : buffers[1]->ptr[buffers[1]->offset];
-    uint8_t len;  // length excluding the prefix
-    switch (first_byte) {
-        case 0xfd:
-            len = 2;
-            break;
-        case 0xfe:
-            len = 4;
-            break;
-        case 0xff:
-            len = 8;
-            break;
-        default:
-            len = 0;
-            break;
-    }
+    // the varint straddles the two buffers; peek the first byte without changing the offsets
+    uint8_t first_byte = first->ptr[first->offset];
+    uint8_t len = varint_prefix_extra_len(first_byte);  // length excluding the prefix
 
     if (!dbuffer_can_read(buffers, 1 + len)) {
         return false;
@@ -93,11 +113,6 @@ bool dbuffer_read_varint(buffer_t *buffers[2], uint64_t *out) {
 
     dbuffer_read_u8(buffers, &first_byte);  // redundant, just to skip 1 byte
 
-    if (first_byte <= 0xfc) {
-        *out = first_byte;
-        return true;
-    }
-
     uint8_t data[8] = {0};
     dbuffer_read_bytes(buffers, data, len);
 
@@ -39,6 +39,27 @@ bool dbuffer_can_read(buffer_t *buffers[2], size_t n);
  */
 bool dbuffer_read_bytes(buffer_t *buffers[2], uint8_t *out, size_t n);
 
+/**
+ * Consumes up to n bytes from the concatenation of the two buffers, without copying them. On
+ * return, *out points to the consumed bytes. Since the consumed bytes are always contiguous, less
+ * than n bytes are consumed if the first buffer ends before; the caller should call this function
+ * again for the rest.
+ *
+ * @return the number of consumed bytes; 0 if both buffers are exhausted, or if n is 0.
+ */
+size_t dbuffer_read_chunk(buffer_t *buffers[2], size_t n, const uint8_t **out);
+
+/**
+ * Consumes exactly n bytes from the concatenation of the two buffers without copying them, if at
+ * least n bytes are available. On success, the consumed bytes are the concatenation of the
+ * out_len[0] bytes pointed by out[0] and the out_len[1] bytes pointed by out[1]; each of them can
+ * be empty.
+ *
+ * @return true on success; false if less than n bytes are available, in which case nothing is
+ * consumed.
+ */
+bool dbuffer_read_spans(buffer_t *buffers[2], size_t n, const uint8_t *out[2], size_t out_len[2]);
+
 /**
  * TODO: docs.
  */
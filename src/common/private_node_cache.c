@@ -0,0 +1,98 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <string.h>   // memcpy, memset
+#include <stdbool.h>  // bool
+
+#include "bip32.h"
+#include "cache.h"
+#include "private_node_cache.h"
+
+typedef struct {
+    uint8_t bip32_path_len;
+    uint32_t bip32_path[MAX_BIP32_PATH_STEPS];
+} private_node_cache_key_t;
+
+typedef struct {
+    private_node_cache_key_t key;
+    uint8_t private_key[32];
+    uint8_t chain_code[32];
+    uint8_t compressed_pubkey[33];
+} private_node_cache_entry_t;
+
+CACHE_DEFINE(G_private_node_cache, private_node_cache_entry_t, PRIVATE_NODE_CACHE_SIZE);
+
+void private_node_cache_reset(void) {
+    cache_reset(&G_private_node_cache);
+}
+
+// Returns false if the path is too long to be cached.
+static bool make_key(private_node_cache_key_t *key,
+                     const uint32_t bip32_path[],
+                     size_t bip32_path_len) {
+    if (bip32_path_len > MAX_BIP32_PATH_STEPS) {
+        return false;
+    }
+
+    memset(key, 0, sizeof(*key));
+    key->bip32_path_len = (uint8_t) bip32_path_len;
+    memcpy(key->bip32_path, bip32_path, bip32_path_len * sizeof(uint32_t));
+    return true;
+}
+
+bool private_node_cache_get(const uint32_t bip32_path[],
+                            size_t bip32_path_len,
+                            uint8_t private_key[static 32],
+                            uint8_t chain_code[static 32],
+                            uint8_t compressed_pubkey[static 33]) {
+    private_node_cache_key_t key;
+    if (!make_key(&key, bip32_path, bip32_path_len)) {
+        return false;
+    }
+
+    const private_node_cache_entry_t *entry = cache_get(&G_private_node_cache, &key);
+    if (entry == NULL) {
+        return false;
+    }
+
+    memcpy(private_key, entry->private_key, 32);
+    memcpy(chain_code, entry->chain_code, 32);
+    memcpy(compressed_pubkey, entry->compressed_pubkey, 33);
+    return true;
+}
+
+void private_node_cache_add(const uint32_t bip32_path[],
+                            size_t bip32_path_len,
+                            const uint8_t private_key[static 32],
+                            const uint8_t chain_code[static 32],
+                            const uint8_t compressed_pubkey[static 33]) {
+    private_node_cache_key_t key;
+    if (!make_key(&key, bip32_path, bip32_path_len)) {
+        return;
+    }
+
+    private_node_cache_entry_t *entry = cache_add(&G_private_node_cache, &key);
+    if (entry == NULL) {
+        return;
+    }
+
+    memcpy(entry->private_key, private_key, 32);
+    memcpy(entry->chain_code, chain_code, 32);
+    memcpy(entry->compressed_pubkey, compressed_pubkey, 33);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#include "../target_config.h"
+
+/*
+  A cache of the private BIP32 nodes (private key and chain code, with the compressed pubkey) that
+  are the parents of the keys used for signing. Deriving a key from the seed runs the whole chain of
+  derivations of its path; for the many inputs of a transaction signed with keys of the same
+  account (at m/.../change/address_index), the node at m/.../change is the same, and each key is
+  then derived from it with a single CKDpriv step.
+
+  Since the entries are private keys, they only live for the duration of a command: the cache is
+  wiped by the dispatcher when the command ends (with a success or an error), when a new command
+  starts, when an interrupted command is abandoned, when the device is locked and when the app
+  exits. Entries are replaced in round-robin order.
+*/
+
+/**
+ * Number of entries of the cache; two are enough for transactions that spend from both the
+ * receive and the change addresses of an account.
+ */
+#define PRIVATE_NODE_CACHE_SIZE TARGET_PRIVATE_NODE_CACHE_SIZE
+
+/**
+ * Removes all the entries from the cache, wiping their content.
+ */
+void private_node_cache_reset(void);
+
+/**
+ * Looks up the private node at the given path in the cache.
+ *
+ * @param[in] bip32_path
+ *   Pointer to the steps of the BIP32 path.
+ * @param[in] bip32_path_len
+ *   Number of steps of the BIP32 path.
+ * @param[out] private_key
+ *   Pointer to the 32-bytes output buffer for the private key.
+ * @param[out] chain_code
+ *   Pointer to the 32-bytes output buffer for the chain code.
+ * @param[out] compressed_pubkey
+ *   Pointer to the 33-bytes output buffer for the compressed pubkey.
+ *
+ * @return true if the node was found in the cache, false otherwise.
+ */
+bool private_node_cache_get(const uint32_t bip32_path[],
+                            size_t bip32_path_len,
+                            uint8_t private_key[static 32],
+                            uint8_t chain_code[static 32],
+                            uint8_t compressed_pubkey[static 33]);
+
+/**
+ * Adds the private node at the given path to the cache, replacing the oldest entry if the cache is
+ * full. Does nothing if the node is already present, or if the path is too long.
+ *
+ * @param[in] bip32_path
+ *   Pointer to the steps of the BIP32 path.
+ * @param[in] bip32_path_len
+ *   Number of steps of the BIP32 path.
+ * @param[in] private_key
+ *   Pointer to the 32-bytes private key.
+ * @param[in] chain_code
+ *   Pointer to the 32-bytes chain code.
+ * @param[in] compressed_pubkey
+ *   Pointer to the 33-bytes compressed pubkey.
+ */
+void private_node_cache_add(const uint32_t bip32_path[],
+                            size_t bip32_path_len,
+                            const uint8_t private_key[static 32],
+                            const uint8_t chain_code[static 32],
+                            const uint8_t compressed_pubkey[static 33]);
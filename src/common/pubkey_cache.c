@@ -0,0 +1,110 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <string.h>   // memcpy, memset
+#include <stdbool.h>  // bool
+
+#include "cache.h"
+#include "pubkey_cache.h"
+
+typedef struct {
+    uint32_t n_keys;
+    uint32_t key_index;
+    uint32_t change;  // 0 for keys without wildcard, whose entry does not depend on the change
+    bool has_wildcard;
+    uint8_t keys_root[32];
+} pubkey_cache_key_t;
+
+typedef struct {
+    pubkey_cache_key_t key;
+    uint8_t chain_code[32];
+    uint8_t uncompressed_pubkey[65];
+} pubkey_cache_entry_t;
+
+CACHE_DEFINE(G_pubkey_cache, pubkey_cache_entry_t, PUBKEY_CACHE_SIZE);
+
+void pubkey_cache_reset(void) {
+    cache_reset(&G_pubkey_cache);
+}
+
+static void make_key(pubkey_cache_key_t *key,
+                     const uint8_t keys_root[static 32],
+                     uint32_t n_keys,
+                     uint32_t key_index,
+                     uint32_t change,
+                     bool has_wildcard) {
+    memset(key, 0, sizeof(*key));
+    key->n_keys = n_keys;
+    key->key_index = key_index;
+    key->change = has_wildcard ? change : 0;
+    key->has_wildcard = has_wildcard;
+    memcpy(key->keys_root, keys_root, 32);
+}
+
+bool pubkey_cache_get(const uint8_t keys_root[static 32],
+                      uint32_t n_keys,
+                      uint32_t key_index,
+                      uint32_t change,
+                      bool *has_wildcard,
+                      uint8_t chain_code[static 32],
+                      uint8_t uncompressed_pubkey[static 65]) {
+    if (n_keys == 0) {
+        return false;
+    }
+
+    // the caller does not know yet if the key has a wildcard
+    pubkey_cache_key_t key;
+    make_key(&key, keys_root, n_keys, key_index, change, true);
+    const pubkey_cache_entry_t *entry = cache_get(&G_pubkey_cache, &key);
+    if (entry == NULL) {
+        make_key(&key, keys_root, n_keys, key_index, change, false);
+        entry = cache_get(&G_pubkey_cache, &key);
+    }
+    if (entry == NULL) {
+        return false;
+    }
+
+    *has_wildcard = entry->key.has_wildcard;
+    memcpy(chain_code, entry->chain_code, 32);
+    memcpy(uncompressed_pubkey, entry->uncompressed_pubkey, 65);
+    return true;
+}
+
+void pubkey_cache_add(const uint8_t keys_root[static 32],
+                      uint32_t n_keys,
+                      uint32_t key_index,
+                      uint32_t change,
+                      bool has_wildcard,
+                      const uint8_t chain_code[static 32],
+                      const uint8_t uncompressed_pubkey[static 65]) {
+    if (n_keys == 0) {
+        return;
+    }
+
+    pubkey_cache_key_t key;
+    make_key(&key, keys_root, n_keys, key_index, change, has_wildcard);
+
+    pubkey_cache_entry_t *entry = cache_add(&G_pubkey_cache, &key);
+    if (entry == NULL) {
+        return;
+    }
+
+    memcpy(entry->chain_code, chain_code, 32);
+    memcpy(entry->uncompressed_pubkey, uncompressed_pubkey, 65);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#include "../target_config.h"
+
+/*
+  A small cache of the pubkeys derived from the keys of a wallet policy. A key is identified by the
+  root of the Merkle tree of the keys information and its size, and by the index of the key in the
+  tree. For keys with a wildcard, the cache stores the chain code and the pubkey of the /change
+  child of the key, so that only the final /address_index derivation is needed for each script;
+  keys without wildcard are stored as they are. Pubkeys are stored uncompressed, so that deriving
+  their children does not require decompressing them each time.
+
+  Since the Merkle root commits to the keys information, entries are facts that hold independently
+  of the command being executed; therefore, like the Merkle cache, the cache does not need to be
+  reset between commands, and entries are simply replaced in round-robin order.
+*/
+
+/**
+ * Number of entries of the cache.
+ */
+#define PUBKEY_CACHE_SIZE TARGET_PUBKEY_CACHE_SIZE
+
+/**
+ * Removes all the entries from the cache.
+ */
+void pubkey_cache_reset(void);
+
+/**
+ * Looks up a key in the cache.
+ *
+ * @param[in] keys_root
+ *   Pointer to the 32-bytes root of the Merkle tree of the keys information.
+ * @param[in] n_keys
+ *   Number of keys in the Merkle tree.
+ * @param[in] key_index
+ *   Index of the key.
+ * @param[in] change
+ *   The change step of the derivation; ignored for keys without wildcard.
+ * @param[out] has_wildcard
+ *   Set to true if the key has a wildcard, that is, if the returned values are for its /change
+ *   child; set to false if they are for the key itself.
+ * @param[out] chain_code
+ *   Pointer to the 32-bytes output buffer for the chain code.
+ * @param[out] uncompressed_pubkey
+ *   Pointer to the 65-bytes output buffer for the uncompressed pubkey.
+ *
+ * @return true if the key was found in the cache, false otherwise.
+ */
+bool pubkey_cache_get(const uint8_t keys_root[static 32],
+                      uint32_t n_keys,
+                      uint32_t key_index,
+                      uint32_t change,
+                      bool *has_wildcard,
+                      uint8_t chain_code[static 32],
+                      uint8_t uncompressed_pubkey[static 65]);
+
+/**
+ * Adds a key to the cache, replacing the oldest entry if the cache is full. Does nothing if the
+ * key is already present.
+ *
+ * @param[in] keys_root
+ *   Pointer to the 32-bytes root of the Merkle tree of the keys information.
+ * @param[in] n_keys
+ *   Number of keys in the Merkle tree.
+ * @param[in] key_index
+ *   Index of the key.
+ * @param[in] change
+ *   The change step of the derivation; ignored for keys without wildcard.
+ * @param[in] has_wildcard
+ *   True if chain_code and uncompressed_pubkey are for the /change child of the key, false if they
+ *   are for the key itself.
+ * @param[in] chain_code
+ *   Pointer to the 32-bytes chain code.
+ * @param[in] uncompressed_pubkey
+ *   Pointer to the 65-bytes uncompressed pubkey.
+ */
+void pubkey_cache_add(const uint8_t keys_root[static 32],
+                      uint32_t n_keys,
+                      uint32_t key_index,
+                      uint32_t change,
+                      bool has_wildcard,
+                      const uint8_t chain_code[static 32],
+                      const uint8_t uncompressed_pubkey[static 65]);
@@ -2,6 +2,20 @@
 
 #include <stdint.h>  // uint*_t
 #include <stddef.h>  // size_t
+#include <string.h>  // memcpy
+
+/*
+  The readers are defined inline, as they are called for every field of every parsed transaction.
+
+  On targets that support unaligned accesses and are little-endian, a value is read with a single
+  (possibly unaligned) load through memcpy, followed by a byte swap for big-endian values. Other
+  targets (like the Cortex-M0 of the Nano S, that faults on unaligned loads) assemble the value
+  from single bytes; memcpy would not be turned into a word load there.
+*/
+#if (defined(__ARM_FEATURE_UNALIGNED) || defined(__x86_64__) || defined(__i386__)) && \
+    defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define READ_HAVE_WORD_LOADS
+#endif
 
 /**
  * Read 2 bytes as Big Endian from byte buffer.
@@ -14,7 +28,16 @@
  * @return 2 bytes value read from buffer.
  *
  */
-uint16_t read_u16_be(const uint8_t *ptr, size_t offset);
+static inline uint16_t read_u16_be(const uint8_t *ptr, size_t offset) {
+#ifdef READ_HAVE_WORD_LOADS
+    uint16_t value;
+    memcpy(&value, ptr + offset, sizeof(value));
+    return __builtin_bswap16(value);
+#else
+    return (uint16_t) ptr[offset + 0] << 8 |  //
+           (uint16_t) ptr[offset + 1] << 0;
+#endif
+}
 
 /**
  * Read 4 bytes as Big Endian from byte buffer.
@@ -27,7 +50,18 @@ uint16_t read_u16_be(const uint8_t *ptr, size_t offset);
  * @return 4 bytes value read from buffer.
  *
  */
-uint32_t read_u32_be(const uint8_t *ptr, size_t offset);
+static inline uint32_t read_u32_be(const uint8_t *ptr, size_t offset) {
+#ifdef READ_HAVE_WORD_LOADS
+    uint32_t value;
+    memcpy(&value, ptr + offset, sizeof(value));
+    return __builtin_bswap32(value);
+#else
+    return (uint32_t) ptr[offset + 0] << 24 |  //
+           (uint32_t) ptr[offset + 1] << 16 |  //
+           (uint32_t) ptr[offset + 2] << 8 |   //
+           (uint32_t) ptr[offset + 3] << 0;
+#endif
+}
 
 /**
  * Read 8 bytes as Big Endian from byte buffer.
@@ -40,7 +74,16 @@ uint32_t read_u32_be(const uint8_t *ptr, size_t offset);
  * @return 8 bytes value read from buffer.
  *
  */
-uint64_t read_u64_be(const uint8_t *ptr, size_t offset);
+static inline uint64_t read_u64_be(const uint8_t *ptr, size_t offset) {
+#ifdef READ_HAVE_WORD_LOADS
+    uint64_t value;
+    memcpy(&value, ptr + offset, sizeof(value));
+    return __builtin_bswap64(value);
+#else
+    return (uint64_t) read_u32_be(ptr, offset) << 32 |  //
+           (uint64_t) read_u32_be(ptr, offset + 4);
+#endif
+}
 
 /**
  * Read 2 bytes as Little Endian from byte buffer.
@@ -53,7 +96,16 @@ uint64_t read_u64_be(const uint8_t *ptr, size_t offset);
  * @return 2 bytes value read from buffer.
  *
  */
-uint16_t read_u16_le(const uint8_t *ptr, size_t offset);
+static inline uint16_t read_u16_le(const uint8_t *ptr, size_t offset) {
+#ifdef READ_HAVE_WORD_LOADS
+    uint16_t value;
+    memcpy(&value, ptr + offset, sizeof(value));
+    return value;
+#else
+    return (uint16_t) ptr[offset + 0] << 0 |  //
+           (uint16_t) ptr[offset + 1] << 8;
+#endif
+}
 
 /**
  * Read 4 bytes as Little Endian from byte buffer.
@@ -66,7 +118,18 @@ uint16_t read_u16_le(const uint8_t *ptr, size_t offset);
  * @return 4 bytes value read from buffer.
  *
  */
-uint32_t read_u32_le(const uint8_t *ptr, size_t offset);
+static inline uint32_t read_u32_le(const uint8_t *ptr, size_t offset) {
+#ifdef READ_HAVE_WORD_LOADS
+    uint32_t value;
+    memcpy(&value, ptr + offset, sizeof(value));
+    return value;
+#else
+    return (uint32_t) ptr[offset + 0] << 0 |   //
+           (uint32_t) ptr[offset + 1] << 8 |   //
+           (uint32_t) ptr[offset + 2] << 16 |  //
+           (uint32_t) ptr[offset + 3] << 24;
+#endif
+}
 
 /**
  * Read 8 bytes as Little Endian from byte buffer.
@@ -79,4 +142,13 @@ uint32_t read_u32_le(const uint8_t *ptr, size_t offset);
  * @return 8 bytes value read from buffer.
  *
  */
-uint64_t read_u64_le(const uint8_t *ptr, size_t offset);
+static inline uint64_t read_u64_le(const uint8_t *ptr, size_t offset) {
+#ifdef READ_HAVE_WORD_LOADS
+    uint64_t value;
+    memcpy(&value, ptr + offset, sizeof(value));
+    return value;
+#else
+    return (uint64_t) read_u32_le(ptr, offset) << 0 |  //
+           (uint64_t) read_u32_le(ptr, offset + 4) << 32;
+#endif
+}
@@ -27,14 +27,22 @@
 
 #include "segwit_addr.h"
 
+/* XOR of the generators 0x3b6a57b2, 0x26508e6d, 0x1ea119fa, 0x3d4233dd and
+ * 0x2a1462b3 selected by the bits of the index, so that each step takes a single
+ * lookup instead of five conditional XORs. Indexed directly, so it is PIC-safe. */
+static const uint32_t bech32_polymod_table[32] = {
+    0x00000000, 0x3b6a57b2, 0x26508e6d, 0x1d3ad9df,
+    0x1ea119fa, 0x25cb4e48, 0x38f19797, 0x039bc025,
+    0x3d4233dd, 0x0628646f, 0x1b12bdb0, 0x2078ea02,
+    0x23e32a27, 0x18897d95, 0x05b3a44a, 0x3ed9f3f8,
+    0x2a1462b3, 0x117e3501, 0x0c44ecde, 0x372ebb6c,
+    0x34b57b49, 0x0fdf2cfb, 0x12e5f524, 0x298fa296,
+    0x1756516e, 0x2c3c06dc, 0x3106df03, 0x0a6c88b1,
+    0x09f74894, 0x329d1f26, 0x2fa7c6f9, 0x14cd914b
+};
+
 static uint32_t bech32_polymod_step(uint32_t pre) {
-    uint8_t b = pre >> 25;
-    return ((pre & 0x1FFFFFF) << 5) ^
-        (-((b >> 0) & 1) & 0x3b6a57b2UL) ^
-        (-((b >> 1) & 1) & 0x26508e6dUL) ^
-        (-((b >> 2) & 1) & 0x1ea119faUL) ^
-        (-((b >> 3) & 1) & 0x3d4233ddUL) ^
-        (-((b >> 4) & 1) & 0x2a1462b3UL);
+    return ((pre & 0x1FFFFFF) << 5) ^ bech32_polymod_table[pre >> 25];
 }
 
 static uint32_t bech32_final_constant(bech32_encoding enc) {
@@ -57,7 +65,7 @@ static const int8_t charset_rev[128] = {
      1,  0,  3, 16, 11, 28, 12, 14,  6,  4,  2, -1, -1, -1, -1, -1
 };
 
-int bech32_encode(char *output, const char *hrp, const uint8_t *data, size_t data_len, bech32_encoding enc) {
+int bech32_hrp_state(const char *hrp, uint32_t *state) {
     uint32_t chk = 1;
     size_t i = 0;
     while (hrp[i] != 0) {
@@ -70,18 +78,26 @@ int bech32_encode(char *output, const char *hrp, const uint8_t *data, size_t dat
         chk = bech32_polymod_step(chk) ^ (ch >> 5);
         ++i;
     }
-    if (i + 7 + data_len > 90) return 0;
     chk = bech32_polymod_step(chk);
+    for (i = 0; hrp[i] != 0; ++i) {
+        chk = bech32_polymod_step(chk) ^ (hrp[i] & 0x1f);
+    }
+    *state = chk;
+    return 1;
+}
+
+/* Writes the human readable part and the separator; returns the end of the output. */
+static char *bech32_write_hrp(char *output, const char *hrp) {
     while (*hrp != 0) {
-        chk = bech32_polymod_step(chk) ^ (*hrp & 0x1f);
         *(output++) = *(hrp++);
     }
     *(output++) = '1';
-    for (i = 0; i < data_len; ++i) {
-        if (*data >> 5) return 0;
-        chk = bech32_polymod_step(chk) ^ (*data);
-        *(output++) = charset[*(data++)];
-    }
+    return output;
+}
+
+/* Writes the 6 characters of the checksum of the state chk after the data, and the null terminator. */
+static void bech32_write_checksum(char *output, uint32_t chk, bech32_encoding enc) {
+    size_t i;
     for (i = 0; i < 6; ++i) {
         chk = bech32_polymod_step(chk);
     }
@@ -90,6 +106,20 @@ int bech32_encode(char *output, const char *hrp, const uint8_t *data, size_t dat
         *(output++) = charset[(chk >> ((5 - i) * 5)) & 0x1f];
     }
     *output = 0;
+}
+
+int bech32_encode(char *output, const char *hrp, const uint8_t *data, size_t data_len, bech32_encoding enc) {
+    uint32_t chk;
+    size_t i;
+    if (!bech32_hrp_state(hrp, &chk)) return 0;
+    if (strlen(hrp) + 7 + data_len > 90) return 0;
+    output = bech32_write_hrp(output, hrp);
+    for (i = 0; i < data_len; ++i) {
+        if (*data >> 5) return 0;
+        chk = bech32_polymod_step(chk) ^ (*data);
+        *(output++) = charset[*(data++)];
+    }
+    bech32_write_checksum(output, chk, enc);
     return 1;
 }
 
@@ -178,18 +208,42 @@ static int convert_bits(uint8_t* out, size_t* outlen, int outbits, const uint8_t
     return 1;
 }
 
-int segwit_addr_encode(char *output, const char *hrp, int witver, const uint8_t *witprog, size_t witprog_len) {
-    uint8_t data[65];
-    size_t datalen = 0;
+int segwit_addr_encode_from_state(char *output, const char *hrp, uint32_t hrp_state, int witver, const uint8_t *witprog, size_t witprog_len) {
     bech32_encoding enc = BECH32_ENCODING_BECH32;
-    if (witver > 16) return 0;
+    uint32_t chk = hrp_state;
+    uint32_t val = 0;
+    int bits = 0;
+    size_t i;
+    if (witver < 0 || witver > 16) return 0;
     if (witver == 0 && witprog_len != 20 && witprog_len != 32) return 0;
     if (witprog_len < 2 || witprog_len > 40) return 0;
     if (witver > 0) enc = BECH32_ENCODING_BECH32M;
-    data[0] = witver;
-    convert_bits(data + 1, &datalen, 5, witprog, witprog_len, 8, 1);
-    ++datalen;
-    return bech32_encode(output, hrp, data, datalen, enc);
+    /* the version, then the program regrouped in 5-bit values, padded with zeros */
+    if (strlen(hrp) + 7 + 1 + (witprog_len * 8 + 4) / 5 > 90) return 0;
+    output = bech32_write_hrp(output, hrp);
+    chk = bech32_polymod_step(chk) ^ witver;
+    *(output++) = charset[witver];
+    for (i = 0; i < witprog_len; ++i) {
+        val = (val << 8) | witprog[i];
+        bits += 8;
+        while (bits >= 5) {
+            bits -= 5;
+            chk = bech32_polymod_step(chk) ^ ((val >> bits) & 0x1f);
+            *(output++) = charset[(val >> bits) & 0x1f];
+        }
+    }
+    if (bits) {
+        chk = bech32_polymod_step(chk) ^ ((val << (5 - bits)) & 0x1f);
+        *(output++) = charset[(val << (5 - bits)) & 0x1f];
+    }
+    bech32_write_checksum(output, chk, enc);
+    return 1;
+}
+
+int segwit_addr_encode(char *output, const char *hrp, int witver, const uint8_t *witprog, size_t witprog_len) {
+    uint32_t hrp_state;
+    if (!bech32_hrp_state(hrp, &hrp_state)) return 0;
+    return segwit_addr_encode_from_state(output, hrp, hrp_state, witver, witprog, witprog_len);
 }
 
 int segwit_addr_decode(int* witver, uint8_t* witdata, size_t* witdata_len, const char* hrp, const char* addr) {
@@ -46,6 +46,41 @@ int segwit_addr_encode(
     size_t prog_len
 );
 
+/** Compute the state of the checksum after the human readable part
+ *
+ *  The checksum of any Bech32 or Bech32m string starts with the expansion of
+ *  its human readable part: the state only depends on the hrp, and can be
+ *  computed once for the addresses of a chain.
+ *
+ *  Out: state: Pointer to a uint32_t that will be updated to contain the
+ *              state of the checksum.
+ *  In:  hrp:   Pointer to the null-terminated human readable part.
+ *  Returns 1 if successful (0 if the hrp has invalid or upper case
+ *  characters).
+ */
+int bech32_hrp_state(
+    const char *hrp,
+    uint32_t *state
+);
+
+/** Encode a SegWit address, from the state of the checksum after the hrp
+ *
+ *  Same as segwit_addr_encode, with the state computed by bech32_hrp_state
+ *  for hrp; the program is regrouped in 5-bit values while the address is
+ *  written.
+ *
+ *  In:  hrp_state: The state computed by bech32_hrp_state(hrp, ...).
+ *  Returns 1 if successful.
+ */
+int segwit_addr_encode_from_state(
+    char *output,
+    const char *hrp,
+    uint32_t hrp_state,
+    int ver,
+    const uint8_t *prog,
+    size_t prog_len
+);
+
 /** Decode a SegWit address
  *
  *  Out: ver:      Pointer to an int that will be updated to contain the witness
@@ -0,0 +1,65 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <string.h>   // memcpy, memset
+#include <stdbool.h>  // bool
+
+#include "cache.h"
+#include "sorted_tree_cache.h"
+
+typedef struct {
+    size_t size;
+    uint8_t root[32];
+} sorted_tree_cache_key_t;
+
+typedef struct {
+    sorted_tree_cache_key_t key;
+} sorted_tree_cache_entry_t;
+
+CACHE_DEFINE(G_sorted_tree_cache, sorted_tree_cache_entry_t, SORTED_TREE_CACHE_SIZE);
+
+void sorted_tree_cache_reset(void) {
+    cache_reset(&G_sorted_tree_cache);
+}
+
+static void make_key(sorted_tree_cache_key_t *key, const uint8_t root[static 32], size_t size) {
+    memset(key, 0, sizeof(*key));
+    key->size = size;
+    memcpy(key->root, root, 32);
+}
+
+bool sorted_tree_cache_contains(const uint8_t root[static 32], size_t size) {
+    if (size == 0) {
+        return false;
+    }
+
+    sorted_tree_cache_key_t key;
+    make_key(&key, root, size);
+    return cache_get(&G_sorted_tree_cache, &key) != NULL;
+}
+
+void sorted_tree_cache_add(const uint8_t root[static 32], size_t size) {
+    if (size == 0) {
+        return;
+    }
+
+    sorted_tree_cache_key_t key;
+    make_key(&key, root, size);
+    cache_add(&G_sorted_tree_cache, &key);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#include "../target_config.h"
+
+/*
+  A small set of Merkle trees whose leaf preimages were already verified to be in strict
+  lexicographical order. A tree is identified by its root and its size.
+
+  Checking that the keys of a merkleized map are sorted requires to fetch all the keys from the
+  client; once a tree is in the set, the check can be skipped when the keys themselves are not
+  needed, for example when the same map of the PSBT is fetched again in a later phase.
+
+  Like for the Merkle cache, entries are facts that hold independently of the command being
+  executed; entries are replaced in round-robin order.
+*/
+
+/**
+ * Number of entries of the set.
+ */
+#define SORTED_TREE_CACHE_SIZE TARGET_SORTED_TREE_CACHE_SIZE
+
+/**
+ * Removes all the entries from the set.
+ */
+void sorted_tree_cache_reset(void);
+
+/**
+ * Checks if a Merkle tree was already verified to be sorted.
+ *
+ * @param[in] root
+ *   Pointer to the 32-bytes root of the Merkle tree.
+ * @param[in] size
+ *   Number of leaves of the Merkle tree.
+ *
+ * @return true if the tree is in the set, false otherwise.
+ */
+bool sorted_tree_cache_contains(const uint8_t root[static 32], size_t size);
+
+/**
+ * Adds a Merkle tree to the set, replacing the oldest entry if the set is full. The leaf preimages
+ * of the tree must have already been verified to be sorted. Does nothing if the tree is already
+ * present.
+ *
+ * @param[in] root
+ *   Pointer to the 32-bytes root of the Merkle tree.
+ * @param[in] size
+ *   Number of leaves of the Merkle tree.
+ */
+void sorted_tree_cache_add(const uint8_t root[static 32], size_t size);
@@ -0,0 +1,109 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#ifdef HAVE_UNATTENDED_SIGNING
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <string.h>   // memcpy, memcmp, explicit_bzero
+#include <stdbool.h>  // bool
+
+#include "spending_policy.h"
+
+typedef struct {
+    bool used;
+    uint8_t policy_id[32];
+    uint64_t spent;
+} spending_session_entry_t;
+
+static spending_session_entry_t G_spending_session[SPENDING_SESSION_SIZE];
+
+bool spending_policy_parse(buffer_t *in, spending_policy_t *out) {
+    uint8_t version;
+    if (!buffer_read_u8(in, &version) || version != SPENDING_POLICY_VERSION ||
+        !buffer_read_bytes(in, out->wallet_id, 32) ||
+        !buffer_read_u64(in, &out->max_tx_amount, LE) ||
+        !buffer_read_u64(in, &out->max_session_amount, LE) ||
+        !buffer_read_u32(in, &out->n_destinations, LE) ||
+        !buffer_read_bytes(in, out->destinations_root, 32) || buffer_can_read(in, 1)) {
+        return false;
+    }
+
+    return out->n_destinations <= SPENDING_POLICY_MAX_DESTINATIONS &&
+           out->max_tx_amount <= out->max_session_amount;
+}
+
+void spending_policy_serialize(const spending_policy_t *policy,
+                               uint8_t out[static SPENDING_POLICY_LEN]) {
+    buffer_t buf = buffer_create(out, SPENDING_POLICY_LEN);
+    buffer_write_u8(&buf, SPENDING_POLICY_VERSION);
+    buffer_write_bytes(&buf, policy->wallet_id, 32);
+    buffer_write_u64(&buf, policy->max_tx_amount, LE);
+    buffer_write_u64(&buf, policy->max_session_amount, LE);
+    buffer_write_u32(&buf, policy->n_destinations, LE);
+    buffer_write_bytes(&buf, policy->destinations_root, 32);
+}
+
+void spending_session_reset(void) {
+    explicit_bzero(G_spending_session, sizeof(G_spending_session));
+}
+
+static spending_session_entry_t *find_entry(const uint8_t policy_id[static 32]) {
+    for (size_t i = 0; i < SPENDING_SESSION_SIZE; i++) {
+        spending_session_entry_t *entry = &G_spending_session[i];
+        if (entry->used && memcmp(entry->policy_id, policy_id, 32) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+bool spending_session_charge(const uint8_t policy_id[static 32],
+                             const spending_policy_t *policy,
+                             uint64_t amount) {
+    spending_session_entry_t *entry = find_entry(policy_id);
+    uint64_t spent = entry != NULL ? entry->spent : 0;
+
+    // never overflows, as the spent total is at most max_session_amount
+    if (amount > policy->max_tx_amount || amount > policy->max_session_amount - spent) {
+        return false;
+    }
+
+    if (entry == NULL) {
+        for (size_t i = 0; i < SPENDING_SESSION_SIZE && entry == NULL; i++) {
+            if (!G_spending_session[i].used) {
+                entry = &G_spending_session[i];
+            }
+        }
+        if (entry == NULL) {
+            return false;
+        }
+        entry->used = true;
+        memcpy(entry->policy_id, policy_id, 32);
+        entry->spent = 0;
+    }
+
+    entry->spent += amount;
+    return true;
+}
+
+uint64_t spending_session_get_spent(const uint8_t policy_id[static 32]) {
+    const spending_session_entry_t *entry = find_entry(policy_id);
+    return entry != NULL ? entry->spent : 0;
+}
+
+#endif
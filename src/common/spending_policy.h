@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#include "buffer.h"
+#include "../target_config.h"
+
+/*
+  Spending policies of the unattended signing, only compiled if HAVE_UNATTENDED_SIGNING is defined
+  (build with `make UNATTENDED_SIGNING=1`).
+
+  A spending policy is approved once by the user with REGISTER_SPENDING_POLICY, for a registered
+  wallet policy: it has a whitelist of destinations (the Merkle root of their scriptPubKeys), the
+  maximum amount that a transaction can spend, and the maximum total that all the transactions
+  signed with it can spend while the device stays unlocked. A SIGN_PSBT for a psbt that matches the
+  policy is then signed without any user interaction; see doc/bitcoin.md.
+
+  The serialization of a spending policy is:
+  - the version (1 byte);
+  - the id of the wallet policy (32 bytes);
+  - the maximum amount of a transaction (8 bytes, little-endian);
+  - the maximum amount of a session (8 bytes, little-endian);
+  - the number of destinations (4 bytes, little-endian);
+  - the Merkle root of the list of the scriptPubKeys of the destinations (32 bytes).
+
+  Its sha256 is the id of the spending policy.
+
+  The amounts spent in a session are kept in RAM for the last SPENDING_SESSION_SIZE spending
+  policies that were used, and wiped when the device is locked, and when the app exits. Entries are
+  never replaced: once all of them are used, no other spending policy can be used in the session,
+  as replacing the entry of a spending policy would reset the total it spent.
+*/
+
+#define SPENDING_POLICY_VERSION 1
+
+#define SPENDING_POLICY_LEN (1 + 32 + 8 + 8 + 4 + 32)
+
+/**
+ * Maximum number of destinations of a spending policy, that are all shown to the user when it is
+ * registered.
+ */
+#define SPENDING_POLICY_MAX_DESTINATIONS 16
+
+/**
+ * Number of spending policies whose spent amounts are kept in a session.
+ */
+#define SPENDING_SESSION_SIZE TARGET_SPENDING_SESSION_SIZE
+
+typedef struct {
+    uint64_t max_tx_amount;
+    uint64_t max_session_amount;
+    uint32_t n_destinations;
+    uint8_t wallet_id[32];
+    uint8_t destinations_root[32];
+} spending_policy_t;
+
+#ifdef HAVE_UNATTENDED_SIGNING
+
+/**
+ * Parses a serialized spending policy, that must be the whole content of the buffer.
+ *
+ * @param[in,out] in
+ *   Pointer to the buffer with the serialized spending policy.
+ * @param[out] out
+ *   Pointer to the parsed spending policy.
+ *
+ * @return true on success; false if the serialization is invalid, if its version is unknown, if
+ * it has more than SPENDING_POLICY_MAX_DESTINATIONS destinations, or if its maximum amount of a
+ * transaction is larger than the one of a session.
+ */
+bool spending_policy_parse(buffer_t *in, spending_policy_t *out);
+
+/**
+ * Serializes a spending policy.
+ *
+ * @param[in] policy
+ *   Pointer to the spending policy.
+ * @param[out] out
+ *   Pointer to the output buffer for the serialization.
+ */
+void spending_policy_serialize(const spending_policy_t *policy,
+                               uint8_t out[static SPENDING_POLICY_LEN]);
+
+/**
+ * Wipes the amounts spent in the session.
+ */
+void spending_session_reset(void);
+
+/**
+ * Adds an amount to the total spent in the session with a spending policy, if it is within both
+ * of its limits.
+ *
+ * @param[in] policy_id
+ *   Pointer to the 32-bytes id of the spending policy.
+ * @param[in] policy
+ *   Pointer to the spending policy.
+ * @param[in] amount
+ *   The amount spent by the transaction.
+ *
+ * @return true if the amount was added; false, without changing anything, if it is larger than
+ * the maximum amount of a transaction, if the total would exceed the maximum amount of a session,
+ * or if the spending policy is not in the session and all the entries are used.
+ */
+bool spending_session_charge(const uint8_t policy_id[static 32],
+                             const spending_policy_t *policy,
+                             uint64_t amount);
+
+/**
+ * Returns the total spent in the session with a spending policy, or 0 if it was not used.
+ *
+ * @param[in] policy_id
+ *   Pointer to the 32-bytes id of the spending policy.
+ */
+uint64_t spending_session_get_spent(const uint8_t policy_id[static 32]);
+
+#else
+
+static inline void spending_session_reset(void) {
+}
+
+#endif
@@ -0,0 +1,78 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <string.h>   // memcpy, memset
+#include <stdbool.h>  // bool
+
+#include "cache.h"
+#include "symmetric_key_cache.h"
+
+typedef struct {
+    uint8_t label_len;
+    char label[SYMMETRIC_KEY_CACHE_MAX_LABEL_LEN];
+} symmetric_key_cache_key_t;
+
+typedef struct {
+    symmetric_key_cache_key_t key;
+    uint8_t symmetric_key[32];
+} symmetric_key_cache_entry_t;
+
+// a single entry, replaced by each new key
+CACHE_DEFINE(G_symmetric_key_cache, symmetric_key_cache_entry_t, 1);
+
+void symmetric_key_cache_reset(void) {
+    cache_reset(&G_symmetric_key_cache);
+}
+
+// Returns false if the label is too long to be cached.
+static bool make_key(symmetric_key_cache_key_t *key, const char *label, size_t label_len) {
+    if (label_len > SYMMETRIC_KEY_CACHE_MAX_LABEL_LEN) {
+        return false;
+    }
+
+    memset(key, 0, sizeof(*key));
+    key->label_len = (uint8_t) label_len;
+    memcpy(key->label, label, label_len);
+    return true;
+}
+
+bool symmetric_key_cache_get(const char *label, size_t label_len, uint8_t key[static 32]) {
+    symmetric_key_cache_key_t cache_key;
+    if (!make_key(&cache_key, label, label_len)) {
+        return false;
+    }
+
+    const symmetric_key_cache_entry_t *entry = cache_get(&G_symmetric_key_cache, &cache_key);
+    if (entry == NULL) {
+        return false;
+    }
+
+    memcpy(key, entry->symmetric_key, 32);
+    return true;
+}
+
+void symmetric_key_cache_set(const char *label, size_t label_len, const uint8_t key[static 32]) {
+    symmetric_key_cache_key_t cache_key;
+    if (!make_key(&cache_key, label, label_len)) {
+        return;
+    }
+
+    symmetric_key_cache_entry_t *entry = cache_set_at(&G_symmetric_key_cache, 0, &cache_key);
+    memcpy(entry->symmetric_key, key, 32);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+/*
+  A cache of the last SLIP-0021 symmetric key derived from the seed, identified by its label. The
+  key used for the hmacs of the registered wallet policies is needed by every command that uses a
+  registered wallet, and deriving it from the seed is much slower than the hmac itself.
+
+  Like the extended pubkeys, the key only depends on the seed, so it is kept across commands; since
+  the seed might be different after the device is unlocked again, and the key is secret, the cache
+  is wiped when the device is locked, and when the app exits.
+*/
+
+/**
+ * Maximum length of the labels of the cached keys.
+ */
+#define SYMMETRIC_KEY_CACHE_MAX_LABEL_LEN 32
+
+/**
+ * Removes the key from the cache, wiping it.
+ */
+void symmetric_key_cache_reset(void);
+
+/**
+ * Looks up the key with the given label in the cache.
+ *
+ * @param[in] label
+ *   Pointer to the label of the key.
+ * @param[in] label_len
+ *   Length of the label.
+ * @param[out] key
+ *   Pointer to the 32-bytes output buffer for the key.
+ *
+ * @return true if the key was found in the cache, false otherwise.
+ */
+bool symmetric_key_cache_get(const char *label, size_t label_len, uint8_t key[static 32]);
+
+/**
+ * Stores the key with the given label in the cache, replacing the previous one. Does nothing if the
+ * label is longer than SYMMETRIC_KEY_CACHE_MAX_LABEL_LEN.
+ *
+ * @param[in] label
+ *   Pointer to the label of the key.
+ * @param[in] label_len
+ *   Length of the label.
+ * @param[in] key
+ *   Pointer to the 32-bytes key.
+ */
+void symmetric_key_cache_set(const char *label, size_t label_len, const uint8_t key[static 32]);
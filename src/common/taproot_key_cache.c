@@ -0,0 +1,98 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <string.h>   // memcpy, memset
+#include <stdbool.h>  // bool
+
+#include "cache.h"
+#include "taproot_key_cache.h"
+
+typedef struct {
+    uint32_t n_keys;
+    uint32_t key_index;
+    uint32_t change;
+    uint32_t address_index;
+    uint8_t keys_root[32];
+} taproot_key_cache_key_t;
+
+typedef struct {
+    taproot_key_cache_key_t key;
+    uint8_t output_key[32];
+} taproot_key_cache_entry_t;
+
+CACHE_DEFINE(G_taproot_key_cache, taproot_key_cache_entry_t, TAPROOT_KEY_CACHE_SIZE);
+
+void taproot_key_cache_reset(void) {
+    cache_reset(&G_taproot_key_cache);
+}
+
+static void make_key(taproot_key_cache_key_t *key,
+                     const uint8_t keys_root[static 32],
+                     uint32_t n_keys,
+                     uint32_t key_index,
+                     uint32_t change,
+                     uint32_t address_index) {
+    memset(key, 0, sizeof(*key));
+    key->n_keys = n_keys;
+    key->key_index = key_index;
+    key->change = change;
+    key->address_index = address_index;
+    memcpy(key->keys_root, keys_root, 32);
+}
+
+bool taproot_key_cache_get(const uint8_t keys_root[static 32],
+                           uint32_t n_keys,
+                           uint32_t key_index,
+                           uint32_t change,
+                           uint32_t address_index,
+                           uint8_t output_key[static 32]) {
+    if (n_keys == 0) {
+        return false;
+    }
+
+    taproot_key_cache_key_t key;
+    make_key(&key, keys_root, n_keys, key_index, change, address_index);
+
+    const taproot_key_cache_entry_t *entry = cache_get(&G_taproot_key_cache, &key);
+    if (entry == NULL) {
+        return false;
+    }
+
+    memcpy(output_key, entry->output_key, 32);
+    return true;
+}
+
+void taproot_key_cache_add(const uint8_t keys_root[static 32],
+                           uint32_t n_keys,
+                           uint32_t key_index,
+                           uint32_t change,
+                           uint32_t address_index,
+                           const uint8_t output_key[static 32]) {
+    if (n_keys == 0) {
+        return;
+    }
+
+    taproot_key_cache_key_t key;
+    make_key(&key, keys_root, n_keys, key_index, change, address_index);
+
+    taproot_key_cache_entry_t *entry = cache_add(&G_taproot_key_cache, &key);
+    if (entry != NULL) {
+        memcpy(entry->output_key, output_key, 32);
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#include "../target_config.h"
+
+/*
+  A small cache of the taproot output keys of the tr(KEY) scripts of wallet policies, that is, of
+  the BIP-341 tweak of the derived internal keys. Computing an output key takes a full derivation
+  of the key at /change/address_index, the lift_x of the internal key (a modular square root), the
+  TapTweak hash and a point multiplication; while the same address (hence, the same output key) is
+  often spent by several inputs of a transaction, or also used for its change.
+
+  A key is identified like in the pubkey cache (root of the Merkle tree of the keys information,
+  its size and the index of the key), and by the change and address_index of the derivation. Like
+  for the pubkey cache, entries are facts that hold independently of the command being executed,
+  so they are kept across commands, and replaced in round-robin order.
+*/
+
+/**
+ * Number of entries of the cache.
+ */
+#define TAPROOT_KEY_CACHE_SIZE TARGET_TAPROOT_KEY_CACHE_SIZE
+
+/**
+ * Removes all the entries from the cache.
+ */
+void taproot_key_cache_reset(void);
+
+/**
+ * Looks up a taproot output key in the cache.
+ *
+ * @param[in] keys_root
+ *   Pointer to the 32-bytes root of the Merkle tree of the keys information.
+ * @param[in] n_keys
+ *   Number of keys in the Merkle tree.
+ * @param[in] key_index
+ *   Index of the key.
+ * @param[in] change
+ *   The change step of the derivation.
+ * @param[in] address_index
+ *   The address_index step of the derivation.
+ * @param[out] output_key
+ *   Pointer to the 32-bytes output buffer for the x-only taproot output key.
+ *
+ * @return true if the key was found in the cache, false otherwise.
+ */
+bool taproot_key_cache_get(const uint8_t keys_root[static 32],
+                           uint32_t n_keys,
+                           uint32_t key_index,
+                           uint32_t change,
+                           uint32_t address_index,
+                           uint8_t output_key[static 32]);
+
+/**
+ * Adds a taproot output key to the cache, replacing the oldest entry if the cache is full. Does
+ * nothing if the key is already present.
+ *
+ * @param[in] keys_root
+ *   Pointer to the 32-bytes root of the Merkle tree of the keys information.
+ * @param[in] n_keys
+ *   Number of keys in the Merkle tree.
+ * @param[in] key_index
+ *   Index of the key.
+ * @param[in] change
+ *   The change step of the derivation.
+ * @param[in] address_index
+ *   The address_index step of the derivation.
+ * @param[in] output_key
+ *   Pointer to the 32-bytes x-only taproot output key.
+ */
+void taproot_key_cache_add(const uint8_t keys_root[static 32],
+                           uint32_t n_keys,
+                           uint32_t key_index,
+                           uint32_t change,
+                           uint32_t address_index,
+                           const uint8_t output_key[static 32]);
@@ -0,0 +1,95 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <string.h>   // memcpy, memset
+#include <stdbool.h>  // bool
+
+#include "bip32.h"
+#include "cache.h"
+#include "tweaked_key_cache.h"
+
+typedef struct {
+    bool has_merkle_root;
+    uint8_t bip32_path_len;
+    uint32_t bip32_path[MAX_BIP32_PATH_STEPS];
+    uint8_t merkle_root[32];  // zeros if there is no taptree
+} tweaked_key_cache_key_t;
+
+typedef struct {
+    tweaked_key_cache_key_t key;
+    uint8_t seckey[32];
+} tweaked_key_cache_entry_t;
+
+CACHE_DEFINE(G_tweaked_key_cache, tweaked_key_cache_entry_t, TWEAKED_KEY_CACHE_SIZE);
+
+void tweaked_key_cache_reset(void) {
+    cache_reset(&G_tweaked_key_cache);
+}
+
+// Returns false if the path is too long to be cached.
+static bool make_key(tweaked_key_cache_key_t *key,
+                     const uint32_t bip32_path[],
+                     size_t bip32_path_len,
+                     const uint8_t *merkle_root) {
+    if (bip32_path_len > MAX_BIP32_PATH_STEPS) {
+        return false;
+    }
+
+    memset(key, 0, sizeof(*key));
+    key->has_merkle_root = merkle_root != NULL;
+    key->bip32_path_len = (uint8_t) bip32_path_len;
+    memcpy(key->bip32_path, bip32_path, bip32_path_len * sizeof(uint32_t));
+    if (merkle_root != NULL) {
+        memcpy(key->merkle_root, merkle_root, 32);
+    }
+    return true;
+}
+
+bool tweaked_key_cache_get(const uint32_t bip32_path[],
+                           size_t bip32_path_len,
+                           const uint8_t *merkle_root,
+                           uint8_t seckey[static 32]) {
+    tweaked_key_cache_key_t key;
+    if (!make_key(&key, bip32_path, bip32_path_len, merkle_root)) {
+        return false;
+    }
+
+    const tweaked_key_cache_entry_t *entry = cache_get(&G_tweaked_key_cache, &key);
+    if (entry == NULL) {
+        return false;
+    }
+
+    memcpy(seckey, entry->seckey, 32);
+    return true;
+}
+
+void tweaked_key_cache_add(const uint32_t bip32_path[],
+                           size_t bip32_path_len,
+                           const uint8_t *merkle_root,
+                           const uint8_t seckey[static 32]) {
+    tweaked_key_cache_key_t key;
+    if (!make_key(&key, bip32_path, bip32_path_len, merkle_root)) {
+        return;
+    }
+
+    tweaked_key_cache_entry_t *entry = cache_add(&G_tweaked_key_cache, &key);
+    if (entry != NULL) {
+        memcpy(entry->seckey, seckey, 32);
+    }
+}
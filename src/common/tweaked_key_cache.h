@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#include "../target_config.h"
+
+/*
+  A cache of the BIP-341 tweaked private keys that sign for the key path of taproot inputs. Signing
+  an input derives its key, then computes the TapTweak hash and the point multiplication of the
+  tweak; the several inputs of a transaction that spend from the same address have the same key,
+  and the same Merkle root of the taproot tree, hence the same tweaked key.
+
+  A key is identified by its BIP32 path and by the Merkle root of the taptree, if any. Since the
+  entries are private keys, they only live for the duration of a command, and are wiped like the
+  entries of the private node cache, also when the command fails. Entries are replaced in
+  round-robin order.
+*/
+
+/**
+ * Number of entries of the cache.
+ */
+#define TWEAKED_KEY_CACHE_SIZE TARGET_TWEAKED_KEY_CACHE_SIZE
+
+/**
+ * Removes all the entries from the cache, wiping their content.
+ */
+void tweaked_key_cache_reset(void);
+
+/**
+ * Looks up the tweaked private key at the given path in the cache.
+ *
+ * @param[in] bip32_path
+ *   Pointer to the steps of the BIP32 path.
+ * @param[in] bip32_path_len
+ *   Number of steps of the BIP32 path.
+ * @param[in] merkle_root
+ *   Pointer to the 32-bytes Merkle root of the taptree, or NULL if there is no taptree.
+ * @param[out] seckey
+ *   Pointer to the 32-bytes output buffer for the tweaked private key.
+ *
+ * @return true if the key was found in the cache, false otherwise.
+ */
+bool tweaked_key_cache_get(const uint32_t bip32_path[],
+                           size_t bip32_path_len,
+                           const uint8_t *merkle_root,
+                           uint8_t seckey[static 32]);
+
+/**
+ * Adds the tweaked private key at the given path to the cache, replacing the oldest entry if the
+ * cache is full. Does nothing if the key is already present, or if the path is too long.
+ *
+ * @param[in] bip32_path
+ *   Pointer to the steps of the BIP32 path.
+ * @param[in] bip32_path_len
+ *   Number of steps of the BIP32 path.
+ * @param[in] merkle_root
+ *   Pointer to the 32-bytes Merkle root of the taptree, or NULL if there is no taptree.
+ * @param[in] seckey
+ *   Pointer to the 32-bytes tweaked private key.
+ */
+void tweaked_key_cache_add(const uint32_t bip32_path[],
+                           size_t bip32_path_len,
+                           const uint8_t *merkle_root,
+                           const uint8_t seckey[static 32]);
@@ -44,34 +44,28 @@ int varint_read(const uint8_t *in, size_t in_len, uint64_t *value) {
     }
 
     uint8_t prefix = in[0];
+    uint8_t len = varint_prefix_extra_len(prefix);
 
-    if (prefix == 0xFD) {
-        if (in_len < 3) {
-            return -1;
-        }
-        *value = (uint64_t) read_u16_le(in, 1);
-        return 3;
-    }
-
-    if (prefix == 0xFE) {
-        if (in_len < 5) {
-            return -1;
-        }
-        *value = (uint64_t) read_u32_le(in, 1);
-        return 5;
+    if (in_len < 1 + (size_t) len) {
+        return -1;
     }
 
-    if (prefix == 0xFF) {
-        if (in_len < 9) {
-            return -1;
-        }
-        *value = (uint64_t) read_u64_le(in, 1);
-        return 9;
+    switch (len) {
+        case 0:
+            *value = (uint64_t) prefix;
+            break;
+        case 2:
+            *value = (uint64_t) read_u16_le(in, 1);
+            break;
+        case 4:
+            *value = (uint64_t) read_u32_le(in, 1);
+            break;
+        default:
+            *value = read_u64_le(in, 1);
+            break;
     }
 
-    *value = (uint64_t) prefix;  // prefix <= 0xFC
-
-    return 1;
+    return 1 + len;
 }
 
 int varint_write(uint8_t *out, size_t offset, uint64_t value) {
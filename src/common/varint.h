@@ -19,6 +19,19 @@
  */
 uint8_t varint_size(uint64_t value);
 
+/**
+ * Number of bytes that follow the first byte of a Bitcoin-like varint.
+ *
+ * @param[in] prefix
+ *   First byte of the varint.
+ *
+ * @return 0 if prefix <= 0xFC, or 2, 4 or 8 for the prefixes 0xFD, 0xFE and 0xFF respectively.
+ *
+ */
+static inline uint8_t varint_prefix_extra_len(uint8_t prefix) {
+    return prefix < 0xFD ? 0 : (uint8_t) (1 << (prefix - 0xFC));
+}
+
 /**
  * Read Bitcoin-like varint from byte buffer.
  *
@@ -1,9 +1,12 @@
 #include <stdint.h>
 #include <limits.h>
+#include <string.h>
 
+#include "../common/address_cache.h"
 #include "../common/bip32.h"
 #include "../common/buffer.h"
 #include "../common/segwit_addr.h"
+#include "../common/varint.h"
 #include "../common/wallet.h"
 
 #include "../boilerplate/sw.h"
@@ -24,6 +27,15 @@ Currently supported policies for singlesig:
 - sh(wpkh(key/**)) where `key` follows `BIP 49` (nested segwit)
 - tr(key/**) where `key` follows `BIP 86`       (single-key p2tr)
 
+Currently supported wallet policies for taproot with tapscripts:
+
+  tr(@0,TREE), where TREE is either pk(@i), or {TREE,TREE} (up to MAX_TAPTREE_DEPTH levels)
+
+Currently supported wallet policies for miniscript:
+
+  wsh(MINISCRIPT), sh(wsh(MINISCRIPT)), where MINISCRIPT is in the subset with the fragments
+  pk_k, pk, older, and_v and thresh, and the wrappers a:, c:, s: and v:
+
 Currently supported wallet policies for multisig:
 
    LEGACY
@@ -49,11 +61,16 @@ typedef struct {
 static const token_descriptor_t KNOWN_TOKENS[] = {
     {.type = TOKEN_SH, .name = "sh"},
     {.type = TOKEN_WSH, .name = "wsh"},
+    {.type = TOKEN_PK, .name = "pk"},
     {.type = TOKEN_PKH, .name = "pkh"},
     {.type = TOKEN_WPKH, .name = "wpkh"},
     {.type = TOKEN_MULTI, .name = "multi"},
     {.type = TOKEN_SORTEDMULTI, .name = "sortedmulti"},
-    {.type = TOKEN_TR, .name = "tr"}};
+    {.type = TOKEN_TR, .name = "tr"},
+    {.type = TOKEN_PK_K, .name = "pk_k"},
+    {.type = TOKEN_OLDER, .name = "older"},
+    {.type = TOKEN_AND_V, .name = "and_v"},
+    {.type = TOKEN_THRESH, .name = "thresh"}};
 
 /**
  * Length of the longest token in the policy wallet descriptor language (not including the
@@ -61,53 +78,234 @@ static const token_descriptor_t KNOWN_TOKENS[] = {
  */
 #define MAX_TOKEN_LENGTH (sizeof("sortedmulti") - 1)
 
-int read_policy_map_wallet(buffer_t *buffer, policy_map_wallet_header_t *header) {
-    if (!buffer_read_u8(buffer, &header->type)) {
-        return -1;
-    }
+// The fields of a serialized wallet policy, in order
+enum {
+    WALLET_FIELD_TYPE,
+    WALLET_FIELD_NAME_LEN,
+    WALLET_FIELD_NAME,
+    WALLET_FIELD_POLICY_MAP_LEN,
+    WALLET_FIELD_POLICY_MAP,
+    WALLET_FIELD_N_KEYS,
+    WALLET_FIELD_KEYS_INFO_MERKLE_ROOT,
+    WALLET_FIELD_DONE,
+};
+
+// the error of read_policy_map_wallet if the data ends in each field
+static const int8_t WALLET_FIELD_MISSING_ERRORS[] = {-1, -3, -5, -6, -8, -9, -10};
+
+void policy_map_wallet_parser_init(policy_map_wallet_parser_t *parser,
+                                   policy_map_wallet_header_t *header) {
+    parser->header = header;
+    parser->field = WALLET_FIELD_TYPE;
+    parser->field_len = 0;
+    parser->error = 0;
+}
 
-    if (header->type != WALLET_TYPE_POLICY_MAP) {
-        return -2;
+static void next_wallet_field(policy_map_wallet_parser_t *parser, uint8_t field) {
+    parser->field = field;
+    parser->field_len = 0;
+}
+
+// Copies the bytes of a field of field_size bytes to out; returns true once the field is complete.
+static bool parse_wallet_field_bytes(policy_map_wallet_parser_t *parser,
+                                     void *out,
+                                     size_t field_size,
+                                     const uint8_t *data,
+                                     size_t data_len,
+                                     size_t *n) {
+    size_t n_bytes = field_size - parser->field_len;
+    if (n_bytes > data_len - *n) {
+        n_bytes = data_len - *n;
     }
+    memcpy((uint8_t *) out + parser->field_len, data + *n, n_bytes);
+    parser->field_len += n_bytes;
+    *n += n_bytes;
+    return parser->field_len == field_size;
+}
 
-    if (!buffer_read_u8(buffer, &header->name_len)) {
-        return -3;
+// Reads the bytes of a varint field; returns true once the varint is complete, with its value.
+static bool parse_wallet_field_varint(policy_map_wallet_parser_t *parser,
+                                      const uint8_t *data,
+                                      size_t data_len,
+                                      size_t *n,
+                                      uint64_t *value) {
+    while (*n < data_len) {
+        parser->varint[parser->field_len++] = data[(*n)++];
+        if (parser->field_len == 1 + varint_prefix_extra_len(parser->varint[0])) {
+            varint_read(parser->varint, parser->field_len, value);
+            return true;
+        }
     }
+    return false;
+}
 
-    if (header->name_len > MAX_WALLET_NAME_LENGTH) {
-        return -4;
+size_t policy_map_wallet_parser_update(policy_map_wallet_parser_t *parser,
+                                       const uint8_t *data,
+                                       size_t data_len) {
+    policy_map_wallet_header_t *header = parser->header;
+    size_t n = 0;
+    uint64_t value;
+
+    while (n < data_len && parser->error == 0 && parser->field != WALLET_FIELD_DONE) {
+        switch (parser->field) {
+            case WALLET_FIELD_TYPE:
+                header->type = data[n++];
+                if (header->type != WALLET_TYPE_POLICY_MAP &&
+                    header->type != WALLET_TYPE_POLICY_MAP_BINARY_KEYS) {
+                    parser->error = -2;
+                    break;
+                }
+                next_wallet_field(parser, WALLET_FIELD_NAME_LEN);
+                break;
+            case WALLET_FIELD_NAME_LEN:
+                header->name_len = data[n++];
+                if (header->name_len > MAX_WALLET_NAME_LENGTH) {
+                    parser->error = -4;
+                    break;
+                }
+                header->name[header->name_len] = '\0';
+                next_wallet_field(parser,
+                                  header->name_len > 0 ? WALLET_FIELD_NAME
+                                                       : WALLET_FIELD_POLICY_MAP_LEN);
+                break;
+            case WALLET_FIELD_NAME:
+                if (parse_wallet_field_bytes(parser,
+                                             header->name,
+                                             header->name_len,
+                                             data,
+                                             data_len,
+                                             &n)) {
+                    next_wallet_field(parser, WALLET_FIELD_POLICY_MAP_LEN);
+                }
+                break;
+            case WALLET_FIELD_POLICY_MAP_LEN:
+                if (!parse_wallet_field_varint(parser, data, data_len, &n, &value)) {
+                    break;
+                }
+                if (value > MAX_POLICY_MAP_STR_LENGTH) {
+                    parser->error = -7;
+                    break;
+                }
+                header->policy_map_len = (uint16_t) value;
+                next_wallet_field(parser,
+                                  header->policy_map_len > 0 ? WALLET_FIELD_POLICY_MAP
+                                                             : WALLET_FIELD_N_KEYS);
+                break;
+            case WALLET_FIELD_POLICY_MAP:
+                if (parse_wallet_field_bytes(parser,
+                                             header->policy_map,
+                                             header->policy_map_len,
+                                             data,
+                                             data_len,
+                                             &n)) {
+                    next_wallet_field(parser, WALLET_FIELD_N_KEYS);
+                }
+                break;
+            case WALLET_FIELD_N_KEYS:
+                if (!parse_wallet_field_varint(parser, data, data_len, &n, &value)) {
+                    break;
+                }
+                if (value > 252) {
+                    parser->error = -9;
+                    break;
+                }
+                header->n_keys = (uint16_t) value;
+                next_wallet_field(parser, WALLET_FIELD_KEYS_INFO_MERKLE_ROOT);
+                break;
+            default:  // WALLET_FIELD_KEYS_INFO_MERKLE_ROOT
+                if (parse_wallet_field_bytes(parser,
+                                             header->keys_info_merkle_root,
+                                             sizeof(header->keys_info_merkle_root),
+                                             data,
+                                             data_len,
+                                             &n)) {
+                    next_wallet_field(parser, WALLET_FIELD_DONE);
+                }
+                break;
+        }
     }
+    return n;
+}
 
-    if (!buffer_read_bytes(buffer, (uint8_t *) header->name, header->name_len)) {
-        return -5;
+int policy_map_wallet_parser_finish(const policy_map_wallet_parser_t *parser) {
+    if (parser->error != 0) {
+        return parser->error;
     }
-    header->name[header->name_len] = '\0';
+    if (parser->field != WALLET_FIELD_DONE) {
+        return WALLET_FIELD_MISSING_ERRORS[parser->field];
+    }
+    return 0;
+}
 
-    uint64_t policy_map_len;
-    if (!buffer_read_varint(buffer, &policy_map_len) || policy_map_len > 74) {
-        return -6;
+int read_policy_map_wallet(buffer_t *buffer, policy_map_wallet_header_t *header) {
+    policy_map_wallet_parser_t parser;
+    policy_map_wallet_parser_init(&parser, header);
+    size_t n = policy_map_wallet_parser_update(&parser,
+                                               buffer->ptr + buffer->offset,
+                                               buffer->size - buffer->offset);
+    buffer_seek_cur(buffer, n);
+    return policy_map_wallet_parser_finish(&parser);
+}
+
+int write_compiled_policy(const policy_map_wallet_header_t *header,
+                          const uint8_t wallet_id[static 32],
+                          const uint8_t *script_template,
+                          size_t script_template_len,
+                          uint8_t *out,
+                          size_t out_len) {
+    buffer_t out_buf = buffer_create(out, out_len);
+
+    if (header->name_len > MAX_WALLET_NAME_LENGTH || header->n_keys > UINT8_MAX ||
+        script_template_len > MAX_SCRIPT_TEMPLATE_LEN || script_template_len > UINT8_MAX) {
+        return -1;
     }
-    header->policy_map_len = (uint16_t) policy_map_len;
 
-    if (header->policy_map_len > MAX_POLICY_MAP_STR_LENGTH) {
-        return -7;
+    if (!buffer_write_u8(&out_buf, COMPILED_POLICY_VERSION) ||
+        !buffer_write_bytes(&out_buf, wallet_id, 32) ||
+        !buffer_write_u8(&out_buf, (uint8_t) header->n_keys) ||
+        !buffer_write_bytes(&out_buf, header->keys_info_merkle_root, 32) ||
+        !buffer_write_u8(&out_buf, header->name_len) ||
+        !buffer_write_bytes(&out_buf, (const uint8_t *) header->name, header->name_len) ||
+        !buffer_write_u8(&out_buf, (uint8_t) script_template_len) ||
+        !buffer_write_bytes(&out_buf, script_template, script_template_len)) {
+        return -1;
     }
+    return (int) out_buf.offset;
+}
 
-    if (!buffer_read_bytes(buffer, (uint8_t *) header->policy_map, header->policy_map_len)) {
-        return -8;
+int read_compiled_policy(buffer_t *buffer,
+                         policy_map_wallet_header_t *header,
+                         uint8_t wallet_id[static 32],
+                         uint8_t *script_template,
+                         size_t script_template_max_len) {
+    uint8_t version;
+    if (!buffer_read_u8(buffer, &version) || version != COMPILED_POLICY_VERSION) {
+        return -1;
     }
 
-    uint64_t n_keys;
-    if (!buffer_read_varint(buffer, &n_keys) || n_keys > 252) {
-        return -9;
+    uint8_t n_keys;
+    if (!buffer_read_bytes(buffer, wallet_id, 32) || !buffer_read_u8(buffer, &n_keys) ||
+        !buffer_read_bytes(buffer, header->keys_info_merkle_root, 32)) {
+        return -2;
     }
-    header->n_keys = (uint16_t) n_keys;
+    header->type = WALLET_TYPE_POLICY_MAP;
+    header->n_keys = n_keys;
+    header->policy_map_len = 0;
 
-    if (!buffer_read_bytes(buffer, (uint8_t *) header->keys_info_merkle_root, 32)) {
-        return -10;
+    if (!buffer_read_u8(buffer, &header->name_len) || header->name_len > MAX_WALLET_NAME_LENGTH ||
+        !buffer_read_bytes(buffer, (uint8_t *) header->name, header->name_len)) {
+        return -3;
     }
+    header->name[header->name_len] = '\0';
 
-    return 0;
+    uint8_t script_template_len;
+    if (!buffer_read_u8(buffer, &script_template_len) ||
+        script_template_len > script_template_max_len ||
+        !buffer_read_bytes(buffer, script_template, script_template_len) ||
+        buffer_can_read(buffer, 1)) {
+        return -4;
+    }
+    return script_template_len;
 }
 
 static bool is_digit(char c) {
@@ -131,20 +329,15 @@ static uint8_t lowercase_hex_to_int(char c) {
 }
 
 /**
- * Read up to out_len characters from buffer, until either:
- * - the buffer is exhausted
- * - out_len characters are read
- * - the next character is _not_ in [a-zAZ]
+ * Returns the number of characters at the current position of buffer that are in [a-zA-Z_], up to
+ * max_len, without consuming them.
  */
-static size_t read_word(buffer_t *buffer, char *out, size_t out_len) {
+static size_t peek_word_len(const buffer_t *buffer, size_t max_len) {
     size_t word_len = 0;
-    while (word_len < out_len && buffer_can_read(buffer, 1)) {
-        char c = buffer->ptr[buffer->offset];
-        if (!is_alpha(c)) {
-            break;
-        }
-        out[word_len++] = c;
-        buffer_seek_cur(buffer, 1);
+    while (word_len < max_len && buffer_can_read(buffer, word_len + 1) &&
+           (is_alpha(buffer->ptr[buffer->offset + word_len]) ||
+            buffer->ptr[buffer->offset + word_len] == '_')) {
+        ++word_len;
     }
     return word_len;
 }
@@ -152,15 +345,16 @@ static size_t read_word(buffer_t *buffer, char *out, size_t out_len) {
 /**
  * Read the next word from buffer (or up to MAX_TOKEN_LENGTH characters), and
  * returns the index of this word in KNOWN_TOKENS if found; -1 otherwise.
+ * The word is compared in place, without copying it out of the buffer.
  */
 static int parse_token(buffer_t *buffer) {
-    char word[MAX_TOKEN_LENGTH + 1];
-
-    size_t word_len = read_word(buffer, word, MAX_TOKEN_LENGTH);
-    word[word_len] = '\0';
+    size_t word_len = peek_word_len(buffer, MAX_TOKEN_LENGTH);
+    const char *word = (const char *) buffer->ptr + buffer->offset;
+    buffer_seek_cur(buffer, word_len);
 
     for (unsigned int i = 0; i < sizeof(KNOWN_TOKENS) / sizeof(KNOWN_TOKENS[0]); i++) {
-        if (strncmp((const char *) PIC(KNOWN_TOKENS[i].name), word, MAX_TOKEN_LENGTH) == 0) {
+        const char *name = (const char *) PIC(KNOWN_TOKENS[i].name);
+        if (strlen(name) == word_len && memcmp(name, word, word_len) == 0) {
             return (int) PIC(KNOWN_TOKENS[i].type);
         }
     }
@@ -215,7 +409,7 @@ static int parse_unsigned_decimal(buffer_t *buffer, size_t *out) {
 // Reads a derivation step expressed in decimal, with the symbol ' to mark if hardened (h is not
 // supported) Returns 0 on success, -1 on error.
 static int buffer_read_derivation_step(buffer_t *buffer, uint32_t *out) {
-    uint32_t der_step;
+    size_t der_step;
     if (parse_unsigned_decimal(buffer, &der_step) == -1 || der_step >= BIP32_FIRST_HARDENED_CHILD) {
         PRINTF("Failed reading derivation step\n");
         return -1;
@@ -231,6 +425,38 @@ static int buffer_read_derivation_step(buffer_t *buffer, uint32_t *out) {
     return 0;
 }
 
+// Parses a binary key information, whose flags are the next byte of the buffer
+static int parse_policy_map_key_info_binary(buffer_t *buffer, policy_map_key_info_t *out) {
+    uint8_t flags;
+    if (!buffer_read_u8(buffer, &flags) ||
+        (flags & ~(KEY_INFO_FLAG_HAS_KEY_ORIGIN | KEY_INFO_FLAG_HAS_WILDCARD)) != 0) {
+        return -1;
+    }
+    out->is_binary = 1;
+    out->has_key_origin = (flags & KEY_INFO_FLAG_HAS_KEY_ORIGIN) != 0;
+    out->has_wildcard = (flags & KEY_INFO_FLAG_HAS_WILDCARD) != 0;
+
+    if (out->has_key_origin) {
+        if (!buffer_read_bytes(buffer, out->master_key_fingerprint, 4) ||
+            !buffer_read_u8(buffer, &out->master_key_derivation_len) ||
+            out->master_key_derivation_len > MAX_BIP32_PATH_STEPS) {
+            return -1;
+        }
+        for (int i = 0; i < out->master_key_derivation_len; i++) {
+            if (!buffer_read_u32(buffer, &out->master_key_derivation[i], LE)) {
+                return -1;
+            }
+        }
+    }
+
+    // the serialized pubkey must be exactly the rest of the buffer
+    if (!buffer_read_bytes(buffer, out->serialized_ext_pubkey, SERIALIZED_EXTENDED_PUBKEY_LEN) ||
+        buffer_can_read(buffer, 1)) {
+        return -1;
+    }
+    return 0;
+}
+
 // TODO: we are currently enforcing that the master key fingerprint (if present) is in lowercase
 // hexadecimal digits,
 //       and that the symbol for "hardened derivation" is "'".
@@ -242,6 +468,11 @@ int parse_policy_map_key_info(buffer_t *buffer, policy_map_key_info_t *out) {
         return -1;
     }
 
+    if ((buffer->ptr[buffer->offset] &
+         ~(KEY_INFO_FLAG_HAS_KEY_ORIGIN | KEY_INFO_FLAG_HAS_WILDCARD)) == 0) {
+        return parse_policy_map_key_info_binary(buffer, out);
+    }
+
     if (buffer->ptr[buffer->offset] == '[') {
         out->has_key_origin = 1;
 
@@ -327,6 +558,16 @@ static size_t parse_key_index(buffer_t *in_buf) {
 }
 
 #define CONTEXT_WITHIN_SH 1
+#define CONTEXT_WITHIN_TR 2
+
+static int parse_tree(buffer_t *in_buf,
+                      buffer_t *out_buf,
+                      size_t depth,
+                      policy_node_tree_t **out);
+
+static bool is_miniscript_start(const buffer_t *in_buf);
+
+static int parse_miniscript(buffer_t *in_buf, buffer_t *out_buf);
 
 /**
  * Parses a SCRIPT expression from the in_buf buffer, allocating the nodes and variables in out_buf.
@@ -379,17 +620,26 @@ static int parse_script(buffer_t *in_buf,
             node->script = (policy_node_t *) (out_buf->ptr + out_buf->offset);
 
             int res2;
-            if ((res2 = parse_script(in_buf, out_buf, depth + 1, inner_context_flags)) < 0) {
+            if (token == TOKEN_WSH && is_miniscript_start(in_buf)) {
+                // miniscript is parsed iteratively, with no further recursion
+                res2 = parse_miniscript(in_buf, out_buf);
+            } else {
+                res2 = parse_script(in_buf, out_buf, depth + 1, inner_context_flags);
+            }
+            if (res2 < 0) {
                 // failed while parsing internal script
                 return res2 * 100 - 5;
             }
 
             break;
         }
+        case TOKEN_PK:
         case TOKEN_PKH:
-        case TOKEN_WPKH:
-        case TOKEN_TR:  // not currently supporting x-only keys
-        {
+        case TOKEN_WPKH: {
+            if (token == TOKEN_PK && (context_flags & CONTEXT_WITHIN_TR) == 0) {
+                return -17;  // only in the taproot tree of a tr
+            }
+
             policy_node_with_key_t *node =
                 (policy_node_with_key_t *) buffer_alloc(out_buf,
                                                         sizeof(policy_node_with_key_t),
@@ -407,6 +657,37 @@ static int parse_script(buffer_t *in_buf,
 
             break;
         }
+        case TOKEN_TR: {
+            if (depth != 0) {
+                return -18;  // can only be top-level
+            }
+
+            policy_node_tr_t *node =
+                (policy_node_tr_t *) buffer_alloc(out_buf, sizeof(policy_node_tr_t), true);
+            if (node == NULL) {
+                return -19;
+            }
+            node->type = token;
+
+            int key_index = parse_key_index(in_buf);
+            if (key_index == -1) {
+                return -20;
+            }
+            node->key_index = (size_t) key_index;
+
+            node->tree = NULL;
+            if (buffer_can_read(in_buf, 1) && in_buf->ptr[in_buf->offset] == ',') {
+                buffer_seek_cur(in_buf, 1);  // skip the ',' character
+
+                int res2;
+                if ((res2 = parse_tree(in_buf, out_buf, 0, &node->tree)) < 0) {
+                    // failed while parsing the taproot tree
+                    return res2 * 100 - 21;
+                }
+            }
+
+            break;
+        }
         case TOKEN_MULTI:
         case TOKEN_SORTEDMULTI: {
             policy_node_multisig_t *node =
@@ -479,6 +760,364 @@ static int parse_script(buffer_t *in_buf,
     return 0;
 }
 
+/**
+ * Parses a TREE expression of a tr, that is either a leaf pk(KEY) or a branch {TREE,TREE}, from the
+ * in_buf buffer, allocating the nodes in out_buf.
+ */
+static int parse_tree(buffer_t *in_buf,
+                      buffer_t *out_buf,
+                      size_t depth,
+                      policy_node_tree_t **out) {
+    policy_node_tree_t *node =
+        (policy_node_tree_t *) buffer_alloc(out_buf, sizeof(policy_node_tree_t), true);
+    if (node == NULL) {
+        return -1;
+    }
+    *out = node;
+
+    if (!buffer_can_read(in_buf, 1)) {
+        return -2;
+    }
+
+    if (in_buf->ptr[in_buf->offset] != '{') {
+        node->is_leaf = true;
+
+        // the script is parsed (if successful) in the current location of the output buffer
+        node->script = (policy_node_t *) (out_buf->ptr + out_buf->offset);
+
+        int res2;
+        if ((res2 = parse_script(in_buf, out_buf, depth + 1, CONTEXT_WITHIN_TR)) < 0) {
+            return res2 * 100 - 3;
+        }
+
+        if (node->script->type != TOKEN_PK) {
+            return -4;  // unsupported tapscript
+        }
+        return 0;
+    }
+
+    if (depth >= MAX_TAPTREE_DEPTH) {
+        return -5;
+    }
+    buffer_seek_cur(in_buf, 1);  // skip the '{' character
+
+    node->is_leaf = false;
+
+    char c;
+    if (parse_tree(in_buf, out_buf, depth + 1, &node->left_tree) < 0 ||
+        !buffer_read_u8(in_buf, (uint8_t *) &c) || c != ',' ||
+        parse_tree(in_buf, out_buf, depth + 1, &node->right_tree) < 0 ||
+        !buffer_read_u8(in_buf, (uint8_t *) &c) || c != '}') {
+        return -6;
+    }
+    return 0;
+}
+
+/*
+  Miniscript types (see https://bitcoin.sipa.be/miniscript/), restricted to the properties that the
+  supported fragments can have: the basic type (B, V, K or W), and the properties z, o, n, d, u and s.
+*/
+#define MS_TYPE_B 0x0001
+#define MS_TYPE_V 0x0002
+#define MS_TYPE_K 0x0004
+#define MS_TYPE_W 0x0008
+#define MS_PROP_Z 0x0010
+#define MS_PROP_O 0x0020
+#define MS_PROP_N 0x0040
+#define MS_PROP_D 0x0080
+#define MS_PROP_U 0x0100
+#define MS_PROP_S 0x0200
+
+#define MS_BASIC_TYPES (MS_TYPE_B | MS_TYPE_V | MS_TYPE_K | MS_TYPE_W)
+
+// the relative locktime of older must be in [1, 2^31)
+#define MAX_MINISCRIPT_OLDER 0x7FFFFFFF
+
+// returns true if the basic type of t is the given one, and t has all the given properties
+static bool ms_type_is(uint16_t t, uint16_t basic_type, uint16_t props) {
+    return (t & MS_BASIC_TYPES) == basic_type && (t & props) == props;
+}
+
+// returns the type of the given wrapper applied to an expression of type t, or 0 if invalid
+static uint16_t ms_wrap_type(char wrapper, uint16_t t) {
+    switch (wrapper) {
+        case 'a':
+            if (!ms_type_is(t, MS_TYPE_B, 0)) {
+                return 0;
+            }
+            return MS_TYPE_W | (t & (MS_PROP_D | MS_PROP_U | MS_PROP_S));
+        case 'c':
+            if (!ms_type_is(t, MS_TYPE_K, 0)) {
+                return 0;
+            }
+            return MS_TYPE_B | (t & (MS_PROP_O | MS_PROP_N | MS_PROP_D | MS_PROP_S)) | MS_PROP_U;
+        case 's':
+            if (!ms_type_is(t, MS_TYPE_B, MS_PROP_O)) {
+                return 0;
+            }
+            return MS_TYPE_W | (t & (MS_PROP_D | MS_PROP_U | MS_PROP_S));
+        case 'v':
+            if (!ms_type_is(t, MS_TYPE_B, 0)) {
+                return 0;
+            }
+            return MS_TYPE_V | (t & (MS_PROP_Z | MS_PROP_O | MS_PROP_N | MS_PROP_S));
+        default:
+            return 0;
+    }
+}
+
+// returns the type of a node, given the type of the fragment itself; 0 if any wrapper is invalid
+static uint16_t ms_apply_wrappers(const policy_node_miniscript_t *node, uint16_t t) {
+    // the innermost wrapper is applied first
+    for (int i = MAX_MINISCRIPT_WRAPPERS - 1; i >= 0 && t != 0; i--) {
+        if (node->wrappers[i] != '\0') {
+            t = ms_wrap_type(node->wrappers[i], t);
+        }
+    }
+    return t;
+}
+
+// an and_v or thresh being parsed, with what is needed to compute its type once it is closed
+typedef struct {
+    policy_node_miniscript_t *node;
+    policy_node_miniscript_t *last_sub;
+    uint16_t x_type;  // for and_v, the type of the first subexpression
+    uint8_t n_z;      // for thresh, the number of subexpressions with each property
+    uint8_t n_o;
+    uint8_t n_s;
+} ms_parser_frame_t;
+
+// accounts for the subexpression of type t of the fragment of the frame; false if invalid
+static bool ms_frame_add_sub(ms_parser_frame_t *frame, uint16_t t) {
+    policy_node_miniscript_t *node = frame->node;
+    if (node->type == TOKEN_AND_V) {
+        if (node->n_subs == 0) {
+            if (!ms_type_is(t, MS_TYPE_V, 0)) {
+                return false;
+            }
+            frame->x_type = t;
+        } else if (node->n_subs != 1 || (t & (MS_TYPE_B | MS_TYPE_K | MS_TYPE_V)) == 0) {
+            return false;
+        }
+    } else {
+        // the first subexpression of a thresh must be Bdu, the others Wdu
+        uint16_t basic_type = node->n_subs == 0 ? MS_TYPE_B : MS_TYPE_W;
+        if (node->n_subs >= MAX_MINISCRIPT_THRESH_SUBS ||
+            !ms_type_is(t, basic_type, MS_PROP_D | MS_PROP_U)) {
+            return false;
+        }
+        frame->n_z += (t & MS_PROP_Z) ? 1 : 0;
+        frame->n_o += (t & MS_PROP_O) ? 1 : 0;
+        frame->n_s += (t & MS_PROP_S) ? 1 : 0;
+    }
+    ++node->n_subs;
+    return true;
+}
+
+// returns the type of the fragment of a frame whose subexpressions are all parsed; 0 if invalid
+static uint16_t ms_frame_close(const ms_parser_frame_t *frame, uint16_t last_type) {
+    const policy_node_miniscript_t *node = frame->node;
+    if (node->type == TOKEN_AND_V) {
+        if (node->n_subs != 2) {
+            return 0;
+        }
+        uint16_t x = frame->x_type, y = last_type;
+        uint16_t t = y & (MS_BASIC_TYPES | MS_PROP_U);
+        if ((x & MS_PROP_Z) && (y & MS_PROP_Z)) {
+            t |= MS_PROP_Z;
+        }
+        if (((x & MS_PROP_Z) && (y & MS_PROP_O)) || ((x & MS_PROP_O) && (y & MS_PROP_Z))) {
+            t |= MS_PROP_O;
+        }
+        if ((x & MS_PROP_N) || ((x & MS_PROP_Z) && (y & MS_PROP_N))) {
+            t |= MS_PROP_N;
+        }
+        if ((x & MS_PROP_S) || (y & MS_PROP_S)) {
+            t |= MS_PROP_S;
+        }
+        return t;
+    }
+
+    // thresh
+    if (!(1 <= node->arg && node->arg <= node->n_subs)) {
+        return 0;
+    }
+    uint16_t t = MS_TYPE_B | MS_PROP_D | MS_PROP_U;
+    if (frame->n_z == node->n_subs) {
+        t |= MS_PROP_Z;
+    }
+    if (frame->n_z + 1 == node->n_subs && frame->n_o == 1) {
+        t |= MS_PROP_O;
+    }
+    if (frame->n_s + node->arg - 1 >= node->n_subs) {
+        t |= MS_PROP_S;
+    }
+    return t;
+}
+
+static bool is_miniscript_start(const buffer_t *in_buf) {
+    size_t word_len = peek_word_len(in_buf, MAX_TOKEN_LENGTH);
+    if (buffer_can_read(in_buf, word_len + 1) && in_buf->ptr[in_buf->offset + word_len] == ':') {
+        return true;  // wrappers
+    }
+
+    buffer_t tmp = *in_buf;
+    int token = parse_token(&tmp);
+    return token == TOKEN_PK || token == TOKEN_PK_K || token == TOKEN_OLDER ||
+           token == TOKEN_AND_V || token == TOKEN_THRESH;
+}
+
+// parses the wrappers (if any) and the name of a miniscript fragment, and the following '('
+static int parse_miniscript_fragment_start(buffer_t *in_buf, policy_node_miniscript_t *node) {
+    size_t n_wrappers = 0;
+    size_t word_len = peek_word_len(in_buf, MAX_TOKEN_LENGTH);
+    if (buffer_can_read(in_buf, word_len + 1) && in_buf->ptr[in_buf->offset + word_len] == ':') {
+        if (word_len == 0 || word_len > MAX_MINISCRIPT_WRAPPERS) {
+            return -1;
+        }
+        for (size_t i = 0; i < word_len; i++) {
+            node->wrappers[i] = (char) in_buf->ptr[in_buf->offset + i];
+        }
+        n_wrappers = word_len;
+        buffer_seek_cur(in_buf, word_len + 1);  // skip the wrappers and the ':' character
+    }
+
+    int token = parse_token(in_buf);
+    if (token == TOKEN_PK) {
+        // pk(KEY) is c:pk_k(KEY)
+        if (n_wrappers >= MAX_MINISCRIPT_WRAPPERS) {
+            return -1;
+        }
+        node->wrappers[n_wrappers] = 'c';
+        token = TOKEN_PK_K;
+    }
+    if (token != TOKEN_PK_K && token != TOKEN_OLDER && token != TOKEN_AND_V &&
+        token != TOKEN_THRESH) {
+        return -1;
+    }
+    node->type = token;
+
+    char c;
+    if (!buffer_read_u8(in_buf, (uint8_t *) &c) || c != '(') {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Parses a miniscript expression from the in_buf buffer, allocating the nodes in out_buf; the first
+ * node is the root of the miniscript. The parsing is iterative: the and_v and thresh being parsed
+ * are kept in an explicit stack of MAX_MINISCRIPT_DEPTH elements, so that the memory used only
+ * depends on the preallocated buffers, and not on the miniscript.
+ * The expression must have type B, and require a signature (property s).
+ */
+static int parse_miniscript(buffer_t *in_buf, buffer_t *out_buf) {
+    ms_parser_frame_t stack[MAX_MINISCRIPT_DEPTH];
+    size_t stack_len = 0;
+    char c;
+
+    while (true) {
+        policy_node_miniscript_t *node =
+            (policy_node_miniscript_t *) buffer_alloc(out_buf,
+                                                      sizeof(policy_node_miniscript_t),
+                                                      true);
+        if (node == NULL) {
+            return -1;
+        }
+        memset(node, 0, sizeof(policy_node_miniscript_t));
+
+        if (parse_miniscript_fragment_start(in_buf, node) < 0) {
+            return -2;
+        }
+
+        if (stack_len > 0) {
+            ms_parser_frame_t *parent = &stack[stack_len - 1];
+            if (parent->last_sub == NULL) {
+                parent->node->subs = node;
+            } else {
+                parent->last_sub->next = node;
+            }
+            parent->last_sub = node;
+        }
+
+        uint16_t t = 0;
+        size_t arg;
+        switch (node->type) {
+            case TOKEN_PK_K: {
+                int key_index = parse_key_index(in_buf);
+                if (key_index == -1) {
+                    return -3;
+                }
+                node->arg = (uint32_t) key_index;
+                t = MS_TYPE_K | MS_PROP_O | MS_PROP_N | MS_PROP_D | MS_PROP_U | MS_PROP_S;
+                break;
+            }
+            case TOKEN_OLDER: {
+                if (parse_unsigned_decimal(in_buf, &arg) == -1 || arg < 1 ||
+                    arg > MAX_MINISCRIPT_OLDER) {
+                    return -4;
+                }
+                node->arg = (uint32_t) arg;
+                t = MS_TYPE_B | MS_PROP_Z;
+                break;
+            }
+            default: {
+                // and_v or thresh: the subexpressions are parsed next
+                if (stack_len >= MAX_MINISCRIPT_DEPTH) {
+                    return -5;
+                }
+                if (node->type == TOKEN_THRESH) {
+                    if (parse_unsigned_decimal(in_buf, &arg) == -1 ||
+                        arg > MAX_MINISCRIPT_THRESH_SUBS || !buffer_read_u8(in_buf, (uint8_t *) &c) ||
+                        c != ',') {
+                        return -6;
+                    }
+                    node->arg = (uint32_t) arg;
+                }
+                memset(&stack[stack_len], 0, sizeof(ms_parser_frame_t));
+                stack[stack_len].node = node;
+                ++stack_len;
+                continue;
+            }
+        }
+
+        // a fragment is complete; close all the fragments that end with it
+        while (true) {
+            if (!buffer_read_u8(in_buf, (uint8_t *) &c) || c != ')') {
+                return -7;
+            }
+            t = ms_apply_wrappers(node, t);
+            if (t == 0) {
+                return -8;  // invalid type
+            }
+
+            if (stack_len == 0) {
+                return ms_type_is(t, MS_TYPE_B, MS_PROP_S) ? 0 : -9;
+            }
+
+            ms_parser_frame_t *frame = &stack[stack_len - 1];
+            if (!ms_frame_add_sub(frame, t)) {
+                return -10;
+            }
+
+            if (!buffer_can_read(in_buf, 1)) {
+                return -11;
+            }
+            if (in_buf->ptr[in_buf->offset] == ',') {
+                buffer_seek_cur(in_buf, 1);  // skip the ',' character; another subexpression follows
+                break;
+            }
+
+            t = ms_frame_close(frame, t);
+            if (t == 0) {
+                return -12;
+            }
+            node = frame->node;
+            --stack_len;
+        }
+    }
+}
+
 int parse_policy_map(buffer_t *in_buf, void *out, size_t out_len) {
     if ((unsigned long) out % 4 != 0) {
         PRINTF("Unaligned pointer\n");
@@ -490,74 +1129,513 @@ int parse_policy_map(buffer_t *in_buf, void *out, size_t out_len) {
     return parse_script(in_buf, &out_buf, 0, 0);
 }
 
-// TODO: add unit tests
-int get_script_type(const uint8_t script[], size_t script_len) {
-    if (script_len == 25 && script[0] == 0x76 && script[1] == 0xa9 && script[2] == 0x14 &&
-        script[23] == 0x88 && script[24] == 0xac) {
-        return SCRIPT_TYPE_P2PKH;
+static bool write_bytes_op(buffer_t *out, const uint8_t *data, uint8_t data_len) {
+    return buffer_write_u8(out, SCRIPT_TEMPLATE_OP_BYTES) && buffer_write_u8(out, data_len) &&
+           buffer_write_bytes(out, data, data_len);
+}
+
+static bool write_key_op(buffer_t *out, script_template_op_e op, size_t key_index) {
+    return key_index <= UINT8_MAX && buffer_write_u8(out, op) &&
+           buffer_write_u8(out, (uint8_t) key_index);
+}
+
+static int write_segment_ops(const policy_node_t *policy, buffer_t *out);
+
+// writes the minimal push of a number as a script number; returns the number of bytes written
+static size_t write_script_number(uint8_t out[static 5], uint32_t n) {
+    if (n <= 16) {
+        out[0] = n == 0 ? 0x00 : (uint8_t) (0x50 + n);  // OP_0, or OP_1 to OP_16
+        return 1;
     }
 
-    if (script_len == 23 && script[0] == 0xa9 && script[1] == 0x14 && script[22] == 0x87) {
-        return SCRIPT_TYPE_P2SH;
+    size_t len = 0;
+    while (n > 0) {
+        out[1 + len++] = (uint8_t) (n & 0xFF);
+        n >>= 8;
+    }
+    if (out[len] & 0x80) {
+        out[1 + len++] = 0x00;  // the number is positive
     }
+    out[0] = (uint8_t) len;
+    return 1 + len;
+}
 
-    if (script_len == 22 && script[0] == 0x00 && script[1] == 0x14) {
-        return SCRIPT_TYPE_P2WPKH;
+// state of the compiler of a miniscript
+typedef struct {
+    buffer_t *out;
+    size_t script_len;
+    // offset of the last operation, if it is a SCRIPT_TEMPLATE_OP_BYTES; SIZE_MAX otherwise
+    size_t bytes_op_offset;
+} ms_writer_t;
+
+// appends bytes to the script, extending the last operation if it is a SCRIPT_TEMPLATE_OP_BYTES
+static bool ms_write_bytes(ms_writer_t *w, const uint8_t *data, uint8_t data_len) {
+    w->script_len += data_len;
+    if (w->bytes_op_offset != SIZE_MAX &&
+        w->out->ptr[w->bytes_op_offset + 1] + data_len <= UINT8_MAX) {
+        w->out->ptr[w->bytes_op_offset + 1] += data_len;
+        return buffer_write_bytes(w->out, data, data_len);
     }
+    w->bytes_op_offset = w->out->offset;
+    return write_bytes_op(w->out, data, data_len);
+}
+
+static bool ms_write_opcode(ms_writer_t *w, uint8_t opcode) {
+    return ms_write_bytes(w, &opcode, 1);
+}
+
+static bool ms_write_number(ms_writer_t *w, uint32_t n) {
+    uint8_t push[5];
+    return ms_write_bytes(w, push, (uint8_t) write_script_number(push, n));
+}
 
-    if (script_len == 34 && script[0] == 0x00 && script[1] == 0x20) {
-        return SCRIPT_TYPE_P2WSH;
+// OP_VERIFY, merged into the last opcode if it has a VERIFY version
+static bool ms_write_verify(ms_writer_t *w) {
+    if (w->bytes_op_offset != SIZE_MAX) {
+        uint8_t *last = &w->out->ptr[w->out->offset - 1];
+        // OP_CHECKSIG, OP_EQUAL and OP_CHECKMULTISIG are followed by their VERIFY version
+        if (*last == 0xac || *last == 0x87 || *last == 0xae) {
+            ++*last;
+            return true;
+        }
     }
+    return ms_write_opcode(w, 0x69);  // OP_VERIFY
+}
 
-    if (script_len == 34 && script[0] == 0x51 && script[1] == 0x20) {
-        return SCRIPT_TYPE_P2TR;
+// writes the opcodes that precede the script of a fragment, for its wrappers
+static bool ms_write_wrappers_prefix(ms_writer_t *w, const policy_node_miniscript_t *node) {
+    for (int i = 0; i < MAX_MINISCRIPT_WRAPPERS; i++) {
+        if (node->wrappers[i] == 's' && !ms_write_opcode(w, 0x7c)) {  // OP_SWAP
+            return false;
+        }
+        if (node->wrappers[i] == 'a' && !ms_write_opcode(w, 0x6b)) {  // OP_TOALTSTACK
+            return false;
+        }
     }
+    return true;
+}
 
-    // unknown
-    return -1;
+// writes the opcodes that follow the script of a fragment, for its wrappers
+static bool ms_write_wrappers_suffix(ms_writer_t *w, const policy_node_miniscript_t *node) {
+    for (int i = MAX_MINISCRIPT_WRAPPERS - 1; i >= 0; i--) {
+        bool ok = true;
+        if (node->wrappers[i] == 'c') {
+            ok = ms_write_opcode(w, 0xac);  // OP_CHECKSIG
+        } else if (node->wrappers[i] == 'v') {
+            ok = ms_write_verify(w);
+        } else if (node->wrappers[i] == 'a') {
+            ok = ms_write_opcode(w, 0x6c);  // OP_FROMALTSTACK
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// writes the operations of a miniscript, returning the length of the script. Like the parser, the
+// compiler is iterative, with an explicit stack of the fragments whose subexpressions are written.
+static int write_miniscript_ops(const policy_node_miniscript_t *root, buffer_t *out) {
+    struct {
+        const policy_node_miniscript_t *node;
+        const policy_node_miniscript_t *next_sub;
+    } stack[MAX_MINISCRIPT_DEPTH];
+    size_t stack_len = 0;
+
+    ms_writer_t w = {.out = out, .script_len = 0, .bytes_op_offset = SIZE_MAX};
+
+    const policy_node_miniscript_t *node = root;
+    while (true) {
+        if (!ms_write_wrappers_prefix(&w, node)) {
+            return -1;
+        }
+
+        if (node->type == TOKEN_AND_V || node->type == TOKEN_THRESH) {
+            if (stack_len >= MAX_MINISCRIPT_DEPTH || node->subs == NULL) {
+                return -1;
+            }
+            stack[stack_len].node = node;
+            stack[stack_len].next_sub = node->subs->next;
+            ++stack_len;
+            node = node->subs;
+            continue;
+        }
+
+        if (node->type == TOKEN_PK_K) {
+            // <33-byte pubkey>
+            if (!ms_write_opcode(&w, 0x21) ||
+                !write_key_op(out, SCRIPT_TEMPLATE_OP_PUBKEY, node->arg)) {
+                return -1;
+            }
+            w.script_len += 33;
+            w.bytes_op_offset = SIZE_MAX;
+        } else if (node->type == TOKEN_OLDER) {
+            // <n> OP_CHECKSEQUENCEVERIFY
+            if (!ms_write_number(&w, node->arg) || !ms_write_opcode(&w, 0xb2)) {
+                return -1;
+            }
+        } else {
+            return -1;
+        }
+
+        // close all the fragments that end with this one
+        while (true) {
+            if (!ms_write_wrappers_suffix(&w, node)) {
+                return -1;
+            }
+            if (stack_len == 0) {
+                return w.script_len > INT16_MAX ? -1 : (int) w.script_len;
+            }
+
+            // the subexpressions of a thresh after the first one are summed: X_1 X_2 OP_ADD ...
+            bool is_first_sub = node == stack[stack_len - 1].node->subs;
+            if (stack[stack_len - 1].node->type == TOKEN_THRESH && !is_first_sub &&
+                !ms_write_opcode(&w, 0x93)) {  // OP_ADD
+                return -1;
+            }
+
+            if (stack[stack_len - 1].next_sub != NULL) {
+                node = stack[stack_len - 1].next_sub;
+                stack[stack_len - 1].next_sub = node->next;
+                break;
+            }
+
+            node = stack[stack_len - 1].node;
+            --stack_len;
+            // ... <k> OP_EQUAL
+            if (node->type == TOKEN_THRESH &&
+                (!ms_write_number(&w, node->arg) || !ms_write_opcode(&w, 0x87))) {
+                return -1;
+            }
+        }
+    }
+}
+
+// writes the program of a taproot tree, returning its length
+static int write_taptree_ops(const policy_node_tree_t *tree, buffer_t *out) {
+    size_t start_offset = out->offset;
+
+    if (!tree->is_leaf) {
+        if (write_taptree_ops(tree->left_tree, out) < 0 ||
+            write_taptree_ops(tree->right_tree, out) < 0 ||
+            !buffer_write_u8(out, TAPTREE_OP_BRANCH)) {
+            return -1;
+        }
+        return (int) (out->offset - start_offset);
+    }
+
+    // the lengths of the leaf are filled once its operations are written
+    if (!buffer_write_u8(out, TAPTREE_OP_LEAF) || !buffer_write_u8(out, 0) ||
+        !buffer_write_u8(out, 0)) {
+        return -1;
+    }
+
+    int script_len = write_segment_ops(tree->script, out);
+    size_t ops_len = out->offset - start_offset - 3;
+    if (script_len < 0 || script_len > UINT8_MAX || ops_len > UINT8_MAX) {
+        return -1;
+    }
+
+    out->ptr[start_offset + 1] = (uint8_t) script_len;
+    out->ptr[start_offset + 2] = (uint8_t) ops_len;
+    return (int) (out->offset - start_offset);
+}
+
+// writes the operations of the segment of a single script, returning the length of the script
+static int write_segment_ops(const policy_node_t *policy, buffer_t *out) {
+    switch (policy->type) {
+        case TOKEN_PKH: {
+            const policy_node_with_key_t *root = (const policy_node_with_key_t *) policy;
+            // OP_DUP OP_HASH160 <20-byte hash> OP_EQUALVERIFY OP_CHECKSIG
+            const uint8_t prefix[] = {0x76, 0xa9, 0x14};
+            const uint8_t suffix[] = {0x88, 0xac};
+            if (!write_bytes_op(out, prefix, sizeof(prefix)) ||
+                !write_key_op(out, SCRIPT_TEMPLATE_OP_PUBKEY_HASH160, root->key_index) ||
+                !write_bytes_op(out, suffix, sizeof(suffix))) {
+                return -1;
+            }
+            return 3 + 20 + 2;
+        }
+        case TOKEN_WPKH: {
+            const policy_node_with_key_t *root = (const policy_node_with_key_t *) policy;
+            // OP_0 <20-byte hash>
+            const uint8_t prefix[] = {0x00, 0x14};
+            if (!write_bytes_op(out, prefix, sizeof(prefix)) ||
+                !write_key_op(out, SCRIPT_TEMPLATE_OP_PUBKEY_HASH160, root->key_index)) {
+                return -1;
+            }
+            return 2 + 20;
+        }
+        case TOKEN_PK: {
+            // only in tapscripts: <32-byte x-only pubkey> OP_CHECKSIG
+            const policy_node_with_key_t *root = (const policy_node_with_key_t *) policy;
+            const uint8_t prefix[] = {0x20};
+            const uint8_t suffix[] = {0xac};
+            if (!write_bytes_op(out, prefix, sizeof(prefix)) ||
+                !write_key_op(out, SCRIPT_TEMPLATE_OP_XONLY_PUBKEY, root->key_index) ||
+                !write_bytes_op(out, suffix, sizeof(suffix))) {
+                return -1;
+            }
+            return 1 + 32 + 1;
+        }
+        case TOKEN_TR: {
+            const policy_node_tr_t *root = (const policy_node_tr_t *) policy;
+            // OP_1 <32-byte output key>
+            const uint8_t prefix[] = {0x51, 0x20};
+            if (!write_bytes_op(out, prefix, sizeof(prefix))) {
+                return -1;
+            }
+
+            if (root->tree == NULL) {
+                if (!write_key_op(out, SCRIPT_TEMPLATE_OP_TAPROOT_OUTPUT_KEY, root->key_index)) {
+                    return -1;
+                }
+                return 2 + 32;
+            }
+
+            // the length of the program of the tree is filled once it is written
+            if (!write_key_op(out, SCRIPT_TEMPLATE_OP_TAPROOT_TREE_OUTPUT_KEY, root->key_index)) {
+                return -1;
+            }
+            size_t tree_len_offset = out->offset;
+            if (!buffer_write_u8(out, 0)) {
+                return -1;
+            }
+
+            int tree_len = write_taptree_ops(root->tree, out);
+            if (tree_len < 0 || tree_len > UINT8_MAX) {
+                return -1;
+            }
+            out->ptr[tree_len_offset] = (uint8_t) tree_len;
+            return 2 + 32;
+        }
+        case TOKEN_SH: {
+            // OP_HASH160 <20-byte hash> OP_EQUAL
+            const uint8_t prefix[] = {0xa9, 0x14};
+            const uint8_t suffix[] = {0x87};
+            if (!write_bytes_op(out, prefix, sizeof(prefix)) ||
+                !buffer_write_u8(out, SCRIPT_TEMPLATE_OP_INNER_HASH160) ||
+                !write_bytes_op(out, suffix, sizeof(suffix))) {
+                return -1;
+            }
+            return 2 + 20 + 1;
+        }
+        case TOKEN_WSH: {
+            // OP_0 <32-byte hash>
+            const uint8_t prefix[] = {0x00, 0x20};
+            if (!write_bytes_op(out, prefix, sizeof(prefix)) ||
+                !buffer_write_u8(out, SCRIPT_TEMPLATE_OP_INNER_SHA256)) {
+                return -1;
+            }
+            return 2 + 32;
+        }
+        case TOKEN_MULTI:
+        case TOKEN_SORTEDMULTI: {
+            const policy_node_multisig_t *root = (const policy_node_multisig_t *) policy;
+            if (root->n > MAX_POLICY_MAP_COSIGNERS || root->k > root->n) {
+                return -1;
+            }
+
+            // OP_k {pubkey_1} ... {pubkey_n} OP_n OP_CHECKMULTISIG
+            const uint8_t op_k = 0x50 + root->k;
+            if (!write_bytes_op(out, &op_k, 1)) {
+                return -1;
+            }
+
+            if (policy->type == TOKEN_SORTEDMULTI) {
+                if (!buffer_write_u8(out, SCRIPT_TEMPLATE_OP_SORTED_PUBKEYS) ||
+                    !buffer_write_u8(out, (uint8_t) root->n)) {
+                    return -1;
+                }
+                for (unsigned int i = 0; i < root->n; i++) {
+                    if (root->key_indexes[i] > UINT8_MAX ||
+                        !buffer_write_u8(out, (uint8_t) root->key_indexes[i])) {
+                        return -1;
+                    }
+                }
+            } else {
+                const uint8_t push_33 = 0x21;
+                for (unsigned int i = 0; i < root->n; i++) {
+                    if (!write_bytes_op(out, &push_33, 1) ||
+                        !write_key_op(out, SCRIPT_TEMPLATE_OP_PUBKEY, root->key_indexes[i])) {
+                        return -1;
+                    }
+                }
+            }
+
+            const uint8_t suffix[] = {0x50 + root->n, 0xae};
+            if (!write_bytes_op(out, suffix, sizeof(suffix))) {
+                return -1;
+            }
+            return 1 + 34 * root->n + 1 + 1;
+        }
+        case TOKEN_PK_K:
+        case TOKEN_OLDER:
+        case TOKEN_AND_V:
+        case TOKEN_THRESH:
+            return write_miniscript_ops((const policy_node_miniscript_t *) policy, out);
+        default:
+            return -1;
+    }
+}
+
+// appends the segments of the script and of its inner scripts, innermost first
+static int write_segments(const policy_node_t *policy, buffer_t *out) {
+    if (policy->type == TOKEN_SH || policy->type == TOKEN_WSH) {
+        const policy_node_with_script_t *root = (const policy_node_with_script_t *) policy;
+        if (write_segments(root->script, out) < 0) {
+            return -1;
+        }
+    }
+
+    // reserve the segment header, filled once the operations are written
+    size_t header_offset = out->offset;
+    if (!buffer_write_u16(out, 0, BE) || !buffer_write_u8(out, 0)) {
+        return -1;
+    }
+
+    int script_len = write_segment_ops(policy, out);
+    size_t ops_len = out->offset - header_offset - 3;
+    if (script_len < 0 || script_len > UINT16_MAX || ops_len > UINT8_MAX) {
+        return -1;
+    }
+
+    out->ptr[header_offset] = (uint8_t) (script_len >> 8);
+    out->ptr[header_offset + 1] = (uint8_t) (script_len & 0xFF);
+    out->ptr[header_offset + 2] = (uint8_t) ops_len;
+    return 0;
+}
+
+int compile_script_template(const policy_node_t *policy, uint8_t *out, size_t out_len) {
+    buffer_t out_buf = buffer_create(out, out_len);
+
+    if (write_segments(policy, &out_buf) < 0) {
+        return -1;
+    }
+    return (int) out_buf.offset;
+}
+
+int compile_taptree_template(const policy_node_tree_t *tree, uint8_t *out, size_t out_len) {
+    buffer_t out_buf = buffer_create(out, out_len);
+
+    return write_taptree_ops(tree, &out_buf);
+}
+
+// The supported scriptPubKeys: their length, and the opcodes before and after the hash or the
+// witness program, that fills the rest of the script.
+static const struct {
+    uint8_t type;
+    uint8_t len;
+    uint8_t prefix_len;
+    uint8_t prefix[3];
+    uint8_t suffix_len;
+    uint8_t suffix[2];
+} SCRIPT_TEMPLATES[] = {
+    {SCRIPT_TYPE_P2PKH, 25, 3, {0x76, 0xa9, 0x14}, 2, {0x88, 0xac}},
+    {SCRIPT_TYPE_P2SH, 23, 2, {0xa9, 0x14}, 1, {0x87}},
+    {SCRIPT_TYPE_P2WPKH, 22, 2, {0x00, 0x14}, 0, {0}},
+    {SCRIPT_TYPE_P2WSH, 34, 2, {0x00, 0x20}, 0, {0}},
+    {SCRIPT_TYPE_P2TR, 34, 2, {0x51, 0x20}, 0, {0}},
+};
+
+void classify_script(const uint8_t script[], size_t script_len, script_info_t *out) {
+    out->type = -1;
+    out->program_offset = 0;
+    out->program_len = 0;
+
+    // a witness program is a version (OP_0 to OP_16) and a single push of 2 to 40 bytes
+    out->segwit_version = -1;
+    if (script_len >= 4 && script_len <= 42 && script[1] == script_len - 2) {
+        if (script[0] == 0x00) {
+            out->segwit_version = 0;
+        } else if (script[0] >= 0x51 && script[0] <= 0x60) {
+            out->segwit_version = script[0] - 0x50;
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(SCRIPT_TEMPLATES) / sizeof(SCRIPT_TEMPLATES[0]); i++) {
+        size_t prefix_len = SCRIPT_TEMPLATES[i].prefix_len;
+        size_t suffix_len = SCRIPT_TEMPLATES[i].suffix_len;
+        if (script_len == SCRIPT_TEMPLATES[i].len &&
+            memcmp(script, SCRIPT_TEMPLATES[i].prefix, prefix_len) == 0 &&
+            memcmp(script + script_len - suffix_len, SCRIPT_TEMPLATES[i].suffix, suffix_len) ==
+                0) {
+            out->type = SCRIPT_TEMPLATES[i].type;
+            out->program_offset = prefix_len;
+            out->program_len = script_len - prefix_len - suffix_len;
+            return;
+        }
+    }
+}
+
+int get_script_type(const uint8_t script[], size_t script_len) {
+    script_info_t info;
+    classify_script(script, script_len, &info);
+    return info.type;
 }
 
 #ifndef SKIP_FOR_CMOCKA
 
-// TODO: add unit tests
 int get_script_address(const uint8_t script[],
                        size_t script_len,
                        global_context_t *coin_config,
                        char *out,
                        size_t out_len) {
-    int script_type = get_script_type(script, script_len);
-    int addr_len;
-    switch (script_type) {
+    script_info_t info;
+    classify_script(script, script_len, &info);
+    return get_classified_script_address(script, script_len, &info, coin_config, out, out_len);
+}
+
+// The native segwit prefix of the last bech32/bech32m address, and the state of the checksum after
+// it; the prefix of the coin does not change while the app runs.
+static const char *G_segwit_hrp;
+static uint32_t G_segwit_hrp_state;
+
+// TODO: add unit tests
+int get_classified_script_address(const uint8_t script[],
+                                  size_t script_len,
+                                  const script_info_t *info,
+                                  global_context_t *coin_config,
+                                  char *out,
+                                  size_t out_len) {
+    int addr_len = address_cache_get(script, script_len, out, out_len);
+    if (addr_len >= 0) {
+        return addr_len;
+    }
+
+    const uint8_t *program = script + info->program_offset;
+    switch (info->type) {
         case SCRIPT_TYPE_P2PKH:
-            addr_len =
-                base58_encode_address(script + 3, coin_config->p2pkh_version, out, out_len - 1);
+            addr_len = base58_encode_address(program, coin_config->p2pkh_version, out, out_len - 1);
             break;
         case SCRIPT_TYPE_P2SH:
-            addr_len =
-                base58_encode_address(script + 2, coin_config->p2sh_version, out, out_len - 1);
+            addr_len = base58_encode_address(program, coin_config->p2sh_version, out, out_len - 1);
             break;
         case SCRIPT_TYPE_P2WPKH:
         case SCRIPT_TYPE_P2WSH:
         case SCRIPT_TYPE_P2TR: {
             // bech32/bech32m encoding
 
-            // 20 for P2WPKH, 32 for P2WSH or P2TR
-            int hash_length = (script_type == SCRIPT_TYPE_P2WPKH ? 20 : 32);
-
-            // witness program version
-            int version = (script_type == SCRIPT_TYPE_P2TR ? 1 : 0);
-
             // make sure that the output buffer is long enough
             if (out_len < 73 + strlen(coin_config->native_segwit_prefix)) {
                 return -1;
             }
 
-            int ret = segwit_addr_encode(out,
-                                         coin_config->native_segwit_prefix,
-                                         version,
-                                         script + 2,
-                                         hash_length  // 20 for WPKH, 32 for WSH
-            );
+            // the state of the checksum after the prefix is the same for all the addresses
+            if (G_segwit_hrp != coin_config->native_segwit_prefix) {
+                if (bech32_hrp_state(coin_config->native_segwit_prefix, &G_segwit_hrp_state) != 1) {
+                    return -1;  // should never happen
+                }
+                G_segwit_hrp = coin_config->native_segwit_prefix;
+            }
+
+            // 20 bytes for P2WPKH, 32 for P2WSH or P2TR
+            int ret = segwit_addr_encode_from_state(out,
+                                                    coin_config->native_segwit_prefix,
+                                                    G_segwit_hrp_state,
+                                                    info->segwit_version,
+                                                    program,
+                                                    info->program_len);
 
             if (ret != 1) {
                 return -1;  // should never happen
@@ -570,6 +1648,8 @@ int get_script_address(const uint8_t script[],
             return -1;
     }
     out[addr_len] = '\0';
+
+    address_cache_add(script, script_len, out, addr_len);
     return addr_len;
 }
 
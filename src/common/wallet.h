@@ -14,15 +14,24 @@
 
 #define WALLET_TYPE_POLICY_MAP 1
 
+// Same as WALLET_TYPE_POLICY_MAP, but the keys information are in the binary format, that does not
+// need to be parsed as text nor base58-decoded (see parse_policy_map_key_info)
+#define WALLET_TYPE_POLICY_MAP_BINARY_KEYS 2
+
 /**
- * Maximum supported number of keys for a policy map.
+ * Maximum supported number of keys of a multi or sortedmulti script.
  */
-#define MAX_POLICY_MAP_COSIGNERS 5
+#define MAX_POLICY_MAP_COSIGNERS 15
 
 /**
  * Maximum supported number of keys for a policy map.
  */
-#define MAX_POLICY_MAP_KEYS 5
+#define MAX_POLICY_MAP_KEYS 15
+
+/**
+ * Maximum supported number of internal keys (that is, keys of this device) for a policy map.
+ */
+#define MAX_POLICY_MAP_INTERNAL_KEYS 5
 
 // The string describing a pubkey can contain:
 // - (optional) the key origin info, which we limit to 46 bytes (2 + 8 + 3*12 = 46 bytes)
@@ -31,12 +40,28 @@
 // Therefore, the total length of the key info string is at most 162 bytes.
 #define MAX_POLICY_KEY_INFO_LEN (46 + MAX_SERIALIZED_PUBKEY_LENGTH + 3)
 
-// Enough to store "sh(wsh(sortedmulti(15,@0,@1,@2,@3,@4,@5,@6,@7,@8,@9,@10,@11,@12,@13,@14)))"
-#define MAX_POLICY_MAP_STR_LENGTH 74
+// Length of an extended pubkey serialized as in BIP-32, before the base58check encoding
+#define SERIALIZED_EXTENDED_PUBKEY_LEN 78
+
+// The binary key information (of the wallets of type WALLET_TYPE_POLICY_MAP_BINARY_KEYS) contains:
+// - the flags (1 byte), a combination of the KEY_INFO_FLAG_* values
+// - if KEY_INFO_FLAG_HAS_KEY_ORIGIN is set, the master key fingerprint (4 bytes), the number of
+//   derivation steps (1 byte, at most MAX_BIP32_PATH_STEPS) and the steps (4 bytes each, LE)
+// - the serialized extended pubkey (78 bytes)
+#define KEY_INFO_FLAG_HAS_KEY_ORIGIN 0x01
+#define KEY_INFO_FLAG_HAS_WILDCARD   0x02
+
+#define MAX_POLICY_KEY_INFO_BINARY_LEN \
+    (1 + 4 + 1 + 4 * MAX_BIP32_PATH_STEPS + SERIALIZED_EXTENDED_PUBKEY_LEN)
+
+// Enough for "sh(wsh(sortedmulti(15,@0,@1,@2,@3,@4,@5,@6,@7,@8,@9,@10,@11,@12,@13,@14)))" (74
+// bytes), and for miniscript policies with timelocks; the serialized wallet policy still fits in
+// the data of an apdu. The parsed policy must also fit in MAX_POLICY_MAP_BYTES.
+#define MAX_POLICY_MAP_STR_LENGTH 160
 
 #define MAX_POLICY_MAP_NAME_LENGTH 16
 
-// at most 126 bytes
+// at most 212 bytes
 // wallet type (1 byte)
 // name length (1 byte)
 // name (max MAX_POLICY_MAP_NAME_LENGTH bytes)
@@ -45,7 +70,7 @@
 // n_keys (1 byte)
 // keys_merkle_root (32 bytes)
 #define MAX_POLICY_MAP_SERIALIZED_LENGTH \
-    (1 + MAX_POLICY_MAP_NAME_LENGTH + 1 + MAX_POLICY_MAP_STR_LENGTH + 32)
+    (1 + 1 + MAX_POLICY_MAP_NAME_LENGTH + 1 + MAX_POLICY_MAP_STR_LENGTH + 1 + 32)
 
 // Maximum size of a parsed policy map in memory
 #define MAX_POLICY_MAP_BYTES 128
@@ -59,11 +84,17 @@ typedef struct {
     uint8_t master_key_derivation_len;
     uint8_t has_key_origin;
     uint8_t has_wildcard;  // true iff the keys ends with the /** wildcard
-    char ext_pubkey[MAX_SERIALIZED_PUBKEY_LENGTH + 1];
+    uint8_t is_binary;     // true iff parsed from a binary key information
+    union {
+        // if !is_binary, the base58check-encoded extended pubkey
+        char ext_pubkey[MAX_SERIALIZED_PUBKEY_LENGTH + 1];
+        // if is_binary, the serialized extended pubkey
+        uint8_t serialized_ext_pubkey[SERIALIZED_EXTENDED_PUBKEY_LEN];
+    };
 } policy_map_key_info_t;
 
 typedef struct {
-    uint8_t type;  // Currently the only supported value is WALLET_TYPE_POLICY_MAP
+    uint8_t type;  // WALLET_TYPE_POLICY_MAP or WALLET_TYPE_POLICY_MAP_BINARY_KEYS
     uint8_t name_len;
     char name[MAX_WALLET_NAME_LENGTH + 1];
     uint16_t policy_map_len;
@@ -75,7 +106,7 @@ typedef struct {
 typedef enum {
     TOKEN_SH,
     TOKEN_WSH,
-    // TOKEN_PK,       // disabled, but it will be needed for taproot
+    TOKEN_PK,  // only in the leaves of the taproot tree of a tr (in miniscript, pk is c:pk_k)
     TOKEN_PKH,
     TOKEN_WPKH,
     // TOKEN_COMBO     // disabled, does not mix well with the script policy language
@@ -84,6 +115,11 @@ typedef enum {
     TOKEN_TR,
     // TOKEN_ADDR,     // unsupported
     // TOKEN_RAW,      // unsupported
+    // miniscript fragments, only inside wsh (see policy_node_miniscript_t)
+    TOKEN_PK_K,
+    TOKEN_OLDER,
+    TOKEN_AND_V,
+    TOKEN_THRESH,
 } PolicyNodeType;
 
 // TODO: the following structures are using size_t for all integers to avoid alignment problems;
@@ -106,6 +142,25 @@ typedef struct {
     size_t key_index;     // index of the key
 } policy_node_with_key_t;
 
+// a node of the taproot tree of a tr: either a leaf with a tapscript, or a branch {left,right}
+typedef struct policy_node_tree_s {
+    bool is_leaf;
+    policy_node_t *script;                 // only for leaves
+    struct policy_node_tree_s *left_tree;  // only for branches
+    struct policy_node_tree_s *right_tree;
+} policy_node_tree_t;
+
+typedef struct {
+    PolicyNodeType type;       // == TOKEN_TR
+    size_t key_index;          // index of the internal key
+    policy_node_tree_t *tree;  // NULL if there are no tapscripts (key path only)
+} policy_node_tr_t;
+
+/**
+ * Maximum depth of the taproot tree of a tr.
+ */
+#define MAX_TAPTREE_DEPTH 2
+
 typedef struct {
     PolicyNodeType type;  // == TOKEN_MULTI, == TOKEN_SORTEDMULTI
     size_t k;             // threshold
@@ -113,6 +168,96 @@ typedef struct {
     size_t *key_indexes;  // pointer to array of exactly n key indexes
 } policy_node_multisig_t;
 
+/**
+ * Maximum number of wrappers of a miniscript fragment, including the c: implied by pk(KEY).
+ */
+#define MAX_MINISCRIPT_WRAPPERS 3
+
+/**
+ * Maximum nesting of the miniscript fragments with subexpressions (and_v and thresh). The parser and
+ * the compiler of miniscript are iterative, and use an explicit stack of this size.
+ */
+#define MAX_MINISCRIPT_DEPTH 4
+
+/**
+ * Maximum number of subexpressions of a thresh.
+ */
+#define MAX_MINISCRIPT_THRESH_SUBS 15
+
+// A node of a miniscript (in the supported subset: pk_k, older, and_v and thresh, with the wrappers
+// a:, c:, s: and v:). All the fragments share the same node, so that the memory used by a
+// miniscript only depends on the number of its fragments.
+typedef struct policy_node_miniscript_s {
+    PolicyNodeType type;  // == TOKEN_PK_K, == TOKEN_OLDER, == TOKEN_AND_V, == TOKEN_THRESH
+    // the wrappers, outermost first, padded with 0s
+    char wrappers[MAX_MINISCRIPT_WRAPPERS];
+    uint8_t n_subs;  // number of subexpressions: 0 for pk_k and older, 2 for and_v, n for thresh
+    uint32_t arg;    // the key index for pk_k, the relative locktime for older, k for thresh
+    struct policy_node_miniscript_s *subs;  // first subexpression, NULL if n_subs == 0
+    struct policy_node_miniscript_s *next;  // next subexpression of the parent, or NULL
+} policy_node_miniscript_t;
+
+/*
+  Script templates are a flat representation of the scripts of a parsed policy map, that can be
+  filled for any change/address_index with a single linear pass and no recursion.
+
+  A template is a sequence of segments, one per script, with the inner scripts first; the last
+  segment is the script of the policy itself, while the previous ones are only hashed, and their
+  hash is available to the following segment. Each segment is made of:
+  - the length of the script (2 bytes, big-endian);
+  - the total length of the operations of the segment (1 byte);
+  - the operations (script_template_op_e), each followed by its arguments.
+*/
+
+/**
+ * Maximum length of the script template of a policy map.
+ */
+#define MAX_SCRIPT_TEMPLATE_LEN 128
+
+typedef enum {
+    // followed by the length n (1 byte) and by n bytes, that are copied to the script
+    SCRIPT_TEMPLATE_OP_BYTES = 0x00,
+    // followed by a key index (1 byte); adds the 33-byte compressed pubkey
+    SCRIPT_TEMPLATE_OP_PUBKEY = 0x01,
+    // followed by a key index (1 byte); adds the 20-byte hash160 of the compressed pubkey
+    SCRIPT_TEMPLATE_OP_PUBKEY_HASH160 = 0x02,
+    // followed by a key index (1 byte); adds the 32-byte BIP-86 taproot output key
+    SCRIPT_TEMPLATE_OP_TAPROOT_OUTPUT_KEY = 0x03,
+    // followed by n (1 byte) and by n key indexes; adds the n pushes of the 33-byte compressed
+    // pubkeys, sorted lexicographically
+    SCRIPT_TEMPLATE_OP_SORTED_PUBKEYS = 0x04,
+    // adds the 32-byte sha256 of the script of the previous segment
+    SCRIPT_TEMPLATE_OP_INNER_SHA256 = 0x05,
+    // adds the 20-byte hash160 of the script of the previous segment
+    SCRIPT_TEMPLATE_OP_INNER_HASH160 = 0x06,
+    // followed by a key index (1 byte); adds the 32-byte x-only pubkey
+    SCRIPT_TEMPLATE_OP_XONLY_PUBKEY = 0x07,
+    // followed by the index of the internal key (1 byte), the length n of the program of the
+    // taproot tree (1 byte) and by the n bytes of the program (see taptree_op_e); adds the 32-byte
+    // taproot output key, tweaked with the Merkle root of the tree
+    SCRIPT_TEMPLATE_OP_TAPROOT_TREE_OUTPUT_KEY = 0x08,
+} script_template_op_e;
+
+/*
+  The program of a taproot tree computes its Merkle root in postfix order: each leaf pushes its
+  TapLeaf hash on a stack, and each branch replaces the two topmost hashes with their TapBranch hash.
+  The program of a tree of depth d never needs more than d + 1 hashes on the stack.
+*/
+
+/**
+ * Maximum number of hashes on the stack while computing the Merkle root of a taproot tree.
+ */
+#define MAX_TAPTREE_STACK_SIZE (MAX_TAPTREE_DEPTH + 1)
+
+typedef enum {
+    // followed by the length of the tapscript (1 byte), the total length n of its operations
+    // (1 byte) and by the n bytes of the operations, as in a segment of a script template; pushes
+    // the TapLeaf hash of the tapscript, with leaf version 0xC0
+    TAPTREE_OP_LEAF = 0x00,
+    // pops two hashes, and pushes their TapBranch hash
+    TAPTREE_OP_BRANCH = 0x01,
+} taptree_op_e;
+
 typedef enum {
     SCRIPT_TYPE_P2PKH = 0x00,
     SCRIPT_TYPE_P2SH = 0x01,
@@ -122,10 +267,98 @@ typedef enum {
 } script_type_e;
 
 /**
- * TODO: docs
+ * The classification of a scriptPubKey by classify_script, kept with the script so that it is only
+ * inspected once.
+ */
+typedef struct {
+    int8_t type;             // a script_type_e, or -1 if not one of the supported scripts
+    int8_t segwit_version;   // the version of a witness program, or -1 if it is not one
+    uint8_t program_offset;  // the offset of the hash or of the witness program in the script
+    uint8_t program_len;     // its length; 0 if type is -1
+} script_info_t;
+
+/**
+ * Parses a serialized wallet policy from buffer into header, advancing the buffer past it; any
+ * data after it is left in the buffer.
+ *
+ * Returns 0 on success, or a negative number identifying the first invalid or missing field.
  */
 int read_policy_map_wallet(buffer_t *buffer, policy_map_wallet_header_t *header);
 
+/**
+ * State of the parsing of a serialized wallet policy that is received in chunks, for example while
+ * its preimage is streamed from the host, so that it does not need to be buffered.
+ */
+typedef struct {
+    policy_map_wallet_header_t *header;  // filled while the fields are parsed
+    uint8_t field;                       // the field being parsed
+    uint8_t field_len;                   // the number of bytes of the field already parsed
+    uint8_t varint[9];                   // the bytes of a varint field, until it is complete
+    int error;                           // the error of read_policy_map_wallet, or 0
+} policy_map_wallet_parser_t;
+
+void policy_map_wallet_parser_init(policy_map_wallet_parser_t *parser,
+                                   policy_map_wallet_header_t *header);
+
+/**
+ * Parses the next data_len bytes of the serialized wallet policy. Once the wallet policy is
+ * complete, or after an error, the rest of the data is ignored.
+ *
+ * Returns the number of bytes that were parsed.
+ */
+size_t policy_map_wallet_parser_update(policy_map_wallet_parser_t *parser,
+                                       const uint8_t *data,
+                                       size_t data_len);
+
+/**
+ * Returns 0 if the serialized wallet policy is complete and valid, or the negative number that
+ * read_policy_map_wallet returns for the same bytes.
+ */
+int policy_map_wallet_parser_finish(const policy_map_wallet_parser_t *parser);
+
+/*
+  The compiled form of a registered wallet policy is a device-defined serialization of what is
+  needed to derive its addresses, so that the policy does not need to be fetched and parsed again:
+  - the version, COMPILED_POLICY_VERSION (1 byte);
+  - the wallet id (32 bytes);
+  - the number of keys (1 byte), and the root of the Merkle tree of the keys information (32 bytes);
+  - the length of the wallet name (1 byte), and the name;
+  - the length of the script template (1 byte), and the script template.
+*/
+
+#define COMPILED_POLICY_VERSION 0x01
+
+/**
+ * Maximum length of the compiled form of a wallet policy.
+ */
+#define MAX_COMPILED_POLICY_LEN \
+    (1 + 32 + 1 + 32 + 1 + MAX_WALLET_NAME_LENGTH + 1 + MAX_SCRIPT_TEMPLATE_LEN)
+
+/**
+ * Serializes the compiled form of a wallet policy, given its header, its id and its script template.
+ *
+ * @return the length of the compiled form on success, -1 on failure (output buffer too short).
+ */
+int write_compiled_policy(const policy_map_wallet_header_t *header,
+                          const uint8_t wallet_id[static 32],
+                          const uint8_t *script_template,
+                          size_t script_template_len,
+                          uint8_t *out,
+                          size_t out_len);
+
+/**
+ * Reads the compiled form of a wallet policy. The name, the number of keys and the Merkle root of
+ * the keys information are read into header, whose policy is left empty, as it is not part of the
+ * compiled form.
+ *
+ * @return the length of the script template on success, a negative number on failure.
+ */
+int read_compiled_policy(buffer_t *buffer,
+                         policy_map_wallet_header_t *header,
+                         uint8_t wallet_id[static 32],
+                         uint8_t *script_template,
+                         size_t script_template_max_len);
+
 /**
  *
  * Parses a string representing the key information for a policy map wallet (multisig).
@@ -135,6 +368,10 @@ int read_policy_map_wallet(buffer_t *buffer, policy_map_wallet_header_t *header)
  *
  * For example:
  * "[d34db33f/44'/0'/0']xpub6ERApfZwUNrhLCkDtcHTcxd75RbzS1ed54G1LkBUHQVHQKqhMkhgbmJbZRkrgZw4koxb5JaHWkY4ALHY2grBGRjaDMzQLcgJvLJuZZvRcEL"
+ *
+ * The binary key information of the wallets of type WALLET_TYPE_POLICY_MAP_BINARY_KEYS is also
+ * accepted, and recognized from its first byte (the flags, that is never a character of the string
+ * format); then, is_binary is set, and serialized_ext_pubkey is filled instead of ext_pubkey.
  */
 int parse_policy_map_key_info(buffer_t *buffer, policy_map_key_info_t *out);
 
@@ -143,6 +380,38 @@ int parse_policy_map_key_info(buffer_t *buffer, policy_map_key_info_t *out);
  */
 int parse_policy_map(buffer_t *in_buf, void *out, size_t out_len);
 
+/**
+ * Compiles the script template of a parsed policy map.
+ *
+ * @param[in] policy
+ *   Pointer to the root node of the policy, as output by parse_policy_map.
+ * @param[out] out
+ *   Pointer to the output buffer.
+ * @param[in] out_len
+ *   Length of the output buffer; MAX_SCRIPT_TEMPLATE_LEN bytes are enough for any supported policy.
+ *
+ * @return the length of the script template on success, -1 on failure (unsupported policy, or
+ *   output buffer too short).
+ */
+int compile_script_template(const policy_node_t *policy, uint8_t *out, size_t out_len);
+
+/**
+ * Compiles the program of a taproot tree (see taptree_op_e), as used by the script template of a tr
+ * with tapscripts.
+ *
+ * @return the length of the program on success, -1 on failure.
+ */
+int compile_taptree_template(const policy_node_tree_t *tree, uint8_t *out, size_t out_len);
+
+/**
+ * Classifies a scriptPubKey with the table of the supported script types; a witness program of any
+ * version is recognized even if its type is not supported.
+ */
+void classify_script(const uint8_t script[], size_t script_len, script_info_t *out);
+
+/**
+ * Returns the script_type_e of a scriptPubKey, or -1 if not one of the supported scripts.
+ */
 int get_script_type(const uint8_t script[], size_t script_len);
 
 #ifndef SKIP_FOR_CMOCKA
@@ -153,6 +422,16 @@ int get_script_address(const uint8_t script[],
                        char *out,
                        size_t out_len);
 
+/**
+ * Same as get_script_address, for a script already classified by classify_script.
+ */
+int get_classified_script_address(const uint8_t script[],
+                                  size_t script_len,
+                                  const script_info_t *info,
+                                  global_context_t *coin_config,
+                                  char *out,
+                                  size_t out_len);
+
 // /**
 //  * TODO: docs
 //  */
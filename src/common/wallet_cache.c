@@ -0,0 +1,80 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#ifdef HAVE_WALLET_CACHE
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <string.h>   // memcpy
+#include <stdbool.h>  // bool
+
+#include "cache.h"
+#include "wallet_cache.h"
+
+typedef struct {
+    uint8_t wallet_id[32];
+} wallet_cache_key_t;
+
+typedef struct {
+    wallet_cache_key_t key;
+    uint8_t wallet_hmac[32];
+    policy_map_wallet_header_t header;
+} wallet_cache_entry_t;
+
+CACHE_DEFINE(G_wallet_cache, wallet_cache_entry_t, WALLET_CACHE_SIZE);
+
+void wallet_cache_reset(void) {
+    cache_reset(&G_wallet_cache);
+}
+
+// constant-time comparison, as the provided hmac is compared against a verified one
+static bool secure_equal(const uint8_t a[static 32], const uint8_t b[static 32]) {
+    uint8_t diff = 0;
+    for (int i = 0; i < 32; i++) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+const policy_map_wallet_header_t *wallet_cache_get(const uint8_t wallet_id[static 32],
+                                                   const uint8_t wallet_hmac[static 32]) {
+    wallet_cache_key_t key;
+    memcpy(key.wallet_id, wallet_id, 32);
+
+    const wallet_cache_entry_t *entry = cache_get(&G_wallet_cache, &key);
+    if (entry == NULL || !secure_equal(entry->wallet_hmac, wallet_hmac)) {
+        return NULL;
+    }
+    return &entry->header;
+}
+
+void wallet_cache_add(const uint8_t wallet_id[static 32],
+                      const uint8_t wallet_hmac[static 32],
+                      const policy_map_wallet_header_t *header) {
+    wallet_cache_key_t key;
+    memcpy(key.wallet_id, wallet_id, 32);
+
+    wallet_cache_entry_t *entry = cache_add(&G_wallet_cache, &key);
+    if (entry == NULL) {
+        return;
+    }
+
+    memcpy(entry->wallet_hmac, wallet_hmac, 32);
+    memcpy(&entry->header, header, sizeof(entry->header));
+}
+
+#endif
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#include "wallet.h"
+#include "../target_config.h"
+
+/*
+  Optional session cache of the headers of the last registered wallet policies that were verified,
+  so that consecutive commands for the same wallet (for example, GET_WALLET_ADDRESS for many
+  address indexes) do not need to fetch the serialized policy from the client and check its hmac
+  again. It is only compiled if HAVE_WALLET_CACHE is defined (build with `make WALLET_CACHE=1`);
+  otherwise, lookups always miss and additions do nothing.
+
+  An entry is identified by the wallet id and by the hmac that was verified for it; only wallets
+  with a valid (hence non-zero) hmac are added. Parsed policies contain pointers into the buffer
+  they are parsed into, so the cache stores the header (that includes the policy map), which is
+  parsed again by the caller; this is pure computation, and much cheaper than the round trips with
+  the client and the derivation of the hmac key.
+
+  Unlike the Merkle and pubkey caches, entries are only valid for an unlocked device: the cache is
+  wiped when the device is locked, and when the app exits.
+*/
+
+/**
+ * Number of entries of the cache.
+ */
+#define WALLET_CACHE_SIZE TARGET_WALLET_CACHE_SIZE
+
+#ifdef HAVE_WALLET_CACHE
+
+/**
+ * Removes all the entries from the cache, wiping their content.
+ */
+void wallet_cache_reset(void);
+
+/**
+ * Looks up a verified wallet policy in the cache.
+ *
+ * @param[in] wallet_id
+ *   Pointer to the 32-bytes id of the wallet.
+ * @param[in] wallet_hmac
+ *   Pointer to the 32-bytes hmac provided for the wallet; compared in constant time.
+ *
+ * @return a pointer to the header of the wallet policy if found, or NULL otherwise. The pointer is
+ * only valid until the next call to wallet_cache_add or wallet_cache_reset.
+ */
+const policy_map_wallet_header_t *wallet_cache_get(const uint8_t wallet_id[static 32],
+                                                   const uint8_t wallet_hmac[static 32]);
+
+/**
+ * Adds a verified wallet policy to the cache, replacing the least recently added entry if the
+ * cache is full. Does nothing if the wallet is already present.
+ *
+ * @param[in] wallet_id
+ *   Pointer to the 32-bytes id of the wallet.
+ * @param[in] wallet_hmac
+ *   Pointer to the 32-bytes hmac of the wallet, that must have been verified by the caller.
+ * @param[in] header
+ *   Pointer to the header of the wallet policy, whose id must be wallet_id.
+ */
+void wallet_cache_add(const uint8_t wallet_id[static 32],
+                      const uint8_t wallet_hmac[static 32],
+                      const policy_map_wallet_header_t *header);
+
+#else
+
+static inline void wallet_cache_reset(void) {
+}
+
+static inline const policy_map_wallet_header_t *wallet_cache_get(
+    const uint8_t wallet_id[static 32],
+    const uint8_t wallet_hmac[static 32]) {
+    (void) wallet_id;
+    (void) wallet_hmac;
+    return NULL;
+}
+
+static inline void wallet_cache_add(const uint8_t wallet_id[static 32],
+                                    const uint8_t wallet_hmac[static 32],
+                                    const policy_map_wallet_header_t *header) {
+    (void) wallet_id;
+    (void) wallet_hmac;
+    (void) header;
+}
+
+#endif
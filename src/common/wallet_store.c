@@ -0,0 +1,119 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#ifdef HAVE_WALLET_STORE
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <string.h>   // memcpy, memcmp
+#include <stdbool.h>  // bool
+
+#ifdef SKIP_FOR_CMOCKA
+// the NVRAM is plain memory in the unit tests, written by their mock of nvm_write
+#define PIC(x)      (x)
+#define NVRAM_CONST
+#else
+#define NVRAM_CONST const
+#endif
+
+#include "wallet_store.h"
+
+#include "os.h"
+
+#ifndef SKIP_FOR_CMOCKA
+#include "../crypto.h"
+#else
+// the crypto helpers are not available when compiling unit tests with CMOCKA; they mock this one
+uint32_t crypto_get_master_key_fingerprint();
+#endif
+
+typedef struct {
+    uint8_t used;
+    uint32_t master_fingerprint;  // of the seed the wallet was registered with
+    uint8_t wallet_id[32];
+    uint8_t wallet_hmac[32];
+    policy_map_wallet_header_t header;
+} wallet_store_entry_t;
+
+typedef struct {
+    wallet_store_entry_t entries[WALLET_STORE_SIZE];
+    uint8_t next_slot;
+} wallet_store_t;
+
+wallet_store_t NVRAM_CONST N_wallet_store_real;
+#define N_wallet_store (*(volatile wallet_store_t *) PIC(&N_wallet_store_real))
+
+// constant-time comparison, as the provided hmac is compared against a verified one
+static bool secure_equal(const uint8_t a[static 32], const uint8_t b[static 32]) {
+    uint8_t diff = 0;
+    for (int i = 0; i < 32; i++) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+// the entries of other seeds (for example, of a passphrase) are ignored
+static const wallet_store_entry_t *find_entry(const uint8_t wallet_id[static 32],
+                                              uint32_t master_fingerprint) {
+    for (size_t i = 0; i < WALLET_STORE_SIZE; i++) {
+        const wallet_store_entry_t *entry =
+            (const wallet_store_entry_t *) &N_wallet_store.entries[i];
+        if (entry->used && entry->master_fingerprint == master_fingerprint &&
+            memcmp(entry->wallet_id, wallet_id, 32) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+const policy_map_wallet_header_t *wallet_store_get(const uint8_t wallet_id[static 32],
+                                                   const uint8_t wallet_hmac[static 32]) {
+    const wallet_store_entry_t *entry =
+        find_entry(wallet_id, crypto_get_master_key_fingerprint());
+    if (entry == NULL || !secure_equal(entry->wallet_hmac, wallet_hmac)) {
+        return NULL;
+    }
+    return &entry->header;
+}
+
+void wallet_store_add(const uint8_t wallet_id[static 32],
+                      const uint8_t wallet_hmac[static 32],
+                      const policy_map_wallet_header_t *header) {
+    uint32_t master_fingerprint = crypto_get_master_key_fingerprint();
+    if (find_entry(wallet_id, master_fingerprint) != NULL) {
+        return;
+    }
+
+    uint8_t slot = N_wallet_store.next_slot;
+    if (slot >= WALLET_STORE_SIZE) {
+        slot = 0;
+    }
+
+    // the entry is prepared in RAM, and written with a single call
+    wallet_store_entry_t entry;
+    entry.used = 1;
+    entry.master_fingerprint = master_fingerprint;
+    memcpy(entry.wallet_id, wallet_id, 32);
+    memcpy(entry.wallet_hmac, wallet_hmac, 32);
+    memcpy(&entry.header, header, sizeof(entry.header));
+    nvm_write((void *) &N_wallet_store.entries[slot], &entry, sizeof(entry));
+
+    uint8_t next_slot = (slot + 1) % WALLET_STORE_SIZE;
+    nvm_write((void *) &N_wallet_store.next_slot, &next_slot, sizeof(next_slot));
+}
+
+#endif
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#include "wallet.h"
+#include "../target_config.h"
+
+/*
+  Optional persistent store, in the NVRAM of the app, of the headers of registered wallet policies.
+  A wallet is only added at REGISTER_WALLET, after the user approved it, if the client asks for it
+  with REGISTER_WALLET_FLAG_STORE; later commands for that wallet (SIGN_PSBT, GET_WALLET_ADDRESS)
+  find it here even after the app is restarted, and do not fetch the serialized policy from the
+  client. It is only compiled if HAVE_WALLET_STORE is defined (build with `make WALLET_STORE=1`);
+  otherwise, lookups always miss and additions do nothing.
+
+  An entry is identified by the wallet id and by its hmac, compared in constant time, and it is
+  bound to the master fingerprint of the seed it was registered with: the NVRAM outlives a change
+  of seed (for example, with a passphrase), so the entries of other seeds are never returned. The
+  hmac of a wallet found in the store is still verified by the commands, like the one of a fetched
+  wallet, before it is added to the session cache (see wallet_cache.h). The oldest entry is
+  replaced once the store is full; each addition costs a write of the NVRAM.
+*/
+
+/**
+ * Number of entries of the store.
+ */
+#define WALLET_STORE_SIZE TARGET_WALLET_STORE_SIZE
+
+#ifdef HAVE_WALLET_STORE
+
+/**
+ * Looks up a registered wallet policy in the store, among the entries of the current seed.
+ *
+ * @param[in] wallet_id
+ *   Pointer to the 32-bytes id of the wallet.
+ * @param[in] wallet_hmac
+ *   Pointer to the 32-bytes hmac provided for the wallet; compared in constant time.
+ *
+ * @return a pointer to the header of the wallet policy in NVRAM if found, or NULL otherwise. The
+ * pointer is only valid until the next call to wallet_store_add.
+ */
+const policy_map_wallet_header_t *wallet_store_get(const uint8_t wallet_id[static 32],
+                                                   const uint8_t wallet_hmac[static 32]);
+
+/**
+ * Adds a registered wallet policy to the store, bound to the current seed, replacing the least
+ * recently added entry if the store is full. Does nothing if the wallet is already present.
+ *
+ * @param[in] wallet_id
+ *   Pointer to the 32-bytes id of the wallet.
+ * @param[in] wallet_hmac
+ *   Pointer to the 32-bytes hmac of the wallet, as computed at registration.
+ * @param[in] header
+ *   Pointer to the header of the wallet policy, whose id must be wallet_id.
+ */
+void wallet_store_add(const uint8_t wallet_id[static 32],
+                      const uint8_t wallet_hmac[static 32],
+                      const policy_map_wallet_header_t *header);
+
+#else
+
+static inline const policy_map_wallet_header_t *wallet_store_get(
+    const uint8_t wallet_id[static 32],
+    const uint8_t wallet_hmac[static 32]) {
+    (void) wallet_id;
+    (void) wallet_hmac;
+    return NULL;
+}
+
+static inline void wallet_store_add(const uint8_t wallet_id[static 32],
+                                    const uint8_t wallet_hmac[static 32],
+                                    const policy_map_wallet_header_t *header) {
+    (void) wallet_id;
+    (void) wallet_hmac;
+    (void) header;
+}
+
+#endif
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdint.h>   // uint*_t
+#include <stddef.h>   // size_t
+#include <stdbool.h>  // bool
+
+#include "../target_config.h"
+
+/*
+  A small cache of the extended pubkeys derived from the seed, identified by their BIP32 path, and
+  of the master key fingerprint. Deriving them requires a full private key derivation (two, for
+  an extended pubkey, in order to compute the parent fingerprint), while the same few keys (the
+  master key, and the account-level keys of the wallets) are needed by most commands.
+
+  Entries only depend on the seed, so they are kept across commands. However, the seed might be
+  different after the device is unlocked again (for example, with a PIN linked to a passphrase);
+  therefore, the cache is wiped when the device is locked, and entries are replaced in round-robin
+  order otherwise. Only paths with at most MAX_BIP32_PATH_STEPS steps are cached.
+*/
+
+/**
+ * Number of entries of the cache.
+ */
+#define XPUB_CACHE_SIZE TARGET_XPUB_CACHE_SIZE
+
+/**
+ * Removes all the entries from the cache, including the master key fingerprint.
+ */
+void xpub_cache_reset(void);
+
+/**
+ * Gets the master key fingerprint, if in the cache.
+ *
+ * @param[out] fingerprint
+ *   Pointer to the output master key fingerprint.
+ *
+ * @return true if the master key fingerprint is in the cache, false otherwise.
+ */
+bool xpub_cache_get_master_fingerprint(uint32_t *fingerprint);
+
+/**
+ * Stores the master key fingerprint in the cache.
+ *
+ * @param[in] fingerprint
+ *   The master key fingerprint.
+ */
+void xpub_cache_set_master_fingerprint(uint32_t fingerprint);
+
+/**
+ * Looks up the extended pubkey at the given path in the cache.
+ *
+ * @param[in] bip32_path
+ *   Pointer to the steps of the BIP32 path.
+ * @param[in] bip32_path_len
+ *   Number of steps of the BIP32 path.
+ * @param[out] parent_fingerprint
+ *   Pointer to the 4-bytes output buffer for the fingerprint of the parent key, in big-endian.
+ * @param[out] chain_code
+ *   Pointer to the 32-bytes output buffer for the chain code.
+ * @param[out] compressed_pubkey
+ *   Pointer to the 33-bytes output buffer for the compressed pubkey.
+ *
+ * @return true if the key was found in the cache, false otherwise.
+ */
+bool xpub_cache_get(const uint32_t bip32_path[],
+                    size_t bip32_path_len,
+                    uint8_t parent_fingerprint[static 4],
+                    uint8_t chain_code[static 32],
+                    uint8_t compressed_pubkey[static 33]);
+
+/**
+ * Adds the extended pubkey at the given path to the cache, replacing the oldest entry if the cache
+ * is full. Does nothing if the key is already present, or if the path is too long.
+ *
+ * @param[in] bip32_path
+ *   Pointer to the steps of the BIP32 path.
+ * @param[in] bip32_path_len
+ *   Number of steps of the BIP32 path.
+ * @param[in] parent_fingerprint
+ *   Pointer to the 4-bytes fingerprint of the parent key, in big-endian.
+ * @param[in] chain_code
+ *   Pointer to the 32-bytes chain code.
+ * @param[in] compressed_pubkey
+ *   Pointer to the 33-bytes compressed pubkey.
+ */
+void xpub_cache_add(const uint32_t bip32_path[],
+                    size_t bip32_path_len,
+                    const uint8_t parent_fingerprint[static 4],
+                    const uint8_t chain_code[static 32],
+                    const uint8_t compressed_pubkey[static 33]);
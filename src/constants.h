@@ -60,7 +60,14 @@
  */
 #define MAX_SERIALIZED_PUBKEY_LENGTH 113
 
+/**
+ * Length of the chunks of a message to sign, sent as the leaves of a Merkle tree; the last chunk
+ * can be shorter.
+ */
+#define MESSAGE_CHUNK_SIZE 64
+
 // SIGHASH flags
+#define SIGHASH_DEFAULT      0x00000000  // only valid for taproot inputs
 #define SIGHASH_ALL          0x00000001
 #define SIGHASH_NONE         0x00000002
 #define SIGHASH_SINGLE       0x00000003
@@ -16,7 +16,7 @@
  *****************************************************************************/
 
 #include <stdint.h>   // uint*_t
-#include <string.h>   // memset, explicit_bzero
+#include <string.h>   // memcmp, memset, explicit_bzero
 #include <stdbool.h>  // bool
 
 #include "os.h"
@@ -24,11 +24,15 @@
 #include "cx_ecfp.h"
 #include "ox_ec.h"
 
+#include "common/account_xpub_cache.h"
 #include "common/base58.h"
 #include "common/bip32.h"
 #include "common/format.h"
+#include "common/private_node_cache.h"
 #include "common/read.h"
+#include "common/symmetric_key_cache.h"
 #include "common/write.h"
+#include "common/xpub_cache.h"
 
 #include "crypto.h"
 
@@ -71,8 +75,27 @@ static const uint8_t secp256k1_sqr_exponent[] = {
     0x3f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xbf, 0xff, 0xff, 0x0c};
 
-/* BIP0341 tags for computing the tagged hashes when tweaking public keys */
-static const uint8_t BIP0341_taptweak_tag[] = {'T', 'a', 'p', 'T', 'w', 'e', 'a', 'k'};
+/* SHA256 hashes of the BIP0341 tags, that prefix (twice) each tagged hash */
+
+// sha256("TapTweak"), used when tweaking keys
+static const uint8_t BIP0341_taptweak_tag_hash[32] = {
+    0xe8, 0x0f, 0xe1, 0x63, 0x9c, 0x9c, 0xa0, 0x50, 0xe3, 0xaf, 0x1b, 0x39, 0xc1, 0x43, 0xc6, 0x3e,
+    0x42, 0x9c, 0xbc, 0xeb, 0x15, 0xd9, 0x40, 0xfb, 0xb5, 0xc5, 0xa1, 0xf4, 0xaf, 0x57, 0xc5, 0xe9};
+
+// sha256("TapSighash"), used when computing the sighash
+const uint8_t BIP0341_tapsighash_tag_hash[32] = {
+    0xf4, 0x0a, 0x48, 0xdf, 0x4b, 0x2a, 0x70, 0xc8, 0xb4, 0x92, 0x4b, 0xf2, 0x65, 0x46, 0x61, 0xed,
+    0x3d, 0x95, 0xfd, 0x66, 0xa3, 0x13, 0xeb, 0x87, 0x23, 0x75, 0x97, 0xc6, 0x28, 0xe4, 0xa0, 0x31};
+
+// sha256("TapLeaf"), used when hashing the leaves of taproot trees
+const uint8_t BIP0341_tapleaf_tag_hash[32] = {
+    0xae, 0xea, 0x8f, 0xdc, 0x42, 0x08, 0x98, 0x31, 0x05, 0x73, 0x4b, 0x58, 0x08, 0x1d, 0x1e, 0x26,
+    0x38, 0xd3, 0x5f, 0x1c, 0xb5, 0x40, 0x08, 0xd4, 0xd3, 0x57, 0xca, 0x03, 0xbe, 0x78, 0xe9, 0xee};
+
+// sha256("TapBranch"), used when hashing the branches of taproot trees
+const uint8_t BIP0341_tapbranch_tag_hash[32] = {
+    0x19, 0x41, 0xa1, 0xf2, 0xe5, 0x6e, 0xb9, 0x5f, 0xa2, 0xa9, 0xf1, 0x94, 0xbe, 0x5c, 0x01, 0xf7,
+    0x21, 0x6f, 0x33, 0xed, 0x82, 0xb0, 0x91, 0x46, 0x34, 0x90, 0xd0, 0x5b, 0xf5, 0x16, 0xa0, 0x15};
 
 static int secp256k1_point(const uint8_t scalar[static 32], uint8_t out[static 65]);
 
@@ -81,10 +104,95 @@ static int secp256k1_point(const uint8_t scalar[static 32], uint8_t out[static 6
  * Returns 0 if point is Infinity, encoding length otherwise.
  */
 static int secp256k1_point(const uint8_t k[static 32], uint8_t out[static 65]) {
+    APP_STATS_INC(ec_scalar_mults);
     memcpy(out, secp256k1_generator, 65);
     return cx_ecfp_scalar_mult(CX_CURVE_SECP256K1, out, 65, k, 32);
 }
 
+// BIP32 CKDpriv for an unhardened child: I = HMAC-SHA512(Key = c_par, Data = ser_P(K_par) ||
+// ser_32(i)), then k_i = parse_256(I_L) + k_par (mod n) and c_i = I_R. The parent's pubkey is
+// given, so no scalar multiplication is needed.
+static int bip32_CKDpriv(const uint8_t parent_private_key[static 32],
+                         const uint8_t parent_chain_code[static 32],
+                         const uint8_t parent_pubkey[static 33],
+                         uint32_t index,
+                         uint8_t child_private_key[static 32],
+                         uint8_t child_chain_code[static 32]) {
+    if (index >= BIP32_FIRST_HARDENED_CHILD) {
+        return -1;  // hardened children need the parent's private key in the hmac data
+    }
+
+    uint8_t I[64];
+    uint8_t tmp[33 + 4];
+    memcpy(tmp, parent_pubkey, 33);
+    write_u32_be(tmp, 33, index);
+    cx_hmac_sha512(parent_chain_code, 32, tmp, sizeof(tmp), I, 64);
+
+    int ret = 0;
+    // fail if I_L is not smaller than the group order n, or if the child is 0; the probability is
+    // < 1/2^127
+    if (cx_math_cmp(I, secp256k1_n, 32) >= 0) {
+        ret = -1;
+    } else {
+        cx_math_addm(child_private_key, I, parent_private_key, secp256k1_n, 32);
+        memcpy(child_chain_code, &I[32], 32);
+        if (cx_math_is_zero(child_private_key, 32)) {
+            ret = -1;
+        }
+    }
+
+    explicit_bzero(I, sizeof(I));
+    return ret;
+}
+
+// Computes the private key and chain code at the path, which MUST end with an unhardened step, from
+// the node at the parent path; the parent node is derived from the seed (and cached), unless it is
+// already in the private node cache.
+static void derive_private_key_from_parent(const uint32_t *bip32_path,
+                                           uint8_t bip32_path_len,
+                                           uint8_t private_key[static 32],
+                                           uint8_t chain_code[static 32]) {
+    struct {
+        uint8_t private_key[32];
+        uint8_t chain_code[32];
+        uint8_t compressed_pubkey[33];
+    } parent;
+
+    if (!private_node_cache_get(bip32_path,
+                                bip32_path_len - 1,
+                                parent.private_key,
+                                parent.chain_code,
+                                parent.compressed_pubkey)) {
+        os_perso_derive_node_bip32(CX_CURVE_256K1,
+                                   bip32_path,
+                                   bip32_path_len - 1,
+                                   parent.private_key,
+                                   parent.chain_code);
+
+        uint8_t uncompressed_pubkey[65];
+        secp256k1_point(parent.private_key, uncompressed_pubkey);
+        crypto_get_compressed_pubkey(uncompressed_pubkey, parent.compressed_pubkey);
+
+        private_node_cache_add(bip32_path,
+                               bip32_path_len - 1,
+                               parent.private_key,
+                               parent.chain_code,
+                               parent.compressed_pubkey);
+    }
+
+    int ret = bip32_CKDpriv(parent.private_key,
+                            parent.chain_code,
+                            parent.compressed_pubkey,
+                            bip32_path[bip32_path_len - 1],
+                            private_key,
+                            chain_code);
+    explicit_bzero(&parent, sizeof(parent));
+
+    if (ret < 0) {
+        THROW(EXCEPTION);
+    }
+}
+
 int crypto_derive_private_key(cx_ecfp_private_key_t *private_key,
                               uint8_t chain_code[static 32],
                               const uint32_t *bip32_path,
@@ -94,13 +202,21 @@ int crypto_derive_private_key(cx_ecfp_private_key_t *private_key,
     int ret = 0;
     BEGIN_TRY {
         TRY {
-            // derive the seed with bip32_path
-
-            os_perso_derive_node_bip32(CX_CURVE_256K1,
-                                       bip32_path,
-                                       bip32_path_len,
-                                       raw_private_key,
-                                       chain_code);
+            // derive the seed with bip32_path; keys at an unhardened step are derived from their
+            // parent, that is shared by the keys of the same account for the same change
+
+            if (bip32_path_len > 0 && bip32_path[bip32_path_len - 1] < BIP32_FIRST_HARDENED_CHILD) {
+                derive_private_key_from_parent(bip32_path,
+                                               bip32_path_len,
+                                               raw_private_key,
+                                               chain_code);
+            } else {
+                os_perso_derive_node_bip32(CX_CURVE_256K1,
+                                           bip32_path,
+                                           bip32_path_len,
+                                           raw_private_key,
+                                           chain_code);
+            }
 
             // new private_key from raw
             cx_ecfp_init_private_key(CX_CURVE_256K1,
@@ -120,30 +236,11 @@ int crypto_derive_private_key(cx_ecfp_private_key_t *private_key,
     return ret;
 }
 
-int bip32_CKDpub(const serialized_extended_pubkey_t *parent,
-                 uint32_t index,
-                 serialized_extended_pubkey_t *child) {
-    PRINT_STACK_POINTER();
-
-    if (index >= BIP32_FIRST_HARDENED_CHILD) {
-        return -1;  // can only derive unhardened children
-    }
-
-    if (parent->depth == 255) {
-        return -2;  // maximum derivation depth reached
-    }
-
-    uint8_t I[64];
-
-    {  // make sure that heavy memory allocations are freed as soon as possible
-
-        uint8_t tmp[33 + 4];
-        memcpy(tmp, parent->compressed_pubkey, 33);
-        write_u32_be(tmp, 33, index);
-
-        cx_hmac_sha512(parent->chain_code, 32, tmp, sizeof(tmp), I, 64);
-    }
-
+// Second part of CKDpub, after I = HMAC-SHA512(Key = c_par, Data = ser_P(K_par) || ser_32(i))
+static int bip32_CKDpub_from_hmac(uint8_t I[static 64],
+                                  const uint8_t parent_pubkey[static 65],
+                                  uint8_t child_chain_code[static 32],
+                                  uint8_t child_pubkey[static 65]) {
     uint8_t *I_L = &I[0];
     uint8_t *I_R = &I[32];
 
@@ -152,6 +249,8 @@ int bip32_CKDpub(const serialized_extended_pubkey_t *parent,
         return -1;
     }
 
+    // child_pubkey (resp. child_chain_code) might overlap with parent_pubkey (resp.
+    // parent_chain_code), so the outputs are only written at the end
     uint8_t child_uncompressed_pubkey[65];
 
     {  // make sure that heavy memory allocations are freed as soon as possible
@@ -159,31 +258,137 @@ int bip32_CKDpub(const serialized_extended_pubkey_t *parent,
         uint8_t P[65];
         secp256k1_point(I_L, P);
 
-        uint8_t K_par[65];
-        crypto_get_uncompressed_pubkey(parent->compressed_pubkey, K_par);
-
         // add K_par
         if (cx_ecfp_add_point(CX_CURVE_SECP256K1,
                               child_uncompressed_pubkey,
                               P,
-                              K_par,
+                              parent_pubkey,
                               sizeof(child_uncompressed_pubkey)) == 0) {
             return -3;  // the point at infinity is not a valid child pubkey (should never happen in
                         // practice)
         }
     }
 
-    memmove(child->version, parent->version, 4);
-    child->depth = parent->depth + 1;
+    memcpy(child_pubkey, child_uncompressed_pubkey, 65);
+    memcpy(child_chain_code, I_R, 32);
+
+    return 0;
+}
+
+int bip32_CKDpub_uncompressed(const uint8_t parent_chain_code[static 32],
+                              const uint8_t parent_pubkey[static 65],
+                              uint32_t index,
+                              uint8_t child_chain_code[static 32],
+                              uint8_t child_pubkey[static 65]) {
+    PRINT_STACK_POINTER();
+
+    if (index >= BIP32_FIRST_HARDENED_CHILD) {
+        return -1;  // can only derive unhardened children
+    }
+
+    uint8_t I[64];
+
+    {  // make sure that heavy memory allocations are freed as soon as possible
+
+        uint8_t tmp[33 + 4];
+        crypto_get_compressed_pubkey(parent_pubkey, tmp);
+        write_u32_be(tmp, 33, index);
+
+        cx_hmac_sha512(parent_chain_code, 32, tmp, sizeof(tmp), I, 64);
+    }
+
+    return bip32_CKDpub_from_hmac(I, parent_pubkey, child_chain_code, child_pubkey);
+}
+
+void bip32_prepare_parent(const uint8_t parent_chain_code[static 32],
+                          const uint8_t parent_pubkey[static 65],
+                          bip32_prepared_parent_t *out) {
+    PRINT_STACK_POINTER();
+
+    // HMAC-SHA512 with a 32-bytes key: the key is zero-padded to the 128-bytes block size
+    uint8_t pad[128];
+
+    memset(pad, 0x36, sizeof(pad));  // ipad
+    for (int i = 0; i < 32; i++) {
+        pad[i] ^= parent_chain_code[i];
+    }
+    cx_sha512_init(&out->inner);
+    crypto_hash_update(&out->inner.header, pad, sizeof(pad));
+
+    // the serialized parent pubkey is the common prefix of the data of all the children
+    uint8_t compressed_pubkey[33];
+    crypto_get_compressed_pubkey(parent_pubkey, compressed_pubkey);
+    crypto_hash_update(&out->inner.header, compressed_pubkey, sizeof(compressed_pubkey));
+
+    memset(pad, 0x5c, sizeof(pad));  // opad
+    for (int i = 0; i < 32; i++) {
+        pad[i] ^= parent_chain_code[i];
+    }
+    cx_sha512_init(&out->outer);
+    crypto_hash_update(&out->outer.header, pad, sizeof(pad));
+
+    memcpy(out->pubkey, parent_pubkey, 65);
+}
+
+int bip32_CKDpub_prepared(const bip32_prepared_parent_t *parent,
+                          uint32_t index,
+                          uint8_t child_chain_code[static 32],
+                          uint8_t child_pubkey[static 65]) {
+    PRINT_STACK_POINTER();
+
+    if (index >= BIP32_FIRST_HARDENED_CHILD) {
+        return -1;  // can only derive unhardened children
+    }
+
+    uint8_t I[64];
+
+    {  // make sure that heavy memory allocations are freed as soon as possible
+        cx_sha512_t hash_context;
+
+        // inner hash: resume after the ipad block and the parent pubkey, and add ser_32(i)
+        memcpy(&hash_context, &parent->inner, sizeof(hash_context));
+        uint8_t index_be[4];
+        write_u32_be(index_be, 0, index);
+        crypto_hash_update(&hash_context.header, index_be, sizeof(index_be));
+        crypto_hash_digest(&hash_context.header, I, 64);
+
+        // outer hash: resume after the opad block, and add the inner hash
+        memcpy(&hash_context, &parent->outer, sizeof(hash_context));
+        crypto_hash_update(&hash_context.header, I, 64);
+        crypto_hash_digest(&hash_context.header, I, 64);
+    }
+
+    return bip32_CKDpub_from_hmac(I, parent->pubkey, child_chain_code, child_pubkey);
+}
+
+int bip32_CKDpub(const serialized_extended_pubkey_t *parent,
+                 uint32_t index,
+                 serialized_extended_pubkey_t *child) {
+    PRINT_STACK_POINTER();
+
+    if (parent->depth == 255) {
+        return -2;  // maximum derivation depth reached
+    }
 
     uint32_t parent_fingerprint = crypto_get_key_fingerprint(parent->compressed_pubkey);
 
+    uint8_t K[65];  // the parent's pubkey, then the child's pubkey
+    if (crypto_get_uncompressed_pubkey(parent->compressed_pubkey, K) < 0) {
+        return -1;
+    }
+
+    int ret = bip32_CKDpub_uncompressed(parent->chain_code, K, index, child->chain_code, K);
+    if (ret < 0) {
+        return ret;
+    }
+
+    memmove(child->version, parent->version, 4);
+    child->depth = parent->depth + 1;
+
     write_u32_be(child->parent_fingerprint, 0, parent_fingerprint);
     write_u32_be(child->child_number, 0, index);
 
-    memcpy(child->chain_code, I_R, 32);
-
-    crypto_get_compressed_pubkey(child_uncompressed_pubkey, child->compressed_pubkey);
+    crypto_get_compressed_pubkey(K, child->compressed_pubkey);
 
     return 0;
 }
@@ -195,6 +400,8 @@ static size_t cx_hash_ripemd160(const uint8_t *in, size_t in_len, uint8_t *out,
     if (out_len < CX_RIPEMD160_SIZE) {
         return 0;
     }
+    cxram_check_overlap(&G_cx, sizeof(cx_ripemd160_t));
+
     cx_ripemd160_init_no_throw((cx_ripemd160_t *) &G_cx);
     cx_ripemd160_update((cx_ripemd160_t *) &G_cx, in, in_len);
     cx_ripemd160_final((cx_ripemd160_t *) &G_cx, out);
@@ -226,30 +433,40 @@ int crypto_get_compressed_pubkey(const uint8_t uncompressed_key[static 65],
     return 0;
 }
 
-int crypto_get_uncompressed_pubkey(const uint8_t compressed_key[static 33],
-                                   uint8_t out[static 65]) {
+// Computes the uncompressed point 0x04 || x || y of secp256k1 with the given x coordinate and the
+// given parity of y (0 for even, 1 for odd). It is allowed to have x == out + 1.
+// Returns -1 if x is not the x coordinate of a point of the curve.
+//
+// As p = 3 (mod 4), sqrt(c) = c^((p+1)/4) (mod p) if c has a square root. The exponentiation is a
+// single call to cx_math_powm, executed by the bignum accelerator of the secure element: computing
+// it with an addition chain (like secp256k1_fe_sqrt in libsecp256k1) would take ~270 separate
+// modular multiplications, each being a syscall, and would therefore be slower.
+static int secp256k1_decompress(const uint8_t x[static 32],
+                                uint8_t y_parity,
+                                uint8_t out[static 65]) {
     PRINT_STACK_POINTER();
 
-    uint8_t prefix = compressed_key[0];
-    if (prefix != 0x02 && prefix != 0x03) {
-        return -1;
-    }
-
-    uint8_t *x = &out[1], *y = &out[1 + 32];
-
-    memmove(x, compressed_key + 1, 32);  // copy x
-
-    // we use y for intermediate results, in order to save memory
+    uint8_t *out_x = out + 1, *y = out + 1 + 32;
+    memmove(out_x, x, 32);
 
+    uint8_t c[32];
     uint8_t e = 3;
-    cx_math_powm(y, x, &e, 1, secp256k1_p, 32);  // tmp = x^3 (mod p)
+    cx_math_powm(c, out_x, &e, 1, secp256k1_p, 32);  // c = x^3 (mod p)
     uint8_t scalar[32] = {0};
     scalar[31] = 7;
-    cx_math_addm(y, y, scalar, secp256k1_p, 32);                      // tmp = x^3 + 7 (mod p)
-    cx_math_powm(y, y, secp256k1_sqr_exponent, 32, secp256k1_p, 32);  // tmp = sqrt(x^3 + 7) (mod p)
+    cx_math_addm(c, c, scalar, secp256k1_p, 32);  // c = x^3 + 7 (mod p)
+
+    cx_math_powm(y, c, secp256k1_sqr_exponent, 32, secp256k1_p, 32);  // y = sqrt(x^3 + 7) (mod p)
+
+    // fail if y * y % p != x^3 + 7, that is, if x^3 + 7 is not a square (mod p); we reuse scalar
+    e = 2;
+    cx_math_powm(scalar, y, &e, 1, secp256k1_p, 32);  // y^2 (mod p)
+    if (cx_math_cmp(scalar, c, 32) != 0) {
+        return -1;
+    }
 
-    // if the prefix and y don't have the same parity, take the opposite root (mod p)
-    if (((prefix ^ y[31]) & 1) != 0) {
+    // if y doesn't have the requested parity, take the opposite root (mod p)
+    if (((y_parity ^ y[31]) & 1) != 0) {
         cx_math_sub(y, secp256k1_p, y, 32);
     }
 
@@ -257,6 +474,18 @@ int crypto_get_uncompressed_pubkey(const uint8_t compressed_key[static 33],
     return 0;
 }
 
+int crypto_get_uncompressed_pubkey(const uint8_t compressed_key[static 33],
+                                   uint8_t out[static 65]) {
+    PRINT_STACK_POINTER();
+
+    uint8_t prefix = compressed_key[0];
+    if (prefix != 0x02 && prefix != 0x03) {
+        return -1;
+    }
+
+    return secp256k1_decompress(compressed_key + 1, prefix & 1, out);
+}
+
 // TODO: missing unit tests
 void crypto_get_checksum(const uint8_t *in, uint16_t in_len, uint8_t out[static 4]) {
     uint8_t buffer[32];
@@ -265,10 +494,29 @@ void crypto_get_checksum(const uint8_t *in, uint16_t in_len, uint8_t out[static
     memmove(out, buffer, 4);
 }
 
-void crypto_get_compressed_pubkey_at_path(const uint32_t bip32_path[],
-                                          uint8_t bip32_path_len,
-                                          uint8_t pubkey[static 33],
-                                          uint8_t chain_code[]) {
+// Looks up the extended pubkey at the given path in the account xpub cache and in the xpub cache
+static bool xpub_caches_get(const uint32_t bip32_path[],
+                            uint8_t bip32_path_len,
+                            uint8_t parent_fingerprint[static 4],
+                            uint8_t chain_code[static 32],
+                            uint8_t compressed_pubkey[static 33]) {
+    return account_xpub_cache_get(bip32_path,
+                                  bip32_path_len,
+                                  parent_fingerprint,
+                                  chain_code,
+                                  compressed_pubkey) ||
+           xpub_cache_get(bip32_path,
+                          bip32_path_len,
+                          parent_fingerprint,
+                          chain_code,
+                          compressed_pubkey);
+}
+
+// Derives the compressed pubkey and the chain code at the given path from the private key
+static void derive_compressed_pubkey_at_path(const uint32_t bip32_path[],
+                                             uint8_t bip32_path_len,
+                                             uint8_t pubkey[static 33],
+                                             uint8_t chain_code[]) {
     struct {
         uint8_t prefix;
         uint8_t raw_public_key[64];
@@ -290,6 +538,7 @@ void crypto_get_compressed_pubkey_at_path(const uint32_t bip32_path[],
             }
 
             // generate corresponding public key
+            APP_STATS_INC(ec_scalar_mults);
             cx_ecfp_generate_pair(CX_CURVE_256K1, &public_key, &private_key, 1);
 
             memmove(keydata.raw_public_key, public_key.W + 1, 64);
@@ -306,6 +555,55 @@ void crypto_get_compressed_pubkey_at_path(const uint32_t bip32_path[],
     END_TRY;
 }
 
+void crypto_get_compressed_pubkey_at_path(const uint32_t bip32_path[],
+                                          uint8_t bip32_path_len,
+                                          uint8_t pubkey[static 33],
+                                          uint8_t chain_code[]) {
+    // only the steps up to the last hardened one need the private key
+    uint8_t prefix_len = bip32_path_len;
+    while (prefix_len > 0 && bip32_path[prefix_len - 1] < BIP32_FIRST_HARDENED_CHILD) {
+        --prefix_len;
+    }
+
+    serialized_extended_pubkey_t xpub;
+    if (prefix_len == bip32_path_len) {
+        if (xpub_caches_get(bip32_path,
+                            bip32_path_len,
+                            xpub.parent_fingerprint,
+                            xpub.chain_code,
+                            xpub.compressed_pubkey)) {
+            memcpy(pubkey, xpub.compressed_pubkey, 33);
+            if (chain_code != NULL) {
+                memcpy(chain_code, xpub.chain_code, 32);
+            }
+            return;
+        }
+        derive_compressed_pubkey_at_path(bip32_path, bip32_path_len, pubkey, chain_code);
+        return;
+    }
+
+    // the key at the end of the hardened prefix (typically, an account) is derived once and
+    // cached; the non-hardened tail is derived from its extended pubkey
+    crypto_get_extended_pubkey_at_path(bip32_path, prefix_len, 0, &xpub);
+
+    uint8_t K[65];
+    if (crypto_get_uncompressed_pubkey(xpub.compressed_pubkey, K) < 0) {
+        derive_compressed_pubkey_at_path(bip32_path, bip32_path_len, pubkey, chain_code);
+        return;
+    }
+    for (uint8_t i = prefix_len; i < bip32_path_len; i++) {
+        if (bip32_CKDpub_uncompressed(xpub.chain_code, K, bip32_path[i], xpub.chain_code, K) < 0) {
+            // invalid child (probability lower than 1/2^127): as in the private derivation
+            derive_compressed_pubkey_at_path(bip32_path, bip32_path_len, pubkey, chain_code);
+            return;
+        }
+    }
+    crypto_get_compressed_pubkey(K, pubkey);
+    if (chain_code != NULL) {
+        memcpy(chain_code, xpub.chain_code, 32);
+    }
+}
+
 uint32_t crypto_get_key_fingerprint(const uint8_t pub_key[static 33]) {
     uint8_t key_rip[20];
     crypto_hash160(pub_key, 33, key_rip);
@@ -314,13 +612,25 @@ uint32_t crypto_get_key_fingerprint(const uint8_t pub_key[static 33]) {
 }
 
 uint32_t crypto_get_master_key_fingerprint() {
+    uint32_t fingerprint;
+    if (xpub_cache_get_master_fingerprint(&fingerprint)) {
+        return fingerprint;
+    }
+
     uint8_t master_pub_key[33];
     uint32_t bip32_path[] = {};
     crypto_get_compressed_pubkey_at_path(bip32_path, 0, master_pub_key, NULL);
-    return crypto_get_key_fingerprint(master_pub_key);
+    fingerprint = crypto_get_key_fingerprint(master_pub_key);
+
+    xpub_cache_set_master_fingerprint(fingerprint);
+    return fingerprint;
 }
 
 void crypto_derive_symmetric_key(const char *label, size_t label_len, uint8_t key[static 32]) {
+    if (symmetric_key_cache_get(label, label_len, key)) {
+        return;
+    }
+
     // TODO: is there a better way?
     //       The label is a byte string in SLIP-0021, but os_perso_derive_node_with_seed_key
     //       accesses the `path` argument as an array of uint32_t, causing a device freeze if memory
@@ -337,46 +647,67 @@ void crypto_derive_symmetric_key(const char *label, size_t label_len, uint8_t ke
                                        NULL,
                                        NULL,
                                        0);
+
+    symmetric_key_cache_set(label, label_len, key);
 }
 
-// TODO: Split serialization from key derivation?
-//       It might be difficult to have a clean API without wasting memory, as the checksum
-//       needs to be concatenated to the data before base58 serialization.
-int get_serialized_extended_pubkey_at_path(const uint32_t bip32_path[],
-                                           uint8_t bip32_path_len,
-                                           uint32_t bip32_pubkey_version,
-                                           char out[static MAX_SERIALIZED_PUBKEY_LENGTH + 1]) {
-    // find parent key's fingerprint and child number
+void crypto_get_extended_pubkey_at_path(const uint32_t bip32_path[],
+                                        uint8_t bip32_path_len,
+                                        uint32_t bip32_pubkey_version,
+                                        serialized_extended_pubkey_t *out) {
+    write_u32_be(out->version, 0, bip32_pubkey_version);
+    out->depth = bip32_path_len;
+    write_u32_be(out->child_number, 0, bip32_path_len > 0 ? bip32_path[bip32_path_len - 1] : 0);
+
+    if (xpub_caches_get(bip32_path,
+                        bip32_path_len,
+                        out->parent_fingerprint,
+                        out->chain_code,
+                        out->compressed_pubkey)) {
+        return;
+    }
+
+    // find parent key's fingerprint
     uint32_t parent_fingerprint = 0;
-    uint32_t child_number = 0;
     if (bip32_path_len > 0) {
         // here we reuse the storage for the parent keys that we will later use
         // for the response, in order to save memory
 
-        uint8_t parent_pubkey[33];
+        uint8_t *parent_pubkey = out->compressed_pubkey;
         crypto_get_compressed_pubkey_at_path(bip32_path, bip32_path_len - 1, parent_pubkey, NULL);
 
         parent_fingerprint = crypto_get_key_fingerprint(parent_pubkey);
-        child_number = bip32_path[bip32_path_len - 1];
     }
+    write_u32_be(out->parent_fingerprint, 0, parent_fingerprint);
+
+    crypto_get_compressed_pubkey_at_path(bip32_path,
+                                         bip32_path_len,
+                                         out->compressed_pubkey,
+                                         out->chain_code);
+
+    // the keys of the standard accounts have their own slots, and do not evict other keys
+    if (!account_xpub_cache_add(bip32_path,
+                                bip32_path_len,
+                                out->parent_fingerprint,
+                                out->chain_code,
+                                out->compressed_pubkey)) {
+        xpub_cache_add(bip32_path,
+                       bip32_path_len,
+                       out->parent_fingerprint,
+                       out->chain_code,
+                       out->compressed_pubkey);
+    }
+}
 
+int serialize_extended_pubkey(const serialized_extended_pubkey_t *ext_pubkey,
+                              char out[static MAX_SERIALIZED_PUBKEY_LENGTH + 1]) {
     struct {
         serialized_extended_pubkey_t ext_pubkey;
         uint8_t checksum[4];
     } ext_pubkey_check;  // extended pubkey and checksum
 
-    serialized_extended_pubkey_t *ext_pubkey = &ext_pubkey_check.ext_pubkey;
-
-    write_u32_be(ext_pubkey->version, 0, bip32_pubkey_version);
-    ext_pubkey->depth = bip32_path_len;
-    write_u32_be(ext_pubkey->parent_fingerprint, 0, parent_fingerprint);
-    write_u32_be(ext_pubkey->child_number, 0, child_number);
-
-    crypto_get_compressed_pubkey_at_path(bip32_path,
-                                         bip32_path_len,
-                                         ext_pubkey->compressed_pubkey,
-                                         ext_pubkey->chain_code);
-    crypto_get_checksum((uint8_t *) ext_pubkey, 78, ext_pubkey_check.checksum);
+    memcpy(&ext_pubkey_check.ext_pubkey, ext_pubkey, sizeof(serialized_extended_pubkey_t));
+    crypto_get_checksum((uint8_t *) &ext_pubkey_check.ext_pubkey, 78, ext_pubkey_check.checksum);
 
     int serialized_pubkey_len =
         base58_encode((uint8_t *) &ext_pubkey_check, 78 + 4, out, MAX_SERIALIZED_PUBKEY_LENGTH);
@@ -387,6 +718,20 @@ int get_serialized_extended_pubkey_at_path(const uint32_t bip32_path[],
     return serialized_pubkey_len;
 }
 
+int get_serialized_extended_pubkey_at_path(const uint32_t bip32_path[],
+                                           uint8_t bip32_path_len,
+                                           uint32_t bip32_pubkey_version,
+                                           char out[static MAX_SERIALIZED_PUBKEY_LENGTH + 1]) {
+    serialized_extended_pubkey_t ext_pubkey;
+
+    crypto_get_extended_pubkey_at_path(bip32_path,
+                                       bip32_path_len,
+                                       bip32_pubkey_version,
+                                       &ext_pubkey);
+
+    return serialize_extended_pubkey(&ext_pubkey, out);
+}
+
 int base58_encode_address(const uint8_t in[20], uint32_t version, char *out, size_t out_len) {
     uint8_t tmp[4 + 20 + 4];  // version + max_in_len + checksum
 
@@ -407,73 +752,55 @@ int base58_encode_address(const uint8_t in[20], uint32_t version, char *out, siz
     return base58_encode(tmp, version_len + 20 + 4, out, out_len);
 }
 
-void crypto_tr_tagged_hash_init(cx_sha256_t *hash_context, const uint8_t *tag, uint16_t tag_len) {
-    // we recycle the input to save memory (will reinit later)
-    cx_sha256_init(hash_context);
+int base58check_decode(const char *in, size_t in_len, uint8_t *out, size_t out_len) {
+    int decoded_len = base58_decode(in, in_len, out, out_len);
+    if (decoded_len < 4) {
+        return -1;
+    }
 
-    uint8_t hashtag[32];
-    crypto_hash_update(&hash_context->header, tag, tag_len);
-    crypto_hash_digest(&hash_context->header, hashtag, sizeof(hashtag));
+    int payload_len = decoded_len - 4;
+    uint8_t checksum[4];
+    crypto_get_checksum(out, payload_len, checksum);
+    if (memcmp(checksum, out + payload_len, 4) != 0) {
+        return -1;
+    }
+    return payload_len;
+}
 
+void crypto_tr_tagged_hash_init(cx_sha256_t *hash_context, const uint8_t tag_hash[static 32]) {
     cx_sha256_init(hash_context);
-    crypto_hash_update(&hash_context->header, hashtag, sizeof(hashtag));
-    crypto_hash_update(&hash_context->header, hashtag, sizeof(hashtag));
+    crypto_hash_update(&hash_context->header, tag_hash, 32);
+    crypto_hash_update(&hash_context->header, tag_hash, 32);
 }
 
-static void crypto_tr_tagged_hash(const uint8_t *tag,
-                                  uint16_t tag_len,
-                                  const uint8_t *data,
-                                  uint16_t data_len,
-                                  uint8_t out[static 32]) {
+// the tweak t = hash_TapTweak(pubkey || h) of BIP0341, where h is the Merkle root (if any)
+static void crypto_tr_taptweak(const uint8_t pubkey[static 32],
+                               const uint8_t *merkle_root,
+                               uint8_t out[static 32]) {
     cx_sha256_t hash_context;
-    cx_sha256_init(&hash_context);
-
-    crypto_tr_tagged_hash_init(&hash_context, tag, tag_len);
+    crypto_tr_tagged_hash_init(&hash_context, BIP0341_taptweak_tag_hash);
 
-    crypto_hash_update(&hash_context.header, data, data_len);
+    crypto_hash_update(&hash_context.header, pubkey, 32);
+    if (merkle_root != NULL) {
+        crypto_hash_update(&hash_context.header, merkle_root, 32);
+    }
     crypto_hash_digest(&hash_context.header, out, 32);
 }
 
+// lift_x of BIP0340: the point with x coordinate x, and even y
 static int crypto_tr_lift_x(const uint8_t x[static 32], uint8_t out[static 65]) {
-    // save memory by reusing output buffer for intermediate results
-    uint8_t *y = out + 1 + 32;
-    // we use the memory for the x-coordinate of the output as a temporary variable
-    uint8_t *c = out + 1;
-
-    uint8_t e = 3;
-    cx_math_powm(c, x, &e, 1, secp256k1_p, 32);  // c = x^3 (mod p)
-    uint8_t scalar[32] = {0};
-    scalar[31] = 7;
-    cx_math_addm(c, c, scalar, secp256k1_p, 32);  // c = x^3 + 7 (mod p)
-
-    cx_math_powm(y, c, secp256k1_sqr_exponent, 32, secp256k1_p, 32);  // y = sqrt(x^3 + 7) (mod p)
-
-    // sanity check: fail if y * y % p != x^3 + 7
-    uint8_t y_2[32];
-    e = 2;
-    cx_math_powm(y_2, y, &e, 1, secp256k1_p, 32);  // y^2 (mod p)
-    if (cx_math_cmp(y_2, c, 32) != 0) {
-        return -1;
-    }
-
-    if (y[31] & 1) {
-        // y must be even: take the negation
-        cx_math_sub(out + 1 + 32, secp256k1_p, y, 32);
-    }
-
-    // add the 0x04 prefix; copy x verbatim
-    out[0] = 0x04;
-    memcpy(out + 1, x, 32);
-
-    return 0;
+    return secp256k1_decompress(x, 0, out);
 }
 
-// Like taproot_tweak_pubkey of BIP0341, with empty string h
+// Like taproot_tweak_pubkey of BIP0341, with h either empty or the Merkle root
 // TODO: should it recycle pubkey also for the output (like crypto_tr_tweak_seckey below)?
-int crypto_tr_tweak_pubkey(uint8_t pubkey[static 32], uint8_t *y_parity, uint8_t out[static 32]) {
+int crypto_tr_tweak_pubkey(uint8_t pubkey[static 32],
+                           const uint8_t *merkle_root,
+                           uint8_t *y_parity,
+                           uint8_t out[static 32]) {
     uint8_t t[32];
 
-    crypto_tr_tagged_hash(BIP0341_taptweak_tag, sizeof(BIP0341_taptweak_tag), pubkey, 32, t);
+    crypto_tr_taptweak(pubkey, merkle_root, t);
 
     // fail if t is not smaller than the curve order
     if (cx_math_cmp(t, secp256k1_n, 32) >= 0) {
@@ -501,8 +828,8 @@ int crypto_tr_tweak_pubkey(uint8_t pubkey[static 32], uint8_t *y_parity, uint8_t
     return 0;
 }
 
-// Like taproot_tweak_seckey of BIP0341, with empty string h
-int crypto_tr_tweak_seckey(uint8_t seckey[static 32]) {
+// Like taproot_tweak_seckey of BIP0341, with h either empty or the Merkle root
+int crypto_tr_tweak_seckey(uint8_t seckey[static 32], const uint8_t *merkle_root) {
     uint8_t P[65];
 
     int ret = 0;
@@ -516,11 +843,9 @@ int crypto_tr_tweak_seckey(uint8_t seckey[static 32]) {
             }
 
             uint8_t t[32];
-            crypto_tr_tagged_hash(BIP0341_taptweak_tag,
-                                  sizeof(BIP0341_taptweak_tag),
-                                  &P[1],  // P[1:33] is x(P)
-                                  32,
-                                  t);
+            crypto_tr_taptweak(&P[1],  // P[1:33] is x(P)
+                               merkle_root,
+                               t);
 
             // fail if t is not smaller than the curve order
             if (cx_math_cmp(t, secp256k1_n, 32) >= 0) {
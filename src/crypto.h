@@ -8,6 +8,7 @@
 #include "cx.h"
 #include "constants.h"
 
+#include "./boilerplate/app_stats.h"
 #include "./common/bip32.h"
 #include "./common/varint.h"
 #include "./common/write.h"
@@ -50,6 +51,80 @@ int crypto_derive_private_key(cx_ecfp_private_key_t *private_key,
                               const uint32_t *bip32_path,
                               uint8_t bip32_path_len);
 
+/**
+ * Derives the unhardened child of an extended pubkey given as an uncompressed point, as in the
+ * BIP32 CKDpub function. Unlike bip32_CKDpub, the parent's point is not decompressed, and the
+ * child's point is returned uncompressed; therefore, the caller can keep the points of a parent
+ * used for many derivations (for example, the /change key of a wallet for consecutive address
+ * indexes), or derive again from the child, without any square root computation. The other
+ * fields of the serialized extended pubkey (depth, parent fingerprint, etc.) are not computed.
+ *
+ * @param[in]  parent_chain_code
+ *   Pointer to the 32-bytes chain code of the parent.
+ * @param[in]  parent_pubkey
+ *   Pointer to the 65-bytes uncompressed pubkey of the parent.
+ * @param[in]  index
+ *   Index of the child to derive. It MUST be not hardened, that is, strictly less than 0x80000000.
+ * @param[out] child_chain_code
+ *   Pointer to the 32-bytes output buffer for the chain code of the child. It can equal
+ * parent_chain_code.
+ * @param[out] child_pubkey
+ *   Pointer to the 65-bytes output buffer for the uncompressed pubkey of the child. It can equal
+ * parent_pubkey.
+ *
+ * @return 0 if success, a negative number on failure.
+ */
+int bip32_CKDpub_uncompressed(const uint8_t parent_chain_code[static 32],
+                              const uint8_t parent_pubkey[static 65],
+                              uint32_t index,
+                              uint8_t child_chain_code[static 32],
+                              uint8_t child_pubkey[static 65]);
+
+/**
+ * A parent extended pubkey prepared for the derivation of many unhardened children: it contains
+ * the state of the inner SHA512 of HMAC-SHA512(Key = chain code, ...) after the ipad block and the
+ * serialized parent pubkey (the same for all the children), and of the outer one after the opad
+ * block. Each child then takes 2 SHA512 compressions instead of 4.
+ */
+typedef struct {
+    cx_sha512_t inner;
+    cx_sha512_t outer;
+    uint8_t pubkey[65];  // uncompressed parent pubkey
+} bip32_prepared_parent_t;
+
+/**
+ * Prepares a parent extended pubkey for bip32_CKDpub_prepared.
+ *
+ * @param[in]  parent_chain_code
+ *   Pointer to the 32-bytes chain code of the parent.
+ * @param[in]  parent_pubkey
+ *   Pointer to the 65-bytes uncompressed pubkey of the parent.
+ * @param[out] out
+ *   Pointer to the prepared parent.
+ */
+void bip32_prepare_parent(const uint8_t parent_chain_code[static 32],
+                          const uint8_t parent_pubkey[static 65],
+                          bip32_prepared_parent_t *out);
+
+/**
+ * Like bip32_CKDpub_uncompressed, but for a parent prepared with bip32_prepare_parent.
+ *
+ * @param[in]  parent
+ *   Pointer to the prepared parent.
+ * @param[in]  index
+ *   Index of the child to derive. It MUST be not hardened, that is, strictly less than 0x80000000.
+ * @param[out] child_chain_code
+ *   Pointer to the 32-bytes output buffer for the chain code of the child.
+ * @param[out] child_pubkey
+ *   Pointer to the 65-bytes output buffer for the uncompressed pubkey of the child.
+ *
+ * @return 0 if success, a negative number on failure.
+ */
+int bip32_CKDpub_prepared(const bip32_prepared_parent_t *parent,
+                          uint32_t index,
+                          uint8_t child_chain_code[static 32],
+                          uint8_t child_pubkey[static 65]);
+
 /**
  * Initialize public key given private key.
  *
@@ -81,6 +156,7 @@ int bip32_CKDpub(const serialized_extended_pubkey_t *parent,
  * @return the return value of cx_hash.
  */
 static inline int crypto_hash_update(cx_hash_t *hash_context, const void *in, size_t in_len) {
+    APP_STATS_ADD(sha256_bytes, in_len);
     return cx_hash(hash_context, 0, in, in_len, NULL, 0);
 }
 
@@ -98,9 +174,36 @@ static inline int crypto_hash_update(cx_hash_t *hash_context, const void *in, si
  * @return the return value of cx_hash.
  */
 static inline int crypto_hash_digest(cx_hash_t *hash_context, uint8_t *out, size_t out_len) {
+    APP_STATS_INC(sha256_digests);
     return cx_hash(hash_context, CX_LAST, NULL, 0, out, out_len);
 }
 
+/**
+ * Saves the intermediate state of a SHA256 computation, so that data shared by several messages can
+ * be absorbed only once, and later resumed with crypto_sha256_restore.
+ *
+ * @param[in] hash_context
+ *   The context of the hash, which must already be initialized.
+ * @param[out] snapshot
+ *   Pointer to the output context where the state is saved.
+ */
+static inline void crypto_sha256_snapshot(const cx_sha256_t *hash_context, cx_sha256_t *snapshot) {
+    memcpy(snapshot, hash_context, sizeof(cx_sha256_t));
+}
+
+/**
+ * Restores the intermediate state of a SHA256 computation previously saved with
+ * crypto_sha256_snapshot. The snapshot is not modified, and can be restored multiple times.
+ *
+ * @param[out] hash_context
+ *   The context of the hash to be overwritten.
+ * @param[in] snapshot
+ *   Pointer to the saved state.
+ */
+static inline void crypto_sha256_restore(cx_sha256_t *hash_context, const cx_sha256_t *snapshot) {
+    memcpy(hash_context, snapshot, sizeof(cx_sha256_t));
+}
+
 /**
  * Convenience wrapper for crypto_hash_update, updating a hash with an uint8_t.
  *
@@ -216,7 +319,7 @@ int crypto_get_compressed_pubkey(const uint8_t uncompressed_key[static 65], uint
  * 0x04. It is allowed to have out == compressed_key, and in that case the computation will be done
  * in-place. Otherwise, the input and output arrays MUST be non-overlapping.
  *
- * @return 0 on success, a negative number on failure.
+ * @return 0 on success, a negative number on failure (also if the key is not a point of the curve).
  */
 int crypto_get_uncompressed_pubkey(const uint8_t compressed_key[static 33], uint8_t out[static 65]);
 
@@ -262,12 +365,46 @@ void crypto_get_compressed_pubkey_at_path(const uint32_t bip32_path[],
 uint32_t crypto_get_key_fingerprint(const uint8_t pub_key[static 33]);
 
 /**
- * Computes the fingerprint of the master key as per BIP32.
+ * Computes the fingerprint of the master key as per BIP32. The result is cached until the device
+ * is locked.
  *
  * @return the fingerprint of the master key.
  */
 uint32_t crypto_get_master_key_fingerprint();
 
+/**
+ * Computes the extended pubkey at a given path. The result is cached until the device is locked,
+ * so that the keys needed by consecutive commands (for example, the account-level keys of a
+ * wallet) are only derived once.
+ *
+ * @param[in]  bip32_path
+ *   Pointer to 32-bit integer input buffer.
+ * @param[in]  bip32_path_len
+ *   Number of BIP32 paths in the input buffer.
+ * @param[in]  bip32_pubkey_version
+ *   Version prefix to use for the pubkey.
+ * @param[out] out
+ *   Pointer to the output serialized extended pubkey.
+ */
+void crypto_get_extended_pubkey_at_path(const uint32_t bip32_path[],
+                                        uint8_t bip32_path_len,
+                                        uint32_t bip32_pubkey_version,
+                                        serialized_extended_pubkey_t *out);
+
+/**
+ * Computes the base58check encoding of an extended pubkey.
+ *
+ * @param[in]  ext_pubkey
+ *   Pointer to the extended pubkey.
+ * @param[out] out
+ *   Pointer to the output buffer, which must be long enough to contain the result (including the
+ * terminating null).
+ *
+ * @return the length of the output pubkey (not including the null character), or -1 on error.
+ */
+int serialize_extended_pubkey(const serialized_extended_pubkey_t *ext_pubkey,
+                              char out[static MAX_SERIALIZED_PUBKEY_LENGTH + 1]);
+
 /**
  * Computes the base58check-encoded extended pubkey at a given path.
  *
@@ -291,6 +428,8 @@ int get_serialized_extended_pubkey_at_path(const uint32_t bip32_path[],
 /**
  * Derives the level-1 symmetric key at the given label using SLIP-0021.
  * Must be wrapped in a TRY/FINALLY block to make sure that the output key is wiped after using it.
+ * The last derived key is kept in the symmetric key cache until the device is locked, so that
+ * deriving it again does not require a derivation from the seed.
  *
  * @param[in]  label
  *   Pointer to the label. The first byte of the label must be 0x00 to comply with SLIP-0021.
@@ -322,30 +461,81 @@ void crypto_derive_symmetric_key(const char *label, size_t label_len, uint8_t ke
 int base58_encode_address(const uint8_t in[20], uint32_t version, char *out, size_t out_len);
 
 /**
- * TODO: docs
+ * Decodes a base58check-encoded string, verifying its checksum (the first 4 bytes of the double
+ * SHA-256 of the payload).
+ *
+ * @param[in]  in
+ *   Pointer to the input string.
+ * @param[in]  in_len
+ *   Length of the input string.
+ * @param[out]  out
+ *   Pointer to the output buffer; it receives the payload followed by the 4-bytes checksum.
+ * @param[in]  out_len
+ *   Length of the output buffer.
+ *
+ * @return the length of the payload (excluding the checksum) on success, -1 on failure (that is,
+ *   if the input is not valid base58, if the output would be longer than out_len, or if the
+ *   checksum does not match).
+ */
+int base58check_decode(const char *in, size_t in_len, uint8_t *out, size_t out_len);
+
+/**
+ * SHA256 hash of the "TapSighash" tag of BIP0341, to be used with crypto_tr_tagged_hash_init.
+ */
+extern const uint8_t BIP0341_tapsighash_tag_hash[32];
+
+/**
+ * SHA256 hash of the "TapLeaf" tag of BIP0341, to be used with crypto_tr_tagged_hash_init.
+ */
+extern const uint8_t BIP0341_tapleaf_tag_hash[32];
+
+/**
+ * SHA256 hash of the "TapBranch" tag of BIP0341, to be used with crypto_tr_tagged_hash_init.
+ */
+extern const uint8_t BIP0341_tapbranch_tag_hash[32];
+
+/**
+ * Initializes the context of a BIP0340 tagged hash, that is, a SHA256 hash computation whose
+ * data is prefixed by sha256(tag) || sha256(tag). The hash of the tag is passed precomputed (the
+ * fixed tags used by the app are hardcoded), as hashing the tag each time would cost one more
+ * SHA256 compression.
+ *
+ * @param[out] hash_context
+ *   Pointer to the SHA256 context to initialize.
+ * @param[in] tag_hash
+ *   Pointer to the 32-bytes SHA256 hash of the tag.
  */
-void crypto_tr_tagged_hash_init(cx_sha256_t *hash_context, const uint8_t *tag, uint16_t tag_len);
+void crypto_tr_tagged_hash_init(cx_sha256_t *hash_context, const uint8_t tag_hash[static 32]);
 
 /**
  * Builds a tweaked public key from a BIP340 public key array.
- * Implementation of taproot_tweak_pubkey of BIP341 with `h` set to the empty byte string.
+ * Implementation of taproot_tweak_pubkey of BIP341, with `h` either the empty byte string or the
+ * Merkle root of the taproot tree.
  *
  * @param[in]  pubkey
  *   Pointer to the 32-byte to be used as public key.
+ * @param[in]  merkle_root
+ *   Pointer to the 32-byte Merkle root of the taproot tree, or NULL if there is no tree.
  * @param[out]  y_parity
  *   Pointer to a variable that will be set to 0/1 according to the parity of th y-coordinate of the
  * final tweaked pubkey.
  * @param[out]  out
  *  Pointer to the a 32-byte array that will contain the x coordinate of the tweaked key.
  */
-int crypto_tr_tweak_pubkey(uint8_t pubkey[static 32], uint8_t *y_parity, uint8_t out[static 32]);
+int crypto_tr_tweak_pubkey(uint8_t pubkey[static 32],
+                           const uint8_t *merkle_root,
+                           uint8_t *y_parity,
+                           uint8_t out[static 32]);
 
 /**
  * Builds a tweaked public key from a BIP340 public key array.
- * Implementation of taproot_tweak_seckey of BIP341 with `h` set to the empty byte string.
+ * Implementation of taproot_tweak_seckey of BIP341, with `h` either the empty byte string or the
+ * Merkle root of the taproot tree.
  *
  * @param[in|out] seckey
  *   Pointer to the 32-byte containing the secret key; it will contain the output tweaked secret
  * key.
+ * @param[in]  merkle_root
+ *   Pointer to the 32-byte Merkle root of the taproot tree, or NULL if there is no tree.
  */
-int crypto_tr_tweak_seckey(uint8_t seckey[static 32]);
+int crypto_tr_tweak_seckey(uint8_t seckey[static 32], const uint8_t *merkle_root);
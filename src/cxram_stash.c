@@ -1,8 +1,16 @@
 #include <stdint.h>
+#include <string.h>
 
 #include "cxram_stash.h"
 #include "cx_ram.h"
 
+#ifdef SKIP_FOR_CMOCKA
+// disable problematic macros when compiling unit tests with CMOCKA
+#define PRINTF(...)
+#else
+#include "os.h"
+#endif
+
 #ifndef G_cx
 // The G_cx symbol is only defined in the sdk if compiled with certain libs are included.
 // This makes sure that the symbol exists nonetheless.
@@ -11,7 +19,8 @@ union cx_u G_cx;
 
 #ifndef USE_CXRAM_SECTION
 
-uint8_t G_cxram_replacement_buffer[1024];
+// word-aligned, like the cxram section, so that it can hold arrays of wider integers
+uint8_t G_cxram_replacement_buffer[CXRAM_STASH_SIZE] __attribute__((aligned(4)));
 
 uint8_t *get_cxram_buffer() {
     return G_cxram_replacement_buffer;
@@ -24,3 +33,53 @@ uint8_t *get_cxram_buffer() {
 }
 
 #endif
+
+// number of bytes of the stash currently allocated, from its beginning
+static size_t G_cxram_used;
+
+void *cxram_alloc(size_t size) {
+    size_t start = (G_cxram_used + 3) & ~(size_t) 3;
+    if (start > CXRAM_STASH_SIZE || size > CXRAM_STASH_SIZE - start) {
+        PRINTF("cxram_alloc: cannot allocate %d bytes\n", (int) size);
+        return NULL;
+    }
+
+    G_cxram_used = start + size;
+    return get_cxram_buffer() + start;
+}
+
+cxram_mark_t cxram_mark(void) {
+    return G_cxram_used;
+}
+
+void cxram_release(cxram_mark_t mark) {
+#ifdef HAVE_CXRAM_CHECK
+    if (mark > G_cxram_used) {
+        PRINTF("cxram_release: the mark %d is after the current position %d\n",
+               (int) mark,
+               (int) G_cxram_used);
+        os_sched_exit(-1);
+    }
+    // any later use of the released regions reads garbage
+    memset(get_cxram_buffer() + mark, 0xA5, G_cxram_used - mark);
+#endif
+    if (mark < G_cxram_used) {
+        G_cxram_used = mark;
+    }
+}
+
+#ifdef HAVE_CXRAM_CHECK
+
+void cxram_check_overlap(const void *ptr, size_t len) {
+    const uint8_t *begin = get_cxram_buffer();
+    const uint8_t *p = (const uint8_t *) ptr;
+    if (p < begin + G_cxram_used && begin < p + len) {
+        PRINTF("cxram_check_overlap: %d bytes at %p overlap with %d allocated bytes\n",
+               (int) len,
+               ptr,
+               (int) G_cxram_used);
+        os_sched_exit(-1);
+    }
+}
+
+#endif
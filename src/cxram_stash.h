@@ -1,14 +1,95 @@
 #pragma once
 
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint*_t
+
 /*
  * Due to lack of available stack on NanoS, we make use of a 1K RAM region that is shared between
  * applications and bolos, and used as temporary memory for cryptographic computations.
  *
  * If USE_CXRAM_SECTION is not set, we define a 1K global buffer, and use that instead.
+ *
+ * The stash is handed out by a bump allocator: cxram_alloc returns word-aligned regions in
+ * order, and cxram_mark/cxram_release free everything allocated after a mark, in the order
+ * opposite to the allocations:
+ *
+ *     cxram_mark_t mark = cxram_mark();
+ *     uint16_t *limbs = cxram_alloc(n * sizeof(uint16_t));
+ *     ...
+ *     cxram_release(mark);
+ *
+ * With USE_CXRAM_SECTION, the stash is the G_cx union, that is also used directly by some of the
+ * hashing functions (and by the SDK); allocations must not be kept across calls to them. Builds
+ * with HAVE_CXRAM_CHECK (all the DEBUG builds) verify this in the direct users of G_cx, and poison
+ * the released regions.
  */
 
+/**
+ * Size of the stash, in bytes.
+ */
+#define CXRAM_STASH_SIZE 1024
+
+/**
+ * A position in the stash, as returned by cxram_mark.
+ */
+typedef size_t cxram_mark_t;
+
 /**
  * Returns the address of the 1K cxram section, or the global 1K replacement stash
  * if USE_CXRAM_SECTION is not set.
+ *
+ * The whole stash is returned, regardless of the allocations; prefer cxram_alloc.
+ */
+uint8_t *get_cxram_buffer();
+
+/**
+ * Allocates a word-aligned region of the stash.
+ *
+ * @param[in] size
+ *   Size of the region, in bytes.
+ *
+ * @return a pointer to the region, or NULL if there is not enough space left in the stash.
+ */
+void *cxram_alloc(size_t size);
+
+/**
+ * Returns the current position of the allocator, to be passed to cxram_release.
+ */
+cxram_mark_t cxram_mark(void);
+
+/**
+ * Frees all the regions allocated after the given mark was taken.
+ *
+ * @param[in] mark
+ *   A mark returned by cxram_mark, not later than the current position.
+ */
+void cxram_release(cxram_mark_t mark);
+
+/**
+ * Frees all the regions of the stash. Called at the beginning of each command.
  */
-uint8_t *get_cxram_buffer();
\ No newline at end of file
+static inline void cxram_reset(void) {
+    cxram_release(0);
+}
+
+#ifdef HAVE_CXRAM_CHECK
+
+/**
+ * Checks that the given memory region does not overlap with any region allocated from the stash,
+ * and halts the app otherwise. Called by the functions that use G_cx directly.
+ *
+ * @param[in] ptr
+ *   Pointer to the beginning of the memory region.
+ * @param[in] len
+ *   Length of the memory region.
+ */
+void cxram_check_overlap(const void *ptr, size_t len);
+
+#else
+
+static inline void cxram_check_overlap(const void *ptr, size_t len) {
+    (void) ptr;
+    (void) len;
+}
+
+#endif
@@ -6,9 +6,21 @@ int semihosted_printf(const char *format, ...);
 
 void print_stack_pointer(const char *file, int line, const char *func_name);
 
+#ifdef HAVE_APP_STATS
+void app_stats_record_stack_pointer(void);
+#endif
+
 // Helper macro
-#ifdef HAVE_PRINT_STACK_POINTER
+#if defined(HAVE_PRINT_STACK_POINTER) && defined(HAVE_APP_STATS)
+#define PRINT_STACK_POINTER()                                \
+    do {                                                     \
+        print_stack_pointer(__FILE__, __LINE__, __func__);   \
+        app_stats_record_stack_pointer();                    \
+    } while (0)
+#elif defined(HAVE_PRINT_STACK_POINTER)
 #define PRINT_STACK_POINTER() print_stack_pointer(__FILE__, __LINE__, __func__)
+#elif defined(HAVE_APP_STATS)
+#define PRINT_STACK_POINTER() app_stats_record_stack_pointer()
 #else
 #define PRINT_STACK_POINTER()
 #endif
\ No newline at end of file
@@ -14,7 +14,9 @@
 // Response: <len = preimage length : 1> <preimage : len>
 #define CCMD_GET_PREIMAGE 0x40
 
-// Request : <GET_MERKLE_LEAF_PROOF : 1> <merkle_root : 32> <tree_size: 4> <leaf_index: 4>
+// Request : <GET_MERKLE_LEAF_PROOF : 1> <merkle_root : 32> <tree_size : var> <leaf_index : var>
+//           <proof_size : 1>
+//           Only the first proof_size hashes of the proof (starting from the leaf) are requested.
 // Response: <leaf_hash: 32> <proof_size: 1> <n_proof_elements: 1> <proof_hash 1: 32> <proof_hash 2:
 // 32> ... <proof_hash n_proof_elements: 32>
 //           If n_proof_elements < proof_size, then subsequent elements will be given as responses
@@ -25,6 +27,35 @@
 // Response: <is_found(0 or 1) : 1> <leaf_index : 4>
 #define CCMD_GET_MERKLE_LEAF_INDEX 0x42
 
+// Request : <CCMD_GET_MERKLE_LEAVES_PROOF : 1> <merkle_root : 32> <tree_size : var>
+//           <first_leaf_index : var> <n_leaves : var>
+//           n_leaves must be a power of 2, and first_leaf_index a multiple of n_leaves; the range of
+//           leaves is truncated at the end of the tree, so that it is always a subtree.
+// Response: <proof_size : 1> <n_elements : 1> <element 1 : 32> ... <element n_elements : 32>
+//           The elements are the hashes of the leaves in the range, followed by the proof_size
+//           hashes of the Merkle proof of the root of the subtree. If n_elements is smaller than
+//           the total, then subsequent elements will be given as responses of
+//           CCMD_GET_MORE_ELEMENTS.
+#define CCMD_GET_MERKLE_LEAVES_PROOF 0x43
+
+// Request : <CCMD_GET_MERKLEIZED_MAP_VALUE : 1> <keys_root : 32> <values_root : 32> <size : var>
+//           <key_hash : 32>
+// Response: <is_found(0 or 1) : 1> <leaf_index : var> <len = value length : var> <value : len>
+//           <proof_size : 1> <key_proof_hash 1 : 32> ... <key_proof_hash proof_size : 32>
+//           <value_proof_hash 1 : 32> ... <value_proof_hash proof_size : 32>
+//           If is_found is 0, the response only contains that byte. The response is a stream of
+//           bytes; bytes that do not fit in the first response will be given as responses of
+//           CCMD_GET_MORE_ELEMENTS, as single-byte elements.
+#define CCMD_GET_MERKLEIZED_MAP_VALUE 0x44
+
+// Request : <CCMD_GET_PREIMAGES : 1> <n_hashes : 1> <hash 1 : 32> ... <hash n_hashes : 32>
+// Response: <len 1 : var> <preimage 1 : len 1> ... <len n_hashes : var>
+//           <preimage n_hashes : len n_hashes>
+//           The preimages are in the same order as the hashes. The response is a stream of bytes;
+//           bytes that do not fit in the first response will be given as responses of
+//           CCMD_GET_MORE_ELEMENTS, as single-byte elements.
+#define CCMD_GET_PREIMAGES 0x45
+
 /* GENERIC/MULTIPURPOSE */
 
 // Used to get additional elements from the host when the required response from an interruption did
@@ -33,3 +64,10 @@
 // Response: <n_elements : 1> <el_len = size of each element: 1> <element 1 : el_len> <element 2 :
 // el_len> ... <element n_elements : el_len>
 #define CCMD_GET_MORE_ELEMENTS 0xA0
+
+// Used to send several requests at once; the responses are used instead of sending the requests.
+// Request : <CCMD_BATCH : 1> <n_requests : 1> <req_len 1 : 1> <request 1 : req_len 1> ...
+//           <req_len n_requests : 1> <request n_requests : req_len n_requests>
+// Response: zero or more entries <req_len : 1> <request : req_len> <resp_len : 1>
+//           <response : resp_len>, with the responses to (a subset of) the requests.
+#define CCMD_BATCH 0xA1
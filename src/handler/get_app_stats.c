@@ -0,0 +1,67 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#ifdef HAVE_APP_STATS
+
+#include <stdint.h>
+#include <string.h>
+
+#include "boilerplate/dispatcher.h"
+#include "boilerplate/sw.h"
+#include "../boilerplate/app_stats.h"
+#include "../common/buffer.h"
+
+#include "get_app_stats.h"
+
+void handler_get_app_stats(dispatcher_context_t *dc) {
+    uint8_t response[7 * 4 + 1 + APP_STATS_MAX_CLIENT_COMMANDS * (1 + 4) + STACK_PROFILE_LEN];
+    buffer_t out = buffer_create(response, sizeof(response));
+
+    buffer_write_u32(&out, G_app_stats.n_interruptions, BE);
+    buffer_write_u32(&out, G_app_stats.bytes_received, BE);
+    buffer_write_u32(&out, G_app_stats.bytes_sent, BE);
+    buffer_write_u32(&out, G_app_stats.sha256_bytes, BE);
+    buffer_write_u32(&out, G_app_stats.sha256_digests, BE);
+    buffer_write_u32(&out, G_app_stats.ec_scalar_mults, BE);
+    buffer_write_u32(&out, app_stats_get_max_stack_depth(), BE);
+
+    buffer_write_u8(&out, G_app_stats.n_client_commands);
+    for (size_t i = 0; i < G_app_stats.n_client_commands; i++) {
+        buffer_write_u8(&out, G_app_stats.client_commands[i].code);
+        buffer_write_u32(&out, G_app_stats.client_commands[i].count, BE);
+    }
+
+#ifdef HAVE_STACK_PROFILE
+    buffer_write_u32(&out, app_stats_get_stack_high_water(), BE);
+    buffer_write_u32(&out, app_stats_get_stack_free(), BE);
+    buffer_write_u16(&out, G_app_stats.deepest_processor_line, BE);
+
+    const char *processor = G_app_stats.deepest_processor != NULL
+                                ? (const char *) PIC(G_app_stats.deepest_processor)
+                                : "";
+    uint8_t processor_len = (uint8_t) strnlen(processor, STACK_PROFILE_MAX_NAME_LEN);
+    buffer_write_u8(&out, processor_len);
+    buffer_write_bytes(&out, (const uint8_t *) processor, processor_len);
+#endif
+
+    // the counters are reset, so that the next command is measured from scratch
+    app_stats_reset();
+
+    SEND_RESPONSE(dc, response, out.offset, SW_OK);
+}
+
+#endif
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "../boilerplate/dispatcher.h"
+
+/**
+ * Returns the instrumentation counters collected since the last call, then resets them. Only
+ * available if the app is compiled with HAVE_APP_STATS.
+ */
+void handler_get_app_stats(dispatcher_context_t *dispatcher_context);
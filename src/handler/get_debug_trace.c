@@ -0,0 +1,78 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#ifdef HAVE_DEBUG_TRACE
+
+#include <stdint.h>
+
+#include "boilerplate/dispatcher.h"
+#include "boilerplate/sw.h"
+#include "../boilerplate/debug_trace.h"
+#include "../common/buffer.h"
+
+#include "get_debug_trace.h"
+
+// Length of an event in the response: tick, id and the two arguments
+#define EVENT_LEN (2 + 1 + 4 + 4)
+
+// Maximum length of the response
+#define MAX_RESPONSE_LEN 200
+
+// incremented at each ticker event, in io.c
+extern uint16_t G_ticks;
+
+void handler_get_debug_trace(dispatcher_context_t *dc) {
+    uint8_t start;
+    if (!buffer_read_u8(&dc->read_buffer, &start)) {
+        SEND_SW(dc, SW_WRONG_DATA_LENGTH);
+        return;
+    }
+
+    size_t count = debug_trace_count();
+    if (start > count) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
+    }
+
+    uint8_t response[MAX_RESPONSE_LEN];
+    buffer_t out = buffer_create(response, sizeof(response));
+
+    buffer_write_u8(&out, (uint8_t) count);
+    buffer_write_u32(&out, debug_trace_dropped(), BE);
+    buffer_write_u16(&out, G_ticks, BE);
+
+    // add as many events as fit in the response
+    size_t i = start;
+    while (i < count && buffer_can_read(&out, EVENT_LEN)) {
+        const debug_trace_entry_t *entry = debug_trace_get(i);
+
+        buffer_write_u16(&out, entry->tick, BE);
+        buffer_write_u8(&out, entry->event);
+        buffer_write_u32(&out, entry->args[0], BE);
+        buffer_write_u32(&out, entry->args[1], BE);
+        ++i;
+    }
+
+    // once the client read the whole trace, the next command is traced from scratch
+    if (i == count) {
+        debug_trace_reset();
+    }
+
+    SEND_RESPONSE(dc, response, out.offset, SW_OK);
+}
+
+#endif
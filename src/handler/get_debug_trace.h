@@ -0,0 +1,10 @@
+#pragma once
+
+#include "../boilerplate/dispatcher.h"
+
+/**
+ * Returns the events of the debug trace, starting from the index in the input data; the trace is
+ * reset once its last event is returned. Only available if the app is compiled with
+ * HAVE_DEBUG_TRACE.
+ */
+void handler_get_debug_trace(dispatcher_context_t *dispatcher_context);
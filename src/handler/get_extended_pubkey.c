@@ -16,22 +16,32 @@
  *****************************************************************************/
 
 #include <stdint.h>
+#include <string.h>
 
 #include "boilerplate/io.h"
 #include "boilerplate/dispatcher.h"
 #include "boilerplate/sw.h"
+#include "../common/account_xpub_cache.h"
 #include "../commands.h"
 #include "../constants.h"
 #include "../crypto.h"
 #include "../ui/display.h"
 #include "../ui/menu.h"
 
+#include "client_commands.h"
+
 extern global_context_t *G_coin_config;
 
 static void ui_action_validate_pubkey(dispatcher_context_t *dc, bool choice);
 
 static void send_response(dispatcher_context_t *dc);
 
+static void yield_next_account_xpub(dispatcher_context_t *dc);
+static void account_xpub_yielded(dispatcher_context_t *dc);
+
+static void yield_next_extended_pubkey(dispatcher_context_t *dc);
+static void extended_pubkey_yielded(dispatcher_context_t *dc);
+
 static bool is_path_safe_for_pubkey_export(const uint32_t bip32_path[],
                                            size_t bip32_path_len,
                                            const uint32_t coin_types[],
@@ -137,7 +147,8 @@ void handler_get_extended_pubkey(dispatcher_context_t *dc) {
         return;
     }
 
-    if (display > 1 || bip32_path_len > MAX_BIP32_PATH_STEPS) {
+    // nothing can be shown on screen during a batch
+    if (display > 1 || (display && dc->is_in_batch()) || bip32_path_len > MAX_BIP32_PATH_STEPS) {
         SEND_SW(dc, SW_INCORRECT_DATA);
         return;
     }
@@ -179,7 +190,7 @@ void handler_get_extended_pubkey(dispatcher_context_t *dc) {
                           state->serialized_pubkey_str,
                           ui_action_validate_pubkey);
     } else {
-        dc->next(send_response);
+        dc_next(dc, send_response);
     }
 }
 
@@ -187,7 +198,7 @@ static void ui_action_validate_pubkey(dispatcher_context_t *dc, bool choice) {
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
     if (choice) {
-        dc->next(send_response);
+        dc_next(dc, send_response);
     } else {
         SEND_SW(dc, SW_DENY);
     }
@@ -202,3 +213,230 @@ static void send_response(dispatcher_context_t *dc) {
 
     SEND_RESPONSE(dc, state->serialized_pubkey_str, strlen(state->serialized_pubkey_str), SW_OK);
 }
+
+void handler_get_account_xpubs(dispatcher_context_t *dc) {
+    get_extended_pubkey_state_t *state = (get_extended_pubkey_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    // Device must be unlocked
+    if (os_global_pin_is_validated() != BOLOS_UX_OK) {
+        SEND_SW(dc, SW_SECURITY_STATUS_NOT_SATISFIED);
+        return;
+    }
+
+    state->account_index = 0;
+    dc_next(dc, yield_next_account_xpub);
+}
+
+// Yields the extended pubkey of the next standard account. In builds with the account xpub cache,
+// only the first command after the device is unlocked derives them.
+static void yield_next_account_xpub(dispatcher_context_t *dc) {
+    get_extended_pubkey_state_t *state = (get_extended_pubkey_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    if (state->account_index == N_STANDARD_ACCOUNTS) {
+        SEND_SW(dc, SW_OK);
+        return;
+    }
+
+    uint32_t bip32_path[MAX_STANDARD_ACCOUNT_PATH_LEN];
+    size_t bip32_path_len = get_standard_account_path(state->account_index,
+                                                      G_coin_config->bip44_coin_type,
+                                                      bip32_path);
+
+    int serialized_pubkey_len =
+        get_serialized_extended_pubkey_at_path(bip32_path,
+                                               bip32_path_len,
+                                               G_coin_config->bip32_pubkey_version,
+                                               state->serialized_pubkey_str);
+    if (serialized_pubkey_len == -1) {
+        SEND_SW(dc, SW_BAD_STATE);
+        return;
+    }
+
+    uint8_t cmd = CCMD_YIELD;
+    dc_add_to_response(dc, &cmd, 1);
+    dc_add_to_response(dc, state->serialized_pubkey_str, serialized_pubkey_len);
+
+    dc_interrupt(dc, account_xpub_yielded);
+}
+
+static void account_xpub_yielded(dispatcher_context_t *dc) {
+    get_extended_pubkey_state_t *state = (get_extended_pubkey_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    ++state->account_index;
+    dc_next(dc, yield_next_account_xpub);
+}
+
+// Reads a path serialized as in GET_EXTENDED_PUBKEY, and checks that it is standard.
+static bool read_safe_path(buffer_t *buffer, uint32_t bip32_path[static MAX_BIP32_PATH_STEPS],
+                           uint8_t *bip32_path_len) {
+    uint32_t coin_types[2] = {G_coin_config->bip44_coin_type, G_coin_config->bip44_coin_type2};
+
+    return buffer_read_u8(buffer, bip32_path_len) && *bip32_path_len <= MAX_BIP32_PATH_STEPS &&
+           buffer_read_bip32_path(buffer, bip32_path, *bip32_path_len) &&
+           is_path_safe_for_pubkey_export(bip32_path, *bip32_path_len, coin_types, 2);
+}
+
+void handler_get_extended_pubkeys(dispatcher_context_t *dc) {
+    get_extended_pubkey_state_t *state = (get_extended_pubkey_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    // Device must be unlocked
+    if (os_global_pin_is_validated() != BOLOS_UX_OK) {
+        SEND_SW(dc, SW_SECURITY_STATUS_NOT_SATISFIED);
+        return;
+    }
+
+    if (!buffer_read_u8(&dc->read_buffer, &state->format)) {
+        SEND_SW(dc, SW_WRONG_DATA_LENGTH);
+        return;
+    }
+
+    // All the paths are validated before yielding any key, as none is shown to the user
+    if (state->format == EXTENDED_PUBKEYS_FORMAT_LIST) {
+        if (!buffer_read_u8(&dc->read_buffer, &state->n_remaining_keys) ||
+            state->n_remaining_keys == 0) {
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
+
+        state->paths_len = (uint8_t) (dc->read_buffer.size - dc->read_buffer.offset);
+        state->paths_offset = 0;
+        memcpy(state->paths, dc->read_buffer.ptr + dc->read_buffer.offset, state->paths_len);
+
+        for (size_t i = 0; i < state->n_remaining_keys; i++) {
+            if (!read_safe_path(&dc->read_buffer, state->bip32_path, &state->bip32_path_len)) {
+                SEND_SW(dc, SW_NOT_SUPPORTED);
+                return;
+            }
+        }
+    } else if (state->format == EXTENDED_PUBKEYS_FORMAT_RANGE) {
+        uint32_t first_child;
+        if (!read_safe_path(&dc->read_buffer, state->bip32_path, &state->bip32_path_len) ||
+            state->bip32_path_len == MAX_BIP32_PATH_STEPS ||
+            !buffer_read_u32(&dc->read_buffer, &first_child, BE) ||
+            !buffer_read_u8(&dc->read_buffer, &state->n_remaining_keys) ||
+            state->n_remaining_keys == 0) {
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
+
+        // the children must be all hardened, or all non-hardened
+        uint32_t last_child = first_child + state->n_remaining_keys - 1;
+        if (last_child < first_child ||
+            (first_child < BIP32_FIRST_HARDENED_CHILD && last_child >= BIP32_FIRST_HARDENED_CHILD)) {
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
+
+        // the constraints on the last step of a standard path are intervals, so it is enough to
+        // check the first and the last child
+        uint32_t coin_types[2] = {G_coin_config->bip44_coin_type, G_coin_config->bip44_coin_type2};
+        uint8_t len = state->bip32_path_len + 1;
+        state->bip32_path[len - 1] = last_child;
+        bool is_safe = is_path_safe_for_pubkey_export(state->bip32_path, len, coin_types, 2);
+        state->bip32_path[len - 1] = first_child;
+        if (!is_safe ||
+            !is_path_safe_for_pubkey_export(state->bip32_path, len, coin_types, 2)) {
+            SEND_SW(dc, SW_NOT_SUPPORTED);
+            return;
+        }
+        state->bip32_path_len = len;
+    } else {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
+    }
+
+    if (buffer_can_read(&dc->read_buffer, 1)) {
+        SEND_SW(dc, SW_WRONG_DATA_LENGTH);
+        return;
+    }
+
+    dc_next(dc, yield_next_extended_pubkey);
+}
+
+// Computes the extended pubkey at a path. The key at the hardened prefix of the path is derived from
+// the seed, unless it is in the xpub cache (as it is for the next paths with the same prefix); the
+// non-hardened steps are then derived from it with CKDpub, which is much cheaper.
+static int get_extended_pubkey_from_hardened_prefix(const uint32_t bip32_path[],
+                                                    uint8_t bip32_path_len,
+                                                    serialized_extended_pubkey_t *out) {
+    uint8_t prefix_len = bip32_path_len;
+    while (prefix_len > 0 && bip32_path[prefix_len - 1] < BIP32_FIRST_HARDENED_CHILD) {
+        --prefix_len;
+    }
+
+    crypto_get_extended_pubkey_at_path(bip32_path,
+                                       prefix_len,
+                                       G_coin_config->bip32_pubkey_version,
+                                       out);
+
+    for (uint8_t i = prefix_len; i < bip32_path_len; i++) {
+        if (bip32_CKDpub(out, bip32_path[i], out) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void yield_next_extended_pubkey(dispatcher_context_t *dc) {
+    get_extended_pubkey_state_t *state = (get_extended_pubkey_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    if (state->n_remaining_keys == 0) {
+        SEND_SW(dc, SW_OK);
+        return;
+    }
+
+    if (state->format == EXTENDED_PUBKEYS_FORMAT_LIST) {
+        // the paths were already validated
+        buffer_t paths = buffer_create(state->paths, state->paths_len);
+        buffer_seek_set(&paths, state->paths_offset);
+        if (!buffer_read_u8(&paths, &state->bip32_path_len) ||
+            !buffer_read_bip32_path(&paths, state->bip32_path, state->bip32_path_len)) {
+            SEND_SW(dc, SW_BAD_STATE);  // unexpected
+            return;
+        }
+        state->paths_offset = (uint8_t) paths.offset;
+    }
+
+    serialized_extended_pubkey_t ext_pubkey;
+    if (get_extended_pubkey_from_hardened_prefix(state->bip32_path,
+                                                 state->bip32_path_len,
+                                                 &ext_pubkey) < 0) {
+        SEND_SW(dc, SW_BAD_STATE);
+        return;
+    }
+
+    int serialized_pubkey_len =
+        serialize_extended_pubkey(&ext_pubkey, state->serialized_pubkey_str);
+    if (serialized_pubkey_len == -1) {
+        SEND_SW(dc, SW_BAD_STATE);
+        return;
+    }
+
+    uint8_t cmd = CCMD_YIELD;
+    dc_add_to_response(dc, &cmd, 1);
+    dc_add_to_response(dc, state->serialized_pubkey_str, serialized_pubkey_len);
+
+    dc_interrupt(dc, extended_pubkey_yielded);
+}
+
+static void extended_pubkey_yielded(dispatcher_context_t *dc) {
+    get_extended_pubkey_state_t *state = (get_extended_pubkey_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    if (state->format == EXTENDED_PUBKEYS_FORMAT_RANGE) {
+        ++state->bip32_path[state->bip32_path_len - 1];
+    }
+    --state->n_remaining_keys;
+    dc_next(dc, yield_next_extended_pubkey);
+}
@@ -3,9 +3,37 @@
 #include "../common/bip32.h"
 #include "../boilerplate/dispatcher.h"
 
+// values of the format of GET_EXTENDED_PUBKEYS
+#define EXTENDED_PUBKEYS_FORMAT_LIST  0  // a list of paths
+#define EXTENDED_PUBKEYS_FORMAT_RANGE 1  // a base path, and a range of children
+
 typedef struct {
     machine_context_t ctx;
     char serialized_pubkey_str[MAX_SERIALIZED_PUBKEY_LENGTH + 1];
+    uint8_t account_index;  // GET_ACCOUNT_XPUBS: index of the next standard account to yield
+
+    // GET_EXTENDED_PUBKEYS
+    uint8_t format;
+    uint8_t n_remaining_keys;
+    // EXTENDED_PUBKEYS_FORMAT_LIST: the serialized paths not yielded yet
+    uint8_t paths_len;
+    uint8_t paths_offset;
+    uint8_t paths[255];
+    // EXTENDED_PUBKEYS_FORMAT_RANGE: the path of the next child to yield
+    uint8_t bip32_path_len;
+    uint32_t bip32_path[MAX_BIP32_PATH_STEPS];
 } get_extended_pubkey_state_t;
 
 void handler_get_extended_pubkey(dispatcher_context_t *dispatcher_context);
+
+/**
+ * Yields the extended pubkeys of all the standard accounts (see account_xpub_cache.h), without
+ * showing them.
+ */
+void handler_get_account_xpubs(dispatcher_context_t *dispatcher_context);
+
+/**
+ * Yields the extended pubkeys at a list of standard paths, or at a range of children of a path,
+ * without showing them.
+ */
+void handler_get_extended_pubkeys(dispatcher_context_t *dispatcher_context);
@@ -0,0 +1,85 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#ifdef HAVE_PROCESSOR_TRACE
+
+#include <stdint.h>
+#include <string.h>
+
+#include "boilerplate/dispatcher.h"
+#include "boilerplate/sw.h"
+#include "../boilerplate/processor_trace.h"
+#include "../common/buffer.h"
+
+#include "get_processor_trace.h"
+
+// Maximum length of the name of the processors in the response
+#define MAX_PROCESSOR_NAME_LEN 32
+
+// Maximum length of the response
+#define MAX_RESPONSE_LEN 200
+
+// incremented at each ticker event, in io.c
+extern uint16_t G_ticks;
+
+void handler_get_processor_trace(dispatcher_context_t *dc) {
+    uint8_t start;
+    if (!buffer_read_u8(&dc->read_buffer, &start)) {
+        SEND_SW(dc, SW_WRONG_DATA_LENGTH);
+        return;
+    }
+
+    size_t count = processor_trace_count();
+    if (start > count) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
+    }
+
+    uint8_t response[MAX_RESPONSE_LEN];
+    buffer_t out = buffer_create(response, sizeof(response));
+
+    buffer_write_u8(&out, (uint8_t) count);
+    buffer_write_u32(&out, processor_trace_dropped(), BE);
+    buffer_write_u16(&out, G_ticks, BE);
+
+    // add as many entries as fit in the response
+    size_t i = start;
+    while (i < count) {
+        const processor_trace_entry_t *entry = processor_trace_get(i);
+
+        const char *func = entry->func != NULL ? (const char *) PIC(entry->func) : "";
+        uint8_t func_len = (uint8_t) strnlen(func, MAX_PROCESSOR_NAME_LEN);
+        if (!buffer_can_read(&out, 2 + 2 + 1 + func_len)) {
+            break;
+        }
+
+        buffer_write_u16(&out, entry->tick, BE);
+        buffer_write_u16(&out, entry->line, BE);
+        buffer_write_u8(&out, func_len);
+        buffer_write_bytes(&out, (const uint8_t *) func, func_len);
+        ++i;
+    }
+
+    // once the client read the whole trace, the next command is traced from scratch
+    if (i == count) {
+        processor_trace_reset();
+    }
+
+    SEND_RESPONSE(dc, response, out.offset, SW_OK);
+}
+
+#endif
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "../boilerplate/dispatcher.h"
+
+/**
+ * Returns the entries of the processor trace, starting from the index in P1; the trace is reset
+ * once its last entry is returned. Only available if the app is compiled with HAVE_PROCESSOR_TRACE.
+ */
+void handler_get_processor_trace(dispatcher_context_t *dispatcher_context);
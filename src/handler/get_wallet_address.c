@@ -25,6 +25,8 @@
 #include "../common/read.h"
 #include "../common/segwit_addr.h"
 #include "../common/wallet.h"
+#include "../common/wallet_cache.h"
+#include "../common/wallet_store.h"
 #include "../commands.h"
 #include "../constants.h"
 #include "../crypto.h"
@@ -33,6 +35,7 @@
 
 #include "lib/policy.h"
 #include "lib/get_preimage.h"
+#include "lib/stream_wallet_policy.h"
 
 #include "get_wallet_address.h"
 #include "client_commands.h"
@@ -42,56 +45,96 @@ extern global_context_t *G_coin_config;
 static void ui_action_validate_address(dispatcher_context_t *dc, bool accepted);
 
 static void compute_address(dispatcher_context_t *dc);
+static void yield_next_address(dispatcher_context_t *dc);
+static void address_yielded(dispatcher_context_t *dc);
 
-void handler_get_wallet_address(dispatcher_context_t *dc) {
-    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
-
+// Reads the optional id and hmac of the compiled form of the wallet policy, at the end of the input
+// data. Returns true on success; otherwise, the status word was already sent.
+static bool read_compiled_policy_args(dispatcher_context_t *dc) {
     get_wallet_address_state_t *state = (get_wallet_address_state_t *) &G_command_state;
 
-    // Device must be unlocked
-    if (os_global_pin_is_validated() != BOLOS_UX_OK) {
-        SEND_SW(dc, SW_SECURITY_STATUS_NOT_SATISFIED);
-        return;
+    state->use_compiled_policy = buffer_can_read(&dc->read_buffer, 1);
+    if (!state->use_compiled_policy) {
+        return true;
     }
 
-    if (!buffer_read_u8(&dc->read_buffer, &state->display_address) ||
-        !buffer_read_bytes(&dc->read_buffer, state->wallet_id, 32) ||
-        !buffer_read_bytes(&dc->read_buffer, state->wallet_hmac, 32)) {
+    if (!buffer_read_bytes(&dc->read_buffer, state->compiled_policy_id, 32) ||
+        !buffer_read_bytes(&dc->read_buffer, state->compiled_policy_hmac, 32) ||
+        buffer_can_read(&dc->read_buffer, 1)) {
         SEND_SW(dc, SW_WRONG_DATA_LENGTH);
-        return;
+        return false;
     }
+    return true;
+}
 
-    // change
-    if (!buffer_read_u8(&dc->read_buffer, &state->is_change)) {
-        SEND_SW(dc, SW_WRONG_DATA_LENGTH);
-        return;
-    }
-    if (state->is_change != 0 && state->is_change != 1) {
+// Fetches the compiled form of the registered wallet policy, and verifies its hmac; the wallet
+// policy itself is neither fetched nor parsed, and its script template is not compiled again.
+// Returns true on success; otherwise, the status word was already sent.
+static bool load_compiled_wallet_policy(dispatcher_context_t *dc) {
+    get_wallet_address_state_t *state = (get_wallet_address_state_t *) &G_command_state;
+
+    int compiled_policy_len = call_get_preimage(dc,
+                                                state->compiled_policy_id,
+                                                state->compiled_policy,
+                                                sizeof(state->compiled_policy));
+    if (compiled_policy_len < 0) {
         SEND_SW(dc, SW_INCORRECT_DATA);
-        return;
+        return false;
     }
 
-    // address index
-    if (!buffer_read_u32(&dc->read_buffer, &state->address_index, BE)) {
-        SEND_SW(dc, SW_WRONG_DATA_LENGTH);
-        return;
+    if (!check_compiled_policy_hmac(state->compiled_policy_id, state->compiled_policy_hmac)) {
+        PRINTF("Incorrect hmac of the compiled policy\n");
+        SEND_SW(dc, SW_SIGNATURE_FAIL);
+        return false;
     }
 
-    // Fetch the serialized wallet policy from the client
-    int serialized_wallet_policy_len = call_get_preimage(dc,
-                                                         state->wallet_id,
-                                                         state->serialized_wallet_policy,
-                                                         sizeof(state->serialized_wallet_policy));
-    if (serialized_wallet_policy_len < 0) {
+    buffer_t compiled_policy_buf = buffer_create(state->compiled_policy, compiled_policy_len);
+    state->script_template_len = read_compiled_policy(&compiled_policy_buf,
+                                                      &state->wallet_header,
+                                                      state->computed_wallet_id,
+                                                      state->script_template,
+                                                      sizeof(state->script_template));
+    if (state->script_template_len < 0 ||
+        memcmp(state->wallet_id, state->computed_wallet_id, sizeof(state->wallet_id)) != 0) {
         SEND_SW(dc, SW_INCORRECT_DATA);
-        return;
+        return false;
     }
 
-    buffer_t serialized_wallet_policy_buf =
-        buffer_create(state->serialized_wallet_policy, serialized_wallet_policy_len);
-    if ((read_policy_map_wallet(&serialized_wallet_policy_buf, &state->wallet_header)) < 0) {
-        SEND_SW(dc, SW_INCORRECT_DATA);
-        return;
+    memcpy(state->wallet_header_keys_info_merkle_root,
+           state->wallet_header.keys_info_merkle_root,
+           sizeof(state->wallet_header.keys_info_merkle_root));
+    state->wallet_header_n_keys = state->wallet_header.n_keys;
+
+    state->is_wallet_canonical = false;
+    return true;
+}
+
+// Fetches and validates the wallet policy whose id and hmac are in the state, and parses it. For
+// default wallets, max_address_index is the largest address index that will be derived.
+// Returns true on success; otherwise, the status word was already sent.
+static bool load_wallet_policy(dispatcher_context_t *dc, uint32_t max_address_index) {
+    get_wallet_address_state_t *state = (get_wallet_address_state_t *) &G_command_state;
+
+    if (state->use_compiled_policy) {
+        return load_compiled_wallet_policy(dc);
+    }
+
+    // A registered wallet that was already verified in this session is found in the cache, and
+    // one that was kept at registration in the store of the device, whose hmac is still verified
+    const policy_map_wallet_header_t *cached_header =
+        wallet_cache_get(state->wallet_id, state->wallet_hmac);
+    const policy_map_wallet_header_t *stored_header =
+        cached_header == NULL ? wallet_store_get(state->wallet_id, state->wallet_hmac) : NULL;
+    if (cached_header != NULL || stored_header != NULL) {
+        memcpy(&state->wallet_header,
+               cached_header != NULL ? cached_header : stored_header,
+               sizeof(state->wallet_header));
+    } else {
+        // Fetch the serialized wallet policy from the client, parsing it while it is received
+        if (call_stream_wallet_policy(dc, state->wallet_id, &state->wallet_header) < 0) {
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return false;
+        }
     }
 
     memcpy(state->wallet_header_keys_info_merkle_root,
@@ -106,7 +149,15 @@ void handler_get_wallet_address(dispatcher_context_t *dc) {
                          state->wallet_policy_map_bytes,
                          sizeof(state->wallet_policy_map_bytes)) < 0) {
         SEND_SW(dc, SW_INCORRECT_DATA);
-        return;
+        return false;
+    }
+
+    state->script_template_len = compile_script_template(&state->wallet_policy_map,
+                                                         state->script_template,
+                                                         sizeof(state->script_template));
+    if (state->script_template_len < 0) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return false;
     }
 
     // the binary OR of all the hmac bytes (so == 0 iff the hmac is identically 0)
@@ -121,59 +172,33 @@ void handler_get_wallet_address(dispatcher_context_t *dc) {
         if (state->address_type == -1) {
             PRINTF("Non-standard policy, and no hmac provided\n");
             SEND_SW(dc, SW_SIGNATURE_FAIL);
-            return;
+            return false;
         }
 
         if (state->wallet_header.n_keys != 1) {
             PRINTF("Standard wallets must have exactly 1 key\n");
             SEND_SW(dc, SW_INCORRECT_DATA);
-            return;
+            return false;
         }
 
         // we check if the key is indeed internal
         uint32_t master_key_fingerprint = crypto_get_master_key_fingerprint();
 
-        uint8_t key_info_str[MAX_POLICY_KEY_INFO_LEN];
-        int key_info_len = call_get_merkle_leaf_element(dc,
-                                                        state->wallet_header_keys_info_merkle_root,
-                                                        state->wallet_header_n_keys,
-                                                        0,  // only one key
-                                                        key_info_str,
-                                                        sizeof(key_info_str));
-        if (key_info_len < 0) {
-            SEND_SW(dc, SW_INCORRECT_DATA);
-            return;
-        }
-
-        // Make a sub-buffer for the pubkey info
-        buffer_t key_info_buffer = buffer_create(key_info_str, key_info_len);
-
         policy_map_key_info_t key_info;
-        if (parse_policy_map_key_info(&key_info_buffer, &key_info) == -1) {
-            SEND_SW(dc, SW_INCORRECT_DATA);
-            return;
-        }
-
-        if (read_u32_be(key_info.master_key_fingerprint, 0) != master_key_fingerprint) {
+        if (get_policy_key_info(dc,
+                                state->wallet_header_keys_info_merkle_root,
+                                state->wallet_header_n_keys,
+                                0,  // only one key
+                                &key_info) < 0) {
             SEND_SW(dc, SW_INCORRECT_DATA);
-            return;
-        }
-
-        // generate pubkey and check if it matches
-        char pubkey_derived[MAX_SERIALIZED_PUBKEY_LENGTH + 1];
-        int serialized_pubkey_len =
-            get_serialized_extended_pubkey_at_path(key_info.master_key_derivation,
-                                                   key_info.master_key_derivation_len,
-                                                   G_coin_config->bip32_pubkey_version,
-                                                   pubkey_derived);
-        if (serialized_pubkey_len == -1) {
-            SEND_SW(dc, SW_BAD_STATE);
-            return;
+            return false;
         }
 
-        if (strncmp(key_info.ext_pubkey, pubkey_derived, MAX_SERIALIZED_PUBKEY_LENGTH) != 0) {
+        if (!is_policy_key_internal(&key_info,
+                                    master_key_fingerprint,
+                                    G_coin_config->bip32_pubkey_version)) {
             SEND_SW(dc, SW_INCORRECT_DATA);
-            return;
+            return false;
         }
 
         // check if derivation path is indeed standard
@@ -183,7 +208,7 @@ void handler_get_wallet_address(dispatcher_context_t *dc) {
 
         if (key_info.master_key_derivation_len != 3) {
             SEND_SW(dc, SW_INCORRECT_DATA);
-            return;
+            return false;
         }
 
         uint32_t coin_types[2] = {G_coin_config->bip44_coin_type, G_coin_config->bip44_coin_type2};
@@ -193,21 +218,33 @@ void handler_get_wallet_address(dispatcher_context_t *dc) {
             bip32_path[i] = key_info.master_key_derivation[i];
         }
         bip32_path[3] = state->is_change ? 1 : 0;
-        bip32_path[4] = state->address_index;
+        bip32_path[4] = max_address_index;
 
         if (!is_address_path_standard(bip32_path, 5, bip44_purpose, coin_types, 2, -1)) {
             SEND_SW(dc, SW_INCORRECT_DATA);
-            return;
+            return false;
+        }
+
+        // the only key is ours: its /change child is derived from our own account node, so that
+        // computing the addresses does not fetch the key again
+        if (!cache_internal_policy_key(state->wallet_header_keys_info_merkle_root,
+                                       state->wallet_header_n_keys,
+                                       0,
+                                       &key_info,
+                                       state->is_change,
+                                       G_coin_config->bip32_pubkey_version)) {
+            SEND_SW(dc, SW_BAD_STATE);
+            return false;
         }
 
         state->is_wallet_canonical = true;
     } else {
-        // Verify hmac
+        // Verify hmac (already verified for cached wallets)
 
-        if (!check_wallet_hmac(state->wallet_id, state->wallet_hmac)) {
+        if (cached_header == NULL && !check_wallet_hmac(state->wallet_id, state->wallet_hmac)) {
             PRINTF("Incorrect hmac\n");
             SEND_SW(dc, SW_SIGNATURE_FAIL);
-            return;
+            return false;
         }
 
         state->is_wallet_canonical = false;
@@ -218,10 +255,61 @@ void handler_get_wallet_address(dispatcher_context_t *dc) {
 
     if (memcmp(state->wallet_id, state->computed_wallet_id, sizeof(state->wallet_id)) != 0) {
         SEND_SW(dc, SW_INCORRECT_DATA);  // TODO: more specific error code
+        return false;
+    }
+
+    if (!state->is_wallet_canonical && cached_header == NULL) {
+        wallet_cache_add(state->wallet_id, state->wallet_hmac, &state->wallet_header);
+    }
+
+    return true;
+}
+
+void handler_get_wallet_address(dispatcher_context_t *dc) {
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    get_wallet_address_state_t *state = (get_wallet_address_state_t *) &G_command_state;
+
+    // Device must be unlocked
+    if (os_global_pin_is_validated() != BOLOS_UX_OK) {
+        SEND_SW(dc, SW_SECURITY_STATUS_NOT_SATISFIED);
         return;
     }
 
-    dc->next(compute_address);
+    if (!buffer_read_u8(&dc->read_buffer, &state->display_address) ||
+        !buffer_read_bytes(&dc->read_buffer, state->wallet_id, 32) ||
+        !buffer_read_bytes(&dc->read_buffer, state->wallet_hmac, 32)) {
+        SEND_SW(dc, SW_WRONG_DATA_LENGTH);
+        return;
+    }
+
+    // nothing can be shown on screen during a batch
+    if (state->display_address != 0 && dc->is_in_batch()) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
+    }
+
+    // change
+    if (!buffer_read_u8(&dc->read_buffer, &state->is_change)) {
+        SEND_SW(dc, SW_WRONG_DATA_LENGTH);
+        return;
+    }
+    if (state->is_change != 0 && state->is_change != 1) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
+    }
+
+    // address index
+    if (!buffer_read_u32(&dc->read_buffer, &state->address_index, BE)) {
+        SEND_SW(dc, SW_WRONG_DATA_LENGTH);
+        return;
+    }
+
+    if (!read_compiled_policy_args(dc) || !load_wallet_policy(dc, state->address_index)) {
+        return;
+    }
+
+    dc_next(dc, compute_address);
 }
 
 // stack-intensive, split from the previous function to optimize stack usage
@@ -232,14 +320,16 @@ static void compute_address(dispatcher_context_t *dc) {
 
     buffer_t script_buf = buffer_create(state->script, sizeof(state->script));
 
-    int script_len = call_get_wallet_script(dc,
-                                            &state->wallet_policy_map,
-                                            state->wallet_header_keys_info_merkle_root,
-                                            state->wallet_header_n_keys,
-                                            state->is_change,
-                                            state->address_index,
-                                            &script_buf,
-                                            NULL);
+    int script_len =
+        call_get_wallet_script_from_template(dc,
+                                             state->script_template,
+                                             state->script_template_len,
+                                             state->wallet_header_keys_info_merkle_root,
+                                             state->wallet_header_n_keys,
+                                             state->is_change,
+                                             state->address_index,
+                                             &script_buf,
+                                             NULL);
     if (script_len < 0) {
         SEND_SW(dc, SW_BAD_STATE);  // unexpected
         return;
@@ -280,3 +370,118 @@ static void ui_action_validate_address(dispatcher_context_t *dc, bool accepted)
 
     dc->run();
 }
+
+void handler_get_wallet_addresses(dispatcher_context_t *dc) {
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    get_wallet_address_state_t *state = (get_wallet_address_state_t *) &G_command_state;
+
+    // Device must be unlocked
+    if (os_global_pin_is_validated() != BOLOS_UX_OK) {
+        SEND_SW(dc, SW_SECURITY_STATUS_NOT_SATISFIED);
+        return;
+    }
+
+    if (!buffer_read_u8(&dc->read_buffer, &state->output_format) ||
+        !buffer_read_bytes(&dc->read_buffer, state->wallet_id, 32) ||
+        !buffer_read_bytes(&dc->read_buffer, state->wallet_hmac, 32) ||
+        !buffer_read_u8(&dc->read_buffer, &state->is_change) ||
+        !buffer_read_u32(&dc->read_buffer, &state->address_index, BE) ||
+        !buffer_read_u32(&dc->read_buffer, &state->n_remaining_addresses, BE)) {
+        SEND_SW(dc, SW_WRONG_DATA_LENGTH);
+        return;
+    }
+
+    if (state->output_format != ADDRESSES_FORMAT_ADDRESS &&
+        state->output_format != ADDRESSES_FORMAT_SCRIPT) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
+    }
+
+    if (state->is_change != 0 && state->is_change != 1) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
+    }
+
+    // all the address indexes must be non-hardened
+    if (state->n_remaining_addresses == 0 ||
+        state->address_index >= BIP32_FIRST_HARDENED_CHILD ||
+        state->n_remaining_addresses > BIP32_FIRST_HARDENED_CHILD - state->address_index) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
+    }
+
+    if (!read_compiled_policy_args(dc)) {
+        return;
+    }
+
+    uint32_t last_address_index = state->address_index + state->n_remaining_addresses - 1;
+    if (!load_wallet_policy(dc, last_address_index)) {
+        return;
+    }
+
+    dc_next(dc, yield_next_address);
+}
+
+// Computes the next address (or scriptPubKey) of the batch and yields it to the client. The keys of
+// the wallet (and their /change child) are only fetched and derived for the first one, as they are
+// then found in the pubkey cache.
+static void yield_next_address(dispatcher_context_t *dc) {
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    get_wallet_address_state_t *state = (get_wallet_address_state_t *) &G_command_state;
+
+    if (state->n_remaining_addresses == 0) {
+        SEND_SW(dc, SW_OK);
+        return;
+    }
+
+    buffer_t script_buf = buffer_create(state->script, sizeof(state->script));
+
+    int script_len =
+        call_get_wallet_script_from_template(dc,
+                                             state->script_template,
+                                             state->script_template_len,
+                                             state->wallet_header_keys_info_merkle_root,
+                                             state->wallet_header_n_keys,
+                                             state->is_change,
+                                             state->address_index,
+                                             &script_buf,
+                                             NULL);
+    if (script_len < 0) {
+        SEND_SW(dc, SW_BAD_STATE);  // unexpected
+        return;
+    }
+
+    uint8_t cmd = CCMD_YIELD;
+    dc_add_to_response(dc, &cmd, 1);
+
+    if (state->output_format == ADDRESSES_FORMAT_SCRIPT) {
+        dc_add_to_response(dc, state->script, script_len);
+    } else {
+        state->address_len = get_script_address(state->script,
+                                                script_len,
+                                                G_coin_config,
+                                                state->address,
+                                                sizeof(state->address));
+        if (state->address_len < 0) {
+            SEND_SW(dc, SW_BAD_STATE);  // unexpected
+            return;
+        }
+        dc_add_to_response(dc, state->address, state->address_len);
+    }
+
+    dc_interrupt(dc, address_yielded);
+}
+
+// Resumed once the client acknowledged the yielded address; the frames of yield_next_address and of
+// the script computation are not kept while waiting.
+static void address_yielded(dispatcher_context_t *dc) {
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    get_wallet_address_state_t *state = (get_wallet_address_state_t *) &G_command_state;
+
+    ++state->address_index;
+    --state->n_remaining_addresses;
+    dc_next(dc, yield_next_address);
+}
@@ -7,6 +7,10 @@
 
 #include "lib/get_merkle_leaf_element.h"
 
+// output formats of GET_WALLET_ADDRESSES
+#define ADDRESSES_FORMAT_ADDRESS 0
+#define ADDRESSES_FORMAT_SCRIPT  1
+
 typedef struct {
     machine_context_t ctx;
 
@@ -14,12 +18,21 @@ typedef struct {
     uint8_t is_change;
     uint8_t display_address;
 
+    // only for GET_WALLET_ADDRESSES
+    uint8_t output_format;
+    uint32_t n_remaining_addresses;
+
     bool is_wallet_canonical;
     int address_type;
 
+    // if true, the compiled form of the wallet policy is used, instead of the policy itself
+    bool use_compiled_policy;
+    uint8_t compiled_policy_id[32];  // sha256 of the compiled form
+    uint8_t compiled_policy_hmac[32];
+
     // as deriving wallet addresses is stack-intensive, we move some
     // variables here to use less stack overall
-    uint8_t serialized_wallet_policy[MAX_POLICY_MAP_SERIALIZED_LENGTH];
+    uint8_t compiled_policy[MAX_COMPILED_POLICY_LEN];
 
     policy_map_wallet_header_t wallet_header;
 
@@ -35,6 +48,10 @@ typedef struct {
         policy_node_t wallet_policy_map;
     };
 
+    // compiled once per command, and filled for each address
+    uint8_t script_template[MAX_SCRIPT_TEMPLATE_LEN];
+    int script_template_len;
+
     uint8_t script[MAX_PREVOUT_SCRIPTPUBKEY_LEN];
 
     int address_len;
@@ -42,3 +59,5 @@ typedef struct {
 } get_wallet_address_state_t;
 
 void handler_get_wallet_address(dispatcher_context_t *dispatcher_context);
+
+void handler_get_wallet_addresses(dispatcher_context_t *dispatcher_context);
@@ -0,0 +1,77 @@
+#include <string.h>
+
+#include "batch_requests.h"
+
+#include "../../boilerplate/sw.h"
+#include "../client_commands.h"
+
+// Returns the number of requests that are well-formed and still need to be sent, or -1 if the
+// requests are malformed.
+static int count_missing_requests(dispatcher_context_t *dc,
+                                  const uint8_t *requests,
+                                  size_t requests_len) {
+    int n_missing = 0;
+    size_t pos = 0;
+    while (pos < requests_len) {
+        size_t req_len = requests[pos];
+        if (req_len == 0 || pos + 1 + req_len > requests_len) {
+            return -1;
+        }
+        if (!dc->has_prefetched_response(requests + pos + 1, req_len)) {
+            ++n_missing;
+        }
+        pos += 1 + req_len;
+    }
+    return n_missing;
+}
+
+int call_batch_requests(dispatcher_context_t *dc, const uint8_t *requests, size_t requests_len) {
+    // LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    int n_missing = count_missing_requests(dc, requests, requests_len);
+    if (n_missing < 0) {
+        return -1;
+    } else if (n_missing == 0) {
+        return 0;  // nothing to ask
+    }
+
+    uint8_t header[2] = {CCMD_BATCH, (uint8_t) n_missing};
+    dc_add_to_response(dc, header, sizeof(header));
+
+    for (size_t pos = 0; pos < requests_len; pos += 1 + requests[pos]) {
+        if (!dc->has_prefetched_response(requests + pos + 1, requests[pos])) {
+            dc_add_to_response(dc, requests + pos, 1 + requests[pos]);
+        }
+    }
+
+    dc_finalize_response(dc, SW_INTERRUPTED_EXECUTION);
+
+    if (dc_process_interruption(dc) < 0) {
+        return -2;
+    }
+
+    if (!dc->add_prefetched_responses(dc->read_buffer.ptr + dc->read_buffer.offset,
+                                      dc->read_buffer.size - dc->read_buffer.offset)) {
+        return -3;
+    }
+
+    return 0;
+}
+
+int call_prefetch_preimages(dispatcher_context_t *dc,
+                            const uint8_t (*hashes)[32],
+                            size_t n_hashes) {
+    // each request is length-prefixed, and contains the command code, a zero byte and the hash
+    uint8_t requests[BATCH_MAX_PREIMAGES * (1 + 1 + 1 + 32)];
+    size_t requests_len = 0;
+
+    for (size_t i = 0; i < n_hashes && i < BATCH_MAX_PREIMAGES; i++) {
+        requests[requests_len++] = 1 + 1 + 32;
+        requests[requests_len++] = CCMD_GET_PREIMAGE;
+        requests[requests_len++] = 0;
+        memcpy(requests + requests_len, hashes[i], 32);
+        requests_len += 32;
+    }
+
+    return call_batch_requests(dc, requests, requests_len);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "../../boilerplate/dispatcher.h"
+
+// Maximum number of GET_PREIMAGE requests sent at once by call_prefetch_preimages.
+#define BATCH_MAX_PREIMAGES 4
+
+/**
+ * Sends several client requests at once, with a single BATCH client command. The responses returned
+ * by the client are stored by the dispatcher like the ones pushed in advance, so that each of the
+ * following identical requests is answered without interrupting the execution.
+ *
+ * requests is the concatenation of the requests (each including its client command code), each
+ * prefixed by its 1-byte length. Requests whose response is already stored are not sent; if none is
+ * left, there is no interruption. The client might not return all the responses (for example, if
+ * they do not fit in a single message); the missing ones are sent individually when needed.
+ *
+ * Returns 0 on success, a negative number on failure.
+ */
+int call_batch_requests(dispatcher_context_t *dispatcher_context,
+                        const uint8_t *requests,
+                        size_t requests_len);
+
+/**
+ * Batches the GET_PREIMAGE requests for the first (up to BATCH_MAX_PREIMAGES) hashes, for example
+ * for the leaves of a range obtained with call_get_merkle_leaves_hashes.
+ *
+ * Returns 0 on success, a negative number on failure.
+ */
+int call_prefetch_preimages(dispatcher_context_t *dispatcher_context,
+                            const uint8_t (*hashes)[32],
+                            size_t n_hashes);
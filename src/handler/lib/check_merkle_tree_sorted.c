@@ -1,30 +1,86 @@
 #include <string.h>
 
 #include "check_merkle_tree_sorted.h"
-#include "get_merkle_leaf_element.h"
+#include "get_merkle_preimage.h"
+#include "get_merkle_leaves_hashes.h"
+#include "get_preimages.h"
+
+#include "../client_commands.h"
+
+#include "../../common/sorted_tree_cache.h"
 
 static int compare_byte_arrays(const uint8_t array1[],
                                size_t array1_len,
                                const uint8_t array2[],
                                size_t array2_len);
 
+// Returns true if the response to GET_PREIMAGE for the given hash was pushed in advance.
+static bool has_prefetched_preimage(dispatcher_context_t *dc, const uint8_t hash[static 32]) {
+    uint8_t request[1 + 1 + 32] = {CCMD_GET_PREIMAGE, 0};
+    memcpy(request + 2, hash, 32);
+    return dc->has_prefetched_response(request, sizeof(request));
+}
+
 int call_check_merkle_tree_sorted_with_callback(dispatcher_context_t *dispatcher_context,
                                                 const uint8_t root[static 32],
                                                 size_t size,
                                                 dispatcher_callback_descriptor_t callback) {
     // LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
 
+    if (callback.fn == NULL && sorted_tree_cache_contains(root, size)) {
+        // already verified, and the elements are not needed
+        return 0;
+    }
+
+    _Static_assert(MERKLE_LEAVES_BATCH_SIZE <= GET_PREIMAGES_MAX_HASHES,
+                   "A batch of leaves must fit in a single GET_PREIMAGES request");
+
     int prev_el_len = 0;
     uint8_t prev_el[MAX_CHECK_MERKLE_TREE_SORTED_PREIMAGE_SIZE];
 
+    uint8_t leaf_hashes[MERKLE_LEAVES_BATCH_SIZE][32];
+    bool streaming = false;  // the rest of the batch is read from a GET_PREIMAGES response
     for (size_t cur_el_idx = 0; cur_el_idx < size; cur_el_idx++) {
-        uint8_t cur_el[MAX_CHECK_MERKLE_TREE_SORTED_PREIMAGE_SIZE];
-        int cur_el_len = call_get_merkle_leaf_element(dispatcher_context,
-                                                      root,
-                                                      size,
-                                                      cur_el_idx,
-                                                      cur_el,
-                                                      sizeof(cur_el));
+        size_t batch_idx = cur_el_idx % MERKLE_LEAVES_BATCH_SIZE;
+        if (batch_idx == 0) {
+            // fetch the hashes of the next batch of leaves, with a single Merkle proof
+            if (call_get_merkle_leaves_hashes(dispatcher_context,
+                                              root,
+                                              size,
+                                              cur_el_idx,
+                                              MERKLE_LEAVES_BATCH_SIZE,
+                                              leaf_hashes) < 0) {
+                return -1;
+            }
+            streaming = false;
+        }
+
+        if (!streaming && !has_prefetched_preimage(dispatcher_context, leaf_hashes[batch_idx])) {
+            // the preimages that were not pushed with the proof are asked with a single request
+            size_t n_left = MIN(MERKLE_LEAVES_BATCH_SIZE - batch_idx, size - cur_el_idx);
+            if (call_get_preimages(dispatcher_context, &leaf_hashes[batch_idx], n_left) < 0) {
+                return -1;
+            }
+            streaming = true;
+        }
+
+        // the leaf preimage, with its 0x00 prefix
+        uint8_t leaf_preimage[1 + MAX_CHECK_MERKLE_TREE_SORTED_PREIMAGE_SIZE];
+        uint8_t *cur_el = leaf_preimage + 1;
+        int cur_el_len;
+        if (streaming) {
+            // no other client command can be sent until the batch is read, even by the callback
+            int leaf_preimage_len = call_get_preimages_read(dispatcher_context,
+                                                            leaf_hashes[batch_idx],
+                                                            leaf_preimage,
+                                                            sizeof(leaf_preimage));
+            cur_el_len = leaf_preimage_len - 1;
+        } else {
+            cur_el_len = call_get_merkle_preimage(dispatcher_context,
+                                                  leaf_hashes[batch_idx],
+                                                  cur_el,
+                                                  MAX_CHECK_MERKLE_TREE_SORTED_PREIMAGE_SIZE);
+        }
 
         if (cur_el_len < 0) {
             return -1;
@@ -45,6 +101,8 @@ int call_check_merkle_tree_sorted_with_callback(dispatcher_context_t *dispatcher
             callback.fn(callback.state, &buf);
         }
     }
+
+    sorted_tree_cache_add(root, size);
     return 0;
 }
 
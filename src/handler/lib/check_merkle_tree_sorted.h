@@ -12,6 +12,9 @@
  * callback to a non-NULL function is given, it is called once for each of the elements of the
  * Merkle tree, in lexicographical order.
  *
+ * Trees that pass the check are added to the sorted tree cache; if no callback is given and the
+ * tree is already in the cache, the check succeeds without any request to the client.
+ *
  * Returns 0 on success, or a negative number on failure.
  */
 int call_check_merkle_tree_sorted_with_callback(dispatcher_context_t *dispatcher_context,
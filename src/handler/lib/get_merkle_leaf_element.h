@@ -28,3 +28,15 @@ static inline int call_get_merkle_leaf_element(dispatcher_context_t *dispatcher_
     }
     return call_get_merkle_preimage(dispatcher_context, leaf_hash, out_ptr, out_ptr_len);
 }
+
+/**
+ * Same as call_get_merkle_leaf_element, for a leaf whose hash was already verified against the root
+ * of the tree (for example, with call_get_merkle_leaves_hashes): no Merkle proof is requested, and
+ * only the preimage of the leaf is fetched. call_stream_preimage is the streaming equivalent.
+ */
+static inline int call_get_trusted_merkle_leaf_element(dispatcher_context_t *dispatcher_context,
+                                                       const uint8_t leaf_hash[static 32],
+                                                       uint8_t *out_ptr,
+                                                       size_t out_ptr_len) {
+    return call_get_merkle_preimage(dispatcher_context, leaf_hash, out_ptr, out_ptr_len);
+}
@@ -5,7 +5,7 @@
 #include "../../common/buffer.h"
 #include "../../common/write.h"
 #include "../../common/merkle.h"
-#include "../../common/varint.h"
+#include "../../common/merkle_cache.h"
 #include "../../boilerplate/sw.h"
 #include "../client_commands.h"
 
@@ -19,29 +19,49 @@ int call_get_merkle_leaf_hash(dispatcher_context_t *dc,
 
     PRINT_STACK_POINTER();
 
-    {  // make sure memory is deallocated as soon as possible
-        uint8_t tmp[9];
-        tmp[0] = CCMD_GET_MERKLE_LEAF_PROOF;
-        dc->add_to_response(tmp, 1);
-
-        dc->add_to_response(merkle_root, 32);
-
-        int tree_size_len = varint_write(tmp, 0, tree_size);
-        dc->add_to_response(tmp, tree_size_len);
+    // compute the directions of the path to the leaf, and the length of the full Merkle proof,
+    // that is, the level of the leaf
+    uint32_t directions;
+    int n_directions = merkle_get_directions(tree_size, leaf_index, &directions);
+    if (n_directions < 0) {
+        return -1;
+    }
+    uint8_t leaf_level = (uint8_t) n_directions;
+
+    // find the lowest ancestor of the leaf (possibly the leaf itself) whose hash is known
+    uint8_t trusted_level = leaf_level + 1;
+    const uint8_t *trusted_hash = NULL;
+    while (trusted_level > 1 && trusted_hash == NULL) {
+        --trusted_level;
+        uint32_t first_leaf = merkle_get_ancestor_first_leaf(tree_size, leaf_index, trusted_level);
+        trusted_hash = merkle_cache_get(merkle_root, tree_size, trusted_level, first_leaf);
+    }
+    if (trusted_hash == NULL) {
+        trusted_level = 0;
+        trusted_hash = merkle_root;
+    } else if (trusted_level == leaf_level) {
+        memcpy(out, trusted_hash, 32);
+        return 0;
+    }
 
-        int leaf_index_len = varint_write(tmp, 0, leaf_index);
-        dc->add_to_response(tmp, leaf_index_len);
+    // we only need the part of the proof up to the trusted node
+    uint8_t expected_proof_size = leaf_level - trusted_level;
 
-        dc->finalize_response(SW_INTERRUPTED_EXECUTION);
-    }
+    dc_add_u8_to_response(dc, CCMD_GET_MERKLE_LEAF_PROOF);
+    dc_add_to_response(dc, merkle_root, 32);
+    dc_add_varint_to_response(dc, tree_size);
+    dc_add_varint_to_response(dc, leaf_index);
+    dc_add_u8_to_response(dc, expected_proof_size);
+    dc_finalize_response(dc, SW_INTERRUPTED_EXECUTION);
 
-    if (dc->process_interruption(dc) < 0) {
+    if (dc_process_interruption(dc) < 0) {
         return -1;
     }
 
     {
         int cur_step;          // counter for the proof steps
         uint8_t cur_hash[32];  // temporary buffer for intermediate hashes
+        uint8_t node_hash[32];  // hash of the child of the trusted node, added to the cache
         uint8_t proof_size;
         uint8_t n_proof_elements;
         if (!buffer_read_bytes(&dc->read_buffer, cur_hash, 32) ||
@@ -50,6 +70,11 @@ int call_get_merkle_leaf_hash(dispatcher_context_t *dc,
             return -2;
         }
 
+        if (proof_size != expected_proof_size) {
+            PRINTF("Wrong length of the Merkle proof.\n");
+            return -11;
+        }
+
         if (n_proof_elements > proof_size) {
             PRINTF("Received more proof data than expected.\n");
 
@@ -68,32 +93,44 @@ int call_get_merkle_leaf_hash(dispatcher_context_t *dc,
         cur_step = 0;
 
         while (true) {
-            int end_step = cur_step + n_proof_elements;
-            for (; cur_step < end_step; cur_step++) {
-                // we use the memory in the buffer directly, to avoid copying the hash unnecessarily
-                const uint8_t *sibling_hash = dc->read_buffer.ptr + dc->read_buffer.offset;
-
-                int i = proof_size - cur_step - 1;
-                int direction = merkle_get_ith_direction(tree_size, leaf_index, i);
-
-                if (direction == 0) {
-                    merkle_combine_hashes(cur_hash, sibling_hash, cur_hash);
-                } else if (direction == 1) {
-                    merkle_combine_hashes(sibling_hash, cur_hash, cur_hash);
-                } else {
-                    return -5;  // unexpected, proof too long?
-                }
-
-                buffer_seek_cur(&dc->read_buffer, 32);  // consume the bytes of the sibling hash
+            // we use the memory in the buffer directly, to avoid copying the hashes unnecessarily
+            const uint8_t *siblings = dc->read_buffer.ptr + dc->read_buffer.offset;
+
+            // level of the ancestor of the leaf whose hash is cur_hash
+            int level = leaf_level - cur_step;
+
+            // we stop at the child of the trusted node if it is in this part of the proof, as its
+            // hash is added to the cache
+            int n_first = level - (trusted_level + 1);
+            if (n_first <= 0 || n_first > n_proof_elements) {
+                n_first = n_proof_elements;
             }
 
+            if (merkle_climb_proof(cur_hash, siblings, n_first, directions, level) < 0) {
+                return -5;  // unexpected, proof too long?
+            }
+            if (level - n_first == trusted_level + 1) {
+                memcpy(node_hash, cur_hash, 32);
+            }
+            if (merkle_climb_proof(cur_hash,
+                                   siblings + 32 * n_first,
+                                   n_proof_elements - n_first,
+                                   directions,
+                                   level - n_first) < 0) {
+                return -5;
+            }
+
+            // consume the bytes of the sibling hashes
+            buffer_seek_cur(&dc->read_buffer, 32 * (size_t) n_proof_elements);
+            cur_step += n_proof_elements;
+
             if (cur_step == proof_size) {
                 break;
             }
 
             uint8_t req_more[] = {CCMD_GET_MORE_ELEMENTS};
             SET_RESPONSE(dc, req_more, sizeof(req_more), SW_INTERRUPTED_EXECUTION);
-            if (dc->process_interruption(dc) < 0) {
+            if (dc_process_interruption(dc) < 0) {
                 return -6;
             }
 
@@ -105,7 +142,8 @@ int call_get_merkle_leaf_hash(dispatcher_context_t *dc,
                 return -7;
             }
 
-            if (elements_len != 32) {
+            // an empty response would never complete the proof
+            if (elements_len != 32 || n_proof_elements == 0) {
                 return -8;
             }
 
@@ -115,10 +153,19 @@ int call_get_merkle_leaf_hash(dispatcher_context_t *dc,
             }
         }
 
-        if (memcmp(merkle_root, cur_hash, 32) != 0) {
+        if (memcmp(trusted_hash, cur_hash, 32) != 0) {
             PRINTF("Merkle root mismatch");
             return -10;
         }
+
+        // the leaf and all the nodes on its path are now verified; we add to the cache the leaf,
+        // and the child of the trusted node on the path if not too far from the root
+        uint8_t node_level = trusted_level + 1;
+        if (node_level < leaf_level && node_level <= MERKLE_CACHE_MAX_LEVEL) {
+            uint32_t first_leaf = merkle_get_ancestor_first_leaf(tree_size, leaf_index, node_level);
+            merkle_cache_add(merkle_root, tree_size, node_level, first_leaf, node_hash);
+        }
+        merkle_cache_add(merkle_root, tree_size, leaf_level, leaf_index, out);
     }
 
     return 0;
@@ -11,15 +11,12 @@ int call_get_merkle_leaf_index(dispatcher_context_t *dispatcher_context,
                                const uint8_t leaf_hash[static 32]) {
     // LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
 
-    {  // free memory as soon as possible
-        uint8_t request[1 + 32 + 32];
-        request[0] = CCMD_GET_MERKLE_LEAF_INDEX;
-        memcpy(request + 1, root, 32);
-        memcpy(request + 1 + 32, leaf_hash, 32);
+    dc_add_u8_to_response(dispatcher_context, CCMD_GET_MERKLE_LEAF_INDEX);
+    dc_add_to_response(dispatcher_context, root, 32);
+    dc_add_to_response(dispatcher_context, leaf_hash, 32);
+    dc_finalize_response(dispatcher_context, SW_INTERRUPTED_EXECUTION);
 
-        SET_RESPONSE(dispatcher_context, request, sizeof(request), SW_INTERRUPTED_EXECUTION);
-    }
-    if (dispatcher_context->process_interruption(dispatcher_context) < 0) {
+    if (dc_process_interruption(dispatcher_context) < 0) {
         return -3;
     }
 
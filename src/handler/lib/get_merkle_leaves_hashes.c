@@ -0,0 +1,128 @@
+#include <string.h>
+
+#include "get_merkle_leaves_hashes.h"
+
+#include "../../common/buffer.h"
+#include "../../common/merkle.h"
+#include "../../boilerplate/sw.h"
+#include "../client_commands.h"
+
+int call_get_merkle_leaves_hashes(dispatcher_context_t *dc,
+                                  const uint8_t merkle_root[static 32],
+                                  uint32_t tree_size,
+                                  uint32_t first_leaf_index,
+                                  uint32_t n_leaves,
+                                  uint8_t (*out)[32]) {
+    // LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    PRINT_STACK_POINTER();
+
+    if (n_leaves == 0 || (n_leaves & (n_leaves - 1)) != 0 || first_leaf_index % n_leaves != 0 ||
+        first_leaf_index >= tree_size) {
+        return -1;
+    }
+
+    // The range of leaves is a subtree of the Merkle tree; moreover, the tree of all the subtrees
+    // with n_leaves leaves has exactly the same shape as the original tree, with
+    // ceil(tree_size / n_leaves) leaves. Therefore, the Merkle proof for the root of the subtree is
+    // the proof of the leaf with index first_leaf_index / n_leaves in that tree.
+    uint32_t n_returned = MIN(n_leaves, tree_size - first_leaf_index);
+    uint32_t subtrees_count = tree_size / n_leaves + (tree_size % n_leaves != 0 ? 1 : 0);
+    uint32_t subtree_index = first_leaf_index / n_leaves;
+
+    // the length of the Merkle proof is the number of directions of the path to the subtree
+    uint32_t directions;
+    int expected_proof_size = merkle_get_directions(subtrees_count, subtree_index, &directions);
+
+    dc_add_u8_to_response(dc, CCMD_GET_MERKLE_LEAVES_PROOF);
+    dc_add_to_response(dc, merkle_root, 32);
+    dc_add_varint_to_response(dc, tree_size);
+    dc_add_varint_to_response(dc, first_leaf_index);
+    dc_add_varint_to_response(dc, n_leaves);
+    dc_finalize_response(dc, SW_INTERRUPTED_EXECUTION);
+
+    if (dc_process_interruption(dc) < 0) {
+        return -2;
+    }
+
+    uint8_t proof_size;
+    uint8_t n_elements;
+    if (!buffer_read_u8(&dc->read_buffer, &proof_size) ||
+        !buffer_read_u8(&dc->read_buffer, &n_elements)) {
+        return -3;
+    }
+
+    if (proof_size != expected_proof_size) {
+        PRINTF("Wrong length of the Merkle proof.\n");
+        return -4;
+    }
+
+    uint32_t total_elements = n_returned + proof_size;
+
+    uint8_t cur_hash[32];
+    uint32_t cur_element = 0;
+    while (true) {
+        if (cur_element + n_elements > total_elements) {
+            PRINTF("Received more data than expected.\n");
+            return -5;
+        }
+
+        if (!buffer_can_read(&dc->read_buffer, 32 * (size_t) n_elements)) {
+            return -6;
+        }
+
+        uint32_t end_element = cur_element + n_elements;
+        for (; cur_element < end_element; cur_element++) {
+            if (cur_element < n_returned) {
+                buffer_read_bytes(&dc->read_buffer, out[cur_element], 32);
+
+                if (cur_element == n_returned - 1) {
+                    // all the leaves received, compute the root of their subtree
+                    merkle_compute_root((const uint8_t(*)[32]) out, n_returned, cur_hash);
+                }
+                continue;
+            }
+
+            // we use the memory in the buffer directly, to avoid copying the hash unnecessarily
+            const uint8_t *sibling_hash = dc->read_buffer.ptr + dc->read_buffer.offset;
+
+            int i = proof_size - (cur_element - n_returned) - 1;
+            if (((directions >> i) & 1) == 0) {
+                merkle_combine_hashes(cur_hash, sibling_hash, cur_hash);
+            } else {
+                merkle_combine_hashes(sibling_hash, cur_hash, cur_hash);
+            }
+
+            buffer_seek_cur(&dc->read_buffer, 32);  // consume the bytes of the sibling hash
+        }
+
+        if (cur_element == total_elements) {
+            break;
+        }
+
+        uint8_t req_more[] = {CCMD_GET_MORE_ELEMENTS};
+        SET_RESPONSE(dc, req_more, sizeof(req_more), SW_INTERRUPTED_EXECUTION);
+        if (dc_process_interruption(dc) < 0) {
+            return -8;
+        }
+
+        // Parse response to CCMD_GET_MORE_ELEMENTS
+        uint8_t elements_len;
+        if (!buffer_read_u8(&dc->read_buffer, &n_elements) ||
+            !buffer_read_u8(&dc->read_buffer, &elements_len)) {
+            return -9;
+        }
+
+        // an empty response would never complete the proof
+        if (elements_len != 32 || n_elements == 0) {
+            return -10;
+        }
+    }
+
+    if (memcmp(merkle_root, cur_hash, 32) != 0) {
+        PRINTF("Merkle root mismatch");
+        return -11;
+    }
+
+    return n_returned;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "../../boilerplate/dispatcher.h"
+
+// Number of leaves requested at once by flows that iterate over all the leaves of a Merkle tree.
+// Must be a power of 2.
+#define MERKLE_LEAVES_BATCH_SIZE 4
+
+/**
+ * Requests the hashes of a contiguous range of leaves of a Merkle tree, together with a single
+ * Merkle proof for the subtree containing them, using the GET_MERKLE_LEAVES_PROOF client command.
+ * Internal nodes that are shared by the leaves in the range are therefore only received and hashed
+ * once.
+ *
+ * n_leaves must be a power of 2, and first_leaf_index must be a multiple of n_leaves. If the range
+ * exceeds the end of the tree, only the leaves up to tree_size - 1 are returned.
+ *
+ * Returns the number of leaf hashes written to out in case of success, a negative number on
+ * failure.
+ */
+int call_get_merkle_leaves_hashes(dispatcher_context_t *dispatcher_context,
+                                  const uint8_t merkle_root[static 32],
+                                  uint32_t tree_size,
+                                  uint32_t first_leaf_index,
+                                  uint32_t n_leaves,
+                                  uint8_t (*out)[32]);
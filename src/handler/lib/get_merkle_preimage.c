@@ -17,16 +17,13 @@ int call_get_merkle_preimage(dispatcher_context_t *dispatcher_context,
 
     PRINT_STACK_POINTER();
 
-    uint8_t cmd = CCMD_GET_PREIMAGE;
-    dispatcher_context->add_to_response(&cmd, 1);
+    dc_add_u8_to_response(dispatcher_context, CCMD_GET_PREIMAGE);
+    dc_add_u8_to_response(dispatcher_context, 0);
 
-    uint8_t zero = 0;
-    dispatcher_context->add_to_response(&zero, 1);
+    dc_add_to_response(dispatcher_context, hash, 32);
+    dc_finalize_response(dispatcher_context, SW_INTERRUPTED_EXECUTION);
 
-    dispatcher_context->add_to_response(hash, 32);
-    dispatcher_context->finalize_response(SW_INTERRUPTED_EXECUTION);
-
-    if (dispatcher_context->process_interruption(dispatcher_context) < 0) {
+    if (dc_process_interruption(dispatcher_context) < 0) {
         return -1;
     }
 
@@ -73,7 +70,7 @@ int call_get_merkle_preimage(dispatcher_context_t *dispatcher_context,
     while (bytes_remaining > 0) {
         uint8_t get_more_elements_req[] = {CCMD_GET_MORE_ELEMENTS};
         SET_RESPONSE(dispatcher_context, get_more_elements_req, 1, SW_INTERRUPTED_EXECUTION);
-        if (dispatcher_context->process_interruption(dispatcher_context) < 0) {
+        if (dc_process_interruption(dispatcher_context) < 0) {
             return -6;
         }
 
@@ -85,7 +82,7 @@ int call_get_merkle_preimage(dispatcher_context_t *dispatcher_context,
             return -7;
         }
 
-        if (elements_len != 1) {
+        if (elements_len != 1 || n_bytes == 0) {
             PRINTF("Elements should be single bytes\n");
             return -8;
         }
@@ -2,10 +2,12 @@
 
 #include "get_merkleized_map.h"
 
-#include "get_merkle_leaf_element.h"
+#include "get_merkle_leaf_hash.h"
+#include "get_merkle_preimage.h"
 #include "check_merkle_tree_sorted.h"
 
 #include "../../common/buffer.h"
+#include "../../common/map_commitment_cache.h"
 
 int call_get_merkleized_map_with_callback(dispatcher_context_t *dispatcher_context,
                                           const uint8_t root[static 32],
@@ -15,15 +17,45 @@ int call_get_merkleized_map_with_callback(dispatcher_context_t *dispatcher_conte
                                           merkleized_map_commitment_t *out_ptr) {
     // LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
 
+    if (size <= 0 || index < 0 || index >= size) {
+        return -1;
+    }
+
+    if (map_commitment_cache_get(root, (uint32_t) size, (uint32_t) index, out_ptr)) {
+        // the commitment was already verified to be the leaf; only the keys are swept again
+        return call_check_merkle_tree_sorted_with_callback(dispatcher_context,
+                                                           out_ptr->keys_root,
+                                                           out_ptr->size,
+                                                           keys_callback);
+    }
+
+    uint8_t leaf_hash[32];
+    if (call_get_merkle_leaf_hash(dispatcher_context, root, size, index, leaf_hash) < 0) {
+        return -1;
+    }
+
+    int res = call_get_merkleized_map_from_leaf_hash_with_callback(dispatcher_context,
+                                                                   leaf_hash,
+                                                                   keys_callback,
+                                                                   out_ptr);
+    if (res >= 0) {
+        map_commitment_cache_add(root, (uint32_t) size, (uint32_t) index, out_ptr);
+    }
+    return res;
+}
+
+int call_get_merkleized_map_from_leaf_hash_with_callback(
+    dispatcher_context_t *dispatcher_context,
+    const uint8_t leaf_hash[static 32],
+    dispatcher_callback_descriptor_t keys_callback,
+    merkleized_map_commitment_t *out_ptr) {
+    // LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
+
     uint8_t raw_output[9 + 2 * 32];  // maximum size of serialized result (9 bytes for the varint,
                                      // and the 2 Merkle roots)
 
-    int el_len = call_get_merkle_leaf_element(dispatcher_context,
-                                              root,
-                                              size,
-                                              index,
-                                              raw_output,
-                                              sizeof(raw_output));
+    int el_len =
+        call_get_merkle_preimage(dispatcher_context, leaf_hash, raw_output, sizeof(raw_output));
     if (el_len < 0) {
         return -1;
     }
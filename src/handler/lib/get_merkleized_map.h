@@ -13,6 +13,16 @@ int call_get_merkleized_map_with_callback(dispatcher_context_t *dispatcher_conte
                                           dispatcher_callback_descriptor_t keys_callback,
                                           merkleized_map_commitment_t *out_ptr);
 
+/**
+ * Same as call_get_merkleized_map_with_callback, for a leaf whose hash was already obtained (and
+ * verified) by the caller, for example with call_get_merkle_leaves_hashes.
+ */
+int call_get_merkleized_map_from_leaf_hash_with_callback(
+    dispatcher_context_t *dispatcher_context,
+    const uint8_t leaf_hash[static 32],
+    dispatcher_callback_descriptor_t keys_callback,
+    merkleized_map_commitment_t *out_ptr);
+
 /**
  * Convenience function to call the call_get_merkleized_map flow.
  */
@@ -28,3 +38,15 @@ static inline int call_get_merkleized_map(dispatcher_context_t *dispatcher_conte
                                                  make_callback(NULL, NULL),
                                                  out_ptr);
 }
+
+/**
+ * Convenience function to call the call_get_merkleized_map_from_leaf_hash flow.
+ */
+static inline int call_get_merkleized_map_from_leaf_hash(dispatcher_context_t *dispatcher_context,
+                                                         const uint8_t leaf_hash[static 32],
+                                                         merkleized_map_commitment_t *out_ptr) {
+    return call_get_merkleized_map_from_leaf_hash_with_callback(dispatcher_context,
+                                                                leaf_hash,
+                                                                make_callback(NULL, NULL),
+                                                                out_ptr);
+}
@@ -0,0 +1,215 @@
+#include <string.h>
+
+#include "get_merkleized_map_fields.h"
+
+#include "check_merkle_tree_sorted.h"
+#include "get_merkleized_map.h"
+#include "get_merkle_leaf_element.h"
+#include "get_merkle_leaf_hash.h"
+#include "get_merkle_leaves_hashes.h"
+
+#include "../../common/buffer.h"
+
+typedef struct {
+    dispatcher_callback_descriptor_t keys_callback;
+    merkleized_map_field_t *fields;
+    size_t n_fields;
+    int cur_key_index;
+} fields_callback_state_t;
+
+// Called for each key of the map, in order: records the index of the keys of the requested fields,
+// then forwards the key to the caller's callback (if any).
+static void fields_keys_callback(fields_callback_state_t *state, buffer_t *data) {
+    size_t data_len = data->size - data->offset;
+    const uint8_t *key = data->ptr + data->offset;
+
+    for (size_t i = 0; i < state->n_fields; i++) {
+        merkleized_map_field_t *field = &state->fields[i];
+        if (field->key_len == data_len && memcmp(field->key, key, data_len) == 0) {
+            field->index = state->cur_key_index;
+        }
+    }
+
+    ++state->cur_key_index;
+
+    if (state->keys_callback.fn != NULL) {
+        state->keys_callback.fn(state->keys_callback.state, data);
+    }
+}
+
+// Returns true if the value of the field is still to be fetched, and its leaf is among the
+// MERKLE_LEAVES_BATCH_SIZE leaves starting at first_leaf.
+static bool is_pending_in_batch(const merkleized_map_field_t *field, uint32_t first_leaf) {
+    return field->index >= 0 && field->value_len < 0 &&
+           ((uint32_t) field->index & ~(MERKLE_LEAVES_BATCH_SIZE - 1)) == first_leaf;
+}
+
+// Fetches the values of the fields found in the map out_ptr, whose keys were just swept. The values
+// whose leaves are in the same batch of leaves (like the ones of adjacent keys) are verified with a
+// single Merkle proof, and only their preimages are then fetched; no preimage is fetched for the
+// fields that only need the hash of the leaf.
+static int fetch_fields_values(dispatcher_context_t *dispatcher_context,
+                               merkleized_map_field_t *fields,
+                               size_t n_fields,
+                               const merkleized_map_commitment_t *out_ptr) {
+    uint8_t leaf_hashes[MERKLE_LEAVES_BATCH_SIZE][32];
+
+    for (size_t i = 0; i < n_fields; i++) {
+        if (fields[i].index < 0 || fields[i].value_len >= 0) {
+            continue;  // key not in the map, or value already fetched with a previous field
+        }
+
+        uint32_t first_leaf = (uint32_t) fields[i].index & ~(MERKLE_LEAVES_BATCH_SIZE - 1);
+        size_t n_in_batch = 0;
+        for (size_t j = i; j < n_fields; j++) {
+            if (is_pending_in_batch(&fields[j], first_leaf)) {
+                ++n_in_batch;
+            }
+        }
+
+        if (n_in_batch == 1 && fields[i].hash_only) {
+            if (call_get_merkle_leaf_hash(dispatcher_context,
+                                          out_ptr->values_root,
+                                          out_ptr->size,
+                                          fields[i].index,
+                                          fields[i].out) < 0) {
+                return -2;
+            }
+            fields[i].value_len = 32;
+            continue;
+        }
+
+        if (n_in_batch == 1) {
+            fields[i].value_len = call_get_merkle_leaf_element(dispatcher_context,
+                                                               out_ptr->values_root,
+                                                               out_ptr->size,
+                                                               fields[i].index,
+                                                               fields[i].out,
+                                                               fields[i].out_len);
+            if (fields[i].value_len < 0) {
+                return -2;
+            }
+            continue;
+        }
+
+        if (call_get_merkle_leaves_hashes(dispatcher_context,
+                                          out_ptr->values_root,
+                                          out_ptr->size,
+                                          first_leaf,
+                                          MERKLE_LEAVES_BATCH_SIZE,
+                                          leaf_hashes) < 0) {
+            return -2;
+        }
+
+        for (size_t j = i; j < n_fields; j++) {
+            if (!is_pending_in_batch(&fields[j], first_leaf)) {
+                continue;
+            }
+
+            if (fields[j].hash_only) {
+                memcpy(fields[j].out, leaf_hashes[fields[j].index - first_leaf], 32);
+                fields[j].value_len = 32;
+                continue;
+            }
+
+            fields[j].value_len =
+                call_get_trusted_merkle_leaf_element(dispatcher_context,
+                                                     leaf_hashes[fields[j].index - first_leaf],
+                                                     fields[j].out,
+                                                     fields[j].out_len);
+            if (fields[j].value_len < 0) {
+                return -2;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static fields_callback_state_t init_fields_callback_state(
+    dispatcher_callback_descriptor_t keys_callback,
+    merkleized_map_field_t *fields,
+    size_t n_fields) {
+    for (size_t i = 0; i < n_fields; i++) {
+        fields[i].index = -1;
+        fields[i].value_len = -1;
+    }
+
+    return (fields_callback_state_t){.keys_callback = keys_callback,
+                                     .fields = fields,
+                                     .n_fields = n_fields,
+                                     .cur_key_index = 0};
+}
+
+int call_get_merkleized_map_with_fields(dispatcher_context_t *dispatcher_context,
+                                        const uint8_t root[static 32],
+                                        int size,
+                                        int index,
+                                        dispatcher_callback_descriptor_t keys_callback,
+                                        merkleized_map_field_t *fields,
+                                        size_t n_fields,
+                                        merkleized_map_commitment_t *out_ptr) {
+    // LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
+
+    fields_callback_state_t callback_state =
+        init_fields_callback_state(keys_callback, fields, n_fields);
+
+    int res = call_get_merkleized_map_with_callback(
+        dispatcher_context,
+        root,
+        size,
+        index,
+        make_callback(&callback_state, (dispatcher_callback_t) fields_keys_callback),
+        out_ptr);
+    if (res < 0) {
+        return -1;
+    }
+
+    return fetch_fields_values(dispatcher_context, fields, n_fields, out_ptr);
+}
+
+int call_get_merkleized_map_from_leaf_hash_with_fields(
+    dispatcher_context_t *dispatcher_context,
+    const uint8_t leaf_hash[static 32],
+    dispatcher_callback_descriptor_t keys_callback,
+    merkleized_map_field_t *fields,
+    size_t n_fields,
+    merkleized_map_commitment_t *out_ptr) {
+    // LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
+
+    fields_callback_state_t callback_state =
+        init_fields_callback_state(keys_callback, fields, n_fields);
+
+    int res = call_get_merkleized_map_from_leaf_hash_with_callback(
+        dispatcher_context,
+        leaf_hash,
+        make_callback(&callback_state, (dispatcher_callback_t) fields_keys_callback),
+        out_ptr);
+    if (res < 0) {
+        return -1;
+    }
+
+    return fetch_fields_values(dispatcher_context, fields, n_fields, out_ptr);
+}
+
+int call_get_merkleized_map_commitment_fields(dispatcher_context_t *dispatcher_context,
+                                              const merkleized_map_commitment_t *map,
+                                              dispatcher_callback_descriptor_t keys_callback,
+                                              merkleized_map_field_t *fields,
+                                              size_t n_fields) {
+    // LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
+
+    fields_callback_state_t callback_state =
+        init_fields_callback_state(keys_callback, fields, n_fields);
+
+    int res = call_check_merkle_tree_sorted_with_callback(
+        dispatcher_context,
+        map->keys_root,
+        (size_t) map->size,
+        make_callback(&callback_state, (dispatcher_callback_t) fields_keys_callback));
+    if (res < 0) {
+        return -1;
+    }
+
+    return fetch_fields_values(dispatcher_context, fields, n_fields, map);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "../../boilerplate/dispatcher.h"
+#include "../../common/merkle.h"
+
+/**
+ * Describes a field to be extracted from a merkleized map by call_get_merkleized_map_with_fields.
+ */
+typedef struct {
+    const uint8_t *key;  // the key of the field
+    size_t key_len;      // the length of the key
+    uint8_t *out;        // buffer that will contain the value, if the key is found
+    size_t out_len;      // size of the out buffer
+    int value_len;       // set to the length of the value, or -1 if the key is not in the map
+    int index;           // used internally to store the index of the key in the map
+    bool hash_only;      // if true, out receives the hash of the value's leaf instead of the value
+} merkleized_map_field_t;
+
+/**
+ * Convenience function to initialize a merkleized_map_field_t for a field of the map.
+ */
+static inline merkleized_map_field_t make_merkleized_map_field(const uint8_t *key,
+                                                               size_t key_len,
+                                                               uint8_t *out,
+                                                               size_t out_len) {
+    return (merkleized_map_field_t){.key = key,
+                                    .key_len = key_len,
+                                    .out = out,
+                                    .out_len = out_len,
+                                    .value_len = -1,
+                                    .index = -1,
+                                    .hash_only = false};
+}
+
+/**
+ * Convenience function to initialize a merkleized_map_field_t for a field of the map whose value is
+ * not fetched: out receives the hash of its leaf in the Merkle tree of the values, and value_len is
+ * set to 32 if the key is in the map. The hash is verified against the root of the tree, so that
+ * the value can be compared with a known one, or fetched with call_get_trusted_merkle_leaf_element
+ * only if it is needed.
+ */
+static inline merkleized_map_field_t make_merkleized_map_field_hash(const uint8_t *key,
+                                                                    size_t key_len,
+                                                                    uint8_t out[static 32]) {
+    return (merkleized_map_field_t){.key = key,
+                                    .key_len = key_len,
+                                    .out = out,
+                                    .out_len = 32,
+                                    .value_len = -1,
+                                    .index = -1,
+                                    .hash_only = true};
+}
+
+/**
+ * Same as call_get_merkleized_map_with_callback; moreover, it extracts the values of all the given
+ * fields from the map. The indexes of the keys are found during the same sweep over the keys that
+ * checks that they are sorted, therefore no separate lookup is needed for each key; the values are
+ * then fetched from the Merkle tree of the values, and verified.
+ *
+ * For each field, value_len is set to the length of the value, or -1 if the key is not in the map.
+ *
+ * Returns 0 on success, or a negative number on failure (including if any of the values does not
+ * fit in the corresponding output buffer).
+ */
+int call_get_merkleized_map_with_fields(dispatcher_context_t *dispatcher_context,
+                                        const uint8_t root[static 32],
+                                        int size,
+                                        int index,
+                                        dispatcher_callback_descriptor_t keys_callback,
+                                        merkleized_map_field_t *fields,
+                                        size_t n_fields,
+                                        merkleized_map_commitment_t *out_ptr);
+
+/**
+ * Same as call_get_merkleized_map_with_fields, for a map whose leaf hash in the Merkle tree of the
+ * map commitments was already obtained (and verified) by the caller, for example with
+ * call_get_merkle_leaves_hashes.
+ */
+int call_get_merkleized_map_from_leaf_hash_with_fields(
+    dispatcher_context_t *dispatcher_context,
+    const uint8_t leaf_hash[static 32],
+    dispatcher_callback_descriptor_t keys_callback,
+    merkleized_map_field_t *fields,
+    size_t n_fields,
+    merkleized_map_commitment_t *out_ptr);
+
+/**
+ * Same as call_get_merkleized_map_with_fields, for a map whose commitment is already known (like
+ * the global map of a psbt): its keys are swept, checking that they are sorted, and the values of
+ * the fields are then fetched.
+ */
+int call_get_merkleized_map_commitment_fields(dispatcher_context_t *dispatcher_context,
+                                              const merkleized_map_commitment_t *map,
+                                              dispatcher_callback_descriptor_t keys_callback,
+                                              merkleized_map_field_t *fields,
+                                              size_t n_fields);
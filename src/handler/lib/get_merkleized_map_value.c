@@ -1,33 +1,120 @@
 #include <string.h>
 
 #include "get_merkleized_map_value.h"
+#include "read_response.h"
 
-#include "get_merkle_leaf_index.h"
-#include "get_merkle_leaf_element.h"
+#include "../../boilerplate/sw.h"
+#include "../../common/buffer.h"
+#include "../../crypto.h"
+#include "../client_commands.h"
 
-int call_get_merkleized_map_value(dispatcher_context_t *dispatcher_context,
+// Reads the Merkle proof of the leaf with the given index from the response, and verifies that it
+// matches the expected root.
+static bool verify_response_merkle_proof(dispatcher_context_t *dc,
+                                         const uint8_t root[static 32],
+                                         size_t size,
+                                         size_t index,
+                                         uint8_t proof_size,
+                                         uint8_t cur_hash[static 32]) {
+    uint32_t directions;
+    if (merkle_get_directions(size, index, &directions) != proof_size) {
+        PRINTF("Wrong length of the Merkle proof\n");
+        return false;
+    }
+
+    for (int cur_step = 0; cur_step < proof_size; cur_step++) {
+        uint8_t sibling_hash[32];
+        if (!read_response_bytes(dc, sibling_hash, 32, NULL)) {
+            return false;
+        }
+
+        if (((directions >> (proof_size - cur_step - 1)) & 1) == 0) {
+            merkle_combine_hashes(cur_hash, sibling_hash, cur_hash);
+        } else {
+            merkle_combine_hashes(sibling_hash, cur_hash, cur_hash);
+        }
+    }
+
+    return memcmp(root, cur_hash, 32) == 0;
+}
+
+int call_get_merkleized_map_value(dispatcher_context_t *dc,
                                   const merkleized_map_commitment_t *map,
                                   const uint8_t *key,
                                   int key_len,
                                   uint8_t *out,
                                   int out_len) {
-    // LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
+    // LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    PRINT_STACK_POINTER();
 
-    uint8_t key_merkle_hash[32];
-    merkle_compute_element_hash(key, key_len, key_merkle_hash);
+    uint8_t cur_hash[32];
+    merkle_compute_element_hash(key, key_len, cur_hash);
 
-    int index =
-        call_get_merkle_leaf_index(dispatcher_context, map->size, map->keys_root, key_merkle_hash);
+    dc_add_u8_to_response(dc, CCMD_GET_MERKLEIZED_MAP_VALUE);
+    dc_add_to_response(dc, map->keys_root, 32);
+    dc_add_to_response(dc, map->values_root, 32);
+    dc_add_varint_to_response(dc, map->size);
+    dc_add_to_response(dc, cur_hash, 32);
+    dc_finalize_response(dc, SW_INTERRUPTED_EXECUTION);
 
-    if (index < 0) {
-        PRINTF("Key not found, or incorrect data.\n");
+    if (dc_process_interruption(dc) < 0) {
+        return -2;
+    }
+
+    uint8_t found;
+    if (!read_response_bytes(dc, &found, 1, NULL) || (found != 0 && found != 1)) {
+        return -3;
+    }
+
+    if (!found) {
+        PRINTF("Key not found.\n");
         return -1;
     }
 
-    return call_get_merkle_leaf_element(dispatcher_context,
-                                        map->values_root,
-                                        map->size,
-                                        index,
-                                        out,
-                                        out_len);
-}
\ No newline at end of file
+    uint64_t index;
+    uint64_t value_len;
+    if (!read_response_varint(dc, &index) || index >= map->size ||
+        !read_response_varint(dc, &value_len)) {
+        return -4;
+    }
+
+    if (value_len > (uint64_t) out_len) {
+        PRINTF("Output buffer too short\n");
+        return -5;
+    }
+
+    // read the value, computing its leaf hash
+    cx_sha256_t value_hash_context;
+    cx_sha256_init(&value_hash_context);
+    crypto_hash_update_u8(&value_hash_context.header, 0x00);
+
+    if (!read_response_bytes(dc, out, (size_t) value_len, &value_hash_context.header)) {
+        return -6;
+    }
+
+    uint8_t proof_size;
+    if (!read_response_bytes(dc, &proof_size, 1, NULL)) {
+        return -7;
+    }
+
+    // the key's leaf hash is in cur_hash
+    if (!verify_response_merkle_proof(dc, map->keys_root, map->size, index, proof_size, cur_hash)) {
+        PRINTF("Invalid Merkle proof for the key\n");
+        return -8;
+    }
+
+    crypto_hash_digest(&value_hash_context.header, cur_hash, 32);
+
+    if (!verify_response_merkle_proof(dc,
+                                      map->values_root,
+                                      map->size,
+                                      index,
+                                      proof_size,
+                                      cur_hash)) {
+        PRINTF("Invalid Merkle proof for the value\n");
+        return -9;
+    }
+
+    return (int) value_len;
+}
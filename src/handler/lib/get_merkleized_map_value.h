@@ -5,13 +5,15 @@
 #include "../../common/read.h"
 
 /**
- * Given a commitment to a merkleized key-value map, this flow finds out the index of the element
- * corresponding to the key, then fetches the corresponding element and verifies that its hash and
- * Merkle proof matches. The value is then stored in the `out` pointer, which must be large enough
- * to contain the preimage.
+ * Given a commitment to a merkleized key-value map, this flow uses a single
+ * CCMD_GET_MERKLEIZED_MAP_VALUE request to obtain the index of the element corresponding to the
+ * key, the corresponding value, and the Merkle proofs for both the key and the value, which are
+ * verified. The value is then stored in the `out` pointer, which must be large enough to contain
+ * the preimage.
  *
- * Returns a negative number if the response is too long to fit into the output buffer, or if the
- * key is not found, or if any of the proofs failed. Returns the length of the preimage on success.
+ * Returns -1 if the key is not found, or a different negative number if the response is too long
+ * to fit into the output buffer, or if any of the proofs failed. Returns the length of the preimage
+ * on success.
  *
  * NOTE: this does _not_ check that the keys are lexicographically sorted; the sanity check needs to
  * be done before.
@@ -12,14 +12,12 @@ int call_get_preimage(dispatcher_context_t *dispatcher_context,
                       size_t out_len) {
     // LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
 
-    uint8_t cmd = CCMD_GET_PREIMAGE;
-    dispatcher_context->add_to_response(&cmd, 1);
-    uint8_t zero = 0;
-    dispatcher_context->add_to_response(&zero, 1);
-    dispatcher_context->add_to_response(hash, 32);
-    dispatcher_context->finalize_response(SW_INTERRUPTED_EXECUTION);
-
-    if (dispatcher_context->process_interruption(dispatcher_context) < 0) {
+    dc_add_u8_to_response(dispatcher_context, CCMD_GET_PREIMAGE);
+    dc_add_u8_to_response(dispatcher_context, 0);
+    dc_add_to_response(dispatcher_context, hash, 32);
+    dc_finalize_response(dispatcher_context, SW_INTERRUPTED_EXECUTION);
+
+    if (dc_process_interruption(dispatcher_context) < 0) {
         return -1;
     }
 
@@ -64,7 +62,7 @@ int call_get_preimage(dispatcher_context_t *dispatcher_context,
                      get_more_elements_req,
                      sizeof(get_more_elements_req),
                      SW_INTERRUPTED_EXECUTION);
-        if (dispatcher_context->process_interruption(dispatcher_context) < 0) {
+        if (dc_process_interruption(dispatcher_context) < 0) {
             return -5;
         }
 
@@ -76,7 +74,7 @@ int call_get_preimage(dispatcher_context_t *dispatcher_context,
             return -6;
         }
 
-        if (elements_len != 1) {
+        if (elements_len != 1 || n_bytes == 0) {
             PRINTF("Elements should be single bytes\n");
             return -7;
         }
@@ -0,0 +1,64 @@
+#include <string.h>
+
+#include "get_preimages.h"
+#include "read_response.h"
+
+#include "../../boilerplate/sw.h"
+#include "../../crypto.h"
+#include "../client_commands.h"
+
+int call_get_preimages(dispatcher_context_t *dispatcher_context,
+                       const uint8_t (*hashes)[32],
+                       size_t n_hashes) {
+    // LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
+
+    if (n_hashes == 0 || n_hashes > GET_PREIMAGES_MAX_HASHES) {
+        return -1;
+    }
+
+    dc_add_u8_to_response(dispatcher_context, CCMD_GET_PREIMAGES);
+    dc_add_u8_to_response(dispatcher_context, (uint8_t) n_hashes);
+    dc_add_to_response(dispatcher_context, hashes, 32 * n_hashes);
+    dc_finalize_response(dispatcher_context, SW_INTERRUPTED_EXECUTION);
+
+    if (dc_process_interruption(dispatcher_context) < 0) {
+        return -2;
+    }
+    return 0;
+}
+
+int call_get_preimages_read(dispatcher_context_t *dispatcher_context,
+                            const uint8_t hash[static 32],
+                            uint8_t *out,
+                            size_t out_len) {
+    uint64_t preimage_len;
+    if (!read_response_varint(dispatcher_context, &preimage_len)) {
+        return -1;
+    }
+
+    if (preimage_len > out_len) {
+        PRINTF("Output buffer too short\n");
+        return -2;
+    }
+
+    cx_sha256_t hash_context;
+    cx_sha256_init(&hash_context);
+
+    if (!read_response_bytes(dispatcher_context,
+                             out,
+                             (size_t) preimage_len,
+                             &hash_context.header)) {
+        return -3;
+    }
+
+    // hack: we pass the address of the final accumulator inside cx_sha256_t, so we don't need
+    // an additional variable in the stack to store the final hash.
+    crypto_hash_digest(&hash_context.header, (uint8_t *) &hash_context.acc, 32);
+
+    if (memcmp(hash_context.acc, hash, 32) != 0) {
+        PRINTF("Hash mismatch.\n");
+        return -4;
+    }
+
+    return (int) preimage_len;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../../boilerplate/dispatcher.h"
+
+// Maximum number of hashes in a single CCMD_GET_PREIMAGES request.
+#define GET_PREIMAGES_MAX_HASHES 4
+
+/**
+ * Requests the preimages of several sha256 hashes to the host, with a single CCMD_GET_PREIMAGES
+ * request. The preimages must then be read in order with call_get_preimages_read, before any other
+ * client command is sent, as they are streamed from the response (and from the following
+ * CCMD_GET_MORE_ELEMENTS responses).
+ *
+ * Returns 0 on success, a negative number on failure (including if n_hashes is 0 or larger than
+ * GET_PREIMAGES_MAX_HASHES).
+ */
+int call_get_preimages(dispatcher_context_t *dispatcher_context,
+                       const uint8_t (*hashes)[32],
+                       size_t n_hashes);
+
+/**
+ * Reads the next preimage requested with call_get_preimages, whose hash must be the given one. This
+ * function validates that the SHA256 of the data provided by the host does indeed match it.
+ *
+ * Returns the preimage length on success, or a negative number on error, or if the preimage is
+ * longer than out_len.
+ */
+int call_get_preimages_read(dispatcher_context_t *dispatcher_context,
+                            const uint8_t hash[static 32],
+                            uint8_t *out,
+                            size_t out_len);
@@ -4,11 +4,16 @@
 
 #include "../lib/get_merkle_leaf_element.h"
 #include "../../crypto.h"
-#include "../../common/base58.h"
+#include "../../common/key_info_cache.h"
+#include "../../common/pubkey_cache.h"
+#include "../../common/read.h"
 #include "../../common/segwit_addr.h"
+#include "../../common/taproot_key_cache.h"
+#include "../../target_config.h"
 
 /**
- * Convenience structure to optimize the size of parameters passed to a recursive function.
+ * Convenience structure to optimize the size of parameters passed to the functions filling the
+ * script templates.
  */
 typedef struct {
     dispatcher_context_t *dispatcher_context;
@@ -16,24 +21,82 @@ typedef struct {
     uint32_t n_keys;
     bool change;
     size_t address_index;
-    buffer_t *mem;
+    // if not NULL, the state of the TapLeaf tagged hash after its tag prefix
+    const cx_sha256_t *tapleaf_midstate;
 } _policy_parser_args_t;
 
 extern global_context_t G_context;
 
-// comparator for pointers to compressed pubkeys
-static int cmp_compressed_pubkeys(const void *a, const void *b) {
-    const uint8_t **key_a = (const uint8_t **) a;
-    const uint8_t **key_b = (const uint8_t **) b;
-    for (int i = 0; i < 33; i++) {
-        int diff = (*key_a)[i] - (*key_b)[i];
-        if (diff != 0) {
-            return diff;
+// Optimal sorting network for 5 elements; for n < 5 elements, it is enough to skip the comparators
+// involving the indexes from n onwards (think of them as holding keys larger than any other).
+static const uint8_t SORTING_NETWORK_5[][2] =
+    {{0, 1}, {3, 4}, {2, 4}, {2, 3}, {0, 3}, {0, 2}, {1, 4}, {1, 3}, {1, 2}};
+
+// Maximum number of keys of a sortedmulti that are derived and sorted in memory; larger
+// sortedmulti use the (slower) two-pass approach of fill_sorted_pubkeys_two_passes.
+#define MAX_SORTED_PUBKEYS_IN_MEMORY 5
+
+// Number of leading bytes of each compressed pubkey kept in memory by the two-pass approach.
+#define SORTED_PUBKEY_PREFIX_LEN 8
+
+// sorts lexicographically the (at most 5) pointers to compressed pubkeys
+static void sort_compressed_pubkeys(uint8_t *compressed_pubkeys[], unsigned int n) {
+    _Static_assert(MAX_SORTED_PUBKEYS_IN_MEMORY <= 5, "The sorting network only supports 5 keys");
+
+    for (unsigned int c = 0; c < sizeof(SORTING_NETWORK_5) / sizeof(SORTING_NETWORK_5[0]); c++) {
+        unsigned int i = SORTING_NETWORK_5[c][0];
+        unsigned int j = SORTING_NETWORK_5[c][1];
+        if (j < n && memcmp(compressed_pubkeys[i], compressed_pubkeys[j], 33) > 0) {
+            uint8_t *t = compressed_pubkeys[i];
+            compressed_pubkeys[i] = compressed_pubkeys[j];
+            compressed_pubkeys[j] = t;
         }
     }
-    return 0;
 }
 
+#if TARGET_PREPARED_PARENTS_SIZE > 0
+// Number of /change pubkeys whose HMAC-SHA512 key schedule is kept across the derivations of their
+// /address_index children; none on NanoS, as each entry takes about 500 bytes.
+#define N_PREPARED_PARENTS TARGET_PREPARED_PARENTS_SIZE
+
+typedef struct {
+    uint32_t n_keys;  // 0 for unused entries
+    uint32_t key_index;
+    bool change;
+    uint8_t keys_root[32];
+    bip32_prepared_parent_t parent;
+} prepared_parent_entry_t;
+
+static prepared_parent_entry_t G_prepared_parents[N_PREPARED_PARENTS];
+static size_t G_prepared_parents_next_slot;
+
+// returns the prepared /change pubkey of a key, preparing it from the given chain code and
+// uncompressed pubkey if it is not memoized yet
+static const bip32_prepared_parent_t *get_prepared_parent(const _policy_parser_args_t *args,
+                                                          int key_index,
+                                                          const uint8_t chain_code[static 32],
+                                                          const uint8_t pubkey[static 65]) {
+    for (size_t i = 0; i < N_PREPARED_PARENTS; i++) {
+        prepared_parent_entry_t *entry = &G_prepared_parents[i];
+        if (entry->n_keys == args->n_keys && entry->key_index == (uint32_t) key_index &&
+            entry->change == args->change &&
+            memcmp(entry->keys_root, args->keys_merkle_root, 32) == 0) {
+            return &entry->parent;
+        }
+    }
+
+    prepared_parent_entry_t *entry = &G_prepared_parents[G_prepared_parents_next_slot];
+    G_prepared_parents_next_slot = (G_prepared_parents_next_slot + 1) % N_PREPARED_PARENTS;
+
+    entry->n_keys = args->n_keys;
+    entry->key_index = key_index;
+    entry->change = args->change;
+    memcpy(entry->keys_root, args->keys_merkle_root, 32);
+    bip32_prepare_parent(chain_code, pubkey, &entry->parent);
+    return &entry->parent;
+}
+#endif
+
 static void update_output(buffer_t *out_buf_ptr,
                           cx_hash_t *hash_context,
                           const uint8_t *data,
@@ -51,31 +114,49 @@ static void update_output_u8(buffer_t *out_buf_ptr, cx_hash_t *hash_context, con
     update_output(out_buf_ptr, hash_context, &data, 1);
 }
 
-// Returns true iff the type corresponds to a script that is known to be at most 34 bytes.
-// Used for some memory optimizations when computing script hashes (e.g. for `sh(wsh(...))`
-// policies).
-static bool is_script_type_short(PolicyNodeType type) {
-    return (type == TOKEN_PKH || type == TOKEN_WPKH || type == TOKEN_SH || type == TOKEN_WSH);
-}
-
 // p2pkh                     ==> legacy address (start with 1 on mainnet, m or n on testnet)
 // p2sh (also nested segwit) ==> legacy script  (start with 3 on mainnet, 2 on testnet)
 // p2wpkh or p2wsh           ==> bech32         (sart with bc1 on mainnet, tb1 on testnet)
 
-// convenience function, split from get_derived_pubkey only to improve stack usage
-// returns -1 on error, 0 if the returned key info has no wildcard (**), 1 if it has the wildcard
-static int __attribute__((noinline))
-get_extended_pubkey(_policy_parser_args_t *args, int key_index, serialized_extended_pubkey_t *out) {
-    PRINT_STACK_POINTER();
+// Gets the serialized extended pubkey of a key information; if it is base58check-encoded, it is
+// decoded and its checksum is validated. Returns 0 on success, -1 on failure.
+static int get_key_info_ext_pubkey(const policy_map_key_info_t *key_info,
+                                   serialized_extended_pubkey_t *out) {
+    if (key_info->is_binary) {
+        memcpy(out, key_info->serialized_ext_pubkey, sizeof(serialized_extended_pubkey_t));
+        return 0;
+    }
 
-    policy_map_key_info_t key_info;
+    serialized_extended_pubkey_check_t decoded_pubkey_check;
+    if (base58check_decode(key_info->ext_pubkey,
+                           strlen(key_info->ext_pubkey),
+                           (uint8_t *) &decoded_pubkey_check,
+                           sizeof(decoded_pubkey_check)) !=
+        (int) sizeof(decoded_pubkey_check.serialized_extended_pubkey)) {
+        return -1;
+    }
+
+    memcpy(out,
+           &decoded_pubkey_check.serialized_extended_pubkey,
+           sizeof(decoded_pubkey_check.serialized_extended_pubkey));
+    return 0;
+}
+
+int __attribute__((noinline)) get_policy_key_info(dispatcher_context_t *dispatcher_context,
+                                                  const uint8_t keys_root[static 32],
+                                                  uint32_t n_keys,
+                                                  uint32_t key_index,
+                                                  policy_map_key_info_t *out) {
+    if (key_info_cache_get(keys_root, n_keys, key_index, out)) {
+        return 0;
+    }
 
     {
         char key_info_str[MAX_POLICY_KEY_INFO_LEN];
 
-        int key_info_len = call_get_merkle_leaf_element(args->dispatcher_context,
-                                                        args->keys_merkle_root,
-                                                        args->n_keys,
+        int key_info_len = call_get_merkle_leaf_element(dispatcher_context,
+                                                        keys_root,
+                                                        n_keys,
                                                         key_index,
                                                         (uint8_t *) key_info_str,
                                                         sizeof(key_info_str));
@@ -86,24 +167,45 @@ get_extended_pubkey(_policy_parser_args_t *args, int key_index, serialized_exten
         // Make a sub-buffer for the pubkey info
         buffer_t key_info_buffer = buffer_create(key_info_str, key_info_len);
 
-        if (parse_policy_map_key_info(&key_info_buffer, &key_info) == -1) {
+        if (parse_policy_map_key_info(&key_info_buffer, out) == -1) {
             return -1;
         }
     }
 
-    // decode pubkey
-    serialized_extended_pubkey_check_t decoded_pubkey_check;
-    if (base58_decode(key_info.ext_pubkey,
-                      strlen(key_info.ext_pubkey),
-                      (uint8_t *) &decoded_pubkey_check,
-                      sizeof(decoded_pubkey_check)) == -1) {
+#ifdef KEY_INFO_CACHE_ENABLED
+    // the extended pubkey is decoded (and its checksum verified) once, before the key is cached
+    serialized_extended_pubkey_t ext_pubkey;
+    if (get_key_info_ext_pubkey(out, &ext_pubkey) < 0) {
         return -1;
     }
-    // TODO: validate checksum
+    memcpy(out->serialized_ext_pubkey, &ext_pubkey, sizeof(ext_pubkey));
+    out->is_binary = 1;
 
-    memcpy(out,
-           &decoded_pubkey_check.serialized_extended_pubkey,
-           sizeof(decoded_pubkey_check.serialized_extended_pubkey));
+    key_info_cache_add(keys_root, n_keys, key_index, out);
+#endif
+
+    return 0;
+}
+
+// convenience function, split from get_derived_pubkey only to improve stack usage
+// returns -1 on error, 0 if the returned key info has no wildcard (**), 1 if it has the wildcard
+static int __attribute__((noinline))
+get_extended_pubkey(_policy_parser_args_t *args, int key_index, serialized_extended_pubkey_t *out) {
+    PRINT_STACK_POINTER();
+
+    policy_map_key_info_t key_info;
+    if (get_policy_key_info(args->dispatcher_context,
+                            args->keys_merkle_root,
+                            args->n_keys,
+                            key_index,
+                            &key_info) < 0) {
+        return -1;
+    }
+
+    // this only happens once per key, as the result is kept in the pubkey cache
+    if (get_key_info_ext_pubkey(&key_info, out) < 0) {
+        return -1;
+    }
 
     return key_info.has_wildcard ? 1 : 0;
 }
@@ -112,373 +214,546 @@ static int get_derived_pubkey(_policy_parser_args_t *args, int key_index, uint8_
     PRINT_STACK_POINTER();
 
     serialized_extended_pubkey_t ext_pubkey;
+    memset(&ext_pubkey, 0, sizeof(ext_pubkey));
+
+    // the uncompressed pubkey; only the chain code of ext_pubkey is used after fetching the key
+    uint8_t pubkey[65];
+
+    // the key info, and the /change child for keys with wildcard, are cached, as they are shared by
+    // all the scripts computed for the same wallet policy
+    bool has_wildcard;
+    if (!pubkey_cache_get(args->keys_merkle_root,
+                          args->n_keys,
+                          key_index,
+                          args->change,
+                          &has_wildcard,
+                          ext_pubkey.chain_code,
+                          pubkey)) {
+        int ret = get_extended_pubkey(args, key_index, &ext_pubkey);
+        if (ret < 0) {
+            return -1;
+        }
+        has_wildcard = (ret == 1);
 
-    int ret = get_extended_pubkey(args, key_index, &ext_pubkey);
-    if (ret < 0) {
-        return -1;
+        if (crypto_get_uncompressed_pubkey(ext_pubkey.compressed_pubkey, pubkey) < 0) {
+            return -1;
+        }
+
+        if (has_wildcard) {
+            // we derive the /change child of this pubkey, reusing the same memory
+            if (bip32_CKDpub_uncompressed(ext_pubkey.chain_code,
+                                          pubkey,
+                                          args->change,
+                                          ext_pubkey.chain_code,
+                                          pubkey) < 0) {
+                return -1;
+            }
+        }
+
+        pubkey_cache_add(args->keys_merkle_root,
+                         args->n_keys,
+                         key_index,
+                         args->change,
+                         has_wildcard,
+                         ext_pubkey.chain_code,
+                         pubkey);
     }
 
-    if (ret == 1) {
-        // we derive the /0/i child of this pubkey
-        // we reuse the same memory of ext_pubkey
-        bip32_CKDpub(&ext_pubkey, args->change, &ext_pubkey);
-        bip32_CKDpub(&ext_pubkey, args->address_index, &ext_pubkey);
+    if (has_wildcard) {
+        // we derive the /address_index child of the /change pubkey; as the /change pubkey is
+        // uncompressed, this does not need the square root computed by bip32_CKDpub
+#if TARGET_PREPARED_PARENTS_SIZE > 0
+        // the HMAC-SHA512 key schedule of the /change pubkey is shared by all its children
+        const bip32_prepared_parent_t *parent =
+            get_prepared_parent(args, key_index, ext_pubkey.chain_code, pubkey);
+        if (bip32_CKDpub_prepared(parent,
+                                  args->address_index,
+                                  ext_pubkey.chain_code,
+                                  pubkey) < 0) {
+            return -1;
+        }
+#else
+        if (bip32_CKDpub_uncompressed(ext_pubkey.chain_code,
+                                      pubkey,
+                                      args->address_index,
+                                      ext_pubkey.chain_code,
+                                      pubkey) < 0) {
+            return -1;
+        }
+#endif
     }
 
-    memcpy(out, ext_pubkey.compressed_pubkey, 33);
+    crypto_get_compressed_pubkey(pubkey, out);
 
     return 0;
 }
 
-// forward-declaration
-int _call_get_wallet_script(_policy_parser_args_t *args,
-                            policy_node_t *policy,
-                            buffer_t *out_buf,
-                            cx_hash_t *hash_context);
-
-static int get_pkh_wpkh_script(_policy_parser_args_t *args,
-                               policy_node_t *policy,
-                               buffer_t *out_buf,
-                               cx_hash_t *hash_context) {
-    policy_node_with_key_t *root = (policy_node_with_key_t *) policy;
-
-    unsigned int out_len;
-    if (policy->type == TOKEN_PKH) {
-        out_len = 3 + 20 + 2;
-    } else {
-        out_len = 2 + 20;
+// fills an operation taking a single key; returns the number of bytes added to the script
+static int __attribute__((noinline)) fill_key_op(_policy_parser_args_t *args,
+                                                 uint8_t op,
+                                                 uint8_t key_index,
+                                                 buffer_t *out_buf,
+                                                 cx_hash_t *hash_context) {
+    if (op == SCRIPT_TEMPLATE_OP_TAPROOT_OUTPUT_KEY) {
+        // if the output key is cached, neither the derivation nor the tweak are needed
+        uint8_t output_key[32];
+        if (taproot_key_cache_get(args->keys_merkle_root,
+                                  args->n_keys,
+                                  key_index,
+                                  args->change,
+                                  args->address_index,
+                                  output_key)) {
+            update_output(out_buf, hash_context, output_key, 32);
+            return 32;
+        }
     }
-    if (out_buf != NULL && !buffer_can_read(out_buf, out_len)) {
+
+    uint8_t compressed_pubkey[33];
+    if (-1 == get_derived_pubkey(args, key_index, compressed_pubkey)) {
         return -1;
     }
 
-    int result;
-    buffer_snapshot_t snap = buffer_snapshot(args->mem);
-
-    // memory block taking 33 bytes
-    {
-        uint8_t *compressed_pubkey = (uint8_t *) buffer_alloc(args->mem, 33, false);
-
-        if (compressed_pubkey == NULL) {
-            result = -1;
-        } else if (-1 == get_derived_pubkey(args, root->key_index, compressed_pubkey)) {
-            result = -1;
-        } else if (policy->type == TOKEN_PKH) {
-            update_output_u8(out_buf, hash_context, 0x76);
-            update_output_u8(out_buf, hash_context, 0xa9);
-            update_output_u8(out_buf, hash_context, 0x14);
-
+    switch (op) {
+        case SCRIPT_TEMPLATE_OP_PUBKEY:
+            update_output(out_buf, hash_context, compressed_pubkey, 33);
+            return 33;
+        case SCRIPT_TEMPLATE_OP_PUBKEY_HASH160:
             crypto_hash160(compressed_pubkey, 33, compressed_pubkey);  // reuse memory
             update_output(out_buf, hash_context, compressed_pubkey, 20);
+            return 20;
+        case SCRIPT_TEMPLATE_OP_TAPROOT_OUTPUT_KEY: {
+            uint8_t tweaked_key[32];
+            uint8_t parity;
+            if (crypto_tr_tweak_pubkey(compressed_pubkey + 1, NULL, &parity, tweaked_key) < 0) {
+                return -1;
+            }
+            taproot_key_cache_add(args->keys_merkle_root,
+                                  args->n_keys,
+                                  key_index,
+                                  args->change,
+                                  args->address_index,
+                                  tweaked_key);
+            update_output(out_buf, hash_context, tweaked_key, 32);
+            return 32;
+        }
+        case SCRIPT_TEMPLATE_OP_XONLY_PUBKEY:
+            update_output(out_buf, hash_context, compressed_pubkey + 1, 32);
+            return 32;
+        default:
+            return -1;
+    }
+}
 
-            update_output_u8(out_buf, hash_context, 0x88);
-            update_output_u8(out_buf, hash_context, 0xac);
+static void update_output_pubkey_push(buffer_t *out_buf,
+                                      cx_hash_t *hash_context,
+                                      const uint8_t compressed_pubkey[static 33]) {
+    // push <pubkey> (33 = 0x21 bytes)
+    update_output_u8(out_buf, hash_context, 0x21);
+    update_output(out_buf, hash_context, compressed_pubkey, 33);
+}
 
-            result = 3 + 20 + 2;
-        } else {  // policy->type == TOKEN_WPKH
-            update_output_u8(out_buf, hash_context, 0x00);
-            update_output_u8(out_buf, hash_context, 0x14);
+// Derives all the keys, and sorts them in memory.
+static int __attribute__((noinline)) fill_sorted_pubkeys_in_memory(_policy_parser_args_t *args,
+                                                                   const uint8_t key_indexes[],
+                                                                   unsigned int n,
+                                                                   buffer_t *out_buf,
+                                                                   cx_hash_t *hash_context) {
+    PRINT_STACK_POINTER();
 
-            crypto_hash160(compressed_pubkey, 33, compressed_pubkey);  // reuse memory
-            update_output(out_buf, hash_context, compressed_pubkey, 20);
+    // total size occupation n * (4 + 33)
+    //   = 185 for n = 5.
+    uint8_t compressed_pubkeys_data[MAX_SORTED_PUBKEYS_IN_MEMORY][33];
+    uint8_t *compressed_pubkeys[MAX_SORTED_PUBKEYS_IN_MEMORY];
 
-            result = 2 + 20;
+    for (unsigned int i = 0; i < n; i++) {
+        compressed_pubkeys[i] = compressed_pubkeys_data[i];
+        if (-1 == get_derived_pubkey(args, key_indexes[i], compressed_pubkeys[i])) {
+            return -1;
         }
     }
-    buffer_restore(args->mem, snap);
-    return result;
-}
 
-static int get_sh_wsh_script(_policy_parser_args_t *args,
-                             policy_node_t *policy,
-                             buffer_t *out_buf,
-                             cx_hash_t *hash_context) {
-    policy_node_with_script_t *root = (policy_node_with_script_t *) policy;
-
-    uint8_t *script_hash;
-
-    int result;
-    buffer_snapshot_t snap = buffer_snapshot(args->mem);
-
-    // memory block; will take up to:
-    // - sizeof(cx_sha256_t) + 32 = 108 + 32 = 140 bytes if the inner script is long/unknown
-    // - 34 + 32 = 66 bytes for known standard scripts
-    do {
-        // Memory optimization: as the script_hash_context is expensive (>100 bytes), if we know
-        // that the internal script is short, we are better off computing the full internal script
-        // (rather than its hash).
-        if (is_script_type_short(root->script->type)) {
-            uint8_t *internal_script = buffer_alloc(args->mem, 34, false);
-            if (internal_script == NULL) {
-                result = -1;
-                break;
-            }
+    // sort the pubkey pointers (we avoid qsort, as it takes ~700 bytes in binary size)
+    sort_compressed_pubkeys(compressed_pubkeys, n);
 
-            buffer_t internal_script_buf = buffer_create(internal_script, 34);
+    for (unsigned int i = 0; i < n; i++) {
+        update_output_pubkey_push(out_buf, hash_context, compressed_pubkeys[i]);
+    }
 
-            int internal_script_len =
-                _call_get_wallet_script(args, root->script, &internal_script_buf, NULL);
-            if (internal_script_len == -1) {
-                result = -1;
-                break;
-            }
+    return 34 * n;
+}
 
-            script_hash = (uint8_t *) buffer_alloc(args->mem, 32, false);  // sha256 of the script
-            if (script_hash == NULL) {
-                result = -1;
-                break;
-            }
+typedef struct {
+    uint8_t prefix[SORTED_PUBKEY_PREFIX_LEN];
+    uint8_t key_index;
+} sorted_pubkey_prefix_t;
+
+// Compares two derived pubkeys whose prefixes are identical, deriving them again. Only happens if
+// the same key is used more than once, or for (extremely unlikely) prefix collisions.
+// Returns -2 on error.
+static int __attribute__((noinline)) cmp_derived_pubkeys(_policy_parser_args_t *args,
+                                                         uint8_t key_index_a,
+                                                         uint8_t key_index_b) {
+    if (key_index_a == key_index_b) {
+        return 0;
+    }
 
-            cx_hash_sha256(internal_script, internal_script_len, script_hash, 32);
-        } else {
-            cx_sha256_t *script_hash_context =
-                (cx_sha256_t *) buffer_alloc(args->mem, sizeof(cx_sha256_t), true);
-            if (script_hash_context == NULL) {
-                result = -1;
-                break;
-            }
+    uint8_t pubkey_a[33];
+    uint8_t pubkey_b[33];
+    if (-1 == get_derived_pubkey(args, key_index_a, pubkey_a) ||
+        -1 == get_derived_pubkey(args, key_index_b, pubkey_b)) {
+        return -2;
+    }
+    int diff = memcmp(pubkey_a, pubkey_b, 33);
+    return diff < 0 ? -1 : (diff > 0 ? 1 : 0);
+}
 
-            cx_sha256_init(script_hash_context);
+// Sorts the keys while only keeping a short prefix of each of them in memory, then derives them
+// again in sorted order; therefore, memory usage does not depend on the size of the keys, at the
+// cost of deriving each key twice.
+static int __attribute__((noinline)) fill_sorted_pubkeys_two_passes(_policy_parser_args_t *args,
+                                                                    const uint8_t key_indexes[],
+                                                                    unsigned int n,
+                                                                    buffer_t *out_buf,
+                                                                    cx_hash_t *hash_context) {
+    PRINT_STACK_POINTER();
 
-            int res =
-                _call_get_wallet_script(args, root->script, NULL, &script_hash_context->header);
-            if (res == -1) {
-                result = -1;
-                break;
-            }
+    // total size occupation n * (8 + 1) + 33
+    //   = 168 for n = 15.
+    sorted_pubkey_prefix_t sorted[MAX_POLICY_MAP_COSIGNERS];
+    uint8_t compressed_pubkey[33];
 
-            script_hash = (uint8_t *) buffer_alloc(args->mem, 32, false);  // sha256 of the script
-            if (script_hash == NULL) {
-                result = -1;
+    // first pass: derive each key, and insert its prefix in sorted position
+    for (unsigned int i = 0; i < n; i++) {
+        if (-1 == get_derived_pubkey(args, key_indexes[i], compressed_pubkey)) {
+            return -1;
+        }
+
+        unsigned int pos = i;
+        while (pos > 0) {
+            int diff =
+                memcmp(sorted[pos - 1].prefix, compressed_pubkey, SORTED_PUBKEY_PREFIX_LEN);
+            if (diff == 0) {
+                diff = cmp_derived_pubkeys(args, sorted[pos - 1].key_index, key_indexes[i]);
+                if (diff == -2) {
+                    return -1;
+                }
+            }
+            if (diff <= 0) {
                 break;
             }
-
-            crypto_hash_digest(&script_hash_context->header, script_hash, 32);
+            sorted[pos] = sorted[pos - 1];
+            --pos;
         }
+        memcpy(sorted[pos].prefix, compressed_pubkey, SORTED_PUBKEY_PREFIX_LEN);
+        sorted[pos].key_index = key_indexes[i];
+    }
 
-        if (policy->type == TOKEN_SH) {
-            update_output_u8(out_buf, hash_context, 0xa9);
-            update_output_u8(out_buf, hash_context, 0x14);
-
-            crypto_ripemd160(script_hash, 32, script_hash);  // reuse memory
-            update_output(out_buf, hash_context, script_hash, 20);
-
-            update_output_u8(out_buf, hash_context, 0x87);
-
-            result = 2 + 20 + 1;
-        } else {  // policy->type == TOKEN_WSH
-            update_output_u8(out_buf, hash_context, 0x00);
-            update_output_u8(out_buf, hash_context, 0x20);
-
-            update_output(out_buf, hash_context, script_hash, 32);
-
-            result = 2 + 32;
+    // second pass: derive the keys again, in sorted order
+    for (unsigned int i = 0; i < n; i++) {
+        if (-1 == get_derived_pubkey(args, sorted[i].key_index, compressed_pubkey)) {
+            return -1;
         }
-    } while (false);
+        update_output_pubkey_push(out_buf, hash_context, compressed_pubkey);
+    }
 
-    buffer_restore(args->mem, snap);
-    return result;
+    return 34 * n;
 }
 
-int get_multi_script(_policy_parser_args_t *args,
-                     policy_node_t *policy,
-                     buffer_t *out_buf,
-                     cx_hash_t *hash_context) {
-    PRINT_STACK_POINTER();
-
-    policy_node_multisig_t *root = (policy_node_multisig_t *) policy;
-
-    // k {pubkey_1} ... {pubkey_n} n OP_CHECKMULTISIG
-    unsigned int out_len = 1 + 34 * root->n + 1 + 1;
-
-    if (out_buf != NULL && !buffer_can_read(out_buf, out_len)) {
+// fills a SCRIPT_TEMPLATE_OP_SORTED_PUBKEYS operation, reading its arguments from ops_buf; returns
+// the number of bytes added to the script
+static int fill_sorted_pubkeys_op(_policy_parser_args_t *args,
+                                  buffer_t *ops_buf,
+                                  buffer_t *out_buf,
+                                  cx_hash_t *hash_context) {
+    uint8_t n;
+    uint8_t key_indexes[MAX_POLICY_MAP_COSIGNERS];
+    if (!buffer_read_u8(ops_buf, &n) || n > MAX_POLICY_MAP_COSIGNERS ||
+        !buffer_read_bytes(ops_buf, key_indexes, n)) {
         return -1;
     }
 
-    update_output_u8(out_buf, hash_context, 0x50 + root->k);  // OP_k
-
-    int result = 0;
-    buffer_snapshot_t snap = buffer_snapshot(args->mem);
-
-    do {
-        uint8_t *compressed_pubkey = (uint8_t *) buffer_alloc(args->mem, 33, false);
-        if (compressed_pubkey == NULL) {
-            result = -1;
-            break;
-        }
+    if (n <= MAX_SORTED_PUBKEYS_IN_MEMORY) {
+        return fill_sorted_pubkeys_in_memory(args, key_indexes, n, out_buf, hash_context);
+    } else {
+        return fill_sorted_pubkeys_two_passes(args, key_indexes, n, out_buf, hash_context);
+    }
+}
 
-        for (unsigned int i = 0; i < root->n; i++) {
-            if (-1 == get_derived_pubkey(args, root->key_indexes[i], compressed_pubkey)) {
-                result = -1;
+static int fill_taproot_tree_output_key_op(_policy_parser_args_t *args,
+                                           buffer_t *ops_buf,
+                                           buffer_t *out_buf,
+                                           cx_hash_t *hash_context);
+
+// fills the script of a segment of the template; returns its length. inner_script_hash is NULL for
+// the segments that have no inner script, like the tapscripts
+static int fill_segment(_policy_parser_args_t *args,
+                        buffer_t *ops_buf,
+                        const uint8_t *inner_script_hash,
+                        buffer_t *out_buf,
+                        cx_hash_t *hash_context) {
+    int script_len = 0;
+
+    uint8_t op;
+    while (buffer_read_u8(ops_buf, &op)) {
+        int op_len;
+        switch (op) {
+            case SCRIPT_TEMPLATE_OP_BYTES: {
+                uint8_t data_len;
+                if (!buffer_read_u8(ops_buf, &data_len) || !buffer_can_read(ops_buf, data_len)) {
+                    return -1;
+                }
+                update_output(out_buf, hash_context, ops_buf->ptr + ops_buf->offset, data_len);
+                buffer_seek_cur(ops_buf, data_len);
+                op_len = data_len;
                 break;
             }
-            // push <i-th pubkey> (33 = 0x21 bytes)
-            update_output_u8(out_buf, hash_context, 0x21);
-            update_output(out_buf, hash_context, compressed_pubkey, 33);
-        }
-        if (result == -1) {
-            break;
+            case SCRIPT_TEMPLATE_OP_PUBKEY:
+            case SCRIPT_TEMPLATE_OP_PUBKEY_HASH160:
+            case SCRIPT_TEMPLATE_OP_TAPROOT_OUTPUT_KEY:
+            case SCRIPT_TEMPLATE_OP_XONLY_PUBKEY: {
+                uint8_t key_index;
+                if (!buffer_read_u8(ops_buf, &key_index)) {
+                    return -1;
+                }
+                op_len = fill_key_op(args, op, key_index, out_buf, hash_context);
+                break;
+            }
+            case SCRIPT_TEMPLATE_OP_SORTED_PUBKEYS:
+                op_len = fill_sorted_pubkeys_op(args, ops_buf, out_buf, hash_context);
+                break;
+            case SCRIPT_TEMPLATE_OP_TAPROOT_TREE_OUTPUT_KEY:
+                op_len = fill_taproot_tree_output_key_op(args, ops_buf, out_buf, hash_context);
+                break;
+            case SCRIPT_TEMPLATE_OP_INNER_SHA256:
+                if (inner_script_hash == NULL) {
+                    return -1;
+                }
+                update_output(out_buf, hash_context, inner_script_hash, 32);
+                op_len = 32;
+                break;
+            case SCRIPT_TEMPLATE_OP_INNER_HASH160: {
+                if (inner_script_hash == NULL) {
+                    return -1;
+                }
+                uint8_t script_hash160[20];
+                crypto_ripemd160(inner_script_hash, 32, script_hash160);
+                update_output(out_buf, hash_context, script_hash160, 20);
+                op_len = 20;
+                break;
+            }
+            default:
+                return -1;
         }
 
-        update_output_u8(out_buf, hash_context, 0x50 + root->n);  // OP_n
-        update_output_u8(out_buf, hash_context, 0xae);            // OP_CHECKMULTISIG
-
-        result = out_len;
-    } while (false);
+        if (op_len < 0) {
+            return -1;
+        }
+        script_len += op_len;
+    }
+    return script_len;
+}
 
-    buffer_restore(args->mem, snap);
-    return result;
+// reads the header of a leaf of the program of a taproot tree; ops_buf is set to its operations
+static bool read_tapleaf(buffer_t *tree_buf, uint8_t *script_len, buffer_t *ops_buf) {
+    uint8_t ops_len;
+    if (!buffer_read_u8(tree_buf, script_len) || !buffer_read_u8(tree_buf, &ops_len) ||
+        !buffer_can_read(tree_buf, ops_len)) {
+        return false;
+    }
+    *ops_buf = buffer_create(tree_buf->ptr + tree_buf->offset, ops_len);
+    buffer_seek_cur(tree_buf, ops_len);
+    return true;
 }
 
-int get_sortedmulti_script(_policy_parser_args_t *args,
-                           policy_node_t *policy,
-                           buffer_t *out_buf,
-                           cx_hash_t *hash_context) {
+// computes the TapLeaf hash of a tapscript, with leaf version 0xC0; the tapscript is only hashed
+// while it is filled, and never kept in memory
+static int __attribute__((noinline)) get_tapleaf_hash(_policy_parser_args_t *args,
+                                                      buffer_t *ops_buf,
+                                                      uint8_t script_len,
+                                                      uint8_t out[static 32]) {
     PRINT_STACK_POINTER();
 
-    policy_node_multisig_t *root = (policy_node_multisig_t *) policy;
-
-    // TODO: replace with the maximum we can afford
-    if (root->n > 5) {
-        return -1;
+    cx_sha256_t hash_context;
+    if (args->tapleaf_midstate != NULL) {
+        crypto_sha256_restore(&hash_context, args->tapleaf_midstate);
+    } else {
+        crypto_tr_tagged_hash_init(&hash_context, BIP0341_tapleaf_tag_hash);
     }
 
-    // k {pubkey_1} ... {pubkey_n} n OP_CHECKMULTISIG
-    unsigned int out_len = 1 + 34 * root->n + 1 + 1;
-
-    if (out_buf != NULL && !buffer_can_read(out_buf, out_len)) {
+    crypto_hash_update_u8(&hash_context.header, 0xC0);
+    crypto_hash_update_varint(&hash_context.header, script_len);
+    if (fill_segment(args, ops_buf, NULL, NULL, &hash_context.header) != script_len) {
         return -1;
     }
+    crypto_hash_digest(&hash_context.header, out, 32);
+    return 0;
+}
 
-    update_output_u8(out_buf, hash_context, 0x50 + root->k);  // OP_k
-
-    // total size occupation n * (4 + 33)
-    //   = 185 for n = 5.
+// replaces the hashes a and b with their TapBranch hash, written in a
+static void tapbranch_hash(uint8_t a[static 32], const uint8_t b[static 32]) {
+    cx_sha256_t hash_context;
+    crypto_tr_tagged_hash_init(&hash_context, BIP0341_tapbranch_tag_hash);
 
-    int result = 0;
-    buffer_snapshot_t snap = buffer_snapshot(args->mem);
+    // the two hashes are sorted lexicographically
+    bool a_first = memcmp(a, b, 32) < 0;
+    crypto_hash_update(&hash_context.header, a_first ? a : b, 32);
+    crypto_hash_update(&hash_context.header, a_first ? b : a, 32);
+    crypto_hash_digest(&hash_context.header, a, 32);
+}
 
-    do {
-        uint8_t **compressed_pubkeys =
-            (uint8_t **) buffer_alloc(args->mem, root->n * sizeof(uint8_t *), true);
-        if (compressed_pubkeys == NULL) {
-            result = -1;
-            break;
-        }
+// computes the Merkle root of a taproot tree, running its program (see taptree_op_e)
+static int __attribute__((noinline)) get_taptree_merkle_root(_policy_parser_args_t *args,
+                                                             buffer_t *tree_buf,
+                                                             uint8_t out[static 32]) {
+    PRINT_STACK_POINTER();
 
-        // allocate space for, and derive each key
-        for (unsigned int i = 0; i < root->n; i++) {
-            compressed_pubkeys[i] = (uint8_t *) buffer_alloc(args->mem, 33, false);
-            if (compressed_pubkeys[i] == NULL) {
-                result = -1;
-                break;
+    uint8_t stack[MAX_TAPTREE_STACK_SIZE][32];
+    unsigned int stack_len = 0;
+
+    uint8_t op;
+    while (buffer_read_u8(tree_buf, &op)) {
+        if (op == TAPTREE_OP_LEAF) {
+            uint8_t script_len;
+            buffer_t ops_buf;
+            if (stack_len >= MAX_TAPTREE_STACK_SIZE ||
+                !read_tapleaf(tree_buf, &script_len, &ops_buf) ||
+                get_tapleaf_hash(args, &ops_buf, script_len, stack[stack_len]) < 0) {
+                return -1;
             }
-
-            if (-1 == get_derived_pubkey(args, root->key_indexes[i], compressed_pubkeys[i])) {
-                result = -1;
-                break;
+            ++stack_len;
+        } else if (op == TAPTREE_OP_BRANCH) {
+            if (stack_len < 2) {
+                return -1;
             }
+            tapbranch_hash(stack[stack_len - 2], stack[stack_len - 1]);
+            --stack_len;
+        } else {
+            return -1;
         }
-        if (result == -1) {
-            break;
-        }
-
-        // sort the pubkey pointers (we avoid use qsort, as it takes ~700 bytes in binary size)
-
-        // qsort(compressed_pubkeys, root->n, sizeof(uint8_t *), cmp_compressed_pubkeys);
+    }
 
-        // bubble sort
-        bool swapped;
-        do {
-            swapped = false;
-            for (unsigned int i = 1; i < root->n; i++) {
-                if (cmp_compressed_pubkeys(&compressed_pubkeys[i - 1], &compressed_pubkeys[i]) >
-                    0) {
-                    swapped = true;
+    if (stack_len != 1) {
+        return -1;
+    }
+    memcpy(out, stack[0], 32);
+    return 0;
+}
 
-                    uint8_t *t = compressed_pubkeys[i - 1];
-                    compressed_pubkeys[i - 1] = compressed_pubkeys[i];
-                    compressed_pubkeys[i] = t;
-                }
+// returns true if the operations of a tapscript contain the key with the given index
+static bool tapleaf_has_key(buffer_t ops_buf, uint8_t key_index) {
+    uint8_t op;
+    while (buffer_read_u8(&ops_buf, &op)) {
+        uint8_t arg;
+        if (!buffer_read_u8(&ops_buf, &arg)) {
+            return false;
+        }
+        if (op == SCRIPT_TEMPLATE_OP_BYTES) {
+            if (!buffer_seek_cur(&ops_buf, arg)) {
+                return false;
             }
-        } while (swapped);
-
-        for (unsigned int i = 0; i < root->n; i++) {
-            // push <i-th pubkey> (33 = 0x21 bytes)
-            update_output_u8(out_buf, hash_context, 0x21);
-            update_output(out_buf, hash_context, compressed_pubkeys[i], 33);
+        } else if (op == SCRIPT_TEMPLATE_OP_XONLY_PUBKEY) {
+            if (arg == key_index) {
+                return true;
+            }
+        } else {
+            return false;  // not in the tapscripts of the supported policies
         }
-
-        update_output_u8(out_buf, hash_context, 0x50 + root->n);  // OP_n
-        update_output_u8(out_buf, hash_context, 0xae);            // OP_CHECKMULTISIG
-
-        result = out_len;
-    } while (false);
-
-    buffer_restore(args->mem, snap);
-    return result;
+    }
+    return false;
 }
 
-static int get_tr_script(_policy_parser_args_t *args,
-                         policy_node_t *policy,
-                         buffer_t *out_buf,
-                         cx_hash_t *hash_context) {
-    policy_node_with_key_t *root = (policy_node_with_key_t *) policy;
+// fills a SCRIPT_TEMPLATE_OP_TAPROOT_TREE_OUTPUT_KEY operation, reading its arguments from ops_buf;
+// returns the number of bytes added to the script
+static int __attribute__((noinline)) fill_taproot_tree_output_key_op(_policy_parser_args_t *args,
+                                                                     buffer_t *ops_buf,
+                                                                     buffer_t *out_buf,
+                                                                     cx_hash_t *hash_context) {
+    uint8_t key_index;
+    uint8_t tree_len;
+    if (!buffer_read_u8(ops_buf, &key_index) || !buffer_read_u8(ops_buf, &tree_len) ||
+        !buffer_can_read(ops_buf, tree_len)) {
+        return -1;
+    }
+    buffer_t tree_buf = buffer_create(ops_buf->ptr + ops_buf->offset, tree_len);
+    buffer_seek_cur(ops_buf, tree_len);
+
+    // the output key is not in the taproot key cache, that is only for BIP-86 output keys
+    uint8_t merkle_root[32];
+    if (get_taptree_merkle_root(args, &tree_buf, merkle_root) < 0) {
+        return -1;
+    }
 
-    unsigned int out_len = 2 + 32;
-    if (out_buf != NULL && !buffer_can_read(out_buf, out_len)) {
+    uint8_t compressed_pubkey[33];
+    if (-1 == get_derived_pubkey(args, key_index, compressed_pubkey)) {
         return -1;
     }
 
-    int result;
-    buffer_snapshot_t snap = buffer_snapshot(args->mem);
+    uint8_t tweaked_key[32];
+    uint8_t parity;
+    if (crypto_tr_tweak_pubkey(compressed_pubkey + 1, merkle_root, &parity, tweaked_key) < 0) {
+        return -1;
+    }
+    update_output(out_buf, hash_context, tweaked_key, 32);
+    return 32;
+}
 
-    // memory block taking 33+32 bytes
-    {
-        uint8_t *compressed_pubkey = (uint8_t *) buffer_alloc(args->mem, 33, false);
-        uint8_t *tweaked_key = (uint8_t *) buffer_alloc(args->mem, 32, false);
+int call_get_wallet_script_from_template(dispatcher_context_t *dispatcher_context,
+                                         const uint8_t *script_template,
+                                         size_t script_template_len,
+                                         const uint8_t keys_merkle_root[static 32],
+                                         uint32_t n_keys,
+                                         bool change,
+                                         size_t address_index,
+                                         buffer_t *out_buf,
+                                         cx_hash_t *hash_context) {
+    PRINT_STACK_POINTER();
 
-        if (compressed_pubkey == NULL || tweaked_key == NULL) {
-            result = -1;
-        } else if (-1 == get_derived_pubkey(args, root->key_index, compressed_pubkey)) {
-            result = -1;
-        } else {
-            update_output_u8(out_buf, hash_context, 0x51);
-            update_output_u8(out_buf, hash_context, 0x20);
+    _policy_parser_args_t args = {.dispatcher_context = dispatcher_context,
+                                  .keys_merkle_root = keys_merkle_root,
+                                  .n_keys = n_keys,
+                                  .change = change,
+                                  .address_index = address_index,
+                                  .tapleaf_midstate = NULL};
+
+    // the inner scripts are only hashed; each hash is used by the following segment
+    cx_sha256_t inner_script_context;
+    uint8_t inner_script_hash[32];
+    memset(inner_script_hash, 0, sizeof(inner_script_hash));
+
+    buffer_t template_buf = buffer_create((void *) script_template, script_template_len);
+    while (true) {
+        uint16_t script_len;
+        uint8_t ops_len;
+        if (!buffer_read_u16(&template_buf, &script_len, BE) ||
+            !buffer_read_u8(&template_buf, &ops_len) || !buffer_can_read(&template_buf, ops_len)) {
+            return -1;
+        }
 
-            uint8_t parity;
-            crypto_tr_tweak_pubkey(compressed_pubkey + 1, &parity, tweaked_key);
+        buffer_t ops_buf = buffer_create(template_buf.ptr + template_buf.offset, ops_len);
+        buffer_seek_cur(&template_buf, ops_len);
 
-            update_output(out_buf, hash_context, tweaked_key, 32);
+        bool is_last = !buffer_can_read(&template_buf, 1);
+        if (is_last) {
+            if (out_buf != NULL && !buffer_can_read(out_buf, script_len)) {
+                return -1;
+            }
 
-            result = 2 + 32;
+            if (fill_segment(&args, &ops_buf, inner_script_hash, out_buf, hash_context) !=
+                script_len) {
+                return -1;
+            }
+            return script_len;
         }
-    }
-    buffer_restore(args->mem, snap);
-    return result;
-}
-
-int _call_get_wallet_script(_policy_parser_args_t *args,
-                            policy_node_t *policy,
-                            buffer_t *out_buf,
-                            cx_hash_t *hash_context) {
-    PRINT_STACK_POINTER();
 
-    switch (policy->type) {
-        case TOKEN_PKH:
-        case TOKEN_WPKH:
-            return get_pkh_wpkh_script(args, policy, out_buf, hash_context);
-        case TOKEN_SH:
-        case TOKEN_WSH:
-            return get_sh_wsh_script(args, policy, out_buf, hash_context);
-        case TOKEN_MULTI:
-            return get_multi_script(args, policy, out_buf, hash_context);
-        case TOKEN_SORTEDMULTI:
-            return get_sortedmulti_script(args, policy, out_buf, hash_context);
-        case TOKEN_TR:
-            return get_tr_script(args, policy, out_buf, hash_context);
-        default:
+        cx_sha256_init(&inner_script_context);
+        if (fill_segment(&args,
+                         &ops_buf,
+                         inner_script_hash,
+                         NULL,
+                         &inner_script_context.header) != script_len) {
             return -1;
+        }
+        crypto_hash_digest(&inner_script_context.header, inner_script_hash, 32);
     }
 }
 
@@ -490,20 +765,70 @@ int call_get_wallet_script(dispatcher_context_t *dispatcher_context,
                            size_t address_index,
                            buffer_t *out_buf,
                            cx_hash_t *hash_context) {
-    // Estimated worst case memory used for sh(wsh(sortedmulti(5, ...)))
-    //   34 + 108 + 5 * 37 = 327
-    //
+    uint8_t script_template[MAX_SCRIPT_TEMPLATE_LEN];
+    int script_template_len =
+        compile_script_template(policy, script_template, sizeof(script_template));
+    if (script_template_len < 0) {
+        return -1;
+    }
 
-    uint8_t mem[328];
-    buffer_t mem_buf = buffer_create(mem, sizeof(mem));
+    return call_get_wallet_script_from_template(dispatcher_context,
+                                                script_template,
+                                                script_template_len,
+                                                keys_merkle_root,
+                                                n_keys,
+                                                change,
+                                                address_index,
+                                                out_buf,
+                                                hash_context);
+}
+
+int call_get_taptree_hash(dispatcher_context_t *dispatcher_context,
+                          const policy_node_tree_t *tree,
+                          const uint8_t keys_merkle_root[static 32],
+                          uint32_t n_keys,
+                          bool change,
+                          size_t address_index,
+                          const cx_sha256_t *tapleaf_midstate,
+                          int leaf_key_index,
+                          uint8_t out[static 32]) {
+    PRINT_STACK_POINTER();
 
     _policy_parser_args_t args = {.dispatcher_context = dispatcher_context,
                                   .keys_merkle_root = keys_merkle_root,
                                   .n_keys = n_keys,
                                   .change = change,
                                   .address_index = address_index,
-                                  .mem = &mem_buf};
-    return _call_get_wallet_script(&args, policy, out_buf, hash_context);
+                                  .tapleaf_midstate = tapleaf_midstate};
+
+    uint8_t tree_template[MAX_SCRIPT_TEMPLATE_LEN];
+    int tree_template_len = compile_taptree_template(tree, tree_template, sizeof(tree_template));
+    if (tree_template_len < 0) {
+        return -1;
+    }
+    buffer_t tree_buf = buffer_create(tree_template, tree_template_len);
+
+    if (leaf_key_index < 0) {
+        return get_taptree_merkle_root(&args, &tree_buf, out) < 0 ? -1 : 1;
+    }
+
+    // only the leaf with the key is hashed
+    uint8_t op;
+    while (buffer_read_u8(&tree_buf, &op)) {
+        if (op == TAPTREE_OP_LEAF) {
+            uint8_t script_len;
+            buffer_t ops_buf;
+            if (!read_tapleaf(&tree_buf, &script_len, &ops_buf)) {
+                return -1;
+            }
+            if (tapleaf_has_key(ops_buf, (uint8_t) leaf_key_index)) {
+                return get_tapleaf_hash(&args, &ops_buf, script_len, out) < 0 ? -1 : 1;
+            }
+        } else if (op != TAPTREE_OP_BRANCH) {
+            return -1;
+        }
+    }
+    return 0;
 }
 
 int get_policy_address_type(policy_node_t *policy) {
@@ -526,6 +851,23 @@ int get_policy_address_type(policy_node_t *policy) {
     }
 }
 
+int get_policy_script_type(const policy_node_t *policy) {
+    switch (policy->type) {
+        case TOKEN_PKH:
+            return SCRIPT_TYPE_P2PKH;
+        case TOKEN_WPKH:
+            return SCRIPT_TYPE_P2WPKH;
+        case TOKEN_SH:
+            return SCRIPT_TYPE_P2SH;
+        case TOKEN_WSH:
+            return SCRIPT_TYPE_P2WSH;
+        case TOKEN_TR:
+            return SCRIPT_TYPE_P2TR;
+        default:
+            return -1;
+    }
+}
+
 bool check_wallet_hmac(uint8_t wallet_id[static 32], uint8_t wallet_hmac[static 32]) {
     uint8_t key[32];
     uint8_t correct_hmac[32];
@@ -547,4 +889,127 @@ bool check_wallet_hmac(uint8_t wallet_id[static 32], uint8_t wallet_hmac[static
     END_TRY;
 
     return result;
-}
\ No newline at end of file
+}
+
+void compute_compiled_policy_hmac(const uint8_t compiled_policy_id[static 32],
+                                  uint8_t out[static 32]) {
+    uint8_t key[32];
+    uint8_t message[COMPILED_POLICY_HMAC_TAG_LEN + 32];
+    memcpy(message, COMPILED_POLICY_HMAC_TAG, COMPILED_POLICY_HMAC_TAG_LEN);
+    memcpy(message + COMPILED_POLICY_HMAC_TAG_LEN, compiled_policy_id, 32);
+
+    BEGIN_TRY {
+        TRY {
+            crypto_derive_symmetric_key(WALLET_SLIP0021_LABEL, WALLET_SLIP0021_LABEL_LEN, key);
+
+            cx_hmac_sha256(key, sizeof(key), message, sizeof(message), out, 32);
+        }
+        FINALLY {
+            explicit_bzero(key, sizeof(key));
+        }
+    }
+    END_TRY;
+}
+
+bool check_compiled_policy_hmac(const uint8_t compiled_policy_id[static 32],
+                                const uint8_t hmac[static 32]) {
+    uint8_t correct_hmac[32];
+    compute_compiled_policy_hmac(compiled_policy_id, correct_hmac);
+
+    bool result = os_secure_memcmp((void *) hmac, correct_hmac, 32) == 0;
+    explicit_bzero(correct_hmac, sizeof(correct_hmac));
+    return result;
+}
+
+#ifdef HAVE_UNATTENDED_SIGNING
+
+void compute_spending_policy_hmac(const uint8_t spending_policy_id[static 32],
+                                  uint8_t out[static 32]) {
+    uint8_t key[32];
+    uint8_t message[SPENDING_POLICY_HMAC_TAG_LEN + 32];
+    memcpy(message, SPENDING_POLICY_HMAC_TAG, SPENDING_POLICY_HMAC_TAG_LEN);
+    memcpy(message + SPENDING_POLICY_HMAC_TAG_LEN, spending_policy_id, 32);
+
+    BEGIN_TRY {
+        TRY {
+            crypto_derive_symmetric_key(WALLET_SLIP0021_LABEL, WALLET_SLIP0021_LABEL_LEN, key);
+
+            cx_hmac_sha256(key, sizeof(key), message, sizeof(message), out, 32);
+        }
+        FINALLY {
+            explicit_bzero(key, sizeof(key));
+        }
+    }
+    END_TRY;
+}
+
+bool check_spending_policy_hmac(const uint8_t spending_policy_id[static 32],
+                                const uint8_t hmac[static 32]) {
+    uint8_t correct_hmac[32];
+    compute_spending_policy_hmac(spending_policy_id, correct_hmac);
+
+    bool result = os_secure_memcmp((void *) hmac, correct_hmac, 32) == 0;
+    explicit_bzero(correct_hmac, sizeof(correct_hmac));
+    return result;
+}
+
+#endif
+
+bool is_policy_key_internal(const policy_map_key_info_t *key_info,
+                            uint32_t master_key_fingerprint,
+                            uint32_t bip32_pubkey_version) {
+    if (read_u32_be(key_info->master_key_fingerprint, 0) != master_key_fingerprint) {
+        return false;
+    }
+
+    // it could be a collision on the fingerprint; we verify that we can actually generate the same
+    // pubkey
+    serialized_extended_pubkey_t pubkey;
+    if (get_key_info_ext_pubkey(key_info, &pubkey) < 0) {
+        return false;
+    }
+
+    serialized_extended_pubkey_t derived_pubkey;
+    crypto_get_extended_pubkey_at_path(key_info->master_key_derivation,
+                                       key_info->master_key_derivation_len,
+                                       bip32_pubkey_version,
+                                       &derived_pubkey);
+
+    return memcmp(&pubkey, &derived_pubkey, sizeof(derived_pubkey)) == 0;
+}
+
+bool cache_internal_policy_key(const uint8_t keys_root[static 32],
+                               uint32_t n_keys,
+                               uint32_t key_index,
+                               const policy_map_key_info_t *key_info,
+                               uint32_t change,
+                               uint32_t bip32_pubkey_version) {
+    serialized_extended_pubkey_t ext_pubkey;
+    crypto_get_extended_pubkey_at_path(key_info->master_key_derivation,
+                                       key_info->master_key_derivation_len,
+                                       bip32_pubkey_version,
+                                       &ext_pubkey);
+
+    uint8_t pubkey[65];
+    if (crypto_get_uncompressed_pubkey(ext_pubkey.compressed_pubkey, pubkey) < 0) {
+        return false;
+    }
+
+    if (key_info->has_wildcard &&
+        bip32_CKDpub_uncompressed(ext_pubkey.chain_code,
+                                  pubkey,
+                                  change,
+                                  ext_pubkey.chain_code,
+                                  pubkey) < 0) {
+        return false;
+    }
+
+    pubkey_cache_add(keys_root,
+                     n_keys,
+                     key_index,
+                     change,
+                     key_info->has_wildcard,
+                     ext_pubkey.chain_code,
+                     pubkey);
+    return true;
+}
@@ -11,7 +11,58 @@
     (sizeof(WALLET_SLIP0021_LABEL) - 1)  // sizeof counts the terminating 0
 
 /**
- * TODO
+ * The prefix of the message authenticated by the hmac of the compiled form of a wallet policy,
+ * followed by its sha256; the message is longer than a wallet id, so that the two hmacs can not be
+ * mistaken for each other.
+ */
+#define COMPILED_POLICY_HMAC_TAG     "compiled policy"
+#define COMPILED_POLICY_HMAC_TAG_LEN (sizeof(COMPILED_POLICY_HMAC_TAG) - 1)
+
+/**
+ * The prefix of the message authenticated by the hmac of a spending policy (see
+ * common/spending_policy.h), followed by its sha256.
+ */
+#define SPENDING_POLICY_HMAC_TAG     "spending policy"
+#define SPENDING_POLICY_HMAC_TAG_LEN (sizeof(SPENDING_POLICY_HMAC_TAG) - 1)
+
+/**
+ * Computes the script of a wallet policy for the given change and address index, from its script
+ * template (see compile_script_template). The script template is filled in a single linear pass;
+ * the keys are fetched from the client and derived as needed, using the pubkey cache.
+ *
+ * @param[in] dispatcher_context
+ *   Pointer to the dispatcher context, used to fetch the keys information.
+ * @param[in] script_template
+ *   Pointer to the script template of the policy.
+ * @param[in] script_template_len
+ *   Length of the script template.
+ * @param[in] keys_merkle_root
+ *   Pointer to the Merkle root of the keys information of the wallet.
+ * @param[in] n_keys
+ *   Number of keys of the wallet.
+ * @param[in] change
+ *   Whether the script is for a change address.
+ * @param[in] address_index
+ *   The address index.
+ * @param[out] out_buf
+ *   If not NULL, the script is written to this buffer.
+ * @param[out] hash_context
+ *   If not NULL, the script is added to this hash context.
+ *
+ * @return the length of the script on success, -1 on failure.
+ */
+int call_get_wallet_script_from_template(dispatcher_context_t *dispatcher_context,
+                                         const uint8_t *script_template,
+                                         size_t script_template_len,
+                                         const uint8_t keys_merkle_root[static 32],
+                                         uint32_t n_keys,
+                                         bool change,
+                                         size_t address_index,
+                                         buffer_t *out_buf,
+                                         cx_hash_t *hash_context);
+
+/**
+ * Like call_get_wallet_script_from_template, but compiles the script template of the policy first.
  */
 int call_get_wallet_script(dispatcher_context_t *dispatcher_context,
                            policy_node_t *policy,
@@ -22,13 +73,162 @@ int call_get_wallet_script(dispatcher_context_t *dispatcher_context,
                            buffer_t *out_buf,
                            cx_hash_t *hash_context);
 
+/**
+ * Computes a hash of the taproot tree of a tr policy for the given change and address index: either
+ * the Merkle root of the tree, or the TapLeaf hash of the first tapscript with a given key. In the
+ * latter case, the other tapscripts are not computed.
+ *
+ * @param[in] dispatcher_context
+ *   Pointer to the dispatcher context, used to fetch the keys information.
+ * @param[in] tree
+ *   Pointer to the root of the taproot tree of the policy.
+ * @param[in] keys_merkle_root
+ *   Pointer to the Merkle root of the keys information of the wallet.
+ * @param[in] n_keys
+ *   Number of keys of the wallet.
+ * @param[in] change
+ *   Whether the tree is for a change address.
+ * @param[in] address_index
+ *   The address index.
+ * @param[in] tapleaf_midstate
+ *   If not NULL, the state of a TapLeaf tagged hash after its tag prefix, that is restored rather
+ *   than hashing the prefix for each tapscript.
+ * @param[in] leaf_key_index
+ *   The index of the key of the tapscript to hash, or -1 to compute the Merkle root.
+ * @param[out] out
+ *   Pointer to the 32-byte output hash.
+ *
+ * @return 1 on success, 0 if there is no tapscript with the key leaf_key_index, -1 on failure.
+ */
+int call_get_taptree_hash(dispatcher_context_t *dispatcher_context,
+                          const policy_node_tree_t *tree,
+                          const uint8_t keys_merkle_root[static 32],
+                          uint32_t n_keys,
+                          bool change,
+                          size_t address_index,
+                          const cx_sha256_t *tapleaf_midstate,
+                          int leaf_key_index,
+                          uint8_t out[static 32]);
+
 /**
  * TODO
  */
 int get_policy_address_type(policy_node_t *policy);
 
+/**
+ * Returns the type of the scriptPubKeys of the given policy (one of the values of script_type_e),
+ * which is the same for all the change and address_index; or -1 if they are not of a known type.
+ */
+int get_policy_script_type(const policy_node_t *policy);
+
 /**
  * Verifies if the wallet_hmac is correct for the given wallet_id, using the symmetric key derived
  * with the WALLET_SLIP0021_LABEL label according to SLIP-0021. Returns true/false accordingly.
  */
-bool check_wallet_hmac(uint8_t wallet_id[static 32], uint8_t wallet_hmac[static 32]);
\ No newline at end of file
+bool check_wallet_hmac(uint8_t wallet_id[static 32], uint8_t wallet_hmac[static 32]);
+
+/**
+ * Computes the hmac of the compiled form of a wallet policy (see write_compiled_policy), given its
+ * sha256, with the same symmetric key as check_wallet_hmac.
+ */
+void compute_compiled_policy_hmac(const uint8_t compiled_policy_id[static 32],
+                                  uint8_t out[static 32]);
+
+/**
+ * Verifies if hmac is correct for the compiled form of a wallet policy whose sha256 is
+ * compiled_policy_id. Returns true/false accordingly.
+ */
+bool check_compiled_policy_hmac(const uint8_t compiled_policy_id[static 32],
+                                const uint8_t hmac[static 32]);
+
+#ifdef HAVE_UNATTENDED_SIGNING
+
+/**
+ * Computes the hmac of a spending policy, given its sha256, with the same symmetric key as
+ * check_wallet_hmac.
+ */
+void compute_spending_policy_hmac(const uint8_t spending_policy_id[static 32],
+                                  uint8_t out[static 32]);
+
+/**
+ * Verifies if hmac is correct for the spending policy whose sha256 is spending_policy_id. Returns
+ * true/false accordingly.
+ */
+bool check_spending_policy_hmac(const uint8_t spending_policy_id[static 32],
+                                const uint8_t hmac[static 32]);
+
+#endif
+
+/**
+ * Gets the key information at the given index of the keys of a wallet policy, requesting the leaf
+ * (and its Merkle proof) to the client with GET_MERKLE_LEAF_ELEMENT unless it is in the key
+ * information cache (see key_info_cache.h). Keys from the cache, or that are added to it, are in
+ * binary form.
+ *
+ * @param[in] dispatcher_context
+ *   Pointer to the dispatcher context.
+ * @param[in] keys_root
+ *   Pointer to the 32-bytes root of the Merkle tree of the keys information of the wallet policy.
+ * @param[in] n_keys
+ *   Number of keys of the wallet policy.
+ * @param[in] key_index
+ *   Index of the key in the wallet policy.
+ * @param[out] out
+ *   Pointer to the output parsed key information.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int get_policy_key_info(dispatcher_context_t *dispatcher_context,
+                        const uint8_t keys_root[static 32],
+                        uint32_t n_keys,
+                        uint32_t key_index,
+                        policy_map_key_info_t *out);
+
+/**
+ * Checks if a key information corresponds to a key of this device, that is, if its master key
+ * fingerprint is ours, and its extended pubkey is the one derived at its key origin path. The
+ * comparison is done on the decoded (and checksummed) serialization of the extended pubkey, so
+ * that the derived key does not need to be base58-encoded; the derived key is cached across
+ * commands (see crypto_get_extended_pubkey_at_path).
+ *
+ * @param[in] key_info
+ *   Pointer to the parsed key information.
+ * @param[in] master_key_fingerprint
+ *   The fingerprint of the master key of this device.
+ * @param[in] bip32_pubkey_version
+ *   The version prefix of the extended pubkeys.
+ *
+ * @return true if the key is internal, false otherwise (also if the extended pubkey is malformed).
+ */
+bool is_policy_key_internal(const policy_map_key_info_t *key_info,
+                            uint32_t master_key_fingerprint,
+                            uint32_t bip32_pubkey_version);
+
+/**
+ * Stores in the pubkey cache the /change child of an internal key of a wallet policy, derived from
+ * our own node at the key origin (usually found in the xpub caches) rather than from the key
+ * information. The scripts of the wallet at that change are then computed without fetching and
+ * decoding the key again; this is the fast path of the canonical single-key wallets, for which all
+ * the work is local once their only key is verified.
+ *
+ * @param[in] keys_root
+ *   Pointer to the 32-bytes root of the Merkle tree of the keys information of the wallet policy.
+ * @param[in] n_keys
+ *   Number of keys of the wallet policy.
+ * @param[in] key_index
+ *   Index of the key in the wallet policy.
+ * @param[in] key_info
+ *   Pointer to the parsed key information, that must be internal (see is_policy_key_internal).
+ * @param[in] change
+ *   The change step of the derivation; ignored for keys without wildcard.
+ * @param[in] bip32_pubkey_version
+ *   The version prefix of the extended pubkeys.
+ *
+ * @return true on success, false otherwise.
+ */
+bool cache_internal_policy_key(const uint8_t keys_root[static 32],
+                               uint32_t n_keys,
+                               uint32_t key_index,
+                               const policy_map_key_info_t *key_info,
+                               uint32_t change,
+                               uint32_t bip32_pubkey_version);
@@ -48,6 +48,7 @@ typedef struct parse_rawtx_state_s {
         };
         struct {
             unsigned int out_counter;
+            txid_parser_vout_t *cur_vout;  // the requested output being parsed, or NULL
             parser_context_t output_parser_context;
             parse_rawtxoutput_state_t output_parser_state;
         };
@@ -62,9 +63,8 @@ typedef struct parse_rawtx_state_s {
         };
     };
 
-    int output_index;  // index of queried output, or -1
-
-    txid_parser_outputs_t *parser_outputs;
+    txid_parser_vout_t *vouts;  // the requested outputs
+    size_t n_vouts;
 
 } parse_rawtx_state_t;
 
@@ -77,27 +77,62 @@ typedef struct psbt_parse_rawtx_state_s {
     bool parser_error;  // set to true if there was an error during parsing
 } psbt_parse_rawtx_state_t;
 
+/*   SHARED FIELD PARSERS */
+
+// Parses a field of n bytes, adding it to the hash directly from the buffers; the field is only
+// consumed once it is all available. Returns 1 if done, 0 if more data is needed.
+static int parse_fixed_size_field(cx_sha256_t *hash_context, buffer_t *buffers[2], size_t n) {
+    const uint8_t *spans[2];
+    size_t spans_len[2];
+    if (!dbuffer_read_spans(buffers, n, spans, spans_len)) {
+        return 0;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (spans_len[i] > 0) {
+            crypto_hash_update(&hash_context->header, spans[i], spans_len[i]);
+        }
+    }
+    return 1;
+}
+
+// Parses the bytes of a field of the given size directly from the buffers, as much as it is
+// available; *counter is the number of bytes already parsed. The bytes are added to the hash if
+// hash_context is not NULL, and copied to out (at offset *counter) if out is not NULL.
+// Returns 1 if done, 0 if more data is needed.
+static int parse_variable_size_field(cx_sha256_t *hash_context,
+                                     buffer_t *buffers[2],
+                                     unsigned int size,
+                                     unsigned int *counter,
+                                     uint8_t *out) {
+    while (*counter < size) {
+        const uint8_t *data;
+        size_t data_len = dbuffer_read_chunk(buffers, size - *counter, &data);
+        if (data_len == 0) {
+            return 0;  // could not read enough data
+        }
+
+        if (hash_context != NULL) {
+            crypto_hash_update(&hash_context->header, data, data_len);
+        }
+        if (out != NULL) {
+            memcpy(out + *counter, data, data_len);
+        }
+
+        *counter += data_len;
+    }
+    return 1;  // done
+}
+
 /*   PARSER FOR A RAWTX INPUT */
 
 // parses the 32-bytes txid of an input in a rawtx
 static int parse_rawtxinput_txid(parse_rawtxinput_state_t *state, buffer_t *buffers[2]) {
-    uint8_t txid[32];
-    bool result = dbuffer_read_bytes(buffers, txid, 32);
-    if (result) {
-        crypto_hash_update(&state->parent_state->hash_context->header, txid, 32);
-    }
-    return result;
+    return parse_fixed_size_field(state->parent_state->hash_context, buffers, 32);
 }
 
 // parses the 4-bytes vout of an input in a rawtx
-// TODO: shares logic with the previous method; try to factor out the shared code
 static int parse_rawtxinput_vout(parse_rawtxinput_state_t *state, buffer_t *buffers[2]) {
-    uint8_t vout_bytes[4];
-    bool result = dbuffer_read_bytes(buffers, vout_bytes, 4);
-    if (result) {
-        crypto_hash_update(&state->parent_state->hash_context->header, vout_bytes, 4);
-    }
-    return result;
+    return parse_fixed_size_field(state->parent_state->hash_context, buffers, 4);
 }
 
 static int parse_rawtxinput_scriptsig_size(parse_rawtxinput_state_t *state, buffer_t *buffers[2]) {
@@ -122,38 +157,15 @@ static int parse_rawtxinput_scriptsig_init(parse_rawtxinput_state_t *state, buff
 }
 
 static int parse_rawtxinput_scriptsig(parse_rawtxinput_state_t *state, buffer_t *buffers[2]) {
-    uint8_t data[32];
-
-    while (true) {
-        int remaining_len = state->scriptsig_size - state->scriptsig_counter;
-
-        // We read in chunks of at most 32 bytes, so that we can always interrupt with less than 32
-        // unparsed bytes
-        int data_len = MIN(32, remaining_len);
-
-        bool read_result = dbuffer_read_bytes(buffers, data, data_len);
-        if (!read_result) {
-            return 0;  // could not read enough data
-        }
-
-        crypto_hash_update(&state->parent_state->hash_context->header, data, data_len);
-
-        state->scriptsig_counter += data_len;
-
-        if (state->scriptsig_counter == state->scriptsig_size) {
-            return 1;  // done
-        }
-    }
+    return parse_variable_size_field(state->parent_state->hash_context,
+                                     buffers,
+                                     state->scriptsig_size,
+                                     &state->scriptsig_counter,
+                                     NULL);
 }
 
 static int parse_rawtxinput_sequence(parse_rawtxinput_state_t *state, buffer_t *buffers[2]) {
-    uint8_t sequence_bytes[4];
-
-    bool result = dbuffer_read_bytes(buffers, sequence_bytes, 4);
-    if (result) {
-        crypto_hash_update(&state->parent_state->hash_context->header, sequence_bytes, 4);
-    }
-    return result;
+    return parse_fixed_size_field(state->parent_state->hash_context, buffers, 4);
 }
 
 static const parsing_step_t parse_rawtxinput_steps[] = {
@@ -178,11 +190,8 @@ static int parse_rawtxoutput_value(parse_rawtxoutput_state_t *state, buffer_t *b
 
         crypto_hash_update(&state->parent_state->hash_context->header, value_bytes, 8);
 
-        if (state->parent_state->output_index != -1) {
-            unsigned int relevant_output_index = (unsigned int) state->parent_state->output_index;
-            if (state->parent_state->out_counter == relevant_output_index) {
-                state->parent_state->parser_outputs->vout_value = value;
-            }
+        if (state->parent_state->cur_vout != NULL) {
+            state->parent_state->cur_vout->value = value;
         }
     }
     return result;
@@ -197,12 +206,9 @@ static int parse_rawtxoutput_scriptpubkey_size(parse_rawtxoutput_state_t *state,
 
         crypto_hash_update_varint(&state->parent_state->hash_context->header, scriptpubkey_size);
 
-        if (state->parent_state->output_index != -1) {
-            unsigned int relevant_output_index = (unsigned int) state->parent_state->output_index;
-            if (state->parent_state->out_counter == relevant_output_index) {
-                state->parent_state->parser_outputs->vout_scriptpubkey_len =
-                    (unsigned int) scriptpubkey_size;
-            }
+        if (state->parent_state->cur_vout != NULL) {
+            // larger scriptPubKeys are rejected by parse_rawtxoutput_scriptpubkey
+            state->parent_state->cur_vout->scriptpubkey_len = (uint8_t) scriptpubkey_size;
         }
     }
     return result;
@@ -218,45 +224,18 @@ static int parse_rawtxoutput_scriptpubkey_init(parse_rawtxoutput_state_t *state,
 }
 
 static int parse_rawtxoutput_scriptpubkey(parse_rawtxoutput_state_t *state, buffer_t *buffers[2]) {
-    uint8_t data[32];
-
-    while (true) {
-        int remaining_len = state->scriptpubkey_size - state->scriptpubkey_counter;
-
-        // We read in chunks of at most 32 bytes, so that we can always interrupt with less than 32
-        // unparsed bytes
-        int data_len = MIN(32, remaining_len);
-
-        bool read_result = dbuffer_read_bytes(buffers, data, data_len);
-        if (!read_result) {
-            return 0;  // could not read enough data
-        }
-
-        crypto_hash_update(&state->parent_state->hash_context->header, data, data_len);
-
-        if (state->parent_state->output_index != -1) {
-            unsigned int relevant_output_index = (unsigned int) state->parent_state->output_index;
-            if (state->parent_state->out_counter == relevant_output_index) {
-                unsigned int scriptpubkey_len =
-                    state->parent_state->parser_outputs->vout_scriptpubkey_len;
-                if (scriptpubkey_len > MAX_PREVOUT_SCRIPTPUBKEY_LEN) {
-                    return -1;  // not expecting any scriptPubkey larger than
-                                // MAX_PREVOUT_SCRIPTPUBKEY_LEN
-                }
-
-                memcpy(state->parent_state->parser_outputs->vout_scriptpubkey +
-                           state->scriptpubkey_counter,
-                       data,
-                       data_len);
-            }
-        }
+    // only the scriptPubKeys of the requested outputs are copied; the others are just hashed
+    txid_parser_vout_t *vout = state->parent_state->cur_vout;
 
-        state->scriptpubkey_counter += data_len;
-
-        if (state->scriptpubkey_counter == state->scriptpubkey_size) {
-            return 1;  // done
-        }
+    if (vout != NULL && state->scriptpubkey_size > MAX_PREVOUT_SCRIPTPUBKEY_LEN) {
+        return -1;  // not expecting any scriptPubkey larger than MAX_PREVOUT_SCRIPTPUBKEY_LEN
     }
+
+    return parse_variable_size_field(state->parent_state->hash_context,
+                                     buffers,
+                                     state->scriptpubkey_size,
+                                     &state->scriptpubkey_counter,
+                                     vout != NULL ? vout->scriptpubkey : NULL);
 }
 
 static const parsing_step_t parse_rawtxoutput_steps[] = {
@@ -272,13 +251,7 @@ const int n_parse_rawtxoutput_steps =
 /*   PARSER FOR A FULL RAWTX */
 
 static int parse_rawtx_version(parse_rawtx_state_t *state, buffer_t *buffers[2]) {
-    uint8_t version_bytes[4];
-
-    bool result = dbuffer_read_bytes(buffers, version_bytes, 4);
-    if (result) {
-        crypto_hash_update(&state->hash_context->header, version_bytes, 4);
-    }
-    return result;
+    return parse_fixed_size_field(state->hash_context, buffers, 4);
 }
 
 // Checks if this transaction is serialized according to bip144 (segwit), that is, it has a 0x00
@@ -371,10 +344,21 @@ static int parse_rawtx_output_count(parse_rawtx_state_t *state, buffer_t *buffer
     return result;
 }
 
+// Returns the requested output with the given index, or NULL if it was not requested.
+static txid_parser_vout_t *find_vout(parse_rawtx_state_t *state, unsigned int index) {
+    for (size_t i = 0; i < state->n_vouts; i++) {
+        if (state->vouts[i].index == index) {
+            return &state->vouts[i];
+        }
+    }
+    return NULL;
+}
+
 static int parse_rawtx_outputs_init(parse_rawtx_state_t *state, buffer_t *buffers[2]) {
     (void) buffers;
 
     state->out_counter = 0;
+    state->cur_vout = find_vout(state, 0);
     parser_init_context(&state->output_parser_context, &state->output_parser_state);
 
     state->output_parser_state.parent_state = state;
@@ -397,6 +381,7 @@ static int parse_rawtx_outputs(parse_rawtx_state_t *state, buffer_t *buffers[2])
         }
 
         ++state->out_counter;
+        state->cur_vout = find_vout(state, state->out_counter);
         parser_init_context(&state->output_parser_context, &state->output_parser_state);
     }
     return 1;
@@ -447,18 +432,13 @@ static int parse_rawtx_witnesses(parse_rawtx_state_t *state, buffer_t *buffers[2
                 state->cur_wit_el_bytes_read = 0;
             }
 
-            while (state->cur_wit_el_bytes_read < state->cur_wit_elem_len) {
-                uint8_t data[32];
-                int remaining_len = state->cur_wit_elem_len - state->cur_wit_el_bytes_read;
-
-                // We read in chunks of at most 32 bytes, so that we can always interrupt with less
-                // than 32 unparsed bytes
-                int data_len = MIN(32, remaining_len);
-                if (!dbuffer_read_bytes(buffers, data, data_len)) {
-                    return 0;
-                }
-
-                state->cur_wit_el_bytes_read += data_len;
+            // the witnesses are not part of the txid; skip them without copying
+            if (!parse_variable_size_field(NULL,
+                                           buffers,
+                                           state->cur_wit_elem_len,
+                                           &state->cur_wit_el_bytes_read,
+                                           NULL)) {
+                return 0;
             }
 
             ++state->wit_stack_el_counter;
@@ -473,12 +453,7 @@ static int parse_rawtx_witnesses(parse_rawtx_state_t *state, buffer_t *buffers[2
 }
 
 static int parse_rawtx_locktime(parse_rawtx_state_t *state, buffer_t *buffers[2]) {
-    uint8_t locktime_bytes[4];
-    bool result = dbuffer_read_bytes(buffers, locktime_bytes, 4);
-    if (result) {
-        crypto_hash_update(&state->hash_context->header, locktime_bytes, 4);
-    }
-    return result;
+    return parse_fixed_size_field(state->hash_context, buffers, 4);
 }
 
 static const parsing_step_t parse_rawtx_steps[] = {(parsing_step_t) parse_rawtx_version,
@@ -517,12 +492,11 @@ static void cb_process_data(buffer_t *data, void *cb_state) {
     }
 }
 
-int call_psbt_parse_rawtx(dispatcher_context_t *dispatcher_context,
-                          const merkleized_map_commitment_t *map,
-                          const uint8_t *key,
-                          int key_len,
-                          int output_index,
-                          txid_parser_outputs_t *outputs) {
+int call_psbt_parse_rawtx_vouts(dispatcher_context_t *dispatcher_context,
+                                const uint8_t value_hash[static 32],
+                                txid_parser_vout_t *vouts,
+                                size_t n_vouts,
+                                uint8_t txid[static 32]) {
     LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
 
     cx_sha256_t hash_context;
@@ -536,7 +510,38 @@ int call_psbt_parse_rawtx(dispatcher_context_t *dispatcher_context,
     flow_state.parser_error = false;
     parser_init_context(&flow_state.parser_context, &flow_state.parser_state);
 
-    flow_state.parser_state.output_index = output_index;
+    // init the state of the parser (global)
+    flow_state.parser_state.hash_context = &hash_context;
+    flow_state.parser_state.n_outputs = 0;
+
+    flow_state.parser_state.vouts = vouts;
+    flow_state.parser_state.n_vouts = n_vouts;
+
+    int res =
+        call_stream_preimage(dispatcher_context, value_hash, NULL, cb_process_data, &flow_state);
+    if (res < 0 || flow_state.parser_error) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < n_vouts; i++) {
+        if (vouts[i].index >= flow_state.parser_state.n_outputs) {
+            PRINTF("Requested output %u not in the transaction\n", (unsigned int) vouts[i].index);
+            return -1;
+        }
+    }
+
+    crypto_hash_digest(&hash_context.header, txid, 32);
+    cx_hash_sha256(txid, 32, txid, 32);
+    return 0;
+}
+
+int call_psbt_parse_rawtx(dispatcher_context_t *dispatcher_context,
+                          const merkleized_map_commitment_t *map,
+                          const uint8_t *key,
+                          int key_len,
+                          int output_index,
+                          txid_parser_outputs_t *outputs) {
+    LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
 
     uint8_t value_hash[32];
     int res = call_get_merkleized_map_value_hash(dispatcher_context, map, key, key_len, value_hash);
@@ -544,17 +549,18 @@ int call_psbt_parse_rawtx(dispatcher_context_t *dispatcher_context,
         return -1;
     }
 
-    // init the state of the parser (global)
-    flow_state.parser_state.hash_context = &hash_context;
-
-    flow_state.parser_state.parser_outputs = outputs;
-
-    res = call_stream_preimage(dispatcher_context, value_hash, NULL, cb_process_data, &flow_state);
-    if (res < 0 || flow_state.parser_error) {
+    txid_parser_vout_t vout = {.index = (uint32_t) output_index};
+    res = call_psbt_parse_rawtx_vouts(dispatcher_context,
+                                      value_hash,
+                                      &vout,
+                                      output_index != -1 ? 1 : 0,
+                                      outputs->txid);
+    if (res < 0) {
         return -1;
     }
 
-    crypto_hash_digest(&hash_context.header, outputs->txid, 32);
-    cx_hash_sha256(outputs->txid, 32, outputs->txid, 32);
+    outputs->vout_value = vout.value;
+    outputs->vout_scriptpubkey_len = vout.scriptpubkey_len;
+    memcpy(outputs->vout_scriptpubkey, vout.scriptpubkey, vout.scriptpubkey_len);
     return 0;
 }
@@ -11,6 +11,13 @@ typedef struct {
     uint8_t txid[32];                                         // will contain the computed txid
 } txid_parser_outputs_t;
 
+typedef struct {
+    uint64_t value;            // will contain the value of the output
+    uint32_t index;            // index of the requested output, set by the caller
+    uint8_t scriptpubkey_len;  // will contain the len of the scriptPubKey
+    uint8_t scriptpubkey[MAX_PREVOUT_SCRIPTPUBKEY_LEN];  // will contain the scriptPubKey
+} txid_parser_vout_t;
+
 /**
  * Given a commitment to a merkleized map and a key, this flow parses it as a serialized bitcoin
  * transaction, computes the transaction id and optionally keeps track of the vout amunt and
@@ -22,3 +29,19 @@ int call_psbt_parse_rawtx(dispatcher_context_t *dispatcher_context,
                           int key_len,
                           int output_index,
                           txid_parser_outputs_t *outputs);
+
+/**
+ * Same as call_psbt_parse_rawtx, for the transaction serialized in the preimage of value_hash (the
+ * hash of the leaf of a value in a merkleized map, for example from a merkleized_map_field_t with
+ * hash_only); moreover, the value and the scriptPubKey of several outputs are extracted in the same
+ * run of the parser. The index of each requested output is given in the index field of its element
+ * of vouts; they must be distinct.
+ *
+ * Returns 0 on success, or a negative number on failure, including if any of the requested outputs
+ * is not in the transaction.
+ */
+int call_psbt_parse_rawtx_vouts(dispatcher_context_t *dispatcher_context,
+                                const uint8_t value_hash[static 32],
+                                txid_parser_vout_t *vouts,
+                                size_t n_vouts,
+                                uint8_t txid[static 32]);
@@ -0,0 +1,73 @@
+#include <string.h>
+
+#include "read_response.h"
+
+#include "../../boilerplate/sw.h"
+#include "../../common/buffer.h"
+#include "../../common/read.h"
+#include "../../crypto.h"
+#include "../client_commands.h"
+
+bool read_response_bytes(dispatcher_context_t *dc,
+                         uint8_t *out,
+                         size_t len,
+                         cx_hash_t *hash_context) {
+    while (len > 0) {
+        if (!buffer_can_read(&dc->read_buffer, 1)) {
+            uint8_t get_more_elements_req[] = {CCMD_GET_MORE_ELEMENTS};
+            SET_RESPONSE(dc, get_more_elements_req, 1, SW_INTERRUPTED_EXECUTION);
+            if (dc_process_interruption(dc) < 0) {
+                return false;
+            }
+
+            // Parse response to CCMD_GET_MORE_ELEMENTS
+            uint8_t n_bytes, elements_len;
+            if (!buffer_read_u8(&dc->read_buffer, &n_bytes) ||
+                !buffer_read_u8(&dc->read_buffer, &elements_len) ||
+                !buffer_can_read(&dc->read_buffer, (size_t) n_bytes * elements_len)) {
+                return false;
+            }
+
+            if (elements_len != 1 || n_bytes == 0) {
+                PRINTF("Elements should be single bytes\n");
+                return false;
+            }
+        }
+
+        size_t n_available = dc->read_buffer.size - dc->read_buffer.offset;
+        size_t n_read = MIN(len, n_available);
+
+        const uint8_t *data_ptr = dc->read_buffer.ptr + dc->read_buffer.offset;
+        if (hash_context != NULL) {
+            crypto_hash_update(hash_context, data_ptr, n_read);
+        }
+        if (out != NULL) {
+            memcpy(out, data_ptr, n_read);
+            out += n_read;
+        }
+        buffer_seek_cur(&dc->read_buffer, n_read);
+
+        len -= n_read;
+    }
+    return true;
+}
+
+bool read_response_varint(dispatcher_context_t *dc, uint64_t *value) {
+    uint8_t prefix;
+    if (!read_response_bytes(dc, &prefix, 1, NULL)) {
+        return false;
+    }
+
+    if (prefix < 0xFD) {
+        *value = prefix;
+        return true;
+    }
+
+    uint8_t raw[8] = {0};
+    size_t len = prefix == 0xFD ? 2 : (prefix == 0xFE ? 4 : 8);
+    if (!read_response_bytes(dc, raw, len, NULL)) {
+        return false;
+    }
+    *value = read_u64_le(raw, 0);
+    return true;
+}
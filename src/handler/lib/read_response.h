@@ -0,0 +1,24 @@
+#pragma once
+
+#include "../../boilerplate/dispatcher.h"
+
+/**
+ * Reads exactly len bytes from the response of a client command whose response is a stream of
+ * bytes (like CCMD_GET_MERKLEIZED_MAP_VALUE), which could be split across multiple
+ * CCMD_GET_MORE_ELEMENTS responses (as single-byte elements).
+ * If out is NULL, the bytes are consumed but not copied; if hash_context is not NULL, it is updated
+ * with the bytes.
+ *
+ * Returns true on success, false on failure.
+ */
+bool read_response_bytes(dispatcher_context_t *dc,
+                         uint8_t *out,
+                         size_t len,
+                         cx_hash_t *hash_context);
+
+/**
+ * Reads a Bitcoin-style varint from a response streamed like in read_response_bytes.
+ *
+ * Returns true on success, false on failure.
+ */
+bool read_response_varint(dispatcher_context_t *dc, uint64_t *value);
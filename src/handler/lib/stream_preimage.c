@@ -6,21 +6,22 @@
 #include "../../crypto.h"
 #include "../client_commands.h"
 
-int call_stream_preimage(dispatcher_context_t *dispatcher_context,
-                         const uint8_t hash[static 32],
-                         void (*len_callback)(size_t, void *),
-                         void (*callback)(buffer_t *, void *),
-                         void *callback_state) {
-    LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
-
-    uint8_t cmd = CCMD_GET_PREIMAGE;
-    dispatcher_context->add_to_response(&cmd, 1);
-    uint8_t zero = 0;
-    dispatcher_context->add_to_response(&zero, 1);
-    dispatcher_context->add_to_response(hash, 32);
-    dispatcher_context->finalize_response(SW_INTERRUPTED_EXECUTION);
-
-    if (dispatcher_context->process_interruption(dispatcher_context) < 0) {
+// Common for call_stream_preimage and call_stream_raw_preimage: the first prefix_len bytes of the
+// preimage (the 0x00 prefix of Merkle tree leaves, or none) are hashed, but not passed to the
+// callbacks.
+static int stream_preimage(dispatcher_context_t *dispatcher_context,
+                           const uint8_t hash[static 32],
+                           uint8_t prefix_len,
+                           void (*len_callback)(size_t, void *),
+                           void (*callback)(buffer_t *, void *),
+                           void *callback_state) {
+
+    dc_add_u8_to_response(dispatcher_context, CCMD_GET_PREIMAGE);
+    dc_add_u8_to_response(dispatcher_context, 0);
+    dc_add_to_response(dispatcher_context, hash, 32);
+    dc_finalize_response(dispatcher_context, SW_INTERRUPTED_EXECUTION);
+
+    if (dc_process_interruption(dispatcher_context) < 0) {
         return -1;
     }
 
@@ -35,7 +36,7 @@ int call_stream_preimage(dispatcher_context_t *dispatcher_context,
     }
     uint32_t preimage_len = (uint32_t) preimage_len_u64;
 
-    if (preimage_len < 1) {
+    if (preimage_len < prefix_len || partial_data_len < prefix_len) {
         // at least the initial 0x00 prefix should be there
         return -3;
     }
@@ -45,7 +46,7 @@ int call_stream_preimage(dispatcher_context_t *dispatcher_context,
     }
 
     if (len_callback != NULL) {
-        len_callback(preimage_len - 1, callback_state);
+        len_callback(preimage_len - prefix_len, callback_state);
     }
 
     uint8_t *data_ptr =
@@ -57,7 +58,7 @@ int call_stream_preimage(dispatcher_context_t *dispatcher_context,
     crypto_hash_update(&hash_context.header, data_ptr, partial_data_len);
 
     // call callback with data
-    buffer_t initial_buf = buffer_create(data_ptr + 1, partial_data_len - 1);  // skip 0x00 prefix
+    buffer_t initial_buf = buffer_create(data_ptr + prefix_len, partial_data_len - prefix_len);
     callback(&initial_buf, callback_state);
 
     size_t bytes_remaining = (size_t) preimage_len - partial_data_len;
@@ -68,7 +69,7 @@ int call_stream_preimage(dispatcher_context_t *dispatcher_context,
                      get_more_elements_req,
                      sizeof(get_more_elements_req),
                      SW_INTERRUPTED_EXECUTION);
-        if (dispatcher_context->process_interruption(dispatcher_context) < 0) {
+        if (dc_process_interruption(dispatcher_context) < 0) {
             return -5;
         }
 
@@ -80,7 +81,7 @@ int call_stream_preimage(dispatcher_context_t *dispatcher_context,
             return -6;
         }
 
-        if (elements_len != 1) {
+        if (elements_len != 1 || n_bytes == 0) {
             PRINTF("Elements should be single bytes\n");
             return -7;
         }
@@ -112,5 +113,25 @@ int call_stream_preimage(dispatcher_context_t *dispatcher_context,
         return -9;
     }
 
-    return (int) preimage_len - 1;
+    return (int) preimage_len - prefix_len;
+}
+
+int call_stream_preimage(dispatcher_context_t *dispatcher_context,
+                         const uint8_t hash[static 32],
+                         void (*len_callback)(size_t, void *),
+                         void (*callback)(buffer_t *, void *),
+                         void *callback_state) {
+    LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
+
+    return stream_preimage(dispatcher_context, hash, 1, len_callback, callback, callback_state);
+}
+
+int call_stream_raw_preimage(dispatcher_context_t *dispatcher_context,
+                             const uint8_t hash[static 32],
+                             void (*len_callback)(size_t, void *),
+                             void (*callback)(buffer_t *, void *),
+                             void *callback_state) {
+    LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
+
+    return stream_preimage(dispatcher_context, hash, 0, len_callback, callback, callback_state);
 }
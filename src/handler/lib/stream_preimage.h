@@ -16,3 +16,16 @@ int call_stream_preimage(dispatcher_context_t *dispatcher_context,
                          void (*len_callback)(size_t, void *),
                          void (*callback)(buffer_t *, void *),
                          void *callback_state);
+
+/**
+ * Same as call_stream_preimage, for a preimage that is not a leaf of a Merkle tree (for example,
+ * the serialized wallet policy of a wallet id): all its bytes are passed to the callback, and its
+ * whole length to len_callback.
+ *
+ * Returns a negative number on error, or the preimage length on success.
+ */
+int call_stream_raw_preimage(dispatcher_context_t *dispatcher_context,
+                             const uint8_t hash[static 32],
+                             void (*len_callback)(size_t, void *),
+                             void (*callback)(buffer_t *, void *),
+                             void *callback_state);
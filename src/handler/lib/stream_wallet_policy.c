@@ -0,0 +1,47 @@
+#include "stream_wallet_policy.h"
+
+#include "stream_preimage.h"
+
+typedef struct {
+    policy_map_wallet_parser_t parser;
+    bool too_long;
+} stream_wallet_policy_state_t;
+
+static void cb_wallet_policy_len(size_t len, void *cb_state) {
+    stream_wallet_policy_state_t *state = (stream_wallet_policy_state_t *) cb_state;
+    state->too_long = len > MAX_POLICY_MAP_SERIALIZED_LENGTH;
+}
+
+static void cb_wallet_policy_data(buffer_t *data, void *cb_state) {
+    stream_wallet_policy_state_t *state = (stream_wallet_policy_state_t *) cb_state;
+    policy_map_wallet_parser_update(&state->parser,
+                                    data->ptr + data->offset,
+                                    data->size - data->offset);
+}
+
+int call_stream_wallet_policy(dispatcher_context_t *dispatcher_context,
+                              const uint8_t wallet_id[static 32],
+                              policy_map_wallet_header_t *header) {
+    LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
+
+    stream_wallet_policy_state_t state;
+    policy_map_wallet_parser_init(&state.parser, header);
+    state.too_long = false;
+
+    if (call_stream_raw_preimage(dispatcher_context,
+                                 wallet_id,
+                                 cb_wallet_policy_len,
+                                 cb_wallet_policy_data,
+                                 &state) < 0) {
+        return -1;
+    }
+
+    if (state.too_long) {
+        return -2;
+    }
+
+    if (policy_map_wallet_parser_finish(&state.parser) < 0) {
+        return -3;
+    }
+    return 0;
+}
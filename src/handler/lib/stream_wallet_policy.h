@@ -0,0 +1,16 @@
+#pragma once
+
+#include "../../boilerplate/dispatcher.h"
+#include "../../common/wallet.h"
+
+/**
+ * Requests to the host the serialized wallet policy whose sha256 is wallet_id, and parses it into
+ * header while it is streamed, without buffering it. The header must not be used if this function
+ * fails, as it is filled before the hash is verified.
+ *
+ * Returns a negative number on error (including if the wallet policy is longer than
+ * MAX_POLICY_MAP_SERIALIZED_LENGTH, or invalid), or 0 on success.
+ */
+int call_stream_wallet_policy(dispatcher_context_t *dispatcher_context,
+                              const uint8_t wallet_id[static 32],
+                              policy_map_wallet_header_t *header);
@@ -0,0 +1,270 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#ifdef HAVE_UNATTENDED_SIGNING
+
+#include <stdint.h>
+#include <string.h>
+
+#include "os.h"
+#include "cx.h"
+
+#include "../boilerplate/dispatcher.h"
+#include "../boilerplate/sw.h"
+#include "../common/bip32.h"
+#include "../common/spending_policy.h"
+#include "../common/wallet.h"
+#include "../common/wallet_cache.h"
+#include "../common/wallet_store.h"
+
+#include "../commands.h"
+#include "../constants.h"
+#include "../ui/display.h"
+
+#include "lib/get_merkle_leaf_element.h"
+#include "lib/policy.h"
+#include "lib/stream_wallet_policy.h"
+
+#include "register_spending_policy.h"
+
+static void ui_action_validate_policy(dispatcher_context_t *dc, bool accept);
+static void process_next_destination(dispatcher_context_t *dc);
+static void ui_action_validate_destination(dispatcher_context_t *dc, bool accept);
+static void finalize_response(dispatcher_context_t *dc);
+
+extern global_context_t *G_coin_config;
+
+// Loads the header of the wallet policy of the spending policy, and verifies its hmac; a default
+// wallet policy (with an hmac of zeros) is shown as the derivation path of its key, and it is only
+// verified to be canonical by SIGN_PSBT. Returns false (after sending the status word) on error.
+static bool load_wallet_policy(dispatcher_context_t *dc, uint8_t wallet_hmac[static 32]) {
+    register_spending_policy_state_t *state =
+        (register_spending_policy_state_t *) &G_command_state;
+
+    uint8_t *wallet_id = state->policy.wallet_id;
+
+    const policy_map_wallet_header_t *cached_header = wallet_cache_get(wallet_id, wallet_hmac);
+    const policy_map_wallet_header_t *stored_header =
+        cached_header == NULL ? wallet_store_get(wallet_id, wallet_hmac) : NULL;
+    if (cached_header != NULL || stored_header != NULL) {
+        memcpy(&state->wallet_header,
+               cached_header != NULL ? cached_header : stored_header,
+               sizeof(state->wallet_header));
+    } else if (call_stream_wallet_policy(dc, wallet_id, &state->wallet_header) < 0) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return false;
+    }
+
+    uint8_t hmac_or = 0;
+    for (int i = 0; i < 32; i++) {
+        hmac_or |= wallet_hmac[i];
+    }
+
+    if (hmac_or != 0) {
+        if (cached_header == NULL) {
+            if (!check_wallet_hmac(wallet_id, wallet_hmac)) {
+                PRINTF("Incorrect hmac\n");
+                SEND_SW(dc, SW_SIGNATURE_FAIL);
+                return false;
+            }
+            wallet_cache_add(wallet_id, wallet_hmac, &state->wallet_header);
+        }
+
+        memcpy(state->wallet_str, state->wallet_header.name, state->wallet_header.name_len);
+        state->wallet_str[state->wallet_header.name_len] = '\0';
+        return true;
+    }
+
+    // a default wallet policy has a single key
+    policy_map_key_info_t key_info;
+    if (state->wallet_header.n_keys != 1 ||
+        get_policy_key_info(dc,
+                            state->wallet_header.keys_info_merkle_root,
+                            state->wallet_header.n_keys,
+                            0,
+                            &key_info) < 0 ||
+        !key_info.has_key_origin) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return false;
+    }
+
+    state->wallet_str[0] = 'm';
+    state->wallet_str[1] = '/';
+    if (!bip32_path_format(key_info.master_key_derivation,
+                           key_info.master_key_derivation_len,
+                           state->wallet_str + 2,
+                           sizeof(state->wallet_str) - 2)) {
+        SEND_SW(dc, SW_BAD_STATE);  // should never happen
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Validates the spending policy and loads its wallet policy, then shows the spending policy to the
+ * user.
+ */
+void handler_register_spending_policy(dispatcher_context_t *dc) {
+    register_spending_policy_state_t *state =
+        (register_spending_policy_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    // Device must be unlocked
+    if (os_global_pin_is_validated() != BOLOS_UX_OK) {
+        SEND_SW(dc, SW_SECURITY_STATUS_NOT_SATISFIED);
+        return;
+    }
+
+    uint8_t wallet_hmac[32];
+    uint64_t n_destinations;
+    if (!buffer_read_bytes(&dc->read_buffer, state->policy.wallet_id, 32) ||
+        !buffer_read_bytes(&dc->read_buffer, wallet_hmac, 32) ||
+        !buffer_read_u64(&dc->read_buffer, &state->policy.max_tx_amount, LE) ||
+        !buffer_read_u64(&dc->read_buffer, &state->policy.max_session_amount, LE) ||
+        !buffer_read_varint(&dc->read_buffer, &n_destinations) ||
+        !buffer_read_bytes(&dc->read_buffer, state->policy.destinations_root, 32)) {
+        SEND_SW(dc, SW_WRONG_DATA_LENGTH);
+        return;
+    }
+
+    // nothing can be shown on screen during a batch
+    if (buffer_can_read(&dc->read_buffer, 1) || dc->is_in_batch() ||
+        state->policy.max_tx_amount > state->policy.max_session_amount) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
+    }
+    if (n_destinations > SPENDING_POLICY_MAX_DESTINATIONS) {
+        PRINTF("At most %d destinations are supported\n", SPENDING_POLICY_MAX_DESTINATIONS);
+        SEND_SW(dc, SW_NOT_SUPPORTED);
+        return;
+    }
+    state->policy.n_destinations = (uint32_t) n_destinations;
+
+    if (!load_wallet_policy(dc, wallet_hmac)) {
+        return;
+    }
+
+    dc->pause();
+    ui_display_spending_policy(dc,
+                               state->wallet_str,
+                               G_coin_config->name_short,
+                               state->policy.max_tx_amount,
+                               state->policy.max_session_amount,
+                               state->policy.n_destinations,
+                               ui_action_validate_policy);
+}
+
+/**
+ * Abort if the user rejected the spending policy, otherwise start showing its destinations.
+ */
+static void ui_action_validate_policy(dispatcher_context_t *dc, bool accept) {
+    register_spending_policy_state_t *state =
+        (register_spending_policy_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    if (!accept) {
+        SEND_SW(dc, SW_DENY);
+    } else {
+        state->next_destination_index = 0;
+        dc_next(dc, process_next_destination);
+    }
+    dc->run();
+}
+
+/**
+ * Gets the scriptPubKey of the next destination, and asks the user to validate its address.
+ */
+static void process_next_destination(dispatcher_context_t *dc) {
+    register_spending_policy_state_t *state =
+        (register_spending_policy_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    if (state->next_destination_index == state->policy.n_destinations) {
+        dc_next(dc, finalize_response);
+        return;
+    }
+
+    int destination_len = call_get_merkle_leaf_element(dc,
+                                                       state->policy.destinations_root,
+                                                       state->policy.n_destinations,
+                                                       state->next_destination_index,
+                                                       state->destination,
+                                                       sizeof(state->destination));
+    if (destination_len < 0) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
+    }
+
+    // only destinations with an address can be shown to the user
+    if (get_script_address(state->destination,
+                           destination_len,
+                           G_coin_config,
+                           state->address,
+                           sizeof(state->address)) < 0) {
+        PRINTF("Unknown or unsupported script type for destination %d\n",
+               state->next_destination_index);
+        SEND_SW(dc, SW_NOT_SUPPORTED);
+        return;
+    }
+
+    dc->pause();
+    ui_display_spending_destination(dc,
+                                    state->next_destination_index + 1,  // 1-indexed for the UI
+                                    state->address,
+                                    ui_action_validate_destination);
+}
+
+static void ui_action_validate_destination(dispatcher_context_t *dc, bool accept) {
+    register_spending_policy_state_t *state =
+        (register_spending_policy_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    if (!accept) {
+        SEND_SW(dc, SW_DENY);
+    } else {
+        ++state->next_destination_index;
+        dc_next(dc, process_next_destination);
+    }
+    dc->run();
+}
+
+// Responds with the id of the spending policy, and its hmac
+static void finalize_response(dispatcher_context_t *dc) {
+    register_spending_policy_state_t *state =
+        (register_spending_policy_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    uint8_t serialized_policy[SPENDING_POLICY_LEN];
+    spending_policy_serialize(&state->policy, serialized_policy);
+
+    struct {
+        uint8_t policy_id[32];
+        uint8_t hmac[32];
+    } response;
+
+    cx_hash_sha256(serialized_policy, sizeof(serialized_policy), response.policy_id, 32);
+    compute_spending_policy_hmac(response.policy_id, response.hmac);
+
+    SEND_RESPONSE(dc, &response, sizeof(response), SW_OK);
+}
+
+#endif
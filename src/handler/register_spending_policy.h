@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../constants.h"
+#include "../common/bip32.h"
+#include "../common/spending_policy.h"
+#include "../common/wallet.h"
+#include "../boilerplate/dispatcher.h"
+
+typedef struct {
+    machine_context_t ctx;
+
+    spending_policy_t policy;
+    uint32_t next_destination_index;
+
+    policy_map_wallet_header_t wallet_header;
+
+    // what the user is shown for the wallet policy: the name of a registered wallet policy, or the
+    // derivation path of the account of a default one, prefixed by "m/", that is always longer
+    char wallet_str[2 + MAX_SERIALIZED_BIP32_PATH_LENGTH + 1];
+
+    uint8_t destination[MAX_PREVOUT_SCRIPTPUBKEY_LEN];
+    char address[MAX_ADDRESS_LENGTH_STR + 1];
+} register_spending_policy_state_t;
+
+/**
+ * Registers a spending policy for a wallet policy, after the user approves its limits and each of
+ * its destinations; returns the id and the hmac of the spending policy, that SIGN_PSBT takes to
+ * sign the psbts that match it without user interaction. Only compiled with
+ * HAVE_UNATTENDED_SIGNING.
+ */
+void handler_register_spending_policy(dispatcher_context_t *dispatcher_context);
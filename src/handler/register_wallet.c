@@ -23,9 +23,12 @@
 
 #include "../boilerplate/dispatcher.h"
 #include "../boilerplate/sw.h"
+#include "../common/format.h"
 #include "../common/merkle.h"
 #include "../common/read.h"
 #include "../common/wallet.h"
+#include "../common/wallet_cache.h"
+#include "../common/wallet_store.h"
 #include "../common/write.h"
 
 #include "../commands.h"
@@ -34,21 +37,32 @@
 #include "../ui/display.h"
 #include "../ui/menu.h"
 
+#include "lib/batch_requests.h"
+#include "lib/get_merkle_leaves_hashes.h"
+#include "lib/get_merkle_preimage.h"
 #include "lib/policy.h"
 
 #include "client_commands.h"
 
 #include "register_wallet.h"
 
+static void fetch_next_wallet(dispatcher_context_t *dc);
+static uint16_t validate_wallet_policy(register_wallet_state_t *state);
+static void verify_keys_info(dispatcher_context_t *dc);
 static void ui_action_validate_header(dispatcher_context_t *dc, bool accept);
 static void process_next_cosigner_info(dispatcher_context_t *dc);
 static void ui_action_validate_cosigner(dispatcher_context_t *dc, bool accept);
 static void finalize_response(dispatcher_context_t *dc);
+static void yield_compiled_policy(dispatcher_context_t *dc);
+static void compiled_policy_yielded(dispatcher_context_t *dc);
+static void wallet_yielded(dispatcher_context_t *dc);
 
 extern global_context_t *G_coin_config;
 
 static bool is_policy_acceptable(policy_node_t *policy);
 static bool is_policy_name_acceptable(const char *name, size_t name_len);
+static bool format_binary_key_info(const policy_map_key_info_t *key_info,
+                                   char out[static MAX_POLICY_KEY_INFO_LEN + 1]);
 
 /**
  * Validates the input, initializes the hash context and starts accumulating the wallet header in
@@ -82,14 +96,124 @@ void handler_register_wallet(dispatcher_context_t *dc) {
         return;
     }
 
+    // optional flags; older clients do not send them
+    state->flags = 0;
+    if (buffer_can_read(&dc->read_buffer, 1)) {
+        if (!buffer_read_u8(&dc->read_buffer, &state->flags) ||
+            (state->flags & ~(REGISTER_WALLET_FLAG_COMPILED | REGISTER_WALLET_FLAG_STORE)) != 0 ||
+            buffer_can_read(&dc->read_buffer, 1)) {
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
+    }
+
+    state->is_batch = false;
+    state->master_key_fingerprint = crypto_get_master_key_fingerprint();
+
+    uint16_t sw = validate_wallet_policy(state);
+    if (sw != SW_OK) {
+        SEND_SW(dc, sw);
+        return;
+    }
+
+    dc_next(dc, verify_keys_info);
+}
+
+void handler_register_wallets(dispatcher_context_t *dc) {
+    register_wallet_state_t *state = (register_wallet_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    // Device must be unlocked
+    if (os_global_pin_is_validated() != BOLOS_UX_OK) {
+        SEND_SW(dc, SW_SECURITY_STATUS_NOT_SATISFIED);
+        return;
+    }
+
+    uint64_t n_wallets;
+    if (!buffer_read_varint(&dc->read_buffer, &n_wallets) ||
+        !buffer_read_bytes(&dc->read_buffer, state->wallets_merkle_root, 32)) {
+        SEND_SW(dc, SW_WRONG_DATA_LENGTH);
+        return;
+    }
+    if (n_wallets == 0 || n_wallets > UINT32_MAX) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
+    }
+
+    // optional flags; the compiled form of the wallet policies is not supported
+    state->flags = 0;
+    if (buffer_can_read(&dc->read_buffer, 1)) {
+        if (!buffer_read_u8(&dc->read_buffer, &state->flags) ||
+            (state->flags & ~REGISTER_WALLET_FLAG_STORE) != 0 ||
+            buffer_can_read(&dc->read_buffer, 1)) {
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
+    }
+
+    state->is_batch = true;
+    state->n_wallets = (uint32_t) n_wallets;
+    state->wallet_index = 0;
+
+    // the same for all the wallets; like the symmetric key of the hmac, it is only derived once
+    state->master_key_fingerprint = crypto_get_master_key_fingerprint();
+
+    dc_next(dc, fetch_next_wallet);
+}
+
+/**
+ * Fetches the serialized wallet policy at wallet_index of the Merkle tree of REGISTER_WALLETS, and
+ * validates it as in REGISTER_WALLET.
+ */
+static void fetch_next_wallet(dispatcher_context_t *dc) {
+    register_wallet_state_t *state = (register_wallet_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    int serialized_wallet_policy_len =
+        call_get_merkle_leaf_element(dc,
+                                     state->wallets_merkle_root,
+                                     state->n_wallets,
+                                     state->wallet_index,
+                                     state->serialized_wallet_policy,
+                                     sizeof(state->serialized_wallet_policy));
+    if (serialized_wallet_policy_len < 0) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
+    }
+
+    buffer_t serialized_wallet_policy_buffer =
+        buffer_create(state->serialized_wallet_policy, serialized_wallet_policy_len);
+    if (read_policy_map_wallet(&serialized_wallet_policy_buffer, &state->wallet_header) < 0 ||
+        buffer_can_read(&serialized_wallet_policy_buffer, 1)) {
+        PRINTF("Failed reading policy map\n");
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
+    }
+
+    uint16_t sw = validate_wallet_policy(state);
+    if (sw != SW_OK) {
+        SEND_SW(dc, sw);
+        return;
+    }
+
+    dc_next(dc, verify_keys_info);
+}
+
+/**
+ * Parses the descriptor template of the wallet policy in state->wallet_header, computes its wallet
+ * id, and checks that the name and the policy are acceptable. Returns SW_OK, or the status word of
+ * the error.
+ */
+static uint16_t validate_wallet_policy(register_wallet_state_t *state) {
     buffer_t policy_map_buffer =
         buffer_create(&state->wallet_header.policy_map, state->wallet_header.policy_map_len);
     if (parse_policy_map(&policy_map_buffer,
                          state->policy_map_bytes,
                          sizeof(state->policy_map_bytes)) < 0) {
         PRINTF("Failed parsing policy map\n");
-        SEND_SW(dc, SW_INCORRECT_DATA);
-        return;
+        return SW_INCORRECT_DATA;
     }
 
     // Compute the wallet id (sha256 of the serialization)
@@ -97,19 +221,126 @@ void handler_register_wallet(dispatcher_context_t *dc) {
 
     // Verify that the name is acceptable
     if (!is_policy_name_acceptable(state->wallet_header.name, state->wallet_header.name_len)) {
-        SEND_SW(dc, SW_INCORRECT_DATA);
-        return;
+        return SW_INCORRECT_DATA;
     }
 
-    // check if policy is acceptable; only multisig is accepted at this time,
-    // and it must be one of the accepted patterns.
+    // check if policy is acceptable; only multisig, taproot with tapscripts and miniscript are
+    // accepted at this time, and it must be one of the accepted patterns.
     if (!is_policy_acceptable(&state->policy_map)) {
+        return SW_NOT_SUPPORTED;
+    }
+
+    // the keys information are all verified before showing the wallet, which needs a leaf hash
+    // per key
+    if (state->wallet_header.n_keys > MAX_POLICY_MAP_KEYS) {
+        PRINTF("Too many keys\n");
+        return SW_NOT_SUPPORTED;
+    }
+
+    return SW_OK;
+}
+
+/**
+ * Reads the keys information in batches, each with a single Merkle proof for its leaves and a
+ * single request for their preimages. Each key information is parsed and validated, and it is
+ * checked whether the key is internal; the account xpubs needed for that are usually cached.
+ * Only once all the keys are validated, the wallet is shown to the user.
+ */
+static void verify_keys_info(dispatcher_context_t *dc) {
+    register_wallet_state_t *state = (register_wallet_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    size_t n_keys = state->wallet_header.n_keys;
+
+    state->n_internal_keys = 0;
+    memset(state->internal_keys, 0, sizeof(state->internal_keys));
+
+    for (size_t i = 0; i < n_keys; i++) {
+        if (i % MERKLE_LEAVES_BATCH_SIZE == 0) {
+            if (call_get_merkle_leaves_hashes(dc,
+                                              state->wallet_header.keys_info_merkle_root,
+                                              n_keys,
+                                              i,
+                                              MERKLE_LEAVES_BATCH_SIZE,
+                                              &state->keys_info_leaf_hashes[i]) < 0) {
+                SEND_SW(dc, SW_INCORRECT_DATA);
+                return;
+            }
+
+            if (call_prefetch_preimages(dc,
+                                        &state->keys_info_leaf_hashes[i],
+                                        MIN(MERKLE_LEAVES_BATCH_SIZE, n_keys - i)) < 0) {
+                SEND_SW(dc, SW_INCORRECT_DATA);
+                return;
+            }
+        }
+
+        int key_info_len = call_get_merkle_preimage(dc,
+                                                    state->keys_info_leaf_hashes[i],
+                                                    state->next_pubkey_info,
+                                                    MAX_POLICY_KEY_INFO_LEN);
+        if (key_info_len < 0) {
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
+
+        buffer_t key_info_buffer = buffer_create(state->next_pubkey_info, key_info_len);
+
+        policy_map_key_info_t key_info;
+        if (parse_policy_map_key_info(&key_info_buffer, &key_info) == -1) {
+            PRINTF("Incorrect policy map.\n");
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
+
+        // We refuse to register wallets without key origin information, or whose keys don't end
+        // with the wildcard ('/**'). The key origin information is necessary when signing to
+        // identify which one is our key. Using addresses without a wildcard could potentially be
+        // supported, but disabled for now (question to address: can only _some_ of the keys have a
+        // wildcard?).
+
+        // the keys information must all be in the format of the wallet type, which is part of the
+        // wallet id; binary keys information are shown as the equivalent string
+        bool is_binary_wallet = state->wallet_header.type == WALLET_TYPE_POLICY_MAP_BINARY_KEYS;
+        if (key_info.is_binary != is_binary_wallet) {
+            PRINTF("Wrong format of the key info.\n");
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
+        if (is_binary_wallet &&
+            !format_binary_key_info(&key_info, (char *) state->next_pubkey_info)) {
+            SEND_SW(dc, SW_NOT_SUPPORTED);
+            return;
+        }
+
+        if (!key_info.has_key_origin) {
+            PRINTF("Key info without origin unsupported.\n");
+            SEND_SW(dc, SW_NOT_SUPPORTED);
+            return;
+        }
+
+        if (!key_info.has_wildcard) {
+            PRINTF("Key info without wildcard unsupported.\n");
+            SEND_SW(dc, SW_NOT_SUPPORTED);
+            return;
+        }
+
+        if (is_policy_key_internal(&key_info,
+                                   state->master_key_fingerprint,
+                                   G_coin_config->bip32_pubkey_version)) {
+            bitvector_set(state->internal_keys, i, true);
+            ++state->n_internal_keys;
+        }
+    }
+
+    if (state->n_internal_keys < 1 || state->n_internal_keys > MAX_POLICY_MAP_INTERNAL_KEYS) {
+        // A wallet with no internal key could not be used for signing.
+        // Wallets with multiple internal keys are allowed: SIGN_PSBT signs with all of them.
         SEND_SW(dc, SW_NOT_SUPPORTED);
         return;
     }
 
-    state->master_key_fingerprint = crypto_get_master_key_fingerprint();
-
     state->next_pubkey_index = 0;
 
     dc->pause();
@@ -125,80 +356,53 @@ static void ui_action_validate_header(dispatcher_context_t *dc, bool accept) {
     if (!accept) {
         SEND_SW(dc, SW_DENY);
     } else {
-        dc->next(process_next_cosigner_info);
+        dc_next(dc, process_next_cosigner_info);
     }
     dc->run();
 }
 
 /**
- * Receives and parses the next pubkey info.
- * Asks the user to validate the pubkey info.
+ * Gets the next pubkey info, already verified by verify_keys_info, and asks the user to validate
+ * it. The preimages are requested in batches, so most screens are shown without interrupting.
  */
 static void process_next_cosigner_info(dispatcher_context_t *dc) {
     register_wallet_state_t *state = (register_wallet_state_t *) &G_command_state;
 
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
-    int pubkey_info_len = call_get_merkle_leaf_element(dc,
-                                                       state->wallet_header.keys_info_merkle_root,
-                                                       state->wallet_header.n_keys,
-                                                       state->next_pubkey_index,
-                                                       state->next_pubkey_info,
-                                                       MAX_POLICY_KEY_INFO_LEN);
+    size_t index = state->next_pubkey_index;
 
-    if (pubkey_info_len < 0) {
-        SEND_SW(dc, SW_INCORRECT_DATA);
-        return;
+    if (index % MERKLE_LEAVES_BATCH_SIZE == 0) {
+        if (call_prefetch_preimages(
+                dc,
+                &state->keys_info_leaf_hashes[index],
+                MIN(MERKLE_LEAVES_BATCH_SIZE, state->wallet_header.n_keys - index)) < 0) {
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
     }
 
-    state->next_pubkey_info[pubkey_info_len] = 0;
-
-    // Make a sub-buffer for the pubkey info
-    buffer_t key_info_buffer = buffer_create(state->next_pubkey_info, pubkey_info_len);
-
-    policy_map_key_info_t key_info;
-    if (parse_policy_map_key_info(&key_info_buffer, &key_info) == -1) {
-        PRINTF("Incorrect policy map.\n");
+    // the hash was verified, so the host must return the same key info that was validated
+    int key_info_len = call_get_merkle_preimage(dc,
+                                                state->keys_info_leaf_hashes[index],
+                                                state->next_pubkey_info,
+                                                MAX_POLICY_KEY_INFO_LEN);
+    if (key_info_len < 0) {
         SEND_SW(dc, SW_INCORRECT_DATA);
         return;
     }
 
-    // We refuse to register wallets without key origin information, or whose keys don't end with
-    // the wildcard ('/**'). The key origin information is necessary when signing to identify which
-    // one is our key. Using addresses without a wildcard could potentially be supported, but
-    // disabled for now (question to address: can only _some_ of the keys have a wildcard?).
+    state->next_pubkey_info[key_info_len] = 0;
 
-    if (!key_info.has_key_origin) {
-        PRINTF("Key info without origin unsupported.\n");
-        SEND_SW(dc, SW_NOT_SUPPORTED);
-        return;
-    }
-
-    if (!key_info.has_wildcard) {
-        PRINTF("Key info without wildcard unsupported.\n");
-        SEND_SW(dc, SW_NOT_SUPPORTED);
-        return;
-    }
-
-    bool is_key_internal = false;
-    if (read_u32_be(key_info.master_key_fingerprint, 0) == state->master_key_fingerprint) {
-        // it could be a collision on the fingerprint; we verify that we can actually generate the
-        // same pubkey
-        char pubkey_derived[MAX_SERIALIZED_PUBKEY_LENGTH + 1];
-        int serialized_pubkey_len =
-            get_serialized_extended_pubkey_at_path(key_info.master_key_derivation,
-                                                   key_info.master_key_derivation_len,
-                                                   G_coin_config->bip32_pubkey_version,
-                                                   pubkey_derived);
-        if (serialized_pubkey_len == -1) {
-            SEND_SW(dc, SW_BAD_STATE);
+    if (state->wallet_header.type == WALLET_TYPE_POLICY_MAP_BINARY_KEYS) {
+        // already validated by verify_keys_info
+        buffer_t key_info_buffer = buffer_create(state->next_pubkey_info, key_info_len);
+        policy_map_key_info_t key_info;
+        if (parse_policy_map_key_info(&key_info_buffer, &key_info) == -1 ||
+            !format_binary_key_info(&key_info, (char *) state->next_pubkey_info)) {
+            SEND_SW(dc, SW_BAD_STATE);  // should never happen
             return;
         }
-
-        if (strncmp(key_info.ext_pubkey, pubkey_derived, MAX_SERIALIZED_PUBKEY_LENGTH) == 0) {
-            is_key_internal = true;
-            ++state->n_internal_keys;
-        }
     }
 
     // TODO: it would be sensible to validate the pubkey (at least syntactically + validate
@@ -210,7 +414,7 @@ static void process_next_cosigner_info(dispatcher_context_t *dc) {
                                           (char *) state->next_pubkey_info,
                                           state->next_pubkey_index,  // 1-indexed for the UI
                                           state->wallet_header.n_keys,
-                                          is_key_internal,
+                                          bitvector_get(state->internal_keys, index),
                                           ui_action_validate_cosigner);
 }
 
@@ -232,9 +436,9 @@ static void ui_action_validate_cosigner(dispatcher_context_t *dc, bool accept) {
 
     ++state->next_pubkey_index;
     if (state->next_pubkey_index < state->wallet_header.n_keys) {
-        dc->next(process_next_cosigner_info);
+        dc_next(dc, process_next_cosigner_info);
     } else {
-        dc->next(finalize_response);
+        dc_next(dc, finalize_response);
     }
     dc->run();
 }
@@ -244,13 +448,6 @@ static void finalize_response(dispatcher_context_t *dc) {
 
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
-    if (state->n_internal_keys != 1) {
-        // Unclear if there is any use case for multiple internal keys in the same wallet.
-        // We disallow that, might reconsider in future versions if needed.
-        SEND_SW(dc, SW_NOT_SUPPORTED);
-        return;
-    }
-
     // TODO: force PIN validation to prevent evil maid attacks registering a wallet.
     //       As only the wallet name is shown when signing from a registered wallet, registering a
     //       wallet is a sensitive operation, and a fraudulent wallet with the same name would
@@ -292,29 +489,125 @@ static void finalize_response(dispatcher_context_t *dc) {
     }
     END_TRY;
 
+    // the wallet is likely to be used right away, e.g. to derive its first addresses
+    wallet_cache_add(response.wallet_id, response.hmac, &state->wallet_header);
+
+    // the user approved the wallet, that can be kept on the device for the later commands
+    if (state->flags & REGISTER_WALLET_FLAG_STORE) {
+        wallet_store_add(response.wallet_id, response.hmac, &state->wallet_header);
+    }
+
+    if (state->is_batch) {
+        // the wallet is registered even if the user rejects one of the next wallets
+        uint8_t cmd = CCMD_YIELD;
+        dc_add_to_response(dc, &cmd, 1);
+        dc_add_to_response(dc, &response, sizeof(response));
+        dc_interrupt(dc, wallet_yielded);
+        return;
+    }
+
+    if (state->flags & REGISTER_WALLET_FLAG_COMPILED) {
+        memcpy(state->response.wallet_id, response.wallet_id, sizeof(response.wallet_id));
+        memcpy(state->response.hmac, response.hmac, sizeof(response.hmac));
+        dc_next(dc, yield_compiled_policy);
+        return;
+    }
+
     SEND_RESPONSE(dc, &response, sizeof(response), SW_OK);
 }
 
+/**
+ * Compiles the wallet policy, and yields its compiled form; its hmac is returned in the response.
+ */
+static void yield_compiled_policy(dispatcher_context_t *dc) {
+    register_wallet_state_t *state = (register_wallet_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    int script_template_len = compile_script_template(&state->policy_map,
+                                                      state->script_template,
+                                                      sizeof(state->script_template));
+    if (script_template_len < 0) {
+        SEND_SW(dc, SW_BAD_STATE);  // should never happen
+        return;
+    }
+
+    int compiled_policy_len = write_compiled_policy(&state->wallet_header,
+                                                    state->wallet_id,
+                                                    state->script_template,
+                                                    script_template_len,
+                                                    state->compiled_policy,
+                                                    sizeof(state->compiled_policy));
+    if (compiled_policy_len < 0) {
+        SEND_SW(dc, SW_BAD_STATE);  // should never happen
+        return;
+    }
+
+    uint8_t compiled_policy_id[32];
+    cx_hash_sha256(state->compiled_policy, compiled_policy_len, compiled_policy_id, 32);
+    compute_compiled_policy_hmac(compiled_policy_id, state->response.compiled_policy_hmac);
+
+    uint8_t cmd = CCMD_YIELD;
+    dc_add_to_response(dc, &cmd, 1);
+    dc_add_to_response(dc, state->compiled_policy, compiled_policy_len);
+    dc_interrupt(dc, compiled_policy_yielded);
+}
+
+static void compiled_policy_yielded(dispatcher_context_t *dc) {
+    register_wallet_state_t *state = (register_wallet_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    SEND_RESPONSE(dc, &state->response, sizeof(state->response), SW_OK);
+}
+
+static void wallet_yielded(dispatcher_context_t *dc) {
+    register_wallet_state_t *state = (register_wallet_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    ++state->wallet_index;
+    if (state->wallet_index < state->n_wallets) {
+        dc_next(dc, fetch_next_wallet);
+    } else {
+        SEND_SW(dc, SW_OK);
+    }
+}
+
 static bool is_policy_acceptable(policy_node_t *policy) {
     policy_node_t *internal_script;
 
     if (policy->type == TOKEN_SH) {
         policy_node_t *child_node = ((policy_node_with_script_t *) policy)->script;
         if (child_node->type == TOKEN_WSH) {
-            // sh(wsh({sorted}multi(@0)))
+            // sh(wsh({sorted}multi(@0))), or sh(wsh(MINISCRIPT))
             internal_script = ((policy_node_with_script_t *) child_node)->script;
         } else {
             // sh({sorted}multi(@0))
             internal_script = child_node;
         }
     } else if (policy->type == TOKEN_WSH) {
-        // wsh({sorted}multi(@0))
+        // wsh({sorted}multi(@0)), or wsh(MINISCRIPT)
         internal_script = ((policy_node_with_script_t *) policy)->script;
+    } else if (policy->type == TOKEN_TR) {
+        // tr(@0,TREE); without tapscripts, tr(@0) is a single-signature policy
+        return ((policy_node_tr_t *) policy)->tree != NULL;
     } else {
         return false;  // unexpected policy
     }
 
-    return internal_script->type == TOKEN_MULTI || internal_script->type == TOKEN_SORTEDMULTI;
+    // the parser only accepts a miniscript inside wsh
+    switch (internal_script->type) {
+        case TOKEN_MULTI:
+        case TOKEN_SORTEDMULTI:
+        case TOKEN_PK_K:
+        case TOKEN_OLDER:
+        case TOKEN_AND_V:
+        case TOKEN_THRESH:
+            return true;
+        default:
+            return false;
+    }
 }
 
 static bool is_policy_name_acceptable(const char *name, size_t name_len) {
@@ -329,4 +622,49 @@ static bool is_policy_name_acceptable(const char *name, size_t name_len) {
         if (name[i] < 0x20 || name[i] > 0x7E) return false;
 
     return true;
-}
\ No newline at end of file
+}
+
+// Formats a binary key information as the equivalent string, that is shown to the user, like
+// "[d34db33f/48'/1'/0'/2']tpub.../**". Returns false if the string does not fit in out.
+static bool format_binary_key_info(const policy_map_key_info_t *key_info,
+                                   char out[static MAX_POLICY_KEY_INFO_LEN + 1]) {
+    // "[", the fingerprint, "/", the derivation steps, "]" and the terminating null character
+    char origin[1 + 8 + 1 + MAX_SERIALIZED_BIP32_PATH_LENGTH + 1 + 1];
+    size_t origin_len = 0;
+    if (key_info->has_key_origin) {
+        origin[0] = '[';
+        format_hex(key_info->master_key_fingerprint, 4, origin + 1, 8 + 1);
+        origin_len = 1 + 8;
+        if (key_info->master_key_derivation_len > 0) {
+            origin[origin_len++] = '/';
+            if (!bip32_path_format(key_info->master_key_derivation,
+                                   key_info->master_key_derivation_len,
+                                   origin + origin_len,
+                                   sizeof(origin) - origin_len - 1)) {
+                return false;
+            }
+            origin_len += strlen(origin + origin_len);
+        }
+        origin[origin_len++] = ']';
+    }
+
+    char ext_pubkey[MAX_SERIALIZED_PUBKEY_LENGTH + 1];
+    int ext_pubkey_len = serialize_extended_pubkey(
+        (const serialized_extended_pubkey_t *) key_info->serialized_ext_pubkey,
+        ext_pubkey);
+    if (ext_pubkey_len < 0) {
+        return false;
+    }
+
+    size_t suffix_len = key_info->has_wildcard ? 3 : 0;
+    if (origin_len + ext_pubkey_len + suffix_len > MAX_POLICY_KEY_INFO_LEN) {
+        return false;
+    }
+
+    memcpy(out, origin, origin_len);
+    memcpy(out + origin_len, ext_pubkey, ext_pubkey_len);
+    memcpy(out + origin_len + ext_pubkey_len, "/**", suffix_len);
+    out[origin_len + ext_pubkey_len + suffix_len] = '\0';
+    return true;
+}
+
@@ -2,14 +2,28 @@
 
 #include "../crypto.h"
 #include "../common/bip32.h"
+#include "../common/bitvector.h"
 #include "../common/wallet.h"
 #include "../boilerplate/dispatcher.h"
 
 #include "lib/get_merkle_leaf_element.h"
 
+// flags of REGISTER_WALLET
+#define REGISTER_WALLET_FLAG_COMPILED 0x01  // also return the compiled form of the wallet policy
+#define REGISTER_WALLET_FLAG_STORE    0x02  // keep the wallet policy in the store of the device
+
 typedef struct {
     machine_context_t ctx;
 
+    uint8_t flags;
+
+    // only for REGISTER_WALLETS: the Merkle tree of the serialized wallet policies, and the index
+    // of the one being registered
+    bool is_batch;
+    uint32_t n_wallets;
+    uint32_t wallet_index;
+    uint8_t wallets_merkle_root[32];
+
     policy_map_wallet_header_t wallet_header;
 
     uint8_t wallet_id[32];
@@ -21,8 +35,35 @@ typedef struct {
 
     uint32_t master_key_fingerprint;
 
+    // hashes of the leaves of the keys information tree, and which keys are internal; they are
+    // all verified before any key is shown, so that the UI only needs to fetch each preimage
+    uint8_t keys_info_leaf_hashes[MAX_POLICY_MAP_KEYS][32];
+    uint8_t internal_keys[BITVECTOR_REAL_SIZE(MAX_POLICY_MAP_KEYS)];  // bitvector
+
     uint8_t next_pubkey_index;
     uint8_t next_pubkey_info[MAX_POLICY_KEY_INFO_LEN + 1];
+
+    struct {
+        uint8_t wallet_id[32];
+        uint8_t hmac[32];
+        uint8_t compiled_policy_hmac[32];
+    } response;
+    union {
+        // only with REGISTER_WALLET_FLAG_COMPILED; the response is sent once the compiled form of
+        // the wallet policy is yielded
+        struct {
+            uint8_t script_template[MAX_SCRIPT_TEMPLATE_LEN];
+            uint8_t compiled_policy[MAX_COMPILED_POLICY_LEN];
+        };
+        // only for REGISTER_WALLETS, where the compiled form is not supported
+        uint8_t serialized_wallet_policy[MAX_POLICY_MAP_SERIALIZED_LENGTH];
+    };
 } register_wallet_state_t;
 
 void handler_register_wallet(dispatcher_context_t *dispatcher_context);
+
+/**
+ * Registers several wallet policies in a single command, each shown to the user as in
+ * REGISTER_WALLET; the wallet id and hmac of each wallet are returned with the YIELD client command.
+ */
+void handler_register_wallets(dispatcher_context_t *dispatcher_context);
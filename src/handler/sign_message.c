@@ -0,0 +1,310 @@
+/*****************************************************************************
+ *   Ledger App Bitcoin.
+ *   (c) 2021 Ledger SAS.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *****************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "os.h"
+#include "cx.h"
+
+#include "../boilerplate/dispatcher.h"
+#include "../boilerplate/sw.h"
+#include "../common/buffer.h"
+#include "../common/format.h"
+#include "../commands.h"
+#include "../constants.h"
+#include "../crypto.h"
+#include "../ui/display.h"
+#include "../ui/menu.h"
+
+#include "lib/batch_requests.h"
+#include "lib/get_merkle_leaves_hashes.h"
+#include "lib/stream_preimage.h"
+
+#include "client_commands.h"
+
+#include "sign_message.h"
+
+// after the coin id, in the prefix of signed messages; for example: "\x18Bitcoin Signed Message:\n"
+static const char SIGN_MESSAGE_MAGIC[] = " Signed Message:\n";
+#define SIGN_MESSAGE_MAGIC_LEN (sizeof(SIGN_MESSAGE_MAGIC) - 1)
+
+extern global_context_t *G_coin_config;
+
+static void process_message(dispatcher_context_t *dc);
+static void ui_action_validate_message(dispatcher_context_t *dc, bool accept);
+static void sign_message(dispatcher_context_t *dc);
+
+void handler_sign_message(dispatcher_context_t *dc) {
+    sign_message_state_t *state = (sign_message_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    // Device must be unlocked
+    if (os_global_pin_is_validated() != BOLOS_UX_OK) {
+        SEND_SW(dc, SW_SECURITY_STATUS_NOT_SATISFIED);
+        return;
+    }
+
+    if (!buffer_read_u8(&dc->read_buffer, &state->bip32_path_len)) {
+        SEND_SW(dc, SW_WRONG_DATA_LENGTH);
+        return;
+    }
+
+    if (state->bip32_path_len > MAX_BIP32_PATH_STEPS) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
+    }
+
+    if (!buffer_read_bip32_path(&dc->read_buffer, state->bip32_path, state->bip32_path_len) ||
+        !buffer_read_varint(&dc->read_buffer, &state->message_length) ||
+        !buffer_read_bytes(&dc->read_buffer, state->message_merkle_root, 32)) {
+        SEND_SW(dc, SW_WRONG_DATA_LENGTH);
+        return;
+    }
+
+    if (state->message_length == 0 || state->message_length > UINT32_MAX) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
+    }
+
+    state->n_chunks = (uint32_t) ((state->message_length + MESSAGE_CHUNK_SIZE - 1) /
+                                  MESSAGE_CHUNK_SIZE);
+
+    dc_next(dc, process_message);
+}
+
+typedef struct {
+    sign_message_state_t *state;
+    uint32_t chunk_index;
+    size_t chunk_offset;  // bytes of the chunk already received, as it can be streamed in pieces
+    bool is_length_valid;
+} chunk_callback_state_t;
+
+static void chunk_len_callback(size_t len, void *arg) {
+    chunk_callback_state_t *cb_state = (chunk_callback_state_t *) arg;
+    sign_message_state_t *state = cb_state->state;
+
+    // all the chunks are full, except possibly the last one
+    size_t expected_len = MESSAGE_CHUNK_SIZE;
+    if (cb_state->chunk_index == state->n_chunks - 1) {
+        uint64_t offset = (uint64_t) MESSAGE_CHUNK_SIZE * cb_state->chunk_index;
+        expected_len = (size_t) (state->message_length - offset);
+    }
+    cb_state->is_length_valid = len == expected_len;
+}
+
+static void chunk_callback(buffer_t *data, void *arg) {
+    chunk_callback_state_t *cb_state = (chunk_callback_state_t *) arg;
+    sign_message_state_t *state = cb_state->state;
+
+    if (!cb_state->is_length_valid) {
+        return;  // the chunk is rejected after the preimage is verified
+    }
+
+    const uint8_t *bytes = data->ptr + data->offset;
+    size_t len = data->size - data->offset;
+
+    crypto_hash_update(&state->message_hash_context.header, bytes, len);
+    crypto_hash_update(&state->digest_context.header, bytes, len);
+
+    if (cb_state->chunk_index == 0) {
+        for (size_t i = 0; i < len; i++) {
+            if (bytes[i] < 0x20 || bytes[i] > 0x7E) {
+                state->is_message_printable = false;
+            }
+            state->message_preview[cb_state->chunk_offset + i] = (char) bytes[i];
+        }
+    }
+    cb_state->chunk_offset += len;
+}
+
+/**
+ * Hashes the whole message, whose chunks are requested in batches, each with a single Merkle proof
+ * for its leaves and a single request for their preimages, then shows the message to the user.
+ */
+static void process_message(dispatcher_context_t *dc) {
+    sign_message_state_t *state = (sign_message_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    cx_sha256_init(&state->message_hash_context);
+    cx_sha256_init(&state->digest_context);
+
+    size_t coin_id_len = strlen(G_coin_config->coinid);
+    crypto_hash_update_u8(&state->digest_context.header,
+                          (uint8_t) (coin_id_len + SIGN_MESSAGE_MAGIC_LEN));
+    crypto_hash_update(&state->digest_context.header, G_coin_config->coinid, coin_id_len);
+    crypto_hash_update(&state->digest_context.header, SIGN_MESSAGE_MAGIC, SIGN_MESSAGE_MAGIC_LEN);
+    crypto_hash_update_varint(&state->digest_context.header, state->message_length);
+
+    memset(state->message_preview, 0, sizeof(state->message_preview));
+    state->is_message_printable = true;
+
+    uint8_t leaf_hashes[MERKLE_LEAVES_BATCH_SIZE][32];
+    for (uint32_t i = 0; i < state->n_chunks; i++) {
+        unsigned int batch_idx = i % MERKLE_LEAVES_BATCH_SIZE;
+        if (batch_idx == 0) {
+            // get the leaf hashes of the next batch of chunks, with a single Merkle proof
+            if (call_get_merkle_leaves_hashes(dc,
+                                              state->message_merkle_root,
+                                              state->n_chunks,
+                                              i,
+                                              MERKLE_LEAVES_BATCH_SIZE,
+                                              leaf_hashes) < 0) {
+                SEND_SW(dc, SW_INCORRECT_DATA);
+                return;
+            }
+
+            // ask at once for the chunks of the batch
+            if (call_prefetch_preimages(dc,
+                                        leaf_hashes,
+                                        MIN(MERKLE_LEAVES_BATCH_SIZE, state->n_chunks - i)) < 0) {
+                SEND_SW(dc, SW_INCORRECT_DATA);
+                return;
+            }
+        }
+
+        chunk_callback_state_t cb_state = {.state = state, .chunk_index = i};
+        if (call_stream_preimage(dc,
+                                 leaf_hashes[batch_idx],
+                                 chunk_len_callback,
+                                 chunk_callback,
+                                 &cb_state) < 0 ||
+            !cb_state.is_length_valid) {
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
+    }
+
+    crypto_hash_digest(&state->message_hash_context.header, state->message_hash, 32);
+
+    // the digest is the double sha256 of the prefixed message
+    crypto_hash_digest(&state->digest_context.header, state->digest, 32);
+    cx_hash_sha256(state->digest, 32, state->digest, 32);
+
+    char path_str[MAX_SERIALIZED_BIP32_PATH_LENGTH + 1] = "(Master key)";
+    if (state->bip32_path_len > 0) {
+        bip32_path_format(state->bip32_path, state->bip32_path_len, path_str, sizeof(path_str));
+    }
+
+    char message_hash_str[64 + 1];
+    format_hex(state->message_hash, 32, message_hash_str, sizeof(message_hash_str));
+
+    dc->pause();
+    ui_display_message(dc,
+                       path_str,
+                       state->is_message_printable ? state->message_preview : NULL,
+                       state->n_chunks > 1,
+                       message_hash_str,
+                       ui_action_validate_message);
+}
+
+static void ui_action_validate_message(dispatcher_context_t *dc, bool accept) {
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    if (accept) {
+        dc_next(dc, sign_message);
+    } else {
+        SEND_SW(dc, SW_DENY);
+    }
+
+    dc->run();
+}
+
+// Copies a DER-encoded integer to a 32-byte big-endian buffer; returns false if it does not fit.
+static bool read_der_integer(buffer_t *der, uint8_t out[static 32]) {
+    uint8_t tag, len;
+    if (!buffer_read_u8(der, &tag) || !buffer_read_u8(der, &len) || tag != 0x02 || len == 0 ||
+        !buffer_can_read(der, len)) {
+        return false;
+    }
+
+    const uint8_t *bytes = der->ptr + der->offset;
+    buffer_seek_cur(der, len);
+
+    // skip the leading zero that makes the integer positive
+    while (len > 32 && bytes[0] == 0x00) {
+        ++bytes;
+        --len;
+    }
+    if (len > 32) {
+        return false;
+    }
+
+    memset(out, 0, 32 - len);
+    memcpy(out + 32 - len, bytes, len);
+    return true;
+}
+
+/**
+ * Signs the digest, and returns the signature as the 0x1F byte (or 0x20 if the y coordinate of R
+ * is odd), followed by r and s; that is, the recoverable signature of BIP-137 for a compressed
+ * pubkey, before its base64 encoding.
+ */
+static void sign_message(dispatcher_context_t *dc) {
+    sign_message_state_t *state = (sign_message_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    cx_ecfp_private_key_t private_key = {0};
+    uint8_t chain_code[32] = {0};
+    uint32_t info = 0;
+
+    uint8_t sig[MAX_DER_SIG_LEN];
+    int sig_len = 0;
+
+    bool error = false;
+    BEGIN_TRY {
+        TRY {
+            crypto_derive_private_key(&private_key,
+                                      chain_code,
+                                      state->bip32_path,
+                                      state->bip32_path_len);
+            sig_len = cx_ecdsa_sign(&private_key,
+                                    CX_RND_RFC6979,
+                                    CX_SHA256,
+                                    state->digest,
+                                    32,
+                                    sig,
+                                    MAX_DER_SIG_LEN,
+                                    &info);
+        }
+        CATCH_ALL {
+            error = true;
+        }
+        FINALLY {
+            explicit_bzero(&private_key, sizeof(private_key));
+        }
+    }
+    END_TRY;
+
+    uint8_t response[1 + 32 + 32];
+    response[0] = 27 + 4 + ((info & CX_ECCINFO_PARITY_ODD) ? 1 : 0);
+
+    // the DER signature is a sequence of the two integers r and s
+    buffer_t der = buffer_create(sig, error ? 0 : sig_len);
+    uint8_t seq_tag, seq_len;
+    if (error || !buffer_read_u8(&der, &seq_tag) || !buffer_read_u8(&der, &seq_len) ||
+        seq_tag != 0x30 || !read_der_integer(&der, response + 1) ||
+        !read_der_integer(&der, response + 1 + 32)) {
+        SEND_SW(dc, SW_BAD_STATE);
+        return;
+    }
+
+    SEND_RESPONSE(dc, response, sizeof(response), SW_OK);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "../constants.h"
+#include "../crypto.h"
+#include "../common/bip32.h"
+#include "../boilerplate/dispatcher.h"
+
+typedef struct {
+    machine_context_t ctx;
+
+    uint32_t bip32_path[MAX_BIP32_PATH_STEPS];
+    uint8_t bip32_path_len;
+
+    uint64_t message_length;
+    uint8_t message_merkle_root[32];
+    uint32_t n_chunks;
+
+    // hash of the message, as shown to the user
+    cx_sha256_t message_hash_context;
+    // hash of the message with the magic prefix of signed messages (the first sha256 of the digest)
+    cx_sha256_t digest_context;
+
+    uint8_t message_hash[32];
+    uint8_t digest[32];
+
+    // the first chunk of the message, terminated, if it is printable
+    char message_preview[MESSAGE_CHUNK_SIZE + 1];
+    bool is_message_printable;
+} sign_message_state_t;
+
+/**
+ * Signs a message with a key at the given path, with the signature format of BIP-137 for a
+ * compressed pubkey (as the legacy signMessage), after showing its hash to the user.
+ */
+void handler_sign_message(dispatcher_context_t *dispatcher_context);
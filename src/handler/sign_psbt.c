@@ -19,11 +19,15 @@
 
 #include "../boilerplate/dispatcher.h"
 #include "../boilerplate/sw.h"
+#include "../common/format.h"
 #include "../common/merkle.h"
 #include "../common/psbt.h"
 #include "../common/read.h"
 #include "../common/script.h"
+#include "../common/tweaked_key_cache.h"
 #include "../common/varint.h"
+#include "../common/wallet_cache.h"
+#include "../common/wallet_store.h"
 #include "../common/write.h"
 
 #include "../commands.h"
@@ -39,7 +43,13 @@
 #include "lib/get_preimage.h"
 #include "lib/get_merkleized_map.h"
 #include "lib/get_merkleized_map_value.h"
+#include "lib/get_merkleized_map_fields.h"
+#include "lib/get_merkle_leaf_element.h"
+#include "lib/get_merkle_leaf_index.h"
+#include "lib/get_merkle_leaves_hashes.h"
+#include "lib/batch_requests.h"
 #include "lib/psbt_parse_rawtx.h"
+#include "lib/stream_wallet_policy.h"
 
 #include "sign_psbt.h"
 
@@ -52,9 +62,14 @@ extern global_context_t *G_coin_config;
 // UI callbacks
 static void ui_action_validate_wallet_authorized(dispatcher_context_t *dc, bool accept);
 static void ui_alert_external_inputs_result(dispatcher_context_t *dc, bool accept);
+static void ui_alert_nondefault_sighash_result(dispatcher_context_t *dc, bool accept);
 static void ui_action_validate_output(dispatcher_context_t *dc, bool accept);
+static void ui_action_validate_output_summary(dispatcher_context_t *dc, bool accept);
 static void ui_action_validate_transaction(dispatcher_context_t *dc, bool accept);
 
+// Authorization of the registered wallets
+static void authorize_wallets(dispatcher_context_t *dc);
+
 // Read global map
 static void process_global_map(dispatcher_context_t *dc);
 
@@ -63,6 +78,7 @@ static void process_input_map(dispatcher_context_t *dc);
 static void check_input_owned(dispatcher_context_t *dc);
 
 static void alert_external_inputs(dispatcher_context_t *dc);
+static void alert_nondefault_sighash(dispatcher_context_t *dc);
 
 // Output validation
 static void verify_outputs_init(dispatcher_context_t *dc);
@@ -73,9 +89,12 @@ static void output_next(dispatcher_context_t *dc);
 
 // User confirmation (all)
 static void confirm_transaction(dispatcher_context_t *dc);
+static void confirm_fees(dispatcher_context_t *dc);
+static void yield_amend_record(dispatcher_context_t *dc);
 
 // Signing process (all)
 static void sign_init(dispatcher_context_t *dc);
+static void compute_segwit_hashes(dispatcher_context_t *dc);
 static void sign_process_input_map(dispatcher_context_t *dc);
 
 // Legacy sighash computation (P2PKH and P2SH)
@@ -90,16 +109,19 @@ static void sign_segwit_v1(dispatcher_context_t *dc);
 // Sign input and yield result
 static void sign_sighash_ecdsa(dispatcher_context_t *dc);
 static void sign_sighash_schnorr(dispatcher_context_t *dc);
+static bool flush_yield_buffer(dispatcher_context_t *dc);
+static bool yield_progress(dispatcher_context_t *dc,
+                           uint8_t phase,
+                           unsigned int done,
+                           unsigned int total);
 
 // End point and return
 static void finalize(dispatcher_context_t *dc);
 
-/* BIP0341 tags for computing the tagged hashes when computing he sighash */
-static const uint8_t BIP0341_sighash_tag[] = {'T', 'a', 'p', 'S', 'i', 'g', 'h', 'a', 's', 'h'};
-
 /*
 Current assumptions during signing:
-  1) exactly one of the keys in the wallet is internal (enforce during wallet registration)
+  1) at least one of the keys in the wallet is internal (enforced during wallet registration); each
+     internal input is signed with all the internal keys
   2) all the keys in the wallet have a wildcard (that is, they end with '**'), with at most
      4 derivation steps before it.
 
@@ -112,74 +134,703 @@ the right paths to identify internal inputs/outputs.
 
 // HELPER FUNCTIONS
 
+// Updates the hash_context with the network serialization of the output with the given map.
+// returns -1 on error (in that case, a response is already set). 0 on success.
+static int hash_output_map(dispatcher_context_t *dc,
+                           const merkleized_map_commitment_t *map,
+                           cx_hash_t *hash_context) {
+    // get output's amount
+    uint8_t amount_raw[8];
+    if (8 != call_get_merkleized_map_value(dc,
+                                           map,
+                                           (uint8_t[]){PSBT_OUT_AMOUNT},
+                                           1,
+                                           amount_raw,
+                                           8)) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return -1;
+    }
+
+    crypto_hash_update(hash_context, amount_raw, 8);
+
+    // get output's scriptPubKey
+
+    uint8_t out_script[MAX_PREVOUT_SCRIPTPUBKEY_LEN];
+    int out_script_len = call_get_merkleized_map_value(dc,
+                                                       map,
+                                                       (uint8_t[]){PSBT_OUT_SCRIPT},
+                                                       1,
+                                                       out_script,
+                                                       sizeof(out_script));
+    if (out_script_len < 0) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return -1;
+    }
+
+    crypto_hash_update_varint(hash_context, out_script_len);
+    crypto_hash_update(hash_context, out_script, out_script_len);
+    return 0;
+}
+
 // Updates the hash_context with the network serialization of all the outputs
 // returns -1 on error (in that case, a response is already set). 0 on success.
+// Only needed for legacy sighashes, where the outputs follow the inputs (that differ for each
+// signed input) in the preimage; for segwit, hashes.sha_outputs is computed while verifying the
+// outputs.
 static int hash_outputs(dispatcher_context_t *dc, cx_hash_t *hash_context) {
     sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
 
-    // TODO: support other SIGHASH FLAGS
+    uint8_t leaf_hashes[MERKLE_LEAVES_BATCH_SIZE][32];
     for (unsigned int i = 0; i < state->n_outputs; i++) {
+        unsigned int batch_idx = i % MERKLE_LEAVES_BATCH_SIZE;
+        if (batch_idx == 0) {
+            // get the leaf hashes of the next batch of output maps, with a single Merkle proof
+            if (call_get_merkle_leaves_hashes(dc,
+                                              state->outputs_root,
+                                              state->n_outputs,
+                                              i,
+                                              MERKLE_LEAVES_BATCH_SIZE,
+                                              leaf_hashes) < 0) {
+                SEND_SW(dc, SW_INCORRECT_DATA);
+                return -1;
+            }
+
+            // ask at once for the commitments of the maps of the batch
+            if (call_prefetch_preimages(dc,
+                                        leaf_hashes,
+                                        MIN(MERKLE_LEAVES_BATCH_SIZE, state->n_outputs - i)) < 0) {
+                SEND_SW(dc, SW_INCORRECT_DATA);
+                return -1;
+            }
+        }
+
         // get this output's map
         merkleized_map_commitment_t ith_map;
 
-        int res = call_get_merkleized_map(dc, state->outputs_root, state->n_outputs, i, &ith_map);
+        int res = call_get_merkleized_map_from_leaf_hash(dc, leaf_hashes[batch_idx], &ith_map);
         if (res < 0) {
             SEND_SW(dc, SW_INCORRECT_DATA);
             return -1;
         }
 
-        // get output's amount
-        uint8_t amount_raw[8];
-        if (8 != call_get_merkleized_map_value(dc,
-                                               &ith_map,
-                                               (uint8_t[]){PSBT_OUT_AMOUNT},
-                                               1,
-                                               amount_raw,
-                                               8)) {
+        if (hash_output_map(dc, &ith_map, hash_context) == -1) {
+            return -1;  // response already set
+        }
+    }
+    return 0;
+}
+
+// Updates the hash_context with the network serialization of the output with the same index as
+// the current input, the only one committed to with SIGHASH_SINGLE.
+// returns -1 on error (in that case, a response is already set). 0 on success.
+static int hash_single_output(dispatcher_context_t *dc, cx_hash_t *hash_context) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    // the output exists, as checked in check_input_owned
+    merkleized_map_commitment_t map;
+    int res = call_get_merkleized_map(dc,
+                                      state->outputs_root,
+                                      state->n_outputs,
+                                      state->cur_input_index,
+                                      &map);
+    if (res < 0) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return -1;
+    }
+
+    return hash_output_map(dc, &map, hash_context);
+}
+
+// Returns true if the sighash type can be used to sign an input: SIGHASH_ALL, SIGHASH_NONE or
+// SIGHASH_SINGLE, optionally combined with SIGHASH_ANYONECANPAY; for taproot inputs, also
+// SIGHASH_DEFAULT.
+static bool is_sighash_type_valid(uint32_t sighash_type, bool is_taproot) {
+    if (is_taproot && sighash_type == SIGHASH_DEFAULT) {
+        return true;
+    }
+    uint32_t base_type = sighash_type & ~SIGHASH_ANYONECANPAY;
+    return base_type == SIGHASH_ALL || base_type == SIGHASH_NONE || base_type == SIGHASH_SINGLE;
+}
+
+// Adds amount to *total, that is left unchanged if the sum overflows. Returns false in that case.
+static bool add_to_total(uint64_t *total, uint64_t amount) {
+    if (amount > UINT64_MAX - *total) {
+        PRINTF("Overflow in the totals of the transaction\n");
+        return false;
+    }
+    *total += amount;
+    return true;
+}
+
+// Computes the txid of the BIP-322 'to_spend' transaction for the message hash, and the
+// scriptPubKey of the address whose funds are proven. The 'to_sign' transaction of a proof spends
+// its only output, therefore it can never be mined.
+static void compute_bip322_to_spend_txid(const uint8_t message_hash[static 32],
+                                         const uint8_t *script,
+                                         size_t script_len,
+                                         uint8_t out[static 32]) {
+    cx_sha256_t hash_context;
+    cx_sha256_init(&hash_context);
+
+    uint8_t zeros[32] = {0};
+
+    // version 0, and a single input spending the output 0xFFFFFFFF of the null txid
+    crypto_hash_update(&hash_context.header, zeros, 4);
+    crypto_hash_update_u8(&hash_context.header, 1);
+    crypto_hash_update(&hash_context.header, zeros, 32);
+    crypto_hash_update(&hash_context.header, (uint8_t[]){0xFF, 0xFF, 0xFF, 0xFF}, 4);
+
+    // scriptSig: OP_0 PUSH32[message_hash]; sequence 0
+    crypto_hash_update_u8(&hash_context.header, 2 + 32);
+    crypto_hash_update_u8(&hash_context.header, 0x00);
+    crypto_hash_update_u8(&hash_context.header, 32);
+    crypto_hash_update(&hash_context.header, message_hash, 32);
+    crypto_hash_update(&hash_context.header, zeros, 4);
+
+    // a single output of value 0 with the scriptPubKey; locktime 0
+    crypto_hash_update_u8(&hash_context.header, 1);
+    crypto_hash_update(&hash_context.header, zeros, 8);
+    crypto_hash_update_varint(&hash_context.header, script_len);
+    crypto_hash_update(&hash_context.header, script, script_len);
+    crypto_hash_update(&hash_context.header, zeros, 4);
+
+    crypto_hash_digest(&hash_context.header, out, 32);
+    cx_hash_sha256(out, 32, out, 32);
+}
+
+/*
+  Amend record of a psbt, to sign a fee bump of it in SIGN_PSBT_MODE_AMEND. A psbt that spends the
+  same inputs (with the same input maps) with the same wallet policy can reuse the verification of
+  its inputs, as well as the approval of the external outputs by the user: in SIGN_PSBT_MODE_AMEND,
+  only the outputs are verified, and the user only approves the fee, as long as the external
+  outputs are unchanged.
+
+  The record is authenticated with an hmac of its sha256, bound to the wallet policy and to the
+  input maps; see compute_amend_record_hmac.
+*/
+
+// flags of the amend record
+#define AMEND_RECORD_FLAG_SEGWIT_INPUTS    0x01  // has_internal_segwit_inputs
+#define AMEND_RECORD_FLAG_SEGWIT_V1_INPUTS 0x02  // has_internal_segwit_v1_inputs
+#define AMEND_RECORD_FLAG_NONDEFAULT       0x04  // has_nondefault_sighash
+
+// The prefix of the message authenticated by the hmac of an amend record, followed by the id of the
+// wallet policy, the number and the Merkle root of the input maps, and the sha256 of the record
+#define AMEND_RECORD_HMAC_TAG     "amend record"
+#define AMEND_RECORD_HMAC_TAG_LEN (sizeof(AMEND_RECORD_HMAC_TAG) - 1)
+
+// Computes the hmac of the amend record with sha256 record_id for the psbt and the wallet policy of
+// the current command, with the same symmetric key as the hmac of registered wallet policies.
+static void compute_amend_record_hmac(const sign_psbt_state_t *state,
+                                      const uint8_t record_id[static 32],
+                                      uint8_t out[static 32]) {
+    uint8_t key[32];
+    uint8_t message[AMEND_RECORD_HMAC_TAG_LEN + 32 + 4 + 32 + 32];
+    buffer_t msg = buffer_create(message, sizeof(message));
+    buffer_write_bytes(&msg, (const uint8_t *) AMEND_RECORD_HMAC_TAG, AMEND_RECORD_HMAC_TAG_LEN);
+    buffer_write_bytes(&msg, state->wallet_id, 32);
+    buffer_write_u32(&msg, state->n_inputs, LE);
+    buffer_write_bytes(&msg, state->inputs_root, 32);
+    buffer_write_bytes(&msg, record_id, 32);
+
+    BEGIN_TRY {
+        TRY {
+            crypto_derive_symmetric_key(WALLET_SLIP0021_LABEL, WALLET_SLIP0021_LABEL_LEN, key);
+
+            cx_hmac_sha256(key, sizeof(key), message, sizeof(message), out, 32);
+        }
+        FINALLY {
+            explicit_bzero(key, sizeof(key));
+        }
+    }
+    END_TRY;
+}
+
+// Fetches the amend record with sha256 record_id, verifies its hmac, and restores the result of the
+// verification of the inputs from it. Returns false (after sending the status word) on error.
+static bool load_amend_record(dispatcher_context_t *dc,
+                              const uint8_t record_id[static 32],
+                              const uint8_t record_hmac[static 32]) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    if (state->n_inputs > SIGN_PSBT_AMEND_MAX_N_INPUTS) {
+        SEND_SW(dc, SW_NOT_SUPPORTED);
+        return false;
+    }
+
+    int record_len =
+        call_get_preimage(dc, record_id, state->amend_record, sizeof(state->amend_record));
+    if (record_len < 0) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return false;
+    }
+
+    uint8_t correct_hmac[32];
+    compute_amend_record_hmac(state, record_id, correct_hmac);
+    bool is_hmac_correct = os_secure_memcmp((void *) record_hmac, correct_hmac, 32) == 0;
+    explicit_bzero(correct_hmac, sizeof(correct_hmac));
+    if (!is_hmac_correct) {
+        PRINTF("Incorrect hmac of the amend record\n");
+        SEND_SW(dc, SW_SIGNATURE_FAIL);
+        return false;
+    }
+
+    buffer_t record = buffer_create(state->amend_record, record_len);
+    uint8_t version, flags;
+    if (!buffer_read_u8(&record, &version) || version != SIGN_PSBT_AMEND_RECORD_VERSION ||
+        !buffer_read_u8(&record, &flags) ||
+        !buffer_read_u64(&record, &state->totals.inputs, LE) ||
+        !buffer_read_u64(&record, &state->totals.internal_inputs, LE) ||
+        !buffer_read_bytes(&record, state->hashes.sha_prevouts, 32) ||
+        !buffer_read_bytes(&record, state->hashes.sha_amounts, 32) ||
+        !buffer_read_bytes(&record, state->hashes.sha_scriptpubkeys, 32) ||
+        !buffer_read_bytes(&record, state->hashes.sha_sequences, 32) ||
+        !buffer_read_bytes(&record, state->external_outputs_hash, 32) ||
+        !buffer_read_bytes(&record, state->internal_inputs, BITVECTOR_REAL_SIZE(state->n_inputs)) ||
+        buffer_can_read(&record, 1)) {
+        SEND_SW(dc, SW_INCORRECT_DATA);  // should never happen, as the hmac is correct
+        return false;
+    }
+
+    state->has_internal_segwit_inputs = (flags & AMEND_RECORD_FLAG_SEGWIT_INPUTS) != 0;
+    state->has_internal_segwit_v1_inputs = (flags & AMEND_RECORD_FLAG_SEGWIT_V1_INPUTS) != 0;
+    state->has_nondefault_sighash = (flags & AMEND_RECORD_FLAG_NONDEFAULT) != 0;
+    return true;
+}
+
+#ifdef HAVE_UNATTENDED_SIGNING
+
+// Gets the spending policy of SIGN_PSBT_MODE_UNATTENDED from the client, followed by its hmac, as
+// the preimage of policy_ref; verifies its hmac and that it is for the wallet policy of the psbt.
+// Returns false (after sending the status word) on error.
+static bool load_spending_policy(dispatcher_context_t *dc, const uint8_t policy_ref[static 32]) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    uint8_t preimage[SPENDING_POLICY_LEN + 32];
+    int preimage_len = call_get_preimage(dc, policy_ref, preimage, sizeof(preimage));
+    if (preimage_len != sizeof(preimage)) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return false;
+    }
+
+    cx_hash_sha256(preimage, SPENDING_POLICY_LEN, state->spending_policy_id, 32);
+    if (!check_spending_policy_hmac(state->spending_policy_id, preimage + SPENDING_POLICY_LEN)) {
+        PRINTF("Incorrect hmac of the spending policy\n");
+        SEND_SW(dc, SW_SIGNATURE_FAIL);
+        return false;
+    }
+
+    buffer_t policy = buffer_create(preimage, SPENDING_POLICY_LEN);
+    if (!spending_policy_parse(&policy, &state->spending_policy)) {
+        SEND_SW(dc, SW_INCORRECT_DATA);  // should never happen, as the hmac is correct
+        return false;
+    }
+
+    if (memcmp(state->spending_policy.wallet_id, state->wallet_id, 32) != 0) {
+        PRINTF("The spending policy is for a different wallet policy\n");
+        SEND_SW(dc, SW_DENY);
+        return false;
+    }
+    return true;
+}
+
+#endif
+
+#ifdef HAVE_SIGN_PSBT_CHECKPOINT
+
+/*
+  Checkpoint of the signing flow of the last SIGN_PSBT, saved after the user approved the
+  transaction. If the command is interrupted (for example, if the connection with the client is
+  lost), a SIGN_PSBT for the same psbt and wallet policy in SIGN_PSBT_MODE_RESUME restarts signing from
+  the first input whose signatures were not yielded yet, without verifying the inputs and the
+  outputs, and without user interaction, as that was already done for the very same transaction.
+
+  It contains the parts of sign_psbt_state_t that are computed before signing and are not
+  recomputed by handler_sign_psbt; the checkpoint is only kept in RAM, and it is wiped when the
+  device is locked, when the app exits, and once all the inputs are signed.
+*/
+typedef struct {
+    bool used;
+    uint8_t command_id[32];
+
+    // the input to sign next, and its position in the signing order
+    unsigned int next_input_index;
+    unsigned int sign_order_pos;
+    uint8_t visited_inputs[BITVECTOR_REAL_SIZE(MAX_N_INPUTS_CAN_SIGN)];
+
+    uint32_t tx_version;
+    uint32_t locktime;
+
+    uint8_t internal_inputs[BITVECTOR_REAL_SIZE(MAX_N_INPUTS_CAN_SIGN)];
+    uint8_t input_wallets[SIGN_PSBT_WALLET_INDEX_BITS][BITVECTOR_REAL_SIZE(MAX_N_INPUTS_CAN_SIGN)];
+    bool has_internal_segwit_inputs;
+
+    uint8_t inputs_with_sequence[BITVECTOR_REAL_SIZE(MAX_N_INPUTS_CAN_SIGN)];
+    bool has_inputs_with_sequence;
+
+    struct {
+        uint8_t sha_prevouts[32];
+        uint8_t sha_amounts[32];
+        uint8_t sha_scriptpubkeys[32];
+        uint8_t sha_sequences[32];
+        uint8_t sha_outputs[32];
+    } hashes;
+
+    cx_sha256_t segwit_v0_prefix;
+
+    struct {
+        cx_sha256_t context;
+        unsigned int n_inputs;
+    } legacy_prefix;
+
+    // the internal keys of the active wallet policy
+    unsigned int cur_wallet;
+    unsigned int n_our_keys;
+    internal_key_derivation_t our_keys[MAX_POLICY_MAP_INTERNAL_KEYS];
+} sign_psbt_checkpoint_t;
+
+static sign_psbt_checkpoint_t G_sign_psbt_checkpoint;
+
+void sign_psbt_checkpoint_reset(void) {
+    explicit_bzero(&G_sign_psbt_checkpoint, sizeof(G_sign_psbt_checkpoint));
+}
+
+// saves the checkpoint before signing the current input
+static void sign_psbt_checkpoint_save(const sign_psbt_state_t *state) {
+    sign_psbt_checkpoint_t *ck = &G_sign_psbt_checkpoint;
+
+    ck->used = true;
+    memcpy(ck->command_id, state->command_id, sizeof(ck->command_id));
+    ck->next_input_index = state->cur_input_index;
+    ck->sign_order_pos = state->sign_order_pos;
+    memcpy(ck->visited_inputs, state->visited_inputs, sizeof(ck->visited_inputs));
+    ck->tx_version = state->tx_version;
+    ck->locktime = state->locktime;
+    memcpy(ck->internal_inputs, state->internal_inputs, sizeof(ck->internal_inputs));
+    memcpy(ck->input_wallets, state->input_wallets, sizeof(ck->input_wallets));
+    ck->has_internal_segwit_inputs = state->has_internal_segwit_inputs;
+    memcpy(ck->inputs_with_sequence,
+           state->inputs_with_sequence,
+           sizeof(ck->inputs_with_sequence));
+    ck->has_inputs_with_sequence = state->has_inputs_with_sequence;
+    memcpy(&ck->hashes, &state->hashes, sizeof(ck->hashes));
+    crypto_sha256_snapshot(&state->segwit_v0_prefix, &ck->segwit_v0_prefix);
+    crypto_sha256_snapshot(&state->legacy_prefix.context, &ck->legacy_prefix.context);
+    ck->legacy_prefix.n_inputs = state->legacy_prefix.n_inputs;
+    ck->cur_wallet = state->cur_wallet;
+    ck->n_our_keys = state->n_our_keys;
+    memcpy(ck->our_keys, state->our_keys, sizeof(ck->our_keys));
+}
+
+// restores the signing state from the checkpoint; returns false if there is no checkpoint for the
+// same command
+static bool sign_psbt_checkpoint_restore(sign_psbt_state_t *state) {
+    const sign_psbt_checkpoint_t *ck = &G_sign_psbt_checkpoint;
+
+    if (!ck->used || memcmp(ck->command_id, state->command_id, sizeof(ck->command_id)) != 0) {
+        return false;
+    }
+
+    state->cur_input_index = ck->next_input_index;
+    if (state->has_input_order) {
+        // the order and the range are bound to the command_id
+        state->sign_order_pos = ck->sign_order_pos;
+        memcpy(state->visited_inputs, ck->visited_inputs, sizeof(state->visited_inputs));
+    } else {
+        // the range might differ from the one of the interrupted command
+        if (state->cur_input_index < state->sign_range_start) {
+            state->cur_input_index = state->sign_range_start;
+        }
+        state->sign_order_pos = state->cur_input_index < state->sign_range_end
+                                    ? state->cur_input_index - state->sign_range_start
+                                    : state->sign_range_end - state->sign_range_start;
+    }
+    state->tx_version = ck->tx_version;
+    state->locktime = ck->locktime;
+    memcpy(state->internal_inputs, ck->internal_inputs, sizeof(state->internal_inputs));
+    memcpy(state->input_wallets, ck->input_wallets, sizeof(state->input_wallets));
+    state->has_internal_segwit_inputs = ck->has_internal_segwit_inputs;
+    memcpy(state->inputs_with_sequence,
+           ck->inputs_with_sequence,
+           sizeof(state->inputs_with_sequence));
+    state->has_inputs_with_sequence = ck->has_inputs_with_sequence;
+    memcpy(&state->hashes, &ck->hashes, sizeof(state->hashes));
+    crypto_sha256_restore(&state->segwit_v0_prefix, &ck->segwit_v0_prefix);
+    crypto_sha256_restore(&state->legacy_prefix.context, &ck->legacy_prefix.context);
+    state->legacy_prefix.n_inputs = ck->legacy_prefix.n_inputs;
+    state->cur_wallet = ck->cur_wallet;
+    state->n_our_keys = ck->n_our_keys;
+    memcpy(state->our_keys, ck->our_keys, sizeof(state->our_keys));
+    return true;
+}
+
+#endif
+
+// Records the index of the wallet policy of an internal input.
+static void set_input_wallet(sign_psbt_state_t *state,
+                             unsigned int input_index,
+                             unsigned int wallet_index) {
+    for (int i = 0; i < SIGN_PSBT_WALLET_INDEX_BITS; i++) {
+        bitvector_set(state->input_wallets[i], input_index, (wallet_index >> i) & 1);
+    }
+}
+
+// Returns the index of the wallet policy of an internal input.
+static unsigned int get_input_wallet(const sign_psbt_state_t *state, unsigned int input_index) {
+    unsigned int wallet_index = 0;
+    for (int i = 0; i < SIGN_PSBT_WALLET_INDEX_BITS; i++) {
+        wallet_index |= (unsigned int) bitvector_get(state->input_wallets[i], input_index) << i;
+    }
+    return wallet_index;
+}
+
+// Makes the wallet policy at wallet_index the active one, parsing it in wallet_policy_map. Returns
+// false if the policy can not be parsed, which should never happen once it was loaded.
+static bool activate_wallet_policy(sign_psbt_state_t *state, unsigned int wallet_index) {
+    sign_psbt_wallet_t *wallet = &state->wallets[wallet_index];
+
+    buffer_t policy_map_buffer =
+        buffer_create(state->policy_maps + wallet->policy_map_offset, wallet->policy_map_len);
+    if (parse_policy_map(&policy_map_buffer,
+                         state->wallet_policy_map_bytes,
+                         sizeof(state->wallet_policy_map_bytes)) < 0) {
+        return false;
+    }
+
+    memcpy(state->wallet_header_keys_info_merkle_root,
+           wallet->keys_info_merkle_root,
+           sizeof(wallet->keys_info_merkle_root));
+    state->wallet_header_n_keys = wallet->n_keys;
+
+    state->is_wallet_canonical = wallet->is_canonical;
+    if (wallet->is_canonical) {
+        state->address_type = get_policy_address_type(&state->wallet_policy_map);
+        state->bip44_purpose = get_bip44_purpose(state->address_type);
+    }
+
+    state->cur_wallet = wallet_index;
+    return true;
+}
+
+// Loads the wallet policy with the given id and hmac at wallet_index, and makes it the active one.
+// A registered wallet policy must have a valid hmac, unless it is found in the cache or in the
+// store of verified wallets; a wallet policy without hmac must be a standard one. Returns false
+// on error, after sending the status word.
+static bool load_wallet_policy(dispatcher_context_t *dc,
+                               unsigned int wallet_index,
+                               uint8_t wallet_id[static 32],
+                               uint8_t wallet_hmac[static 32]) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    sign_psbt_wallet_t *wallet = &state->wallets[wallet_index];
+    policy_map_wallet_header_t *wallet_header = &state->wallet_header;
+
+    // A registered wallet that was already verified in this session is found in the cache, and
+    // one that was kept at registration in the store of the device, whose hmac is still verified
+    const policy_map_wallet_header_t *cached_header = wallet_cache_get(wallet_id, wallet_hmac);
+    const policy_map_wallet_header_t *stored_header =
+        cached_header == NULL ? wallet_store_get(wallet_id, wallet_hmac) : NULL;
+    if (cached_header != NULL || stored_header != NULL) {
+        memcpy(wallet_header,
+               cached_header != NULL ? cached_header : stored_header,
+               sizeof(*wallet_header));
+    } else {
+        // Fetch the serialized wallet policy from the client, parsing it while it is received
+        if (call_stream_wallet_policy(dc, wallet_id, wallet_header) < 0) {
             SEND_SW(dc, SW_INCORRECT_DATA);
-            return -1;
+            return false;
         }
+    }
+
+    // only the descriptor template is kept after the header, in the shared buffer
+    if (wallet_header->policy_map_len > sizeof(state->policy_maps) - state->policy_maps_len) {
+        PRINTF("The descriptor templates of the wallet policies are too long\n");
+        SEND_SW(dc, SW_NOT_SUPPORTED);
+        return false;
+    }
+    wallet->policy_map_offset = (uint16_t) state->policy_maps_len;
+    wallet->policy_map_len = wallet_header->policy_map_len;
+    memcpy(state->policy_maps + state->policy_maps_len,
+           wallet_header->policy_map,
+           wallet_header->policy_map_len);
+    state->policy_maps_len += wallet_header->policy_map_len;
+
+    memcpy(wallet->name, wallet_header->name, sizeof(wallet->name));
+    wallet->n_keys = wallet_header->n_keys;
+    memcpy(wallet->keys_info_merkle_root,
+           wallet_header->keys_info_merkle_root,
+           sizeof(wallet->keys_info_merkle_root));
+
+    uint8_t hmac_or =
+        0;  // the binary OR of all the hmac bytes (so == 0 iff the hmac is identically 0)
+    for (int i = 0; i < 32; i++) {
+        hmac_or = hmac_or | wallet_hmac[i];
+    }
 
-        crypto_hash_update(hash_context, amount_raw, 8);
+    wallet->is_canonical = hmac_or == 0;
+    wallet->has_key_origins_filter = false;
 
-        // get output's scriptPubKey
+    if (!activate_wallet_policy(state, wallet_index)) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return false;
+    }
 
-        uint8_t out_script[MAX_PREVOUT_SCRIPTPUBKEY_LEN];
-        int out_script_len = call_get_merkleized_map_value(dc,
-                                                           &ith_map,
-                                                           (uint8_t[]){PSBT_OUT_SCRIPT},
-                                                           1,
-                                                           out_script,
-                                                           sizeof(out_script));
-        if (out_script_len == -1) {
+    wallet->script_type = get_policy_script_type(&state->wallet_policy_map);
+
+    if (wallet->is_canonical) {
+        // No hmac, verify that the policy is a canonical one that is allowed by default
+
+        if (state->wallet_header_n_keys != 1) {
+            PRINTF("Non-standard policy, it should only have 1 key\n");
             SEND_SW(dc, SW_INCORRECT_DATA);
-            return -1;
+            return false;
+        }
+
+        if (state->address_type == -1) {
+            PRINTF("Non-standard policy, and no hmac provided\n");
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return false;
+        }
+
+        // The bip44 purpose expected for this canonical wallet is based on the address type
+        if (state->bip44_purpose < 0) {
+            SEND_SW(dc, SW_BAD_STATE);
+            return false;
+        }
+
+        // We do not check here that the purpose field, coin_type and account (first three step of
+        // the bip44 derivation) are standard. Will check at signing time that the path is valid.
+    } else if (cached_header == NULL) {
+        // Verify hmac (already verified for cached wallets)
+        if (!check_wallet_hmac(wallet_id, wallet_hmac)) {
+            PRINTF("Incorrect hmac\n");
+            SEND_SW(dc, SW_SIGNATURE_FAIL);
+            return false;
         }
 
-        crypto_hash_update_varint(hash_context, out_script_len);
-        crypto_hash_update(hash_context, out_script, out_script_len);
+        wallet_cache_add(wallet_id, wallet_hmac, wallet_header);
     }
-    return 0;
+    return true;
 }
 
-static int get_segwit_version(const uint8_t scriptPubKey[], int scriptPubKey_len) {
-    if (scriptPubKey_len <= 1) {
-        return -1;
+static const policy_node_tree_t *get_wallet_taptree(const sign_psbt_state_t *state) {
+    if (state->wallet_policy_map.type != TOKEN_TR) {
+        return NULL;
     }
+    return ((const policy_node_tr_t *) &state->wallet_policy_map)->tree;
+}
 
-    if (scriptPubKey[0] == 0x00) {
-        return 0;
-    } else if (scriptPubKey[0] >= 0x51 && scriptPubKey[0] <= 0x60) {
-        return scriptPubKey[0] - 0x50;
+// Initializes the hashes of the taproot tree of the active wallet policy kept while signing.
+static void init_taptree_hashes(sign_psbt_state_t *state) {
+    if (get_wallet_taptree(state) != NULL) {
+        // the tag prefix of the TapLeaf hashes of the tapscripts is only absorbed once
+        crypto_tr_tagged_hash_init(&state->tapleaf_midstate, BIP0341_tapleaf_tag_hash);
+        memset(state->taptree_hashes, 0, sizeof(state->taptree_hashes));
+        state->taptree_hashes_next_slot = 0;
     }
-
-    return -1;
 }
 
 /**
  * Validates the input, initializes the hash context and starts accumulating the wallet header in
  * it.
  */
+// Checks each key of the global map: the keys of the fields of the transaction and of the version
+// of the psbt have no key data.
+static void global_keys_callback(bool *has_invalid_key, buffer_t *data) {
+    size_t data_len = data->size - data->offset;
+    uint8_t key_type;
+    if (!buffer_read_u8(data, &key_type)) {
+        *has_invalid_key = true;
+        return;
+    }
+    switch (key_type) {
+        case PSBT_GLOBAL_UNSIGNED_TX:
+        case PSBT_GLOBAL_TX_VERSION:
+        case PSBT_GLOBAL_FALLBACK_LOCKTIME:
+        case PSBT_GLOBAL_INPUT_COUNT:
+        case PSBT_GLOBAL_OUTPUT_COUNT:
+        case PSBT_GLOBAL_TX_MODIFIABLE:
+        case PSBT_GLOBAL_VERSION:
+            if (data_len != 1) {
+                *has_invalid_key = true;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Returns true if the value of a PSBT_GLOBAL_INPUT_COUNT or PSBT_GLOBAL_OUTPUT_COUNT field is
+// missing, or is a varint equal to count.
+static bool is_global_count_valid(const merkleized_map_field_t *field, uint64_t count) {
+    if (field->value_len < 0) {
+        return true;
+    }
+    uint64_t value;
+    return varint_read(field->out, (size_t) field->value_len, &value) == field->value_len &&
+           value == count;
+}
+
+// Pre-screen of the global map, before any work on the inputs: a single sweep of its keys checks
+// that they are sorted and valid, and finds the fields of the transaction, whose values are then
+// fetched together. The input and output counts of the psbt must be the ones of the command.
+// Returns false on error, after sending the status word.
+static bool read_global_map(dispatcher_context_t *dc) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    uint8_t tx_version[4], locktime[4], input_count[9], output_count[9];
+    merkleized_map_field_t fields[] = {
+        make_merkleized_map_field((uint8_t[]){PSBT_GLOBAL_TX_VERSION},
+                                  1,
+                                  tx_version,
+                                  sizeof(tx_version)),
+        make_merkleized_map_field((uint8_t[]){PSBT_GLOBAL_FALLBACK_LOCKTIME},
+                                  1,
+                                  locktime,
+                                  sizeof(locktime)),
+        make_merkleized_map_field((uint8_t[]){PSBT_GLOBAL_INPUT_COUNT},
+                                  1,
+                                  input_count,
+                                  sizeof(input_count)),
+        make_merkleized_map_field((uint8_t[]){PSBT_GLOBAL_OUTPUT_COUNT},
+                                  1,
+                                  output_count,
+                                  sizeof(output_count)),
+    };
+
+    bool has_invalid_key = false;
+    if (call_get_merkleized_map_commitment_fields(
+            dc,
+            &state->global_map,
+            make_callback(&has_invalid_key, (dispatcher_callback_t) global_keys_callback),
+            fields,
+            sizeof(fields) / sizeof(fields[0])) < 0 ||
+        has_invalid_key) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return false;
+    }
+
+    if (fields[0].value_len != 4 || (fields[1].value_len != -1 && fields[1].value_len != 4)) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return false;
+    }
+    state->tx_version = read_u32_le(tx_version, 0);
+
+    // Unlike BIP-0370 recommendation, we use the fallback locktime as-is, ignoring each input's
+    // preferred height/block locktime. If that's relevant, the client must set the fallback
+    // locktime to the appropriate value before calling sign_psbt.
+    state->locktime = fields[1].value_len == 4 ? read_u32_le(locktime, 0) : 0;
+
+    if (!is_global_count_valid(&fields[2], state->n_inputs) ||
+        !is_global_count_valid(&fields[3], state->n_outputs)) {
+        PRINTF("The input or output count of the psbt does not match the command\n");
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return false;
+    }
+
+    return true;
+}
+
 void handler_sign_psbt(dispatcher_context_t *dc) {
     sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
 
@@ -208,7 +859,6 @@ void handler_sign_psbt(dispatcher_context_t *dc) {
         return;
     }
     if (n_inputs > MAX_N_INPUTS_CAN_SIGN) {
-        // TODO: remove this limitation
         PRINTF("At most %d inputs are supported\n", MAX_N_INPUTS_CAN_SIGN);
         SEND_SW(dc, SW_NOT_SUPPORTED);
         return;
@@ -221,14 +871,13 @@ void handler_sign_psbt(dispatcher_context_t *dc) {
         SEND_SW(dc, SW_WRONG_DATA_LENGTH);
         return;
     }
-    state->n_outputs = (unsigned int) n_outputs;
-
-    if (n_outputs > MAX_N_OUTPUTS_CAN_SIGN) {
-        // could remove this limitation; paranoia more than anything else
-        PRINTF("At most %d outputs are supported\n", MAX_N_OUTPUTS_CAN_SIGN);
-        SEND_SW(dc, SW_NOT_SUPPORTED);
+    if (n_outputs > UINT32_MAX) {
+        // the outputs are processed one at a time, so any number of them fits in the limits of a
+        // transaction, but not more than can be counted
+        SEND_SW(dc, SW_INCORRECT_DATA);
         return;
     }
+    state->n_outputs = (unsigned int) n_outputs;
 
     uint8_t wallet_id[32];
     uint8_t wallet_hmac[32];
@@ -238,115 +887,264 @@ void handler_sign_psbt(dispatcher_context_t *dc) {
         return;
     }
 
-    // Fetch the serialized wallet policy from the client
-    uint8_t serialized_wallet_policy[MAX_POLICY_MAP_SERIALIZED_LENGTH];
-    int serialized_wallet_policy_len = call_get_preimage(dc,
-                                                         wallet_id,
-                                                         serialized_wallet_policy,
-                                                         sizeof(serialized_wallet_policy));
-    if (serialized_wallet_policy_len < 0) {
+#ifdef HAVE_SIGN_PSBT_CHECKPOINT
+    cx_hash_sha256(dc->read_buffer.ptr,
+                   dc->read_buffer.offset,
+                   state->command_id,
+                   sizeof(state->command_id));
+#endif
+
+    memcpy(state->wallet_id, wallet_id, sizeof(state->wallet_id));
+
+    // optional mode, to resume signing from the checkpoint of an interrupted SIGN_PSBT, to only
+    // verify the psbt, to sign a proof of funds, to sign a fee bump of an approved psbt, or to sign
+    // a psbt that matches a spending policy
+    uint8_t mode = SIGN_PSBT_MODE_SIGN;
+    if (buffer_can_read(&dc->read_buffer, 1)) {
+        buffer_read_u8(&dc->read_buffer, &mode);
+    }
+    state->coalesce_yields = (mode & SIGN_PSBT_MODE_FLAG_COALESCE_YIELDS) != 0;
+    state->yield_amend_record = (mode & SIGN_PSBT_MODE_FLAG_AMEND_RECORD) != 0;
+    bool is_multi_wallet = (mode & SIGN_PSBT_MODE_FLAG_MULTI_WALLET) != 0;
+    state->has_input_order = (mode & SIGN_PSBT_MODE_FLAG_INPUT_ORDER) != 0;
+    state->yield_progress = (mode & SIGN_PSBT_MODE_FLAG_PROGRESS) != 0;
+    mode &= ~(SIGN_PSBT_MODE_FLAG_COALESCE_YIELDS | SIGN_PSBT_MODE_FLAG_AMEND_RECORD |
+              SIGN_PSBT_MODE_FLAG_MULTI_WALLET | SIGN_PSBT_MODE_FLAG_INPUT_ORDER |
+              SIGN_PSBT_MODE_FLAG_PROGRESS);
+    // a spending policy is bound to a single wallet policy, like the amend record
+    if (mode > SIGN_PSBT_MODE_UNATTENDED ||
+        (state->yield_amend_record && mode != SIGN_PSBT_MODE_SIGN &&
+         mode != SIGN_PSBT_MODE_AMEND) ||
+        (is_multi_wallet && (state->yield_amend_record || mode == SIGN_PSBT_MODE_AMEND ||
+                             mode == SIGN_PSBT_MODE_UNATTENDED))) {
         SEND_SW(dc, SW_INCORRECT_DATA);
         return;
     }
-
-    policy_map_wallet_header_t wallet_header;
-    buffer_t serialized_wallet_policy_buf =
-        buffer_create(serialized_wallet_policy, serialized_wallet_policy_len);
-    if ((read_policy_map_wallet(&serialized_wallet_policy_buf, &wallet_header)) < 0) {
-        SEND_SW(dc, SW_INCORRECT_DATA);
+#ifndef HAVE_UNATTENDED_SIGNING
+    if (mode == SIGN_PSBT_MODE_UNATTENDED) {
+        SEND_SW(dc, SW_NOT_SUPPORTED);
+        return;
+    }
+#endif
+    state->is_check_only = mode == SIGN_PSBT_MODE_CHECK;
+    state->is_bip322_proof = mode == SIGN_PSBT_MODE_PROOF;
+    state->is_amend = mode == SIGN_PSBT_MODE_AMEND;
+    state->is_summary = mode == SIGN_PSBT_MODE_SUMMARY;
+    state->is_unattended = mode == SIGN_PSBT_MODE_UNATTENDED;
+
+    if (state->is_bip322_proof &&
+        !buffer_read_bytes(&dc->read_buffer, state->bip322_message_hash, 32)) {
+        SEND_SW(dc, SW_WRONG_DATA_LENGTH);
         return;
     }
 
-    memcpy(state->wallet_header_keys_info_merkle_root,
-           wallet_header.keys_info_merkle_root,
-           sizeof(wallet_header.keys_info_merkle_root));
-    state->wallet_header_n_keys = wallet_header.n_keys;
+    // SIGN_PSBT_MODE_AMEND: the sha256 of the amend record, and its hmac
+    uint8_t amend_record_id[32];
+    uint8_t amend_record_hmac[32];
+    if (state->is_amend && (!buffer_read_bytes(&dc->read_buffer, amend_record_id, 32) ||
+                            !buffer_read_bytes(&dc->read_buffer, amend_record_hmac, 32))) {
+        SEND_SW(dc, SW_WRONG_DATA_LENGTH);
+        return;
+    }
 
-    buffer_t policy_map_buffer =
-        buffer_create(&wallet_header.policy_map, wallet_header.policy_map_len);
+#ifdef HAVE_UNATTENDED_SIGNING
+    // SIGN_PSBT_MODE_UNATTENDED: the sha256 of the spending policy followed by its hmac, that fits
+    // in the apdu unlike both its id and its hmac
+    uint8_t spending_policy_ref[32];
+    if (state->is_unattended &&
+        !buffer_read_bytes(&dc->read_buffer, spending_policy_ref, 32)) {
+        SEND_SW(dc, SW_WRONG_DATA_LENGTH);
+        return;
+    }
+#endif
+
+    // SIGN_PSBT_MODE_FLAG_MULTI_WALLET: the number of additional wallet policies, followed by the
+    // wallet_id and the wallet_hmac of each of them
+    state->n_wallets = 1;
+    uint8_t extra_wallets[MAX_SIGN_PSBT_WALLETS - 1][32 + 32];
+    if (is_multi_wallet) {
+        uint8_t n_extra_wallets;
+        if (!buffer_read_u8(&dc->read_buffer, &n_extra_wallets)) {
+            SEND_SW(dc, SW_WRONG_DATA_LENGTH);
+            return;
+        }
+        if (n_extra_wallets == 0) {
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
+        if (n_extra_wallets > MAX_SIGN_PSBT_WALLETS - 1) {
+            PRINTF("At most %d wallet policies are supported\n", MAX_SIGN_PSBT_WALLETS);
+            SEND_SW(dc, SW_NOT_SUPPORTED);
+            return;
+        }
+        for (unsigned int i = 0; i < n_extra_wallets; i++) {
+            if (!buffer_read_bytes(&dc->read_buffer, extra_wallets[i], sizeof(extra_wallets[i]))) {
+                SEND_SW(dc, SW_WRONG_DATA_LENGTH);
+                return;
+            }
+        }
+        state->n_wallets = 1 + n_extra_wallets;
+
+#ifdef HAVE_SIGN_PSBT_CHECKPOINT
+        // the checkpoint is also bound to the additional wallet policies
+        uint8_t command_data[32 + 32];
+        memcpy(command_data, state->command_id, 32);
+        cx_hash_sha256(extra_wallets[0],
+                       n_extra_wallets * sizeof(extra_wallets[0]),
+                       command_data + 32,
+                       32);
+        cx_hash_sha256(command_data, sizeof(command_data), state->command_id, 32);
+#endif
+    }
 
-    if (parse_policy_map(&policy_map_buffer,
-                         state->wallet_policy_map_bytes,
-                         sizeof(state->wallet_policy_map_bytes)) < 0) {
-        SEND_SW(dc, SW_INCORRECT_DATA);
+    // SIGN_PSBT_MODE_FLAG_INPUT_ORDER: the root of the list of the inputs in the signing order
+    if (state->has_input_order &&
+        !buffer_read_bytes(&dc->read_buffer, state->input_order_root, 32)) {
+        SEND_SW(dc, SW_WRONG_DATA_LENGTH);
         return;
     }
 
-    uint8_t hmac_or =
-        0;  // the binary OR of all the hmac bytes (so == 0 iff the hmac is identically 0)
-    for (int i = 0; i < 32; i++) {
-        hmac_or = hmac_or | wallet_hmac[i];
+    if (state->yield_amend_record && state->n_inputs > SIGN_PSBT_AMEND_MAX_N_INPUTS) {
+        PRINTF("At most %d inputs are supported for amend records\n", SIGN_PSBT_AMEND_MAX_N_INPUTS);
+        SEND_SW(dc, SW_NOT_SUPPORTED);
+        return;
     }
-    if (hmac_or == 0) {
-        // No hmac, verify that the policy is a canonical one that is allowed by default
 
-        if (state->wallet_header_n_keys != 1) {
-            PRINTF("Non-standard policy, it should only have 1 key\n");
-            SEND_SW(dc, SW_INCORRECT_DATA);
+    // optional range of the inputs to sign; by default, all of them
+    state->sign_range_start = 0;
+    state->sign_range_end = state->n_inputs;
+    if (buffer_can_read(&dc->read_buffer, 1)) {
+        uint64_t range_start, range_end;
+        if (!buffer_read_varint(&dc->read_buffer, &range_start) ||
+            !buffer_read_varint(&dc->read_buffer, &range_end)) {
+            SEND_SW(dc, SW_WRONG_DATA_LENGTH);
             return;
         }
-
-        state->address_type = get_policy_address_type(&state->wallet_policy_map);
-        if (state->address_type == -1) {
-            PRINTF("Non-standard policy, and no hmac provided\n");
+        if (range_start > range_end || range_end > n_inputs ||
+            buffer_can_read(&dc->read_buffer, 1)) {
             SEND_SW(dc, SW_INCORRECT_DATA);
             return;
         }
+        state->sign_range_start = (unsigned int) range_start;
+        state->sign_range_end = (unsigned int) range_end;
+    }
 
-        state->is_wallet_canonical = true;
-
-        // Based on the address type, we set the expected bip44 purpose for this canonical wallet
-        state->bip44_purpose = get_bip44_purpose(state->address_type);
-        if (state->bip44_purpose < 0) {
-            SEND_SW(dc, SW_BAD_STATE);
+#ifdef HAVE_SIGN_PSBT_CHECKPOINT
+    if (state->has_input_order) {
+        // the checkpoint is also bound to the signing order, that is only valid for its range
+        uint8_t command_data[32 + 32 + 4 + 4];
+        memcpy(command_data, state->command_id, 32);
+        memcpy(command_data + 32, state->input_order_root, 32);
+        write_u32_le(command_data, 64, state->sign_range_start);
+        write_u32_le(command_data, 68, state->sign_range_end);
+        cx_hash_sha256(command_data, sizeof(command_data), state->command_id, 32);
+    }
+#endif
+
+    // Load and verify the wallet policies, from the last one: the first one is left active
+    state->policy_maps_len = 0;
+    for (unsigned int i = state->n_wallets; i-- > 0;) {
+        uint8_t *id = i == 0 ? wallet_id : extra_wallets[i - 1];
+        uint8_t *hmac = i == 0 ? wallet_hmac : extra_wallets[i - 1] + 32;
+        if (!load_wallet_policy(dc, i, id, hmac)) {
             return;
         }
+    }
 
-        // We do not check here that the purpose field, coin_type and account (first three step of
-        // the bip44 derivation) are standard. Will check at signing time that the path is valid.
-    } else {
-        // Verify hmac
-
-        if (!check_wallet_hmac(wallet_id, wallet_hmac)) {
-            PRINTF("Incorrect hmac\n");
-            SEND_SW(dc, SW_SIGNATURE_FAIL);
+#if SIGN_PSBT_INPUT_RECORDS > 0
+    // records are only filled by the verification of the inputs, that a resumed signing skips
+    state->n_input_records = 0;
+#endif
+#if SIGN_PSBT_INPUT_PATHS > 0
+    state->n_input_paths = 0;
+#endif
+
+#ifdef HAVE_SIGN_PSBT_CHECKPOINT
+    if (mode == SIGN_PSBT_MODE_RESUME && sign_psbt_checkpoint_restore(state)) {
+        // the psbt was already verified, and the transaction approved by the user
+        PRINTF("Resuming from input %d\n", state->cur_input_index);
+        // the internal keys of the checkpoint are the ones of its active wallet policy
+        if (!activate_wallet_policy(state, state->cur_wallet)) {
+            SEND_SW(dc, SW_BAD_STATE);
             return;
         }
-
-        state->is_wallet_canonical = false;
+        init_taptree_hashes(state);
+        state->yield_buffer_len = 0;
+        dc_next(dc, sign_process_input_map);
+        return;
     }
+#endif
 
-    state->inputs_total_value = 0;
-    state->internal_inputs_total_value = 0;
+    memset(&state->totals, 0, sizeof(state->totals));
     memset(state->internal_inputs, 0, sizeof state->internal_inputs);
+    state->n_internal_inputs = 0;
+    memset(state->input_wallets, 0, sizeof state->input_wallets);
+    // the amend record does not have the sequences, that are then looked up when signing
+    memset(state->inputs_with_sequence, 0, sizeof state->inputs_with_sequence);
+    state->has_inputs_with_sequence = false;
+    state->has_internal_segwit_inputs = false;
+    state->has_internal_segwit_v1_inputs = false;
+    state->has_nondefault_sighash = false;
 
     state->master_key_fingerprint = crypto_get_master_key_fingerprint();
 
-    // Check integrity of the global map
-    if (call_check_merkle_tree_sorted(dc,
-                                      state->global_map.keys_root,
-                                      (size_t) state->global_map.size) < 0) {
-        SEND_SW(dc, SW_INCORRECT_DATA);
+    // Check integrity of the global map, and read its fields
+    if (!read_global_map(dc)) {
+        return;
+    }
+
+    if (state->is_amend && !load_amend_record(dc, amend_record_id, amend_record_hmac)) {
+        return;
+    }
+
+#ifdef HAVE_UNATTENDED_SIGNING
+    if (state->is_unattended && !load_spending_policy(dc, spending_policy_ref)) {
         return;
     }
+#endif
 
-    if (state->is_wallet_canonical) {
-        // Canonical wallet, we start processing the psbt directly
-        dc->next(process_global_map);
+    if (state->is_check_only || state->is_amend || state->is_unattended) {
+        // Nothing will be signed, or the user already authorized the wallet for the inputs of the
+        // amend record or of the spending policy: we start processing the psbt directly
+        dc_next(dc, process_global_map);
     } else {
-        // Show screen to authorize spend from a registered wallet
-        dc->pause();
-        ui_authorize_wallet_spend(dc, wallet_header.name, ui_action_validate_wallet_authorized);
+        state->n_authorized_wallets = 0;
+        dc_next(dc, authorize_wallets);
+    }
+}
+
+// Shows a screen to authorize spend from each registered wallet; canonical wallets do not need it.
+static void authorize_wallets(dispatcher_context_t *dc) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    while (state->n_authorized_wallets < state->n_wallets &&
+           state->wallets[state->n_authorized_wallets].is_canonical) {
+        ++state->n_authorized_wallets;
+    }
+
+    if (state->n_authorized_wallets == state->n_wallets) {
+        dc_next(dc, process_global_map);
+        return;
     }
+
+    dc->pause();
+    ui_authorize_wallet_spend(dc,
+                              state->wallets[state->n_authorized_wallets].name,
+                              ui_action_validate_wallet_authorized);
 }
 
 static void ui_action_validate_wallet_authorized(dispatcher_context_t *dc, bool accept) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
     if (!accept) {
         SEND_SW(dc, SW_DENY);
     } else {
-        dc->next(process_global_map);
+        ++state->n_authorized_wallets;
+        dc_next(dc, authorize_wallets);
     }
 
     dc->run();
@@ -357,45 +1155,30 @@ static void process_global_map(dispatcher_context_t *dc) {
 
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
-    uint8_t raw_result[9];  // max size for a varint
-    int result_len;
-
-    // Read tx version
-    result_len = call_get_merkleized_map_value(dc,
-                                               &state->global_map,
-                                               (uint8_t[]){PSBT_GLOBAL_TX_VERSION},
-                                               1,
-                                               raw_result,
-                                               sizeof(raw_result));
-    if (result_len != 4) {
+    // the fields of the global map were read by the handler
+
+    if (state->is_bip322_proof && (state->tx_version != 0 || state->locktime != 0)) {
+        PRINTF("The to_sign transaction of a proof must have version 0 and locktime 0\n");
         SEND_SW(dc, SW_INCORRECT_DATA);
         return;
     }
-    state->tx_version = read_u32_le(raw_result, 0);
 
-    // Read fallback locktime.
-    // Unlike BIP-0370 recommendation, we use the fallback locktime as-is, ignoring each input's
-    // preferred height/block locktime. If that's relevant, the client must set the fallback
-    // locktime to the appropriate value before calling sign_psbt.
-    result_len = call_get_merkleized_map_value(dc,
-                                               &state->global_map,
-                                               (uint8_t[]){PSBT_GLOBAL_FALLBACK_LOCKTIME},
-                                               1,
-                                               raw_result,
-                                               sizeof(raw_result));
-    if (result_len == -1) {
-        state->locktime = 0;
-    } else if (result_len != 4) {
-        SEND_SW(dc, SW_INCORRECT_DATA);
+    if (state->is_amend) {
+        // the inputs were verified when the amend record was produced
+        dc_next(dc, verify_outputs_init);
         return;
-    } else {
-        state->locktime = read_u32_le(raw_result, 0);
     }
 
-    // we alredy know n_inputs and n_outputs, so we skip reading from the global map
+    cx_sha256_init(&state->sha_prevouts_context);
+    cx_sha256_init(&state->sha_amounts_context);
+    cx_sha256_init(&state->sha_scriptpubkeys_context);
+    cx_sha256_init(&state->sha_sequences_context);
+
+    memset(state->parent_utxo_hash, 0, sizeof(state->parent_utxo_hash));
+    state->n_parent_vouts = 0;
 
     state->cur_input_index = 0;
-    dc->next(process_input_map);
+    dc_next(dc, process_input_map);
 }
 
 /** Inputs verification flow
@@ -406,15 +1189,198 @@ static void process_global_map(dispatcher_context_t *dc) {
  *  - detect internal inputs that should be signed, and external inputs that shouldn't
  */
 
+// Clears the state of the current input, before its map is fetched.
+static void reset_cur_input(sign_psbt_state_t *state) {
+    memset(&state->cur_input, 0, sizeof(state->cur_input));
+
+    state->cur_input.output_index_key_index = -1;
+    state->cur_input.sequence_key_index = -1;
+    state->cur_input.previous_txid_key_index = -1;
+    state->cur_input.redeem_script_key_index = -1;
+    state->cur_input.witness_script_key_index = -1;
+    state->cur_input.bip32_derivation_key_index = -1;
+}
+
+#if SIGN_PSBT_INPUT_RECORDS > 0
+
+// Starts the record of the current input in the slot after the last record, with the fields of its
+// map that its sighash commits to; the record is only kept by save_input_record, once the input is
+// found to be internal.
+static void start_input_record(sign_psbt_state_t *state,
+                               const uint8_t prevout_hash[static 32],
+                               const uint8_t prevout_n_raw[static 4],
+                               const uint8_t nSequence_raw[static 4]) {
+    if (state->n_input_records >= SIGN_PSBT_INPUT_RECORDS) {
+        return;
+    }
+
+    sign_psbt_input_record_t *record = &state->input_records[state->n_input_records];
+    record->input_index = state->cur_input_index;
+    record->amount = state->cur_input.prevout_amount;
+    memcpy(record->prevout_hash, prevout_hash, 32);
+    memcpy(record->prevout_n, prevout_n_raw, 4);
+    memcpy(record->sequence, nSequence_raw, 4);
+}
+
+// Keeps the record of the current internal input, if it can be signed from it alone. Returns true
+// if the record was kept.
+static bool save_input_record(sign_psbt_state_t *state, uint32_t change, uint32_t address_index) {
+    if (state->n_input_records >= SIGN_PSBT_INPUT_RECORDS) {
+        return false;
+    }
+
+    sign_psbt_input_record_t *record = &state->input_records[state->n_input_records];
+    const script_info_t *script_info = &state->cur_input.prevout_script_info;
+    if (script_info->type == SCRIPT_TYPE_P2TR &&
+        (state->cur_input.sighash_type & SIGHASH_ANYONECANPAY) == 0) {
+        record->segwit_version = 1;
+    } else if (script_info->type == SCRIPT_TYPE_P2WPKH && !state->cur_input.has_redeemScript) {
+        // with a redeemScript, signing fails as the scriptPubKey is not its P2SH; not recorded, so
+        // that it still does
+        record->segwit_version = 0;
+        memcpy(record->witness_program,
+               state->cur_input.prevout_scriptpubkey + script_info->program_offset,
+               sizeof(record->witness_program));
+    } else {
+        return false;
+    }
+
+    record->change = change;
+    record->address_index = address_index;
+    record->sighash_type = state->cur_input.sighash_type;
+    ++state->n_input_records;
+    return true;
+}
+
+static const sign_psbt_input_record_t *find_input_record(const sign_psbt_state_t *state,
+                                                         unsigned int input_index) {
+    for (unsigned int i = 0; i < state->n_input_records; i++) {
+        if (state->input_records[i].input_index == input_index) {
+            return &state->input_records[i];
+        }
+    }
+    return NULL;
+}
+
+#else
+
+static inline void start_input_record(sign_psbt_state_t *state,
+                                      const uint8_t prevout_hash[static 32],
+                                      const uint8_t prevout_n_raw[static 4],
+                                      const uint8_t nSequence_raw[static 4]) {
+    (void) state;
+    (void) prevout_hash;
+    (void) prevout_n_raw;
+    (void) nSequence_raw;
+}
+
+static inline bool save_input_record(sign_psbt_state_t *state,
+                                     uint32_t change,
+                                     uint32_t address_index) {
+    (void) state;
+    (void) change;
+    (void) address_index;
+    return false;
+}
+
+static inline const sign_psbt_input_record_t *find_input_record(const sign_psbt_state_t *state,
+                                                                unsigned int input_index) {
+    (void) state;
+    (void) input_index;
+    return NULL;
+}
+
+#endif
+
+#if SIGN_PSBT_INPUT_PATHS > 0
+
+// Keeps the change and address index of the current internal input, verified in check_input_owned.
+static void save_input_path(sign_psbt_state_t *state, uint32_t change, uint32_t address_index) {
+    if (state->n_input_paths >= SIGN_PSBT_INPUT_PATHS) {
+        return;
+    }
+
+    sign_psbt_input_path_t *path = &state->input_paths[state->n_input_paths++];
+    path->input_index = state->cur_input_index;
+    path->change = change;
+    path->address_index = address_index;
+}
+
+// The paths are saved by increasing input index, as the inputs are verified in order.
+static const sign_psbt_input_path_t *find_input_path(const sign_psbt_state_t *state,
+                                                     unsigned int input_index) {
+    unsigned int lo = 0, hi = state->n_input_paths;
+    while (lo < hi) {
+        unsigned int mid = lo + (hi - lo) / 2;
+        if (state->input_paths[mid].input_index < input_index) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < state->n_input_paths && state->input_paths[lo].input_index == input_index) {
+        return &state->input_paths[lo];
+    }
+    return NULL;
+}
+
+#else
+
+static inline void save_input_path(sign_psbt_state_t *state,
+                                   uint32_t change,
+                                   uint32_t address_index) {
+    (void) state;
+    (void) change;
+    (void) address_index;
+}
+
+static inline const sign_psbt_input_path_t *find_input_path(const sign_psbt_state_t *state,
+                                                            unsigned int input_index) {
+    (void) state;
+    (void) input_index;
+    return NULL;
+}
+
+#endif
+
+// Records the index of a single-byte key of the current input map, if its value is read when
+// signing.
+static void record_input_key_index(cur_input_info_t *input, uint8_t key_type, int key_index) {
+    switch (key_type) {
+        case PSBT_IN_OUTPUT_INDEX:
+            input->output_index_key_index = key_index;
+            break;
+        case PSBT_IN_SEQUENCE:
+            input->sequence_key_index = key_index;
+            break;
+        case PSBT_IN_PREVIOUS_TXID:
+            input->previous_txid_key_index = key_index;
+            break;
+        case PSBT_IN_REDEEM_SCRIPT:
+            input->redeem_script_key_index = key_index;
+            break;
+        case PSBT_IN_WITNESS_SCRIPT:
+            input->witness_script_key_index = key_index;
+            break;
+        default:
+            break;
+    }
+}
+
 /**
  * Callback to process all the keys of the current input map.
- * Keeps track if the current input has a witness_utxo and/or a redeemScript.
+ * Keeps track if the current input has a witness_utxo and/or a redeemScript, and records the
+ * indexes of the keys whose values are read when signing.
  */
 static void input_keys_callback(sign_psbt_state_t *state, buffer_t *data) {
     size_t data_len = data->size - data->offset;
+    int key_index = state->cur_input.next_key_index++;
     if (data_len >= 1) {
         uint8_t key_type;
         buffer_read_u8(data, &key_type);
+        if (data_len == 1) {
+            record_input_key_index(&state->cur_input, key_type, key_index);
+        }
         if (key_type == PSBT_IN_WITNESS_UTXO) {
             state->cur_input.has_witnessUtxo = true;
         } else if (key_type == PSBT_IN_NON_WITNESS_UTXO) {
@@ -429,6 +1395,7 @@ static void input_keys_callback(sign_psbt_state_t *state, buffer_t *data) {
             // use this to identify the change and address_index, it does not matter which of the
             // keys we use here (if there are multiple), as per the assumptions above.
             state->cur_input.has_bip32_derivation = true;
+            state->cur_input.bip32_derivation_key_index = key_index;
 
             if (!buffer_read_bytes(data,
                                    state->cur_input.bip32_derivation_pubkey,
@@ -441,6 +1408,8 @@ static void input_keys_callback(sign_psbt_state_t *state, buffer_t *data) {
                    !state->cur_input.has_bip32_derivation) {
             // See comment above
             state->cur_input.has_bip32_derivation = true;
+            state->cur_input.bip32_derivation_is_tap = true;
+            state->cur_input.bip32_derivation_key_index = key_index;
 
             if (!buffer_read_bytes(data,
                                    state->cur_input.bip32_derivation_pubkey,
@@ -453,26 +1422,221 @@ static void input_keys_callback(sign_psbt_state_t *state, buffer_t *data) {
     }
 }
 
+// Reads the value of a key of the current input map, given its index recorded by
+// input_keys_callback: the value is read from the Merkle tree of the values, without looking up the
+// key. Returns the length of the value, or a negative number on failure or if the key is not in the
+// map.
+static int get_cur_input_value(dispatcher_context_t *dc,
+                               const sign_psbt_state_t *state,
+                               int key_index,
+                               uint8_t *out,
+                               size_t out_len) {
+    if (key_index < 0) {
+        return -1;
+    }
+    return call_get_merkle_leaf_element(dc,
+                                        state->cur_input.map.values_root,
+                                        state->cur_input.map.size,
+                                        key_index,
+                                        out,
+                                        out_len);
+}
+
+// Reads the key origin in the value of the PSBT_IN_BIP32_DERIVATION (or, if is_tap is true, of the
+// PSBT_IN_TAP_BIP32_DERIVATION) key of bip32_derivation_pubkey in the current input map.
+// Returns the length of the BIP32 path on success, a negative number on failure.
+static int get_cur_input_fingerprint_and_path(
+    dispatcher_context_t *dc,
+    const sign_psbt_state_t *state,
+    bool is_tap,
+    uint32_t *out_fingerprint,
+    uint32_t out_bip32_path[static MAX_BIP32_PATH_STEPS]) {
+    if (state->cur_input.bip32_derivation_is_tap == is_tap) {
+        // the key was seen when the keys of the map were verified
+        int key_index = state->cur_input.bip32_derivation_key_index;
+        return is_tap ? get_tap_fingerprint_and_path_at_index(dc,
+                                                               &state->cur_input.map,
+                                                               key_index,
+                                                               out_fingerprint,
+                                                               out_bip32_path)
+                      : get_fingerprint_and_path_at_index(dc,
+                                                          &state->cur_input.map,
+                                                          key_index,
+                                                          out_fingerprint,
+                                                          out_bip32_path);
+    } else if (is_tap) {
+        uint8_t key[1 + 32];
+        key[0] = PSBT_IN_TAP_BIP32_DERIVATION;
+        memcpy(key + 1, state->cur_input.bip32_derivation_pubkey, 32);
+
+        return get_tap_fingerprint_and_path(dc,
+                                            &state->cur_input.map,
+                                            key,
+                                            sizeof(key),
+                                            out_fingerprint,
+                                            out_bip32_path);
+    } else {
+        uint8_t key[1 + 33];
+        key[0] = PSBT_IN_BIP32_DERIVATION;
+        memcpy(key + 1, state->cur_input.bip32_derivation_pubkey, 33);
+
+        return get_fingerprint_and_path(dc,
+                                        &state->cur_input.map,
+                                        key,
+                                        sizeof(key),
+                                        out_fingerprint,
+                                        out_bip32_path);
+    }
+}
+
+// Returns the output prevout_n of the non-witness utxo of the current input, whose value has the
+// leaf hash utxo_hash, or NULL on failure; the txid of the non-witness utxo is in parent_txid.
+// The outputs extracted from a non-witness utxo are kept for the next inputs. If the previous input
+// spent the same parent transaction, the maps of the next inputs are peeked, and the outputs spent
+// by the ones that share it are extracted in the same run of the parser: a parent spent by k
+// consecutive inputs is streamed about k / SIGN_PSBT_PARENT_VOUTS times, instead of k.
+static const txid_parser_vout_t *get_parent_vout(dispatcher_context_t *dc,
+                                                 sign_psbt_state_t *state,
+                                                 const uint8_t utxo_hash[static 32],
+                                                 uint32_t prevout_n) {
+    bool is_same_parent = memcmp(state->parent_utxo_hash, utxo_hash, 32) == 0;
+    if (is_same_parent) {
+        for (size_t i = 0; i < state->n_parent_vouts; i++) {
+            if (state->parent_vouts[i].index == prevout_n) {
+                return &state->parent_vouts[i];
+            }
+        }
+    }
+
+    state->parent_vouts[0].index = prevout_n;
+    state->n_parent_vouts = 1;
+
+    // only peek when the parent is already known to be shared, so that psbts whose inputs spend
+    // different transactions do not pay for it
+    for (unsigned int j = state->cur_input_index + 1;
+         is_same_parent && j < state->n_inputs && state->n_parent_vouts < SIGN_PSBT_PARENT_VOUTS;
+         j++) {
+        uint8_t next_utxo_hash[32];
+        uint8_t next_prevout_n_raw[4];
+        merkleized_map_field_t fields[] = {
+            make_merkleized_map_field_hash((uint8_t[]){PSBT_IN_NON_WITNESS_UTXO},
+                                           1,
+                                           next_utxo_hash),
+            make_merkleized_map_field((uint8_t[]){PSBT_IN_OUTPUT_INDEX},
+                                      1,
+                                      next_prevout_n_raw,
+                                      sizeof(next_prevout_n_raw)),
+        };
+        merkleized_map_commitment_t next_map;
+        if (call_get_merkleized_map_with_fields(dc,
+                                                state->inputs_root,
+                                                state->n_inputs,
+                                                j,
+                                                make_callback(NULL, NULL),
+                                                fields,
+                                                sizeof(fields) / sizeof(fields[0]),
+                                                &next_map) < 0) {
+            return NULL;
+        }
+        if (fields[0].value_len != 32 || fields[1].value_len != 4 ||
+            memcmp(next_utxo_hash, utxo_hash, 32) != 0) {
+            break;  // the run of inputs spending the parent ends here
+        }
+
+        uint32_t next_prevout_n = read_u32_le(next_prevout_n_raw, 0);
+        bool is_requested = false;
+        for (size_t i = 0; i < state->n_parent_vouts; i++) {
+            is_requested = is_requested || state->parent_vouts[i].index == next_prevout_n;
+        }
+        if (!is_requested) {
+            state->parent_vouts[state->n_parent_vouts++].index = next_prevout_n;
+        }
+    }
+
+    memset(state->parent_utxo_hash, 0, sizeof(state->parent_utxo_hash));
+    if (call_psbt_parse_rawtx_vouts(dc,
+                                    utxo_hash,
+                                    state->parent_vouts,
+                                    state->n_parent_vouts,
+                                    state->parent_txid) < 0) {
+        state->n_parent_vouts = 0;
+        return NULL;
+    }
+    memcpy(state->parent_utxo_hash, utxo_hash, 32);
+    return &state->parent_vouts[0];
+}
+
 static void process_input_map(dispatcher_context_t *dc) {
     sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
 
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
+    if (!yield_progress(dc, SIGN_PSBT_PHASE_INPUTS, state->cur_input_index, state->n_inputs)) {
+        SEND_SW(dc, SW_BAD_STATE);
+        return;
+    }
+
     if (state->cur_input_index >= state->n_inputs) {
-        // all inputs already processed
-        dc->next(alert_external_inputs);
+        // all inputs already processed; the tx-wide hashes of the inputs are now complete
+        crypto_hash_digest(&state->sha_prevouts_context.header, state->hashes.sha_prevouts, 32);
+        crypto_hash_digest(&state->sha_amounts_context.header, state->hashes.sha_amounts, 32);
+        crypto_hash_digest(&state->sha_scriptpubkeys_context.header,
+                           state->hashes.sha_scriptpubkeys,
+                           32);
+        crypto_hash_digest(&state->sha_sequences_context.header, state->hashes.sha_sequences, 32);
+        state->has_inputs_with_sequence = true;
+
+        dc_next(dc, alert_external_inputs);
         return;
     }
 
     // Reset cur_input struct
-    memset(&state->cur_input, 0, sizeof(state->cur_input));
-
-    int res = call_get_merkleized_map_with_callback(
+    reset_cur_input(state);
+
+    // Fetch all the fields we need in the same sweep that checks the keys of the map; for the
+    // utxos, only the hash of their value: the non-witness utxo is streamed to the parser, and the
+    // witness utxo is not needed if the input also has a non-witness utxo
+    uint8_t prevout_n_raw[4];
+    uint8_t prevout_hash[32];
+    uint8_t non_witness_utxo_hash[32];
+    uint8_t witness_utxo_hash[32];
+    uint8_t nSequence_raw[4];
+    uint8_t sighash_type_raw[4];
+    merkleized_map_field_t fields[] = {
+        make_merkleized_map_field((uint8_t[]){PSBT_IN_OUTPUT_INDEX},
+                                  1,
+                                  prevout_n_raw,
+                                  sizeof(prevout_n_raw)),
+        make_merkleized_map_field((uint8_t[]){PSBT_IN_PREVIOUS_TXID},
+                                  1,
+                                  prevout_hash,
+                                  sizeof(prevout_hash)),
+        make_merkleized_map_field_hash((uint8_t[]){PSBT_IN_NON_WITNESS_UTXO},
+                                       1,
+                                       non_witness_utxo_hash),
+        make_merkleized_map_field_hash((uint8_t[]){PSBT_IN_WITNESS_UTXO}, 1, witness_utxo_hash),
+        make_merkleized_map_field((uint8_t[]){PSBT_IN_SEQUENCE},
+                                  1,
+                                  nSequence_raw,
+                                  sizeof(nSequence_raw)),
+        make_merkleized_map_field((uint8_t[]){PSBT_IN_SIGHASH_TYPE},
+                                  1,
+                                  sighash_type_raw,
+                                  sizeof(sighash_type_raw)),
+    };
+    const merkleized_map_field_t *prevout_n_field = &fields[0];
+    const merkleized_map_field_t *prevout_hash_field = &fields[1];
+    const merkleized_map_field_t *sequence_field = &fields[4];
+    const merkleized_map_field_t *sighash_type_field = &fields[5];
+
+    int res = call_get_merkleized_map_with_fields(
         dc,
         state->inputs_root,
         state->n_inputs,
         state->cur_input_index,
         make_callback(state, (dispatcher_callback_t) input_keys_callback),
+        fields,
+        sizeof(fields) / sizeof(fields[0]),
         &state->cur_input.map);
     if (res < 0) {
         SEND_SW(dc, SW_INCORRECT_DATA);
@@ -486,14 +1650,26 @@ static void process_input_map(dispatcher_context_t *dc) {
     }
 
     // Read the prevout index
-    uint32_t prevout_n;
-    if (4 != call_get_merkleized_map_value_u32_le(dc,
-                                                  &state->cur_input.map,
-                                                  (uint8_t[]){PSBT_IN_OUTPUT_INDEX},
-                                                  1,
-                                                  &prevout_n)) {
+    if (prevout_n_field->value_len != 4) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
+    }
+    uint32_t prevout_n = read_u32_le(prevout_n_raw, 0);
+
+    if (prevout_hash_field->value_len != 32) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
+    }
+
+    // the sighash type is only validated for the internal inputs, in check_input_owned
+    if (!state->cur_input.has_sighash_type) {
+        state->cur_input.sighash_type = SIGHASH_ALL;
+    } else if (sighash_type_field->value_len != 4) {
+        PRINTF("Malformed PSBT_IN_SIGHASH_TYPE for input %d\n", state->cur_input_index);
         SEND_SW(dc, SW_INCORRECT_DATA);
         return;
+    } else {
+        state->cur_input.sighash_type = read_u32_le(sighash_type_raw, 0);
     }
 
     // either witness utxo or non-witness utxo (or both) must be present.
@@ -506,67 +1682,66 @@ static void process_input_map(dispatcher_context_t *dc) {
     // validate non-witness utxo (if present) and witness utxo (if present)
 
     if (state->cur_input.has_nonWitnessUtxo) {
-        txid_parser_outputs_t parser_outputs;
-        // request non-witness utxo, and get the prevout's value and scriptpubkey
-        res = call_psbt_parse_rawtx(dc,
-                                    &state->cur_input.map,
-                                    (uint8_t[]){PSBT_IN_NON_WITNESS_UTXO},
-                                    1,
-                                    prevout_n,
-                                    &parser_outputs);
-        if (res < 0) {
+        // get the prevout's value and scriptpubkey from the non-witness utxo, unless they were
+        // already extracted when it was parsed for a previous input
+        const txid_parser_vout_t *vout =
+            get_parent_vout(dc, state, non_witness_utxo_hash, prevout_n);
+        if (vout == NULL) {
             SEND_SW(dc, SW_INCORRECT_DATA);
             return;
         }
 
-        uint8_t prevout_hash[32];
-
         // check if the prevout_hash of the transaction matches the computed one from the
         // non-witness utxo
-        res = call_get_merkleized_map_value(dc,
-                                            &state->cur_input.map,
-                                            (uint8_t[]){PSBT_IN_PREVIOUS_TXID},
-                                            1,
-                                            prevout_hash,
-                                            sizeof(prevout_hash));
-
-        if (res == -1 || memcmp(parser_outputs.txid, prevout_hash, 32) != 0) {
+        if (memcmp(state->parent_txid, prevout_hash, 32) != 0) {
             PRINTF("Prevout hash did not match non-witness-utxo transaction hash\n");
 
             SEND_SW(dc, SW_INCORRECT_DATA);
             return;
         }
 
-        uint64_t prevout_value = parser_outputs.vout_value;
-
-        state->inputs_total_value += prevout_value;
+        state->cur_input.prevout_amount = vout->value;
 
-        state->cur_input.prevout_amount = prevout_value;
-
-        state->cur_input.prevout_scriptpubkey_len = parser_outputs.vout_scriptpubkey_len;
-
-        if (state->cur_input.prevout_scriptpubkey_len > MAX_PREVOUT_SCRIPTPUBKEY_LEN) {
-            PRINTF("Prevout's scriptPubKey too long: %d bytes.\n",
-                   state->cur_input.prevout_scriptpubkey_len);
+        if (vout->scriptpubkey_len > MAX_PREVOUT_SCRIPTPUBKEY_LEN) {
+            PRINTF("Prevout's scriptPubKey too long: %d bytes.\n", (int) vout->scriptpubkey_len);
             SEND_SW(dc, SW_INCORRECT_DATA);
             return;
         }
 
+        state->cur_input.prevout_scriptpubkey_len = vout->scriptpubkey_len;
+
         memcpy(state->cur_input.prevout_scriptpubkey,
-               parser_outputs.vout_scriptpubkey,
+               vout->scriptpubkey,
                state->cur_input.prevout_scriptpubkey_len);
     }
 
-    if (state->cur_input.has_witnessUtxo) {
-        uint8_t raw_witnessUtxo[8 + 1 + MAX_PREVOUT_SCRIPTPUBKEY_LEN];
+    if (state->cur_input.has_witnessUtxo && state->cur_input.has_nonWitnessUtxo) {
+        // we already know the amount and the scriptPubKey, but we double check that the witness
+        // utxo matches them, by comparing the hash of their serialization with the one of its value
+        uint8_t expected_witnessUtxo[8 + 1 + MAX_PREVOUT_SCRIPTPUBKEY_LEN];
+        write_u64_le(expected_witnessUtxo, 0, state->cur_input.prevout_amount);
+        expected_witnessUtxo[8] = (uint8_t) state->cur_input.prevout_scriptpubkey_len;
+        memcpy(expected_witnessUtxo + 9,
+               state->cur_input.prevout_scriptpubkey,
+               state->cur_input.prevout_scriptpubkey_len);
 
-        int wit_utxo_len = call_get_merkleized_map_value(dc,
-                                                         &state->cur_input.map,
-                                                         (uint8_t[]){PSBT_IN_WITNESS_UTXO},
-                                                         1,
-                                                         raw_witnessUtxo,
-                                                         sizeof(raw_witnessUtxo));
-        if (wit_utxo_len < 0) {
+        uint8_t expected_hash[32];
+        merkle_compute_element_hash(expected_witnessUtxo,
+                                    9 + state->cur_input.prevout_scriptpubkey_len,
+                                    expected_hash);
+        if (memcmp(expected_hash, witness_utxo_hash, 32) != 0) {
+            PRINTF("scriptPubKey or amount in non-witness utxo doesn't match with witness utxo\n");
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
+    } else if (state->cur_input.has_witnessUtxo) {
+        // we extract the scriptPubKey and prevout amount from the witness utxo
+        uint8_t raw_witnessUtxo[8 + 1 + MAX_PREVOUT_SCRIPTPUBKEY_LEN];
+        int wit_utxo_len = call_get_trusted_merkle_leaf_element(dc,
+                                                                witness_utxo_hash,
+                                                                raw_witnessUtxo,
+                                                                sizeof(raw_witnessUtxo));
+        if (wit_utxo_len < 9) {
             PRINTF("Error fetching witness utxo\n");
             SEND_SW(dc, SW_INCORRECT_DATA);
             return;
@@ -580,97 +1755,190 @@ static void process_input_map(dispatcher_context_t *dc) {
             return;
         }
 
-        uint8_t *wit_utxo_scriptPubkey = raw_witnessUtxo + 9;
+        state->cur_input.prevout_amount = read_u64_le(raw_witnessUtxo, 0);
+        state->cur_input.prevout_scriptpubkey_len = wit_utxo_scriptPubkey_len;
+        memcpy(state->cur_input.prevout_scriptpubkey,
+               raw_witnessUtxo + 9,
+               wit_utxo_scriptPubkey_len);
+    }
 
-        uint64_t wit_utxo_prevout_amount = read_u64_le(&raw_witnessUtxo[0], 0);
+    classify_script(state->cur_input.prevout_scriptpubkey,
+                    state->cur_input.prevout_scriptpubkey_len,
+                    &state->cur_input.prevout_script_info);
 
-        if (state->cur_input.has_nonWitnessUtxo) {
-            // we already know the scriptPubKey, but we double check that it matches
-            if (state->cur_input.prevout_scriptpubkey_len != wit_utxo_scriptPubkey_len ||
-                memcmp(state->cur_input.prevout_scriptpubkey,
-                       wit_utxo_scriptPubkey,
-                       wit_utxo_scriptPubkey_len) != 0 ||
-                state->cur_input.prevout_amount != wit_utxo_prevout_amount) {
-                PRINTF(
-                    "scriptPubKey or amount in non-witness utxo doesn't match with witness utxo\n");
-                SEND_SW(dc, SW_INCORRECT_DATA);
-            }
-        } else {
-            // we extract the scriptPubKey and prevout amount from the witness utxo
-            state->inputs_total_value += wit_utxo_prevout_amount;
+    if (!add_to_total(&state->totals.inputs, state->cur_input.prevout_amount)) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
+    }
 
-            state->cur_input.prevout_amount = wit_utxo_prevout_amount;
-            state->cur_input.prevout_scriptpubkey_len = wit_utxo_scriptPubkey_len;
-            memcpy(state->cur_input.prevout_scriptpubkey,
-                   wit_utxo_scriptPubkey,
-                   wit_utxo_scriptPubkey_len);
+    if (state->is_bip322_proof && state->cur_input_index == 0) {
+        // the first input of a proof spends the to_spend transaction of the message
+        uint8_t to_spend_txid[32];
+        compute_bip322_to_spend_txid(state->bip322_message_hash,
+                                     state->cur_input.prevout_scriptpubkey,
+                                     state->cur_input.prevout_scriptpubkey_len,
+                                     to_spend_txid);
+        if (prevout_n != 0 || state->cur_input.prevout_amount != 0 ||
+            memcmp(prevout_hash, to_spend_txid, 32) != 0) {
+            PRINTF("The first input of a proof must spend the to_spend transaction\n");
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
         }
     }
 
-    dc->next(check_input_owned);
-}
-
-static void check_input_owned(dispatcher_context_t *dc) {
-    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
-
-    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+    // absorb this input in the tx-wide hashes
+    crypto_hash_update(&state->sha_prevouts_context.header, prevout_hash, 32);
+    crypto_hash_update(&state->sha_prevouts_context.header, prevout_n_raw, 4);
 
-    int script_type = get_script_type(state->cur_input.prevout_scriptpubkey,
-                                      state->cur_input.prevout_scriptpubkey_len);
+    uint8_t amount_raw[8];
+    write_u64_le(amount_raw, 0, state->cur_input.prevout_amount);
+    crypto_hash_update(&state->sha_amounts_context.header, amount_raw, 8);
 
-    bool external = false;
+    crypto_hash_update_varint(&state->sha_scriptpubkeys_context.header,
+                              state->cur_input.prevout_scriptpubkey_len);
+    crypto_hash_update(&state->sha_scriptpubkeys_context.header,
+                       state->cur_input.prevout_scriptpubkey,
+                       state->cur_input.prevout_scriptpubkey_len);
 
-    do {
-        if (!state->cur_input.has_bip32_derivation) {
-            external = true;
-            break;
-        }
+    if (sequence_field->value_len != 4) {
+        // if no PSBT_IN_SEQUENCE is present, we must assume nSequence 0xFFFFFFFF
+        memset(nSequence_raw, 0xFF, 4);
+    } else {
+        bitvector_set(state->inputs_with_sequence, state->cur_input_index, 1);
+    }
+    crypto_hash_update(&state->sha_sequences_context.header, nSequence_raw, 4);
 
-        // get path, obtain change and address_index,
+    start_input_record(state, prevout_hash, prevout_n_raw, nSequence_raw);
 
-        int bip32_path_len;
-        uint32_t bip32_path[MAX_BIP32_PATH_STEPS];
-        uint32_t fingerprint;
+    dc_next(dc, check_input_owned);
+}
 
-        if (script_type == -1) {
-            external = true;  // unknown script, definitely external
-            break;
-        } else if (script_type == SCRIPT_TYPE_P2TR) {
-            // taproot input, use PSBT_IN_TAP_BIP32_DERIVATION
-            uint8_t key[1 + 32];
-            key[0] = PSBT_IN_TAP_BIP32_DERIVATION;
-            memcpy(key + 1, state->cur_input.bip32_derivation_pubkey, 32);
-
-            bip32_path_len = get_emptyhashes_fingerprint_and_path(dc,
-                                                                  &state->cur_input.map,
-                                                                  key,
-                                                                  sizeof(key),
-                                                                  &fingerprint,
-                                                                  bip32_path);
-        } else {
-            // legacy or segwitv0 input, use PSBT_IN_BIP32_DERIVATION
-            uint8_t key[1 + 33];
-            key[0] = PSBT_IN_BIP32_DERIVATION;
-            memcpy(key + 1, state->cur_input.bip32_derivation_pubkey, 33);
+// All the scripts of a wallet policy have the same type; a script of a different type can be
+// classified as external without fetching its key derivation and deriving the wallet's script.
+static bool is_wallet_script_type(const sign_psbt_wallet_t *wallet, int script_type) {
+    return wallet->script_type == -1 || script_type == wallet->script_type;
+}
 
-            bip32_path_len = get_fingerprint_and_path(dc,
-                                                      &state->cur_input.map,
-                                                      key,
-                                                      sizeof(key),
-                                                      &fingerprint,
-                                                      bip32_path);
+static bool is_any_wallet_script_type(const sign_psbt_state_t *state, int script_type) {
+    for (unsigned int i = 0; i < state->n_wallets; i++) {
+        if (is_wallet_script_type(&state->wallets[i], script_type)) {
+            return true;
         }
+    }
+    return false;
+}
 
-        if (bip32_path_len < 0) {
+// Computes the filter of the key origins of all the keys of the active wallet policy. Returns
+// false on error, after sending the status word.
+static bool compute_key_origins_filter(dispatcher_context_t *dc, sign_psbt_state_t *state) {
+    key_origin_filter_t filter = 0;
+    for (unsigned int i = 0; i < state->wallet_header_n_keys; i++) {
+        policy_map_key_info_t key_info;
+        if (get_policy_key_info(dc,
+                                state->wallet_header_keys_info_merkle_root,
+                                state->wallet_header_n_keys,
+                                i,
+                                &key_info) < 0) {
             SEND_SW(dc, SW_INCORRECT_DATA);
-            return;
+            return false;
         }
 
-        // As per wallet policy assumptions, the path must have change and address index
-        if (bip32_path_len < 2) {
-            external = true;
+        // for canonical wallets, the only key is fetched once: if it is ours, the scripts of both
+        // changes are computed from our own account node
+        if (state->is_wallet_canonical &&
+            is_policy_key_internal(&key_info,
+                                   state->master_key_fingerprint,
+                                   G_coin_config->bip32_pubkey_version)) {
+            for (uint32_t change = 0; change <= 1; change++) {
+                if (!cache_internal_policy_key(state->wallet_header_keys_info_merkle_root,
+                                               state->wallet_header_n_keys,
+                                               i,
+                                               &key_info,
+                                               change,
+                                               G_coin_config->bip32_pubkey_version)) {
+                    SEND_SW(dc, SW_BAD_STATE);
+                    return false;
+                }
+            }
+        }
+
+        if (!key_info.has_key_origin) {
+            // the derivations of this key can have any fingerprint and path
+            filter = KEY_ORIGIN_FILTER_ANY;
             break;
         }
+        filter |= key_origin_filter_bit(read_u32_le(key_info.master_key_fingerprint, 0),
+                                        key_info.master_key_derivation,
+                                        key_info.master_key_derivation_len);
+    }
+
+    state->wallets[state->cur_wallet].key_origins_filter = filter;
+    state->wallets[state->cur_wallet].has_key_origins_filter = true;
+    return true;
+}
+
+// Cheap stages of the classification of the bip32 derivation of an input or output, that run
+// before deriving the script of the wallet at its path, which is the only expensive stage; they
+// rule out most of the derivations of the keys of other wallets (for example, the foreign inputs
+// of a coinjoin) without any EC operation:
+// 1. the path must end with /change/address_index, with change 0 or 1 and a non-hardened
+//    address_index, like all the derivations of the keys of a wallet policy;
+// 2. the fingerprint and the rest of the path must be the key origin of a key of the wallet.
+// A derivation that passes them might still be foreign, as the filter of stage 2 has false
+// positives. Returns 1 if the derivation might be of the wallet, 0 if it is definitely not, -1 on
+// error (after sending the status word).
+static int is_wallet_derivation_candidate(dispatcher_context_t *dc,
+                                          sign_psbt_state_t *state,
+                                          uint32_t fingerprint,
+                                          const uint32_t bip32_path[],
+                                          int bip32_path_len) {
+    uint32_t change = bip32_path[bip32_path_len - 2];
+    uint32_t address_index = bip32_path[bip32_path_len - 1];
+    if (change > 1 || address_index >= BIP32_FIRST_HARDENED_CHILD) {
+        return 0;
+    }
+
+    // the filter is only computed if there is at least a derivation to classify
+    const sign_psbt_wallet_t *wallet = &state->wallets[state->cur_wallet];
+    if (!wallet->has_key_origins_filter && !compute_key_origins_filter(dc, state)) {
+        return -1;
+    }
+    if (!key_origin_filter_may_contain(wallet->key_origins_filter,
+                                       fingerprint,
+                                       bip32_path,
+                                       bip32_path_len - 2)) {
+        return 0;
+    }
+    return 1;
+}
+
+// Looks for the wallet policy of the psbt whose script at the bip32 derivation (fingerprint,
+// bip32_path) of a key is scriptpubkey, starting from the active one; the wallet policy found is
+// left active. For canonical wallets, the path must also be standard, with the given change (or
+// any change if it is -1). Returns 1 if it is found, 0 if the script is external, -1 on error
+// (after sending the status word).
+static int find_wallet_of_script(dispatcher_context_t *dc,
+                                 sign_psbt_state_t *state,
+                                 int script_type,
+                                 uint32_t fingerprint,
+                                 const uint32_t bip32_path[],
+                                 int bip32_path_len,
+                                 int change_step,
+                                 uint8_t scriptpubkey[],
+                                 size_t scriptpubkey_len) {
+    uint32_t change = bip32_path[bip32_path_len - 2];
+    uint32_t address_index = bip32_path[bip32_path_len - 1];
+
+    unsigned int first_wallet = state->cur_wallet;
+    for (unsigned int i = 0; i < state->n_wallets; i++) {
+        unsigned int wallet_index = (first_wallet + i) % state->n_wallets;
+        if (!is_wallet_script_type(&state->wallets[wallet_index], script_type)) {
+            continue;
+        }
+        if (wallet_index != state->cur_wallet && !activate_wallet_policy(state, wallet_index)) {
+            SEND_SW(dc, SW_BAD_STATE);  // should never happen
+            return -1;
+        }
 
         if (state->is_wallet_canonical) {
             // check if path is as expected
@@ -681,14 +1949,18 @@ static void check_input_owned(dispatcher_context_t *dc) {
                                           state->bip44_purpose,
                                           coin_types,
                                           2,
-                                          -1)) {
-                external = true;
-                break;
+                                          change_step)) {
+                continue;
             }
         }
 
-        uint32_t change = bip32_path[bip32_path_len - 2];
-        uint32_t address_index = bip32_path[bip32_path_len - 1];
+        int is_candidate =
+            is_wallet_derivation_candidate(dc, state, fingerprint, bip32_path, bip32_path_len);
+        if (is_candidate < 0) {
+            return -1;
+        } else if (is_candidate == 0) {
+            continue;
+        }
 
         int res = compare_wallet_script_at_path(dc,
                                                 change,
@@ -696,30 +1968,94 @@ static void check_input_owned(dispatcher_context_t *dc) {
                                                 &state->wallet_policy_map,
                                                 state->wallet_header_keys_info_merkle_root,
                                                 state->wallet_header_n_keys,
-                                                state->cur_input.prevout_scriptpubkey,
-                                                state->cur_input.prevout_scriptpubkey_len);
+                                                scriptpubkey,
+                                                scriptpubkey_len);
         if (res < 0) {
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return -1;
+        } else if (res == 1) {
+            return 1;
+        } else if (res != 0) {
+            SEND_SW(dc, SW_BAD_STATE);  // should never happen
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void check_input_owned(dispatcher_context_t *dc) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    int script_type = state->cur_input.prevout_script_info.type;
+
+    bool external = false;
+    uint32_t change = 0, address_index = 0;
+
+    do {
+        if (!state->cur_input.has_bip32_derivation) {
+            external = true;
+            break;
+        }
+
+        // get path, obtain change and address_index,
+
+        int bip32_path_len;
+        uint32_t bip32_path[MAX_BIP32_PATH_STEPS];
+        uint32_t fingerprint;
+
+        if (script_type == -1 || !is_any_wallet_script_type(state, script_type)) {
+            external = true;  // unknown script, or not a script of a wallet: definitely external
+            break;
+        }
+
+        // taproot inputs use PSBT_IN_TAP_BIP32_DERIVATION, legacy and segwitv0 inputs use
+        // PSBT_IN_BIP32_DERIVATION
+        bip32_path_len = get_cur_input_fingerprint_and_path(dc,
+                                                            state,
+                                                            script_type == SCRIPT_TYPE_P2TR,
+                                                            &fingerprint,
+                                                            bip32_path);
+
+        if (bip32_path_len < 0) {
             SEND_SW(dc, SW_INCORRECT_DATA);
             return;
-        } else if (res == 0) {
+        }
+
+        // As per wallet policy assumptions, the path must have change and address index
+        if (bip32_path_len < 2) {
             external = true;
             break;
-        } else if (res == 1) {
-            // input is internal, nothing to do
-        } else {
-            SEND_SW(dc, SW_BAD_STATE);  // should never happen
+        }
+        change = bip32_path[bip32_path_len - 2];
+        address_index = bip32_path[bip32_path_len - 1];
+
+        int res = find_wallet_of_script(dc,
+                                        state,
+                                        script_type,
+                                        fingerprint,
+                                        bip32_path,
+                                        bip32_path_len,
+                                        -1,
+                                        state->cur_input.prevout_scriptpubkey,
+                                        state->cur_input.prevout_scriptpubkey_len);
+        if (res < 0) {
             return;
         }
+        external = res == 0;
     } while (false);  // executed only once; in a block only to be able to break out of it
 
     if (external) {
         PRINTF("INPUT %d is external\n", state->cur_input_index);
     } else {
-        state->internal_inputs[state->cur_input_index] = 1;
-        state->internal_inputs_total_value += state->cur_input.prevout_amount;
+        bitvector_set(state->internal_inputs, state->cur_input_index, 1);
+        set_input_wallet(state, state->cur_input_index, state->cur_wallet);
+        ++state->n_internal_inputs;
+        // never overflows, as the internal inputs are a subset of the inputs
+        add_to_total(&state->totals.internal_inputs, state->cur_input.prevout_amount);
 
-        int segwit_version = get_segwit_version(state->cur_input.prevout_scriptpubkey,
-                                                state->cur_input.prevout_scriptpubkey_len);
+        int segwit_version = state->cur_input.prevout_script_info.segwit_version;
 
         // For legacy or segwit-v0 inputs, the non-witness utxo must be present
         if ((segwit_version == -1 || segwit_version == 0) && !state->cur_input.has_nonWitnessUtxo) {
@@ -734,10 +2070,50 @@ static void check_input_owned(dispatcher_context_t *dc) {
             SEND_SW(dc, SW_INCORRECT_DATA);
             return;
         }
+
+        // Internal inputs are signed as segwit iff they have a witness utxo
+        if (state->cur_input.has_witnessUtxo) {
+            state->has_internal_segwit_inputs = true;
+        }
+        if (segwit_version == 1) {
+            state->has_internal_segwit_v1_inputs = true;
+        }
+
+        uint32_t sighash_type = state->cur_input.sighash_type;
+        if (!is_sighash_type_valid(sighash_type, segwit_version == 1)) {
+            PRINTF("Unsupported sighash type for input %d\n", state->cur_input_index);
+            SEND_SW(dc, SW_NOT_SUPPORTED);
+            return;
+        }
+
+        // A proof is a valid transaction spending the real UTXOs: a signature that does not commit
+        // to all the inputs and outputs could be reused to spend them in a different one
+        if (state->is_bip322_proof && sighash_type != SIGHASH_ALL &&
+            sighash_type != SIGHASH_DEFAULT) {
+            PRINTF("Only SIGHASH_ALL is allowed in proofs, for input %d\n", state->cur_input_index);
+            SEND_SW(dc, SW_NOT_SUPPORTED);
+            return;
+        }
+
+        // SIGHASH_SINGLE commits to the output with the same index as the input, that must exist
+        // (legacy transactions would sign the constant 1 instead, which is never safe)
+        if ((sighash_type & 3) == SIGHASH_SINGLE && state->cur_input_index >= state->n_outputs) {
+            PRINTF("No output for SIGHASH_SINGLE for input %d\n", state->cur_input_index);
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
+
+        if (sighash_type != SIGHASH_ALL && sighash_type != SIGHASH_DEFAULT) {
+            state->has_nondefault_sighash = true;
+        }
+
+        if (!save_input_record(state, change, address_index)) {
+            save_input_path(state, change, address_index);
+        }
     }
 
     ++state->cur_input_index;
-    dc->next(process_input_map);
+    dc_next(dc, process_input_map);
 }
 
 // If there are external inputs, it is unsafe to sign, therefore we warn the user
@@ -746,21 +2122,26 @@ static void alert_external_inputs(dispatcher_context_t *dc) {
 
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
-    size_t count_external_inputs = 0;
-    for (unsigned int i = 0; i < state->n_inputs; i++) {
-        if (!state->internal_inputs[i]) {
-            ++count_external_inputs;
-        }
-    }
+    size_t count_external_inputs = state->n_inputs - state->n_internal_inputs;
 
     if (count_external_inputs == 0) {
         // no external inputs
-        dc->next(verify_outputs_init);
+        dc_next(dc, alert_nondefault_sighash);
     } else if (count_external_inputs == state->n_inputs) {
         // no internal inputs, nothing to sign
         PRINTF("No internal inputs. Aborting\n");
         SEND_SW(dc, SW_INCORRECT_DATA);
         return;
+    } else if (state->is_check_only) {
+        // the user would be warned, but nothing is signed
+        dc_next(dc, alert_nondefault_sighash);
+    } else if (state->is_bip322_proof) {
+        // the to_sign transaction of a proof can not be mined, as it spends the to_spend one
+        dc_next(dc, alert_nondefault_sighash);
+    } else if (state->is_unattended) {
+        // the user can not be warned
+        PRINTF("External inputs are not allowed in unattended signing\n");
+        SEND_SW(dc, SW_DENY);
     } else {
         // some internal and some external inputs, warn the user first
         dc->pause();
@@ -774,7 +2155,39 @@ static void ui_alert_external_inputs_result(dispatcher_context_t *dc, bool accep
     if (!accept) {
         SEND_SW(dc, SW_DENY);
     } else {
-        dc->next(verify_outputs_init);
+        dc_next(dc, alert_nondefault_sighash);
+    }
+
+    dc->run();
+}
+
+// Signatures with a sighash type other than SIGHASH_ALL (or SIGHASH_DEFAULT) do not commit to all
+// the inputs and outputs of the transaction: they can be reused in a different one, therefore we
+// warn the user.
+static void alert_nondefault_sighash(dispatcher_context_t *dc) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    if (!state->has_nondefault_sighash || state->is_check_only) {
+        dc_next(dc, verify_outputs_init);
+    } else if (state->is_unattended) {
+        // the user can not be warned
+        PRINTF("Non-default sighash types are not allowed in unattended signing\n");
+        SEND_SW(dc, SW_DENY);
+    } else {
+        dc->pause();
+        ui_warn_nondefault_sighash(dc, ui_alert_nondefault_sighash_result);
+    }
+}
+
+static void ui_alert_nondefault_sighash_result(dispatcher_context_t *dc, bool accept) {
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    if (!accept) {
+        SEND_SW(dc, SW_DENY);
+    } else {
+        dc_next(dc, verify_outputs_init);
     }
 
     dc->run();
@@ -792,15 +2205,24 @@ static void verify_outputs_init(dispatcher_context_t *dc) {
 
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
-    state->outputs_total_value = 0;
-    state->change_outputs_total_value = 0;
+    state->totals.outputs = 0;
+    state->totals.change_outputs = 0;
     state->change_count = 0;
 
     state->cur_output_index = 0;
 
     state->external_outputs_count = 0;
 
-    dc->next(process_output_map);
+    if (state->is_bip322_proof && state->n_outputs != 1) {
+        PRINTF("The to_sign transaction of a proof must have exactly one output\n");
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
+    }
+
+    cx_sha256_init(&state->sha_outputs_context);
+    cx_sha256_init(&state->external_outputs_context);
+
+    dc_next(dc, process_output_map);
 }
 
 /**
@@ -845,20 +2267,76 @@ static void process_output_map(dispatcher_context_t *dc) {
 
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
+    if (!yield_progress(dc, SIGN_PSBT_PHASE_OUTPUTS, state->cur_output_index, state->n_outputs)) {
+        SEND_SW(dc, SW_BAD_STATE);
+        return;
+    }
+
     if (state->cur_output_index >= state->n_outputs) {
-        // all outputs already processed
-        dc->next(confirm_transaction);
+        // all outputs already processed; their serialization was hashed along the way, therefore
+        // the outputs do not need to be fetched again for the segwit sighashes
+        crypto_hash_digest(&state->sha_outputs_context.header, state->hashes.sha_outputs, 32);
+
+        uint8_t external_outputs_hash[32];
+        crypto_hash_digest(&state->external_outputs_context.header, external_outputs_hash, 32);
+        if (state->is_amend &&
+            memcmp(external_outputs_hash, state->external_outputs_hash, 32) != 0) {
+            // only the fee and the change can be amended; the user did not approve other outputs
+            PRINTF("The external outputs differ from the ones of the amend record\n");
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
+        if (!state->is_bip322_proof) {
+            memcpy(state->external_outputs_hash, external_outputs_hash, 32);
+        }
+
+        dc_next(dc, confirm_transaction);
         return;
     }
 
+    unsigned int batch_idx = state->cur_output_index % MERKLE_LEAVES_BATCH_SIZE;
+    if (batch_idx == 0) {
+        // get the leaf hashes of the next batch of output maps, with a single Merkle proof
+        if (call_get_merkle_leaves_hashes(dc,
+                                          state->outputs_root,
+                                          state->n_outputs,
+                                          state->cur_output_index,
+                                          MERKLE_LEAVES_BATCH_SIZE,
+                                          state->output_leaf_hashes) < 0) {
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
+
+        // ask at once for the commitments of the maps of the batch
+        if (call_prefetch_preimages(
+                dc,
+                state->output_leaf_hashes,
+                MIN(MERKLE_LEAVES_BATCH_SIZE, state->n_outputs - state->cur_output_index)) < 0) {
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
+    }
+
     memset(&state->cur_output, 0, sizeof(state->cur_output));
 
-    int res = call_get_merkleized_map_with_callback(
+    // Read the output's amount and scriptPubKey in the same sweep that checks the keys of the map
+    uint8_t raw_result[8];
+    merkleized_map_field_t fields[] = {
+        make_merkleized_map_field((uint8_t[]){PSBT_OUT_AMOUNT}, 1, raw_result, sizeof(raw_result)),
+        make_merkleized_map_field((uint8_t[]){PSBT_OUT_SCRIPT},
+                                  1,
+                                  state->cur_output.scriptpubkey,
+                                  sizeof(state->cur_output.scriptpubkey)),
+    };
+    const merkleized_map_field_t *amount_field = &fields[0];
+    const merkleized_map_field_t *script_field = &fields[1];
+
+    int res = call_get_merkleized_map_from_leaf_hash_with_fields(
         dc,
-        state->outputs_root,
-        state->n_outputs,
-        state->cur_output_index,
+        state->output_leaf_hashes[batch_idx],
         make_callback(state, (dispatcher_callback_t) output_keys_callback),
+        fields,
+        sizeof(fields) / sizeof(fields[0]),
         &state->cur_output.map);
     if (res < 0) {
         SEND_SW(dc, SW_INCORRECT_DATA);
@@ -871,47 +2349,48 @@ static void process_output_map(dispatcher_context_t *dc) {
         return;
     }
 
-    // read output amount and scriptpubkey
-
-    uint8_t raw_result[8];
-
-    // Read the output's amount
-    int result_len = call_get_merkleized_map_value(dc,
-                                                   &state->cur_output.map,
-                                                   (uint8_t[]){PSBT_OUT_AMOUNT},
-                                                   1,
-                                                   raw_result,
-                                                   sizeof(raw_result));
-    if (result_len != 8) {
+    if (amount_field->value_len != 8) {
         SEND_SW(dc, SW_INCORRECT_DATA);
         return;
     }
     uint64_t value = read_u64_le(raw_result, 0);
 
     state->cur_output.value = value;
-    state->outputs_total_value += value;
-
-    // Read the output's scriptPubKey
-
-    // Read the output's amount
-    result_len = call_get_merkleized_map_value(dc,
-                                               &state->cur_output.map,
-                                               (uint8_t[]){PSBT_OUT_SCRIPT},
-                                               1,
-                                               state->cur_output.scriptpubkey,
-                                               sizeof(state->cur_output.scriptpubkey));
-    if (result_len == -1) {
+    if (!add_to_total(&state->totals.outputs, value)) {
         SEND_SW(dc, SW_INCORRECT_DATA);
         return;
-    } else if (result_len > (int) sizeof(state->cur_output.scriptpubkey)) {
-        PRINTF("Output's scriptPubKey too long: %d\n", result_len);
+    }
+
+    int result_len = script_field->value_len;
+    if (result_len < 0) {
         SEND_SW(dc, SW_INCORRECT_DATA);
         return;
     }
 
     state->cur_output.scriptpubkey_len = result_len;
 
-    dc->next(check_output_owned);
+    crypto_hash_update(&state->sha_outputs_context.header, raw_result, 8);
+    crypto_hash_update_varint(&state->sha_outputs_context.header, result_len);
+    crypto_hash_update(&state->sha_outputs_context.header,
+                       state->cur_output.scriptpubkey,
+                       result_len);
+
+    classify_script(state->cur_output.scriptpubkey,
+                    state->cur_output.scriptpubkey_len,
+                    &state->cur_output.script_info);
+
+    if (state->is_bip322_proof) {
+        // the only output of a proof is an OP_RETURN (0x6a) of value 0, not shown to the user
+        if (value != 0 || result_len != 1 || state->cur_output.scriptpubkey[0] != 0x6a) {
+            PRINTF("The output of a proof must be an empty OP_RETURN\n");
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
+        dc_next(dc, output_next);
+        return;
+    }
+
+    dc_next(dc, check_output_owned);
 }
 
 // TODO: lots of code duplication with check_input_owned, consider refactoring
@@ -920,8 +2399,7 @@ static void check_output_owned(dispatcher_context_t *dc) {
 
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
-    int script_type =
-        get_script_type(state->cur_output.scriptpubkey, state->cur_output.scriptpubkey_len);
+    int script_type = state->cur_output.script_info.type;
 
     bool external = false;
 
@@ -937,8 +2415,8 @@ static void check_output_owned(dispatcher_context_t *dc) {
         uint32_t bip32_path[MAX_BIP32_PATH_STEPS];
         uint32_t fingerprint;
 
-        if (script_type == -1) {
-            external = true;  // unknown script, definitely external
+        if (script_type == -1 || !is_any_wallet_script_type(state, script_type)) {
+            external = true;  // unknown script, or not a script of a wallet: definitely external
             break;
         } else if (script_type == SCRIPT_TYPE_P2TR) {
             // taproot output, use PSBT_OUT_TAP_BIP32_DERIVATION
@@ -946,12 +2424,12 @@ static void check_output_owned(dispatcher_context_t *dc) {
             key[0] = PSBT_OUT_TAP_BIP32_DERIVATION;
             memcpy(key + 1, state->cur_output.bip32_derivation_pubkey, 32);
 
-            bip32_path_len = get_emptyhashes_fingerprint_and_path(dc,
-                                                                  &state->cur_output.map,
-                                                                  key,
-                                                                  sizeof(key),
-                                                                  &fingerprint,
-                                                                  bip32_path);
+            bip32_path_len = get_tap_fingerprint_and_path(dc,
+                                                          &state->cur_output.map,
+                                                          key,
+                                                          sizeof(key),
+                                                          &fingerprint,
+                                                          bip32_path);
         } else {
             // legacy or segwitv0 output, use PSBT_OUT_BIP32_DERIVATION
             uint8_t key[1 + 33];
@@ -976,64 +2454,60 @@ static void check_output_owned(dispatcher_context_t *dc) {
             external = true;
             break;
         }
-        uint32_t change = bip32_path[bip32_path_len - 2];
-        uint32_t address_index = bip32_path[bip32_path_len - 1];
-
-        if (change != 1) {
+        if (bip32_path[bip32_path_len - 2] != 1) {
             // unlike for inputs, change must be 1 for this output to be considered internal
             external = true;
             break;
         }
 
-        if (state->is_wallet_canonical) {
-            // for canonical wallets, the path must be exactly as expected for a change output
-            uint32_t coin_types[2] = {G_coin_config->bip44_coin_type,
-                                      G_coin_config->bip44_coin_type2};
-            if (!is_address_path_standard(bip32_path,
-                                          bip32_path_len,
-                                          state->bip44_purpose,
-                                          coin_types,
-                                          2,
-                                          1)) {
-                external = true;
-                break;
-            }
-        }
-
-        int res = compare_wallet_script_at_path(dc,
-                                                change,
-                                                address_index,
-                                                &state->wallet_policy_map,
-                                                state->wallet_header_keys_info_merkle_root,
-                                                state->wallet_header_n_keys,
-                                                state->cur_output.scriptpubkey,
-                                                state->cur_output.scriptpubkey_len);
+        // for canonical wallets, the path must be exactly as expected for a change output
+        int res = find_wallet_of_script(dc,
+                                        state,
+                                        script_type,
+                                        fingerprint,
+                                        bip32_path,
+                                        bip32_path_len,
+                                        1,
+                                        state->cur_output.scriptpubkey,
+                                        state->cur_output.scriptpubkey_len);
         if (res < 0) {
-            SEND_SW(dc, SW_INCORRECT_DATA);
-            return;
-        } else if (res == 0) {
-            external = true;
-        } else if (res == 1) {
-            // output is internal, nothing to do
-        } else {
-            SEND_SW(dc, SW_BAD_STATE);  // should never happen
             return;
         }
+        external = res == 0;
     } while (false);  // execute only once; just to be able to break out
 
     if (external) {
         // external output, user needs to validate
         ++state->external_outputs_count;
 
-        dc->next(output_validate_external);
+        uint8_t value[8];
+        write_u64_le(value, 0, state->cur_output.value);
+        crypto_hash_update(&state->external_outputs_context.header, value, 8);
+        crypto_hash_update_varint(&state->external_outputs_context.header,
+                                  state->cur_output.scriptpubkey_len);
+        crypto_hash_update(&state->external_outputs_context.header,
+                           state->cur_output.scriptpubkey,
+                           state->cur_output.scriptpubkey_len);
+
+        dc_next(dc, output_validate_external);
         return;
     } else {
         // valid change address, nothing to show to the user
 
-        state->change_outputs_total_value += state->cur_output.value;
-        ++state->change_count;
+        if (state->change_count >= MAX_CHANGE_OUTPUTS) {
+            // As the information regarding change outputs is aggregated, we want to prevent the
+            // user from unknowingly signing a transaction that sends the change to too many
+            // (possibly unspendable) outputs.
+            PRINTF("Too many change outputs: more than %d\n", MAX_CHANGE_OUTPUTS);
+            SEND_SW(dc, SW_NOT_SUPPORTED);
+            return;
+        }
+
+        // never overflows, as the change outputs are a subset of the outputs
+        add_to_total(&state->totals.change_outputs, state->cur_output.value);
+        state->change_output_indexes[state->change_count++] = state->cur_output_index;
 
-        dc->next(output_next);
+        dc_next(dc, output_next);
         return;
     }
 }
@@ -1043,27 +2517,68 @@ static void output_validate_external(dispatcher_context_t *dc) {
 
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
-    // show this output's address
+    // show this output's address; the screens of the output are prepared here, so that showing
+    // them does not format anything
     // TODO: handle outputs without an address (e.g.: OP_RETURN)
-    char output_address[MAX_ADDRESS_LENGTH_STR + 1];
-    int address_len = get_script_address(state->cur_output.scriptpubkey,
-                                         state->cur_output.scriptpubkey_len,
-                                         G_coin_config,
-                                         output_address,
-                                         sizeof(output_address));
+    char *output_address = ui_prepare_output(state->external_outputs_count,
+                                             G_coin_config->name_short,
+                                             state->cur_output.value);
+    int address_len = get_classified_script_address(state->cur_output.scriptpubkey,
+                                                    state->cur_output.scriptpubkey_len,
+                                                    &state->cur_output.script_info,
+                                                    G_coin_config,
+                                                    output_address,
+                                                    MAX_ADDRESS_LENGTH_STR + 1);
     if (address_len < 0) {
         PRINTF("Unknown or unsupported script type for output %d\n", state->cur_output_index);
         SEND_SW(dc, SW_NOT_SUPPORTED);
         return;
     }
 
+    if (state->is_check_only) {
+        // the output would be shown to the user
+        dc_next(dc, output_next);
+        return;
+    }
+
+    if (state->is_amend) {
+        // the external outputs were approved for the amend record; verified once all the outputs
+        // are processed
+        dc_next(dc, output_next);
+        return;
+    }
+
+    if (state->is_summary) {
+        // the external outputs are validated at once, with their hash, once all of them are
+        // processed
+        dc_next(dc, output_next);
+        return;
+    }
+
+#ifdef HAVE_UNATTENDED_SIGNING
+    if (state->is_unattended) {
+        // the output must be one of the destinations approved for the spending policy
+        uint8_t scriptpubkey_hash[32];
+        merkle_compute_element_hash(state->cur_output.scriptpubkey,
+                                    state->cur_output.scriptpubkey_len,
+                                    scriptpubkey_hash);
+        if (state->spending_policy.n_destinations == 0 ||
+            call_get_merkle_leaf_index(dc,
+                                       state->spending_policy.n_destinations,
+                                       state->spending_policy.destinations_root,
+                                       scriptpubkey_hash) < 0) {
+            PRINTF("Output %d is not a destination of the spending policy\n",
+                   state->cur_output_index);
+            SEND_SW(dc, SW_DENY);
+            return;
+        }
+        dc_next(dc, output_next);
+        return;
+    }
+#endif
+
     dc->pause();
-    ui_validate_output(dc,
-                       state->external_outputs_count,
-                       output_address,
-                       G_coin_config->name_short,
-                       state->cur_output.value,
-                       ui_action_validate_output);
+    ui_validate_output(dc, ui_action_validate_output);
 }
 
 static void ui_action_validate_output(dispatcher_context_t *dc, bool accept) {
@@ -1072,7 +2587,7 @@ static void ui_action_validate_output(dispatcher_context_t *dc, bool accept) {
     if (!accept) {
         SEND_SW(dc, SW_DENY);
     } else {
-        dc->next(output_next);
+        dc_next(dc, output_next);
     }
 
     dc->run();
@@ -1084,33 +2599,126 @@ static void output_next(dispatcher_context_t *dc) {
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
     ++state->cur_output_index;
-    dc->next(process_output_map);
+    dc_next(dc, process_output_map);
+}
+
+// Responds to a SIGN_PSBT in SIGN_PSBT_MODE_CHECK, once the psbt is verified, with what the user
+// would validate: the totals, and which inputs and outputs are internal
+static void send_check_result(dispatcher_context_t *dc) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    uint8_t response[3 * 8 + BITVECTOR_REAL_SIZE(MAX_N_INPUTS_CAN_SIGN) +
+                     MAX(BITVECTOR_REAL_SIZE(SIGN_PSBT_CHECK_MAX_BITVECTOR_OUTPUTS),
+                         1 + 4 * MAX_CHANGE_OUTPUTS)];
+    buffer_t out = buffer_create(response, sizeof(response));
+
+    buffer_write_u64(&out, state->totals.inputs, LE);
+    buffer_write_u64(&out, state->totals.outputs, LE);
+    buffer_write_u64(&out, state->totals.change_outputs, LE);
+    buffer_write_bytes(&out, state->internal_inputs, BITVECTOR_REAL_SIZE(state->n_inputs));
+    if (state->n_outputs <= SIGN_PSBT_CHECK_MAX_BITVECTOR_OUTPUTS) {
+        uint8_t change_outputs[BITVECTOR_REAL_SIZE(SIGN_PSBT_CHECK_MAX_BITVECTOR_OUTPUTS)];
+        memset(change_outputs, 0, sizeof(change_outputs));
+        for (int i = 0; i < state->change_count; i++) {
+            bitvector_set(change_outputs, state->change_output_indexes[i], 1);
+        }
+        buffer_write_bytes(&out, change_outputs, BITVECTOR_REAL_SIZE(state->n_outputs));
+    } else {
+        // a bitvector would not fit in the response
+        buffer_write_u8(&out, (uint8_t) state->change_count);
+        for (int i = 0; i < state->change_count; i++) {
+            buffer_write_u32(&out, state->change_output_indexes[i], LE);
+        }
+    }
+
+    SEND_RESPONSE(dc, response, out.offset, SW_OK);
 }
 
-// Show fees and confirm transaction with the user
+// Checks the totals of the transaction, and validates the external outputs at once in
+// SIGN_PSBT_MODE_SUMMARY
 static void confirm_transaction(dispatcher_context_t *dc) {
     sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
 
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
-    if (state->inputs_total_value < state->outputs_total_value) {
+    if (state->totals.inputs < state->totals.outputs) {
         // negative fee transaction is invalid
         SEND_SW(dc, SW_INCORRECT_DATA);
         return;
     }
 
-    if (state->change_count > 10) {
-        // As the information regarding change outputs is aggregated, we want to prevent the user
-        // from unknowingly signing a transaction that sends the change to too many (possibly
-        // unspendable) outputs.
-        PRINTF("Too many change outputs: %d\n", state->change_count);
-        SEND_SW(dc, SW_NOT_SUPPORTED);
+    if (state->is_check_only) {
+        send_check_result(dc);
+        return;
+    }
+
+#ifdef HAVE_UNATTENDED_SIGNING
+    if (state->is_unattended) {
+        // all the inputs are internal: the transaction spends its external outputs and the fee.
+        // Never underflows, as the change outputs are a subset of the outputs
+        uint64_t spent = state->totals.inputs - state->totals.change_outputs;
+        if (!spending_session_charge(state->spending_policy_id, &state->spending_policy, spent)) {
+            PRINTF("The transaction exceeds the limits of the spending policy\n");
+            SEND_SW(dc, SW_DENY);
+            return;
+        }
+        dc_next(dc, sign_init);
+        return;
+    }
+#endif
+
+    if (state->is_summary && state->external_outputs_count > 0) {
+        // the external outputs were not shown one by one: the user validates their number, their
+        // total and the hash of their serializations, that the client can compute and show too
+        char outputs_hash_str[64 + 1];
+        format_hex(state->external_outputs_hash, 32, outputs_hash_str, sizeof(outputs_hash_str));
+
+        dc->pause();
+        // never underflows, as the change outputs are a subset of the outputs
+        ui_validate_output_summary(dc,
+                                   state->external_outputs_count,
+                                   outputs_hash_str,
+                                   G_coin_config->name_short,
+                                   state->totals.outputs - state->totals.change_outputs,
+                                   ui_action_validate_output_summary);
         return;
     }
 
-    uint64_t fee = state->inputs_total_value - state->outputs_total_value;
+    dc_next(dc, confirm_fees);
+}
+
+static void ui_action_validate_output_summary(dispatcher_context_t *dc, bool accept) {
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    if (!accept) {
+        SEND_SW(dc, SW_DENY);
+    } else {
+        dc_next(dc, confirm_fees);
+    }
+
+    dc->run();
+}
+
+// Show the fees (or, for a proof, the proven funds) and confirm the transaction with the user
+static void confirm_fees(dispatcher_context_t *dc) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    uint64_t fee = state->totals.inputs - state->totals.outputs;
 
     dc->pause();
+    if (state->is_bip322_proof) {
+        // nothing is spent: the user confirms the message and the funds that are proven instead
+        char message_hash_str[64 + 1];
+        format_hex(state->bip322_message_hash, 32, message_hash_str, sizeof(message_hash_str));
+        ui_validate_proof_of_reserves(dc,
+                                      message_hash_str,
+                                      G_coin_config->name_short,
+                                      state->totals.internal_inputs,
+                                      ui_action_validate_transaction);
+        return;
+    }
     ui_validate_transaction(dc, G_coin_config->name_short, fee, ui_action_validate_transaction);
 }
 
@@ -1119,89 +2727,249 @@ static void ui_action_validate_transaction(dispatcher_context_t *dc, bool accept
 
     if (!accept) {
         SEND_SW(dc, SW_DENY);
+    } else if (((sign_psbt_state_t *) &G_command_state)->yield_amend_record) {
+        dc_next(dc, yield_amend_record);
     } else {
-        dc->next(sign_init);
+        dc_next(dc, sign_init);
     }
 
     dc->run();
 }
 
-/** SIGNING FLOW
- *
- * Iterate over all inputs. For each input that should be signed, compute and sign sighash.
- */
-
-// entry point for the signing flow
-static void sign_init(dispatcher_context_t *dc) {
+// Yields the amend record of the transaction approved by the user, followed by its hmac
+static void yield_amend_record(dispatcher_context_t *dc) {
     sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
 
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
-    // find and parse our registered key info in the wallet
-    bool our_key_found = false;
-    for (unsigned int i = 0; i < state->wallet_header_n_keys; i++) {
-        uint8_t key_info_str[MAX_POLICY_KEY_INFO_LEN];
+    uint8_t flags = 0;
+    if (state->has_internal_segwit_inputs) {
+        flags |= AMEND_RECORD_FLAG_SEGWIT_INPUTS;
+    }
+    if (state->has_internal_segwit_v1_inputs) {
+        flags |= AMEND_RECORD_FLAG_SEGWIT_V1_INPUTS;
+    }
+    if (state->has_nondefault_sighash) {
+        flags |= AMEND_RECORD_FLAG_NONDEFAULT;
+    }
 
-        int key_info_len = call_get_merkle_leaf_element(dc,
-                                                        state->wallet_header_keys_info_merkle_root,
-                                                        state->wallet_header_n_keys,
-                                                        i,
-                                                        key_info_str,
-                                                        sizeof(key_info_str));
+    buffer_t record = buffer_create(state->amend_record, sizeof(state->amend_record));
+    buffer_write_u8(&record, SIGN_PSBT_AMEND_RECORD_VERSION);
+    buffer_write_u8(&record, flags);
+    buffer_write_u64(&record, state->totals.inputs, LE);
+    buffer_write_u64(&record, state->totals.internal_inputs, LE);
+    buffer_write_bytes(&record, state->hashes.sha_prevouts, 32);
+    buffer_write_bytes(&record, state->hashes.sha_amounts, 32);
+    buffer_write_bytes(&record, state->hashes.sha_scriptpubkeys, 32);
+    buffer_write_bytes(&record, state->hashes.sha_sequences, 32);
+    buffer_write_bytes(&record, state->external_outputs_hash, 32);
+    if (!buffer_write_bytes(&record,
+                            state->internal_inputs,
+                            BITVECTOR_REAL_SIZE(state->n_inputs))) {
+        SEND_SW(dc, SW_BAD_STATE);  // should never happen, as n_inputs was checked
+        return;
+    }
 
-        if (key_info_len < 0) {
-            SEND_SW(dc, SW_BAD_STATE);  // should never happen
-            return;
-        }
+    uint8_t record_id[32];
+    uint8_t record_hmac[32];
+    cx_hash_sha256(state->amend_record, record.offset, record_id, 32);
+    compute_amend_record_hmac(state, record_id, record_hmac);
 
-        // Make a sub-buffer for the pubkey info
-        buffer_t key_info_buffer = buffer_create(key_info_str, key_info_len);
+    uint8_t cmd = CCMD_YIELD;
+    dc_add_to_response(dc, &cmd, 1);
+    dc_add_to_response(dc, state->amend_record, record.offset);
+    dc_add_to_response(dc, record_hmac, sizeof(record_hmac));
+    dc_interrupt(dc, sign_init);
+}
+
+/** SIGNING FLOW
+ *
+ * Iterate over all inputs. For each input that should be signed, compute and sign sighash.
+ */
 
+// Returns the taproot tree of the wallet policy, or NULL if it has no tapscripts.
+// Finds the internal keys of the active wallet policy, that sign each of its internal inputs.
+// Returns false on error, after sending the status word.
+static bool load_our_keys(dispatcher_context_t *dc, sign_psbt_state_t *state) {
+    // find and parse all our registered key infos in the wallet
+    state->n_our_keys = 0;
+    for (unsigned int i = 0; i < state->wallet_header_n_keys; i++) {
         policy_map_key_info_t our_key_info;
-        if (parse_policy_map_key_info(&key_info_buffer, &our_key_info) == -1) {
+        if (get_policy_key_info(dc,
+                                state->wallet_header_keys_info_merkle_root,
+                                state->wallet_header_n_keys,
+                                i,
+                                &our_key_info) < 0) {
             SEND_SW(dc, SW_BAD_STATE);  // should never happen
-            return;
+            return false;
         }
 
-        uint32_t fpr = read_u32_be(our_key_info.master_key_fingerprint, 0);
-        if (fpr == state->master_key_fingerprint) {
-            // it could be a collision on the fingerprint; we verify that we can actually generate
-            // the same pubkey
-            char pubkey_derived[MAX_SERIALIZED_PUBKEY_LENGTH + 1];
-            int serialized_pubkey_len =
-                get_serialized_extended_pubkey_at_path(our_key_info.master_key_derivation,
-                                                       our_key_info.master_key_derivation_len,
-                                                       G_coin_config->bip32_pubkey_version,
-                                                       pubkey_derived);
-            if (serialized_pubkey_len == -1) {
-                SEND_SW(dc, SW_BAD_STATE);
-                return;
+        if (is_policy_key_internal(&our_key_info,
+                                   state->master_key_fingerprint,
+                                   G_coin_config->bip32_pubkey_version)) {
+            if (state->n_our_keys >= MAX_POLICY_MAP_INTERNAL_KEYS) {
+                SEND_SW(dc, SW_BAD_STATE);  // should never happen
+                return false;
             }
 
-            if (strncmp(our_key_info.ext_pubkey, pubkey_derived, MAX_SERIALIZED_PUBKEY_LENGTH) ==
-                0) {
-                our_key_found = true;
-
-                state->our_key_derivation_length = our_key_info.master_key_derivation_len;
-                for (int i = 0; i < our_key_info.master_key_derivation_len; i++) {
-                    state->our_key_derivation[i] = our_key_info.master_key_derivation[i];
-                }
-
-                break;
+            internal_key_derivation_t *our_key = &state->our_keys[state->n_our_keys];
+            our_key->derivation_length = our_key_info.master_key_derivation_len;
+            for (int j = 0; j < our_key_info.master_key_derivation_len; j++) {
+                our_key->derivation[j] = our_key_info.master_key_derivation[j];
             }
+            our_key->key_index = (uint8_t) i;
+            ++state->n_our_keys;
         }
     }
 
-    if (!our_key_found) {
+    if (state->n_our_keys == 0) {
         PRINTF("Couldn't find internal key\n");
         SEND_SW(
             dc,
             SW_BAD_STATE);  // should never happen if we only register wallets with an internal key
+        return false;
+    }
+
+    init_taptree_hashes(state);
+    return true;
+}
+
+// Initializes the part of the legacy sighash preimage that precedes the inputs.
+static void init_legacy_prefix(sign_psbt_state_t *state) {
+    cx_sha256_init(&state->legacy_prefix.context);
+    uint8_t tmp[4];
+    write_u32_le(tmp, 0, state->tx_version);
+    crypto_hash_update(&state->legacy_prefix.context.header, tmp, 4);
+    crypto_hash_update_varint(&state->legacy_prefix.context.header, state->n_inputs);
+    state->legacy_prefix.n_inputs = 0;
+}
+
+// entry point for the signing flow
+static void sign_init(dispatcher_context_t *dc) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    // the keys are the ones of the wallet policy of the first input to sign; the wallet policies of
+    // the other inputs are activated when they are reached
+    for (unsigned int i = state->sign_range_start; i < state->sign_range_end; i++) {
+        if (bitvector_get(state->internal_inputs, i)) {
+            if (!activate_wallet_policy(state, get_input_wallet(state, i))) {
+                SEND_SW(dc, SW_BAD_STATE);  // should never happen
+                return;
+            }
+            break;
+        }
+    }
+
+    if (!load_our_keys(dc, state)) {
         return;
     }
 
-    state->cur_input_index = 0;
-    dc->next(sign_process_input_map);
+    init_legacy_prefix(state);
+
+    if (!state->has_internal_segwit_inputs) {
+        // tx-wide hashes are only needed for segwit inputs
+        state->sign_order_pos = 0;
+        memset(state->visited_inputs, 0, sizeof(state->visited_inputs));
+        state->yield_buffer_len = 0;
+        dc_next(dc, sign_process_input_map);
+    } else {
+        dc_next(dc, compute_segwit_hashes);
+    }
+}
+
+// Initializes sighash_context with the part of the BIP143 preimage that precedes the current input:
+// nVersion, hashPrevouts and hashSequence, that are zeros if the sighash type does not commit to
+// the other inputs, or to their nSequence.
+static void hash_segwit_v0_prefix(uint32_t sighash_type, cx_sha256_t *sighash_context) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    cx_sha256_init(sighash_context);
+
+    uint8_t tmp[4];
+    write_u32_le(tmp, 0, state->tx_version);
+    crypto_hash_update(&sighash_context->header, tmp, 4);
+
+    uint8_t dbl_hash[32];
+
+    // add to hash: hashPrevouts = sha256(sha_prevouts)
+    if (sighash_type & SIGHASH_ANYONECANPAY) {
+        memset(dbl_hash, 0, 32);
+    } else {
+        cx_hash_sha256(state->hashes.sha_prevouts, 32, dbl_hash, 32);
+    }
+    crypto_hash_update(&sighash_context->header, dbl_hash, 32);
+
+    // add to hash: hashSequence sha256(sha_sequences)
+    if (sighash_type != SIGHASH_ALL) {
+        memset(dbl_hash, 0, 32);
+    } else {
+        cx_hash_sha256(state->hashes.sha_sequences, 32, dbl_hash, 32);
+    }
+    crypto_hash_update(&sighash_context->header, dbl_hash, 32);
+}
+
+// Computes the part of the BIP143 preimage shared by all the segwit v0 inputs, so that it is only
+// computed once, rather than once per signed input.
+static void compute_segwit_hashes(dispatcher_context_t *dc) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    // The tx-wide hashes were already computed while verifying the inputs and the outputs.
+    // The BIP143 preimage starts with nVersion, hashPrevouts and hashSequence, which are the same
+    // for all the segwit v0 inputs signed with SIGHASH_ALL; we absorb them once and save the state
+    cx_sha256_t sighash_context;
+    hash_segwit_v0_prefix(SIGHASH_ALL, &sighash_context);
+
+    crypto_sha256_snapshot(&sighash_context, &state->segwit_v0_prefix);
+
+    state->sign_order_pos = 0;
+    memset(state->visited_inputs, 0, sizeof(state->visited_inputs));
+    state->yield_buffer_len = 0;
+    dc_next(dc, sign_process_input_map);
+}
+
+// Returns the index of the input at position pos of the signing order, or -1 on error, after
+// sending the status word. By default, the inputs of the range are signed by index; with
+// SIGN_PSBT_MODE_FLAG_INPUT_ORDER, the index is the element at position pos of the list committed
+// by the client, that must be an input of the range not visited yet: as the list has one element
+// per input of the range, it is then a permutation of the range.
+static int get_input_at_sign_position(dispatcher_context_t *dc,
+                                      const sign_psbt_state_t *state,
+                                      unsigned int pos) {
+    unsigned int range_len = state->sign_range_end - state->sign_range_start;
+
+    if (!state->has_input_order) {
+        return (int) (state->sign_range_start + pos);
+    }
+
+    uint8_t element[4];
+    if (call_get_merkle_leaf_element(dc,
+                                     state->input_order_root,
+                                     range_len,
+                                     pos,
+                                     element,
+                                     sizeof(element)) != sizeof(element)) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return -1;
+    }
+
+    uint32_t input_index = read_u32_le(element, 0);
+    if (input_index < state->sign_range_start || input_index >= state->sign_range_end ||
+        bitvector_get(state->visited_inputs, input_index)) {
+        PRINTF("Invalid input %d at position %d of the signing order\n", input_index, pos);
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return -1;
+    }
+    return (int) input_index;
+}
+
+// Moves to the next position of the signing order, once the current input is signed or skipped.
+static void next_sign_position(sign_psbt_state_t *state) {
+    bitvector_set(state->visited_inputs, state->cur_input_index, 1);
+    ++state->sign_order_pos;
 }
 
 static void sign_process_input_map(dispatcher_context_t *dc) {
@@ -1209,28 +2977,109 @@ static void sign_process_input_map(dispatcher_context_t *dc) {
 
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
+    unsigned int range_len = state->sign_range_end - state->sign_range_start;
+    if (!yield_progress(dc, SIGN_PSBT_PHASE_SIGN, state->sign_order_pos, range_len)) {
+        SEND_SW(dc, SW_BAD_STATE);
+        return;
+    }
+
     // skip external inputs
-    while (state->cur_input_index < state->n_inputs &&
-           !state->internal_inputs[state->cur_input_index]) {
+    while (state->sign_order_pos < range_len) {
+        int input_index = get_input_at_sign_position(dc, state, state->sign_order_pos);
+        if (input_index < 0) {
+            return;  // response already set
+        }
+        state->cur_input_index = (unsigned int) input_index;
+        if (bitvector_get(state->internal_inputs, state->cur_input_index)) {
+            break;
+        }
         PRINTF("Skipping signing external input %d\n", state->cur_input_index);
-        ++state->cur_input_index;
+        next_sign_position(state);
     }
 
-    if (state->cur_input_index >= state->n_inputs) {
-        // all inputs already processed
-        dc->next(finalize);
+    if (state->sign_order_pos >= range_len) {
+        // all inputs in the range already processed
+        sign_psbt_checkpoint_reset();
+        dc_next(dc, finalize);
+        return;
+    }
+
+    // each internal input is signed with the keys of its wallet policy
+    unsigned int wallet_index = get_input_wallet(state, state->cur_input_index);
+    if (wallet_index != state->cur_wallet) {
+        if (!activate_wallet_policy(state, wallet_index)) {
+            SEND_SW(dc, SW_BAD_STATE);  // should never happen
+            return;
+        }
+        if (!load_our_keys(dc, state)) {
+            return;
+        }
+    }
+
+#ifdef HAVE_SIGN_PSBT_CHECKPOINT
+    // With coalesced yields, the buffer is sent before an input whose signatures might not fit,
+    // and the checkpoint is only saved when it is empty: so it always points to the first input
+    // whose signatures were not sent yet.
+    if (state->coalesce_yields &&
+        state->yield_buffer_len + state->n_our_keys * SIGN_PSBT_YIELD_ENTRY_MAX_LEN >
+            SIGN_PSBT_YIELD_BUFFER_SIZE &&
+        !flush_yield_buffer(dc)) {
+        SEND_SW(dc, SW_BAD_STATE);
         return;
     }
+    if (state->yield_buffer_len == 0) {
+        // the signatures of all the previous inputs were yielded
+        sign_psbt_checkpoint_save(state);
+    }
+#endif
 
     // Reset cur_input struct
-    memset(&state->cur_input, 0, sizeof(state->cur_input));
+    reset_cur_input(state);
+
+    // the inputs with a record are signed from it, without fetching their map
+    state->cur_input_record = find_input_record(state, state->cur_input_index);
+    if (state->cur_input_record != NULL) {
+        const sign_psbt_input_record_t *record = state->cur_input_record;
+        state->cur_input.has_witnessUtxo = true;
+        state->cur_input.prevout_amount = record->amount;
+        state->cur_input.sighash_type = record->sighash_type;
+        state->cur_input.change = record->change;
+        state->cur_input.address_index = record->address_index;
+        if (record->segwit_version == 1) {
+            dc_next(dc, sign_segwit_v1);
+        } else {
+            state->cur_input.witness_program_len = sizeof(record->witness_program);
+            memcpy(state->cur_input.witness_program,
+                   record->witness_program,
+                   sizeof(record->witness_program));
+            dc_next(dc, sign_segwit_v0);
+        }
+        return;
+    }
 
-    int res = call_get_merkleized_map_with_callback(
+    // Fetch the sighash type, and the hash of the witness utxo (if any), in the same sweep that
+    // checks the keys of the map; the witness utxo itself is only fetched if it is needed for the
+    // sighash. The redeemScript is not fetched here, as for legacy inputs it can be too long to be
+    // stored, and is streamed into the sighash instead.
+    uint8_t sighash_type_raw[4];
+    uint8_t witness_utxo_hash[32];
+    merkleized_map_field_t fields[] = {
+        make_merkleized_map_field((uint8_t[]){PSBT_IN_SIGHASH_TYPE},
+                                  1,
+                                  sighash_type_raw,
+                                  sizeof(sighash_type_raw)),
+        make_merkleized_map_field_hash((uint8_t[]){PSBT_IN_WITNESS_UTXO}, 1, witness_utxo_hash),
+    };
+    const merkleized_map_field_t *sighash_type_field = &fields[0];
+
+    int res = call_get_merkleized_map_with_fields(
         dc,
         state->inputs_root,
         state->n_inputs,
         state->cur_input_index,
         make_callback(state, (dispatcher_callback_t) input_keys_callback),
+        fields,
+        sizeof(fields) / sizeof(fields[0]),
         &state->cur_input.map);
     if (res < 0) {
         SEND_SW(dc, SW_INCORRECT_DATA);
@@ -1241,70 +3090,77 @@ static void sign_process_input_map(dispatcher_context_t *dc) {
         state->cur_input.sighash_type = SIGHASH_ALL;
     } else {
         // Get sighash type
-        if (4 != call_get_merkleized_map_value_u32_le(dc,
-                                                      &state->cur_input.map,
-                                                      (uint8_t[]){PSBT_IN_SIGHASH_TYPE},
-                                                      1,
-                                                      &state->cur_input.sighash_type)) {
+        if (sighash_type_field->value_len != 4) {
             PRINTF("Malformed PSBT_IN_SIGHASH_TYPE for input %d\n", state->cur_input_index);
 
             SEND_SW(dc, SW_INCORRECT_DATA);
             return;
         }
+        state->cur_input.sighash_type = read_u32_le(sighash_type_raw, 0);
     }
 
-    // TODO: add support for other sighash flags
-    if (state->cur_input.sighash_type != SIGHASH_ALL) {
-        PRINTF("Only SIGHASH_ALL is currently supported\n");
-        SEND_SW(dc, SW_NOT_SUPPORTED);
-        return;
+    // For taproot inputs, the amount and the scriptPubKey of the input are only part of the sighash
+    // with SIGHASH_ANYONECANPAY: otherwise, they are committed by the tx-wide hashes, and the
+    // scriptPubKey was already checked to be the wallet's P2TR script in check_input_owned.
+    if (state->cur_input.has_witnessUtxo &&
+        (state->wallet_policy_map.type != TOKEN_TR ||
+         (state->cur_input.sighash_type & SIGHASH_ANYONECANPAY) != 0)) {
+        uint8_t raw_witnessUtxo[8 + 1 + MAX_PREVOUT_SCRIPTPUBKEY_LEN];
+        int wit_utxo_len = call_get_trusted_merkle_leaf_element(dc,
+                                                                witness_utxo_hash,
+                                                                raw_witnessUtxo,
+                                                                sizeof(raw_witnessUtxo));
+        if (wit_utxo_len < 9 || wit_utxo_len != 8 + 1 + raw_witnessUtxo[8]) {
+            PRINTF("Invalid witness utxo\n");
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return;
+        }
+
+        // Validation of the witness-utxo was already done during input processing
+        state->cur_input.prevout_amount = read_u64_le(raw_witnessUtxo, 0);
+        state->cur_input.prevout_scriptpubkey_len = raw_witnessUtxo[8];
+        memcpy(state->cur_input.prevout_scriptpubkey,
+               raw_witnessUtxo + 9,
+               state->cur_input.prevout_scriptpubkey_len);
     }
 
-    // get path, obtain change and address_index
+    // the sighash type was already validated in check_input_owned
 
-    int bip32_path_len;
-    uint32_t bip32_path[MAX_BIP32_PATH_STEPS];
-    uint32_t fingerprint;
+    const sign_psbt_input_path_t *input_path = find_input_path(state, state->cur_input_index);
+    if (input_path != NULL) {
+        // the change and address index were kept when the input was verified
+        state->cur_input.change = input_path->change;
+        state->cur_input.address_index = input_path->address_index;
+    } else {
+        // get path, obtain change and address_index
 
-    if (state->wallet_policy_map.type == TOKEN_TR) {
-        // taproot input, use PSBT_IN_TAP_BIP32_DERIVATION
-        uint8_t key[1 + 32];
-        key[0] = PSBT_IN_TAP_BIP32_DERIVATION;
-        memcpy(key + 1, state->cur_input.bip32_derivation_pubkey, 32);
+        int bip32_path_len;
+        uint32_t bip32_path[MAX_BIP32_PATH_STEPS];
+        uint32_t fingerprint;
 
-        bip32_path_len = get_emptyhashes_fingerprint_and_path(dc,
-                                                              &state->cur_input.map,
-                                                              key,
-                                                              sizeof(key),
-                                                              &fingerprint,
-                                                              bip32_path);
-    } else {
-        // legacy or segwitv0 input, use PSBT_IN_BIP32_DERIVATION
-        uint8_t key[1 + 33];
-        key[0] = PSBT_IN_BIP32_DERIVATION;
-        memcpy(key + 1, state->cur_input.bip32_derivation_pubkey, 33);
+        // taproot inputs use PSBT_IN_TAP_BIP32_DERIVATION, legacy and segwitv0 inputs use
+        // PSBT_IN_BIP32_DERIVATION
+        bip32_path_len =
+            get_cur_input_fingerprint_and_path(dc,
+                                               state,
+                                               state->wallet_policy_map.type == TOKEN_TR,
+                                               &fingerprint,
+                                               bip32_path);
 
-        bip32_path_len = get_fingerprint_and_path(dc,
-                                                  &state->cur_input.map,
-                                                  key,
-                                                  sizeof(key),
-                                                  &fingerprint,
-                                                  bip32_path);
-    }
+        if (bip32_path_len < 2) {
+            SEND_SW(dc, SW_BAD_STATE);
+            return;
+        }
 
-    if (bip32_path_len < 2) {
-        SEND_SW(dc, SW_BAD_STATE);
-        return;
+        state->cur_input.change = bip32_path[bip32_path_len - 2];
+        state->cur_input.address_index = bip32_path[bip32_path_len - 1];
     }
 
-    state->cur_input.change = bip32_path[bip32_path_len - 2];
-    state->cur_input.address_index = bip32_path[bip32_path_len - 1];
-
     // Sign as segwit input iff it has a witness utxo
     if (!state->cur_input.has_witnessUtxo) {
-        dc->next(sign_legacy);
+        dc_next(dc, sign_legacy);
     } else {
-        dc->next(sign_segwit);
+        dc_next(dc, sign_segwit);
     }
 }
 
@@ -1317,146 +3173,236 @@ static void sign_legacy(dispatcher_context_t *dc) {
 
     // sign_non_witness(non_witness_utxo.vout[psbt.tx.input_[i].prevout.n].scriptPubKey, i)
 
-    // Read the prevout index
-    uint32_t prevout_n;
-    if (4 != call_get_merkleized_map_value_u32_le(dc,
-                                                  &state->cur_input.map,
-                                                  (uint8_t[]){PSBT_IN_OUTPUT_INDEX},
-                                                  1,
-                                                  &prevout_n)) {
-        SEND_SW(dc, SW_INCORRECT_DATA);
-        return;
-    }
-
-    txid_parser_outputs_t parser_outputs;
-    // request non-witness utxo, and get the prevout's value and scriptpubkey
-    int res = call_psbt_parse_rawtx(dc,
-                                    &state->cur_input.map,
-                                    (uint8_t[]){PSBT_IN_NON_WITNESS_UTXO},
-                                    1,
-                                    prevout_n,
-                                    &parser_outputs);
-    if (res < 0) {
-        SEND_SW(dc, SW_INCORRECT_DATA);
+    // The prevout's scriptPubKey was extracted from the non-witness utxo while processing the
+    // inputs, and it was checked to be the wallet's script at the same change and address_index
+    // (taken from the same committed map). Therefore, we can derive it again instead of streaming
+    // the whole non-witness utxo a second time.
+    buffer_t scriptpubkey_buf = buffer_create(state->cur_input.prevout_scriptpubkey,
+                                              sizeof(state->cur_input.prevout_scriptpubkey));
+    int scriptpubkey_len = call_get_wallet_script(dc,
+                                                  &state->wallet_policy_map,
+                                                  state->wallet_header_keys_info_merkle_root,
+                                                  state->wallet_header_n_keys,
+                                                  state->cur_input.change,
+                                                  state->cur_input.address_index,
+                                                  &scriptpubkey_buf,
+                                                  NULL);
+    if (scriptpubkey_len < 0) {
+        SEND_SW(dc, SW_BAD_STATE);  // should never happen
         return;
     }
+    state->cur_input.prevout_scriptpubkey_len = scriptpubkey_len;
 
-    state->cur_input.prevout_scriptpubkey_len = parser_outputs.vout_scriptpubkey_len;
-    memcpy(state->cur_input.prevout_scriptpubkey,
-           parser_outputs.vout_scriptpubkey,
-           parser_outputs.vout_scriptpubkey_len);
-
-    dc->next(sign_legacy_compute_sighash);
+    dc_next(dc, sign_legacy_compute_sighash);
 }
 
-static void sign_legacy_compute_sighash(dispatcher_context_t *dc) {
+// Updates the hash_context with the serialization of the i-th input in the legacy sighash preimage.
+// The scriptCode is empty for all the inputs except the one being signed. If zero_sequence is true,
+// the nSequence is 0 instead of the input's one (for the other inputs with SIGHASH_NONE and
+// SIGHASH_SINGLE).
+// returns -1 on error (in that case, a response is already set). 0 on success.
+static int hash_legacy_input(dispatcher_context_t *dc,
+                             unsigned int i,
+                             bool zero_sequence,
+                             cx_hash_t *hash_context) {
     sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
 
-    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+    // get this input's map
+    merkleized_map_commitment_t ith_map;
 
-    cx_sha256_t sighash_context;
-    cx_sha256_init(&sighash_context);
+    if (i != state->cur_input_index) {
+        int res = call_get_merkleized_map(dc, state->inputs_root, state->n_inputs, i, &ith_map);
+        if (res < 0) {
+            SEND_SW(dc, SW_INCORRECT_DATA);
+            return -1;
+        }
+    } else {
+        // Avoid requesting the same map unnecessarily
+        // (might be removed once a caching mechanism is implemented)
+        memcpy(&ith_map, &state->cur_input.map, sizeof(state->cur_input.map));
+    }
 
-    uint8_t tmp[4];
-    write_u32_le(tmp, 0, state->tx_version);
-    crypto_hash_update(&sighash_context.header, tmp, 4);
+    // get prevout hash and output index for the i-th input; for the current input, the indexes of
+    // the keys are already known
+    bool is_cur_input = i == state->cur_input_index;
+
+    uint8_t ith_prevout_hash[32];
+    if (32 != (is_cur_input ? get_cur_input_value(dc,
+                                                  state,
+                                                  state->cur_input.previous_txid_key_index,
+                                                  ith_prevout_hash,
+                                                  32)
+                            : call_get_merkleized_map_value(dc,
+                                                            &ith_map,
+                                                            (uint8_t[]){PSBT_IN_PREVIOUS_TXID},
+                                                            1,
+                                                            ith_prevout_hash,
+                                                            32))) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return -1;
+    }
 
-    crypto_hash_update_varint(&sighash_context.header, state->n_inputs);
+    crypto_hash_update(hash_context, ith_prevout_hash, 32);
 
-    for (unsigned int i = 0; i < state->n_inputs; i++) {
-        // get this input's map
-        merkleized_map_commitment_t ith_map;
+    uint8_t ith_prevout_n_raw[4];
+    if (4 != (is_cur_input ? get_cur_input_value(dc,
+                                                 state,
+                                                 state->cur_input.output_index_key_index,
+                                                 ith_prevout_n_raw,
+                                                 4)
+                           : call_get_merkleized_map_value(dc,
+                                                           &ith_map,
+                                                           (uint8_t[]){PSBT_IN_OUTPUT_INDEX},
+                                                           1,
+                                                           ith_prevout_n_raw,
+                                                           4))) {
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return -1;
+    }
+
+    crypto_hash_update(hash_context, ith_prevout_n_raw, 4);
+
+    if (!is_cur_input) {
+        // empty scriptcode
+        crypto_hash_update_u8(hash_context, 0x00);
+    } else {
+        if (!state->cur_input.has_redeemScript) {
+            // P2PKH, the script_code is the prevout's scriptPubKey
+            crypto_hash_update_varint(hash_context, state->cur_input.prevout_scriptpubkey_len);
+            crypto_hash_update(hash_context,
+                               state->cur_input.prevout_scriptpubkey,
+                               state->cur_input.prevout_scriptpubkey_len);
+        } else {
+            // P2SH, the script_code is the redeemScript
+
+            // update sighash_context with the length-prefixed redeem script
+            int redeemScript_len =
+                update_hashes_with_map_value_at_index(dc,
+                                                      &state->cur_input.map,
+                                                      state->cur_input.redeem_script_key_index,
+                                                      NULL,
+                                                      hash_context);
 
-        if (i != state->cur_input_index) {
-            int res = call_get_merkleized_map(dc, state->inputs_root, state->n_inputs, i, &ith_map);
-            if (res < 0) {
+            if (redeemScript_len < 0) {
+                PRINTF("Error fetching redeemScript\n");
                 SEND_SW(dc, SW_INCORRECT_DATA);
-                return;
+                return -1;
             }
-        } else {
-            // Avoid requesting the same map unnecessarily
-            // (might be removed once a caching mechanism is implemented)
-            memcpy(&ith_map, &state->cur_input.map, sizeof(state->cur_input.map));
-        }
-
-        // get prevout hash and output index for the i-th input
-        uint8_t ith_prevout_hash[32];
-        if (32 != call_get_merkleized_map_value(dc,
-                                                &ith_map,
-                                                (uint8_t[]){PSBT_IN_PREVIOUS_TXID},
-                                                1,
-                                                ith_prevout_hash,
-                                                32)) {
-            SEND_SW(dc, SW_INCORRECT_DATA);
-            return;
         }
+    }
+
+    // the sequences that the first pass found absent are not looked up
+    bool has_sequence =
+        !state->has_inputs_with_sequence || bitvector_get(state->inputs_with_sequence, i);
+
+    uint8_t ith_nSequence_raw[4];
+    if (zero_sequence) {
+        memset(ith_nSequence_raw, 0x00, 4);
+    } else if (!has_sequence ||
+               4 != (is_cur_input ? get_cur_input_value(dc,
+                                                        state,
+                                                        state->cur_input.sequence_key_index,
+                                                        ith_nSequence_raw,
+                                                        4)
+                                  : call_get_merkleized_map_value(dc,
+                                                                  &ith_map,
+                                                                  (uint8_t[]){PSBT_IN_SEQUENCE},
+                                                                  1,
+                                                                  ith_nSequence_raw,
+                                                                  4))) {
+        // if no PSBT_IN_SEQUENCE is present, we must assume nSequence 0xFFFFFFFF
+        memset(ith_nSequence_raw, 0xFF, 4);
+    }
+
+    crypto_hash_update(hash_context, ith_nSequence_raw, 4);
+
+    return 0;
+}
+
+static void sign_legacy_compute_sighash(dispatcher_context_t *dc) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
-        crypto_hash_update(&sighash_context.header, ith_prevout_hash, 32);
+    uint32_t sighash_type = state->cur_input.sighash_type;
+    uint32_t base_type = sighash_type & 3;
 
-        uint8_t ith_prevout_n_raw[4];
-        if (4 != call_get_merkleized_map_value(dc,
-                                               &ith_map,
-                                               (uint8_t[]){PSBT_IN_OUTPUT_INDEX},
-                                               1,
-                                               ith_prevout_n_raw,
-                                               4)) {
-            SEND_SW(dc, SW_INCORRECT_DATA);
-            return;
+    cx_sha256_t sighash_context;
+
+    if (sighash_type == SIGHASH_ALL) {
+        // Inputs are usually signed in order, therefore the part of the preimage preceding the
+        // current input is an extension of the one computed for the previous legacy input; we
+        // only add the inputs in between, instead of hashing again all the previous inputs.
+        if (state->cur_input_index < state->legacy_prefix.n_inputs) {
+            // signed out of order, with SIGN_PSBT_MODE_FLAG_INPUT_ORDER: hashed from the start
+            init_legacy_prefix(state);
         }
+        for (unsigned int i = state->legacy_prefix.n_inputs; i < state->cur_input_index; i++) {
+            if (hash_legacy_input(dc, i, false, &state->legacy_prefix.context.header) == -1) {
+                return;  // response already set
+            }
+        }
+        state->legacy_prefix.n_inputs = state->cur_input_index;
 
-        crypto_hash_update(&sighash_context.header, ith_prevout_n_raw, 4);
+        crypto_sha256_restore(&sighash_context, &state->legacy_prefix.context);
 
-        if (i != state->cur_input_index) {
-            // empty scriptcode
-            crypto_hash_update_u8(&sighash_context.header, 0x00);
+        for (unsigned int i = state->cur_input_index; i < state->n_inputs; i++) {
+            if (hash_legacy_input(dc, i, false, &sighash_context.header) == -1) {
+                return;  // response already set
+            }
+        }
+    } else {
+        // The other inputs are either omitted, or hashed with a different nSequence: the prefix
+        // shared with the SIGHASH_ALL inputs can not be used.
+        cx_sha256_init(&sighash_context);
+
+        uint8_t version_raw[4];
+        write_u32_le(version_raw, 0, state->tx_version);
+        crypto_hash_update(&sighash_context.header, version_raw, 4);
+
+        if (sighash_type & SIGHASH_ANYONECANPAY) {
+            // only the current input
+            crypto_hash_update_varint(&sighash_context.header, 1);
+            if (hash_legacy_input(dc, state->cur_input_index, false, &sighash_context.header) ==
+                -1) {
+                return;  // response already set
+            }
         } else {
-            if (!state->cur_input.has_redeemScript) {
-                // P2PKH, the script_code is the prevout's scriptPubKey
-                crypto_hash_update_varint(&sighash_context.header,
-                                          state->cur_input.prevout_scriptpubkey_len);
-                crypto_hash_update(&sighash_context.header,
-                                   state->cur_input.prevout_scriptpubkey,
-                                   state->cur_input.prevout_scriptpubkey_len);
-            } else {
-                // P2SH, the script_code is the redeemScript
-
-                // update sighash_context with the length-prefixed redeem script
-                int redeemScript_len =
-                    update_hashes_with_map_value(dc,
-                                                 &state->cur_input.map,
-                                                 (uint8_t[]){PSBT_IN_REDEEM_SCRIPT},
-                                                 1,
-                                                 NULL,
-                                                 &sighash_context.header);
-
-                if (redeemScript_len < 0) {
-                    PRINTF("Error fetching redeemScript\n");
-                    SEND_SW(dc, SW_INCORRECT_DATA);
-                    return;
+            crypto_hash_update_varint(&sighash_context.header, state->n_inputs);
+            for (unsigned int i = 0; i < state->n_inputs; i++) {
+                bool zero_sequence = base_type != SIGHASH_ALL && i != state->cur_input_index;
+                if (hash_legacy_input(dc, i, zero_sequence, &sighash_context.header) == -1) {
+                    return;  // response already set
                 }
             }
         }
-
-        uint8_t ith_nSequence_raw[4];
-        if (4 != call_get_merkleized_map_value(dc,
-                                               &ith_map,
-                                               (uint8_t[]){PSBT_IN_SEQUENCE},
-                                               1,
-                                               ith_nSequence_raw,
-                                               4)) {
-            // if no PSBT_IN_SEQUENCE is present, we must assume nSequence 0xFFFFFFFF
-            memset(ith_nSequence_raw, 0xFF, 4);
-        }
-
-        crypto_hash_update(&sighash_context.header, ith_nSequence_raw, 4);
     }
 
     // outputs
-    crypto_hash_update_varint(&sighash_context.header, state->n_outputs);
-    if (hash_outputs(dc, &sighash_context.header) == -1) {
-        return;  // response alredy set
+    if (base_type == SIGHASH_NONE) {
+        crypto_hash_update_varint(&sighash_context.header, 0);
+    } else if (base_type == SIGHASH_SINGLE) {
+        // the outputs preceding the one of the current input are replaced with empty ones, with
+        // value -1 and empty script; the following ones are omitted
+        crypto_hash_update_varint(&sighash_context.header, state->cur_input_index + 1);
+        for (unsigned int i = 0; i < state->cur_input_index; i++) {
+            uint8_t empty_output[8 + 1];
+            memset(empty_output, 0xFF, 8);
+            empty_output[8] = 0x00;
+            crypto_hash_update(&sighash_context.header, empty_output, sizeof(empty_output));
+        }
+        if (hash_single_output(dc, &sighash_context.header) == -1) {
+            return;  // response already set
+        }
+    } else {
+        crypto_hash_update_varint(&sighash_context.header, state->n_outputs);
+        if (hash_outputs(dc, &sighash_context.header) == -1) {
+            return;  // response alredy set
+        }
     }
 
+    uint8_t tmp[4];
+
     // nLocktime
     write_u32_le(tmp, 0, state->locktime);
     crypto_hash_update(&sighash_context.header, tmp, 4);
@@ -1469,7 +3415,7 @@ static void sign_legacy_compute_sighash(dispatcher_context_t *dc) {
     crypto_hash_digest(&sighash_context.header, state->sighash, 32);
     cx_hash_sha256(state->sighash, 32, state->sighash, 32);
 
-    dc->next(sign_sighash_ecdsa);
+    dc_next(dc, sign_sighash_ecdsa);
 }
 
 static void sign_segwit(dispatcher_context_t *dc) {
@@ -1477,219 +3423,74 @@ static void sign_segwit(dispatcher_context_t *dc) {
 
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
-    uint8_t segwit_version;
-
-    {
-        uint8_t raw_witnessUtxo[8 + 1 + MAX_PREVOUT_SCRIPTPUBKEY_LEN];
+    if (state->wallet_policy_map.type == TOKEN_TR) {
+        // the scriptPubKey was checked to be the wallet's P2TR script in check_input_owned; it was
+        // only fetched in sign_process_input_map if the sighash needs it
+        dc_next(dc, sign_segwit_v1);
+        return;
+    }
 
-        int wit_utxo_len = call_get_merkleized_map_value(dc,
-                                                         &state->cur_input.map,
-                                                         (uint8_t[]){PSBT_IN_WITNESS_UTXO},
-                                                         1,
-                                                         raw_witnessUtxo,
-                                                         sizeof(raw_witnessUtxo));
-        if (wit_utxo_len < 0) {
-            PRINTF("Error fetching witness utxo\n");
+    // the script used when signing, either from the witness utxo or the redeem script
+    const uint8_t *script = state->cur_input.prevout_scriptpubkey;
+    int script_len = state->cur_input.prevout_scriptpubkey_len;
+
+    // The witness utxo was already fetched in sign_process_input_map
+    uint8_t redeemScript[MAX_PREVOUT_SCRIPTPUBKEY_LEN];
+    if (state->cur_input.has_redeemScript) {
+        // Get redeemScript; for segwit inputs, it can't be longer than the supported scriptPubKeys
+        int redeemScript_length = get_cur_input_value(dc,
+                                                      state,
+                                                      state->cur_input.redeem_script_key_index,
+                                                      redeemScript,
+                                                      sizeof(redeemScript));
+        if (redeemScript_length < 0) {
+            PRINTF("Error fetching redeem script\n");
             SEND_SW(dc, SW_INCORRECT_DATA);
             return;
         }
 
-        int wit_utxo_scriptPubkey_len = raw_witnessUtxo[8];
+        uint8_t p2sh_redeemscript[2 + 20 + 1];
+        p2sh_redeemscript[0] = 0xa9;
+        p2sh_redeemscript[1] = 0x14;
+        crypto_hash160(redeemScript, redeemScript_length, p2sh_redeemscript + 2);
+        p2sh_redeemscript[22] = 0x87;
 
-        if (wit_utxo_len != 8 + 1 + wit_utxo_scriptPubkey_len) {
-            PRINTF("Length mismatch for witness utxo's scriptPubKey\n");
+        if (state->cur_input.prevout_scriptpubkey_len != 23 ||
+            memcmp(state->cur_input.prevout_scriptpubkey, p2sh_redeemscript, 23) != 0) {
+            PRINTF("witnessUtxo's scriptPubKey does not match redeemScript\n");
             SEND_SW(dc, SW_INCORRECT_DATA);
             return;
         }
 
-        uint8_t *wit_utxo_scriptPubkey = raw_witnessUtxo + 9;
-        uint64_t wit_utxo_prevout_amount = read_u64_le(&raw_witnessUtxo[0], 0);
-
-        // Validation of the witness-utxo was already done during input processing
-        state->cur_input.prevout_amount = wit_utxo_prevout_amount;
-        state->cur_input.prevout_scriptpubkey_len = wit_utxo_scriptPubkey_len;
-        memcpy(state->cur_input.prevout_scriptpubkey,
-               wit_utxo_scriptPubkey,
-               wit_utxo_scriptPubkey_len);
-
-        if (state->cur_input.has_redeemScript) {
-            // Get redeemScript
-            uint8_t redeemScript[64];
-
-            int redeemScript_length =
-                call_get_merkleized_map_value(dc,
-                                              &state->cur_input.map,
-                                              (uint8_t[]){PSBT_IN_REDEEM_SCRIPT},
-                                              1,
-                                              redeemScript,
-                                              sizeof(redeemScript));
-            if (redeemScript_length < 0) {
-                PRINTF("Error fetching redeem script\n");
-                SEND_SW(dc, SW_INCORRECT_DATA);
-                return;
-            }
-
-            uint8_t p2sh_redeemscript[2 + 20 + 1];
-            p2sh_redeemscript[0] = 0xa9;
-            p2sh_redeemscript[1] = 0x14;
-            crypto_hash160(redeemScript, redeemScript_length, p2sh_redeemscript + 2);
-            p2sh_redeemscript[22] = 0x87;
-
-            if (wit_utxo_scriptPubkey_len != 23 ||
-                memcmp(wit_utxo_scriptPubkey, p2sh_redeemscript, 23) != 0) {
-                PRINTF("witnessUtxo's scriptPubKey does not match redeemScript\n");
-                SEND_SW(dc, SW_INCORRECT_DATA);
-                return;
-            }
-
-            state->cur_input.script_len = redeemScript_length;
-            memcpy(state->cur_input.script, redeemScript, redeemScript_length);
-            segwit_version = get_segwit_version(redeemScript, redeemScript_length);
-        } else {
-            state->cur_input.script_len = wit_utxo_scriptPubkey_len;
-            memcpy(state->cur_input.script, wit_utxo_scriptPubkey, wit_utxo_scriptPubkey_len);
-
-            segwit_version = get_segwit_version(wit_utxo_scriptPubkey, wit_utxo_scriptPubkey_len);
-        }
+        script = redeemScript;
+        script_len = redeemScript_length;
     }
 
+    script_info_t script_info;
+    classify_script(script, script_len, &script_info);
+    int segwit_version = script_info.segwit_version;
+
     if (segwit_version > 1) {
         PRINTF("Segwit version not supported: %d\n", segwit_version);
         SEND_SW(dc, SW_NOT_SUPPORTED);
         return;
     }
 
-    // compute all the tx-wide hashes
-
-    {
-        // compute sha_prevouts and sha_sequences
-        cx_sha256_t sha_prevouts_context, sha_sequences_context;
-
-        // compute hashPrevouts and hashSequence
-        cx_sha256_init(&sha_prevouts_context);
-        cx_sha256_init(&sha_sequences_context);
-
-        for (unsigned int i = 0; i < state->n_inputs; i++) {
-            // get this input's map
-            merkleized_map_commitment_t ith_map;
-
-            int res = call_get_merkleized_map(dc, state->inputs_root, state->n_inputs, i, &ith_map);
-            if (res < 0) {
-                SEND_SW(dc, SW_INCORRECT_DATA);
-                return;
-            }
-
-            // get prevout hash and output index for the i-th input
-            uint8_t ith_prevout_hash[32];
-            if (32 != call_get_merkleized_map_value(dc,
-                                                    &ith_map,
-                                                    (uint8_t[]){PSBT_IN_PREVIOUS_TXID},
-                                                    1,
-                                                    ith_prevout_hash,
-                                                    32)) {
-                SEND_SW(dc, SW_INCORRECT_DATA);
-                return;
-            }
-
-            crypto_hash_update(&sha_prevouts_context.header, ith_prevout_hash, 32);
-
-            uint8_t ith_prevout_n_raw[4];
-            if (4 != call_get_merkleized_map_value(dc,
-                                                   &ith_map,
-                                                   (uint8_t[]){PSBT_IN_OUTPUT_INDEX},
-                                                   1,
-                                                   ith_prevout_n_raw,
-                                                   4)) {
-                SEND_SW(dc, SW_INCORRECT_DATA);
-                return;
-            }
-
-            crypto_hash_update(&sha_prevouts_context.header, ith_prevout_n_raw, 4);
-
-            uint8_t ith_nSequence_raw[4];
-            if (4 != call_get_merkleized_map_value(dc,
-                                                   &ith_map,
-                                                   (uint8_t[]){PSBT_IN_SEQUENCE},
-                                                   1,
-                                                   ith_nSequence_raw,
-                                                   4)) {
-                // if no PSBT_IN_SEQUENCE is present, we must assume nSequence 0xFFFFFFFF
-                memset(ith_nSequence_raw, 0xFF, 4);
-            }
-
-            crypto_hash_update(&sha_sequences_context.header, ith_nSequence_raw, 4);
-        }
-
-        crypto_hash_digest(&sha_prevouts_context.header, state->hashes.sha_prevouts, 32);
-        crypto_hash_digest(&sha_sequences_context.header, state->hashes.sha_sequences, 32);
-    }
-
-    {
-        // compute sha_outputs
-        cx_sha256_t sha_outputs_context;
-        cx_sha256_init(&sha_outputs_context);
-
-        if (hash_outputs(dc, &sha_outputs_context.header) == -1) {
-            return;
-        }
-
-        crypto_hash_digest(&sha_outputs_context.header, state->hashes.sha_outputs, 32);
-    }
-
-    {
-        // compute sha_amounts and sha_scriptpubkeys
-        // TODO: could be skipped if there are no segwitv1 inputs to sign
-
-        cx_sha256_t sha_amounts_context, sha_scriptpubkeys_context;
-
-        cx_sha256_init(&sha_amounts_context);
-        cx_sha256_init(&sha_scriptpubkeys_context);
-
-        for (unsigned int i = 0; i < state->n_inputs; i++) {
-            // get this input's map
-            merkleized_map_commitment_t ith_map;
-
-            int res = call_get_merkleized_map(dc, state->inputs_root, state->n_inputs, i, &ith_map);
-            if (res < 0) {
-                SEND_SW(dc, SW_INCORRECT_DATA);
-                return;
-            }
-
-            // get prevout hash and output index for the i-th input
-            uint8_t wit_utxo[8 + 1 + MAX_PREVOUT_SCRIPTPUBKEY_LEN];
-            int ret = call_get_merkleized_map_value(dc,
-                                                    &ith_map,
-                                                    (uint8_t[]){PSBT_IN_WITNESS_UTXO},
-                                                    1,
-                                                    wit_utxo,
-                                                    sizeof(wit_utxo));
-            if (ret < 9) {
-                SEND_SW(dc, SW_INCORRECT_DATA);
-                return;
-            }
-            uint8_t scriptPubKey_len = wit_utxo[8];
-            if (ret != 8 + 1 + scriptPubKey_len) {
-                SEND_SW(dc, SW_INCORRECT_DATA);
-                return;
-            }
-
-            uint8_t *scriptPubKey = wit_utxo + 9;
-
-            crypto_hash_update(&sha_amounts_context.header, wit_utxo, 8);
-
-            crypto_hash_update_varint(&sha_scriptpubkeys_context.header, scriptPubKey_len);
-            crypto_hash_update(&sha_scriptpubkeys_context.header, scriptPubKey, scriptPubKey_len);
-        }
-
-        crypto_hash_digest(&sha_amounts_context.header, state->hashes.sha_amounts, 32);
-        crypto_hash_digest(&sha_scriptpubkeys_context.header, state->hashes.sha_scriptpubkeys, 32);
+    // only the witness program is kept; the ones of the supported versions are at most 32 bytes
+    if (script_len < 2 + 2 || script[1] != script_len - 2 ||
+        script_len - 2 > (int) sizeof(state->cur_input.witness_program)) {
+        PRINTF("Invalid or unsupported script in segwit transaction\n");
+        SEND_SW(dc, SW_INCORRECT_DATA);
+        return;
     }
+    state->cur_input.witness_program_len = script_len - 2;
+    memcpy(state->cur_input.witness_program, script + 2, state->cur_input.witness_program_len);
 
     if (segwit_version == 0) {
-        dc->next(sign_segwit_v0);
+        dc_next(dc, sign_segwit_v0);
         return;
     } else if (segwit_version == 1) {
-        dc->next(sign_segwit_v1);
+        dc_next(dc, sign_segwit_v1);
 
         return;
     }
@@ -1703,38 +3504,32 @@ static void sign_segwit_v0(dispatcher_context_t *dc) {
 
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
+    uint32_t sighash_type = state->cur_input.sighash_type;
+
     cx_sha256_t sighash_context;
-    cx_sha256_init(&sighash_context);
+    if (sighash_type == SIGHASH_ALL) {
+        // nVersion, hashPrevouts and hashSequence were already absorbed in compute_segwit_hashes
+        crypto_sha256_restore(&sighash_context, &state->segwit_v0_prefix);
+    } else {
+        hash_segwit_v0_prefix(sighash_type, &sighash_context);
+    }
 
     uint8_t tmp[8];
 
-    // nVersion
-    write_u32_le(tmp, 0, state->tx_version);
-    crypto_hash_update(&sighash_context.header, tmp, 4);
-
-    {
-        uint8_t dbl_hash[32];
-
-        // add to hash: hashPrevouts = sha256(sha_prevouts)
-        cx_hash_sha256(state->hashes.sha_prevouts, 32, dbl_hash, 32);
-        crypto_hash_update(&sighash_context.header, dbl_hash, 32);
-
-        // add to hash: hashSequence sha256(sha_sequences)
-        cx_hash_sha256(state->hashes.sha_sequences, 32, dbl_hash, 32);
-        crypto_hash_update(&sighash_context.header, dbl_hash, 32);
-    }
-
-    {
+    if (state->cur_input_record != NULL) {
+        // outpoint, from the record of the input
+        crypto_hash_update(&sighash_context.header, state->cur_input_record->prevout_hash, 32);
+        crypto_hash_update(&sighash_context.header, state->cur_input_record->prevout_n, 4);
+    } else {
         // outpoint (32-byte prevout hash, 4-byte index)
 
         // get prevout hash and output index for the current input
         uint8_t prevout_hash[32];
-        if (32 != call_get_merkleized_map_value(dc,
-                                                &state->cur_input.map,
-                                                (uint8_t[]){PSBT_IN_PREVIOUS_TXID},
-                                                1,
-                                                prevout_hash,
-                                                32)) {
+        if (32 != get_cur_input_value(dc,
+                                      state,
+                                      state->cur_input.previous_txid_key_index,
+                                      prevout_hash,
+                                      32)) {
             SEND_SW(dc, SW_INCORRECT_DATA);
             return;
         }
@@ -1742,12 +3537,11 @@ static void sign_segwit_v0(dispatcher_context_t *dc) {
         crypto_hash_update(&sighash_context.header, prevout_hash, 32);
 
         uint8_t prevout_n_raw[4];
-        if (4 != call_get_merkleized_map_value(dc,
-                                               &state->cur_input.map,
-                                               (uint8_t[]){PSBT_IN_OUTPUT_INDEX},
-                                               1,
-                                               prevout_n_raw,
-                                               4)) {
+        if (4 != get_cur_input_value(dc,
+                                     state,
+                                     state->cur_input.output_index_key_index,
+                                     prevout_n_raw,
+                                     4)) {
             SEND_SW(dc, SW_INCORRECT_DATA);
             return;
         }
@@ -1756,12 +3550,12 @@ static void sign_segwit_v0(dispatcher_context_t *dc) {
     }
 
     // scriptCode
-    if (is_p2wpkh(state->cur_input.script, state->cur_input.script_len)) {
-        // P2WPKH(script[2:22])
+    if (state->cur_input.witness_program_len == 20) {
+        // P2WPKH(witness_program)
         crypto_hash_update_u32(&sighash_context.header, 0x1976a914);
-        crypto_hash_update(&sighash_context.header, state->cur_input.script + 2, 20);
+        crypto_hash_update(&sighash_context.header, state->cur_input.witness_program, 20);
         crypto_hash_update_u16(&sighash_context.header, 0x88ac);
-    } else if (is_p2wsh(state->cur_input.script, state->cur_input.script_len)) {
+    } else if (state->cur_input.witness_program_len == 32) {
         // P2WSH
 
         // update sighash_context.header with the length-prefixed witnessScript,
@@ -1769,12 +3563,16 @@ static void sign_segwit_v0(dispatcher_context_t *dc) {
         cx_sha256_t witnessScript_hash_context;
         cx_sha256_init(&witnessScript_hash_context);
 
-        int witnessScript_len = update_hashes_with_map_value(dc,
-                                                             &state->cur_input.map,
-                                                             (uint8_t[]){PSBT_IN_WITNESS_SCRIPT},
-                                                             1,
-                                                             &witnessScript_hash_context.header,
-                                                             &sighash_context.header);
+        const hash_sink_t sinks[] = {
+            make_hash_sink(&witnessScript_hash_context.header, false),
+            make_hash_sink(&sighash_context.header, true),
+        };
+        int witnessScript_len =
+            update_hash_sinks_with_map_value_at_index(dc,
+                                                      &state->cur_input.map,
+                                                      state->cur_input.witness_script_key_index,
+                                                      sinks,
+                                                      sizeof(sinks) / sizeof(sinks[0]));
 
         if (witnessScript_len < 0) {
             PRINTF("Error fetching witnessScript\n");
@@ -1785,10 +3583,8 @@ static void sign_segwit_v0(dispatcher_context_t *dc) {
         uint8_t witnessScript_hash[32];
         crypto_hash_digest(&witnessScript_hash_context.header, witnessScript_hash, 32);
 
-        // check that script == P2WSH(witnessScript)
-        if (state->cur_input.script_len != 2 + 32 || state->cur_input.script[0] != 0x00 ||
-            state->cur_input.script[1] != 0x20 ||
-            memcmp(state->cur_input.script + 2, witnessScript_hash, 32) != 0) {
+        // check that the witness program is sha256(witnessScript)
+        if (memcmp(state->cur_input.witness_program, witnessScript_hash, 32) != 0) {
             PRINTF("Mismatching witnessScript\n");
 
             SEND_SW(dc, SW_INCORRECT_DATA);
@@ -1800,35 +3596,20 @@ static void sign_segwit_v0(dispatcher_context_t *dc) {
         return;
     }
 
-    {
-        // input value, taken from the WITNESS_UTXO field
-        uint8_t witness_utxo[8 + 1 + MAX_PREVOUT_SCRIPTPUBKEY_LEN];
-
-        int witness_utxo_len = call_get_merkleized_map_value(dc,
-                                                             &state->cur_input.map,
-                                                             (uint8_t[]){PSBT_IN_WITNESS_UTXO},
-                                                             1,
-                                                             witness_utxo,
-                                                             sizeof(witness_utxo));
-        if (witness_utxo_len < 8) {
-            SEND_SW(dc, SW_INCORRECT_DATA);
-            return;
-        }
-
-        crypto_hash_update(&sighash_context.header,
-                           witness_utxo,
-                           8);  // only the first 8 bytes (amount)
-    }
+    // input value, taken from the WITNESS_UTXO field in sign_process_input_map
+    write_u64_le(tmp, 0, state->cur_input.prevout_amount);
+    crypto_hash_update(&sighash_context.header, tmp, 8);
 
     // nSequence
-    {
+    if (state->cur_input_record != NULL) {
+        crypto_hash_update(&sighash_context.header, state->cur_input_record->sequence, 4);
+    } else {
         uint8_t nSequence_raw[4];
-        if (4 != call_get_merkleized_map_value(dc,
-                                               &state->cur_input.map,
-                                               (uint8_t[]){PSBT_IN_SEQUENCE},
-                                               1,
-                                               nSequence_raw,
-                                               4)) {
+        if (4 != get_cur_input_value(dc,
+                                     state,
+                                     state->cur_input.sequence_key_index,
+                                     nSequence_raw,
+                                     4)) {
             // if no PSBT_IN_SEQUENCE is present, we must assume nSequence 0xFFFFFFFF
             memset(nSequence_raw, 0xFF, 4);
         }
@@ -1836,10 +3617,23 @@ static void sign_segwit_v0(dispatcher_context_t *dc) {
     }
 
     {
-        // compute hashOutputs = sha256(sha_outputs)
-
         uint8_t hashOutputs[32];
-        cx_hash_sha256(state->hashes.sha_outputs, 32, hashOutputs, 32);
+
+        if ((sighash_type & 3) == SIGHASH_NONE) {
+            memset(hashOutputs, 0, 32);
+        } else if ((sighash_type & 3) == SIGHASH_SINGLE) {
+            // hashOutputs is the double sha256 of the output with the same index as the input
+            cx_sha256_t output_hash_context;
+            cx_sha256_init(&output_hash_context);
+            if (hash_single_output(dc, &output_hash_context.header) == -1) {
+                return;  // response already set
+            }
+            crypto_hash_digest(&output_hash_context.header, hashOutputs, 32);
+            cx_hash_sha256(hashOutputs, 32, hashOutputs, 32);
+        } else {
+            // compute hashOutputs = sha256(sha_outputs)
+            cx_hash_sha256(state->hashes.sha_outputs, 32, hashOutputs, 32);
+        }
 
         crypto_hash_update(&sighash_context.header, hashOutputs, 32);
     }
@@ -1856,16 +3650,19 @@ static void sign_segwit_v0(dispatcher_context_t *dc) {
     crypto_hash_digest(&sighash_context.header, state->sighash, 32);
     cx_hash_sha256(state->sighash, 32, state->sighash, 32);
 
-    dc->next(sign_sighash_ecdsa);
+    dc_next(dc, sign_sighash_ecdsa);
 }
 
-static void sign_segwit_v1(dispatcher_context_t *dc) {
+// Computes the BIP341 sighash of the current input, either for the key path or, if tapleaf_hash is
+// not NULL, for the script path spending the tapscript with that TapLeaf hash.
+// Returns -1 on error, after setting the response.
+static int compute_taproot_sighash(dispatcher_context_t *dc,
+                                   const uint8_t *tapleaf_hash,
+                                   uint8_t out[static 32]) {
     sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
 
-    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
-
     cx_sha256_t sighash_context;
-    crypto_tr_tagged_hash_init(&sighash_context, BIP0341_sighash_tag, sizeof(BIP0341_sighash_tag));
+    crypto_tr_tagged_hash_init(&sighash_context, BIP0341_tapsighash_tag_hash);
     // the first 0x00 byte is not part of SigMsg
     crypto_hash_update_u8(&sighash_context.header, 0x00);
 
@@ -1894,31 +3691,29 @@ static void sign_segwit_v1(dispatcher_context_t *dc) {
         crypto_hash_update(&sighash_context.header, state->hashes.sha_outputs, 32);
     }
 
-    // annex and ext_flags not supported, so spend_type = 0
-    crypto_hash_update_u8(&sighash_context.header, 0x00);
+    // annex not supported, so spend_type = 2 * ext_flag, with ext_flag = 1 for the script path
+    crypto_hash_update_u8(&sighash_context.header, tapleaf_hash != NULL ? 0x02 : 0x00);
 
     if ((sighash_byte & 0x80) == SIGHASH_ANYONECANPAY) {
         // outpoint (hash)
-        if (32 != call_get_merkleized_map_value(dc,
-                                                &state->cur_input.map,
-                                                (uint8_t[]){PSBT_IN_PREVIOUS_TXID},
-                                                1,
-                                                tmp,
-                                                32)) {
+        if (32 != get_cur_input_value(dc,
+                                      state,
+                                      state->cur_input.previous_txid_key_index,
+                                      tmp,
+                                      32)) {
             SEND_SW(dc, SW_INCORRECT_DATA);
-            return;
+            return -1;
         }
         crypto_hash_update(&sighash_context.header, tmp, 32);
 
         // outpoint (output index)
-        if (4 != call_get_merkleized_map_value(dc,
-                                               &state->cur_input.map,
-                                               (uint8_t[]){PSBT_IN_OUTPUT_INDEX},
-                                               1,
-                                               tmp,
-                                               4)) {
+        if (4 != get_cur_input_value(dc,
+                                     state,
+                                     state->cur_input.output_index_key_index,
+                                     tmp,
+                                     4)) {
             SEND_SW(dc, SW_INCORRECT_DATA);
-            return;
+            return -1;
         }
         crypto_hash_update(&sighash_context.header, tmp, 4);
 
@@ -1926,18 +3721,19 @@ static void sign_segwit_v1(dispatcher_context_t *dc) {
         write_u64_le(tmp, 0, state->cur_input.prevout_amount);
         crypto_hash_update(&sighash_context.header, tmp, 8);
 
-        // scriptPubKey
+        // scriptPubKey, serialized as in a CTxOut
+        crypto_hash_update_varint(&sighash_context.header,
+                                  state->cur_input.prevout_scriptpubkey_len);
         crypto_hash_update(&sighash_context.header,
                            state->cur_input.prevout_scriptpubkey,
                            state->cur_input.prevout_scriptpubkey_len);
 
         // nSequence
-        if (4 != call_get_merkleized_map_value(dc,
-                                               &state->cur_input.map,
-                                               (uint8_t[]){PSBT_IN_SEQUENCE},
-                                               1,
-                                               tmp,
-                                               4)) {
+        if (4 != get_cur_input_value(dc,
+                                     state,
+                                     state->cur_input.sequence_key_index,
+                                     tmp,
+                                     4)) {
             // if no PSBT_IN_SEQUENCE is present, we must assume nSequence 0xFFFFFFFF
             memset(tmp, 0xFF, 4);
         }
@@ -1950,171 +3746,376 @@ static void sign_segwit_v1(dispatcher_context_t *dc) {
 
     // no annex
 
-    // TODO: SIGHASH_SINGLE not implemented
+    if ((sighash_byte & 3) == SIGHASH_SINGLE) {
+        // sha_single_output: the sha256 of the output with the same index as the input
+        cx_sha256_t output_hash_context;
+        cx_sha256_init(&output_hash_context);
+        if (hash_single_output(dc, &output_hash_context.header) == -1) {
+            return -1;  // response already set
+        }
+        crypto_hash_digest(&output_hash_context.header, tmp, 32);
+        crypto_hash_update(&sighash_context.header, tmp, 32);
+    }
 
-    crypto_hash_digest(&sighash_context.header, state->sighash, 32);
+    if (tapleaf_hash != NULL) {
+        // tapleaf_hash, key_version = 0x00 and codesep_pos = 0xffffffff (no OP_CODESEPARATOR)
+        crypto_hash_update(&sighash_context.header, tapleaf_hash, 32);
+        crypto_hash_update_u8(&sighash_context.header, 0x00);
+        memset(tmp, 0xFF, 4);
+        crypto_hash_update(&sighash_context.header, tmp, 4);
+    }
 
-    dc->next(sign_sighash_schnorr);
+    crypto_hash_digest(&sighash_context.header, out, 32);
+    return 0;
 }
 
-// Common for legacy and segwitv0 transactions
-static void sign_sighash_ecdsa(dispatcher_context_t *dc) {
+static void sign_segwit_v1(dispatcher_context_t *dc) {
     sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
 
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
-    cx_ecfp_private_key_t private_key = {0};
-    uint8_t chain_code[32] = {0};
-    uint32_t info = 0;
-
-    uint32_t sign_path[MAX_BIP32_PATH_STEPS];
-    for (int i = 0; i < state->our_key_derivation_length; i++) {
-        sign_path[i] = state->our_key_derivation[i];
+    // sighash for the key path; the script path sighashes are computed for each key, if needed
+    if (compute_taproot_sighash(dc, NULL, state->sighash) < 0) {
+        return;  // response already set
     }
-    sign_path[state->our_key_derivation_length] = state->cur_input.change;
-    sign_path[state->our_key_derivation_length + 1] = state->cur_input.address_index;
-
-    int sign_path_len = state->our_key_derivation_length + 2;
 
-    uint8_t sig[MAX_DER_SIG_LEN];
+    dc_next(dc, sign_sighash_schnorr);
+}
 
-    int sig_len = 0;
-    bool error = false;
-    BEGIN_TRY {
-        TRY {
-            crypto_derive_private_key(&private_key, chain_code, sign_path, sign_path_len);
-            sig_len = cx_ecdsa_sign(&private_key,
-                                    CX_RND_RFC6979,
-                                    CX_SHA256,
-                                    state->sighash,
-                                    32,
-                                    sig,
-                                    MAX_DER_SIG_LEN,
-                                    &info);
-        }
-        CATCH_ALL {
-            error = true;
-        }
-        FINALLY {
-            explicit_bzero(&private_key, sizeof(private_key));
-        }
+// Common for legacy and segwitv0 transactions
+// Computes the path of the key used to sign the current input with one of our keys, appending the
+// change and address_index of the input to the key origin derivation; returns its length.
+static int get_sign_path(const sign_psbt_state_t *state,
+                         const internal_key_derivation_t *our_key,
+                         uint32_t sign_path[static MAX_BIP32_PATH_STEPS]) {
+    for (int i = 0; i < our_key->derivation_length; i++) {
+        sign_path[i] = our_key->derivation[i];
     }
-    END_TRY;
+    sign_path[our_key->derivation_length] = state->cur_input.change;
+    sign_path[our_key->derivation_length + 1] = state->cur_input.address_index;
 
-    if (error) {
-        // unexpected error when signing
-        SEND_SW(dc, SW_BAD_STATE);
-        return;
+    return our_key->derivation_length + 2;
+}
+
+// Sends the buffered signatures with a single YIELD; returns false on error.
+static bool flush_yield_buffer(dispatcher_context_t *dc) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    if (state->yield_buffer_len == 0) {
+        return true;
     }
 
-    // yield signature
     uint8_t cmd = CCMD_YIELD;
-    dc->add_to_response(&cmd, 1);
-    uint8_t input_index = (uint8_t) state->cur_input_index;
-    dc->add_to_response(&input_index, 1);
-    dc->add_to_response(&sig, sig_len);
-    uint8_t sighash_byte = (uint8_t) (state->cur_input.sighash_type & 0xFF);
-    dc->add_to_response(&sighash_byte, 1);
-    dc->finalize_response(SW_INTERRUPTED_EXECUTION);
+    dc_add_to_response(dc, &cmd, 1);
+    dc_add_to_response(dc, state->yield_buffer, state->yield_buffer_len);
+    dc_finalize_response(dc, SW_INTERRUPTED_EXECUTION);
 
-    if (dc->process_interruption(dc) < 0) {
-        SEND_SW(dc, SW_BAD_STATE);
-        return;
+    state->yield_buffer_len = 0;
+    return dc_process_interruption(dc) >= 0;
+}
+
+// With SIGN_PSBT_MODE_FLAG_PROGRESS, yields the progress of a phase if done is 0, a multiple of
+// SIGN_PSBT_PROGRESS_INTERVAL, or total; returns false on error.
+static bool yield_progress(dispatcher_context_t *dc,
+                           uint8_t phase,
+                           unsigned int done,
+                           unsigned int total) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    if (!state->yield_progress || (done % SIGN_PSBT_PROGRESS_INTERVAL != 0 && done != total)) {
+        return true;
     }
 
-    ++state->cur_input_index;
-    dc->next(sign_process_input_map);
+    uint8_t event[1 + SIGN_PSBT_PROGRESS_LEN];
+    event[0] = CCMD_YIELD;
+    event[1] = phase;
+    write_u32_le(event, 2, done);
+    write_u32_le(event, 6, total);
+    dc_add_to_response(dc, event, sizeof(event));
+    dc_finalize_response(dc, SW_INTERRUPTED_EXECUTION);
+
+    return dc_process_interruption(dc) >= 0;
 }
 
-// Signing for segwitv1 (taproot)
-static void sign_sighash_schnorr(dispatcher_context_t *dc) {
+// Yields the signature of the current input, followed by the sighash byte if it is not 0; with
+// coalesced yields, the signature is only buffered (and the buffer is sent first if it is full).
+// Returns false on error.
+static bool yield_signature(dispatcher_context_t *dc,
+                            const uint8_t *sig,
+                            size_t sig_len,
+                            uint8_t sighash_byte) {
     sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
 
-    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+    // the input index is a varint, as inputs beyond the 256th can be signed
+    uint8_t input_index[3];
+    int input_index_len = varint_write(input_index, 0, state->cur_input_index);
+    uint8_t entry_len = (uint8_t) (input_index_len + sig_len + (sighash_byte != 0x00 ? 1 : 0));
+
+    if (!state->coalesce_yields) {
+        uint8_t cmd = CCMD_YIELD;
+        dc_add_to_response(dc, &cmd, 1);
+        dc_add_to_response(dc, input_index, input_index_len);
+        dc_add_to_response(dc, sig, sig_len);
+        if (sighash_byte != 0x00) {
+            dc_add_to_response(dc, &sighash_byte, 1);
+        }
+        dc_finalize_response(dc, SW_INTERRUPTED_EXECUTION);
 
-    cx_ecfp_private_key_t private_key = {0};
-    uint8_t *seckey = private_key.d;  // convenience alias (entirely within the private_key struct)
+        return dc_process_interruption(dc) >= 0;
+    }
 
-    uint8_t chain_code[32] = {0};
+    if (state->yield_buffer_len + 1 + entry_len > SIGN_PSBT_YIELD_BUFFER_SIZE &&
+        !flush_yield_buffer(dc)) {
+        return false;
+    }
 
-    uint32_t sign_path[MAX_BIP32_PATH_STEPS];
-    for (int i = 0; i < state->our_key_derivation_length; i++) {
-        sign_path[i] = state->our_key_derivation[i];
+    uint8_t *entry = state->yield_buffer + state->yield_buffer_len;
+    entry[0] = entry_len;
+    memcpy(entry + 1, input_index, input_index_len);
+    memcpy(entry + 1 + input_index_len, sig, sig_len);
+    if (sighash_byte != 0x00) {
+        entry[1 + input_index_len + sig_len] = sighash_byte;
     }
-    sign_path[state->our_key_derivation_length] = state->cur_input.change;
-    sign_path[state->our_key_derivation_length + 1] = state->cur_input.address_index;
+    state->yield_buffer_len += 1 + entry_len;
+    return true;
+}
 
-    int sign_path_len = state->our_key_derivation_length + 2;
+// Signs the sighash of the current input with each of our keys, yielding a signature for each.
+static void sign_sighash_ecdsa(dispatcher_context_t *dc) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
 
-    uint8_t sig[64];
-    size_t sig_len;
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
-    bool error = false;
-    BEGIN_TRY {
-        TRY {
-            crypto_derive_private_key(&private_key, chain_code, sign_path, sign_path_len);
-            crypto_tr_tweak_seckey(seckey);
-
-            unsigned int err = cx_ecschnorr_sign_no_throw(&private_key,
-                                                          CX_ECSCHNORR_BIP0340 | CX_RND_TRNG,
-                                                          CX_SHA256,
-                                                          state->sighash,
-                                                          32,
-                                                          sig,
-                                                          &sig_len);
-            if (err != CX_OK) {
-                PRINTF("Signature error: %08X\n", err);
-                SEND_SW(dc, SW_BAD_STATE);
-                return;
+    for (unsigned int k = 0; k < state->n_our_keys; k++) {
+        cx_ecfp_private_key_t private_key = {0};
+        uint8_t chain_code[32] = {0};
+        uint32_t info = 0;
+
+        uint32_t sign_path[MAX_BIP32_PATH_STEPS];
+        int sign_path_len = get_sign_path(state, &state->our_keys[k], sign_path);
+
+        uint8_t sig[MAX_DER_SIG_LEN];
+
+        int sig_len = 0;
+        bool error = false;
+        BEGIN_TRY {
+            TRY {
+                crypto_derive_private_key(&private_key, chain_code, sign_path, sign_path_len);
+                sig_len = cx_ecdsa_sign(&private_key,
+                                        CX_RND_RFC6979,
+                                        CX_SHA256,
+                                        state->sighash,
+                                        32,
+                                        sig,
+                                        MAX_DER_SIG_LEN,
+                                        &info);
+            }
+            CATCH_ALL {
+                error = true;
+            }
+            FINALLY {
+                explicit_bzero(&private_key, sizeof(private_key));
             }
         }
-        CATCH_ALL {
-            error = true;
+        END_TRY;
+
+        if (error) {
+            // unexpected error when signing
+            SEND_SW(dc, SW_BAD_STATE);
+            return;
         }
-        FINALLY {
-            explicit_bzero(&private_key, sizeof(private_key));
+
+        // the sighash byte is never omitted, as SIGHASH_DEFAULT is only valid for taproot
+        uint8_t sighash_byte = (uint8_t) (state->cur_input.sighash_type & 0xFF);
+        if (!yield_signature(dc, sig, sig_len, sighash_byte)) {
+            SEND_SW(dc, SW_BAD_STATE);
+            return;
         }
     }
-    END_TRY;
 
-    if (error) {
-        // unexpected error when signing
-        SEND_SW(dc, SW_BAD_STATE);
-        return;
+    next_sign_position(state);
+    dc_next(dc, sign_process_input_map);
+}
+
+// Gets the hash of the taproot tree of the wallet policy needed to sign the current input with one
+// of our keys: the Merkle root for the internal key, otherwise the TapLeaf hash of its tapscript.
+// Returns 1 on success, 0 if the key is in no tapscript, -1 on error.
+static int get_taptree_hash(dispatcher_context_t *dc,
+                            const internal_key_derivation_t *our_key,
+                            bool is_internal_key,
+                            uint8_t out[static 32]) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    uint32_t change = (uint32_t) state->cur_input.change;
+    uint32_t address_index = (uint32_t) state->cur_input.address_index;
+
+    for (unsigned int i = 0; i < TAPTREE_HASH_CACHE_SIZE; i++) {
+        const taptree_hash_cache_entry_t *entry = &state->taptree_hashes[i];
+        if (entry->is_valid && entry->key_index == our_key->key_index &&
+            entry->change == change && entry->address_index == address_index) {
+            memcpy(out, entry->hash, 32);
+            return 1;
+        }
     }
 
-    if (sig_len != 64) {
-        PRINTF("SIG LEN: %d\n", sig_len);
-        SEND_SW(dc, SW_BAD_STATE);
-        return;
+    int ret = call_get_taptree_hash(dc,
+                                    get_wallet_taptree(state),
+                                    state->wallet_header_keys_info_merkle_root,
+                                    state->wallet_header_n_keys,
+                                    change,
+                                    address_index,
+                                    &state->tapleaf_midstate,
+                                    is_internal_key ? -1 : our_key->key_index,
+                                    out);
+    if (ret != 1) {
+        return ret;
     }
 
-    // yield signature
-    uint8_t cmd = CCMD_YIELD;
-    dc->add_to_response(&cmd, 1);
-    uint8_t input_index = (uint8_t) state->cur_input_index;
-    dc->add_to_response(&input_index, 1);
-    dc->add_to_response(&sig, sizeof(sig));
+    taptree_hash_cache_entry_t *entry = &state->taptree_hashes[state->taptree_hashes_next_slot];
+    state->taptree_hashes_next_slot =
+        (state->taptree_hashes_next_slot + 1) % TAPTREE_HASH_CACHE_SIZE;
 
-    // only append the sighash type byte if it is non-zero
-    uint8_t sighash_byte = (uint8_t) (state->cur_input.sighash_type & 0xFF);
-    if (sighash_byte != 0x00) {
-        // only add the sighash byte if not 0
-        dc->add_to_response(&sighash_byte, 1);
-    }
-    dc->finalize_response(SW_INTERRUPTED_EXECUTION);
+    entry->is_valid = true;
+    entry->key_index = our_key->key_index;
+    entry->change = change;
+    entry->address_index = address_index;
+    memcpy(entry->hash, out, 32);
+    return 1;
+}
 
-    if (dc->process_interruption(dc) < 0) {
-        SEND_SW(dc, SW_BAD_STATE);
-        return;
+// Signing for segwitv1 (taproot). For wallet policies with tapscripts, the internal key signs for
+// the key path, and each other key for the script path of its tapscript.
+static void sign_sighash_schnorr(dispatcher_context_t *dc) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
+    LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
+
+    const policy_node_tree_t *taptree = get_wallet_taptree(state);
+
+    for (unsigned int k = 0; k < state->n_our_keys; k++) {
+        const internal_key_derivation_t *our_key = &state->our_keys[k];
+
+        bool is_key_path =
+            taptree == NULL ||
+            our_key->key_index == ((const policy_node_tr_t *) &state->wallet_policy_map)->key_index;
+
+        // the Merkle root for the key path, or the TapLeaf hash for the script path
+        uint8_t taptree_hash[32];
+        const uint8_t *sighash = state->sighash;
+        uint8_t script_path_sighash[32];
+        if (taptree != NULL) {
+            int ret = get_taptree_hash(dc, our_key, is_key_path, taptree_hash);
+            if (ret < 0) {
+                SEND_SW(dc, SW_BAD_STATE);
+                return;
+            } else if (ret == 0) {
+                continue;  // the key is not used in the tree
+            }
+
+            if (!is_key_path) {
+                if (compute_taproot_sighash(dc, taptree_hash, script_path_sighash) < 0) {
+                    return;  // response already set
+                }
+                sighash = script_path_sighash;
+            }
+        }
+
+        cx_ecfp_private_key_t private_key = {0};
+        // convenience alias (entirely within the private_key struct)
+        uint8_t *seckey = private_key.d;
+
+        uint8_t chain_code[32] = {0};
+
+        uint32_t sign_path[MAX_BIP32_PATH_STEPS];
+        int sign_path_len = get_sign_path(state, our_key, sign_path);
+
+        uint8_t sig[64];
+        size_t sig_len;
+
+        // the Merkle root of the taptree, for the tweak of the key path
+        const uint8_t *merkle_root = taptree != NULL ? taptree_hash : NULL;
+        uint8_t tweaked_seckey[32];
+
+        bool error = false;
+        BEGIN_TRY {
+            TRY {
+                if (is_key_path && tweaked_key_cache_get(sign_path,
+                                                         sign_path_len,
+                                                         merkle_root,
+                                                         tweaked_seckey)) {
+                    // another input at the same address was already signed for the key path
+                    cx_ecfp_init_private_key(CX_CURVE_256K1,
+                                             tweaked_seckey,
+                                             sizeof(tweaked_seckey),
+                                             &private_key);
+                } else {
+                    crypto_derive_private_key(&private_key, chain_code, sign_path, sign_path_len);
+
+                    // the keys of the tapscripts sign with their untweaked key
+                    if (is_key_path) {
+                        if (crypto_tr_tweak_seckey(seckey, merkle_root) < 0) {
+                            error = true;
+                        } else {
+                            tweaked_key_cache_add(sign_path, sign_path_len, merkle_root, seckey);
+                        }
+                    }
+                }
+
+                if (!error) {
+                    unsigned int err =
+                        cx_ecschnorr_sign_no_throw(&private_key,
+                                                   CX_ECSCHNORR_BIP0340 | CX_RND_TRNG,
+                                                   CX_SHA256,
+                                                   sighash,
+                                                   32,
+                                                   sig,
+                                                   &sig_len);
+                    if (err != CX_OK) {
+                        PRINTF("Signature error: %08X\n", err);
+                        error = true;
+                    }
+                }
+            }
+            CATCH_ALL {
+                error = true;
+            }
+            FINALLY {
+                explicit_bzero(&private_key, sizeof(private_key));
+                explicit_bzero(tweaked_seckey, sizeof(tweaked_seckey));
+            }
+        }
+        END_TRY;
+
+        if (error) {
+            // unexpected error when signing
+            SEND_SW(dc, SW_BAD_STATE);
+            return;
+        }
+
+        if (sig_len != 64) {
+            PRINTF("SIG LEN: %d\n", sig_len);
+            SEND_SW(dc, SW_BAD_STATE);
+            return;
+        }
+
+        // the sighash type byte is only appended if it is non-zero
+        uint8_t sighash_byte = (uint8_t) (state->cur_input.sighash_type & 0xFF);
+        if (!yield_signature(dc, sig, sizeof(sig), sighash_byte)) {
+            SEND_SW(dc, SW_BAD_STATE);
+            return;
+        }
     }
 
-    ++state->cur_input_index;
-    dc->next(sign_process_input_map);
+    next_sign_position(state);
+    dc_next(dc, sign_process_input_map);
 }
 
 static void finalize(dispatcher_context_t *dc) {
+    sign_psbt_state_t *state = (sign_psbt_state_t *) &G_command_state;
+
     LOG_PROCESSOR(dc, __FILE__, __LINE__, __func__);
 
-    SEND_SW(dc, SW_OK);
+    // the dispatcher wipes the keys cached for this transaction once the response is sent
+    // with coalesced yields, the signatures that were not yielded yet are in the response
+    SEND_RESPONSE(dc, state->yield_buffer, state->yield_buffer_len, SW_OK);
 }
\ No newline at end of file
@@ -1,67 +1,261 @@
 #pragma once
 
 #include "../boilerplate/dispatcher.h"
+#include "../constants.h"
+#include "../common/bitvector.h"
+#include "../common/key_origin_filter.h"
 #include "../common/merkle.h"
-
-#define MAX_N_INPUTS_CAN_SIGN  64
-#define MAX_N_OUTPUTS_CAN_SIGN 256
+#include "../common/spending_policy.h"
+#include "../target_config.h"
+#include "lib/get_merkle_leaves_hashes.h"
+#include "lib/psbt_parse_rawtx.h"
+
+#define MAX_N_INPUTS_CAN_SIGN 512
+
+// The information on the change outputs is aggregated in the UI: a transaction that sends the
+// change to more outputs is rejected, rather than possibly leaving funds in unspendable outputs.
+// There is no limit on the number of outputs, that are processed one at a time.
+#define MAX_CHANGE_OUTPUTS 10
+
+// SIGN_PSBT_MODE_CHECK: the change outputs of psbts with at most this many outputs are returned as
+// a bitvector, and as a list of indexes for larger psbts
+#define SIGN_PSBT_CHECK_MAX_BITVECTOR_OUTPUTS 256
+
+// values of the optional mode of SIGN_PSBT
+#define SIGN_PSBT_MODE_SIGN    0  // verify and sign the psbt
+#define SIGN_PSBT_MODE_RESUME  1  // resume from the checkpoint of an interrupted signing, if any
+#define SIGN_PSBT_MODE_CHECK   2  // only verify the psbt, without UI nor signing; see doc/bitcoin.md
+#define SIGN_PSBT_MODE_PROOF   3  // sign a BIP-322 proof of funds; see doc/bitcoin.md
+#define SIGN_PSBT_MODE_AMEND   4  // sign a fee bump of an approved psbt, from its amend record
+#define SIGN_PSBT_MODE_SUMMARY 5  // sign, with the external outputs confirmed in aggregate
+// sign without user interaction a psbt that matches a spending policy; only supported if compiled
+// with HAVE_UNATTENDED_SIGNING, see doc/bitcoin.md
+#define SIGN_PSBT_MODE_UNATTENDED 6
+
+// flag of the mode: the client accepts several signatures in each YIELD, and in the response
+#define SIGN_PSBT_MODE_FLAG_COALESCE_YIELDS 0x80
+
+// flag of the mode: once the user approves the transaction, its amend record is yielded, followed
+// by its hmac; only for SIGN_PSBT_MODE_SIGN and SIGN_PSBT_MODE_AMEND
+#define SIGN_PSBT_MODE_FLAG_AMEND_RECORD 0x40
+
+// flag of the mode: the mode is followed by a list of additional wallet policies; the inputs and
+// the outputs of any of the wallet policies are internal. Not allowed with SIGN_PSBT_MODE_AMEND nor
+// with SIGN_PSBT_MODE_FLAG_AMEND_RECORD, as the amend record is bound to a single wallet policy.
+#define SIGN_PSBT_MODE_FLAG_MULTI_WALLET 0x20
+
+// flag of the mode: the mode is followed by the Merkle root of the list of the indexes of the inputs
+// in the range to sign, as 4-byte little-endian integers, in the order they are signed; the list
+// must be a permutation of the range. The signatures are still yielded with the input index.
+#define SIGN_PSBT_MODE_FLAG_INPUT_ORDER 0x10
+
+// flag of the mode: the progress of the verification of the inputs, of the verification of the
+// outputs and of the signing is yielded at the start of each phase, every
+// SIGN_PSBT_PROGRESS_INTERVAL items and at its end, as the phase (1 byte), the number of items
+// done and the total number of items (4-byte little-endian integers each). These yields are
+// shorter than the ones of the signatures and of the amend record.
+#define SIGN_PSBT_MODE_FLAG_PROGRESS 0x08
+
+#define SIGN_PSBT_PHASE_INPUTS  1  // verification of the inputs
+#define SIGN_PSBT_PHASE_OUTPUTS 2  // verification of the outputs (and their UI)
+#define SIGN_PSBT_PHASE_SIGN    3  // signing of the internal inputs of the range
+
+#define SIGN_PSBT_PROGRESS_LEN      (1 + 4 + 4)
+#define SIGN_PSBT_PROGRESS_INTERVAL 8
+
+// Maximum number of wallet policies of a SIGN_PSBT, including the first one; the index of the
+// wallet policy of each internal input is kept in SIGN_PSBT_WALLET_INDEX_BITS bitvectors.
+#define MAX_SIGN_PSBT_WALLETS       TARGET_MAX_SIGN_PSBT_WALLETS
+#define SIGN_PSBT_WALLET_INDEX_BITS TARGET_SIGN_PSBT_WALLET_INDEX_BITS
+
+// The descriptor templates of the wallet policies are kept one after the other in a buffer of this
+// size, rather than in a header of MAX_POLICY_MAP_STR_LENGTH bytes each; it fits at least one
+// descriptor template of maximum length.
+#define SIGN_PSBT_POLICY_MAPS_SIZE TARGET_SIGN_PSBT_POLICY_MAPS_SIZE
+
+// The amend record of a psbt contains the result of the verification of its inputs: the version,
+// a byte of flags, the totals of the inputs, the tx-wide hashes of the inputs, the hash of the
+// external outputs, and the bitvector of the internal inputs. It is only produced for psbts with
+// at most SIGN_PSBT_AMEND_MAX_N_INPUTS inputs, so that it fits in a single YIELD with its hmac.
+#define SIGN_PSBT_AMEND_RECORD_VERSION 1
+#define SIGN_PSBT_AMEND_MAX_N_INPUTS   256
+#define SIGN_PSBT_AMEND_RECORD_MAX_LEN \
+    (1 + 1 + 2 * 8 + 4 * 32 + 32 + BITVECTOR_REAL_SIZE(SIGN_PSBT_AMEND_MAX_N_INPUTS))
+
+// With SIGN_PSBT_MODE_FLAG_COALESCE_YIELDS, each signature is buffered as its length (1 byte),
+// the input index (a varint, of at most 3 bytes as MAX_N_INPUTS_CAN_SIGN < 2^16), the signature
+// and the sighash byte, and the buffer is sent when it is full, or in the response once all the
+// inputs are signed.
+#define SIGN_PSBT_YIELD_ENTRY_MAX_LEN (1 + 3 + MAX_DER_SIG_LEN + 1)
+#define SIGN_PSBT_YIELD_BUFFER_SIZE   (3 * SIGN_PSBT_YIELD_ENTRY_MAX_LEN)
+
+_Static_assert(MAX_N_INPUTS_CAN_SIGN <= 0xFFFF, "The yielded input index is at most 3 bytes");
+
+// Number of hashes of the taproot tree of the wallet policy kept while signing
+#define TAPTREE_HASH_CACHE_SIZE TARGET_TAPTREE_HASH_CACHE_SIZE
+
+// Maximum number of outputs extracted in the same run of the parser from a non-witness utxo that
+// is shared by consecutive inputs
+#define SIGN_PSBT_PARENT_VOUTS TARGET_SIGN_PSBT_PARENT_VOUTS
+
+// Maximum number of internal inputs whose record is kept from their verification to their signing
+#define SIGN_PSBT_INPUT_RECORDS TARGET_SIGN_PSBT_INPUT_RECORDS
+
+// Maximum number of the other internal inputs whose change and address index are kept from their
+// verification to their signing
+#define SIGN_PSBT_INPUT_PATHS TARGET_SIGN_PSBT_INPUT_PATHS
+
+// The fields of the structs below are ordered by decreasing alignment, to avoid padding; see
+// dev-tools/memory_layout.py.
 
 typedef struct {
     merkleized_map_commitment_t map;
 
+    uint64_t prevout_amount;  // the value of the prevout of the current input
+
+    uint32_t sighash_type;
+
+    int change;
+    int address_index;
+
+    uint8_t prevout_scriptpubkey[MAX_PREVOUT_SCRIPTPUBKEY_LEN];
+
+    // the witness program of the script used when signing a segwit input, either from the witness
+    // utxo or the redeem script; its segwit version selects the signing processor
+    uint8_t witness_program[32];
+
+    uint8_t bip32_derivation_pubkey[33];  // the pubkey of the first PSBT_IN_BIP32_DERIVATION or
+                                          // PSBT_IN_TAP_BIP32_DERIVATION key seen.
+                                          // Could be 33 (legacy or segwitv0) or 32 bytes long
+                                          // (taproot), based on the script type.
+
     bool has_witnessUtxo;
     bool has_nonWitnessUtxo;
     bool has_redeemScript;
     bool has_sighash_type;
 
     bool has_bip32_derivation;
-    uint8_t bip32_derivation_pubkey[33];  // the pubkey of the first PSBT_IN_BIP32_DERIVATION or
-                                          // PSBT_IN_TAP_BIP32_DERIVATION key seen.
-                                          // Could be 33 (legacy or segwitv0) or 32 bytes long
-                                          // (taproot), based on the script type.
 
     bool unexpected_pubkey_error;  // Set to true if the pubkey in the keydata of
                                    // PSBT_IN_BIP32_DERIVATION or PSBT_IN_TAP_BIP32_DERIVATION is
                                    // not the correct length.
 
-    uint64_t prevout_amount;  // the value of the prevout of the current input
+    bool bip32_derivation_is_tap;  // true if the key of bip32_derivation_pubkey is a
+                                   // PSBT_IN_TAP_BIP32_DERIVATION
 
-    uint8_t prevout_scriptpubkey[MAX_PREVOUT_SCRIPTPUBKEY_LEN];
-    int prevout_scriptpubkey_len;
+    // Indexes in the map of the keys of the fields read when signing, recorded during the sweep
+    // that verifies the keys when the map is fetched, or -1 if the key is not in the map. Their
+    // values are read directly from the Merkle tree of the values, without looking up the keys.
+    int next_key_index;  // index of the next key of the sweep
+    int output_index_key_index;
+    int sequence_key_index;
+    int previous_txid_key_index;
+    int redeem_script_key_index;
+    int witness_script_key_index;
+    int bip32_derivation_key_index;  // the key of bip32_derivation_pubkey
 
-    // the script used when signing, either from the witness utxo or the redeem script
-    uint8_t script[MAX_PREVOUT_SCRIPTPUBKEY_LEN];
-    int script_len;
-
-    uint32_t sighash_type;
+    script_info_t prevout_script_info;  // classification of prevout_scriptpubkey
 
-    int change;
-    int address_index;
+    uint8_t prevout_scriptpubkey_len;  // at most MAX_PREVOUT_SCRIPTPUBKEY_LEN
+    uint8_t witness_program_len;
 } cur_input_info_t;
 
 typedef struct {
     merkleized_map_commitment_t map;
 
-    bool has_bip32_derivation;
+    uint64_t value;
+    int scriptpubkey_len;
+    uint8_t scriptpubkey[MAX_PREVOUT_SCRIPTPUBKEY_LEN];
+
     uint8_t bip32_derivation_pubkey[33];  // the pubkey of the first PSBT_OUT_BIP32_DERIVATION or
                                           // PSBT_OUT_TAP_BIP32_DERIVATION key seen.
                                           // Could be 33 (legacy or segwitv0) or 32 bytes long
                                           // (taproot), based on the script type.
 
+    script_info_t script_info;  // classification of scriptpubkey
+
+    bool has_bip32_derivation;
+
     bool unexpected_pubkey_error;  // Set to true if the pubkey in the keydata of
                                    // PSBT_OUT_BIP32_DERIVATION or PSBT_OUT_TAP_BIP32_DERIVATION is
                                    // not the correct length.
+} cur_output_info_t;
 
-    uint64_t value;
-    uint8_t scriptpubkey[MAX_PREVOUT_SCRIPTPUBKEY_LEN];
-    int scriptpubkey_len;
+// The fields of the map of an internal input that its sighash commits to, extracted while the
+// input is verified, for the inputs that can be signed from them alone: taproot inputs (unless the
+// sighash commits to their outpoint and scriptPubKey), and P2WPKH inputs, whose scriptCode only
+// depends on their witness program. Signing them does not fetch their map again.
+typedef struct {
+    uint64_t amount;
+    uint32_t input_index;
+    uint32_t change;
+    uint32_t address_index;
+    uint32_t sighash_type;
+    uint8_t prevout_hash[32];
+    uint8_t prevout_n[4];
+    uint8_t sequence[4];
+    uint8_t witness_program[20];  // only for P2WPKH inputs
+    uint8_t segwit_version;       // 0 for P2WPKH inputs, 1 for taproot inputs
+} sign_psbt_input_record_t;
+
+// The last two steps of the BIP32 derivation of an internal input without a record, as found when
+// the input was verified; signing it does not read its PSBT_IN_BIP32_DERIVATION (or
+// PSBT_IN_TAP_BIP32_DERIVATION) again.
+typedef struct {
+    uint32_t input_index;
+    uint32_t change;
+    uint32_t address_index;
+} sign_psbt_input_path_t;
 
-} cur_output_info_t;
+typedef struct {
+    uint8_t derivation_length;
+    uint8_t key_index;  // index of the key in the wallet policy
+    uint32_t derivation[MAX_BIP32_PATH_STEPS];
+} internal_key_derivation_t;
+
+// A hash of the taproot tree of the wallet policy at an address, needed to sign with one of our
+// keys: the Merkle root for the internal key, otherwise the TapLeaf hash of the key's tapscript.
+typedef struct {
+    bool is_valid;
+    uint8_t key_index;
+    uint32_t change;
+    uint32_t address_index;
+    uint8_t hash[32];
+} taptree_hash_cache_entry_t;
+
+// A wallet policy of the psbt. Only one of them, the active wallet policy, is parsed at a time in
+// wallet_policy_map; the inputs and the outputs are classified with each of them in turn, and each
+// internal input is signed with the wallet policy it belongs to.
+typedef struct {
+    char name[MAX_WALLET_NAME_LENGTH + 1];
+    size_t n_keys;
+    uint8_t keys_info_merkle_root[32];  // root of the Merkle tree of the keys information
+    // the descriptor template, at policy_map_offset in the policy_maps of the state
+    uint16_t policy_map_offset;
+    uint16_t policy_map_len;
+    int script_type;  // type of all the scriptPubKeys of the wallet, or -1 if unknown
+    // filter of the key origins of all the keys of the wallet policy, computed when the first bip32
+    // derivation of an input or output is classified with it
+    key_origin_filter_t key_origins_filter;
+    bool has_key_origins_filter;  // true once key_origins_filter is computed
+    bool is_canonical;            // true for a standard wallet policy, that has no hmac
+} sign_psbt_wallet_t;
+
+// Sums of the amounts of the transaction, accumulated while the inputs and the outputs are verified;
+// each of them is only updated with sign_psbt's add_to_total, that rejects overflows.
+typedef struct {
+    uint64_t inputs;
+    uint64_t outputs;
+    uint64_t internal_inputs;
+    uint64_t change_outputs;
+} tx_totals_t;
 
 typedef struct {
     machine_context_t ctx;
 
-    merkleized_map_commitment_t global_map;  // 48 bytes
+    merkleized_map_commitment_t global_map;  // 72 bytes
+
+    tx_totals_t totals;
 
     uint32_t tx_version;
     uint32_t locktime;
@@ -71,10 +265,16 @@ typedef struct {
     unsigned int n_outputs;
     uint8_t outputs_root[32];  // merkle root of the vector of output maps commitments
 
-    bool is_wallet_canonical;
     int address_type;   // only relevant for canonical wallets
     int bip44_purpose;  // only relevant for canonical wallets
 
+    // the wallet policies of the psbt; the fields below are the ones of the active wallet policy
+    sign_psbt_wallet_t wallets[MAX_SIGN_PSBT_WALLETS];
+    char policy_maps[SIGN_PSBT_POLICY_MAPS_SIZE];
+    size_t policy_maps_len;
+    unsigned int n_wallets;
+    unsigned int cur_wallet;  // index of the active wallet policy
+
     uint8_t wallet_header_keys_info_merkle_root[32];
     size_t wallet_header_n_keys;
     union {
@@ -84,21 +284,137 @@ typedef struct {
 
     uint32_t master_key_fingerprint;
 
-    uint8_t internal_inputs[MAX_N_INPUTS_CAN_SIGN];  // TODO: use a bitvector
+    union {
+        // SIGN_PSBT_MODE_PROOF: the BIP-322 hash of the message that the psbt proves the funds for
+        uint8_t bip322_message_hash[32];
+        // otherwise: the hash of the external outputs, for the amend record
+        uint8_t external_outputs_hash[32];
+    };
+
+    uint8_t internal_inputs[BITVECTOR_REAL_SIZE(MAX_N_INPUTS_CAN_SIGN)];  // bitvector
+    unsigned int n_internal_inputs;
+
+    // the bits of the index of the wallet policy of each internal input
+    uint8_t input_wallets[SIGN_PSBT_WALLET_INDEX_BITS][BITVECTOR_REAL_SIZE(MAX_N_INPUTS_CAN_SIGN)];
+
+    // the inputs with a PSBT_IN_SEQUENCE, as verified by the sweep of the keys of their maps; only
+    // valid if has_inputs_with_sequence, otherwise the sequences must be looked up
+    uint8_t inputs_with_sequence[BITVECTOR_REAL_SIZE(MAX_N_INPUTS_CAN_SIGN)];  // bitvector
+    bool has_inputs_with_sequence;
+
+#if SIGN_PSBT_INPUT_RECORDS > 0
+    // the records of the first internal inputs that can be signed from them; the slot after the
+    // last one is filled while an input is verified, and only kept if the input is internal
+    sign_psbt_input_record_t input_records[SIGN_PSBT_INPUT_RECORDS];
+    unsigned int n_input_records;
+#endif
+
+#if SIGN_PSBT_INPUT_PATHS > 0
+    // the paths of the first internal inputs without a record, by increasing input index
+    sign_psbt_input_path_t input_paths[SIGN_PSBT_INPUT_PATHS];
+    unsigned int n_input_paths;
+#endif
+
+    // only the internal inputs with index in [sign_range_start, sign_range_end) are signed
+    unsigned int sign_range_start;
+    unsigned int sign_range_end;
+
+    // SIGN_PSBT_MODE_FLAG_INPUT_ORDER: the root of the list of the inputs of the range, in the
+    // order they are signed
+    uint8_t input_order_root[32];
+
+    bool is_wallet_canonical;
+    bool has_input_order;                // SIGN_PSBT_MODE_FLAG_INPUT_ORDER
+    bool is_check_only;                  // SIGN_PSBT_MODE_CHECK
+    bool is_bip322_proof;                // SIGN_PSBT_MODE_PROOF
+    bool is_summary;                     // SIGN_PSBT_MODE_SUMMARY
+    bool is_unattended;                  // SIGN_PSBT_MODE_UNATTENDED
+    bool coalesce_yields;                // SIGN_PSBT_MODE_FLAG_COALESCE_YIELDS
+    bool yield_progress;                 // SIGN_PSBT_MODE_FLAG_PROGRESS
+    bool has_internal_segwit_inputs;     // true if any internal input will be signed as segwit
+    bool has_internal_segwit_v1_inputs;  // true if any internal input is a taproot input
+    bool has_nondefault_sighash;         // true if any internal input is not signed with
+                                         // SIGHASH_ALL (or SIGHASH_DEFAULT, for taproot)
 
     union {
         struct {
-            unsigned int cur_input_index;
             cur_input_info_t cur_input;
+            unsigned int cur_input_index;
+            union {
+                // running hashes of the fields of the inputs verified so far; their digests are
+                // the tx-wide hashes in hashes, that are therefore ready after the inputs
+                // verification
+                struct {
+                    cx_sha256_t sha_prevouts_context;
+                    cx_sha256_t sha_amounts_context;
+                    cx_sha256_t sha_scriptpubkeys_context;
+                    cx_sha256_t sha_sequences_context;
+
+                    // the outputs spent by consecutive inputs with the same non-witness utxo,
+                    // extracted when it was last parsed; parent_utxo_hash is the hash of the leaf
+                    // of its value, or all zeros
+                    uint8_t parent_utxo_hash[32];
+                    uint8_t parent_txid[32];
+                    txid_parser_vout_t parent_vouts[SIGN_PSBT_PARENT_VOUTS];
+                    uint8_t n_parent_vouts;
+                };
+                // while signing the inputs
+                struct {
+                    // position in the signing order of the current input, and the inputs of
+                    // the previous positions, that can not appear again in the order
+                    unsigned int sign_order_pos;
+                    uint8_t visited_inputs[BITVECTOR_REAL_SIZE(MAX_N_INPUTS_CAN_SIGN)];
+
+                    // the record of the current input, if it is signed from it, or NULL
+                    const sign_psbt_input_record_t *cur_input_record;
+
+                    // signatures not yielded yet, with coalesced yields
+                    uint8_t yield_buffer[SIGN_PSBT_YIELD_BUFFER_SIZE];
+                    uint8_t yield_buffer_len;
+
+                    // for wallet policies with tapscripts: the state of the TapLeaf tagged hash
+                    // after its tag prefix, and the hashes of the tree for the last addresses
+                    // signed, that are shared by all the inputs spending the same address
+                    cx_sha256_t tapleaf_midstate;
+                    taptree_hash_cache_entry_t taptree_hashes[TAPTREE_HASH_CACHE_SIZE];
+                    uint8_t taptree_hashes_next_slot;
+                };
+            };
         };
         struct {
-            unsigned int cur_output_index;
             cur_output_info_t cur_output;
+            unsigned int cur_output_index;
+            // leaf hashes of the batch of output maps that contains the current output, fetched
+            // with a single Merkle proof
+            uint8_t output_leaf_hashes[MERKLE_LEAVES_BATCH_SIZE][32];
+            // running hash of the serialization of the outputs processed so far; its digest is
+            // hashes.sha_outputs
+            cx_sha256_t sha_outputs_context;
+            // running hash of the serialization of the external outputs processed so far; its
+            // digest is external_outputs_hash
+            cx_sha256_t external_outputs_context;
+            // indexes of the first change_count change outputs
+            uint32_t change_output_indexes[MAX_CHANGE_OUTPUTS];
+        };
+        // only used by the handler while reading the wallet policies, before the inputs are
+        // processed; kept here rather than on the stack of the handler
+        struct {
+            policy_map_wallet_header_t wallet_header;  // of the wallet policy being loaded
+            unsigned int n_authorized_wallets;  // wallet policies already authorized by the user
         };
+        // the amend record, read by the handler once the wallet policy is parsed, or written once
+        // the user approved the transaction
+        uint8_t amend_record[SIGN_PSBT_AMEND_RECORD_MAX_LEN];
     };
 
-    uint8_t sighash[32];
+    union {
+        // the id of the wallet policy, only needed for the hmac of the amend record, that is
+        // computed before signing
+        uint8_t wallet_id[32];
+        uint8_t sighash[32];
+    };
 
+    // tx-wide hashes, computed while verifying the inputs and the outputs
     struct {
         uint8_t sha_prevouts[32];
         uint8_t sha_amounts[32];
@@ -107,18 +423,53 @@ typedef struct {
         uint8_t sha_outputs[32];
     } hashes;
 
-    uint64_t inputs_total_value;
-    uint64_t outputs_total_value;
-
-    uint64_t internal_inputs_total_value;
+    // state of the BIP143 sighash computation after nVersion, hashPrevouts and hashSequence, which
+    // are shared by all the segwit v0 inputs
+    cx_sha256_t segwit_v0_prefix;
 
-    uint64_t change_outputs_total_value;
+    // legacy sighash preimage up to the first n_inputs inputs (with an empty scriptCode), shared by
+    // all the legacy inputs that come after them
+    struct {
+        cx_sha256_t context;
+        unsigned int n_inputs;
+    } legacy_prefix;
 
     int external_outputs_count;  // count of external outputs that are shown to the user
     int change_count;            // count of outputs compatible with change outputs
 
-    int our_key_derivation_length;
-    uint32_t our_key_derivation[MAX_BIP32_PATH_STEPS];
+    // key origin derivations of all the keys of the wallet policy that are internal; each internal
+    // input is signed with all of them
+    unsigned int n_our_keys;
+    internal_key_derivation_t our_keys[MAX_POLICY_MAP_INTERNAL_KEYS];
+
+    bool is_amend;            // SIGN_PSBT_MODE_AMEND
+    bool yield_amend_record;  // SIGN_PSBT_MODE_FLAG_AMEND_RECORD
+
+#ifdef HAVE_UNATTENDED_SIGNING
+    // SIGN_PSBT_MODE_UNATTENDED: the spending policy that the psbt must match, and its id
+    spending_policy_t spending_policy;
+    uint8_t spending_policy_id[32];
+#endif
+
+#ifdef HAVE_SIGN_PSBT_CHECKPOINT
+    // sha256 of the data of the SIGN_PSBT command up to the mode, and of the additional wallet
+    // policies; it identifies the psbt and the wallet policies of the checkpoint
+    uint8_t command_id[32];
+#endif
 } sign_psbt_state_t;
 
 void handler_sign_psbt(dispatcher_context_t *dispatcher_context);
+
+#ifdef HAVE_SIGN_PSBT_CHECKPOINT
+
+/**
+ * Wipes the checkpoint of the last SIGN_PSBT, if any.
+ */
+void sign_psbt_checkpoint_reset(void);
+
+#else
+
+static inline void sign_psbt_checkpoint_reset(void) {
+}
+
+#endif
@@ -3,27 +3,18 @@
 
 #include "get_fingerprint_and_path.h"
 
+#include "../lib/get_merkle_leaf_element.h"
 #include "../lib/get_merkleized_map_value.h"
+#include "../lib/stream_merkle_leaf_element.h"
+#include "../lib/stream_merkleized_map_value.h"
 
 #include "../../common/read.h"
 
-int get_fingerprint_and_path(dispatcher_context_t *dispatcher_context,
-                             const merkleized_map_commitment_t *map,
-                             const uint8_t *key,
-                             int key_len,
-                             uint32_t *out_fingerprint,
-                             uint32_t out_bip32_path[static MAX_BIP32_PATH_STEPS]) {
-    LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
-
-    uint8_t fpt_der[4 + 4 * MAX_BIP32_PATH_STEPS];
-
-    int len = call_get_merkleized_map_value(dispatcher_context,
-                                            map,
-                                            key,
-                                            key_len,
-                                            fpt_der,
-                                            sizeof(fpt_der));
-
+// parses the fingerprint and the derivation steps of a key origin
+static int read_fingerprint_and_path(const uint8_t *fpt_der,
+                                     int len,
+                                     uint32_t *out_fingerprint,
+                                     uint32_t out_bip32_path[static MAX_BIP32_PATH_STEPS]) {
     if (len < 4 || len % 4 != 0) {
         return -1;
     }
@@ -36,7 +27,7 @@ int get_fingerprint_and_path(dispatcher_context_t *dispatcher_context,
 
     *out_fingerprint = read_u32_le(fpt_der, 0);
 
-    uint8_t *derivation_path = fpt_der + 4;
+    const uint8_t *derivation_path = fpt_der + 4;
     for (int i = 0; i < bip32_path_len; i++) {
         out_bip32_path[i] = read_u32_le(derivation_path, 4 * i);
     }
@@ -44,47 +35,144 @@ int get_fingerprint_and_path(dispatcher_context_t *dispatcher_context,
     return bip32_path_len;
 }
 
-int get_emptyhashes_fingerprint_and_path(dispatcher_context_t *dispatcher_context,
-                                         const merkleized_map_commitment_t *map,
-                                         const uint8_t *key,
-                                         int key_len,
-                                         uint32_t *out_fingerprint,
-                                         uint32_t out_bip32_path[static MAX_BIP32_PATH_STEPS]) {
+int get_fingerprint_and_path(dispatcher_context_t *dispatcher_context,
+                             const merkleized_map_commitment_t *map,
+                             const uint8_t *key,
+                             int key_len,
+                             uint32_t *out_fingerprint,
+                             uint32_t out_bip32_path[static MAX_BIP32_PATH_STEPS]) {
     LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
 
-    uint8_t hasheslen_fpt_der[1 + 4 + 4 * MAX_BIP32_PATH_STEPS];
+    uint8_t fpt_der[4 + 4 * MAX_BIP32_PATH_STEPS];
 
     int len = call_get_merkleized_map_value(dispatcher_context,
                                             map,
                                             key,
                                             key_len,
-                                            hasheslen_fpt_der,
-                                            sizeof(hasheslen_fpt_der));
+                                            fpt_der,
+                                            sizeof(fpt_der));
 
-    if (len < 1 + 4 || (len - 1) % 4 != 0) {
+    return read_fingerprint_and_path(fpt_der, len, out_fingerprint, out_bip32_path);
+}
+
+int get_fingerprint_and_path_at_index(dispatcher_context_t *dispatcher_context,
+                                      const merkleized_map_commitment_t *map,
+                                      int key_index,
+                                      uint32_t *out_fingerprint,
+                                      uint32_t out_bip32_path[static MAX_BIP32_PATH_STEPS]) {
+    LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
+
+    if (key_index < 0 || (uint64_t) key_index >= map->size) {
         return -1;
     }
 
-    if (hasheslen_fpt_der[0] != 0) {
-        // this function only handles the case when hashes_len == 0
-        // (always the case for key path spending)
-        PRINTF("Unexpected hashes_len != 0");
+    uint8_t fpt_der[4 + 4 * MAX_BIP32_PATH_STEPS];
+
+    int len = call_get_merkle_leaf_element(dispatcher_context,
+                                           map->values_root,
+                                           map->size,
+                                           key_index,
+                                           fpt_der,
+                                           sizeof(fpt_der));
+
+    return read_fingerprint_and_path(fpt_der, len, out_fingerprint, out_bip32_path);
+}
 
+typedef struct {
+    size_t offset;      // offset in the value of the next streamed byte
+    size_t hashes_end;  // offset of the key origin, that follows the leaf hashes
+    uint8_t fpt_der[4 + 4 * MAX_BIP32_PATH_STEPS];
+    int fpt_der_len;
+    bool error;
+} tap_bip32_derivation_state_t;
+
+// skips the leaf hashes, and keeps the key origin that follows them
+static void cb_process_tap_bip32_derivation(buffer_t *data, void *cb_state) {
+    tap_bip32_derivation_state_t *state = (tap_bip32_derivation_state_t *) cb_state;
+
+    uint8_t c;
+    while (!state->error && buffer_read_u8(data, &c)) {
+        if (state->offset == 0) {
+            // number of leaf hashes; larger compact sizes are not supported
+            if (c >= 0xfd) {
+                state->error = true;
+            }
+            state->hashes_end = 1 + 32 * (size_t) c;
+        } else if (state->offset >= state->hashes_end) {
+            if (state->fpt_der_len >= (int) sizeof(state->fpt_der)) {
+                state->error = true;
+            } else {
+                state->fpt_der[state->fpt_der_len++] = c;
+            }
+        }
+        ++state->offset;
+    }
+}
+
+// parses the key origin of a PSBT_{IN,OUT}_TAP_BIP32_DERIVATION value that was streamed to
+// cb_process_tap_bip32_derivation
+static int read_tap_fingerprint_and_path(int len,
+                                         const tap_bip32_derivation_state_t *cb_state,
+                                         uint32_t *out_fingerprint,
+                                         uint32_t out_bip32_path[static MAX_BIP32_PATH_STEPS]) {
+    if (len < 0 || cb_state->error || cb_state->offset < cb_state->hashes_end) {
         return -1;
     }
 
-    int bip32_path_len = (len - 1 - 4) / 4;
+    return read_fingerprint_and_path(cb_state->fpt_der,
+                                     cb_state->fpt_der_len,
+                                     out_fingerprint,
+                                     out_bip32_path);
+}
 
-    if (bip32_path_len > MAX_BIP32_PATH_STEPS) {
+int get_tap_fingerprint_and_path(dispatcher_context_t *dispatcher_context,
+                                 const merkleized_map_commitment_t *map,
+                                 const uint8_t *key,
+                                 int key_len,
+                                 uint32_t *out_fingerprint,
+                                 uint32_t out_bip32_path[static MAX_BIP32_PATH_STEPS]) {
+    LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
+
+    tap_bip32_derivation_state_t cb_state = {.offset = 0,
+                                             .hashes_end = 0,
+                                             .fpt_der_len = 0,
+                                             .error = false};
+
+    // the leaf hashes are streamed, so that they are never kept in memory
+    int len = call_stream_merkleized_map_value(dispatcher_context,
+                                               map,
+                                               key,
+                                               key_len,
+                                               NULL,
+                                               cb_process_tap_bip32_derivation,
+                                               &cb_state);
+
+    return read_tap_fingerprint_and_path(len, &cb_state, out_fingerprint, out_bip32_path);
+}
+
+int get_tap_fingerprint_and_path_at_index(dispatcher_context_t *dispatcher_context,
+                                          const merkleized_map_commitment_t *map,
+                                          int key_index,
+                                          uint32_t *out_fingerprint,
+                                          uint32_t out_bip32_path[static MAX_BIP32_PATH_STEPS]) {
+    LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
+
+    if (key_index < 0 || (uint64_t) key_index >= map->size) {
         return -1;
     }
 
-    *out_fingerprint = read_u32_le(hasheslen_fpt_der, 1);
+    tap_bip32_derivation_state_t cb_state = {.offset = 0,
+                                             .hashes_end = 0,
+                                             .fpt_der_len = 0,
+                                             .error = false};
 
-    uint8_t *derivation_path = hasheslen_fpt_der + 1 + 4;
-    for (int i = 0; i < bip32_path_len; i++) {
-        out_bip32_path[i] = read_u32_le(derivation_path, 4 * i);
-    }
+    int len = call_stream_merkle_leaf_element(dispatcher_context,
+                                              map->values_root,
+                                              map->size,
+                                              key_index,
+                                              NULL,
+                                              cb_process_tap_bip32_derivation,
+                                              &cb_state);
 
-    return bip32_path_len;
-}
\ No newline at end of file
+    return read_tap_fingerprint_and_path(len, &cb_state, out_fingerprint, out_bip32_path);
+}
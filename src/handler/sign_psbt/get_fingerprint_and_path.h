@@ -19,14 +19,33 @@ int get_fingerprint_and_path(dispatcher_context_t *dispatcher_context,
 
 /**
  * Used to read PSBT_IN_TAP_BIP32_DERIVATION or PSBT_OUT_TAP_BIP32_DERIVATION entries from a PSBT
- * map; fails if the hashes_len is not 0 (only useful for keypath spending).
+ * map. The value is streamed, and its leaf hashes (if any, for keys used in tapscripts) are
+ * skipped; at most 252 leaf hashes are supported.
  * Returns the length of the BIP32 path on success, a negative number on failure.
- *
- * TODO: more precise docs
  */
-int get_emptyhashes_fingerprint_and_path(dispatcher_context_t *dispatcher_context,
-                                         const merkleized_map_commitment_t *map,
-                                         const uint8_t *key,
-                                         int key_len,
-                                         uint32_t *out_fingerprint,
-                                         uint32_t out_bip32_path[static MAX_BIP32_PATH_STEPS]);
\ No newline at end of file
+int get_tap_fingerprint_and_path(dispatcher_context_t *dispatcher_context,
+                                 const merkleized_map_commitment_t *map,
+                                 const uint8_t *key,
+                                 int key_len,
+                                 uint32_t *out_fingerprint,
+                                 uint32_t out_bip32_path[static MAX_BIP32_PATH_STEPS]);
+
+/**
+ * Same as get_fingerprint_and_path, for the key with the given index in the map, for example
+ * recorded while the keys of the map were verified; the key is not looked up.
+ */
+int get_fingerprint_and_path_at_index(dispatcher_context_t *dispatcher_context,
+                                      const merkleized_map_commitment_t *map,
+                                      int key_index,
+                                      uint32_t *out_fingerprint,
+                                      uint32_t out_bip32_path[static MAX_BIP32_PATH_STEPS]);
+
+/**
+ * Same as get_tap_fingerprint_and_path, for the key with the given index in the map, for example
+ * recorded while the keys of the map were verified; the key is not looked up.
+ */
+int get_tap_fingerprint_and_path_at_index(dispatcher_context_t *dispatcher_context,
+                                          const merkleized_map_commitment_t *map,
+                                          int key_index,
+                                          uint32_t *out_fingerprint,
+                                          uint32_t out_bip32_path[static MAX_BIP32_PATH_STEPS]);
@@ -1,19 +1,21 @@
-
 #include "update_hashes_with_map_value.h"
 
+#include "../lib/stream_merkle_leaf_element.h"
 #include "../lib/stream_merkleized_map_value.h"
 #include "../../crypto.h"
 
 typedef struct {
-    cx_hash_t *hash_unprefixed;
-    cx_hash_t *hash_prefixed;
+    const hash_sink_t *sinks;
+    size_t n_sinks;
 } callback_state_t;
 
 static void cb_process_len(size_t len, void *cb_state) {
     callback_state_t *state = (callback_state_t *) cb_state;
 
-    if (state->hash_prefixed != NULL) {
-        crypto_hash_update_varint(state->hash_prefixed, len);
+    for (size_t i = 0; i < state->n_sinks; i++) {
+        if (state->sinks[i].prefix_length) {
+            crypto_hash_update_varint(state->sinks[i].hash, len);
+        }
     }
 }
 
@@ -23,24 +25,20 @@ static void cb_process_data(buffer_t *data, void *cb_state) {
     size_t data_len = data->size - data->offset;
     uint8_t *data_start_ptr = data->ptr + data->offset;
 
-    if (state->hash_prefixed != NULL) {
-        crypto_hash_update(state->hash_prefixed, data_start_ptr, data_len);
-    }
-    if (state->hash_unprefixed != NULL) {
-        crypto_hash_update(state->hash_unprefixed, data_start_ptr, data_len);
+    for (size_t i = 0; i < state->n_sinks; i++) {
+        crypto_hash_update(state->sinks[i].hash, data_start_ptr, data_len);
     }
 }
 
-int update_hashes_with_map_value(dispatcher_context_t *dispatcher_context,
-                                 const merkleized_map_commitment_t *map,
-                                 const uint8_t *key,
-                                 int key_len,
-                                 cx_hash_t *hash_unprefixed,
-                                 cx_hash_t *hash_prefixed) {
+int update_hash_sinks_with_map_value(dispatcher_context_t *dispatcher_context,
+                                     const merkleized_map_commitment_t *map,
+                                     const uint8_t *key,
+                                     int key_len,
+                                     const hash_sink_t sinks[],
+                                     size_t n_sinks) {
     LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
 
-    callback_state_t cb_state = {.hash_unprefixed = hash_unprefixed,
-                                 .hash_prefixed = hash_prefixed};
+    callback_state_t cb_state = {.sinks = sinks, .n_sinks = n_sinks};
 
     return call_stream_merkleized_map_value(dispatcher_context,
                                             map,
@@ -50,3 +48,67 @@ int update_hashes_with_map_value(dispatcher_context_t *dispatcher_context,
                                             cb_process_data,
                                             &cb_state);
 }
+
+int update_hash_sinks_with_map_value_at_index(dispatcher_context_t *dispatcher_context,
+                                              const merkleized_map_commitment_t *map,
+                                              int key_index,
+                                              const hash_sink_t sinks[],
+                                              size_t n_sinks) {
+    LOG_PROCESSOR(dispatcher_context, __FILE__, __LINE__, __func__);
+
+    if (key_index < 0 || (uint64_t) key_index >= map->size) {
+        return -1;
+    }
+
+    callback_state_t cb_state = {.sinks = sinks, .n_sinks = n_sinks};
+
+    return call_stream_merkle_leaf_element(dispatcher_context,
+                                           map->values_root,
+                                           map->size,
+                                           key_index,
+                                           cb_process_len,
+                                           cb_process_data,
+                                           &cb_state);
+}
+
+// Fills sinks with the non-NULL hash contexts among hash_unprefixed and hash_prefixed; returns
+// their number.
+static size_t make_two_sinks(cx_hash_t *hash_unprefixed,
+                             cx_hash_t *hash_prefixed,
+                             hash_sink_t sinks[static 2]) {
+    size_t n_sinks = 0;
+    if (hash_unprefixed != NULL) {
+        sinks[n_sinks++] = make_hash_sink(hash_unprefixed, false);
+    }
+    if (hash_prefixed != NULL) {
+        sinks[n_sinks++] = make_hash_sink(hash_prefixed, true);
+    }
+    return n_sinks;
+}
+
+int update_hashes_with_map_value(dispatcher_context_t *dispatcher_context,
+                                 const merkleized_map_commitment_t *map,
+                                 const uint8_t *key,
+                                 int key_len,
+                                 cx_hash_t *hash_unprefixed,
+                                 cx_hash_t *hash_prefixed) {
+    hash_sink_t sinks[2];
+    size_t n_sinks = make_two_sinks(hash_unprefixed, hash_prefixed, sinks);
+
+    return update_hash_sinks_with_map_value(dispatcher_context, map, key, key_len, sinks, n_sinks);
+}
+
+int update_hashes_with_map_value_at_index(dispatcher_context_t *dispatcher_context,
+                                          const merkleized_map_commitment_t *map,
+                                          int key_index,
+                                          cx_hash_t *hash_unprefixed,
+                                          cx_hash_t *hash_prefixed) {
+    hash_sink_t sinks[2];
+    size_t n_sinks = make_two_sinks(hash_unprefixed, hash_prefixed, sinks);
+
+    return update_hash_sinks_with_map_value_at_index(dispatcher_context,
+                                                     map,
+                                                     key_index,
+                                                     sinks,
+                                                     n_sinks);
+}
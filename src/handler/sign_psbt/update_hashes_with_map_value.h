@@ -3,13 +3,53 @@
 #include "../../boilerplate/dispatcher.h"
 #include "../../common/merkle.h"
 
+/**
+ * A hash context that absorbs a streamed value: its bytes, preceded by its length serialized as a
+ * Bitcoin-style varint if prefix_length is true. It is responsibility of the caller to ensure that
+ * the hash context is initialized.
+ */
+typedef struct {
+    cx_hash_t *hash;
+    bool prefix_length;
+} hash_sink_t;
+
+/**
+ * Convenience function to initialize a hash_sink_t.
+ */
+static inline hash_sink_t make_hash_sink(cx_hash_t *hash, bool prefix_length) {
+    return (hash_sink_t){.hash = hash, .prefix_length = prefix_length};
+}
+
+/**
+ * Streams the requested preimage from a merkleized map, updating each of the n_sinks hash sinks
+ * with it; the value is only fetched once, whatever the number of hashes that need it.
+ *
+ * Returns the length of the preimage on success, or -1 in case of error.
+ */
+int update_hash_sinks_with_map_value(dispatcher_context_t *dispatcher_context,
+                                     const merkleized_map_commitment_t *map,
+                                     const uint8_t *key,
+                                     int key_len,
+                                     const hash_sink_t sinks[],
+                                     size_t n_sinks);
+
+/**
+ * Same as update_hash_sinks_with_map_value, for the value of the key with the given index in the
+ * map, for example recorded while the keys of the map were verified; the key is not looked up.
+ */
+int update_hash_sinks_with_map_value_at_index(dispatcher_context_t *dispatcher_context,
+                                              const merkleized_map_commitment_t *map,
+                                              int key_index,
+                                              const hash_sink_t sinks[],
+                                              size_t n_sinks);
+
 /**
  * Streams the requested preimage from a merkleized map, updating the given has contexts
  * appropriately. Both hash_unprefixed and hash_prefixed are optional, but if not NULL, it is
  * responsibility of the caller to ensure that they are initialized.
  *
  * If hash_unprefixed is not NULL, it is updated with the preimage bytes.
- * If hash_unprefixed is not NULL, it is updated with the premiage length serialized as a
+ * If hash_prefixed is not NULL, it is updated with the premiage length serialized as a
  * Bitcoin-style varint, followed by the preimage bytes.
  *
  * Returns the length of the preimage on success, or -1 in case of error.
@@ -19,4 +59,14 @@ int update_hashes_with_map_value(dispatcher_context_t *dispatcher_context,
                                  const uint8_t *key,
                                  int key_len,
                                  cx_hash_t *hash_unprefixed,
-                                 cx_hash_t *hash_prefixed);
\ No newline at end of file
+                                 cx_hash_t *hash_prefixed);
+
+/**
+ * Same as update_hashes_with_map_value, for the value of the key with the given index in the map,
+ * for example recorded while the keys of the map were verified; the key is not looked up.
+ */
+int update_hashes_with_map_value_at_index(dispatcher_context_t *dispatcher_context,
+                                          const merkleized_map_commitment_t *map,
+                                          int key_index,
+                                          cx_hash_t *hash_unprefixed,
+                                          cx_hash_t *hash_prefixed);
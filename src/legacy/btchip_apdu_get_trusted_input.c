@@ -22,10 +22,16 @@
 
 #define GET_TRUSTED_INPUT_P1_FIRST 0x00
 #define GET_TRUSTED_INPUT_P1_NEXT 0x80
+#define GET_TRUSTED_INPUT_P2_SINGLE 0x00
+// The first chunk starts with the number of outputs (at most TRUSTED_INPUT_BATCH_MAX) followed by
+// their indexes, instead of a single index; a Trusted Input is returned for each of them, so that
+// the transaction is only streamed once
+#define GET_TRUSTED_INPUT_P2_BATCH 0x01
 
 unsigned short btchip_apdu_get_trusted_input() {
     unsigned char apduLength;
     unsigned char dataOffset = 0;
+    unsigned char i;
     apduLength = G_io_apdu_buffer[ISO_OFFSET_LC];
 
     SB_CHECK(N_btchip.bkp.config.operationMode);
@@ -38,16 +44,39 @@ unsigned short btchip_apdu_get_trusted_input() {
         return BTCHIP_SW_CONDITIONS_OF_USE_NOT_SATISFIED;
     }
 
+    if ((G_io_apdu_buffer[ISO_OFFSET_P2] != GET_TRUSTED_INPUT_P2_SINGLE) &&
+        (G_io_apdu_buffer[ISO_OFFSET_P2] != GET_TRUSTED_INPUT_P2_BATCH)) {
+        return BTCHIP_SW_INCORRECT_P1_P2;
+    }
+
     if (G_io_apdu_buffer[ISO_OFFSET_P1] == GET_TRUSTED_INPUT_P1_FIRST) {
         // Initialize
-        btchip_context_D.transactionTargetInput =
-            btchip_read_u32(G_io_apdu_buffer + ISO_OFFSET_CDATA, 1, 0);
+        if (G_io_apdu_buffer[ISO_OFFSET_P2] == GET_TRUSTED_INPUT_P2_BATCH) {
+            unsigned char count = G_io_apdu_buffer[ISO_OFFSET_CDATA];
+            if ((count == 0) || (count > TRUSTED_INPUT_BATCH_MAX) ||
+                (apduLength < 1 + 4 * count)) {
+                return BTCHIP_SW_INCORRECT_DATA;
+            }
+            for (i = 0; i < count; i++) {
+                btchip_context_D.transactionTargetInput[i] =
+                    btchip_read_u32(G_io_apdu_buffer + ISO_OFFSET_CDATA + 1 + 4 * i, 1, 0);
+            }
+            btchip_context_D.transactionTargetInputCount = count;
+            dataOffset = 1 + 4 * count;
+        } else {
+            if (apduLength < 4) {
+                return BTCHIP_SW_INCORRECT_DATA;
+            }
+            btchip_context_D.transactionTargetInput[0] =
+                btchip_read_u32(G_io_apdu_buffer + ISO_OFFSET_CDATA, 1, 0);
+            btchip_context_D.transactionTargetInputCount = 1;
+            dataOffset = 4;
+        }
         btchip_context_D.transactionContext.transactionState =
             BTCHIP_TRANSACTION_NONE;
         btchip_context_D.trustedInputProcessed = 0;
         btchip_context_D.transactionContext.consumeP2SH = 0;
         btchip_set_check_internal_structure_integrity(1);
-        dataOffset = 4;
         btchip_context_D.transactionHashOption = TRANSACTION_HASH_FULL;
         btchip_context_D.usingSegwit = 0;
         btchip_context_D.usingOverwinter = 0;
@@ -55,9 +84,6 @@ unsigned short btchip_apdu_get_trusted_input() {
         return BTCHIP_SW_INCORRECT_P1_P2;
     }
 
-    if (G_io_apdu_buffer[ISO_OFFSET_P2] != 0x00) {
-        return BTCHIP_SW_INCORRECT_P1_P2;
-    }
     btchip_context_D.transactionBufferPointer =
         G_io_apdu_buffer + ISO_OFFSET_CDATA + dataOffset;
     btchip_context_D.transactionDataRemaining = apduLength - dataOffset;
@@ -66,33 +92,42 @@ unsigned short btchip_apdu_get_trusted_input() {
 
     if (btchip_context_D.transactionContext.transactionState ==
         BTCHIP_TRANSACTION_PARSED) {
+        unsigned char txHash[32];
 
         btchip_context_D.transactionContext.transactionState =
             BTCHIP_TRANSACTION_NONE;
         btchip_set_check_internal_structure_integrity(1);
-        if (!btchip_context_D.trustedInputProcessed) {
+        if (btchip_context_D.trustedInputProcessed !=
+            (1 << btchip_context_D.transactionTargetInputCount) - 1) {
             // Output was not found
             return BTCHIP_SW_INCORRECT_DATA;
         }
 
         cx_hash(&btchip_context_D.transactionHashFull.sha256.header, CX_LAST,
-                (unsigned char *)NULL, 0, G_io_apdu_buffer + TRUSTED_INPUT_SIZE, 32);
-
-        // Otherwise prepare
-        cx_rng(G_io_apdu_buffer, 8);
-        G_io_apdu_buffer[0] = MAGIC_TRUSTED_INPUT;
-        G_io_apdu_buffer[1] = 0x00;
-        cx_hash_sha256(G_io_apdu_buffer + TRUSTED_INPUT_SIZE, 32, G_io_apdu_buffer + 4, 32);
-
-        btchip_write_u32_le(G_io_apdu_buffer + 4 + 32,
-                            btchip_context_D.transactionTargetInput);
-        os_memmove(G_io_apdu_buffer + 4 + 32 + 4,
-                   btchip_context_D.transactionContext.transactionAmount, 8);
-
-        cx_hmac_sha256((uint8_t *)N_btchip.bkp.trustedinput_key,
-                       sizeof(N_btchip.bkp.trustedinput_key), G_io_apdu_buffer,
-                       TRUSTED_INPUT_SIZE, G_io_apdu_buffer + TRUSTED_INPUT_SIZE, 32);
-        btchip_context_D.outLength = TRUSTED_INPUT_TOTAL_SIZE;
+                (unsigned char *)NULL, 0, txHash, 32);
+        cx_hash_sha256(txHash, 32, txHash, 32);
+
+        // Otherwise prepare, one Trusted Input per requested output
+        for (i = 0; i < btchip_context_D.transactionTargetInputCount; i++) {
+            unsigned char *trustedInput =
+                G_io_apdu_buffer + i * TRUSTED_INPUT_TOTAL_SIZE;
+
+            cx_rng(trustedInput, 8);
+            trustedInput[0] = MAGIC_TRUSTED_INPUT;
+            trustedInput[1] = 0x00;
+            os_memmove(trustedInput + 4, txHash, 32);
+
+            btchip_write_u32_le(trustedInput + 4 + 32,
+                                btchip_context_D.transactionTargetInput[i]);
+            os_memmove(trustedInput + 4 + 32 + 4,
+                       btchip_context_D.transactionTargetAmount[i], 8);
+
+            cx_hmac_sha256((uint8_t *)N_btchip.bkp.trustedinput_key,
+                           sizeof(N_btchip.bkp.trustedinput_key), trustedInput,
+                           TRUSTED_INPUT_SIZE, trustedInput + TRUSTED_INPUT_SIZE, 32);
+        }
+        btchip_context_D.outLength =
+            btchip_context_D.transactionTargetInputCount * TRUSTED_INPUT_TOTAL_SIZE;
     }
     return BTCHIP_SW_OK;
 }
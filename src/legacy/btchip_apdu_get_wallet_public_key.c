@@ -27,23 +27,163 @@
 #include "segwit_addr.h"
 #include "cashaddr.h"
 #include "btchip_apdu_get_wallet_public_key.h"
+#include "../crypto.h"
+
+// Maximum length of the data of the response of a batch request
+#define BATCH_MAX_RESPONSE_LENGTH 255
 
 int get_public_key_chain_code(unsigned char* keyPath, bool uncompressedPublicKeys, unsigned char* publicKey, unsigned char* chainCode) {
-    cx_ecfp_private_key_t private_key;
-    cx_ecfp_public_key_t public_key;
-    int keyLength = 0;
-    btchip_private_derive_keypair(keyPath, 1, chainCode, &private_key, &public_key);
-    // Then encode it
+    uint32_t bip32Path[MAX_BIP32_PATH];
+    unsigned char bip32PathLength = keyPath[0];
+    unsigned char i;
+    if (bip32PathLength > MAX_BIP32_PATH) {
+        THROW(INVALID_PARAMETER);
+    }
+    for (i = 0; i < bip32PathLength; i++) {
+        bip32Path[i] = btchip_read_u32(keyPath + 1 + 4 * i, 1, 0);
+    }
+
+    // the non-hardened tail of the path is derived from the cached xpub of its hardened prefix
+    unsigned char compressedPublicKey[33];
+    io_seproxyhal_io_heartbeat();
+    crypto_get_compressed_pubkey_at_path(bip32Path, bip32PathLength, compressedPublicKey, chainCode);
+    io_seproxyhal_io_heartbeat();
+
+    // the full point is always written, as the response restores it from a compressed key
+    if (crypto_get_uncompressed_pubkey(compressedPublicKey, publicKey) < 0) {
+        THROW(EXCEPTION);
+    }
     if (uncompressedPublicKeys) {
-        keyLength = 65;
+        return 65;
+    }
+    publicKey[0] = compressedPublicKey[0];
+    return 33;
+}
+
+// Encodes the address of the public key as in the response (P2PKH, P2SH-P2WPKH, P2WPKH or
+// CashAddr); returns its length.
+static unsigned char encode_address(unsigned char *publicKey,
+                                    unsigned char keyLength,
+                                    bool segwit,
+                                    bool nativeSegwit,
+                                    bool cashAddr,
+                                    unsigned char *out,
+                                    unsigned char outLength) {
+    unsigned char addressLength = 0;
+    if (cashAddr) {
+        uint8_t tmp[20];
+        btchip_public_key_hash160(publicKey, // IN
+                                  keyLength, // INLEN
+                                  tmp);
+        addressLength =
+            cashaddr_encode(tmp, 20, out, outLength, CASHADDR_P2PKH);
+    } else if (!(segwit || nativeSegwit)) {
+        addressLength = btchip_public_key_to_encoded_base58(
+            publicKey, // IN
+            keyLength, // INLEN
+            out,       // OUT
+            outLength, // MAXOUTLEN
+            G_coin_config->p2pkh_version, 0);
     } else {
-        btchip_compress_public_key_value(public_key.W);
-        keyLength = 33;
+        uint8_t tmp[22];
+        tmp[0] = 0x00;
+        tmp[1] = 0x14;
+        btchip_public_key_hash160(publicKey, // IN
+                                  keyLength, // INLEN
+                                  tmp + 2    // OUT
+                                  );
+        if (!nativeSegwit) {
+            addressLength = btchip_public_key_to_encoded_base58(
+                tmp,       // IN
+                22,        // INLEN
+                out,       // OUT
+                outLength, // MAXOUTLEN
+                G_coin_config->p2sh_version, 0);
+        } else {
+            // the buffer must have room for 73 + strlen(hrp) characters
+            if (G_coin_config->native_segwit_prefix &&
+                outLength >= 73 + strlen((char *)PIC(G_coin_config->native_segwit_prefix))) {
+                if (segwit_addr_encode(
+                    (char *)out,
+                    (char *)PIC(G_coin_config->native_segwit_prefix), 0, tmp + 2, 20) == 1) {
+                    addressLength = strlen((char *)out);
+                }
+            }
+        }
     }
+    return addressLength;
+}
+
+/**
+ * Batch variant of GET_WALLET_PUBLIC_KEY without display (P1 = P1_NO_DISPLAY_BATCH), for the
+ * pools of addresses: the data is the path of the parent, followed by the index of the first
+ * child (4 bytes, big endian, not hardened) and the number of children (1 byte). The parent is
+ * derived once, and its children with CKDpub.
+ *
+ * The response is the number n of children returned, followed for each one by
+ * len(pub_key) (1) || pub_key (var) || len(addr) (1) || addr (var), without the chain codes.
+ * The key is compressed unless the uncompressed keys option is set. n is less than the number of
+ * children requested if the others do not fit in the response; they are requested again by the
+ * client, starting from the first child that was not returned.
+ */
+static unsigned short get_wallet_public_keys_batch(bool uncompressedPublicKeys,
+                                                   bool segwit,
+                                                   bool nativeSegwit,
+                                                   bool cashAddr) {
+    unsigned char *parentPath = G_io_apdu_buffer + ISO_OFFSET_CDATA;
+    unsigned char parentPathLength = parentPath[0];
+    cx_ecfp_private_key_t private_key;
+    cx_ecfp_public_key_t parent_public_key;
+    unsigned char parentChainCode[32];
+    unsigned char childChainCode[32];
+    unsigned char childPublicKey[65];
+    unsigned char address[90];
 
-    os_memmove(publicKey, public_key.W,
-               sizeof(public_key.W));
-    return keyLength;
+    if (parentPathLength > MAX_BIP32_PATH ||
+        G_io_apdu_buffer[ISO_OFFSET_LC] != 1 + 4 * parentPathLength + 4 + 1) {
+        return BTCHIP_SW_INCORRECT_LENGTH;
+    }
+    uint32_t firstIndex = btchip_read_u32(parentPath + 1 + 4 * parentPathLength, 1, 0);
+    unsigned char count = parentPath[1 + 4 * parentPathLength + 4];
+    if (count == 0 || firstIndex >= 0x80000000 || count > 0x80000000 - firstIndex) {
+        return BTCHIP_SW_INCORRECT_DATA;
+    }
+
+    btchip_private_derive_keypair(parentPath, 1, parentChainCode, &private_key,
+                                  &parent_public_key);
+    explicit_bzero(&private_key, sizeof(private_key));
+
+    unsigned short offset = 1;
+    unsigned char n = 0;
+    for (; n < count; n++) {
+        if (bip32_CKDpub_uncompressed(parentChainCode, parent_public_key.W, firstIndex + n,
+                                      childChainCode, childPublicKey) < 0) {
+            return BTCHIP_SW_INCORRECT_DATA;  // invalid child, with probability lower than 2^-127
+        }
+        unsigned char keyLength = 65;
+        if (!uncompressedPublicKeys) {
+            btchip_compress_public_key_value(childPublicKey);
+            keyLength = 33;
+        }
+        unsigned char addressLength = encode_address(childPublicKey, keyLength, segwit,
+                                                     nativeSegwit, cashAddr, address,
+                                                     sizeof(address));
+        if (addressLength == 0) {
+            return BTCHIP_SW_INCORRECT_DATA;
+        }
+        if (offset + 1 + keyLength + 1 + addressLength > BATCH_MAX_RESPONSE_LENGTH) {
+            break;
+        }
+        G_io_apdu_buffer[offset++] = keyLength;
+        os_memmove(G_io_apdu_buffer + offset, childPublicKey, keyLength);
+        offset += keyLength;
+        G_io_apdu_buffer[offset++] = addressLength;
+        os_memmove(G_io_apdu_buffer + offset, address, addressLength);
+        offset += addressLength;
+    }
+    G_io_apdu_buffer[0] = n;
+    btchip_context_D.outLength = offset;
+    return BTCHIP_SW_OK;
 }
 
 unsigned short btchip_apdu_get_wallet_public_key() {
@@ -57,6 +197,7 @@ unsigned short btchip_apdu_get_wallet_public_key() {
     bool display = (G_io_apdu_buffer[ISO_OFFSET_P1] == P1_DISPLAY);
     bool display_request_token = N_btchip.pubKeyRequestRestriction && (G_io_apdu_buffer[ISO_OFFSET_P1] == P1_REQUEST_TOKEN) && G_io_apdu_media == IO_APDU_MEDIA_U2F;
     bool require_user_approval = N_btchip.pubKeyRequestRestriction && !(display_request_token || display) && G_io_apdu_media == IO_APDU_MEDIA_U2F;
+    bool batch = (G_io_apdu_buffer[ISO_OFFSET_P1] == P1_NO_DISPLAY_BATCH);
     bool segwit = (G_io_apdu_buffer[ISO_OFFSET_P2] == P2_SEGWIT);
     bool nativeSegwit = (G_io_apdu_buffer[ISO_OFFSET_P2] == P2_NATIVE_SEGWIT);
     bool cashAddr = (G_io_apdu_buffer[ISO_OFFSET_P2] == P2_CASHADDR);
@@ -67,6 +208,7 @@ unsigned short btchip_apdu_get_wallet_public_key() {
     case P1_NO_DISPLAY:
     case P1_DISPLAY:
     case P1_REQUEST_TOKEN:
+    case P1_NO_DISPLAY_BATCH:
         break;
     default:
         return BTCHIP_SW_INCORRECT_P1_P2;
@@ -81,7 +223,7 @@ unsigned short btchip_apdu_get_wallet_public_key() {
     case P2_SEGWIT:
         break;
     case P2_CASHADDR:
-        if (G_coin_config->kind != COIN_KIND_BITCOIN_CASH) {
+        if (!COIN_KIND_IS(COIN_KIND_BITCOIN_CASH)) {
             return BTCHIP_SW_INCORRECT_P1_P2;
         }
         break;
@@ -119,49 +261,20 @@ unsigned short btchip_apdu_get_wallet_public_key() {
 
     unsigned char bip44_enforced = enforce_bip44_coin_type(G_io_apdu_buffer + ISO_OFFSET_CDATA, true);
 
+    if (batch) {
+        // the addresses can't be displayed: only for the standard paths, without approval
+        if (!bip44_enforced || require_user_approval) {
+            return BTCHIP_SW_CONDITIONS_OF_USE_NOT_SATISFIED;
+        }
+        return get_wallet_public_keys_batch(uncompressedPublicKeys, segwit, nativeSegwit,
+                                            cashAddr);
+    }
+
     G_io_apdu_buffer[0] = 65;
     keyLength = get_public_key_chain_code(G_io_apdu_buffer + ISO_OFFSET_CDATA, uncompressedPublicKeys, G_io_apdu_buffer + 1, chainCode);
 
-    if (cashAddr) {
-        uint8_t tmp[20];
-        btchip_public_key_hash160(G_io_apdu_buffer + 1, // IN
-                                  keyLength,            // INLEN
-                                  tmp);
-        keyLength =
-            cashaddr_encode(tmp, 20, G_io_apdu_buffer + 67, 50, CASHADDR_P2PKH);
-    } else if (!(segwit || nativeSegwit)) {
-        keyLength = btchip_public_key_to_encoded_base58(
-            G_io_apdu_buffer + 1,  // IN
-            keyLength,             // INLEN
-            G_io_apdu_buffer + 67, // OUT
-            150,                   // MAXOUTLEN
-            G_coin_config->p2pkh_version, 0);
-    } else {
-        uint8_t tmp[22];
-        tmp[0] = 0x00;
-        tmp[1] = 0x14;
-        btchip_public_key_hash160(G_io_apdu_buffer + 1, // IN
-                                  keyLength,            // INLEN
-                                  tmp + 2               // OUT
-                                  );
-        if (!nativeSegwit) {
-            keyLength = btchip_public_key_to_encoded_base58(
-                tmp,                   // IN
-                22,                    // INLEN
-                G_io_apdu_buffer + 67, // OUT
-                150,                   // MAXOUTLEN
-                G_coin_config->p2sh_version, 0);
-        } else {
-            if (G_coin_config->native_segwit_prefix) {
-                keyLength = segwit_addr_encode(
-                    (char *)(G_io_apdu_buffer + 67),
-                    (char *)PIC(G_coin_config->native_segwit_prefix), 0, tmp + 2, 20);
-                if (keyLength == 1) {
-                    keyLength = strlen((char *)(G_io_apdu_buffer + 67));
-                }
-            }
-        }
-    }
+    keyLength = encode_address(G_io_apdu_buffer + 1, keyLength, segwit, nativeSegwit, cashAddr,
+                               G_io_apdu_buffer + 67, cashAddr ? 50 : 150);
     G_io_apdu_buffer[66] = keyLength;
     PRINTF("Length %d\n", keyLength);
     if (!uncompressedPublicKeys) {
@@ -4,6 +4,7 @@
 #define P1_NO_DISPLAY 0x00
 #define P1_DISPLAY 0x01
 #define P1_REQUEST_TOKEN 0x02
+#define P1_NO_DISPLAY_BATCH 0x04
 
 #define P2_LEGACY 0x00
 #define P2_SEGWIT 0x01
@@ -46,7 +46,7 @@ static bool check_output_displayable() {
     bool displayable = true;
     unsigned char amount[8], isOpReturn, isP2sh, isNativeSegwit, j,
         nullAmount = 1;
-    unsigned char isOpCreate, isOpCall;
+    unsigned char isRegular, isOpCreate, isOpCall, scriptType;
 
     for (j = 0; j < 8; j++) {
         if (btchip_context_D.currentOutput[j] != 0) {
@@ -59,22 +59,21 @@ static bool check_output_displayable() {
         transaction_amount_add_be(btchip_context_D.totalOutputAmount,
                                   btchip_context_D.totalOutputAmount, amount);
     }
-    isOpReturn =
-        btchip_output_script_is_op_return(btchip_context_D.currentOutput + 8);
-    isP2sh = btchip_output_script_is_p2sh(btchip_context_D.currentOutput + 8);
-    isNativeSegwit = btchip_output_script_is_native_witness(
-        btchip_context_D.currentOutput + 8);
-    isOpCreate =
-        btchip_output_script_is_op_create(btchip_context_D.currentOutput + 8,
+    // the script is classified once, as soon as the whole output is received
+    scriptType =
+        btchip_output_script_get_type(btchip_context_D.currentOutput + 8,
           sizeof(btchip_context_D.currentOutput) - 8);
-    isOpCall =
-        btchip_output_script_is_op_call(btchip_context_D.currentOutput + 8,
-          sizeof(btchip_context_D.currentOutput) - 8);
-    if (((G_coin_config->kind == COIN_KIND_QTUM || G_coin_config->kind == COIN_KIND_HYDRA) &&
-         !btchip_output_script_is_regular(btchip_context_D.currentOutput + 8) &&
+    isRegular = (scriptType & OUTPUT_SCRIPT_TYPE_REGULAR) != 0;
+    isOpReturn = (scriptType & OUTPUT_SCRIPT_TYPE_OP_RETURN) != 0;
+    isP2sh = (scriptType & OUTPUT_SCRIPT_TYPE_P2SH) != 0;
+    isNativeSegwit = (scriptType & OUTPUT_SCRIPT_TYPE_NATIVE_WITNESS) != 0;
+    isOpCreate = (scriptType & OUTPUT_SCRIPT_TYPE_OP_CREATE) != 0;
+    isOpCall = (scriptType & OUTPUT_SCRIPT_TYPE_OP_CALL) != 0;
+    if (((COIN_KIND_IS(COIN_KIND_QTUM) || COIN_KIND_IS(COIN_KIND_HYDRA)) &&
+         !isRegular &&
          !isP2sh && !(nullAmount && isOpReturn) && !isOpCreate && !isOpCall) ||
-        (!(G_coin_config->kind == COIN_KIND_QTUM || G_coin_config->kind == COIN_KIND_HYDRA) &&
-         !btchip_output_script_is_regular(btchip_context_D.currentOutput + 8) &&
+        (!(COIN_KIND_IS(COIN_KIND_QTUM) || COIN_KIND_IS(COIN_KIND_HYDRA)) &&
+         !isRegular &&
          !isP2sh && !(nullAmount && isOpReturn))) {
         PRINTF("Error : Unrecognized output script");
         THROW(EXCEPTION);
@@ -99,7 +98,7 @@ static bool check_output_displayable() {
             btchip_public_key_hash160(changeSegwit, 22, changeSegwit);
             if (os_memcmp(btchip_context_D.currentOutput + 8 + addressOffset,
                           changeSegwit, 20) == 0) {
-                if (G_coin_config->flags & FLAG_SEGWIT_CHANGE_SUPPORT) {
+                if (COIN_FLAG_IS_SET(FLAG_SEGWIT_CHANGE_SUPPORT)) {
                     changeFound = true;
                 } else {
                     // Attempt to avoid fatal failures on Bitcoin Cash
@@ -305,6 +304,10 @@ unsigned short btchip_apdu_hash_input_finalize_full_internal(
                            G_io_apdu_buffer + ISO_OFFSET_CDATA,
                            MAX_BIP32_PATH_LENGTH);
 
+                // The change key is derived only here, once per transaction: the
+                // outputs (even split over several APDUs) are compared with the
+                // cached hash160 in tmpCtx.output.changeAddress, and changeAccepted
+                // prevents another CHANGEINFO until the next transaction.
                 get_pubkey_hash160(transactionSummary->keyPath, btchip_context_D.tmpCtx.output.changeAddress);
                 PRINTF("Change address = %.*H\n", 20, btchip_context_D.tmpCtx.output.changeAddress);
 
@@ -334,7 +337,7 @@ unsigned short btchip_apdu_hash_input_finalize_full_internal(
                     sw = BTCHIP_SW_INCORRECT_DATA;
                     goto discardTransaction;
                 }
-                if (btchip_context_D.usingOverwinter) {
+                if (TX_USING_OVERWINTER) {
                     cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, G_io_apdu_buffer + ISO_OFFSET_CDATA + hashOffset, apduLength - hashOffset, NULL, 0);
                 }
                 else {
@@ -394,7 +397,7 @@ unsigned short btchip_apdu_hash_input_finalize_full_internal(
 
             if (btchip_context_D.usingSegwit) {
                 if (!btchip_context_D.segwitParsedOnce) {
-                    if (btchip_context_D.usingOverwinter) {
+                    if (TX_USING_OVERWINTER) {
                         cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, CX_LAST, btchip_context_D.segwit.cache.hashedOutputs, 0, btchip_context_D.segwit.cache.hashedOutputs, 32);
                     }
                     else {
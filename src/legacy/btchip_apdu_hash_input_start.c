@@ -28,6 +28,14 @@
 #define P2_NEW_SEGWIT_CASHADDR 0x03
 #define P2_NEW_SEGWIT_OVERWINTER 0x04
 #define P2_NEW_SEGWIT_SAPLING 0x05
+// In segwit mode, the first pass over all the inputs (P1_FIRST with one of the P2_NEW_SEGWIT*)
+// computes hashPrevouts and hashSequence, and HASH_INPUT_FINALIZE_FULL computes hashOutputs after
+// the outputs are validated by the user; they are kept in btchip_context_D.segwit.cache. Since
+// each BIP143 preimage only depends on the input being signed and on these hashes, the client is
+// expected to sign each input with P2_CONTINUE, streaming only that input: the cached hashes are
+// reused, and signing n inputs takes O(n) instead of streaming all the inputs again for each one.
+// The cache is only valid for the current transaction: a new P2_NEW_SEGWIT* resets it, and the
+// outputs have to be validated again.
 #define P2_CONTINUE 0x80
 
 #define IS_INPUT()                                                          \
@@ -96,10 +104,10 @@ unsigned short btchip_apdu_hash_input_start() {
             btchip_context_D.transactionContext.relaxed = 0;
             btchip_context_D.usingSegwit = usingSegwit;
             btchip_context_D.usingCashAddr =
-                (G_coin_config->kind == COIN_KIND_BITCOIN_CASH ? usingCashAddr
+                (COIN_KIND_IS(COIN_KIND_BITCOIN_CASH) ? usingCashAddr
                                                                : 0);
             btchip_context_D.usingOverwinter = 0;
-            if ((G_coin_config->kind == COIN_KIND_ZCASH) || (G_coin_config->kind == COIN_KIND_KOMODO) || (G_coin_config->kind == COIN_KIND_ZCLASSIC) || (G_coin_config->kind == COIN_KIND_RESISTANCE)) {
+            if ((COIN_KIND_IS(COIN_KIND_ZCASH)) || (COIN_KIND_IS(COIN_KIND_KOMODO)) || (COIN_KIND_IS(COIN_KIND_ZCLASSIC)) || (COIN_KIND_IS(COIN_KIND_RESISTANCE))) {
                 if (G_io_apdu_buffer[ISO_OFFSET_P2] == P2_NEW_SEGWIT_OVERWINTER) {
                     btchip_context_D.usingOverwinter = ZCASH_USING_OVERWINTER;
                 }
@@ -110,6 +118,8 @@ unsigned short btchip_apdu_hash_input_start() {
             }
             btchip_context_D.overwinterSignReady = 0;
             btchip_context_D.segwitParsedOnce = 0;
+            btchip_signing_key_cache_reset();
+            btchip_trusted_input_cache_reset();
             btchip_set_check_internal_structure_integrity(1);
             // Initialize for screen pairing
             os_memset(&btchip_context_D.tmpCtx.output, 0,
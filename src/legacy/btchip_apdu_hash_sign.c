@@ -52,125 +52,147 @@ unsigned short btchip_apdu_hash_sign() {
     }
 
     // Check state
-    BEGIN_TRY {
-        TRY {
-            btchip_set_check_internal_structure_integrity(0);
-
-            // Zcash special - store parameters for later
-
-            if ((btchip_context_D.usingOverwinter) &&
-                (!btchip_context_D.overwinterSignReady) &&
-                (btchip_context_D.segwitParsedOnce) &&
-                (btchip_context_D.transactionContext.transactionState == BTCHIP_TRANSACTION_NONE)) {
-                unsigned long int expiryHeight;
-                parameters += (4 * G_io_apdu_buffer[ISO_OFFSET_CDATA]) + 1;
-                authorizationLength = *(parameters++);
-                parameters += authorizationLength;
-                lockTime = btchip_read_u32(parameters, 1, 0);
-                parameters += 4;
-                sighashType = *(parameters++);
-                expiryHeight = btchip_read_u32(parameters, 1, 0);
-                btchip_write_u32_le(btchip_context_D.nLockTime, lockTime);
-                btchip_write_u32_le(btchip_context_D.sigHashType, sighashType);
-                btchip_write_u32_le(btchip_context_D.nExpiryHeight, expiryHeight);
-                btchip_context_D.overwinterSignReady = 1;
-                CLOSE_TRY;
-                return BTCHIP_SW_OK;
-            }
+    btchip_set_check_internal_structure_integrity(0);
+
+    // Zcash special - store parameters for later
+
+    if ((TX_USING_OVERWINTER) &&
+        (!btchip_context_D.overwinterSignReady) &&
+        (btchip_context_D.segwitParsedOnce) &&
+        (btchip_context_D.transactionContext.transactionState == BTCHIP_TRANSACTION_NONE)) {
+        unsigned long int expiryHeight;
+        parameters += (4 * G_io_apdu_buffer[ISO_OFFSET_CDATA]) + 1;
+        authorizationLength = *(parameters++);
+        parameters += authorizationLength;
+        lockTime = btchip_read_u32(parameters, 1, 0);
+        parameters += 4;
+        sighashType = *(parameters++);
+        expiryHeight = btchip_read_u32(parameters, 1, 0);
+        btchip_write_u32_le(btchip_context_D.nLockTime, lockTime);
+        btchip_write_u32_le(btchip_context_D.sigHashType, sighashType);
+        btchip_write_u32_le(btchip_context_D.nExpiryHeight, expiryHeight);
+        btchip_context_D.overwinterSignReady = 1;
+        btchip_set_check_internal_structure_integrity(1);
+        return BTCHIP_SW_OK;
+    }
 
-            if (btchip_context_D.transactionContext.transactionState !=
-                BTCHIP_TRANSACTION_SIGN_READY) {
-                PRINTF("Invalid transaction state %d\n", btchip_context_D.transactionContext.transactionState);
-                sw = BTCHIP_SW_CONDITIONS_OF_USE_NOT_SATISFIED;
-                goto discardTransaction;
-            }
+    if (btchip_context_D.transactionContext.transactionState !=
+        BTCHIP_TRANSACTION_SIGN_READY) {
+        PRINTF("Invalid transaction state %d\n", btchip_context_D.transactionContext.transactionState);
+        sw = BTCHIP_SW_CONDITIONS_OF_USE_NOT_SATISFIED;
+        goto discardTransaction;
+    }
 
-            if (btchip_context_D.usingOverwinter && !btchip_context_D.overwinterSignReady) {
-                PRINTF("Overwinter not ready to sign\n");
-                sw = BTCHIP_SW_CONDITIONS_OF_USE_NOT_SATISFIED;
-                goto discardTransaction;
-            }
+    if (TX_USING_OVERWINTER && !btchip_context_D.overwinterSignReady) {
+        PRINTF("Overwinter not ready to sign\n");
+        sw = BTCHIP_SW_CONDITIONS_OF_USE_NOT_SATISFIED;
+        goto discardTransaction;
+    }
 
-            // Read parameters
-            if (G_io_apdu_buffer[ISO_OFFSET_CDATA] > MAX_BIP32_PATH) {
+    // Read parameters
+    if (G_io_apdu_buffer[ISO_OFFSET_CDATA] > MAX_BIP32_PATH) {
+        sw = BTCHIP_SW_INCORRECT_DATA;
+        goto discardTransaction;
+    }
+    os_memmove(btchip_context_D.transactionSummary.keyPath,
+        G_io_apdu_buffer + ISO_OFFSET_CDATA,
+        MAX_BIP32_PATH_LENGTH);
+    parameters += (4 * G_io_apdu_buffer[ISO_OFFSET_CDATA]) + 1;
+    authorizationLength = *(parameters++);
+    parameters += authorizationLength;
+    lockTime = btchip_read_u32(parameters, 1, 0);
+    parameters += 4;
+    sighashType = *(parameters++);
+    btchip_context_D.transactionSummary.sighashType = sighashType;
+
+    if (((N_btchip.bkp.config.options &
+          BTCHIP_OPTION_FREE_SIGHASHTYPE) == 0)) {
+        // if bitcoin cash OR forkid is set, then use the fork id
+        if (COIN_KIND_IS(COIN_KIND_BITCOIN_CASH) ||
+            (COIN_CONFIG_FORKID)) {
+#define SIGHASH_FORKID 0x40
+            if (sighashType != (SIGHASH_ALL | SIGHASH_FORKID)) {
                 sw = BTCHIP_SW_INCORRECT_DATA;
-            discardTransaction:
-                CLOSE_TRY;
-                goto catch_discardTransaction;
+                goto discardTransaction;
             }
-            os_memmove(btchip_context_D.transactionSummary.keyPath,
-                G_io_apdu_buffer + ISO_OFFSET_CDATA,
-                MAX_BIP32_PATH_LENGTH);
-            parameters += (4 * G_io_apdu_buffer[ISO_OFFSET_CDATA]) + 1;
-            authorizationLength = *(parameters++);
-            parameters += authorizationLength;
-            lockTime = btchip_read_u32(parameters, 1, 0);
-            parameters += 4;
-            sighashType = *(parameters++);
-            btchip_context_D.transactionSummary.sighashType = sighashType;
-
-            if (((N_btchip.bkp.config.options &
-                  BTCHIP_OPTION_FREE_SIGHASHTYPE) == 0)) {
-                // if bitcoin cash OR forkid is set, then use the fork id
-                if (G_coin_config->kind == COIN_KIND_BITCOIN_CASH ||
-                    (G_coin_config->forkid)) {
-#define SIGHASH_FORKID 0x40
-                    if (sighashType != (SIGHASH_ALL | SIGHASH_FORKID)) {
-                        sw = BTCHIP_SW_INCORRECT_DATA;
-                        goto discardTransaction;
-                    }
-                    sighashType |= (G_coin_config->forkid << 8);
-                } else {
-                    if (sighashType != SIGHASH_ALL) {
-                        sw = BTCHIP_SW_INCORRECT_DATA;
-                        goto discardTransaction;
-                    }
-                }
+            sighashType |= (COIN_CONFIG_FORKID << 8);
+        } else {
+            if (sighashType != SIGHASH_ALL) {
+                sw = BTCHIP_SW_INCORRECT_DATA;
+                goto discardTransaction;
             }
+        }
+    }
 
-            // Finalize the hash
-            if (!btchip_context_D.usingOverwinter) {
-                btchip_write_u32_le(dataBuffer, lockTime);
-                btchip_write_u32_le(dataBuffer + 4, sighashType);
-                PRINTF("--- ADD TO HASH FULL:\n%.*H\n", sizeof(dataBuffer), dataBuffer);
-                cx_hash(&btchip_context_D.transactionHashFull.sha256.header, 0,
-                    dataBuffer, sizeof(dataBuffer), NULL, 0);
-            }
+    // Finalize the hash
+    if (!TX_USING_OVERWINTER) {
+        btchip_write_u32_le(dataBuffer, lockTime);
+        btchip_write_u32_le(dataBuffer + 4, sighashType);
+        PRINTF("--- ADD TO HASH FULL:\n%.*H\n", sizeof(dataBuffer), dataBuffer);
+        cx_hash(&btchip_context_D.transactionHashFull.sha256.header, 0,
+            dataBuffer, sizeof(dataBuffer), NULL, 0);
+    }
 
-            // Check if the path needs to be enforced
-            if (!enforce_bip44_coin_type(btchip_context_D.transactionSummary.keyPath, false)) {
-                btchip_context_D.io_flags |= IO_ASYNCH_REPLY;
-                btchip_bagl_request_sign_path_approval(btchip_context_D.transactionSummary.keyPath);
-            }
-            else {
-                // Sign immediately
+    // Check if the path needs to be enforced
+    if (!enforce_bip44_coin_type(btchip_context_D.transactionSummary.keyPath, false)) {
+        btchip_context_D.io_flags |= IO_ASYNCH_REPLY;
+        btchip_bagl_request_sign_path_approval(btchip_context_D.transactionSummary.keyPath);
+    }
+    else {
+        // Sign immediately; only the derivation and the signature can raise an exception
+        sw = BTCHIP_SW_OK;
+        BEGIN_TRY {
+            TRY {
                 btchip_bagl_user_action_signtx(1, 1);
             }
-            sw = BTCHIP_SW_OK;
-            if (btchip_context_D.called_from_swap) {
-                // if we signed all outputs we should exit,
-                // but only after sending response, so lets raise the
-                // vars.swap_data.should_exit flag and check it on timer later
-                vars.swap_data.alreadySignedInputs++;
-                if (vars.swap_data.alreadySignedInputs >= vars.swap_data.totalNumberOfInputs) {
-                    vars.swap_data.should_exit = 1;
-                }
+            CATCH_ALL {
+                sw = SW_TECHNICAL_DETAILS(0xF);
             }
-
-            // Then discard the transaction and reply
+            FINALLY;
         }
-        CATCH_ALL {
-            sw = SW_TECHNICAL_DETAILS(0xF);
-        catch_discardTransaction:
-            btchip_context_D.transactionContext.transactionState =
-                BTCHIP_TRANSACTION_NONE;
+        END_TRY;
+        if (sw != BTCHIP_SW_OK) {
+            goto discardTransaction;
         }
-        FINALLY {
-            btchip_set_check_internal_structure_integrity(1);
-            return sw;
+    }
+    sw = BTCHIP_SW_OK;
+    if (btchip_context_D.called_from_swap) {
+        // if we signed all outputs we should exit,
+        // but only after sending response, so lets raise the
+        // vars.swap_data.should_exit flag and check it on timer later
+        vars.swap_data.alreadySignedInputs++;
+        if (vars.swap_data.alreadySignedInputs >= vars.swap_data.totalNumberOfInputs) {
+            vars.swap_data.should_exit = 1;
         }
     }
-    END_TRY;
+    btchip_set_check_internal_structure_integrity(1);
+    return sw;
+
+discardTransaction:
+    btchip_context_D.transactionContext.transactionState =
+        BTCHIP_TRANSACTION_NONE;
+    btchip_set_check_internal_structure_integrity(1);
+    return sw;
+}
+
+// Derives the private key at keyPath, unless the previous signature of the transaction used the
+// same path (for example, for several inputs sent to the same address): its key is then reused,
+// skipping the derivation from the seed
+static void get_signing_key(unsigned char *keyPath, cx_ecfp_private_key_t *private_key) {
+    // the length of the path was checked by btchip_apdu_hash_sign
+    unsigned char keyPathLength = 1 + 4 * keyPath[0];
+
+    if (btchip_context_D.signingKeyValid &&
+        os_memcmp(btchip_context_D.signingKeyPath, keyPath, keyPathLength) == 0) {
+        cx_ecdsa_init_private_key(BTCHIP_CURVE, btchip_context_D.signingKey, 32, private_key);
+        return;
+    }
+
+    btchip_signing_key_cache_reset();
+    btchip_private_derive_keypair(keyPath, 0, NULL, private_key, NULL);
+    os_memmove(btchip_context_D.signingKeyPath, keyPath, keyPathLength);
+    os_memmove(btchip_context_D.signingKey, private_key->d, 32);
+    btchip_context_D.signingKeyValid = 1;
 }
 
 void btchip_bagl_user_action_signtx(unsigned char confirming, unsigned char direct) {
@@ -180,8 +202,8 @@ void btchip_bagl_user_action_signtx(unsigned char confirming, unsigned char dire
     if (confirming) {
         unsigned char hash[32];
         // Fetch the private key
-        btchip_private_derive_keypair(btchip_context_D.transactionSummary.keyPath, 0, NULL, &private_key, NULL);
-        if (btchip_context_D.usingOverwinter) {
+        get_signing_key(btchip_context_D.transactionSummary.keyPath, &private_key);
+        if (TX_USING_OVERWINTER) {
             cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, CX_LAST, hash, 0, hash, 32);
         }
         else {
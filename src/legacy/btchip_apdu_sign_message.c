@@ -83,152 +83,139 @@ unsigned short btchip_apdu_sign_message_internal() {
         return BTCHIP_SW_SECURITY_STATUS_NOT_SATISFIED;
     }
 
-    BEGIN_TRY {
-        TRY {
-            if (p1 == P1_PREPARE) {
-                if ((p2 == P2_FIRST) || (p2 == P2_LEGACY)) {
-                    unsigned char chunkLength;
-                    unsigned char messageLength[3];
-                    unsigned char messageLengthSize;
-                    os_memset(&btchip_context_D.transactionSummary, 0,
-                              sizeof(btchip_transaction_summary_t));
-                    if (G_io_apdu_buffer[offset] > MAX_BIP32_PATH) {
-                        PRINTF("Invalid path\n");
-                        sw = BTCHIP_SW_INCORRECT_DATA;
-                        CLOSE_TRY;
-                        goto discard;
-                    }
-                    btchip_context_D.transactionSummary.payToAddressVersion =
-                        G_coin_config->p2pkh_version;
-                    btchip_context_D.transactionSummary.payToScriptHashVersion =
-                        G_coin_config->p2sh_version;
-                    os_memmove(
-                        btchip_context_D.transactionSummary.keyPath,
-                        G_io_apdu_buffer + offset, MAX_BIP32_PATH_LENGTH);
-                    offset += (4 * G_io_apdu_buffer[offset]) + 1;
-                    if (p2 == P2_LEGACY) {
-                        btchip_context_D.transactionSummary.messageLength =
-                            G_io_apdu_buffer[offset];
-                        offset++;
-                    } else {
-                        btchip_context_D.transactionSummary.messageLength =
-                            (G_io_apdu_buffer[offset] << 8) |
-                            (G_io_apdu_buffer[offset + 1]);
-                        offset += 2;
-                    }
-                    if (btchip_context_D.transactionSummary.messageLength ==
-                        0) {
-                        PRINTF("Null message length\n");
-                        sw = BTCHIP_SW_INCORRECT_DATA;
-                        CLOSE_TRY;
-                        goto discard;
-                    }
-                    btchip_context_D.hashedMessageLength = 0;
-                    cx_sha256_init(&btchip_context_D.transactionHashFull.sha256);
-                    cx_sha256_init(
-                        &btchip_context_D.transactionHashAuthorization);
-                    chunkLength =
-                        strlen(G_coin_config->coinid) + SIGNMAGIC_LENGTH;
-                    cx_hash(&btchip_context_D.transactionHashFull.sha256.header, 0,
-                            &chunkLength, 1, NULL, 0);
-                    cx_hash(&btchip_context_D.transactionHashFull.sha256.header, 0,
-                            (uint8_t *)G_coin_config->coinid,
-                            strlen(G_coin_config->coinid), NULL, 0);
-                    cx_hash(&btchip_context_D.transactionHashFull.sha256.header, 0,
-                            (unsigned char *)SIGNMAGIC, SIGNMAGIC_LENGTH, NULL, 0);
-                    if (btchip_context_D.transactionSummary.messageLength <
-                        0xfd) {
-                        messageLength[0] =
-                            btchip_context_D.transactionSummary.messageLength;
-                        messageLengthSize = 1;
-                    } else {
-                        messageLength[0] = 0xfd;
-                        messageLength[1] =
-                            (btchip_context_D.transactionSummary.messageLength &
-                             0xff);
-                        messageLength[2] = ((btchip_context_D.transactionSummary
-                                                 .messageLength >>
-                                             8) &
-                                            0xff);
-                        messageLengthSize = 3;
-                    }
-                    cx_hash(&btchip_context_D.transactionHashFull.sha256.header, 0,
-                            messageLength, messageLengthSize, NULL, 0);
-                    chunkLength = apduLength - (offset - ISO_OFFSET_CDATA);
-                    if ((btchip_context_D.hashedMessageLength + chunkLength) >
-                        btchip_context_D.transactionSummary.messageLength) {
-                        PRINTF("Invalid data length\n");
-                        sw = BTCHIP_SW_INCORRECT_DATA;
-                        CLOSE_TRY;
-                        goto discard;
-                    }
-                    cx_hash(&btchip_context_D.transactionHashFull.sha256.header, 0,
-                            G_io_apdu_buffer + offset, chunkLength, NULL, 0);
-                    cx_hash(
-                        &btchip_context_D.transactionHashAuthorization.header,
-                        0, G_io_apdu_buffer + offset, chunkLength, NULL, 0);
-                    btchip_context_D.hashedMessageLength += chunkLength;
-                    G_io_apdu_buffer[0] = 0x00;
-                    if (btchip_context_D.hashedMessageLength ==
-                        btchip_context_D.transactionSummary.messageLength) {
-                        G_io_apdu_buffer[1] = 0x00;
-                        btchip_context_D.outLength = 2;
-                    } else {
-                        btchip_context_D.outLength = 1;
-                    }
-                } else {
-                    if ((btchip_context_D.hashedMessageLength + apduLength) >
-                        btchip_context_D.transactionSummary.messageLength) {
-                        PRINTF("Invalid data length\n");
-                        sw = BTCHIP_SW_INCORRECT_DATA;
-                        CLOSE_TRY;
-                        goto discard;
-                    }
-                    cx_hash(&btchip_context_D.transactionHashFull.sha256.header, 0,
-                            G_io_apdu_buffer + offset, apduLength, NULL, 0);
-                    cx_hash(
-                        &btchip_context_D.transactionHashAuthorization.header,
-                        0, G_io_apdu_buffer + offset, apduLength, NULL, 0);
-                    btchip_context_D.hashedMessageLength += apduLength;
-                    G_io_apdu_buffer[0] = 0x00;
-                    if (btchip_context_D.hashedMessageLength ==
-                        btchip_context_D.transactionSummary.messageLength) {
-                        G_io_apdu_buffer[1] = 0x00;
-                        btchip_context_D.outLength = 2;
-                    } else {
-                        btchip_context_D.outLength = 1;
-                    }
-                }
+    // The message is only hashed here, nothing raises an exception: the signature has its own
+    // exception handler in btchip_compute_hash
+    if (p1 == P1_PREPARE) {
+        if ((p2 == P2_FIRST) || (p2 == P2_LEGACY)) {
+            unsigned char chunkLength;
+            unsigned char messageLength[3];
+            unsigned char messageLengthSize;
+            os_memset(&btchip_context_D.transactionSummary, 0,
+                      sizeof(btchip_transaction_summary_t));
+            if (G_io_apdu_buffer[offset] > MAX_BIP32_PATH) {
+                PRINTF("Invalid path\n");
+                sw = BTCHIP_SW_INCORRECT_DATA;
+                goto discard;
+            }
+            btchip_context_D.transactionSummary.payToAddressVersion =
+                G_coin_config->p2pkh_version;
+            btchip_context_D.transactionSummary.payToScriptHashVersion =
+                G_coin_config->p2sh_version;
+            os_memmove(
+                btchip_context_D.transactionSummary.keyPath,
+                G_io_apdu_buffer + offset, MAX_BIP32_PATH_LENGTH);
+            offset += (4 * G_io_apdu_buffer[offset]) + 1;
+            if (p2 == P2_LEGACY) {
+                btchip_context_D.transactionSummary.messageLength =
+                    G_io_apdu_buffer[offset];
+                offset++;
+            } else {
+                btchip_context_D.transactionSummary.messageLength =
+                    (G_io_apdu_buffer[offset] << 8) |
+                    (G_io_apdu_buffer[offset + 1]);
+                offset += 2;
+            }
+            if (btchip_context_D.transactionSummary.messageLength ==
+                0) {
+                PRINTF("Null message length\n");
+                sw = BTCHIP_SW_INCORRECT_DATA;
+                goto discard;
+            }
+            btchip_context_D.hashedMessageLength = 0;
+            cx_sha256_init(&btchip_context_D.transactionHashFull.sha256);
+            cx_sha256_init(
+                &btchip_context_D.transactionHashAuthorization);
+            chunkLength =
+                strlen(G_coin_config->coinid) + SIGNMAGIC_LENGTH;
+            cx_hash(&btchip_context_D.transactionHashFull.sha256.header, 0,
+                    &chunkLength, 1, NULL, 0);
+            cx_hash(&btchip_context_D.transactionHashFull.sha256.header, 0,
+                    (uint8_t *)G_coin_config->coinid,
+                    strlen(G_coin_config->coinid), NULL, 0);
+            cx_hash(&btchip_context_D.transactionHashFull.sha256.header, 0,
+                    (unsigned char *)SIGNMAGIC, SIGNMAGIC_LENGTH, NULL, 0);
+            if (btchip_context_D.transactionSummary.messageLength <
+                0xfd) {
+                messageLength[0] =
+                    btchip_context_D.transactionSummary.messageLength;
+                messageLengthSize = 1;
+            } else {
+                messageLength[0] = 0xfd;
+                messageLength[1] =
+                    (btchip_context_D.transactionSummary.messageLength &
+                     0xff);
+                messageLength[2] = ((btchip_context_D.transactionSummary
+                                         .messageLength >>
+                                     8) &
+                                    0xff);
+                messageLengthSize = 3;
+            }
+            cx_hash(&btchip_context_D.transactionHashFull.sha256.header, 0,
+                    messageLength, messageLengthSize, NULL, 0);
+            chunkLength = apduLength - (offset - ISO_OFFSET_CDATA);
+            if ((btchip_context_D.hashedMessageLength + chunkLength) >
+                btchip_context_D.transactionSummary.messageLength) {
+                PRINTF("Invalid data length\n");
+                sw = BTCHIP_SW_INCORRECT_DATA;
+                goto discard;
+            }
+            cx_hash(&btchip_context_D.transactionHashFull.sha256.header, 0,
+                    G_io_apdu_buffer + offset, chunkLength, NULL, 0);
+            cx_hash(
+                &btchip_context_D.transactionHashAuthorization.header,
+                0, G_io_apdu_buffer + offset, chunkLength, NULL, 0);
+            btchip_context_D.hashedMessageLength += chunkLength;
+            G_io_apdu_buffer[0] = 0x00;
+            if (btchip_context_D.hashedMessageLength ==
+                btchip_context_D.transactionSummary.messageLength) {
+                G_io_apdu_buffer[1] = 0x00;
+                btchip_context_D.outLength = 2;
             } else {
-                if ((btchip_context_D.transactionSummary.messageLength == 0) ||
-                    (btchip_context_D.hashedMessageLength !=
-                     btchip_context_D.transactionSummary.messageLength)) {
-                    PRINTF("Invalid length to sign\n");
-                    sw = BTCHIP_SW_INCORRECT_DATA;
-                    CLOSE_TRY;
-                    goto discard;
-                }
-                if (checkBitId(btchip_context_D.transactionSummary.keyPath) != BITID_NONE) {
-                    sw = btchip_compute_hash();
-                } else {
-                    btchip_context_D.io_flags |= IO_ASYNCH_REPLY;
-                    CLOSE_TRY;
-                    return BTCHIP_SW_OK;
-                }
+                btchip_context_D.outLength = 1;
+            }
+        } else {
+            if ((btchip_context_D.hashedMessageLength + apduLength) >
+                btchip_context_D.transactionSummary.messageLength) {
+                PRINTF("Invalid data length\n");
+                sw = BTCHIP_SW_INCORRECT_DATA;
+                goto discard;
+            }
+            cx_hash(&btchip_context_D.transactionHashFull.sha256.header, 0,
+                    G_io_apdu_buffer + offset, apduLength, NULL, 0);
+            cx_hash(
+                &btchip_context_D.transactionHashAuthorization.header,
+                0, G_io_apdu_buffer + offset, apduLength, NULL, 0);
+            btchip_context_D.hashedMessageLength += apduLength;
+            G_io_apdu_buffer[0] = 0x00;
+            if (btchip_context_D.hashedMessageLength ==
+                btchip_context_D.transactionSummary.messageLength) {
+                G_io_apdu_buffer[1] = 0x00;
+                btchip_context_D.outLength = 2;
+            } else {
+                btchip_context_D.outLength = 1;
             }
         }
-        CATCH_ALL {
-            sw = SW_TECHNICAL_DETAILS(0x0F);
+    } else {
+        if ((btchip_context_D.transactionSummary.messageLength == 0) ||
+            (btchip_context_D.hashedMessageLength !=
+             btchip_context_D.transactionSummary.messageLength)) {
+            PRINTF("Invalid length to sign\n");
+            sw = BTCHIP_SW_INCORRECT_DATA;
+            goto discard;
         }
-    discard : {
-        os_memset(&btchip_context_D.transactionSummary, 0,
-                  sizeof(btchip_transaction_summary_t));
-    }
-        FINALLY {
-            return sw;
+        if (checkBitId(btchip_context_D.transactionSummary.keyPath) != BITID_NONE) {
+            sw = btchip_compute_hash();
+        } else {
+            btchip_context_D.io_flags |= IO_ASYNCH_REPLY;
+            return BTCHIP_SW_OK;
         }
     }
-    END_TRY;
+    return sw;
+
+discard:
+    os_memset(&btchip_context_D.transactionSummary, 0,
+              sizeof(btchip_transaction_summary_t));
+    return sw;
 }
 
 unsigned short btchip_apdu_sign_message() {
@@ -21,6 +21,17 @@
 
 void btchip_autosetup(void);
 
+void btchip_signing_key_cache_reset(void) {
+    os_memset(btchip_context_D.signingKey, 0, sizeof(btchip_context_D.signingKey));
+    btchip_context_D.signingKeyValid = 0;
+}
+
+void btchip_trusted_input_cache_reset(void) {
+#if TRUSTED_INPUT_CACHE_SIZE > 0
+    btchip_context_D.verifiedTrustedInputsCount = 0;
+#endif
+}
+
 /**
  * Initialize the application context on boot
  */
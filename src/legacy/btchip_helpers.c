@@ -62,16 +62,9 @@ const unsigned char ZEN_OUTPUT_SCRIPT_POST[] = {
     0xb4              // OP_CHECKBLOCKATHEIGHT
 };                    // BIP0115 Replay Protection
 
-unsigned char btchip_output_script_is_regular(unsigned char *buffer) {
-    if (G_coin_config->native_segwit_prefix) {
-        if ((os_memcmp(buffer, TRANSACTION_OUTPUT_SCRIPT_P2WPKH_PRE,
-                       sizeof(TRANSACTION_OUTPUT_SCRIPT_P2WPKH_PRE)) == 0) ||
-            (os_memcmp(buffer, TRANSACTION_OUTPUT_SCRIPT_P2WSH_PRE,
-                       sizeof(TRANSACTION_OUTPUT_SCRIPT_P2WSH_PRE)) == 0)) {
-            return 1;
-        }
-    }
-    if (G_coin_config->kind == COIN_KIND_HORIZEN) {
+// P2PKH scripts, the regular ones that are not native witness programs
+static unsigned char output_script_is_p2pkh(unsigned char *buffer) {
+    if (COIN_KIND_IS(COIN_KIND_HORIZEN)) {
         if ((os_memcmp(buffer, ZEN_OUTPUT_SCRIPT_PRE,
                        sizeof(ZEN_OUTPUT_SCRIPT_PRE)) == 0) &&
             (os_memcmp(buffer + sizeof(ZEN_OUTPUT_SCRIPT_PRE) + 20,
@@ -91,8 +84,12 @@ unsigned char btchip_output_script_is_regular(unsigned char *buffer) {
     return 0;
 }
 
+unsigned char btchip_output_script_is_regular(unsigned char *buffer) {
+    return btchip_output_script_is_native_witness(buffer) || output_script_is_p2pkh(buffer);
+}
+
 unsigned char btchip_output_script_is_p2sh(unsigned char *buffer) {
-    if (G_coin_config->kind == COIN_KIND_HORIZEN) {
+    if (COIN_KIND_IS(COIN_KIND_HORIZEN)) {
         if ((os_memcmp(buffer, ZEN_TRANSACTION_OUTPUT_SCRIPT_P2SH_PRE,
                        sizeof(ZEN_TRANSACTION_OUTPUT_SCRIPT_P2SH_PRE)) == 0) &&
             (os_memcmp(buffer + sizeof(ZEN_TRANSACTION_OUTPUT_SCRIPT_P2SH_PRE) + 20,
@@ -125,7 +122,7 @@ unsigned char btchip_output_script_is_native_witness(unsigned char *buffer) {
 }
 
 unsigned char btchip_output_script_is_op_return(unsigned char *buffer) {
-    if (G_coin_config->kind == COIN_KIND_BITCOIN_CASH) {
+    if (COIN_KIND_IS(COIN_KIND_BITCOIN_CASH)) {
         return ((buffer[1] == 0x6A) || ((buffer[1] == 0x00) && (buffer[2] == 0x6A)));
     }
     else {
@@ -133,24 +130,40 @@ unsigned char btchip_output_script_is_op_return(unsigned char *buffer) {
     }
 }
 
-static unsigned char output_script_is_op_create_or_call(unsigned char *buffer,
-                                                        size_t size,
-                                                        unsigned char value) {
-    return (!btchip_output_script_is_regular(buffer) &&
-            !btchip_output_script_is_p2sh(buffer) &&
-            !btchip_output_script_is_op_return(buffer) && (buffer[0] <= 0xEA) &&
-            (buffer[0] < size) &&
-            (buffer[buffer[0]] == value));
+unsigned char btchip_output_script_get_type(unsigned char *buffer, size_t size) {
+    unsigned char type = 0;
+    if (btchip_output_script_is_native_witness(buffer)) {
+        type |= OUTPUT_SCRIPT_TYPE_NATIVE_WITNESS | OUTPUT_SCRIPT_TYPE_REGULAR;
+    } else if (output_script_is_p2pkh(buffer)) {
+        type |= OUTPUT_SCRIPT_TYPE_REGULAR;
+    }
+    if (btchip_output_script_is_p2sh(buffer)) {
+        type |= OUTPUT_SCRIPT_TYPE_P2SH;
+    }
+    if (btchip_output_script_is_op_return(buffer)) {
+        type |= OUTPUT_SCRIPT_TYPE_OP_RETURN;
+    }
+    // OP_CREATE and OP_CALL scripts end with their opcode, and are none of the above
+    if ((type == 0) && (buffer[0] <= 0xEA) && (buffer[0] < size)) {
+        if (buffer[buffer[0]] == 0xC1) {
+            type |= OUTPUT_SCRIPT_TYPE_OP_CREATE;
+        } else if (buffer[buffer[0]] == 0xC2) {
+            type |= OUTPUT_SCRIPT_TYPE_OP_CALL;
+        }
+    }
+    return type;
 }
 
 unsigned char btchip_output_script_is_op_create(unsigned char *buffer,
                                                 size_t size) {
-    return output_script_is_op_create_or_call(buffer, size, 0xC1);
+    return (btchip_output_script_get_type(buffer, size) &
+            OUTPUT_SCRIPT_TYPE_OP_CREATE) != 0;
 }
 
 unsigned char btchip_output_script_is_op_call(unsigned char *buffer,
                                               size_t size) {
-    return output_script_is_op_create_or_call(buffer, size, 0xC2);
+    return (btchip_output_script_get_type(buffer, size) &
+            OUTPUT_SCRIPT_TYPE_OP_CALL) != 0;
 }
 
 unsigned char btchip_rng_u8_modulo(unsigned char modulo) {
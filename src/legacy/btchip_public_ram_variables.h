@@ -27,4 +27,26 @@ extern btchip_context_t btchip_context_D;
 
 extern btchip_altcoin_config_t *G_coin_config;
 
+#ifdef HAVE_BITCOIN_ONLY
+// The app only runs with its own coin configuration (BITCOIN_ONLY=1 in the Makefile): the kind, the
+// flags and the fork id of the coin are constants, so the branches of the altcoins are removed at
+// compile time, and no transaction can use the Overwinter format of Zcash.
+#ifndef COIN_FLAGS
+#error "HAVE_BITCOIN_ONLY requires COIN_FLAGS"
+#endif
+#define COIN_KIND_IS(k) (COIN_KIND == (k))
+#define COIN_FLAG_IS_SET(flag) ((COIN_FLAGS & (flag)) != 0)
+#ifdef COIN_FORKID
+#define COIN_CONFIG_FORKID COIN_FORKID
+#else
+#define COIN_CONFIG_FORKID 0
+#endif
+#define TX_USING_OVERWINTER 0
+#else
+#define COIN_KIND_IS(k) (G_coin_config->kind == (k))
+#define COIN_FLAG_IS_SET(flag) ((G_coin_config->flags & (flag)) != 0)
+#define COIN_CONFIG_FORKID (G_coin_config->forkid)
+#define TX_USING_OVERWINTER (btchip_context_D.usingOverwinter)
+#endif
+
 #endif /* _BTCHIP_PUBLIC_RAM_VARIABLES_H_ */
@@ -26,20 +26,80 @@
 #define CONSENSUS_BRANCH_ID_ZCLASSIC 0x930b540d
 
 // Check if fOverwintered flag is set and if nVersion is >= 0x03
-#define TRUSTED_INPUT_OVERWINTER ( (G_coin_config->kind == COIN_KIND_ZCASH || \
-                                    G_coin_config->kind == COIN_KIND_ZCLASSIC || \
-                                    G_coin_config->kind == COIN_KIND_KOMODO) && \
+#define TRUSTED_INPUT_OVERWINTER ( (COIN_KIND_IS(COIN_KIND_ZCASH) || \
+                                    COIN_KIND_IS(COIN_KIND_ZCLASSIC) || \
+                                    COIN_KIND_IS(COIN_KIND_KOMODO)) && \
                                     (btchip_read_u32(btchip_context_D.transactionVersion, 0, 0) & (1<<31)) && \
                                     (btchip_read_u32(btchip_context_D.transactionVersion, 0, 0) ^ (1<<31)) >= 0x03 \
                                 )
 
 #define DEBUG_LONG "%d"
 
-void check_transaction_available(unsigned char x) {
+// Returns 1 if the Trusted Input starting at trustedInput, with its HMAC, is one of the ones
+// already verified in this transaction: it is then authentic, as the HMAC key does not change.
+static unsigned char trusted_input_cache_contains(const unsigned char *trustedInput,
+                                                  unsigned char trustedInputLength) {
+#if TRUSTED_INPUT_CACHE_SIZE > 0
+    if (trustedInputLength != TRUSTED_INPUT_TOTAL_SIZE) {
+        return 0;
+    }
+    for (unsigned char i = 0; i < btchip_context_D.verifiedTrustedInputsCount; i++) {
+        if (os_memcmp(btchip_context_D.verifiedTrustedInputs[i], trustedInput,
+                      TRUSTED_INPUT_TOTAL_SIZE) == 0) {
+            return 1;
+        }
+    }
+#else
+    (void) trustedInput;
+    (void) trustedInputLength;
+#endif
+    return 0;
+}
+
+// Remembers a Trusted Input whose HMAC was just verified. Once the cache is full, the next ones are
+// not added, so that the first inputs are still found when all the inputs are streamed again.
+static void trusted_input_cache_add(const unsigned char *trustedInput,
+                                    unsigned char trustedInputLength) {
+#if TRUSTED_INPUT_CACHE_SIZE > 0
+    if (trustedInputLength != TRUSTED_INPUT_TOTAL_SIZE ||
+        btchip_context_D.verifiedTrustedInputsCount == TRUSTED_INPUT_CACHE_SIZE) {
+        return;
+    }
+    os_memmove(btchip_context_D.verifiedTrustedInputs[btchip_context_D.verifiedTrustedInputsCount],
+               trustedInput, TRUSTED_INPUT_TOTAL_SIZE);
+    btchip_context_D.verifiedTrustedInputsCount++;
+#else
+    (void) trustedInput;
+    (void) trustedInputLength;
+#endif
+}
+
+// Computes the BLAKE2b personalization of the signature hash (the consensus branch id follows
+// "ZcashSigHash"), on the first pass over the inputs; each input signed after that reuses it.
+// The personalization is only xored with the IV by cx_blake2b_init2, so copying a whole
+// initialized context instead would not save any compression.
+static void init_overwinter_sighash_param(void) {
+    uint32_t branch_id;
+    if (COIN_KIND_IS(COIN_KIND_ZCLASSIC)) {
+        branch_id = CONSENSUS_BRANCH_ID_ZCLASSIC;
+    } else if (TX_USING_OVERWINTER == ZCASH_USING_OVERWINTER_SAPLING) {
+        branch_id = G_coin_config->zcash_consensus_branch_id != 0
+                        ? G_coin_config->zcash_consensus_branch_id
+                        : CONSENSUS_BRANCH_ID_SAPLING;
+    } else {
+        branch_id = CONSENSUS_BRANCH_ID_OVERWINTER;
+    }
+    os_memmove(btchip_context_D.overwinterSigHashParam, OVERWINTER_PARAM_SIGHASH, 16);
+    btchip_write_u32_le(btchip_context_D.overwinterSigHashParam + 12, branch_id);
+}
+
+// Returns 0 if less than x bytes remain in the current chunk
+static unsigned char check_transaction_available(unsigned char x) {
     if (btchip_context_D.transactionDataRemaining < x) {
         PRINTF("Check transaction available failed %d < %d\n", btchip_context_D.transactionDataRemaining, x);
-        THROW(EXCEPTION);
+        return 0;
     }
+    return 1;
 }
 
 #define OP_HASH160 0xA9
@@ -88,7 +148,7 @@ unsigned char transaction_amount_sub_be(unsigned char *target,
 void transaction_offset(unsigned char value) {
     if ((btchip_context_D.transactionHashOption & TRANSACTION_HASH_FULL) != 0) {
         PRINTF("--- ADD TO HASH FULL:\n%.*H\n", value, btchip_context_D.transactionBufferPointer);
-        if (btchip_context_D.usingOverwinter) {
+        if (TX_USING_OVERWINTER) {
             cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.transactionBufferPointer, value, NULL, 0);
         }
         else {
@@ -110,827 +170,925 @@ void transaction_offset_increase(unsigned char value) {
     btchip_context_D.transactionDataRemaining -= value;
 }
 
-unsigned long int transaction_get_varint(void) {
+// Reads a varint into *result; returns 0 on success, or the exception to raise at the end of the
+// parsing
+static unsigned short transaction_get_varint(unsigned long int *result) {
     unsigned char firstByte;
-    check_transaction_available(1);
+    if (!check_transaction_available(1)) {
+        return EXCEPTION;
+    }
     firstByte = *btchip_context_D.transactionBufferPointer;
     if (firstByte < 0xFD) {
         transaction_offset_increase(1);
-        return firstByte;
+        *result = firstByte;
+        return 0;
     } else if (firstByte == 0xFD) {
-        unsigned long int result;
         transaction_offset_increase(1);
-        check_transaction_available(2);
-        result =
+        if (!check_transaction_available(2)) {
+            return EXCEPTION;
+        }
+        *result =
             (unsigned long int)(*btchip_context_D.transactionBufferPointer) |
             ((unsigned long int)(*(btchip_context_D.transactionBufferPointer +
                                    1))
              << 8);
         transaction_offset_increase(2);
-        return result;
+        return 0;
     } else if (firstByte == 0xFE) {
-        unsigned long int result;
         transaction_offset_increase(1);
-        check_transaction_available(4);
-        result =
+        if (!check_transaction_available(4)) {
+            return EXCEPTION;
+        }
+        *result =
             btchip_read_u32(btchip_context_D.transactionBufferPointer, 0, 0);
         transaction_offset_increase(4);
-        return result;
+        return 0;
     } else {
         PRINTF("Varint parsing failed\n");
-        THROW(INVALID_PARAMETER);
-        return 0;
+        return INVALID_PARAMETER;
+    }
+}
+
+static unsigned char is_trusted_input_target(unsigned long int index) {
+    unsigned char i;
+    for (i = 0; i < btchip_context_D.transactionTargetInputCount; i++) {
+        if (btchip_context_D.transactionTargetInput[i] == index) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Size of the run of outputs at the current position that are entirely in the current chunk and
+// are not Trusted Input targets, so that they can be hashed and skipped with a single
+// transaction_offset_increase; their number is returned in count
+static unsigned char transaction_skippable_outputs_size(unsigned long int *count) {
+    unsigned short size = 0;
+    unsigned long int index =
+        btchip_context_D.transactionContext.transactionCurrentInputOutput;
+    *count = 0;
+    while (*count < btchip_context_D.transactionContext
+                        .transactionRemainingInputsOutputs &&
+           !is_trusted_input_target(index + *count)) {
+        unsigned char *output = btchip_context_D.transactionBufferPointer + size;
+        unsigned short available = btchip_context_D.transactionDataRemaining - size;
+        unsigned short outputSize;
+        // amount and script length
+        if (available < 8 + 1) {
+            break;
+        }
+        if (output[8] < 0xFD) {
+            outputSize = 8 + 1 + output[8];
+        } else if (output[8] == 0xFD && available >= 8 + 3) {
+            outputSize = 8 + 3 + (output[9] | (output[10] << 8));
+        } else {
+            // longer scripts never fit in a chunk
+            break;
+        }
+        if (outputSize > available) {
+            break;
+        }
+        size += outputSize;
+        (*count)++;
     }
+    return (unsigned char)size;
 }
 
 void transaction_parse(unsigned char parseMode) {
     unsigned char optionP2SHSkip2FA =
         ((N_btchip.bkp.config.options & BTCHIP_OPTION_SKIP_2FA_P2SH) != 0);
+    unsigned char operationMode;
+    unsigned short error;
+    // The integrity of the operation mode is checked once per chunk, not for each untrusted input
+    SB_CHECK_FAST(N_btchip.bkp.config.operationMode);
+    operationMode = SB_GET(N_btchip.bkp.config.operationMode);
     btchip_set_check_internal_structure_integrity(0);
-    BEGIN_TRY {
-        TRY {
-            for (;;) {
-                switch (btchip_context_D.transactionContext.transactionState) {
-                case BTCHIP_TRANSACTION_NONE: {
-                    PRINTF("Init transaction parser\n");
-                    // Reset transaction state
-                    btchip_context_D.transactionContext
-                        .transactionRemainingInputsOutputs = 0;
-                    btchip_context_D.transactionContext
-                        .transactionCurrentInputOutput = 0;
-                    btchip_context_D.transactionContext.scriptRemaining = 0;
-                    os_memset(
-                        btchip_context_D.transactionContext.transactionAmount,
-                        0, sizeof(btchip_context_D.transactionContext
-                                      .transactionAmount));
-                    // TODO : transactionControlFid
-                    // Reset hashes
-                    if (btchip_context_D.usingOverwinter) {
-                        if (btchip_context_D.segwitParsedOnce) {
-                            uint8_t parameters[16];
-                            os_memmove(parameters, OVERWINTER_PARAM_SIGHASH, 16);
-                            if (G_coin_config->kind == COIN_KIND_ZCLASSIC) {
-                                btchip_write_u32_le(parameters + 12, CONSENSUS_BRANCH_ID_ZCLASSIC);
-                            }
-                            else {
-                                btchip_write_u32_le(parameters + 12,
-                                    btchip_context_D.usingOverwinter == ZCASH_USING_OVERWINTER_SAPLING ?
-                                    (G_coin_config->zcash_consensus_branch_id != 0 ? G_coin_config->zcash_consensus_branch_id : CONSENSUS_BRANCH_ID_SAPLING) : CONSENSUS_BRANCH_ID_OVERWINTER);
-                            }
-                            cx_blake2b_init2(&btchip_context_D.transactionHashFull.blake2b, 256, NULL, 0, parameters, 16);
-                        }
+    for (;;) {
+        switch (btchip_context_D.transactionContext.transactionState) {
+        case BTCHIP_TRANSACTION_NONE: {
+            PRINTF("Init transaction parser\n");
+            // Reset transaction state
+            btchip_context_D.transactionContext
+                .transactionRemainingInputsOutputs = 0;
+            btchip_context_D.transactionContext
+                .transactionCurrentInputOutput = 0;
+            btchip_context_D.transactionContext.scriptRemaining = 0;
+            os_memset(
+                btchip_context_D.transactionContext.transactionAmount,
+                0, sizeof(btchip_context_D.transactionContext
+                              .transactionAmount));
+            // TODO : transactionControlFid
+            // Reset hashes
+            if (TX_USING_OVERWINTER) {
+                if (btchip_context_D.segwitParsedOnce) {
+                    cx_blake2b_init2(&btchip_context_D.transactionHashFull.blake2b, 256, NULL, 0, btchip_context_D.overwinterSigHashParam, 16);
+                }
+            }
+            else {
+                cx_sha256_init(&btchip_context_D.transactionHashFull.sha256);
+            }
+            cx_sha256_init(
+                &btchip_context_D.transactionHashAuthorization);
+            if (btchip_context_D.usingSegwit) {
+                btchip_context_D.transactionHashOption = 0;
+                if (!btchip_context_D.segwitParsedOnce) {
+                    if (TX_USING_OVERWINTER) {
+                        init_overwinter_sighash_param();
+                        cx_blake2b_init2(&btchip_context_D.segwit.hash.hashPrevouts.blake2b, 256, NULL, 0, (uint8_t *)OVERWINTER_PARAM_PREVOUTS, 16);
+                        cx_blake2b_init2(&btchip_context_D.transactionHashFull.blake2b, 256, NULL, 0, (uint8_t *)OVERWINTER_PARAM_SEQUENCE, 16);
                     }
                     else {
-                        cx_sha256_init(&btchip_context_D.transactionHashFull.sha256);
+                        cx_sha256_init(
+                            &btchip_context_D.segwit.hash.hashPrevouts.sha256);
                     }
-                    cx_sha256_init(
-                        &btchip_context_D.transactionHashAuthorization);
-                    if (btchip_context_D.usingSegwit) {
-                        btchip_context_D.transactionHashOption = 0;
-                        if (!btchip_context_D.segwitParsedOnce) {
-                            if (btchip_context_D.usingOverwinter) {
-                                cx_blake2b_init2(&btchip_context_D.segwit.hash.hashPrevouts.blake2b, 256, NULL, 0, (uint8_t *)OVERWINTER_PARAM_PREVOUTS, 16);
-                                cx_blake2b_init2(&btchip_context_D.transactionHashFull.blake2b, 256, NULL, 0, (uint8_t *)OVERWINTER_PARAM_SEQUENCE, 16);
-                            }
-                            else {
-                                cx_sha256_init(
-                                    &btchip_context_D.segwit.hash.hashPrevouts.sha256);
-                            }
-                        } else {
-                            PRINTF("Resume SegWit hash\n");
-                            PRINTF("SEGWIT Version\n%.*H\n",sizeof(btchip_context_D.transactionVersion),btchip_context_D.transactionVersion);
-                            PRINTF("SEGWIT HashedPrevouts\n%.*H\n",sizeof(btchip_context_D.segwit.cache.hashedPrevouts),btchip_context_D.segwit.cache.hashedPrevouts);
-                            PRINTF("SEGWIT HashedSequence\n%.*H\n",sizeof(btchip_context_D.segwit.cache.hashedSequence),btchip_context_D.segwit.cache.hashedSequence);
-                            if (btchip_context_D.usingOverwinter) {
-                                cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.transactionVersion, sizeof(btchip_context_D.transactionVersion), NULL, 0);
-                                cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.nVersionGroupId, sizeof(btchip_context_D.nVersionGroupId), NULL, 0);
-                                cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.segwit.cache.hashedPrevouts, sizeof(btchip_context_D.segwit.cache.hashedPrevouts), NULL, 0);
-                                cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.segwit.cache.hashedSequence, sizeof(btchip_context_D.segwit.cache.hashedSequence), NULL, 0);
-                                cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.segwit.cache.hashedOutputs, sizeof(btchip_context_D.segwit.cache.hashedOutputs), NULL, 0);
-                                cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, OVERWINTER_NO_JOINSPLITS, 32, NULL, 0);
-                                if (btchip_context_D.usingOverwinter == ZCASH_USING_OVERWINTER_SAPLING) {
-                                    cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, OVERWINTER_NO_JOINSPLITS, 32, NULL, 0); // sapling hashShieldedSpends
-                                    cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, OVERWINTER_NO_JOINSPLITS, 32, NULL, 0); // sapling hashShieldedOutputs
-                                }
-                                cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.nLockTime, sizeof(btchip_context_D.nLockTime), NULL, 0);
-                                cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.nExpiryHeight, sizeof(btchip_context_D.nExpiryHeight), NULL, 0);
-                                if (btchip_context_D.usingOverwinter == ZCASH_USING_OVERWINTER_SAPLING) {
-                                    unsigned char valueBalance[8];
-                                    os_memset(valueBalance, 0, sizeof(valueBalance));
-                                    cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, valueBalance, sizeof(valueBalance), NULL, 0); // sapling valueBalance
-                                }
-                                cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.sigHashType, sizeof(btchip_context_D.sigHashType), NULL, 0);
-                            }
-                            else {
-                                PRINTF("--- ADD TO HASH FULL:\n%.*H\n", sizeof(btchip_context_D.transactionVersion), btchip_context_D.transactionVersion);
-                                cx_hash(
-                                    &btchip_context_D.transactionHashFull.sha256.header, 0,
-                                    btchip_context_D.transactionVersion,
-                                    sizeof(btchip_context_D.transactionVersion),
-                                    NULL, 0);
-                                PRINTF("--- ADD TO HASH FULL:\n%.*H\n", sizeof(btchip_context_D.segwit.cache.hashedPrevouts), btchip_context_D.segwit.cache.hashedPrevouts);
-                                cx_hash(
-                                    &btchip_context_D.transactionHashFull.sha256.header, 0,
-                                    btchip_context_D.segwit.cache.hashedPrevouts,
-                                    sizeof(btchip_context_D.segwit.cache
-                                           .hashedPrevouts),
-                                    NULL, 0);
-                                PRINTF("--- ADD TO HASH FULL:\n%.*H\n", sizeof(btchip_context_D.segwit.cache.hashedSequence), btchip_context_D.segwit.cache.hashedSequence);
-                                cx_hash(
-                                    &btchip_context_D.transactionHashFull.sha256.header, 0,
-                                    btchip_context_D.segwit.cache.hashedSequence,
-                                    sizeof(btchip_context_D.segwit.cache
-                                           .hashedSequence),
-                                    NULL, 0);
-                                PRINTF("--- ADD TO HASH AUTH:\n%.*H\n", sizeof(btchip_context_D.segwit.cache), (unsigned char *)&btchip_context_D.segwit.cache);
-                                cx_hash(&btchip_context_D
-                                         .transactionHashAuthorization.header,
-                                    0,
-                                    (unsigned char *)&btchip_context_D
-                                        .segwit.cache,
-                                    sizeof(btchip_context_D.segwit.cache),
-                                    NULL, 0);
-                            }
+                } else {
+                    PRINTF("Resume SegWit hash\n");
+                    PRINTF("SEGWIT Version\n%.*H\n",sizeof(btchip_context_D.transactionVersion),btchip_context_D.transactionVersion);
+                    PRINTF("SEGWIT HashedPrevouts\n%.*H\n",sizeof(btchip_context_D.segwit.cache.hashedPrevouts),btchip_context_D.segwit.cache.hashedPrevouts);
+                    PRINTF("SEGWIT HashedSequence\n%.*H\n",sizeof(btchip_context_D.segwit.cache.hashedSequence),btchip_context_D.segwit.cache.hashedSequence);
+                    if (TX_USING_OVERWINTER) {
+                        cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.transactionVersion, sizeof(btchip_context_D.transactionVersion), NULL, 0);
+                        cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.nVersionGroupId, sizeof(btchip_context_D.nVersionGroupId), NULL, 0);
+                        cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.segwit.cache.hashedPrevouts, sizeof(btchip_context_D.segwit.cache.hashedPrevouts), NULL, 0);
+                        cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.segwit.cache.hashedSequence, sizeof(btchip_context_D.segwit.cache.hashedSequence), NULL, 0);
+                        cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.segwit.cache.hashedOutputs, sizeof(btchip_context_D.segwit.cache.hashedOutputs), NULL, 0);
+                        cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, OVERWINTER_NO_JOINSPLITS, 32, NULL, 0);
+                        if (TX_USING_OVERWINTER == ZCASH_USING_OVERWINTER_SAPLING) {
+                            cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, OVERWINTER_NO_JOINSPLITS, 32, NULL, 0); // sapling hashShieldedSpends
+                            cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, OVERWINTER_NO_JOINSPLITS, 32, NULL, 0); // sapling hashShieldedOutputs
+                        }
+                        cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.nLockTime, sizeof(btchip_context_D.nLockTime), NULL, 0);
+                        cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.nExpiryHeight, sizeof(btchip_context_D.nExpiryHeight), NULL, 0);
+                        if (TX_USING_OVERWINTER == ZCASH_USING_OVERWINTER_SAPLING) {
+                            unsigned char valueBalance[8];
+                            os_memset(valueBalance, 0, sizeof(valueBalance));
+                            cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, valueBalance, sizeof(valueBalance), NULL, 0); // sapling valueBalance
                         }
+                        cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.sigHashType, sizeof(btchip_context_D.sigHashType), NULL, 0);
                     }
-                    // Parse the beginning of the transaction
-                    // Version
-                    check_transaction_available(4);
-                    os_memmove(btchip_context_D.transactionVersion,
-                               btchip_context_D.transactionBufferPointer, 4);
-                    transaction_offset_increase(4);
-
-                    if (btchip_context_D.usingOverwinter ||
-                        TRUSTED_INPUT_OVERWINTER) {
-                        // nVersionGroupId
-                        check_transaction_available(4);
-                        os_memmove(btchip_context_D.nVersionGroupId,
-                               btchip_context_D.transactionBufferPointer, 4);
-                        transaction_offset_increase(4);
+                    else {
+                        PRINTF("--- ADD TO HASH FULL:\n%.*H\n", sizeof(btchip_context_D.transactionVersion), btchip_context_D.transactionVersion);
+                        cx_hash(
+                            &btchip_context_D.transactionHashFull.sha256.header, 0,
+                            btchip_context_D.transactionVersion,
+                            sizeof(btchip_context_D.transactionVersion),
+                            NULL, 0);
+                        PRINTF("--- ADD TO HASH FULL:\n%.*H\n", sizeof(btchip_context_D.segwit.cache.hashedPrevouts), btchip_context_D.segwit.cache.hashedPrevouts);
+                        cx_hash(
+                            &btchip_context_D.transactionHashFull.sha256.header, 0,
+                            btchip_context_D.segwit.cache.hashedPrevouts,
+                            sizeof(btchip_context_D.segwit.cache
+                                   .hashedPrevouts),
+                            NULL, 0);
+                        PRINTF("--- ADD TO HASH FULL:\n%.*H\n", sizeof(btchip_context_D.segwit.cache.hashedSequence), btchip_context_D.segwit.cache.hashedSequence);
+                        cx_hash(
+                            &btchip_context_D.transactionHashFull.sha256.header, 0,
+                            btchip_context_D.segwit.cache.hashedSequence,
+                            sizeof(btchip_context_D.segwit.cache
+                                   .hashedSequence),
+                            NULL, 0);
+                        PRINTF("--- ADD TO HASH AUTH:\n%.*H\n", sizeof(btchip_context_D.segwit.cache), (unsigned char *)&btchip_context_D.segwit.cache);
+                        cx_hash(&btchip_context_D
+                                 .transactionHashAuthorization.header,
+                            0,
+                            (unsigned char *)&btchip_context_D
+                                .segwit.cache,
+                            sizeof(btchip_context_D.segwit.cache),
+                            NULL, 0);
                     }
+                }
+            }
+            // Parse the beginning of the transaction
+            // Version
+            if (!check_transaction_available(4)) {
+                goto fail;
+            }
+            os_memmove(btchip_context_D.transactionVersion,
+                       btchip_context_D.transactionBufferPointer, 4);
+            transaction_offset_increase(4);
 
-                    if (G_coin_config->flags & FLAG_PEERCOIN_SUPPORT) {
-                        if ((G_coin_config->family ==
-                            BTCHIP_FAMILY_PEERCOIN) ||
-                            ((G_coin_config->family == BTCHIP_FAMILY_STEALTH) &&
-                            (btchip_context_D.transactionVersion[0] < 2))) {
-                            // Timestamp
-                            check_transaction_available(4);
-                            transaction_offset_increase(4);
-                        }
-                    }
+            if (TX_USING_OVERWINTER ||
+                TRUSTED_INPUT_OVERWINTER) {
+                // nVersionGroupId
+                if (!check_transaction_available(4)) {
+                    goto fail;
+                }
+                os_memmove(btchip_context_D.nVersionGroupId,
+                       btchip_context_D.transactionBufferPointer, 4);
+                transaction_offset_increase(4);
+            }
 
-                    // Number of inputs
-                    btchip_context_D.transactionContext
-                        .transactionRemainingInputsOutputs =
-                        transaction_get_varint();
-                    PRINTF("Number of inputs : " DEBUG_LONG "\n",btchip_context_D.transactionContext.transactionRemainingInputsOutputs);
-                    if (btchip_context_D.called_from_swap && parseMode == PARSE_MODE_SIGNATURE) {
-                        // remember number of inputs to know when to exit from library
-                        // we will count number of already signed inputs and compare with this value
-                        // As there are a lot of different states in which we can have different number of input
-                        // (when for ex. we sign segregated witness)
-                        if (vars.swap_data.totalNumberOfInputs == 0) {
-                            vars.swap_data.totalNumberOfInputs =
-                                btchip_context_D.transactionContext.transactionRemainingInputsOutputs;
-                        }
-                        // Reseting the flag, because we should check address ones for each input
-                        vars.swap_data.was_address_checked = 0;
+            if (COIN_FLAG_IS_SET(FLAG_PEERCOIN_SUPPORT)) {
+                if ((G_coin_config->family ==
+                    BTCHIP_FAMILY_PEERCOIN) ||
+                    ((G_coin_config->family == BTCHIP_FAMILY_STEALTH) &&
+                    (btchip_context_D.transactionVersion[0] < 2))) {
+                    // Timestamp
+                    if (!check_transaction_available(4)) {
+                        goto fail;
                     }
-                    // Ready to proceed
-                    btchip_context_D.transactionContext.transactionState =
-                        BTCHIP_TRANSACTION_DEFINED_WAIT_INPUT;
+                    transaction_offset_increase(4);
+                }
+            }
 
-                    // no break is intentional
+            // Number of inputs
+            error = transaction_get_varint(
+                &btchip_context_D.transactionContext.transactionRemainingInputsOutputs);
+            if (error != 0) {
+                goto fail_error;
+            }
+            PRINTF("Number of inputs : " DEBUG_LONG "\n",btchip_context_D.transactionContext.transactionRemainingInputsOutputs);
+            if (btchip_context_D.called_from_swap && parseMode == PARSE_MODE_SIGNATURE) {
+                // remember number of inputs to know when to exit from library
+                // we will count number of already signed inputs and compare with this value
+                // As there are a lot of different states in which we can have different number of input
+                // (when for ex. we sign segregated witness)
+                if (vars.swap_data.totalNumberOfInputs == 0) {
+                    vars.swap_data.totalNumberOfInputs =
+                        btchip_context_D.transactionContext.transactionRemainingInputsOutputs;
                 }
+                // Reseting the flag, because we should check address ones for each input
+                vars.swap_data.was_address_checked = 0;
+            }
+            // Ready to proceed
+            btchip_context_D.transactionContext.transactionState =
+                BTCHIP_TRANSACTION_DEFINED_WAIT_INPUT;
 
-                case BTCHIP_TRANSACTION_DEFINED_WAIT_INPUT: {
-                    unsigned char trustedInputFlag = 1;
-                    PRINTF("Process input\n");
-                    if (btchip_context_D.transactionContext
-                            .transactionRemainingInputsOutputs == 0) {
-                        // No more inputs to hash, move forward
-                        btchip_context_D.transactionContext.transactionState =
-                            BTCHIP_TRANSACTION_INPUT_HASHING_DONE;
-                        continue;
+            // no break is intentional
+        }
+
+        case BTCHIP_TRANSACTION_DEFINED_WAIT_INPUT: {
+            unsigned char trustedInputFlag = 1;
+            PRINTF("Process input\n");
+            if (btchip_context_D.transactionContext
+                    .transactionRemainingInputsOutputs == 0) {
+                // No more inputs to hash, move forward
+                btchip_context_D.transactionContext.transactionState =
+                    BTCHIP_TRANSACTION_INPUT_HASHING_DONE;
+                continue;
+            }
+            if (btchip_context_D.transactionDataRemaining < 1) {
+                // No more data to read, ok
+                goto ok;
+            }
+            // Proceed with the next input
+            if (parseMode == PARSE_MODE_TRUSTED_INPUT) {
+                if (!check_transaction_available(36)) { // prevout : 32 hash + 4 index
+                    goto fail;
+                }
+                transaction_offset_increase(36);
+            }
+            if (parseMode == PARSE_MODE_SIGNATURE) {
+                unsigned char trustedInputLength;
+                unsigned char trustedInput[TRUSTED_INPUT_TOTAL_SIZE];
+                unsigned char amount[8];
+                unsigned char *savePointer;
+
+                // Expect the trusted input flag and trusted input length
+                if (!check_transaction_available(2)) {
+                    goto fail;
+                }
+                switch (*btchip_context_D.transactionBufferPointer) {
+                case 0:
+                    if (btchip_context_D.usingSegwit) {
+                        PRINTF("Non trusted input used in segwit mode\n");
+                        goto fail;
                     }
-                    if (btchip_context_D.transactionDataRemaining < 1) {
-                        // No more data to read, ok
-                        goto ok;
+                    trustedInputFlag = 0;
+                    break;
+                case 1:
+                    if (btchip_context_D.usingSegwit) {
+                        // Segwit inputs can be passed as TrustedInput also
+                        PRINTF("Trusted input used in segwit mode\n");
                     }
-                    // Proceed with the next input
-                    if (parseMode == PARSE_MODE_TRUSTED_INPUT) {
-                        check_transaction_available(
-                            36); // prevout : 32 hash + 4 index
-                        transaction_offset_increase(36);
+                    trustedInputFlag = 1;
+                    break;
+                case 2:
+                    if (!btchip_context_D.usingSegwit) {
+                        PRINTF("Segwit input not used in segwit mode\n");
+                        goto fail;
                     }
-                    if (parseMode == PARSE_MODE_SIGNATURE) {
-                        unsigned char trustedInputLength;
-                        unsigned char trustedInput[TRUSTED_INPUT_TOTAL_SIZE];
-                        unsigned char amount[8];
-                        unsigned char *savePointer;
-
-                        // Expect the trusted input flag and trusted input length
-                        check_transaction_available(2);
-                        switch (*btchip_context_D.transactionBufferPointer) {
-                        case 0:
-                            if (btchip_context_D.usingSegwit) {
-                                PRINTF("Non trusted input used in segwit mode\n");
-                                goto fail;
-                            }
-                            trustedInputFlag = 0;
-                            break;
-                        case 1:
-                            if (btchip_context_D.usingSegwit) {
-                                // Segwit inputs can be passed as TrustedInput also
-                                PRINTF("Trusted input used in segwit mode\n");
-                            }
-                            trustedInputFlag = 1;
-                            break;
-                        case 2:
-                            if (!btchip_context_D.usingSegwit) {
-                                PRINTF("Segwit input not used in segwit mode\n");
-                                goto fail;
-                            }
-                            trustedInputFlag = 0;
-                            break;
-                        default:
-                            PRINTF("Invalid trusted input flag\n");
+                    trustedInputFlag = 0;
+                    break;
+                default:
+                    PRINTF("Invalid trusted input flag\n");
+                    goto fail;
+                }
+                /*
+                trustedInputLength =
+                *(btchip_context_D.transactionBufferPointer + 1);
+                if (trustedInputLength > sizeof(trustedInput)) {
+                  PRINTF("Trusted input too long\n");
+                  goto fail;
+                }
+                */
+                // Check TrustedInput (TI) integrity, be it a non-segwit TI or a segwit TI
+                if (trustedInputFlag) {
+                    trustedInputLength = *(
+                        btchip_context_D.transactionBufferPointer + 1);
+                    if ((trustedInputLength > sizeof(trustedInput)) ||
+                        (trustedInputLength < 8)) {
+                        PRINTF("Invalid trusted input size\n");
+                        goto fail;
+                    }
+
+                    if (!check_transaction_available(2 + trustedInputLength)) {
+                        goto fail;
+                    }
+                    // Check TrustedInput Hmac, unless the same TrustedInput was already
+                    // verified in this transaction
+                    if (!trusted_input_cache_contains(
+                            btchip_context_D.transactionBufferPointer + 2,
+                            trustedInputLength)) {
+                        cx_hmac_sha256(
+                            (uint8_t *)N_btchip.bkp.trustedinput_key,
+                            sizeof(N_btchip.bkp.trustedinput_key),
+                            btchip_context_D.transactionBufferPointer + 2,
+                            trustedInputLength - 8, trustedInput, trustedInputLength);
+                            PRINTF("====> Input HMAC:    %.*H\n", 8, btchip_context_D.transactionBufferPointer + 2 + trustedInputLength - 8);
+                            PRINTF("====> Computed HMAC: %.*H\n", 8, trustedInput);
+
+                        if (btchip_secure_memcmp(
+                                trustedInput,       // Contains computed Hmac for now
+                                btchip_context_D.transactionBufferPointer +
+                                    2 + trustedInputLength - 8,
+                                8) != 0) {
+                            PRINTF("Invalid signature\n");
                             goto fail;
                         }
-                        /*
-                        trustedInputLength =
-                        *(btchip_context_D.transactionBufferPointer + 1);
-                        if (trustedInputLength > sizeof(trustedInput)) {
-                          PRINTF("Trusted input too long\n");
-                          goto fail;
-                        }
-                        */
-                        // Check TrustedInput (TI) integrity, be it a non-segwit TI or a segwit TI
-                        if (trustedInputFlag) {
-                            trustedInputLength = *(
-                                btchip_context_D.transactionBufferPointer + 1);
-                            if ((trustedInputLength > sizeof(trustedInput)) ||
-                                (trustedInputLength < 8)) {
-                                PRINTF("Invalid trusted input size\n");
-                                goto fail;
-                            }
-
-                            check_transaction_available(2 + trustedInputLength);
-                            // Check TrustedInput Hmac
-                            cx_hmac_sha256(
-                                (uint8_t *)N_btchip.bkp.trustedinput_key,
-                                sizeof(N_btchip.bkp.trustedinput_key),
-                                btchip_context_D.transactionBufferPointer + 2,
-                                trustedInputLength - 8, trustedInput, trustedInputLength);
-                                PRINTF("====> Input HMAC:    %.*H\n", 8, btchip_context_D.transactionBufferPointer + 2 + trustedInputLength - 8);
-                                PRINTF("====> Computed HMAC: %.*H\n", 8, trustedInput);
-
-                            if (btchip_secure_memcmp(
-                                    trustedInput,       // Contains computed Hmac for now
-                                    btchip_context_D.transactionBufferPointer +
-                                        2 + trustedInputLength - 8,
-                                    8) != 0) {
-                                PRINTF("Invalid signature\n");
-                                goto fail;
-                            }
-                            // Hmac is valid. If TrustedInput contains a segwit input, update data pointer & length
-                            // to fake the parser into believing a normal segwit input was received. Do not use
-                            // transaction_offset_increase() here as it could update the hash being computed.
-                            if (btchip_context_D.usingSegwit) {
-                                // Overwrite the no longer needed HMAC's 1st byte w/ the input script length byte.
-                                *(btchip_context_D.transactionBufferPointer + 1 + TRUSTED_INPUT_SIZE + 1) =
-                                    *(btchip_context_D.transactionBufferPointer + 1 + TRUSTED_INPUT_TOTAL_SIZE + 1);
-                                // Set tx data pointer on TI header's (i.e. 0x38||0x32||0x00||Nonce (2B)) last byte
-                                // before prevout tx hash. Also remove HMAC size from remaining data length.
-                                btchip_context_D.transactionBufferPointer += 5;
-                                btchip_context_D.transactionDataRemaining -= (5+8);
-                            }
+                        trusted_input_cache_add(
+                            btchip_context_D.transactionBufferPointer + 2,
+                            trustedInputLength);
+                    }
+                    // Hmac is valid. If TrustedInput contains a segwit input, update data pointer & length
+                    // to fake the parser into believing a normal segwit input was received. Do not use
+                    // transaction_offset_increase() here as it could update the hash being computed.
+                    if (btchip_context_D.usingSegwit) {
+                        // Overwrite the no longer needed HMAC's 1st byte w/ the input script length byte.
+                        *(btchip_context_D.transactionBufferPointer + 1 + TRUSTED_INPUT_SIZE + 1) =
+                            *(btchip_context_D.transactionBufferPointer + 1 + TRUSTED_INPUT_TOTAL_SIZE + 1);
+                        // Set tx data pointer on TI header's (i.e. 0x38||0x32||0x00||Nonce (2B)) last byte
+                        // before prevout tx hash. Also remove HMAC size from remaining data length.
+                        btchip_context_D.transactionBufferPointer += 5;
+                        btchip_context_D.transactionDataRemaining -= (5+8);
+                    }
+                }
+                // Handle pure segwit inputs, whether trusted or not (i.e. InputHashStart 1st APDU's P2==02
+                // & data[0]=={0x01, 0x02})
+                if (btchip_context_D.usingSegwit) {
+                    transaction_offset_increase(1);     // Set tx pointer on 1st byte of hash
+                    if (!check_transaction_available(36)) { // prevout : 32 hash + 4 index
+                        goto fail;
+                    }
+                    if (!btchip_context_D.segwitParsedOnce) {
+                        if (TX_USING_OVERWINTER) {
+                            cx_hash(&btchip_context_D.segwit.hash.hashPrevouts.blake2b.header, 0, btchip_context_D.transactionBufferPointer, 36, NULL, 0);
                         }
-                        // Handle pure segwit inputs, whether trusted or not (i.e. InputHashStart 1st APDU's P2==02
-                        // & data[0]=={0x01, 0x02})
-                        if (btchip_context_D.usingSegwit) {
-                            transaction_offset_increase(1);     // Set tx pointer on 1st byte of hash
-                            check_transaction_available(
-                                36); // prevout : 32 hash + 4 index
-                            if (!btchip_context_D.segwitParsedOnce) {
-                                if (btchip_context_D.usingOverwinter) {
-                                    cx_hash(&btchip_context_D.segwit.hash.hashPrevouts.blake2b.header, 0, btchip_context_D.transactionBufferPointer, 36, NULL, 0);
-                                }
-                                else {
-                                    cx_hash(
-                                        &btchip_context_D.segwit.hash.hashPrevouts
-                                         .sha256.header,
-                                        0,
-                                        btchip_context_D.transactionBufferPointer,
-                                        36, NULL, 0);
-                                }
-                                transaction_offset_increase(36);
-                                check_transaction_available(8); // update amount
-                                btchip_swap_bytes(
-                                    amount,
-                                    btchip_context_D.transactionBufferPointer,
-                                    8);
-                                if (transaction_amount_add_be(
-                                        btchip_context_D.transactionContext
-                                            .transactionAmount,
-                                        btchip_context_D.transactionContext
-                                            .transactionAmount,
-                                        amount)) {
-                                    PRINTF("Overflow\n");
-                                    goto fail;
-                                }
-                                PRINTF("Adding amount\n%.*H\n",8,btchip_context_D.transactionBufferPointer);
-                                PRINTF("New amount\n%.*H\n",8,btchip_context_D.transactionContext.transactionAmount);
-                                transaction_offset_increase(8);
-                            } else {
-                                btchip_context_D.transactionHashOption =
-                                    TRANSACTION_HASH_FULL;
-                                transaction_offset_increase(36);
-                                btchip_context_D.transactionHashOption = 0;
-                                check_transaction_available(8); // save amount
-                                os_memmove(
-                                    btchip_context_D.inputValue,
-                                    btchip_context_D.transactionBufferPointer,
-                                    8);
-                                transaction_offset_increase(8);
-                                btchip_context_D.transactionHashOption =
-                                    TRANSACTION_HASH_FULL;
-                            }
+                        else {
+                            cx_hash(
+                                &btchip_context_D.segwit.hash.hashPrevouts
+                                 .sha256.header,
+                                0,
+                                btchip_context_D.transactionBufferPointer,
+                                36, NULL, 0);
                         }
-                        // Handle non-segwit inputs (i.e. InputHashStart 1st APDU's P2==00 && data[0]==0x00)
-                        else if (!trustedInputFlag) {
-                            // Only authorized in relaxed wallet and server
-                            // modes
-                            SB_CHECK(N_btchip.bkp.config.operationMode);
-                            switch (SB_GET(N_btchip.bkp.config.operationMode)) {
-                            case BTCHIP_MODE_WALLET:
-                                if (!optionP2SHSkip2FA) {
-                                    PRINTF("Untrusted input not authorized\n");
-                                    goto fail;
-                                }
-                                break;
-                            case BTCHIP_MODE_RELAXED_WALLET:
-                            case BTCHIP_MODE_SERVER:
-                                break;
-                            default:
-                                PRINTF("Untrusted input not authorized\n");
-                                goto fail;
-                            }
-                            btchip_context_D.transactionBufferPointer++;
-                            btchip_context_D.transactionDataRemaining--;
-                            check_transaction_available(
-                                36); // prevout : 32 hash + 4 index
-                            transaction_offset_increase(36);
-                            PRINTF("Marking relaxed input\n");
-                            btchip_context_D.transactionContext.relaxed = 1;
-                            /*
-                            PRINTF("Clearing P2SH consumption\n");
-                            btchip_context_D.transactionContext.consumeP2SH = 0;
-                            */
+                        transaction_offset_increase(36);
+                        if (!check_transaction_available(8)) { // update amount
+                            goto fail;
                         }
-                        // Handle non-segwit TrustedInput (i.e. InputHashStart 1st APDU's P2==00 & data[0]==0x01)
-                        else if (trustedInputFlag && !btchip_context_D.usingSegwit) {
-                            os_memmove(
-                                trustedInput,
-                                btchip_context_D.transactionBufferPointer + 2,
-                                trustedInputLength - 8);
-                            if (trustedInput[0] != MAGIC_TRUSTED_INPUT) {
-                                PRINTF("Failed to verify trusted input signature\n");
-                                goto fail;
-                            }
-                            // Update the hash with prevout data
-                            savePointer =
-                                btchip_context_D.transactionBufferPointer;
-                            /*
-                            // Check if a P2SH script is used
-                            if ((trustedInput[1] & FLAG_TRUSTED_INPUT_P2SH) ==
-                            0) {
-                              PRINTF("Clearing P2SH consumption\n");
-                              btchip_context_D.transactionContext.consumeP2SH =
-                            0;
-                            }
-                            */
-                            btchip_context_D.transactionBufferPointer =
-                                trustedInput + 4;
-                            PRINTF("Trusted input hash\n%.*H\n",36,btchip_context_D.transactionBufferPointer);
-                            transaction_offset(36);
-
-                            btchip_context_D.transactionBufferPointer =
-                                savePointer + (2 + trustedInputLength);
-                            btchip_context_D.transactionDataRemaining -=
-                                (2 + trustedInputLength);
-
-                            // Update the amount
-
-                            btchip_swap_bytes(amount, trustedInput + 40, 8);
-                            if (transaction_amount_add_be(
-                                    btchip_context_D.transactionContext
-                                        .transactionAmount,
-                                    btchip_context_D.transactionContext
-                                        .transactionAmount,
-                                    amount)) {
-                                PRINTF("Overflow\n");
-                                goto fail;
-                            }
-
-                            PRINTF("Adding amount\n%.*H\n",8,(trustedInput + 40));
-                            PRINTF("New amount\n%.*H\n",8,btchip_context_D.transactionContext.transactionAmount);
+                        btchip_swap_bytes(
+                            amount,
+                            btchip_context_D.transactionBufferPointer,
+                            8);
+                        if (transaction_amount_add_be(
+                                btchip_context_D.transactionContext
+                                    .transactionAmount,
+                                btchip_context_D.transactionContext
+                                    .transactionAmount,
+                                amount)) {
+                            PRINTF("Overflow\n");
+                            goto fail;
                         }
-
-                        if (!btchip_context_D.usingSegwit) {
-                            // Do not include the input script length + value in
-                            // the authentication hash
-                            btchip_context_D.transactionHashOption =
-                                TRANSACTION_HASH_FULL;
+                        PRINTF("Adding amount\n%.*H\n",8,btchip_context_D.transactionBufferPointer);
+                        PRINTF("New amount\n%.*H\n",8,btchip_context_D.transactionContext.transactionAmount);
+                        transaction_offset_increase(8);
+                    } else {
+                        btchip_context_D.transactionHashOption =
+                            TRANSACTION_HASH_FULL;
+                        transaction_offset_increase(36);
+                        btchip_context_D.transactionHashOption = 0;
+                        if (!check_transaction_available(8)) { // save amount
+                            goto fail;
                         }
+                        os_memmove(
+                            btchip_context_D.inputValue,
+                            btchip_context_D.transactionBufferPointer,
+                            8);
+                        transaction_offset_increase(8);
+                        btchip_context_D.transactionHashOption =
+                            TRANSACTION_HASH_FULL;
                     }
-                    // Read the script length
-                    btchip_context_D.transactionContext.scriptRemaining =
-                        transaction_get_varint();
-                    PRINTF("Script to read " DEBUG_LONG "\n",btchip_context_D.transactionContext.scriptRemaining);
-
-                    if ((parseMode == PARSE_MODE_SIGNATURE) &&
-                        !trustedInputFlag && !btchip_context_D.usingSegwit) {
-                        // Only proceeds if this is not to be signed - so length
-                        // should be null
-                        if (btchip_context_D.transactionContext
-                                .scriptRemaining != 0) {
-                            PRINTF("Request to sign relaxed input\n");
-                            if (!optionP2SHSkip2FA) {
-                                goto fail;
-                            }
+                }
+                // Handle non-segwit inputs (i.e. InputHashStart 1st APDU's P2==00 && data[0]==0x00)
+                else if (!trustedInputFlag) {
+                    // Only authorized in relaxed wallet and server
+                    // modes
+                    switch (operationMode) {
+                    case BTCHIP_MODE_WALLET:
+                        if (!optionP2SHSkip2FA) {
+                            PRINTF("Untrusted input not authorized\n");
+                            goto fail;
                         }
+                        break;
+                    case BTCHIP_MODE_RELAXED_WALLET:
+                    case BTCHIP_MODE_SERVER:
+                        break;
+                    default:
+                        PRINTF("Untrusted input not authorized\n");
+                        goto fail;
                     }
-                    // Move on
-                    btchip_context_D.transactionContext.transactionState =
-                        BTCHIP_TRANSACTION_INPUT_HASHING_IN_PROGRESS_INPUT_SCRIPT;
-
-                    // no break is intentional
+                    btchip_context_D.transactionBufferPointer++;
+                    btchip_context_D.transactionDataRemaining--;
+                    if (!check_transaction_available(36)) { // prevout : 32 hash + 4 index
+                        goto fail;
+                    }
+                    transaction_offset_increase(36);
+                    PRINTF("Marking relaxed input\n");
+                    btchip_context_D.transactionContext.relaxed = 1;
+                    /*
+                    PRINTF("Clearing P2SH consumption\n");
+                    btchip_context_D.transactionContext.consumeP2SH = 0;
+                    */
                 }
-                case BTCHIP_TRANSACTION_INPUT_HASHING_IN_PROGRESS_INPUT_SCRIPT: {
-                    unsigned char dataAvailable;
-                    PRINTF("Process input script, remaining " DEBUG_LONG "\n",btchip_context_D.transactionContext.scriptRemaining);
-                    if (btchip_context_D.transactionDataRemaining < 1) {
-                        // No more data to read, ok
-                        goto ok;
+                // Handle non-segwit TrustedInput (i.e. InputHashStart 1st APDU's P2==00 & data[0]==0x01)
+                else if (trustedInputFlag && !btchip_context_D.usingSegwit) {
+                    os_memmove(
+                        trustedInput,
+                        btchip_context_D.transactionBufferPointer + 2,
+                        trustedInputLength - 8);
+                    if (trustedInput[0] != MAGIC_TRUSTED_INPUT) {
+                        PRINTF("Failed to verify trusted input signature\n");
+                        goto fail;
                     }
-                    // Scan for P2SH consumption - huge shortcut, but fine
-                    // enough
-                    // Also usable in SegWit mode
-                    if (btchip_context_D.transactionContext.scriptRemaining ==
-                        1) {
-                        if (*btchip_context_D.transactionBufferPointer ==
-                            OP_CHECKMULTISIG) {
-                            if (optionP2SHSkip2FA) {
-                                PRINTF("Marking P2SH consumption\n");
-                                btchip_context_D.transactionContext
-                                    .consumeP2SH = 1;
-                            }
-                        } else {
-                            // When using the P2SH shortcut, all inputs must use
-                            // P2SH
-                            PRINTF("Disabling P2SH consumption\n");
-                            btchip_context_D.transactionContext.consumeP2SH = 0;
-                        }
-                        transaction_offset_increase(1);
-                        btchip_context_D.transactionContext.scriptRemaining--;
+                    // Update the hash with prevout data
+                    savePointer =
+                        btchip_context_D.transactionBufferPointer;
+                    /*
+                    // Check if a P2SH script is used
+                    if ((trustedInput[1] & FLAG_TRUSTED_INPUT_P2SH) ==
+                    0) {
+                      PRINTF("Clearing P2SH consumption\n");
+                      btchip_context_D.transactionContext.consumeP2SH =
+                    0;
                     }
+                    */
+                    btchip_context_D.transactionBufferPointer =
+                        trustedInput + 4;
+                    PRINTF("Trusted input hash\n%.*H\n",36,btchip_context_D.transactionBufferPointer);
+                    transaction_offset(36);
 
-                    if (btchip_context_D.transactionContext.scriptRemaining ==
-                        0) {
-                        if (parseMode == PARSE_MODE_SIGNATURE) {
-                            if (!btchip_context_D.usingSegwit) {
-                                // Restore dual hash for signature +
-                                // authentication
-                                btchip_context_D.transactionHashOption =
-                                    TRANSACTION_HASH_BOTH;
-                            } else {
-                                if (btchip_context_D.segwitParsedOnce) {
-                                    // Append the saved value
-                                    PRINTF("SEGWIT Add value\n%.*H\n",8,btchip_context_D.inputValue);
-                                    if (btchip_context_D.usingOverwinter) {
-                                        cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.inputValue, 8, NULL, 0);
-                                    }
-                                    else {
-                                        PRINTF("--- ADD TO HASH FULL:\n%.*H\n", sizeof(btchip_context_D.inputValue), btchip_context_D.inputValue);
-                                        cx_hash(&btchip_context_D
-                                                 .transactionHashFull.sha256.header,
-                                            0, btchip_context_D.inputValue, 8,
-                                            NULL, 0);
-                                    }
-                                }
-                            }
-                        }
-                        // Sequence
-                        check_transaction_available(4);
-                        if (btchip_context_D.usingSegwit &&
-                            !btchip_context_D.segwitParsedOnce) {
-                            if (btchip_context_D.usingOverwinter) {
-                                cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.transactionBufferPointer, 4, NULL, 0);
-                            }
-                            else {
-                                PRINTF("--- ADD TO HASH FULL:\n%.*H\n", 4, btchip_context_D.transactionBufferPointer);
-                                cx_hash(&btchip_context_D.transactionHashFull
-                                         .sha256.header,
-                                    0,
-                                    btchip_context_D.transactionBufferPointer,
-                                    4, NULL, 0);
-                            }
-                        }
-                        transaction_offset_increase(4);
-                        // Move to next input
-                        btchip_context_D.transactionContext
-                            .transactionRemainingInputsOutputs--;
-                        btchip_context_D.transactionContext
-                            .transactionCurrentInputOutput++;
-                        btchip_context_D.transactionContext.transactionState =
-                            BTCHIP_TRANSACTION_DEFINED_WAIT_INPUT;
-                        continue;
+                    btchip_context_D.transactionBufferPointer =
+                        savePointer + (2 + trustedInputLength);
+                    btchip_context_D.transactionDataRemaining -=
+                        (2 + trustedInputLength);
+
+                    // Update the amount
+
+                    btchip_swap_bytes(amount, trustedInput + 40, 8);
+                    if (transaction_amount_add_be(
+                            btchip_context_D.transactionContext
+                                .transactionAmount,
+                            btchip_context_D.transactionContext
+                                .transactionAmount,
+                            amount)) {
+                        PRINTF("Overflow\n");
+                        goto fail;
                     }
-                    // Save the last script byte for the P2SH check
-                    dataAvailable =
-                        (btchip_context_D.transactionDataRemaining >
-                                 btchip_context_D.transactionContext
-                                         .scriptRemaining -
-                                     1
-                             ? btchip_context_D.transactionContext
-                                       .scriptRemaining -
-                                   1
-                             : btchip_context_D.transactionDataRemaining);
-                    if (dataAvailable == 0) {
-                        goto ok;
+
+                    PRINTF("Adding amount\n%.*H\n",8,(trustedInput + 40));
+                    PRINTF("New amount\n%.*H\n",8,btchip_context_D.transactionContext.transactionAmount);
+                }
+
+                if (!btchip_context_D.usingSegwit) {
+                    // Do not include the input script length + value in
+                    // the authentication hash
+                    btchip_context_D.transactionHashOption =
+                        TRANSACTION_HASH_FULL;
+                }
+            }
+            // Read the script length
+            error = transaction_get_varint(
+                &btchip_context_D.transactionContext.scriptRemaining);
+            if (error != 0) {
+                goto fail_error;
+            }
+            PRINTF("Script to read " DEBUG_LONG "\n",btchip_context_D.transactionContext.scriptRemaining);
+
+            if ((parseMode == PARSE_MODE_SIGNATURE) &&
+                !trustedInputFlag && !btchip_context_D.usingSegwit) {
+                // Only proceeds if this is not to be signed - so length
+                // should be null
+                if (btchip_context_D.transactionContext
+                        .scriptRemaining != 0) {
+                    PRINTF("Request to sign relaxed input\n");
+                    if (!optionP2SHSkip2FA) {
+                        goto fail;
                     }
-                    transaction_offset_increase(dataAvailable);
-                    btchip_context_D.transactionContext.scriptRemaining -=
-                        dataAvailable;
-                    break;
                 }
-                case BTCHIP_TRANSACTION_INPUT_HASHING_DONE: {
-                    PRINTF("Input hashing done\n");
-                    if (parseMode == PARSE_MODE_SIGNATURE) {
-                        // inputs have been prepared, stop the parsing here
-                        if (btchip_context_D.usingSegwit &&
-                            !btchip_context_D.segwitParsedOnce) {
-                            unsigned char hashedPrevouts[32];
-                            unsigned char hashedSequence[32];
-                            // Flush the cache
-                            if (btchip_context_D.usingOverwinter) {
-                                cx_hash(&btchip_context_D.segwit.hash.hashPrevouts.blake2b.header, CX_LAST, hashedPrevouts, 0, hashedPrevouts, 32);
-                                cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, CX_LAST, hashedSequence, 0, hashedSequence, 32);
-                            }
-                            else {
-                                cx_hash(&btchip_context_D.segwit.hash.hashPrevouts
-                                         .sha256.header,
-                                    CX_LAST, hashedPrevouts, 0, hashedPrevouts, 32);
-                                cx_sha256_init(
-                                    &btchip_context_D.segwit.hash.hashPrevouts.sha256);
-                                cx_hash(&btchip_context_D.segwit.hash.hashPrevouts
-                                         .sha256.header,
-                                    CX_LAST, hashedPrevouts,
-                                    sizeof(hashedPrevouts), hashedPrevouts, 32);
-                                cx_hash(&btchip_context_D.transactionHashFull
-                                         .sha256.header,
-                                    CX_LAST, hashedSequence, 0, hashedSequence, 32);
-                                cx_sha256_init(
-                                    &btchip_context_D.transactionHashFull.sha256);
-                                PRINTF("--- ADD TO HASH FULL:\n%.*H\n", sizeof(hashedSequence), hashedSequence);
-                                cx_hash(&btchip_context_D.transactionHashFull
-                                         .sha256.header,
-                                    CX_LAST, hashedSequence,
-                                    sizeof(hashedSequence), hashedSequence, 32);
+            }
+            // Move on
+            btchip_context_D.transactionContext.transactionState =
+                BTCHIP_TRANSACTION_INPUT_HASHING_IN_PROGRESS_INPUT_SCRIPT;
+
+            // no break is intentional
+        }
+        case BTCHIP_TRANSACTION_INPUT_HASHING_IN_PROGRESS_INPUT_SCRIPT: {
+            unsigned char dataAvailable;
+            PRINTF("Process input script, remaining " DEBUG_LONG "\n",btchip_context_D.transactionContext.scriptRemaining);
+            if (btchip_context_D.transactionDataRemaining < 1) {
+                // No more data to read, ok
+                goto ok;
+            }
+            // Scan for P2SH consumption - huge shortcut, but fine
+            // enough
+            // Also usable in SegWit mode
+            if (btchip_context_D.transactionContext.scriptRemaining ==
+                1) {
+                if (*btchip_context_D.transactionBufferPointer ==
+                    OP_CHECKMULTISIG) {
+                    if (optionP2SHSkip2FA) {
+                        PRINTF("Marking P2SH consumption\n");
+                        btchip_context_D.transactionContext
+                            .consumeP2SH = 1;
+                    }
+                } else {
+                    // When using the P2SH shortcut, all inputs must use
+                    // P2SH
+                    PRINTF("Disabling P2SH consumption\n");
+                    btchip_context_D.transactionContext.consumeP2SH = 0;
+                }
+                transaction_offset_increase(1);
+                btchip_context_D.transactionContext.scriptRemaining--;
+            }
 
+            if (btchip_context_D.transactionContext.scriptRemaining ==
+                0) {
+                if (parseMode == PARSE_MODE_SIGNATURE) {
+                    if (!btchip_context_D.usingSegwit) {
+                        // Restore dual hash for signature +
+                        // authentication
+                        btchip_context_D.transactionHashOption =
+                            TRANSACTION_HASH_BOTH;
+                    } else {
+                        if (btchip_context_D.segwitParsedOnce) {
+                            // Append the saved value
+                            PRINTF("SEGWIT Add value\n%.*H\n",8,btchip_context_D.inputValue);
+                            if (TX_USING_OVERWINTER) {
+                                cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.inputValue, 8, NULL, 0);
                             }
-                            os_memmove(
-                                btchip_context_D.segwit.cache.hashedPrevouts,
-                                hashedPrevouts, sizeof(hashedPrevouts));
-                            os_memmove(
-                                btchip_context_D.segwit.cache.hashedSequence,
-                                hashedSequence, sizeof(hashedSequence));
-                            PRINTF("hashPrevout\n%.*H\n",32,btchip_context_D.segwit.cache.hashedPrevouts);
-                            PRINTF("hashSequence\n%.*H\n",32,btchip_context_D.segwit.cache.hashedSequence);
-                        }
-                        if (btchip_context_D.usingSegwit &&
-                            btchip_context_D.segwitParsedOnce) {
-                            if (!btchip_context_D.usingOverwinter) {
-                                PRINTF("SEGWIT hashedOutputs\n%.*H\n",sizeof(btchip_context_D.segwit.cache.hashedOutputs),btchip_context_D.segwit.cache.hashedOutputs);
-                                cx_hash(
-                                    &btchip_context_D.transactionHashFull.sha256.header, 0,
-                                    btchip_context_D.segwit.cache.hashedOutputs,
-                                    sizeof(btchip_context_D.segwit.cache
-                                           .hashedOutputs),
+                            else {
+                                PRINTF("--- ADD TO HASH FULL:\n%.*H\n", sizeof(btchip_context_D.inputValue), btchip_context_D.inputValue);
+                                cx_hash(&btchip_context_D
+                                         .transactionHashFull.sha256.header,
+                                    0, btchip_context_D.inputValue, 8,
                                     NULL, 0);
                             }
-                            btchip_context_D.transactionContext
-                                .transactionState =
-                                BTCHIP_TRANSACTION_SIGN_READY;
-                        } else {
-                            btchip_context_D.transactionContext
-                                .transactionState =
-                                BTCHIP_TRANSACTION_PRESIGN_READY;
-                            if (btchip_context_D.usingOverwinter) {
-                                cx_blake2b_init2(&btchip_context_D.transactionHashFull.blake2b, 256, NULL, 0, (uint8_t *)OVERWINTER_PARAM_OUTPUTS, 16);
-                            }
-                            else
-                            if (btchip_context_D.usingSegwit) {
-                                cx_sha256_init(&btchip_context_D.transactionHashFull.sha256);
-                            }
                         }
-                        continue;
                     }
-                    if (btchip_context_D.transactionDataRemaining < 1) {
-                        // No more data to read, ok
-                        goto ok;
-                    }
-                    // Number of outputs
-                    btchip_context_D.transactionContext
-                        .transactionRemainingInputsOutputs =
-                        transaction_get_varint();
-                    btchip_context_D.transactionContext
-                        .transactionCurrentInputOutput = 0;
-                    PRINTF("Number of outputs : " DEBUG_LONG "\n",
-                        btchip_context_D.transactionContext.transactionRemainingInputsOutputs);
-                    // Ready to proceed
-                    btchip_context_D.transactionContext.transactionState =
-                        BTCHIP_TRANSACTION_DEFINED_WAIT_OUTPUT;
-
-                    // no break is intentional
                 }
-                case BTCHIP_TRANSACTION_DEFINED_WAIT_OUTPUT: {
-                    if (btchip_context_D.transactionContext
-                            .transactionRemainingInputsOutputs == 0) {
-                        // No more outputs to hash, move forward
-                        btchip_context_D.transactionContext.transactionState =
-                            BTCHIP_TRANSACTION_OUTPUT_HASHING_DONE;
-                        continue;
+                // Sequence
+                if (!check_transaction_available(4)) {
+                    goto fail;
+                }
+                if (btchip_context_D.usingSegwit &&
+                    !btchip_context_D.segwitParsedOnce) {
+                    if (TX_USING_OVERWINTER) {
+                        cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, 0, btchip_context_D.transactionBufferPointer, 4, NULL, 0);
                     }
-                    if (btchip_context_D.transactionDataRemaining < 1) {
-                        // No more data to read, ok
-                        goto ok;
+                    else {
+                        PRINTF("--- ADD TO HASH FULL:\n%.*H\n", 4, btchip_context_D.transactionBufferPointer);
+                        cx_hash(&btchip_context_D.transactionHashFull
+                                 .sha256.header,
+                            0,
+                            btchip_context_D.transactionBufferPointer,
+                            4, NULL, 0);
                     }
-                    // Amount
-                    check_transaction_available(8);
-                    if ((parseMode == PARSE_MODE_TRUSTED_INPUT) &&
-                        (btchip_context_D.transactionContext
-                             .transactionCurrentInputOutput ==
-                         btchip_context_D.transactionTargetInput)) {
-                        // Save the amount
-                        os_memmove(btchip_context_D.transactionContext
-                                       .transactionAmount,
-                                   btchip_context_D.transactionBufferPointer,
-                                   8);
-                        btchip_context_D.trustedInputProcessed = 1;
+                }
+                transaction_offset_increase(4);
+                // Move to next input
+                btchip_context_D.transactionContext
+                    .transactionRemainingInputsOutputs--;
+                btchip_context_D.transactionContext
+                    .transactionCurrentInputOutput++;
+                btchip_context_D.transactionContext.transactionState =
+                    BTCHIP_TRANSACTION_DEFINED_WAIT_INPUT;
+                continue;
+            }
+            // Save the last script byte for the P2SH check
+            dataAvailable =
+                (btchip_context_D.transactionDataRemaining >
+                         btchip_context_D.transactionContext
+                                 .scriptRemaining -
+                             1
+                     ? btchip_context_D.transactionContext
+                               .scriptRemaining -
+                           1
+                     : btchip_context_D.transactionDataRemaining);
+            if (dataAvailable == 0) {
+                goto ok;
+            }
+            transaction_offset_increase(dataAvailable);
+            btchip_context_D.transactionContext.scriptRemaining -=
+                dataAvailable;
+            break;
+        }
+        case BTCHIP_TRANSACTION_INPUT_HASHING_DONE: {
+            PRINTF("Input hashing done\n");
+            if (parseMode == PARSE_MODE_SIGNATURE) {
+                // inputs have been prepared, stop the parsing here
+                if (btchip_context_D.usingSegwit &&
+                    !btchip_context_D.segwitParsedOnce) {
+                    unsigned char hashedPrevouts[32];
+                    unsigned char hashedSequence[32];
+                    // Flush the cache
+                    if (TX_USING_OVERWINTER) {
+                        cx_hash(&btchip_context_D.segwit.hash.hashPrevouts.blake2b.header, CX_LAST, hashedPrevouts, 0, hashedPrevouts, 32);
+                        cx_hash(&btchip_context_D.transactionHashFull.blake2b.header, CX_LAST, hashedSequence, 0, hashedSequence, 32);
                     }
-                    transaction_offset_increase(8);
-                    // Read the script length
-                    btchip_context_D.transactionContext.scriptRemaining =
-                        transaction_get_varint();
-
-                    PRINTF("Script to read " DEBUG_LONG "\n",btchip_context_D.transactionContext.scriptRemaining);
-                    // Move on
-                    btchip_context_D.transactionContext.transactionState =
-                        BTCHIP_TRANSACTION_OUTPUT_HASHING_IN_PROGRESS_OUTPUT_SCRIPT;
+                    else {
+                        cx_hash(&btchip_context_D.segwit.hash.hashPrevouts
+                                 .sha256.header,
+                            CX_LAST, hashedPrevouts, 0, hashedPrevouts, 32);
+                        cx_sha256_init(
+                            &btchip_context_D.segwit.hash.hashPrevouts.sha256);
+                        cx_hash(&btchip_context_D.segwit.hash.hashPrevouts
+                                 .sha256.header,
+                            CX_LAST, hashedPrevouts,
+                            sizeof(hashedPrevouts), hashedPrevouts, 32);
+                        cx_hash(&btchip_context_D.transactionHashFull
+                                 .sha256.header,
+                            CX_LAST, hashedSequence, 0, hashedSequence, 32);
+                        cx_sha256_init(
+                            &btchip_context_D.transactionHashFull.sha256);
+                        PRINTF("--- ADD TO HASH FULL:\n%.*H\n", sizeof(hashedSequence), hashedSequence);
+                        cx_hash(&btchip_context_D.transactionHashFull
+                                 .sha256.header,
+                            CX_LAST, hashedSequence,
+                            sizeof(hashedSequence), hashedSequence, 32);
 
-                    // no break is intentional
-                }
-                case BTCHIP_TRANSACTION_OUTPUT_HASHING_IN_PROGRESS_OUTPUT_SCRIPT: {
-                    unsigned char dataAvailable;
-                    PRINTF("Process output script, remaining " DEBUG_LONG "\n",btchip_context_D.transactionContext.scriptRemaining);
-                    /*
-                    // Special check if consuming a P2SH script
-                    if (parseMode == PARSE_MODE_TRUSTED_INPUT) {
-                      // Assume the full input script is sent in a single APDU,
-                    then do the ghetto validation
-                      if ((btchip_context_D.transactionBufferPointer[0] ==
-                    OP_HASH160) &&
-                          (btchip_context_D.transactionBufferPointer[btchip_context_D.transactionDataRemaining
-                    - 1] == OP_EQUAL)) {
-                        PRINTF("Marking P2SH output\n");
-                        btchip_context_D.transactionContext.consumeP2SH = 1;
-                      }
                     }
-                    */
-                    if (btchip_context_D.transactionDataRemaining < 1) {
-                        // No more data to read, ok
-                        goto ok;
+                    os_memmove(
+                        btchip_context_D.segwit.cache.hashedPrevouts,
+                        hashedPrevouts, sizeof(hashedPrevouts));
+                    os_memmove(
+                        btchip_context_D.segwit.cache.hashedSequence,
+                        hashedSequence, sizeof(hashedSequence));
+                    PRINTF("hashPrevout\n%.*H\n",32,btchip_context_D.segwit.cache.hashedPrevouts);
+                    PRINTF("hashSequence\n%.*H\n",32,btchip_context_D.segwit.cache.hashedSequence);
+                }
+                if (btchip_context_D.usingSegwit &&
+                    btchip_context_D.segwitParsedOnce) {
+                    if (!TX_USING_OVERWINTER) {
+                        PRINTF("SEGWIT hashedOutputs\n%.*H\n",sizeof(btchip_context_D.segwit.cache.hashedOutputs),btchip_context_D.segwit.cache.hashedOutputs);
+                        cx_hash(
+                            &btchip_context_D.transactionHashFull.sha256.header, 0,
+                            btchip_context_D.segwit.cache.hashedOutputs,
+                            sizeof(btchip_context_D.segwit.cache
+                                   .hashedOutputs),
+                            NULL, 0);
                     }
-                    if (btchip_context_D.transactionContext.scriptRemaining ==
-                        0) {
-                        // Move to next output
-                        btchip_context_D.transactionContext
-                            .transactionRemainingInputsOutputs--;
-                        btchip_context_D.transactionContext
-                            .transactionCurrentInputOutput++;
-                        btchip_context_D.transactionContext.transactionState =
-                            BTCHIP_TRANSACTION_DEFINED_WAIT_OUTPUT;
-                        continue;
+                    btchip_context_D.transactionContext
+                        .transactionState =
+                        BTCHIP_TRANSACTION_SIGN_READY;
+                } else {
+                    btchip_context_D.transactionContext
+                        .transactionState =
+                        BTCHIP_TRANSACTION_PRESIGN_READY;
+                    if (TX_USING_OVERWINTER) {
+                        cx_blake2b_init2(&btchip_context_D.transactionHashFull.blake2b, 256, NULL, 0, (uint8_t *)OVERWINTER_PARAM_OUTPUTS, 16);
                     }
-                    dataAvailable =
-                        (btchip_context_D.transactionDataRemaining >
-                                 btchip_context_D.transactionContext
-                                     .scriptRemaining
-                             ? btchip_context_D.transactionContext
-                                   .scriptRemaining
-                             : btchip_context_D.transactionDataRemaining);
-                    if (dataAvailable == 0) {
-                        goto ok;
+                    else
+                    if (btchip_context_D.usingSegwit) {
+                        cx_sha256_init(&btchip_context_D.transactionHashFull.sha256);
                     }
-                    transaction_offset_increase(dataAvailable);
-                    btchip_context_D.transactionContext.scriptRemaining -=
-                        dataAvailable;
-                    break;
                 }
-                case BTCHIP_TRANSACTION_OUTPUT_HASHING_DONE: {
-                    PRINTF("Output hashing done\n");
-                    if (btchip_context_D.transactionDataRemaining < 1) {
-                        // No more data to read, ok
-                        goto ok;
-                    }
-                    // Locktime
-                    check_transaction_available(4);
-                    transaction_offset_increase(4);
+                continue;
+            }
+            if (btchip_context_D.transactionDataRemaining < 1) {
+                // No more data to read, ok
+                goto ok;
+            }
+            // Number of outputs
+            error = transaction_get_varint(
+                &btchip_context_D.transactionContext.transactionRemainingInputsOutputs);
+            if (error != 0) {
+                goto fail_error;
+            }
+            btchip_context_D.transactionContext
+                .transactionCurrentInputOutput = 0;
+            PRINTF("Number of outputs : " DEBUG_LONG "\n",
+                btchip_context_D.transactionContext.transactionRemainingInputsOutputs);
+            // Ready to proceed
+            btchip_context_D.transactionContext.transactionState =
+                BTCHIP_TRANSACTION_DEFINED_WAIT_OUTPUT;
 
-                    if (btchip_context_D.transactionDataRemaining == 0) {
-                        btchip_context_D.transactionContext.transactionState =
-                            BTCHIP_TRANSACTION_PARSED;
-                        continue;
-                    } else {
-                        btchip_context_D.transactionHashOption = 0;
-                        btchip_context_D.transactionContext.scriptRemaining =
-                            transaction_get_varint();
-                        btchip_context_D.transactionHashOption =
-                            TRANSACTION_HASH_FULL;
-                        btchip_context_D.transactionContext.transactionState =
-                            BTCHIP_TRANSACTION_PROCESS_EXTRA;
-                        continue;
+            // no break is intentional
+        }
+        case BTCHIP_TRANSACTION_DEFINED_WAIT_OUTPUT: {
+            if (btchip_context_D.transactionContext
+                    .transactionRemainingInputsOutputs == 0) {
+                // No more outputs to hash, move forward
+                btchip_context_D.transactionContext.transactionState =
+                    BTCHIP_TRANSACTION_OUTPUT_HASHING_DONE;
+                continue;
+            }
+            if (btchip_context_D.transactionDataRemaining < 1) {
+                // No more data to read, ok
+                goto ok;
+            }
+            if (parseMode == PARSE_MODE_TRUSTED_INPUT) {
+                // Only the amounts of the targets are needed: hash the other outputs
+                // that are entirely in this chunk at once
+                unsigned long int count;
+                unsigned char size = transaction_skippable_outputs_size(&count);
+                if (count != 0) {
+                    transaction_offset_increase(size);
+                    btchip_context_D.transactionContext
+                        .transactionRemainingInputsOutputs -= count;
+                    btchip_context_D.transactionContext
+                        .transactionCurrentInputOutput += count;
+                    continue;
+                }
+            }
+            // Amount
+            if (!check_transaction_available(8)) {
+                goto fail;
+            }
+            if (parseMode == PARSE_MODE_TRUSTED_INPUT) {
+                unsigned char i;
+                for (i = 0; i < btchip_context_D.transactionTargetInputCount;
+                     i++) {
+                    if (btchip_context_D.transactionContext
+                            .transactionCurrentInputOutput ==
+                        btchip_context_D.transactionTargetInput[i]) {
+                        // Save the amount
+                        os_memmove(
+                            btchip_context_D.transactionTargetAmount[i],
+                            btchip_context_D.transactionBufferPointer, 8);
+                        btchip_context_D.trustedInputProcessed |= (1 << i);
                     }
                 }
+            }
+            transaction_offset_increase(8);
+            // Read the script length
+            error = transaction_get_varint(
+                &btchip_context_D.transactionContext.scriptRemaining);
+            if (error != 0) {
+                goto fail_error;
+            }
 
-                case BTCHIP_TRANSACTION_PROCESS_EXTRA: {
-                    unsigned char dataAvailable;
-
-                    if (btchip_context_D.transactionContext.scriptRemaining ==
-                        0) {
-                        btchip_context_D.transactionContext.transactionState =
-                            BTCHIP_TRANSACTION_PARSED;
-                        continue;
-                    }
+            PRINTF("Script to read " DEBUG_LONG "\n",btchip_context_D.transactionContext.scriptRemaining);
+            // Move on
+            btchip_context_D.transactionContext.transactionState =
+                BTCHIP_TRANSACTION_OUTPUT_HASHING_IN_PROGRESS_OUTPUT_SCRIPT;
 
-                    if (btchip_context_D.transactionDataRemaining < 1) {
-                        // No more data to read, ok
-                        goto ok;
-                    }
+            // no break is intentional
+        }
+        case BTCHIP_TRANSACTION_OUTPUT_HASHING_IN_PROGRESS_OUTPUT_SCRIPT: {
+            unsigned char dataAvailable;
+            PRINTF("Process output script, remaining " DEBUG_LONG "\n",btchip_context_D.transactionContext.scriptRemaining);
+            /*
+            // Special check if consuming a P2SH script
+            if (parseMode == PARSE_MODE_TRUSTED_INPUT) {
+              // Assume the full input script is sent in a single APDU,
+            then do the ghetto validation
+              if ((btchip_context_D.transactionBufferPointer[0] ==
+            OP_HASH160) &&
+                  (btchip_context_D.transactionBufferPointer[btchip_context_D.transactionDataRemaining
+            - 1] == OP_EQUAL)) {
+                PRINTF("Marking P2SH output\n");
+                btchip_context_D.transactionContext.consumeP2SH = 1;
+              }
+            }
+            */
+            if (btchip_context_D.transactionDataRemaining < 1) {
+                // No more data to read, ok
+                goto ok;
+            }
+            if (btchip_context_D.transactionContext.scriptRemaining ==
+                0) {
+                // Move to next output
+                btchip_context_D.transactionContext
+                    .transactionRemainingInputsOutputs--;
+                btchip_context_D.transactionContext
+                    .transactionCurrentInputOutput++;
+                btchip_context_D.transactionContext.transactionState =
+                    BTCHIP_TRANSACTION_DEFINED_WAIT_OUTPUT;
+                continue;
+            }
+            dataAvailable =
+                (btchip_context_D.transactionDataRemaining >
+                         btchip_context_D.transactionContext
+                             .scriptRemaining
+                     ? btchip_context_D.transactionContext
+                           .scriptRemaining
+                     : btchip_context_D.transactionDataRemaining);
+            if (dataAvailable == 0) {
+                goto ok;
+            }
+            transaction_offset_increase(dataAvailable);
+            btchip_context_D.transactionContext.scriptRemaining -=
+                dataAvailable;
+            break;
+        }
+        case BTCHIP_TRANSACTION_OUTPUT_HASHING_DONE: {
+            PRINTF("Output hashing done\n");
+            if (btchip_context_D.transactionDataRemaining < 1) {
+                // No more data to read, ok
+                goto ok;
+            }
+            // Locktime
+            if (!check_transaction_available(4)) {
+                goto fail;
+            }
+            transaction_offset_increase(4);
 
-                    dataAvailable =
-                        (btchip_context_D.transactionDataRemaining >
-                                 btchip_context_D.transactionContext
-                                     .scriptRemaining
-                             ? btchip_context_D.transactionContext
-                                   .scriptRemaining
-                             : btchip_context_D.transactionDataRemaining);
-                    if (dataAvailable == 0) {
-                        goto ok;
-                    }
-                    transaction_offset_increase(dataAvailable);
-                    btchip_context_D.transactionContext.scriptRemaining -=
-                        dataAvailable;
-                    break;
+            if (btchip_context_D.transactionDataRemaining == 0) {
+                btchip_context_D.transactionContext.transactionState =
+                    BTCHIP_TRANSACTION_PARSED;
+                continue;
+            } else {
+                btchip_context_D.transactionHashOption = 0;
+                error = transaction_get_varint(
+                    &btchip_context_D.transactionContext.scriptRemaining);
+                if (error != 0) {
+                    goto fail_error;
                 }
+                btchip_context_D.transactionHashOption =
+                    TRANSACTION_HASH_FULL;
+                btchip_context_D.transactionContext.transactionState =
+                    BTCHIP_TRANSACTION_PROCESS_EXTRA;
+                continue;
+            }
+        }
 
-                case BTCHIP_TRANSACTION_PARSED: {
-                    PRINTF("Transaction parsed\n");
-                    goto ok;
-                }
+        case BTCHIP_TRANSACTION_PROCESS_EXTRA: {
+            unsigned char dataAvailable;
 
-                case BTCHIP_TRANSACTION_PRESIGN_READY: {
-                    PRINTF("Presign ready\n");
-                    goto ok;
-                }
+            if (btchip_context_D.transactionContext.scriptRemaining ==
+                0) {
+                btchip_context_D.transactionContext.transactionState =
+                    BTCHIP_TRANSACTION_PARSED;
+                continue;
+            }
 
-                case BTCHIP_TRANSACTION_SIGN_READY: {
-                    PRINTF("Sign ready\n");
-                    goto ok;
-                }
-                }
+            if (btchip_context_D.transactionDataRemaining < 1) {
+                // No more data to read, ok
+                goto ok;
             }
 
-        fail:
-            PRINTF("Transaction parse - fail\n");
-            THROW(EXCEPTION);
-        ok : {}
+            dataAvailable =
+                (btchip_context_D.transactionDataRemaining >
+                         btchip_context_D.transactionContext
+                             .scriptRemaining
+                     ? btchip_context_D.transactionContext
+                           .scriptRemaining
+                     : btchip_context_D.transactionDataRemaining);
+            if (dataAvailable == 0) {
+                goto ok;
+            }
+            transaction_offset_increase(dataAvailable);
+            btchip_context_D.transactionContext.scriptRemaining -=
+                dataAvailable;
+            break;
         }
-        CATCH_OTHER(e) {
-            PRINTF("Transaction parse - surprise fail\n");
-            btchip_context_D.transactionContext.transactionState =
-                BTCHIP_TRANSACTION_NONE;
-            btchip_set_check_internal_structure_integrity(1);
-            THROW(e);
+
+        case BTCHIP_TRANSACTION_PARSED: {
+            PRINTF("Transaction parsed\n");
+            goto ok;
+        }
+
+        case BTCHIP_TRANSACTION_PRESIGN_READY: {
+            PRINTF("Presign ready\n");
+            goto ok;
+        }
+
+        case BTCHIP_TRANSACTION_SIGN_READY: {
+            PRINTF("Sign ready\n");
+            goto ok;
         }
-        // before the finally to restore the surrounding context if an exception
-        // is raised during finally
-        FINALLY {
-            btchip_set_check_internal_structure_integrity(1);
         }
     }
-    END_TRY;
+
+fail:
+    error = EXCEPTION;
+fail_error:
+    // a single exception for the whole chunk, raised to the APDU dispatcher
+    PRINTF("Transaction parse - fail\n");
+    btchip_context_D.transactionContext.transactionState =
+        BTCHIP_TRANSACTION_NONE;
+    btchip_set_check_internal_structure_integrity(1);
+    THROW(error);
+ok:
+    btchip_set_check_internal_structure_integrity(1);
 }
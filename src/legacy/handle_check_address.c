@@ -1,6 +1,7 @@
 #include "handle_check_address.h"
 #include "os.h"
 #include "btchip_helpers.h"
+#include "btchip_base58.h"
 #include "bip32_path.h"
 #include "btchip_ecc.h"
 #include "btchip_apdu_get_wallet_public_key.h"
@@ -102,8 +103,85 @@ static int os_strcmp(const char* s1, const char* s2) {
     return memcmp(s1, s2, size);
 }
 
+// Cheap checks that reject an address that can not be of the given format (or that can not fit
+// in a buffer of max_address_length), before the costly derivation of the key
+static bool may_be_address_of_format(
+    unsigned char format,
+    const char* address,
+    const char* native_segwit_prefix,
+    size_t max_address_length
+) {
+    size_t address_length = strlen(address);
+    if (address_length == 0 || address_length >= max_address_length)
+        return false;
+    if (format == P2_NATIVE_SEGWIT) {
+        // the human-readable part, followed by the separator '1'
+        if (!native_segwit_prefix)
+            return false;
+        size_t prefix_length = strlen(native_segwit_prefix);
+        return address_length > prefix_length &&
+               memcmp(address, native_segwit_prefix, prefix_length) == 0 &&
+               address[prefix_length] == '1';
+    }
+    return true;
+}
+
+// Decodes a base58check address with the given version, and copies the hash160 that it pays to in
+// hash; returns false if the address is not valid, or has another version
+static bool decode_base58_address(const char* address, unsigned short version, uint8_t hash[static 20]) {
+    size_t version_size = (version > 255 ? 2 : 1);
+    uint8_t decoded[2 + 20 + 4 + 1];  // one more byte, to reject longer payloads
+    size_t decoded_length = sizeof(decoded);
+    if (btchip_decode_base58(address, strlen(address), decoded, &decoded_length) < 0 ||
+        decoded_length != version_size + 20 + 4)
+        return false;
+
+    if ((version_size == 2 && (decoded[0] != (version >> 8) || decoded[1] != (version & 0xFF))) ||
+        (version_size == 1 && decoded[0] != version))
+        return false;
+
+    uint8_t checksum[32];
+    cx_hash_sha256(decoded, version_size + 20, checksum, 32);
+    cx_hash_sha256(checksum, 32, checksum, 32);
+    if (memcmp(decoded + version_size + 20, checksum, 4) != 0)
+        return false;
+
+    memcpy(hash, decoded + version_size, 20);
+    return true;
+}
+
+// Decodes the address to check into the hash160 that it pays to: of the public key for P2_LEGACY
+// and P2_NATIVE_SEGWIT, or of the P2WPKH script for P2_SEGWIT. Returns false if the address can not
+// be of the given format. The address is decoded once, before the costly derivation of the key;
+// the address of the key is then never encoded, as the hashes are compared instead.
+static bool decode_address_to_check(
+    unsigned char format,
+    const char* address,
+    const btchip_altcoin_config_t* coin_config,
+    uint8_t hash[static 20]
+) {
+    if (format == P2_NATIVE_SEGWIT) {
+        int version;
+        uint8_t program[40];
+        size_t program_length;
+        if (!coin_config->native_segwit_prefix ||
+            !segwit_addr_decode(&version, program, &program_length,
+                                coin_config->native_segwit_prefix, address) ||
+            version != 0 || program_length != 20)
+            return false;
+        memcpy(hash, program, 20);
+        return true;
+    } else if (format == P2_SEGWIT) {
+        return decode_base58_address(address, coin_config->p2sh_version, hash);
+    } else {
+        return decode_base58_address(address, coin_config->p2pkh_version, hash);
+    }
+}
+
 int handle_check_address(check_address_parameters_t* params, btchip_altcoin_config_t* coin_config) {
     unsigned char compressed_public_key[33];
+    char address[51];
+    uint8_t expected_hash[20];
     PRINTF("Params on the address %d\n",(unsigned int)params);
     PRINTF("Address to check %s\n",params->address_to_check);
     PRINTF("Inside handle_check_address\n");
@@ -111,6 +189,24 @@ int handle_check_address(check_address_parameters_t* params, btchip_altcoin_conf
         PRINTF("Address to check == 0\n");
         return 0;
     }
+    if (params->address_parameters_length == 0) {
+        PRINTF("No address format\n");
+        return 0;
+    }
+    unsigned char format = params->address_parameters[0];
+    // cashaddr addresses are not decoded: the address of the key is encoded, and compared
+    bool is_decoded = format != P2_CASHADDR;
+    if (is_decoded ? !decode_address_to_check(format,
+                                              params->address_to_check,
+                                              coin_config,
+                                              expected_hash)
+                   : !may_be_address_of_format(format,
+                                               params->address_to_check,
+                                               coin_config->native_segwit_prefix,
+                                               sizeof(address))) {
+        PRINTF("Address can't match the requested format\n");
+        return 0;
+    }
     if (!derive_compressed_public_key(
         params->address_parameters + 1,
         params->address_parameters_length - 1,
@@ -119,9 +215,27 @@ int handle_check_address(check_address_parameters_t* params, btchip_altcoin_conf
         return 0;
     }
 
-    char address[51];
+    if (is_decoded) {
+        uint8_t hash[20];
+        btchip_public_key_hash160(compressed_public_key, 33, hash);
+        if (format == P2_SEGWIT) {
+            // the P2SH address pays to the hash160 of the P2WPKH script
+            uint8_t script[22];
+            script[0] = 0x00;
+            script[1] = 0x14;
+            memcpy(script + 2, hash, 20);
+            btchip_public_key_hash160(script, sizeof(script), hash);
+        }
+        if (memcmp(hash, expected_hash, 20) != 0) {
+            PRINTF("Addresses don't match\n");
+            return 0;
+        }
+        PRINTF("Addresses match\n");
+        return 1;
+    }
+
     if (!get_address_from_compressed_public_key(
-        params->address_parameters[0],
+        format,
         compressed_public_key,
         coin_config->p2pkh_version,
         coin_config->p2sh_version,
@@ -137,4 +251,4 @@ int handle_check_address(check_address_parameters_t* params, btchip_altcoin_conf
     }
     PRINTF("Addresses match\n");
     return 1;
-}
\ No newline at end of file
+}
@@ -23,13 +23,22 @@
 #include "cx.h"
 #include "btchip_secure_value.h"
 #include "btchip_filesystem_tx.h"
+#include "../../target_config.h"
 
 #define MAX_OUTPUT_TO_CHECK 100
 #define MAX_COIN_ID 13
 #define MAX_SHORT_COIN_ID 5
 
 #define MAGIC_TRUSTED_INPUT 0x32
+#define TRUSTED_INPUT_SIZE   48
+#define TRUSTED_INPUT_TOTAL_SIZE (TRUSTED_INPUT_SIZE + 8)
+/** Maximum number of Trusted Inputs returned for the same transaction by a GET_TRUSTED_INPUT batch */
+#define TRUSTED_INPUT_BATCH_MAX 4
 #define MAGIC_DEV_KEY 0x01
+/**
+ * Number of Trusted Inputs whose HMAC is remembered for the current transaction; none on NanoS.
+ */
+#define TRUSTED_INPUT_CACHE_SIZE TARGET_TRUSTED_INPUT_CACHE_SIZE
 
 #define ZCASH_USING_OVERWINTER 0x01
 #define ZCASH_USING_OVERWINTER_SAPLING 0x02
@@ -138,7 +147,8 @@ struct btchip_transaction_context_s {
 typedef struct btchip_transaction_context_s btchip_transaction_context_t;
 
 struct btchip_tmp_output_s {
-    /** Change address if initialized */
+    /** Change address if initialized: hash160 of the change public key,
+     * derived once per transaction */
     unsigned char changeAddress[20];
     /** Flag set if the change address was initialized */
     unsigned char changeInitialized;
@@ -192,10 +202,14 @@ struct btchip_context_s {
     unsigned char transactionDataRemaining;
     /** Current pointer to the transaction buffer for the transaction parser */
     unsigned char *transactionBufferPointer;
-    /** Trusted Input index processed */
+    /** Bitmask of the Trusted Input targets processed */
     unsigned char trustedInputProcessed;
-    /** Transaction input to catch for a Trusted Input lookup */
-    unsigned long int transactionTargetInput;
+    /** Transaction outputs to catch for a Trusted Input lookup */
+    unsigned long int transactionTargetInput[TRUSTED_INPUT_BATCH_MAX];
+    /** Amounts of the transaction outputs to catch for a Trusted Input lookup */
+    unsigned char transactionTargetAmount[TRUSTED_INPUT_BATCH_MAX][8];
+    /** Number of transaction outputs to catch for a Trusted Input lookup */
+    unsigned char transactionTargetInputCount;
 
     /** Length of the incoming command */
     unsigned short inLength;
@@ -214,6 +228,16 @@ struct btchip_context_s {
     // was previously in NVRAM
     btchip_transaction_summary_t transactionSummary;
 
+    /** Private key of the last HASH_SIGN, reused if the next one signs with the same path */
+    unsigned char signingKeyPath[MAX_BIP32_PATH_LENGTH];
+    unsigned char signingKey[32];
+    unsigned char signingKeyValid;
+
+#if TRUSTED_INPUT_CACHE_SIZE > 0
+    /** Trusted Inputs (with their HMAC) already verified since the start of the transaction */
+    unsigned char verifiedTrustedInputs[TRUSTED_INPUT_CACHE_SIZE][TRUSTED_INPUT_TOTAL_SIZE];
+    unsigned char verifiedTrustedInputsCount;
+#endif
 
     unsigned short hashedMessageLength;
 
@@ -237,6 +261,8 @@ struct btchip_context_s {
     unsigned char nExpiryHeight[4];
     unsigned char nLockTime[4];
     unsigned char sigHashType[4];
+    /** BLAKE2b personalization of the signature hash, computed once per transaction */
+    unsigned char overwinterSigHashParam[16];
 
     /*Is swap mode*/
     unsigned char called_from_swap;
@@ -313,4 +339,17 @@ typedef struct btchip_altcoin_config_s {
 
 void btchip_context_init(void);
 
+/**
+ * Wipes the private key kept for the next HASH_SIGN; called when a new transaction starts, when
+ * the device is locked, when the app leaves the legacy mode and when it exits.
+ */
+void btchip_signing_key_cache_reset(void);
+
+/**
+ * Forgets the Trusted Inputs verified so far; called when a new transaction starts, as the client
+ * streams all the inputs again for each signature of a non-segwit transaction (P2=0x80), and each
+ * Trusted Input seen before is only compared with the verified one instead of checking its HMAC.
+ */
+void btchip_trusted_input_cache_reset(void);
+
 #endif
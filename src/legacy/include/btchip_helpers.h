@@ -30,6 +30,16 @@
 
 #define OUTPUT_SCRIPT_NATIVE_WITNESS_PROGRAM_OFFSET 3
 
+/**
+ * Flags returned by btchip_output_script_get_type; native witness scripts are also regular.
+ */
+#define OUTPUT_SCRIPT_TYPE_REGULAR 0x01
+#define OUTPUT_SCRIPT_TYPE_P2SH 0x02
+#define OUTPUT_SCRIPT_TYPE_NATIVE_WITNESS 0x04
+#define OUTPUT_SCRIPT_TYPE_OP_RETURN 0x08
+#define OUTPUT_SCRIPT_TYPE_OP_CREATE 0x10
+#define OUTPUT_SCRIPT_TYPE_OP_CALL 0x20
+
 unsigned char btchip_output_script_is_regular(unsigned char *buffer);
 unsigned char btchip_output_script_is_p2sh(unsigned char *buffer);
 unsigned char btchip_output_script_is_op_return(unsigned char *buffer);
@@ -40,6 +50,12 @@ unsigned char btchip_output_script_is_op_create(unsigned char *buffer,
 unsigned char btchip_output_script_is_op_call(unsigned char *buffer,
                                                 size_t size);
 
+/**
+ * Classifies an output script (starting with its length) in a single pass, returning the
+ * OUTPUT_SCRIPT_TYPE_* flags of all the btchip_output_script_is_* functions that would match it.
+ */
+unsigned char btchip_output_script_get_type(unsigned char *buffer, size_t size);
+
 void btchip_sleep16(unsigned short delay);
 void btchip_sleep32(unsigned long int delayEach, unsigned long int delayRepeat);
 
@@ -41,6 +41,19 @@ void ssCheck(secu16 source);
 
 #define SS_CHECK(x) ssCheck(x);
 
+// Inlined versions of SB_CHECK and SS_CHECK, without the call, for the parsing loops
+#define SB_CHECK_FAST(x)                                                       \
+    do {                                                                       \
+        if ((((x) >> 8) & 0xff) != (unsigned char)(~((x) & 0xff)))             \
+            reset();                                                           \
+    } while (0)
+
+#define SS_CHECK_FAST(x)                                                       \
+    do {                                                                       \
+        if ((((x) >> 16) & 0xffff) != (unsigned short)(~((x) & 0xffff)))       \
+            reset();                                                           \
+    } while (0)
+
 #define SSEC_DEF(x) unsigned char x = 0;
 #define SSEC_INC(x) x++;
 #define SSEC_CHECK(x, value)                                                   \
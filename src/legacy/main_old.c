@@ -825,7 +825,7 @@ uint8_t prepare_fees() {
         borrow = transaction_amount_sub_be(
                 fees, btchip_context_D.transactionContext.transactionAmount,
                 btchip_context_D.totalOutputAmount);
-        if (borrow && G_coin_config->kind == COIN_KIND_KOMODO) {
+        if (borrow && COIN_KIND_IS(COIN_KIND_KOMODO)) {
             os_memmove(vars.tmp.feesAmount, "REWARD", 6);
             vars.tmp.feesAmount[6] = '\0';
         }
@@ -855,21 +855,22 @@ error:
 #define USDT_ASSETID 31
 
 void get_address_from_output_script(unsigned char* script, int script_size, char* out, int out_size) {
-    if (btchip_output_script_is_op_return(script)) {
+    unsigned char scriptType = btchip_output_script_get_type(script, script_size);
+    if (scriptType & OUTPUT_SCRIPT_TYPE_OP_RETURN) {
         strcpy(out, "OP_RETURN");
         return;
     }
-    if ((G_coin_config->kind == COIN_KIND_QTUM || G_coin_config->kind == COIN_KIND_HYDRA) &&
-        btchip_output_script_is_op_create(script, script_size)) {
+    if ((COIN_KIND_IS(COIN_KIND_QTUM) || COIN_KIND_IS(COIN_KIND_HYDRA)) &&
+        (scriptType & OUTPUT_SCRIPT_TYPE_OP_CREATE)) {
         strcpy(out, "OP_CREATE");
         return;
     }
-    if ((G_coin_config->kind == COIN_KIND_QTUM || G_coin_config->kind == COIN_KIND_HYDRA) &&
-        btchip_output_script_is_op_call(script, script_size)) {
+    if ((COIN_KIND_IS(COIN_KIND_QTUM) || COIN_KIND_IS(COIN_KIND_HYDRA)) &&
+        (scriptType & OUTPUT_SCRIPT_TYPE_OP_CALL)) {
         strcpy(out, "OP_CALL");
         return;
     }
-    if (btchip_output_script_is_native_witness(script)) {
+    if (scriptType & OUTPUT_SCRIPT_TYPE_NATIVE_WITNESS) {
         if (G_coin_config->native_segwit_prefix) {
             segwit_addr_encode(
                 out, (char *)PIC(G_coin_config->native_segwit_prefix), 0,
@@ -884,7 +885,7 @@ void get_address_from_output_script(unsigned char* script, int script_size, char
     int addressOffset = 3;
     unsigned short version = G_coin_config->p2sh_version;
 
-    if (btchip_output_script_is_regular(script)) {
+    if (scriptType & OUTPUT_SCRIPT_TYPE_REGULAR) {
         addressOffset = 4;
         version = G_coin_config->p2pkh_version;
     }
@@ -1185,6 +1186,10 @@ void library_main(struct libargs_s *args) {
         args->coin_config = &coin_config;
     }
     bool end = false;
+#ifdef HAVE_BITCOIN_ONLY
+    // the altcoin branches are compiled out: the calls for another coin are not handled
+    end = args->coin_config->kind != COIN_KIND;
+#endif
     /* This loop ensures that library_main_helper and os_lib_end are called
      * within a try context, even if an exception is thrown */
     while (1) {
@@ -28,8 +28,19 @@
 #include "sw.h"
 #include "ui/menu.h"
 #include "boilerplate/apdu_parser.h"
+#include "boilerplate/app_stats.h"
 #include "boilerplate/constants.h"
+#include "boilerplate/debug_trace.h"
 #include "boilerplate/dispatcher.h"
+#include "common/key_info_cache.h"
+#include "common/wallet_cache.h"
+#include "common/account_xpub_cache.h"
+#include "common/private_node_cache.h"
+#include "common/spending_policy.h"
+#include "common/tweaked_key_cache.h"
+#include "common/symmetric_key_cache.h"
+#include "common/xpub_cache.h"
+#include "cxram_stash.h"
 
 #include "commands.h"
 
@@ -73,12 +84,14 @@ const command_descriptor_t COMMAND_DESCRIPTORS[] = {
     {
         .cla = CLA_APP,
         .ins = GET_EXTENDED_PUBKEY,
-        .handler = (command_handler_t)handler_get_extended_pubkey
+        .handler = (command_handler_t)handler_get_extended_pubkey,
+        .batchable = true
     },
     {
         .cla = CLA_APP,
         .ins = GET_WALLET_ADDRESS,
-        .handler = (command_handler_t)handler_get_wallet_address
+        .handler = (command_handler_t)handler_get_wallet_address,
+        .batchable = true
     },
     {
         .cla = CLA_APP,
@@ -93,8 +106,62 @@ const command_descriptor_t COMMAND_DESCRIPTORS[] = {
     {
         .cla = CLA_APP,
         .ins = GET_MASTER_FINGERPRINT,
-        .handler = (command_handler_t)handler_get_master_fingerprint
+        .handler = (command_handler_t)handler_get_master_fingerprint,
+        .batchable = true
     },
+    {
+        .cla = CLA_APP,
+        .ins = GET_WALLET_ADDRESSES,
+        .handler = (command_handler_t)handler_get_wallet_addresses
+    },
+    {
+        .cla = CLA_APP,
+        .ins = GET_ACCOUNT_XPUBS,
+        .handler = (command_handler_t)handler_get_account_xpubs
+    },
+    {
+        .cla = CLA_APP,
+        .ins = GET_EXTENDED_PUBKEYS,
+        .handler = (command_handler_t)handler_get_extended_pubkeys
+    },
+    {
+        .cla = CLA_APP,
+        .ins = REGISTER_WALLETS,
+        .handler = (command_handler_t)handler_register_wallets
+    },
+    {
+        .cla = CLA_APP,
+        .ins = SIGN_MESSAGE,
+        .handler = (command_handler_t)handler_sign_message
+    },
+#ifdef HAVE_UNATTENDED_SIGNING
+    {
+        .cla = CLA_APP,
+        .ins = REGISTER_SPENDING_POLICY,
+        .handler = (command_handler_t)handler_register_spending_policy
+    },
+#endif
+#ifdef HAVE_APP_STATS
+    {
+        .cla = CLA_APP,
+        .ins = GET_APP_STATS,
+        .handler = (command_handler_t)handler_get_app_stats
+    },
+#endif
+#ifdef HAVE_PROCESSOR_TRACE
+    {
+        .cla = CLA_APP,
+        .ins = GET_PROCESSOR_TRACE,
+        .handler = (command_handler_t)handler_get_processor_trace
+    },
+#endif
+#ifdef HAVE_DEBUG_TRACE
+    {
+        .cla = CLA_APP,
+        .ins = GET_DEBUG_TRACE,
+        .handler = (command_handler_t)handler_get_debug_trace
+    },
+#endif
 };
 // clang-format on
 
@@ -164,9 +231,10 @@ void app_main() {
         }
 
         if (G_io_apdu_buffer[0] == CLA_APP_LEGACY) {
+            // The legacy context (and the setup of the legacy NVRAM) is only initialized when the
+            // first legacy APDU is received, so hosts that only use the new protocol never pay
+            // for it. btchip_context_init also clears the whole context.
             if (G_app_mode != APP_MODE_LEGACY) {
-                explicit_bzero(&btchip_context_D, sizeof(btchip_context_D));
-
                 btchip_context_init();
 
                 G_app_mode = APP_MODE_LEGACY;
@@ -186,6 +254,9 @@ void app_main() {
             }
         } else {
             if (G_app_mode != APP_MODE_NEW) {
+                if (G_app_mode == APP_MODE_LEGACY) {
+                    btchip_signing_key_cache_reset();
+                }
                 explicit_bzero(&G_command_state, sizeof(G_command_state));
 
                 G_app_mode = APP_MODE_NEW;
@@ -193,23 +264,25 @@ void app_main() {
 
             // Reset structured APDU command
             memset(&cmd, 0, sizeof(cmd));
+            // No allocation of the cxram stash outlives a command
+            cxram_reset();
             // Parse APDU command from G_io_apdu_buffer
             if (!apdu_parser(&cmd, G_io_apdu_buffer, input_len)) {
                 PRINTF("=> /!\\ BAD LENGTH: %.*H\n", input_len, G_io_apdu_buffer);
                 io_send_sw(SW_WRONG_DATA_LENGTH);
                 return;
             }
-
-            PRINTF("=> CLA=%02X | INS=%02X | P1=%02X | P2=%02X | Lc=%02X | CData=",
-                   cmd.cla,
-                   cmd.ins,
-                   cmd.p1,
-                   cmd.p2,
-                   cmd.lc);
-            for (int i = 0; i < cmd.lc; i++) {
-                PRINTF("%02X", cmd.data[i]);
+            // Private keys are only cached during a command
+            if (cmd.cla != CLA_FRAMEWORK || cmd.ins != INS_CONTINUE) {
+                private_node_cache_reset();
+                tweaked_key_cache_reset();
+#ifndef HAVE_KEY_INFO_CACHE
+                // without the session cache, key information only lives for a command
+                key_info_cache_reset();
+#endif
             }
-            PRINTF("\n");
+
+            debug_trace_apdu(&cmd);
 
             // Dispatch structured APDU command to handler
             apdu_dispatcher(COMMAND_DESCRIPTORS,
@@ -226,6 +299,19 @@ void app_main() {
  * Exit the application and go back to the dashboard.
  */
 void app_exit() {
+    if (G_app_mode == APP_MODE_LEGACY) {
+        btchip_signing_key_cache_reset();
+    }
+    xpub_cache_reset();
+    account_xpub_cache_reset();
+    private_node_cache_reset();
+    tweaked_key_cache_reset();
+    symmetric_key_cache_reset();
+    wallet_cache_reset();
+    key_info_cache_reset();
+    sign_psbt_checkpoint_reset();
+    spending_session_reset();
+
     BEGIN_TRY_L(exit) {
         TRY_L(exit) {
             os_sched_exit(-1);
@@ -267,6 +353,10 @@ void coin_main(btchip_altcoin_config_t *coin_config) {
     // Reset dispatcher state
     explicit_bzero(&G_dispatcher_context, sizeof(G_dispatcher_context));
 
+#ifdef HAVE_STACK_PROFILE
+    app_stats_paint_stack();
+#endif
+
     memset(G_io_apdu_buffer, 0, 255);  // paranoia
 
     // Process the incoming APDUs
@@ -295,7 +385,9 @@ void coin_main(btchip_altcoin_config_t *coin_config) {
                 app_main();
             }
             CATCH(EXCEPTION_IO_RESET) {
-                // reset IO and UX
+                // reset IO and UX; an interrupted command is abandoned, with its private keys
+                private_node_cache_reset();
+                tweaked_key_cache_reset();
                 CLOSE_TRY;
                 continue;
             }
@@ -374,6 +466,11 @@ __attribute__((section(".boot"))) int main(int arg0) {
             // coin application launched from dashboard
             if (args->coin_config == NULL)
                 app_exit();
+#ifdef HAVE_BITCOIN_ONLY
+            // the altcoin branches are compiled out, the app can not run for another coin
+            else if (args->coin_config->kind != COIN_KIND)
+                app_exit();
+#endif
             else
                 coin_main(args->coin_config);
             break;
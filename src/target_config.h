@@ -0,0 +1,93 @@
+#pragma once
+
+/*
+  Sizes of the caches and buffers of the app that depend on the device, selected by the TARGET_NAME
+  of the Makefile (the SDK defines a macro with the same name). NanoS has about 4 KB of RAM for the
+  app, so its caches are as small as possible; the other targets, and the builds for the host, have
+  several times more, and use it to avoid recomputing derivations and hashes, and to save round
+  trips with the client.
+
+  Limits that are visible to the client, like the maximum number of keys of a wallet policy or of
+  inputs of a psbt, are not here: they are the same on all the devices, so that a wallet policy or
+  a psbt accepted by one device is accepted by all of them.
+*/
+
+#ifdef TARGET_NANOS
+
+// src/boilerplate
+#define TARGET_PREFETCH_BUFFER_SIZE 128
+#define TARGET_BATCH_BUFFER_SIZE    128
+#define TARGET_DEBUG_TRACE_SIZE     32
+#define TARGET_PROCESSOR_TRACE_SIZE 32
+
+// src/common: derived keys and addresses
+#define TARGET_XPUB_CACHE_SIZE         2
+#define TARGET_PRIVATE_NODE_CACHE_SIZE 1
+#define TARGET_TWEAKED_KEY_CACHE_SIZE  1
+#define TARGET_PUBKEY_CACHE_SIZE       5
+#define TARGET_TAPROOT_KEY_CACHE_SIZE  2
+#define TARGET_ADDRESS_CACHE_SIZE      1
+
+// src/common: wallet policies and verified Merkle trees
+#define TARGET_WALLET_CACHE_SIZE          1
+#define TARGET_KEY_INFO_CACHE_SIZE        2
+#define TARGET_KEY_INFO_CACHE_PER_COMMAND 0
+#define TARGET_WALLET_STORE_SIZE          1
+#define TARGET_MERKLE_CACHE_SIZE          8
+#define TARGET_SORTED_TREE_CACHE_SIZE     8
+#define TARGET_MAP_COMMITMENT_CACHE_SIZE  0
+#define TARGET_SPENDING_SESSION_SIZE      1
+
+// src/handler
+#define TARGET_MAX_SIGN_PSBT_WALLETS       2
+#define TARGET_SIGN_PSBT_WALLET_INDEX_BITS 1
+#define TARGET_TAPTREE_HASH_CACHE_SIZE     2
+#define TARGET_SIGN_PSBT_PARENT_VOUTS      2
+#define TARGET_SIGN_PSBT_POLICY_MAPS_SIZE  160
+#define TARGET_SIGN_PSBT_INPUT_RECORDS     0
+#define TARGET_SIGN_PSBT_INPUT_PATHS       0
+#define TARGET_PREPARED_PARENTS_SIZE       0
+
+// src/legacy
+#define TARGET_TRUSTED_INPUT_CACHE_SIZE 0
+
+#else
+
+// src/boilerplate
+#define TARGET_PREFETCH_BUFFER_SIZE 256
+#define TARGET_BATCH_BUFFER_SIZE    255
+#define TARGET_DEBUG_TRACE_SIZE     128
+#define TARGET_PROCESSOR_TRACE_SIZE 128
+
+// src/common: derived keys and addresses
+#define TARGET_XPUB_CACHE_SIZE         4
+#define TARGET_PRIVATE_NODE_CACHE_SIZE 2
+#define TARGET_TWEAKED_KEY_CACHE_SIZE  2
+#define TARGET_PUBKEY_CACHE_SIZE       8
+#define TARGET_TAPROOT_KEY_CACHE_SIZE  4
+#define TARGET_ADDRESS_CACHE_SIZE      4
+
+// src/common: wallet policies and verified Merkle trees
+#define TARGET_WALLET_CACHE_SIZE          4
+#define TARGET_KEY_INFO_CACHE_SIZE        15
+#define TARGET_KEY_INFO_CACHE_PER_COMMAND 1
+#define TARGET_WALLET_STORE_SIZE          4
+#define TARGET_MERKLE_CACHE_SIZE          16
+#define TARGET_SORTED_TREE_CACHE_SIZE     16
+#define TARGET_MAP_COMMITMENT_CACHE_SIZE  16
+#define TARGET_SPENDING_SESSION_SIZE      4
+
+// src/handler
+#define TARGET_MAX_SIGN_PSBT_WALLETS       4
+#define TARGET_SIGN_PSBT_WALLET_INDEX_BITS 2
+#define TARGET_TAPTREE_HASH_CACHE_SIZE     4
+#define TARGET_SIGN_PSBT_PARENT_VOUTS      8
+#define TARGET_SIGN_PSBT_POLICY_MAPS_SIZE  320
+#define TARGET_SIGN_PSBT_INPUT_RECORDS     16
+#define TARGET_SIGN_PSBT_INPUT_PATHS       32
+#define TARGET_PREPARED_PARENTS_SIZE       4
+
+// src/legacy
+#define TARGET_TRUSTED_INPUT_CACHE_SIZE 8
+
+#endif
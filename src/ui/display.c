@@ -63,10 +63,19 @@ typedef struct {
     char address[MAX_ADDRESS_LENGTH_STR + 1];
 } ui_path_and_address_state_t;
 
+typedef struct {
+    char bip32_path_str[MAX_SERIALIZED_BIP32_PATH_LENGTH + 1];
+    char message[MESSAGE_CHUNK_SIZE + sizeof("...")];
+    char message_hash[64 + 1];
+} ui_path_and_message_state_t;
+
 typedef struct {
     char wallet_name[MAX_WALLET_NAME_LENGTH + 1];
-    char policy_map[MAX_POLICY_MAP_STR_LENGTH];
-    char address[MAX_ADDRESS_LENGTH_STR + 1];
+    // the header of a wallet policy and its addresses are never shown in the same flow
+    union {
+        char policy_map[MAX_POLICY_MAP_STR_LENGTH];
+        char address[MAX_ADDRESS_LENGTH_STR + 1];
+    };
 } ui_wallet_state_t;
 
 typedef struct {
@@ -75,25 +84,54 @@ typedef struct {
 } ui_cosigner_pubkey_and_index_state_t;
 
 typedef struct {
-    char index[sizeof("output #999")];
+    char index[sizeof("output #4294967295")];
     char address[MAX_ADDRESS_LENGTH_STR + 1];
     char amount[MAX_AMOUNT_LENGTH + 1];
 } ui_validate_output_state_t;
 
+typedef struct {
+    char n_outputs[sizeof("4294967295 outputs")];
+    char outputs_hash[64 + 1];
+    char amount[MAX_AMOUNT_LENGTH + 1];
+} ui_validate_output_summary_state_t;
+
 typedef struct {
     char fee[MAX_AMOUNT_LENGTH + 1];
 } ui_validate_transaction_state_t;
 
+typedef struct {
+    char message_hash[64 + 1];
+    char amount[MAX_AMOUNT_LENGTH + 1];
+} ui_validate_proof_state_t;
+
+typedef struct {
+    // the name of the wallet, or the derivation path of the account of a default wallet
+    char wallet[2 + MAX_SERIALIZED_BIP32_PATH_LENGTH + 1];
+    char max_tx_amount[MAX_AMOUNT_LENGTH + 1];
+    char max_session_amount[MAX_AMOUNT_LENGTH + 1];
+    char n_destinations[sizeof("4294967295")];
+} ui_spending_policy_state_t;
+
+typedef struct {
+    char index[sizeof("destination #4294967295")];
+    char address[MAX_ADDRESS_LENGTH_STR + 1];
+} ui_spending_destination_state_t;
+
 /**
  * Union of all the states for each of the UI screens, in order to save memory.
  */
 typedef union {
     ui_path_and_pubkey_state_t path_and_pubkey;
     ui_path_and_address_state_t path_and_address;
+    ui_path_and_message_state_t path_and_message;
     ui_wallet_state_t wallet;
     ui_cosigner_pubkey_and_index_state_t cosigner_pubkey_and_index;
     ui_validate_output_state_t validate_output;
+    ui_validate_output_summary_state_t validate_output_summary;
     ui_validate_transaction_state_t validate_transaction;
+    ui_validate_proof_state_t validate_proof;
+    ui_spending_policy_state_t spending_policy;
+    ui_spending_destination_state_t spending_destination;
 } ui_state_t;
 
 #ifdef TARGET_NANOS
@@ -192,6 +230,35 @@ UX_STEP_NOCB(ux_display_address_step,
                  .text = g_ui_state.path_and_address.address,
              });
 
+// MESSAGE
+
+// Step with icon and text to sign a message
+UX_STEP_NOCB(ux_display_sign_message_step, pnn, {&C_icon_certificate, "Sign", "message"});
+
+// Step with title/text for the BIP32 path of the key signing a message
+UX_STEP_NOCB(ux_display_message_path_step,
+             bnnn_paging,
+             {
+                 .title = "Path",
+                 .text = g_ui_state.path_and_message.bip32_path_str,
+             });
+
+// Step with title/text for a message (or its beginning)
+UX_STEP_NOCB(ux_display_message_step,
+             bnnn_paging,
+             {
+                 .title = "Message",
+                 .text = g_ui_state.path_and_message.message,
+             });
+
+// Step with title/text for the hash of a message
+UX_STEP_NOCB(ux_display_message_hash_step,
+             bnnn_paging,
+             {
+                 .title = "Message hash",
+                 .text = g_ui_state.path_and_message.message_hash,
+             });
+
 // Step with icon and text with name of a wallet being registered
 UX_STEP_NOCB(ux_display_wallet_header_name_step,
              pnn,
@@ -252,6 +319,15 @@ UX_STEP_NOCB(ux_display_warning_external_inputs_step,
                  "external inputs",
              });
 
+// Step with warning icon and text explaining that some inputs have a non-default sighash type
+UX_STEP_NOCB(ux_display_warning_nondefault_sighash_step,
+             pnn,
+             {
+                 &C_icon_warning,
+                 "Non-default",
+                 "sighash",
+             });
+
 // Step with eye icon and "Review" and the output index
 UX_STEP_NOCB(ux_review_step,
              pnn,
@@ -277,6 +353,26 @@ UX_STEP_NOCB(ux_validate_address_step,
                  .text = g_ui_state.validate_output.address,
              });
 
+UX_STEP_NOCB(ux_review_output_summary_step,
+             pnn,
+             {
+                 &C_icon_eye,
+                 "Review",
+                 g_ui_state.validate_output_summary.n_outputs,
+             });
+UX_STEP_NOCB(ux_validate_output_summary_amount_step,
+             bnnn_paging,
+             {
+                 .title = "Total amount",
+                 .text = g_ui_state.validate_output_summary.amount,
+             });
+UX_STEP_NOCB(ux_validate_output_summary_hash_step,
+             bnnn_paging,
+             {
+                 .title = "Outputs hash",
+                 .text = g_ui_state.validate_output_summary.outputs_hash,
+             });
+
 UX_STEP_NOCB(ux_confirm_transaction_step, pnn, {&C_icon_eye, "Confirm", "transaction"});
 UX_STEP_NOCB(ux_confirm_transaction_fees_step,
              bnnn_paging,
@@ -284,6 +380,65 @@ UX_STEP_NOCB(ux_confirm_transaction_fees_step,
                  .title = "Fees",
                  .text = g_ui_state.validate_transaction.fee,
              });
+UX_STEP_NOCB(ux_confirm_proof_step, pnn, {&C_icon_eye, "Confirm proof", "of reserves"});
+UX_STEP_NOCB(ux_confirm_proof_message_hash_step,
+             bnnn_paging,
+             {
+                 .title = "Message hash",
+                 .text = g_ui_state.validate_proof.message_hash,
+             });
+UX_STEP_NOCB(ux_confirm_proof_amount_step,
+             bnnn_paging,
+             {
+                 .title = "Reserves",
+                 .text = g_ui_state.validate_proof.amount,
+             });
+
+UX_STEP_NOCB(ux_display_unattended_signing_step,
+             pnn,
+             {
+                 &C_icon_warning,
+                 "Unattended",
+                 "signing",
+             });
+UX_STEP_NOCB(ux_display_spending_policy_wallet_step,
+             bnnn_paging,
+             {
+                 .title = "Spend from",
+                 .text = g_ui_state.spending_policy.wallet,
+             });
+UX_STEP_NOCB(ux_display_spending_policy_max_tx_step,
+             bnnn_paging,
+             {
+                 .title = "Max per tx",
+                 .text = g_ui_state.spending_policy.max_tx_amount,
+             });
+UX_STEP_NOCB(ux_display_spending_policy_max_session_step,
+             bnnn_paging,
+             {
+                 .title = "Max per session",
+                 .text = g_ui_state.spending_policy.max_session_amount,
+             });
+UX_STEP_NOCB(ux_display_spending_policy_destinations_step,
+             bnnn_paging,
+             {
+                 .title = "Destinations",
+                 .text = g_ui_state.spending_policy.n_destinations,
+             });
+
+UX_STEP_NOCB(ux_review_spending_destination_step,
+             pnn,
+             {
+                 &C_icon_eye,
+                 "Review",
+                 g_ui_state.spending_destination.index,
+             });
+UX_STEP_NOCB(ux_display_spending_destination_address_step,
+             bnnn_paging,
+             {
+                 .title = "Address",
+                 .text = g_ui_state.spending_destination.address,
+             });
 UX_STEP_CB(ux_accept_and_send_step,
            pbb,
            (*g_validate_callback)(&G_dispatcher_context, true),
@@ -361,6 +516,34 @@ UX_FLOW(ux_display_unusual_derivation_path_flow,
         &ux_display_approve_step,
         &ux_display_reject_step);
 
+// FLOW to sign a message:
+// #1 screen: certificate icon + "Sign message"
+// #2 screen: display BIP32 Path
+// #3 screen: display message hash
+// #4 screen: approve button
+// #5 screen: reject button
+UX_FLOW(ux_sign_message_flow,
+        &ux_display_sign_message_step,
+        &ux_display_message_path_step,
+        &ux_display_message_hash_step,
+        &ux_display_approve_step,
+        &ux_display_reject_step);
+
+// FLOW to sign a printable message:
+// #1 screen: certificate icon + "Sign message"
+// #2 screen: display BIP32 Path
+// #3 screen: display the message, or its first chunk followed by "..." (paginated)
+// #4 screen: display message hash
+// #5 screen: approve button
+// #6 screen: reject button
+UX_FLOW(ux_sign_message_with_preview_flow,
+        &ux_display_sign_message_step,
+        &ux_display_message_path_step,
+        &ux_display_message_step,
+        &ux_display_message_hash_step,
+        &ux_display_approve_step,
+        &ux_display_reject_step);
+
 // FLOW to display the header of a policy map wallet:
 // #1 screen: eye icon + "Register wallet" and the wallet name
 // #2 screen: display policy map (paginated)
@@ -419,6 +602,15 @@ UX_FLOW(ux_display_warning_external_inputs_flow,
         &ux_display_reject_if_not_sure_step,
         &ux_display_continue_step);
 
+// FLOW to warn about inputs signed with a non-default sighash type
+// #1 screen: warning icon + "Non-default sighash"
+// #2 screen: crossmark icon + "Reject if not sure" (user can reject here)
+// #3 screen: "continue" button
+UX_FLOW(ux_display_warning_nondefault_sighash_flow,
+        &ux_display_warning_nondefault_sighash_step,
+        &ux_display_reject_if_not_sure_step,
+        &ux_display_continue_step);
+
 // FLOW to validate a single output
 // #1 screen: eye icon + "Review" + index of output to validate
 // #2 screen: output amount
@@ -432,6 +624,19 @@ UX_FLOW(ux_display_output_address_amount_flow,
         &ux_display_approve_step,
         &ux_display_reject_step);
 
+// FLOW to validate all the external outputs at once
+// #1 screen: eye icon + "Review" + number of external outputs
+// #2 screen: total amount of the external outputs
+// #3 screen: hash of the external outputs (paginated)
+// #4 screen: approve button
+// #5 screen: reject button
+UX_FLOW(ux_display_output_summary_flow,
+        &ux_review_output_summary_step,
+        &ux_validate_output_summary_amount_step,
+        &ux_validate_output_summary_hash_step,
+        &ux_display_approve_step,
+        &ux_display_reject_step);
+
 // Finalize see the transaction fees and finally accept signing
 // #1 screen: eye icon + "Confirm Transaction"
 // #2 screen: fee amount
@@ -443,14 +648,46 @@ UX_FLOW(ux_accept_transaction_flow,
         &ux_accept_and_send_step,
         &ux_display_reject_step);
 
-static size_t n_digits(uint64_t number) {
-    size_t count = 0;
-    do {
-        count++;
-        number /= 10;
-    } while (number != 0);
-    return count;
-}
+// FLOW to confirm a BIP-322 proof of reserves, instead of a transaction
+// #1 screen: eye icon + "Confirm proof of reserves"
+// #2 screen: hash of the signed message (paginated)
+// #3 screen: total amount of the proven inputs
+// #4 screen: approve button
+// #5 screen: reject button
+UX_FLOW(ux_accept_proof_flow,
+        &ux_confirm_proof_step,
+        &ux_confirm_proof_message_hash_step,
+        &ux_confirm_proof_amount_step,
+        &ux_display_approve_step,
+        &ux_display_reject_step);
+
+// FLOW to register a spending policy, whose psbts are then signed without user interaction
+// #1 screen: warning icon + "Unattended signing"
+// #2 screen: wallet name, or account of a default wallet
+// #3 screen: maximum amount of a transaction
+// #4 screen: maximum amount of a session
+// #5 screen: number of destinations, that are shown next
+// #6 screen: approve button
+// #7 screen: reject button
+UX_FLOW(ux_display_spending_policy_flow,
+        &ux_display_unattended_signing_step,
+        &ux_display_spending_policy_wallet_step,
+        &ux_display_spending_policy_max_tx_step,
+        &ux_display_spending_policy_max_session_step,
+        &ux_display_spending_policy_destinations_step,
+        &ux_display_approve_step,
+        &ux_display_reject_step);
+
+// FLOW to validate a destination of a spending policy
+// #1 screen: eye icon + "Review" + index of the destination
+// #2 screen: destination address (paginated)
+// #3 screen: approve button
+// #4 screen: reject button
+UX_FLOW(ux_display_spending_destination_flow,
+        &ux_review_spending_destination_step,
+        &ux_display_spending_destination_address_step,
+        &ux_display_approve_step,
+        &ux_display_reject_step);
 
 // TODO: document and add unit tests
 static void format_sats_amount(const char *coin_name,
@@ -462,29 +699,21 @@ static void format_sats_amount(const char *coin_name,
 
     char *amount_str = out + coin_name_len + 1;
 
-    uint64_t integral_part = amount / 100000000;
-    uint32_t fractional_part = (uint32_t) (amount % 100000000);
-
-    // format the integral part, starting from the least significant digit
-    size_t integral_part_digit_count = n_digits(integral_part);
-    for (unsigned int i = 0; i < integral_part_digit_count; i++) {
-        amount_str[integral_part_digit_count - 1 - i] = '0' + (integral_part % 10);
-        integral_part /= 10;
+    // exactly 8 decimals; format_fpu64 only does 64-bit divisions for amounts above 2^32 satoshis
+    if (!format_fpu64(amount_str, MAX_AMOUNT_LENGTH - coin_name_len, amount, 8)) {
+        amount_str[0] = '\0';  // never happens, as MAX_AMOUNT_LENGTH fits any amount
+        return;
     }
 
-    if (fractional_part == 0) {
-        amount_str[integral_part_digit_count] = '\0';
-    } else {
-        // format the fractional part (exactly 8 digits, possibly with trailing zeros)
-        amount_str[integral_part_digit_count] = '.';
-        char *fract_part_str = amount_str + integral_part_digit_count + 1;
-        snprintf(fract_part_str, 8 + 1, "%08u", fractional_part);
-
-        // drop trailing zeros
-        for (int i = 7; i > 0 && fract_part_str[i] == '0'; i--) {
-            fract_part_str[i] = '\0';
-        }
+    // drop the trailing zeros of the fractional part, and the decimal separator if nothing is left
+    char *end = amount_str + strlen(amount_str);
+    while (end[-1] == '0') {
+        --end;
     }
+    if (end[-1] == '.') {
+        --end;
+    }
+    *end = '\0';
 }
 
 void ui_display_pubkey(dispatcher_context_t *context,
@@ -529,6 +758,33 @@ void ui_display_address(dispatcher_context_t *context,
     }
 }
 
+void ui_display_message(dispatcher_context_t *context,
+                        char *bip32_path_str,
+                        char *message,
+                        bool is_truncated,
+                        char *message_hash,
+                        action_validate_cb callback) {
+    (void) (context);
+
+    ui_path_and_message_state_t *state = (ui_path_and_message_state_t *) &g_ui_state;
+
+    strncpy(state->bip32_path_str, bip32_path_str, sizeof(state->bip32_path_str));
+    strncpy(state->message_hash, message_hash, sizeof(state->message_hash));
+
+    g_validate_callback = callback;
+
+    if (message == NULL) {
+        ux_flow_init(0, ux_sign_message_flow, NULL);
+    } else {
+        // the message is at most MESSAGE_CHUNK_SIZE characters long
+        strncpy(state->message, message, MESSAGE_CHUNK_SIZE + 1);
+        if (is_truncated) {
+            strcat(state->message, "...");
+        }
+        ux_flow_init(0, ux_sign_message_with_preview_flow, NULL);
+    }
+}
+
 void ui_display_wallet_header(dispatcher_context_t *context,
                               policy_map_wallet_header_t *wallet_header,
                               action_validate_cb callback) {
@@ -629,25 +885,51 @@ void ui_warn_external_inputs(dispatcher_context_t *context, action_validate_cb c
     ux_flow_init(0, ux_display_warning_external_inputs_flow, NULL);
 }
 
-void ui_validate_output(dispatcher_context_t *context,
-                        int index,
-                        char *address,
-                        char *coin_name,
-                        uint64_t amount,
-                        action_validate_cb callback) {
+void ui_warn_nondefault_sighash(dispatcher_context_t *context, action_validate_cb callback) {
     (void) (context);
 
+    g_validate_callback = callback;
+
+    ux_flow_init(0, ux_display_warning_nondefault_sighash_flow, NULL);
+}
+
+char *ui_prepare_output(int index, const char *coin_name, uint64_t amount) {
     ui_validate_output_state_t *state = (ui_validate_output_state_t *) &g_ui_state;
 
     snprintf(state->index, sizeof(state->index), "output #%d", index);
-    strncpy(state->address, address, sizeof(state->address));
     format_sats_amount(coin_name, amount, state->amount);
+    state->address[0] = '\0';
+
+    return state->address;
+}
+
+void ui_validate_output(dispatcher_context_t *context, action_validate_cb callback) {
+    (void) (context);
 
     g_validate_callback = callback;
 
     ux_flow_init(0, ux_display_output_address_amount_flow, NULL);
 }
 
+void ui_validate_output_summary(dispatcher_context_t *context,
+                                int n_outputs,
+                                char *outputs_hash,
+                                char *coin_name,
+                                uint64_t amount,
+                                action_validate_cb callback) {
+    (void) (context);
+
+    ui_validate_output_summary_state_t *state = (ui_validate_output_summary_state_t *) &g_ui_state;
+
+    snprintf(state->n_outputs, sizeof(state->n_outputs), "%d outputs", n_outputs);
+    strncpy(state->outputs_hash, outputs_hash, sizeof(state->outputs_hash));
+    format_sats_amount(coin_name, amount, state->amount);
+
+    g_validate_callback = callback;
+
+    ux_flow_init(0, ux_display_output_summary_flow, NULL);
+}
+
 void ui_validate_transaction(dispatcher_context_t *context,
                              char *coin_name,
                              uint64_t fee,
@@ -662,3 +944,58 @@ void ui_validate_transaction(dispatcher_context_t *context,
 
     ux_flow_init(0, ux_accept_transaction_flow, NULL);
 }
+
+void ui_validate_proof_of_reserves(dispatcher_context_t *context,
+                                   char *message_hash,
+                                   char *coin_name,
+                                   uint64_t amount,
+                                   action_validate_cb callback) {
+    (void) (context);
+
+    ui_validate_proof_state_t *state = (ui_validate_proof_state_t *) &g_ui_state;
+
+    strncpy(state->message_hash, message_hash, sizeof(state->message_hash));
+    format_sats_amount(coin_name, amount, state->amount);
+
+    g_validate_callback = callback;
+
+    ux_flow_init(0, ux_accept_proof_flow, NULL);
+}
+
+void ui_display_spending_policy(dispatcher_context_t *context,
+                                char *wallet,
+                                char *coin_name,
+                                uint64_t max_tx_amount,
+                                uint64_t max_session_amount,
+                                uint32_t n_destinations,
+                                action_validate_cb callback) {
+    (void) (context);
+
+    ui_spending_policy_state_t *state = (ui_spending_policy_state_t *) &g_ui_state;
+
+    strncpy(state->wallet, wallet, sizeof(state->wallet) - 1);
+    state->wallet[sizeof(state->wallet) - 1] = '\0';
+    format_sats_amount(coin_name, max_tx_amount, state->max_tx_amount);
+    format_sats_amount(coin_name, max_session_amount, state->max_session_amount);
+    snprintf(state->n_destinations, sizeof(state->n_destinations), "%d", (int) n_destinations);
+
+    g_validate_callback = callback;
+
+    ux_flow_init(0, ux_display_spending_policy_flow, NULL);
+}
+
+void ui_display_spending_destination(dispatcher_context_t *context,
+                                     int index,
+                                     char *address,
+                                     action_validate_cb callback) {
+    (void) (context);
+
+    ui_spending_destination_state_t *state = (ui_spending_destination_state_t *) &g_ui_state;
+
+    snprintf(state->index, sizeof(state->index), "destination #%d", index);
+    strncpy(state->address, address, sizeof(state->address));
+
+    g_validate_callback = callback;
+
+    ux_flow_init(0, ux_display_spending_destination_flow, NULL);
+}
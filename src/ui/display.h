@@ -29,6 +29,18 @@ void ui_display_address(dispatcher_context_t *dispatcher_context,
                         char *bip32_path_str,
                         action_validate_cb callback);
 
+/**
+ * Display the derivation path and the hash of a message to sign, and asks the confirmation to
+ * sign it. If message is not NULL, the (beginning of the) message is also shown; is_truncated
+ * tells if it is only the beginning.
+ */
+void ui_display_message(dispatcher_context_t *dispatcher_context,
+                        char *bip32_path_str,
+                        char *message,
+                        bool is_truncated,
+                        char *message_hash,
+                        action_validate_cb callback);
+
 void ui_display_wallet_header(dispatcher_context_t *context,
                               policy_map_wallet_header_t *wallet_header,
                               action_validate_cb callback);
@@ -55,14 +67,57 @@ void ui_authorize_wallet_spend(dispatcher_context_t *context,
 
 void ui_warn_external_inputs(dispatcher_context_t *context, action_validate_cb callback);
 
-void ui_validate_output(dispatcher_context_t *context,
-                        int index,
-                        char *address,
-                        char *coin_name,
-                        uint64_t amount,
-                        action_validate_cb callback);
+void ui_warn_nondefault_sighash(dispatcher_context_t *context, action_validate_cb callback);
+
+/**
+ * Prepares the screens of an external output while the output is verified: formats its index and
+ * amount, and returns the buffer, of MAX_ADDRESS_LENGTH_STR + 1 bytes, where the caller encodes its
+ * address. The output is then shown with ui_validate_output, that does no formatting; the strings
+ * are kept until the next call to a ui_* function.
+ */
+char *ui_prepare_output(int index, const char *coin_name, uint64_t amount);
+
+/**
+ * Shows the output prepared with ui_prepare_output, and asks the user to validate it.
+ */
+void ui_validate_output(dispatcher_context_t *context, action_validate_cb callback);
+
+void ui_validate_output_summary(dispatcher_context_t *context,
+                                int n_outputs,
+                                char *outputs_hash,
+                                char *coin_name,
+                                uint64_t amount,
+                                action_validate_cb callback);
 
 void ui_validate_transaction(dispatcher_context_t *context,
                              char *coin_name,
                              uint64_t fee,
                              action_validate_cb callback);
+
+void ui_validate_proof_of_reserves(dispatcher_context_t *context,
+                                   char *message_hash,
+                                   char *coin_name,
+                                   uint64_t amount,
+                                   action_validate_cb callback);
+
+/**
+ * Shows the wallet (its name, or the derivation path of the account of a default wallet), the
+ * limits and the number of destinations of a spending policy, and asks the user to approve the
+ * unattended signing of the psbts that match it; the destinations are then shown one by one with
+ * ui_display_spending_destination.
+ */
+void ui_display_spending_policy(dispatcher_context_t *context,
+                                char *wallet,
+                                char *coin_name,
+                                uint64_t max_tx_amount,
+                                uint64_t max_session_amount,
+                                uint32_t n_destinations,
+                                action_validate_cb callback);
+
+/**
+ * Shows the address of a destination of a spending policy, and asks the user to validate it.
+ */
+void ui_display_spending_destination(dispatcher_context_t *context,
+                                     int index,
+                                     char *address,
+                                     action_validate_cb callback);
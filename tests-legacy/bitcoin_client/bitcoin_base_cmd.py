@@ -174,6 +174,59 @@ class BitcoinBaseCommand:
 
         return pub_key, addr, bip32_chain_code
 
+    def get_public_keys_batch(self,
+                              addr_type: AddrType,
+                              bip32_path: str,
+                              first_index: int,
+                              count: int) -> List[Tuple[bytes, str]]:
+        """Get the public keys and the addresses of `count` consecutive children of a BIP32 path, without display.
+
+        Parameters
+        ----------
+        addr_type : AddrType
+            Type of address. Could be AddrType.Legacy, AddrType.P2SH_P2WPKH,
+            AddrType.BECH32.
+        bip32_path : str
+            BIP32 path of the parent.
+        first_index : int
+            Index of the first child (not hardened).
+        count : int
+            Number of children.
+
+        Returns
+        -------
+        List[Tuple[bytes, str]]
+            The public key (compressed, unless the app uses uncompressed keys) and the address of each child.
+
+        """
+        result: List[Tuple[bytes, str]] = []
+        while len(result) < count:
+            sw, response = self.transport.exchange_raw(
+                self.builder.get_public_keys_batch(addr_type=addr_type,
+                                                   bip32_path=bip32_path,
+                                                   first_index=first_index + len(result),
+                                                   count=min(255, count - len(result)))
+            )  # type: int, bytes
+
+            if sw != 0x9000:
+                raise DeviceException(error_code=sw, ins=InsType.GET_WALLET_PUBLIC_KEY)
+
+            # response = n (1) || (len(pub_key) (1) || pub_key (var) || len(addr) (1) || addr (var)) * n
+            n: int = response[0]
+            offset: int = 1
+            for _ in range(n):
+                pub_key_len: int = response[offset]
+                pub_key: bytes = response[offset + 1:offset + 1 + pub_key_len]
+                offset += 1 + pub_key_len
+                addr_len: int = response[offset]
+                addr: str = response[offset + 1:offset + 1 + addr_len].decode("ascii")
+                offset += 1 + addr_len
+                result.append((pub_key, addr))
+
+            assert n > 0 and len(response) == offset
+
+        return result
+
     def get_trusted_input(self,
                           utxo: CTransaction,
                           output_index: int) -> bytes:
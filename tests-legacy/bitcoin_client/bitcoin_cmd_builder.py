@@ -182,6 +182,43 @@ class BitcoinCommandBuilder:
 
         return self.serialize(cla=self.CLA, ins=ins, p1=p1, p2=p2, cdata=cdata)
 
+    def get_public_keys_batch(self,
+                              addr_type: AddrType,
+                              bip32_path: str,
+                              first_index: int,
+                              count: int) -> bytes:
+        """Command builder for GET_WALLET_PUBLIC_KEY of consecutive children without display (P1 = 0x04).
+
+        Parameters
+        ----------
+        addr_type : AddrType
+            The type of addresses expected in the response.
+        bip32_path : str
+            String representation of the BIP32 path of the parent.
+        first_index : int
+            Index of the first child (not hardened).
+        count : int
+            Number of children, from 1 to 255.
+
+        Returns
+        -------
+        bytes
+            APDU command for GET_WALLET_PUBLIC_KEY.
+
+        """
+        ins: InsType = InsType.GET_WALLET_PUBLIC_KEY
+
+        path: List[bytes] = bip32_path_from_string(bip32_path)
+
+        cdata: bytes = b"".join([
+            len(path).to_bytes(1, byteorder="big"),
+            *path,
+            first_index.to_bytes(4, byteorder="big"),
+            count.to_bytes(1, byteorder="big")
+        ])
+
+        return self.serialize(cla=self.CLA, ins=ins, p1=0x04, p2=addr_type.value, cdata=cdata)
+
     def get_trusted_input(self,
                           utxo: CTransaction,
                           output_index: int) -> Iterator[bytes]:
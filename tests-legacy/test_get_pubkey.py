@@ -40,3 +40,22 @@ def test_get_public_key(cmd):
                                     "648e4f638cabc4e4383fa3fe8348456e46fa56742dcf500a5b50dc1d403492f0")
     assert addr == "tb1qzdr7s2sr0dwmkwx033r4nujzk86u0cy6fmzfjk"
     assert bip32_chain_code == bytes.fromhex("efd851020a3827ba0d3fd4375910f0ed55dbe8c5d740b37559e993b1d623a956")
+
+
+def test_get_public_keys_batch(cmd):
+    for addr_type, path in [(AddrType.Legacy, "m/44'/1'/0'/0"),
+                            (AddrType.P2SH_P2WPKH, "m/49'/1'/0'/1"),
+                            (AddrType.BECH32, "m/84'/1'/0'/0")]:
+        # more children than fit in one response
+        keys = cmd.get_public_keys_batch(addr_type=addr_type, bip32_path=path, first_index=3, count=7)
+
+        assert len(keys) == 7
+        for i, (pub_key, addr) in enumerate(keys):
+            expected_pub_key, expected_addr, _ = cmd.get_public_key(
+                addr_type=addr_type,
+                bip32_path=f"{path}/{3 + i}",
+                display=False
+            )
+            # the key of the batch is compressed
+            assert pub_key == bytes([2 + (expected_pub_key[64] & 1)]) + expected_pub_key[1:33]
+            assert addr == expected_addr
@@ -1,10 +1,13 @@
 from dataclasses import dataclass
 
 from tests.utils import automation
+from tests.utils.benchmark import BenchmarkRecorder
+from tests.utils.transcript import RecordingClient, ReplayClient, load_transcript, save_transcript
 
 import json
+import re
 
-from typing import Union
+from typing import Optional, Union
 
 from pathlib import Path
 
@@ -26,6 +29,60 @@ def pytest_addoption(parser):
     parser.addoption("--hid", action="store_true")
     parser.addoption("--headless", action="store_true")
     parser.addoption("--enableslowtests", action="store_true")
+    parser.addoption("--benchmark", action="store_true", help="run the benchmarks (skipped otherwise)")
+    parser.addoption("--benchmark-report", action="store", default=None,
+                     help="path of the JSON file where the benchmark results are saved")
+    parser.addoption("--benchmark-baseline", action="store", default=None,
+                     help="path of a JSON report to compare the benchmark results with")
+    parser.addoption("--record-transcripts", action="store", default=None,
+                     help="directory where the transcript of the APDUs of each test is saved")
+    parser.addoption("--replay-transcripts", action="store", default=None,
+                     help="directory of recorded transcripts: the device is replaced by their responses")
+    parser.addoption("--replay-requests", action="store", default=None,
+                     help="directory of recorded transcripts: the benchmarks only send their requests to the device")
+
+
+def pytest_configure(config):
+    config.benchmark_recorder = BenchmarkRecorder()
+
+
+def pytest_collection_modifyitems(config, items):
+    if config.getoption("benchmark"):
+        return
+
+    skip_benchmark = pytest.mark.skip(reason="benchmarks only run with the --benchmark option")
+    for item in items:
+        if "benchmark" in item.keywords:
+            item.add_marker(skip_benchmark)
+
+
+def pytest_terminal_summary(terminalreporter, config):
+    recorder: BenchmarkRecorder = config.benchmark_recorder
+    if len(recorder.results) == 0:
+        return
+
+    report_path = config.getoption("benchmark_report")
+    if report_path is not None:
+        recorder.save(report_path)
+        terminalreporter.write_line(f"Benchmark report saved to {report_path}")
+
+    curves = recorder.scaling_curves()
+    if len(curves) > 0:
+        terminalreporter.section("benchmark scaling curves")
+        for line in curves:
+            terminalreporter.write_line(line)
+
+    comparison = recorder.protocol_comparison()
+    if len(comparison) > 0:
+        terminalreporter.section("benchmark legacy protocol vs SIGN_PSBT")
+        for line in comparison:
+            terminalreporter.write_line(line)
+
+    baseline_path = config.getoption("benchmark_baseline")
+    if baseline_path is not None:
+        terminalreporter.section("benchmark comparison with baseline")
+        for line in recorder.compare(baseline_path):
+            terminalreporter.write_line(line)
 
 
 @pytest.fixture(scope="module")
@@ -55,7 +112,30 @@ def enable_slow_tests(pytestconfig):
 
 
 @pytest.fixture
-def client(request, hid) -> Union[HIDClient, SpeculosClient]:
+def benchmark_recorder(pytestconfig) -> BenchmarkRecorder:
+    return pytestconfig.benchmark_recorder
+
+
+def transcript_path(directory: Optional[str], request) -> Optional[Path]:
+    """Returns the path of the transcript of the test in the directory, or None if there is no directory."""
+    if directory is None:
+        return None
+    return Path(directory) / (re.sub(r"[^\w.-]", "_", request.node.nodeid) + ".json")
+
+
+@pytest.fixture
+def replay_requests_path(request, pytestconfig) -> Optional[Path]:
+    return transcript_path(pytestconfig.getoption("replay_requests"), request)
+
+
+@pytest.fixture
+def client(request, pytestconfig, hid) -> Union[HIDClient, SpeculosClient, RecordingClient, ReplayClient]:
+    replay_path = transcript_path(pytestconfig.getoption("replay_transcripts"), request)
+    if replay_path is not None:
+        # no device: the responses come from the transcript
+        yield ReplayClient(load_transcript(replay_path))
+        return
+
     if hid:
         client = HIDClient()
     else:
@@ -73,10 +153,17 @@ def client(request, hid) -> Union[HIDClient, SpeculosClient]:
             rules = json.load(open(automation_file))
             client.set_automation_rules(rules)
 
+    record_path = transcript_path(pytestconfig.getoption("record_transcripts"), request)
+    if record_path is not None:
+        client = RecordingClient(client)
+
     yield client
 
     client.stop()
 
+    if record_path is not None:
+        save_transcript(record_path, client.transcript)
+
 
 @pytest.fixture
 def cmd(client) -> BitcoinCommand:
@@ -0,0 +1,36 @@
+import asyncio
+
+from bitcoin_client.async_command import AsyncBitcoinCommand, ThreadedAsyncTransport
+from bitcoin_client.command import BitcoinCommand
+from bitcoin_client.wallet import PolicyMapWallet
+
+
+def test_async_get_master_fingerprint(client, cmd: BitcoinCommand):
+    async_cmd = AsyncBitcoinCommand(ThreadedAsyncTransport(client))
+
+    assert asyncio.run(async_cmd.get_master_fingerprint()) == cmd.get_master_fingerprint()
+
+
+def test_async_get_wallet_addresses(client, cmd: BitcoinCommand):
+    # the command requires answering client commands during its execution
+    async_cmd = AsyncBitcoinCommand(ThreadedAsyncTransport(client))
+
+    wallet = PolicyMapWallet(
+        name="",
+        policy_map="wpkh(@0)",
+        keys_info=[
+            f"[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**",
+        ],
+    )
+
+    async def get_both():
+        # concurrent commands on the same device are executed one at a time
+        return await asyncio.gather(
+            async_cmd.get_wallet_addresses(wallet, None, 0, 0, 4),
+            async_cmd.get_wallet_address(wallet, None, 1, 3, False),
+        )
+
+    addresses, change_address = asyncio.run(get_both())
+
+    assert addresses == cmd.get_wallet_addresses(wallet, None, 0, 0, 4)
+    assert change_address == cmd.get_wallet_address(wallet, None, 1, 3, False)
@@ -0,0 +1,79 @@
+import random
+
+from typing import List, Tuple
+
+import pytest
+
+from tests.utils import txmaker
+from tests.utils.benchmark import BenchmarkRecorder, CountingBitcoinCommand
+from tests.utils.legacy_client import CountingLegacyTransport, legacy_sign_psbt, load_legacy_client
+
+from .test_benchmark_sign_psbt import SINGLESIG_WALLETS
+from .utils import automation
+
+# Benchmarks of the same transactions signed with the legacy protocol (GET_TRUSTED_INPUT for each input, then
+# UNTRUSTED_HASH_TRANSACTION_INPUT_START/FINALIZE and UNTRUSTED_HASH_SIGN, with the client of tests-legacy) and with
+# SIGN_PSBT, to decide when to migrate the integrations that still use the legacy protocol. Like the other benchmarks,
+# they are skipped unless the --benchmark option is used; at the end of the run, the results of the two protocols are
+# compared for each case, and the cases where SIGN_PSBT is slower or exchanges more APDUs are marked.
+#
+# Each protocol signs in its own test, with a fresh instance of speculos, so that no cache of the device is warm. The
+# PSBT only depends on the case, so both protocols sign the same transaction. Only the single-signature segwit v0
+# wallets are signed by both protocols with the same client code in the legacy client.
+
+
+SCRIPT_TYPES = ["wpkh", "sh_wpkh"]
+
+# (n_inputs, n_outputs)
+SIZES = [(1, 1), (1, 4), (4, 1), (4, 4), (16, 2), (2, 16), (16, 16)]
+
+# the largest cases are very slow (esp. with DEBUG enabled), so they also need the --enableslowtests option
+SLOW_SIZES = [(16, 16)]
+
+PROTOCOLS = ["legacy", "psbt"]
+
+
+def make_cases() -> List[Tuple[str, str, int, int]]:
+    return [(protocol, script_type, n_inputs, n_outputs)
+            for script_type in SCRIPT_TYPES
+            for n_inputs, n_outputs in SIZES
+            for protocol in PROTOCOLS]
+
+
+def case_name(script_type: str, n_inputs: int, n_outputs: int) -> str:
+    return f"{script_type}-{n_inputs}to{n_outputs}"
+
+
+@pytest.mark.benchmark
+@pytest.mark.parametrize("protocol,script_type,n_inputs,n_outputs", make_cases(),
+                         ids=[f"{case[0]}-{case_name(*case[1:])}" for case in make_cases()])
+@automation("automations/sign_with_wallet_accept.json")
+def test_benchmark_protocols(client, benchmark_recorder: BenchmarkRecorder, enable_slow_tests: bool,
+                             protocol: str, script_type: str, n_inputs: int, n_outputs: int):
+    if (n_inputs, n_outputs) in SLOW_SIZES and not enable_slow_tests:
+        pytest.skip("Requires --enableslowtests")
+
+    name = case_name(script_type, n_inputs, n_outputs)
+
+    # the same PSBT for both protocols; one change output (if there is more than one output)
+    random.seed(name)
+    wallet = SINGLESIG_WALLETS[script_type]
+    change_index = 0 if n_outputs > 1 else -1
+    psbt = txmaker.createPsbt(
+        wallet,
+        [100_000 + 10_000 * i for i in range(n_inputs)],
+        [999 + 99 * i for i in range(n_outputs)],
+        [i == change_index for i in range(n_outputs)]
+    )
+
+    if protocol == "legacy":
+        bitcoin_cmd, serialization = load_legacy_client()
+        transport = CountingLegacyTransport(client)
+        legacy_cmd = bitcoin_cmd.BitcoinCommand(transport=transport, debug=False)
+        result = benchmark_recorder.measure(f"protocols-legacy-{name}", transport,
+                                            legacy_sign_psbt, legacy_cmd, serialization, psbt)
+    else:
+        cmd = CountingBitcoinCommand(client=client, debug=False)
+        result = benchmark_recorder.measure(f"protocols-psbt-{name}", cmd, cmd.sign_psbt, psbt, wallet, None)
+
+    assert len(result) == n_inputs
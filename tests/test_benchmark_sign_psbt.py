@@ -0,0 +1,204 @@
+import dataclasses
+import hmac
+import random
+
+from hashlib import sha256
+from pathlib import Path
+from typing import List, Optional, Tuple
+
+import pytest
+
+from bitcoin_client.wallet import PolicyMapWallet, MultisigWallet, AddressType
+from tests.utils import txmaker
+from tests.utils.benchmark import BenchmarkRecorder, CountingBitcoinCommand
+from tests.utils.psbt_generator import PsbtSpec, generate_psbt
+from tests.utils.transcript import load_transcript
+
+from .utils import automation
+
+# Benchmarks for SIGN_PSBT over a matrix of generated PSBTs. They are skipped unless the --benchmark option is used.
+# For each case, the wall time, the number of APDUs and the number of bytes exchanged are recorded; use
+# --benchmark-report to save them to a JSON file, and --benchmark-baseline to compare them with a previous report.
+#
+# The wall time includes the (automated) user interaction, so it is only comparable across runs on the same machine
+# and with the same build options. APDU count and bytes only depend on the PSBT and on the protocol, so any change
+# (for example in the merkle protocol or in the caches) is visible there.
+#
+# To separate the costs of the client and of the device, record the transcripts of the APDUs with
+# --record-transcripts=DIR; then --replay-transcripts=DIR replays the responses of the device, so that only the work of
+# the client is measured, and --replay-requests=DIR only sends the recorded requests to the device, so that only the
+# work of the device is measured.
+#
+# The scaling benchmarks vary one parameter of the PSBT at a time (number of inputs, of outputs, size of the
+# non-witness parent transactions), and their results are summarized as curves at the end of the run.
+
+
+SINGLESIG_WALLETS = {
+    "pkh": PolicyMapWallet(
+        "",
+        "pkh(@0)",
+        [
+            "[f5acc2fd/44'/1'/0']tpubDCwYjpDhUdPGP5rS3wgNg13mTrrjBuG8V9VpWbyptX6TRPbNoZVXsoVUSkCjmQ8jJycjuDKBb9eataSymXakTTaGifxR6kmVsfFehH1ZgJT/**"
+        ],
+    ),
+    "sh_wpkh": PolicyMapWallet(
+        "",
+        "sh(wpkh(@0))",
+        [
+            "[f5acc2fd/49'/1'/0']tpubDC871vGLAiKPcwAw22EjhKVLk5L98UGXBEcGR8gpcigLQVDDfgcYW24QBEyTHTSFEjgJgbaHU8CdRi9vmG4cPm1kPLmZhJEP17FMBdNheh3/**"
+        ],
+    ),
+    "wpkh": PolicyMapWallet(
+        "",
+        "wpkh(@0)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+        ],
+    ),
+    "tr": PolicyMapWallet(
+        "",
+        "tr(@0)",
+        [
+            "[f5acc2fd/86'/1'/0']tpubDDKYE6BREvDsSWMazgHoyQWiJwYaDDYPbCFjYxN3HFXJP5fokeiK4hwK5tTLBNEDBwrDXn8cQ4v9b2xdW62Xr5yxoQdMu1v6c7UDXYVH27U/**"
+        ],
+    ),
+}
+
+# key of the speculos seed used in the multisig wallets; the other keys are random cosigners
+MULTISIG_PATH = "m/48'/1'/0'/2'"
+MULTISIG_OUR_KEY_INFO = "[f5acc2fd/48'/1'/0'/2']tpubDFAqEGNyad35aBCKUAXbQGDjdVhNueno5ZZVEn3sQbW5ci457gLR7HyTmHBg93oourBssgUxuWz1jX5uhc1qaqFo9VsybY1J5FuedLfm4dK/**"
+
+MULTISIG_ADDRESS_TYPES = {
+    "sh": AddressType.LEGACY,
+    "sh_wsh": AddressType.SH_WIT,
+    "wsh": AddressType.WIT,
+}
+
+# (threshold, number of keys); (1, 1) is single-signature.
+QUORUMS = [(1, 1), (2, 3), (3, 5)]
+
+# (n_inputs, n_outputs)
+SIZES = [(1, 1), (1, 16), (4, 4), (16, 1), (16, 16), (64, 2), (2, 256), (64, 256)]
+
+# the largest cases are very slow (esp. with DEBUG enabled), so they also need the --enableslowtests option
+SLOW_SIZES = [(2, 256), (64, 256)]
+
+
+def make_cases() -> List[Tuple[str, int, int, int, int]]:
+    cases = []
+    for threshold, n_keys in QUORUMS:
+        script_types = SINGLESIG_WALLETS.keys() if n_keys == 1 else MULTISIG_ADDRESS_TYPES.keys()
+        for script_type in script_types:
+            for n_inputs, n_outputs in SIZES:
+                cases.append((script_type, threshold, n_keys, n_inputs, n_outputs))
+    return cases
+
+
+def case_name(script_type: str, threshold: int, n_keys: int, n_inputs: int, n_outputs: int) -> str:
+    quorum = "singlesig" if n_keys == 1 else f"{threshold}of{n_keys}"
+    return f"{quorum}-{script_type}-{n_inputs}to{n_outputs}"
+
+
+def make_wallet(script_type: str, threshold: int, n_keys: int) -> Tuple[PolicyMapWallet, Optional[bytes]]:
+    """Returns the wallet, and its id if it needs registration (None for single-signature wallets)."""
+    if n_keys == 1:
+        return SINGLESIG_WALLETS[script_type], None
+
+    keys_info = [MULTISIG_OUR_KEY_INFO] + [txmaker.createCosignerKeyInfo(MULTISIG_PATH) for _ in range(n_keys - 1)]
+    wallet = MultisigWallet(
+        name="Benchmark",
+        address_type=MULTISIG_ADDRESS_TYPES[script_type],
+        threshold=threshold,
+        keys_info=keys_info,
+    )
+    return wallet, wallet.id
+
+
+@pytest.fixture
+def counting_cmd(client) -> CountingBitcoinCommand:
+    return CountingBitcoinCommand(client=client, debug=False)
+
+
+@pytest.mark.benchmark
+@pytest.mark.parametrize("script_type,threshold,n_keys,n_inputs,n_outputs", make_cases(),
+                         ids=[case_name(*case) for case in make_cases()])
+@automation("automations/sign_with_wallet_accept.json")
+def test_benchmark_sign_psbt(counting_cmd: CountingBitcoinCommand, benchmark_recorder: BenchmarkRecorder,
+                             speculos_globals, enable_slow_tests: bool, replay_requests_path: Optional[Path],
+                             script_type: str, threshold: int, n_keys: int, n_inputs: int, n_outputs: int):
+    if (n_inputs, n_outputs) in SLOW_SIZES and not enable_slow_tests:
+        pytest.skip("Requires --enableslowtests")
+
+    name = case_name(script_type, threshold, n_keys, n_inputs, n_outputs)
+
+    if replay_requests_path is not None:
+        benchmark_recorder.measure_replay(name, counting_cmd.client, load_transcript(replay_requests_path))
+        return
+
+    # the PSBT (and the cosigners) only depend on the case, so that APDU counts can be compared across runs
+    random.seed(name)
+
+    wallet, wallet_id = make_wallet(script_type, threshold, n_keys)
+    wallet_hmac = None
+    if wallet_id is not None:
+        # the wallet registration key is deterministic, so there is no need to register the wallet
+        wallet_hmac = hmac.new(speculos_globals.wallet_registration_key, wallet_id, sha256).digest()
+
+    # one change output (if there is more than one output), all the other outputs are external
+    change_index = 0 if n_outputs > 1 else -1
+    psbt = txmaker.createPsbt(
+        wallet,
+        [100_000 + 10_000 * i for i in range(n_inputs)],
+        [999 + 99 * i for i in range(n_outputs)],
+        [i == change_index for i in range(n_outputs)]
+    )
+
+    result = benchmark_recorder.measure(name, counting_cmd, counting_cmd.sign_psbt, psbt, wallet, wallet_hmac)
+
+    assert len(result) == n_inputs
+
+
+# Each series of the scaling benchmarks changes one field of SCALING_BASE. The PSBTs are made by psbt_generator, with a
+# 2-of-3 wsh wallet: external outputs pay to all the script types, and each input and output has foreign derivations.
+SCALING_BASE = PsbtSpec(n_inputs=4, n_outputs=4, parent_outputs=4, foreign_keypaths=2)
+SCALING_SERIES = {
+    "inputs": ("n_inputs", [1, 2, 4, 8, 16, 32, 64]),
+    "outputs": ("n_outputs", [1, 2, 4, 16, 64, 256]),
+    "parent_outputs": ("parent_outputs", [1, 16, 128, 1024]),
+}
+SLOW_SCALING_CASES = [("inputs", 64), ("outputs", 256), ("parent_outputs", 1024)]
+
+
+def make_scaling_cases() -> List[Tuple[str, int]]:
+    return [(series, value) for series, (_, values) in SCALING_SERIES.items() for value in values]
+
+
+@pytest.mark.benchmark
+@pytest.mark.parametrize("series,value", make_scaling_cases(),
+                         ids=[f"scaling-{series}-{value}" for series, value in make_scaling_cases()])
+@automation("automations/sign_with_wallet_accept.json")
+def test_benchmark_sign_psbt_scaling(counting_cmd: CountingBitcoinCommand, benchmark_recorder: BenchmarkRecorder,
+                                     speculos_globals, enable_slow_tests: bool, replay_requests_path: Optional[Path],
+                                     series: str, value: int):
+    if (series, value) in SLOW_SCALING_CASES and not enable_slow_tests:
+        pytest.skip("Requires --enableslowtests")
+
+    name = f"scaling-{series}-{value}"
+
+    if replay_requests_path is not None:
+        benchmark_recorder.measure_replay(name, counting_cmd.client, load_transcript(replay_requests_path))
+        return
+
+    field, _ = SCALING_SERIES[series]
+    spec = dataclasses.replace(SCALING_BASE, **{field: value})
+    spec.n_change = min(spec.n_change, spec.n_outputs - 1)  # keep at least one external output
+
+    random.seed(name)  # for the cosigners
+    wallet, wallet_id = make_wallet("wsh", 2, 3)
+    wallet_hmac = hmac.new(speculos_globals.wallet_registration_key, wallet_id, sha256).digest()
+
+    psbt = generate_psbt(wallet, spec, seed=name)
+
+    result = benchmark_recorder.measure(name, counting_cmd, counting_cmd.sign_psbt, psbt, wallet, wallet_hmac)
+
+    assert len(result) == spec.n_inputs
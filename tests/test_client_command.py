@@ -0,0 +1,65 @@
+import random
+
+from bitcoin_client import client_command
+from bitcoin_client.client_command import ClientCommandCode, ClientCommandInterpreter
+from bitcoin_client.merkle import element_hash, get_merkleized_map_commitment
+from bitcoin_client.preimage_store import PreimageStore
+
+# Tests of the known data of ClientCommandInterpreter; they do not use the device.
+
+
+def test_known_trees_are_deduplicated():
+    rnd = random.Random("dedup")
+    interpreter = ClientCommandInterpreter()
+
+    # maps with the same keys: the tree of the keys is only stored once
+    keys = [rnd.randbytes(rnd.randrange(1, 40)) for _ in range(5)]
+    maps = [{key: rnd.randbytes(20) for key in keys} for _ in range(10)]
+    for m in maps:
+        assert interpreter.add_known_mapping(m) == get_merkleized_map_commitment(m)
+    assert len(interpreter.known_trees) == 1 + len(maps)
+
+    elements = [rnd.randbytes(50) for _ in range(40)]
+    tree = interpreter.add_known_list(elements)
+    assert interpreter.add_known_list(list(elements)) is tree
+    assert tree.is_precomputed
+
+    # the equal nodes of different trees are the same object
+    other = interpreter.add_known_list(elements[:32])
+    assert all(a is b for a, b in zip(other.levels[5], tree.levels[5]))
+
+
+def test_small_trees_are_not_precomputed(monkeypatch):
+    rnd = random.Random("small")
+    elements = [rnd.randbytes(rnd.randrange(0, 100)) for _ in range(client_command.PRECOMPUTE_MIN_LEAVES - 1)]
+
+    interpreter = ClientCommandInterpreter()
+    tree = interpreter.add_known_list(elements)
+    assert not tree.is_precomputed
+
+    monkeypatch.setattr(client_command, "PRECOMPUTE_MIN_LEAVES", 0)
+    precomputed_interpreter = ClientCommandInterpreter()
+    assert precomputed_interpreter.add_known_list(elements).is_precomputed
+
+    # the responses are the same
+    for i, element in enumerate(elements):
+        proof_size = len(tree.prove_leaf(i))
+        for request in [
+            bytes([ClientCommandCode.GET_MERKLE_LEAF_PROOF]) + tree.root + bytes([len(elements), i, proof_size]),
+            bytes([ClientCommandCode.GET_MERKLE_LEAF_INDEX]) + tree.root + element_hash(element),
+        ]:
+            assert interpreter.execute(request) == precomputed_interpreter.execute(request)
+            interpreter.reset()
+            precomputed_interpreter.reset()
+
+
+def test_known_preimages_are_not_spilled_twice():
+    store = PreimageStore(spill_size=10)
+    interpreter = ClientCommandInterpreter(store)
+
+    parent = bytes(range(200))
+    interpreter.add_known_mapping({b"\x00": parent, b"\x01": b"a"})
+    interpreter.add_known_mapping({b"\x00": parent, b"\x01": b"b"})
+
+    assert store[element_hash(parent)] == b"\x00" + parent
+    assert store._spill_file_size == 1 + len(parent)
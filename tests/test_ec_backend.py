@@ -0,0 +1,47 @@
+import pytest
+
+from bitcoin_client import secp256k1
+from bitcoin_client.key import ExtendedKey, G, point_mul, point_to_bytes
+
+# The libsecp256k1 backends of bitcoin_client.secp256k1 must give the same results as the pure Python one; these tests
+# do not use the device, and they are skipped for the backends that are not available.
+
+XPUB = "tpubDE7NQymr4AFtewpAsWtnreyq9ghkzQBXpCZjWLFVRAvnbf7vya2eMTvT2fPapNqL8SuVvLQdbUbMfWLVDCZKnsEBqp6UK93QEzL8Ck23AwF"
+
+
+def make_backend(name: str):
+    try:
+        return secp256k1._BACKENDS[name]()
+    except (ImportError, OSError, AttributeError):
+        pytest.skip(f"the {name} backend is not available")
+
+
+@pytest.mark.parametrize("name", ["python", "coincurve", "ctypes"])
+def test_ec_backend(name: str):
+    backend = make_backend(name)
+
+    for k in [1, 2, 3, 0xdeadbeef, secp256k1.n - 1]:
+        privkey = k.to_bytes(32, byteorder="big")
+        assert backend.pubkey_create(privkey) == point_to_bytes(point_mul(G, k))
+
+    pubkey = ExtendedKey.deserialize(XPUB).pubkey
+    reference = secp256k1.PythonBackend()
+    for tweak in [bytes(32), bytes(31) + b"\x01", bytes(range(32))]:
+        assert backend.pubkey_tweak_add(pubkey, tweak) == reference.pubkey_tweak_add(pubkey, tweak)
+
+    for invalid_privkey in [bytes(32), secp256k1.n.to_bytes(32, byteorder="big"), b"\x01"]:
+        with pytest.raises(ValueError):
+            backend.pubkey_create(invalid_privkey)
+
+    # pubkey + (n - 1)*G is the point at infinity for pubkey = G
+    with pytest.raises(ValueError):
+        backend.pubkey_tweak_add(point_to_bytes(G), (secp256k1.n - 1).to_bytes(32, byteorder="big"))
+
+
+def test_derive_pub_batch():
+    xpub = ExtendedKey.deserialize(XPUB)
+    indexes = [0, 1, 2, 100, 2**31 - 1]
+    assert [k.to_string() for k in xpub.derive_pub_batch(indexes)] == [xpub.derive_pub(i).to_string() for i in indexes]
+
+    with pytest.raises(ValueError):
+        xpub.derive_pub_batch([0, 2**31])
@@ -3,9 +3,9 @@ import threading
 import pytest
 
 from bitcoin_client.command import BitcoinCommand
-from bitcoin_client.exception import DenyError, NotSupportedError
+from bitcoin_client.exception import ClaNotSupportedError, DenyError, NotSupportedError
 
-from speculos.client import SpeculosClient
+from speculos.client import ApduException, SpeculosClient
 
 
 def test_get_extended_pubkey_standard_nodisplay(cmd: BitcoinCommand):
@@ -26,6 +26,32 @@ def test_get_extended_pubkey_standard_nodisplay(cmd: BitcoinCommand):
         )
 
 
+def test_get_account_xpubs(cmd: BitcoinCommand):
+    paths = ["m/84'/1'/0'", "m/49'/1'/0'", "m/86'/1'/0'", "m/48'/1'/0'/2'"]
+
+    # twice, as the second time they might be cached
+    for _ in range(2):
+        assert cmd.get_account_xpubs() == [cmd.get_extended_pubkey(path, False) for path in paths]
+
+
+def test_get_extended_pubkeys(cmd: BitcoinCommand):
+    paths = ["m/44'/1'/0'", "m/44'/1'/2'/1/42", "m/84'/1'/2'/0/10", "m/84'/1'/2'/0/11", "m/48'/1'/4'/1'/0/7"]
+
+    assert cmd.get_extended_pubkeys(paths) == [cmd.get_extended_pubkey(path, False) for path in paths]
+
+    # the children of a path, hardened and not
+    assert cmd.get_child_extended_pubkeys("m/84'/1'/2'/0", 8, 4) == [
+        cmd.get_extended_pubkey(f"m/84'/1'/2'/0/{i}", False) for i in range(8, 12)]
+    assert cmd.get_child_extended_pubkeys("m/86'/1'", 0x80000000, 3) == [
+        cmd.get_extended_pubkey(f"m/86'/1'/{i}'", False) for i in range(3)]
+
+    # all the paths must be standard
+    with pytest.raises(NotSupportedError):
+        cmd.get_extended_pubkeys(["m/44'/1'/0'", "m/44'/1'/0"])
+    with pytest.raises(NotSupportedError):
+        cmd.get_child_extended_pubkeys("m/84'/1'/2'", 1, 2)  # change bigger than 1
+
+
 def test_get_extended_pubkey_nonstandard_nodisplay(cmd: BitcoinCommand):
     # as these paths are not standard, the app should reject immediately if display=False
     testcases = [
@@ -143,3 +169,50 @@ def test_get_extended_pubkey_non_standard_reject(client: SpeculosClient, cmd: Bi
         )
 
     x.join()
+
+
+class CountingClient:
+    """Forwards the apdus to the client, counting them; if `fail_sw` is set, the next apdu fails with it instead."""
+
+    def __init__(self, client) -> None:
+        self.client = client
+        self.n_exchanges = 0
+        self.fail_sw = None
+
+    def apdu_exchange(self, cla: int, ins: int, data: bytes = b"", p1: int = 0, p2: int = 0) -> bytes:
+        self.n_exchanges += 1
+        if self.fail_sw is not None:
+            sw, self.fail_sw = self.fail_sw, None
+            raise ApduException(sw=sw, data=b"")
+        return self.client.apdu_exchange(cla=cla, ins=ins, data=data, p1=p1, p2=p2)
+
+
+def test_response_cache(client, cmd: BitcoinCommand):
+    counting_client = CountingClient(client)
+    cached_cmd = BitcoinCommand(client=counting_client, debug=False, response_cache=True)
+
+    paths = ["m/84'/1'/0'", "m/49'/1'/0'", "m/86'/1'/0'", "m/48'/1'/0'/2'"]
+    expected_xpubs = [cmd.get_extended_pubkey(path, False) for path in paths]
+    expected_fpr = cmd.get_master_fingerprint()
+
+    # the fingerprint and the account xpubs are fetched once
+    cached_cmd.warm_response_cache()
+    n_exchanges = counting_client.n_exchanges
+
+    assert cached_cmd.get_master_fingerprint() == expected_fpr
+    assert cached_cmd.get_account_xpubs() == expected_xpubs
+    assert [cached_cmd.get_extended_pubkey(path, False) for path in paths] == expected_xpubs
+    assert cached_cmd.get_extended_pubkeys(paths[1:3]) == expected_xpubs[1:3]
+    assert counting_client.n_exchanges == n_exchanges
+
+    # the children are cached one by one
+    children = cached_cmd.get_child_extended_pubkeys("m/84'/1'/0'/0", 0, 3)
+    assert cached_cmd.get_extended_pubkey("m/84'/1'/0'/0/1", False) == children[1]
+    assert counting_client.n_exchanges == n_exchanges + 1
+
+    # a status word of another app clears the cache
+    counting_client.fail_sw = 0x6E00
+    with pytest.raises(ClaNotSupportedError):
+        cached_cmd.get_extended_pubkey("m/44'/1'/0'", False)
+    assert cached_cmd.get_master_fingerprint() == expected_fpr
+    assert counting_client.n_exchanges == n_exchanges + 3
@@ -2,6 +2,7 @@ from bitcoin_client.exception.errors import IncorrectDataError
 from bitcoin_client.command import BitcoinCommand
 from bitcoin_client.common import AddressType
 from bitcoin_client.wallet import MultisigWallet, PolicyMapWallet
+from bitcoin_client.wallet_registry import WalletRegistry
 
 from .utils import automation
 
@@ -198,3 +199,69 @@ def test_get_wallet_address_multisig_wit(cmd: BitcoinCommand):
 
     res = cmd.get_wallet_address(wallet, wallet_hmac, 0, 0, False)
     assert res == "tb1qmyauyzn08cduzdqweexgna2spwd0rndj55fsrkefry2cpuyt4cpsn2pg28"
+
+
+def test_get_wallet_address_multisig_wit_registry(cmd: BitcoinCommand, tmp_path):
+    # same as test_get_wallet_address_multisig_wit, with the wallet loaded from a registry
+
+    wallet = MultisigWallet(
+        name="Cold storage",
+        address_type=AddressType.WIT,
+        threshold=2,
+        keys_info=[
+            f"[76223a6e/48'/1'/0'/2']tpubDE7NQymr4AFtewpAsWtnreyq9ghkzQBXpCZjWLFVRAvnbf7vya2eMTvT2fPapNqL8SuVvLQdbUbMfWLVDCZKnsEBqp6UK93QEzL8Ck23AwF/**",
+            f"[f5acc2fd/48'/1'/0'/2']tpubDFAqEGNyad35aBCKUAXbQGDjdVhNueno5ZZVEn3sQbW5ci457gLR7HyTmHBg93oourBssgUxuWz1jX5uhc1qaqFo9VsybY1J5FuedLfm4dK/**",
+        ],
+    )
+    wallet_hmac = bytes.fromhex(
+        "d6434852fb3caa7edbd1165084968f1691444b3cfc10cf1e431acbbc7f48451f"
+    )
+
+    with WalletRegistry(tmp_path / "wallets.db") as registry:
+        registry.add(wallet, wallet_hmac)
+
+    with WalletRegistry(tmp_path / "wallets.db") as registry:
+        prepared_wallet, prepared_hmac = registry.get(wallet.id)
+
+    assert prepared_wallet.id == wallet.id
+
+    res = cmd.get_wallet_address(prepared_wallet, prepared_hmac, 0, 0, False)
+    assert res == "tb1qmyauyzn08cduzdqweexgna2spwd0rndj55fsrkefry2cpuyt4cpsn2pg28"
+
+
+def test_get_wallet_address_tr_tapscripts(cmd: BitcoinCommand):
+    # taproot policy with a script path, where @1 can spend with the leaf pk(@1)
+
+    wallet = PolicyMapWallet(
+        name="Tapscripts",
+        policy_map="tr(@0,pk(@1))",
+        keys_info=[
+            f"[76223a6e/48'/1'/0'/2']tpubDE7NQymr4AFtewpAsWtnreyq9ghkzQBXpCZjWLFVRAvnbf7vya2eMTvT2fPapNqL8SuVvLQdbUbMfWLVDCZKnsEBqp6UK93QEzL8Ck23AwF/**",
+            f"[f5acc2fd/48'/1'/0'/2']tpubDFAqEGNyad35aBCKUAXbQGDjdVhNueno5ZZVEn3sQbW5ci457gLR7HyTmHBg93oourBssgUxuWz1jX5uhc1qaqFo9VsybY1J5FuedLfm4dK/**",
+        ],
+    )
+    wallet_hmac = bytes.fromhex(
+        "a33a1315e400c86e25ee80231872101805486c116aeaf173cbfcaf75ff534ae4"
+    )
+
+    res = cmd.get_wallet_address(wallet, wallet_hmac, 0, 0, False)
+    assert res == "tb1pls9pp5cgcljpkjauxep03lv2c2yc2wcuua26p3ks6j2lq0vl9kjqf5rgm2"
+
+
+def test_get_wallet_address_miniscript(cmd: BitcoinCommand):
+    # wsh(and_v(v:thresh(1,pk(@0),s:pk(@1)),older(144))), registered in test_register_wallet_accept_miniscript
+
+    wallet = PolicyMapWallet(
+        name="Vault",
+        policy_map="wsh(and_v(v:thresh(1,pk(@0),s:pk(@1)),older(144)))",
+        keys_info=[
+            f"[76223a6e/48'/1'/0'/2']tpubDE7NQymr4AFtewpAsWtnreyq9ghkzQBXpCZjWLFVRAvnbf7vya2eMTvT2fPapNqL8SuVvLQdbUbMfWLVDCZKnsEBqp6UK93QEzL8Ck23AwF/**",
+            f"[f5acc2fd/48'/1'/0'/2']tpubDFAqEGNyad35aBCKUAXbQGDjdVhNueno5ZZVEn3sQbW5ci457gLR7HyTmHBg93oourBssgUxuWz1jX5uhc1qaqFo9VsybY1J5FuedLfm4dK/**",
+        ],
+    )
+    wallet_hmac = bytes.fromhex(
+        "41c6771f6a94689e7054526d4ee66251bc450d1504202bb0cb6863e732fde0ee"
+    )
+
+    res = cmd.get_wallet_address(wallet, wallet_hmac, 0, 0, False)
+    assert res == "tb1qrhy5mzl4lkj9tc6agf475e2702we6u0pxqx4hkm8t5rllk26l36sfp3r50"
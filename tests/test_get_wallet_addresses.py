@@ -0,0 +1,215 @@
+from bitcoin_client.exception.errors import IncorrectDataError, NotSupportedError
+from bitcoin_client.client_command import ClientCommandInterpreter
+from bitcoin_client.command import BitcoinCommand, add_known_wallet
+from bitcoin_client.common import AddressType
+from bitcoin_client.wallet import MultisigWallet, PolicyMapWallet, WalletAddressIndex
+
+from typing import List
+
+import pytest
+
+from tests.utils import txmaker
+
+
+def test_get_wallet_addresses_singlesig_wit(cmd: BitcoinCommand):
+    wallet = PolicyMapWallet(
+        name="",
+        policy_map="wpkh(@0)",
+        keys_info=[
+            f"[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**",
+        ],
+    )
+
+    res = cmd.get_wallet_addresses(wallet, None, 0, 0, 1)
+    assert res == ["tb1qzdr7s2sr0dwmkwx033r4nujzk86u0cy6fmzfjk"]
+
+    res = cmd.get_wallet_addresses(wallet, None, 1, 10, 8)
+    assert len(res) == 8
+    assert res[5] == "tb1qlrvzyx8jcjfj2xuy69du9trtxnsvjuped7e289"
+    assert res == [cmd.get_wallet_address(wallet, None, 1, i, False) for i in range(10, 18)]
+
+
+def test_get_wallet_addresses_singlesig_taproot(cmd: BitcoinCommand):
+    wallet = PolicyMapWallet(
+        name="",
+        policy_map="tr(@0)",
+        keys_info=[
+            f"[f5acc2fd/86'/1'/0']tpubDDKYE6BREvDsSWMazgHoyQWiJwYaDDYPbCFjYxN3HFXJP5fokeiK4hwK5tTLBNEDBwrDXn8cQ4v9b2xdW62Xr5yxoQdMu1v6c7UDXYVH27U/**",
+        ],
+    )
+
+    res = cmd.get_wallet_addresses(wallet, None, 0, 0, 10)
+    assert res[0] == "tb1pws8wvnj99ca6acf8kq7pjk7vyxknah0d9mexckh5s0vu2ccy68js9am6u7"
+    assert res[9] == "tb1psl7eyk2jyjzq6evqvan854fts7a5j65rth25yqahkd2a765yvj0qggs5ne"
+
+    scripts = cmd.get_wallet_script_pubkeys(wallet, None, 0, 0, 10)
+    assert len(scripts) == 10
+    assert all(len(s) == 34 and s[0:2] == bytes([0x51, 0x20]) for s in scripts)
+
+
+def test_get_wallet_addresses_multisig_wit(cmd: BitcoinCommand):
+    wallet = MultisigWallet(
+        name="Cold storage",
+        address_type=AddressType.WIT,
+        threshold=2,
+        keys_info=[
+            f"[76223a6e/48'/1'/0'/2']tpubDE7NQymr4AFtewpAsWtnreyq9ghkzQBXpCZjWLFVRAvnbf7vya2eMTvT2fPapNqL8SuVvLQdbUbMfWLVDCZKnsEBqp6UK93QEzL8Ck23AwF/**",
+            f"[f5acc2fd/48'/1'/0'/2']tpubDFAqEGNyad35aBCKUAXbQGDjdVhNueno5ZZVEn3sQbW5ci457gLR7HyTmHBg93oourBssgUxuWz1jX5uhc1qaqFo9VsybY1J5FuedLfm4dK/**",
+        ],
+    )
+    wallet_hmac = bytes.fromhex(
+        "d6434852fb3caa7edbd1165084968f1691444b3cfc10cf1e431acbbc7f48451f"
+    )
+
+    res = cmd.get_wallet_addresses(wallet, wallet_hmac, 0, 0, 20)
+    assert res[0] == "tb1qmyauyzn08cduzdqweexgna2spwd0rndj55fsrkefry2cpuyt4cpsn2pg28"
+    assert len(set(res)) == 20
+
+    scripts = cmd.get_wallet_script_pubkeys(wallet, wallet_hmac, 1, 0, 3)
+    assert all(len(s) == 34 and s[0:2] == bytes([0x00, 0x20]) for s in scripts)
+
+
+def test_get_wallet_addresses_fail(cmd: BitcoinCommand):
+    wallet = PolicyMapWallet(
+        name="",
+        policy_map="pkh(@0)",
+        keys_info=[
+            f"[f5acc2fd/44'/1'/0']tpubDCwYjpDhUdPGP5rS3wgNg13mTrrjBuG8V9VpWbyptX6TRPbNoZVXsoVUSkCjmQ8jJycjuDKBb9eataSymXakTTaGifxR6kmVsfFehH1ZgJT/**",
+        ],
+    )
+
+    # for default wallets, all the address indexes must be standard
+    with pytest.raises(IncorrectDataError):
+        cmd.get_wallet_addresses(wallet, None, 0, 49990, 20)
+
+    # the range must be non-empty
+    with pytest.raises(ValueError):
+        cmd.get_wallet_addresses(wallet, None, 0, 0, 0)
+
+
+def test_get_wallet_addresses_batch(cmd: BitcoinCommand):
+    wallet_wit = PolicyMapWallet(
+        name="",
+        policy_map="wpkh(@0)",
+        keys_info=[
+            f"[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**",
+        ],
+    )
+    wallet_tr = PolicyMapWallet(
+        name="",
+        policy_map="tr(@0)",
+        keys_info=[
+            f"[f5acc2fd/86'/1'/0']tpubDDKYE6BREvDsSWMazgHoyQWiJwYaDDYPbCFjYxN3HFXJP5fokeiK4hwK5tTLBNEDBwrDXn8cQ4v9b2xdW62Xr5yxoQdMu1v6c7UDXYVH27U/**",
+        ],
+    )
+    wallet_multisig = MultisigWallet(
+        name="Cold storage",
+        address_type=AddressType.WIT,
+        threshold=2,
+        keys_info=[
+            f"[76223a6e/48'/1'/0'/2']tpubDE7NQymr4AFtewpAsWtnreyq9ghkzQBXpCZjWLFVRAvnbf7vya2eMTvT2fPapNqL8SuVvLQdbUbMfWLVDCZKnsEBqp6UK93QEzL8Ck23AwF/**",
+            f"[f5acc2fd/48'/1'/0'/2']tpubDFAqEGNyad35aBCKUAXbQGDjdVhNueno5ZZVEn3sQbW5ci457gLR7HyTmHBg93oourBssgUxuWz1jX5uhc1qaqFo9VsybY1J5FuedLfm4dK/**",
+        ],
+    )
+    wallet_hmac = bytes.fromhex(
+        "d6434852fb3caa7edbd1165084968f1691444b3cfc10cf1e431acbbc7f48451f"
+    )
+
+    requests = [
+        (wallet_wit, None, 0, 0),
+        (wallet_tr, None, 0, 0),
+        (wallet_multisig, wallet_hmac, 0, 0),
+        (wallet_tr, None, 0, 9),
+        (wallet_wit, None, 1, 15),
+    ]
+    res = cmd.get_wallet_addresses_batch(requests)
+    assert res == [
+        "tb1qzdr7s2sr0dwmkwx033r4nujzk86u0cy6fmzfjk",
+        "tb1pws8wvnj99ca6acf8kq7pjk7vyxknah0d9mexckh5s0vu2ccy68js9am6u7",
+        "tb1qmyauyzn08cduzdqweexgna2spwd0rndj55fsrkefry2cpuyt4cpsn2pg28",
+        "tb1psl7eyk2jyjzq6evqvan854fts7a5j65rth25yqahkd2a765yvj0qggs5ne",
+        "tb1qlrvzyx8jcjfj2xuy69du9trtxnsvjuped7e289",
+    ]
+
+    # the same addresses, with one command per batch
+    assert cmd.get_wallet_addresses_batch(requests, max_batch_len=80) == res
+
+
+def test_get_wallet_addresses_batch_fail(cmd: BitcoinCommand):
+    wallet = PolicyMapWallet(
+        name="",
+        policy_map="wpkh(@0)",
+        keys_info=[
+            f"[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**",
+        ],
+    )
+
+    client_intepreter = ClientCommandInterpreter()
+    add_known_wallet(client_intepreter, wallet)
+
+    # a failing command does not stop the batch, and nothing can be shown on screen
+    results = cmd._run_flow(cmd._batch_flow([
+        cmd.builder.get_wallet_address(wallet, None, 0, 0, True),
+        cmd.builder.get_master_fingerprint(),
+        cmd.builder.get_wallet_address(wallet, None, 0, 0, False),
+    ], client_intepreter))
+    assert results == [
+        (0x6A80, b""),
+        (0x9000, cmd.get_master_fingerprint()),
+        (0x9000, b"tb1qzdr7s2sr0dwmkwx033r4nujzk86u0cy6fmzfjk"),
+    ]
+
+    # commands that can require user interaction can not be batched
+    with pytest.raises(NotSupportedError):
+        cmd._run_flow(cmd._batch_flow([
+            cmd.builder.get_master_fingerprint(),
+            cmd.builder.register_wallet(wallet),
+        ], client_intepreter))
+
+
+def test_get_wallet_addresses_host_index(cmd: BitcoinCommand):
+    # the scriptPubKeys returned by the device are the ones derived on the host
+    wallet = MultisigWallet(
+        name="Cold storage",
+        address_type=AddressType.WIT,
+        threshold=2,
+        keys_info=[
+            f"[76223a6e/48'/1'/0'/2']tpubDE7NQymr4AFtewpAsWtnreyq9ghkzQBXpCZjWLFVRAvnbf7vya2eMTvT2fPapNqL8SuVvLQdbUbMfWLVDCZKnsEBqp6UK93QEzL8Ck23AwF/**",
+            f"[f5acc2fd/48'/1'/0'/2']tpubDFAqEGNyad35aBCKUAXbQGDjdVhNueno5ZZVEn3sQbW5ci457gLR7HyTmHBg93oourBssgUxuWz1jX5uhc1qaqFo9VsybY1J5FuedLfm4dK/**",
+        ],
+    )
+    wallet_hmac = bytes.fromhex(
+        "d6434852fb3caa7edbd1165084968f1691444b3cfc10cf1e431acbbc7f48451f"
+    )
+
+    index = WalletAddressIndex(wallet)
+    for change in [0, 1]:
+        scripts = cmd.get_wallet_script_pubkeys(wallet, wallet_hmac, change, 5, 10)
+        assert scripts == index.script_pubkeys(change == 1, 5, 10)
+        assert index.find(scripts[3]) == (change == 1, 8)
+
+
+@pytest.mark.parametrize("policy_map,keys_info", [
+    ("pkh(@0)", ["[f5acc2fd/44'/1'/0']tpubDCwYjpDhUdPGP5rS3wgNg13mTrrjBuG8V9VpWbyptX6TRPbNoZVXsoVUSkCjmQ8jJycjuDKBb9eataSymXakTTaGifxR6kmVsfFehH1ZgJT/**"]),
+    ("wpkh(@0)", ["[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"]),
+    ("tr(@0)", ["[f5acc2fd/86'/1'/0']tpubDDKYE6BREvDsSWMazgHoyQWiJwYaDDYPbCFjYxN3HFXJP5fokeiK4hwK5tTLBNEDBwrDXn8cQ4v9b2xdW62Xr5yxoQdMu1v6c7UDXYVH27U/**"]),
+    ("sh(wsh(sortedmulti(2,@0,@1)))", [
+        "[76223a6e/48'/1'/0'/1']tpubDE7NQymr4AFtcJXi9TaWZtrhAdy8QyKmT4U6b9qYByAxCzoyMJ8zw5d8xVLVpbTRAEqP8pVUxjLE2vDt1rSFjaiS8DSz1QcNZ8D1qxUMx1g/**",
+        "[f5acc2fd/48'/1'/0'/1']tpubDFAqEGNyad35YgH8zxvxFZqNUoPtr5mDojs7wzbXQBHTZ4xHeVXG6w2HvsKvjBpaRpTmjYDjdPg5w2c6Wvu8QBkyMDrmBWdCyqkDM7reSsY/**",
+    ]),
+])
+def test_wallet_address_index(policy_map: str, keys_info: List[str]):
+    # does not use the device
+    wallet = PolicyMapWallet(name="", policy_map=policy_map, keys_info=keys_info)
+    index = WalletAddressIndex(wallet)
+
+    # a range overlapping the ones already derived gives the same scriptPubKeys as the single derivations
+    first = index.script_pubkeys(False, 0, 4)
+    scripts = index.script_pubkeys(False, 2, 6)
+    assert scripts[:2] == first[2:]
+    for i, script in enumerate(scripts):
+        assert script == txmaker.getScriptPubkeyFromWallet(wallet, False, 2 + i).data
+        assert index.find(script) == (False, 2 + i)
+
+    assert index.script_pubkey(True, 3) == txmaker.getScriptPubkeyFromWallet(wallet, True, 3).data
+    assert index.find(b"\x00\x14" + bytes(20)) is None
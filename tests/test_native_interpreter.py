@@ -0,0 +1,134 @@
+import random
+
+from hashlib import sha256
+from typing import List
+
+import pytest
+
+from bitcoin_client import native
+from bitcoin_client.client_command import (ClientCommandCode, ClientCommandInterpreter, get_preimage_request,
+                                           get_preimages_request)
+from bitcoin_client.command import add_known_wallet
+from bitcoin_client.common import write_varint
+from bitcoin_client.merkle import MerkleTree, element_hash, get_merkleized_map_commitment
+from bitcoin_client.wallet import AddressType, MultisigWallet
+
+# The native interpreter of host-lib/ must give the same responses as ClientCommandInterpreter; these tests do not use
+# the device, and they are skipped if the library is not built (see host-lib/README.md).
+pytestmark = pytest.mark.skipif(not native.is_available(), reason="host-lib is not built")
+
+
+def run_both(python_interpreter: ClientCommandInterpreter, native_interpreter: native.NativeClientCommandInterpreter,
+             request: bytes) -> bytes:
+    """Executes the request with both interpreters, followed by the GET_MORE_ELEMENTS requests that empty the queue;
+    the responses must be the same. Returns the response to the request."""
+    get_more_elements = bytes([ClientCommandCode.GET_MORE_ELEMENTS])
+
+    expected = [python_interpreter.execute(request)]
+    while len(python_interpreter.queue) > 0:
+        expected.append(python_interpreter.execute(get_more_elements))
+
+    actual = [native_interpreter.execute(request)] + [native_interpreter.execute(get_more_elements)
+                                                      for _ in expected[1:]]
+    assert actual == expected
+
+    # the queue of the native interpreter is empty too
+    with pytest.raises(RuntimeError):
+        native_interpreter.execute(get_more_elements)
+
+    return expected[0]
+
+
+def make_elements(n: int, rnd: random.Random) -> List[bytes]:
+    return [rnd.randbytes(rnd.randrange(0, 400)) for _ in range(n)]
+
+
+@pytest.mark.parametrize("n_elements", [1, 2, 3, 7, 8, 9, 33, 100])
+def test_native_merkle_requests(n_elements: int):
+    rnd = random.Random(n_elements)
+    elements = make_elements(n_elements, rnd)
+
+    python_interpreter = ClientCommandInterpreter()
+    native_interpreter = native.NativeClientCommandInterpreter()
+    tree: MerkleTree = python_interpreter.add_known_list(elements)
+    root = native_interpreter.add_known_list(elements)
+    assert root == tree.root
+
+    for index in range(n_elements):
+        leaf = element_hash(elements[index])
+
+        # the whole proof, and only its first element
+        for proof_size in {len(tree.prove_leaf(index)), min(1, len(tree.prove_leaf(index)))}:
+            request = b"".join([bytes([ClientCommandCode.GET_MERKLE_LEAF_PROOF]), root, write_varint(n_elements),
+                                write_varint(index), bytes([proof_size])])
+            run_both(python_interpreter, native_interpreter, request)
+            assert native_interpreter.get_prefetched_responses(request, 200) == \
+                python_interpreter.get_prefetched_responses(request, 200)
+
+        run_both(python_interpreter, native_interpreter,
+                 bytes([ClientCommandCode.GET_MERKLE_LEAF_INDEX]) + root + leaf)
+        run_both(python_interpreter, native_interpreter, get_preimage_request(leaf))
+
+    for n_leaves in [1, 2, 4, 8, 64]:
+        for first_index in range(0, n_elements, n_leaves):
+            request = b"".join([bytes([ClientCommandCode.GET_MERKLE_LEAVES_PROOF]), root, write_varint(n_elements),
+                                write_varint(first_index), write_varint(n_leaves)])
+            run_both(python_interpreter, native_interpreter, request)
+            assert native_interpreter.get_prefetched_responses(request, 254) == \
+                python_interpreter.get_prefetched_responses(request, 254)
+
+    # a BATCH of the preimages of the first leaves
+    requests = [get_preimage_request(element_hash(el)) for el in elements[:16]]
+    batch = bytes([ClientCommandCode.BATCH, len(requests)]) + b"".join(bytes([len(r)]) + r for r in requests)
+    run_both(python_interpreter, native_interpreter, batch)
+
+    # the preimages of the first leaves, with a single GET_PREIMAGES
+    run_both(python_interpreter, native_interpreter,
+             get_preimages_request([element_hash(el) for el in elements[:4]]))
+
+    # a leaf that is not in the tree
+    run_both(python_interpreter, native_interpreter,
+             bytes([ClientCommandCode.GET_MERKLE_LEAF_INDEX]) + root + bytes(32))
+
+
+def test_native_merkleized_map():
+    rnd = random.Random("map")
+    mapping = {rnd.randbytes(rnd.randrange(1, 40)): rnd.randbytes(rnd.randrange(0, 600)) for _ in range(30)}
+
+    python_interpreter = ClientCommandInterpreter()
+    native_interpreter = native.NativeClientCommandInterpreter()
+    assert python_interpreter.add_known_mapping(mapping) == get_merkleized_map_commitment(mapping)
+    commitment = native_interpreter.add_known_mapping(mapping)
+    assert commitment == get_merkleized_map_commitment(mapping)
+
+    roots = commitment[1:]
+    for key in list(mapping.keys()) + [b"missing"]:
+        run_both(python_interpreter, native_interpreter, b"".join([
+            bytes([ClientCommandCode.GET_MERKLEIZED_MAP_VALUE]), roots, write_varint(len(mapping)), element_hash(key)
+        ]))
+
+
+def test_native_wallet_and_yield():
+    wallet = MultisigWallet(
+        name="Cold storage",
+        address_type=AddressType.WIT,
+        threshold=2,
+        keys_info=[
+            "[76223a6e/48'/1'/0'/2']tpubDE7NQymr4AFtewpAsWtnreyq9ghkzQBXpCZjWLFVRAvnbf7vya2eMTvT2fPapNqL8SuVvLQdbUbMfWLVDCZKnsEBqp6UK93QEzL8Ck23AwF/**",
+            "[f5acc2fd/48'/1'/0'/2']tpubDFAqEGNyad35aBCKUAXbQGDjdVhNueno5ZZVEn3sQbW5ci457gLR7HyTmHBg93oourBssgUxuWz1jX5uhc1qaqFo9VsybY1J5FuedLfm4dK/**",
+        ],
+    )
+
+    python_interpreter = ClientCommandInterpreter()
+    native_interpreter = native.NativeClientCommandInterpreter()
+    add_known_wallet(python_interpreter, wallet)
+    native_interpreter.add_known_wallet(wallet)
+
+    assert run_both(python_interpreter, native_interpreter, get_preimage_request(sha256(wallet.serialize()).digest()))
+
+    for value in [b"", b"\x01" * 100]:
+        run_both(python_interpreter, native_interpreter, bytes([ClientCommandCode.YIELD]) + value)
+    assert native_interpreter.yielded == python_interpreter.yielded
+
+    native_interpreter.reset()
+    assert native_interpreter.yielded == []
@@ -0,0 +1,149 @@
+from typing import List, Tuple
+
+import pytest
+
+from bitcoin_client.command import BitcoinCommand
+from bitcoin_client.command_builder import BitcoinInsType
+from bitcoin_client.persistent_transport import PersistentHIDClient
+
+# These tests do not use the device: the transport is a fake device that answers GET_MASTER_FINGERPRINT and
+# GET_EXTENDED_PUBKEY, and that can be disconnected, or replaced by another device, between two exchanges.
+
+XPUB = "tpubDCwYjpDhUdPGP5rS3wgNg13mTrrjBuG8V9VpWbyptX6TRPbNoZVXsoVUSkCjmQ8jJycjuDKBb9eataSymXakTTaGifxR6kmVsfFehH1ZgJT"
+
+
+class FakeDevice:
+    def __init__(self, fingerprint: bytes) -> None:
+        self.fingerprint = fingerprint
+        self.connected = True
+        self.n_apdus = 0
+        self.instructions: List[int] = []
+
+
+class FakeTransport:
+    def __init__(self, device: FakeDevice) -> None:
+        self.device = device
+        self.stale = False  # the device was re-enumerated since the transport was opened
+
+    def exchange(self, cla: int, ins: int, p1: int = 0, p2: int = 0, option=None, cdata: bytes = b"") -> Tuple[int, bytes]:
+        if self.stale or not self.device.connected:
+            raise OSError("read error")
+        self.device.n_apdus += 1
+        self.device.instructions.append(ins)
+        if ins == BitcoinInsType.GET_MASTER_FINGERPRINT:
+            return 0x9000, self.device.fingerprint
+        if ins == BitcoinInsType.GET_EXTENDED_PUBKEY:
+            return 0x9000, XPUB.encode()
+        return 0x6D00, b""
+
+    def close(self) -> None:
+        pass
+
+
+class FakeHost:
+    """Plays the role of the USB enumeration: opening returns a transport to the device that is plugged in."""
+
+    def __init__(self, device: FakeDevice) -> None:
+        self.device = device
+        self.transports: List[FakeTransport] = []
+        self.n_failed_opens = 0
+
+    def open(self) -> FakeTransport:
+        if not self.device.connected:
+            self.n_failed_opens += 1
+            raise OSError("no device")
+        self.transports.append(FakeTransport(self.device))
+        return self.transports[-1]
+
+
+def make_client(host: FakeHost, **kwargs) -> PersistentHIDClient:
+    return PersistentHIDClient(transport_factory=host.open, open_delay=0, **kwargs)
+
+
+def test_persistent_transport_reopens_after_disconnection():
+    device = FakeDevice(bytes.fromhex("f5acc2fd"))
+    host = FakeHost(device)
+    client = make_client(host)
+
+    cmd = BitcoinCommand(client, response_cache=True)
+    assert cmd.get_master_fingerprint() == device.fingerprint
+    assert client.n_opens == 1 and client.fingerprint == device.fingerprint
+    generation = client.identity_generation
+
+    # the failed exchange is not retried, and the transport is closed
+    device.connected = False
+    with pytest.raises(OSError):
+        client.apdu_exchange(0xE1, BitcoinInsType.GET_EXTENDED_PUBKEY)
+    assert not client.is_open
+
+    # the next exchange re-opens the transport; the device is the same, so the caches are still valid
+    device.connected = True
+    assert cmd.get_extended_pubkey("m/84'/1'/0'") == XPUB
+    assert client.n_opens == 2
+    assert client.identity_generation == generation
+
+    n_apdus = device.n_apdus
+    assert cmd.get_master_fingerprint() == device.fingerprint
+    assert cmd.get_extended_pubkey("m/84'/1'/0'") == XPUB
+    assert device.n_apdus == n_apdus
+
+
+def test_persistent_transport_detects_another_device():
+    device = FakeDevice(bytes.fromhex("f5acc2fd"))
+    host = FakeHost(device)
+    client = make_client(host)
+
+    cmd = BitcoinCommand(client, response_cache=True)
+    assert cmd.get_extended_pubkey("m/84'/1'/0'") == XPUB
+    generation = client.identity_generation
+
+    client.close()
+    host.device = other = FakeDevice(bytes.fromhex("0badcafe"))
+
+    # the first exchange after the reconnection finds another fingerprint, and the cache is cleared
+    assert cmd.get_extended_pubkey("m/84'/1'/1'") == XPUB
+    assert client.identity_generation == generation + 1
+
+    assert cmd.get_master_fingerprint() == other.fingerprint
+    assert other.instructions.count(BitcoinInsType.GET_MASTER_FINGERPRINT) == 2  # by the client, then by the command
+
+
+def test_persistent_transport_open_attempts():
+    device = FakeDevice(bytes.fromhex("f5acc2fd"))
+    device.connected = False
+    host = FakeHost(device)
+    client = make_client(host, open_attempts=3)
+
+    with pytest.raises(OSError):
+        client.open()
+    assert host.n_failed_opens == 3
+    assert not client.is_open
+
+
+def test_persistent_transport_health_check():
+    device = FakeDevice(bytes.fromhex("f5acc2fd"))
+    host = FakeHost(device)
+    client = make_client(host, health_check_interval=0)
+
+    client.apdu_exchange(0xE1, BitcoinInsType.GET_EXTENDED_PUBKEY)
+    # with an interval of 0, each exchange after the first one is preceded by a health check
+    client.apdu_exchange(0xE1, BitcoinInsType.GET_EXTENDED_PUBKEY)
+    assert device.instructions == [
+        BitcoinInsType.GET_MASTER_FINGERPRINT,
+        BitcoinInsType.GET_EXTENDED_PUBKEY,
+        BitcoinInsType.GET_MASTER_FINGERPRINT,
+        BitcoinInsType.GET_EXTENDED_PUBKEY,
+    ]
+
+    # the device was re-enumerated while the transport was idle: the health check re-opens it, and the exchange
+    # does not fail
+    host.transports[-1].stale = True
+    assert client.apdu_exchange(0xE1, BitcoinInsType.GET_EXTENDED_PUBKEY) == XPUB.encode()
+    assert client.n_opens == 2
+
+
+def test_persistent_transport_shared():
+    a = PersistentHIDClient.shared("test-shared", transport_factory=FakeHost(FakeDevice(b"\0\0\0\0")).open)
+    b = PersistentHIDClient.shared("test-shared")
+    assert a is b
+    assert PersistentHIDClient.shared("test-shared-2", transport_factory=a.transport_factory) is not a
@@ -1,7 +1,7 @@
 from bitcoin_client.exception.errors import IncorrectDataError, NotSupportedError
 from bitcoin_client.command import BitcoinCommand
 from bitcoin_client.common import AddressType
-from bitcoin_client.exception import DenyError
+from bitcoin_client.exception import DenyError, SignatureFailError
 from bitcoin_client.wallet import MultisigWallet, PolicyMapWallet
 
 from .utils import automation
@@ -78,6 +78,178 @@ def test_register_wallet_accept_wit(cmd: BitcoinCommand, speculos_globals):
     )
 
 
+@automation("automations/register_wallet_accept.json")
+def test_register_wallet_accept_wit_binary_keys(cmd: BitcoinCommand, speculos_globals):
+    # same screens as for the keys information in the string format, but a different wallet id
+    wallet = MultisigWallet(
+        name="Cold storage",
+        address_type=AddressType.WIT,
+        threshold=2,
+        keys_info=[
+            f"[76223a6e/48'/1'/0'/2']tpubDE7NQymr4AFtewpAsWtnreyq9ghkzQBXpCZjWLFVRAvnbf7vya2eMTvT2fPapNqL8SuVvLQdbUbMfWLVDCZKnsEBqp6UK93QEzL8Ck23AwF/**",
+            f"[f5acc2fd/48'/1'/0'/2']tpubDFAqEGNyad35aBCKUAXbQGDjdVhNueno5ZZVEn3sQbW5ci457gLR7HyTmHBg93oourBssgUxuWz1jX5uhc1qaqFo9VsybY1J5FuedLfm4dK/**",
+        ],
+        binary_keys=True,
+    )
+
+    wallet_id, wallet_hmac = cmd.register_wallet(wallet)
+
+    assert wallet_id == wallet.id
+
+    assert hmac.compare_digest(
+        hmac.new(speculos_globals.wallet_registration_key, wallet_id, sha256).digest(),
+        wallet_hmac,
+    )
+
+
+@automation("automations/register_wallet_accept.json")
+def test_register_wallet_accept_tr_tapscripts(cmd: BitcoinCommand, speculos_globals):
+    # the internal key is not ours; our key is in the tapscript
+    wallet = PolicyMapWallet(
+        name="Tapscripts",
+        policy_map="tr(@0,pk(@1))",
+        keys_info=[
+            f"[76223a6e/48'/1'/0'/2']tpubDE7NQymr4AFtewpAsWtnreyq9ghkzQBXpCZjWLFVRAvnbf7vya2eMTvT2fPapNqL8SuVvLQdbUbMfWLVDCZKnsEBqp6UK93QEzL8Ck23AwF/**",
+            f"[f5acc2fd/48'/1'/0'/2']tpubDFAqEGNyad35aBCKUAXbQGDjdVhNueno5ZZVEn3sQbW5ci457gLR7HyTmHBg93oourBssgUxuWz1jX5uhc1qaqFo9VsybY1J5FuedLfm4dK/**",
+        ],
+    )
+
+    wallet_id, wallet_hmac = cmd.register_wallet(wallet)
+
+    assert wallet_id == wallet.id
+
+    assert hmac.compare_digest(
+        hmac.new(speculos_globals.wallet_registration_key, wallet_id, sha256).digest(),
+        wallet_hmac,
+    )
+
+
+@automation("automations/register_wallet_accept.json")
+def test_register_wallet_accept_miniscript(cmd: BitcoinCommand, speculos_globals):
+    # vault: either key can spend, after a relative timelock of 144 blocks
+    wallet = PolicyMapWallet(
+        name="Vault",
+        policy_map="wsh(and_v(v:thresh(1,pk(@0),s:pk(@1)),older(144)))",
+        keys_info=[
+            f"[76223a6e/48'/1'/0'/2']tpubDE7NQymr4AFtewpAsWtnreyq9ghkzQBXpCZjWLFVRAvnbf7vya2eMTvT2fPapNqL8SuVvLQdbUbMfWLVDCZKnsEBqp6UK93QEzL8Ck23AwF/**",
+            f"[f5acc2fd/48'/1'/0'/2']tpubDFAqEGNyad35aBCKUAXbQGDjdVhNueno5ZZVEn3sQbW5ci457gLR7HyTmHBg93oourBssgUxuWz1jX5uhc1qaqFo9VsybY1J5FuedLfm4dK/**",
+        ],
+    )
+
+    wallet_id, wallet_hmac = cmd.register_wallet(wallet)
+
+    assert wallet_id == wallet.id
+
+    assert hmac.compare_digest(
+        hmac.new(speculos_globals.wallet_registration_key, wallet_id, sha256).digest(),
+        wallet_hmac,
+    )
+
+
+@automation("automations/register_wallet_accept.json")
+def test_register_wallet_accept_compiled(cmd: BitcoinCommand, speculos_globals):
+    wallet = MultisigWallet(
+        name="Cold storage",
+        address_type=AddressType.WIT,
+        threshold=2,
+        keys_info=[
+            f"[76223a6e/48'/1'/0'/2']tpubDE7NQymr4AFtewpAsWtnreyq9ghkzQBXpCZjWLFVRAvnbf7vya2eMTvT2fPapNqL8SuVvLQdbUbMfWLVDCZKnsEBqp6UK93QEzL8Ck23AwF/**",
+            f"[f5acc2fd/48'/1'/0'/2']tpubDFAqEGNyad35aBCKUAXbQGDjdVhNueno5ZZVEn3sQbW5ci457gLR7HyTmHBg93oourBssgUxuWz1jX5uhc1qaqFo9VsybY1J5FuedLfm4dK/**",
+        ],
+    )
+
+    wallet_id, wallet_hmac, compiled_policy, compiled_policy_hmac = cmd.register_wallet_compiled(wallet)
+
+    assert wallet_id == wallet.id
+    assert compiled_policy[0] == 0x01  # version
+    assert compiled_policy[1:33] == wallet_id
+
+    assert hmac.compare_digest(
+        hmac.new(speculos_globals.wallet_registration_key, wallet_id, sha256).digest(),
+        wallet_hmac,
+    )
+    assert hmac.compare_digest(
+        hmac.new(speculos_globals.wallet_registration_key,
+                 b"compiled policy" + sha256(compiled_policy).digest(), sha256).digest(),
+        compiled_policy_hmac,
+    )
+
+    # the compiled form gives the same addresses as the wallet policy
+    assert cmd.get_wallet_address(wallet, wallet_hmac, 0, 0, False,
+                                  compiled_policy=(compiled_policy, compiled_policy_hmac)) == \
+        cmd.get_wallet_address(wallet, wallet_hmac, 0, 0, False)
+    assert cmd.get_wallet_addresses(wallet, wallet_hmac, 1, 3, 2,
+                                    compiled_policy=(compiled_policy, compiled_policy_hmac)) == \
+        cmd.get_wallet_addresses(wallet, wallet_hmac, 1, 3, 2)
+
+    # a compiled form with a wrong hmac is rejected
+    with pytest.raises(SignatureFailError):
+        cmd.get_wallet_address(wallet, wallet_hmac, 0, 0, False,
+                               compiled_policy=(compiled_policy, bytes(32)))
+
+
+@automation("automations/register_wallet_accept.json")
+def test_register_wallets_accept(cmd: BitcoinCommand, speculos_globals):
+    wallets = [
+        MultisigWallet(
+            name="Cold storage",
+            address_type=AddressType.WIT,
+            threshold=2,
+            keys_info=[
+                f"[76223a6e/48'/1'/0'/2']tpubDE7NQymr4AFtewpAsWtnreyq9ghkzQBXpCZjWLFVRAvnbf7vya2eMTvT2fPapNqL8SuVvLQdbUbMfWLVDCZKnsEBqp6UK93QEzL8Ck23AwF/**",
+                f"[f5acc2fd/48'/1'/0'/2']tpubDFAqEGNyad35aBCKUAXbQGDjdVhNueno5ZZVEn3sQbW5ci457gLR7HyTmHBg93oourBssgUxuWz1jX5uhc1qaqFo9VsybY1J5FuedLfm4dK/**",
+            ],
+        ),
+        MultisigWallet(
+            name="Cold storage",
+            address_type=AddressType.SH_WIT,
+            threshold=2,
+            keys_info=[
+                f"[76223a6e/48'/1'/0'/1']tpubDE7NQymr4AFtcJXi9TaWZtrhAdy8QyKmT4U6b9qYByAxCzoyMJ8zw5d8xVLVpbTRAEqP8pVUxjLE2vDt1rSFjaiS8DSz1QcNZ8D1qxUMx1g/**",
+                f"[f5acc2fd/48'/1'/0'/1']tpubDFAqEGNyad35YgH8zxvxFZqNUoPtr5mDojs7wzbXQBHTZ4xHeVXG6w2HvsKvjBpaRpTmjYDjdPg5w2c6Wvu8QBkyMDrmBWdCyqkDM7reSsY/**",
+            ],
+        ),
+        PolicyMapWallet(
+            name="Vault",
+            policy_map="wsh(and_v(v:thresh(1,pk(@0),s:pk(@1)),older(144)))",
+            keys_info=[
+                f"[76223a6e/48'/1'/0'/2']tpubDE7NQymr4AFtewpAsWtnreyq9ghkzQBXpCZjWLFVRAvnbf7vya2eMTvT2fPapNqL8SuVvLQdbUbMfWLVDCZKnsEBqp6UK93QEzL8Ck23AwF/**",
+                f"[f5acc2fd/48'/1'/0'/2']tpubDFAqEGNyad35aBCKUAXbQGDjdVhNueno5ZZVEn3sQbW5ci457gLR7HyTmHBg93oourBssgUxuWz1jX5uhc1qaqFo9VsybY1J5FuedLfm4dK/**",
+            ],
+        ),
+    ]
+
+    results = cmd.register_wallets(wallets)
+
+    assert len(results) == len(wallets)
+    for wallet, (wallet_id, wallet_hmac) in zip(wallets, results):
+        assert wallet_id == wallet.id
+
+        assert hmac.compare_digest(
+            hmac.new(speculos_globals.wallet_registration_key, wallet_id, sha256).digest(),
+            wallet_hmac,
+        )
+
+        # the same hmac as a wallet registered alone
+        assert cmd.register_wallet(wallet) == (wallet_id, wallet_hmac)
+
+
+@automation("automations/register_wallet_reject.json")
+def test_register_wallets_reject(cmd: BitcoinCommand):
+    wallet = MultisigWallet(
+        name="Cold storage",
+        address_type=AddressType.WIT,
+        threshold=2,
+        keys_info=[
+            f"[76223a6e/48'/1'/0'/2']tpubDE7NQymr4AFtewpAsWtnreyq9ghkzQBXpCZjWLFVRAvnbf7vya2eMTvT2fPapNqL8SuVvLQdbUbMfWLVDCZKnsEBqp6UK93QEzL8Ck23AwF/**",
+            f"[f5acc2fd/48'/1'/0'/2']tpubDFAqEGNyad35aBCKUAXbQGDjdVhNueno5ZZVEn3sQbW5ci457gLR7HyTmHBg93oourBssgUxuWz1jX5uhc1qaqFo9VsybY1J5FuedLfm4dK/**",
+        ],
+    )
+
+    with pytest.raises(DenyError):
+        cmd.register_wallets([wallet, wallet])
+
+
 @automation("automations/register_wallet_reject.json")
 def test_register_wallet_reject_header(cmd):
     wallet = MultisigWallet(
@@ -0,0 +1,52 @@
+import base64
+from hashlib import sha256
+
+from ecdsa import SECP256k1, VerifyingKey
+from ecdsa.util import sigdecode_string
+
+from bitcoin_client import base58
+from bitcoin_client.command import BitcoinCommand
+from bitcoin_client.common import write_varint
+from bitcoin_client.exception import DenyError
+
+import pytest
+
+from .utils import automation
+
+
+def message_digest(message: bytes) -> bytes:
+    prefixed = b"\x18Bitcoin Signed Message:\n" + write_varint(len(message)) + message
+    return sha256(sha256(prefixed).digest()).digest()
+
+
+def check_signature(cmd: BitcoinCommand, message: bytes, path: str, signature: str) -> None:
+    sig = base64.b64decode(signature)
+    assert len(sig) == 65
+    assert sig[0] in (31, 32)  # compressed pubkey, with the parity of R
+
+    xpub = base58.decode(cmd.get_extended_pubkey(path, False))
+    pubkey = VerifyingKey.from_string(xpub[45:78], curve=SECP256k1)
+    assert pubkey.verify_digest(sig[1:], message_digest(message), sigdecode=sigdecode_string)
+
+
+@automation("automations/sign_message_accept.json")
+def test_sign_message(cmd: BitcoinCommand):
+    message = b"Hello world!"
+    path = "m/44'/1'/0'/0/0"
+
+    check_signature(cmd, message, path, cmd.sign_message(message, path))
+
+
+@automation("automations/sign_message_accept.json")
+def test_sign_message_long(cmd: BitcoinCommand):
+    # many chunks, with a shorter last one; not printable, so only its hash is shown
+    message = bytes(range(256)) * 4 + b"end"
+    path = "m/84'/1'/0'/0/8"
+
+    check_signature(cmd, message, path, cmd.sign_message(message, path))
+
+
+@automation("automations/sign_message_reject.json")
+def test_sign_message_reject(cmd: BitcoinCommand):
+    with pytest.raises(DenyError):
+        cmd.sign_message("Hello world!", "m/44'/1'/0'/0/0")
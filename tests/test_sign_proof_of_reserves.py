@@ -0,0 +1,71 @@
+import pytest
+
+from pathlib import Path
+
+from bitcoin_client import bip322
+from bitcoin_client.command import BitcoinCommand
+from bitcoin_client.exception.errors import IncorrectDataError, NotSupportedError
+from bitcoin_client.psbt import PSBT
+from bitcoin_client.wallet import PolicyMapWallet
+
+from .utils import automation
+from .utils.sighash import SIGHASH_NONE, SIGHASH_ANYONECANPAY
+
+tests_root: Path = Path(__file__).parent
+
+
+wallet = PolicyMapWallet(
+    "",
+    "wpkh(@0)",
+    [
+        "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+    ],
+)
+
+
+def make_proof(message: str) -> PSBT:
+    # proves the two UTXOs of an existing psbt, with the address of the first one as the challenge
+    psbt = PSBT()
+    psbt.deserialize(open(f"{tests_root}/psbt/singlesig/wpkh-2to2.psbt", "r").read())
+
+    utxos = [(txin.prevout, psbt_in) for txin, psbt_in in zip(psbt.tx.vin, psbt.inputs)]
+    challenge_script = psbt.inputs[0].witness_utxo.scriptPubKey
+    return bip322.make_proof_psbt(bip322.message_hash(message), challenge_script, utxos, psbt.inputs[0])
+
+
+def test_bip322_message_hash():
+    # test vectors of BIP-322
+    assert bip322.message_hash("").hex() == "c90c269c4f8fcbe6880f72a721ddfbf1914268a794cbb21cfafee13770ae19f1"
+    assert bip322.message_hash("Hello World").hex() == \
+        "f0eb03b1a75ac6d9847f55c624a99169b5dccba2a31f5b23bea77ba270de0a7a"
+
+    to_spend = bip322.make_to_spend(
+        bip322.message_hash(""), bytes.fromhex("00142b05d564e6a7a33c087f16e0f730d1440123799d"))
+    assert to_spend.hash == "c5680aa69bb8d860bf82d4e9cd3504b55dde018de765a91bb566283c545a99a7"
+
+
+@automation("automations/sign_proof_accept.json")
+def test_sign_proof_of_reserves(cmd: BitcoinCommand):
+    message = "I own these coins"
+
+    result = cmd.sign_proof_of_reserves(make_proof(message), wallet, None, message)
+
+    # the challenge input and the two proven UTXOs are all internal
+    assert sorted(result.keys()) == [0, 1, 2]
+    assert all(len(sigs) == 1 and sigs[0][-1] == 0x01 for sigs in result.values())
+
+
+def test_sign_proof_of_reserves_wrong_message(cmd: BitcoinCommand):
+    # the first input does not spend the to_spend transaction of the message
+    with pytest.raises(IncorrectDataError):
+        cmd.sign_proof_of_reserves(make_proof("I own these coins"), wallet, None, "Some other message")
+
+
+def test_sign_proof_of_reserves_fail_nondefault_sighash(cmd: BitcoinCommand):
+    # a signature of a proven UTXO that does not commit to all the inputs and outputs could be reused to spend it
+    message = "I own these coins"
+    psbt = make_proof(message)
+    psbt.inputs[1].sighash = SIGHASH_NONE | SIGHASH_ANYONECANPAY
+
+    with pytest.raises(NotSupportedError):
+        cmd.sign_proof_of_reserves(psbt, wallet, None, message)
@@ -1,23 +1,37 @@
 import pytest
 
+import hmac
 import threading
 
+from concurrent.futures import ThreadPoolExecutor
+
+from hashlib import sha256
+
 from decimal import Decimal
 
+from ecdsa import SECP256k1, VerifyingKey
+from ecdsa.util import sigdecode_der
+
 from typing import List
 
 from pathlib import Path
 
-from bitcoin_client.command import BitcoinCommand
-from bitcoin_client.exception.errors import IncorrectDataError, NotSupportedError
+from bitcoin_client.command import BitcoinCommand, SignPsbtPhase, external_outputs_hash
+from bitcoin_client.device_pool import DevicePool, split_range
+from bitcoin_client.exception.errors import IncorrectDataError, NotSupportedError, SignatureFailError
 
 from bitcoin_client.psbt import PSBT
+from bitcoin_client.quorum import sign_psbt_with_devices
+from bitcoin_client.tracing import ExchangeMetrics
 from bitcoin_client.wallet import PolicyMapWallet, MultisigWallet, AddressType
 from speculos.client import SpeculosClient
 from tests.utils import txmaker
 
 from .utils import automation
 from .utils import bip0340
+from .utils.sighash import (
+    legacy_sighash, segwit_v0_sighash, SIGHASH_NONE, SIGHASH_SINGLE, SIGHASH_ANYONECANPAY
+)
 
 from embit.script import Script
 from embit.networks import NETWORKS
@@ -199,6 +213,178 @@ def test_sign_psbt_singlesig_wpkh_1to2(cmd: BitcoinCommand):
     }
 
 
+@automation("automations/sign_with_wallet_accept.json")
+def test_sign_psbt_multi_wallet_singlesig_wpkh_1to2(cmd: BitcoinCommand):
+    # same as test_sign_psbt_singlesig_wpkh_1to2, with an additional wallet that has no input in the psbt
+    psbt = open_psbt_from_file(f"{tests_root}/psbt/singlesig/wpkh-1to2.psbt")
+
+    wallet = PolicyMapWallet(
+        "",
+        "wpkh(@0)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+        ],
+    )
+    other_wallet = PolicyMapWallet(
+        "",
+        "pkh(@0)",
+        [
+            "[f5acc2fd/44'/1'/0']tpubDCwYjpDhUdPGP5rS3wgNg13mTrrjBuG8V9VpWbyptX6TRPbNoZVXsoVUSkCjmQ8jJycjuDKBb9eataSymXakTTaGifxR6kmVsfFehH1ZgJT/**"
+        ],
+    )
+
+    result = cmd.sign_psbt_multi_wallet(psbt, [(other_wallet, None), (wallet, None)])
+
+    assert result == {
+        0: bytes.fromhex(
+            "3045022100ab44f34dd7e87c9054591297a101e8500a0641d1d591878d0d23cf8096fa79e802205d12d1062d925e27b57bdcf994ecf332ad0a8e67b8fe407bab2101255da632aa01"
+        )
+    }
+
+
+@automation("automations/sign_with_wallet_accept.json")
+def test_sign_psbt_stream_singlesig_wpkh_1to2(cmd: BitcoinCommand):
+    # same as test_sign_psbt_singlesig_wpkh_1to2, streaming the psbt from the (base64) file
+    wallet = PolicyMapWallet(
+        "",
+        "wpkh(@0)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+        ],
+    )
+
+    result = cmd.sign_psbt_stream(f"{tests_root}/psbt/singlesig/wpkh-1to2.psbt", wallet, None)
+
+    assert result == {
+        0: bytes.fromhex(
+            "3045022100ab44f34dd7e87c9054591297a101e8500a0641d1d591878d0d23cf8096fa79e802205d12d1062d925e27b57bdcf994ecf332ad0a8e67b8fe407bab2101255da632aa01"
+        )
+    }
+
+
+def test_check_psbt_singlesig_wpkh_1to2(cmd: BitcoinCommand):
+    # same psbt as test_sign_psbt_singlesig_wpkh_1to2, only verified: no UI, and no signature
+    psbt = open_psbt_from_file(f"{tests_root}/psbt/singlesig/wpkh-1to2.psbt")
+
+    wallet = PolicyMapWallet(
+        "",
+        "wpkh(@0)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+        ],
+    )
+
+    result = cmd.check_psbt(psbt, wallet, None)
+
+    assert result == {
+        "inputs_total": 3208357,
+        "outputs_total": 3208212,
+        "fee": 145,
+        "change_total": 2308212,
+        "internal_inputs": [0],
+        "change_outputs": [1],
+    }
+
+
+@automation("automations/sign_summary_accept.json")
+def test_sign_psbt_summary_singlesig_wpkh_2to2(cmd: BitcoinCommand):
+    # same psbt as test_sign_psbt_singlesig_wpkh_2to2; the external output is validated with the summary of the
+    # external outputs instead, and the signatures are the same
+    psbt = open_psbt_from_file(f"{tests_root}/psbt/singlesig/wpkh-2to2.psbt")
+
+    wallet = PolicyMapWallet(
+        "",
+        "wpkh(@0)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+        ],
+    )
+
+    result = cmd.sign_psbt_summary(psbt, wallet, None)
+
+    assert result == {
+        0: [bytes.fromhex(
+            "304402206b3e877655f08c6e7b1b74d6d893a82cdf799f68a5ae7cecae63a71b0339e5ce022019b94aa3fb6635956e109f3d89c996b1bfbbaf3c619134b5a302badfaf52180e01"
+        )],
+        1: [bytes.fromhex(
+            "3045022100e2e98e4f8c70274f10145c89a5d86e216d0376bdf9f42f829e4315ea67d79d210220743589fd4f55e540540a976a5af58acd610fa5e188a5096dfe7d36baf3afb94001"
+        )],
+    }
+
+
+def test_check_psbt_singlesig_wpkh_4to300(cmd: BitcoinCommand, enable_slow_tests: bool):
+    # more than 256 outputs: the change outputs are returned as a list of indexes
+    # Slow test, so disabled unless the --enableslowtests option is used
+
+    if not enable_slow_tests:
+        pytest.skip()
+
+    wallet = WPKH_WALLET
+
+    n_outputs = 300
+    change_indexes = [7, 280]
+    psbt = txmaker.createPsbt(
+        wallet,
+        [10_000_000 + 100_000 * i for i in range(4)],
+        [10_000 + 10 * i for i in range(n_outputs)],
+        [i in change_indexes for i in range(n_outputs)]
+    )
+
+    result = cmd.check_psbt(psbt, wallet, None)
+
+    assert result["internal_inputs"] == [0, 1, 2, 3]
+    assert result["change_outputs"] == change_indexes
+    assert result["change_total"] == sum(psbt.tx.vout[i].nValue for i in change_indexes)
+    assert len(external_outputs_hash(psbt, result["change_outputs"])) == 32
+
+
+WPKH_WALLET = PolicyMapWallet(
+    "",
+    "wpkh(@0)",
+    [
+        "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+    ],
+)
+
+
+def verify_wpkh_signatures(psbt: PSBT, result) -> None:
+    for i, sigs in result.items():
+        witness_utxo = psbt.inputs[i].witness_utxo
+        script_code = b"\x76\xa9\x14" + witness_utxo.scriptPubKey[2:] + b"\x88\xac"
+        sighash = segwit_v0_sighash(psbt.tx, i, script_code, witness_utxo.nValue, sigs[-1][-1])
+        pubkey = list(psbt.inputs[i].hd_keypaths.keys())[0]
+        assert verify_ecdsa(pubkey, sighash, sigs[-1])
+
+
+@automation("automations/sign_with_wallet_accept.json")
+def test_sign_psbt_amend_fee_bump(cmd: BitcoinCommand):
+    # the psbt is signed with its amend record; then, a fee bump that only lowers the change output is signed from the
+    # amend record, that was produced for the original psbt: the inputs are not verified again
+    psbt = open_psbt_from_file(f"{tests_root}/psbt/singlesig/wpkh-1to2.psbt")
+
+    result, amend_record = cmd.sign_psbt_amendable(psbt, WPKH_WALLET, None)
+    assert sorted(result.keys()) == [0]
+    verify_wpkh_signatures(psbt, result)
+
+    bumped_psbt = open_psbt_from_file(f"{tests_root}/psbt/singlesig/wpkh-1to2.psbt")
+    bumped_psbt.tx.vout[1].nValue -= 1000  # the change output
+
+    result = cmd.sign_psbt_amend(bumped_psbt, WPKH_WALLET, None, amend_record)
+    assert sorted(result.keys()) == [0]
+    verify_wpkh_signatures(bumped_psbt, result)
+
+    # the amend record binds the psbt to its approved external outputs, and the hmac to the input maps
+    changed_psbt = open_psbt_from_file(f"{tests_root}/psbt/singlesig/wpkh-1to2.psbt")
+    changed_psbt.tx.vout[0].nValue -= 1000  # the external output
+    with pytest.raises(IncorrectDataError):
+        cmd.sign_psbt_amend(changed_psbt, WPKH_WALLET, None, amend_record)
+
+    other_inputs_psbt = open_psbt_from_file(f"{tests_root}/psbt/singlesig/wpkh-1to2.psbt")
+    other_inputs_psbt.tx.vin[0].nSequence -= 1
+    with pytest.raises(SignatureFailError):
+        cmd.sign_psbt_amend(other_inputs_psbt, WPKH_WALLET, None, amend_record)
+
+
 @automation("automations/sign_with_wallet_accept.json")
 def test_sign_psbt_singlesig_wpkh_2to2(cmd: BitcoinCommand):
     # PSBT for a legacy 2-input 2-output spend (1 change address)
@@ -233,6 +419,124 @@ def test_sign_psbt_singlesig_wpkh_2to2(cmd: BitcoinCommand):
     }
 
 
+@automation("automations/sign_with_wallet_accept.json")
+def test_sign_psbt_singlesig_wpkh_2to2_input_order(cmd: BitcoinCommand):
+    # same as test_sign_psbt_singlesig_wpkh_2to2, signing the second input first
+    psbt = open_psbt_from_file(f"{tests_root}/psbt/singlesig/wpkh-2to2.psbt")
+
+    wallet = PolicyMapWallet(
+        "",
+        "wpkh(@0)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+        ],
+    )
+
+    result = cmd.sign_psbt_in_order(psbt, wallet, None, [1, 0])
+
+    assert result == {
+        0: [bytes.fromhex(
+            "304402206b3e877655f08c6e7b1b74d6d893a82cdf799f68a5ae7cecae63a71b0339e5ce022019b94aa3fb6635956e109f3d89c996b1bfbbaf3c619134b5a302badfaf52180e01"
+        )],
+        1: [bytes.fromhex(
+            "3045022100e2e98e4f8c70274f10145c89a5d86e216d0376bdf9f42f829e4315ea67d79d210220743589fd4f55e540540a976a5af58acd610fa5e188a5096dfe7d36baf3afb94001"
+        )],
+    }
+
+    # the order must be a permutation of the inputs
+    with pytest.raises(IncorrectDataError):
+        cmd.sign_psbt_in_order(psbt, wallet, None, [0, 0])
+
+def verify_ecdsa(pubkey: bytes, sighash: bytes, sig: bytes) -> bool:
+    """Returns true if sig, a DER-encoded signature followed by the sighash byte, is a valid signature of sighash."""
+    return VerifyingKey.from_string(pubkey, curve=SECP256k1).verify_digest(sig[:-1], sighash, sigdecode=sigdecode_der)
+
+
+@automation("automations/sign_with_wallet_nondefault_sighash_accept.json")
+def test_sign_psbt_singlesig_pkh_1to1_sighash_single(cmd: BitcoinCommand):
+    psbt = open_psbt_from_file(f"{tests_root}/psbt/singlesig/pkh-1to1.psbt")
+    psbt.inputs[0].sighash = SIGHASH_SINGLE
+
+    wallet = PolicyMapWallet(
+        "",
+        "pkh(@0)",
+        [
+            "[f5acc2fd/44'/1'/0']tpubDCwYjpDhUdPGP5rS3wgNg13mTrrjBuG8V9VpWbyptX6TRPbNoZVXsoVUSkCjmQ8jJycjuDKBb9eataSymXakTTaGifxR6kmVsfFehH1ZgJT/**"
+        ],
+    )
+
+    result = cmd.sign_psbt(psbt, wallet, None)
+
+    psbt_in = psbt.inputs[0]
+    script_code = psbt_in.non_witness_utxo.vout[psbt.tx.vin[0].prevout.n].scriptPubKey
+    pubkey = list(psbt_in.hd_keypaths.keys())[0]
+
+    assert result.keys() == {0}
+    assert result[0][-1] == SIGHASH_SINGLE
+    assert verify_ecdsa(pubkey, legacy_sighash(psbt.tx, 0, script_code, SIGHASH_SINGLE), result[0])
+
+
+@automation("automations/sign_with_wallet_nondefault_sighash_accept.json")
+def test_sign_psbt_singlesig_wpkh_2to2_nondefault_sighash(cmd: BitcoinCommand):
+    # the first input only commits to itself and the first output, the second one to all the inputs and no output
+    sighash_types = [SIGHASH_SINGLE | SIGHASH_ANYONECANPAY, SIGHASH_NONE]
+
+    psbt = open_psbt_from_file(f"{tests_root}/psbt/singlesig/wpkh-2to2.psbt")
+    for psbt_in, sighash_type in zip(psbt.inputs, sighash_types):
+        psbt_in.sighash = sighash_type
+
+    wallet = PolicyMapWallet(
+        "",
+        "wpkh(@0)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+        ],
+    )
+
+    result = cmd.sign_psbt(psbt, wallet, None)
+
+    assert result.keys() == {0, 1}
+    for i, sighash_type in enumerate(sighash_types):
+        witness_utxo = psbt.inputs[i].witness_utxo
+        script_code = b"\x76\xa9\x14" + witness_utxo.scriptPubKey[2:] + b"\x88\xac"  # P2PKH of the witness program
+        sighash = segwit_v0_sighash(psbt.tx, i, script_code, witness_utxo.nValue, sighash_type)
+        pubkey = list(psbt.inputs[i].hd_keypaths.keys())[0]
+
+        assert result[i][-1] == sighash_type
+        assert verify_ecdsa(pubkey, sighash, result[i])
+
+
+def test_sign_psbt_fail_sighash_single_without_output(client: SpeculosClient, cmd: BitcoinCommand):
+    # SIGHASH_SINGLE for an input with no output at the same index must fail with IncorrectDataError before any user
+    # interaction; an undefined sighash type with NotSupportedError
+
+    if not isinstance(client, SpeculosClient):
+        pytest.skip("Requires speculos")
+
+    wallet = PolicyMapWallet(
+        "",
+        "wpkh(@0)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+        ],
+    )
+
+    psbt = txmaker.createPsbt(
+        wallet,
+        [1 * 100_000_000, 2 * 100_000_000],
+        [3 * 100_000_000 - 10_000],
+        [False]
+    )
+
+    psbt.inputs[1].sighash = SIGHASH_SINGLE
+    with pytest.raises(IncorrectDataError):
+        cmd.sign_psbt(psbt, wallet, None)
+
+    psbt.inputs[1].sighash = 0x04
+    with pytest.raises(NotSupportedError):
+        cmd.sign_psbt(psbt, wallet, None)
+
+
 # def test_sign_psbt_legacy(cmd: BitcoinCommand):
 #     # legacy address
 #     # PSBT for a legacy 1-input 1-output spend
@@ -290,6 +594,309 @@ def test_sign_psbt_multisig_wsh(cmd: BitcoinCommand):
     }
 
 
+@automation("automations/sign_with_wallet_accept.json")
+def test_sign_psbt_multisig_wsh_with_devices(cmd: BitcoinCommand):
+    # the psbt is prepared once for all the cosigners, and their signatures are merged into it
+    wallet = MultisigWallet(
+        name="Cold storage",
+        address_type=AddressType.WIT,
+        threshold=2,
+        keys_info=[
+            f"[76223a6e/48'/1'/0'/2']tpubDE7NQymr4AFtewpAsWtnreyq9ghkzQBXpCZjWLFVRAvnbf7vya2eMTvT2fPapNqL8SuVvLQdbUbMfWLVDCZKnsEBqp6UK93QEzL8Ck23AwF/**",
+            f"[f5acc2fd/48'/1'/0'/2']tpubDFAqEGNyad35aBCKUAXbQGDjdVhNueno5ZZVEn3sQbW5ci457gLR7HyTmHBg93oourBssgUxuWz1jX5uhc1qaqFo9VsybY1J5FuedLfm4dK/**",
+        ],
+    )
+
+    wallet_hmac = bytes.fromhex(
+        "d6434852fb3caa7edbd1165084968f1691444b3cfc10cf1e431acbbc7f48451f"
+    )
+
+    psbt = open_psbt_from_file(f"{tests_root}/psbt/multisig/wsh-2of2.psbt")
+
+    expected_sig = bytes.fromhex(
+        "304402206ab297c83ab66e573723892061d827c5ac0150e2044fed7ed34742fedbcfb26e0220319cdf4eaddff63fc308cdf53e225ea034024ef96de03fd0939b6deeea1e8bd301"
+    )
+
+    result = sign_psbt_with_devices(psbt, wallet, [(cmd, wallet_hmac)])
+
+    assert result == {bytes.fromhex("f5acc2fd"): {0: [expected_sig]}}
+
+    pubkey = next(pk for pk, origin in psbt.inputs[0].hd_keypaths.items()
+                  if origin.fingerprint == bytes.fromhex("f5acc2fd"))
+    assert psbt.inputs[0].partial_sigs[pubkey] == expected_sig
+
+
+@automation("automations/sign_with_wallet_accept.json")
+def test_sign_psbt_multisig_wsh_device_pool(cmd: BitcoinCommand):
+    # same as test_sign_psbt_multisig_wsh_with_devices, with the jobs dispatched by a DevicePool
+    wallet = MultisigWallet(
+        name="Cold storage",
+        address_type=AddressType.WIT,
+        threshold=2,
+        keys_info=[
+            f"[76223a6e/48'/1'/0'/2']tpubDE7NQymr4AFtewpAsWtnreyq9ghkzQBXpCZjWLFVRAvnbf7vya2eMTvT2fPapNqL8SuVvLQdbUbMfWLVDCZKnsEBqp6UK93QEzL8Ck23AwF/**",
+            f"[f5acc2fd/48'/1'/0'/2']tpubDFAqEGNyad35aBCKUAXbQGDjdVhNueno5ZZVEn3sQbW5ci457gLR7HyTmHBg93oourBssgUxuWz1jX5uhc1qaqFo9VsybY1J5FuedLfm4dK/**",
+        ],
+    )
+
+    wallet_hmac = bytes.fromhex(
+        "d6434852fb3caa7edbd1165084968f1691444b3cfc10cf1e431acbbc7f48451f"
+    )
+
+    psbt = open_psbt_from_file(f"{tests_root}/psbt/multisig/wsh-2of2.psbt")
+
+    expected_sig = bytes.fromhex(
+        "304402206ab297c83ab66e573723892061d827c5ac0150e2044fed7ed34742fedbcfb26e0220319cdf4eaddff63fc308cdf53e225ea034024ef96de03fd0939b6deeea1e8bd301"
+    )
+
+    assert split_range(0, 10, 3) == [(0, 4), (4, 7), (7, 10)]
+    assert split_range(0, 2, 5) == [(0, 1), (1, 2)]
+
+    with DevicePool([cmd]) as pool:
+        fingerprint = pool.devices[0].fingerprint
+        assert fingerprint == bytes.fromhex("f5acc2fd")
+
+        # the wallet policy is not registered in the pool yet
+        with pytest.raises(ValueError):
+            pool.sign_psbt(psbt, wallet)
+
+        pool.add_wallet(wallet, fingerprint, wallet_hmac)
+        result = pool.sign_psbt(psbt, wallet).result()
+
+    assert result == {fingerprint: {0: [expected_sig]}}
+
+    pubkey = next(pk for pk, origin in psbt.inputs[0].hd_keypaths.items()
+                  if origin.fingerprint == fingerprint)
+    assert psbt.inputs[0].partial_sigs[pubkey] == expected_sig
+
+
+
+@automation("automations/sign_with_wallet_accept.json")
+def test_sign_psbt_multisig_wsh_two_internal_keys(cmd: BitcoinCommand, speculos_globals):
+    # two of the three keys are derived from the seed of the device: each input is signed with both
+    wallet = MultisigWallet(
+        name="Two internal keys",
+        address_type=AddressType.WIT,
+        threshold=2,
+        keys_info=[
+            "[f5acc2fd/48'/1'/0'/2']tpubDFAqEGNyad35aBCKUAXbQGDjdVhNueno5ZZVEn3sQbW5ci457gLR7HyTmHBg93oourBssgUxuWz1jX5uhc1qaqFo9VsybY1J5FuedLfm4dK/**",
+            txmaker.createCosignerKeyInfo("m/48'/1'/0'/2'"),
+            "[f5acc2fd/48'/1'/1'/2']tpubDFU9XnLGgM4HGrqy3vYEJAZi1x5UZAXaeQeHqUfzNrng6iCzpNzLPjwWhUoRRVFndSzFuf1ZadL75q2iPinXBsdKk23Gz34LKQcvcnPcewj/**",
+        ],
+    )
+
+    # the wallet registration key is deterministic, so there is no need to register the wallet
+    wallet_hmac = hmac.new(speculos_globals.wallet_registration_key, wallet.id, sha256).digest()
+
+    psbt = txmaker.createPsbt(
+        wallet,
+        [100_000, 200_000],
+        [250_000],
+        [False]
+    )
+
+    result = cmd.sign_psbt_all_signatures(psbt, wallet, wallet_hmac)
+
+    assert sorted(result.keys()) == [0, 1]
+    for sigs in result.values():
+        assert len(sigs) == 2
+        assert sigs[0] != sigs[1]
+
+
+@automation("automations/sign_with_wallet_accept.json")
+def test_sign_psbt_cached_retry(client):
+    # signing the same psbt again reuses the prepared commitments, and gives the same signatures
+    cached_cmd = BitcoinCommand(client=client, debug=False, psbt_cache_size=2)
+
+    wallet = PolicyMapWallet(
+        "",
+        "wpkh(@0)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+        ],
+    )
+
+    psbt = txmaker.createPsbt(
+        wallet,
+        [100_000, 200_000],
+        [250_000, 40_000],
+        [False, True]
+    )
+
+    result = cached_cmd.sign_psbt(psbt, wallet, None)
+    assert len(cached_cmd._psbt_cache) == 1
+
+    result_retry = cached_cmd.sign_psbt(psbt, wallet, None)
+    assert len(cached_cmd._psbt_cache) == 1
+
+    assert result_retry == result
+
+def test_update_prepared_psbt(cmd: BitcoinCommand):
+    # updating a prepared psbt for a new version of it gives the same commitments and trees as preparing it again
+    psbt = open_psbt_from_file(f"{tests_root}/psbt/singlesig/wpkh-2to2.psbt")
+    prepared = cmd.prepare_psbt(psbt, WPKH_WALLET)
+
+    bumped_psbt = open_psbt_from_file(f"{tests_root}/psbt/singlesig/wpkh-2to2.psbt")
+    bumped_psbt.tx.vout[1].nValue -= 1000
+    cmd.update_prepared_psbt(prepared, bumped_psbt)
+
+    expected = cmd.prepare_psbt(bumped_psbt, WPKH_WALLET)
+    assert prepared.global_commitment == expected.global_commitment
+    assert prepared.input_commitments == expected.input_commitments
+    assert prepared.output_commitments == expected.output_commitments
+    assert prepared.output_tree.root == expected.output_tree.root
+    assert prepared.output_tree.root in prepared.client_intepreter.known_trees
+    assert prepared.output_tree.prove_leaf(1) == expected.output_tree.prove_leaf(1)
+
+    # with fewer outputs, the tree of the output maps is built again
+    bumped_psbt.tx.vout.pop()
+    bumped_psbt.outputs.pop()
+    cmd.update_prepared_psbt(prepared, bumped_psbt)
+    assert prepared.output_tree.root == cmd.prepare_psbt(bumped_psbt, WPKH_WALLET).output_tree.root
+
+
+@automation("automations/sign_with_wallet_accept.json")
+def test_sign_psbt_preimage_spill(client):
+    # the long preimages are paged in from a temporary file, with the same signatures
+    spill_cmd = BitcoinCommand(client=client, debug=False, preimage_spill_size=64)
+
+    psbt = open_psbt_from_file(f"{tests_root}/psbt/singlesig/wpkh-1to2.psbt")
+
+    wallet = PolicyMapWallet(
+        "",
+        "wpkh(@0)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+        ],
+    )
+
+    result = spill_cmd.sign_psbt(psbt, wallet, None)
+
+    assert result == {
+        0: bytes.fromhex(
+            "3045022100ab44f34dd7e87c9054591297a101e8500a0641d1d591878d0d23cf8096fa79e802205d12d1062d925e27b57bdcf994ecf332ad0a8e67b8fe407bab2101255da632aa01"
+        )
+    }
+
+
+@automation("automations/sign_with_wallet_accept.json")
+def test_sign_psbt_coalesced_yields(client):
+    # several signatures are returned in each YIELD and in the final response, with the same result
+    cmd = BitcoinCommand(client=client, debug=False)
+    coalescing_cmd = BitcoinCommand(client=client, debug=False, coalesce_yields=True)
+
+    wallet = PolicyMapWallet(
+        "",
+        "wpkh(@0)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+        ],
+    )
+
+    psbt = txmaker.createPsbt(
+        wallet,
+        [100_000 + 10_000 * i for i in range(7)],
+        [250_000, 40_000],
+        [False, True]
+    )
+
+    result = cmd.sign_psbt(psbt, wallet, None)
+    coalesced_result = coalescing_cmd.sign_psbt(psbt, wallet, None)
+
+    assert len(result) == 7
+    assert coalesced_result == result
+
+
+def test_sign_psbt_progress_events(client):
+    # the progress of each phase is reported while signing, and the signatures are the same
+    cmd = BitcoinCommand(client=client, debug=False)
+    events = []
+    progress_cmd = BitcoinCommand(client=client, debug=False,
+                                  progress_callback=lambda *event: events.append(event))
+
+    wallet = PolicyMapWallet(
+        "",
+        "wpkh(@0)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+        ],
+    )
+
+    psbt = txmaker.createPsbt(
+        wallet,
+        [100_000 + 10_000 * i for i in range(9)],
+        [250_000, 40_000],
+        [False, True]
+    )
+
+    result = cmd.sign_psbt(psbt, wallet, None)
+    progress_result = progress_cmd.sign_psbt(psbt, wallet, None)
+
+    assert progress_result == result
+    assert events == [
+        (SignPsbtPhase.INPUTS, 0, 9), (SignPsbtPhase.INPUTS, 8, 9), (SignPsbtPhase.INPUTS, 9, 9),
+        (SignPsbtPhase.OUTPUTS, 0, 2), (SignPsbtPhase.OUTPUTS, 2, 2),
+        (SignPsbtPhase.SIGN, 0, 9), (SignPsbtPhase.SIGN, 8, 9), (SignPsbtPhase.SIGN, 9, 9),
+    ]
+
+
+def test_sign_psbt_background_precompute(client):
+    # the lookup tables of the Merkle trees are computed while the psbt is signed, with the same signatures
+    cmd = BitcoinCommand(client=client, debug=False)
+
+    wallet = PolicyMapWallet(
+        "",
+        "wpkh(@0)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+        ],
+    )
+
+    psbt = txmaker.createPsbt(wallet, [100_000 + 10_000 * i for i in range(9)], [250_000, 40_000], [False, True])
+
+    result = cmd.sign_psbt(psbt, wallet, None)
+    with ThreadPoolExecutor(max_workers=1) as executor:
+        precompute_cmd = BitcoinCommand(client=client, debug=False, precompute_executor=executor)
+        assert precompute_cmd.sign_psbt(psbt, wallet, None) == result
+
+
+def test_sign_psbt_metrics(client):
+    # the exchanges are recorded by phase, and a span is emitted for each of them
+    spans = []
+    metrics = ExchangeMetrics(span_hook=lambda *span: spans.append(span))
+    cmd = BitcoinCommand(client=client, debug=False, progress_callback=lambda *event: None, metrics=metrics)
+
+    wallet = PolicyMapWallet(
+        "",
+        "wpkh(@0)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P/**"
+        ],
+    )
+
+    psbt = txmaker.createPsbt(wallet, [100_000, 120_000], [150_000, 60_000], [False, True])
+
+    result = cmd.sign_psbt(psbt, wallet, None)
+    assert len(result) == 2
+
+    stats = metrics.as_dict()
+    assert set(stats["phases"].keys()) == {"INIT", "INPUTS", "OUTPUTS", "SIGN"}
+    assert sum(phase["apdus"] for phase in stats["phases"].values()) == sum(
+        apdu["count"] for apdu in stats["apdus"].values())
+    assert sum(phase["client_commands"] for phase in stats["phases"].values()) == sum(
+        command["count"] for command in stats["client_commands"].values())
+    assert "GET_MERKLEIZED_MAP_VALUE" in stats["client_commands"]
+
+    assert len(spans) == sum(phase["apdus"] + phase["client_commands"] for phase in stats["phases"].values())
+    for name, start_ns, end_ns, attributes in spans:
+        assert name in ("apdu_exchange", "client_command")
+        assert start_ns <= end_ns
+        assert attributes["phase"] in stats["phases"]
+
+    metrics.reset()
+    assert metrics.as_dict()["apdus"] == {}
+
+
 # def test_sign_psbt_legacy_wrong_non_witness_utxo(cmd: BitcoinCommand):
 #     # legacy address
 #     # PSBT for a legacy 1-input 1-output spend
@@ -405,7 +1012,7 @@ def test_sign_psbt_singlesig_wpkh_4to3(client: SpeculosClient, cmd: BitcoinComma
 
 @automation("automations/sign_with_wallet_accept.json")
 def test_sign_psbt_singlesig_wpkh_64to256(cmd: BitcoinCommand, enable_slow_tests: bool):
-    # PSBT for a transaction with 64 inputs and 256 outputs (maximum currently supported in the app)
+    # PSBT for a transaction with 64 inputs and 256 outputs
     # Very slow test (esp. with DEBUG enabled), so disabled unless the --enableslowtests option is used
 
     if not enable_slow_tests:
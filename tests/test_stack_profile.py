@@ -0,0 +1,63 @@
+import pytest
+
+from pathlib import Path
+
+from bitcoin_client.command import BitcoinCommand
+from bitcoin_client.exception.errors import InsNotSupportedError
+from bitcoin_client.psbt import PSBT
+
+from .utils import automation
+from .test_benchmark_sign_psbt import SINGLESIG_WALLETS
+
+# Checks the high-water mark of the stack while signing the test PSBTs. They are skipped unless the app is compiled
+# with `make STACK_PROFILE=1`.
+#
+# The budgets are upper bounds in bytes, relative to the stack pointer at the beginning of the command; if a change
+# makes a test fail, check the deepest processor reported in the failure before raising the budget.
+
+tests_root: Path = Path(__file__).parent
+
+# psbt file (in tests/psbt/singlesig) -> (wallet, stack budget)
+STACK_BUDGETS = {
+    "pkh-1to1": ("pkh", 3072),
+    "sh-wpkh-1to2": ("sh_wpkh", 3072),
+    "wpkh-1to2": ("wpkh", 3072),
+    "wpkh-2to2": ("wpkh", 3072),
+    "tr-1to2": ("tr", 3328),
+}
+
+
+def get_stack_profile(cmd: BitcoinCommand) -> dict:
+    try:
+        stats = cmd.get_app_stats()
+    except InsNotSupportedError:
+        pytest.skip("Requires an app compiled with STACK_PROFILE=1")
+
+    if "stack_high_water" not in stats:
+        pytest.skip("Requires an app compiled with STACK_PROFILE=1")
+
+    return stats
+
+
+@pytest.mark.parametrize("psbt_name", STACK_BUDGETS.keys())
+@automation("automations/sign_with_wallet_accept.json")
+def test_stack_profile_sign_psbt(cmd: BitcoinCommand, psbt_name: str):
+    wallet_name, budget = STACK_BUDGETS[psbt_name]
+
+    psbt = PSBT()
+    psbt.deserialize(open(f"{tests_root}/psbt/singlesig/{psbt_name}.psbt", "r").read())
+
+    # resets the counters, and paints the stack again
+    get_stack_profile(cmd)
+
+    result = cmd.sign_psbt(psbt, SINGLESIG_WALLETS[wallet_name], None)
+    assert len(result) == len(psbt.inputs)
+
+    stats = get_stack_profile(cmd)
+    deepest = stats["deepest_processor"]
+    print(f"{psbt_name}: stack high-water mark {stats['stack_high_water']} bytes, "
+          f"{stats['stack_free']} bytes never used, deepest processor {deepest['function']}:{deepest['line']}")
+
+    assert stats["stack_free"] > 0
+    assert stats["stack_high_water"] <= budget, \
+        f"deepest processor: {deepest['function']}:{deepest['line']}"
@@ -0,0 +1,214 @@
+import hmac
+import random
+
+from hashlib import sha256
+from typing import Any, Callable, Dict, List, Tuple
+
+import pytest
+
+from bitcoin_client.exception.errors import BadStateError, IncorrectDataError, InsNotSupportedError
+from bitcoin_client.wallet import AddressType, MultisigWallet
+from tests.utils import txmaker
+from tests.utils.adversarial_host import MaximallySplittingCommand
+from tests.utils.benchmark import BenchmarkRecorder
+from tests.utils.psbt_generator import PsbtSpec, generate_psbt
+
+from .test_benchmark_sign_psbt import MULTISIG_OUR_KEY_INFO, MULTISIG_PATH
+from .utils import automation
+
+# Worst-case costs of SIGN_PSBT, REGISTER_WALLET and GET_WALLET_ADDRESS, with a host that splits all its responses as
+# much as the protocol allows (see tests/utils/adversarial_host.py), and inputs of maximal size: PSBTs whose external
+# outputs can only be classified by deriving a script of the wallet, and wallet policies with up to the maximum number
+# of keys (15).
+#
+# The costs are the number of APDUs (round trips) and, if the app is compiled with APP_STATS=1, the counters of
+# GET_APP_STATS that measure the work of the device: interruptions, bytes hashed with SHA256, and EC scalar
+# multiplications (speculos can not count the cycles of the device, but these are the expensive operations). All of
+# them only depend on the inputs, so they are deterministic.
+#
+# Each cost must be linear in the size of the inputs: the costs measured at a base size, and at the base size with one
+# dimension doubled, give the cost per input, per output or per key; the cost at a larger size must then be at most
+# MODEL_SLACK times the linear extrapolation. A quadratic blow-up (for example, some work done for each pair of an
+# input and an output) fails the test, and its message reports the cost model. The costs are recorded like the
+# benchmarks (see --benchmark-report), and the costs per unit are printed.
+#
+# The largest sizes (64 inputs and 256 outputs, as in test_benchmark_sign_psbt.py) also require --enableslowtests.
+
+# Upper bound of the ratio between a measured cost and the linear extrapolation of the costs at the base sizes; it
+# leaves room for the caches, that are less effective on larger inputs.
+MODEL_SLACK = 2.0
+
+DEVICE_COUNTERS = ["n_interruptions", "sha256_bytes", "ec_scalar_mults"]
+
+Costs = Dict[str, int]
+
+
+@pytest.fixture
+def splitting_cmd(client) -> MaximallySplittingCommand:
+    return MaximallySplittingCommand(client=client, debug=False)
+
+
+@pytest.fixture
+def stalling_cmd(client) -> MaximallySplittingCommand:
+    return MaximallySplittingCommand(client=client, debug=False, stall=True)
+
+
+def measure(recorder: BenchmarkRecorder, name: str, cmd: MaximallySplittingCommand, fn: Callable,
+            *args) -> Tuple[Any, Costs]:
+    """Runs fn(*args), recording its costs under name; returns the return value of fn, and the costs."""
+    try:
+        cmd.get_app_stats()  # resets the counters
+        has_app_stats = True
+    except InsNotSupportedError:
+        has_app_stats = False
+
+    ret = recorder.measure(name, cmd, fn, *args)
+    costs = {"n_apdus": cmd.n_apdus}
+
+    if has_app_stats:
+        stats = cmd.get_app_stats()
+        device_counters = {counter: stats[counter] for counter in DEVICE_COUNTERS}
+        recorder.record_device_counters(name, device_counters)
+        costs.update(device_counters)
+
+    return ret, costs
+
+
+def check_linear_costs(name: str, dimensions: List[str], base_size: Tuple[int, ...], base_costs: Costs,
+                       doubled_costs: List[Costs], size: Tuple[int, ...], costs: Costs) -> None:
+    """Checks that the costs at size are at most MODEL_SLACK times the linear extrapolation from the costs at
+    base_size, and at base_size with each dimension doubled (doubled_costs[i] for dimensions[i])."""
+    for counter, base_cost in base_costs.items():
+        # cost per unit of each dimension, as measured by its doubling
+        per_unit = [max(0.0, (doubled[counter] - base_cost) / base_size[i])
+                    for i, doubled in enumerate(doubled_costs)]
+        predicted = base_cost + sum(per_unit[i] * (size[i] - base_size[i]) for i in range(len(dimensions)))
+
+        model = f"{base_cost} at {base_size}, " + ", ".join(
+            f"{per_unit[i]:.1f} per {dimension}" for i, dimension in enumerate(dimensions))
+        print(f"{name}: {counter}: {costs[counter]} at {size}; model: {model}")
+
+        assert costs[counter] <= MODEL_SLACK * predicted, \
+            f"{counter} of {name} is not linear: {costs[counter]} at {size}, but the model is {model}"
+
+
+def make_multisig_wallet(name: str, n_keys: int, registration_key: bytes) -> Tuple[MultisigWallet, bytes]:
+    """Returns a 2-of-n_keys wsh wallet with the key of the speculos seed, and its hmac."""
+    random.seed(name)  # for the cosigners
+    wallet = MultisigWallet(
+        name="Worst case",
+        address_type=AddressType.WIT,
+        threshold=2,
+        keys_info=[MULTISIG_OUR_KEY_INFO] + [txmaker.createCosignerKeyInfo(MULTISIG_PATH) for _ in range(n_keys - 1)],
+    )
+    # the wallet registration key of speculos is deterministic, so there is no need to register the wallet
+    wallet_hmac = hmac.new(registration_key, wallet.id, sha256).digest()
+    return wallet, wallet_hmac
+
+
+def make_worst_case_psbt_spec(n_inputs: int, n_outputs: int) -> PsbtSpec:
+    # a single change output: all the other outputs are decoys, that need a derivation to be classified as external
+    return PsbtSpec(n_inputs=n_inputs, n_outputs=n_outputs, n_change=1, parent_outputs=4, mixed_outputs=False,
+                    foreign_keypaths=2, decoy_keypaths=True)
+
+
+# (number of keys of the wallet, base size, final size) for SIGN_PSBT; the sizes are (n_inputs, n_outputs)
+SIGN_PSBT_CASES = [
+    (3, (2, 4), (8, 16)),
+    (15, (2, 4), (64, 256)),
+]
+SLOW_SIGN_PSBT_CASES = [(15, (2, 4), (64, 256))]
+
+
+@pytest.mark.parametrize("n_keys,base_size,size", SIGN_PSBT_CASES,
+                         ids=[f"2of{n_keys}-{size[0]}to{size[1]}" for n_keys, _, size in SIGN_PSBT_CASES])
+@automation("automations/sign_with_wallet_accept.json")
+def test_worst_case_sign_psbt(splitting_cmd: MaximallySplittingCommand, benchmark_recorder: BenchmarkRecorder,
+                              speculos_globals, enable_slow_tests: bool, n_keys: int, base_size: Tuple[int, int],
+                              size: Tuple[int, int]):
+    if (n_keys, base_size, size) in SLOW_SIGN_PSBT_CASES and not enable_slow_tests:
+        pytest.skip("Requires --enableslowtests")
+
+    wallet, wallet_hmac = make_multisig_wallet(f"worst-case-sign-psbt-2of{n_keys}", n_keys,
+                                               speculos_globals.wallet_registration_key)
+
+    def run(n_inputs: int, n_outputs: int) -> Costs:
+        name = f"worst-case-sign-psbt-2of{n_keys}-{n_inputs}to{n_outputs}"
+        psbt = generate_psbt(wallet, make_worst_case_psbt_spec(n_inputs, n_outputs), seed=name)
+        result, costs = measure(benchmark_recorder, name, splitting_cmd, splitting_cmd.sign_psbt,
+                                psbt, wallet, wallet_hmac)
+        assert len(result) == n_inputs
+        return costs
+
+    n_inputs, n_outputs = base_size
+    base_costs = run(n_inputs, n_outputs)
+    doubled_costs = [run(2 * n_inputs, n_outputs), run(n_inputs, 2 * n_outputs)]
+    costs = run(*size)
+
+    check_linear_costs(f"SIGN_PSBT with 2of{n_keys} wallet", ["input", "output"], base_size, base_costs,
+                       doubled_costs, size, costs)
+
+
+# base number of keys, and final number of keys (the maximum)
+KEYS_CASE = (3, 15)
+
+
+@automation("automations/register_wallet_accept.json")
+def test_worst_case_register_wallet(splitting_cmd: MaximallySplittingCommand, benchmark_recorder: BenchmarkRecorder,
+                                    speculos_globals):
+    def run(n_keys: int) -> Costs:
+        name = f"worst-case-register-wallet-{n_keys}keys"
+        wallet, wallet_hmac = make_multisig_wallet(name, n_keys, speculos_globals.wallet_registration_key)
+
+        result, costs = measure(benchmark_recorder, name, splitting_cmd, splitting_cmd.register_wallet, wallet)
+        assert result == (wallet.id, wallet_hmac)
+        return costs
+
+    base_keys, n_keys = KEYS_CASE
+    base_costs = run(base_keys)
+    doubled_costs = [run(2 * base_keys)]
+    costs = run(n_keys)
+
+    check_linear_costs("REGISTER_WALLET", ["key"], (base_keys,), base_costs, doubled_costs, (n_keys,), costs)
+
+
+def test_worst_case_get_wallet_address(splitting_cmd: MaximallySplittingCommand,
+                                       benchmark_recorder: BenchmarkRecorder, speculos_globals):
+    def run(n_keys: int) -> Costs:
+        name = f"worst-case-get-wallet-address-{n_keys}keys"
+        wallet, wallet_hmac = make_multisig_wallet(name, n_keys, speculos_globals.wallet_registration_key)
+
+        # the largest address index, for a change address
+        _, costs = measure(benchmark_recorder, name, splitting_cmd, splitting_cmd.get_wallet_address,
+                           wallet, wallet_hmac, 1, 2**31 - 1, False)
+        return costs
+
+    base_keys, n_keys = KEYS_CASE
+    base_costs = run(base_keys)
+    doubled_costs = [run(2 * base_keys)]
+    costs = run(n_keys)
+
+    check_linear_costs("GET_WALLET_ADDRESS", ["key"], (base_keys,), base_costs, doubled_costs, (n_keys,), costs)
+
+
+@automation("automations/sign_with_wallet_accept.json")
+def test_get_more_elements_without_progress_sign_psbt(stalling_cmd: MaximallySplittingCommand, speculos_globals):
+    # a host that never completes a preimage or a proof can not keep the device busy
+    wallet, wallet_hmac = make_multisig_wallet("stalling-sign-psbt", 3, speculos_globals.wallet_registration_key)
+    psbt = generate_psbt(wallet, make_worst_case_psbt_spec(2, 4), seed="stalling-sign-psbt")
+
+    with pytest.raises((IncorrectDataError, BadStateError)):
+        stalling_cmd.sign_psbt(psbt, wallet, wallet_hmac)
+
+    assert stalling_cmd.n_stalled_responses == 1
+
+
+def test_get_more_elements_without_progress_get_wallet_address(stalling_cmd: MaximallySplittingCommand,
+                                                               speculos_globals):
+    wallet, wallet_hmac = make_multisig_wallet("stalling-get-wallet-address", 15,
+                                               speculos_globals.wallet_registration_key)
+
+    with pytest.raises((IncorrectDataError, BadStateError)):
+        stalling_cmd.get_wallet_address(wallet, wallet_hmac, 0, 0, False)
+
+    assert stalling_cmd.n_stalled_responses == 1
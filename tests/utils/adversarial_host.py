@@ -0,0 +1,101 @@
+"""
+Hosts that answer the client commands of the hardware wallet in the most expensive way that the protocol allows, to
+measure the worst-case costs of the commands.
+"""
+
+from collections import deque
+from typing import List, Optional
+
+from bitcoin_client.client_command import ClientCommandCode, ClientCommandInterpreter
+from bitcoin_client.common import ByteStreamParser, write_varint
+
+from .benchmark import CountingBitcoinCommand
+
+# Number of empty GET_MORE_ELEMENTS responses after which the stalling host gives up: the hardware wallet should reject
+# the first one, as it would never complete the data it is receiving.
+MAX_STALLED_RESPONSES = 16
+
+
+def _requeue(queue: "deque[bytes]", elements: List[bytes]) -> None:
+    """Puts the elements at the front of the queue, in order."""
+    queue.extendleft(reversed(elements))
+
+
+def _split(data: bytes, element_len: int) -> List[bytes]:
+    return [data[i: i + element_len] for i in range(0, len(data), element_len)]
+
+
+class MaximallySplittingCommand(CountingBitcoinCommand):
+    """CountingBitcoinCommand for a host that splits the responses to the client commands as much as the protocol
+    allows: the response to GET_PREIMAGE, GET_MERKLE_LEAF_PROOF, GET_MERKLE_LEAVES_PROOF, GET_MERKLEIZED_MAP_VALUE and
+    GET_PREIMAGES only contains its first element (byte or hash), each GET_MORE_ELEMENTS response contains a single
+    element, nothing is pushed in advance, and the BATCH requests are never answered (so the hardware wallet sends each
+    request individually).
+
+    With stall=True, the host answers GET_MORE_ELEMENTS with no elements instead, which never makes progress; the
+    number of these responses is counted in n_stalled_responses.
+    """
+
+    def __init__(self, *args, stall: bool = False, **kwargs) -> None:
+        self.stall = stall
+        super().__init__(*args, **kwargs)
+
+    def reset_counters(self) -> None:
+        super().reset_counters()
+        self.n_stalled_responses = 0
+
+    def continue_apdu(self, response: bytes, client_intepreter: Optional[ClientCommandInterpreter]) -> dict:
+        if not client_intepreter:
+            raise RuntimeError("Unexpected SW_INTERRUPTED_EXECUTION received.")
+
+        return self.builder.continue_interrupted(self._execute_split(client_intepreter, response))
+
+    def _execute_split(self, interpreter: ClientCommandInterpreter, request: bytes) -> bytes:
+        code = request[0]
+        queue = interpreter.queue
+
+        if code == ClientCommandCode.GET_MORE_ELEMENTS:
+            if len(queue) == 0:
+                raise ValueError("No elements to get.")
+            element_len = len(queue[0])
+            if self.stall:
+                self.n_stalled_responses += 1
+                if self.n_stalled_responses > MAX_STALLED_RESPONSES:
+                    raise RuntimeError("The hardware wallet accepts GET_MORE_ELEMENTS responses without elements")
+                return bytes([0, element_len])
+            return bytes([1, element_len]) + queue.popleft()
+
+        if code == ClientCommandCode.BATCH:
+            return b""
+
+        response = interpreter.execute(request)
+
+        if code == ClientCommandCode.GET_PREIMAGE:
+            # length of the preimage, length of the partial preimage, partial preimage
+            preimage_len = ByteStreamParser(response).read_varint()
+            prefix_len = len(write_varint(preimage_len))
+            partial = response[prefix_len + 1:]
+            if len(partial) <= 1:
+                return response
+            _requeue(queue, _split(partial[1:], 1))
+            return response[:prefix_len] + b"\x01" + partial[:1]
+        elif code == ClientCommandCode.GET_MERKLE_LEAF_PROOF:
+            # leaf hash, length of the proof, number of elements in the response, elements
+            elements = response[34:]
+            if len(elements) <= 32:
+                return response
+            _requeue(queue, _split(elements[32:], 32))
+            return response[:33] + b"\x01" + elements[:32]
+        elif code == ClientCommandCode.GET_MERKLE_LEAVES_PROOF:
+            # length of the proof, number of elements in the response, elements (leaves, then proof)
+            elements = response[2:]
+            if len(elements) <= 32:
+                return response
+            _requeue(queue, _split(elements[32:], 32))
+            return response[:1] + b"\x01" + elements[:32]
+        elif code in (ClientCommandCode.GET_MERKLEIZED_MAP_VALUE, ClientCommandCode.GET_PREIMAGES):
+            # the whole response is split in single bytes
+            _requeue(queue, _split(response[1:], 1))
+            return response[:1]
+
+        return response
@@ -0,0 +1,152 @@
+import json
+import re
+import time
+
+from dataclasses import dataclass, asdict
+from typing import Dict, List, Optional, Tuple
+
+from bitcoin_client.command import BitcoinCommand
+from tests.utils.transcript import Exchange, replay_requests
+
+
+class CountingBitcoinCommand(BitcoinCommand):
+    """BitcoinCommand that counts the APDUs exchanged with the device, and the bytes in each direction.
+
+    The sent bytes include the 5-byte APDU header; the received bytes include the 2-byte status word.
+    """
+
+    def __init__(self, *args, **kwargs) -> None:
+        super().__init__(*args, **kwargs)
+        self.reset_counters()
+
+    def reset_counters(self) -> None:
+        self.n_apdus = 0
+        self.bytes_sent = 0
+        self.bytes_received = 0
+
+    def _apdu_exchange(self, apdu: dict) -> Tuple[int, bytes]:
+        sw, response = super()._apdu_exchange(apdu)
+
+        self.n_apdus += 1
+        self.bytes_sent += 5 + len(apdu["data"])
+        self.bytes_received += len(response) + 2
+
+        return sw, response
+
+
+@dataclass
+class BenchmarkResult:
+    wall_time: float
+    n_apdus: int
+    bytes_sent: int
+    bytes_received: int
+    # counters of GET_APP_STATS for the same run, if the app is compiled with APP_STATS=1
+    device_counters: Optional[Dict[str, int]] = None
+
+
+class BenchmarkRecorder:
+    """Collects the results of the benchmarks, and compares them with a baseline report."""
+
+    def __init__(self) -> None:
+        self.results: Dict[str, BenchmarkResult] = {}
+
+    def measure(self, name: str, cmd: CountingBitcoinCommand, fn, *args, **kwargs):
+        """Runs fn(*args, **kwargs), recording the elapsed time and the APDUs exchanged by cmd under name.
+
+        Returns the return value of fn.
+        """
+        cmd.reset_counters()
+        start = time.perf_counter()
+        ret = fn(*args, **kwargs)
+        wall_time = time.perf_counter() - start
+
+        self.results[name] = BenchmarkResult(wall_time, cmd.n_apdus, cmd.bytes_sent, cmd.bytes_received)
+
+        return ret
+
+    def measure_replay(self, name: str, client, transcript: List[Exchange]) -> None:
+        """Sends the requests of a recorded transcript to the device with `replay_requests`, recording under name the
+        time spent in the device only, and the APDUs of the transcript."""
+        wall_time = replay_requests(client, transcript)
+
+        self.results[name] = BenchmarkResult(
+            wall_time,
+            len(transcript),
+            sum(5 + len(exchange.data) // 2 for exchange in transcript),
+            sum(len(exchange.response) // 2 + 2 for exchange in transcript)
+        )
+
+    def record_device_counters(self, name: str, counters: Dict[str, int]) -> None:
+        """Adds the counters returned by GET_APP_STATS to the result recorded under name."""
+        self.results[name].device_counters = counters
+
+    def to_json(self) -> str:
+        return json.dumps({name: asdict(res) for name, res in sorted(self.results.items())}, indent=2)
+
+    def save(self, path: str) -> None:
+        with open(path, "w") as f:
+            f.write(self.to_json())
+
+    def scaling_curves(self) -> List[str]:
+        """Returns a human-readable line for each series of results named "scaling-<series>-<value>", with the wall
+        time and the number of APDUs for each value, in increasing order of value."""
+        series: Dict[str, List[Tuple[int, BenchmarkResult]]] = {}
+        for name, res in self.results.items():
+            match = re.fullmatch(r"scaling-(.+)-(\d+)", name)
+            if match is not None:
+                series.setdefault(match.group(1), []).append((int(match.group(2)), res))
+
+        lines: List[str] = []
+        for name, points in sorted(series.items()):
+            lines.append(f"{name}: " + ", ".join(
+                f"{value} -> {res.wall_time:.2f}s/{res.n_apdus} apdus" for value, res in sorted(points)
+            ))
+        return lines
+
+    def protocol_comparison(self) -> List[str]:
+        """Returns a human-readable line for each case that was signed with both protocols, that is, whose results are
+        named "protocols-legacy-<case>" and "protocols-psbt-<case>", with the ratios of the new protocol to the legacy
+        one; the lines of the cases where SIGN_PSBT is slower, or exchanges more APDUs, are marked."""
+        lines: List[str] = []
+        for name, legacy in sorted(self.results.items()):
+            match = re.fullmatch(r"protocols-legacy-(.+)", name)
+            psbt = self.results.get(f"protocols-psbt-{match.group(1)}") if match is not None else None
+            if psbt is None:
+                continue
+
+            time_ratio = psbt.wall_time / legacy.wall_time if legacy.wall_time > 0 else float("inf")
+            slower = time_ratio > 1 or psbt.n_apdus > legacy.n_apdus
+            lines.append(
+                f"{match.group(1)}: "
+                f"legacy {legacy.wall_time:.2f}s/{legacy.n_apdus} apdus/{legacy.bytes_sent + legacy.bytes_received}B, "
+                f"psbt {psbt.wall_time:.2f}s/{psbt.n_apdus} apdus/{psbt.bytes_sent + psbt.bytes_received}B, "
+                f"time x{time_ratio:.2f}" + (" (SLOWER)" if slower else "")
+            )
+        return lines
+
+    def compare(self, baseline_path: str) -> List[str]:
+        """Returns a human-readable line for each benchmark that is also present in the baseline report.
+
+        APDU count and bytes are deterministic for a given PSBT, so any difference is reported; the wall time is
+        reported as a ratio, as it depends on the machine running the tests.
+        """
+        with open(baseline_path, "r") as f:
+            baseline: Dict[str, BenchmarkResult] = {
+                name: BenchmarkResult(**res) for name, res in json.load(f).items()
+            }
+
+        lines: List[str] = []
+        for name, res in sorted(self.results.items()):
+            base: Optional[BenchmarkResult] = baseline.get(name)
+            if base is None:
+                lines.append(f"{name}: not in baseline")
+                continue
+
+            time_ratio = res.wall_time / base.wall_time if base.wall_time > 0 else float("inf")
+            lines.append(
+                f"{name}: time x{time_ratio:.2f}, "
+                f"apdus {res.n_apdus - base.n_apdus:+d}, "
+                f"sent {res.bytes_sent - base.bytes_sent:+d}B, "
+                f"received {res.bytes_received - base.bytes_received:+d}B"
+            )
+        return lines
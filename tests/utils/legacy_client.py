@@ -0,0 +1,106 @@
+import importlib
+import sys
+
+from pathlib import Path
+from types import ModuleType
+from typing import List, Tuple
+
+from bitcoin_client.command import ApduException
+from bitcoin_client.psbt import PSBT
+
+# the client of the legacy protocol, used by the tests in tests-legacy
+LEGACY_TESTS_PATH = Path(__file__).parent.parent.parent / "tests-legacy"
+
+
+def load_legacy_client() -> Tuple[ModuleType, ModuleType]:
+    """Imports the `bitcoin_cmd` and the `hwi.serialization` modules of the legacy client.
+
+    Both clients are packages named `bitcoin_client`: the modules of the client of the new protocol are removed from
+    sys.modules while the legacy client is imported, and restored afterwards. The legacy modules keep the references to
+    the ones they imported, so they can be used alongside the client of the new protocol.
+    """
+    def take_modules():
+        names = [name for name in sys.modules if name == "bitcoin_client" or name.startswith("bitcoin_client.")]
+        return {name: sys.modules.pop(name) for name in names}
+
+    saved = take_modules()
+    sys.path.insert(0, str(LEGACY_TESTS_PATH))
+    try:
+        bitcoin_cmd = importlib.import_module("bitcoin_client.bitcoin_cmd")
+        serialization = importlib.import_module("bitcoin_client.hwi.serialization")
+    finally:
+        sys.path.remove(str(LEGACY_TESTS_PATH))
+        take_modules()
+        sys.modules.update(saved)
+    return bitcoin_cmd, serialization
+
+
+class CountingLegacyTransport:
+    """The subset of the ledgercomm Transport used by the legacy client, on top of a client of these tests (for
+    example, SpeculosClient). Like CountingBitcoinCommand, it counts the APDUs and the bytes in each direction."""
+
+    def __init__(self, client) -> None:
+        self.client = client
+        self.reset_counters()
+        self._pending = None
+
+    def reset_counters(self) -> None:
+        self.n_apdus = 0
+        self.bytes_sent = 0
+        self.bytes_received = 0
+
+    def exchange(self, cla: int, ins: int, p1: int = 0, p2: int = 0, option=None, cdata: bytes = b"") -> Tuple[int, bytes]:
+        try:
+            sw, response = 0x9000, self.client.apdu_exchange(cla, ins, cdata, p1, p2)
+        except ApduException as e:
+            sw, response = e.sw, e.data
+
+        self.n_apdus += 1
+        self.bytes_sent += 5 + len(cdata)
+        self.bytes_received += len(response) + 2
+        return sw, response
+
+    def exchange_raw(self, apdu: bytes) -> Tuple[int, bytes]:
+        cla, ins, p1, p2, lc = apdu[:5]
+        return self.exchange(cla, ins, p1, p2, None, apdu[5:5 + lc])
+
+    def send_raw(self, apdu: bytes) -> None:
+        self._pending = apdu
+
+    def recv(self) -> Tuple[int, bytes]:
+        apdu, self._pending = self._pending, None
+        return self.exchange_raw(apdu)
+
+
+def path_string(path: List[int]) -> str:
+    return "m" + "".join(f"/{step & 0x7FFFFFFF}" + ("'" if step & 0x80000000 else "") for step in path)
+
+
+def legacy_sign_psbt(legacy_cmd, serialization: ModuleType, psbt: PSBT) -> list:
+    """Signs the inputs of a PSBT of a single-signature segwit v0 wallet (wpkh or sh(wpkh)) with the legacy protocol:
+    GET_TRUSTED_INPUT for each input, then UNTRUSTED_HASH_TRANSACTION_INPUT_START/FINALIZE and UNTRUSTED_HASH_SIGN.
+
+    The change output is the first output with a BIP32 derivation, if any. Returns the signatures of the inputs.
+    """
+    tx = serialization.CTransaction.from_bytes(psbt.tx.serialize_without_witness())
+
+    utxos = []
+    sign_paths = []
+    for i, psbt_in in enumerate(psbt.inputs):
+        prevout = serialization.CTransaction.from_bytes(psbt_in.non_witness_utxo.serialize_without_witness())
+        output_index = tx.vin[i].prevout.n
+        utxos.append((prevout, output_index, prevout.vout[output_index].nValue))
+
+        (pubkey, origin), = psbt_in.hd_keypaths.items()
+        sign_paths.append(path_string(origin.path))
+        # the scriptCode of BIP-143 for a P2WPKH is the one of the P2PKH of the same key
+        tx.vin[i].scriptSig = b"\x76\xa9\x14" + serialization.hash160(pubkey) + b"\x88\xac"
+
+    change_path = None
+    for psbt_out in psbt.outputs:
+        if len(psbt_out.hd_keypaths) > 0:
+            (_, origin), = psbt_out.hd_keypaths.items()
+            change_path = path_string(origin.path)
+            break
+
+    return legacy_cmd.sign_tx(tx, change_path, sign_paths, utxos)
@@ -0,0 +1,217 @@
+"""
+Generator of large synthetic PSBTs for load testing, deterministic for a given seed.
+
+Unlike `txmaker.createPsbt`, the shape of the PSBT is fully controlled by a `PsbtSpec`: number of inputs and outputs,
+number of change outputs, size of the non-witness parent transactions, external outputs with mixed script types, and
+foreign derivations (keys of other wallets, with assorted fingerprints and paths) in the inputs and outputs. All the
+inputs are spent from the given wallet, so that the hardware wallet signs all of them.
+
+With decoy_keypaths, the external outputs also have the derivations of the keys of the wallet at some change address;
+together with mixed_outputs=False (so that they pay to another address of the wallet), they are the most expensive
+external outputs to classify, as the hardware wallet must derive the script of the wallet to tell them apart.
+"""
+
+import random
+
+from dataclasses import dataclass
+from typing import List
+
+from bitcoin_client.key import KeyOriginInfo, parse_path
+from bitcoin_client.psbt import PSBT, PartiallySignedInput, PartiallySignedOutput
+from bitcoin_client.tx import CScriptWitness, CTransaction, CTxIn, CTxInWitness, CTxOut, COutPoint, CTxWitness
+from bitcoin_client.tx import uint256_from_str
+from bitcoin_client.wallet import PolicyMapWallet
+
+from embit.ec import PrivateKey
+
+from .txmaker import getDescriptorFromWallet, getKeypathsFromWallet
+
+# script types of the external outputs, used in turn when mixed_outputs is set
+FOREIGN_SCRIPT_TYPES = ["pkh", "sh", "wpkh", "wsh", "tr"]
+
+# paths of the foreign derivations, used in turn; {a} is a random account, {i} a random address index
+FOREIGN_PATHS = [
+    "m/44'/1'/{a}'/0/{i}",
+    "m/49'/1'/{a}'/1/{i}",
+    "m/84'/1'/{a}'/0/{i}",
+    "m/86'/1'/{a}'/1/{i}",
+    "m/48'/1'/{a}'/2'/0/{i}",
+    "m/{a}/{i}",
+    "m/0'/0'/{a}'/5/7/{i}",
+]
+
+
+@dataclass
+class PsbtSpec:
+    n_inputs: int
+    n_outputs: int
+    n_change: int = 1             # the first n_change outputs are change outputs of the wallet
+    parent_inputs: int = 1        # number of inputs of each non-witness parent transaction
+    parent_outputs: int = 2       # number of outputs of each non-witness parent transaction
+    mixed_outputs: bool = True    # external outputs pay to scripts of all the FOREIGN_SCRIPT_TYPES in turn
+    foreign_keypaths: int = 0     # number of foreign derivations added to each input and output
+    decoy_keypaths: bool = False  # external outputs have derivations of the wallet's keys (see generate_psbt)
+
+
+def _random_bytes(rng: random.Random, n: int) -> bytes:
+    return bytes(rng.getrandbits(8) for _ in range(n))
+
+
+def _foreign_script(rng: random.Random, script_type: str) -> bytes:
+    if script_type == "pkh":
+        return b"\x76\xa9\x14" + _random_bytes(rng, 20) + b"\x88\xac"
+    elif script_type == "sh":
+        return b"\xa9\x14" + _random_bytes(rng, 20) + b"\x87"
+    elif script_type == "wpkh":
+        return b"\x00\x14" + _random_bytes(rng, 20)
+    elif script_type == "wsh":
+        return b"\x00\x20" + _random_bytes(rng, 32)
+    elif script_type == "tr":
+        return b"\x51\x20" + _random_bytes(rng, 32)
+    raise ValueError(f"Unknown script type: {script_type}")
+
+
+def _foreign_keypath(rng: random.Random, k: int) -> KeyOriginInfo:
+    path = FOREIGN_PATHS[k % len(FOREIGN_PATHS)].format(a=rng.randint(0, 10), i=rng.randint(0, 100_000))
+    return KeyOriginInfo(_random_bytes(rng, 4), parse_path(path))
+
+
+def _foreign_pubkey(rng: random.Random) -> bytes:
+    return PrivateKey(_random_bytes(rng, 32)).get_public_key().sec()
+
+
+def _add_foreign_keypaths(rng: random.Random, psbt_map, n: int, is_taproot: bool) -> None:
+    for k in range(n):
+        pubkey, origin = _foreign_pubkey(rng), _foreign_keypath(rng, k)
+        if is_taproot:
+            psbt_map.tap_hd_keypaths[pubkey[1:]] = (list(), origin)
+        else:
+            psbt_map.hd_keypaths[pubkey] = origin
+
+
+def _make_parent(rng: random.Random, spec: PsbtSpec, output_index: int, output: CTxOut,
+                 is_segwit: bool) -> CTransaction:
+    """Returns a (fake) transaction with spec.parent_inputs inputs and spec.parent_outputs outputs, whose output at
+    output_index is the given one."""
+    tx = CTransaction()
+    tx.nVersion = 2
+    tx.nLockTime = 0
+
+    for _ in range(spec.parent_inputs):
+        txin = CTxIn()
+        txin.prevout = COutPoint(uint256_from_str(_random_bytes(rng, 32)), rng.randint(0, 20))
+        txin.nSequence = 0xfffffffd
+        txin.scriptSig = b"" if is_segwit else _random_bytes(rng, 107)  # dummy
+        tx.vin.append(txin)
+
+    for i in range(spec.parent_outputs):
+        if i == output_index:
+            tx.vout.append(output)
+        else:
+            script_type = FOREIGN_SCRIPT_TYPES[i % len(FOREIGN_SCRIPT_TYPES)]
+            tx.vout.append(CTxOut(rng.randint(1_000, 100_000_000), _foreign_script(rng, script_type)))
+
+    tx.wit = CTxWitness()
+    if is_segwit:
+        for _ in range(spec.parent_inputs):
+            script_wit = CScriptWitness()
+            script_wit.stack = [_random_bytes(rng, 72), _random_bytes(rng, 33)]  # dummy
+            in_wit = CTxInWitness()
+            in_wit.scriptWitness = script_wit
+            tx.wit.vtxinwit.append(in_wit)
+
+    tx.rehash()
+    return tx
+
+
+def generate_psbt(wallet: PolicyMapWallet, spec: PsbtSpec, seed: str) -> PSBT:
+    """Returns a PSBT of version 0 spending spec.n_inputs coins of wallet (any policy supported by txmaker), with the
+    shape described by spec. The same wallet, spec and seed always give the same PSBT."""
+    if spec.n_inputs <= 0 or spec.n_outputs <= 0 or not 0 <= spec.n_change <= spec.n_outputs:
+        raise ValueError("Invalid number of inputs or outputs")
+    if spec.parent_inputs <= 0 or spec.parent_outputs <= 0:
+        raise ValueError("Invalid size of the parent transactions")
+
+    rng = random.Random(seed)
+
+    is_taproot = wallet.policy_map.startswith("tr(")
+    is_segwitv0 = wallet.policy_map.startswith(("wpkh(", "wsh(", "sh(wpkh(", "sh(wsh("))
+    has_redeem_script = wallet.policy_map.startswith("sh(")
+    has_witness_script = "wsh(" in wallet.policy_map
+
+    input_amounts = [rng.randint(100_000, 10_000_000) for _ in range(spec.n_inputs)]
+    output_total = sum(input_amounts) - 1_000 * spec.n_inputs  # what is left is the fee
+    output_amounts = [output_total // spec.n_outputs] * spec.n_outputs
+
+    psbt = PSBT()
+    psbt.version = 0
+    psbt.inputs = [PartiallySignedInput() for _ in range(spec.n_inputs)]
+    psbt.outputs = [PartiallySignedOutput() for _ in range(spec.n_outputs)]
+
+    tx = CTransaction()
+    tx.nVersion = 2
+    tx.nLockTime = 0
+    tx.wit = CTxWitness()
+
+    for i in range(spec.n_inputs):
+        change, address_index = rng.randint(0, 1), rng.randint(0, 10_000)
+        descriptor = getDescriptorFromWallet(wallet, change, address_index)
+
+        prevout_index = rng.randint(0, spec.parent_outputs - 1)
+        prevout = CTxOut(input_amounts[i], descriptor.script_pubkey().data)
+        parent = _make_parent(rng, spec, prevout_index, prevout, is_segwitv0 or is_taproot)
+
+        txin = CTxIn()
+        txin.prevout = COutPoint(parent.sha256, prevout_index)
+        txin.scriptSig = b""
+        txin.nSequence = 0xfffffffd
+        tx.vin.append(txin)
+
+        if not is_taproot:
+            psbt.inputs[i].non_witness_utxo = parent
+        if is_segwitv0 or is_taproot:
+            psbt.inputs[i].witness_utxo = prevout
+        if has_redeem_script:
+            psbt.inputs[i].redeem_script = descriptor.redeem_script().data
+        if has_witness_script:
+            psbt.inputs[i].witness_script = descriptor.witness_script().data
+
+        for pubkey, origin in getKeypathsFromWallet(wallet, change, address_index).items():
+            if is_taproot:
+                psbt.inputs[i].tap_hd_keypaths[pubkey[1:]] = (list(), origin)
+            else:
+                psbt.inputs[i].hd_keypaths[pubkey] = origin
+        _add_foreign_keypaths(rng, psbt.inputs[i], spec.foreign_keypaths, is_taproot)
+
+    for i in range(spec.n_outputs):
+        if i < spec.n_change:
+            address_index = rng.randint(0, 10_000)
+            script = getDescriptorFromWallet(wallet, True, address_index).script_pubkey().data
+            for pubkey, origin in getKeypathsFromWallet(wallet, True, address_index).items():
+                if is_taproot:
+                    psbt.outputs[i].tap_hd_keypaths[pubkey[1:]] = (list(), origin)
+                else:
+                    psbt.outputs[i].hd_keypaths[pubkey] = origin
+        elif spec.mixed_outputs:
+            script = _foreign_script(rng, FOREIGN_SCRIPT_TYPES[i % len(FOREIGN_SCRIPT_TYPES)])
+        else:
+            # an address of the wallet, but without derivation: it is external for the hardware wallet
+            script = getDescriptorFromWallet(wallet, False, rng.randint(0, 10_000)).script_pubkey().data
+        if i >= spec.n_change and spec.decoy_keypaths:
+            # only deriving the script of the wallet at this path tells that the output is external
+            for pubkey, origin in getKeypathsFromWallet(wallet, True, rng.randint(0, 10_000)).items():
+                if is_taproot:
+                    psbt.outputs[i].tap_hd_keypaths[pubkey[1:]] = (list(), origin)
+                else:
+                    psbt.outputs[i].hd_keypaths[pubkey] = origin
+        _add_foreign_keypaths(rng, psbt.outputs[i], spec.foreign_keypaths, is_taproot)
+
+        tx.vout.append(CTxOut(output_amounts[i], script))
+
+    psbt.tx = tx
+    return psbt
+
+
+def input_sizes(psbt: PSBT) -> List[int]:
+    """Returns the size in bytes of the serialized non-witness UTXO of each input (0 if missing)."""
+    return [len(inp.non_witness_utxo.serialize()) if inp.non_witness_utxo is not None else 0 for inp in psbt.inputs]
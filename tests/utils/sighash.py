@@ -0,0 +1,82 @@
+"""
+Legacy and BIP-143 (segwit v0) sighashes for all the sighash types, to verify the signatures returned by the device.
+"""
+
+import struct
+
+from bitcoin_client._serialize import ser_compact_size, ser_string
+from bitcoin_client.common import hash256
+from bitcoin_client.tx import CTransaction, CTxOut
+
+SIGHASH_ALL = 0x01
+SIGHASH_NONE = 0x02
+SIGHASH_SINGLE = 0x03
+SIGHASH_ANYONECANPAY = 0x80
+
+
+def legacy_sighash(tx: CTransaction, input_index: int, script_code: bytes, sighash_type: int) -> bytes:
+    """Returns the legacy sighash of the input, where script_code is the scriptPubKey of the prevout (or the
+    redeemScript). With SIGHASH_SINGLE, the input must have an output with the same index."""
+
+    base_type = sighash_type & 0x1f
+    anyone_can_pay = (sighash_type & SIGHASH_ANYONECANPAY) != 0
+
+    r = struct.pack("<i", tx.nVersion)
+
+    input_indexes = [input_index] if anyone_can_pay else range(len(tx.vin))
+    r += ser_compact_size(len(input_indexes))
+    for i in input_indexes:
+        txin = tx.vin[i]
+        r += txin.prevout.serialize()
+        r += ser_string(script_code if i == input_index else b"")
+        commits_to_sequence = i == input_index or base_type not in [SIGHASH_NONE, SIGHASH_SINGLE]
+        r += struct.pack("<I", txin.nSequence if commits_to_sequence else 0)
+
+    if base_type == SIGHASH_NONE:
+        outputs = []
+    elif base_type == SIGHASH_SINGLE:
+        outputs = [CTxOut(-1, b"") for _ in range(input_index)] + [tx.vout[input_index]]
+    else:
+        outputs = tx.vout
+    r += ser_compact_size(len(outputs))
+    for txout in outputs:
+        r += txout.serialize()
+
+    r += struct.pack("<I", tx.nLockTime)
+    r += struct.pack("<I", sighash_type)
+    return hash256(r)
+
+
+def segwit_v0_sighash(tx: CTransaction, input_index: int, script_code: bytes, amount: int, sighash_type: int) -> bytes:
+    """Returns the BIP-143 sighash of the input, where script_code is the scriptCode of the spent witness program."""
+
+    base_type = sighash_type & 0x1f
+    anyone_can_pay = (sighash_type & SIGHASH_ANYONECANPAY) != 0
+
+    hash_prevouts = bytes(32)
+    if not anyone_can_pay:
+        hash_prevouts = hash256(b"".join(txin.prevout.serialize() for txin in tx.vin))
+
+    hash_sequence = bytes(32)
+    if not anyone_can_pay and base_type not in [SIGHASH_NONE, SIGHASH_SINGLE]:
+        hash_sequence = hash256(b"".join(struct.pack("<I", txin.nSequence) for txin in tx.vin))
+
+    hash_outputs = bytes(32)
+    if base_type not in [SIGHASH_NONE, SIGHASH_SINGLE]:
+        hash_outputs = hash256(b"".join(txout.serialize() for txout in tx.vout))
+    elif base_type == SIGHASH_SINGLE and input_index < len(tx.vout):
+        hash_outputs = hash256(tx.vout[input_index].serialize())
+
+    txin = tx.vin[input_index]
+
+    r = struct.pack("<i", tx.nVersion)
+    r += hash_prevouts
+    r += hash_sequence
+    r += txin.prevout.serialize()
+    r += ser_string(script_code)
+    r += struct.pack("<q", amount)
+    r += struct.pack("<I", txin.nSequence)
+    r += hash_outputs
+    r += struct.pack("<I", tx.nLockTime)
+    r += struct.pack("<I", sighash_type)
+    return hash256(r)
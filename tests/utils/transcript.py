@@ -0,0 +1,113 @@
+import json
+import time
+
+from dataclasses import dataclass, asdict
+from pathlib import Path
+from typing import List
+
+from bitcoin_client.command import ApduException
+
+
+@dataclass
+class Exchange:
+    """An APDU sent to the device, its response and status word, and the time the device took to respond."""
+    cla: int
+    ins: int
+    p1: int
+    p2: int
+    data: str  # hex
+    sw: int
+    response: str  # hex
+    time: float  # seconds
+
+    def request(self) -> dict:
+        return dict(cla=self.cla, ins=self.ins, p1=self.p1, p2=self.p2, data=bytes.fromhex(self.data))
+
+
+def load_transcript(path: Path) -> List[Exchange]:
+    with open(path, "r") as f:
+        return [Exchange(**exchange) for exchange in json.load(f)]
+
+
+def save_transcript(path: Path, transcript: List[Exchange]) -> None:
+    path.parent.mkdir(parents=True, exist_ok=True)
+    with open(path, "w") as f:
+        json.dump([asdict(exchange) for exchange in transcript], f, indent=1)
+
+
+class RecordingClient:
+    """Client that forwards the APDUs to another client (for example, SpeculosClient), and records the transcript of
+    all the exchanges."""
+
+    def __init__(self, client) -> None:
+        self.client = client
+        self.transcript: List[Exchange] = []
+
+    def apdu_exchange(self, cla: int, ins: int, data: bytes = b"", p1: int = 0, p2: int = 0) -> bytes:
+        start = time.perf_counter()
+        try:
+            sw, response = 0x9000, self.client.apdu_exchange(cla=cla, ins=ins, data=data, p1=p1, p2=p2)
+        except ApduException as e:
+            sw, response = e.sw, e.data
+        elapsed = time.perf_counter() - start
+
+        self.transcript.append(Exchange(cla, ins, p1, p2, data.hex(), sw, response.hex(), elapsed))
+
+        if sw != 0x9000:
+            raise ApduException(sw, response)
+        return response
+
+    def stop(self) -> None:
+        self.client.stop()
+
+
+class ReplayClient:
+    """Client that answers with the responses of a recorded transcript, without any device.
+
+    As the device costs nothing, running a test with it measures the work done by the client only. The requests must
+    be the same as the recorded ones, in the same order: a test whose requests are not deterministic can not be
+    replayed.
+    """
+
+    def __init__(self, transcript: List[Exchange]) -> None:
+        self.transcript = transcript
+        self.position = 0
+
+    def apdu_exchange(self, cla: int, ins: int, data: bytes = b"", p1: int = 0, p2: int = 0) -> bytes:
+        if self.position >= len(self.transcript):
+            raise RuntimeError(f"Apdu {self.position} is not in the transcript")
+
+        exchange = self.transcript[self.position]
+        if exchange.request() != dict(cla=cla, ins=ins, p1=p1, p2=p2, data=data):
+            raise RuntimeError(f"Apdu {self.position} differs from the transcript")
+        self.position += 1
+
+        response = bytes.fromhex(exchange.response)
+        if exchange.sw != 0x9000:
+            raise ApduException(exchange.sw, response)
+        return response
+
+    def stop(self) -> None:
+        pass
+
+
+def replay_requests(client, transcript: List[Exchange]) -> float:
+    """Sends the requests of a recorded transcript to the device, without running the client.
+
+    Returns the total time spent waiting for the device, which no longer includes any work of the client, nor the
+    time to compute its responses. Only the status words are compared with the transcript, as not all signatures are
+    deterministic.
+    """
+    device_time = 0.0
+    for i, exchange in enumerate(transcript):
+        start = time.perf_counter()
+        try:
+            sw = 0x9000
+            client.apdu_exchange(**exchange.request())
+        except ApduException as e:
+            sw = e.sw
+        device_time += time.perf_counter() - start
+
+        if sw != exchange.sw:
+            raise RuntimeError(f"Apdu {i}: status word {sw:04x} instead of {exchange.sw:04x}")
+    return device_time
@@ -1,6 +1,8 @@
+import re
+
 from random import randint
 
-from typing import List, Tuple
+from typing import Dict, List, Tuple
 from bitcoin_client.key import KeyOriginInfo, parse_path
 from bitcoin_client.psbt import PSBT, PartiallySignedInput, PartiallySignedOutput
 from bitcoin_client.tx import CScriptWitness, CTransaction, CTxIn, CTxInWitness, CTxOut, COutPoint, CTxWitness, uint256_from_str
@@ -10,6 +12,7 @@ from embit.descriptor import Descriptor
 from embit.script import Script
 from embit.bip32 import HDKey
 from embit.bip39 import mnemonic_to_seed
+from embit.networks import NETWORKS
 
 SPECULOS_SEED = "glory promote mansion idle axis finger extra february uncover one trip resource lawn turtle enact monster seven myth punch hobby comfort wild raise skin"
 master_key = HDKey.from_seed(mnemonic_to_seed(SPECULOS_SEED))
@@ -38,13 +41,13 @@ def random_txid() -> bytes:
     return random_bytes(32)
 
 
-def getScriptPubkeyFromWallet(wallet: PolicyMapWallet, change: bool, address_index: int) -> Script:
+def getDescriptorFromWallet(wallet: PolicyMapWallet, change: bool, address_index: int) -> Descriptor:
     descriptor_str = wallet.policy_map
 
     # Iterate in reverse order, as strings identifying a small-index key (like @1) can be a
     # prefix of substrings identifying a large-index key (like @12), but not the other way around
     # A more structural parsing would be more robust
-    for i, key_info_str in enumerate(reversed(wallet.keys_info)):
+    for i, key_info_str in reversed(list(enumerate(wallet.keys_info))):
         if key_info_str[-3:] != "/**":
             raise ValueError("All the keys must have wildcard (/**)")
 
@@ -55,7 +58,44 @@ def getScriptPubkeyFromWallet(wallet: PolicyMapWallet, change: bool, address_ind
 
         descriptor_str = descriptor_str.replace(f"@{i}", key_info_str)
 
-    return Descriptor.from_string(descriptor_str).derive(address_index).script_pubkey()
+    return Descriptor.from_string(descriptor_str).derive(address_index)
+
+
+def getScriptPubkeyFromWallet(wallet: PolicyMapWallet, change: bool, address_index: int) -> Script:
+    return getDescriptorFromWallet(wallet, change, address_index).script_pubkey()
+
+
+def getKeypathsFromWallet(wallet: PolicyMapWallet, change: bool, address_index: int) -> Dict[bytes, KeyOriginInfo]:
+    """
+    Returns a dictionary mapping each compressed pubkey of the wallet at the given change/address_index to its
+    key origin information. All the keys must have key origin information and wildcard (/**).
+    """
+    result: Dict[bytes, KeyOriginInfo] = {}
+    for key_info_str in wallet.keys_info:
+        if key_info_str[0] != "[" or key_info_str[-3:] != "/**":
+            raise ValueError("All the keys must have key origin information and wildcard (/**)")
+
+        origin_end = key_info_str.index("]")
+        fpr = bytes.fromhex(key_info_str[1:9])
+        origin_path = key_info_str[9:origin_end]
+        xpub = key_info_str[origin_end + 1:-3]
+
+        pubkey: bytes = HDKey.from_base58(xpub).derive([int(change), address_index]).key.sec()
+        assert len(pubkey) == 33
+
+        result[pubkey] = KeyOriginInfo(fpr, parse_path(f"m{origin_path}/{int(change)}/{address_index}"))
+    return result
+
+
+def createCosignerKeyInfo(path: str) -> str:
+    """
+    Returns the key information (with key origin and wildcard) of a random testnet extended pubkey derived at path,
+    for a cosigner different from the speculos seed. Not cryptographically secure.
+    """
+    cosigner_master_key = HDKey.from_seed(random_bytes(32), version=NETWORKS["test"]["xprv"])
+    cosigner_fpr = cosigner_master_key.derive("m/0'").fingerprint
+    xpub = cosigner_master_key.derive(path).to_public().to_base58()
+    return f"[{cosigner_fpr.hex()}{path[1:]}]{xpub}/**"
 
 
 def createFakeWalletTransaction(n_inputs: int, n_outputs: int, output_amount: int, wallet: PolicyMapWallet) -> Tuple[CTransaction, int, int, int]:
@@ -115,11 +155,8 @@ def createPsbt(wallet: PolicyMapWallet, input_amounts: List[int], output_amounts
     assert len(output_amounts) == len(output_is_change)
     assert sum(output_amounts) <= sum(input_amounts)
 
-    # TODO: add support for wrapped segwit wallets
-
-    if wallet.n_keys != 1:
-        raise NotImplementedError("Only 1-key wallets supported")
-    if wallet.policy_map not in ["pkh(@0)", "wpkh(@0)", "tr(@0)"]:
+    if wallet.policy_map not in ["pkh(@0)", "wpkh(@0)", "sh(wpkh(@0))", "tr(@0)"] and \
+            not re.fullmatch(r"(sh|wsh|sh\(wsh)\((sorted)?multi\(\d+(,@\d+)+\)+", wallet.policy_map):
         raise NotImplementedError("Unsupported policy type")
 
     vin: List[CTxIn] = [CTxIn() for _ in input_amounts]
@@ -155,11 +192,12 @@ def createPsbt(wallet: PolicyMapWallet, input_amounts: List[int], output_amounts
     psbt.outputs = [PartiallySignedOutput() for _ in output_amounts]
 
     # simplification; good enough for the scripts we support now, but will need more work
-    is_legacy = "pkh("
-    is_segwitv0 = wallet.policy_map.startswith("wpkh(") or wallet.policy_map.startswith("sh(wpkh(")
     is_taproot = wallet.policy_map.startswith("tr(")
-
-    key_origin = wallet.keys_info[0][1:wallet.keys_info[0].index("]")]
+    is_segwitv0 = wallet.policy_map.startswith("wpkh(") or wallet.policy_map.startswith("wsh(") or \
+        wallet.policy_map.startswith("sh(wpkh(") or wallet.policy_map.startswith("sh(wsh(")
+    is_legacy = not is_segwitv0 and not is_taproot
+    has_redeem_script = wallet.policy_map.startswith("sh(")
+    has_witness_script = "wsh(" in wallet.policy_map
 
     for i in range(len(input_amounts)):
         if is_legacy or is_segwitv0:
@@ -169,17 +207,19 @@ def createPsbt(wallet: PolicyMapWallet, input_amounts: List[int], output_amounts
             # add witness UTXO
             psbt.inputs[i].witness_utxo = prevouts[i].vout[prevout_ns[i]]
 
-        path_str = f"m{key_origin[8:]}/{prevout_path_change[i]}/{prevout_path_addr_idx[i]}"
-        path = parse_path(path_str)
-        input_key: bytes = master_key.derive(path_str).key.sec()
-
-        assert len(input_key) == 33
+        descriptor = getDescriptorFromWallet(wallet, prevout_path_change[i], prevout_path_addr_idx[i])
+        if has_redeem_script:
+            psbt.inputs[i].redeem_script = descriptor.redeem_script().data
+        if has_witness_script:
+            psbt.inputs[i].witness_script = descriptor.witness_script().data
 
         # add key and path info
+        keypaths = getKeypathsFromWallet(wallet, prevout_path_change[i], prevout_path_addr_idx[i])
         if is_legacy or is_segwitv0:
-            psbt.inputs[i].hd_keypaths[input_key] = KeyOriginInfo(master_key_fpr, path)
+            psbt.inputs[i].hd_keypaths.update(keypaths)
         elif is_taproot:
-            psbt.inputs[i].tap_hd_keypaths[input_key[1:]] = (list(), KeyOriginInfo(master_key_fpr, path))
+            for input_key, key_origin_info in keypaths.items():
+                psbt.inputs[i].tap_hd_keypaths[input_key[1:]] = (list(), key_origin_info)
         else:
             raise RuntimeError("Unexpected state: unknown transaction type")
 
@@ -193,15 +233,13 @@ def createPsbt(wallet: PolicyMapWallet, input_amounts: List[int], output_amounts
         tx.vout[i].nValue = output_amount
 
         if output_is_change[i]:
-            path_str = f"m{key_origin[8:]}/1/{i}"
-            path = parse_path(path_str)
-            output_key: bytes = master_key.derive(path_str).key.sec()
-
             # add key and path information for change output
+            keypaths = getKeypathsFromWallet(wallet, 1, i)
             if is_legacy or is_segwitv0:
-                psbt.outputs[i].hd_keypaths[output_key] = KeyOriginInfo(master_key_fpr, path)
+                psbt.outputs[i].hd_keypaths.update(keypaths)
             elif is_taproot:
-                psbt.outputs[i].tap_hd_keypaths[output_key[1:]] = (list(), KeyOriginInfo(master_key_fpr, path))
+                for output_key, key_origin_info in keypaths.items():
+                    psbt.outputs[i].tap_hd_keypaths[output_key[1:]] = (list(), key_origin_info)
 
     psbt.tx = tx
 
@@ -0,0 +1,93 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "bench.h"
+
+volatile uint32_t bench_sink;
+
+#if defined(__linux__)
+
+// Counter of the instructions executed by this process in user space; -1 if not available (for
+// example, in a container without access to the performance counters).
+static int open_instruction_counter(void) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+#else
+
+// no instruction counter: on the emulated Cortex-M0, they are counted by qemu
+static int open_instruction_counter(void) {
+    return -1;
+}
+
+// semihosted clock(), in centiseconds of (emulated) time
+static uint64_t now_ns(void) {
+    return (uint64_t) clock() * (1000000000u / CLOCKS_PER_SEC);
+}
+
+#endif
+
+void bench_run(const char *name, uint32_t iterations, bench_fn_t fn, void *arg) {
+    fn(arg);
+
+    int counter = open_instruction_counter();
+#if defined(__linux__)
+    if (counter >= 0) {
+        ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+
+    uint64_t start = now_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        fn(arg);
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    uint64_t instructions = 0;
+#if defined(__linux__)
+    if (counter >= 0) {
+        ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(counter, &instructions, sizeof(instructions)) != sizeof(instructions)) {
+            counter = -1;
+        }
+        close(counter);
+    }
+#endif
+
+    // the 64-bit values are printed as doubles, as newlib-nano has no %llu
+    if (counter >= 0) {
+        printf("%-40s %12.1f ns/op %12.1f instructions/op\n",
+               name,
+               (double) elapsed / iterations,
+               (double) instructions / iterations);
+    } else {
+        printf("%-40s %12.1f ns/op %12s instructions/op\n",
+               name,
+               (double) elapsed / iterations,
+               "n/a");
+    }
+}
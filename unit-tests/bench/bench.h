@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Minimal harness for the microbenchmarks of the sources of src/common.
+ *
+ * Each benchmark is a function run in a loop; bench_run prints the time per call and, where the
+ * platform can count them, the number of instructions per call. The benchmarks are built with
+ * CMAKE_BUILD_TYPE=Bench, for the host or for Cortex-M0 (see README.md).
+ */
+
+typedef void (*bench_fn_t)(void *arg);
+
+/**
+ * Runs fn(arg) once to warm up, then `iterations` times, and prints a line with name, ns/op and
+ * instructions/op (if available).
+ */
+void bench_run(const char *name, uint32_t iterations, bench_fn_t fn, void *arg);
+
+// the emulated Cortex-M0 is orders of magnitude slower than the host
+#ifdef BENCH_CORTEX_M0
+#define BENCH_ITERATIONS(n) ((n) / 100 > 0 ? (n) / 100 : 1)
+#else
+#define BENCH_ITERATIONS(n) (n)
+#endif
+
+// the benchmarks accumulate their results here, so that they are not optimized away
+extern volatile uint32_t bench_sink;
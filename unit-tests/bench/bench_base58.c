@@ -0,0 +1,37 @@
+#include <stdint.h>
+
+#include "common/base58.h"
+
+#include "bench.h"
+
+// tpub of the speculos seed at m/44'/1'/0'
+static const char xpub[] =
+    "tpubDCwYjpDhUdPGP5rS3wgNg13mTrrjBuG8V9VpWbyptX6TRPbNoZVXsoVUSkCjmQ8jJycjuDKBb9eataSymXakTTaGif"
+    "xR6kmVsfFehH1ZgJT";
+
+static uint8_t xpub_decoded[82];
+
+static void decode_xpub(void *arg) {
+    (void) arg;
+
+    uint8_t decoded[128];
+    bench_sink += base58_decode(xpub, sizeof(xpub) - 1, decoded, sizeof(decoded));
+}
+
+static void encode_xpub(void *arg) {
+    (void) arg;
+
+    char encoded[128];
+    bench_sink += base58_encode(xpub_decoded, sizeof(xpub_decoded), encoded, sizeof(encoded));
+}
+
+int main() {
+    if (base58_decode(xpub, sizeof(xpub) - 1, xpub_decoded, sizeof(xpub_decoded)) !=
+        sizeof(xpub_decoded)) {
+        return 1;
+    }
+
+    bench_run("base58_decode (xpub)", BENCH_ITERATIONS(20000), decode_xpub, NULL);
+    bench_run("base58_encode (xpub)", BENCH_ITERATIONS(20000), encode_xpub, NULL);
+    return 0;
+}
@@ -0,0 +1,38 @@
+#include <stdint.h>
+
+#include "common/format.h"
+
+#include "bench.h"
+
+static void u64(void *arg) {
+    uint64_t *amount = (uint64_t *) arg;
+
+    char out[21];
+    bench_sink += format_u64(out, sizeof(out), *amount);
+    *amount -= 9973;
+}
+
+static void fpu64(void *arg) {
+    uint64_t *amount = (uint64_t *) arg;
+
+    char out[22];
+    bench_sink += format_fpu64(out, sizeof(out), *amount, 8);
+    *amount -= 9973;
+}
+
+static void hex(void *arg) {
+    (void) arg;
+
+    static const uint8_t hash[32] = {0xde, 0x0b, 0x29, 0x56};
+    char out[2 * sizeof(hash) + 1];
+    bench_sink += format_hex(hash, sizeof(hash), out, sizeof(out));
+}
+
+int main() {
+    uint64_t amount = 2099999997690000ull;
+
+    bench_run("format_u64", BENCH_ITERATIONS(200000), u64, &amount);
+    bench_run("format_fpu64 (8 decimals)", BENCH_ITERATIONS(200000), fpu64, &amount);
+    bench_run("format_hex (32 bytes)", BENCH_ITERATIONS(200000), hex, NULL);
+    return 0;
+}
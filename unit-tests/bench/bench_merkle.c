@@ -0,0 +1,49 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "common/merkle.h"
+
+#include "bench.h"
+
+// a proof of depth 31, for the last leaf of a tree with 2^31 leaves
+#define PROOF_DEPTH (MAX_MERKLE_TREE_DEPTH - 1)
+
+// a tree of 64 leaves, like the keys or the outputs of a large transaction
+#define N_LEAVES 64
+
+static uint8_t siblings[PROOF_DEPTH][32];
+static uint8_t leaves[N_LEAVES][32];
+
+static void climb_proof(void *arg) {
+    (void) arg;
+
+    const size_t tree_size = (size_t) 1 << PROOF_DEPTH;
+    uint8_t cur_hash[32];
+    memset(cur_hash, 0x42, sizeof(cur_hash));
+
+    uint32_t directions;
+    merkle_get_directions(tree_size, tree_size - 1, &directions);
+    merkle_climb_proof(cur_hash, siblings[0], PROOF_DEPTH, directions, PROOF_DEPTH);
+    bench_sink += cur_hash[0];
+}
+
+static void compute_root(void *arg) {
+    (void) arg;
+
+    uint8_t root[32];
+    merkle_compute_root((const uint8_t(*)[32]) leaves, N_LEAVES, root);
+    bench_sink += root[0];
+}
+
+int main() {
+    for (size_t i = 0; i < PROOF_DEPTH; i++) {
+        memset(siblings[i], (int) (i * 7 + 3), 32);
+    }
+    for (size_t i = 0; i < N_LEAVES; i++) {
+        memset(leaves[i], (int) i, 32);
+    }
+
+    bench_run("merkle_climb_proof (depth 31)", BENCH_ITERATIONS(2000), climb_proof, NULL);
+    bench_run("merkle_compute_root (64 leaves)", BENCH_ITERATIONS(1000), compute_root, NULL);
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include <stdint.h>
+
+#include "common/parser.h"
+#include "common/varint.h"
+
+#include "bench.h"
+
+// mostly 1-byte varints, as in the counts and script lengths of a transaction
+static uint8_t data[1024];
+static size_t data_len;
+
+// reads all the varints, either from the stream only, or split between the store and the stream
+static void read_varints(void *arg) {
+    size_t split = *(const size_t *) arg;
+
+    buffer_t store = buffer_create(data, split);
+    buffer_t stream = buffer_create(data + split, data_len - split);
+    buffer_t *buffers[2] = {&store, &stream};
+
+    uint64_t value;
+    while (dbuffer_read_varint(buffers, &value)) {
+        bench_sink += (uint32_t) value;
+    }
+}
+
+int main() {
+    size_t n_varints = 0;
+    while (data_len + 9 <= sizeof(data)) {
+        uint64_t value = n_varints % 8 == 7 ? 0x100 + n_varints : n_varints % 0xfd;
+        data_len += varint_write(data, data_len, value);
+        n_varints++;
+    }
+
+    // the split is in the middle of a varint
+    size_t no_split = 0, split = 11;
+
+    bench_run("dbuffer_read_varint (stream)", BENCH_ITERATIONS(2000), read_varints, &no_split);
+    bench_run("dbuffer_read_varint (store+stream)", BENCH_ITERATIONS(2000), read_varints, &split);
+    return 0;
+}
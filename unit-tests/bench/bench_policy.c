@@ -0,0 +1,48 @@
+#include <stdint.h>
+#include <string.h>
+
+// missing definitions to make it compile without the SDK
+unsigned int pic(unsigned int linked_address) {
+    return linked_address;
+}
+
+#include "common/wallet.h"
+
+#include "bench.h"
+
+#define MAX_POLICY_MAP_MEMORY_SIZE 256
+
+typedef struct {
+    const char *policy;
+    uint8_t parsed[MAX_POLICY_MAP_MEMORY_SIZE];
+} policy_bench_t;
+
+static void parse(void *arg) {
+    policy_bench_t *b = (policy_bench_t *) arg;
+
+    buffer_t policy_buf = buffer_create((void *) b->policy, strlen(b->policy));
+    bench_sink += parse_policy_map(&policy_buf, b->parsed, sizeof(b->parsed));
+}
+
+static void compile(void *arg) {
+    policy_bench_t *b = (policy_bench_t *) arg;
+
+    uint8_t script_template[MAX_SCRIPT_TEMPLATE_LEN];
+    bench_sink += compile_script_template((policy_node_t *) b->parsed,
+                                          script_template,
+                                          sizeof(script_template));
+}
+
+int main() {
+    static policy_bench_t singlesig = {.policy = "wpkh(@0)"};
+    static policy_bench_t multisig = {.policy = "sh(wsh(sortedmulti(3,@0,@1,@2,@3,@4)))"};
+
+    bench_run("parse_policy_map (wpkh)", BENCH_ITERATIONS(100000), parse, &singlesig);
+    bench_run("parse_policy_map (sh-wsh 3of5)", BENCH_ITERATIONS(100000), parse, &multisig);
+    bench_run("compile_script_template (wpkh)", BENCH_ITERATIONS(100000), compile, &singlesig);
+    bench_run("compile_script_template (sh-wsh 3of5)",
+              BENCH_ITERATIONS(100000),
+              compile,
+              &multisig);
+    return 0;
+}
@@ -0,0 +1,30 @@
+# Toolchain file to build the microbenchmarks for Cortex-M0, and run them on qemu:
+#
+#   cmake -Bbuild-m0 -H. -DCMAKE_BUILD_TYPE=Bench -DCMAKE_TOOLCHAIN_FILE=bench/cortex-m0.cmake
+#
+# The code is compiled for ARMv6-M (like the Cortex-M0 of the secure element), and run on the
+# Cortex-M3 of the mps2-an385 board, since the only Cortex-M0 board of qemu (microbit) has too
+# little RAM; the instructions are the same. Input and output use semihosting.
+#
+# If QEMU_INSN_PLUGIN is the path of the libinsn.so plugin of qemu, the number of instructions
+# executed by each benchmark is printed when it exits.
+
+set(CMAKE_SYSTEM_NAME Generic)
+set(CMAKE_SYSTEM_PROCESSOR arm)
+
+set(CMAKE_C_COMPILER arm-none-eabi-gcc)
+set(CMAKE_TRY_COMPILE_TARGET_TYPE STATIC_LIBRARY)
+
+set(BENCH_CORTEX_M0 ON)
+
+set(CMAKE_C_FLAGS_INIT "-mcpu=cortex-m0 -mthumb -DBENCH_CORTEX_M0")
+set(CMAKE_EXE_LINKER_FLAGS_INIT "--specs=rdimon.specs -T${CMAKE_CURRENT_LIST_DIR}/cortex-m.ld")
+
+set(QEMU_INSN_PLUGIN "" CACHE FILEPATH "Path of the libinsn.so plugin of qemu, to count instructions")
+
+set(CMAKE_CROSSCOMPILING_EMULATOR
+    qemu-system-arm -M mps2-an385 -nographic -semihosting-config enable=on,target=native)
+if (QEMU_INSN_PLUGIN)
+  list(APPEND CMAKE_CROSSCOMPILING_EMULATOR -plugin ${QEMU_INSN_PLUGIN} -d plugin)
+endif()
+list(APPEND CMAKE_CROSSCOMPILING_EMULATOR -kernel)
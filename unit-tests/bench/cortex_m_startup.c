@@ -0,0 +1,10 @@
+#include <stdint.h>
+
+// Vector table of the benchmarks on Cortex-M: the initial stack pointer, and the entry point of
+// the C runtime of newlib (rdimon), which initializes semihosting and the bss, then calls main.
+
+extern uint32_t __stack;
+extern void _start(void);
+
+__attribute__((section(".vectors"), used)) static const void *const vectors[2] = {&__stack,
+                                                                                  (void *) _start};
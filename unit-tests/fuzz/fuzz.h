@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint*_t
+#include <stdio.h>   // fprintf
+#include <stdlib.h>  // abort
+
+/**
+ * Differential fuzz targets of the kernels of src/common. Each target is a libFuzzer entry point
+ * that runs the implementation of the app and the reference one of reference/ on the same input,
+ * and aborts if they disagree. Without libFuzzer, fuzz_driver.c runs the targets on pseudo-random
+ * inputs, or on the given files (see README.md).
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+// Aborts if cond is false, so that the input is recorded as a crash.
+#define FUZZ_CHECK(cond)                                                                \
+    do {                                                                                \
+        if (!(cond)) {                                                                  \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            abort();                                                                    \
+        }                                                                               \
+    } while (0)
+
+// Maximum length of the inputs generated by fuzz_driver.c; also the -max_len of libFuzzer.
+#define FUZZ_MAX_INPUT_SIZE 512
+
+/**
+ * Consumes the first byte of the input, if any; returns 0 otherwise. The targets read their
+ * parameters with it before using the rest of the input as data.
+ */
+static inline uint8_t fuzz_consume_u8(const uint8_t **data, size_t *size) {
+    if (*size == 0) {
+        return 0;
+    }
+    uint8_t value = **data;
+    ++*data;
+    --*size;
+    return value;
+}
@@ -0,0 +1,77 @@
+#include <stdbool.h>  // bool
+#include <stddef.h>   // size_t
+#include <stdint.h>   // uint*_t
+#include <string.h>   // memcmp, memset
+
+#include "common/base58.h"
+
+#include "fuzz.h"
+#include "reference.h"
+
+/*
+  base58_encode and base58_decode against the conversions one digit at a time. The first byte of
+  the input selects the function (bit 0) and the size of the output buffer; the rest is the data
+  to encode, or the string to decode, whose bytes are mapped to the base58 alphabet except for an
+  invalid character once in a while.
+*/
+
+static const char ALPHABET[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+#define OUT_SIZE 256
+
+static void fuzz_encode(const uint8_t *data, size_t size, size_t out_len) {
+    char out[OUT_SIZE], ref_out[OUT_SIZE];
+    memset(out, 0, sizeof(out));
+    memset(ref_out, 0, sizeof(ref_out));
+
+    int len = base58_encode(data, size, out, out_len);
+    int ref_len = ref_base58_encode(data, size, ref_out, out_len);
+    FUZZ_CHECK(len == ref_len);
+    if (len < 0) {
+        return;
+    }
+    FUZZ_CHECK(memcmp(out, ref_out, len) == 0);
+
+    // the round trip, if the encoding can be decoded
+    if (len >= 2 && len <= MAX_DEC_INPUT_SIZE) {
+        uint8_t decoded[OUT_SIZE];
+        FUZZ_CHECK(base58_decode(out, len, decoded, sizeof(decoded)) == (int) size);
+        FUZZ_CHECK(memcmp(decoded, data, size) == 0);
+    }
+}
+
+static void fuzz_decode(const uint8_t *data, size_t size, size_t out_len) {
+    char in[FUZZ_MAX_INPUT_SIZE];
+    for (size_t i = 0; i < size; i++) {
+        // mostly valid characters, with the leading '1's of the zero bytes
+        in[i] = data[i] >= 0xF8 ? (char) (data[i] & 0x7F) : ALPHABET[data[i] % 58];
+        if (data[i] < 0x20) {
+            in[i] = '1';
+        }
+    }
+
+    uint8_t out[OUT_SIZE], ref_out[OUT_SIZE];
+    memset(out, 0, sizeof(out));
+    memset(ref_out, 0, sizeof(ref_out));
+
+    int len = base58_decode(in, size, out, out_len);
+    int ref_len = ref_base58_decode(in, size, ref_out, out_len);
+    FUZZ_CHECK(len == ref_len);
+    if (len > 0) {
+        FUZZ_CHECK(memcmp(out, ref_out, len) == 0);
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    uint8_t params = fuzz_consume_u8(&data, &size);
+
+    // half of the time, an output buffer of at most 63 bytes, that can be too short
+    size_t out_len = (params & 0x80) ? (params >> 1) & 0x3F : OUT_SIZE;
+
+    if (params & 1) {
+        fuzz_decode(data, size, out_len);
+    } else {
+        fuzz_encode(data, size, out_len);
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <stdint.h>  // uint*_t
+#include <stdio.h>   // fopen, fread, printf
+#include <stdlib.h>  // getenv, strtoul
+
+#include "fuzz.h"
+
+/*
+  Runs a fuzz target without libFuzzer: on the given files (for example, the crashes found by
+  libFuzzer), or otherwise on FUZZ_ITERATIONS pseudo-random inputs generated from FUZZ_SEED; half
+  of them are at most 64 bytes long, so that the short inputs are well covered.
+*/
+
+#define DEFAULT_ITERATIONS 20000
+
+static uint64_t G_rng_state;
+
+// xorshift64*
+static uint32_t next_random(void) {
+    G_rng_state ^= G_rng_state >> 12;
+    G_rng_state ^= G_rng_state << 25;
+    G_rng_state ^= G_rng_state >> 27;
+    return (uint32_t) ((G_rng_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static unsigned long env_or_default(const char *name, unsigned long default_value) {
+    const char *value = getenv(name);
+    return value != NULL ? strtoul(value, NULL, 0) : default_value;
+}
+
+static int run_file(const char *path) {
+    static uint8_t data[1 << 16];
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+    size_t size = fread(data, 1, sizeof(data), file);
+    fclose(file);
+
+    LLVMFuzzerTestOneInput(data, size);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            if (run_file(argv[i]) != 0) {
+                return 1;
+            }
+        }
+        printf("%d inputs\n", argc - 1);
+        return 0;
+    }
+
+    unsigned long iterations = env_or_default("FUZZ_ITERATIONS", DEFAULT_ITERATIONS);
+    G_rng_state = env_or_default("FUZZ_SEED", 1) * 0x9E3779B97F4A7C15ULL + 1;
+
+    uint8_t data[FUZZ_MAX_INPUT_SIZE];
+    for (unsigned long i = 0; i < iterations; i++) {
+        size_t max_size = (i & 1) ? FUZZ_MAX_INPUT_SIZE : 64;
+        size_t size = next_random() % (max_size + 1);
+        for (size_t k = 0; k < size; k++) {
+            data[k] = (uint8_t) next_random();
+        }
+        LLVMFuzzerTestOneInput(data, size);
+    }
+    printf("%lu inputs\n", iterations);
+    return 0;
+}
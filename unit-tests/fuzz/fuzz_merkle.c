@@ -0,0 +1,90 @@
+#include <stdbool.h>  // bool
+#include <stddef.h>   // size_t
+#include <stdint.h>   // uint*_t
+#include <string.h>   // memcmp, memcpy
+
+#include "common/merkle.h"
+
+#include "fuzz.h"
+#include "reference.h"
+
+/*
+  The Merkle roots, the directions and the verification of the proofs against the versions with one
+  hash update per field and the directions recomputed from the root. The first 5 bytes of the input
+  are the number of leaves (up to 128), the index of the proven leaf and the level where the proof
+  is split in two calls of merkle_climb_proof; the hashes of the leaves are filled with the rest.
+*/
+
+#define MAX_LEAVES 128
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static uint8_t leaves[MAX_LEAVES][32];
+
+    size_t n_leaves = fuzz_consume_u8(&data, &size);
+    n_leaves = 1 + (n_leaves | (size_t) fuzz_consume_u8(&data, &size) << 8) % MAX_LEAVES;
+    size_t index = fuzz_consume_u8(&data, &size);
+    index = (index | (size_t) fuzz_consume_u8(&data, &size) << 8) % n_leaves;
+    uint8_t split = fuzz_consume_u8(&data, &size);
+
+    for (size_t i = 0; i < n_leaves; i++) {
+        for (size_t k = 0; k < 32; k++) {
+            leaves[i][k] = (size > 0 ? data[(32 * i + k) % size] : 0) ^ (uint8_t) i;
+        }
+    }
+
+    uint8_t hash[32], ref_hash[32];
+    if (n_leaves >= 2) {
+        merkle_combine_hashes(leaves[0], leaves[1], hash);
+        ref_merkle_combine_hashes(leaves[0], leaves[1], ref_hash);
+        FUZZ_CHECK(memcmp(hash, ref_hash, 32) == 0);
+    }
+
+    uint8_t root[32], ref_root[32];
+    merkle_compute_root((const uint8_t(*)[32]) leaves, n_leaves, root);
+    ref_merkle_compute_root((const uint8_t(*)[32]) leaves, n_leaves, ref_root);
+    FUZZ_CHECK(memcmp(root, ref_root, 32) == 0);
+
+    // the directions, from the root
+    uint32_t directions;
+    int level = merkle_get_directions(n_leaves, index, &directions);
+    FUZZ_CHECK(level >= 0 && level <= MAX_MERKLE_TREE_DEPTH);
+    for (int i = 0; i <= level; i++) {
+        int ref_direction = ref_merkle_get_ith_direction(n_leaves, index, i);
+        FUZZ_CHECK(merkle_get_ith_direction(n_leaves, index, i) == ref_direction);
+        if (i < level) {
+            FUZZ_CHECK((int) ((directions >> i) & 1) == ref_direction);
+        } else {
+            FUZZ_CHECK(ref_direction == -1);
+        }
+    }
+    FUZZ_CHECK(merkle_get_directions(n_leaves, n_leaves, &directions) == -1);
+
+    // the proof from the lowest level, verified in two parts
+    uint8_t proof[MAX_MERKLE_TREE_DEPTH][32];
+    size_t proof_len =
+        ref_merkle_compute_proof((const uint8_t(*)[32]) leaves, n_leaves, index, proof);
+    FUZZ_CHECK(proof_len == (size_t) level);
+
+    size_t n_first = split % (proof_len + 1);
+    memcpy(hash, leaves[index], 32);
+    FUZZ_CHECK(merkle_climb_proof(hash, proof[0], n_first, directions, level) == 0);
+    FUZZ_CHECK(merkle_climb_proof(hash,
+                                  proof[n_first],
+                                  proof_len - n_first,
+                                  directions,
+                                  level - n_first) == 0);
+    FUZZ_CHECK(memcmp(hash, root, 32) == 0);
+
+    // too many steps: rejected, without changing the hash
+    memcpy(hash, leaves[index], 32);
+    FUZZ_CHECK(merkle_climb_proof(hash, proof[0], proof_len + 1, directions, level) == -1);
+    FUZZ_CHECK(memcmp(hash, leaves[index], 32) == 0);
+
+    // a wrong sibling
+    if (proof_len > 0) {
+        proof[split % proof_len][split % 32] ^= 1 << (split % 8);
+        FUZZ_CHECK(merkle_climb_proof(hash, proof[0], proof_len, directions, level) == 0);
+        FUZZ_CHECK(memcmp(hash, root, 32) != 0);
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include <stdbool.h>  // bool
+#include <stddef.h>   // size_t
+#include <stdint.h>   // uint*_t
+#include <string.h>   // memcmp, memcpy
+
+#include "common/buffer.h"
+#include "common/parser.h"
+
+#include "fuzz.h"
+
+/*
+  The readers of the concatenation of two buffers against the same reads from a single buffer with
+  the same content: the result of a read must not depend on where the data is split. The first
+  byte of the input is the number of operations (up to 31), each encoded in one byte; the next two
+  bytes are the split point; the rest is the data to read.
+*/
+
+enum {
+    OP_U8,
+    OP_U16,      // endianness in bit 0 of the argument
+    OP_U32,      // endianness in bit 0 of the argument
+    OP_VARINT,
+    OP_BYTES,    // the argument is the length
+    OP_CHUNK,    // the argument is the maximum length
+    OP_SPANS,    // the argument is the length
+    OP_CAN_READ  // the argument is the length
+};
+
+static void run_op(uint8_t op, buffer_t *buffers[2], buffer_t *flat) {
+    size_t arg = op >> 3;
+    endianness_t endianness = (arg & 1) ? LE : BE;
+    uint8_t bytes[32], flat_bytes[32];
+
+    switch (op & 7) {
+        case OP_U8: {
+            uint8_t value = 0, flat_value = 0;
+            bool ok = dbuffer_read_u8(buffers, &value);
+            FUZZ_CHECK(ok == buffer_read_u8(flat, &flat_value));
+            FUZZ_CHECK(!ok || value == flat_value);
+            break;
+        }
+        case OP_U16: {
+            uint16_t value = 0, flat_value = 0;
+            bool ok = dbuffer_read_u16(buffers, &value, endianness);
+            FUZZ_CHECK(ok == buffer_read_u16(flat, &flat_value, endianness));
+            FUZZ_CHECK(!ok || value == flat_value);
+            break;
+        }
+        case OP_U32: {
+            uint32_t value = 0, flat_value = 0;
+            bool ok = dbuffer_read_u32(buffers, &value, endianness);
+            FUZZ_CHECK(ok == buffer_read_u32(flat, &flat_value, endianness));
+            FUZZ_CHECK(!ok || value == flat_value);
+            break;
+        }
+        case OP_VARINT: {
+            uint64_t value = 0, flat_value = 0;
+            bool ok = dbuffer_read_varint(buffers, &value);
+            FUZZ_CHECK(ok == buffer_read_varint(flat, &flat_value));
+            FUZZ_CHECK(!ok || value == flat_value);
+            break;
+        }
+        case OP_BYTES: {
+            bool ok = dbuffer_read_bytes(buffers, bytes, arg);
+            FUZZ_CHECK(ok == buffer_read_bytes(flat, flat_bytes, arg));
+            FUZZ_CHECK(!ok || memcmp(bytes, flat_bytes, arg) == 0);
+            break;
+        }
+        case OP_CHUNK: {
+            // the rest of the first non-empty buffer, up to arg bytes
+            size_t first_len = buffers[0]->size - buffers[0]->offset;
+            size_t available = first_len > 0 ? first_len : buffers[1]->size - buffers[1]->offset;
+            const uint8_t *chunk = NULL;
+            size_t chunk_len = dbuffer_read_chunk(buffers, arg, &chunk);
+            FUZZ_CHECK(chunk_len == (arg < available ? arg : available));
+            FUZZ_CHECK(buffer_read_bytes(flat, flat_bytes, chunk_len));
+            FUZZ_CHECK(chunk_len == 0 || memcmp(chunk, flat_bytes, chunk_len) == 0);
+            break;
+        }
+        case OP_SPANS: {
+            const uint8_t *spans[2];
+            size_t spans_len[2];
+            bool ok = dbuffer_read_spans(buffers, arg, spans, spans_len);
+            FUZZ_CHECK(ok == buffer_read_bytes(flat, flat_bytes, arg));
+            if (ok) {
+                FUZZ_CHECK(spans_len[0] + spans_len[1] == arg);
+                FUZZ_CHECK(spans_len[0] == 0 || memcmp(spans[0], flat_bytes, spans_len[0]) == 0);
+                FUZZ_CHECK(spans_len[1] == 0 ||
+                           memcmp(spans[1], flat_bytes + spans_len[0], spans_len[1]) == 0);
+            }
+            break;
+        }
+        default:
+            FUZZ_CHECK(dbuffer_can_read(buffers, arg) == buffer_can_read(flat, arg));
+            break;
+    }
+
+    FUZZ_CHECK(dbuffer_get_length(buffers) == flat->size - flat->offset);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    uint8_t ops[31];
+    size_t n_ops = fuzz_consume_u8(&data, &size) % (sizeof(ops) + 1);
+    for (size_t i = 0; i < n_ops; i++) {
+        ops[i] = fuzz_consume_u8(&data, &size);
+    }
+    size_t split = fuzz_consume_u8(&data, &size);
+    split = (split | (size_t) fuzz_consume_u8(&data, &size) << 8) % (size + 1);
+
+    // the two buffers are over a copy, that is modified by parser_consolidate_buffers
+    uint8_t copy[FUZZ_MAX_INPUT_SIZE];
+    size = size < sizeof(copy) ? size : sizeof(copy);
+    memcpy(copy, data, size);
+    buffer_t first = buffer_create(copy, split);
+    buffer_t second = buffer_create(copy + split, size - split);
+    buffer_t *buffers[2] = {&first, &second};
+    buffer_t flat = buffer_create((void *) data, size);
+
+    for (size_t i = 0; i < n_ops; i++) {
+        run_op(ops[i], buffers, &flat);
+    }
+
+    // the remaining bytes, moved to the first buffer if they fit
+    size_t remaining = flat.size - flat.offset;
+    size_t max_size = (n_ops & 1) && remaining > 0 ? remaining - 1 : remaining;
+    bool ok = parser_consolidate_buffers(buffers, max_size);
+    FUZZ_CHECK(ok == (max_size == remaining));
+    if (ok) {
+        FUZZ_CHECK(first.offset == 0 && first.size == remaining);
+        FUZZ_CHECK(memcmp(first.ptr, flat.ptr + flat.offset, remaining) == 0);
+    }
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include <stdbool.h>  // bool
+#include <stddef.h>   // size_t
+#include <stdint.h>   // uint*_t
+#include <string.h>   // memcmp, memset, strcmp, strlen
+
+#include "common/segwit_addr.h"
+
+#include "fuzz.h"
+#include "reference.h"
+
+/*
+  The Bech32 and Bech32m encodings and the segwit addresses against the reference implementation
+  of BIP-173 and BIP-350, with the bitwise polymod step. The first byte of the input selects the
+  function and its parameters. Random strings almost never have a valid checksum, so the strings
+  to decode are valid encodings of the input, with a few characters replaced.
+*/
+
+static const char CHARSET[] = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+
+// the human readable parts of the segwit addresses, a valid one, and an upper case one
+static const char *const SEGWIT_HRPS[] = {"bc", "tb", "bcrt", "a", "Bc"};
+
+#define STRING_SIZE (FUZZ_MAX_INPUT_SIZE + 16)
+
+// Reads a human readable part of at most 15 characters, mostly lower case letters.
+static void consume_hrp(const uint8_t **data, size_t *size, size_t hrp_len, char *hrp) {
+    for (size_t i = 0; i < hrp_len && *size > 0; i++) {
+        uint8_t c = fuzz_consume_u8(data, size);
+        *hrp++ = c < 0xE0 ? (char) ('a' + c % 26) : (char) (33 + c % 94);
+    }
+    *hrp = '\0';
+}
+
+// Replaces a few characters of str, at the positions and with the characters chosen by the input.
+static void mutate(const uint8_t **data, size_t *size, char *str) {
+    size_t len = strlen(str);
+    uint8_t n_mutations = fuzz_consume_u8(data, size) % 4;
+    for (uint8_t i = 0; i < n_mutations && len > 0; i++) {
+        size_t pos = fuzz_consume_u8(data, size) % len;
+        uint8_t c = fuzz_consume_u8(data, size);
+        if (c < 0xC0) {
+            str[pos] = CHARSET[c % 32];
+        } else if (c < 0xE0) {
+            str[pos] = (char) ('A' + c % 26);  // mixed case
+        } else if (c < 0xF0) {
+            str[pos] = '1';
+        } else {
+            str[pos] = (char) (c & 0x7F);
+        }
+    }
+}
+
+static void check_bech32_decode(const char *str) {
+    char hrp[STRING_SIZE], ref_hrp[STRING_SIZE];
+    uint8_t values[STRING_SIZE], ref_values[STRING_SIZE];
+    size_t values_len = 0, ref_values_len = 0;
+
+    bech32_encoding enc = bech32_decode(hrp, values, &values_len, str);
+    bech32_encoding ref_enc = ref_bech32_decode(ref_hrp, ref_values, &ref_values_len, str);
+    FUZZ_CHECK(enc == ref_enc);
+    if (enc != BECH32_ENCODING_NONE) {
+        FUZZ_CHECK(strcmp(hrp, ref_hrp) == 0);
+        FUZZ_CHECK(values_len == ref_values_len);
+        FUZZ_CHECK(memcmp(values, ref_values, values_len) == 0);
+    }
+}
+
+static void fuzz_bech32(const uint8_t *data, size_t size, uint8_t params) {
+    char hrp[16];
+    consume_hrp(&data, &size, (params >> 2) & 0x0F, hrp);
+    bech32_encoding enc = (params & 0x40) ? BECH32_ENCODING_BECH32M : BECH32_ENCODING_BECH32;
+
+    // up to 100 5-bit values, more than what fits in 90 characters
+    uint8_t values[100];
+    size_t values_len = fuzz_consume_u8(&data, &size) % (sizeof(values) + 1);
+    for (size_t i = 0; i < values_len; i++) {
+        values[i] = fuzz_consume_u8(&data, &size) & 0x1F;
+    }
+
+    char out[STRING_SIZE], ref_out[STRING_SIZE];
+    int ret = bech32_encode(out, hrp, values, values_len, enc);
+    int ref_ret = ref_bech32_encode(ref_out, hrp, values, values_len, enc);
+    FUZZ_CHECK(ret == ref_ret);
+    if (ret != 1) {
+        return;
+    }
+    FUZZ_CHECK(strcmp(out, ref_out) == 0);
+
+    check_bech32_decode(out);
+    mutate(&data, &size, out);
+    check_bech32_decode(out);
+}
+
+static void fuzz_segwit(const uint8_t *data, size_t size, uint8_t params) {
+    const char *hrp = SEGWIT_HRPS[((params >> 2) & 0x07) % (sizeof(SEGWIT_HRPS) / sizeof(char *))];
+    int version = fuzz_consume_u8(&data, &size) % 18;  // 17 is invalid
+
+    // up to 44 bytes, while the witness programs have 2 to 40 bytes
+    uint8_t prog[44];
+    size_t prog_len = fuzz_consume_u8(&data, &size) % (sizeof(prog) + 1);
+    for (size_t i = 0; i < prog_len; i++) {
+        prog[i] = fuzz_consume_u8(&data, &size);
+    }
+
+    char out[STRING_SIZE], ref_out[STRING_SIZE];
+    int ret = segwit_addr_encode(out, hrp, version, prog, prog_len);
+    int ref_ret = ref_segwit_addr_encode(ref_out, hrp, version, prog, prog_len);
+    FUZZ_CHECK(ret == ref_ret);
+    if (ret != 1) {
+        return;
+    }
+    FUZZ_CHECK(strcmp(out, ref_out) == 0);
+
+    // the same address from the state of the checksum after the hrp
+    uint32_t hrp_state;
+    char out_from_state[STRING_SIZE];
+    FUZZ_CHECK(bech32_hrp_state(hrp, &hrp_state) == 1);
+    FUZZ_CHECK(segwit_addr_encode_from_state(out_from_state, hrp, hrp_state, version, prog, prog_len) ==
+               1);
+    FUZZ_CHECK(strcmp(out_from_state, out) == 0);
+
+    if (params & 0x20) {
+        mutate(&data, &size, out);
+    }
+
+    int dec_version = -1, ref_dec_version = -1;
+    uint8_t dec_prog[STRING_SIZE], ref_dec_prog[STRING_SIZE];
+    size_t dec_prog_len = 0, ref_dec_prog_len = 0;
+    ret = segwit_addr_decode(&dec_version, dec_prog, &dec_prog_len, hrp, out);
+    ref_ret = ref_segwit_addr_decode(&ref_dec_version, ref_dec_prog, &ref_dec_prog_len, hrp, out);
+    FUZZ_CHECK(ret == ref_ret);
+    if (ret == 1) {
+        FUZZ_CHECK(dec_version == ref_dec_version);
+        FUZZ_CHECK(dec_prog_len == ref_dec_prog_len);
+        FUZZ_CHECK(memcmp(dec_prog, ref_dec_prog, dec_prog_len) == 0);
+    }
+}
+
+// Decodes the input as a string, mostly of characters of the charset.
+static void fuzz_raw_decode(const uint8_t *data, size_t size) {
+    char str[STRING_SIZE];
+    size_t len = size < STRING_SIZE - 1 ? size : STRING_SIZE - 1;
+    for (size_t i = 0; i < len; i++) {
+        str[i] = data[i] < 0xF0 ? CHARSET[data[i] % 32] : data[i] < 0xF8 ? '1' : (char) (data[i] & 0x7F);
+        if (str[i] == '\0') {
+            str[i] = 'q';
+        }
+    }
+    str[len] = '\0';
+    check_bech32_decode(str);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    uint8_t params = fuzz_consume_u8(&data, &size);
+
+    switch (params & 3) {
+        case 0:
+        case 1:
+            fuzz_bech32(data, size, params);
+            break;
+        case 2:
+            fuzz_segwit(data, size, params);
+            break;
+        default:
+            fuzz_raw_decode(data, size);
+            break;
+    }
+    return 0;
+}
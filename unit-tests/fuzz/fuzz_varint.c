@@ -0,0 +1,62 @@
+#include <stdbool.h>  // bool
+#include <stddef.h>   // size_t
+#include <stdint.h>   // uint*_t
+#include <string.h>   // memcmp, memcpy
+
+#include "common/buffer.h"
+#include "common/varint.h"
+
+#include "fuzz.h"
+#include "reference.h"
+
+/*
+  varint_read, varint_write, varint_size and buffer_read_varint against the varints read and
+  written one byte at a time. The input is read as a varint, with its fast paths and its
+  truncations; then its first 8 bytes, shifted right by the bits of the first byte so that all the
+  sizes are covered, are written as a varint and read back.
+*/
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    uint64_t value = 0, ref_value = 0;
+    int len = varint_read(data, size, &value);
+    int ref_len = ref_varint_read(data, size, &ref_value);
+    FUZZ_CHECK(len == ref_len);
+    if (len > 0) {
+        FUZZ_CHECK(value == ref_value);
+    }
+
+    // the same from a buffer, that is only consumed on success
+    buffer_t buffer = buffer_create((void *) data, size);
+    bool ok = buffer_read_varint(&buffer, &value);
+    FUZZ_CHECK(ok == (ref_len > 0));
+    FUZZ_CHECK(buffer.offset == (ok ? (size_t) ref_len : 0));
+    if (ok) {
+        FUZZ_CHECK(value == ref_value);
+    }
+
+    uint8_t raw[8] = {0};
+    memcpy(raw, data, size < 8 ? size : 8);
+    uint64_t to_write = 0;
+    for (int i = 0; i < 8; i++) {
+        to_write |= (uint64_t) raw[i] << (8 * i);
+    }
+    to_write >>= size > 0 ? data[0] % 64 : 0;
+
+    FUZZ_CHECK(varint_size(to_write) == ref_varint_size(to_write));
+
+    // at an offset, with the rest of the output untouched
+    uint8_t out[16], ref_out[16];
+    memset(out, 0xA5, sizeof(out));
+    memset(ref_out, 0xA5, sizeof(ref_out));
+    size_t offset = size > 1 ? data[1] % 8 : 0;
+    len = varint_write(out, offset, to_write);
+    ref_len = ref_varint_write(ref_out, offset, to_write);
+    FUZZ_CHECK(len == ref_len);
+    FUZZ_CHECK(memcmp(out, ref_out, sizeof(out)) == 0);
+
+    // and back
+    FUZZ_CHECK(varint_read(out + offset, len, &value) == len);
+    FUZZ_CHECK(value == to_write);
+    FUZZ_CHECK(varint_read(out + offset, len - 1, &value) == -1);
+    return 0;
+}
@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""
+Generates python_vectors.h, with random inputs of the base58 conversions, of the varints and of the Merkle roots and
+their results computed by the Python client, that are used by test_python_vectors.c to cross-check the
+implementations of the app. Run from the root of the repository:
+
+    python3 unit-tests/fuzz/gen_python_vectors.py > unit-tests/fuzz/python_vectors.h
+"""
+
+import random
+import sys
+from pathlib import Path
+
+sys.path.append(str(Path(__file__).resolve().parent.parent.parent))
+
+from bitcoin_client import base58  # noqa: E402
+from bitcoin_client.common import write_varint  # noqa: E402
+from bitcoin_client.merkle import MerkleTree, element_hash  # noqa: E402
+
+SEED = 124
+N_BASE58_VECTORS = 32
+N_MERKLE_VECTORS = 16
+MAX_ENC_INPUT_SIZE = 120  # of src/common/base58.h
+
+# the boundaries of the sizes of the varints, and of their first byte
+VARINT_BOUNDARIES = [0, 1, 0xFC, 0xFD, 0xFE, 0xFF, 0xFFFF, 0x10000, 0xFFFFFFFF, 0x100000000, 2**64 - 1]
+N_RANDOM_VARINTS = 21
+
+
+def c_bytes(data: bytes) -> str:
+    return "{" + ", ".join(f"0x{b:02x}" for b in data) + "}"
+
+
+def random_bytes(n: int) -> bytes:
+    return bytes(random.getrandbits(8) for _ in range(n))
+
+
+def print_base58_vectors():
+    print("typedef struct {")
+    print("    size_t data_len;")
+    print(f"    uint8_t data[{MAX_ENC_INPUT_SIZE}];")
+    print("    const char *encoded;")
+    print("} base58_vector_t;")
+    print()
+    print("static const base58_vector_t base58_vectors[] = {")
+    for i in range(N_BASE58_VECTORS):
+        # leading zeros in a quarter of them, that are encoded as '1's
+        n_zeros = random.randint(1, 4) if i % 4 == 0 else 0
+        data = bytes(n_zeros) + random_bytes(random.randint(1, MAX_ENC_INPUT_SIZE - n_zeros))
+        print(f"    {{{len(data)}, {c_bytes(data)}, \"{base58.encode(data)}\"}},")
+    print("};")
+
+
+def print_varint_vectors():
+    values = VARINT_BOUNDARIES + [random.getrandbits(random.choice([8, 16, 32, 64])) for _ in range(N_RANDOM_VARINTS)]
+
+    print("typedef struct {")
+    print("    uint64_t value;")
+    print("    size_t len;")
+    print("    uint8_t serialized[9];")
+    print("} varint_vector_t;")
+    print()
+    print("static const varint_vector_t varint_vectors[] = {")
+    for value in values:
+        serialized = write_varint(value)
+        print(f"    {{0x{value:x}ULL, {len(serialized)}, {c_bytes(serialized)}}},")
+    print("};")
+
+
+def print_merkle_vectors():
+    print("typedef struct {")
+    print("    size_t n_leaves;")
+    print("    size_t leaves_len;  // the leaves are the element hashes of leaves_len bytes each")
+    print("    uint8_t leaves_seed;  // leaf i is made of the bytes (leaves_seed + i + k) % 256")
+    print("    uint8_t root[32];")
+    print("} merkle_root_vector_t;")
+    print()
+    print("static const merkle_root_vector_t merkle_root_vectors[] = {")
+    for i in range(N_MERKLE_VECTORS):
+        n_leaves = i + 1 if i < N_MERKLE_VECTORS // 2 else random.randint(9, 300)
+        leaves_len = random.randint(0, 40)
+        seed = random.getrandbits(8)
+        leaves = [element_hash(bytes((seed + j + k) % 256 for k in range(leaves_len))) for j in range(n_leaves)]
+        root = MerkleTree(leaves).root
+        print(f"    {{{n_leaves}, {leaves_len}, {seed}, {c_bytes(root)}}},")
+    print("};")
+
+
+def main():
+    random.seed(SEED)
+
+    print("// Generated by gen_python_vectors.py; do not edit.")
+    print()
+    print("#pragma once")
+    print()
+    print("#include <stdint.h>")
+    print("#include <stddef.h>")
+    print()
+    print_base58_vectors()
+    print()
+    print_varint_vectors()
+    print()
+    print_merkle_vectors()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,114 @@
+// Generated by gen_python_vectors.py; do not edit.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+    size_t data_len;
+    uint8_t data[120];
+    const char *encoded;
+} base58_vector_t;
+
+static const base58_vector_t base58_vectors[] = {
+    {74, {0x00, 0x00, 0x00, 0x01, 0x2d, 0xf2, 0xf7, 0x0f, 0x6a, 0x47, 0xc9, 0x5d, 0x08, 0x51, 0x2a, 0x65, 0xf7, 0x4f, 0xd0, 0x6b, 0x05, 0x8b, 0x79, 0x9d, 0x6c, 0x04, 0x3a, 0x37, 0x19, 0x67, 0x50, 0x35, 0x24, 0x63, 0x30, 0xc4, 0xdd, 0xa6, 0x5b, 0x89, 0x4b, 0xc1, 0x66, 0x2b, 0x1b, 0x74, 0xe6, 0xb4, 0x83, 0x9a, 0xa9, 0xee, 0xfd, 0xb6, 0x1c, 0x62, 0x91, 0x88, 0x7a, 0xee, 0xc4, 0x1c, 0x9b, 0xe1, 0x71, 0x17, 0x21, 0xbf, 0x88, 0x62, 0xca, 0x3f, 0xf2, 0x2f}, "111EGbGoLrJzXht19WHCGbBZnbSz6jGQnsDgyscKV4WQJm7LYMRjffynpiQcXCY773bYxVR3sWpFMJ6dbZfkopoSz7K7yB4CdE6"},
+    {59, {0xb9, 0x83, 0x09, 0xcd, 0xa5, 0x72, 0xa3, 0x67, 0xa3, 0xbc, 0x5a, 0xe1, 0x97, 0xc5, 0x76, 0xee, 0x14, 0x2c, 0x10, 0x87, 0xe7, 0x0f, 0xcb, 0xf0, 0x0e, 0x3c, 0x88, 0x86, 0x19, 0xb1, 0x9d, 0x78, 0xca, 0x78, 0x9b, 0x78, 0x14, 0x94, 0x7b, 0xa4, 0xa5, 0xba, 0x07, 0x78, 0x3c, 0x66, 0xaf, 0x28, 0x38, 0x05, 0xcb, 0x50, 0x83, 0xf4, 0x5b, 0x78, 0x6f, 0x27, 0xd0}, "8SzgRguR6XWkDZWuDxcLGBKpKELSsixxSRJeZ43K58B9oj7MxhiZicexnDBT9ASwqFj6coKTuNhp8XZdh"},
+    {61, {0xc1, 0xbb, 0x80, 0xd4, 0x51, 0x5e, 0x12, 0x9b, 0xd0, 0x0e, 0xd6, 0xd6, 0x40, 0x64, 0x16, 0x1c, 0x64, 0x34, 0x80, 0xd0, 0x9d, 0xe3, 0xfe, 0x33, 0x6c, 0xf7, 0xa3, 0x39, 0xc3, 0x12, 0x15, 0x08, 0x08, 0x29, 0xbc, 0xb7, 0x1c, 0x91, 0x2b, 0xea, 0x17, 0x35, 0x33, 0x2b, 0x09, 0xdb, 0x69, 0x7a, 0xca, 0x78, 0xeb, 0xc2, 0xba, 0x00, 0xa6, 0x0d, 0xd8, 0x16, 0x76, 0x5b, 0xc1}, "3cXs9fxoLTcLj8NbkWCihV5pKaKcP4zX7KiwMf3uxDEXiLpYi3rC3uWu1E4G5HYtk2G6DvMvjp7zaTQ2KKur"},
+    {12, {0x12, 0x88, 0x6d, 0x6b, 0x2d, 0x5c, 0x38, 0x41, 0x8f, 0x6f, 0xce, 0xc3}, "MHVwXRWBsjcbZsdL"},
+    {59, {0x00, 0x00, 0xfa, 0xcd, 0x04, 0x6e, 0xa1, 0x85, 0xbd, 0xad, 0xed, 0x85, 0x8c, 0x5b, 0x3c, 0x57, 0x71, 0x82, 0xf2, 0xe0, 0x22, 0xe9, 0x82, 0xa2, 0x5e, 0xd2, 0x53, 0xba, 0x14, 0x1f, 0x73, 0x16, 0x95, 0xd5, 0xcd, 0xb7, 0xf5, 0x9e, 0x50, 0x51, 0x49, 0x7e, 0x24, 0x10, 0x85, 0xf4, 0xc8, 0x03, 0xa8, 0xbf, 0x72, 0x5f, 0xf4, 0x9b, 0xf3, 0x2a, 0xe7, 0x17, 0x55}, "11Wym4QJAYs9h14nB7j2eG4h2KxexNF3a8mAZjAaK8aKPHisZPARyJ7pGjY3bwKTUULfeEDcG97kxAeg"},
+    {12, {0xb3, 0x71, 0x0b, 0xed, 0xa1, 0xbe, 0x43, 0xac, 0x83, 0xd5, 0xff, 0xd6}, "4PQEdhChGC3R83FU1"},
+    {38, {0xfb, 0x44, 0xb8, 0xac, 0x75, 0x20, 0x1e, 0x45, 0x0f, 0xd0, 0x71, 0x1e, 0xd5, 0xc5, 0x3b, 0x6b, 0xb4, 0x6b, 0x17, 0xe7, 0xa7, 0x6b, 0xfe, 0x10, 0x63, 0x94, 0x7b, 0x6c, 0x93, 0xcc, 0xf1, 0x86, 0x75, 0xc6, 0xb2, 0xbb, 0x98, 0xa7}, "eAqrTkBWN5sLBsgUEfFJGWnjejBQfwKkXhRaWuFoiGj3M7JSTNNr"},
+    {25, {0xd4, 0xa3, 0xaa, 0xf5, 0x18, 0xdd, 0x27, 0xff, 0x16, 0xba, 0x81, 0xad, 0xf3, 0xf6, 0x3c, 0x57, 0x17, 0x75, 0x2f, 0xc6, 0x9c, 0x40, 0xde, 0xb4, 0xde}, "2UZaGgcr3BNQgxGz2rkhzU6w9NepTnDnai9"},
+    {12, {0x00, 0x00, 0x9a, 0x27, 0x1b, 0x77, 0x80, 0x6e, 0xc4, 0xe4, 0x21, 0x63}, "119fKCW1BaxJPKyC"},
+    {118, {0xd8, 0x61, 0xe4, 0x3b, 0xe2, 0xe3, 0x03, 0x4f, 0xa9, 0x0c, 0x5f, 0x2f, 0xed, 0x89, 0xea, 0x50, 0x15, 0x46, 0x1d, 0x2b, 0x7a, 0x15, 0x87, 0x4f, 0x26, 0x87, 0x08, 0x4f, 0x22, 0x58, 0x4d, 0x12, 0x15, 0x60, 0x6c, 0xd0, 0x5d, 0x74, 0x61, 0xfb, 0x9f, 0xe5, 0x5d, 0xdf, 0x13, 0x74, 0x78, 0xdb, 0xd1, 0x25, 0xc7, 0x91, 0x9f, 0x41, 0xc9, 0x95, 0xfa, 0x1a, 0x37, 0x85, 0x94, 0xec, 0x7b, 0x3e, 0xb5, 0x26, 0xf5, 0x05, 0x1a, 0x34, 0xf8, 0xbc, 0x6f, 0xa9, 0x02, 0x58, 0x62, 0xec, 0xa1, 0x10, 0xad, 0xc0, 0xfd, 0x18, 0xa2, 0x05, 0xc3, 0x48, 0x2e, 0x98, 0x1b, 0x9e, 0x6f, 0xeb, 0x45, 0x96, 0x96, 0x06, 0x96, 0xcd, 0x6f, 0x22, 0xb1, 0x4f, 0xc1, 0xef, 0xa2, 0xc9, 0x27, 0x35, 0x4d, 0xf3, 0x80, 0x99, 0xbd, 0x11, 0x43, 0x08}, "2YJ1fiFP899d92QAkvWPoKvXPgegQq8EyxZU1ThhUXZBe275rMjZQrbneBUBBwdnXZCBHNHmckoCuh47qAFgEC36CQZdKeCjrrmoJeUkVpwgRPemEy4ksXgS4mUm5PAqwzbx8YysK2qChHt3BbH2zr5WBpsrHeEi3y"},
+    {77, {0x7a, 0x25, 0x75, 0xac, 0xf7, 0xd0, 0x8e, 0x81, 0x52, 0x0e, 0xa0, 0x45, 0x97, 0xf9, 0x68, 0x9d, 0x8c, 0x9e, 0xe5, 0xf2, 0xfc, 0x92, 0x2c, 0xab, 0x22, 0xde, 0x33, 0x94, 0x05, 0xba, 0x26, 0x1c, 0x6c, 0xde, 0x39, 0xf4, 0x02, 0x23, 0xc7, 0x06, 0x00, 0x9f, 0x60, 0x49, 0x38, 0x7e, 0xc7, 0x77, 0x57, 0x01, 0xff, 0x42, 0x30, 0xe6, 0xbc, 0x75, 0xb9, 0x88, 0x11, 0xee, 0x95, 0x27, 0x4e, 0x68, 0xc8, 0x69, 0x1c, 0xc1, 0xb6, 0x75, 0xc5, 0xea, 0x91, 0xd9, 0x37, 0xe1, 0x9e}, "u5C6CwAE7k8tNg4rFFPPvsv7JdXFFM6Du2uQXaqZagCxMqpVa4BYTJ2gSPekPhW1VAucowXXkb6KkDBXBV1DMLs7bxXFfMZxo24m5yR3B"},
+    {35, {0x80, 0x73, 0xe7, 0x02, 0x18, 0xa0, 0x76, 0x1d, 0xac, 0x71, 0xe3, 0x95, 0xd4, 0xe7, 0x82, 0x29, 0xb0, 0x19, 0xd8, 0xa2, 0x81, 0x07, 0x7c, 0x19, 0xab, 0x0b, 0x02, 0xf1, 0xd1, 0x98, 0xcc, 0x77, 0x73, 0x41, 0x10}, "DpPQDZL5CYYAhkTif82iN3dADhSfBeF5NpaZUwAGXSxWsPHR"},
+    {84, {0x00, 0x00, 0x00, 0x9a, 0xff, 0x93, 0x71, 0x60, 0x54, 0x29, 0xc2, 0x6f, 0x24, 0x65, 0x57, 0x77, 0x21, 0x6f, 0x1d, 0x2a, 0xd9, 0xb4, 0x83, 0x8b, 0x04, 0x11, 0x30, 0x79, 0xaf, 0x55, 0x7b, 0xd7, 0xad, 0x3d, 0xc0, 0xe4, 0x6d, 0xe0, 0x48, 0x39, 0x3e, 0xec, 0x43, 0x75, 0xed, 0xfd, 0xe2, 0x22, 0x3e, 0x25, 0x9a, 0x20, 0xe9, 0xab, 0x01, 0xbf, 0x62, 0x4b, 0x34, 0x1f, 0x86, 0xe2, 0x45, 0x88, 0xba, 0x2b, 0x1b, 0x68, 0xba, 0xdb, 0xac, 0x85, 0xe2, 0x21, 0x79, 0x95, 0x19, 0xad, 0x10, 0x57, 0x53, 0xa7, 0xbd, 0x0a}, "1118TPU4P9Rj7e6kdDz4GzWhYEU6We2ZB7WpGzHjL8PorTY3VB1JtFAwYLaH3UaVzcushqZqAjkt4Ew4ESaS3sfN9gN2BQ32G3QZvZhzr1GHknp64Z"},
+    {90, {0xd7, 0xb8, 0xb9, 0x08, 0xa0, 0x88, 0x5f, 0x03, 0x80, 0xa0, 0x42, 0x09, 0x37, 0xe7, 0x64, 0xb2, 0xc3, 0x4f, 0x51, 0x03, 0x1a, 0x22, 0x07, 0x58, 0xa1, 0x82, 0x68, 0x99, 0x1f, 0xf2, 0x62, 0x36, 0x5b, 0x9c, 0xa0, 0x7d, 0xdd, 0x68, 0x3a, 0x84, 0xad, 0x3c, 0x81, 0x83, 0x8e, 0x5b, 0x4e, 0x9e, 0xf0, 0xbd, 0xf0, 0x8e, 0xe0, 0xe9, 0x5f, 0x18, 0x6f, 0xee, 0xd5, 0x17, 0x57, 0x40, 0xba, 0xc8, 0xc2, 0x2a, 0x88, 0x52, 0x6f, 0x74, 0x30, 0xba, 0xc5, 0x54, 0xc1, 0x88, 0x83, 0x2b, 0x5d, 0xf2, 0x9a, 0x15, 0x1f, 0xa8, 0x39, 0x40, 0x32, 0xd0, 0x65, 0x01}, "aowFSm8Gv9KKkaTJdWM8BbWp7uJbRtjZEstcz1vU26qaX6yKDnkg582wQ4nDTd4Qtf3eQbDcLc2HL8xtSkgsKfZpMCiwZNJ5XDFLRZagvfjTa5HQeveK7wVcAdW"},
+    {103, {0xab, 0x23, 0x2c, 0x9e, 0xc1, 0xbe, 0xd1, 0xf3, 0x26, 0x19, 0x7a, 0xc3, 0x97, 0x4b, 0x45, 0x1c, 0xe5, 0x15, 0xc7, 0x9e, 0x67, 0xe3, 0xc3, 0x4b, 0xf5, 0x4c, 0xa7, 0xdc, 0xd4, 0x51, 0xee, 0x5e, 0xd1, 0x10, 0x89, 0xd1, 0x45, 0xa1, 0xee, 0x7c, 0x93, 0x9f, 0x0d, 0x7d, 0xc6, 0x89, 0x43, 0x81, 0xc3, 0x57, 0x1f, 0x62, 0x46, 0x07, 0x19, 0xf2, 0x70, 0x66, 0xde, 0x24, 0xc5, 0x0f, 0x63, 0x38, 0x7f, 0x04, 0x27, 0x9d, 0x48, 0xe2, 0xab, 0x0b, 0x07, 0x1c, 0x53, 0x7d, 0x44, 0xdc, 0xef, 0xad, 0x0b, 0xba, 0xc8, 0xf2, 0x4d, 0x9c, 0xa4, 0xa2, 0x9e, 0xcb, 0xdd, 0x02, 0xec, 0x7d, 0x80, 0x4d, 0x82, 0x53, 0x39, 0xe2, 0x9a, 0x1f, 0x23}, "AruyjeDgFKwdzv7rngoTquxU67tBbtgDniBy99ozNQALUWvwhgtVWe6gwBKPrFpGAH8x7MsdSdq98pqcpgJMBAWgQQm6CK9w6vCSz43ZpogMPMV6G2D8fLaaa7DNiMXvbvijgsArcBKJa"},
+    {38, {0x17, 0x8e, 0x72, 0x19, 0xca, 0x46, 0xf2, 0x0c, 0xf1, 0x3b, 0x42, 0xb5, 0x5b, 0xdf, 0x47, 0xff, 0x3a, 0x3f, 0xff, 0x6c, 0x68, 0x29, 0x8f, 0x05, 0x76, 0x31, 0x62, 0x33, 0xb2, 0x41, 0x0b, 0x41, 0x8c, 0xa5, 0xaf, 0x8d, 0x62, 0xf3}, "4V7Q7K8kNzGYA13FuwMz2u2WSzUjSbaPfNuACqRb6P1HsD1c43gn"},
+    {81, {0x00, 0xe5, 0x50, 0xbf, 0x82, 0xf1, 0xb3, 0x8f, 0xcc, 0x7d, 0x0b, 0x4f, 0xd3, 0x9c, 0x21, 0x2c, 0xc3, 0x36, 0x47, 0xc9, 0x03, 0xc4, 0xcb, 0x02, 0x7a, 0x9b, 0x94, 0xb4, 0xbc, 0xbd, 0xdf, 0x97, 0x4a, 0x6c, 0xe6, 0xc5, 0xf0, 0xd3, 0x55, 0xf7, 0x6b, 0x3f, 0xa8, 0x4a, 0x41, 0x05, 0xee, 0x15, 0x68, 0x1b, 0xd3, 0xd6, 0xb5, 0xee, 0x59, 0x6b, 0x88, 0xab, 0xc9, 0xa4, 0x4c, 0x6f, 0x96, 0x33, 0x59, 0xd2, 0x72, 0x46, 0xa6, 0x8c, 0x1c, 0xab, 0xea, 0xb2, 0x3e, 0xce, 0x1b, 0x70, 0xd7, 0x47, 0x68}, "13Vw7YMojN7BrRs3pvXpe2sEYQhL4mweNtkuyJLndEtj32E3x3LKte6eH6diwG8edogX8iZ4Saq1hNDiW8tQs4eK3d6QmWs3LhX9zP2wWehBymZ"},
+    {10, {0x7e, 0xae, 0x2f, 0x51, 0x27, 0x49, 0xba, 0x4e, 0x78, 0xad}, "87o3XeFGvYFoPz"},
+    {41, {0xdd, 0x26, 0x7b, 0x5d, 0x12, 0x76, 0x19, 0x9e, 0xd2, 0xc6, 0xc0, 0x96, 0x02, 0xf5, 0xff, 0x9e, 0x0c, 0x8e, 0xdf, 0x54, 0x32, 0xd4, 0xca, 0xb4, 0x54, 0xa7, 0xec, 0x2a, 0xc2, 0xb6, 0x4f, 0x47, 0x8f, 0x21, 0x15, 0x76, 0x54, 0x37, 0xf5, 0x22, 0x16}, "qW2oatSr8tSVg6ijQvJFcvtrVkif8NwxtfENScvXyPA4dmy9gaEDiVvV"},
+    {107, {0x70, 0x9b, 0x89, 0x61, 0x36, 0x20, 0x3f, 0x9e, 0xcb, 0x53, 0x07, 0x5c, 0x90, 0xeb, 0x6b, 0xcc, 0x95, 0x61, 0x00, 0x85, 0xd3, 0x79, 0x0d, 0x21, 0x9e, 0x87, 0xc7, 0xff, 0x80, 0x53, 0x83, 0x30, 0xf0, 0x8a, 0x93, 0x77, 0x7a, 0x13, 0x4d, 0x8e, 0xdc, 0xd8, 0x50, 0x98, 0x45, 0xbe, 0xee, 0x7d, 0xbd, 0x41, 0x32, 0x1c, 0xce, 0x8b, 0x33, 0x7f, 0x3a, 0x10, 0x1b, 0xd6, 0xb4, 0xa7, 0x55, 0x36, 0xcd, 0x44, 0x4b, 0x13, 0xad, 0x14, 0x98, 0x4a, 0x9c, 0x24, 0x5d, 0x56, 0xe0, 0x59, 0x95, 0x0e, 0x5d, 0xc0, 0x0b, 0x7e, 0x1f, 0x2b, 0x05, 0x6c, 0xc8, 0x76, 0xef, 0xc9, 0x76, 0x3a, 0xca, 0x4d, 0xcc, 0x8e, 0xfe, 0x35, 0x62, 0x44, 0x6e, 0x1e, 0x56, 0x0c, 0x72}, "jTUsja5nekGf1HbsheqKydAtCbM5pqf84GJhPbaWFLAyMzvnLMteKZDQkRwUCMTVqvttM9PAkJDCNJGWWB2otcq25MbKwGKE5ruWuMrGUsxnuAEM81tQLurvBA8sGpiqYYWPhAxCmdqfRetaPB"},
+    {105, {0x00, 0x00, 0x00, 0x00, 0x80, 0x0b, 0xeb, 0xce, 0x57, 0x48, 0x1c, 0x0f, 0x24, 0x4f, 0x7b, 0xd7, 0x2a, 0xe2, 0x34, 0xa6, 0x9c, 0xf5, 0x58, 0xd2, 0x6b, 0xf1, 0x0c, 0x7a, 0xfa, 0x2f, 0xa7, 0xbc, 0x43, 0xef, 0x8b, 0xb3, 0x20, 0x81, 0x07, 0xe0, 0x9c, 0x4e, 0xb7, 0xc7, 0x44, 0x29, 0x4b, 0xd2, 0xd9, 0x1e, 0xe3, 0x9f, 0x71, 0xaa, 0x0c, 0x74, 0xde, 0x58, 0xf0, 0xc1, 0x8d, 0x60, 0xfc, 0x42, 0x62, 0xa8, 0xd1, 0xd4, 0xe6, 0x90, 0xd4, 0xe2, 0x3f, 0xc5, 0x7c, 0x08, 0x03, 0xb0, 0x43, 0x42, 0x74, 0xda, 0x56, 0x99, 0xdf, 0x44, 0xf5, 0x8d, 0x42, 0xcc, 0x15, 0xfe, 0x1c, 0x04, 0xc9, 0x9e, 0xcb, 0xed, 0xa2, 0x18, 0xc9, 0x47, 0x1f, 0xcb, 0xb9}, "1111NxxwmXjvmEMWgt1JcMqMRxsqmwvHpFBqmJkfuni7x4CAivKgqaAmWHgL2dMi2JgyzjPHTpRXhaYD7ZqmCcGGDtAYnMFncK1x6yrvgpSTQXtyHoLRJnmSmvNHbXpZH9cM7KY8uLAi88"},
+    {36, {0x82, 0x6a, 0x93, 0x18, 0xa7, 0xa3, 0x1f, 0x2f, 0x8c, 0xeb, 0x00, 0x55, 0x5c, 0x74, 0xd0, 0xa6, 0x42, 0x40, 0xfa, 0x4d, 0x15, 0x72, 0x6d, 0xf6, 0x9e, 0xe3, 0x95, 0xc3, 0x5f, 0x6a, 0x1c, 0xdd, 0xa5, 0x4c, 0x13, 0x3c}, "zSJxF86gBQ2B8A1ehDRwCv2oJExJocpLqaSwLUXU6DUkbgcGK"},
+    {98, {0xbd, 0x7f, 0x43, 0x35, 0xfc, 0x1f, 0xa9, 0xec, 0x02, 0x00, 0xf7, 0x70, 0x5d, 0x00, 0xa4, 0x1d, 0x56, 0xfe, 0x14, 0xb2, 0x0b, 0x79, 0x36, 0x63, 0x29, 0x21, 0xaa, 0x0b, 0x2b, 0x5e, 0x74, 0x13, 0x9e, 0x27, 0xef, 0x02, 0x36, 0x58, 0x08, 0x6b, 0xcb, 0x97, 0xba, 0x80, 0xa1, 0xe0, 0x81, 0xa0, 0xdd, 0x4e, 0x24, 0x40, 0xd3, 0xf8, 0xba, 0x5e, 0xb0, 0xb6, 0x2d, 0x9f, 0xe6, 0x78, 0x24, 0x32, 0x20, 0x3e, 0x1c, 0xcc, 0x6f, 0xe5, 0x03, 0xb9, 0xf0, 0x7b, 0xb5, 0x49, 0xe4, 0x51, 0x34, 0xc2, 0xd0, 0x20, 0x70, 0xdf, 0x4f, 0x20, 0x18, 0x10, 0xb3, 0xc0, 0xc3, 0xfd, 0x15, 0xd9, 0xd5, 0xbb, 0xd1, 0x5d}, "NvhW9SG6uUPKUKbRimGu3y3wUNKbcnZEupV3hXTrJbPMTbBxwAW8rAjYKxSegXM2PzK8Bxj2FwizXoJNVohtxbpLBKWFbtBMBaGdfQZmkigGVP1VeaciXfyopmyPstVKNp3fcx"},
+    {1, {0xc2}, "4M"},
+    {46, {0x00, 0x00, 0xea, 0xa7, 0xbd, 0x57, 0xf5, 0x92, 0xbf, 0xb6, 0x56, 0xca, 0x34, 0xdb, 0x13, 0x5a, 0x87, 0xfb, 0x17, 0x41, 0x55, 0x04, 0xb1, 0xb2, 0x52, 0xb9, 0x8a, 0x67, 0xe2, 0xea, 0xfb, 0x47, 0x54, 0x69, 0x46, 0xbb, 0x02, 0xab, 0xdb, 0x19, 0x6c, 0xd0, 0x11, 0xe7, 0x76, 0x22}, "112KJ81Ba4tJt7vozKKEiYnrypY1oJJDcUHXH2WAaNnG6QiGLBqYRCrrqhRMaiM"},
+    {102, {0x27, 0xec, 0x31, 0x6f, 0xc5, 0x5b, 0x8c, 0x68, 0xea, 0xe2, 0xd5, 0xa0, 0xb0, 0xfc, 0xe1, 0x1f, 0x41, 0x0d, 0xf5, 0x5f, 0xbd, 0x95, 0xd3, 0xe7, 0x2a, 0x3c, 0xdb, 0xbc, 0xc6, 0xcc, 0xdc, 0x9b, 0xea, 0x6d, 0x69, 0xa2, 0x93, 0x76, 0xdc, 0x3c, 0xc6, 0x46, 0x2f, 0x9d, 0x24, 0x65, 0x43, 0x32, 0xa5, 0x65, 0x0d, 0xb3, 0x72, 0xb9, 0xc1, 0x7e, 0xe1, 0x9a, 0xd2, 0xe7, 0xb1, 0x98, 0x9f, 0x1d, 0x09, 0x81, 0xef, 0x4b, 0x7f, 0xfc, 0x78, 0xac, 0x64, 0x98, 0x05, 0x31, 0xa9, 0xa8, 0x0e, 0xcb, 0x64, 0x48, 0x5b, 0x30, 0x89, 0x49, 0x23, 0xa1, 0x14, 0x14, 0x0e, 0xbe, 0xaf, 0xd3, 0xd7, 0xfa, 0x93, 0x53, 0x21, 0xca, 0xf3, 0xf5}, "XEA399aycP7ci9DUtzBisfMwCeQvEC7z4abgMW3tjFRhSw2UtVbBioSaFtRdqxT5Ephn75Qnvpa2Lmc8JFL2VsyDG34GMWMBV6DBwPcptQPcKJYKKKsoabw6KGCqb9WRLpTsPY1WXBJ"},
+    {88, {0xf4, 0x43, 0x15, 0x87, 0x0b, 0xd1, 0xac, 0xef, 0x67, 0x19, 0x08, 0xf1, 0x7f, 0xf6, 0x4b, 0x85, 0xf1, 0x2e, 0x96, 0x2d, 0xb5, 0x08, 0xde, 0x06, 0x93, 0x0d, 0x9c, 0xd7, 0x62, 0x19, 0x82, 0xc8, 0xb2, 0xab, 0xf6, 0x1a, 0x61, 0x53, 0xa3, 0xb1, 0x31, 0x91, 0xdc, 0x35, 0xde, 0x8f, 0x4a, 0x6e, 0x67, 0xcb, 0x88, 0x7f, 0xd2, 0x5e, 0x51, 0x89, 0xb1, 0x4e, 0x05, 0x5d, 0x4a, 0xe4, 0x84, 0x8e, 0xce, 0x98, 0xb8, 0x92, 0xd8, 0x31, 0x6f, 0x5f, 0xca, 0x15, 0xfd, 0x13, 0x63, 0x1a, 0xf2, 0x3d, 0xed, 0x8f, 0xfb, 0x4a, 0xa4, 0x0f, 0x20, 0xac}, "2xyRxje4U5GHXQr1rV3RQxMK9LTt3tXLtZuLK5WasAaXVt5XjAZe6LxGGECJGaaExLYo7QF9eZeuRdH8XWF5qaFhCevMFemCJvgGQgHi18EGABv9ntBHckShq"},
+    {6, {0xb0, 0x9d, 0xa6, 0x06, 0x0b, 0x0c}, "2Wx5BDrq9"},
+    {28, {0x00, 0x00, 0x00, 0x00, 0x9b, 0xd6, 0x57, 0x14, 0x19, 0x0b, 0xa9, 0x73, 0x05, 0x20, 0xc9, 0xb4, 0xfb, 0xf9, 0x03, 0xa2, 0xde, 0x2a, 0x35, 0xf7, 0x27, 0x23, 0xc1, 0x17}, "1111FCzWMDC1eWVGxDQ6RHN3bpc681E2KUxzz"},
+    {115, {0xaf, 0xb3, 0x0a, 0x76, 0x14, 0xda, 0x75, 0x77, 0xf9, 0xad, 0xcc, 0xa5, 0x55, 0x5a, 0xfe, 0x2e, 0x7f, 0x6f, 0xfe, 0x07, 0xae, 0x93, 0x88, 0xb1, 0x31, 0x8b, 0xd5, 0x9a, 0x8b, 0x56, 0xb1, 0x97, 0x6d, 0xca, 0x21, 0x87, 0x43, 0x8f, 0x61, 0x70, 0x74, 0x4a, 0x2d, 0xf0, 0xbd, 0xf6, 0x31, 0x4d, 0x95, 0xf6, 0xbb, 0xe4, 0x80, 0x6e, 0xcb, 0x2a, 0x80, 0x28, 0xd6, 0x3b, 0xf3, 0x2f, 0xe8, 0x10, 0x46, 0x46, 0x71, 0xbe, 0x18, 0xc1, 0x33, 0x8d, 0x3d, 0x0a, 0x0c, 0xe0, 0x83, 0x15, 0x1a, 0x74, 0x18, 0x6b, 0xc2, 0xfa, 0xaf, 0xb4, 0x05, 0x21, 0x70, 0x49, 0x9b, 0xa2, 0xc1, 0x7c, 0x5e, 0x30, 0x85, 0xd6, 0xa0, 0xbf, 0xed, 0xb7, 0xab, 0xa1, 0x0b, 0xd6, 0xff, 0x31, 0x3e, 0xf3, 0xdf, 0x15, 0x6f, 0xd4, 0xb3}, "quXhSVfB8afm1ar8WfsoXf17yDc5rDDjcqSGtMv69FDmh7h5h45AzjwjcHa1f2DaG5wYEudtTz9DRTYYLV5Ddbxa44ukt3iP2SaLUDwPrUBnqgP2RuwcGusoZifW9M9aq9jQFjgcxqkgoBDfEJ6kv1LV56mdL"},
+    {15, {0x1f, 0x01, 0xab, 0xcc, 0x3a, 0x40, 0xab, 0xee, 0x5b, 0x6b, 0x82, 0x81, 0x4f, 0x2d, 0xa9}, "sKA9e5LyJWB24CuYGBFE"},
+    {68, {0x25, 0xca, 0x13, 0xd0, 0xb8, 0x43, 0x0a, 0x6e, 0xe0, 0x3b, 0xab, 0x81, 0x23, 0xf6, 0x15, 0x3f, 0xb5, 0x46, 0x5b, 0x5c, 0x89, 0xc2, 0xf0, 0xcb, 0x46, 0xca, 0x3d, 0xa4, 0xe6, 0xea, 0xec, 0x6c, 0x8c, 0x71, 0x7c, 0x2f, 0x96, 0xf6, 0x43, 0x05, 0xb5, 0x8f, 0x98, 0x52, 0x86, 0x2f, 0x3a, 0xf2, 0xd7, 0xdc, 0x84, 0x18, 0xf1, 0x36, 0x75, 0x6f, 0x97, 0x5d, 0xf8, 0xb5, 0x51, 0x07, 0xcb, 0x63, 0x51, 0x3a, 0x72, 0xce}, "5wkN4oCeAhsAReeNa6BNY242GnjUXccmfMBvc6ESPxXBpTZD2Jna2kvHLNCmDXFJDWr1YHwRwF9qNVwxBKUAjMQ8i3RBj"},
+};
+
+typedef struct {
+    uint64_t value;
+    size_t len;
+    uint8_t serialized[9];
+} varint_vector_t;
+
+static const varint_vector_t varint_vectors[] = {
+    {0x0ULL, 1, {0x00}},
+    {0x1ULL, 1, {0x01}},
+    {0xfcULL, 1, {0xfc}},
+    {0xfdULL, 3, {0xfd, 0xfd, 0x00}},
+    {0xfeULL, 3, {0xfd, 0xfe, 0x00}},
+    {0xffULL, 3, {0xfd, 0xff, 0x00}},
+    {0xffffULL, 3, {0xfd, 0xff, 0xff}},
+    {0x10000ULL, 5, {0xfe, 0x00, 0x00, 0x01, 0x00}},
+    {0xffffffffULL, 5, {0xfe, 0xff, 0xff, 0xff, 0xff}},
+    {0x100000000ULL, 9, {0xff, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00}},
+    {0xffffffffffffffffULL, 9, {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff}},
+    {0x7b4eULL, 3, {0xfd, 0x4e, 0x7b}},
+    {0xb2ULL, 1, {0xb2}},
+    {0xc4586e02f430d6a1ULL, 9, {0xff, 0xa1, 0xd6, 0x30, 0xf4, 0x02, 0x6e, 0x58, 0xc4}},
+    {0xf1ULL, 1, {0xf1}},
+    {0xa742ULL, 3, {0xfd, 0x42, 0xa7}},
+    {0x7eULL, 1, {0x7e}},
+    {0x61d49f2dULL, 5, {0xfe, 0x2d, 0x9f, 0xd4, 0x61}},
+    {0xf654801d709736e2ULL, 9, {0xff, 0xe2, 0x36, 0x97, 0x70, 0x1d, 0x80, 0x54, 0xf6}},
+    {0xfdb967bbcad48b61ULL, 9, {0xff, 0x61, 0x8b, 0xd4, 0xca, 0xbb, 0x67, 0xb9, 0xfd}},
+    {0xe09a40edc5502b19ULL, 9, {0xff, 0x19, 0x2b, 0x50, 0xc5, 0xed, 0x40, 0x9a, 0xe0}},
+    {0x3bULL, 1, {0x3b}},
+    {0xcbULL, 1, {0xcb}},
+    {0xc276ULL, 3, {0xfd, 0x76, 0xc2}},
+    {0xeb10c89ea10b2697ULL, 9, {0xff, 0x97, 0x26, 0x0b, 0xa1, 0x9e, 0xc8, 0x10, 0xeb}},
+    {0x10ULL, 1, {0x10}},
+    {0xdbc7af42ULL, 5, {0xfe, 0x42, 0xaf, 0xc7, 0xdb}},
+    {0xb254ac6a909237a8ULL, 9, {0xff, 0xa8, 0x37, 0x92, 0x90, 0x6a, 0xac, 0x54, 0xb2}},
+    {0xabULL, 1, {0xab}},
+    {0xc55e210dULL, 5, {0xfe, 0x0d, 0x21, 0x5e, 0xc5}},
+    {0x6a520d90ULL, 5, {0xfe, 0x90, 0x0d, 0x52, 0x6a}},
+    {0x12209c61ULL, 5, {0xfe, 0x61, 0x9c, 0x20, 0x12}},
+};
+
+typedef struct {
+    size_t n_leaves;
+    size_t leaves_len;  // the leaves are the element hashes of leaves_len bytes each
+    uint8_t leaves_seed;  // leaf i is made of the bytes (leaves_seed + i + k) % 256
+    uint8_t root[32];
+} merkle_root_vector_t;
+
+static const merkle_root_vector_t merkle_root_vectors[] = {
+    {1, 22, 37, {0x93, 0x5c, 0xcb, 0xe4, 0x3d, 0x8c, 0x1e, 0xa5, 0x8d, 0x1b, 0x45, 0xa1, 0x1b, 0xc0, 0x34, 0x7d, 0x80, 0x1b, 0xe1, 0x49, 0xbd, 0x89, 0x0c, 0x71, 0xb4, 0x8b, 0x73, 0x62, 0xec, 0x08, 0x4a, 0x4e}},
+    {2, 6, 199, {0xd2, 0x73, 0x64, 0x4c, 0xe9, 0x61, 0x72, 0xfc, 0x7a, 0xbe, 0xbd, 0x1c, 0x54, 0xad, 0xab, 0x12, 0x66, 0xe6, 0xf6, 0x48, 0x24, 0xe3, 0x22, 0x63, 0xc8, 0xf3, 0xd8, 0x52, 0x9c, 0x3a, 0xb2, 0xd2}},
+    {3, 18, 121, {0xcb, 0xa4, 0x24, 0x93, 0xc0, 0x57, 0xda, 0xb4, 0xec, 0x2d, 0xdd, 0xf2, 0xab, 0x58, 0xa0, 0x30, 0x60, 0x82, 0x50, 0x00, 0x33, 0x69, 0x91, 0x3e, 0x9e, 0x63, 0x30, 0x82, 0xd7, 0x43, 0x89, 0xfc}},
+    {4, 38, 186, {0x8a, 0x9b, 0xa4, 0x40, 0x42, 0xa2, 0x65, 0x0a, 0x02, 0xca, 0xd8, 0xb9, 0x8b, 0xf0, 0xc7, 0x7c, 0xb0, 0xb7, 0x97, 0x7a, 0x6f, 0x14, 0x06, 0xf0, 0x3a, 0xb2, 0x6f, 0x51, 0x59, 0xd0, 0xb6, 0x5c}},
+    {5, 27, 0, {0xdc, 0x9e, 0x24, 0xff, 0x06, 0x7c, 0xeb, 0x3b, 0xcc, 0x14, 0xfa, 0xf1, 0x3b, 0xcf, 0xd6, 0xce, 0xec, 0x46, 0xdb, 0xea, 0x19, 0x4a, 0xd1, 0x5c, 0x14, 0xc2, 0x6a, 0x4a, 0xef, 0xdc, 0x59, 0x75}},
+    {6, 32, 228, {0xa0, 0x8c, 0xf8, 0xeb, 0x74, 0x1e, 0xd1, 0xd8, 0xf8, 0x30, 0x67, 0xa5, 0x17, 0x9e, 0x95, 0x30, 0x24, 0xcd, 0xde, 0x62, 0x0e, 0xa3, 0x79, 0xa4, 0xb1, 0xa8, 0x2e, 0xd7, 0x60, 0x6a, 0xdf, 0x41}},
+    {7, 0, 145, {0x08, 0x7a, 0x31, 0x0a, 0x52, 0xe7, 0x29, 0x57, 0x51, 0x49, 0xb1, 0x41, 0x7c, 0x1c, 0x7e, 0x5a, 0xa4, 0x75, 0xc5, 0x56, 0x1b, 0x63, 0x0e, 0x8e, 0xd6, 0x28, 0xcf, 0xee, 0x38, 0x14, 0x58, 0xc0}},
+    {8, 33, 71, {0xb7, 0xfa, 0x2e, 0xd9, 0x9e, 0xe9, 0x63, 0x8b, 0x79, 0x7c, 0xea, 0x6b, 0xde, 0x89, 0x26, 0x2d, 0x80, 0x17, 0x04, 0x9a, 0xad, 0xf3, 0x36, 0xe7, 0x92, 0x78, 0xc3, 0x1b, 0x52, 0xcf, 0x8b, 0xeb}},
+    {120, 10, 116, {0xb3, 0x89, 0x76, 0xcb, 0x69, 0x1d, 0x15, 0x71, 0x79, 0x74, 0xc0, 0x15, 0xe3, 0xb7, 0x89, 0xdb, 0xc6, 0x79, 0x6b, 0x51, 0x37, 0x1c, 0x56, 0xe9, 0x43, 0xda, 0x41, 0x44, 0x7b, 0x22, 0x91, 0x64}},
+    {189, 37, 232, {0xce, 0x1a, 0x07, 0x1a, 0xd2, 0xde, 0xf6, 0x62, 0xe2, 0x9f, 0xf3, 0xeb, 0x7f, 0xd0, 0x6a, 0xc9, 0xc0, 0x57, 0x19, 0xfa, 0xb7, 0x3d, 0x0a, 0x9f, 0x96, 0xc0, 0xbb, 0x8c, 0xd4, 0xda, 0x35, 0x66}},
+    {43, 37, 38, {0x57, 0x0f, 0xe5, 0xe1, 0x98, 0xec, 0xa3, 0xe6, 0x8c, 0x61, 0xb3, 0xb2, 0x7e, 0x3d, 0xca, 0x35, 0xeb, 0xb6, 0x9e, 0x64, 0xeb, 0xe0, 0x67, 0xcc, 0x66, 0x6f, 0x3d, 0xb6, 0x05, 0x50, 0xfd, 0x4f}},
+    {114, 14, 244, {0xb7, 0x4a, 0xe9, 0xd1, 0x3e, 0x87, 0x4f, 0x7e, 0x2d, 0x1e, 0x09, 0xc6, 0x9b, 0x5e, 0xe0, 0x72, 0x1a, 0x76, 0x97, 0x69, 0xde, 0xf7, 0x8e, 0x12, 0x1a, 0xb1, 0xd7, 0xc6, 0x95, 0x1c, 0xcf, 0x11}},
+    {88, 0, 178, {0xf0, 0x57, 0x1f, 0x2f, 0x63, 0xc2, 0x8a, 0xdb, 0x02, 0x91, 0x3d, 0x57, 0xf2, 0xbc, 0xc2, 0xd9, 0xd9, 0xb4, 0xa0, 0xbd, 0xdc, 0x60, 0x01, 0xa0, 0xa4, 0xd0, 0xc0, 0x22, 0xfc, 0x80, 0x03, 0x36}},
+    {269, 30, 138, {0x0a, 0xb1, 0xd4, 0x35, 0x7d, 0x8e, 0x3a, 0x11, 0xaf, 0x87, 0x0d, 0xee, 0x14, 0x0f, 0x9a, 0x1b, 0xa3, 0xcc, 0x85, 0x1f, 0x98, 0xb6, 0x28, 0x9a, 0xb5, 0xb4, 0xff, 0xa3, 0x97, 0x31, 0xe0, 0xd5}},
+    {15, 38, 67, {0x5c, 0x9b, 0x4c, 0xa7, 0xfe, 0xe3, 0x08, 0x41, 0x06, 0x75, 0xc1, 0x83, 0xe9, 0x74, 0xd6, 0x3a, 0xbb, 0x7e, 0xca, 0x8a, 0xf7, 0xb9, 0x37, 0x09, 0x73, 0xe3, 0x4b, 0x10, 0xae, 0x41, 0x69, 0xb6}},
+    {268, 29, 53, {0x44, 0x93, 0x7f, 0xa4, 0x6a, 0x3a, 0x71, 0x66, 0xf2, 0xbe, 0xc6, 0xc8, 0xa0, 0x20, 0x5b, 0xef, 0x29, 0x91, 0x92, 0x30, 0xea, 0x07, 0xff, 0x88, 0x91, 0xd9, 0x01, 0xe1, 0x20, 0xb1, 0x91, 0x3e}},
+};
@@ -0,0 +1,104 @@
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint*_t
+#include <string.h>  // memcpy, memset
+
+#include "cx_ram.h"
+
+#include "reference.h"
+
+// The Merkle trees of the app before the single-update proofs and the O(log n) directions: one
+// hash update per field, and the directions recomputed from the root for each level.
+
+// the hash functions of the SDK are mocked in mock_sha256.c
+
+void ref_merkle_combine_hashes(const uint8_t left[static 32],
+                               const uint8_t right[static 32],
+                               uint8_t out[static 32]) {
+    cx_sha256_t hash;
+    cx_sha256_init_no_throw(&hash);
+
+    // H(0x01 | left | right)
+    uint8_t prefix = 0x01;
+    cx_hash_no_throw(&hash.header, 0, &prefix, 1, NULL, 0);
+    cx_hash_no_throw(&hash.header, 0, left, 32, NULL, 0);
+    cx_hash_no_throw(&hash.header, CX_LAST, right, 32, out, 32);
+}
+
+static uint8_t ref_ceil_lg(size_t n) {
+    uint8_t r = 0;
+    size_t t = 1;
+    while (t < n) {
+        t = 2 * t;
+        ++r;
+    }
+    return r;
+}
+
+int ref_merkle_get_ith_direction(size_t size, size_t index, size_t i) {
+    if (size <= 1 || index >= size) {
+        return -1;
+    }
+
+    size_t n_directions = 0;
+    while (size > 1) {
+        // number of leaves of the left subtree
+        size_t mask = (size_t) 1 << (ref_ceil_lg(size) - 1);
+
+        int is_right_child = (index & mask) != 0 ? 1 : 0;
+        if (n_directions == i) {
+            return is_right_child;
+        }
+        ++n_directions;
+
+        if (is_right_child) {
+            size -= mask;
+            index -= mask;
+        } else {
+            size = mask;
+        }
+    }
+
+    return -1;
+}
+
+void ref_merkle_compute_root(const uint8_t (*leaf_hashes)[32],
+                             size_t n_leaves,
+                             uint8_t out[static 32]) {
+    if (n_leaves == 0) {
+        memset(out, 0, 32);
+        return;
+    } else if (n_leaves == 1) {
+        memcpy(out, leaf_hashes[0], 32);
+        return;
+    }
+
+    size_t n_left = (size_t) 1 << (ref_ceil_lg(n_leaves) - 1);
+
+    uint8_t left_hash[32], right_hash[32];
+    ref_merkle_compute_root(leaf_hashes, n_left, left_hash);
+    ref_merkle_compute_root(leaf_hashes + n_left, n_leaves - n_left, right_hash);
+    ref_merkle_combine_hashes(left_hash, right_hash, out);
+}
+
+size_t ref_merkle_compute_proof(const uint8_t (*leaf_hashes)[32],
+                                size_t n_leaves,
+                                size_t index,
+                                uint8_t (*proof)[32]) {
+    if (n_leaves <= 1) {
+        return 0;
+    }
+
+    size_t n_left = (size_t) 1 << (ref_ceil_lg(n_leaves) - 1);
+    size_t len;
+    if (index < n_left) {
+        len = ref_merkle_compute_proof(leaf_hashes, n_left, index, proof);
+        ref_merkle_compute_root(leaf_hashes + n_left, n_leaves - n_left, proof[len]);
+    } else {
+        len = ref_merkle_compute_proof(leaf_hashes + n_left,
+                                       n_leaves - n_left,
+                                       index - n_left,
+                                       proof);
+        ref_merkle_compute_root(leaf_hashes, n_left, proof[len]);
+    }
+    return len + 1;
+}
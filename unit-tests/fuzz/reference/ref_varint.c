@@ -0,0 +1,99 @@
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint*_t
+
+#include "reference.h"
+
+// The varints of the app before the fast paths, with the integers read and written one byte at a
+// time instead of with the helpers of read.h and write.h.
+
+static uint64_t read_le(const uint8_t *in, size_t len) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < len; i++) {
+        value |= (uint64_t) in[i] << (8 * i);
+    }
+    return value;
+}
+
+static void write_le(uint8_t *out, uint64_t value, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        out[i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+uint8_t ref_varint_size(uint64_t value) {
+    if (value <= 0xFC) {
+        return 1;
+    }
+
+    if (value <= UINT16_MAX) {
+        return 3;
+    }
+
+    if (value <= UINT32_MAX) {
+        return 5;
+    }
+
+    return 9;  // <= UINT64_MAX
+}
+
+int ref_varint_read(const uint8_t *in, size_t in_len, uint64_t *value) {
+    if (in_len < 1) {
+        return -1;
+    }
+
+    uint8_t prefix = in[0];
+
+    if (prefix == 0xFD) {
+        if (in_len < 3) {
+            return -1;
+        }
+        *value = read_le(in + 1, 2);
+        return 3;
+    }
+
+    if (prefix == 0xFE) {
+        if (in_len < 5) {
+            return -1;
+        }
+        *value = read_le(in + 1, 4);
+        return 5;
+    }
+
+    if (prefix == 0xFF) {
+        if (in_len < 9) {
+            return -1;
+        }
+        *value = read_le(in + 1, 8);
+        return 9;
+    }
+
+    *value = (uint64_t) prefix;  // prefix <= 0xFC
+
+    return 1;
+}
+
+int ref_varint_write(uint8_t *out, size_t offset, uint64_t value) {
+    uint8_t varint_len = ref_varint_size(value);
+
+    switch (varint_len) {
+        case 1:
+            out[offset] = (uint8_t) value;
+            break;
+        case 3:
+            out[offset++] = 0xFD;
+            write_le(out + offset, value, 2);
+            break;
+        case 5:
+            out[offset++] = 0xFE;
+            write_le(out + offset, value, 4);
+            break;
+        case 9:
+            out[offset++] = 0xFF;
+            write_le(out + offset, value, 8);
+            break;
+        default:
+            return -1;
+    }
+
+    return varint_len;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint*_t
+
+#include "common/segwit_addr.h"
+
+/*
+  The implementations of the kernels of src/common before their optimizations, that the fuzz
+  targets use as a reference: they have the same contracts as the functions of the app with the
+  same name without the ref_ prefix (see the headers of src/common).
+*/
+
+int ref_base58_decode(const char *in, size_t in_len, uint8_t *out, size_t out_len);
+int ref_base58_encode(const uint8_t *in, size_t in_len, char *out, size_t out_len);
+
+int ref_bech32_encode(char *output,
+                      const char *hrp,
+                      const uint8_t *data,
+                      size_t data_len,
+                      bech32_encoding enc);
+bech32_encoding ref_bech32_decode(char *hrp, uint8_t *data, size_t *data_len, const char *input);
+int ref_segwit_addr_encode(char *output,
+                           const char *hrp,
+                           int ver,
+                           const uint8_t *prog,
+                           size_t prog_len);
+int ref_segwit_addr_decode(int *ver,
+                           uint8_t *prog,
+                           size_t *prog_len,
+                           const char *hrp,
+                           const char *addr);
+
+uint8_t ref_varint_size(uint64_t value);
+int ref_varint_read(const uint8_t *in, size_t in_len, uint64_t *value);
+int ref_varint_write(uint8_t *out, size_t offset, uint64_t value);
+
+void ref_merkle_combine_hashes(const uint8_t left[static 32],
+                               const uint8_t right[static 32],
+                               uint8_t out[static 32]);
+int ref_merkle_get_ith_direction(size_t size, size_t index, size_t i);
+void ref_merkle_compute_root(const uint8_t (*leaf_hashes)[32],
+                             size_t n_leaves,
+                             uint8_t out[static 32]);
+
+/**
+ * Computes the Merkle proof of the leaf with the given index, from the lowest level, into proof
+ * (at least 32 entries); returns its length.
+ */
+size_t ref_merkle_compute_proof(const uint8_t (*leaf_hashes)[32],
+                                size_t n_leaves,
+                                size_t index,
+                                uint8_t (*proof)[32]);
@@ -0,0 +1,90 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "cx_ram.h"
+
+#include "common/base58.h"
+#include "common/merkle.h"
+#include "common/varint.h"
+
+#include "python_vectors.h"
+
+// the hash functions of the SDK are mocked in mock_sha256.c
+
+static void test_base58_python_vectors(void **state) {
+    (void) state;
+
+    for (size_t i = 0; i < sizeof(base58_vectors) / sizeof(base58_vectors[0]); i++) {
+        const base58_vector_t *vector = &base58_vectors[i];
+        size_t encoded_len = strlen(vector->encoded);
+
+        char encoded[MAX_DEC_INPUT_SIZE];
+        assert_int_equal(base58_encode(vector->data, vector->data_len, encoded, sizeof(encoded)),
+                         encoded_len);
+        assert_memory_equal(encoded, vector->encoded, encoded_len);
+
+        uint8_t decoded[MAX_ENC_INPUT_SIZE];
+        assert_int_equal(base58_decode(vector->encoded, encoded_len, decoded, sizeof(decoded)),
+                         vector->data_len);
+        assert_memory_equal(decoded, vector->data, vector->data_len);
+    }
+}
+
+static void test_varint_python_vectors(void **state) {
+    (void) state;
+
+    for (size_t i = 0; i < sizeof(varint_vectors) / sizeof(varint_vectors[0]); i++) {
+        const varint_vector_t *vector = &varint_vectors[i];
+
+        uint8_t serialized[9];
+        assert_int_equal(varint_size(vector->value), vector->len);
+        assert_int_equal(varint_write(serialized, 0, vector->value), vector->len);
+        assert_memory_equal(serialized, vector->serialized, vector->len);
+
+        uint64_t value;
+        assert_int_equal(varint_read(vector->serialized, vector->len, &value), vector->len);
+        assert_true(value == vector->value);
+    }
+}
+
+static void test_merkle_root_python_vectors(void **state) {
+    (void) state;
+
+    static uint8_t leaves[300][32];
+    for (size_t i = 0; i < sizeof(merkle_root_vectors) / sizeof(merkle_root_vectors[0]); i++) {
+        const merkle_root_vector_t *vector = &merkle_root_vectors[i];
+        assert_true(vector->n_leaves <= sizeof(leaves) / sizeof(leaves[0]));
+
+        for (size_t j = 0; j < vector->n_leaves; j++) {
+            // the element hash H(0x00 | data)
+            uint8_t element[1 + 40];
+            element[0] = 0x00;
+            for (size_t k = 0; k < vector->leaves_len; k++) {
+                element[1 + k] = (uint8_t) (vector->leaves_seed + j + k);
+            }
+            cx_sha256_t hash;
+            cx_sha256_init_no_throw(&hash);
+            cx_hash_no_throw(&hash.header, CX_LAST, element, 1 + vector->leaves_len, leaves[j], 32);
+        }
+
+        uint8_t root[32];
+        merkle_compute_root((const uint8_t(*)[32]) leaves, vector->n_leaves, root);
+        assert_memory_equal(root, vector->root, 32);
+    }
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_base58_python_vectors),
+        cmocka_unit_test(test_varint_python_vectors),
+        cmocka_unit_test(test_merkle_root_python_vectors),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
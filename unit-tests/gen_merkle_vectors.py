@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""
+Generates merkle_vectors.h, with random Merkle proofs produced by MerkleTree.prove_leaf of the Python client, that
+are used by test_merkle.c to cross-check the implementation of the app. Run from the root of the repository:
+
+    python3 unit-tests/gen_merkle_vectors.py > unit-tests/merkle_vectors.h
+"""
+
+import random
+import sys
+from pathlib import Path
+
+sys.path.append(str(Path(__file__).resolve().parent.parent))
+
+from bitcoin_client.merkle import MerkleTree, element_hash  # noqa: E402
+
+N_VECTORS = 16
+SEED = 54
+
+
+def c_bytes(data: bytes) -> str:
+    return "{" + ", ".join(f"0x{b:02x}" for b in data) + "}"
+
+
+def directions(tree: MerkleTree, index: int) -> int:
+    """Returns the directions of the path from the root to the leaf, where bit i is the ith direction from the root
+    (1 = right), derived from the levels of the tree."""
+
+    steps = []
+    for level in tree.levels[:-1]:
+        if index ^ 1 < len(level):
+            steps.append(index & 1)  # there is a sibling, hence a step of the proof
+        index //= 2
+
+    # steps are from the leaf; the directions are numbered from the root
+    return sum(bit << (len(steps) - 1 - k) for k, bit in enumerate(steps))
+
+
+def main():
+    random.seed(SEED)
+
+    print("// Generated by gen_merkle_vectors.py; do not edit.")
+    print()
+    print("#pragma once")
+    print()
+    print("#include <stdint.h>")
+    print("#include <stddef.h>")
+    print()
+    print("typedef struct {")
+    print("    size_t size;")
+    print("    size_t index;")
+    print("    uint32_t directions;")
+    print("    size_t proof_len;")
+    print("    uint8_t leaf[32];")
+    print("    uint8_t root[32];")
+    print("    uint8_t proof[32][32];")
+    print("} merkle_vector_t;")
+    print()
+    print("static const merkle_vector_t merkle_vectors[] = {")
+    for _ in range(N_VECTORS):
+        size = random.choice([random.randint(1, 40), random.randint(41, 3000)])
+        index = random.randrange(size)
+        tree = MerkleTree(element_hash(random.randbytes(8)) for _ in range(size))
+        proof = tree.prove_leaf(index)
+
+        print("    {")
+        print(f"        .size = {size},")
+        print(f"        .index = {index},")
+        print(f"        .directions = 0x{directions(tree, index):x},")
+        print(f"        .proof_len = {len(proof)},")
+        print(f"        .leaf = {c_bytes(tree.get(index))},")
+        print(f"        .root = {c_bytes(tree.root)},")
+        print("        .proof = {" + ", ".join(c_bytes(h) for h in proof) + "},")
+        print("    },")
+    print("};")
+
+
+if __name__ == "__main__":
+    main()
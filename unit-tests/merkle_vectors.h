@@ -0,0 +1,163 @@
+// Generated by gen_merkle_vectors.py; do not edit.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+    size_t size;
+    size_t index;
+    uint32_t directions;
+    size_t proof_len;
+    uint8_t leaf[32];
+    uint8_t root[32];
+    uint8_t proof[32][32];
+} merkle_vector_t;
+
+static const merkle_vector_t merkle_vectors[] = {
+    {
+        .size = 1838,
+        .index = 989,
+        .directions = 0x5de,
+        .proof_len = 11,
+        .leaf = {0xf0, 0x76, 0x9d, 0x35, 0x32, 0xdc, 0x10, 0x14, 0xdf, 0x4a, 0x03, 0x20, 0x67, 0x81, 0xbb, 0x69, 0x35, 0xd4, 0x1a, 0xad, 0xfc, 0x63, 0x01, 0x4a, 0xbd, 0xe0, 0xf1, 0x90, 0xdf, 0xd5, 0xfb, 0xd4},
+        .root = {0x97, 0x6b, 0x8a, 0x17, 0x6a, 0x91, 0xef, 0xfe, 0xe1, 0x76, 0xc7, 0xd2, 0x48, 0x21, 0xe4, 0xa8, 0x29, 0xb6, 0x03, 0xa4, 0x58, 0x25, 0x80, 0xd2, 0xe4, 0xcf, 0x6b, 0xe3, 0xaa, 0x63, 0x62, 0x25},
+        .proof = {{0xa8, 0xa5, 0x65, 0xc1, 0xd4, 0x6f, 0xa5, 0xd2, 0x2e, 0x8a, 0x5a, 0x24, 0x8f, 0xb2, 0x67, 0xec, 0x49, 0xad, 0x92, 0xcb, 0xf9, 0x4d, 0x0f, 0x1d, 0x09, 0xb8, 0xbf, 0xe2, 0x25, 0x5d, 0x3a, 0x3c}, {0xeb, 0x60, 0x46, 0xd2, 0x40, 0xc4, 0xa3, 0xa8, 0x34, 0x32, 0x4b, 0x64, 0xf1, 0x92, 0xcd, 0x16, 0x10, 0x65, 0x77, 0xd7, 0x3d, 0x6d, 0xf3, 0x55, 0x57, 0x05, 0x7e, 0xda, 0xf6, 0x9a, 0x39, 0x0e}, {0x80, 0xd5, 0x2f, 0xfd, 0x1b, 0x03, 0xc8, 0x16, 0x54, 0x57, 0x47, 0x24, 0x7c, 0x8c, 0x6e, 0x47, 0x55, 0xea, 0x0f, 0xbd, 0xd5, 0x17, 0xe6, 0x38, 0x4d, 0x63, 0x81, 0xea, 0x2e, 0x56, 0x1a, 0x3d}, {0x0b, 0xab, 0x85, 0x63, 0x57, 0x65, 0xd3, 0xaa, 0xd6, 0x56, 0xa4, 0x8a, 0x1e, 0x00, 0xd8, 0xa9, 0xb5, 0x7c, 0x9f, 0x53, 0x95, 0x79, 0x1a, 0x09, 0x59, 0xaf, 0x9b, 0xc4, 0x21, 0xda, 0xc9, 0x4b}, {0xe4, 0x5c, 0x48, 0x83, 0x7c, 0x44, 0x4b, 0x4b, 0xf2, 0x4c, 0x06, 0x5b, 0x72, 0xb9, 0xf8, 0x46, 0xf8, 0xf5, 0xef, 0x3d, 0x7c, 0xfb, 0xb5, 0x25, 0xd2, 0xb6, 0xc1, 0x4c, 0xd5, 0xde, 0xf8, 0x13}, {0x2f, 0x43, 0xd1, 0x1e, 0x17, 0x20, 0xe5, 0x91, 0x62, 0x73, 0x16, 0x2c, 0xab, 0xfc, 0x7b, 0x52, 0x72, 0x9e, 0x52, 0x7f, 0x88, 0xbc, 0xcb, 0xd1, 0x9c, 0x99, 0x9b, 0xba, 0x9b, 0x77, 0x31, 0x36}, {0x83, 0x28, 0xd4, 0xf1, 0xb4, 0x08, 0xb1, 0x16, 0x05, 0xfe, 0xd7, 0x15, 0xe8, 0xe3, 0x47, 0x4f, 0x23, 0xf6, 0xfd, 0x6d, 0xa9, 0x87, 0x24, 0xde, 0x56, 0xed, 0x22, 0xf9, 0xd7, 0xea, 0xb5, 0x35}, {0xf0, 0xf4, 0x5f, 0x3c, 0x18, 0xa6, 0x1c, 0x25, 0xe8, 0x35, 0xe3, 0x15, 0x6c, 0x2f, 0x26, 0xd4, 0x21, 0xb0, 0xaa, 0x28, 0xd6, 0x10, 0xae, 0x9e, 0x5a, 0x7c, 0xcf, 0x13, 0xf1, 0x55, 0xdb, 0x73}, {0xba, 0x37, 0xd8, 0xb2, 0xe1, 0x37, 0xa2, 0x86, 0xe1, 0x98, 0x22, 0xea, 0x62, 0xf0, 0xcc, 0xf6, 0x98, 0x55, 0xe0, 0x7c, 0xf7, 0x66, 0x0f, 0x67, 0xd5, 0x31, 0x36, 0x96, 0x4f, 0x15, 0x20, 0x12}, {0xbd, 0x34, 0xd7, 0xd1, 0x89, 0x3f, 0x78, 0xe2, 0xf5, 0x66, 0x11, 0xbb, 0xff, 0x43, 0xef, 0x51, 0x27, 0x53, 0x58, 0x4c, 0x2f, 0x75, 0x64, 0x96, 0x0f, 0xb6, 0x5b, 0x3f, 0x6e, 0xc9, 0x67, 0xc5}, {0x46, 0xf7, 0xc8, 0xc5, 0x89, 0xb0, 0xf2, 0x14, 0x97, 0xdc, 0xb2, 0x95, 0xf7, 0x61, 0x4c, 0x49, 0xb1, 0x43, 0xb4, 0xe6, 0x96, 0xd2, 0xf7, 0x5a, 0x1b, 0x4d, 0x5e, 0xf8, 0x13, 0x70, 0x21, 0xa2}},
+    },
+    {
+        .size = 38,
+        .index = 24,
+        .directions = 0x6,
+        .proof_len = 6,
+        .leaf = {0xed, 0xdb, 0xc4, 0x33, 0x00, 0xd1, 0xc1, 0xe9, 0x5f, 0x8a, 0xc2, 0x1f, 0x20, 0x31, 0x2f, 0x32, 0xea, 0x76, 0xda, 0x1d, 0x7f, 0x27, 0x60, 0x6e, 0x47, 0xc4, 0x3f, 0x95, 0x63, 0x57, 0x78, 0x45},
+        .root = {0x22, 0x7d, 0x10, 0x70, 0x70, 0x41, 0x4b, 0x25, 0xc1, 0x56, 0x00, 0x30, 0xdc, 0x5e, 0xc8, 0xd1, 0x22, 0x08, 0x49, 0xeb, 0xac, 0x22, 0x71, 0x32, 0xa6, 0xf9, 0xeb, 0x5d, 0x0a, 0x0e, 0x73, 0x1f},
+        .proof = {{0x8f, 0x81, 0x5f, 0xe6, 0x2a, 0xb3, 0x99, 0x06, 0x9c, 0x34, 0xa6, 0x2d, 0x72, 0x2c, 0x3e, 0xde, 0x3a, 0xa2, 0x29, 0x9c, 0x77, 0xb3, 0x2a, 0xc4, 0xf1, 0x33, 0x92, 0xa7, 0x82, 0x76, 0xca, 0x9e}, {0xd9, 0xe8, 0x6f, 0xf0, 0x39, 0x15, 0x08, 0x25, 0x7e, 0x8b, 0xb4, 0x7d, 0x9b, 0xa3, 0x54, 0x3d, 0x57, 0xc9, 0xd4, 0x0c, 0xd1, 0xee, 0x38, 0x88, 0xd4, 0x42, 0xa2, 0x82, 0x6a, 0xc3, 0xbd, 0xb3}, {0xa8, 0x0b, 0xfa, 0x71, 0x8b, 0x7e, 0x73, 0x93, 0xe5, 0xfb, 0x6c, 0x05, 0xf3, 0x75, 0xee, 0x1c, 0xa7, 0xf7, 0xad, 0xa7, 0x0e, 0xd5, 0x07, 0x37, 0x71, 0x49, 0x8c, 0xcc, 0x47, 0x3b, 0x3d, 0x1d}, {0xfe, 0x67, 0x32, 0x45, 0x8d, 0x33, 0x3e, 0xa0, 0x6e, 0x1c, 0x1b, 0xfe, 0x99, 0x6e, 0x93, 0x4d, 0x19, 0x97, 0x9b, 0xc8, 0x39, 0xe9, 0x38, 0x2e, 0x16, 0x0e, 0xe5, 0x63, 0xc4, 0x7b, 0x86, 0xd5}, {0xf8, 0xeb, 0x64, 0x4f, 0x14, 0x32, 0xc7, 0x26, 0xc2, 0x7b, 0x07, 0x5b, 0xdf, 0x8e, 0x73, 0xa3, 0x5c, 0x7a, 0xa4, 0x70, 0xea, 0x02, 0x94, 0xc4, 0x29, 0x1e, 0x44, 0x62, 0xc9, 0xdc, 0xb0, 0x7f}, {0xe8, 0x06, 0x4f, 0x4e, 0x1c, 0x69, 0xc1, 0x49, 0x40, 0xcc, 0x58, 0x42, 0xcb, 0x9d, 0x0a, 0x0b, 0x63, 0x7b, 0x71, 0x68, 0x10, 0xd3, 0xd9, 0xed, 0xeb, 0x0a, 0xc6, 0x7b, 0xfb, 0x3d, 0x10, 0x1e}},
+    },
+    {
+        .size = 13,
+        .index = 4,
+        .directions = 0x2,
+        .proof_len = 4,
+        .leaf = {0x3a, 0x5d, 0xb6, 0x5e, 0xbc, 0xfc, 0xd3, 0x40, 0x4b, 0x4b, 0x16, 0x97, 0x9d, 0x27, 0xa1, 0xac, 0xcd, 0xf9, 0xc2, 0xae, 0x30, 0xe9, 0x99, 0x6b, 0x5b, 0xeb, 0x62, 0x99, 0x45, 0x59, 0x22, 0x41},
+        .root = {0x1e, 0x95, 0xb6, 0x5d, 0x30, 0xaf, 0x67, 0xef, 0xb7, 0x1e, 0xbd, 0x80, 0xbe, 0xc9, 0xb1, 0x5e, 0x27, 0x2c, 0xda, 0x45, 0x85, 0x17, 0x80, 0xe9, 0xe5, 0x2a, 0xe6, 0xd7, 0x78, 0x3b, 0x43, 0x64},
+        .proof = {{0xc9, 0x9e, 0x4f, 0x49, 0x24, 0x53, 0xdb, 0xf3, 0x61, 0xac, 0x29, 0x81, 0x70, 0x54, 0x81, 0xf6, 0xc4, 0x01, 0x4a, 0x57, 0xa5, 0x88, 0x86, 0x24, 0xab, 0xa5, 0x05, 0xa2, 0xc9, 0x5f, 0x40, 0xf3}, {0xac, 0xdb, 0x6f, 0x41, 0x11, 0xc7, 0xad, 0x0d, 0xeb, 0xe7, 0x00, 0x49, 0x9c, 0xb1, 0xa6, 0x7e, 0xf1, 0x9b, 0x18, 0x09, 0xcc, 0xd6, 0xb0, 0x1c, 0x3b, 0xf2, 0x59, 0xd8, 0x5f, 0x36, 0xc1, 0xd7}, {0x75, 0xb5, 0xde, 0x96, 0xe0, 0x23, 0xb9, 0xbc, 0x10, 0x84, 0xc9, 0xb8, 0x58, 0x31, 0xd6, 0xa3, 0xe9, 0xbd, 0xe5, 0x1d, 0xab, 0x60, 0xdd, 0xe1, 0x3c, 0x5b, 0xb5, 0x97, 0x14, 0x49, 0x82, 0x59}, {0x00, 0x02, 0x0e, 0x4e, 0x38, 0xa1, 0xd5, 0x0c, 0x10, 0xa9, 0x54, 0x44, 0x0f, 0x8c, 0x0e, 0x5b, 0x35, 0xe6, 0x5c, 0x16, 0xae, 0x80, 0x75, 0xc8, 0x0e, 0x07, 0xb8, 0x32, 0xcf, 0x9f, 0x3d, 0x20}},
+    },
+    {
+        .size = 767,
+        .index = 742,
+        .directions = 0xcf,
+        .proof_len = 9,
+        .leaf = {0x00, 0x46, 0xdd, 0x76, 0xc7, 0x1d, 0x99, 0x35, 0x14, 0x3e, 0x9c, 0x6b, 0x72, 0x2d, 0xd2, 0xdb, 0xd5, 0xe8, 0x1d, 0x9c, 0xb0, 0xb6, 0xff, 0x9b, 0x6f, 0xab, 0xc2, 0x9b, 0x4f, 0x2b, 0x36, 0xb3},
+        .root = {0xb1, 0xd5, 0x82, 0x13, 0x2e, 0xb4, 0x03, 0x0d, 0x13, 0x1c, 0xa5, 0x73, 0x49, 0x39, 0xbe, 0xc6, 0xf1, 0x35, 0x79, 0x9b, 0xc3, 0xe6, 0xbc, 0xb4, 0x61, 0xb0, 0xc4, 0x39, 0x92, 0xc1, 0xb3, 0x89},
+        .proof = {{0xda, 0xb8, 0x0a, 0x68, 0xd6, 0x01, 0x46, 0xdb, 0x3c, 0x30, 0x75, 0xb9, 0x5d, 0x46, 0x62, 0x72, 0x00, 0x7d, 0xa4, 0xbc, 0x84, 0x0f, 0x28, 0x8a, 0x08, 0xdd, 0xab, 0xd4, 0x51, 0x84, 0x1f, 0xae}, {0xff, 0x6f, 0x47, 0xa4, 0x09, 0xd4, 0xc1, 0xa3, 0x74, 0xad, 0xb8, 0xa6, 0x11, 0x56, 0xb4, 0x7d, 0x0d, 0x52, 0x92, 0xca, 0x6e, 0x92, 0x20, 0xdb, 0x0b, 0x08, 0xee, 0x75, 0x53, 0xec, 0x73, 0x1c}, {0x83, 0xec, 0x0d, 0x42, 0x50, 0xb8, 0x9a, 0x3e, 0x96, 0xae, 0x41, 0xb1, 0xbf, 0xc8, 0x03, 0x3d, 0xac, 0xc3, 0xed, 0xb0, 0x65, 0xf4, 0x26, 0xb6, 0xe4, 0xb8, 0xad, 0x17, 0xff, 0x40, 0xcb, 0x4e}, {0xea, 0x0b, 0xa8, 0xe9, 0x0b, 0xf7, 0x9f, 0xe0, 0xb9, 0x68, 0xa7, 0x45, 0xdf, 0x93, 0x72, 0xed, 0x2a, 0xb4, 0x99, 0xc1, 0xc2, 0x85, 0xe5, 0x87, 0x10, 0xbc, 0x77, 0x84, 0x1f, 0x7a, 0xdd, 0xe6}, {0xd3, 0xf5, 0x46, 0x4e, 0x94, 0x43, 0xec, 0xfd, 0xa9, 0x64, 0x29, 0x4f, 0x29, 0x50, 0xed, 0xb4, 0x13, 0x58, 0x77, 0xe4, 0xce, 0x0c, 0x3c, 0xf4, 0x2a, 0x70, 0xb1, 0x12, 0x55, 0x6e, 0xea, 0xda}, {0xf5, 0x91, 0x88, 0x7a, 0x12, 0xcb, 0x49, 0x32, 0xcf, 0xef, 0x19, 0x6d, 0x2a, 0x2d, 0xe7, 0xab, 0x90, 0x12, 0x8a, 0xc1, 0x58, 0x0d, 0xdc, 0x1d, 0xa0, 0x34, 0xf1, 0xe5, 0x1b, 0xbe, 0x27, 0x04}, {0x2f, 0x37, 0x79, 0x0f, 0xc0, 0x5d, 0x57, 0xdb, 0x6b, 0x91, 0x9c, 0x59, 0x70, 0xaf, 0xda, 0xf2, 0x98, 0xbd, 0xdb, 0x2c, 0xc3, 0xad, 0xbf, 0x52, 0x7e, 0xc3, 0x31, 0xfb, 0xcc, 0xa0, 0xb2, 0x05}, {0x21, 0xdb, 0x93, 0x01, 0xa4, 0xfa, 0x59, 0xfd, 0x48, 0x2c, 0x27, 0x22, 0x6d, 0x3b, 0x6b, 0xe6, 0xc0, 0x63, 0x6c, 0x27, 0x92, 0x20, 0xc2, 0x7d, 0xd5, 0x7d, 0x9d, 0x77, 0xfe, 0x13, 0x53, 0xb3}, {0x2f, 0x78, 0xd4, 0x65, 0xa0, 0x0f, 0xa8, 0xb4, 0x72, 0x3a, 0x8e, 0xec, 0x59, 0xb4, 0x74, 0x73, 0x67, 0x84, 0xb5, 0xec, 0x7a, 0x0e, 0x42, 0xfd, 0x94, 0xf2, 0xb8, 0xa6, 0x94, 0xe0, 0xac, 0x65}},
+    },
+    {
+        .size = 460,
+        .index = 277,
+        .directions = 0x151,
+        .proof_len = 9,
+        .leaf = {0x5e, 0x22, 0x72, 0x15, 0xfa, 0x9c, 0x79, 0x6a, 0x7e, 0x6d, 0x1a, 0xf7, 0xf6, 0x24, 0x85, 0xa6, 0x63, 0xa9, 0x6f, 0x9b, 0xd5, 0x56, 0xcc, 0xca, 0x9e, 0x43, 0x7a, 0x46, 0xb5, 0x04, 0xd1, 0xb1},
+        .root = {0xfb, 0x27, 0xc0, 0xf4, 0xaf, 0xbf, 0x6e, 0x88, 0x4b, 0x06, 0x1b, 0xfd, 0x7e, 0x89, 0x68, 0xda, 0xc5, 0x41, 0x8c, 0x02, 0x64, 0x68, 0xdf, 0x2a, 0x7e, 0x97, 0xdc, 0xa1, 0x28, 0x96, 0xf1, 0xfd},
+        .proof = {{0x89, 0xe9, 0x5f, 0x36, 0xff, 0x65, 0xec, 0xad, 0x4f, 0x1a, 0x2c, 0x74, 0xe3, 0x03, 0x41, 0x54, 0x4f, 0x46, 0x40, 0xce, 0x91, 0x49, 0x04, 0x79, 0xa2, 0x57, 0xb0, 0xf5, 0xbe, 0xd3, 0xb5, 0x80}, {0x02, 0x48, 0xff, 0xfe, 0x40, 0x68, 0x02, 0x90, 0x4a, 0xda, 0x09, 0x08, 0xc4, 0x50, 0x19, 0x85, 0x8a, 0x29, 0x88, 0xa9, 0xb7, 0x90, 0xeb, 0x72, 0xf3, 0x54, 0x94, 0xd3, 0x0c, 0xa2, 0xf3, 0x62}, {0xce, 0x06, 0x75, 0x27, 0x26, 0x3e, 0xe7, 0x61, 0xb4, 0xf4, 0xdd, 0xf1, 0x35, 0x6f, 0x39, 0x81, 0x86, 0xf5, 0x35, 0xf5, 0x0b, 0x36, 0xe8, 0x2b, 0xbd, 0x1c, 0xdb, 0xf1, 0x8a, 0x8c, 0x82, 0x4e}, {0x90, 0xe2, 0x51, 0xaf, 0x3d, 0x25, 0x46, 0x85, 0xf5, 0x92, 0xf2, 0x09, 0x28, 0xbd, 0xe2, 0xfd, 0x01, 0x09, 0x98, 0xa6, 0xa5, 0xcd, 0x61, 0x8d, 0xd9, 0x4d, 0x69, 0xf1, 0xad, 0x23, 0xc7, 0xef}, {0xd0, 0x34, 0xe0, 0x33, 0xdb, 0x68, 0x64, 0x44, 0xcc, 0x70, 0x22, 0x52, 0x09, 0xb9, 0x10, 0x66, 0x25, 0xd5, 0x3f, 0x0c, 0x62, 0xf3, 0x2d, 0x17, 0x79, 0x4e, 0x85, 0xc4, 0x16, 0xea, 0x8c, 0x3c}, {0x5a, 0x40, 0x4e, 0x26, 0x11, 0x0f, 0xef, 0x41, 0x91, 0x57, 0x9d, 0x7e, 0x7b, 0xc4, 0x9c, 0xbc, 0x4f, 0x56, 0x46, 0x73, 0xbc, 0x59, 0x0e, 0x52, 0xf2, 0x29, 0xcc, 0xa0, 0x1b, 0x68, 0x97, 0x03}, {0x68, 0xe5, 0x01, 0xf6, 0x91, 0x29, 0x2e, 0x4e, 0x62, 0x96, 0x1b, 0x98, 0x3d, 0x52, 0x73, 0xa4, 0x2f, 0x12, 0x58, 0x02, 0x3d, 0x35, 0x1c, 0xbf, 0xe6, 0xee, 0xbc, 0xff, 0xc5, 0x3a, 0x8e, 0x56}, {0x18, 0x5f, 0xd0, 0xe8, 0x8c, 0x1e, 0x69, 0xb9, 0x29, 0x6a, 0x0d, 0xf1, 0xe0, 0x3f, 0xa0, 0xfc, 0xb6, 0x11, 0x44, 0xcf, 0x2e, 0xae, 0xc3, 0x84, 0xd5, 0x54, 0x1d, 0x6a, 0xe1, 0xc2, 0xaf, 0x4e}, {0x3b, 0x5f, 0x05, 0x3d, 0xae, 0xb2, 0xce, 0xb7, 0xf7, 0x68, 0x39, 0xf0, 0x96, 0x47, 0x74, 0xe8, 0x51, 0x36, 0x4c, 0x14, 0xc7, 0xbd, 0xf2, 0x8b, 0x8b, 0xda, 0x85, 0xb3, 0xb0, 0x50, 0xfd, 0xc0}},
+    },
+    {
+        .size = 40,
+        .index = 38,
+        .directions = 0x7,
+        .proof_len = 4,
+        .leaf = {0xff, 0x8f, 0x0a, 0xb7, 0xc6, 0x49, 0x67, 0x0c, 0x6b, 0xb0, 0x79, 0xf1, 0xd3, 0x37, 0x3a, 0xbb, 0xa2, 0x66, 0x32, 0x1a, 0x74, 0xee, 0x0f, 0x62, 0xcd, 0x7e, 0xf5, 0xae, 0xab, 0x4f, 0x13, 0xab},
+        .root = {0xd4, 0x7b, 0x1d, 0x12, 0x91, 0xf7, 0xcc, 0x2c, 0x8c, 0xbc, 0xe1, 0x54, 0x8a, 0xe2, 0xdb, 0xf2, 0x8a, 0xab, 0xb1, 0xd5, 0x29, 0x22, 0xc0, 0x22, 0xf6, 0xed, 0x6f, 0xf6, 0xc8, 0x03, 0x86, 0x05},
+        .proof = {{0x9c, 0xdc, 0xae, 0x08, 0xa4, 0x48, 0x81, 0xc1, 0xdd, 0x66, 0x12, 0x23, 0xc8, 0x3f, 0x22, 0x34, 0x3f, 0x36, 0x24, 0x65, 0x40, 0x7f, 0x78, 0x30, 0x21, 0xba, 0x3f, 0x34, 0xda, 0x38, 0x2f, 0x9f}, {0xbc, 0xee, 0x28, 0x37, 0x91, 0x50, 0x85, 0x36, 0x10, 0x39, 0xca, 0x00, 0x4a, 0xd4, 0x88, 0x2d, 0xab, 0x42, 0x1b, 0x76, 0x9b, 0xae, 0xf1, 0x94, 0x0f, 0x7f, 0x46, 0xd1, 0xfd, 0x43, 0x15, 0xbb}, {0x76, 0x9f, 0x27, 0x83, 0x98, 0x69, 0x6e, 0x5c, 0xaf, 0xbe, 0xb6, 0xda, 0xab, 0x3a, 0xb0, 0x7c, 0x19, 0x7c, 0x0f, 0x78, 0x56, 0xf3, 0x90, 0x1e, 0x9b, 0xdf, 0xf2, 0x38, 0xe7, 0x73, 0x56, 0x7f}, {0xe0, 0xd0, 0x2b, 0x46, 0x1e, 0x40, 0x95, 0x68, 0x4e, 0x1e, 0x58, 0x06, 0x0f, 0x63, 0xdf, 0x33, 0xf8, 0x0b, 0xa3, 0x3b, 0xe8, 0xd9, 0xb6, 0x5b, 0xc8, 0x1f, 0xb4, 0x8a, 0xe5, 0x3a, 0xc3, 0x42}},
+    },
+    {
+        .size = 964,
+        .index = 327,
+        .directions = 0x38a,
+        .proof_len = 10,
+        .leaf = {0x7b, 0x10, 0x30, 0xb2, 0xcc, 0xc9, 0x4f, 0x2a, 0xac, 0x12, 0xf4, 0xc2, 0x53, 0xec, 0xe8, 0xad, 0xf1, 0x7c, 0x25, 0x10, 0x77, 0xcd, 0x4d, 0xe1, 0xbb, 0x93, 0x15, 0x4f, 0x3a, 0xe4, 0x1b, 0x00},
+        .root = {0x69, 0x36, 0x92, 0xab, 0x5d, 0xfd, 0x91, 0x5b, 0x8c, 0x28, 0x0e, 0xad, 0x55, 0xa7, 0x58, 0x81, 0x5d, 0x26, 0x23, 0x57, 0x0d, 0xa3, 0x1d, 0x0b, 0x7e, 0x69, 0xb1, 0x6d, 0x22, 0xca, 0xa1, 0x45},
+        .proof = {{0xf7, 0x96, 0x33, 0x57, 0x44, 0xa8, 0x37, 0x79, 0x5e, 0x59, 0x71, 0x87, 0xfe, 0xba, 0x7e, 0x8f, 0xaf, 0x12, 0xb1, 0x18, 0x11, 0xea, 0x07, 0xba, 0xc0, 0xdb, 0xee, 0x11, 0xc1, 0xe3, 0xac, 0x1f}, {0x39, 0x1a, 0x66, 0x08, 0x23, 0xc3, 0xba, 0xb4, 0xa9, 0x58, 0x92, 0x99, 0x33, 0xc2, 0xde, 0xa9, 0x23, 0x64, 0xcd, 0x66, 0xce, 0x09, 0xe0, 0x8a, 0x5b, 0xe8, 0xdc, 0x39, 0x54, 0x32, 0x9a, 0x2b}, {0x70, 0x9b, 0x93, 0x58, 0x1a, 0xb7, 0xb6, 0x43, 0x21, 0x3d, 0x6b, 0x1c, 0x93, 0x94, 0x3f, 0x8c, 0x40, 0x73, 0xb0, 0x2a, 0x7f, 0xf6, 0xe1, 0xaf, 0x8d, 0x64, 0x79, 0xb7, 0x17, 0x2b, 0xce, 0x8f}, {0x8f, 0x21, 0x7a, 0x6a, 0x61, 0xb3, 0xad, 0x55, 0xd9, 0x18, 0x9f, 0x76, 0xba, 0x67, 0xaa, 0x61, 0xdc, 0x7e, 0xb6, 0xca, 0xbc, 0x56, 0x41, 0xb5, 0xdb, 0x06, 0xba, 0x95, 0x59, 0xca, 0xee, 0x59}, {0xae, 0xd6, 0x97, 0x16, 0x67, 0x48, 0x1b, 0x44, 0x53, 0x0e, 0x3c, 0x80, 0xc9, 0xba, 0x12, 0x94, 0x03, 0x44, 0x75, 0xb2, 0xca, 0x2a, 0x44, 0x8b, 0x02, 0xdc, 0x9f, 0xc5, 0xe0, 0x28, 0x2a, 0x8e}, {0xa5, 0x3c, 0x10, 0x79, 0x3e, 0x2e, 0xbd, 0x9f, 0x2d, 0x8d, 0x33, 0x14, 0x60, 0x23, 0xb9, 0x62, 0x03, 0x68, 0x9e, 0x94, 0xd9, 0xa1, 0x2b, 0xca, 0x50, 0xa6, 0x92, 0xbd, 0xae, 0x4c, 0xf4, 0xa9}, {0x3f, 0x85, 0x7b, 0x1c, 0x87, 0x66, 0xd2, 0x5d, 0xf1, 0x3f, 0xac, 0x2a, 0xe2, 0x5a, 0x89, 0x4a, 0x72, 0xb4, 0x78, 0x6e, 0x4c, 0x9c, 0xf9, 0xf4, 0x0f, 0xfd, 0xc6, 0xc1, 0xc0, 0xb0, 0x9c, 0x5c}, {0x0e, 0x76, 0x3d, 0x36, 0xa8, 0x15, 0x5c, 0xcd, 0xbf, 0xac, 0xbf, 0x54, 0x5d, 0x38, 0x9e, 0xd3, 0x7f, 0xd7, 0x0a, 0xce, 0xcd, 0x02, 0xa5, 0x1d, 0xe4, 0x43, 0x59, 0x1c, 0x1e, 0xac, 0x46, 0xe8}, {0xca, 0xa7, 0x4e, 0xf2, 0xb1, 0x9d, 0x87, 0x16, 0xc0, 0x37, 0x33, 0x06, 0x12, 0x2b, 0xaf, 0x68, 0x7b, 0x98, 0x15, 0x39, 0x79, 0x8a, 0x0e, 0xa4, 0xd5, 0x32, 0x14, 0xcb, 0x99, 0x74, 0x9d, 0x52}, {0xca, 0xe2, 0x97, 0x6c, 0x9a, 0x3d, 0x59, 0x72, 0x50, 0xc1, 0x4f, 0xfe, 0xab, 0x60, 0x9d, 0x9a, 0x12, 0xa9, 0xf9, 0x5a, 0xd1, 0xd1, 0xaa, 0xf8, 0x89, 0xc7, 0xf2, 0xd3, 0x1e, 0xad, 0x29, 0x78}},
+    },
+    {
+        .size = 1501,
+        .index = 705,
+        .directions = 0x41a,
+        .proof_len = 11,
+        .leaf = {0x67, 0xed, 0x23, 0xad, 0xbb, 0x12, 0x5a, 0x3d, 0x0c, 0x5c, 0xec, 0x8c, 0x43, 0xed, 0xb8, 0x30, 0x1d, 0x8a, 0x18, 0x0e, 0x9b, 0xe0, 0xfc, 0xf2, 0x5b, 0xd2, 0xf3, 0xee, 0x22, 0x17, 0x99, 0xa4},
+        .root = {0x57, 0x2e, 0x6e, 0x5b, 0xb9, 0x9a, 0x11, 0x10, 0x33, 0x4b, 0x90, 0xf1, 0x34, 0xdf, 0xcf, 0xb6, 0x60, 0x4d, 0xa5, 0x71, 0xe4, 0x6d, 0x19, 0x44, 0x14, 0x17, 0x81, 0x2c, 0x81, 0xe6, 0x90, 0xef},
+        .proof = {{0x07, 0xd6, 0x88, 0xd9, 0xc8, 0x81, 0xe3, 0xf6, 0x20, 0x0b, 0x41, 0xe6, 0xbf, 0x50, 0xea, 0xb0, 0x08, 0xdf, 0x25, 0x7e, 0xb7, 0xca, 0x2b, 0x1a, 0x93, 0x5f, 0xc4, 0x12, 0xad, 0x29, 0x5f, 0x25}, {0x95, 0x0e, 0x20, 0x1a, 0x8d, 0x51, 0xde, 0xaa, 0x16, 0x13, 0xf6, 0xd9, 0xd9, 0xd0, 0x2b, 0x8f, 0x53, 0x02, 0xe5, 0x47, 0xf5, 0xa8, 0x99, 0x46, 0x58, 0x4b, 0x22, 0x7f, 0x7f, 0xa4, 0x97, 0x2d}, {0x0a, 0x34, 0x32, 0x59, 0x21, 0xa6, 0xec, 0x10, 0x7b, 0xae, 0x61, 0xef, 0xb7, 0xd4, 0x85, 0xa1, 0xb4, 0xe6, 0xce, 0xac, 0x76, 0xf8, 0x65, 0x34, 0x74, 0x3d, 0x18, 0xb2, 0xa9, 0x90, 0x28, 0x44}, {0x18, 0x97, 0x4c, 0x6c, 0x29, 0xe9, 0x6b, 0x6f, 0x61, 0x6c, 0xd7, 0x4b, 0x73, 0x4e, 0xc5, 0x44, 0xcc, 0xbd, 0xe5, 0xaf, 0x43, 0x3e, 0x71, 0x16, 0x59, 0xe8, 0x0d, 0x72, 0x3a, 0x78, 0xc0, 0x37}, {0x80, 0x58, 0xdc, 0x51, 0x03, 0xce, 0x0c, 0x82, 0xd6, 0x81, 0xd2, 0xbd, 0xca, 0x97, 0xad, 0x39, 0x0c, 0x98, 0x92, 0x50, 0x65, 0xfa, 0xe9, 0xb7, 0xbb, 0xce, 0x6d, 0x6d, 0x1b, 0xf8, 0xd8, 0xc4}, {0x45, 0xaf, 0xb9, 0x2d, 0xb8, 0xde, 0xcf, 0x52, 0xf9, 0xdc, 0x54, 0x7d, 0x67, 0x7e, 0xbc, 0xdb, 0xe3, 0x7e, 0x83, 0xb5, 0xd4, 0xd5, 0x91, 0xb7, 0x2e, 0xd1, 0xeb, 0x0b, 0x09, 0x86, 0xb7, 0x0b}, {0x96, 0x9d, 0x4f, 0x84, 0xb9, 0xcc, 0xd5, 0xea, 0x17, 0xfd, 0x41, 0xee, 0x6f, 0x13, 0x99, 0x57, 0x29, 0xea, 0xd0, 0x2b, 0x3e, 0x23, 0x6d, 0x2a, 0x0b, 0xe5, 0xfd, 0x96, 0xe2, 0xb1, 0x01, 0x8e}, {0x0f, 0xb2, 0x88, 0xed, 0x18, 0x07, 0xfd, 0xd0, 0x6e, 0xa6, 0xe4, 0x14, 0x38, 0x76, 0xd5, 0x46, 0xf5, 0x58, 0x8a, 0x88, 0xf2, 0xcf, 0x3c, 0x67, 0xab, 0x88, 0xa2, 0x39, 0xbf, 0xd1, 0x5b, 0xd0}, {0xaf, 0x51, 0xeb, 0xf1, 0xd1, 0xa7, 0xfa, 0x34, 0x33, 0x51, 0xf9, 0x2e, 0x74, 0xe2, 0xc3, 0xe6, 0x17, 0xb4, 0x4d, 0x17, 0x44, 0x45, 0x8c, 0x2d, 0x0b, 0xd4, 0xb3, 0x75, 0x17, 0x21, 0x8a, 0x0f}, {0x1a, 0x46, 0x64, 0xfd, 0x08, 0xaf, 0x1c, 0x9f, 0xc8, 0xf1, 0xab, 0x4f, 0x18, 0x5b, 0x36, 0x24, 0x22, 0x0d, 0x3a, 0x10, 0xfa, 0xed, 0xee, 0x0f, 0x13, 0xa7, 0xac, 0xe1, 0xcd, 0xa1, 0xbe, 0xc4}, {0x80, 0xdf, 0x8c, 0x4e, 0xce, 0x21, 0x1a, 0x8f, 0xf1, 0xe6, 0xf8, 0x06, 0xe9, 0x38, 0xb4, 0x46, 0x93, 0xf3, 0xc9, 0xdd, 0x6d, 0xdb, 0xe6, 0xb3, 0xf5, 0x61, 0x38, 0x92, 0xcf, 0xe2, 0x51, 0xb8}},
+    },
+    {
+        .size = 1090,
+        .index = 713,
+        .directions = 0x49a,
+        .proof_len = 11,
+        .leaf = {0x54, 0x88, 0xb9, 0x4c, 0xcb, 0x8d, 0x3d, 0x25, 0x7b, 0xb3, 0xfb, 0xe7, 0x43, 0xe7, 0x26, 0xb4, 0x02, 0xea, 0x07, 0x7c, 0x2a, 0x64, 0x80, 0x1c, 0xb4, 0x4c, 0x3c, 0x22, 0x98, 0xa5, 0x3a, 0x91},
+        .root = {0x4d, 0x37, 0x3d, 0x16, 0x2a, 0xd8, 0x47, 0x42, 0x9b, 0x7a, 0x13, 0x11, 0x79, 0x0c, 0x42, 0x38, 0x96, 0x6c, 0x6f, 0xa0, 0x43, 0xdd, 0xb0, 0x72, 0xed, 0x43, 0xdb, 0xc7, 0xe5, 0xd7, 0xc9, 0xd9},
+        .proof = {{0x34, 0x46, 0xee, 0x58, 0xab, 0xef, 0x0a, 0x5f, 0x32, 0x5d, 0x63, 0x8a, 0x39, 0x7e, 0xc7, 0xac, 0x3f, 0x52, 0x12, 0xd6, 0xd5, 0xc4, 0x53, 0xc8, 0xf1, 0xac, 0x7a, 0x2c, 0x82, 0xa6, 0x8f, 0xa1}, {0x17, 0x4e, 0xeb, 0xa1, 0xc5, 0xe8, 0x1a, 0xac, 0xb9, 0xa2, 0xf2, 0x68, 0x27, 0x94, 0x7b, 0xe2, 0x53, 0x83, 0xa2, 0x0a, 0xbb, 0xc7, 0x07, 0x1b, 0xc7, 0xab, 0x7e, 0xde, 0xcb, 0xa5, 0xa3, 0xf9}, {0xd2, 0xc8, 0x64, 0xad, 0x36, 0x55, 0xc4, 0x7c, 0xb1, 0x6c, 0x01, 0xe8, 0x32, 0xcb, 0x3a, 0xd9, 0xfc, 0xe4, 0x21, 0xa4, 0x21, 0x58, 0x15, 0x12, 0x92, 0x98, 0xc0, 0x83, 0xf8, 0xdd, 0xff, 0x80}, {0x48, 0xd8, 0xf1, 0x30, 0x29, 0x2a, 0xe6, 0x88, 0x43, 0xfe, 0x70, 0x48, 0x46, 0xa2, 0xa6, 0xc7, 0x44, 0x46, 0x46, 0xb6, 0xb9, 0x51, 0xd4, 0xd1, 0x16, 0x15, 0x37, 0x69, 0xd0, 0x5c, 0x17, 0xf6}, {0xf9, 0x19, 0xba, 0xd6, 0x77, 0xcc, 0xcf, 0xad, 0xc2, 0x53, 0x8a, 0x1e, 0x89, 0x38, 0x8f, 0xa9, 0x36, 0x0e, 0xfa, 0x25, 0x94, 0x3d, 0x6b, 0xbe, 0x48, 0xbf, 0xaa, 0x57, 0x26, 0x33, 0x4c, 0x65}, {0xb6, 0x95, 0x42, 0x15, 0x31, 0xa1, 0x0a, 0xeb, 0xe9, 0xbf, 0x5b, 0x66, 0x07, 0x41, 0x0a, 0x59, 0x5f, 0x4e, 0x7a, 0xe6, 0x9b, 0xe5, 0x0f, 0xb9, 0x26, 0xce, 0xa0, 0x0c, 0xd3, 0x2e, 0x0c, 0x39}, {0x37, 0x5e, 0xa0, 0xbc, 0x99, 0x4e, 0xac, 0x4a, 0x3f, 0x01, 0x66, 0x29, 0x89, 0x1f, 0x5b, 0xbf, 0x77, 0x0b, 0x15, 0x54, 0x39, 0x5d, 0x44, 0x4b, 0x60, 0xb5, 0x79, 0xaf, 0xcf, 0xe0, 0x18, 0xb5}, {0xb2, 0x75, 0x1a, 0xbc, 0x99, 0x2f, 0x0e, 0xf8, 0x86, 0x7a, 0x05, 0x45, 0xea, 0xff, 0xca, 0x60, 0x8e, 0x7c, 0x2f, 0x8e, 0x0d, 0x10, 0x33, 0x4b, 0x74, 0x5c, 0x0e, 0xa8, 0x57, 0x37, 0xa7, 0xd9}, {0x96, 0x15, 0xcf, 0x8f, 0xdb, 0x4d, 0x43, 0x21, 0xc6, 0x74, 0x36, 0xd8, 0x43, 0x72, 0x89, 0x7f, 0x61, 0xe2, 0xd0, 0x13, 0x16, 0xbc, 0x74, 0xff, 0x8f, 0x2a, 0x40, 0xaf, 0xdc, 0x16, 0x9c, 0x00}, {0x05, 0x08, 0x96, 0x06, 0xb4, 0xed, 0x74, 0x5f, 0x44, 0x9c, 0x3b, 0xc7, 0xbb, 0x52, 0xc4, 0x2b, 0x9d, 0x1a, 0x32, 0x7f, 0x02, 0xcd, 0xf2, 0x18, 0x11, 0x16, 0x6e, 0x58, 0xf3, 0x79, 0x1f, 0x74}, {0x9a, 0x4e, 0xd8, 0xe5, 0xfb, 0xd4, 0xe2, 0xda, 0x11, 0x93, 0x50, 0x21, 0xff, 0xff, 0xce, 0x74, 0x4c, 0xae, 0x55, 0xca, 0xd6, 0x03, 0xd9, 0x74, 0xfc, 0x53, 0x6e, 0xae, 0x40, 0xe1, 0x0d, 0x0c}},
+    },
+    {
+        .size = 2410,
+        .index = 302,
+        .directions = 0x748,
+        .proof_len = 12,
+        .leaf = {0x62, 0xb6, 0x49, 0x55, 0x6a, 0xd1, 0x56, 0xc2, 0x86, 0x12, 0x8e, 0x35, 0x05, 0x2e, 0x32, 0x3e, 0xf3, 0xe4, 0x22, 0xf6, 0x8b, 0x28, 0x5b, 0xad, 0xb7, 0x50, 0x95, 0xe6, 0x36, 0x4a, 0x5c, 0xe6},
+        .root = {0x19, 0xd8, 0x43, 0xaf, 0x1c, 0x5d, 0x40, 0xb6, 0x84, 0xc1, 0x3e, 0x9c, 0x6b, 0x81, 0xa8, 0x6d, 0x54, 0x4b, 0xf2, 0x4e, 0xad, 0xc7, 0x66, 0xbd, 0x64, 0xa8, 0x9c, 0xf1, 0x30, 0x87, 0x79, 0x3c},
+        .proof = {{0x91, 0xb5, 0x9f, 0x9a, 0x5f, 0x6e, 0x59, 0x08, 0xa3, 0xdc, 0x7b, 0xb0, 0xcf, 0x3b, 0x7f, 0xbc, 0x0e, 0xa9, 0x80, 0x4f, 0xe4, 0xdb, 0x3f, 0x17, 0xa2, 0xc3, 0xbe, 0xd8, 0x6a, 0x4c, 0x25, 0x88}, {0x7f, 0xa9, 0x9d, 0x24, 0x27, 0x92, 0x6d, 0x67, 0xaf, 0x83, 0x3e, 0x09, 0x6b, 0x0e, 0x36, 0x76, 0xd7, 0xa8, 0x28, 0xb2, 0xde, 0x7d, 0xbf, 0x8a, 0x4c, 0x7e, 0xdb, 0x3a, 0x17, 0x92, 0x88, 0x1c}, {0xe2, 0x29, 0x43, 0xc6, 0x46, 0x8e, 0x11, 0xb9, 0x7c, 0x3e, 0x93, 0xef, 0x88, 0x65, 0x44, 0xaa, 0x8a, 0x5e, 0xe3, 0xfd, 0x6e, 0xe5, 0x96, 0x86, 0x61, 0x50, 0x49, 0x6e, 0xb4, 0x2e, 0x91, 0xc1}, {0x70, 0xfa, 0xb2, 0x48, 0xb5, 0xe2, 0x23, 0x53, 0xa4, 0x42, 0x09, 0x5a, 0x7f, 0xc3, 0x03, 0x05, 0x7d, 0xc3, 0xc9, 0x06, 0x73, 0xaf, 0x25, 0x57, 0xb2, 0x90, 0x40, 0x92, 0xc4, 0x33, 0x8c, 0xca}, {0x54, 0x7a, 0x51, 0x61, 0xca, 0x1c, 0xd3, 0x75, 0xb1, 0x3c, 0xf6, 0x35, 0x5a, 0x8c, 0x3e, 0x97, 0x27, 0xa4, 0x9d, 0x08, 0x04, 0x67, 0x67, 0x46, 0xfc, 0x8e, 0x92, 0x4f, 0x66, 0xd6, 0xfb, 0x50}, {0x3d, 0x19, 0x4f, 0xca, 0xa9, 0x7f, 0xa0, 0x3e, 0x0e, 0xcf, 0x0b, 0x29, 0x22, 0x2b, 0x19, 0x6a, 0x22, 0xcb, 0xa5, 0xa3, 0xcc, 0x3f, 0xec, 0xa5, 0x46, 0xd6, 0xe5, 0x66, 0x0c, 0x26, 0xb1, 0x32}, {0xc2, 0x33, 0xd1, 0x06, 0xd8, 0x07, 0xc7, 0x88, 0x16, 0x2c, 0x0b, 0x22, 0xbc, 0x38, 0x7a, 0x2a, 0x68, 0xaa, 0x4b, 0x7a, 0xa6, 0x85, 0xec, 0x77, 0xda, 0xbe, 0x69, 0xc3, 0x87, 0x1a, 0x6d, 0x3d}, {0x45, 0x75, 0x9d, 0xf2, 0x7c, 0x29, 0xcc, 0x9e, 0x3a, 0x5a, 0x83, 0xf0, 0x04, 0x8c, 0xe3, 0xbd, 0x22, 0xcf, 0x6a, 0xfb, 0xf5, 0x0b, 0x0d, 0x28, 0x46, 0x9b, 0xbc, 0xc0, 0x16, 0xc8, 0xbf, 0x94}, {0xf5, 0xc9, 0x3f, 0x9c, 0x35, 0x74, 0x03, 0x12, 0x53, 0x9c, 0xd3, 0xad, 0x0e, 0x11, 0x62, 0xd9, 0x0f, 0xdd, 0xe5, 0x78, 0x5c, 0x40, 0xf5, 0xa6, 0x13, 0x37, 0x7c, 0x23, 0x0d, 0xfe, 0x02, 0x1d}, {0x21, 0x0e, 0x1b, 0x60, 0x08, 0x5a, 0x09, 0x53, 0xf7, 0x3b, 0x2c, 0xe3, 0x0d, 0x41, 0xf1, 0xd7, 0x91, 0x33, 0xfa, 0xd0, 0x45, 0xc8, 0x3e, 0xbd, 0x5f, 0xd3, 0x2a, 0x5c, 0x93, 0x92, 0xd2, 0x2b}, {0x72, 0xad, 0x73, 0x1f, 0x47, 0x0a, 0x48, 0xa8, 0x26, 0xe7, 0x53, 0x1c, 0x34, 0x15, 0xb6, 0x40, 0x50, 0xa3, 0x3b, 0x05, 0x9a, 0xd3, 0xb5, 0x4b, 0x3c, 0xba, 0x49, 0x1f, 0x59, 0x5e, 0x59, 0xc7}, {0xde, 0x3f, 0xd6, 0xf1, 0xcc, 0x20, 0x38, 0x78, 0xf6, 0xb1, 0xb9, 0xcf, 0xbe, 0x3b, 0x3d, 0x02, 0x13, 0x4f, 0x02, 0xcb, 0xf6, 0xdf, 0x06, 0xc6, 0xc1, 0x50, 0xa1, 0x78, 0x58, 0x9c, 0x10, 0x92}},
+    },
+    {
+        .size = 68,
+        .index = 7,
+        .directions = 0x70,
+        .proof_len = 7,
+        .leaf = {0x93, 0xae, 0xd4, 0x2b, 0x88, 0xde, 0xd1, 0x1d, 0x10, 0xe1, 0x9c, 0xab, 0xc2, 0xe9, 0xe9, 0xf8, 0xdc, 0x45, 0xd7, 0x8b, 0xd6, 0x6b, 0xe9, 0x0a, 0x21, 0x97, 0xe8, 0x2e, 0x87, 0x97, 0x3e, 0xc9},
+        .root = {0xfc, 0x65, 0x72, 0x90, 0xde, 0xcc, 0x2d, 0x9f, 0xdc, 0xf8, 0x2f, 0x52, 0xd8, 0x61, 0x9b, 0x21, 0x75, 0xbd, 0x1d, 0x59, 0xa5, 0xc5, 0x94, 0x16, 0xe0, 0x5d, 0xce, 0x66, 0xe8, 0xe9, 0x21, 0xb5},
+        .proof = {{0x1a, 0x96, 0x07, 0xd6, 0x9b, 0x3e, 0x18, 0x7f, 0x20, 0xc4, 0xf9, 0x5b, 0xf1, 0xdf, 0x6e, 0xaa, 0x3b, 0x1b, 0xc3, 0x01, 0x69, 0xb3, 0xa5, 0xa7, 0xff, 0x56, 0xcf, 0xba, 0xa2, 0x7d, 0x64, 0x74}, {0x16, 0x57, 0x88, 0xd6, 0xc9, 0x75, 0xf9, 0x46, 0xa4, 0x2c, 0xdc, 0xca, 0x01, 0x23, 0xdb, 0xa2, 0x02, 0x59, 0xfa, 0x82, 0x5f, 0xe7, 0xf7, 0x94, 0x9b, 0x08, 0x51, 0x77, 0xdf, 0x99, 0xa0, 0x0f}, {0x4e, 0x4d, 0x58, 0xc9, 0x44, 0x8c, 0x81, 0xa2, 0x38, 0xbc, 0x10, 0xa3, 0x9d, 0x27, 0x58, 0x3a, 0x34, 0x7a, 0xfd, 0xdb, 0x90, 0xcd, 0x82, 0xc9, 0x2d, 0x70, 0x19, 0x2b, 0xd6, 0x65, 0x72, 0xb7}, {0xe3, 0xee, 0x6c, 0x47, 0xd0, 0xcc, 0x67, 0x34, 0x9c, 0xf6, 0xff, 0x46, 0x9b, 0x67, 0x6a, 0xab, 0x27, 0x32, 0xb9, 0x0f, 0xb3, 0x4d, 0xf6, 0xbb, 0x47, 0x74, 0x67, 0x70, 0xae, 0x24, 0xa5, 0x50}, {0xfa, 0x7d, 0x3c, 0xdb, 0x40, 0x40, 0xd2, 0x18, 0x33, 0x6d, 0x41, 0x4c, 0xc7, 0x50, 0xc8, 0xcd, 0x79, 0x2b, 0x04, 0xdb, 0x98, 0x94, 0xe3, 0x77, 0x82, 0xf1, 0x6f, 0x5f, 0x76, 0x08, 0x4e, 0x56}, {0x84, 0x09, 0x42, 0xa3, 0x15, 0x66, 0x8d, 0x76, 0xa7, 0x0d, 0x8c, 0x59, 0xa9, 0x05, 0x3c, 0xc6, 0x93, 0xe3, 0x30, 0xcc, 0xdd, 0x89, 0x77, 0x90, 0x7c, 0x8a, 0xa6, 0x3e, 0x7e, 0x43, 0x69, 0x33}, {0x17, 0xe2, 0xd3, 0x08, 0x13, 0x9a, 0x40, 0x30, 0xe5, 0x46, 0x15, 0xed, 0x7c, 0x50, 0x00, 0x71, 0x99, 0x22, 0xe6, 0x3b, 0x12, 0xcb, 0x05, 0x0d, 0xbf, 0x65, 0x16, 0xef, 0xba, 0x94, 0xdf, 0x3d}},
+    },
+    {
+        .size = 2285,
+        .index = 280,
+        .directions = 0x188,
+        .proof_len = 12,
+        .leaf = {0x7a, 0x6f, 0xeb, 0x80, 0xca, 0x04, 0x2e, 0x7b, 0x93, 0x13, 0xfd, 0xec, 0xe1, 0x2b, 0x36, 0x9a, 0x56, 0x91, 0xc8, 0x3b, 0xd8, 0x68, 0x10, 0xc6, 0xb9, 0x5b, 0x28, 0x1d, 0x98, 0x98, 0x12, 0xd1},
+        .root = {0xb2, 0xc7, 0xe4, 0x3e, 0x89, 0x93, 0x82, 0x50, 0x78, 0xa5, 0x39, 0x49, 0xdb, 0xbe, 0xcd, 0x15, 0xfc, 0x4a, 0x71, 0x18, 0x32, 0xe4, 0xef, 0xb7, 0xe8, 0xd6, 0x8b, 0x79, 0xeb, 0x03, 0x8f, 0x2c},
+        .proof = {{0x53, 0x09, 0x31, 0x51, 0x10, 0x18, 0x62, 0x50, 0xc7, 0x0c, 0xfc, 0x19, 0xd9, 0x02, 0x67, 0x80, 0x97, 0x20, 0xd2, 0x88, 0x5b, 0x9d, 0xbd, 0x0e, 0x72, 0x05, 0x9e, 0xed, 0xa2, 0x47, 0x43, 0x98}, {0x7a, 0x33, 0x5c, 0x4b, 0x31, 0x55, 0x7e, 0xec, 0x65, 0x12, 0xea, 0xa9, 0xc3, 0x35, 0xc8, 0xdf, 0x2e, 0x43, 0x71, 0xd4, 0x02, 0xa0, 0xfd, 0x44, 0x17, 0x59, 0x21, 0xa9, 0xd9, 0xe3, 0xd0, 0x30}, {0x8f, 0xc4, 0xe1, 0x8c, 0x9e, 0x1d, 0x9f, 0xa0, 0x43, 0x0f, 0xe2, 0xb9, 0xe4, 0x4f, 0x6b, 0xda, 0xff, 0xd2, 0x7a, 0x8a, 0xc5, 0x0d, 0xe3, 0xf4, 0x98, 0x8d, 0x08, 0xf1, 0x22, 0x4d, 0x93, 0x7b}, {0x90, 0x52, 0x3e, 0xed, 0xef, 0xf5, 0x7b, 0x4f, 0xa9, 0xd7, 0x05, 0x8e, 0xcd, 0xdd, 0xfb, 0x1c, 0xb0, 0xc4, 0x96, 0x52, 0xf5, 0x83, 0x4a, 0xc5, 0xbd, 0x51, 0x46, 0xd5, 0xae, 0x7b, 0x7d, 0x07}, {0x10, 0xb4, 0xad, 0x5c, 0xec, 0x5c, 0x59, 0x8e, 0x54, 0x73, 0x61, 0x16, 0xef, 0x3e, 0x28, 0x09, 0xe9, 0xc1, 0xe8, 0x54, 0x3b, 0xd2, 0x70, 0xa4, 0x32, 0x01, 0x55, 0xdf, 0xc2, 0x03, 0x5d, 0xc4}, {0xf3, 0x20, 0xb6, 0xcd, 0x34, 0x5e, 0xdb, 0x21, 0xd3, 0x0e, 0xa1, 0x05, 0x30, 0xbc, 0xb2, 0x77, 0x8f, 0xc5, 0xce, 0x59, 0xee, 0xb6, 0xdb, 0x09, 0x61, 0x08, 0xfa, 0x5e, 0xe4, 0xdc, 0xb0, 0xe5}, {0x1b, 0xbc, 0x82, 0xd0, 0x22, 0x12, 0xf5, 0x95, 0x4d, 0xb5, 0xb0, 0x19, 0x81, 0xdc, 0x34, 0xb1, 0x2b, 0x41, 0x4c, 0xbb, 0xe3, 0xc5, 0xdb, 0x52, 0xe9, 0xd4, 0xc5, 0x4a, 0xf7, 0x83, 0x37, 0x9b}, {0x6b, 0x63, 0x31, 0xab, 0x4a, 0x18, 0x53, 0x0d, 0xe8, 0xcd, 0x47, 0xb8, 0xff, 0x1b, 0x5d, 0x5a, 0xf7, 0x8e, 0xd2, 0x45, 0xcc, 0x38, 0x23, 0x28, 0x44, 0x64, 0x91, 0x13, 0x44, 0x94, 0x28, 0x8b}, {0x25, 0x52, 0xe5, 0xbb, 0xdb, 0x5d, 0x74, 0xdc, 0x83, 0x9e, 0x28, 0x63, 0xe9, 0x3c, 0x3c, 0xf5, 0x46, 0xab, 0xbc, 0xc9, 0x51, 0xad, 0x48, 0x08, 0xbb, 0xeb, 0xde, 0x27, 0xc7, 0x61, 0x02, 0x98}, {0x3a, 0x05, 0xa6, 0xf3, 0xde, 0x48, 0x97, 0x5b, 0x13, 0x25, 0x48, 0xa1, 0x4b, 0x4a, 0xd7, 0xe1, 0xac, 0xe0, 0xb1, 0x63, 0xd3, 0xdc, 0xcf, 0x0e, 0x7d, 0xa0, 0x61, 0x14, 0xf9, 0x6d, 0xa2, 0x2f}, {0x28, 0x02, 0x91, 0x2d, 0x4e, 0x49, 0xab, 0xc9, 0x0f, 0x99, 0x9e, 0x5d, 0xe0, 0xc8, 0xdc, 0x72, 0x6f, 0x95, 0x89, 0x98, 0xc0, 0x48, 0x6d, 0x2b, 0xb3, 0xdd, 0x57, 0xa9, 0x20, 0x2f, 0x34, 0xb1}, {0x71, 0xc1, 0xaa, 0x2e, 0x03, 0xf4, 0x65, 0x8f, 0xd5, 0x59, 0xae, 0x33, 0xcc, 0xff, 0xb4, 0x3a, 0xc8, 0x21, 0x6d, 0x2e, 0xd4, 0x18, 0x27, 0xab, 0x5c, 0x86, 0x3a, 0x78, 0x8c, 0x8b, 0x14, 0x4e}},
+    },
+    {
+        .size = 2253,
+        .index = 788,
+        .directions = 0x28c,
+        .proof_len = 12,
+        .leaf = {0x4b, 0x43, 0x4c, 0x8e, 0xdc, 0x93, 0x9b, 0xe0, 0x25, 0x3f, 0xe6, 0x32, 0x65, 0x5c, 0x64, 0xc3, 0x60, 0xc7, 0xbe, 0xe2, 0xe8, 0x11, 0x0f, 0xe6, 0xab, 0x36, 0x7e, 0x91, 0xca, 0x76, 0x2f, 0xa0},
+        .root = {0x0e, 0x33, 0x9c, 0x02, 0xc5, 0x51, 0x1c, 0x6d, 0x06, 0xec, 0xa1, 0xe9, 0x23, 0x8d, 0x32, 0x41, 0x4c, 0x9c, 0xd6, 0xf1, 0x3d, 0x2f, 0x8a, 0xfd, 0x5f, 0x3a, 0x77, 0x5b, 0x70, 0xdf, 0xd8, 0x60},
+        .proof = {{0xce, 0xe5, 0x82, 0x80, 0xb2, 0x29, 0x0f, 0x79, 0x38, 0x58, 0xe5, 0xb8, 0x25, 0xea, 0x8b, 0xd1, 0x2d, 0x81, 0x75, 0xe1, 0xc8, 0x78, 0x9c, 0xaf, 0xa2, 0x73, 0x32, 0x7d, 0xaa, 0x26, 0x10, 0x2a}, {0x16, 0x61, 0x67, 0x08, 0x0b, 0x31, 0x3a, 0x1c, 0xc9, 0xa3, 0x0f, 0xcc, 0x50, 0xfb, 0x06, 0x15, 0x52, 0x79, 0xfb, 0x66, 0x88, 0x12, 0xe1, 0xd9, 0xce, 0x5b, 0x44, 0xa1, 0xfa, 0x39, 0x26, 0xf4}, {0xeb, 0x64, 0x51, 0xe6, 0x98, 0xc4, 0x8e, 0x90, 0x3c, 0x6e, 0x31, 0x32, 0x1e, 0x00, 0x4b, 0x4f, 0x95, 0xc8, 0x40, 0xc5, 0xa7, 0xdb, 0x37, 0x48, 0x61, 0xca, 0x25, 0xa7, 0x86, 0xae, 0x5b, 0xde}, {0x72, 0x9a, 0x44, 0xca, 0x81, 0xc8, 0xb6, 0xd8, 0x7b, 0x45, 0xff, 0x3c, 0xeb, 0xc8, 0x12, 0x02, 0x2f, 0x2f, 0x0b, 0x5a, 0x02, 0x8c, 0x1b, 0xfe, 0x2b, 0x7b, 0x03, 0x78, 0x9f, 0x0a, 0x63, 0xa8}, {0x94, 0xfb, 0x01, 0x51, 0xe0, 0xa3, 0xbd, 0x37, 0x50, 0xe5, 0x13, 0xfa, 0x14, 0xa8, 0x4f, 0x1e, 0x03, 0xb9, 0x82, 0x65, 0xe6, 0x6a, 0x93, 0x6a, 0x52, 0x72, 0x3b, 0x78, 0xc6, 0xc6, 0x99, 0x1e}, {0x43, 0x9b, 0x33, 0x3f, 0x90, 0x00, 0x8c, 0xb6, 0xbf, 0x78, 0x4c, 0xe9, 0x37, 0xf0, 0x5b, 0x62, 0xf3, 0x3d, 0xae, 0x62, 0x46, 0xb6, 0xbb, 0xbc, 0x93, 0xed, 0x72, 0x29, 0xce, 0x55, 0x36, 0x97}, {0x32, 0x65, 0x41, 0xf4, 0x11, 0xb6, 0xb2, 0x37, 0xbb, 0xdb, 0xaf, 0x17, 0xf2, 0x8b, 0xed, 0xe9, 0xc4, 0x5c, 0x52, 0xea, 0xc6, 0xa8, 0xb9, 0xe3, 0x9f, 0x66, 0x55, 0x08, 0x7e, 0x77, 0x35, 0x3b}, {0x2a, 0xfa, 0x8b, 0x8e, 0x1d, 0x4a, 0xb8, 0x8f, 0x02, 0xa3, 0x1f, 0x85, 0x63, 0x94, 0x74, 0xd8, 0x3e, 0xbf, 0x18, 0x23, 0x1f, 0xd7, 0x03, 0xcf, 0x9e, 0xa9, 0xfa, 0x19, 0xad, 0x3d, 0x2a, 0xf6}, {0x25, 0x05, 0x56, 0x5b, 0xfa, 0xac, 0xa0, 0xf1, 0x11, 0x2a, 0xfb, 0x98, 0x43, 0x24, 0xdc, 0x21, 0xd0, 0x09, 0x91, 0x05, 0xfe, 0x0c, 0x30, 0xc7, 0x75, 0xe0, 0x7c, 0xc8, 0xeb, 0xfd, 0x39, 0x1a}, {0x27, 0x9b, 0x66, 0xed, 0x56, 0x74, 0x02, 0x30, 0xe5, 0x8e, 0x2c, 0xd0, 0x73, 0x42, 0x97, 0xec, 0x3b, 0xe5, 0x67, 0x93, 0xce, 0x5a, 0x9f, 0x15, 0xe6, 0xd8, 0xdf, 0xb7, 0x76, 0x2a, 0x50, 0x65}, {0xb3, 0xac, 0xf0, 0xeb, 0xe4, 0x51, 0x87, 0x5b, 0xc0, 0xa1, 0x81, 0x37, 0x1e, 0x9a, 0x64, 0xed, 0xb9, 0xa3, 0xa6, 0x61, 0xac, 0xb6, 0x18, 0x35, 0x8c, 0xf8, 0xe1, 0x13, 0x33, 0xb0, 0x07, 0xdf}, {0xaa, 0xfa, 0xfe, 0xd0, 0x61, 0x09, 0x0c, 0xbc, 0x19, 0xc2, 0xb7, 0x20, 0xc1, 0x61, 0x83, 0xde, 0x9d, 0x8f, 0x2f, 0xa8, 0x4f, 0x77, 0xa7, 0xff, 0x2e, 0x5d, 0x31, 0x46, 0x7f, 0xf5, 0x39, 0x15}},
+    },
+    {
+        .size = 19,
+        .index = 3,
+        .directions = 0x18,
+        .proof_len = 5,
+        .leaf = {0x0f, 0xf4, 0x38, 0x4d, 0x75, 0x11, 0x14, 0x66, 0x7f, 0x6c, 0x38, 0xda, 0x19, 0xf9, 0x48, 0x4a, 0x60, 0x82, 0xe3, 0x68, 0x30, 0x03, 0xec, 0xa6, 0x62, 0xc2, 0x45, 0x17, 0xa8, 0x81, 0x30, 0x5b},
+        .root = {0xec, 0xc4, 0xff, 0x12, 0xd2, 0x9d, 0x0e, 0x6d, 0xc1, 0xad, 0x28, 0xd5, 0x26, 0x3c, 0x98, 0x23, 0xbf, 0xdb, 0x44, 0x85, 0xfe, 0x6d, 0x5b, 0x54, 0x7b, 0x13, 0x47, 0xab, 0x10, 0x7b, 0xc0, 0x22},
+        .proof = {{0xd4, 0xd6, 0x01, 0x6c, 0x97, 0x30, 0x83, 0xec, 0xa6, 0x6f, 0xc5, 0xc7, 0x8f, 0xeb, 0x90, 0xab, 0xcf, 0xd1, 0xbf, 0x3c, 0xd3, 0x65, 0xb2, 0x00, 0x33, 0xb8, 0x95, 0xaf, 0xd4, 0x49, 0xa3, 0xe3}, {0xa6, 0x4a, 0xf5, 0x9a, 0x64, 0xc0, 0x00, 0x35, 0xf2, 0xbf, 0x15, 0xad, 0xeb, 0xa1, 0x14, 0x61, 0x0b, 0xb5, 0xb4, 0x42, 0xf2, 0x7e, 0x33, 0x57, 0x8e, 0x45, 0x9f, 0xe3, 0x8b, 0x19, 0x9c, 0x3f}, {0xf4, 0xb4, 0x3c, 0x5a, 0xe7, 0xc3, 0x30, 0xae, 0x08, 0x68, 0x9c, 0x2f, 0x97, 0x16, 0xee, 0xef, 0x65, 0x1f, 0xaa, 0xda, 0x6c, 0xc0, 0x7a, 0x41, 0x5f, 0x63, 0x61, 0x36, 0x2f, 0x36, 0xeb, 0x59}, {0x84, 0x53, 0xe3, 0x1d, 0xc9, 0x30, 0x3d, 0xc2, 0x0c, 0xcc, 0xdc, 0x06, 0xe0, 0x17, 0x5b, 0x32, 0x6e, 0x97, 0x90, 0x2a, 0xe4, 0xd0, 0xa9, 0x10, 0xc2, 0x17, 0xf7, 0x1e, 0x27, 0x0e, 0x13, 0xb8}, {0x12, 0x56, 0x47, 0x3a, 0x49, 0xff, 0xa6, 0x76, 0xea, 0x3f, 0x8c, 0x76, 0xb3, 0x99, 0xb6, 0x22, 0x0c, 0x58, 0x1c, 0x2d, 0xda, 0x2b, 0xd1, 0x00, 0x47, 0x4a, 0xf9, 0xcf, 0x62, 0x15, 0xc1, 0xf4}},
+    },
+    {
+        .size = 739,
+        .index = 606,
+        .directions = 0xf5,
+        .proof_len = 9,
+        .leaf = {0x92, 0x81, 0x1d, 0x5e, 0x0f, 0xc6, 0x03, 0x75, 0x2f, 0xf8, 0xe3, 0x89, 0x4b, 0x7e, 0x78, 0x32, 0x93, 0x7b, 0x4d, 0x3f, 0xa9, 0xb6, 0xdc, 0xc9, 0x0f, 0x24, 0x43, 0x63, 0x14, 0x24, 0x35, 0x7d},
+        .root = {0x40, 0xb1, 0x26, 0x26, 0xe1, 0xf8, 0x61, 0xdd, 0x39, 0xfc, 0x60, 0x83, 0xe7, 0x12, 0x8f, 0xbe, 0x2f, 0x85, 0xd2, 0x7d, 0x5a, 0x20, 0x18, 0xdd, 0x94, 0xfd, 0x27, 0xe1, 0x53, 0xa6, 0x61, 0x13},
+        .proof = {{0x65, 0x6d, 0xdf, 0x9d, 0x59, 0x7c, 0x61, 0x70, 0xf6, 0x14, 0x2e, 0x99, 0xcb, 0xd9, 0xf9, 0x14, 0x14, 0x49, 0x5b, 0x54, 0x5b, 0x32, 0x43, 0x44, 0x5f, 0x4c, 0x98, 0x58, 0xf0, 0x6c, 0x33, 0x64}, {0xee, 0xc8, 0xd1, 0x60, 0xda, 0xa4, 0x4c, 0x9a, 0xce, 0xe1, 0x35, 0xdb, 0xf1, 0x08, 0x61, 0x82, 0x71, 0xe0, 0x18, 0x00, 0xe6, 0xdf, 0x15, 0xeb, 0xc9, 0xdd, 0x02, 0x22, 0xae, 0x67, 0xbe, 0x86}, {0xd3, 0xc4, 0xe9, 0x44, 0x3f, 0xbb, 0xf1, 0x88, 0x27, 0xba, 0xe7, 0x1f, 0xb3, 0x9d, 0x06, 0x8c, 0x8c, 0x58, 0xc9, 0x94, 0x80, 0x82, 0x74, 0xb2, 0x99, 0x78, 0x68, 0xad, 0x09, 0x56, 0xa8, 0x8b}, {0x39, 0x25, 0xb7, 0xf9, 0x2f, 0x1c, 0xd5, 0x93, 0xae, 0xcf, 0x53, 0xdf, 0x1d, 0x49, 0x41, 0x51, 0x2f, 0x52, 0x89, 0xbb, 0x1c, 0x64, 0x45, 0x31, 0xb7, 0x6f, 0xce, 0xa9, 0x23, 0x46, 0xf7, 0xd6}, {0x62, 0x3e, 0x40, 0xf8, 0x60, 0x2a, 0x46, 0x63, 0xf1, 0xea, 0xb3, 0x8b, 0xc4, 0xe5, 0x9b, 0x58, 0x24, 0x1f, 0x96, 0xc2, 0x52, 0x43, 0x59, 0x51, 0x0b, 0xcf, 0x68, 0x91, 0x98, 0xea, 0xcc, 0x23}, {0x5f, 0x43, 0xdc, 0x76, 0x6f, 0xac, 0x77, 0x02, 0x06, 0xee, 0xe6, 0xab, 0xd0, 0x6f, 0xd2, 0x38, 0xc0, 0xe5, 0x02, 0xc3, 0x56, 0x36, 0x88, 0xc0, 0xb4, 0x80, 0x9f, 0x26, 0x5d, 0xbc, 0xdd, 0x36}, {0x26, 0x62, 0xe7, 0xdc, 0x85, 0xc4, 0xd4, 0x1d, 0x46, 0xd8, 0x5a, 0xac, 0xcb, 0xbb, 0x37, 0xb0, 0xec, 0xd9, 0x37, 0x9b, 0xe6, 0xc5, 0xd4, 0xb2, 0xeb, 0x3a, 0x13, 0xb4, 0xea, 0x1d, 0x53, 0x02}, {0x40, 0x8a, 0x0f, 0x24, 0x30, 0x22, 0xc7, 0xb7, 0x79, 0xd2, 0xbf, 0x7b, 0x33, 0x51, 0x59, 0x1b, 0x8b, 0x76, 0x3c, 0xb8, 0xce, 0xf3, 0x4f, 0x26, 0x54, 0x9c, 0x0f, 0xa6, 0x1a, 0xdb, 0x27, 0x22}, {0x71, 0xa0, 0xb8, 0x6d, 0x42, 0xd3, 0x66, 0x13, 0x30, 0x0a, 0xd1, 0x67, 0xc8, 0xca, 0xb9, 0xef, 0x52, 0x84, 0x79, 0xc3, 0x6a, 0xb9, 0x90, 0xfa, 0x8b, 0x8f, 0xae, 0x98, 0x14, 0x4d, 0x68, 0x98}},
+    },
+    {
+        .size = 13,
+        .index = 5,
+        .directions = 0xa,
+        .proof_len = 4,
+        .leaf = {0x98, 0xe0, 0xd0, 0x6a, 0x00, 0x73, 0x6a, 0xf5, 0x65, 0x0a, 0x91, 0xf0, 0xa4, 0x4f, 0x78, 0x38, 0xac, 0x3c, 0x2e, 0xa2, 0xff, 0xd5, 0x75, 0x67, 0xe7, 0xd1, 0x2a, 0x6f, 0x6f, 0x9d, 0xa3, 0xe3},
+        .root = {0x0b, 0x8d, 0x47, 0x16, 0x3f, 0xfc, 0x77, 0x52, 0xe4, 0x81, 0xb5, 0xd8, 0xda, 0xe1, 0x2d, 0xf8, 0x63, 0xd4, 0xda, 0xb2, 0xac, 0x2a, 0xee, 0x0a, 0x7d, 0xa6, 0x97, 0x72, 0x10, 0xc8, 0xc6, 0x9e},
+        .proof = {{0x98, 0x1f, 0x8f, 0x89, 0x76, 0xaa, 0x89, 0x6e, 0xfd, 0x0d, 0xc9, 0x37, 0x7d, 0xcb, 0x55, 0x9a, 0x11, 0xa8, 0x4e, 0x55, 0xcb, 0x62, 0xbd, 0xdd, 0xa2, 0xb9, 0x11, 0x93, 0xe7, 0xc6, 0x4b, 0x56}, {0x7f, 0x15, 0x39, 0x18, 0x32, 0x72, 0x6e, 0xd4, 0x08, 0x9c, 0x88, 0xe2, 0x37, 0x29, 0x2c, 0xe2, 0x83, 0xc8, 0xeb, 0x3f, 0x4d, 0x52, 0x40, 0x09, 0xc7, 0x2d, 0x9a, 0xe7, 0x20, 0x89, 0x6f, 0xc2}, {0xc6, 0x61, 0x74, 0x19, 0x3c, 0xc5, 0x65, 0x42, 0xcf, 0xd2, 0x0b, 0x16, 0x7b, 0x5b, 0x30, 0x8e, 0x0c, 0xe4, 0x02, 0x07, 0x81, 0x89, 0x6e, 0x5d, 0x06, 0xcc, 0x9e, 0x39, 0x39, 0x42, 0x3b, 0xe2}, {0xfc, 0xaf, 0x89, 0x37, 0x43, 0xad, 0xba, 0x04, 0x1b, 0xec, 0x57, 0x83, 0x60, 0xfd, 0x8b, 0xd6, 0xb8, 0xe1, 0xf9, 0x9d, 0xb1, 0x54, 0x75, 0x61, 0xa8, 0xaa, 0x1f, 0xb9, 0x7f, 0x0b, 0xca, 0x69}},
+    },
+};
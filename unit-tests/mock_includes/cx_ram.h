@@ -0,0 +1,13 @@
+#pragma once
+
+#include "os.h"
+#include "cx.h"
+
+/**
+ * Shared RAM region for the cryptographic contexts (the CXRAM section on the device).
+ */
+union cx_u {
+    cx_sha256_t sha256;
+};
+
+extern union cx_u G_cx;
@@ -110,4 +110,13 @@ CXCALL int cx_hash(cx_hash_t *hash PLENGTH(scc__cx_scc_struct_size_hash__hash),
                    unsigned int len, unsigned char *out PLENGTH(out_len),
                    unsigned int out_len);
 
+/** Error code returned by the *_no_throw functions; 0 on success. */
+typedef uint32_t cx_err_t;
+
+/**
+ * Same as cx_hash, but returns an error code instead of throwing an exception.
+ */
+cx_err_t cx_hash_no_throw(cx_hash_t *hash, uint32_t mode, const uint8_t *in, size_t len,
+                          uint8_t *out, size_t out_len);
+
 #endif
@@ -60,6 +60,11 @@ CXCALL int cx_sha224_init(cx_sha256_t *hash PLENGTH(sizeof(cx_sha256_t)));
  */
 CXCALL int cx_sha256_init(cx_sha256_t *hash PLENGTH(sizeof(cx_sha256_t)));
 
+/**
+ * Same as cx_sha256_init, but returns an error code instead of throwing an exception.
+ */
+cx_err_t cx_sha256_init_no_throw(cx_sha256_t *hash);
+
 /**
  * One shot SHA-256 digest
  *
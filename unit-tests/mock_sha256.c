@@ -0,0 +1,119 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "cx_ram.h"
+
+// Reference implementation of SHA-256, used to mock the hash functions of the SDK.
+// The state is kept in the acc field of the context, and the number of processed blocks in the
+// counter of its header.
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static uint32_t ror(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+static void sha256_compress(cx_sha256_t *hash) {
+    uint32_t state[8], w[64];
+    memcpy(state, hash->acc, sizeof(state));
+
+    for (int i = 0; i < 16; i++) {
+        const uint8_t *p = hash->block + 4 * i;
+        w[i] = (uint32_t) p[0] << 24 | (uint32_t) p[1] << 16 | (uint32_t) p[2] << 8 | p[3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+    memcpy(hash->acc, state, sizeof(state));
+
+    ++hash->header.counter;
+    hash->blen = 0;
+}
+
+cx_err_t cx_sha256_init_no_throw(cx_sha256_t *hash) {
+    static const uint32_t iv[8] = {0x6a09e667,
+                                   0xbb67ae85,
+                                   0x3c6ef372,
+                                   0xa54ff53a,
+                                   0x510e527f,
+                                   0x9b05688c,
+                                   0x1f83d9ab,
+                                   0x5be0cd19};
+    memset(hash, 0, sizeof(*hash));
+    hash->header.algo = CX_SHA256;
+    memcpy(hash->acc, iv, sizeof(iv));
+    return 0;
+}
+
+cx_err_t cx_hash_no_throw(cx_hash_t *hash_header,
+                          uint32_t mode,
+                          const uint8_t *in,
+                          size_t len,
+                          uint8_t *out,
+                          size_t out_len) {
+    cx_sha256_t *hash = (cx_sha256_t *) hash_header;
+
+    for (size_t i = 0; i < len; i++) {
+        hash->block[hash->blen++] = in[i];
+        if (hash->blen == 64) {
+            sha256_compress(hash);
+        }
+    }
+
+    if (mode & CX_LAST) {
+        uint64_t bit_len = ((uint64_t) hash->header.counter * 64 + hash->blen) * 8;
+
+        hash->block[hash->blen++] = 0x80;
+        if (hash->blen > 56) {
+            memset(hash->block + hash->blen, 0, 64 - hash->blen);
+            sha256_compress(hash);
+        }
+        memset(hash->block + hash->blen, 0, 56 - hash->blen);
+        for (int i = 0; i < 8; i++) {
+            hash->block[63 - i] = (uint8_t) (bit_len >> (8 * i));
+        }
+        sha256_compress(hash);
+
+        uint32_t state[8];
+        memcpy(state, hash->acc, sizeof(state));
+        for (size_t i = 0; i < 32 && i < out_len; i++) {
+            out[i] = (uint8_t) (state[i / 4] >> (24 - 8 * (i % 4)));
+        }
+    }
+    return 0;
+}
@@ -4,15 +4,12 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 
 #include <cmocka.h>
 
-uint8_t G_cxram_replacement_buffer[1024];
-
-uint8_t *get_cxram_buffer() {
-    return G_cxram_replacement_buffer;
-}
-
 #include "common/base58.h"
 
 static void test_base58(void **state) {
@@ -33,8 +30,207 @@ static void test_base58(void **state) {
     assert_string_equal((char *) out2, expected_out2);
 }
 
+// byte-by-byte conversions (the textbook algorithm), used as a reference for the limb-based ones
+static int reference_base58_decode(const char *in, size_t in_len, uint8_t *out, size_t out_len) {
+    static const char alphabet[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+    uint8_t buffer[256] = {0};
+    size_t size = 0;
+    size_t zero_count = 0;
+
+    while (zero_count < in_len && in[zero_count] == '1') {
+        ++zero_count;
+    }
+    for (size_t i = zero_count; i < in_len; i++) {
+        const char *c = strchr(alphabet, in[i]);
+        if (c == NULL || *c == '\0') {
+            return -1;
+        }
+        uint32_t carry = (uint32_t) (c - alphabet);
+        for (size_t k = 0; k < size; k++) {
+            carry += (uint32_t) buffer[k] * 58;
+            buffer[k] = carry & 0xFF;
+            carry >>= 8;
+        }
+        while (carry != 0) {
+            buffer[size++] = carry & 0xFF;
+            carry >>= 8;
+        }
+    }
+    if (out_len < zero_count + size) {
+        return -1;
+    }
+    memset(out, 0, zero_count);
+    for (size_t k = 0; k < size; k++) {
+        out[zero_count + k] = buffer[size - 1 - k];
+    }
+    return (int) (zero_count + size);
+}
+
+static int reference_base58_encode(const uint8_t *in, size_t in_len, char *out, size_t out_len) {
+    static const char alphabet[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+    uint8_t digits[256] = {0};
+    size_t size = 0;
+    size_t zero_count = 0;
+
+    while (zero_count < in_len && in[zero_count] == 0) {
+        ++zero_count;
+    }
+    for (size_t i = zero_count; i < in_len; i++) {
+        uint32_t carry = in[i];
+        for (size_t k = 0; k < size; k++) {
+            carry += (uint32_t) digits[k] << 8;
+            digits[k] = carry % 58;
+            carry /= 58;
+        }
+        while (carry != 0) {
+            digits[size++] = carry % 58;
+            carry /= 58;
+        }
+    }
+    if (out_len < zero_count + size) {
+        return -1;
+    }
+    memset(out, '1', zero_count);
+    for (size_t k = 0; k < size; k++) {
+        out[zero_count + k] = alphabet[digits[size - 1 - k]];
+    }
+    return (int) (zero_count + size);
+}
+
+// tpub of the speculos seed at m/44'/1'/0', and its decoding (including the checksum)
+static const char xpub[] =
+    "tpubDCwYjpDhUdPGP5rS3wgNg13mTrrjBuG8V9VpWbyptX6TRPbNoZVXsoVUSkCjmQ8jJycjuDKBb9eataSymXakTTaGif"
+    "xR6kmVsfFehH1ZgJT";
+static const uint8_t xpub_decoded[] = {
+    0x04, 0x35, 0x87, 0xcf, 0x03, 0x7c, 0xac, 0x55, 0x06, 0x80, 0x00, 0x00, 0x00, 0xb7,
+    0xb9, 0x3b, 0x0f, 0x1b, 0xf8, 0x80, 0x83, 0x44, 0x38, 0x80, 0x19, 0x39, 0xc3, 0xe5,
+    0x4b, 0xcc, 0x1d, 0x4b, 0x5a, 0x66, 0x7c, 0xae, 0x3c, 0x61, 0x82, 0x7e, 0xdf, 0x19,
+    0x0f, 0x6d, 0x9d, 0x03, 0xe8, 0x4c, 0x7f, 0x4b, 0x76, 0x62, 0xfa, 0xed, 0x9f, 0x5e,
+    0xb2, 0xd8, 0x12, 0xd9, 0xb7, 0xbc, 0xf0, 0xe0, 0xbf, 0x2a, 0x33, 0xb1, 0x7a, 0xc4,
+    0x5e, 0x38, 0xb8, 0x45, 0x96, 0x69, 0xc3, 0x21, 0x2b, 0x13, 0x73, 0xf0};
+
+static void test_base58_vectors(void **state) {
+    (void) state;
+
+    uint8_t decoded[128];
+    char encoded[200];
+
+    // xpub
+    assert_int_equal(base58_decode(xpub, sizeof(xpub) - 1, decoded, sizeof(decoded)),
+                     sizeof(xpub_decoded));
+    assert_memory_equal(decoded, xpub_decoded, sizeof(xpub_decoded));
+    assert_int_equal(base58_encode(xpub_decoded, sizeof(xpub_decoded), encoded, sizeof(encoded)),
+                     sizeof(xpub) - 1);
+    assert_memory_equal(encoded, xpub, sizeof(xpub) - 1);
+
+    // legacy address, with a leading zero byte
+    const char address[] = "1BvBMSEYstWetqTFn5Au4m4GFg7xJaNVN2";
+    const uint8_t address_decoded[] = {0x00, 0x77, 0xbf, 0xf2, 0x0c, 0x60, 0xe5, 0x22, 0xdf,
+                                       0xaa, 0x33, 0x50, 0xc3, 0x9b, 0x03, 0x0a, 0x5d, 0x00,
+                                       0x4e, 0x83, 0x9a, 0xf4, 0x15, 0x76, 0x6b};
+    assert_int_equal(base58_decode(address, sizeof(address) - 1, decoded, sizeof(decoded)),
+                     sizeof(address_decoded));
+    assert_memory_equal(decoded, address_decoded, sizeof(address_decoded));
+    assert_int_equal(
+        base58_encode(address_decoded, sizeof(address_decoded), encoded, sizeof(encoded)),
+        sizeof(address) - 1);
+    assert_memory_equal(encoded, address, sizeof(address) - 1);
+
+    // leading zeros
+    const uint8_t zeros_prefix[] = {0, 0, 0, 1, 2, 3};
+    assert_int_equal(base58_encode(zeros_prefix, sizeof(zeros_prefix), encoded, sizeof(encoded)),
+                     6);
+    assert_memory_equal(encoded, "111Ldp", 6);
+    assert_int_equal(base58_decode("111Ldp", 6, decoded, sizeof(decoded)), sizeof(zeros_prefix));
+    assert_memory_equal(decoded, zeros_prefix, sizeof(zeros_prefix));
+
+    const uint8_t only_zeros[] = {0, 0, 0};
+    assert_int_equal(base58_encode(only_zeros, sizeof(only_zeros), encoded, sizeof(encoded)), 3);
+    assert_memory_equal(encoded, "111", 3);
+    assert_int_equal(base58_decode("111", 3, decoded, sizeof(decoded)), 3);
+    assert_memory_equal(decoded, only_zeros, sizeof(only_zeros));
+
+    // errors
+    assert_int_equal(base58_decode("1BvBMSEYstWetqTFn5Au4m4GFg7xJaNV0", 33, decoded, 128), -1);
+    assert_int_equal(base58_decode("1BvBMSEYstWetqTFn5Au4m4GFg7xJaNVl", 33, decoded, 128), -1);
+    assert_int_equal(base58_decode(address, sizeof(address) - 1, decoded, 24), -1);
+    assert_int_equal(base58_encode(address_decoded, sizeof(address_decoded), encoded, 33), -1);
+}
+
+static void test_base58_random(void **state) {
+    (void) state;
+
+    srand(42);
+    for (int iter = 0; iter < 2000; iter++) {
+        uint8_t data[MAX_ENC_INPUT_SIZE];
+        size_t data_len = 1 + rand() % (MAX_ENC_INPUT_SIZE - 1);
+        size_t n_zeros = rand() % 4 == 0 ? rand() % 4 : 0;
+        for (size_t i = 0; i < data_len; i++) {
+            data[i] = i < n_zeros ? 0 : rand() & 0xFF;
+        }
+
+        char encoded[200];
+        char expected_encoded[200];
+        int encoded_len = base58_encode(data, data_len, encoded, sizeof(encoded));
+        assert_int_equal(
+            encoded_len,
+            reference_base58_encode(data, data_len, expected_encoded, sizeof(expected_encoded)));
+        assert_memory_equal(encoded, expected_encoded, encoded_len);
+
+        if (encoded_len < 2 || encoded_len > MAX_DEC_INPUT_SIZE) {
+            continue;
+        }
+
+        uint8_t decoded[MAX_ENC_INPUT_SIZE];
+        int decoded_len = base58_decode(encoded, encoded_len, decoded, sizeof(decoded));
+        assert_int_equal(decoded_len, data_len);
+        assert_memory_equal(decoded, data, data_len);
+
+        uint8_t expected_decoded[MAX_ENC_INPUT_SIZE];
+        assert_int_equal(
+            reference_base58_decode(encoded, encoded_len, expected_decoded, sizeof(expected_decoded)),
+            data_len);
+    }
+}
+
+#define BENCHMARK_ITERATIONS 20000
+
+// Not a pass/fail test: prints the time spent converting an xpub with the limb-based and the
+// reference implementations. The ratio is only indicative of the gain on the device.
+static void test_base58_benchmark(void **state) {
+    (void) state;
+
+    uint8_t decoded[128];
+    char encoded[200];
+    volatile int sink = 0;
+
+    clock_t start = clock();
+    for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        sink += base58_decode(xpub, sizeof(xpub) - 1, decoded, sizeof(decoded));
+        sink += base58_encode(decoded, sizeof(xpub_decoded), encoded, sizeof(encoded));
+    }
+    clock_t limbs_time = clock() - start;
+
+    start = clock();
+    for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        sink += reference_base58_decode(xpub, sizeof(xpub) - 1, decoded, sizeof(decoded));
+        sink += reference_base58_encode(decoded, sizeof(xpub_decoded), encoded, sizeof(encoded));
+    }
+    clock_t reference_time = clock() - start;
+
+    assert_int_equal(sink, 2 * BENCHMARK_ITERATIONS * (sizeof(xpub) - 1 + sizeof(xpub_decoded)));
+
+    printf("base58 xpub decode+encode, %d iterations: limbs %.3f s, reference %.3f s\n",
+           BENCHMARK_ITERATIONS,
+           (double) limbs_time / CLOCKS_PER_SEC,
+           (double) reference_time / CLOCKS_PER_SEC);
+}
+
 int main() {
-    const struct CMUnitTest tests[] = {cmocka_unit_test(test_base58)};
+    const struct CMUnitTest tests[] = {cmocka_unit_test(test_base58),
+                                       cmocka_unit_test(test_base58_vectors),
+                                       cmocka_unit_test(test_base58_random),
+                                       cmocka_unit_test(test_base58_benchmark)};
 
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -0,0 +1,58 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "common/bitvector.h"
+
+static void test_bitvector_real_size(void **state) {
+    (void) state;
+
+    assert_int_equal(BITVECTOR_REAL_SIZE(0), 0);
+    assert_int_equal(BITVECTOR_REAL_SIZE(1), 1);
+    assert_int_equal(BITVECTOR_REAL_SIZE(8), 1);
+    assert_int_equal(BITVECTOR_REAL_SIZE(9), 2);
+    assert_int_equal(BITVECTOR_REAL_SIZE(512), 64);
+}
+
+static void test_bitvector_set_get(void **state) {
+    (void) state;
+
+    uint8_t vec[BITVECTOR_REAL_SIZE(20)];
+    memset(vec, 0, sizeof(vec));
+
+    bitvector_set(vec, 0, true);
+    bitvector_set(vec, 9, true);
+    bitvector_set(vec, 19, true);
+
+    assert_int_equal(vec[0], 0x01);
+    assert_int_equal(vec[1], 0x02);
+    assert_int_equal(vec[2], 0x08);
+
+    for (size_t i = 0; i < 20; i++) {
+        assert_int_equal(bitvector_get(vec, i), i == 0 || i == 9 || i == 19);
+    }
+
+    // clearing a bit does not affect the neighbours
+    bitvector_set(vec, 9, false);
+    assert_false(bitvector_get(vec, 9));
+    assert_false(bitvector_get(vec, 8));
+    assert_false(bitvector_get(vec, 10));
+    assert_true(bitvector_get(vec, 0));
+    assert_true(bitvector_get(vec, 19));
+
+    // setting a bit twice is idempotent
+    bitvector_set(vec, 19, true);
+    assert_int_equal(vec[2], 0x08);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {cmocka_unit_test(test_bitvector_real_size),
+                                       cmocka_unit_test(test_bitvector_set_get)};
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
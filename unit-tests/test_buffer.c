@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
 
 #include <cmocka.h>
 
@@ -271,13 +273,74 @@ static void test_buffer_create(void **state) {
     assert_int_equal(buffer.offset, 0);
 }
 
+// Reference byte-wise little-endian reader, as the readers were before being inlined
+static uint64_t reference_read_le(const uint8_t *ptr, size_t len) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < len; i++) {
+        value |= (uint64_t) ptr[i] << (8 * i);
+    }
+    return value;
+}
+
+#define BENCHMARK_ITERATIONS 2000
+
+// Not a pass/fail test: prints the time spent reading the fixed-size fields of transaction outputs
+// (an 8-bytes amount followed by a 4-bytes field) with the buffer readers and with a byte-wise
+// reference implementation. The ratio is only indicative of the gain on the device.
+static void test_buffer_read_benchmark(void **state) {
+    (void) state;
+
+    uint8_t data[12 * 256];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t) (i * 7 + 3);
+    }
+
+    uint64_t expected = 0;
+    for (size_t i = 0; i < sizeof(data); i += 12) {
+        expected += reference_read_le(data + i, 8) + reference_read_le(data + i + 8, 4);
+    }
+
+    volatile uint64_t sink = 0;
+
+    clock_t start = clock();
+    for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        buffer_t buf = buffer_create(data, sizeof(data));
+        uint64_t sum = 0, amount;
+        uint32_t field;
+        while (buffer_read_u64(&buf, &amount, LE) && buffer_read_u32(&buf, &field, LE)) {
+            sum += amount + field;
+        }
+        assert_int_equal(sum, expected);
+        sink += sum;
+    }
+    clock_t inline_time = clock() - start;
+
+    start = clock();
+    for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        uint64_t sum = 0;
+        for (size_t j = 0; j < sizeof(data); j += 12) {
+            sum += reference_read_le(data + j, 8) + reference_read_le(data + j + 8, 4);
+        }
+        assert_int_equal(sum, expected);
+        sink += sum;
+    }
+    clock_t reference_time = clock() - start;
+
+    (void) sink;
+
+    printf("buffer read u64+u32 LE, %d iterations: inline %.3f s, reference %.3f s\n",
+           BENCHMARK_ITERATIONS,
+           (double) inline_time / CLOCKS_PER_SEC,
+           (double) reference_time / CLOCKS_PER_SEC);
+}
 
 int main() {
     const struct CMUnitTest tests[] = {cmocka_unit_test(test_buffer_can_read),
                                        cmocka_unit_test(test_buffer_seek),
                                        cmocka_unit_test(test_buffer_read),
                                        cmocka_unit_test(test_buffer_write),
-                                       cmocka_unit_test(test_buffer_create)};
+                                       cmocka_unit_test(test_buffer_create),
+                                       cmocka_unit_test(test_buffer_read_benchmark)};
 
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
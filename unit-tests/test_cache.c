@@ -0,0 +1,933 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "common/bip32.h"
+#include "common/cache.h"
+#include "common/account_xpub_cache.h"
+#include "common/address_cache.h"
+#include "common/key_info_cache.h"
+#include "common/map_commitment_cache.h"
+#include "common/merkle_cache.h"
+#include "common/private_node_cache.h"
+#include "common/pubkey_cache.h"
+#include "common/sorted_tree_cache.h"
+#include "common/symmetric_key_cache.h"
+#include "common/taproot_key_cache.h"
+#include "common/tweaked_key_cache.h"
+#include "common/wallet_cache.h"
+#include "common/xpub_cache.h"
+
+#define H BIP32_FIRST_HARDENED_CHILD
+
+/*
+  The storage shared by all the caches: lookups, round-robin replacement, slots and wiping.
+*/
+
+#define TEST_CACHE_SIZE 4
+
+typedef struct {
+    struct {
+        uint32_t id;
+    } key;
+    uint8_t value[8];
+} test_cache_entry_t;
+
+CACHE_DEFINE(G_test_cache, test_cache_entry_t, TEST_CACHE_SIZE);
+
+static test_cache_entry_t *add(uint32_t id, uint8_t fill) {
+    test_cache_entry_t *entry = cache_add(&G_test_cache, &id);
+    if (entry != NULL) {
+        memset(entry->value, fill, sizeof(entry->value));
+    }
+    return entry;
+}
+
+static const test_cache_entry_t *get(uint32_t id) {
+    return cache_get(&G_test_cache, &id);
+}
+
+static void test_cache(void **state) {
+    (void) state;
+
+    cache_reset(&G_test_cache);
+
+    assert_null(get(1));
+    assert_non_null(add(1, 0xAA));
+
+    const test_cache_entry_t *entry = get(1);
+    assert_non_null(entry);
+    assert_int_equal(entry->key.id, 1);
+    assert_int_equal(entry->value[0], 0xAA);
+
+    // any difference in the key is a miss
+    assert_null(get(2));
+
+    // adding the same key again does not use another slot, nor change the value
+    for (int i = 0; i < TEST_CACHE_SIZE; i++) {
+        assert_null(add(1, 0xBB));
+    }
+    for (int i = 0; i < TEST_CACHE_SIZE - 1; i++) {
+        assert_non_null(add(100 + i, 0xCC));
+    }
+    assert_non_null(get(1));
+    assert_int_equal(get(1)->value[0], 0xAA);
+
+    // the oldest entry is replaced once the cache is full, with its value zeroed
+    entry = add(200, 0xDD);
+    assert_non_null(entry);
+    assert_null(get(1));
+    assert_ptr_equal(get(200), entry);
+    for (int i = 0; i < TEST_CACHE_SIZE - 1; i++) {
+        assert_non_null(get(100 + i));
+    }
+
+    // the entries are wiped
+    cache_reset(&G_test_cache);
+    assert_null(get(200));
+    const uint8_t *bytes = (const uint8_t *) G_test_cache_entries;
+    for (size_t i = 0; i < sizeof(G_test_cache_entries); i++) {
+        assert_int_equal(bytes[i], 0);
+    }
+}
+
+static void test_cache_slots(void **state) {
+    (void) state;
+
+    cache_reset(&G_test_cache);
+
+    uint32_t id = 0;
+    assert_null(cache_get_at(&G_test_cache, 2, &id));
+
+    // an unused slot is never a hit, even for a key of zeros
+    assert_null(get(0));
+
+    test_cache_entry_t *entry = cache_set_at(&G_test_cache, 2, &id);
+    assert_ptr_equal(entry, &G_test_cache_entries[2]);
+    assert_ptr_equal(cache_get_at(&G_test_cache, 2, &id), entry);
+    assert_null(cache_get_at(&G_test_cache, 1, &id));
+    assert_ptr_equal(get(0), entry);
+
+    // a new key replaces the entry of the slot
+    id = 5;
+    memset(entry->value, 0xAA, sizeof(entry->value));
+    assert_ptr_equal(cache_set_at(&G_test_cache, 2, &id), entry);
+    assert_int_equal(entry->value[0], 0);
+    assert_null(get(0));
+    assert_ptr_equal(get(5), entry);
+}
+
+/*
+  The caches of the pubkeys and the private keys of the wallet policies, on the keys of the inputs
+  of a transaction.
+*/
+
+static void test_pubkey_cache(void **state) {
+    (void) state;
+
+    uint8_t root1[32], root2[32];
+    memset(root1, 0x11, 32);
+    memset(root2, 0x22, 32);
+
+    uint8_t chain_code[32], pubkey[65];
+    memset(chain_code, 0xCC, 32);
+    memset(pubkey, 0x04, 65);
+
+    uint8_t out_chain_code[32], out_pubkey[65];
+    bool has_wildcard;
+
+    pubkey_cache_reset();
+
+    assert_false(pubkey_cache_get(root1, 3, 0, 0, &has_wildcard, out_chain_code, out_pubkey));
+
+    pubkey_cache_add(root1, 3, 0, 1, true, chain_code, pubkey);
+    assert_true(pubkey_cache_get(root1, 3, 0, 1, &has_wildcard, out_chain_code, out_pubkey));
+    assert_true(has_wildcard);
+    assert_memory_equal(out_chain_code, chain_code, 32);
+    assert_memory_equal(out_pubkey, pubkey, 65);
+
+    // any difference in the identifier of the key is a miss
+    assert_false(pubkey_cache_get(root2, 3, 0, 1, &has_wildcard, out_chain_code, out_pubkey));
+    assert_false(pubkey_cache_get(root1, 4, 0, 1, &has_wildcard, out_chain_code, out_pubkey));
+    assert_false(pubkey_cache_get(root1, 3, 1, 1, &has_wildcard, out_chain_code, out_pubkey));
+    assert_false(pubkey_cache_get(root1, 3, 0, 0, &has_wildcard, out_chain_code, out_pubkey));
+
+    // for keys without wildcard, the change is ignored
+    pubkey_cache_add(root1, 3, 2, 0, false, chain_code, pubkey);
+    assert_true(pubkey_cache_get(root1, 3, 2, 1, &has_wildcard, out_chain_code, out_pubkey));
+    assert_false(has_wildcard);
+
+    // empty trees are never added
+    pubkey_cache_add(root2, 0, 0, 0, false, chain_code, pubkey);
+    assert_false(pubkey_cache_get(root2, 0, 0, 0, &has_wildcard, out_chain_code, out_pubkey));
+
+    // the inputs of a 2-of-2 multisig spend from both receive and change addresses: each key is
+    // only derived once at each /change
+    pubkey_cache_reset();
+    int n_misses = 0;
+    for (uint32_t input = 0; input < 100; input++) {
+        uint32_t change = input % 2;
+        for (uint32_t key_index = 0; key_index < 2; key_index++) {
+            if (!pubkey_cache_get(root1,
+                                  2,
+                                  key_index,
+                                  change,
+                                  &has_wildcard,
+                                  out_chain_code,
+                                  out_pubkey)) {
+                ++n_misses;
+                pubkey_cache_add(root1, 2, key_index, change, true, chain_code, pubkey);
+            }
+        }
+    }
+    assert_int_equal(n_misses, 4);
+
+    pubkey_cache_reset();
+    assert_false(pubkey_cache_get(root1, 3, 2, 0, &has_wildcard, out_chain_code, out_pubkey));
+}
+
+static void test_taproot_key_cache(void **state) {
+    (void) state;
+
+    uint8_t root1[32], root2[32];
+    memset(root1, 0x11, 32);
+    memset(root2, 0x22, 32);
+
+    uint8_t output_key[32];
+    memset(output_key, 0xAA, 32);
+
+    uint8_t out_output_key[32];
+
+    taproot_key_cache_reset();
+
+    assert_false(taproot_key_cache_get(root1, 1, 0, 0, 7, out_output_key));
+
+    taproot_key_cache_add(root1, 1, 0, 0, 7, output_key);
+    assert_true(taproot_key_cache_get(root1, 1, 0, 0, 7, out_output_key));
+    assert_memory_equal(out_output_key, output_key, 32);
+
+    // any difference in the identifier of the key is a miss
+    assert_false(taproot_key_cache_get(root2, 1, 0, 0, 7, out_output_key));
+    assert_false(taproot_key_cache_get(root1, 2, 0, 0, 7, out_output_key));
+    assert_false(taproot_key_cache_get(root1, 1, 1, 0, 7, out_output_key));
+    assert_false(taproot_key_cache_get(root1, 1, 0, 1, 7, out_output_key));
+    assert_false(taproot_key_cache_get(root1, 1, 0, 0, 8, out_output_key));
+
+    // empty trees are never added
+    taproot_key_cache_add(root2, 0, 0, 0, 0, output_key);
+    assert_false(taproot_key_cache_get(root2, 0, 0, 0, 0, out_output_key));
+
+    taproot_key_cache_reset();
+    assert_false(taproot_key_cache_get(root1, 1, 0, 0, 7, out_output_key));
+}
+
+static void test_private_node_cache(void **state) {
+    (void) state;
+
+    const uint32_t path1[] = {0x80000054, 0x80000001, 0x80000000, 0};
+    const uint32_t path2[] = {0x80000054, 0x80000001, 0x80000000, 1};
+
+    uint8_t private_key[32], chain_code[32], pubkey[33];
+    memset(private_key, 0x11, 32);
+    memset(chain_code, 0xCC, 32);
+    memset(pubkey, 0x02, 33);
+
+    uint8_t out_private_key[32], out_chain_code[32], out_pubkey[33];
+
+    private_node_cache_reset();
+
+    assert_false(private_node_cache_get(path1, 4, out_private_key, out_chain_code, out_pubkey));
+
+    private_node_cache_add(path1, 4, private_key, chain_code, pubkey);
+    assert_true(private_node_cache_get(path1, 4, out_private_key, out_chain_code, out_pubkey));
+    assert_memory_equal(out_private_key, private_key, 32);
+    assert_memory_equal(out_chain_code, chain_code, 32);
+    assert_memory_equal(out_pubkey, pubkey, 33);
+
+    // any difference in the path is a miss
+    assert_false(private_node_cache_get(path2, 4, out_private_key, out_chain_code, out_pubkey));
+    assert_false(private_node_cache_get(path1, 3, out_private_key, out_chain_code, out_pubkey));
+
+    // too long paths are not cached
+    uint32_t long_path[MAX_BIP32_PATH_STEPS + 1] = {0};
+    private_node_cache_add(long_path, MAX_BIP32_PATH_STEPS + 1, private_key, chain_code, pubkey);
+    assert_false(private_node_cache_get(long_path,
+                                        MAX_BIP32_PATH_STEPS + 1,
+                                        out_private_key,
+                                        out_chain_code,
+                                        out_pubkey));
+
+    // the inputs are signed with the keys of the receive addresses, then of the change addresses:
+    // each parent node is only derived once
+    private_node_cache_reset();
+    int n_misses = 0;
+    for (int input = 0; input < 20; input++) {
+        const uint32_t *parent = input < 10 ? path1 : path2;
+        if (!private_node_cache_get(parent, 4, out_private_key, out_chain_code, out_pubkey)) {
+            ++n_misses;
+            private_node_cache_add(parent, 4, private_key, chain_code, pubkey);
+        }
+    }
+    assert_int_equal(n_misses, 2);
+
+    // the private keys are wiped
+    private_node_cache_reset();
+    assert_false(private_node_cache_get(path2, 4, out_private_key, out_chain_code, out_pubkey));
+}
+
+static void test_tweaked_key_cache(void **state) {
+    (void) state;
+
+    const uint32_t path1[] = {0x80000056, 0x80000001, 0x80000000, 0, 3};
+    const uint32_t path2[] = {0x80000056, 0x80000001, 0x80000000, 0, 4};
+
+    uint8_t root1[32], root2[32];
+    memset(root1, 0x11, 32);
+    memset(root2, 0x22, 32);
+
+    uint8_t seckey[32], other_seckey[32];
+    memset(seckey, 0x5E, 32);
+    memset(other_seckey, 0x6F, 32);
+
+    uint8_t out[32];
+
+    tweaked_key_cache_reset();
+
+    assert_false(tweaked_key_cache_get(path1, 5, NULL, out));
+
+    tweaked_key_cache_add(path1, 5, NULL, seckey);
+    assert_true(tweaked_key_cache_get(path1, 5, NULL, out));
+    assert_memory_equal(out, seckey, 32);
+
+    // the path and the Merkle root identify the key
+    assert_false(tweaked_key_cache_get(path2, 5, NULL, out));
+    assert_false(tweaked_key_cache_get(path1, 4, NULL, out));
+    assert_false(tweaked_key_cache_get(path1, 5, root1, out));
+
+    tweaked_key_cache_add(path1, 5, root1, other_seckey);
+    assert_true(tweaked_key_cache_get(path1, 5, root1, out));
+    assert_memory_equal(out, other_seckey, 32);
+    assert_false(tweaked_key_cache_get(path1, 5, root2, out));
+    assert_true(tweaked_key_cache_get(path1, 5, NULL, out));
+    assert_memory_equal(out, seckey, 32);
+
+    // a Merkle root of zeros is not the absence of a taptree
+    uint8_t zero_root[32] = {0};
+    assert_false(tweaked_key_cache_get(path2, 5, zero_root, out));
+    tweaked_key_cache_add(path2, 5, NULL, seckey);
+    assert_false(tweaked_key_cache_get(path2, 5, zero_root, out));
+
+    // too long paths are not cached
+    uint32_t long_path[MAX_BIP32_PATH_STEPS + 1] = {0};
+    tweaked_key_cache_add(long_path, MAX_BIP32_PATH_STEPS + 1, NULL, seckey);
+    assert_false(tweaked_key_cache_get(long_path, MAX_BIP32_PATH_STEPS + 1, NULL, out));
+
+    // the tweaked keys are wiped
+    tweaked_key_cache_reset();
+    assert_false(tweaked_key_cache_get(path1, 5, NULL, out));
+}
+
+/*
+  The caches of the keys derived from the seed, kept while the device is unlocked.
+*/
+
+static void test_xpub_cache(void **state) {
+    (void) state;
+
+    const uint32_t path1[] = {0x8000002C, 0x80000001, 0x80000000};
+    const uint32_t path2[] = {0x80000054, 0x80000001, 0x80000000};
+
+    uint8_t parent_fingerprint[4] = {0x01, 0x02, 0x03, 0x04};
+    uint8_t chain_code[32], pubkey[33];
+    memset(chain_code, 0xCC, 32);
+    memset(pubkey, 0x02, 33);
+
+    uint8_t out_parent_fingerprint[4], out_chain_code[32], out_pubkey[33];
+    uint32_t fingerprint;
+
+    xpub_cache_reset();
+
+    assert_false(xpub_cache_get_master_fingerprint(&fingerprint));
+    xpub_cache_set_master_fingerprint(0xf5acc2fd);
+    assert_true(xpub_cache_get_master_fingerprint(&fingerprint));
+    assert_int_equal(fingerprint, 0xf5acc2fd);
+
+    assert_false(xpub_cache_get(path1, 3, out_parent_fingerprint, out_chain_code, out_pubkey));
+
+    xpub_cache_add(path1, 3, parent_fingerprint, chain_code, pubkey);
+    assert_true(xpub_cache_get(path1, 3, out_parent_fingerprint, out_chain_code, out_pubkey));
+    assert_memory_equal(out_parent_fingerprint, parent_fingerprint, 4);
+    assert_memory_equal(out_chain_code, chain_code, 32);
+    assert_memory_equal(out_pubkey, pubkey, 33);
+
+    // any difference in the path is a miss
+    assert_false(xpub_cache_get(path2, 3, out_parent_fingerprint, out_chain_code, out_pubkey));
+    assert_false(xpub_cache_get(path1, 2, out_parent_fingerprint, out_chain_code, out_pubkey));
+
+    // the empty path is a valid path
+    xpub_cache_add(path1, 0, parent_fingerprint, chain_code, pubkey);
+    assert_true(xpub_cache_get(path2, 0, out_parent_fingerprint, out_chain_code, out_pubkey));
+
+    // too long paths are not cached
+    uint32_t long_path[MAX_BIP32_PATH_STEPS + 1] = {0};
+    xpub_cache_add(long_path, MAX_BIP32_PATH_STEPS + 1, parent_fingerprint, chain_code, pubkey);
+    assert_false(xpub_cache_get(long_path,
+                                MAX_BIP32_PATH_STEPS + 1,
+                                out_parent_fingerprint,
+                                out_chain_code,
+                                out_pubkey));
+
+    // both the master fingerprint and the xpubs are wiped
+    xpub_cache_reset();
+    assert_false(xpub_cache_get_master_fingerprint(&fingerprint));
+    assert_false(xpub_cache_get(path1, 3, out_parent_fingerprint, out_chain_code, out_pubkey));
+}
+
+static void test_get_standard_account_path(void **state) {
+    (void) state;
+
+    uint32_t path[MAX_STANDARD_ACCOUNT_PATH_LEN];
+
+    assert_int_equal(get_standard_account_path(0, 1, path), 3);
+    assert_memory_equal(path, ((uint32_t[]){H + 84, H + 1, H + 0}), 3 * sizeof(uint32_t));
+
+    assert_int_equal(get_standard_account_path(1, 0, path), 3);
+    assert_memory_equal(path, ((uint32_t[]){H + 49, H + 0, H + 0}), 3 * sizeof(uint32_t));
+
+    assert_int_equal(get_standard_account_path(2, 0, path), 3);
+    assert_memory_equal(path, ((uint32_t[]){H + 86, H + 0, H + 0}), 3 * sizeof(uint32_t));
+
+    assert_int_equal(get_standard_account_path(3, 0, path), 4);
+    assert_memory_equal(path, ((uint32_t[]){H + 48, H + 0, H + 0, H + 2}), 4 * sizeof(uint32_t));
+}
+
+static uint8_t account_parent_fingerprint[4] = {0x01, 0x02, 0x03, 0x04};
+static uint8_t account_chain_code[32], account_pubkey[33];
+
+static bool add_account_xpub(const uint32_t path[], size_t path_len) {
+    return account_xpub_cache_add(path,
+                                  path_len,
+                                  account_parent_fingerprint,
+                                  account_chain_code,
+                                  account_pubkey);
+}
+
+static bool get_account_xpub(const uint32_t path[], size_t path_len) {
+    uint8_t out_fingerprint[4], out_chain_code[32], out_pubkey[33];
+    if (!account_xpub_cache_get(path, path_len, out_fingerprint, out_chain_code, out_pubkey)) {
+        return false;
+    }
+    assert_memory_equal(out_fingerprint, account_parent_fingerprint, 4);
+    assert_memory_equal(out_chain_code, account_chain_code, 32);
+    assert_memory_equal(out_pubkey, account_pubkey, 33);
+    return true;
+}
+
+static void test_account_xpub_cache(void **state) {
+    (void) state;
+
+    const uint32_t wpkh_main[] = {H + 84, H + 0, H + 0};
+    const uint32_t wpkh_test[] = {H + 84, H + 1, H + 0};
+    const uint32_t wsh_main[] = {H + 48, H + 0, H + 0, H + 2};
+    const uint32_t sh_wsh_main[] = {H + 48, H + 0, H + 0, H + 1};
+    const uint32_t wpkh_account_1[] = {H + 84, H + 0, H + 1};
+    const uint32_t wpkh_address[] = {H + 84, H + 0, H + 0, 0, 0};
+
+    memset(account_chain_code, 0xCC, 32);
+    memset(account_pubkey, 0x02, 33);
+
+    account_xpub_cache_reset();
+
+    assert_false(get_account_xpub(wpkh_main, 3));
+    assert_true(add_account_xpub(wpkh_main, 3));
+    assert_true(get_account_xpub(wpkh_main, 3));
+
+    // a different coin type is a miss, and replaces the entry of the same standard account
+    assert_false(get_account_xpub(wpkh_test, 3));
+    assert_true(add_account_xpub(wpkh_test, 3));
+    assert_true(get_account_xpub(wpkh_test, 3));
+    assert_false(get_account_xpub(wpkh_main, 3));
+
+    // other standard accounts have their own entry
+    assert_true(add_account_xpub(wsh_main, 4));
+    assert_true(get_account_xpub(wsh_main, 4));
+    assert_true(get_account_xpub(wpkh_test, 3));
+
+    // the other paths are not cached
+    assert_false(add_account_xpub(sh_wsh_main, 4));
+    assert_false(add_account_xpub(wpkh_account_1, 3));
+    assert_false(add_account_xpub(wpkh_address, 5));
+    assert_false(add_account_xpub(wsh_main, 3));
+    assert_false(get_account_xpub(sh_wsh_main, 4));
+    assert_false(get_account_xpub(wsh_main, 3));
+
+    // GET_ACCOUNT_XPUBS, repeated by a software wallet at each connection, derives each standard
+    // account only once
+    account_xpub_cache_reset();
+    int n_misses = 0;
+    for (int connection = 0; connection < 5; connection++) {
+        for (size_t i = 0; i < N_STANDARD_ACCOUNTS; i++) {
+            uint32_t path[MAX_STANDARD_ACCOUNT_PATH_LEN];
+            size_t path_len = get_standard_account_path(i, 1, path);
+            if (!get_account_xpub(path, path_len)) {
+                ++n_misses;
+                assert_true(add_account_xpub(path, path_len));
+            }
+        }
+    }
+    assert_int_equal(n_misses, N_STANDARD_ACCOUNTS);
+
+    account_xpub_cache_reset();
+    assert_false(get_account_xpub(wpkh_test, 3));
+    assert_false(get_account_xpub(wsh_main, 4));
+}
+
+static void test_symmetric_key_cache(void **state) {
+    (void) state;
+
+    const char label1[] = "\0LEDGER-Wallet policy";
+    const char label2[] = "\0LEDGER-Other label";
+
+    uint8_t key1[32], key2[32], out_key[32];
+    memset(key1, 0x11, 32);
+    memset(key2, 0x22, 32);
+
+    symmetric_key_cache_reset();
+
+    assert_false(symmetric_key_cache_get(label1, sizeof(label1) - 1, out_key));
+
+    symmetric_key_cache_set(label1, sizeof(label1) - 1, key1);
+    assert_true(symmetric_key_cache_get(label1, sizeof(label1) - 1, out_key));
+    assert_memory_equal(out_key, key1, 32);
+
+    // any difference in the label is a miss
+    assert_false(symmetric_key_cache_get(label1, sizeof(label1) - 2, out_key));
+    assert_false(symmetric_key_cache_get(label2, sizeof(label2) - 1, out_key));
+
+    // a new key replaces the previous one
+    symmetric_key_cache_set(label2, sizeof(label2) - 1, key2);
+    assert_false(symmetric_key_cache_get(label1, sizeof(label1) - 1, out_key));
+    assert_true(symmetric_key_cache_get(label2, sizeof(label2) - 1, out_key));
+    assert_memory_equal(out_key, key2, 32);
+
+    // too long labels are not cached
+    char long_label[SYMMETRIC_KEY_CACHE_MAX_LABEL_LEN + 1] = {0};
+    symmetric_key_cache_set(long_label, sizeof(long_label), key1);
+    assert_false(symmetric_key_cache_get(long_label, sizeof(long_label), out_key));
+    assert_true(symmetric_key_cache_get(label2, sizeof(label2) - 1, out_key));
+
+    symmetric_key_cache_reset();
+    assert_false(symmetric_key_cache_get(label2, sizeof(label2) - 1, out_key));
+}
+
+/*
+  The caches of the verified wallet policies, and of their keys information.
+*/
+
+static void test_wallet_cache(void **state) {
+    (void) state;
+
+    uint8_t id1[32], id2[32], hmac1[32], hmac2[32];
+    memset(id1, 0x11, 32);
+    memset(id2, 0x22, 32);
+    memset(hmac1, 0xA1, 32);
+    memset(hmac2, 0xA2, 32);
+
+    policy_map_wallet_header_t header1;
+    memset(&header1, 0, sizeof(header1));
+    header1.n_keys = 3;
+
+    wallet_cache_reset();
+
+    assert_null(wallet_cache_get(id1, hmac1));
+
+    wallet_cache_add(id1, hmac1, &header1);
+    const policy_map_wallet_header_t *found = wallet_cache_get(id1, hmac1);
+    assert_non_null(found);
+    assert_memory_equal(found, &header1, sizeof(header1));
+
+    // the hmac must match the verified one
+    assert_null(wallet_cache_get(id1, hmac2));
+    uint8_t hmac_zero[32] = {0};
+    assert_null(wallet_cache_get(id1, hmac_zero));
+    assert_null(wallet_cache_get(id2, hmac1));
+
+    // nor does adding the same wallet with another hmac replace the verified one
+    wallet_cache_add(id1, hmac2, &header1);
+    assert_null(wallet_cache_get(id1, hmac2));
+    assert_non_null(wallet_cache_get(id1, hmac1));
+
+    wallet_cache_reset();
+    assert_null(wallet_cache_get(id1, hmac1));
+}
+
+static void test_key_info_cache(void **state) {
+    (void) state;
+
+    uint8_t root1[32], root2[32];
+    memset(root1, 0x11, 32);
+    memset(root2, 0x22, 32);
+
+    policy_map_key_info_t key_info, key_info_str;
+    memset(&key_info, 0, sizeof(key_info));
+    memset(&key_info_str, 0, sizeof(key_info_str));
+
+    key_info.is_binary = 1;
+    key_info.has_wildcard = 1;
+    key_info.has_key_origin = 1;
+    memcpy(key_info.master_key_fingerprint, "\xf5\xac\xc2\xfd", 4);
+    key_info.master_key_derivation_len = 3;
+    key_info.master_key_derivation[0] = 0x80000030;
+    key_info.master_key_derivation[1] = 0x80000001;
+    key_info.master_key_derivation[2] = 0x80000000;
+    memset(key_info.serialized_ext_pubkey, 0xA1, sizeof(key_info.serialized_ext_pubkey));
+
+    policy_map_key_info_t found;
+
+    key_info_cache_reset();
+
+    assert_false(key_info_cache_get(root1, 3, 0, &found));
+
+    key_info_cache_add(root1, 3, 0, &key_info);
+    assert_true(key_info_cache_get(root1, 3, 0, &found));
+    assert_memory_equal(&found, &key_info, sizeof(key_info));
+
+    // the root, the size and the index must all match
+    assert_false(key_info_cache_get(root2, 3, 0, &found));
+    assert_false(key_info_cache_get(root1, 4, 0, &found));
+    assert_false(key_info_cache_get(root1, 3, 1, &found));
+
+    // only keys in binary form are cached
+    key_info_cache_add(root1, 3, 1, &key_info_str);
+    assert_false(key_info_cache_get(root1, 3, 1, &found));
+
+    // SIGN_PSBT looks up all the keys of the wallet for each input and output: a wallet policy
+    // with as many keys as the cache fetches each of them once
+    key_info_cache_reset();
+    int n_misses = 0;
+    for (int script = 0; script < 10; script++) {
+        for (uint32_t i = 0; i < KEY_INFO_CACHE_SIZE; i++) {
+            if (!key_info_cache_get(root2, KEY_INFO_CACHE_SIZE, i, &found)) {
+                ++n_misses;
+                key_info_cache_add(root2, KEY_INFO_CACHE_SIZE, i, &key_info);
+            }
+        }
+    }
+    assert_int_equal(n_misses, KEY_INFO_CACHE_SIZE);
+
+    key_info_cache_reset();
+    assert_false(key_info_cache_get(root2, KEY_INFO_CACHE_SIZE, 0, &found));
+}
+
+/*
+  The caches of the verified parts of the Merkle trees of the client.
+*/
+
+static void test_merkle_get_ancestor_first_leaf(void **state) {
+    (void) state;
+
+    // the root always has first leaf 0
+    assert_int_equal(merkle_get_ancestor_first_leaf(5, 3, 0), 0);
+    assert_int_equal(merkle_get_ancestor_first_leaf(5, 4, 0), 0);
+
+    // tree with 5 leaves: the left subtree has leaves 0-3, the right subtree is leaf 4
+    assert_int_equal(merkle_get_ancestor_first_leaf(5, 3, 1), 0);
+    assert_int_equal(merkle_get_ancestor_first_leaf(5, 4, 1), 4);
+    assert_int_equal(merkle_get_ancestor_first_leaf(5, 3, 2), 2);
+    assert_int_equal(merkle_get_ancestor_first_leaf(5, 1, 2), 0);
+    assert_int_equal(merkle_get_ancestor_first_leaf(5, 3, 3), 3);
+
+    // leaf 4 is at level 1
+    assert_int_equal(merkle_get_ancestor_first_leaf(5, 4, 2), -1);
+    // leaf 3 is at level 3
+    assert_int_equal(merkle_get_ancestor_first_leaf(5, 3, 4), -1);
+
+    // invalid leaf index
+    assert_int_equal(merkle_get_ancestor_first_leaf(5, 5, 0), -1);
+}
+
+static void test_merkle_cache(void **state) {
+    (void) state;
+
+    uint8_t root1[32], root2[32], hash[32];
+    memset(root1, 0x11, 32);
+    memset(root2, 0x22, 32);
+
+    merkle_cache_reset();
+
+    assert_null(merkle_cache_get(root1, 5, 1, 0));
+
+    memset(hash, 0xAA, 32);
+    merkle_cache_add(root1, 5, 1, 0, hash);
+
+    const uint8_t *cached = merkle_cache_get(root1, 5, 1, 0);
+    assert_non_null(cached);
+    assert_memory_equal(cached, hash, 32);
+
+    // any difference in the identifier of the node is a miss
+    assert_null(merkle_cache_get(root2, 5, 1, 0));
+    assert_null(merkle_cache_get(root1, 6, 1, 0));
+    assert_null(merkle_cache_get(root1, 5, 2, 0));
+    assert_null(merkle_cache_get(root1, 5, 1, 4));
+
+    // the leaves do not replace the internal nodes
+    for (int i = 0; i < MERKLE_CACHE_NODE_SLOTS - 1; i++) {
+        merkle_cache_add(root2, 1000, 3, 16 * i, hash);
+    }
+    for (int i = 0; i < 2 * MERKLE_CACHE_SIZE; i++) {
+        merkle_cache_add(root2, 100, 7, i, hash);
+    }
+    assert_non_null(merkle_cache_get(root1, 5, 1, 0));
+    assert_null(merkle_cache_get(root2, 100, 7, 0));
+    assert_non_null(merkle_cache_get(root2, 100, 7, 2 * MERKLE_CACHE_SIZE - 1));
+
+    // the oldest internal node is replaced once their slots are full
+    merkle_cache_add(root2, 1000, 3, 16 * MERKLE_CACHE_NODE_SLOTS, hash);
+    assert_null(merkle_cache_get(root1, 5, 1, 0));
+    assert_non_null(merkle_cache_get(root2, 1000, 3, 16 * MERKLE_CACHE_NODE_SLOTS));
+
+    merkle_cache_reset();
+    assert_null(merkle_cache_get(root2, 1000, 3, 0));
+}
+
+// Like the passes of sign_psbt over the inputs: the leaves of a large tree are visited once each, in
+// order, interleaved with the same leaf of a small tree.
+static void test_merkle_cache_sequential_leaves(void **state) {
+    (void) state;
+
+    uint8_t root[32], small_root[32], hash[32];
+    memset(root, 0x11, 32);
+    memset(small_root, 0x22, 32);
+    memset(hash, 0xAA, 32);
+
+    merkle_cache_reset();
+
+    const uint32_t size = 300;
+    int node_misses = 0;
+    for (uint32_t i = 0; i < size; i++) {
+        for (uint8_t level = 1; level <= MERKLE_CACHE_MAX_LEVEL; level++) {
+            uint32_t first_leaf = (uint32_t) merkle_get_ancestor_first_leaf(size, i, level);
+            if (merkle_cache_get(root, size, level, first_leaf) == NULL) {
+                ++node_misses;
+                merkle_cache_add(root, size, level, first_leaf, hash);
+            }
+        }
+        // the level of a leaf is the length of its proof
+        uint8_t leaf_level = MERKLE_CACHE_MAX_LEVEL;
+        while (merkle_get_ancestor_first_leaf(size, i, leaf_level + 1) >= 0) {
+            ++leaf_level;
+        }
+        merkle_cache_add(root, size, leaf_level, i, hash);
+
+        if (merkle_cache_get(small_root, 7, 3, 2) == NULL) {
+            merkle_cache_add(small_root, 7, 3, 2, hash);
+        }
+    }
+
+    // each of the 2 + 4 + 8 internal nodes of the first levels is only fetched once
+    assert_int_equal(node_misses, 14);
+}
+
+static void test_sorted_tree_cache(void **state) {
+    (void) state;
+
+    uint8_t root1[32], root2[32];
+    memset(root1, 0x11, 32);
+    memset(root2, 0x22, 32);
+
+    sorted_tree_cache_reset();
+
+    assert_false(sorted_tree_cache_contains(root1, 5));
+
+    sorted_tree_cache_add(root1, 5);
+    assert_true(sorted_tree_cache_contains(root1, 5));
+
+    // both the root and the size identify the tree
+    assert_false(sorted_tree_cache_contains(root2, 5));
+    assert_false(sorted_tree_cache_contains(root1, 6));
+
+    // empty trees are never added
+    sorted_tree_cache_add(root2, 0);
+    assert_false(sorted_tree_cache_contains(root2, 0));
+
+    sorted_tree_cache_reset();
+    assert_false(sorted_tree_cache_contains(root1, 5));
+}
+
+static merkleized_map_commitment_t make_map(uint64_t size, uint8_t fill) {
+    merkleized_map_commitment_t map;
+    map.size = size;
+    memset(map.keys_root, fill, 32);
+    memset(map.values_root, fill + 1, 32);
+    return map;
+}
+
+static void test_map_commitment_cache(void **state) {
+    (void) state;
+
+    uint8_t root1[32], root2[32];
+    memset(root1, 0x11, 32);
+    memset(root2, 0x22, 32);
+
+    merkleized_map_commitment_t map1 = make_map(3, 0xAA);
+    merkleized_map_commitment_t out;
+
+    map_commitment_cache_reset();
+
+    assert_false(map_commitment_cache_get(root1, 5, 2, &out));
+
+    map_commitment_cache_add(root1, 5, 2, &map1);
+    assert_true(map_commitment_cache_get(root1, 5, 2, &out));
+    assert_memory_equal(&out, &map1, sizeof(map1));
+
+    // the root, the size and the index identify the leaf
+    assert_false(map_commitment_cache_get(root2, 5, 2, &out));
+    assert_false(map_commitment_cache_get(root1, 6, 2, &out));
+    assert_false(map_commitment_cache_get(root1, 5, 3, &out));
+
+    // leaves outside of the tree are never added
+    map_commitment_cache_add(root2, 0, 0, &map1);
+    map_commitment_cache_add(root2, 4, 4, &map1);
+    assert_false(map_commitment_cache_get(root2, 0, 0, &out));
+    assert_false(map_commitment_cache_get(root2, 4, 4, &out));
+
+    // the slot of a leaf is given by its index: a leaf of another tree replaces it
+    map_commitment_cache_add(root2, 100, 2 + MAP_COMMITMENT_CACHE_SIZE, &map1);
+    assert_false(map_commitment_cache_get(root1, 5, 2, &out));
+    assert_true(map_commitment_cache_get(root2, 100, 2 + MAP_COMMITMENT_CACHE_SIZE, &out));
+    assert_memory_equal(&out, &map1, sizeof(map1));
+
+    // an earlier leaf of the same tree does not
+    merkleized_map_commitment_t map2 = make_map(4, 0xBB);
+    map_commitment_cache_add(root2, 100, 2, &map2);
+    assert_false(map_commitment_cache_get(root2, 100, 2, &out));
+    assert_true(map_commitment_cache_get(root2, 100, 2 + MAP_COMMITMENT_CACHE_SIZE, &out));
+
+    // nor the same leaf again
+    map_commitment_cache_add(root2, 100, 2 + MAP_COMMITMENT_CACHE_SIZE, &map2);
+    assert_true(map_commitment_cache_get(root2, 100, 2 + MAP_COMMITMENT_CACHE_SIZE, &out));
+    assert_memory_equal(&out, &map1, sizeof(map1));
+
+    map_commitment_cache_reset();
+    assert_false(map_commitment_cache_get(root2, 100, 0, &out));
+}
+
+// Visits the maps of a tree by index like SIGN_PSBT, from first_index, adding the ones that are not
+// in the cache; returns the number of hits.
+static int visit_maps(const uint8_t root[static 32], uint32_t n_maps, uint32_t first_index) {
+    int n_hits = 0;
+    for (uint32_t i = first_index; i < n_maps; i++) {
+        merkleized_map_commitment_t map = make_map(i, (uint8_t) i), out;
+        if (map_commitment_cache_get(root, n_maps, i, &out)) {
+            assert_memory_equal(&out, &map, sizeof(map));
+            ++n_hits;
+        } else {
+            map_commitment_cache_add(root, n_maps, i, &map);
+        }
+    }
+    return n_hits;
+}
+
+static void test_map_commitment_cache_many_maps(void **state) {
+    (void) state;
+
+    uint8_t root[32];
+    memset(root, 0x33, 32);
+
+    // the inputs are visited when they are processed, then when they are signed, where the first
+    // SIGN_PSBT_INPUT_RECORDS ones are signed from their records, without fetching their map
+    const uint32_t n_records = 16;
+    const uint32_t n_inputs[] = {MAP_COMMITMENT_CACHE_SIZE, 17, 40, 300};
+    for (size_t i = 0; i < sizeof(n_inputs) / sizeof(n_inputs[0]); i++) {
+        map_commitment_cache_reset();
+        assert_int_equal(visit_maps(root, n_inputs[i], 0), 0);
+
+        // the last MAP_COMMITMENT_CACHE_SIZE inputs are still cached, whatever their number
+        uint32_t n_signed = n_inputs[i] > n_records ? n_inputs[i] - n_records : 0;
+        uint32_t n_expected = n_signed < MAP_COMMITMENT_CACHE_SIZE ? n_signed
+                                                                   : MAP_COMMITMENT_CACHE_SIZE;
+        assert_int_equal(visit_maps(root, n_inputs[i], n_records), n_expected);
+
+        // and a new visit from the first input, as in a later SIGN_PSBT of the same psbt, finds
+        // the same ones
+        assert_int_equal(visit_maps(root, n_inputs[i], 0), MAP_COMMITMENT_CACHE_SIZE);
+    }
+}
+
+/*
+  The cache of the rendered addresses.
+*/
+
+static void test_address_cache(void **state) {
+    (void) state;
+
+    uint8_t script1[22] = {0x00, 0x14};
+    uint8_t script2[22] = {0x00, 0x14};
+    memset(script1 + 2, 0x11, 20);
+    memset(script2 + 2, 0x22, 20);
+
+    const char address[] = "bc1qzyg3zyg3zyg3zyg3zyg3zyg3zyg3zyg3zzyenx";
+    char out[ADDRESS_CACHE_MAX_ADDRESS_LEN + 1];
+
+    address_cache_reset();
+
+    assert_int_equal(address_cache_get(script1, sizeof(script1), out, sizeof(out)), -1);
+
+    address_cache_add(script1, sizeof(script1), address, strlen(address));
+    assert_int_equal(address_cache_get(script1, sizeof(script1), out, sizeof(out)),
+                     strlen(address));
+    assert_string_equal(out, address);
+
+    // any difference in the script is a miss
+    assert_int_equal(address_cache_get(script2, sizeof(script2), out, sizeof(out)), -1);
+    assert_int_equal(address_cache_get(script1, sizeof(script1) - 1, out, sizeof(out)), -1);
+
+    // the output buffer must also fit the terminating null character
+    assert_int_equal(address_cache_get(script1, sizeof(script1), out, strlen(address)), -1);
+
+    // scripts and addresses that are too long are not added
+    uint8_t long_script[ADDRESS_CACHE_MAX_SCRIPT_LEN + 1] = {0};
+    address_cache_add(long_script, sizeof(long_script), address, strlen(address));
+    assert_int_equal(address_cache_get(long_script, sizeof(long_script), out, sizeof(out)), -1);
+
+    char long_address[ADDRESS_CACHE_MAX_ADDRESS_LEN + 1];
+    memset(long_address, 'a', sizeof(long_address));
+    address_cache_add(script2, sizeof(script2), long_address, sizeof(long_address));
+    assert_int_equal(address_cache_get(script2, sizeof(script2), out, sizeof(out)), -1);
+
+    // nor is the empty script
+    address_cache_add(script1, 0, address, strlen(address));
+    assert_int_equal(address_cache_get(script1, 0, out, sizeof(out)), -1);
+
+    address_cache_reset();
+    assert_int_equal(address_cache_get(script1, sizeof(script1), out, sizeof(out)), -1);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {cmocka_unit_test(test_cache),
+                                       cmocka_unit_test(test_cache_slots),
+                                       cmocka_unit_test(test_pubkey_cache),
+                                       cmocka_unit_test(test_taproot_key_cache),
+                                       cmocka_unit_test(test_private_node_cache),
+                                       cmocka_unit_test(test_tweaked_key_cache),
+                                       cmocka_unit_test(test_xpub_cache),
+                                       cmocka_unit_test(test_get_standard_account_path),
+                                       cmocka_unit_test(test_account_xpub_cache),
+                                       cmocka_unit_test(test_symmetric_key_cache),
+                                       cmocka_unit_test(test_wallet_cache),
+                                       cmocka_unit_test(test_key_info_cache),
+                                       cmocka_unit_test(test_merkle_get_ancestor_first_leaf),
+                                       cmocka_unit_test(test_merkle_cache),
+                                       cmocka_unit_test(test_merkle_cache_sequential_leaves),
+                                       cmocka_unit_test(test_sorted_tree_cache),
+                                       cmocka_unit_test(test_map_commitment_cache),
+                                       cmocka_unit_test(test_map_commitment_cache_many_maps),
+                                       cmocka_unit_test(test_address_cache)};
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,69 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "cxram_stash.h"
+
+static void test_cxram_alloc(void **state) {
+    (void) state;
+
+    cxram_reset();
+
+    uint8_t *base = get_cxram_buffer();
+
+    uint8_t *a = cxram_alloc(3);
+    assert_ptr_equal(a, base);
+
+    // allocations are word-aligned
+    uint8_t *b = cxram_alloc(8);
+    assert_ptr_equal(b, base + 4);
+    assert_int_equal(cxram_mark(), 12);
+
+    // the whole remaining space can be allocated, but not more
+    assert_null(cxram_alloc(CXRAM_STASH_SIZE - 12 + 1));
+    uint8_t *c = cxram_alloc(CXRAM_STASH_SIZE - 12);
+    assert_ptr_equal(c, base + 12);
+    assert_null(cxram_alloc(1));
+
+    cxram_reset();
+    assert_int_equal(cxram_mark(), 0);
+    assert_ptr_equal(cxram_alloc(CXRAM_STASH_SIZE), base);
+    cxram_reset();
+}
+
+static void test_cxram_release(void **state) {
+    (void) state;
+
+    cxram_reset();
+
+    uint8_t *base = get_cxram_buffer();
+
+    assert_non_null(cxram_alloc(16));
+    cxram_mark_t mark = cxram_mark();
+
+    assert_non_null(cxram_alloc(100));
+    assert_non_null(cxram_alloc(200));
+
+    // everything allocated after the mark is freed, and can be allocated again
+    cxram_release(mark);
+    assert_int_equal(cxram_mark(), 16);
+    assert_ptr_equal(cxram_alloc(4), base + 16);
+
+    // releasing again to the same mark does nothing
+    cxram_release(mark);
+    assert_int_equal(cxram_mark(), 16);
+
+    cxram_reset();
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {cmocka_unit_test(test_cxram_alloc),
+                                       cmocka_unit_test(test_cxram_release)};
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -4,6 +4,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 
 #include <cmocka.h>
 
@@ -50,6 +53,60 @@ static void test_format_u64(void **state) {
     assert_false(format_u64(temp, sizeof(temp) - 5, value));
 }
 
+// digit by digit, with 64-bit divisions (the textbook algorithm), used as a reference
+static void reference_format_u64(char *out, uint64_t in) {
+    char digits[20];
+    size_t count = 0;
+    do {
+        digits[count++] = '0' + in % 10;
+        in /= 10;
+    } while (in != 0);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = digits[count - 1 - i];
+    }
+    out[count] = '\0';
+}
+
+static void test_format_u64_limbs(void **state) {
+    (void) state;
+
+    // around the boundaries of the limbs of 9 digits, and of 32-bit values
+    const uint64_t values[] = {9ull,
+                               10ull,
+                               999999999ull,
+                               1000000000ull,
+                               1000000001ull,
+                               4294967295ull,
+                               4294967296ull,
+                               999999999999999999ull,
+                               1000000000000000000ull,
+                               1000000000000000001ull,
+                               10000000000000000000ull,
+                               18446744073709551615ull};
+
+    char temp[21];
+    char expected[21];
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        reference_format_u64(expected, values[i]);
+        assert_true(format_u64(temp, sizeof(temp), values[i]));
+        assert_string_equal(temp, expected);
+
+        // exactly the room for the digits and the terminator
+        assert_true(format_u64(temp, strlen(expected) + 1, values[i]));
+        assert_false(format_u64(temp, strlen(expected), values[i]));
+    }
+
+    srand(42);
+    for (int iter = 0; iter < 10000; iter++) {
+        uint64_t value = ((uint64_t) rand() << 42) ^ ((uint64_t) rand() << 21) ^ (uint64_t) rand();
+        value >>= rand() % 64;
+
+        reference_format_u64(expected, value);
+        assert_true(format_u64(temp, sizeof(temp), value));
+        assert_string_equal(temp, expected);
+    }
+}
+
 static void test_format_fpu64(void **state) {
     (void) state;
 
@@ -60,6 +117,12 @@ static void test_format_fpu64(void **state) {
     assert_true(format_fpu64(temp, sizeof(temp), amount, 8));
     assert_string_equal(temp, "1.00000000");  // BTC
 
+    // the result is terminated, even if the buffer is not zeroed
+    amount = 12345678000ull;  // satoshi
+    memset(temp, 'x', sizeof(temp));
+    assert_true(format_fpu64(temp, sizeof(temp), amount, 8));
+    assert_string_equal(temp, "123.45678000");  // BTC
+
     amount = 24964823ull;  // satoshi
     memset(temp, 0, sizeof(temp));
     assert_true(format_fpu64(temp, sizeof(temp), amount, 8));
@@ -82,6 +145,39 @@ static void test_format_fpu64(void **state) {
     assert_false(format_fpu64(temp2, sizeof(temp2) - 20, amount, 18));
 }
 
+#define BENCHMARK_ITERATIONS 200000
+
+// Not a pass/fail test: prints the time spent formatting amounts with the limb-based and the
+// reference implementations. On the host, 64-bit divisions are native, so the gain on the device
+// (where each of them is a call to libgcc) is larger.
+static void test_format_u64_benchmark(void **state) {
+    (void) state;
+
+    char temp[21];
+    volatile size_t sink = 0;
+
+    clock_t start = clock();
+    for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        format_u64(temp, sizeof(temp), 2099999997690000ull - (uint64_t) i * 9973);
+        sink += strlen(temp);
+    }
+    clock_t limbs_time = clock() - start;
+
+    start = clock();
+    for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        reference_format_u64(temp, 2099999997690000ull - (uint64_t) i * 9973);
+        sink -= strlen(temp);
+    }
+    clock_t reference_time = clock() - start;
+
+    assert_int_equal(sink, 0);
+
+    printf("format_u64, %d iterations: limbs %.3f s, reference %.3f s\n",
+           BENCHMARK_ITERATIONS,
+           (double) limbs_time / CLOCKS_PER_SEC,
+           (double) reference_time / CLOCKS_PER_SEC);
+}
+
 static void test_format_hex(void **state) {
     (void) state;
 
@@ -98,8 +194,10 @@ static void test_format_hex(void **state) {
 int main() {
     const struct CMUnitTest tests[] = {cmocka_unit_test(test_format_i64),
                                        cmocka_unit_test(test_format_u64),
+                                       cmocka_unit_test(test_format_u64_limbs),
                                        cmocka_unit_test(test_format_fpu64),
-                                       cmocka_unit_test(test_format_hex)};
+                                       cmocka_unit_test(test_format_hex),
+                                       cmocka_unit_test(test_format_u64_benchmark)};
 
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
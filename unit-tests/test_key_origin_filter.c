@@ -0,0 +1,65 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "common/key_origin_filter.h"
+
+#define H 0x80000000u
+
+static void test_key_origin_filter_bit(void **state) {
+    (void) state;
+
+    const uint32_t path[] = {48 ^ H, 1 ^ H, 0 ^ H, 2 ^ H};
+
+    // exactly one bit, always the same
+    key_origin_filter_t bit = key_origin_filter_bit(0xf5acc2fd, path, 4);
+    assert_int_not_equal(bit, 0);
+    assert_int_equal(bit & (bit - 1), 0);
+    assert_int_equal(key_origin_filter_bit(0xf5acc2fd, path, 4), bit);
+
+    // the empty path is a valid key origin
+    key_origin_filter_t root_bit = key_origin_filter_bit(0xf5acc2fd, NULL, 0);
+    assert_int_not_equal(root_bit, 0);
+    assert_int_equal(root_bit & (root_bit - 1), 0);
+}
+
+static void test_key_origin_filter_may_contain(void **state) {
+    (void) state;
+
+    const uint32_t path_1[] = {84 ^ H, 1 ^ H, 0 ^ H};
+    const uint32_t path_2[] = {48 ^ H, 1 ^ H, 0 ^ H, 2 ^ H};
+
+    key_origin_filter_t filter = 0;
+    filter |= key_origin_filter_bit(0xf5acc2fd, path_1, 3);
+    filter |= key_origin_filter_bit(0x12345678, path_2, 4);
+
+    // no false negatives
+    assert_true(key_origin_filter_may_contain(filter, 0xf5acc2fd, path_1, 3));
+    assert_true(key_origin_filter_may_contain(filter, 0x12345678, path_2, 4));
+
+    // the empty filter contains nothing, the KEY_ORIGIN_FILTER_ANY filter contains everything
+    assert_false(key_origin_filter_may_contain(0, 0xf5acc2fd, path_1, 3));
+    assert_true(key_origin_filter_may_contain(KEY_ORIGIN_FILTER_ANY, 0xdeadbeef, path_2, 2));
+
+    // most of the other origins are ruled out: with 2 bits set, about 1 in 8 is a false positive
+    int n_false_positives = 0;
+    for (uint32_t account = 0; account < 1000; account++) {
+        const uint32_t path[] = {84 ^ H, 1 ^ H, (account + 1) ^ H};
+        if (key_origin_filter_may_contain(filter, 0xf5acc2fd, path, 3)) {
+            ++n_false_positives;
+        }
+    }
+    assert_true(n_false_positives < 250);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {cmocka_unit_test(test_key_origin_filter_bit),
+                                       cmocka_unit_test(test_key_origin_filter_may_contain)};
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,331 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <cmocka.h>
+
+#include "cx_ram.h"
+
+#include "common/merkle.h"
+
+#include "merkle_vectors.h"
+
+#define BENCHMARK_ITERATIONS 2000
+
+union cx_u G_cx;
+
+// the hash functions of the SDK are mocked in mock_sha256.c
+
+// The original O(log^2 n) implementation of merkle_get_ith_direction, used as a reference.
+static int reference_get_ith_direction(size_t size, size_t index, size_t i) {
+    if (size <= 1 || index >= size) {
+        return -1;
+    }
+
+    size_t n_directions = 0;
+    while (size > 1) {
+        uint8_t depth = 0;
+        for (size_t t = 1; t < size; t *= 2) {
+            ++depth;
+        }
+
+        // number of leaves of the left subtree
+        size_t mask = (size_t) 1 << (depth - 1);
+
+        int is_right_child = (index & mask) != 0 ? 1 : 0;
+        if (n_directions == i) {
+            return is_right_child;
+        }
+        ++n_directions;
+
+        if (is_right_child) {
+            size -= mask;
+            index -= mask;
+        } else {
+            size = mask;
+        }
+    }
+
+    return -1;
+}
+
+// Computes the proof of the leaf with the given index in a tree with the given leaf hashes,
+// from the lowest level. Returns the length of the proof.
+static size_t compute_proof(const uint8_t (*leaves)[32],
+                            size_t n_leaves,
+                            size_t index,
+                            uint8_t (*proof)[32]) {
+    if (n_leaves <= 1) {
+        return 0;
+    }
+
+    size_t n_left = 1 << (ceil_lg(n_leaves) - 1);
+    size_t len;
+    if (index < n_left) {
+        len = compute_proof(leaves, n_left, index, proof);
+        merkle_compute_root(leaves + n_left, n_leaves - n_left, proof[len]);
+    } else {
+        len = compute_proof(leaves + n_left, n_leaves - n_left, index - n_left, proof);
+        merkle_compute_root(leaves, n_left, proof[len]);
+    }
+    return len + 1;
+}
+
+static void test_merkle_combine_hashes(void **state) {
+    (void) state;
+
+    uint8_t left[32], right[32], out[32];
+    memset(left, 0x01, 32);
+    memset(right, 0x02, 32);
+
+    // sha256(0x01 | left | right)
+    const uint8_t expected[32] = {0xb3, 0x31, 0xda, 0x6e, 0xc4, 0x9d, 0x45, 0x47, 0xd9, 0x94, 0x2a,
+                                  0x67, 0x27, 0xe5, 0x12, 0x3f, 0x69, 0xbe, 0xd5, 0xa0, 0xb9, 0x7a,
+                                  0xc1, 0x71, 0xcf, 0xbf, 0xd6, 0x20, 0x14, 0x31, 0xfc, 0xfa};
+
+    merkle_combine_hashes(left, right, out);
+    assert_memory_equal(out, expected, 32);
+
+    // the output can overlap the inputs
+    merkle_combine_hashes(left, right, left);
+    assert_memory_equal(left, expected, 32);
+}
+
+static void test_merkle_compute_root(void **state) {
+    (void) state;
+
+    uint8_t leaves[11][32], root[32];
+    for (int i = 0; i < 11; i++) {
+        memset(leaves[i], i, 32);
+    }
+
+    const uint8_t expected[32] = {0x26, 0x03, 0x48, 0xc7, 0x8b, 0xf3, 0x20, 0xf7, 0x11, 0x55, 0x91,
+                                  0xde, 0x47, 0x34, 0x01, 0x83, 0xed, 0x51, 0x3f, 0x2f, 0x2d, 0x85,
+                                  0xac, 0xa0, 0xec, 0x10, 0x62, 0x2e, 0xf0, 0xa6, 0xd8, 0x37};
+
+    merkle_compute_root((const uint8_t(*)[32]) leaves, 11, root);
+    assert_memory_equal(root, expected, 32);
+}
+
+static void test_merkle_climb_proof(void **state) {
+    (void) state;
+
+    uint8_t leaves[11][32], root[32];
+    for (int i = 0; i < 11; i++) {
+        memset(leaves[i], i, 32);
+    }
+    merkle_compute_root((const uint8_t(*)[32]) leaves, 11, root);
+
+    for (size_t index = 0; index < 11; index++) {
+        uint8_t proof[MAX_MERKLE_TREE_DEPTH][32];
+        size_t proof_len = compute_proof((const uint8_t(*)[32]) leaves, 11, index, proof);
+
+        uint32_t directions;
+        assert_int_equal(merkle_get_directions(11, index, &directions), proof_len);
+
+        // the whole proof at once
+        uint8_t cur_hash[32];
+        memcpy(cur_hash, leaves[index], 32);
+        assert_int_equal(merkle_climb_proof(cur_hash, proof[0], proof_len, directions, proof_len),
+                         0);
+        assert_memory_equal(cur_hash, root, 32);
+
+        // the proof in two parts
+        for (size_t n_first = 0; n_first <= proof_len; n_first++) {
+            memcpy(cur_hash, leaves[index], 32);
+            assert_int_equal(
+                merkle_climb_proof(cur_hash, proof[0], n_first, directions, proof_len),
+                0);
+            assert_int_equal(merkle_climb_proof(cur_hash,
+                                                proof[n_first],
+                                                proof_len - n_first,
+                                                directions,
+                                                proof_len - n_first),
+                             0);
+            assert_memory_equal(cur_hash, root, 32);
+        }
+
+        // a proof longer than the path to the root
+        memcpy(cur_hash, leaves[index], 32);
+        assert_int_equal(
+            merkle_climb_proof(cur_hash, proof[0], proof_len, directions, proof_len - 1),
+            -1);
+
+        // a wrong level results in a wrong root
+        if (proof_len > 1) {
+            memcpy(cur_hash, leaves[index], 32);
+            merkle_climb_proof(cur_hash, proof[0], proof_len - 1, directions, proof_len - 1);
+            assert_true(memcmp(cur_hash, root, 32) != 0);
+        }
+    }
+}
+
+static void test_merkle_get_directions(void **state) {
+    (void) state;
+
+    uint32_t directions;
+    assert_int_equal(merkle_get_directions(1, 0, &directions), 0);
+    assert_int_equal(merkle_get_directions(5, 5, &directions), -1);
+
+    // tree with 5 leaves: the left subtree has leaves 0-3, the right subtree is leaf 4
+    assert_int_equal(merkle_get_directions(5, 4, &directions), 1);
+    assert_int_equal(directions, 0x1);
+    assert_int_equal(merkle_get_directions(5, 2, &directions), 3);
+    assert_int_equal(directions, 0x2);
+
+    // random trees, compared with the reference implementation
+    srand(54);
+    for (int k = 0; k < 1000; k++) {
+        // sizes up to 2^31, with many small trees
+        size_t size = 1 + ((size_t) rand() % 0x7FFFFFFF) % ((size_t) 1 << (rand() % 32));
+        size_t index = (size_t) rand() % size;
+
+        int n_directions = merkle_get_directions(size, index, &directions);
+        assert_true(n_directions >= 0 && n_directions <= MAX_MERKLE_TREE_DEPTH);
+        for (int i = 0; i <= n_directions; i++) {
+            int expected = reference_get_ith_direction(size, index, i);
+            assert_int_equal(merkle_get_ith_direction(size, index, i), expected);
+            if (i < n_directions) {
+                assert_int_equal((directions >> i) & 1, expected);
+            } else {
+                assert_int_equal(expected, -1);
+            }
+        }
+    }
+}
+
+static void test_merkle_tree_shape(void **state) {
+    (void) state;
+
+    merkle_tree_shape_t shape;
+    merkle_tree_shape_init(&shape, 11);
+    assert_int_equal(shape.depth, 4);
+    assert_int_equal(shape.right_edge_mask, 10);
+
+    // all the leaves of the small trees, and the first and last leaves of the largest ones, with
+    // the same shape for all the paths of a tree
+    for (uint32_t size = 1; size <= 300; size++) {
+        merkle_tree_shape_init(&shape, size);
+        for (uint32_t index = 0; index <= size; index++) {
+            uint32_t directions;
+            int n_directions = merkle_shape_get_directions(&shape, index, &directions);
+            for (int i = 0; i <= n_directions; i++) {
+                int expected = reference_get_ith_direction(size, index, i);
+                assert_int_equal(i < n_directions ? (int) ((directions >> i) & 1) : -1, expected);
+            }
+            if (index == size) {
+                assert_int_equal(n_directions, -1);
+            }
+        }
+    }
+    const uint32_t large_sizes[] = {0x80000000, 0x80000001, 0xAAAAAAAB, 0xFFFFFFFF};
+    for (size_t k = 0; k < sizeof(large_sizes) / sizeof(large_sizes[0]); k++) {
+        merkle_tree_shape_init(&shape, large_sizes[k]);
+        const uint32_t indexes[] = {0, large_sizes[k] / 3, large_sizes[k] - 2, large_sizes[k] - 1};
+        for (size_t l = 0; l < sizeof(indexes) / sizeof(indexes[0]); l++) {
+            uint32_t directions;
+            int n_directions = merkle_shape_get_directions(&shape, indexes[l], &directions);
+            assert_true(n_directions > 0 && n_directions <= 32);
+            for (int i = 0; i <= n_directions; i++) {
+                int expected = reference_get_ith_direction(large_sizes[k], indexes[l], i);
+                assert_int_equal(i < n_directions ? (int) ((directions >> i) & 1) : -1, expected);
+            }
+        }
+    }
+}
+
+// cross-check with the proofs produced by MerkleTree.prove_leaf in the Python client
+static void test_merkle_python_vectors(void **state) {
+    (void) state;
+
+    for (size_t k = 0; k < sizeof(merkle_vectors) / sizeof(merkle_vectors[0]); k++) {
+        const merkle_vector_t *v = &merkle_vectors[k];
+
+        uint32_t directions;
+        assert_int_equal(merkle_get_directions(v->size, v->index, &directions), v->proof_len);
+        assert_int_equal(directions, v->directions);
+
+        // the Python proofs start from the leaf
+        uint8_t cur_hash[32];
+        memcpy(cur_hash, v->leaf, 32);
+        assert_int_equal(
+            merkle_climb_proof(cur_hash, v->proof[0], v->proof_len, directions, v->proof_len),
+            0);
+        assert_memory_equal(cur_hash, v->root, 32);
+    }
+}
+
+static void test_merkle_climb_proof_benchmark(void **state) {
+    (void) state;
+
+    // a proof of depth 31, for the last leaf of a tree with 2^31 leaves
+    const size_t tree_size = (size_t) 1 << (MAX_MERKLE_TREE_DEPTH - 1);
+    const size_t index = tree_size - 1;
+    const size_t depth = MAX_MERKLE_TREE_DEPTH - 1;
+
+    uint8_t siblings[MAX_MERKLE_TREE_DEPTH][32];
+    for (size_t i = 0; i < depth; i++) {
+        memset(siblings[i], (int) (i * 7 + 3), 32);
+    }
+
+    uint8_t leaf[32], kernel_root[32], reference_root[32];
+    memset(leaf, 0x42, 32);
+
+    clock_t start = clock();
+    for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        memcpy(kernel_root, leaf, 32);
+        uint32_t directions;
+        assert_int_equal(merkle_get_directions(tree_size, index, &directions), depth);
+        assert_int_equal(merkle_climb_proof(kernel_root, siblings[0], depth, directions, depth), 0);
+    }
+    clock_t kernel_time = clock() - start;
+
+    // reference: the direction computed separately for each level, and a separate
+    // init/update/final cycle for each level, with one update for each part of the node
+    start = clock();
+    for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        memcpy(reference_root, leaf, 32);
+        for (size_t j = 0; j < depth; j++) {
+            int direction = reference_get_ith_direction(tree_size, index, depth - j - 1);
+            const uint8_t *left = direction == 0 ? reference_root : siblings[j];
+            const uint8_t *right = direction == 0 ? siblings[j] : reference_root;
+            uint8_t prefix = 0x01, node[64];
+            memcpy(node, left, 32);
+            memcpy(node + 32, right, 32);
+
+            cx_sha256_t hash;
+            cx_sha256_init_no_throw(&hash);
+            cx_hash_no_throw(&hash.header, 0, &prefix, 1, NULL, 0);
+            cx_hash_no_throw(&hash.header, 0, node, 32, NULL, 0);
+            cx_hash_no_throw(&hash.header, 0, node + 32, 32, NULL, 0);
+            cx_hash_no_throw(&hash.header, CX_LAST, NULL, 0, reference_root, 32);
+        }
+    }
+    clock_t reference_time = clock() - start;
+
+    assert_memory_equal(kernel_root, reference_root, 32);
+
+    printf("merkle proof of depth %zu, %d iterations: kernel %.3f s, reference %.3f s\n",
+           depth,
+           BENCHMARK_ITERATIONS,
+           (double) kernel_time / CLOCKS_PER_SEC,
+           (double) reference_time / CLOCKS_PER_SEC);
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {cmocka_unit_test(test_merkle_combine_hashes),
+                                       cmocka_unit_test(test_merkle_compute_root),
+                                       cmocka_unit_test(test_merkle_climb_proof),
+                                       cmocka_unit_test(test_merkle_get_directions),
+                                       cmocka_unit_test(test_merkle_tree_shape),
+                                       cmocka_unit_test(test_merkle_python_vectors),
+                                       cmocka_unit_test(test_merkle_climb_proof_benchmark)};
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
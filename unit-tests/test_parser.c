@@ -4,10 +4,13 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
 
 #include <cmocka.h>
 
 #include "common/parser.h"
+#include "common/varint.h"
 
 // An example parser that reads an uint32_t, an array of 8 bytes, and an uint8_t.
 typedef struct {
@@ -307,6 +310,186 @@ static void test_parser_error(void **state) {
     assert_int_equal(parser_state.a, 0xa0a1a2a3);  // a should have been parsed correctly
 }
 
+static void test_dbuffer_read_chunk(void **state) {
+    (void) state;
+
+    uint8_t store[32] = {0, 0, 0xa0, 0xa1, 0xa2};
+    uint8_t stream[32] = {0xb0, 0xb1, 0xb2, 0xb3};
+
+    buffer_t store_buf = buffer_create(store, 5);
+    buffer_seek_cur(&store_buf, 2);  // skip initial zeros
+    buffer_t stream_buf = buffer_create(stream, 4);
+    buffer_t *buffers[2] = {&store_buf, &stream_buf};
+
+    const uint8_t *chunk = NULL;
+
+    // a chunk never spans both buffers
+    assert_int_equal(dbuffer_read_chunk(buffers, 5, &chunk), 3);
+    assert_ptr_equal(chunk, &store[2]);
+
+    assert_int_equal(dbuffer_read_chunk(buffers, 0, &chunk), 0);
+
+    assert_int_equal(dbuffer_read_chunk(buffers, 2, &chunk), 2);
+    assert_ptr_equal(chunk, &stream[0]);
+
+    assert_int_equal(dbuffer_read_chunk(buffers, 5, &chunk), 2);
+    assert_ptr_equal(chunk, &stream[2]);
+
+    // both buffers are exhausted
+    assert_int_equal(dbuffer_read_chunk(buffers, 1, &chunk), 0);
+    assert_int_equal(store_buf.offset, 5);
+    assert_int_equal(stream_buf.offset, 4);
+}
+
+static void test_dbuffer_read_spans(void **state) {
+    (void) state;
+
+    uint8_t store[32] = {0, 0, 0xa0, 0xa1, 0xa2};
+    uint8_t stream[32] = {0xb0, 0xb1, 0xb2, 0xb3};
+
+    buffer_t store_buf = buffer_create(store, 5);
+    buffer_seek_cur(&store_buf, 2);  // skip initial zeros
+    buffer_t stream_buf = buffer_create(stream, 4);
+    buffer_t *buffers[2] = {&store_buf, &stream_buf};
+
+    const uint8_t *spans[2];
+    size_t spans_len[2];
+
+    // entirely in the first buffer
+    assert_true(dbuffer_read_spans(buffers, 2, spans, spans_len));
+    assert_ptr_equal(spans[0], &store[2]);
+    assert_int_equal(spans_len[0], 2);
+    assert_int_equal(spans_len[1], 0);
+
+    // spanning both buffers
+    assert_true(dbuffer_read_spans(buffers, 3, spans, spans_len));
+    assert_ptr_equal(spans[0], &store[4]);
+    assert_int_equal(spans_len[0], 1);
+    assert_ptr_equal(spans[1], &stream[0]);
+    assert_int_equal(spans_len[1], 2);
+
+    // not enough data, nothing is consumed
+    assert_false(dbuffer_read_spans(buffers, 3, spans, spans_len));
+    assert_int_equal(store_buf.offset, 5);
+    assert_int_equal(stream_buf.offset, 2);
+
+    // entirely in the second buffer
+    assert_true(dbuffer_read_spans(buffers, 2, spans, spans_len));
+    assert_int_equal(spans_len[0], 0);
+    assert_ptr_equal(spans[1], &stream[2]);
+    assert_int_equal(spans_len[1], 2);
+    assert_int_equal(stream_buf.offset, 4);
+}
+
+// Reads a varint one part at a time, as dbuffer_read_varint does when the varint straddles the two
+// buffers; used as the reference for the benchmark of the fast path.
+static bool reference_dbuffer_read_varint(buffer_t *buffers[2], uint64_t *out) {
+    uint8_t first_byte;
+    if (!dbuffer_read_u8(buffers, &first_byte)) {
+        return false;
+    }
+
+    uint8_t len = varint_prefix_extra_len(first_byte);
+    uint8_t data[8] = {0};
+    if (!dbuffer_read_bytes(buffers, data, len)) {
+        return false;
+    }
+
+    *out = len == 0 ? first_byte : 0;
+    for (int i = len - 1; i >= 0; i--) {
+        *out = *out << 8 | data[i];
+    }
+    return true;
+}
+
+static void test_dbuffer_read_varint(void **state) {
+    (void) state;
+
+    // 0x12, 0x3456, 0x789abcde, 0x0102030405060708
+    uint8_t data[] = {0x12, 0xfd, 0x56, 0x34, 0xfe, 0xde, 0xbc, 0x9a, 0x78, 0xff,
+                      0x08, 0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01};
+    const uint64_t expected[] = {0x12, 0x3456, 0x789abcde, 0x0102030405060708ULL};
+
+    // try every split of the data between the two buffers
+    for (size_t split = 0; split <= sizeof(data); split++) {
+        buffer_t store = buffer_create(data, split);
+        buffer_t stream = buffer_create(data + split, sizeof(data) - split);
+        buffer_t *buffers[2] = {&store, &stream};
+
+        for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+            uint64_t value;
+            assert_true(dbuffer_read_varint(buffers, &value));
+            assert_int_equal(value, expected[i]);
+        }
+        uint64_t value;
+        assert_false(dbuffer_read_varint(buffers, &value));
+    }
+
+    // truncated varint: nothing is consumed
+    buffer_t store = buffer_create(data + 9, 4);
+    buffer_t stream = buffer_create(data + 13, 3);
+    buffer_t *buffers[2] = {&store, &stream};
+    uint64_t value;
+    assert_false(dbuffer_read_varint(buffers, &value));
+    assert_int_equal(store.offset, 0);
+    assert_int_equal(stream.offset, 0);
+}
+
+#define BENCHMARK_ITERATIONS 2000
+
+// Not a pass/fail test: prints the time spent reading a stream of varints with dbuffer_read_varint
+// and with the reference implementation that reads them one part at a time. The ratio is only
+// indicative of the gain on the device.
+static void test_dbuffer_read_varint_benchmark(void **state) {
+    (void) state;
+
+    // mostly 1-byte varints, as in the counts and script lengths of a transaction
+    uint8_t data[1024];
+    size_t len = 0, n_varints = 0;
+    while (len + 9 <= sizeof(data)) {
+        uint64_t value = n_varints % 8 == 7 ? 0x100 + n_varints : n_varints % 0xfd;
+        len += varint_write(data, len, value);
+        n_varints++;
+    }
+
+    volatile uint64_t sink = 0;
+    uint64_t fast_sum = 0, reference_sum = 0;
+
+    clock_t start = clock();
+    for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        buffer_t store = buffer_create(NULL, 0);
+        buffer_t stream = buffer_create(data, len);
+        buffer_t *buffers[2] = {&store, &stream};
+        uint64_t value;
+        while (dbuffer_read_varint(buffers, &value)) {
+            fast_sum += value;
+        }
+    }
+    clock_t fast_time = clock() - start;
+
+    start = clock();
+    for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        buffer_t store = buffer_create(NULL, 0);
+        buffer_t stream = buffer_create(data, len);
+        buffer_t *buffers[2] = {&store, &stream};
+        uint64_t value;
+        while (reference_dbuffer_read_varint(buffers, &value)) {
+            reference_sum += value;
+        }
+    }
+    clock_t reference_time = clock() - start;
+
+    assert_int_equal(fast_sum, reference_sum);
+    sink += fast_sum;
+    (void) sink;
+
+    printf("dbuffer read %zu varints, %d iterations: fast path %.3f s, reference %.3f s\n",
+           n_varints,
+           BENCHMARK_ITERATIONS,
+           (double) fast_time / CLOCKS_PER_SEC,
+           (double) reference_time / CLOCKS_PER_SEC);
+}
+
 int main() {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_parser_init_context),
@@ -316,6 +499,10 @@ int main() {
         cmocka_unit_test(test_parser_stream_ends),
         cmocka_unit_test(test_parser_continue_partial),
         cmocka_unit_test(test_parser_error),
+        cmocka_unit_test(test_dbuffer_read_chunk),
+        cmocka_unit_test(test_dbuffer_read_spans),
+        cmocka_unit_test(test_dbuffer_read_varint),
+        cmocka_unit_test(test_dbuffer_read_varint_benchmark),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -0,0 +1,118 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <cmocka.h>
+
+#include "common/segwit_addr.h"
+
+typedef struct {
+    const char *hrp;
+    int version;
+    const char *program_hex;
+    const char *address;
+} segwit_addr_vector_t;
+
+// from BIP-173 and BIP-350
+static const segwit_addr_vector_t vectors[] = {
+    {"bc", 0, "751e76e8199196d454941c45d1b3a323f1433bd6", "bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4"},
+    {"tb",
+     0,
+     "1863143c14c5166804bd19203356da136c985678cd4d27a1b8c6329604903262",
+     "tb1qrp33g0q5c5txsp9arysrx4k6zdkfs4nce4xj0gdcccefvpysxf3q0sl5k7"},
+    {"bc",
+     1,
+     "79be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798",
+     "bc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqzk5jj0"},
+};
+
+static size_t parse_hex(const char *hex, uint8_t *out) {
+    size_t len = strlen(hex) / 2;
+    for (size_t i = 0; i < len; i++) {
+        unsigned int byte;
+        sscanf(hex + 2 * i, "%2x", &byte);
+        out[i] = (uint8_t) byte;
+    }
+    return len;
+}
+
+static void test_segwit_addr_encode(void **state) {
+    (void) state;
+
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        uint8_t program[40];
+        size_t program_len = parse_hex(vectors[i].program_hex, program);
+
+        char address[73 + 2 + 1];
+        assert_int_equal(
+            segwit_addr_encode(address, vectors[i].hrp, vectors[i].version, program, program_len),
+            1);
+        assert_string_equal(address, vectors[i].address);
+    }
+}
+
+static void test_segwit_addr_encode_from_state(void **state) {
+    (void) state;
+
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        uint8_t program[40];
+        size_t program_len = parse_hex(vectors[i].program_hex, program);
+
+        uint32_t hrp_state;
+        assert_int_equal(bech32_hrp_state(vectors[i].hrp, &hrp_state), 1);
+
+        char address[73 + 2 + 1];
+        assert_int_equal(segwit_addr_encode_from_state(address,
+                                                       vectors[i].hrp,
+                                                       hrp_state,
+                                                       vectors[i].version,
+                                                       program,
+                                                       program_len),
+                         1);
+        assert_string_equal(address, vectors[i].address);
+    }
+
+    // upper case characters are not valid in the hrp of an encoding
+    uint32_t hrp_state;
+    assert_int_equal(bech32_hrp_state("Bc", &hrp_state), 0);
+}
+
+static void test_segwit_addr_decode(void **state) {
+    (void) state;
+
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        uint8_t expected_program[40];
+        size_t expected_program_len = parse_hex(vectors[i].program_hex, expected_program);
+
+        int version;
+        uint8_t program[40];
+        size_t program_len;
+        assert_int_equal(
+            segwit_addr_decode(&version, program, &program_len, vectors[i].hrp, vectors[i].address),
+            1);
+        assert_int_equal(version, vectors[i].version);
+        assert_int_equal(program_len, expected_program_len);
+        assert_memory_equal(program, expected_program, program_len);
+
+        // any change in a character breaks the checksum
+        char corrupted[91];
+        strcpy(corrupted, vectors[i].address);
+        size_t pos = strlen(corrupted) - 10;
+        corrupted[pos] = corrupted[pos] == 'q' ? 'p' : 'q';
+        assert_int_equal(
+            segwit_addr_decode(&version, program, &program_len, vectors[i].hrp, corrupted),
+            0);
+    }
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {cmocka_unit_test(test_segwit_addr_encode),
+                                       cmocka_unit_test(test_segwit_addr_encode_from_state),
+                                       cmocka_unit_test(test_segwit_addr_decode)};
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,122 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "common/spending_policy.h"
+
+static spending_policy_t make_policy(uint64_t max_tx_amount, uint64_t max_session_amount) {
+    spending_policy_t policy;
+    memset(&policy, 0, sizeof(policy));
+    memset(policy.wallet_id, 0x11, 32);
+    memset(policy.destinations_root, 0x22, 32);
+    policy.n_destinations = 3;
+    policy.max_tx_amount = max_tx_amount;
+    policy.max_session_amount = max_session_amount;
+    return policy;
+}
+
+static void test_spending_policy_serialization(void **state) {
+    (void) state;
+
+    spending_policy_t policy = make_policy(100000, 250000);
+    uint8_t serialized[SPENDING_POLICY_LEN];
+    spending_policy_serialize(&policy, serialized);
+
+    assert_int_equal(serialized[0], SPENDING_POLICY_VERSION);
+    assert_memory_equal(serialized + 1, policy.wallet_id, 32);
+    assert_int_equal(serialized[33], 0xa0);  // 100000 = 0x0186a0, little-endian
+    assert_int_equal(serialized[34], 0x86);
+    assert_int_equal(serialized[35], 0x01);
+    assert_int_equal(serialized[49], 3);
+    assert_memory_equal(serialized + 53, policy.destinations_root, 32);
+
+    spending_policy_t parsed;
+    buffer_t buf = buffer_create(serialized, sizeof(serialized));
+    assert_true(spending_policy_parse(&buf, &parsed));
+    assert_memory_equal(parsed.wallet_id, policy.wallet_id, 32);
+    assert_memory_equal(parsed.destinations_root, policy.destinations_root, 32);
+    assert_int_equal(parsed.n_destinations, 3);
+    assert_int_equal(parsed.max_tx_amount, 100000);
+    assert_int_equal(parsed.max_session_amount, 250000);
+
+    // truncated, or with trailing data
+    buf = buffer_create(serialized, sizeof(serialized) - 1);
+    assert_false(spending_policy_parse(&buf, &parsed));
+    uint8_t longer[SPENDING_POLICY_LEN + 1] = {0};
+    memcpy(longer, serialized, sizeof(serialized));
+    buf = buffer_create(longer, sizeof(longer));
+    assert_false(spending_policy_parse(&buf, &parsed));
+
+    // unknown version
+    serialized[0] = SPENDING_POLICY_VERSION + 1;
+    buf = buffer_create(serialized, sizeof(serialized));
+    assert_false(spending_policy_parse(&buf, &parsed));
+
+    // too many destinations
+    policy.n_destinations = SPENDING_POLICY_MAX_DESTINATIONS + 1;
+    spending_policy_serialize(&policy, serialized);
+    buf = buffer_create(serialized, sizeof(serialized));
+    assert_false(spending_policy_parse(&buf, &parsed));
+
+    // a transaction can not spend more than a session
+    policy = make_policy(250001, 250000);
+    spending_policy_serialize(&policy, serialized);
+    buf = buffer_create(serialized, sizeof(serialized));
+    assert_false(spending_policy_parse(&buf, &parsed));
+}
+
+static void test_spending_session(void **state) {
+    (void) state;
+
+    spending_policy_t policy = make_policy(100000, 250000);
+    uint8_t id1[32], id2[32];
+    memset(id1, 0xA1, 32);
+    memset(id2, 0xA2, 32);
+
+    spending_session_reset();
+    assert_int_equal(spending_session_get_spent(id1), 0);
+
+    // over the limit of a transaction
+    assert_false(spending_session_charge(id1, &policy, 100001));
+    assert_int_equal(spending_session_get_spent(id1), 0);
+
+    assert_true(spending_session_charge(id1, &policy, 100000));
+    assert_true(spending_session_charge(id1, &policy, 100000));
+    assert_int_equal(spending_session_get_spent(id1), 200000);
+
+    // over the limit of the session
+    assert_false(spending_session_charge(id1, &policy, 50001));
+    assert_true(spending_session_charge(id1, &policy, 50000));
+    assert_false(spending_session_charge(id1, &policy, 1));
+    assert_int_equal(spending_session_get_spent(id1), 250000);
+
+    // each spending policy has its own total
+    assert_int_equal(spending_session_get_spent(id2), 0);
+    assert_true(spending_session_charge(id2, &policy, 0));
+
+    // the entries are never replaced
+    uint8_t id[32];
+    for (int i = 2; i < SPENDING_SESSION_SIZE; i++) {
+        memset(id, i, 32);
+        assert_true(spending_session_charge(id, &policy, 1));
+    }
+    memset(id, 0xFF, 32);
+    assert_false(spending_session_charge(id, &policy, 1));
+    assert_false(spending_session_charge(id1, &policy, 1));
+
+    spending_session_reset();
+    assert_int_equal(spending_session_get_spent(id1), 0);
+    assert_true(spending_session_charge(id1, &policy, 1));
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {cmocka_unit_test(test_spending_policy_serialization),
+                                       cmocka_unit_test(test_spending_session)};
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
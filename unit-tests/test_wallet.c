@@ -161,6 +161,43 @@ static void test_parse_policy_map_multisig_3(void **state) {
     for (int i = 0; i < 5; i++) assert_int_equal(inner->key_indexes[i], i);
 }
 
+static void test_parse_policy_map_taproot_tree(void **state) {
+    (void) state;
+
+    uint8_t out[MAX_POLICY_MAP_MEMORY_SIZE];
+
+    int res;
+
+    char *policy = "tr(@0,{pk(@1),{pk(@2),pk(@0)}})";
+    buffer_t policy_buf = buffer_create((void *) policy, strlen(policy));
+
+    res = parse_policy_map(&policy_buf, out, sizeof(out));
+    assert_int_equal(res, 0);
+    policy_node_tr_t *root = (policy_node_tr_t *) out;
+
+    assert_int_equal(root->type, TOKEN_TR);
+    assert_int_equal(root->key_index, 0);
+    assert_false(root->tree->is_leaf);
+
+    policy_node_tree_t *left = root->tree->left_tree;
+    assert_true(left->is_leaf);
+    assert_int_equal(left->script->type, TOKEN_PK);
+    assert_int_equal(((policy_node_with_key_t *) left->script)->key_index, 1);
+
+    policy_node_tree_t *right = root->tree->right_tree;
+    assert_false(right->is_leaf);
+    assert_int_equal(((policy_node_with_key_t *) right->left_tree->script)->key_index, 2);
+    assert_int_equal(((policy_node_with_key_t *) right->right_tree->script)->key_index, 0);
+
+    // without tapscripts
+    policy = "tr(@0)";
+    policy_buf = buffer_create((void *) policy, strlen(policy));
+
+    res = parse_policy_map(&policy_buf, out, sizeof(out));
+    assert_int_equal(res, 0);
+    assert_null(((policy_node_tr_t *) out)->tree);
+}
+
 // convenience function to parse as one liners
 
 static int parse_policy(char *policy, size_t policy_len, uint8_t *out, size_t out_len) {
@@ -207,6 +244,559 @@ static void test_failures(void **state) {
     assert_true(0 > PARSE_POLICY("multi(@0,@1,@2,@3,@4)", out, sizeof(out)));
     assert_true(0 > PARSE_POLICY("multi(1)", out, sizeof(out)));
     assert_true(0 > PARSE_POLICY("multi(1,)", out, sizeof(out)));
+
+    // pk is only supported in the taproot tree of a tr or in miniscript, and only pk is supported
+    // in tapscripts
+    assert_true(0 > PARSE_POLICY("pk(@0)", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("sh(pk(@0))", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("tr(@0,pkh(@1))", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("tr(@0,multi(1,@1,@2))", out, sizeof(out)));
+
+    // tr can only be top-level
+    assert_true(0 > PARSE_POLICY("sh(tr(@0))", out, sizeof(out)));
+
+    // malformed or too deep taproot trees
+    assert_true(0 > PARSE_POLICY("tr(@0,)", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("tr(@0,{pk(@1)})", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("tr(@0,{pk(@1),pk(@2)", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("tr(@0,{pk(@1),{pk(@2),{pk(@3),pk(@4)}}})", out, sizeof(out)));
+
+    // miniscript is only supported inside wsh
+    assert_true(0 > PARSE_POLICY("sh(and_v(v:pk(@0),pk(@1)))", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("tr(@0,pk_k(@1))", out, sizeof(out)));
+
+    // miniscript with invalid types, or that does not require a signature
+    assert_true(0 > PARSE_POLICY("wsh(pk_k(@0))", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("wsh(older(144))", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("wsh(and_v(pk(@0),older(144)))", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("wsh(v:pk(@0))", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("wsh(c:pk(@0))", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("wsh(x:pk_k(@0))", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("wsh(thresh(2,pk(@0),pk(@1)))", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("wsh(thresh(1,pk(@0),s:pk(@1),a:older(10)))", out, sizeof(out)));
+
+    // malformed miniscript
+    assert_true(0 > PARSE_POLICY("wsh(and_v(v:pk(@0)))", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("wsh(and_v(v:pk(@0),pk(@1),pk(@2)))", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("wsh(thresh(0,pk(@0)))", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("wsh(thresh(2,pk(@0),s:pk(@1))", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("wsh(and_v(v:pk(@0),older(0)))", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("wsh(and_v(v:pk(@0),older(2147483648)))", out, sizeof(out)));
+    assert_true(0 > PARSE_POLICY("wsh(svc:pk(@0))", out, sizeof(out)));  // too many wrappers
+
+    // miniscript nested deeper than MAX_MINISCRIPT_DEPTH (with enough memory for its nodes)
+    uint8_t large_out[2 * MAX_POLICY_MAP_MEMORY_SIZE];
+    assert_int_equal(PARSE_POLICY("wsh(and_v(v:and_v(v:and_v(v:and_v(v:pk(@0),pk(@1)),pk(@2)),"
+                                  "pk(@3)),pk(@4)))",
+                                  large_out,
+                                  sizeof(large_out)),
+                     0);
+    assert_true(0 > PARSE_POLICY("wsh(and_v(v:and_v(v:and_v(v:and_v(v:and_v(v:pk(@0),pk(@1)),"
+                                 "pk(@2)),pk(@3)),pk(@4)),pk(@5)))",
+                                 large_out,
+                                 sizeof(large_out)));
+
+    // too many keys
+    assert_true(0 > PARSE_POLICY(
+                        "sortedmulti(1,@0,@1,@2,@3,@4,@5,@6,@7,@8,@9,@10,@11,@12,@13,@14,@15)",
+                        out,
+                        sizeof(out)));
+}
+static void test_parse_policy_map_miniscript(void **state) {
+    (void) state;
+
+    uint8_t out[MAX_POLICY_MAP_MEMORY_SIZE];
+
+    int res;
+
+    char *policy = "wsh(and_v(v:pk(@0),older(144)))";
+    buffer_t policy_buf = buffer_create((void *) policy, strlen(policy));
+
+    res = parse_policy_map(&policy_buf, out, sizeof(out));
+    assert_int_equal(res, 0);
+    policy_node_with_script_t *root = (policy_node_with_script_t *) out;
+    assert_int_equal(root->type, TOKEN_WSH);
+
+    policy_node_miniscript_t *and_v = (policy_node_miniscript_t *) root->script;
+    assert_int_equal(and_v->type, TOKEN_AND_V);
+    assert_int_equal(and_v->n_subs, 2);
+    assert_null(and_v->next);
+
+    // pk(@0) is c:pk_k(@0)
+    policy_node_miniscript_t *x = and_v->subs;
+    assert_int_equal(x->type, TOKEN_PK_K);
+    assert_memory_equal(x->wrappers, "vc", 2);
+    assert_int_equal(x->wrappers[2], 0);
+    assert_int_equal(x->arg, 0);
+
+    policy_node_miniscript_t *y = x->next;
+    assert_int_equal(y->type, TOKEN_OLDER);
+    assert_int_equal(y->arg, 144);
+    assert_null(y->next);
+
+    policy = "sh(wsh(thresh(2,pk(@0),s:pk(@1),s:pk(@2))))";
+    policy_buf = buffer_create((void *) policy, strlen(policy));
+
+    res = parse_policy_map(&policy_buf, out, sizeof(out));
+    assert_int_equal(res, 0);
+    policy_node_miniscript_t *thresh =
+        (policy_node_miniscript_t *) ((policy_node_with_script_t *) ((policy_node_with_script_t *)
+                                                                         out)
+                                          ->script)
+            ->script;
+    assert_int_equal(thresh->type, TOKEN_THRESH);
+    assert_int_equal(thresh->arg, 2);
+    assert_int_equal(thresh->n_subs, 3);
+    assert_int_equal(thresh->subs->next->next->arg, 2);
+    assert_memory_equal(thresh->subs->next->next->wrappers, "sc", 3);
+}
+
+static void test_compile_script_template_singlesig(void **state) {
+    (void) state;
+
+    uint8_t out[MAX_POLICY_MAP_MEMORY_SIZE];
+    uint8_t script_template[MAX_SCRIPT_TEMPLATE_LEN];
+
+    assert_int_equal(PARSE_POLICY("pkh(@0)", out, sizeof(out)), 0);
+    const uint8_t expected_pkh[] = {
+        0, 25, 11,                                               // script_len, ops_len
+        SCRIPT_TEMPLATE_OP_BYTES, 3, 0x76, 0xa9, 0x14,           // OP_DUP OP_HASH160 <20 bytes>
+        SCRIPT_TEMPLATE_OP_PUBKEY_HASH160, 0,                    // hash160(@0)
+        SCRIPT_TEMPLATE_OP_BYTES, 2, 0x88, 0xac                  // OP_EQUALVERIFY OP_CHECKSIG
+    };
+    int res =
+        compile_script_template((policy_node_t *) out, script_template, sizeof(script_template));
+    assert_int_equal(res, sizeof(expected_pkh));
+    assert_memory_equal(script_template, expected_pkh, sizeof(expected_pkh));
+
+    // the inner script comes first
+    assert_int_equal(PARSE_POLICY("sh(wpkh(@0))", out, sizeof(out)), 0);
+    const uint8_t expected_sh_wpkh[] = {
+        0, 22, 6,                                                // wpkh(@0)
+        SCRIPT_TEMPLATE_OP_BYTES, 2, 0x00, 0x14,
+        SCRIPT_TEMPLATE_OP_PUBKEY_HASH160, 0,
+        0, 23, 8,                                                // sh(...)
+        SCRIPT_TEMPLATE_OP_BYTES, 2, 0xa9, 0x14,
+        SCRIPT_TEMPLATE_OP_INNER_HASH160,
+        SCRIPT_TEMPLATE_OP_BYTES, 1, 0x87
+    };
+    res = compile_script_template((policy_node_t *) out, script_template, sizeof(script_template));
+    assert_int_equal(res, sizeof(expected_sh_wpkh));
+    assert_memory_equal(script_template, expected_sh_wpkh, sizeof(expected_sh_wpkh));
+
+    assert_int_equal(PARSE_POLICY("tr(@0)", out, sizeof(out)), 0);
+    const uint8_t expected_tr[] = {
+        0, 34, 6,
+        SCRIPT_TEMPLATE_OP_BYTES, 2, 0x51, 0x20,
+        SCRIPT_TEMPLATE_OP_TAPROOT_OUTPUT_KEY, 0
+    };
+    res = compile_script_template((policy_node_t *) out, script_template, sizeof(script_template));
+    assert_int_equal(res, sizeof(expected_tr));
+    assert_memory_equal(script_template, expected_tr, sizeof(expected_tr));
+}
+
+static void test_compile_script_template_multisig(void **state) {
+    (void) state;
+
+    uint8_t out[MAX_POLICY_MAP_MEMORY_SIZE];
+    uint8_t script_template[MAX_SCRIPT_TEMPLATE_LEN];
+
+    assert_int_equal(PARSE_POLICY("wsh(multi(1,@1,@0))", out, sizeof(out)), 0);
+    const uint8_t expected_wsh_multi[] = {
+        0, 1 + 34 * 2 + 2, 17,                                   // multi(1,@1,@0)
+        SCRIPT_TEMPLATE_OP_BYTES, 1, 0x51,
+        SCRIPT_TEMPLATE_OP_BYTES, 1, 0x21, SCRIPT_TEMPLATE_OP_PUBKEY, 1,
+        SCRIPT_TEMPLATE_OP_BYTES, 1, 0x21, SCRIPT_TEMPLATE_OP_PUBKEY, 0,
+        SCRIPT_TEMPLATE_OP_BYTES, 2, 0x52, 0xae,
+        0, 34, 5,                                                // wsh(...)
+        SCRIPT_TEMPLATE_OP_BYTES, 2, 0x00, 0x20,
+        SCRIPT_TEMPLATE_OP_INNER_SHA256
+    };
+    int res =
+        compile_script_template((policy_node_t *) out, script_template, sizeof(script_template));
+    assert_int_equal(res, sizeof(expected_wsh_multi));
+    assert_memory_equal(script_template, expected_wsh_multi, sizeof(expected_wsh_multi));
+
+    assert_int_equal(PARSE_POLICY("sh(wsh(sortedmulti(2,@0,@1,@2)))", out, sizeof(out)), 0);
+    const uint8_t expected_sh_wsh_sortedmulti[] = {
+        0, 1 + 34 * 3 + 2, 12,                                   // sortedmulti(2,@0,@1,@2)
+        SCRIPT_TEMPLATE_OP_BYTES, 1, 0x52,
+        SCRIPT_TEMPLATE_OP_SORTED_PUBKEYS, 3, 0, 1, 2,
+        SCRIPT_TEMPLATE_OP_BYTES, 2, 0x53, 0xae,
+        0, 34, 5,                                                // wsh(...)
+        SCRIPT_TEMPLATE_OP_BYTES, 2, 0x00, 0x20,
+        SCRIPT_TEMPLATE_OP_INNER_SHA256,
+        0, 23, 8,                                                // sh(...)
+        SCRIPT_TEMPLATE_OP_BYTES, 2, 0xa9, 0x14,
+        SCRIPT_TEMPLATE_OP_INNER_HASH160,
+        SCRIPT_TEMPLATE_OP_BYTES, 1, 0x87
+    };
+    res = compile_script_template((policy_node_t *) out, script_template, sizeof(script_template));
+    assert_int_equal(res, sizeof(expected_sh_wsh_sortedmulti));
+    assert_memory_equal(script_template,
+                        expected_sh_wsh_sortedmulti,
+                        sizeof(expected_sh_wsh_sortedmulti));
+
+    // the largest supported policy fits in MAX_SCRIPT_TEMPLATE_LEN bytes
+    assert_int_equal(
+        PARSE_POLICY("sh(wsh(multi(15,@0,@1,@2,@3,@4,@5,@6,@7,@8,@9,@10,@11,@12,@13,@14)))",
+                     out,
+                     sizeof(out)),
+        0);
+    res = compile_script_template((policy_node_t *) out, script_template, sizeof(script_template));
+    assert_true(res > 0);
+    // the script of the multi is longer than 255 bytes
+    assert_int_equal(script_template[0], (1 + 34 * 15 + 2) >> 8);
+    assert_int_equal(script_template[1], (1 + 34 * 15 + 2) & 0xFF);
+
+    // output buffer too short
+    res = compile_script_template((policy_node_t *) out, script_template, 20);
+    assert_int_equal(res, -1);
+}
+
+static void test_compile_script_template_taproot_tree(void **state) {
+    (void) state;
+
+    uint8_t out[MAX_POLICY_MAP_MEMORY_SIZE];
+    uint8_t script_template[MAX_SCRIPT_TEMPLATE_LEN];
+
+    assert_int_equal(PARSE_POLICY("tr(@0,{pk(@1),pk(@2)})", out, sizeof(out)), 0);
+    const uint8_t expected_tr_tree[] = {
+        0, 34, 30,
+        SCRIPT_TEMPLATE_OP_BYTES, 2, 0x51, 0x20,
+        SCRIPT_TEMPLATE_OP_TAPROOT_TREE_OUTPUT_KEY, 0, 23,       // internal key, tree length
+        TAPTREE_OP_LEAF, 34, 8,                                  // pk(@1)
+        SCRIPT_TEMPLATE_OP_BYTES, 1, 0x20,
+        SCRIPT_TEMPLATE_OP_XONLY_PUBKEY, 1,
+        SCRIPT_TEMPLATE_OP_BYTES, 1, 0xac,
+        TAPTREE_OP_LEAF, 34, 8,                                  // pk(@2)
+        SCRIPT_TEMPLATE_OP_BYTES, 1, 0x20,
+        SCRIPT_TEMPLATE_OP_XONLY_PUBKEY, 2,
+        SCRIPT_TEMPLATE_OP_BYTES, 1, 0xac,
+        TAPTREE_OP_BRANCH
+    };
+    int res =
+        compile_script_template((policy_node_t *) out, script_template, sizeof(script_template));
+    assert_int_equal(res, sizeof(expected_tr_tree));
+    assert_memory_equal(script_template, expected_tr_tree, sizeof(expected_tr_tree));
+
+    // the program of the tree alone, as in the script template
+    res = compile_taptree_template(((policy_node_tr_t *) out)->tree,
+                                   script_template,
+                                   sizeof(script_template));
+    assert_int_equal(res, 23);
+    assert_memory_equal(script_template, expected_tr_tree + 10, 23);
+}
+
+static void test_compile_script_template_miniscript(void **state) {
+    (void) state;
+
+    uint8_t out[MAX_POLICY_MAP_MEMORY_SIZE];
+    uint8_t script_template[MAX_SCRIPT_TEMPLATE_LEN];
+
+    // the consecutive bytes are in a single operation, and v: is merged into the OP_CHECKSIG
+    assert_int_equal(PARSE_POLICY("wsh(and_v(v:pk(@0),older(144)))", out, sizeof(out)), 0);
+    const uint8_t expected_and_v[] = {
+        0, 34 + 1 + 3 + 1, 12,                                   // and_v(v:pk(@0),older(144))
+        SCRIPT_TEMPLATE_OP_BYTES, 1, 0x21, SCRIPT_TEMPLATE_OP_PUBKEY, 0,
+        SCRIPT_TEMPLATE_OP_BYTES, 5, 0xad, 0x02, 0x90, 0x00, 0xb2,  // OP_CHECKSIGVERIFY <144> OP_CSV
+        0, 34, 5,                                                // wsh(...)
+        SCRIPT_TEMPLATE_OP_BYTES, 2, 0x00, 0x20,
+        SCRIPT_TEMPLATE_OP_INNER_SHA256
+    };
+    int res =
+        compile_script_template((policy_node_t *) out, script_template, sizeof(script_template));
+    assert_int_equal(res, sizeof(expected_and_v));
+    assert_memory_equal(script_template, expected_and_v, sizeof(expected_and_v));
+
+    assert_int_equal(PARSE_POLICY("wsh(thresh(2,pk(@0),s:pk(@1),a:pk(@2)))", out, sizeof(out)), 0);
+    const uint8_t expected_thresh[] = {
+        0, 35 + 37 + 38 + 2, 27,                                 // thresh(2,...)
+        SCRIPT_TEMPLATE_OP_BYTES, 1, 0x21, SCRIPT_TEMPLATE_OP_PUBKEY, 0,
+        SCRIPT_TEMPLATE_OP_BYTES, 3, 0xac, 0x7c, 0x21, SCRIPT_TEMPLATE_OP_PUBKEY, 1,  // OP_SWAP
+        SCRIPT_TEMPLATE_OP_BYTES, 4, 0xac, 0x93, 0x6b, 0x21, SCRIPT_TEMPLATE_OP_PUBKEY, 2,
+        SCRIPT_TEMPLATE_OP_BYTES, 5, 0xac, 0x6c, 0x93, 0x52, 0x87,  // ... OP_ADD OP_2 OP_EQUAL
+        0, 34, 5,                                                // wsh(...)
+        SCRIPT_TEMPLATE_OP_BYTES, 2, 0x00, 0x20,
+        SCRIPT_TEMPLATE_OP_INNER_SHA256
+    };
+    res = compile_script_template((policy_node_t *) out, script_template, sizeof(script_template));
+    assert_int_equal(res, sizeof(expected_thresh));
+    assert_memory_equal(script_template, expected_thresh, sizeof(expected_thresh));
+
+    // v: on a thresh turns its OP_EQUAL into OP_EQUALVERIFY
+    assert_int_equal(
+        PARSE_POLICY("wsh(and_v(v:thresh(1,pk(@0),s:pk(@1)),older(1000)))", out, sizeof(out)),
+        0);
+    res = compile_script_template((policy_node_t *) out, script_template, sizeof(script_template));
+    assert_true(res > 0);
+    const uint8_t expected_tail[] = {
+        SCRIPT_TEMPLATE_OP_BYTES, 8, 0xac, 0x93, 0x51, 0x88, 0x02, 0xe8, 0x03, 0xb2
+    };
+    assert_memory_equal(script_template + res - 8 - sizeof(expected_tail),
+                        expected_tail,
+                        sizeof(expected_tail));
+}
+
+static void test_compiled_policy(void **state) {
+    (void) state;
+
+    policy_map_wallet_header_t header = {.type = WALLET_TYPE_POLICY_MAP,
+                                         .name_len = 5,
+                                         .name = "Vault",
+                                         .n_keys = 2};
+    memset(header.keys_info_merkle_root, 0x42, sizeof(header.keys_info_merkle_root));
+    uint8_t wallet_id[32];
+    memset(wallet_id, 0x11, sizeof(wallet_id));
+    const uint8_t script_template[] = {SCRIPT_TEMPLATE_OP_BYTES, 1, 0x51};
+
+    uint8_t compiled[MAX_COMPILED_POLICY_LEN];
+    int len = write_compiled_policy(&header,
+                                    wallet_id,
+                                    script_template,
+                                    sizeof(script_template),
+                                    compiled,
+                                    sizeof(compiled));
+    assert_int_equal(len, 1 + 32 + 1 + 32 + 1 + 5 + 1 + sizeof(script_template));
+
+    policy_map_wallet_header_t read_header;
+    uint8_t read_wallet_id[32];
+    uint8_t read_script_template[MAX_SCRIPT_TEMPLATE_LEN];
+    buffer_t buf = buffer_create(compiled, len);
+    assert_int_equal(read_compiled_policy(&buf,
+                                          &read_header,
+                                          read_wallet_id,
+                                          read_script_template,
+                                          sizeof(read_script_template)),
+                     sizeof(script_template));
+    assert_memory_equal(read_wallet_id, wallet_id, sizeof(wallet_id));
+    assert_int_equal(read_header.n_keys, 2);
+    assert_memory_equal(read_header.keys_info_merkle_root,
+                        header.keys_info_merkle_root,
+                        sizeof(header.keys_info_merkle_root));
+    assert_string_equal(read_header.name, "Vault");
+    assert_memory_equal(read_script_template, script_template, sizeof(script_template));
+
+    // truncated, or with trailing bytes
+    buf = buffer_create(compiled, len - 1);
+    assert_true(read_compiled_policy(&buf,
+                                     &read_header,
+                                     read_wallet_id,
+                                     read_script_template,
+                                     sizeof(read_script_template)) < 0);
+    compiled[len] = 0;
+    buf = buffer_create(compiled, len + 1);
+    assert_true(read_compiled_policy(&buf,
+                                     &read_header,
+                                     read_wallet_id,
+                                     read_script_template,
+                                     sizeof(read_script_template)) < 0);
+}
+
+static void test_parse_policy_map_key_info_binary(void **state) {
+    (void) state;
+
+    // [f5acc2fd/48'/1'/0'/2'] followed by the serialized extended pubkey, with wildcard
+    uint8_t binary[1 + 4 + 1 + 4 * 4 + SERIALIZED_EXTENDED_PUBKEY_LEN] = {
+        KEY_INFO_FLAG_HAS_KEY_ORIGIN | KEY_INFO_FLAG_HAS_WILDCARD,
+        0xf5, 0xac, 0xc2, 0xfd,
+        4,
+        0x30, 0x00, 0x00, 0x80,
+        0x01, 0x00, 0x00, 0x80,
+        0x00, 0x00, 0x00, 0x80,
+        0x02, 0x00, 0x00, 0x80};
+    uint8_t *ext_pubkey = binary + sizeof(binary) - SERIALIZED_EXTENDED_PUBKEY_LEN;
+    for (int i = 0; i < SERIALIZED_EXTENDED_PUBKEY_LEN; i++) {
+        ext_pubkey[i] = (uint8_t) i;
+    }
+
+    policy_map_key_info_t key_info;
+    buffer_t buf = buffer_create(binary, sizeof(binary));
+    assert_int_equal(parse_policy_map_key_info(&buf, &key_info), 0);
+    assert_true(key_info.is_binary);
+    assert_true(key_info.has_key_origin);
+    assert_true(key_info.has_wildcard);
+    assert_memory_equal(key_info.master_key_fingerprint, binary + 1, 4);
+    assert_int_equal(key_info.master_key_derivation_len, 4);
+    assert_int_equal(key_info.master_key_derivation[0], 0x80000030);
+    assert_int_equal(key_info.master_key_derivation[3], 0x80000002);
+    assert_memory_equal(key_info.serialized_ext_pubkey, ext_pubkey, SERIALIZED_EXTENDED_PUBKEY_LEN);
+
+    // without key origin nor wildcard
+    uint8_t *no_origin = binary + 1 + 4 + 1 + 4 * 4 - 1;
+    no_origin[0] = 0;
+    buf = buffer_create(no_origin, 1 + SERIALIZED_EXTENDED_PUBKEY_LEN);
+    assert_int_equal(parse_policy_map_key_info(&buf, &key_info), 0);
+    assert_true(key_info.is_binary);
+    assert_false(key_info.has_key_origin);
+    assert_false(key_info.has_wildcard);
+    assert_memory_equal(key_info.serialized_ext_pubkey, ext_pubkey, SERIALIZED_EXTENDED_PUBKEY_LEN);
+
+    // truncated, or with trailing bytes
+    buf = buffer_create(no_origin, SERIALIZED_EXTENDED_PUBKEY_LEN);
+    assert_int_equal(parse_policy_map_key_info(&buf, &key_info), -1);
+    uint8_t trailing[1 + SERIALIZED_EXTENDED_PUBKEY_LEN + 1] = {0};
+    buf = buffer_create(trailing, sizeof(trailing));
+    assert_int_equal(parse_policy_map_key_info(&buf, &key_info), -1);
+
+    // too many derivation steps
+    uint8_t long_path[1 + 4 + 1 + 4 * (MAX_BIP32_PATH_STEPS + 1) + SERIALIZED_EXTENDED_PUBKEY_LEN] =
+        {KEY_INFO_FLAG_HAS_KEY_ORIGIN, 0, 0, 0, 0, MAX_BIP32_PATH_STEPS + 1};
+    buf = buffer_create(long_path, sizeof(long_path));
+    assert_int_equal(parse_policy_map_key_info(&buf, &key_info), -1);
+}
+
+static void test_read_policy_map_wallet_long(void **state) {
+    (void) state;
+
+    // longer than the 74 bytes that were the previous limit
+    const char policy[] =
+        "wsh(thresh(3,pk(@0),s:pk(@1),s:pk(@2),s:pk(@3),s:pk(@4),s:pk(@5),s:pk(@6),s:pk(@7)))";
+    uint8_t serialized[MAX_POLICY_MAP_SERIALIZED_LENGTH + 1] = {WALLET_TYPE_POLICY_MAP, 4};
+    size_t len = 2;
+    memcpy(serialized + len, "Cold", 4);
+    len += 4;
+    serialized[len++] = sizeof(policy) - 1;
+    memcpy(serialized + len, policy, sizeof(policy) - 1);
+    len += sizeof(policy) - 1;
+    serialized[len++] = 8;
+    memset(serialized + len, 0x42, 32);
+    len += 32;
+
+    policy_map_wallet_header_t header;
+    buffer_t buf = buffer_create(serialized, len);
+    assert_int_equal(read_policy_map_wallet(&buf, &header), 0);
+    assert_int_equal(header.policy_map_len, sizeof(policy) - 1);
+    assert_memory_equal(header.policy_map, policy, sizeof(policy) - 1);
+    assert_int_equal(header.n_keys, 8);
+
+    uint8_t out[2 * MAX_POLICY_MAP_MEMORY_SIZE];
+    buf = buffer_create(header.policy_map, header.policy_map_len);
+    assert_true(parse_policy_map(&buf, out, sizeof(out)) >= 0);
+
+    // a descriptor template longer than MAX_POLICY_MAP_STR_LENGTH is rejected
+    uint8_t too_long[2 + 3 + MAX_POLICY_MAP_STR_LENGTH + 1] = {WALLET_TYPE_POLICY_MAP, 0, 0xfd};
+    too_long[3] = (uint8_t) (MAX_POLICY_MAP_STR_LENGTH + 1);
+    too_long[4] = (uint8_t) ((MAX_POLICY_MAP_STR_LENGTH + 1) >> 8);
+    buf = buffer_create(too_long, sizeof(too_long));
+    assert_int_equal(read_policy_map_wallet(&buf, &header), -7);
+}
+
+static void test_policy_map_wallet_parser(void **state) {
+    (void) state;
+
+    const char policy[] = "wsh(sortedmulti(2,@0/**,@1/**))";
+    uint8_t serialized[MAX_POLICY_MAP_SERIALIZED_LENGTH + 1] = {WALLET_TYPE_POLICY_MAP, 4};
+    size_t len = 2;
+    memcpy(serialized + len, "Cold", 4);
+    len += 4;
+    serialized[len++] = sizeof(policy) - 1;
+    memcpy(serialized + len, policy, sizeof(policy) - 1);
+    len += sizeof(policy) - 1;
+    serialized[len++] = 2;
+    memset(serialized + len, 0x42, 32);
+    len += 32;
+
+    policy_map_wallet_header_t expected;
+    buffer_t buf = buffer_create(serialized, len);
+    assert_int_equal(read_policy_map_wallet(&buf, &expected), 0);
+
+    // the same header, with the bytes received one at a time; the trailing byte is not parsed
+    policy_map_wallet_header_t header;
+    policy_map_wallet_parser_t parser;
+    policy_map_wallet_parser_init(&parser, &header);
+    for (size_t i = 0; i < len; i++) {
+        assert_int_equal(policy_map_wallet_parser_update(&parser, serialized + i, 1), 1);
+    }
+    assert_int_equal(policy_map_wallet_parser_update(&parser, serialized + len, 1), 0);
+    assert_int_equal(policy_map_wallet_parser_finish(&parser), 0);
+    assert_int_equal(header.type, expected.type);
+    assert_string_equal(header.name, expected.name);
+    assert_int_equal(header.policy_map_len, expected.policy_map_len);
+    assert_memory_equal(header.policy_map, expected.policy_map, expected.policy_map_len);
+    assert_int_equal(header.n_keys, expected.n_keys);
+    assert_memory_equal(header.keys_info_merkle_root, expected.keys_info_merkle_root, 32);
+
+    // a truncated wallet policy fails with the error of read_policy_map_wallet
+    for (size_t truncated_len = 0; truncated_len < len; truncated_len++) {
+        buf = buffer_create(serialized, truncated_len);
+        int expected_error = read_policy_map_wallet(&buf, &expected);
+        assert_true(expected_error < 0);
+
+        policy_map_wallet_parser_init(&parser, &header);
+        policy_map_wallet_parser_update(&parser, serialized, truncated_len);
+        assert_int_equal(policy_map_wallet_parser_finish(&parser), expected_error);
+    }
+
+    // an invalid field stops the parsing
+    serialized[1] = MAX_WALLET_NAME_LENGTH + 1;
+    policy_map_wallet_parser_init(&parser, &header);
+    assert_int_equal(policy_map_wallet_parser_update(&parser, serialized, len), 2);
+    assert_int_equal(policy_map_wallet_parser_finish(&parser), -4);
+}
+
+static void test_classify_script(void **state) {
+    (void) state;
+
+    script_info_t info;
+
+    uint8_t p2pkh[25] = {0x76, 0xa9, 0x14};
+    p2pkh[23] = 0x88;
+    p2pkh[24] = 0xac;
+    classify_script(p2pkh, sizeof(p2pkh), &info);
+    assert_int_equal(info.type, SCRIPT_TYPE_P2PKH);
+    assert_int_equal(info.segwit_version, -1);
+    assert_int_equal(info.program_offset, 3);
+    assert_int_equal(info.program_len, 20);
+
+    uint8_t p2sh[23] = {0xa9, 0x14};
+    p2sh[22] = 0x87;
+    classify_script(p2sh, sizeof(p2sh), &info);
+    assert_int_equal(info.type, SCRIPT_TYPE_P2SH);
+    assert_int_equal(info.program_offset, 2);
+    assert_int_equal(info.program_len, 20);
+
+    // a P2SH without its OP_EQUAL
+    p2sh[22] = 0x88;
+    classify_script(p2sh, sizeof(p2sh), &info);
+    assert_int_equal(info.type, -1);
+
+    uint8_t p2wpkh[22] = {0x00, 0x14};
+    classify_script(p2wpkh, sizeof(p2wpkh), &info);
+    assert_int_equal(info.type, SCRIPT_TYPE_P2WPKH);
+    assert_int_equal(info.segwit_version, 0);
+    assert_int_equal(info.program_len, 20);
+
+    uint8_t p2wsh[34] = {0x00, 0x20};
+    classify_script(p2wsh, sizeof(p2wsh), &info);
+    assert_int_equal(info.type, SCRIPT_TYPE_P2WSH);
+    assert_int_equal(info.segwit_version, 0);
+    assert_int_equal(info.program_len, 32);
+
+    uint8_t p2tr[34] = {0x51, 0x20};
+    classify_script(p2tr, sizeof(p2tr), &info);
+    assert_int_equal(info.type, SCRIPT_TYPE_P2TR);
+    assert_int_equal(info.segwit_version, 1);
+    assert_int_equal(info.program_offset, 2);
+    assert_int_equal(info.program_len, 32);
+    assert_int_equal(get_script_type(p2tr, sizeof(p2tr)), SCRIPT_TYPE_P2TR);
+
+    // a witness program of a future version is recognized, but not supported
+    uint8_t v2[18] = {0x52, 0x10};
+    classify_script(v2, sizeof(v2), &info);
+    assert_int_equal(info.type, -1);
+    assert_int_equal(info.segwit_version, 2);
+
+    // the push must cover the rest of the script
+    classify_script(p2wpkh, sizeof(p2wpkh) - 1, &info);
+    assert_int_equal(info.type, -1);
+    assert_int_equal(info.segwit_version, -1);
+
+    uint8_t op_return[] = {0x6a, 0x04, 0xde, 0xad, 0xbe, 0xef};
+    classify_script(op_return, sizeof(op_return), &info);
+    assert_int_equal(info.type, -1);
+    assert_int_equal(info.segwit_version, -1);
+    assert_int_equal(info.program_len, 0);
 }
 
 int main() {
@@ -217,7 +807,18 @@ int main() {
         cmocka_unit_test(test_parse_policy_map_multisig_1),
         cmocka_unit_test(test_parse_policy_map_multisig_2),
         cmocka_unit_test(test_parse_policy_map_multisig_3),
+        cmocka_unit_test(test_parse_policy_map_taproot_tree),
+        cmocka_unit_test(test_parse_policy_map_miniscript),
         cmocka_unit_test(test_failures),
+        cmocka_unit_test(test_compile_script_template_singlesig),
+        cmocka_unit_test(test_compile_script_template_multisig),
+        cmocka_unit_test(test_compile_script_template_taproot_tree),
+        cmocka_unit_test(test_compile_script_template_miniscript),
+        cmocka_unit_test(test_compiled_policy),
+        cmocka_unit_test(test_parse_policy_map_key_info_binary),
+        cmocka_unit_test(test_read_policy_map_wallet_long),
+        cmocka_unit_test(test_policy_map_wallet_parser),
+        cmocka_unit_test(test_classify_script),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
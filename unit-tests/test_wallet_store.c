@@ -0,0 +1,113 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "common/wallet_store.h"
+
+static int n_nvm_writes;
+static uint32_t master_fingerprint = 0xF5ACC2FD;
+
+uint32_t crypto_get_master_key_fingerprint() {
+    return master_fingerprint;
+}
+
+// the NVRAM of the store is plain memory in the unit tests
+void nvm_write(void *dst_adr, void *src_adr, unsigned int src_len) {
+    ++n_nvm_writes;
+    if (src_adr == NULL) {
+        memset(dst_adr, 0, src_len);
+    } else {
+        memcpy(dst_adr, src_adr, src_len);
+    }
+}
+
+static void test_wallet_store(void **state) {
+    (void) state;
+
+    uint8_t id1[32], id2[32], hmac1[32], hmac2[32];
+    memset(id1, 0x11, 32);
+    memset(id2, 0x22, 32);
+    memset(hmac1, 0xA1, 32);
+    memset(hmac2, 0xA2, 32);
+
+    policy_map_wallet_header_t header1, header2;
+    memset(&header1, 0, sizeof(header1));
+    memset(&header2, 0, sizeof(header2));
+    header1.n_keys = 3;
+    header2.n_keys = 5;
+
+    assert_null(wallet_store_get(id1, hmac1));
+
+    wallet_store_add(id1, hmac1, &header1);
+
+    const policy_map_wallet_header_t *found = wallet_store_get(id1, hmac1);
+    assert_non_null(found);
+    assert_memory_equal(found, &header1, sizeof(header1));
+
+    // the hmac must match the one of the registration
+    assert_null(wallet_store_get(id1, hmac2));
+    uint8_t hmac_zero[32] = {0};
+    assert_null(wallet_store_get(id1, hmac_zero));
+    assert_null(wallet_store_get(id2, hmac1));
+
+    // adding the same wallet again does not write the NVRAM
+    n_nvm_writes = 0;
+    for (int i = 0; i < WALLET_STORE_SIZE; i++) {
+        wallet_store_add(id1, hmac1, &header1);
+    }
+    assert_int_equal(n_nvm_writes, 0);
+
+    uint8_t id[32];
+    for (int i = 0; i < WALLET_STORE_SIZE - 1; i++) {
+        memset(id, i, 32);
+        wallet_store_add(id, hmac2, &header2);
+    }
+    assert_non_null(wallet_store_get(id1, hmac1));
+
+    // the oldest entry is replaced once the store is full
+    wallet_store_add(id2, hmac2, &header2);
+    assert_null(wallet_store_get(id1, hmac1));
+    found = wallet_store_get(id2, hmac2);
+    assert_non_null(found);
+    assert_memory_equal(found, &header2, sizeof(header2));
+}
+
+static void test_wallet_store_other_seed(void **state) {
+    (void) state;
+
+    uint8_t id[32], hmac[32];
+    memset(id, 0x33, 32);
+    memset(hmac, 0xA3, 32);
+
+    policy_map_wallet_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.n_keys = 2;
+
+    wallet_store_add(id, hmac, &header);
+    assert_non_null(wallet_store_get(id, hmac));
+
+    // with another seed, for example with a passphrase, the entry is not returned
+    master_fingerprint = 0x12345678;
+    assert_null(wallet_store_get(id, hmac));
+
+    // the same wallet can be stored for that seed too
+    n_nvm_writes = 0;
+    wallet_store_add(id, hmac, &header);
+    assert_int_not_equal(n_nvm_writes, 0);
+    assert_non_null(wallet_store_get(id, hmac));
+
+    master_fingerprint = 0xF5ACC2FD;
+    assert_non_null(wallet_store_get(id, hmac));
+}
+
+int main() {
+    const struct CMUnitTest tests[] = {cmocka_unit_test(test_wallet_store),
+                                       cmocka_unit_test(test_wallet_store_other_seed)};
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}